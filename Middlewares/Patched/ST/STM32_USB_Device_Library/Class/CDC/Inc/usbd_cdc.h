@@ -64,7 +64,16 @@ extern "C" {
 #define CDC_CMD_PACKET_SIZE                         8U  /* Control Endpoint Packet size */
 
 #define USB_CDC_CONFIG_DESC_SIZ                     67U
-#define USB_MIDI_CONFIG_DESC_SIZ                     101U
+/* Number of virtual MIDI cables (ports) in the MIDI descriptors, 1 to 4 */
+#ifndef USBD_MIDI_NUM_CABLES
+#define USBD_MIDI_NUM_CABLES                        1U
+#endif /* USBD_MIDI_NUM_CABLES */
+#if USBD_MIDI_NUM_CABLES < 1 || USBD_MIDI_NUM_CABLES > 4
+#error "USBD_MIDI_NUM_CABLES must be 1 to 4"
+#endif
+/* 4 jacks per cable, and an embedded jack per cable at each endpoint */
+#define USB_MIDI_MS_DESC_SIZ                        (33U + 32U * USBD_MIDI_NUM_CABLES)
+#define USB_MIDI_CONFIG_DESC_SIZ                    (36U + USB_MIDI_MS_DESC_SIZ)
 #define CDC_DATA_HS_IN_PACKET_SIZE                  CDC_DATA_HS_MAX_PACKET_SIZE
 #define CDC_DATA_HS_OUT_PACKET_SIZE                 CDC_DATA_HS_MAX_PACKET_SIZE
 
@@ -149,6 +158,10 @@ extern USBD_ClassTypeDef USBD_CDC;
 // these are used to hack in an optional MIDI mode
 #define USBD_MODE_CDC  0
 #define USBD_MODE_MIDI 1
+// the audio mode registers the USBD_UAC class in place of this one
+#define USBD_MODE_AUDIO 2
+// and the mass storage mode registers USBD_MSC
+#define USBD_MODE_MSC 3
 extern uint8_t usbd_mode;
 
 /**
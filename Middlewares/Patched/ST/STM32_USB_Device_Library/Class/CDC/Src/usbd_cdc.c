@@ -168,6 +168,34 @@ static uint8_t CDCOutEpAdd = CDC_OUT_EP;
 static uint8_t CDCCmdEpAdd = CDC_CMD_EP;
 
 // Hacked descriptors to allow either CDC or MIDI
+
+// The embedded and external IN and OUT jacks of a cable, with IDs from base
+#define USB_MIDI_CABLE_JACKS(base)                                   \
+  0x06, 0x24, 0x02, 0x01, (base) + 1, 0x00,                          \
+  0x06, 0x24, 0x02, 0x02, (base) + 2, 0x00,                          \
+  0x09, 0x24, 0x03, 0x01, (base) + 3, 0x01, (base) + 2, 0x01, 0x00,  \
+  0x09, 0x24, 0x03, 0x02, (base) + 6, 0x01, (base) + 1, 0x01, 0x00
+
+#if USBD_MIDI_NUM_CABLES == 1
+#define USB_MIDI_JACKS USB_MIDI_CABLE_JACKS(0x00)
+#define USB_MIDI_EMB_IN_JACKS 0x01
+#define USB_MIDI_EMB_OUT_JACKS 0x03
+#elif USBD_MIDI_NUM_CABLES == 2
+#define USB_MIDI_JACKS USB_MIDI_CABLE_JACKS(0x00), USB_MIDI_CABLE_JACKS(0x10)
+#define USB_MIDI_EMB_IN_JACKS 0x01, 0x11
+#define USB_MIDI_EMB_OUT_JACKS 0x03, 0x13
+#elif USBD_MIDI_NUM_CABLES == 3
+#define USB_MIDI_JACKS USB_MIDI_CABLE_JACKS(0x00), USB_MIDI_CABLE_JACKS(0x10), \
+                       USB_MIDI_CABLE_JACKS(0x20)
+#define USB_MIDI_EMB_IN_JACKS 0x01, 0x11, 0x21
+#define USB_MIDI_EMB_OUT_JACKS 0x03, 0x13, 0x23
+#else
+#define USB_MIDI_JACKS USB_MIDI_CABLE_JACKS(0x00), USB_MIDI_CABLE_JACKS(0x10), \
+                       USB_MIDI_CABLE_JACKS(0x20), USB_MIDI_CABLE_JACKS(0x30)
+#define USB_MIDI_EMB_IN_JACKS 0x01, 0x11, 0x21, 0x31
+#define USB_MIDI_EMB_OUT_JACKS 0x03, 0x13, 0x23, 0x33
+#endif
+
 __ALIGN_BEGIN uint8_t USBD_MIDI_CfgDesc[USB_MIDI_CONFIG_DESC_SIZ] __ALIGN_END = 
 {
   // configuration descriptor
@@ -177,23 +205,18 @@ __ALIGN_BEGIN uint8_t USBD_MIDI_CfgDesc[USB_MIDI_CONFIG_DESC_SIZ] __ALIGN_END =
   0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, // Standard AC Interface Descriptor
   0x09, 0x24, 0x01, 0x00, 0x01, 0x09, 0x00, 0x01, 0x01, // Class-specific AC Interface Descriptor
   0x09, 0x04, 0x01, 0x00, 0x02, 0x01, 0x03, 0x00, 0x00, // MIDIStreaming Interface Descriptors
-  0x07, 0x24, 0x01, 0x00, 0x01, 0x41, 0x00,             // Class-Specific MS Interface Header Descriptor
-
-  // MIDI IN JACKS
-  0x06, 0x24, 0x02, 0x01, 0x01, 0x00,
-  0x06, 0x24, 0x02, 0x02, 0x02, 0x00,
+  0x07, 0x24, 0x01, 0x00, 0x01, USB_MIDI_MS_DESC_SIZ, 0x00, // Class-Specific MS Interface Header Descriptor
 
-  // MIDI OUT JACKS
-  0x09, 0x24, 0x03, 0x01, 0x03, 0x01, 0x02, 0x01, 0x00,
-  0x09, 0x24, 0x03, 0x02, 0x06, 0x01, 0x01, 0x01, 0x00,
+  // MIDI IN and OUT JACKS of each cable
+  USB_MIDI_JACKS,
 
   // OUT endpoint descriptor
   0x09, 0x05, CDC_OUT_EP, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,
-  0x05, 0x25, 0x01, 0x01, 0x01,
+  0x04 + USBD_MIDI_NUM_CABLES, 0x25, 0x01, USBD_MIDI_NUM_CABLES, USB_MIDI_EMB_IN_JACKS,
 
   // IN endpoint descriptor
   0x09, 0x05, CDC_IN_EP, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,
-  0x05, 0x25, 0x01, 0x01, 0x03
+  0x04 + USBD_MIDI_NUM_CABLES, 0x25, 0x01, USBD_MIDI_NUM_CABLES, USB_MIDI_EMB_OUT_JACKS
 };
 
 /* USB CDC device Configuration Descriptor */
@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+#
+# prints the flash and RAM used by each object file, per memory region,
+# and lists the large zero initialized buffers in internal RAM, which
+# could go to the SDRAM instead
+#
+# reads either the linker map of a firmware:
+#   memory_report.py build/MyProject.map
+# or the sections of object files or archives, before the linker drops the
+# unused ones, with the size tool of the toolchain:
+#   memory_report.py --size arm-none-eabi-size build/libdaisy.a
+#
+import sys
+import os
+import re
+import argparse
+import subprocess
+
+# where the output sections of core/STM32H750IB_flash.lds go, for object
+# files, which have no addresses yet. Longest prefix first.
+NOMINAL_SECTIONS = [
+    ('.itcmram_text', 'ITCMRAM', True),
+    ('.dtcmram_data', 'DTCMRAM', True),
+    ('.dtcmram_bss', 'DTCMRAM', False),
+    ('.sram1_bss', 'RAM_D2', False),
+    ('.sram_text', 'SRAM', True),
+    ('.sdram_text', 'SDRAM', True),
+    ('.sdram_data', 'SDRAM', True),
+    ('.sdram_bss', 'SDRAM', False),
+    ('.backup_sram', 'BACKUP_SRAM', False),
+    ('.qspiflash_text', 'QSPIFLASH', False),
+    ('.qspiflash_data', 'QSPIFLASH', False),
+    ('.qspiflash_bss', 'QSPIFLASH', False),
+    ('.text', 'FLASH', False),
+    ('.rodata', 'FLASH', False),
+    ('.ARM.extab', 'FLASH', False),
+    ('.ARM.exidx', 'FLASH', False),
+    ('.init_array', 'FLASH', False),
+    ('.fini_array', 'FLASH', False),
+    ('.preinit_array', 'FLASH', False),
+    ('.data', 'SRAM', True),
+    ('.bss', 'SRAM', False),
+    ('COMMON', 'SRAM', False),
+]
+
+# zero initialized buffers in these can move to the SDRAM. The D2 SRAM
+# isn't in the list, its buffers are there for the DMA.
+MOVABLE_SECTIONS = ('.bss', '.dtcmram_bss', 'COMMON')
+
+NON_ALLOC = ('.debug', '.comment', '.ARM.attributes', '.stab', '.note',
+             '/DISCARD/')
+
+parser = argparse.ArgumentParser(
+    description='Prints the memory used by each module of a firmware')
+parser.add_argument('files', nargs='+',
+                    help='a linker map, or with --size objects and archives')
+parser.add_argument('--size', metavar='TOOL',
+                    help='reads objects with this size tool, e.g. '
+                    'arm-none-eabi-size, instead of a map')
+parser.add_argument('--sections', action='store_true',
+                    help='also lists the sections of each module')
+parser.add_argument('--top', type=int, default=40,
+                    help='number of modules to list, 0 for all')
+parser.add_argument('--threshold', type=int, default=1024,
+                    help='smallest buffer in bytes to flag for the SDRAM')
+parser.add_argument('--csv', action='store_true',
+                    help='prints module,region,section,bytes lines instead')
+args = parser.parse_args()
+
+
+class Usage:
+    """bytes per module, region and output section, and the buffers"""
+
+    def __init__(self):
+        self.regions = {}  # name -> (origin, length)
+        self.used = {}  # (module, region, section) -> bytes
+        self.buffers = []  # (bytes, symbol, section, region, module)
+
+    def add(self, module, region, section, size):
+        key = (module, region, section)
+        self.used[key] = self.used.get(key, 0) + size
+
+    def add_buffer(self, size, symbol, section, region, module):
+        """returns the index of the buffer, or None if it's not one"""
+        if section.startswith(MOVABLE_SECTIONS) and region != 'SDRAM' \
+                and size >= args.threshold:
+            self.buffers.append((size, symbol, section, region, module))
+            return len(self.buffers) - 1
+        return None
+
+
+def module_name(path):
+    # libdaisy.a(midi.o) and build/src/hid/midi.o both become midi.o
+    m = re.match(r'.*\((.*)\)$', path)
+    return m.group(1) if m else os.path.basename(path)
+
+
+def nominal(section):
+    for prefix, region, loaded in NOMINAL_SECTIONS:
+        if section == prefix or section.startswith(prefix + '.') \
+                or section.startswith(prefix + '*'):
+            return prefix, region, loaded
+    return None, None, False
+
+
+def parse_map(path, usage):
+    with open(path, errors='replace') as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    region_re = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+    while i < len(lines) and not lines[i].startswith('Memory Configuration'):
+        i += 1
+    while i < len(lines) and \
+            not lines[i].startswith('Linker script and memory map'):
+        m = region_re.match(lines[i])
+        if m and m.group(1) != '*default*':
+            usage.regions[m.group(1)] = (int(m.group(2), 16),
+                                         int(m.group(3), 16))
+        i += 1
+
+    def region_of(addr):
+        for name, (origin, length) in usage.regions.items():
+            if origin <= addr < origin + length:
+                return name
+        return None
+
+    out_re = re.compile(r'^(\.\S+|/DISCARD/)(?:\s+0x([0-9a-fA-F]+)'
+                        r'\s+0x([0-9a-fA-F]+)(?:\s+load address'
+                        r'\s+0x([0-9a-fA-F]+))?)?\s*$')
+    in_re = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)'
+                       r'\s+(\S.*))?\s*$')
+    cont_re = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)'
+                         r'(?:\s+load address\s+0x([0-9a-fA-F]+))?'
+                         r'(?:\s+(\S.*))?\s*$')
+    sym_re = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([^\s=]+)\s*$')
+
+    out_name, out_region, load_region = None, None, None
+    pending = None  # buffer that's named after the next symbol line
+    while i < len(lines):
+        line = lines[i]
+        i += 1
+        m = out_re.match(line)
+        if m:
+            out_name = m.group(1)
+            addr, load = m.group(2), m.group(4)
+            if addr is None and i < len(lines):
+                c = cont_re.match(lines[i])
+                if c:
+                    addr, load = c.group(1), c.group(3)
+                    i += 1
+            out_region = region_of(int(addr, 16)) if addr else None
+            load_region = region_of(int(load, 16)) if load else None
+            if load_region == out_region:
+                load_region = None
+            pending = None
+            continue
+        if out_name is None or out_name.startswith(NON_ALLOC):
+            continue
+        m = in_re.match(line)
+        if m and not line.startswith(' *'):
+            name, addr, size, obj = m.groups()
+            if addr is None and i < len(lines):
+                c = cont_re.match(lines[i])
+                if not c or c.group(4) is None:
+                    continue
+                addr, size, obj = c.group(1), c.group(2), c.group(4)
+                i += 1
+            size = int(size, 16)
+            pending = None
+            if size == 0 or out_region is None:
+                continue
+            module = module_name(obj.strip())
+            usage.add(module, out_region, out_name, size)
+            if load_region:
+                usage.add(module, load_region, out_name + ' (init)', size)
+            pending = usage.add_buffer(size, name, out_name, out_region,
+                                       module)
+            continue
+        m = sym_re.match(line)
+        if m and pending is not None:
+            # named after the first symbol in its section, for buffers in
+            # sections like .dtcmram_bss, which don't carry the name
+            b = usage.buffers[pending]
+            usage.buffers[pending] = (b[0], m.group(2), b[2], b[3], b[4])
+            pending = None
+
+
+def parse_objects(tool, files, usage):
+    for name, (origin, length) in [('FLASH', (0x08000000, 128 << 10)),
+                                   ('ITCMRAM', (0, 64 << 10)),
+                                   ('DTCMRAM', (0x20000000, 128 << 10)),
+                                   ('SRAM', (0x24000000, 512 << 10)),
+                                   ('RAM_D2', (0x30000000, 288 << 10)),
+                                   ('BACKUP_SRAM', (0x38800000, 4 << 10)),
+                                   ('SDRAM', (0xc0000000, 64 << 20)),
+                                   ('QSPIFLASH', (0x90000000, 8 << 20))]:
+        usage.regions[name] = (origin, length)
+    try:
+        text = subprocess.run([tool, '-A'] + files, check=True,
+                              stdout=subprocess.PIPE,
+                              universal_newlines=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('can\'t run {}: {}'.format(tool, e))
+
+    module = None
+    for line in text.splitlines():
+        m = re.match(r'^(\S+)\s+(?:\(ex .*\))?\s*:\s*$', line)
+        if m:
+            module = module_name(m.group(1))
+            continue
+        m = re.match(r'^(\S+)\s+(\d+)\s+(\d+)\s*$', line)
+        if not m or module is None:
+            continue
+        section, size = m.group(1), int(m.group(2))
+        prefix, region, loaded = nominal(section)
+        if size == 0 or prefix is None:
+            continue
+        usage.add(module, region, prefix, size)
+        if loaded:
+            usage.add(module, 'FLASH', prefix + ' (init)', size)
+        usage.add_buffer(size, section, prefix, region, module)
+
+
+def demangle(names):
+    prefix = args.size[:-len('size')] if args.size and \
+        args.size.endswith('size') else 'arm-none-eabi-'
+    for tool in (prefix + 'c++filt', 'c++filt'):
+        try:
+            out = subprocess.run([tool], input='\n'.join(names),
+                                 stdout=subprocess.PIPE, check=True,
+                                 universal_newlines=True).stdout
+            return out.splitlines()
+        except (OSError, subprocess.CalledProcessError):
+            continue
+    return names
+
+
+def symbol_of(section_or_symbol):
+    # .bss._ZN5daisyL6bufferE -> _ZN5daisyL6bufferE
+    for prefix in MOVABLE_SECTIONS:
+        if section_or_symbol.startswith(prefix + '.'):
+            return section_or_symbol[len(prefix) + 1:]
+    return section_or_symbol
+
+
+def report(usage):
+    regions = sorted({r for (_, r, _) in usage.used},
+                     key=lambda r: usage.regions.get(r, (0, 0))[0])
+    if args.csv:
+        print('module,region,section,bytes')
+        for (module, region, section), size in sorted(usage.used.items()):
+            print('{},{},{},{}'.format(module, region, section, size))
+        for size, symbol, section, region, module in usage.buffers:
+            print('sdram_candidate,{},{},{},{}'.format(
+                region, section, symbol_of(symbol), size))
+        return
+
+    print('{:<12} {:>10} {:>10}'.format('region', 'used', 'size'))
+    for r in regions:
+        used = sum(s for (_, rr, _), s in usage.used.items() if rr == r)
+        length = usage.regions.get(r, (0, 0))[1]
+        pct = '{:5.1f}%'.format(100.0 * used / length) if length else ''
+        print('{:<12} {:>10} {:>10} {:>6}'.format(r, used, length, pct))
+    print()
+
+    modules = {}
+    for (module, region, _), size in usage.used.items():
+        modules.setdefault(module, {})
+        modules[module][region] = modules[module].get(region, 0) + size
+
+    # sorted by the internal RAM they take, the scarce part
+    def ram(per_region):
+        return sum(s for r, s in per_region.items()
+                   if r not in ('FLASH', 'QSPIFLASH', 'SDRAM'))
+
+    order = sorted(modules, key=lambda m: (-ram(modules[m]),
+                                           -modules[m].get('FLASH', 0), m))
+    if args.top:
+        order = order[:args.top]
+    width = max([len(m) for m in order] + [6])
+    print(('{:<' + str(width) + '}').format('module') +
+          ''.join(' {:>11}'.format(r) for r in regions))
+    for m in order:
+        print(('{:<' + str(width) + '}').format(m) +
+              ''.join(' {:>11}'.format(modules[m].get(r, '')) for r in regions))
+        if args.sections:
+            for (mm, r, sec), size in sorted(usage.used.items()):
+                if mm == m:
+                    print('    {:<24} {:<12} {:>8}'.format(sec, r, size))
+    if args.top and len(modules) > args.top:
+        print('... {} more, see --top'.format(len(modules) - args.top))
+    print()
+
+    if not usage.buffers:
+        print('no zero initialized buffers of {} bytes or more in internal '
+              'RAM'.format(args.threshold))
+        return
+    print('zero initialized buffers in internal RAM that could go to the '
+          'SDRAM with DSY_SDRAM_BSS,')
+    print('if they aren\'t in the audio path or used by a DMA that can\'t '
+          'reach it:')
+    buffers = sorted(usage.buffers, reverse=True)
+    names = demangle([symbol_of(b[1]) for b in buffers])
+    for (size, _, section, region, module), name in zip(buffers, names):
+        print('  {:>8}  {:<9} {:<14} {:<20} {}'.format(
+            size, region, section, module, name))
+
+
+usage = Usage()
+if args.size:
+    parse_objects(args.size, args.files, usage)
+else:
+    if len(args.files) != 1:
+        sys.exit('give one map file, or use --size for objects')
+    parse_map(args.files[0], usage)
+report(usage)
@@ -31,6 +31,17 @@ target_link_options(${FIRMWARE_NAME} PUBLIC
     -Wl,--print-memory-usage
 )
 
+# flash and RAM of each module of the firmware, from the linker map
+find_package(Python3 COMPONENTS Interpreter)
+if(Python3_FOUND)
+  add_custom_target(memory-report
+    COMMAND ${Python3_EXECUTABLE} ${LIBDAISY_DIR}/ci/memory_report.py
+      ${CMAKE_CURRENT_BINARY_DIR}/${FIRMWARE_NAME}.map
+    DEPENDS ${FIRMWARE_NAME}
+    VERBATIM
+    )
+endif()
+
 add_custom_command(TARGET ${FIRMWARE_NAME} POST_BUILD
     COMMAND ${CMAKE_OBJCOPY}
     ARGS -O ihex
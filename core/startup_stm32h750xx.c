@@ -1531,6 +1531,14 @@ int main();
 
 extern void *_sidata, *_sdata, *_edata;
 extern void *_sbss, *_ebss;
+extern void *_siitcmram_text, *_sitcmram_text, *_eitcmram_text;
+extern void *_sidtcmram_data, *_sdtcmram_data, *_edtcmram_data;
+extern void *_sstack;
+
+// Set when the stack was painted at startup, read by
+// System::GetStackHighWaterMark(). Build with DSY_STACK_PAINT defined, e.g.
+// PAINT_STACK = 1 in the program's Makefile.
+unsigned int dsy_stack_painted;
 
 void __attribute__((naked, noreturn)) Reset_Handler()
 {
@@ -1547,6 +1555,23 @@ void __attribute__((naked, noreturn)) Reset_Handler()
 	for (pDest = &_sbss; pDest != &_ebss; pDest++)
 		*pDest = 0;
 
+	// DSY_ITCM_FUNC code and DSY_DTCM_DATA variables, before anything runs
+	// from the ITCM. The TCMs are enabled out of reset.
+	for (pSource = &_siitcmram_text, pDest = &_sitcmram_text; pDest != &_eitcmram_text; pSource++, pDest++)
+		*pDest = *pSource;
+
+	for (pSource = &_sidtcmram_data, pDest = &_sdtcmram_data; pDest != &_edtcmram_data; pSource++, pDest++)
+		*pDest = *pSource;
+
+	#ifdef DSY_STACK_PAINT
+	// Fills the stack below the top 256 bytes, which this function may use,
+	// with System::kStackPaintPattern. The deepest word that doesn't hold it
+	// anymore is the high-water mark.
+	for (pDest = &_sstack; pDest < &_estack - 64; pDest++)
+		*pDest = (void *)0xA5A5A5A5;
+	dsy_stack_painted = 1;
+	#endif
+
 	#ifndef BOOT_APP
 	SystemInit();
 	#endif
@@ -0,0 +1,75 @@
+// Measures the first audio callbacks after a boot from the QSPI flash
+//
+// The callback runs a bank of sine oscillators, and the durations of the
+// first callbacks and the longest callback since are printed over the USB
+// serial logger, in us. From the QSPI flash, the first callbacks wait for
+// the flash on every instruction cache miss. Build with SRAM_FUNC=1 to
+// run the processing from the AXI SRAM with DSY_SRAM_FUNC, and compare.
+// The program waits for a serial monitor to be connected before starting.
+#include <math.h>
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+#if SRAM_FUNC
+#define PROCESS_FUNC DSY_SRAM_FUNC
+#else
+#define PROCESS_FUNC
+#endif
+
+DaisySeed hw;
+
+static constexpr size_t kNumOscillators = 16;
+
+static float phases[kNumOscillators];
+
+static void PROCESS_FUNC ProcessOscillators(float* out, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        float sum = 0.f;
+        for(size_t osc = 0; osc < kNumOscillators; osc++)
+        {
+            phases[osc] += 0.001f * (osc + 1);
+            if(phases[osc] > 1.f)
+                phases[osc] -= 1.f;
+            sum += sinf(phases[osc] * 6.2831853f);
+        }
+        out[i] = sum / kNumOscillators;
+    }
+}
+
+static void AudioCallback(AudioHandle::InputBuffer  in,
+                          AudioHandle::OutputBuffer out,
+                          size_t                    size)
+{
+    ProcessOscillators(out[0], size);
+    for(size_t i = 0; i < size; i++)
+        out[1][i] = out[0][i];
+}
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    const float us_per_cycle = 1e6f / System::GetCpuFreq();
+
+    // the callbacks start cold, right after the log
+    hw.StartAudio(AudioCallback);
+    System::Delay(1000);
+    const AudioHandle::CallbackStats stats
+        = hw.audio_handle.GetCallbackStats();
+
+    hw.PrintLine("Cold Start Benchmark, processing in %s",
+                 SRAM_FUNC ? "SRAM" : "QSPI flash");
+    for(size_t i = 0; i < DSY_AUDIO_COLD_START_CALLBACKS; i++)
+    {
+        hw.PrintLine("callback %u: %.1f us",
+                     unsigned(i),
+                     stats.first_cycles[i] * us_per_cycle);
+    }
+    hw.PrintLine("last: %.1f us, longest: %.1f us",
+                 stats.last_cycles * us_per_cycle,
+                 stats.worst_case_cycles * us_per_cycle);
+    while(1) {}
+}
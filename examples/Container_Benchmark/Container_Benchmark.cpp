@@ -0,0 +1,42 @@
+// Times the core operations of the util containers
+//
+// Runs ContainerBenchmark on FIFO, RingBuffer, Stack, FixedCapStr and
+// MappedFloatValue, and prints the CPU cycles per operation over the USB
+// serial logger, with interrupts disabled during the runs.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The same operations run on the host with "make benchmark" in tests/,
+// which is quicker for trying a change to one of the headers. This shows
+// what it costs on the Cortex-M7.
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+DaisySeed hw;
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    hw.PrintLine("Container Benchmark, %lu MHz",
+                 (unsigned long)(System::GetCpuFreq() / 1000000));
+
+    ContainerBenchmark::Result results[ContainerBenchmark::kNumResults];
+    {
+        ScopedIrqBlocker irq_blocker;
+        ContainerBenchmark::Run(System::GetCycleCount, results);
+    }
+
+    ContainerBenchmark::PrintHeader<DaisySeed::Log>("cycles");
+    for(const auto& r : results)
+        ContainerBenchmark::PrintRow<DaisySeed::Log>(r);
+    hw.PrintLine("done");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
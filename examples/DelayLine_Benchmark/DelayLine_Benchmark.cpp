@@ -0,0 +1,96 @@
+// Compares block and per-sample access of a delay line in the SDRAM
+//
+// Runs a 4 tap BlockDelayLine of 2^18 samples (1MB) in the SDRAM, once a
+// block at a time with Write() and ReadTaps(), and once a sample at a time
+// with Write() and ReadLinear() for each tap, and prints the CPU cycles
+// per sample over the USB serial logger, for a few block sizes.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The delay line is much larger than the 16kB data cache, and the taps are
+// far apart, so a sample at a time each tap mostly misses the cache, while
+// a block walks through each tap's cache lines in order.
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+DaisySeed hw;
+
+using Delay = BlockDelayLine<float, 262144>;
+
+static Delay DSY_SDRAM_BSS delay;
+
+static constexpr size_t kNumTaps    = 4;
+static constexpr size_t kMaxBlock   = 256;
+static constexpr size_t kNumSamples = 48000;
+
+static const float delays[kNumTaps] = {4800.5f, 48000.f, 120000.25f, 240000.f};
+
+static float in[kMaxBlock];
+static float taps[kNumTaps][kMaxBlock];
+static float* const outs[kNumTaps] = {taps[0], taps[1], taps[2], taps[3]};
+
+// Keeps the compiler from dropping the reads
+static volatile float sink;
+
+static uint32_t RunBlocks(size_t block_size)
+{
+    const uint32_t start = System::GetCycleCount();
+    for(size_t n = 0; n < kNumSamples; n += block_size)
+    {
+        delay.Write(in, block_size);
+        delay.ReadTaps(outs, delays, kNumTaps, block_size);
+        sink = taps[kNumTaps - 1][block_size - 1];
+    }
+    return System::GetCycleCount() - start;
+}
+
+static uint32_t RunSamples(size_t block_size)
+{
+    const uint32_t start = System::GetCycleCount();
+    for(size_t n = 0; n < kNumSamples; n += block_size)
+    {
+        for(size_t i = 0; i < block_size; i++)
+        {
+            delay.Write(in[i]);
+            for(size_t tap = 0; tap < kNumTaps; tap++)
+                outs[tap][i] = delay.ReadLinear(delays[tap]);
+        }
+        sink = taps[kNumTaps - 1][block_size - 1];
+    }
+    return System::GetCycleCount() - start;
+}
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    hw.PrintLine("Delay Line Benchmark, %lu MHz, %u taps",
+                 (unsigned long)(System::GetCpuFreq() / 1000000),
+                 unsigned(kNumTaps));
+
+    delay.Init();
+    for(size_t i = 0; i < kMaxBlock; i++)
+        in[i] = float(i) / kMaxBlock;
+
+    hw.PrintLine("%6s %12s %12s", "block", "per sample", "block");
+    for(size_t block_size : {16u, 48u, 128u, 256u})
+    {
+        // fills the line first, so both runs see the same cache state
+        RunBlocks(block_size);
+        const uint32_t samples = RunSamples(block_size);
+        const uint32_t blocks  = RunBlocks(block_size);
+        hw.PrintLine("%6u %12lu %12lu",
+                     unsigned(block_size),
+                     (unsigned long)(samples / kNumSamples),
+                     (unsigned long)(blocks / kNumSamples));
+    }
+    hw.PrintLine("cycles per sample, done");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
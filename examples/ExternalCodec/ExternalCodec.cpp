@@ -61,6 +61,12 @@ int main(void)
     audio_cfg.samplerate = SaiHandle::Config::SampleRate::SAI_48KHZ;
     audio_cfg.postgain   = 0.5f;
 
+    /** The second codec may run from a clock of its own, which drifts
+     *  against the one of the Daisy. Its audio is resampled to the
+     *  Daisy's clock, so the two never slip against each other.
+     */
+    audio_cfg.resample_secondary = true;
+
     /** Initialize for two SAIs, including the built-in SAI that is 
      *  configured during hw.Init()
      */
@@ -0,0 +1,63 @@
+// Measures the throughput and latency of each memory region
+//
+// Runs MemoryBenchmark on a 32kB buffer in the DTCM, the AXI SRAM, the D2
+// and D3 SRAMs, and the SDRAM, with the data cache on and off, and prints
+// a table over the USB serial logger.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The buffers are twice the size of the data cache, so the cached numbers
+// show the memory behind the cache, not just the cache. The first 32kB of
+// the D2 SRAM, where DMA_BUFFER_MEM_SECTION buffers go, are never cached
+// (see System::ConfigureMpu()), and the DTCM has no cache in front of it.
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+DaisySeed hw;
+
+static constexpr size_t kBufferSize = 32768;
+
+static uint32_t DTCM_MEM_SECTION __attribute__((aligned(32)))
+dtcm_buffer[kBufferSize / 4];
+static uint32_t __attribute__((aligned(32))) axi_buffer[kBufferSize / 4];
+static uint32_t DMA_BUFFER_MEM_SECTION __attribute__((aligned(32)))
+d2_buffer[kBufferSize / 4];
+static uint32_t DSY_SDRAM_BSS __attribute__((aligned(32)))
+sdram_buffer[kBufferSize / 4];
+
+// Nothing is linked into the D3 SRAM, its start is used directly
+static void* const d3_buffer = reinterpret_cast<void*>(0x38000000);
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    hw.PrintLine("Memory Benchmark, %lu MHz",
+                 (unsigned long)(System::GetCpuFreq() / 1000000));
+
+    void* const buffers[]
+        = {dtcm_buffer, axi_buffer, d2_buffer, d3_buffer, sdram_buffer};
+
+    MemoryBenchmark::PrintHeader<DaisySeed::Log>();
+    for(bool dcache : {true, false})
+    {
+        for(void* buffer : buffers)
+        {
+            MemoryBenchmark::Config cfg;
+            cfg.buffer = buffer;
+            cfg.size   = kBufferSize;
+            cfg.dcache = dcache;
+            MemoryBenchmark::PrintRow<DaisySeed::Log>(
+                MemoryBenchmark::Run(cfg));
+        }
+    }
+    hw.PrintLine("done");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
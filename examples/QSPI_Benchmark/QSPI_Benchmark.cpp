@@ -0,0 +1,112 @@
+// Measures the QSPI flash read throughput in quad SDR and quad DTR mode
+//
+// Reads the first 64kB of the flash into the AXI SRAM, through the memory
+// mapped window with memcpy, through the memory mapped window with the
+// MDMA, and in indirect mode with QSPIHandle::Read() and with the
+// QSPIHandle::StartRead() DMA, for each read mode, and prints MB/s over
+// the USB serial logger. The copies are compared, which checks that DTR
+// reads return the same data.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The data cache is invalidated before each memcpy, so the flash is read,
+// not the cache. Read() includes switching to indirect mode and back,
+// which reinitializes the chip, so it's also timed for a single page.
+// StartRead() is timed in indirect mode, as it would be for streaming, and
+// the CPU time left to other work during it is counted in loop passes.
+// The program has to run from the internal flash, it reinitializes the
+// QSPI.
+#include <cstring>
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+DaisySeed  hw;
+MdmaHandle mdma;
+
+static constexpr size_t kSize     = 65536;
+static constexpr size_t kPageSize = 256;
+
+static uint8_t __attribute__((aligned(32))) by_memcpy[kSize];
+static uint8_t __attribute__((aligned(32))) by_mdma[kSize];
+static uint8_t __attribute__((aligned(32))) by_read[kSize];
+static uint8_t __attribute__((aligned(32))) by_dma[kSize];
+
+static void PrintRate(const char* name, size_t size, uint32_t us)
+{
+    const float mb_per_s = us > 0 ? float(size) / float(us) : 0.f;
+    hw.PrintLine(
+        "  %-18s %6luus  %.1f MB/s", name, (unsigned long)us, mb_per_s);
+}
+
+static void Run(QSPIHandle::Config::ReadMode read_mode, const char* name)
+{
+    QSPIHandle::Config cfg = hw.qspi_config;
+    cfg.read_mode          = read_mode;
+    if(hw.qspi.Init(cfg) != QSPIHandle::Result::OK)
+    {
+        hw.PrintLine("%s: init failed", name);
+        return;
+    }
+    hw.PrintLine("%s", name);
+
+    void* const mapped = hw.qspi.GetData(0);
+
+    SCB_InvalidateDCache_by_Addr((uint32_t*)mapped, kSize);
+    uint32_t start = System::GetUs();
+    std::memcpy(by_memcpy, mapped, kSize);
+    PrintRate("mapped, memcpy", kSize, System::GetUs() - start);
+
+    start = System::GetUs();
+    mdma.Copy(by_mdma, mapped, kSize);
+    mdma.Wait();
+    PrintRate("mapped, MDMA", kSize, System::GetUs() - start);
+
+    start = System::GetUs();
+    hw.qspi.Read(0, kPageSize, by_read);
+    PrintRate("indirect, 1 page", kPageSize, System::GetUs() - start);
+
+    start = System::GetUs();
+    const bool read_ok = hw.qspi.Read(0, kSize, by_read) == QSPIHandle::OK;
+    PrintRate("indirect, 64kB", kSize, System::GetUs() - start);
+
+    cfg.mode = QSPIHandle::Config::Mode::INDIRECT_POLLING;
+    hw.qspi.Init(cfg);
+    uint32_t passes = 0;
+    start           = System::GetUs();
+    const bool dma_ok
+        = hw.qspi.StartRead(0, kSize, by_dma) == QSPIHandle::OK;
+    while(dma_ok && hw.qspi.Process())
+        passes++;
+    PrintRate("indirect, DMA", kSize, System::GetUs() - start);
+    hw.PrintLine("  %lu loop passes during the DMA", (unsigned long)passes);
+
+    const bool same = read_ok && dma_ok
+                      && std::memcmp(by_memcpy, by_mdma, kSize) == 0
+                      && std::memcmp(by_memcpy, by_read, kSize) == 0
+                      && std::memcmp(by_memcpy, by_dma, kSize) == 0;
+    hw.PrintLine("  data %s", same ? "matches" : "DIFFERS");
+}
+
+int main(void)
+{
+    hw.Init();
+    mdma.Init();
+    hw.StartLog(true);
+    hw.PrintLine("QSPI Benchmark, %lu MHz",
+                 (unsigned long)(System::GetCpuFreq() / 1000000));
+
+    Run(QSPIHandle::Config::ReadMode::QUAD_SDR, "quad SDR, 120MHz");
+    Run(QSPIHandle::Config::ReadMode::QUAD_DTR, "quad DTR, 80MHz");
+
+    // back to the default for the rest of the program
+    hw.qspi.Init(hw.qspi_config);
+    hw.PrintLine("done");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
@@ -0,0 +1,262 @@
+// Times a fixed set of kernels, for comparing libDaisy releases
+//
+// Runs the audio sample conversion, a QSPI flash read, an SD card read, an
+// SSD130x display update, and blocking SPI and I2C transfers a number of
+// times each, counts the CPU cycles of every run with the DWT cycle
+// counter, and prints one CSV line per kernel over the USB serial logger:
+//
+//   kernel,bytes,runs,min_cycles,mean_cycles,max_cycles,status
+//
+// Lines starting with # are the label, CPU clock and end marker. Build the
+// same program against two releases, with e.g. make BENCH_LABEL=v7.0.0,
+// and compare the two logs line by line.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The CPU only kernels run with interrupts disabled. The transfers don't,
+// as the blocking calls time out with the SysTick, and include the waits
+// for the bus. status is "ok", or what went wrong:
+//   - no_card, when there's no SD card with a FAT filesystem
+//   - fail, when some of the runs returned an error, e.g. the I2C transfer
+//     when nothing answers at the display address 0x3C on D11/D12
+// The display and SPI transfers run on SPI1 (D8, D10), whether or not a
+// display is connected. The SD test writes a 64kB file and deletes it.
+#include <cstring>
+#include "daisy_seed.h"
+#include "dev/oled_ssd130x.h"
+#include "fatfs.h"
+
+#ifndef BENCH_LABEL
+#define BENCH_LABEL "unlabeled"
+#endif
+
+using namespace daisy;
+
+using Display = OledDisplay<SSD130x4WireSpi128x64Driver>;
+
+DaisySeed      hw;
+Display        display;
+SpiHandle      spi;
+I2CHandle      i2c;
+SdmmcHandler   sdmmc;
+FatFSInterface fsi;
+FIL            file;
+
+static constexpr size_t kFrames   = 48;
+static constexpr size_t kReadSize = 4096;
+static constexpr size_t kFileSize = 65536;
+
+static int32_t            raw[kFrames * 2];
+static float              left[kFrames], right[kFrames];
+static float* const       chans[2]       = {left, right};
+static const float* const const_chans[2] = {left, right};
+static uint8_t __attribute__((aligned(32))) read_buffer[kReadSize];
+static uint8_t DMA_BUFFER_MEM_SECTION       tx_buffer[256];
+
+/** Cycle counts of the runs of one kernel */
+struct Stats
+{
+    uint32_t runs     = 0;
+    uint32_t failures = 0;
+    uint32_t min      = 0xFFFFFFFF;
+    uint32_t max      = 0;
+    uint64_t sum      = 0;
+
+    void Add(uint32_t cycles, bool ok)
+    {
+        runs++;
+        failures += ok ? 0 : 1;
+        min = cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        sum += cycles;
+    }
+};
+
+/** Runs a kernel, which returns false when it failed, and times each run */
+template <typename Kernel>
+static Stats Time(uint32_t runs, bool block_irqs, Kernel kernel)
+{
+    Stats stats;
+    for(uint32_t i = 0; i < runs; i++)
+    {
+        bool     ok;
+        uint32_t cycles;
+        if(block_irqs)
+        {
+            ScopedIrqBlocker irq_blocker;
+            const uint32_t   start = System::GetCycleCount();
+            ok                     = kernel();
+            cycles                 = System::GetCycleCount() - start;
+        }
+        else
+        {
+            const uint32_t start = System::GetCycleCount();
+            ok                   = kernel();
+            cycles               = System::GetCycleCount() - start;
+        }
+        stats.Add(cycles, ok);
+    }
+    return stats;
+}
+
+static void
+PrintRow(const char* kernel, size_t bytes, const Stats& s, const char* status)
+{
+    if(s.runs == 0)
+    {
+        hw.PrintLine("%s,%lu,0,0,0,0,%s", kernel, (unsigned long)bytes, status);
+        return;
+    }
+    if(s.failures > 0)
+        status = "fail";
+    hw.PrintLine("%s,%lu,%lu,%lu,%lu,%lu,%s",
+                 kernel,
+                 (unsigned long)bytes,
+                 (unsigned long)s.runs,
+                 (unsigned long)s.min,
+                 (unsigned long)(s.sum / s.runs),
+                 (unsigned long)s.max,
+                 status);
+}
+
+static void RunAudio()
+{
+    for(size_t i = 0; i < kFrames * 2; i++)
+        raw[i] = int32_t(i * 104729) & 0xFFFFFF;
+    Stats s = Time(1000, true, [] {
+        audio_convert::DeinterleaveStereo<24>(raw, chans, kFrames, 1.f);
+        return true;
+    });
+    PrintRow("audio_to_float_24bit", sizeof(raw), s, "ok");
+    s = Time(1000, true, [] {
+        audio_convert::InterleaveStereo<24>(const_chans, raw, kFrames, 1.f);
+        return true;
+    });
+    PrintRow("audio_from_float_24bit", sizeof(raw), s, "ok");
+}
+
+static void RunQspi()
+{
+    // the cache is invalidated in each run, so it's the flash that's read
+    const Stats s = Time(100, true, [] {
+        uint8_t* const mapped = static_cast<uint8_t*>(hw.qspi.GetData(0));
+        SCB_InvalidateDCache_by_Addr((uint32_t*)mapped, kReadSize);
+        std::memcpy(read_buffer, mapped, kReadSize);
+        return true;
+    });
+    PrintRow("qspi_read_mapped", kReadSize, s, "ok");
+}
+
+static void RunSd()
+{
+    SdmmcHandler::Config sd_cfg;
+    sdmmc.Init(sd_cfg);
+    fsi.Init(FatFSInterface::Config::MEDIA_SD);
+    FATFS&      fs   = fsi.GetSDFileSystem();
+    const char* path = "bench.dat";
+    UINT        bw   = 0;
+
+    bool ready = f_mount(&fs, "/", 1) == FR_OK
+                 && f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK;
+    for(size_t i = 0; ready && i < kFileSize; i += kReadSize)
+    {
+        std::memset(read_buffer, int(i / kReadSize), kReadSize);
+        ready = f_write(&file, read_buffer, kReadSize, &bw) == FR_OK
+                && bw == kReadSize;
+    }
+    if(ready)
+        ready = f_close(&file) == FR_OK
+                && f_open(&file, path, FA_READ) == FR_OK;
+    if(!ready)
+    {
+        PrintRow("sd_read", kReadSize, Stats(), "no_card");
+        fsi.DeInit();
+        return;
+    }
+
+    static size_t offset = 0;
+    const Stats   s      = Time(64, false, [] {
+        UINT br = 0;
+        offset  = (offset + kReadSize) % kFileSize;
+        return f_lseek(&file, offset) == FR_OK
+               && f_read(&file, read_buffer, kReadSize, &br) == FR_OK
+               && br == kReadSize;
+    });
+    PrintRow("sd_read", kReadSize, s, "ok");
+    f_close(&file);
+    f_unlink(path);
+    f_mount(nullptr, "/", 0);
+    fsi.DeInit();
+}
+
+static void RunDisplay()
+{
+    Display::Config display_cfg;
+    display.Init(display_cfg);
+    display.Fill(true);
+    const Stats s = Time(100, false, [] {
+        display.Update();
+        return true;
+    });
+    PrintRow("display_update_128x64", 128 * 64 / 8, s, "ok");
+}
+
+static void RunSpi()
+{
+    SpiHandle::Config spi_cfg;
+    spi_cfg.periph          = SpiHandle::Config::Peripheral::SPI_1;
+    spi_cfg.mode            = SpiHandle::Config::Mode::MASTER;
+    spi_cfg.direction       = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+    spi_cfg.nss             = SpiHandle::Config::NSS::HARD_OUTPUT;
+    spi_cfg.baud_prescaler  = SpiHandle::Config::BaudPrescaler::PS_8;
+    spi_cfg.pin_config.sclk = seed::D8;
+    spi_cfg.pin_config.miso = {DSY_GPIOX, 0};
+    spi_cfg.pin_config.mosi = seed::D10;
+    spi_cfg.pin_config.nss  = seed::D7;
+    spi.Init(spi_cfg);
+    const Stats s = Time(100, false, [] {
+        return spi.BlockingTransmit(tx_buffer, sizeof(tx_buffer))
+               == SpiHandle::Result::OK;
+    });
+    PrintRow("spi_tx_blocking", sizeof(tx_buffer), s, "ok");
+}
+
+static void RunI2c()
+{
+    I2CHandle::Config i2c_cfg;
+    i2c_cfg.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_cfg.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_cfg.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_cfg.pin_config.scl = seed::D11;
+    i2c_cfg.pin_config.sda = seed::D12;
+    i2c.Init(i2c_cfg);
+    const Stats s = Time(100, false, [] {
+        return i2c.TransmitBlocking(0x3C, tx_buffer, 32, 10)
+               == I2CHandle::Result::OK;
+    });
+    PrintRow("i2c_tx_blocking_400k", 32, s, "ok");
+}
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    hw.PrintLine("# label,%s", BENCH_LABEL);
+    hw.PrintLine("# cpu_hz,%lu", (unsigned long)System::GetCpuFreq());
+    hw.PrintLine("kernel,bytes,runs,min_cycles,mean_cycles,max_cycles,status");
+
+    RunAudio();
+    RunQspi();
+    RunSd();
+    RunDisplay();
+    RunSpi();
+    RunI2c();
+    hw.PrintLine("# end");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
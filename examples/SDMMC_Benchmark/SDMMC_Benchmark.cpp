@@ -0,0 +1,86 @@
+// Measures the SD card throughput and latency with each bus setting
+//
+// Runs SdBenchmark for 1 and 4 bit wide buses at 25, 50 and 100MHz, and with
+// Speed::AUTO, and prints MB/s, and the worst case latency, over the USB
+// serial logger.
+// The program waits for a serial monitor to be connected before starting.
+//
+// The card needs a FAT filesystem, and about 4MB of free space.
+// The test file is deleted afterwards.
+// Not every card (or wiring) copes with the fastest settings, a failing
+// setting is reported with its FRESULT, and the next one is tried.
+#include "daisy_seed.h"
+#include "fatfs.h"
+
+using namespace daisy;
+
+DaisySeed      hw;
+SdmmcHandler   sdmmc;
+FatFSInterface fsi;
+
+// The SD DMA can reach AXI SRAM and SDRAM directly, 32 byte aligned avoids
+// the scratch buffer copies in the disk driver.
+static uint8_t DSY_SDRAM_BSS __attribute__((aligned(32))) buffer[32768];
+
+using Width = SdmmcHandler::BusWidth;
+using Speed = SdmmcHandler::Speed;
+
+struct BusSetting
+{
+    Width       width;
+    Speed       speed;
+    const char* name;
+};
+
+static const BusSetting settings[] = {
+    {Width::BITS_1, Speed::STANDARD, "1 bit, 25MHz"},
+    {Width::BITS_1, Speed::FAST, "1 bit, 50MHz"},
+    {Width::BITS_1, Speed::VERY_FAST, "1 bit, 100MHz"},
+    {Width::BITS_4, Speed::STANDARD, "4 bit, 25MHz"},
+    {Width::BITS_4, Speed::FAST, "4 bit, 50MHz"},
+    {Width::BITS_4, Speed::VERY_FAST, "4 bit, 100MHz"},
+    {Width::BITS_4, Speed::AUTO, "4 bit, auto"},
+};
+
+int main(void)
+{
+    hw.Init();
+    hw.StartLog(true);
+    hw.PrintLine("SDMMC Benchmark");
+
+    SdBenchmark::Config bench_cfg;
+    bench_cfg.buffer      = buffer;
+    bench_cfg.buffer_size = sizeof(buffer);
+
+    for(const BusSetting& s : settings)
+    {
+        // reconfigure the peripheral, and have FatFs initialize the card again
+        SdmmcHandler::Config sd_cfg;
+        sd_cfg.width = s.width;
+        sd_cfg.speed = s.speed;
+        sdmmc.DeInit();
+        sdmmc.Init(sd_cfg);
+        fsi.Init(FatFSInterface::Config::MEDIA_SD);
+
+        FATFS&               fs  = fsi.GetSDFileSystem();
+        SdBenchmark::Results res = {};
+        res.result               = f_mount(&fs, "/", 1);
+        if(res.result == FR_OK)
+            res = SdBenchmark::Run(bench_cfg);
+        SdBenchmark::Print<DaisySeed::Log>(s.name, res);
+        if(s.speed == Speed::AUTO)
+            hw.PrintLine("  auto picked speed %d", int(sdmmc.GetSpeed()));
+
+        f_mount(nullptr, "/", 0);
+        fsi.DeInit();
+    }
+    hw.PrintLine("done");
+
+    while(1)
+    {
+        hw.SetLed(true);
+        System::Delay(500);
+        hw.SetLed(false);
+        System::Delay(500);
+    }
+}
@@ -0,0 +1,62 @@
+// Transmits while the circular reception of DmaRingStart() runs.
+//
+// Connect D13 (USART1 TX) to D14 (USART1 RX), or to a USB serial adapter.
+// Every 100 ms a counter is queued with QueueTx(), and every received byte
+// is echoed back. The LED blinks while the transmissions complete, and
+// stays on once one gets stuck behind the reception, or the queue
+// overflows.
+#include "daisy_seed.h"
+
+using namespace daisy;
+
+DaisySeed   hw;
+UartHandler uart;
+
+uint8_t DMA_BUFFER_MEM_SECTION rx_ring[64];
+uint8_t DMA_BUFFER_MEM_SECTION tx_queue[64];
+
+int main(void)
+{
+    hw.Init();
+
+    UartHandler::Config uart_conf;
+    uart_conf.periph        = UartHandler::Config::Peripheral::USART_1;
+    uart_conf.mode          = UartHandler::Config::Mode::TX_RX;
+    uart_conf.pin_config.tx = Pin(PORTB, 6);
+    uart_conf.pin_config.rx = Pin(PORTB, 7);
+    uart.Init(uart_conf);
+
+    // start receiving first, the transmissions run next to it
+    uart.SetTxQueue(tx_queue, sizeof(tx_queue));
+    uart.DmaRingStart(rx_ring, sizeof(rx_ring));
+
+    uint8_t  count   = 0;
+    bool     led     = false;
+    bool     stuck   = false;
+    uint32_t last_ms = System::GetNow();
+    while(1)
+    {
+        // echo the received bytes
+        UartHandler::RxSpan span;
+        if(uart.GetRxSpan(span) > 0)
+        {
+            for(int i = 0; i < 2; i++)
+                if(span.size[i] > 0)
+                    uart.QueueTx(span.data[i], span.size[i]);
+            uart.ReleaseRx(span.Total());
+        }
+
+        const uint32_t now = System::GetNow();
+        if(now - last_ms >= 100)
+        {
+            last_ms = now;
+            // the previous counter should be sent long ago
+            stuck = stuck || uart.GetTxQueued() > sizeof(tx_queue) / 2;
+            if(uart.QueueTx(&count, 1) != UartHandler::Result::OK)
+                stuck = true;
+            count++;
+            led = stuck || !led;
+            hw.SetLed(led);
+        }
+    }
+}
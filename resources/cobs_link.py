@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Host side of CobsLink, binary frames over a serial stream
+
+Each frame is the payload and its CRC-32 (zlib.crc32, little endian),
+COBS encoded and ended by a 0 byte (see src/util/CobsLink.h). Import it
+to send commands from a script:
+
+    link = CobsLink(open("/dev/ttyACM0", "r+b", buffering=0))
+    link.send(struct.pack("<Bf", 1, 0.5))
+    for payload in link.receive():
+        ...
+
+or run it to print the frames of a stream as hex, one per line.
+
+usage: python3 resources/cobs_link.py [input]
+
+input is a capture of the stream, or the serial device of the Daisy, e.g.
+/dev/ttyACM0, and defaults to stdin.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+
+def encode(payload):
+    """Returns the frame of a payload, with its CRC and the 0 at the end"""
+    data = bytes(payload) + struct.pack("<I", zlib.crc32(payload))
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out.append(len(block) + 1)
+            out += block
+            block.clear()
+            continue
+        block.append(byte)
+        if len(block) == 254:
+            out.append(255)
+            out += block
+            block.clear()
+    out.append(len(block) + 1)
+    out += block
+    out.append(0)
+    return bytes(out)
+
+
+def decode(frame):
+    """Returns the payload of a frame without its 0, None if it's invalid"""
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code != 255 and i < len(frame):
+            out.append(0)
+    if len(out) < 4:
+        return None
+    payload, crc = bytes(out[:-4]), struct.unpack("<I", out[-4:])[0]
+    return payload if zlib.crc32(payload) == crc else None
+
+
+class CobsLink:
+    """Sends and receives frames on a binary file or serial device"""
+
+    def __init__(self, stream):
+        self.stream = stream
+        self.pending = bytearray()
+        self.errors = 0
+
+    def send(self, payload):
+        self.stream.write(encode(payload))
+
+    def feed(self, data):
+        """Returns the payloads completed by data"""
+        self.pending += data
+        payloads = []
+        while True:
+            end = self.pending.find(0)
+            if end < 0:
+                break
+            frame = bytes(self.pending[:end])
+            del self.pending[:end + 1]
+            if not frame:
+                continue
+            payload = decode(frame)
+            if payload is None:
+                self.errors += 1
+            else:
+                payloads.append(payload)
+        return payloads
+
+    def receive(self, size=4096):
+        """Reads once from the stream, returns the payloads completed"""
+        data = self.stream.read(size)
+        return self.feed(data) if data else []
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Prints the frames of a CobsLink stream as hex")
+    parser.add_argument("input", nargs="?",
+                        help="capture file or serial device, default stdin")
+    args = parser.parse_args()
+
+    stream = (open(args.input, "rb", buffering=0) if args.input
+              else sys.stdin.buffer)
+    link = CobsLink(stream)
+    try:
+        while True:
+            data = stream.read(4096)
+            if not data:
+                break
+            for payload in link.feed(data):
+                sys.stdout.write(payload.hex() + "\n")
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.input:
+            stream.close()
+        if link.errors:
+            sys.stderr.write("%d invalid frames\n" % link.errors)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Decodes the binary trace records of Logger::Trace()
+
+The records hold the address of their format string and the raw argument
+words (see src/util/TraceRecord.h). The format strings are read from the
+.elf file of the program that sent them, and the messages are printed with
+their time, text received on the same stream is passed through.
+
+usage: python3 resources/decode_trace.py program.elf [input] [--tick-freq HZ]
+                                          [--itm PORT]
+
+input is a capture of the stream, or the serial device of the Daisy, e.g.
+/dev/ttyACM0, and defaults to stdin. The time is GetTick() divided by the
+tick frequency, 200 MHz by default.
+
+With --itm the input is the raw output of the SWO pin (LOGGER_SWO), e.g.
+from a USB serial adapter at LOGGER_SWO_BAUD, and only the data of the
+ITM stimulus port is decoded.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0xD5
+HEADER_WORDS = 3
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+SPEC_RE = re.compile(
+    r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|L|z|j|t)?([diouxXcsfFeEgGp%])")
+
+
+class Elf:
+    """The loaded sections of an ELF32 little endian file"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s isn't a 32 bit little endian ELF file" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset,
+             size) = struct.unpack_from("<6I", data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size > 0:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, address):
+        """Returns the C string at address, None when it's not in a section"""
+        for start, contents in self.sections:
+            if start <= address < start + len(contents):
+                offset = address - start
+                end = contents.find(b"\0", offset)
+                if end < 0:
+                    return None
+                return contents[offset:end].decode("utf-8", "replace")
+        return None
+
+
+def format_message(elf, fmt, words):
+    """printf for the argument words, the conversions each take one"""
+    args = iter(words)
+    out = []
+    pos = 0
+    for m in SPEC_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        word = next(args, 0)
+        spec = "%" + flags + width
+        if precision is not None:
+            spec += "." + precision
+        if conv in "di":
+            value = word - (1 << 32) if word & 0x80000000 else word
+            out.append((spec + "d") % value)
+        elif conv in "ouxX":
+            out.append((spec + (conv if conv != "u" else "d")) % word)
+        elif conv == "c":
+            out.append((spec + "c") % chr(word & 0xFF))
+        elif conv in "fFeEgG":
+            value, = struct.unpack("<f", struct.pack("<I", word))
+            out.append((spec + conv) % value)
+        elif conv == "s":
+            text = elf.string(word)
+            out.append((spec + "s") %
+                       (text if text is not None else "<0x%08x>" % word))
+        else:  # p
+            out.append("0x%08x" % word)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+class ItmFilter:
+    """Passes the data of one ITM stimulus port on, out of the packets"""
+
+    def __init__(self, port, decoder):
+        self.port = port
+        self.decoder = decoder
+        self.payload = 0  # bytes left of a source packet
+        self.keep = False  # whether they're from the port
+        self.continued = False  # in a timestamp or extension packet
+
+    def feed(self, data):
+        out = bytearray()
+        for byte in data:
+            if self.payload:
+                self.payload -= 1
+                if self.keep:
+                    out.append(byte)
+            elif self.continued:
+                self.continued = bool(byte & 0x80)
+            elif byte & 0x03:
+                # source packet: size in the low bits, port in the high ones
+                self.payload = (1, 2, 4)[(byte & 0x03) - 1]
+                self.keep = not byte & 0x04 and byte >> 3 == self.port
+            elif byte not in (0x00, 0x70, 0x80):
+                # timestamp or extension, more bytes follow while bit 7 is set
+                self.continued = bool(byte & 0x80)
+        self.decoder.feed(bytes(out))
+
+
+class Decoder:
+    """Splits the stream in records and text"""
+
+    def __init__(self, elf, tick_freq, out):
+        self.elf = elf
+        self.tick_freq = tick_freq
+        self.out = out
+        self.pending = bytearray()
+        self.text = bytearray()
+        self.sequence = None
+
+    def feed(self, data):
+        self.pending += data
+        buf = self.pending
+        i = 0
+        while i < len(buf):
+            if buf[i] != MAGIC:
+                self.add_text(buf[i])
+                i += 1
+                continue
+            if len(buf) - i < 4 * HEADER_WORDS:
+                break
+            header, tick, address = struct.unpack_from("<3I", buf, i)
+            count = (header >> 8) & 0xFF
+            size = 4 * (HEADER_WORDS + count)
+            fmt = self.elf.string(address)
+            if fmt is None:
+                # not a record after all
+                self.add_text(buf[i])
+                i += 1
+                continue
+            if len(buf) - i < size:
+                break
+            words = struct.unpack_from("<%dI" % count, buf,
+                                       i + 4 * HEADER_WORDS)
+            self.record(header >> 16, tick, format_message(self.elf, fmt,
+                                                           words))
+            i += size
+        del buf[:i]
+
+    def add_text(self, byte):
+        if byte == ord("\n"):
+            self.out.write(self.text.decode("utf-8", "replace").rstrip("\r")
+                           + "\n")
+            self.text.clear()
+        else:
+            self.text.append(byte)
+
+    def record(self, sequence, tick, message):
+        if self.sequence is not None:
+            lost = (sequence - self.sequence - 1) & 0xFFFF
+            if lost:
+                self.out.write("--- %d records lost ---\n" % lost)
+        self.sequence = sequence
+        self.out.write("[%12.6f] %s\n" % (tick / self.tick_freq,
+                                          message.rstrip("\r\n")))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decodes the binary trace records of Logger::Trace()")
+    parser.add_argument("elf", help="the .elf file of the program")
+    parser.add_argument("input", nargs="?",
+                        help="capture file or serial device, default stdin")
+    parser.add_argument("--tick-freq", type=float, default=200e6,
+                        help="rate of System::GetTick() in Hz")
+    parser.add_argument("--itm", type=int, metavar="PORT",
+                        help="decode ITM packets, e.g. of LOGGER_SWO at "
+                        "port 0, from a raw SWO capture")
+    args = parser.parse_args()
+
+    decoder = Decoder(Elf(args.elf), args.tick_freq, sys.stdout)
+    if args.itm is not None:
+        decoder = ItmFilter(args.itm, decoder)
+    stream = (open(args.input, "rb", buffering=0) if args.input
+              else sys.stdin.buffer)
+    try:
+        while True:
+            data = stream.read(4096)
+            if not data:
+                break
+            decoder.feed(data)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.input:
+            stream.close()
+
+
+if __name__ == "__main__":
+    main()
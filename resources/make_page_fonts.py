@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Generates src/util/oled_page_fonts.c from src/util/oled_fonts.c
+
+The fonts in oled_fonts.c are stored row by row, one uint16_t per line of a
+glyph, with the leftmost pixel in the MSB. The page fonts are stored the way
+the SSD130x and similar displays keep their memory: column bytes in bands of
+8 lines, the top line of a band in the LSB. Each glyph is
+width * ((height + 7) / 8) bytes, band after band.
+
+usage: python3 resources/make_page_fonts.py [oled_fonts.c] [oled_page_fonts.c]
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_IN = os.path.join(ROOT, "src", "util", "oled_fonts.c")
+DEFAULT_OUT = os.path.join(ROOT, "src", "util", "oled_page_fonts.c")
+
+FIRST_CHAR = 32
+LAST_CHAR = 126
+
+ARRAY_RE = re.compile(
+    r"static\s+const\s+uint16_t\s+(\w+)\[\]\s*=\s*\{(.*?)\};", re.S)
+FONTDEF_RE = re.compile(
+    r"FontDef\s+(\w+)\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)\s*\}\s*;")
+
+
+def parse(text):
+    """Returns the arrays, by name, and the FontDefs in the file"""
+    arrays = {}
+    for name, body in ARRAY_RE.findall(text):
+        body = re.sub(r"//[^\n]*", "", body)
+        arrays[name] = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", body)]
+    fonts = []
+    for name, width, height, data in FONTDEF_RE.findall(text):
+        fonts.append((name, int(width), int(height), data))
+    return arrays, fonts
+
+
+def to_pages(rows, width, height):
+    """Turns the rows of one glyph into its column bytes"""
+    bands = (height + 7) // 8
+    out = [0] * (bands * width)
+    for j in range(height):
+        for i in range(width):
+            if (rows[j] << i) & 0x8000:
+                out[(j // 8) * width + i] |= 1 << (j % 8)
+    return out
+
+
+# values per line of the output
+PER_LINE = 8
+
+
+def glyph_comment(ch):
+    if ch == " ":
+        return "// sp"
+    # a backslash at the end of a line comment would continue it
+    return "/* \\ */" if ch == "\\" else "// " + ch
+
+
+def generate(arrays, fonts):
+    lines = [
+        "/* Generated by resources/make_page_fonts.py from oled_fonts.c,",
+        " * do not edit. */",
+        '#include "util/oled_fonts.h"',
+        "",
+    ]
+    defs = []
+    for name, width, height, data in fonts:
+        rows = arrays[data]
+        count = LAST_CHAR - FIRST_CHAR + 1
+        if len(rows) < count * height:
+            raise ValueError("%s is too short" % data)
+        array = data + "Pages"
+        lines.append("static const uint8_t %s[] = {" % array)
+        for c in range(count):
+            glyph = to_pages(rows[c * height:(c + 1) * height], width, height)
+            values = ["0x%02X" % v for v in glyph]
+            comment = glyph_comment(chr(FIRST_CHAR + c))
+            # at most PER_LINE values of a band per line, the comment after
+            # the last one
+            chunks = []
+            for band in range(0, len(values), width):
+                for i in range(band, band + width, PER_LINE):
+                    chunks.append(values[i:min(i + PER_LINE, band + width)])
+            for n, chunk in enumerate(chunks):
+                text = "    " + ", ".join(chunk) + ","
+                if n == len(chunks) - 1:
+                    text += " " + comment
+                lines.append(text)
+        lines.append("};")
+        lines.append("")
+        defs.append((name + "_Pages", width, height, array))
+
+    wide = max(len(d[0]) for d in defs)
+    for name, width, height, array in defs:
+        lines.append("PageFontDef %s = {%d, %d, %s};" %
+                     (name.ljust(wide), width, height, array))
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_IN
+    dst = sys.argv[2] if len(sys.argv) > 2 else DEFAULT_OUT
+    with open(src) as f:
+        arrays, fonts = parse(f.read())
+    if not fonts:
+        sys.exit("no FontDef found in " + src)
+    with open(dst, "w") as f:
+        f.write(generate(arrays, fonts))
+    print("wrote %d fonts to %s" % (len(fonts), dst))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Packs WAV files into a sample bank image for the QSPI flash
+
+The image is read on the Daisy with SampleBank (see src/util/SampleBank.h):
+a 32 byte header, an index of 48 bytes per sample, and the data of each
+sample on a 32 byte boundary. 8, 16, 24 and 32 bit PCM WAV files are
+converted to 16 bit PCM, or with --float to 32 bit floats. Each sample is
+named after its file, without the extension.
+
+usage: python3 resources/make_sample_bank.py [-o bank.bin] [--float]
+       [--loop name:start:end] file.wav [file.wav ...]
+
+The image can then be written to the flash, e.g. by an example program that
+includes it, or with the bootloader.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import wave
+import zlib
+
+MAGIC = 0x42595344  # "DSYB"
+VERSION = 1
+ALIGNMENT = 32
+MAX_NAME_LENGTH = 23
+HEADER_SIZE = 32
+ENTRY_SIZE = 48
+PCM_16 = 0
+FLOAT_32 = 1
+
+
+def read_wav(path):
+    """Returns the channels, rate and frames of a WAV file, as floats"""
+    with wave.open(path, "rb") as wav:
+        channels = wav.getnchannels()
+        rate = wav.getframerate()
+        width = wav.getsampwidth()
+        raw = wav.readframes(wav.getnframes())
+    if width == 1:
+        values = [(b - 128) / 128.0 for b in raw]
+    elif width == 2:
+        values = [v / 32768.0 for v, in struct.iter_unpack("<h", raw)]
+    elif width == 3:
+        values = [int.from_bytes(raw[i:i + 3], "little", signed=True)
+                  / 8388608.0 for i in range(0, len(raw), 3)]
+    elif width == 4:
+        values = [v / 2147483648.0 for v, in struct.iter_unpack("<i", raw)]
+    else:
+        raise ValueError("%s: %d byte samples aren't supported"
+                         % (path, width))
+    return channels, rate, values
+
+
+def encode(values, fmt):
+    if fmt == FLOAT_32:
+        return struct.pack("<%df" % len(values), *values)
+    pcm = [max(-32768, min(32767, int(round(v * 32768.0)))) for v in values]
+    return struct.pack("<%dh" % len(pcm), *pcm)
+
+
+def pack(samples, fmt):
+    """samples: list of (name, channels, rate, values, loop_start,
+    loop_end), returns the image"""
+    index_end = HEADER_SIZE + ENTRY_SIZE * len(samples)
+    offset = (index_end + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+    index = bytearray()
+    data = bytearray(offset - index_end)
+    for name, channels, rate, values, loop_start, loop_end in samples:
+        encoded = encode(values, fmt)
+        index += struct.pack("<24sIIIIIBBH", name.encode()[:MAX_NAME_LENGTH],
+                             offset, len(encoded), rate, loop_start,
+                             loop_end, channels, fmt, 0)
+        data += encoded
+        data += bytes(-len(data) % ALIGNMENT)
+        offset = index_end + len(data)
+    header = struct.pack("<IHHIII12x", MAGIC, VERSION, len(samples),
+                         index_end + len(data), zlib.crc32(index),
+                         zlib.crc32(data))
+    return header + index + data
+
+
+def parse_loops(args_loops):
+    loops = {}
+    for loop in args_loops:
+        name, start, end = loop.rsplit(":", 2)
+        loops[name] = (int(start), int(end))
+    return loops
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Packs WAV files into a sample bank image")
+    parser.add_argument("files", nargs="+", help="WAV files to pack")
+    parser.add_argument("-o", "--output", default="bank.bin",
+                        help="image to write, default bank.bin")
+    parser.add_argument("--float", action="store_true",
+                        help="store 32 bit floats instead of 16 bit PCM")
+    parser.add_argument("--loop", action="append", default=[],
+                        metavar="NAME:START:END",
+                        help="loop of a sample, in frames, END excluded")
+    args = parser.parse_args()
+
+    loops = parse_loops(args.loop)
+    samples = []
+    for path in args.files:
+        name = os.path.splitext(os.path.basename(path))[0]
+        if len(name.encode()) > MAX_NAME_LENGTH:
+            sys.stderr.write("%s: name cut to %d characters\n"
+                             % (name, MAX_NAME_LENGTH))
+        channels, rate, values = read_wav(path)
+        frames = len(values) // channels
+        loop_start, loop_end = loops.pop(name, (0, 0))
+        if not 0 <= loop_start <= loop_end <= frames:
+            sys.exit("%s: loop %d:%d outside of the %d frames"
+                     % (name, loop_start, loop_end, frames))
+        samples.append((name, channels, rate, values, loop_start, loop_end))
+    if loops:
+        sys.exit("no sample named %s" % ", ".join(loops))
+    if len(samples) > 0xFFFF:
+        sys.exit("too many samples")
+
+    image = pack(samples, FLOAT_32 if args.float else PCM_16)
+    with open(args.output, "wb") as out:
+        out.write(image)
+    print("%s: %d samples, %d bytes" % (args.output, len(samples),
+                                        len(image)))
+
+
+if __name__ == "__main__":
+    main()
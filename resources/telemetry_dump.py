@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Prints the frames of a Telemetry stream as CSV
+
+Each value frame becomes a line with its time in seconds and the values of
+the channels, and a new header line is printed whenever the descriptor
+frame changes. Frames with a bad CRC are skipped, lost frames reported on
+stderr, and text on the same stream is ignored (see src/util/Telemetry.h).
+
+usage: python3 resources/telemetry_dump.py [input]
+
+input is a capture of the stream, or the serial device of the Daisy, e.g.
+/dev/ttyACM0, and defaults to stdin.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0xD6
+TYPES = {0: "<f", 1: "<I", 2: "<i"}
+
+
+class Decoder:
+    """Splits the stream in frames"""
+
+    def __init__(self, out):
+        self.out = out
+        self.pending = bytearray()
+        self.channels = None
+        self.sequence = None
+
+    def feed(self, data):
+        self.pending += data
+        buf = self.pending
+        i = 0
+        while len(buf) - i >= 8:
+            if buf[i] != MAGIC or buf[i + 1] not in b"DV":
+                i += 1
+                continue
+            payload, = struct.unpack_from("<H", buf, i + 2)
+            if len(buf) - i < payload + 8:
+                break
+            crc, = struct.unpack_from("<I", buf, i + 4 + payload)
+            if zlib.crc32(bytes(buf[i + 1:i + 4 + payload])) != crc:
+                i += 1
+                continue
+            body = bytes(buf[i + 4:i + 4 + payload])
+            if buf[i + 1] == ord("D"):
+                self.descriptor(body)
+            else:
+                self.values(body)
+            i += payload + 8
+        del buf[:i]
+
+    def descriptor(self, body):
+        channels = []
+        pos = 1
+        for _ in range(body[0]):
+            end = body.index(b"\0", pos + 1)
+            channels.append((body[pos], body[pos + 1:end].decode()))
+            pos = end + 1
+        if channels != self.channels:
+            self.channels = channels
+            self.out.write(",".join(["time"] + [n for _, n in channels])
+                           + "\n")
+
+    def values(self, body):
+        if self.channels is None:
+            return
+        sequence, time_us = struct.unpack_from("<HI", body)
+        if self.sequence is not None:
+            lost = (sequence - self.sequence - 1) & 0xFFFF
+            if lost:
+                sys.stderr.write("%d frames lost\n" % lost)
+        self.sequence = sequence
+        fields = ["%.6f" % (time_us / 1e6)]
+        for n, (kind, _) in enumerate(self.channels):
+            if 6 + 4 * n + 4 > len(body):
+                break
+            value, = struct.unpack_from(TYPES.get(kind, "<I"), body,
+                                        6 + 4 * n)
+            fields.append("%g" % value if kind == 0 else str(value))
+        self.out.write(",".join(fields) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Prints the frames of a Telemetry stream as CSV")
+    parser.add_argument("input", nargs="?",
+                        help="capture file or serial device, default stdin")
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+    stream = (open(args.input, "rb", buffering=0) if args.input
+              else sys.stdin.buffer)
+    try:
+        while True:
+            data = stream.read(4096)
+            if not data:
+                break
+            decoder.feed(data)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.input:
+            stream.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,15 @@
 #include "version.h"
 
 #include "sys/system.h"
+#include "sys/mdma.h"
+#include "sys/dma2d.h"
+#include "sys/dma_streams.h"
+#include "sys/exti.h"
+#include "sys/power_monitor.h"
+#include "sys/scheduler.h"
+#include "sys/system_heap.h"
+#include "sys/timer_service.h"
+#include "sys/irq_priority.h"
 #include "per/qspi.h"
 #include "per/dac.h"
 #include "per/gpio.h"
@@ -15,19 +24,35 @@
 #include "dev/sdram.h"
 #include "dev/sr_4021.h"
 #include "hid/audio.h"
+#include "hid/audio_asrc.h"
+#include "hid/audio_chain.h"
+#include "hid/audio_oversampler.h"
+#include "hid/spectrum_analyzer.h"
+#include "hid/audio_graph.h"
 #include "util/unique_id.h"
 #ifdef __cplusplus
 #include "per/i2c.h"
+#include "per/i2c_scheduler.h"
 #include "per/adc.h"
 #include "per/uart.h"
 #include "hid/midi.h"
+#include "hid/midi_clock.h"
+#include "hid/midi_encoder.h"
 #include "hid/encoder.h"
 #include "hid/switch.h"
 #include "hid/switch3.h"
+#include "hid/switch_bank.h"
 #include "hid/ctrl.h"
+#include "hid/ctrl_bank.h"
+#include "hid/board_layout.h"
+#include "hid/smoothing_bank.h"
 #include "hid/gatein.h"
+#include "hid/gate_scheduler.h"
+#include "hid/input_service.h"
 #include "hid/parameter.h"
 #include "hid/usb.h"
+#include "hid/usb_audio.h"
+#include "hid/usb_msc.h"
 #include "hid/logger.h"
 #include "hid/usb_host.h"
 #include "per/sai.h"
@@ -37,9 +62,12 @@
 #include "per/rng.h"
 #include "hid/disp/display.h"
 #include "hid/disp/oled_display.h"
+#include "hid/disp/graphics_display.h"
 #include "hid/disp/graphics_common.h"
 #include "hid/wavplayer.h"
+#include "hid/wavstreamer.h"
 #include "hid/led.h"
+#include "hid/led_pwm_service.h"
 #include "hid/rgb_led.h"
 #include "dev/sr_595.h"
 #include "dev/apds9960.h"
@@ -52,6 +80,7 @@
 #include "dev/tlv493d.h"
 #include "dev/dotstar.h"
 #include "dev/neopixel.h"
+#include "dev/ws2812.h"
 #include "dev/neotrellis.h"
 #include "dev/icm20948.h"
 #include "ui/ButtonMonitor.h"
@@ -61,14 +90,51 @@
 #include "ui/AbstractMenu.h"
 #include "ui/FullScreenItemMenu.h"
 #include "util/scopedirqblocker.h"
+#include "util/AudioBlockClock.h"
+#include "util/BackupSnapshot.h"
+#include "util/BlockDelayLine.h"
+#include "util/BlockPool.h"
+#include "util/BootTimer.h"
+#include "util/CobsLink.h"
+#include "util/ControlRateClock.h"
 #include "util/CpuLoadMeter.h"
+#include "util/Crc32.h"
+#include "util/CycleCpuLoadMeter.h"
+#include "util/DmaBuffer.h"
+#include "util/FastMath.h"
+#include "util/FastRandom.h"
 #include "util/FIFO.h"
+#include "util/SpscFifo.h"
+#include "util/FileIoQueue.h"
 #include "util/FixedCapStr.h"
+#include "util/KeyValueStore.h"
 #include "util/MappedValue.h"
+#include "util/MemoryArena.h"
+#include "util/ContainerBenchmark.h"
+#include "util/MemoryBenchmark.h"
+#include "util/ObjectPool.h"
+#include "util/IntrusiveList.h"
 #include "util/PersistentStorage.h"
+#include "util/PoolHeap.h"
+#include "util/RealFft.h"
+#include "util/Profiler.h"
+#include "util/IrqProfiler.h"
+#include "util/SampleBank.h"
+#include "util/PresetBank.h"
+#include "util/SampleSlots.h"
+#include "util/SdBenchmark.h"
+#include "util/SectorCache.h"
 #include "util/Stack.h"
+#include "util/StringFormat.h"
+#include "util/TimerWheel.h"
 #include "util/VoctCalibration.h"
 #include "util/WaveTableLoader.h"
 #include "util/WavWriter.h"
+#include "util/MultiWavWriter.h"
+#include "util/WorkQueue.h"
+#include "util/LogRing.h"
+#include "util/TraceRecord.h"
+#include "util/Telemetry.h"
+#include "util/AudioLinkFrame.h"
 #endif
 #endif
@@ -30,6 +30,57 @@ cache enabled.
 */
 #define DTCM_MEM_SECTION __attribute__((section(".dtcmram_bss")))
 
+/** Places a function in the ITCM RAM, which runs it without wait states
+or cache misses, unlike the QSPI flash or internal flash. It's copied
+there at startup. Meant for the few functions that run every audio
+block, the ITCM has 64kB.
+Functions it calls that aren't in the ITCM run from where they are,
+inline functions are inlined into it.
+    void DSY_ITCM_FUNC ProcessBlock(float* buf, size_t size);
+*/
+#define DSY_ITCM_FUNC __attribute__((section(".itcmram_text")))
+
+/** Places a function in the AXI SRAM, for code that runs often but
+doesn't fit in the ITCM. It's copied there at startup with the initialized
+data. From the QSPI flash, every instruction cache miss waits for the
+flash, which is what makes the first audio callbacks after a boot slow;
+from the SRAM a miss costs a few cycles. It takes SRAM from the data.
+    void DSY_SRAM_FUNC UpdateVoices();
+*/
+#define DSY_SRAM_FUNC __attribute__((section(".sram_text")))
+
+/** Data in the AXI SRAM, which every DMA reaches, unlike the D2 SRAM of
+DMA_BUFFER_MEM_SECTION for the SDMMC1 IDMA, or the DTCM, where BOOT_SRAM
+apps have their .bss. It's cached and isn't cleared at startup.
+*/
+#define DSY_AXI_SRAM_BSS __attribute__((section(".axi_sram_bss")))
+
+/** Initialized data in the DTCM RAM, e.g. tables the audio callback reads.
+It's copied there at startup, no cache in front of it. Use
+DTCM_MEM_SECTION for data that doesn't need initial values.
+*/
+#define DSY_DTCM_DATA __attribute__((section(".dtcmram_data")))
+
+/** Data in the 4kB backup SRAM, e.g. a BackupSnapshot. It isn't cleared
+at startup, and keeps its contents across resets, and with VBAT supplied
+and System::InitBackupSram(true), without power on VDD. The section comes
+after the BootInfo of the bootloader, which has to stay at the start.
+*/
+#define DSY_BACKUP_SRAM_BSS __attribute__((section(".backup_sram.user")))
+
+/** libDaisy's own audio interrupt path, from the SAI DMA interrupt to the
+user callback, is placed in the ITCM. Build the library with
+DSY_AUDIO_IN_ITCM=0 to keep it with the rest of the code.
+*/
+#ifndef DSY_AUDIO_IN_ITCM
+#define DSY_AUDIO_IN_ITCM 1
+#endif
+#if DSY_AUDIO_IN_ITCM && !defined(UNIT_TEST)
+#define DSY_AUDIO_FUNC DSY_ITCM_FUNC /**< & */
+#else
+#define DSY_AUDIO_FUNC /**< & */
+#endif
+
 #define FBIPMAX 0.999985f             /**< close to 1.0f-LSB at 16 bit */
 #define FBIPMIN (-FBIPMAX)            /**< - (1 - LSB) */
 #define U82F_SCALE 0.0078740f         /**< 1 / 127 */
@@ -103,7 +103,7 @@ void DaisyField::Init(bool boost)
                              PIN_MUX_SEL_0,
                              PIN_MUX_SEL_1,
                              PIN_MUX_SEL_2);
-    seed.adc.Init(adc_cfg, 5);
+    seed.adc.Init(adc_cfg, 5, AdcHandle::OVS_32, AdcHandle::MODE_DUAL);
 
     // Order of pots on the hardware connected to mux.
     size_t pot_order[KNOB_LAST] = {0, 3, 1, 4, 2, 5, 6, 7};
@@ -192,13 +192,14 @@ void DaisyField::ChangeAudioCallback(AudioHandle::AudioCallback cb)
 void DaisyField::SetHidUpdateRates()
 {
     //set the hids to the new update rate
+    control_clock_.SetBlockRate(AudioCallbackRate());
     for(size_t i = 0; i < KNOB_LAST; i++)
     {
-        knob[i].SetSampleRate(AudioCallbackRate());
+        knob[i].SetSampleRate(control_clock_.GetRate());
     }
     for(size_t i = 0; i < CV_LAST; i++)
     {
-        cv[i].SetSampleRate(AudioCallbackRate());
+        cv[i].SetSampleRate(control_clock_.GetRate());
     }
 }
 
@@ -248,12 +249,20 @@ void DaisyField::StartDac()
 
 void DaisyField::ProcessAnalogControls()
 {
+    if(!control_clock_.Tick())
+        return;
     for(size_t i = 0; i < KNOB_LAST; i++)
         knob[i].Process();
     for(size_t i = 0; i < CV_LAST; i++)
         cv[i].Process();
 }
 
+void DaisyField::SetControlRate(float hz)
+{
+    control_clock_.SetRate(hz);
+    SetHidUpdateRates();
+}
+
 void DaisyField::ProcessDigitalControls()
 {
     // Switches
@@ -262,18 +271,106 @@ void DaisyField::ProcessDigitalControls()
         sw[i].Debounce();
         // Keyboard SM
     }
+    if(background_scan_)
+    {
+        // take the edges the scans saw since the last call
+        ScopedIrqBlocker block;
+        key_rise_mask_ = key_rises_;
+        key_fall_mask_ = key_falls_;
+        key_rises_     = 0;
+        key_falls_     = 0;
+    }
+    else
+    {
+        ScanKeyboard();
+    }
+    // Gate Input
+    gate_in_trig_ = gate_in.Trig();
+}
+
+void DaisyField::ScanKeyboard()
+{
     //dsy_sr_4021_update(&keyboard_sr_);
     keyboard_sr_.Update();
+    const uint32_t keys = keyboard_sr_.GetStateMask();
     for(size_t i = 0; i < 16; i++)
     {
         uint8_t keyidx, keyoffset;
         keyoffset = i > 7 ? 8 : 0;
         keyidx    = (7 - (i % 8)) + keyoffset;
-        keyboard_state_[keyidx]
-            = keyboard_sr_.State(i) | (keyboard_state_[keyidx] << 1);
+        const uint8_t state
+            = ((keys >> i) & 1) | (keyboard_state_[keyidx] << 1);
+        keyboard_state_[keyidx] = state;
+        if(state == 0x80)
+            key_rises_ = key_rises_ | (1u << keyidx);
+        else if(state == 0x7F)
+            key_falls_ = key_falls_ | (1u << keyidx);
     }
-    // Gate Input
-    gate_in_trig_ = gate_in.Trig();
+}
+
+bool DaisyField::StartBackgroundScan(float                           scan_rate,
+                                     TimerHandle::Config::Peripheral periph)
+{
+    StopBackgroundScan();
+    if(scan_rate <= 0.f || periph == TimerHandle::Config::Peripheral::TIM_2)
+        return false;
+    // TIM3 and TIM4 only count to 16 bits, the prescaler makes up the rest
+    const bool     is_32bit  = periph == TimerHandle::Config::Peripheral::TIM_5;
+    const float    ticks     = System::GetPClk1Freq() * 2.f / scan_rate;
+    const float    max_ticks = is_32bit ? 4294967296.f : 65536.f;
+    const uint32_t prescaler = uint32_t(ticks / max_ticks);
+    if(ticks < 2.f || prescaler > 0xffff)
+        return false;
+
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = periph;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.period     = uint32_t(ticks / (prescaler + 1) + 0.5f) - 1;
+    tim_cfg.enable_irq = true;
+    if(scan_timer_.Init(tim_cfg) != TimerHandle::Result::OK)
+        return false;
+    scan_timer_.SetPrescaler(prescaler);
+    scan_timer_.SetCallback(BackgroundScanCallback, this);
+
+    key_rises_       = 0;
+    key_falls_       = 0;
+    background_scan_ = true;
+    if(scan_timer_.Start() != TimerHandle::Result::OK)
+    {
+        background_scan_ = false;
+        return false;
+    }
+    return true;
+}
+
+void DaisyField::StopBackgroundScan()
+{
+    if(!background_scan_)
+        return;
+    scan_timer_.Stop();
+    background_scan_ = false;
+    key_rise_mask_   = 0;
+    key_fall_mask_   = 0;
+    // LEDs that were waiting for the interrupt
+    if(led_driver.IsFramePending())
+        led_driver.SwapBuffersAndTransmit();
+}
+
+void DaisyField::UpdateLeds()
+{
+    if(background_scan_)
+        led_driver.QueueFrame();
+    else
+        led_driver.SwapBuffersAndTransmit();
+}
+
+void DaisyField::BackgroundScanCallback(void* context)
+{
+    DaisyField* field = static_cast<DaisyField*>(context);
+    field->ScanKeyboard();
+    // a frame still being sent is left to finish, the pending one then
+    // goes out with a later scan
+    field->led_driver.Process();
 }
 
 void DaisyField::SetCvOut1(uint16_t val)
@@ -293,11 +390,15 @@ bool DaisyField::KeyboardState(size_t idx) const
 
 bool DaisyField::KeyboardRisingEdge(size_t idx) const
 {
+    if(background_scan_)
+        return (key_rise_mask_ >> idx) & 1;
     return keyboard_state_[idx] == 0x80;
 }
 
 bool DaisyField::KeyboardFallingEdge(size_t idx) const
 {
+    if(background_scan_)
+        return (key_fall_mask_ >> idx) & 1;
     return keyboard_state_[idx] == 0x7F;
 }
 
@@ -380,6 +481,6 @@ void DaisyField::VegasMode()
         }
 
         display.Update();
-        led_driver.SwapBuffersAndTransmit();
+        UpdateLeds();
     }
 }
\ No newline at end of file
@@ -150,6 +150,20 @@ class DaisyField
     /** Processes the ADC inputs, updating their values */
     void ProcessAnalogControls();
 
+    /** Processes the analog controls at a fixed rate instead of with every
+        audio block, which saves their cost with small blocks.
+        ProcessAnalogControls() is still called from every audio callback,
+        and only processes them when an update is due. Read the values
+        between updates with Interpolate(GetControlPhase()).
+        \param hz updates per second, 0 to process them with every call
+    */
+    void SetControlRate(float hz);
+
+    /** Returns how far the audio is between the last two control updates,
+        0 to 1, for AnalogControl::Interpolate(). 1 without a control rate.
+    */
+    float GetControlPhase() const { return control_clock_.GetPhase(); }
+
     /** Process tactile switches and keyboard states */
     void ProcessDigitalControls();
 
@@ -160,6 +174,41 @@ class DaisyField
         ProcessDigitalControls();
     }
 
+    /** Scans the keyboard and sends the LEDs from a timer interrupt,
+        instead of from ProcessDigitalControls() and the main loop.
+        The keyboard shift registers aren't on SPI pins, so they're still
+        read bit by bit, but in the interrupt, at scan_rate. The LEDs are
+        sent by I2C DMA, started from the interrupt after UpdateLeds(),
+        once the last frame is out, so nothing waits for the I2C.
+        ProcessDigitalControls() then only debounces the switches, and
+        takes the key edges seen by the scans since it was last called,
+        so no key press is missed however seldom it's called.
+        \param scan_rate keyboard scans per second, 1kHz matches the
+               debouncing of the keys at the default update rate
+        \param periph timer to use, not TIM_2, which System uses, nor one
+               used by e.g. a TimerService
+        \returns false if the timer can't run at the scan rate
+    */
+    bool StartBackgroundScan(float                           scan_rate = 1000.f,
+                             TimerHandle::Config::Peripheral periph
+                             = TimerHandle::Config::Peripheral::TIM_4);
+
+    /** Stops the background scan, back to scanning the keyboard in
+        ProcessDigitalControls()
+    */
+    void StopBackgroundScan();
+
+    /** Returns true while the keyboard and LEDs are scanned by the timer */
+    bool IsScanningInBackground() const { return background_scan_; }
+
+    /** Sends the LEDs set with led_driver.SetLed(). With the background
+        scan, queues them to be sent from the timer interrupt and returns
+        right away, a frame that can't be sent yet goes out with a later
+        scan, or is replaced by the next one. Otherwise waits for the last
+        frame to be out, like led_driver.SwapBuffersAndTransmit().
+    */
+    void UpdateLeds();
+
     /** Sets the output of CV out 1 to a value between 0-4095 that corresponds to 0-5V */
     void SetCvOut1(uint16_t val);
 
@@ -224,11 +273,22 @@ class DaisyField
     /** Set all the HID callback rates any time a new callback rate is established */
     void SetHidUpdateRates();
     void InitMidi();
+    void ScanKeyboard();
+    static void BackgroundScanCallback(void* context);
 
     ShiftRegister4021<2> keyboard_sr_; /**< Two 4021s daisy-chained. */
-    uint8_t              keyboard_state_[16];
+    volatile uint8_t     keyboard_state_[16];
     uint32_t             last_led_update_; // for vegas mode
     bool                 gate_in_trig_;    // True when triggered.
+    ControlRateClock     control_clock_;
+
+    // background scan
+    TimerHandle       scan_timer_;
+    bool              background_scan_ = false;
+    volatile uint16_t key_rises_       = 0; // edges seen by the scans
+    volatile uint16_t key_falls_       = 0;
+    uint16_t          key_rise_mask_   = 0; // edges of the last
+    uint16_t          key_fall_mask_   = 0; // ProcessDigitalControls()
 };
 
 /** @} */
@@ -23,6 +23,36 @@ constexpr Pin PIN_ADC_PITCH1 = seed::D23;
 constexpr Pin PIN_ADC_CV0    = seed::D19;
 constexpr Pin PIN_ADC_CV1    = seed::D21;
 
+constexpr BoardSwitch3 kSwitches[]
+    = {{PIN_TOGGLE3_LEFT_A, PIN_TOGGLE3_LEFT_B},
+       {PIN_TOGGLE3_RIGHT_A, PIN_TOGGLE3_RIGHT_B}};
+
+constexpr BoardRgbLed kLeds[]
+    = {{PIN_LED_LEFT_R, PIN_LED_LEFT_G, PIN_LED_LEFT_B, true},
+       {PIN_LED_RIGHT_R, PIN_LED_RIGHT_G, PIN_LED_RIGHT_B, true}};
+
+constexpr BoardAnalogIn kControls[]
+    = {{PIN_ADC_PITCH0, true}, {PIN_ADC_CV0, true}, {PIN_ADC_CV1, true}};
+
+constexpr Pin kPins[] = {PIN_SW_ENC,
+                         PIN_TRIG_GATE,
+                         PIN_TOGGLE3_RIGHT_A,
+                         PIN_TOGGLE3_RIGHT_B,
+                         PIN_TOGGLE3_LEFT_A,
+                         PIN_TOGGLE3_LEFT_B,
+                         PIN_ENC_A,
+                         PIN_ENC_B,
+                         PIN_LED_LEFT_R,
+                         PIN_LED_LEFT_G,
+                         PIN_LED_LEFT_B,
+                         PIN_LED_RIGHT_R,
+                         PIN_LED_RIGHT_G,
+                         PIN_LED_RIGHT_B,
+                         PIN_ADC_PITCH0,
+                         PIN_ADC_CV0,
+                         PIN_ADC_CV1};
+static_assert(BoardPinsUnique(kPins), "a Legio pin is used twice");
+
 void DaisyLegio::Init(bool boost)
 {
     // seed init
@@ -31,43 +61,16 @@ void DaisyLegio::Init(bool boost)
     seed.SetAudioBlockSize(48);
     float blockrate_ = seed.AudioSampleRate() / (float)seed.AudioBlockSize();
 
-    Pin toggle_pina[] = {PIN_TOGGLE3_LEFT_A, PIN_TOGGLE3_RIGHT_A};
-    Pin toggle_pinb[] = {PIN_TOGGLE3_LEFT_B, PIN_TOGGLE3_RIGHT_B};
-    Pin ledr_pin[]    = {PIN_LED_LEFT_R, PIN_LED_RIGHT_R};
-    Pin ledg_pin[]    = {PIN_LED_LEFT_G, PIN_LED_RIGHT_G};
-    Pin ledb_pin[]    = {PIN_LED_LEFT_B, PIN_LED_RIGHT_B};
-    Pin adc_pin[]     = {PIN_ADC_PITCH0, PIN_ADC_CV0, PIN_ADC_CV1};
-
     // push-button encoder
     encoder.Init(PIN_ENC_A, PIN_ENC_B, PIN_SW_ENC);
 
     // gate CV gate
     gate.Init(PIN_TRIG_GATE, false);
 
-    // 3-position switches
-    for(size_t i = 0; i < SW_LAST; i++)
-    {
-        sw[i].Init(toggle_pina[i], toggle_pinb[i]);
-    }
-
-    // ADC
-    AdcChannelConfig adc_cfg[CONTROL_LAST];
-    for(size_t i = 0; i < CONTROL_LAST; i++)
-    {
-        adc_cfg[i].InitSingle(adc_pin[i]);
-    }
-    seed.adc.Init(adc_cfg, CONTROL_LAST);
-
-    for(size_t i = 0; i < CONTROL_LAST; i++)
-    {
-        controls[i].Init(seed.adc.GetPtr(i), blockrate_, true);
-    }
-
-    // RGB LEDs
-    for(size_t i = 0; i < LED_LAST; i++)
-    {
-        leds[i].Init(ledr_pin[i], ledg_pin[i], ledb_pin[i], true);
-    }
+    // 3-position switches, ADC and RGB LEDs
+    InitBoardSwitch3s(kSwitches, sw);
+    InitBoardAnalogIns(seed.adc, kControls, controls, blockrate_);
+    InitBoardRgbLeds(kLeds, leds);
 }
 
 void DaisyLegio::SetHidUpdateRates()
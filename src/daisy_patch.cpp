@@ -238,7 +238,7 @@ void DaisyPatch::InitControls()
     cfg[CTRL_4].InitSingle(PIN_CTRL_4);
 
     // Initialize ADC
-    seed.adc.Init(cfg, CTRL_LAST);
+    seed.adc.Init(cfg, CTRL_LAST, AdcHandle::OVS_32, AdcHandle::MODE_DUAL);
 
     // Initialize AnalogControls, with flip set to true
     for(size_t i = 0; i < CTRL_LAST; i++)
@@ -1,4 +1,6 @@
 #include "daisy_patch_sm.h"
+#include "util/DmaBuffer.h"
+#include <algorithm>
 #include <vector>
 
 namespace daisy
@@ -118,7 +120,7 @@ namespace patch_sm
     constexpr Pin DaisyPatchSM::D10;
 
     /** outside of class static buffer(s) for DMA access */
-    uint16_t DMA_BUFFER_MEM_SECTION dsy_patch_sm_dac_buffer[2][48];
+    DmaBuffer<uint16_t, 48> DMA_BUFFER_MEM_SECTION dsy_patch_sm_dac_buffer[2];
 
     class DaisyPatchSM::Impl
     {
@@ -129,8 +131,12 @@ namespace patch_sm
             dac_buffer_size_        = 48;
             dac_output_[0]          = 0;
             dac_output_[1]          = 0;
-            internal_dac_buffer_[0] = dsy_patch_sm_dac_buffer[0];
-            internal_dac_buffer_[1] = dsy_patch_sm_dac_buffer[1];
+            cv_volts_[0]            = 0.f;
+            cv_volts_[1]            = 0.f;
+            cv_streaming_           = false;
+            internal_dac_buffer_[0] = dsy_patch_sm_dac_buffer[0].Data();
+            internal_dac_buffer_[1] = dsy_patch_sm_dac_buffer[1].Data();
+            deferred_init_pending_  = false;
         }
 
         void InitDac();
@@ -139,6 +145,10 @@ namespace patch_sm
 
         void StopDac();
 
+        bool StartCvStream(float samplerate, size_t block_size);
+
+        void WriteCvBlock(const float *cv_1, const float *cv_2, size_t size);
+
         static void InternalDacCallback(uint16_t **output, size_t size);
 
         /** Based on a 0-5V output with a 0-4095 12-bit DAC */
@@ -155,15 +165,24 @@ namespace patch_sm
         inline void WriteCvOut(int channel, float voltage)
         {
             if(channel == 0 || channel == 1)
+            {
                 dac_output_[0] = VoltageToCode(voltage);
+                cv_volts_[0]   = voltage;
+            }
             if(channel == 0 || channel == 2)
+            {
                 dac_output_[1] = VoltageToCode(voltage);
+                cv_volts_[1]   = voltage;
+            }
         }
 
         size_t    dac_buffer_size_;
         uint16_t *internal_dac_buffer_[2];
         uint16_t  dac_output_[2];
+        float     cv_volts_[2]; // held by a stream without a block
         DacHandle dac_;
+        bool      deferred_init_pending_;
+        bool      cv_streaming_;
 
       private:
         bool dac_running_;
@@ -194,13 +213,48 @@ namespace patch_sm
                    internal_dac_buffer_[1],
                    dac_buffer_size_,
                    callback == nullptr ? InternalDacCallback : callback);
-        dac_running_ = true;
+        dac_running_  = true;
+        cv_streaming_ = false;
     }
 
     void DaisyPatchSM::Impl::StopDac()
     {
         dac_.Stop();
-        dac_running_ = false;
+        dac_running_  = false;
+        cv_streaming_ = false;
+    }
+
+    bool DaisyPatchSM::Impl::StartCvStream(float samplerate, size_t block_size)
+    {
+        if(dac_running_)
+            dac_.Stop();
+        dac_running_  = false;
+        cv_streaming_ = false;
+        // WriteSynced() takes fractions of full scale, 0-5V is 0-4095
+        dac_.SetCalibration(DacHandle::Channel::BOTH, 0.2f, 0.f);
+        if(dac_.StartSynced(samplerate, block_size) != DacHandle::Result::OK)
+            return false;
+        dac_running_  = true;
+        cv_streaming_ = true;
+        return true;
+    }
+
+    void DaisyPatchSM::Impl::WriteCvBlock(const float *cv_1,
+                                          const float *cv_2,
+                                          size_t       size)
+    {
+        if(!cv_streaming_ || size > DSY_DAC_SYNC_MAX_BLOCK)
+            return;
+        static float held[2][DSY_DAC_SYNC_MAX_BLOCK];
+        const float *in[2] = {cv_1, cv_2};
+        for(size_t chn = 0; chn < 2; chn++)
+        {
+            if(in[chn] != nullptr)
+                continue;
+            std::fill(held[chn], held[chn] + size, cv_volts_[chn]);
+            in[chn] = held[chn];
+        }
+        dac_.WriteSynced(in, size);
     }
 
 
@@ -222,6 +276,12 @@ namespace patch_sm
  */
 
     void DaisyPatchSM::Init()
+    {
+        InitAudioFirst();
+        InitDeferred();
+    }
+
+    void DaisyPatchSM::InitAudioFirst()
     {
         /** Assign pimpl pointer */
         pimpl_ = &patch_sm_hw;
@@ -240,29 +300,8 @@ namespace patch_sm
         }
 
         system.Init(syscfg);
-        /** Memories */
-        // When using the bootloader priori to v6, SDRAM has been already configured
-        if(boot_version != System::BootInfo::Version::LT_v6_0
-           || (boot_version == System::BootInfo::Version::LT_v6_0
-               && memory == System::MemoryRegion::INTERNAL_FLASH))
-        {
-            /** FMC SDRAM */
-            sdram.Init();
-        }
-        if(memory != System::MemoryRegion::QSPI)
-        {
-            /** QUADSPI FLASH */
-            QSPIHandle::Config qspi_config;
-            qspi_config.device = QSPIHandle::Config::Device::IS25LP064A;
-            qspi_config.mode   = QSPIHandle::Config::Mode::MEMORY_MAPPED;
-            qspi_config.pin_config.io0 = Pin(PORTF, 8);
-            qspi_config.pin_config.io1 = Pin(PORTF, 9);
-            qspi_config.pin_config.io2 = Pin(PORTF, 7);
-            qspi_config.pin_config.io3 = Pin(PORTF, 6);
-            qspi_config.pin_config.clk = Pin(PORTF, 10);
-            qspi_config.pin_config.ncs = Pin(PORTG, 6);
-            qspi.Init(qspi_config);
-        }
+        BootTimer::Mark("system");
+
         /** Audio */
         // Audio Init
         SaiHandle::Config sai_config;
@@ -295,7 +334,10 @@ namespace patch_sm
         audio_config.samplerate = SaiHandle::Config::SampleRate::SAI_48KHZ;
         audio_config.postgain   = 1.f;
         audio.Init(audio_config, sai_1_handle);
+        sai_1_         = sai_1_handle;
         callback_rate_ = AudioSampleRate() / AudioBlockSize();
+        control_clock_.SetBlockRate(callback_rate_);
+        BootTimer::Mark("audio");
 
         /** ADC Init */
         AdcChannelConfig adc_config[ADC_LAST];
@@ -324,9 +366,10 @@ namespace patch_sm
         for(size_t i = 0; i < ADC_LAST; i++)
         {
             if(i < ADC_9)
-                controls[i].InitBipolarCv(adc.GetPtr(i), callback_rate_);
+                controls[i].InitBipolarCv(adc.GetPtr(i),
+                                          control_clock_.GetRate());
             else
-                controls[i].Init(adc.GetPtr(i), callback_rate_);
+                controls[i].Init(adc.GetPtr(i), control_clock_.GetRate());
         }
 
         /** Fixed-function Digital I/O */
@@ -354,16 +397,65 @@ namespace patch_sm
         /** Start any background stuff */
         StartAdc();
         StartDac();
+        BootTimer::Mark("controls");
+
+        pimpl_->deferred_init_pending_ = true;
+    }
+
+    void DaisyPatchSM::InitDeferred()
+    {
+        if(pimpl_ == nullptr || !pimpl_->deferred_init_pending_)
+            return;
+        pimpl_->deferred_init_pending_ = false;
+
+        auto memory       = System::GetProgramMemoryRegion();
+        auto boot_version = System::GetBootloaderVersion();
+
+        /** Memories */
+        // When using the bootloader priori to v6, SDRAM has been already configured
+        if(boot_version != System::BootInfo::Version::LT_v6_0
+           || (boot_version == System::BootInfo::Version::LT_v6_0
+               && memory == System::MemoryRegion::INTERNAL_FLASH))
+        {
+            /** FMC SDRAM */
+            sdram.Init();
+            BootTimer::Mark("sdram");
+        }
+        if(memory != System::MemoryRegion::QSPI)
+        {
+            /** QUADSPI FLASH */
+            QSPIHandle::Config qspi_config;
+            qspi_config.device = QSPIHandle::Config::Device::IS25LP064A;
+            qspi_config.mode   = QSPIHandle::Config::Mode::MEMORY_MAPPED;
+            qspi_config.pin_config.io0 = Pin(PORTF, 8);
+            qspi_config.pin_config.io1 = Pin(PORTF, 9);
+            qspi_config.pin_config.io2 = Pin(PORTF, 7);
+            qspi_config.pin_config.io3 = Pin(PORTF, 6);
+            qspi_config.pin_config.clk = Pin(PORTF, 10);
+            qspi_config.pin_config.ncs = Pin(PORTG, 6);
+            qspi.Init(qspi_config);
+            BootTimer::Mark("qspi");
+        }
     }
 
     void DaisyPatchSM::StartAudio(AudioHandle::AudioCallback cb)
     {
+        // the gates count the frames from the start of the audio
+        if(scheduled_gates_)
+            gates_.Start(sai_1_, AudioBlockSize());
         audio.Start(cb);
+        audio_running_ = true;
+        BootTimer::Mark("audio start");
     }
 
     void DaisyPatchSM::StartAudio(AudioHandle::InterleavingAudioCallback cb)
     {
+        // the gates count the frames from the start of the audio
+        if(scheduled_gates_)
+            gates_.Start(sai_1_, AudioBlockSize());
         audio.Start(cb);
+        audio_running_ = true;
+        BootTimer::Mark("audio start");
     }
 
     void DaisyPatchSM::ChangeAudioCallback(AudioHandle::AudioCallback cb)
@@ -377,16 +469,23 @@ namespace patch_sm
         audio.ChangeCallback(cb);
     }
 
-    void DaisyPatchSM::StopAudio() { audio.Stop(); }
+    void DaisyPatchSM::StopAudio()
+    {
+        audio.Stop();
+        gates_.Stop();
+        audio_running_ = false;
+    }
 
     void DaisyPatchSM::SetAudioBlockSize(size_t size)
     {
         audio.SetBlockSize(size);
         callback_rate_ = AudioSampleRate() / AudioBlockSize();
+        control_clock_.SetBlockRate(callback_rate_);
         for(size_t i = 0; i < ADC_LAST; i++)
         {
-            controls[i].SetSampleRate(callback_rate_);
-        }
+            controls[i].SetSampleRate(control_clock_.GetRate());
+        }        if(IsCvOutStreaming())
+            StartCvOutStream();
     }
 
     void DaisyPatchSM::SetAudioSampleRate(float sr)
@@ -411,10 +510,12 @@ namespace patch_sm
         }
         audio.SetSampleRate(sai_sr);
         callback_rate_ = AudioSampleRate() / AudioBlockSize();
+        control_clock_.SetBlockRate(callback_rate_);
         for(size_t i = 0; i < ADC_LAST; i++)
         {
-            controls[i].SetSampleRate(callback_rate_);
-        }
+            controls[i].SetSampleRate(control_clock_.GetRate());
+        }        if(IsCvOutStreaming())
+            StartCvOutStream();
     }
 
     void
@@ -422,10 +523,12 @@ namespace patch_sm
     {
         audio.SetSampleRate(sample_rate);
         callback_rate_ = AudioSampleRate() / AudioBlockSize();
+        control_clock_.SetBlockRate(callback_rate_);
         for(size_t i = 0; i < ADC_LAST; i++)
         {
-            controls[i].SetSampleRate(callback_rate_);
-        }
+            controls[i].SetSampleRate(control_clock_.GetRate());
+        }        if(IsCvOutStreaming())
+            StartCvOutStream();
     }
 
     size_t DaisyPatchSM::AudioBlockSize()
@@ -443,16 +546,52 @@ namespace patch_sm
 
     void DaisyPatchSM::ProcessAnalogControls()
     {
+        if(!control_clock_.Tick())
+            return;
         for(int i = 0; i < ADC_LAST; i++)
         {
             controls[i].Process();
         }
     }
 
-    void DaisyPatchSM::ProcessDigitalControls() {}
+    void DaisyPatchSM::SetControlRate(float hz)
+    {
+        control_clock_.SetRate(hz);
+        for(size_t i = 0; i < ADC_LAST; i++)
+        {
+            controls[i].SetSampleRate(control_clock_.GetRate());
+        }
+    }
+
+    void DaisyPatchSM::ProcessDigitalControls()
+    {
+        if(scheduled_gates_)
+            gates_.BeginBlock();
+    }
 
     float DaisyPatchSM::GetAdcValue(int idx) { return controls[idx].Value(); }
 
+    bool DaisyPatchSM::EnableScheduledGates(
+        GateScheduler::Config::DmaStream stream)
+    {
+        if(audio_running_)
+            return false;
+        GateScheduler::Config gate_cfg;
+        gate_cfg.stream = stream;
+        gates_.Init(gate_cfg);
+        gate_ids_[GATE_OUT_1] = gates_.AddPin(B5);
+        gate_ids_[GATE_OUT_2] = gates_.AddPin(B6);
+        scheduled_gates_      = true;
+        return true;
+    }
+
+    void DaisyPatchSM::ScheduleGateOut(int idx, bool state, size_t offset)
+    {
+        if(idx < 0 || idx >= GATE_OUT_LAST)
+            return;
+        gates_.Schedule(gate_ids_[idx], state, offset);
+    }
+
     dsy_gpio_pin DaisyPatchSM::GetPin(const PinBank bank, const int idx)
     {
         if(idx <= 0 || idx > 10)
@@ -473,6 +612,29 @@ namespace patch_sm
         pimpl_->WriteCvOut(channel, voltage);
     }
 
+    bool DaisyPatchSM::StartCvOutStream()
+    {
+        return pimpl_->StartCvStream(AudioSampleRate(), AudioBlockSize());
+    }
+
+    void DaisyPatchSM::StopCvOutStream()
+    {
+        if(pimpl_->cv_streaming_)
+            pimpl_->StartDac(nullptr);
+    }
+
+    bool DaisyPatchSM::IsCvOutStreaming() const
+    {
+        return pimpl_ != nullptr && pimpl_->cv_streaming_;
+    }
+
+    void DaisyPatchSM::WriteCvOutBlock(const float *cv_out_1,
+                                       const float *cv_out_2,
+                                       size_t       size)
+    {
+        pimpl_->WriteCvBlock(cv_out_1, cv_out_2, size);
+    }
+
     void DaisyPatchSM::SetLed(bool state) { dsy_gpio_write(&user_led, state); }
 
     bool DaisyPatchSM::ValidateSDRAM()
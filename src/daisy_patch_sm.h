@@ -40,6 +40,14 @@ namespace patch_sm
         CV_OUT_2,
     };
 
+    /** Gate outputs, for DaisyPatchSM::ScheduleGateOut() */
+    enum
+    {
+        GATE_OUT_1 = 0,
+        GATE_OUT_2,
+        GATE_OUT_LAST,
+    };
+
 
     /** @brief Board support file for DaisyPatchSM hardware
      *  @author shensley
@@ -61,12 +69,33 @@ namespace patch_sm
             D
         };
 
-        DaisyPatchSM() {}
+        DaisyPatchSM()
+        : scheduled_gates_(false), audio_running_(false), pimpl_(nullptr)
+        {
+        }
         ~DaisyPatchSM() {}
 
         /** Initializes the memories, and core peripherals for the Daisy Patch SM */
         void Init();
 
+        /** Initializes the core peripherals, and leaves the SDRAM and QSPI
+         *  to InitDeferred(). The SDRAM init alone waits 100ms, so this way
+         *  the audio can be started that much sooner:
+         *  @code
+         *  hw.InitAudioFirst();
+         *  hw.StartAudio(AudioCallback);
+         *  hw.InitDeferred();
+         *  @endcode
+         *  Until InitDeferred() returns, the audio callback mustn't touch
+         *  DSY_SDRAM_BSS or QSPI data. Init() calls both.
+         */
+        void InitAudioFirst();
+
+        /** Initializes the SDRAM and QSPI, after InitAudioFirst().
+         *  Does nothing when they have been initialized already.
+         */
+        void InitDeferred();
+
         /** Starts a non-interleaving audio callback */
         void StartAudio(AudioHandle::AudioCallback cb);
 
@@ -120,8 +149,22 @@ namespace patch_sm
         /** Reads and filters all of the analog control inputs */
         void ProcessAnalogControls();
 
+        /** Processes the analog controls at a fixed rate instead of with every
+            audio block, which saves their cost with small blocks.
+            ProcessAnalogControls() is still called from every audio callback,
+            and only processes them when an update is due. Read the values
+            between updates with Interpolate(GetControlPhase()).
+            \param hz updates per second, 0 to process them with every call
+        */
+        void SetControlRate(float hz);
+
+        /** Returns how far the audio is between the last two control updates,
+            0 to 1, for AnalogControl::Interpolate(). 1 without a control rate.
+        */
+        float GetControlPhase() const { return control_clock_.GetPhase(); }
+
         /** Reads and debounces any of the digital control inputs 
-         *  This does nothing on this board at this time.
+         *  This only prepares the scheduled gate outputs at this time.
          */
         void ProcessDigitalControls();
 
@@ -135,6 +178,29 @@ namespace patch_sm
         /** Returns the current value for one of the ADCs */
         float GetAdcValue(int idx);
 
+        /** Drives the gate outputs with a GateScheduler from then on, so
+         *  that ScheduleGateOut() can change them at a sample of the audio
+         *  block. Call it before StartAudio(), which starts the scheduler
+         *  with the audio. The gates stay low until the first change.
+         *  \param stream DMA stream for the scheduler, not used by anything
+         *         else, e.g. a UartHandler or a LedPwmService
+         *  \returns false if the audio is running already
+         */
+        bool EnableScheduledGates(
+            GateScheduler::Config::DmaStream stream
+            = GateScheduler::Config::DmaStream::DMA_2_STREAM_7);
+
+        /** Sets or clears a gate output at a frame of the block of the
+         *  current audio callback. It changes when that output sample
+         *  plays, one block later, like the audio. Call
+         *  ProcessAllControls() in every callback as well, which clears
+         *  the changes of older blocks.
+         *  \param idx GATE_OUT_1 or GATE_OUT_2
+         *  \param state true for high
+         *  \param offset frame within the block, 0 to AudioBlockSize() - 1
+         */
+        void ScheduleGateOut(int idx, bool state, size_t offset);
+
         /** Returns the STM32 port/pin combo for the desired pin (or an invalid pin for HW only pins)
          *
          *  Macros at top of file can be used in place of separate arguments (i.e. GetPin(A4), etc.)
@@ -171,6 +237,37 @@ namespace patch_sm
          */
         void WriteCvOut(const int channel, float voltage);
 
+        /** Streams the CV Outputs from the audio callback, a sample per
+         *  audio frame, instead of holding the value of WriteCvOut().
+         *  The DAC DMA runs at the audio samplerate and is kept locked to
+         *  the audio blocks (see DacHandle::StartSynced()), so envelopes
+         *  and modulation are as smooth and as timely as the audio.
+         *  The samples of a block are output half a block after it.
+         *
+         *  Follows later changes of the block size or samplerate.
+         *  StartDac() goes back to the held values.
+         *
+         *  \retval false if the block size is over DSY_DAC_SYNC_MAX_BLOCK
+         */
+        bool StartCvOutStream();
+
+        /** Stops streaming and goes back to the values of WriteCvOut() */
+        void StopCvOutStream();
+
+        /** Returns true while the CV Outputs are streamed */
+        bool IsCvOutStreaming() const;
+
+        /** Queues one block of each CV Output, call it once per audio
+         *  callback after StartCvOutStream().
+         *  \param cv_out_1 samples in Volts, 0-5V, or nullptr to hold the
+         *         last WriteCvOut() value
+         *  \param cv_out_2 likewise for CV Out 2
+         *  \param size samples per buffer, the audio block size
+         */
+        void WriteCvOutBlock(const float* cv_out_1,
+                             const float* cv_out_2,
+                             size_t       size);
+
         /** Here are some wrappers around libDaisy Static functions 
          *  to provide simpler syntax to those who prefer it. */
 
@@ -308,7 +405,13 @@ namespace patch_sm
       private:
         using Log = Logger<LOGGER_INTERNAL>;
 
-        float callback_rate_;
+        float            callback_rate_;
+        ControlRateClock control_clock_;
+        SaiHandle        sai_1_;
+        GateScheduler    gates_;
+        bool             scheduled_gates_;
+        bool             audio_running_;
+        int              gate_ids_[GATE_OUT_LAST];
 
         /** Background callback for updating the DACs. */
         Impl* pimpl_;
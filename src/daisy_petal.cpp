@@ -98,15 +98,16 @@ void DaisyPetal::DelayMs(size_t del)
 
 void DaisyPetal::SetHidUpdateRates()
 {
+    control_clock_.SetBlockRate(AudioCallbackRate());
     for(size_t i = 0; i < KNOB_LAST; i++)
     {
-        knob[i].SetSampleRate(AudioCallbackRate());
+        knob[i].SetSampleRate(control_clock_.GetRate());
     }
     for(size_t i = 0; i < FOOTSWITCH_LED_LAST; i++)
     {
         footswitch_led[i].SetSampleRate(AudioCallbackRate());
     }
-    expression.SetSampleRate(AudioCallbackRate());
+    expression.SetSampleRate(control_clock_.GetRate());
 }
 
 
@@ -175,6 +176,8 @@ void DaisyPetal::StopAdc()
 
 void DaisyPetal::ProcessAnalogControls()
 {
+    if(!control_clock_.Tick())
+        return;
     for(size_t i = 0; i < KNOB_LAST; i++)
     {
         knob[i].Process();
@@ -182,6 +185,12 @@ void DaisyPetal::ProcessAnalogControls()
     expression.Process();
 }
 
+void DaisyPetal::SetControlRate(float hz)
+{
+    control_clock_.SetRate(hz);
+    SetHidUpdateRates();
+}
+
 float DaisyPetal::GetKnobValue(Knob k)
 {
     size_t idx;
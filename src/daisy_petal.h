@@ -131,6 +131,20 @@ class DaisyPetal
     /** Call at the same frequency as controls are read for stable readings.*/
     void ProcessAnalogControls();
 
+    /** Processes the analog controls at a fixed rate instead of with every
+        audio block, which saves their cost with small blocks.
+        ProcessAnalogControls() is still called from every audio callback,
+        and only processes them when an update is due. Read the values
+        between updates with Interpolate(GetControlPhase()).
+        \param hz updates per second, 0 to process them with every call
+    */
+    void SetControlRate(float hz);
+
+    /** Returns how far the audio is between the last two control updates,
+        0 to 1, for AnalogControl::Interpolate(). 1 without a control rate.
+    */
+    float GetControlPhase() const { return control_clock_.GetPhase(); }
+
     /** Process Analog and Digital Controls */
     inline void ProcessAllControls()
     {
@@ -193,6 +207,7 @@ class DaisyPetal
     inline uint16_t* adc_ptr(const uint8_t chn) { return seed.adc.GetPtr(chn); }
 
     LedDriverPca9685<2, true> led_driver_;
+    ControlRateClock          control_clock_;
 };
 
 } // namespace daisy
@@ -94,9 +94,10 @@ void DaisyPod::DelayMs(size_t del)
 
 void DaisyPod::SetHidUpdateRates()
 {
+    control_clock_.SetBlockRate(AudioCallbackRate());
     for(int i = 0; i < KNOB_LAST; i++)
     {
-        knobs[i]->SetSampleRate(AudioCallbackRate());
+        knobs[i]->SetSampleRate(control_clock_.GetRate());
     }
 }
 
@@ -165,10 +166,18 @@ void DaisyPod::StopAdc()
 
 void DaisyPod::ProcessAnalogControls()
 {
+    if(!control_clock_.Tick())
+        return;
     knob1.Process();
     knob2.Process();
 }
 
+void DaisyPod::SetControlRate(float hz)
+{
+    control_clock_.SetRate(hz);
+    SetHidUpdateRates();
+}
+
 float DaisyPod::GetKnobValue(Knob k)
 {
     size_t idx;
@@ -98,6 +98,12 @@ const dsy_gpio_pin seedgpio[32] = {
 void DaisySeed::Configure() {}
 
 void DaisySeed::Init(bool boost)
+{
+    InitAudioFirst(boost);
+    InitDeferred();
+}
+
+void DaisySeed::InitAudioFirst(bool boost)
 {
     //dsy_system_init();
     System::Config syscfg;
@@ -123,9 +129,7 @@ void DaisySeed::Init(bool boost)
     }
 
     system.Init(syscfg);
-
-    if(memory != System::MemoryRegion::QSPI)
-        qspi.Init(qspi_config);
+    BootTimer::Mark("system");
 
     if(boot_version != System::BootInfo::Version::LT_v6_0
        || (boot_version == System::BootInfo::Version::LT_v6_0
@@ -133,12 +137,13 @@ void DaisySeed::Init(bool boost)
     {
         dsy_gpio_init(&led);
         dsy_gpio_init(&testpoint);
-        sdram_handle.Init();
     }
 
     ConfigureAudio();
+    BootTimer::Mark("audio");
 
-    callback_rate_ = AudioSampleRate() / AudioBlockSize();
+    callback_rate_         = AudioSampleRate() / AudioBlockSize();
+    deferred_init_pending_ = true;
     // Due to the added 16kB+ of flash usage,
     // and the fact that certain breakouts use
     // both; USB won't be initialized by the
@@ -146,6 +151,31 @@ void DaisySeed::Init(bool boost)
     //usb_handle.Init(UsbHandle::FS_INTERNAL);
 }
 
+void DaisySeed::InitDeferred()
+{
+    if(!deferred_init_pending_)
+        return;
+    deferred_init_pending_ = false;
+
+    auto memory       = System::GetProgramMemoryRegion();
+    auto boot_version = System::GetBootloaderVersion();
+
+    if(memory != System::MemoryRegion::QSPI)
+    {
+        qspi.Init(qspi_config);
+        BootTimer::Mark("qspi");
+    }
+
+    // When using the bootloader prior to v6, SDRAM has been already configured
+    if(boot_version != System::BootInfo::Version::LT_v6_0
+       || (boot_version == System::BootInfo::Version::LT_v6_0
+           && memory == System::MemoryRegion::INTERNAL_FLASH))
+    {
+        sdram_handle.Init();
+        BootTimer::Mark("sdram");
+    }
+}
+
 void DaisySeed::DeInit()
 {
     // This is intended to be used by the bootloader, but
@@ -186,11 +216,25 @@ void DaisySeed::DelayMs(size_t del)
 void DaisySeed::StartAudio(AudioHandle::InterleavingAudioCallback cb)
 {
     audio_handle.Start(cb);
+    BootTimer::Mark("audio start");
 }
 
 void DaisySeed::StartAudio(AudioHandle::AudioCallback cb)
 {
     audio_handle.Start(cb);
+    BootTimer::Mark("audio start");
+}
+
+void DaisySeed::StartAudio(AudioHandle::NativeAudioCallback cb)
+{
+    audio_handle.Start(cb);
+    BootTimer::Mark("audio start");
+}
+
+void DaisySeed::StartAudio(AudioChain& chain)
+{
+    audio_handle.Start(chain);
+    BootTimer::Mark("audio start");
 }
 
 void DaisySeed::ChangeAudioCallback(AudioHandle::InterleavingAudioCallback cb)
@@ -203,6 +247,16 @@ void DaisySeed::ChangeAudioCallback(AudioHandle::AudioCallback cb)
     audio_handle.ChangeCallback(cb);
 }
 
+void DaisySeed::ChangeAudioCallback(AudioHandle::NativeAudioCallback cb)
+{
+    audio_handle.ChangeCallback(cb);
+}
+
+void DaisySeed::ChangeAudioCallback(AudioChain& chain)
+{
+    audio_handle.ChangeCallback(chain);
+}
+
 void DaisySeed::StopAudio()
 {
     audio_handle.Stop();
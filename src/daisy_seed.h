@@ -18,7 +18,7 @@ namespace daisy
 class DaisySeed
 {
   public:
-    DaisySeed() {}
+    DaisySeed() : deferred_init_pending_(false) {}
     ~DaisySeed() {}
 
     /** This function used to provide a pre-initialization configuraiton 
@@ -37,6 +37,25 @@ class DaisySeed
     */
     void Init(bool boost = false);
 
+    /** Initializes the system, the LED and Testpoint, and the audio, and
+    leaves the QSPI and SDRAM to InitDeferred(). The SDRAM init alone waits
+    100ms, so this way the audio can be started that much sooner:
+    \code
+    hw.InitAudioFirst();
+    hw.StartAudio(AudioCallback);
+    hw.InitDeferred();
+    \endcode
+    Until InitDeferred() returns, the audio callback mustn't touch
+    DSY_SDRAM_BSS or QSPI data. Init() calls both.
+    \param boost see Init()
+    */
+    void InitAudioFirst(bool boost = false);
+
+    /** Initializes the QSPI and SDRAM, after InitAudioFirst().
+    Does nothing when they have been initialized already.
+    */
+    void InitDeferred();
+
     /** 
     Deinitializes all peripherals automatically handled by `Init`.
     */
@@ -67,6 +86,18 @@ class DaisySeed
     */
     void StartAudio(AudioHandle::AudioCallback cb);
 
+    /** Begins the audio for the seeds builtin audio.
+    the specified callback will get the raw 24-bit DMA buffers,
+    with no conversion to float.
+    */
+    void StartAudio(AudioHandle::NativeAudioCallback cb);
+
+    /** Begins the audio for the seeds builtin audio.
+    the stages of the chain will process each block in place,
+    one after the other.
+    */
+    void StartAudio(AudioChain& chain);
+
     /** Changes to a new interleaved callback
      */
     void ChangeAudioCallback(AudioHandle::InterleavingAudioCallback cb);
@@ -75,6 +106,14 @@ class DaisySeed
      */
     void ChangeAudioCallback(AudioHandle::AudioCallback cb);
 
+    /** Changes to a new native callback
+     */
+    void ChangeAudioCallback(AudioHandle::NativeAudioCallback cb);
+
+    /** Changes to a chain of stages
+     */
+    void ChangeAudioCallback(AudioChain& chain);
+
     /** Stops the audio if it is running. */
     void StopAudio();
 
@@ -184,6 +223,7 @@ class DaisySeed
     void ConfigureDac();
     //void     ConfigureI2c();
     float callback_rate_;
+    bool  deferred_init_pending_;
 
     SaiHandle sai_1_handle_;
 };
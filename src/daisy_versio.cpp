@@ -31,6 +31,32 @@ constexpr Pin PIN_ADC_CV5 = seed::D17;
 constexpr Pin PIN_ADC_CV6 = seed::D19;
 
 
+constexpr BoardSwitch3 kSwitches[] = {{PIN_TOGGLE3_0A, PIN_TOGGLE3_0B},
+                                      {PIN_TOGGLE3_1A, PIN_TOGGLE3_1B}};
+
+constexpr BoardRgbLed kLeds[] = {{PIN_LED0_R, PIN_LED0_G, PIN_LED0_B, true},
+                                 {PIN_LED1_R, PIN_LED1_G, PIN_LED1_B, true},
+                                 {PIN_LED2_R, PIN_LED2_G, PIN_LED2_B, true},
+                                 {PIN_LED3_R, PIN_LED3_G, PIN_LED3_B, true}};
+
+constexpr BoardAnalogIn kKnobs[] = {{PIN_ADC_CV0, true},
+                                    {PIN_ADC_CV1, true},
+                                    {PIN_ADC_CV2, true},
+                                    {PIN_ADC_CV3, true},
+                                    {PIN_ADC_CV4, true},
+                                    {PIN_ADC_CV5, true},
+                                    {PIN_ADC_CV6, true}};
+
+constexpr Pin kPins[]
+    = {PIN_TRIG_IN,    PIN_SW,         PIN_TOGGLE3_0A, PIN_TOGGLE3_0B,
+       PIN_TOGGLE3_1A, PIN_TOGGLE3_1B, PIN_LED0_R,     PIN_LED0_G,
+       PIN_LED0_B,     PIN_LED1_R,     PIN_LED1_G,     PIN_LED1_B,
+       PIN_LED2_R,     PIN_LED2_G,     PIN_LED2_B,     PIN_LED3_R,
+       PIN_LED3_G,     PIN_LED3_B,     PIN_ADC_CV0,    PIN_ADC_CV1,
+       PIN_ADC_CV2,    PIN_ADC_CV3,    PIN_ADC_CV4,    PIN_ADC_CV5,
+       PIN_ADC_CV6};
+static_assert(BoardPinsUnique(kPins), "a Versio pin is used twice");
+
 void DaisyVersio::Init(bool boost)
 {
     // seed init
@@ -39,49 +65,14 @@ void DaisyVersio::Init(bool boost)
     seed.SetAudioBlockSize(48);
     float blockrate_ = seed.AudioSampleRate() / (float)seed.AudioBlockSize();
 
-    // pin numbers
-    constexpr Pin toggle_pina[] = {PIN_TOGGLE3_0A, PIN_TOGGLE3_1A};
-    constexpr Pin toggle_pinb[] = {PIN_TOGGLE3_0B, PIN_TOGGLE3_1B};
-    constexpr Pin ledr_pin[] = {PIN_LED0_R, PIN_LED1_R, PIN_LED2_R, PIN_LED3_R};
-    constexpr Pin ledg_pin[] = {PIN_LED0_G, PIN_LED1_G, PIN_LED2_G, PIN_LED3_G};
-    constexpr Pin ledb_pin[] = {PIN_LED0_B, PIN_LED1_B, PIN_LED2_B, PIN_LED3_B};
-    constexpr Pin adc_pin[]  = {PIN_ADC_CV0,
-                               PIN_ADC_CV1,
-                               PIN_ADC_CV2,
-                               PIN_ADC_CV3,
-                               PIN_ADC_CV4,
-                               PIN_ADC_CV5,
-                               PIN_ADC_CV6};
-
     // gate in and momentary switch
     tap.Init(PIN_SW);
     gate.Init(PIN_TRIG_IN);
 
-
-    // 3-position switches
-    for(size_t i = 0; i < SW_LAST; i++)
-    {
-        sw[i].Init(toggle_pina[i], toggle_pinb[i]);
-    }
-
-    // ADC
-    AdcChannelConfig adc_cfg[KNOB_LAST];
-    for(size_t i = 0; i < KNOB_LAST; i++)
-    {
-        adc_cfg[i].InitSingle(adc_pin[i]);
-    }
-    seed.adc.Init(adc_cfg, 7);
-
-    for(size_t i = 0; i < KNOB_LAST; i++)
-    {
-        knobs[i].Init(seed.adc.GetPtr(i), blockrate_, true);
-    }
-
-    // RGB LEDs
-    for(size_t i = 0; i < LED_LAST; i++)
-    {
-        leds[i].Init(ledr_pin[i], ledg_pin[i], ledb_pin[i], true);
-    }
+    // 3-position switches, ADC and RGB LEDs
+    InitBoardSwitch3s(kSwitches, sw);
+    InitBoardAnalogIns(seed.adc, kKnobs, knobs, blockrate_);
+    InitBoardRgbLeds(kLeds, leds);
 }
 
 void DaisyVersio::SetHidUpdateRates()
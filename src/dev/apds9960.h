@@ -119,6 +119,18 @@ class Apds9960I2CTransport
                != i2c_.ReceiveBlocking(APDS9960_ADDRESS, data, size, 10);
     }
 
+    /** Starts a read with the DMA, data must be in DMA memory
+        \return true if error, false if ok */
+    bool ReadDma(uint8_t                       *data,
+                 uint16_t                       size,
+                 I2CHandle::CallbackFunctionPtr callback,
+                 void                          *callback_context)
+    {
+        return I2CHandle::Result::OK
+               != i2c_.ReceiveDma(
+                   APDS9960_ADDRESS, data, size, callback, callback_context);
+    }
+
   private:
     I2CHandle i2c_;
 };
@@ -135,6 +147,14 @@ class Apds9960
     Apds9960() {}
     ~Apds9960() {}
 
+    /** Bytes of the full gesture FIFO, 32 datasets of up, down, left and
+        right
+    */
+    static constexpr size_t kGestureFifoSize = 128;
+
+    /** Size of Config::gesture_dma_buffer */
+    static constexpr size_t kGestureDmaBufferSize = kGestureFifoSize;
+
     struct Config
     {
         uint16_t integrationTimeMs;
@@ -150,10 +170,22 @@ class Apds9960
         bool prox_mode;
         bool gesture_mode;
 
+        /** INT output, for ProcessGesture() to only read the gesture FIFO
+            when it reached gestureFifoThresh. Unset to poll GSTATUS.
+        */
+        Pin int_pin;
+
+        /** kGestureDmaBufferSize bytes in DMA memory for the FIFO reads of
+            ProcessGesture(), or nullptr for blocking reads
+        */
+        uint8_t *gesture_dma_buffer;
+
         typename Transport::Config transport_config;
 
         Config()
         {
+            gesture_dma_buffer = nullptr;
+
             integrationTimeMs = 10;
             adcGain           = 1; // 4x
 
@@ -183,6 +215,12 @@ class Apds9960
     {
         config_          = config;
         transport_error_ = false;
+        gesture_state_   = DmaState::IDLE;
+        gesture_active_  = false;
+        gesture_         = 0;
+        if(config_.int_pin.IsValid())
+            int_pin_.Init(
+                config_.int_pin, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
 
         SetTransportErr(transport_.Init(config_.transport_config));
 
@@ -212,6 +250,10 @@ class Apds9960
         SetGestureProximityThreshold(config_.gestureProximityThresh);
         ResetCounts();
 
+        // the INT output signals the gesture FIFO threshold
+        gconf4_.GIEN = config_.int_pin.IsValid();
+        Write8(APDS9960_GCONF4, gconf4_.get());
+
         gpulse_.GPLEN  = 0x03; // 32 us
         gpulse_.GPULSE = 9;    // 10 pulses
         Write8(APDS9960_GPULSE, gpulse_.get());
@@ -654,7 +696,57 @@ class Apds9960
     uint16_t GetColorDataRed() { return Read16R(APDS9960_RDATAL); }
 
 
-    /** Reads the raw green channel value
+        /** Reads the gesture FIFO without waiting, and decodes the gestures
+        with integer math. Once the FIFO holds data, which the INT pin
+        signals when it's set, all of its datasets are read with one
+        burst, with the DMA when Config::gesture_dma_buffer is set. A
+        gesture is decoded from its first and last dataset, once no data
+        arrived for kGestureEndMs. Call it in the main loop.
+        \return true if a gesture was decoded, see GetGesture()
+    */
+    bool ProcessGesture()
+    {
+        const uint32_t now = System::GetNow();
+        if(gesture_state_ == DmaState::DONE)
+        {
+            TakeGestureData(config_.gesture_dma_buffer, gesture_level_, now);
+            gesture_state_ = DmaState::IDLE;
+        }
+        else if(gesture_state_ == DmaState::FAILED)
+        {
+            SetTransportErr(true);
+            gesture_state_ = DmaState::IDLE;
+        }
+        if(gesture_state_ != DmaState::IDLE)
+            return false;
+
+        if(!config_.int_pin.IsValid() || !int_pin_.Read())
+        {
+            // GFLVL and GSTATUS follow each other
+            uint8_t status[2] = {0, 0};
+            uint8_t reg       = APDS9960_GFLVL;
+            bool    err       = transport_.Write(&reg, 1);
+            err               = err || transport_.Read(status, 2);
+            SetTransportErr(err);
+            gstatus_.set(status[1]);
+            gesture_level_ = status[0] < 32 ? status[0] : 32;
+            if(!err && gstatus_.GVALID && gesture_level_ > 0)
+                return ReadGestureFifo(now);
+        }
+        return EndGesture(now);
+    }
+
+    /** The gesture of the last ProcessGesture() that decoded one
+        \return (1,4) -> {UP, DOWN, LEFT, RIGHT}, or 0 if there's none
+    */
+    uint8_t GetGesture()
+    {
+        const uint8_t gesture = gesture_;
+        gesture_              = 0;
+        return gesture;
+    }
+
+/** Reads the raw green channel value
         \return Green channel value
     */
     uint16_t GetColorDataGreen() { return Read16R(APDS9960_GDATAL); }
@@ -687,10 +779,113 @@ class Apds9960
     }
 
   private:
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
+    /** Datasets with all values above it take part in a gesture */
+    static constexpr int kGestureThreshold = 10;
+
+    /** Change of the up/down or left/right ratio in percent for a gesture */
+    static constexpr int kGestureSensitivity = 50;
+
+    /** Time without data after which a gesture is decoded */
+    static constexpr uint32_t kGestureEndMs = 50;
+
+    /** Reads gesture_level_ datasets from the FIFO
+        \return true if a gesture was decoded
+    */
+    bool ReadGestureFifo(uint32_t now)
+    {
+        uint8_t  reg  = APDS9960_GFIFO_U;
+        uint16_t size = gesture_level_ * 4;
+        if(config_.gesture_dma_buffer == nullptr)
+        {
+            uint8_t buf[kGestureFifoSize];
+            bool    err = transport_.Write(&reg, 1);
+            err         = err || transport_.Read(buf, size);
+            SetTransportErr(err);
+            if(!err)
+                TakeGestureData(buf, gesture_level_, now);
+            return false;
+        }
+        gesture_state_ = DmaState::BUSY;
+        if(transport_.Write(&reg, 1)
+           || transport_.ReadDma(
+               config_.gesture_dma_buffer, size, GestureReadDone, this))
+            gesture_state_ = DmaState::FAILED;
+        return false;
+    }
+
+    /** Takes the up/down and left/right ratios of the first and the last
+        dataset of a gesture in percent
+    */
+    void TakeGestureData(const uint8_t *buf, uint8_t datasets, uint32_t now)
+    {
+        for(uint8_t i = 0; i < datasets; i++, buf += 4)
+        {
+            const int u = buf[0], d = buf[1], l = buf[2], r = buf[3];
+            if(u <= kGestureThreshold || d <= kGestureThreshold
+               || l <= kGestureThreshold || r <= kGestureThreshold)
+                continue;
+            ud_last_ = (u - d) * 100 / (u + d);
+            lr_last_ = (l - r) * 100 / (l + r);
+            if(!gesture_active_)
+            {
+                ud_first_       = ud_last_;
+                lr_first_       = lr_last_;
+                gesture_active_ = true;
+            }
+            gesture_last_ms_ = now;
+        }
+    }
+
+    /** Decodes the gesture once no data arrived for kGestureEndMs
+        \return true if a gesture was decoded
+    */
+    bool EndGesture(uint32_t now)
+    {
+        if(!gesture_active_ || now - gesture_last_ms_ < kGestureEndMs)
+            return false;
+        gesture_active_ = false;
+
+        const int ud     = ud_last_ - ud_first_;
+        const int lr     = lr_last_ - lr_first_;
+        const int ud_abs = ud < 0 ? -ud : ud;
+        const int lr_abs = lr < 0 ? -lr : lr;
+        if(ud_abs < kGestureSensitivity && lr_abs < kGestureSensitivity)
+            return false;
+        if(ud_abs > lr_abs)
+            gesture_ = ud > 0 ? APDS9960_DOWN : APDS9960_UP;
+        else
+            gesture_ = lr > 0 ? APDS9960_RIGHT : APDS9960_LEFT;
+        return true;
+    }
+
+    static void GestureReadDone(void *context, I2CHandle::Result result)
+    {
+        auto apds            = static_cast<Apds9960 *>(context);
+        apds->gesture_state_ = result == I2CHandle::Result::OK
+                                   ? DmaState::DONE
+                                   : DmaState::FAILED;
+    }
+
     uint8_t gestCnt_, UCount_, DCount_, LCount_, RCount_; // counters
     uint8_t gestureReceived_;
     bool    transport_error_;
 
+    GPIO              int_pin_;
+    volatile DmaState gesture_state_;
+    uint8_t           gesture_level_;
+    uint8_t           gesture_;
+    bool              gesture_active_;
+    int               ud_first_, lr_first_, ud_last_, lr_last_;
+    uint32_t          gesture_last_ms_;
+
     Config    config_;
     Transport transport_;
 
@@ -850,6 +1045,21 @@ class Apds9960
     status status_;
 };
 
+template <typename Transport>
+constexpr size_t Apds9960<Transport>::kGestureFifoSize;
+
+template <typename Transport>
+constexpr size_t Apds9960<Transport>::kGestureDmaBufferSize;
+
+template <typename Transport>
+constexpr int Apds9960<Transport>::kGestureThreshold;
+
+template <typename Transport>
+constexpr int Apds9960<Transport>::kGestureSensitivity;
+
+template <typename Transport>
+constexpr uint32_t Apds9960<Transport>::kGestureEndMs;
+
 /** @} */
 
 using Apds9960I2C = Apds9960<Apds9960I2CTransport>;
@@ -11,10 +11,10 @@ void Ak4556::Init(dsy_gpio_pin reset_pin)
     reset.mode = DSY_GPIO_MODE_OUTPUT_PP;
     reset.pull = DSY_GPIO_NOPULL;
     dsy_gpio_init(&reset);
-    dsy_gpio_write(&reset, 1);
-    System::Delay(1);
+    // PDN only has to be low for 150ns, and the device is ready again
+    // once the clocks run, so a short pulse is enough
     dsy_gpio_write(&reset, 0);
-    System::Delay(1);
+    System::DelayUs(10);
     dsy_gpio_write(&reset, 1);
 }
 
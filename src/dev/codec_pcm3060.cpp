@@ -51,48 +51,34 @@ Pcm3060::Result Pcm3060::Init(I2CHandle i2c)
     // TODO: bit 1 can be set via hardware and should be configurable.
     dev_addr_ = 0x8c;
 
-    // Reset the codec (though by default we may not need to do this)
-    uint8_t sysreg = 0x00;
-
-    // MRST
-    if(ReadRegister(kAddrRegSysCtrl, &sysreg) != Result::OK)
-        return Result::ERR;
-    sysreg &= ~(kMrstBitMask);
-    if(WriteRegister(kAddrRegSysCtrl, sysreg) != Result::OK)
-        return Result::ERR;
-    //dsy_system_delay(4);
-    System::Delay(4);
-
-    // SRST
-    if(ReadRegister(kAddrRegSysCtrl, &sysreg) != Result::OK)
-        return Result::ERR;
-    sysreg &= ~(kSrstBitMask);
-    if(WriteRegister(kAddrRegSysCtrl, sysreg) != Result::OK)
-        return Result::ERR;
-    System::Delay(4);
-
-    // ADC/DAC Format set to 24-bit LJ
-    uint8_t dac_ctrl, adc_ctrl;
-    if(ReadRegister(kAddrRegDacCtrl1, &dac_ctrl) != Result::OK)
-        return Result::ERR;
-    if(ReadRegister(kAddrRegAdcCtrl1, &adc_ctrl) != Result::OK)
-        return Result::ERR;
-    dac_ctrl |= (kFmtBitMask & 1);
-    adc_ctrl |= (kFmtBitMask & 1);
-    if(WriteRegister(kAddrRegDacCtrl1, dac_ctrl) != Result::OK)
-        return Result::ERR;
-    if(WriteRegister(kAddrRegAdcCtrl1, adc_ctrl) != Result::OK)
-        return Result::ERR;
-
-    // Disable Powersave for ADC/DAC
-    if(ReadRegister(kAddrRegSysCtrl, &sysreg) != Result::OK)
-        return Result::ERR;
-    sysreg &= ~(kAdcPsvBitMask);
-    sysreg &= ~(kDacPsvBitMask);
-    if(WriteRegister(kAddrRegSysCtrl, sysreg) != Result::OK)
-        return Result::ERR;
+    // Reset the codec (though by default we may not need to do this),
+    // set the ADC/DAC format to 24-bit LJ, and disable powersave.
+    // Only the resets need time before the next access.
+    const RegisterUpdate updates[] = {
+        {kAddrRegSysCtrl, kMrstBitMask, 0, 4},
+        {kAddrRegSysCtrl, kSrstBitMask, 0, 4},
+        {kAddrRegDacCtrl1, 0, kFmtBitMask & 1, 0},
+        {kAddrRegAdcCtrl1, 0, kFmtBitMask & 1, 0},
+        {kAddrRegSysCtrl, kAdcPsvBitMask | kDacPsvBitMask, 0, 0},
+    };
+    return UpdateRegisters(updates, sizeof(updates) / sizeof(updates[0]));
+}
 
-    // Success
+Pcm3060::Result Pcm3060::UpdateRegisters(const RegisterUpdate* updates,
+                                         size_t                count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        const RegisterUpdate& update = updates[i];
+        uint8_t               val;
+        if(ReadRegister(update.addr, &val) != Result::OK)
+            return Result::ERR;
+        val = (val & ~update.clear) | update.set;
+        if(WriteRegister(update.addr, val) != Result::OK)
+            return Result::ERR;
+        if(update.delay_ms > 0)
+            System::Delay(update.delay_ms);
+    }
     return Result::OK;
 }
 
@@ -34,6 +34,20 @@ class Pcm3060
     Result Init(I2CHandle i2c);
 
   private:
+    /** A read-modify-write of a register, and the time the device needs
+     *  after it
+     */
+    struct RegisterUpdate
+    {
+        uint8_t addr;
+        uint8_t clear;
+        uint8_t set;
+        uint8_t delay_ms;
+    };
+
+    /** Applies a list of register updates in order */
+    Result UpdateRegisters(const RegisterUpdate *updates, size_t count);
+
     /** Reads the data byte corresponding to the register address */
     Result ReadRegister(uint8_t addr, uint8_t *data);
 
@@ -94,48 +94,11 @@ Wm8731::Result Wm8731::Init(const Wm8731::Config &config, I2CHandle i2c)
     // I2C Driver knows to shift the address
     dev_addr_ = cfg_.csb_pin_state ? W8731_ADDR_1 : W8731_ADDR_0;
 
-    Result res;
-    // Reset
-    res = WriteControlRegister(CODEC_REG_RESET, 0);
-    if(res != Result::OK)
-        return Result::ERR;
-    // Set Line Inputs to 0DB
-    res = WriteControlRegister(CODEC_REG_LEFT_LINE_IN, CODEC_INPUT_0_DB);
-    if(res != Result::OK)
-        return Result::ERR;
-    res = WriteControlRegister(CODEC_REG_RIGHT_LINE_IN, CODEC_INPUT_0_DB);
-    if(res != Result::OK)
-        return Result::ERR;
-    // Set Headphone To Mute (and disable?)
-    res = WriteControlRegister(CODEC_REG_LEFT_HEADPHONES_OUT,
-                               CODEC_HEADPHONES_MUTE);
-    if(res != Result::OK)
-        return Result::ERR;
-    res = WriteControlRegister(CODEC_REG_RIGHT_HEADPHONES_OUT,
-                               CODEC_HEADPHONES_MUTE);
-    if(res != Result::OK)
-        return Result::ERR;
-
-    // Analog and Digital Routing
-    res = WriteControlRegister(CODEC_REG_ANALOGUE_ROUTING,
-                               CODEC_MIC_MUTE | CODEC_ADC_LINE
-                                   | CODEC_OUTPUT_DAC_ENABLE);
-    if(res != Result::OK)
-        return Result::ERR;
-
-    res = WriteControlRegister(CODEC_REG_DIGITAL_ROUTING,
-                               CODEC_DEEMPHASIS_NONE);
-    if(res != Result::OK)
-        return Result::ERR;
-
     // Configure power management
     uint8_t power_down_reg
         = CODEC_POWER_DOWN_MIC | CODEC_POWER_DOWN_CLOCK_OUTPUT;
     if(cfg_.mcu_is_master)
         power_down_reg |= CODEC_POWER_DOWN_OSCILLATOR;
-    res = WriteControlRegister(CODEC_REG_POWER_MANAGEMENT, power_down_reg);
-    if(res != Result::OK)
-        return Result::ERR;
 
     // Digital Format
     uint8_t format_byte;
@@ -145,25 +108,35 @@ Wm8731::Result Wm8731::Init(const Wm8731::Config &config, I2CHandle i2c)
         |= cfg_.mcu_is_master ? CODEC_FORMAT_SLAVE : CODEC_FORMAT_MASTER;
     if(cfg_.lr_swap)
         format_byte |= CODEC_FORMAT_LR_SWAP;
-    res = WriteControlRegister(CODEC_REG_DIGITAL_FORMAT, format_byte);
-    if(res != Result::OK)
-        return Result::ERR;
 
-    // samplerate
+    // The registers are written in this order, the device is inactive
+    // after the reset, and is enabled last.
     // TODO: add support for other samplerates
-    res = WriteControlRegister(CODEC_REG_SAMPLE_RATE, CODEC_RATE_48K_48K);
-    if(res != Result::OK)
-        return Result::ERR;
-
-    res = WriteControlRegister(CODEC_REG_ACTIVE, 0x00);
-    if(res != Result::OK)
-        return Result::ERR;
-
-    // Enable
-    res = WriteControlRegister(CODEC_REG_ACTIVE, 0x01);
-    if(res != Result::OK)
-        return Result::ERR;
+    const RegisterWrite writes[] = {
+        {CODEC_REG_RESET, 0},
+        {CODEC_REG_LEFT_LINE_IN, CODEC_INPUT_0_DB},
+        {CODEC_REG_RIGHT_LINE_IN, CODEC_INPUT_0_DB},
+        {CODEC_REG_LEFT_HEADPHONES_OUT, CODEC_HEADPHONES_MUTE},
+        {CODEC_REG_RIGHT_HEADPHONES_OUT, CODEC_HEADPHONES_MUTE},
+        {CODEC_REG_ANALOGUE_ROUTING,
+         CODEC_MIC_MUTE | CODEC_ADC_LINE | CODEC_OUTPUT_DAC_ENABLE},
+        {CODEC_REG_DIGITAL_ROUTING, CODEC_DEEMPHASIS_NONE},
+        {CODEC_REG_POWER_MANAGEMENT, power_down_reg},
+        {CODEC_REG_DIGITAL_FORMAT, format_byte},
+        {CODEC_REG_SAMPLE_RATE, CODEC_RATE_48K_48K},
+        {CODEC_REG_ACTIVE, 0x01},
+    };
+    return WriteRegisters(writes, sizeof(writes) / sizeof(writes[0]));
+}
 
+Wm8731::Result Wm8731::WriteRegisters(const RegisterWrite* writes,
+                                      size_t              count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(WriteControlRegister(writes[i].addr, writes[i].data) != Result::OK)
+            return Result::ERR;
+    }
     return Result::OK;
 }
 
@@ -176,7 +149,8 @@ Wm8731::Result Wm8731::WriteControlRegister(uint8_t address, uint16_t data)
     {
         return Result::ERR;
     }
-    System::Delay(10);
+    // The registers take the data at the end of the transfer, so there's
+    // no need to wait before the next one
     return Result::OK;
 }
 
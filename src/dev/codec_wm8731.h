@@ -103,6 +103,16 @@ class Wm8731
     Result Init(const Config &config, I2CHandle i2c);
 
   private:
+    /** A register and the 9 bits of data written to it */
+    struct RegisterWrite
+    {
+        uint8_t  addr;
+        uint16_t data;
+    };
+
+    /** Writes a list of registers back to back, in order */
+    Result WriteRegisters(const RegisterWrite *writes, size_t count);
+
     I2CHandle i2c_;
     Config    cfg_;
     Result    WriteControlRegister(uint8_t addr, uint16_t data);
@@ -0,0 +1,192 @@
+#pragma once
+#ifndef DSY_DISPLAY_SPI_TRANSPORT_H
+#define DSY_DISPLAY_SPI_TRANSPORT_H
+
+#include "per/spi.h"
+#include "per/gpio.h"
+#include "sys/dma.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+/** @brief 4 wire SPI transport for colour and greyscale display controllers
+ *  @ingroup device
+ *
+ *  SPI with a data/command pin and a reset pin, e.g. for the SSD1327 and
+ *  the ST7789. Commands and their parameters are sent blocking, the
+ *  pixels by DMA, in as many transfers as it takes.
+ */
+class DisplaySpiTransport
+{
+  public:
+    /** Most commands of SendCommandsDma() */
+    static constexpr size_t kMaxCommands = 8;
+
+    /** Largest SPI DMA transfer, SendDataDma() splits larger ones */
+    static constexpr size_t kMaxDmaSize = 32768;
+
+    /** Called from the interrupt when a DMA transfer is done */
+    typedef void (*TransferCallback)(void* context);
+
+    struct Config
+    {
+        Config()
+        {
+            // Initialize using defaults
+            Defaults();
+        }
+        SpiHandle::Config spi_config;
+        struct
+        {
+            dsy_gpio_pin dc;    /**< & */
+            dsy_gpio_pin reset; /**< & */
+        } pin_config;
+        void Defaults()
+        {
+            // SPI peripheral config
+            spi_config.periph = SpiHandle::Config::Peripheral::SPI_1;
+            spi_config.mode   = SpiHandle::Config::Mode::MASTER;
+            spi_config.direction
+                = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+            spi_config.datasize       = 8;
+            spi_config.clock_polarity = SpiHandle::Config::ClockPolarity::LOW;
+            spi_config.clock_phase    = SpiHandle::Config::ClockPhase::ONE_EDGE;
+            spi_config.nss            = SpiHandle::Config::NSS::HARD_OUTPUT;
+            spi_config.baud_prescaler = SpiHandle::Config::BaudPrescaler::PS_4;
+            // SPI pin config
+            spi_config.pin_config.sclk = {DSY_GPIOG, 11};
+            spi_config.pin_config.miso = {DSY_GPIOX, 0};
+            spi_config.pin_config.mosi = {DSY_GPIOB, 5};
+            spi_config.pin_config.nss  = {DSY_GPIOG, 10};
+            // control pin config
+            pin_config.dc    = {DSY_GPIOB, 4};
+            pin_config.reset = {DSY_GPIOB, 15};
+        }
+    };
+
+    void Init(const Config& config)
+    {
+        pin_dc_.mode = DSY_GPIO_MODE_OUTPUT_PP;
+        pin_dc_.pin  = config.pin_config.dc;
+        dsy_gpio_init(&pin_dc_);
+        pin_reset_.mode = DSY_GPIO_MODE_OUTPUT_PP;
+        pin_reset_.pin  = config.pin_config.reset;
+        dsy_gpio_init(&pin_reset_);
+
+        spi_.Init(config.spi_config);
+
+        // reset the controller
+        dsy_gpio_write(&pin_reset_, 0);
+        System::Delay(10);
+        dsy_gpio_write(&pin_reset_, 1);
+        System::Delay(120);
+    }
+
+    void SendCommand(uint8_t cmd)
+    {
+        dsy_gpio_write(&pin_dc_, 0);
+        spi_.BlockingTransmit(&cmd, 1);
+    }
+
+    /** Sends a command followed by its parameters */
+    void SendCommand(uint8_t cmd, const uint8_t* params, size_t size)
+    {
+        SendCommand(cmd);
+        if(size > 0)
+            SendData(const_cast<uint8_t*>(params), size);
+    }
+
+    void SendData(uint8_t* buff, size_t size)
+    {
+        dsy_gpio_write(&pin_dc_, 1);
+        while(size > 0)
+        {
+            size_t chunk = size;
+            if(chunk > kMaxDmaSize)
+                chunk = kMaxDmaSize;
+            spi_.BlockingTransmit(buff, chunk);
+            buff += chunk;
+            size -= chunk;
+        }
+    }
+
+    /** Sends up to kMaxCommands commands by DMA and returns. The commands
+     *  are copied. Call once the previous transfer is done, e.g. from its
+     *  callback.
+     */
+    void SendCommandsDma(const uint8_t*   cmds,
+                         size_t           size,
+                         TransferCallback callback,
+                         void*            context)
+    {
+        if(size > kMaxCommands)
+            size = kMaxCommands;
+        for(size_t i = 0; i < size; i++)
+            cmds_[i] = cmds[i];
+        dsy_gpio_write(&pin_dc_, 0);
+        StartDma(cmds_, size, callback, context);
+    }
+
+    /** Sends display data by DMA and returns. The data is not copied, it
+     *  must stay unchanged and be reachable by the DMA until the callback.
+     */
+    void SendDataDma(const uint8_t*   buff,
+                     size_t           size,
+                     TransferCallback callback,
+                     void*            context)
+    {
+        dsy_gpio_write(&pin_dc_, 1);
+        StartDma(const_cast<uint8_t*>(buff), size, callback, context);
+    }
+
+  private:
+    void StartDma(uint8_t*         buff,
+                  size_t           size,
+                  TransferCallback callback,
+                  void*            context)
+    {
+        dsy_dma_clear_cache_for_buffer(buff, size);
+        callback_         = callback;
+        callback_context_ = context;
+        dma_next_         = buff;
+        dma_left_         = size;
+        SendNextChunk();
+    }
+
+    void SendNextChunk()
+    {
+        size_t chunk = dma_left_;
+        if(chunk > kMaxDmaSize)
+            chunk = kMaxDmaSize;
+        uint8_t* buff = dma_next_;
+        dma_next_ += chunk;
+        dma_left_ -= chunk;
+        // errors are reported through the callback too
+        spi_.DmaTransmit(buff, chunk, nullptr, &DmaCallback, this);
+    }
+
+    static void DmaCallback(void* context, SpiHandle::Result result)
+    {
+        auto& transport = *static_cast<DisplaySpiTransport*>(context);
+        if(result == SpiHandle::Result::OK && transport.dma_left_ > 0)
+        {
+            transport.SendNextChunk();
+            return;
+        }
+        if(transport.callback_ != nullptr)
+            transport.callback_(transport.callback_context_);
+    }
+
+    SpiHandle        spi_;
+    dsy_gpio         pin_reset_;
+    dsy_gpio         pin_dc_;
+    TransferCallback callback_;
+    void*            callback_context_;
+    uint8_t*         dma_next_;
+    size_t           dma_left_;
+    uint8_t          cmds_[kMaxCommands];
+};
+
+} // namespace daisy
+
+#endif
@@ -2,8 +2,12 @@
 #ifndef DSY_DOTSTAR_H
 #define DSY_DOTSTAR_H
 
+#include <algorithm>
+#include <cstring>
 #include "per/i2c.h"
 #include "per/spi.h"
+#include "util/color.h"
+#include "util/scopedirqblocker.h"
 
 namespace daisy
 {
@@ -13,6 +17,9 @@ namespace daisy
 class DotStarSpiTransport
 {
   public:
+    /** Called from an interrupt when a transfer has completed */
+    typedef void (*DoneCallback)(void *context);
+
     struct Config
     {
         SpiHandle::Config::Peripheral    periph;
@@ -53,14 +60,40 @@ class DotStarSpiTransport
         return spi_.BlockingTransmit(data, size) == SpiHandle::Result::OK;
     };
 
+    /** Starts sending a buffer in DMA memory */
+    bool Transmit(uint8_t *data, size_t size, DoneCallback done, void *context)
+    {
+        done_    = done;
+        context_ = context;
+        return spi_.DmaTransmit(data, size, nullptr, SpiDone, this)
+               == SpiHandle::Result::OK;
+    };
+
   private:
-    SpiHandle spi_;
+    static void SpiDone(void *context, SpiHandle::Result)
+    {
+        auto transport = static_cast<DotStarSpiTransport *>(context);
+        transport->done_(transport->context_);
+    }
+
+    SpiHandle    spi_;
+    DoneCallback done_;
+    void        *context_;
 };
 
 
 /** \brief Device support for Adafruit DotStar LEDs (Opsco SK9822)
     \author Nick Donaldson
     \date March 2023
+
+    With two DMA buffers in the Config, Show() copies the frame into the
+    buffer that isn't being sent and returns, the transfer runs in the
+    background. A frame that has to wait for the one before goes out from
+    the transfer complete interrupt, and a newer Show() replaces it.
+    \code
+    constexpr size_t kSize = DotStarSpi::GetDmaBufferSize(120);
+    uint8_t DMA_BUFFER_MEM_SECTION buff_a[kSize], buff_b[kSize];
+    \endcode
 */
 template <typename Transport>
 class DotStar
@@ -89,27 +122,47 @@ class DotStar
         typename Transport::Config
                    transport_config; /**< Transport-specific configuration */
         ColorOrder color_order;      /**< Pixel color channel ordering */
-        uint16_t   num_pixels;       /**< Number of pixels/LEDs (max 64) */
+        uint16_t   num_pixels;       /**< Number of pixels/LEDs (max 256) */
+        uint8_t   *dma_buffer_a; /**< GetDmaBufferSize() bytes in DMA memory,
+                                      nullptr for blocking transfers */
+        uint8_t   *dma_buffer_b; /**< the second DMA buffer */
 
         void Defaults()
         {
             transport_config.Defaults();
-            color_order = ColorOrder::RGB;
-            num_pixels  = 1;
+            color_order  = ColorOrder::RGB;
+            num_pixels   = 1;
+            dma_buffer_a = nullptr;
+            dma_buffer_b = nullptr;
         };
     };
 
+    /** Size of each DMA buffer in bytes: the start frame, the pixels and
+     *  the end frame
+     */
+    static constexpr size_t GetDmaBufferSize(size_t num_pixels)
+    {
+        return 4 + num_pixels * 4 + GetEndFrameSize(num_pixels);
+    }
+
     DotStar(){};
     ~DotStar(){};
 
     Result Init(Config &config)
     {
-        if(config.num_pixels > kMaxNumPixels)
+        if(config.num_pixels > kMaxNumPixels
+           || (config.dma_buffer_a == nullptr)
+                  != (config.dma_buffer_b == nullptr))
         {
             return Result::ERR_INVALID_ARGUMENT;
         }
         transport_.Init(config.transport_config);
         num_pixels_ = config.num_pixels;
+        buffers_[0] = config.dma_buffer_a;
+        buffers_[1] = config.dma_buffer_b;
+        sending_    = -1;
+        pending_    = -1;
+        error_      = false;
         // first color byte is always global brightness (hence +1 offset)
         r_offset_ = ((config.color_order >> 4) & 0b11) + 1;
         g_offset_ = ((config.color_order >> 2) & 0b11) + 1;
@@ -185,6 +238,17 @@ class DotStar
         SetPixelColor(idx, color.Red8(), color.Green8(), color.Blue8());
     }
 
+    /**
+     * \brief Sets color of a single pixel, e.g. from HsvToRgb8()
+     *
+     * \param idx Index of the pixel
+     * \param color 8-bit color to apply to the pixel
+     */
+    void SetPixelColor(uint16_t idx, const Rgb8 &color)
+    {
+        SetPixelColor(idx, color.red, color.green, color.blue);
+    }
+
     /**
      * \brief Sets color of a single pixel
      * \param color 32-bit integer representing 24-bit RGB color. MSB ignored.
@@ -268,11 +332,20 @@ class DotStar
         }
     };
 
-    /** \brief Writes current pixel buffer data to LEDs */
+    /** \brief Writes current pixel buffer data to LEDs
+     *  \details With DMA buffers it returns right away, and
+     *           ERR_TRANSPORT means a transfer couldn't be started since the
+     *           last call. Call it from one context only then.
+     */
     Result Show()
     {
-        uint8_t sf[4] = {0x00, 0x00, 0x00, 0x00};
-        uint8_t ef[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+        if(buffers_[0] != nullptr)
+        {
+            return ShowDma();
+        }
+        uint8_t        sf[4]    = {0x00, 0x00, 0x00, 0x00};
+        uint8_t        ef[4]    = {0xFF, 0xFF, 0xFF, 0xFF};
+        const uint16_t ef_bytes = GetEndFrameSize(num_pixels_);
         if(!transport_.Write(sf, 4))
         {
             return Result::ERR_TRANSPORT;
@@ -284,19 +357,89 @@ class DotStar
                 return Result::ERR_TRANSPORT;
             }
         }
-        if(!transport_.Write(ef, 4))
+        for(uint16_t i = 0; i < ef_bytes; i += 4)
         {
-            return Result::ERR_TRANSPORT;
+            if(!transport_.Write(ef, 4))
+            {
+                return Result::ERR_TRANSPORT;
+            }
         }
         return Result::OK;
     };
 
+    /** Returns true while a DMA frame is being sent, or waits to be sent */
+    bool IsBusy() const { return sending_ >= 0; }
+
   private:
-    static const size_t kMaxNumPixels = 64;
+    /** The data is delayed by half a clock at each pixel, the end frame
+     *  clocks it through: a bit per 2 pixels, in words of 4 bytes
+     */
+    static constexpr size_t GetEndFrameSize(size_t num_pixels)
+    {
+        return num_pixels <= 64 ? 4 : (num_pixels + 63) / 64 * 4;
+    }
+
+    Result ShowDma()
+    {
+        int buffer;
+        {
+            // the buffer that isn't on its way, it may be pending
+            ScopedIrqBlocker block;
+            buffer   = sending_ == 0 ? 1 : 0;
+            pending_ = -1;
+        }
+
+        uint8_t *out = buffers_[buffer];
+        memset(out, 0x00, 4);
+        memcpy(out + 4, pixels_, num_pixels_ * 4);
+        memset(out + 4 + num_pixels_ * 4, 0xFF, GetEndFrameSize(num_pixels_));
+
+        {
+            ScopedIrqBlocker block;
+            if(sending_ < 0)
+                StartTransfer(buffer);
+            else
+                pending_ = buffer;
+        }
+        const bool error = error_;
+        error_           = false;
+        return error ? Result::ERR_TRANSPORT : Result::OK;
+    }
+
+    void StartTransfer(int buffer)
+    {
+        sending_ = buffer;
+        if(!transport_.Transmit(buffers_[buffer],
+                                GetDmaBufferSize(num_pixels_),
+                                TransferDone,
+                                this))
+        {
+            sending_ = -1;
+            error_   = true;
+        }
+    }
+
+    static void TransferDone(void *context)
+    {
+        auto strip      = static_cast<DotStar *>(context);
+        strip->sending_ = -1;
+        if(strip->pending_ >= 0)
+        {
+            const int buffer = strip->pending_;
+            strip->pending_  = -1;
+            strip->StartTransfer(buffer);
+        }
+    }
+
+    static const size_t kMaxNumPixels = 256;
     Transport           transport_;
     uint16_t            num_pixels_;
     uint32_t            pixels_[kMaxNumPixels];
     uint8_t             r_offset_, g_offset_, b_offset_;
+    uint8_t            *buffers_[2];
+    volatile int8_t     sending_;
+    volatile int8_t     pending_;
+    volatile bool       error_;
 };
 
 using DotStarSpi = DotStar<DotStarSpiTransport>;
@@ -10,10 +10,12 @@
 #define DPS310_TMPCFG 0x07      ///< Temperature configuration
 #define DPS310_MEASCFG 0x08     ///< Sensor configuration
 #define DPS310_CFGREG 0x09      ///< Interrupt/FIFO configuration
-#define DPS310_RESET 0x0C       ///< Soft reset
+#define DPS310_RESET 0x0C       ///< Soft reset and FIFO flush
 #define DPS310_PRODREVID 0x0D   ///< Register that contains the part ID
 #define DPS310_TMPCOEFSRCE 0x28 ///< Temperature calibration src
 
+#include "util/FIFO.h"
+
 namespace daisy
 {
 /** @addtogroup external 
@@ -133,6 +135,30 @@ class Dps310I2CTransport
                | uint32_t(buffer[2]);
     }
 
+    /** Called from an interrupt when a DMA read is done */
+    typedef void (*DmaCallback)(void *context, bool error);
+
+    /** Starts a read with the DMA, the buffer must be in DMA memory
+        \param buffer the register address, followed by room for the data
+        \param size bytes to read into buffer + 1
+        \param callback called when the data arrived
+        \param context passed to the callback
+        \return true if error, false if ok
+    */
+    bool ReadRegDma(uint8_t    *buffer,
+                    uint16_t    size,
+                    DmaCallback callback,
+                    void       *context)
+    {
+        dma_buffer_   = buffer;
+        dma_size_     = size;
+        dma_callback_ = callback;
+        dma_context_  = context;
+        return I2CHandle::Result::OK
+               != i2c_.TransmitDma(
+                   config_.address, buffer, 1, DmaWriteDone, this);
+    }
+
     bool GetError()
     {
         bool tmp = error_;
@@ -141,8 +167,32 @@ class Dps310I2CTransport
     }
 
   private:
-    I2CHandle i2c_;
-    Config    config_;
+    static void DmaWriteDone(void *context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<Dps310I2CTransport *>(context);
+        if(result != I2CHandle::Result::OK
+           || I2CHandle::Result::OK
+                  != transport->i2c_.ReceiveDma(transport->config_.address,
+                                                transport->dma_buffer_ + 1,
+                                                transport->dma_size_,
+                                                DmaReadDone,
+                                                transport))
+            transport->dma_callback_(transport->dma_context_, true);
+    }
+
+    static void DmaReadDone(void *context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<Dps310I2CTransport *>(context);
+        transport->dma_callback_(transport->dma_context_,
+                                 result != I2CHandle::Result::OK);
+    }
+
+    I2CHandle   i2c_;
+    Config      config_;
+    uint8_t    *dma_buffer_;
+    uint16_t    dma_size_;
+    DmaCallback dma_callback_;
+    void       *dma_context_;
 
     // true if error has occured since last check
     bool error_;
@@ -261,6 +311,30 @@ class Dps310SpiTransport
                | uint32_t(buffer[2]);
     }
 
+    /** Called from an interrupt when a DMA read is done */
+    typedef void (*DmaCallback)(void *context, bool error);
+
+    /** Starts a read with the DMA, the buffer must be in DMA memory. The
+        address and the data are one transfer, received into the same buffer.
+        \param buffer the register address, followed by room for the data
+        \param size bytes to read into buffer + 1
+        \param callback called when the data arrived
+        \param context passed to the callback
+        \return true if error, false if ok
+    */
+    bool ReadRegDma(uint8_t    *buffer,
+                    uint16_t    size,
+                    DmaCallback callback,
+                    void       *context)
+    {
+        buffer[0]     = uint8_t(buffer[0] | 0x80);
+        dma_callback_ = callback;
+        dma_context_  = context;
+        return SpiHandle::Result::OK
+               != spi_.DmaTransmitAndReceive(
+                   buffer, buffer, size + 1, nullptr, DmaDone, this);
+    }
+
     bool GetError()
     {
         bool tmp = error_;
@@ -269,8 +343,17 @@ class Dps310SpiTransport
     }
 
   private:
-    SpiHandle spi_;
-    bool      error_;
+    static void DmaDone(void *context, SpiHandle::Result result)
+    {
+        auto transport = static_cast<Dps310SpiTransport *>(context);
+        transport->dma_callback_(transport->dma_context_,
+                                 result != SpiHandle::Result::OK);
+    }
+
+    SpiHandle   spi_;
+    bool        error_;
+    DmaCallback dma_callback_;
+    void       *dma_context_;
 };
 
 /** \brief Device support for DPS310 Barometric Pressure and Altitude Sensor
@@ -284,6 +367,17 @@ class Dps310
     Dps310() {}
     ~Dps310() {}
 
+    /** Results the sensor's FIFO holds */
+    static constexpr size_t kFifoDepth = 32;
+
+    /** Size of Config::fifo_dma_buffer, the register address and 3 bytes
+        for each result of the FIFO
+    */
+    static constexpr size_t kFifoDmaBufferSize = 4 * kFifoDepth;
+
+    /** Pressures kept by the driver until ReadFifoPressure() */
+    static constexpr size_t kFifoSamples = 64;
+
     int32_t oversample_scalefactor[8]
         = {524288, 1572864, 3670016, 7864320, 253952, 516096, 1040384, 2088960};
 
@@ -328,7 +422,12 @@ class Dps310
     {
         typename Transport::Config transport_config;
 
-        Config() {}
+        /** kFifoDmaBufferSize bytes in DMA memory for ProcessFifo(), or
+            nullptr for blocking reads
+        */
+        uint8_t *fifo_dma_buffer;
+
+        Config() : fifo_dma_buffer(nullptr) {}
     };
 
     enum Result
@@ -342,7 +441,12 @@ class Dps310
     */
     Result Init(Config config)
     {
-        config_ = config;
+        config_       = config;
+        dma_state_    = DmaState::IDLE;
+        fifo_enabled_ = false;
+        fifo_error_   = false;
+        fifo_drops_   = 0;
+        samples_.Clear();
 
         transport_.Init(config_.transport_config);
 
@@ -487,7 +591,8 @@ class Dps310
             WriteBits(DPS310_CFGREG, 0, 1, 2);
         }
 
-        pressure_scale = oversample_scalefactor[os];
+        pressure_scale   = oversample_scalefactor[os];
+        pressure_factor_ = 1.f / pressure_scale;
     }
 
 
@@ -499,7 +604,8 @@ class Dps310
     {
         WriteBits(DPS310_TMPCFG, rate, 3, 4);
         WriteBits(DPS310_TMPCFG, os, 4, 0);
-        temp_scale = oversample_scalefactor[os];
+        temp_scale   = oversample_scalefactor[os];
+        temp_factor_ = 1.f / temp_scale;
 
         // Set shift bit if necessary
         if(os > DPS310_8SAMPLES)
@@ -522,24 +628,135 @@ class Dps310
     */
     void Process(void)
     {
-        raw_temperature = twosComplement(Read24(DPS310_TMPB2), 24);
-        raw_pressure    = twosComplement(Read24(DPS310_PRSB2), 24);
+        // the pressure and temperature registers follow each other
+        uint8_t buffer[6];
+        ReadReg(DPS310_PRSB2, buffer, 6);
+        raw_pressure    = twosComplement(Get24(buffer), 24);
+        raw_temperature = twosComplement(Get24(buffer + 3), 24);
+
+        CompensateTemperature(raw_temperature);
+        _pressure = CompensatePressure(raw_pressure);
+    }
+
+    /** Starts the background mode with the sensor's FIFO, for a steady
+        stream of pressures read by ProcessFifo(). The temperature
+        measurements in between update the compensation. Process() doesn't
+        work while the FIFO is on.
+        \param rate pressure measurements per second
+        \param os pressure oversampling
+        \param temp_rate temperature measurements per second
+        \param temp_os temperature oversampling
+    */
+    Result StartFifo(dps310_rate_t       rate,
+                     dps310_oversample_t os,
+                     dps310_rate_t       temp_rate = DPS310_1HZ,
+                     dps310_oversample_t temp_os   = DPS310_1SAMPLE)
+    {
+        setMode(DPS310_IDLE);
+        configurePressure(rate, os);
+        configureTemperature(temp_rate, temp_os);
 
-        _scaled_rawtemp = (float)raw_temperature / temp_scale;
-        _temperature    = _scaled_rawtemp * _c1 + _c0 / 2.0;
+        // a temperature for the pressures before the first one in the FIFO
+        Process();
 
-        _pressure = (float)raw_pressure / pressure_scale;
+        WriteBits(DPS310_CFGREG, 1, 1, 1);
+        Write8(DPS310_RESET, 0x80); // flush the FIFO
+        samples_.Clear();
+        fifo_enabled_ = true;
+        setMode(DPS310_CONT_PRESTEMP);
+        return GetTransportError();
+    }
 
-        _pressure
-            = (int32_t)_c00
-              + _pressure
-                    * ((int32_t)_c10
-                       + _pressure
-                             * ((int32_t)_c20 + _pressure * (int32_t)_c30))
-              + _scaled_rawtemp
-                    * ((int32_t)_c01
-                       + _pressure
-                             * ((int32_t)_c11 + _pressure * (int32_t)_c21));
+    /** Turns the FIFO off, not while a DMA read of ProcessFifo() is busy.
+        The sensor keeps measuring, for Process().
+    */
+    Result StopFifo()
+    {
+        fifo_enabled_ = false;
+        setMode(DPS310_IDLE);
+        WriteBits(DPS310_CFGREG, 0, 1, 1);
+        Write8(DPS310_RESET, 0x80);
+        setMode(DPS310_CONT_PRESTEMP);
+        return GetTransportError();
+    }
+
+    /** Takes the results from the sensor's FIFO, call it in the main loop.
+        Each read takes one result, and they are read until the FIFO is
+        empty, so an empty FIFO costs one 3 byte read. With
+        Config::fifo_dma_buffer the reads follow each other from the DMA
+        interrupts, and their results arrive with a later call.
+        \return true if pressures were added for ReadFifoPressure()
+    */
+    bool ProcessFifo()
+    {
+        bool updated = false;
+        if(dma_state_ == DmaState::DONE)
+        {
+            for(size_t i = 0; i < dma_results_; i++)
+                updated |= TakeFifoResult(
+                    Get24(config_.fifo_dma_buffer + 4 * i + 1));
+            dma_state_ = DmaState::IDLE;
+        }
+        else if(dma_state_ == DmaState::FAILED)
+        {
+            fifo_error_ = true;
+            dma_state_  = DmaState::IDLE;
+        }
+        if(dma_state_ != DmaState::IDLE || !fifo_enabled_)
+            return updated;
+
+        if(config_.fifo_dma_buffer == nullptr)
+        {
+            for(size_t i = 0; i < kFifoDepth; i++)
+            {
+                uint8_t buffer[3];
+                ReadReg(DPS310_PRSB2, buffer, 3);
+                if(GetTransportError() == ERR)
+                {
+                    fifo_error_ = true;
+                    break;
+                }
+                const uint32_t raw = Get24(buffer);
+                if(raw == kFifoEmpty)
+                    break;
+                updated |= TakeFifoResult(raw);
+            }
+            return updated;
+        }
+
+        dma_results_ = 0;
+        dma_state_   = DmaState::BUSY;
+        if(StartFifoRead())
+            dma_state_ = DmaState::FAILED;
+        return updated;
+    }
+
+    /** Takes the oldest pressure that ProcessFifo() read
+        \param pressure receives the pressure in hPa
+        \return false if there's none
+    */
+    bool ReadFifoPressure(float &pressure)
+    {
+        if(samples_.IsEmpty())
+            return false;
+        pressure = samples_.PopFront();
+        return true;
+    }
+
+    /** \return the pressures waiting for ReadFifoPressure() */
+    size_t GetNumFifoPressures() const { return samples_.GetNumElements(); }
+
+    /** \return pressures dropped because ReadFifoPressure() was too slow */
+    uint32_t GetFifoDropCount() const { return fifo_drops_; }
+
+    /** Get and reset the error flag of ProcessFifo()
+        \return Whether a FIFO read failed since the last check
+    */
+    Result GetFifoError()
+    {
+        const bool err = fifo_error_;
+        fifo_error_    = false;
+        return err ? ERR : OK;
     }
 
     /** Get last temperature reading
@@ -636,6 +853,91 @@ class Dps310
     Result GetTransportError() { return transport_.GetError() ? ERR : OK; }
 
   private:
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
+    /** What a read of an empty FIFO returns */
+    static constexpr uint32_t kFifoEmpty = 0x800000;
+
+    static uint32_t Get24(const uint8_t *buffer)
+    {
+        return uint32_t(buffer[0]) << 16 | uint32_t(buffer[1]) << 8
+               | uint32_t(buffer[2]);
+    }
+
+    /** Works out the pressure polynomial for a temperature, which changes
+        slowly, so that each pressure only needs three multiply-adds
+    */
+    void CompensateTemperature(int32_t raw)
+    {
+        _scaled_rawtemp   = raw * temp_factor_;
+        _temperature      = _scaled_rawtemp * _c1 + _c0 * 0.5f;
+        pressure_coef_[0] = _c00 + _scaled_rawtemp * _c01;
+        pressure_coef_[1] = _c10 + _scaled_rawtemp * _c11;
+        pressure_coef_[2] = _c20 + _scaled_rawtemp * _c21;
+        pressure_coef_[3] = _c30;
+    }
+
+    /** \return the pressure in Pa for the last CompensateTemperature() */
+    float CompensatePressure(int32_t raw)
+    {
+        const float p = raw * pressure_factor_;
+        return pressure_coef_[0]
+               + p
+                     * (pressure_coef_[1]
+                        + p * (pressure_coef_[2] + p * pressure_coef_[3]));
+    }
+
+    /** Takes a result from the FIFO, the lowest bit is set for pressures
+        \return true if it was a pressure
+    */
+    bool TakeFifoResult(uint32_t raw)
+    {
+        const int32_t value = twosComplement(raw, 24);
+        if(!(raw & 1))
+        {
+            raw_temperature = value;
+            CompensateTemperature(value);
+            return false;
+        }
+        raw_pressure = value;
+        _pressure    = CompensatePressure(value);
+        if(!samples_.PushBack(_pressure / 100))
+            fifo_drops_++;
+        return true;
+    }
+
+    /** Reads the next FIFO result into its slot of the DMA buffer
+        \return true if error
+    */
+    bool StartFifoRead()
+    {
+        uint8_t *slot = config_.fifo_dma_buffer + 4 * dma_results_;
+        slot[0]       = DPS310_PRSB2;
+        return transport_.ReadRegDma(slot, 3, FifoReadDone, this);
+    }
+
+    static void FifoReadDone(void *context, bool error)
+    {
+        auto dps = static_cast<Dps310 *>(context);
+        if(error)
+        {
+            dps->dma_state_ = DmaState::FAILED;
+            return;
+        }
+        const uint8_t *slot
+            = dps->config_.fifo_dma_buffer + 4 * dps->dma_results_;
+        if(Get24(slot + 1) == kFifoEmpty || ++dps->dma_results_ == kFifoDepth)
+            dps->dma_state_ = DmaState::DONE;
+        else if(dps->StartFifoRead())
+            dps->dma_state_ = DmaState::FAILED;
+    }
+
     Config    config_;
     Transport transport_;
 
@@ -645,8 +947,30 @@ class Dps310
     int32_t raw_pressure, raw_temperature;
     float   _temperature, _scaled_rawtemp, _pressure;
     int32_t temp_scale, pressure_scale;
+
+    float temp_factor_, pressure_factor_; ///< 1 / the scales
+    float pressure_coef_[4];              ///< polynomial at the temperature
+
+    volatile DmaState         dma_state_;
+    volatile size_t           dma_results_;
+    bool                      fifo_enabled_;
+    bool                      fifo_error_;
+    uint32_t                  fifo_drops_;
+    FIFO<float, kFifoSamples> samples_;
 };
 
+template <typename Transport>
+constexpr size_t Dps310<Transport>::kFifoDepth;
+
+template <typename Transport>
+constexpr size_t Dps310<Transport>::kFifoDmaBufferSize;
+
+template <typename Transport>
+constexpr size_t Dps310<Transport>::kFifoSamples;
+
+template <typename Transport>
+constexpr uint32_t Dps310<Transport>::kFifoEmpty;
+
 /** @} */
 
 using Dps310I2C = Dps310<Dps310I2CTransport>;
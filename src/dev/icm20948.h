@@ -21,6 +21,12 @@
 #define ICM20X_B0_PWR_MGMT_1 0x06   ///< primary power management register
 #define ICM20X_B0_ACCEL_XOUT_H 0x2D ///< first byte of accel data
 #define ICM20X_B0_GYRO_XOUT_H 0x33  ///< first byte of accel data
+#define ICM20X_B0_FIFO_EN_2 0x67    ///< Sensor data written to the FIFO
+#define ICM20X_B0_FIFO_RST 0x68     ///< FIFO reset
+#define ICM20X_B0_FIFO_MODE 0x69    ///< FIFO stream or snapshot mode
+#define ICM20X_B0_FIFO_COUNTH 0x70  ///< FIFO byte count, high byte first
+#define ICM20X_B0_FIFO_R_W 0x72     ///< FIFO data
+#define ICM20X_B0_FIFO_CFG 0x76     ///< FIFO interrupt status config
 
 // Bank 2
 #define ICM20X_B2_GYRO_SMPLRT_DIV 0x00    ///< Gyroscope data rate divisor
@@ -70,6 +76,9 @@
 #define SENSORS_GRAVITY_EARTH (9.80665F)
 #define SENSORS_DPS_TO_RADS (0.017453293F)
 
+#include <algorithm>
+#include "util/FIFO.h"
+
 namespace daisy
 {
 /** @addtogroup external 
@@ -178,6 +187,30 @@ class Icm20948I2CTransport
         return buffer;
     }
 
+    /** Called from an interrupt when a DMA read is done */
+    typedef void (*DmaCallback)(void *context, bool error);
+
+    /** Starts a read with the DMA, the buffer must be in DMA memory
+        \param buffer the register address, followed by room for the data
+        \param size bytes to read into buffer + 1
+        \param callback called when the data arrived
+        \param context passed to the callback
+        \return true if error, false if ok
+    */
+    bool ReadRegDma(uint8_t    *buffer,
+                    uint16_t    size,
+                    DmaCallback callback,
+                    void       *context)
+    {
+        dma_buffer_   = buffer;
+        dma_size_     = size;
+        dma_callback_ = callback;
+        dma_context_  = context;
+        return I2CHandle::Result::OK
+               != i2c_.TransmitDma(
+                   config_.address, buffer, 1, DmaWriteDone, this);
+    }
+
     bool GetError()
     {
         bool tmp = error_;
@@ -186,8 +219,32 @@ class Icm20948I2CTransport
     }
 
   private:
-    I2CHandle i2c_;
-    Config    config_;
+    static void DmaWriteDone(void *context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<Icm20948I2CTransport *>(context);
+        if(result != I2CHandle::Result::OK
+           || I2CHandle::Result::OK
+                  != transport->i2c_.ReceiveDma(transport->config_.address,
+                                                transport->dma_buffer_ + 1,
+                                                transport->dma_size_,
+                                                DmaReadDone,
+                                                transport))
+            transport->dma_callback_(transport->dma_context_, true);
+    }
+
+    static void DmaReadDone(void *context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<Icm20948I2CTransport *>(context);
+        transport->dma_callback_(transport->dma_context_,
+                                 result != I2CHandle::Result::OK);
+    }
+
+    I2CHandle   i2c_;
+    Config      config_;
+    uint8_t    *dma_buffer_;
+    uint16_t    dma_size_;
+    DmaCallback dma_callback_;
+    void       *dma_context_;
 
     // true if error has occured since last check
     bool error_;
@@ -296,6 +353,30 @@ class Icm20948SpiTransport
         return buffer;
     }
 
+    /** Called from an interrupt when a DMA read is done */
+    typedef void (*DmaCallback)(void *context, bool error);
+
+    /** Starts a read with the DMA, the buffer must be in DMA memory. The
+        address and the data are one transfer, received into the same buffer.
+        \param buffer the register address, followed by room for the data
+        \param size bytes to read into buffer + 1
+        \param callback called when the data arrived
+        \param context passed to the callback
+        \return true if error, false if ok
+    */
+    bool ReadRegDma(uint8_t    *buffer,
+                    uint16_t    size,
+                    DmaCallback callback,
+                    void       *context)
+    {
+        buffer[0]     = uint8_t(buffer[0] | 0x80);
+        dma_callback_ = callback;
+        dma_context_  = context;
+        return SpiHandle::Result::OK
+               != spi_.DmaTransmitAndReceive(
+                   buffer, buffer, size + 1, nullptr, DmaDone, this);
+    }
+
     bool GetError()
     {
         bool tmp = error_;
@@ -304,8 +385,17 @@ class Icm20948SpiTransport
     }
 
   private:
-    SpiHandle spi_;
-    bool      error_;
+    static void DmaDone(void *context, SpiHandle::Result result)
+    {
+        auto transport = static_cast<Icm20948SpiTransport *>(context);
+        transport->dma_callback_(transport->dma_context_,
+                                 result != SpiHandle::Result::OK);
+    }
+
+    SpiHandle   spi_;
+    bool        error_;
+    DmaCallback dma_callback_;
+    void       *dma_context_;
 };
 
 /** \brief Device support for ICM20948 IMU sensor
@@ -319,11 +409,29 @@ class Icm20948
     Icm20948() {}
     ~Icm20948() {}
 
+    /** Bytes of one FIFO record, accel and gyro x, y and z */
+    static constexpr size_t kFifoRecordSize = 12;
+
+    /** Most records read from the chip's FIFO with one burst */
+    static constexpr size_t kFifoMaxBurst = 42;
+
+    /** Size of Config::fifo_dma_buffer, the register address and a burst */
+    static constexpr size_t kFifoDmaBufferSize
+        = 1 + kFifoMaxBurst * kFifoRecordSize;
+
+    /** Samples kept by the driver until ReadFifoSample() */
+    static constexpr size_t kFifoSamples = 64;
+
     struct Config
     {
         typename Transport::Config transport_config;
 
-        Config() {}
+        /** kFifoDmaBufferSize bytes in DMA memory for ProcessFifo(), or
+            nullptr for blocking reads
+        */
+        uint8_t *fifo_dma_buffer;
+
+        Config() : fifo_dma_buffer(nullptr) {}
     };
 
     struct Icm20948Vect
@@ -333,6 +441,14 @@ class Icm20948
         float z;
     };
 
+    /** A sample read from the chip's FIFO */
+    struct FifoSample
+    {
+        Icm20948Vect accel;   ///< m/s^2
+        Icm20948Vect gyro;    ///< rad/s
+        uint32_t     time_us; ///< System::GetUs() when it was measured
+    };
+
     /** The accelerometer data range */
     enum icm20948_accel_range_t
     {
@@ -375,7 +491,12 @@ class Icm20948
     */
     Result Init(Config config)
     {
-        config_ = config;
+        config_         = config;
+        dma_state_      = DmaState::IDLE;
+        fifo_enabled_   = false;
+        fifo_error_     = false;
+        fifo_overflows_ = 0;
+        samples_.Clear();
 
         transport_.Init(config_.transport_config);
 
@@ -501,14 +622,30 @@ class Icm20948
     }
 
     void ScaleValues()
+    {
+        const float accel_scale = GetAccelScale();
+        const float gyro_scale  = GetGyroScale();
+
+        gyroX = rawGyroX / gyro_scale;
+        gyroY = rawGyroY / gyro_scale;
+        gyroZ = rawGyroZ / gyro_scale;
+
+        accX = rawAccX / accel_scale;
+        accY = rawAccY / accel_scale;
+        accZ = rawAccZ / accel_scale;
+
+        magX = rawMagX * ICM20948_UT_PER_LSB;
+        magY = rawMagY * ICM20948_UT_PER_LSB;
+        magZ = rawMagZ * ICM20948_UT_PER_LSB;
+    }
+
+    /** \return the gyro LSBs per degree per second of the current range */
+    float GetGyroScale()
     {
         icm20948_gyro_range_t gyro_range
             = (icm20948_gyro_range_t)current_gyro_range_;
-        icm20948_accel_range_t accel_range
-            = (icm20948_accel_range_t)current_accel_range_;
 
-        float accel_scale = 1.0;
-        float gyro_scale  = 1.0;
+        float gyro_scale = 1.0;
 
         if(gyro_range == ICM20948_GYRO_RANGE_250_DPS)
             gyro_scale = 131.0;
@@ -519,6 +656,17 @@ class Icm20948
         if(gyro_range == ICM20948_GYRO_RANGE_2000_DPS)
             gyro_scale = 16.4;
 
+        return gyro_scale;
+    }
+
+    /** \return the accel LSBs per g of the current range */
+    float GetAccelScale()
+    {
+        icm20948_accel_range_t accel_range
+            = (icm20948_accel_range_t)current_accel_range_;
+
+        float accel_scale = 1.0;
+
         if(accel_range == ICM20948_ACCEL_RANGE_2_G)
             accel_scale = 16384.0;
         if(accel_range == ICM20948_ACCEL_RANGE_4_G)
@@ -528,17 +676,7 @@ class Icm20948
         if(accel_range == ICM20948_ACCEL_RANGE_16_G)
             accel_scale = 2048.0;
 
-        gyroX = rawGyroX / gyro_scale;
-        gyroY = rawGyroY / gyro_scale;
-        gyroZ = rawGyroZ / gyro_scale;
-
-        accX = rawAccX / accel_scale;
-        accY = rawAccY / accel_scale;
-        accZ = rawAccZ / accel_scale;
-
-        magX = rawMagX * ICM20948_UT_PER_LSB;
-        magY = rawMagY * ICM20948_UT_PER_LSB;
-        magZ = rawMagZ * ICM20948_UT_PER_LSB;
+        return accel_scale;
     }
 
     /** Sets the accelerometer's data rate divisor.
@@ -800,6 +938,150 @@ class Icm20948
         SetBank(0);
     }
 
+    /** Writes accel and gyro samples to the chip's FIFO, so that
+        ProcessFifo() can read many of them with one burst. Both sensors
+        run at 1100Hz / (1 + rate_divisor).
+        \param rate_divisor sample rate divisor of both sensors
+        \param watermark samples in the chip's FIFO before they are read
+    */
+    Result EnableFifo(uint8_t rate_divisor = 10, uint16_t watermark = 1)
+    {
+        SetGyroRateDivisor(rate_divisor);
+        SetAccelRateDivisor(rate_divisor);
+
+        SetBank(0);
+        Write8(ICM20X_B0_FIFO_EN_2, 0x1E); // accel and gyro x, y, z
+        Write8(ICM20X_B0_FIFO_MODE, 0x00); // stream
+        Write8(ICM20X_B0_FIFO_CFG, 0x00);
+        ResetFifo();
+        WriteBits(ICM20X_B0_USER_CTRL, 1, 1, 6);
+
+        fifo_period_us_ = (1 + rate_divisor) * 1000000 / 1100;
+        fifo_watermark_ = watermark > 0 ? watermark : 1;
+        fifo_enabled_   = true;
+        samples_.Clear();
+        return GetTransportError();
+    }
+
+    /** Stops writing samples to the chip's FIFO, not while a DMA read of
+        ProcessFifo() is busy
+    */
+    Result DisableFifo()
+    {
+        fifo_enabled_ = false;
+        SetBank(0);
+        WriteBits(ICM20X_B0_USER_CTRL, 0, 1, 6);
+        Write8(ICM20X_B0_FIFO_EN_2, 0x00);
+        return GetTransportError();
+    }
+
+    /** Reads the chip's FIFO once it holds the watermark, call it in the
+        main loop. The FIFO count is read first, then up to kFifoMaxBurst
+        records with one burst, with the DMA when Config::fifo_dma_buffer
+        is set. Those samples then arrive with a later call. Each sample is
+        timestamped, counting back from the time of the FIFO count by the
+        sample period.
+        \return true if samples were added for ReadFifoSample()
+    */
+    bool ProcessFifo()
+    {
+        bool updated = false;
+        if(dma_state_ == DmaState::DONE)
+        {
+            ParseFifo(config_.fifo_dma_buffer + 1);
+            dma_state_ = DmaState::IDLE;
+            updated    = true;
+        }
+        else if(dma_state_ == DmaState::FAILED)
+        {
+            fifo_error_ = true;
+            dma_state_  = DmaState::IDLE;
+        }
+        if(dma_state_ != DmaState::IDLE || !fifo_enabled_)
+            return updated;
+
+        uint8_t count[2];
+        ReadReg(ICM20X_B0_FIFO_COUNTH, count, 2);
+        const uint32_t now   = System::GetUs();
+        const size_t   bytes = ((count[0] & 0x1F) << 8) | count[1];
+        if(GetTransportError() == ERR)
+        {
+            fifo_error_ = true;
+            return updated;
+        }
+
+        // a full FIFO drops its oldest bytes, the records lose their order
+        if(bytes >= kFifoSize || bytes % kFifoRecordSize != 0)
+        {
+            ResetFifo();
+            fifo_overflows_++;
+            return updated;
+        }
+
+        const size_t records = bytes / kFifoRecordSize;
+        const size_t space
+            = samples_.GetCapacity() - samples_.GetNumElements();
+        if(records < fifo_watermark_ || space == 0)
+            return updated;
+
+        // the newest record was measured within the last sample period
+        burst_records_ = std::min(std::min(records, kFifoMaxBurst), space);
+        burst_time_us_ = now - uint32_t(records - 1) * fifo_period_us_;
+        const size_t size = burst_records_ * kFifoRecordSize;
+
+        if(config_.fifo_dma_buffer == nullptr)
+        {
+            // ReadReg() reads up to 255 bytes at once
+            uint8_t buffer[kFifoMaxBurst * kFifoRecordSize];
+            for(size_t pos = 0; pos < size; pos += kBlockingReadSize)
+                ReadReg(ICM20X_B0_FIFO_R_W,
+                        buffer + pos,
+                        std::min(size - pos, kBlockingReadSize));
+            if(GetTransportError() == ERR)
+            {
+                fifo_error_ = true;
+                return updated;
+            }
+            ParseFifo(buffer);
+            return true;
+        }
+
+        dma_state_                 = DmaState::BUSY;
+        config_.fifo_dma_buffer[0] = ICM20X_B0_FIFO_R_W;
+        if(transport_.ReadRegDma(
+               config_.fifo_dma_buffer, size, FifoReadDone, this))
+            dma_state_ = DmaState::FAILED;
+        return updated;
+    }
+
+    /** Takes the oldest sample that ProcessFifo() read
+        \param sample receives the sample
+        \return false if there's none
+    */
+    bool ReadFifoSample(FifoSample &sample)
+    {
+        if(samples_.IsEmpty())
+            return false;
+        sample = samples_.PopFront();
+        return true;
+    }
+
+    /** \return the samples waiting for ReadFifoSample() */
+    size_t GetNumFifoSamples() const { return samples_.GetNumElements(); }
+
+    /** \return how often the chip's FIFO overflowed and was reset */
+    uint32_t GetFifoOverflowCount() const { return fifo_overflows_; }
+
+    /** Get and reset the error flag of ProcessFifo()
+        \return Whether a FIFO read failed since the last check
+    */
+    Result GetFifoError()
+    {
+        const bool err = fifo_error_;
+        fifo_error_    = false;
+        return err ? ERR : OK;
+    }
+
     Icm20948Vect GetAccelVect()
     {
         Icm20948Vect vect;
@@ -955,9 +1237,64 @@ class Icm20948
     Result GetTransportError() { return transport_.GetError() ? ERR : OK; }
 
   private:
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
+    /** Bytes of the chip's FIFO */
+    static constexpr size_t kFifoSize = 512;
+
+    /** Bytes of each blocking FIFO read, whole records */
+    static constexpr size_t kBlockingReadSize = 20 * kFifoRecordSize;
+
+    void ResetFifo()
+    {
+        Write8(ICM20X_B0_FIFO_RST, 0x1F);
+        Write8(ICM20X_B0_FIFO_RST, 0x00);
+    }
+
+    /** Adds the samples of a burst read from ICM20X_B0_FIFO_R_W */
+    void ParseFifo(const uint8_t *buff)
+    {
+        const float accel = SENSORS_GRAVITY_EARTH / GetAccelScale();
+        const float gyro  = SENSORS_DPS_TO_RADS / GetGyroScale();
+        for(size_t i = 0; i < burst_records_; i++, buff += kFifoRecordSize)
+        {
+            FifoSample sample;
+            sample.accel.x = int16_t(buff[0] << 8 | buff[1]) * accel;
+            sample.accel.y = int16_t(buff[2] << 8 | buff[3]) * accel;
+            sample.accel.z = int16_t(buff[4] << 8 | buff[5]) * accel;
+            sample.gyro.x  = int16_t(buff[6] << 8 | buff[7]) * gyro;
+            sample.gyro.y  = int16_t(buff[8] << 8 | buff[9]) * gyro;
+            sample.gyro.z  = int16_t(buff[10] << 8 | buff[11]) * gyro;
+            sample.time_us = burst_time_us_ + uint32_t(i) * fifo_period_us_;
+            samples_.PushBack(sample);
+        }
+    }
+
+    static void FifoReadDone(void *context, bool error)
+    {
+        auto icm        = static_cast<Icm20948 *>(context);
+        icm->dma_state_ = error ? DmaState::FAILED : DmaState::DONE;
+    }
+
     Config    config_;
     Transport transport_;
 
+    volatile DmaState              dma_state_;
+    bool                           fifo_enabled_;
+    bool                           fifo_error_;
+    uint32_t                       fifo_overflows_;
+    uint32_t                       fifo_period_us_;
+    size_t                         fifo_watermark_;
+    size_t                         burst_records_;
+    uint32_t                       burst_time_us_;
+    FIFO<FifoSample, kFifoSamples> samples_;
+
     uint16_t _sensorid_accel, ///< ID number for accelerometer
         _sensorid_gyro,       ///< ID number for gyro
         _sensorid_mag,        ///< ID number for mag
@@ -989,6 +1326,24 @@ class Icm20948
         magZ;          ///< Last reading's mag Z axis in rad/s
 };
 
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kFifoRecordSize;
+
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kFifoMaxBurst;
+
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kFifoDmaBufferSize;
+
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kFifoSamples;
+
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kFifoSize;
+
+template <typename Transport>
+constexpr size_t Icm20948<Transport>::kBlockingReadSize;
+
 /** @} */
 
 using Icm20948I2C = Icm20948<Icm20948I2CTransport>;
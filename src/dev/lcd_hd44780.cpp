@@ -11,11 +11,11 @@ Based on: HD44780-Stm32HAL by Olivier Van den Eede (https://github.com/4ilo/HD44
 */
 
 
-#include <stdio.h>
 #include <string.h>
 
 #include "daisy_core.h"
 #include "sys/system.h"
+#include "util/StringFormat.h"
 
 #include "lcd_hd44780.h"
 
@@ -120,8 +120,8 @@ void LcdHD44780::Print(const char* string)
 
 void LcdHD44780::PrintInt(int number)
 {
-    char buffer[11];
-    sprintf(buffer, "%d", number);
+    char buffer[12];
+    FormatString(buffer, sizeof(buffer), "%d", number);
 
     Print(buffer);
 }
@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include "per/i2c.h"
 #include "per/gpio.h"
+#include "sys/system.h"
+#include "util/color.h"
 
 namespace daisy
 {
@@ -15,6 +17,13 @@ namespace daisy
  * It includes gamma correction from 8bit brightness values but it 
  * can also be supplied with raw 12bit values.
  * This driver uses two buffers - one for drawing, one for transmitting.
+ * Only the channels that changed since the last transmission are sent, in
+ * runs of consecutive registers, and drivers without changes are skipped.
+ * SwapBuffersAndTransmit() waits for the last frame to be out. Instead,
+ * QueueFrame() leaves a finished frame in the draw buffer, to be sent by
+ * Process() once the last one is out and the interval set with
+ * SetMaxFrameRate() is over, so drawing never waits for the I2C and the
+ * latest frame wins.
  * Multiple LedDriverPca9685 instances can be used at the same time.
  * \param numDrivers    The number of PCA9685 driver attached to the I2C
  *                      peripheral.
@@ -75,6 +84,13 @@ class LedDriverPca9685
         for(int d = 0; d < numDrivers; d++)
             addresses_[d] = addresses[d];
         current_driver_idx_ = -1;
+        patched_byte_       = nullptr;
+        // the chips start with all leds off, the first frame goes out whole
+        resend_all_         = true;
+        frame_pending_      = false;
+        frame_interval_us_  = 0;
+        num_frames_sent_    = 0;
+        num_frames_dropped_ = 0;
 
         InitializeBuffers();
         InitializeDrivers();
@@ -94,7 +110,7 @@ class LedDriverPca9685
     /** Sets all leds to a gamma corrected brightness between 0 and 255. */
     void SetAllTo(uint8_t brightness)
     {
-        const uint16_t cycles = gamma_table_[brightness];
+        const uint16_t cycles = Gamma12(brightness);
         SetAllToRaw(cycles);
     }
 
@@ -116,7 +132,7 @@ class LedDriverPca9685
     /** Sets a single led to a gamma corrected brightness between 0 and 255. */
     void SetLed(int ledIndex, uint8_t brightness)
     {
-        const uint16_t cycles = gamma_table_[brightness];
+        const uint16_t cycles = Gamma12(brightness);
         SetLedRaw(ledIndex, cycles);
     }
 
@@ -135,58 +151,184 @@ class LedDriverPca9685
             draw_buffer_[d].leds[ch].on = on; // clear "full on" bit
     }
 
+    /** Returns true while the last frame is still being transmitted, when
+     *  SwapBuffersAndTransmit() would wait for it, and Process() would
+     *  leave the frame of QueueFrame() pending
+     */
+    bool IsTransmitting() const { return current_driver_idx_ >= 0; }
+
+    /** Limits how often Process() sends frames, to leave the I2C bus to
+     *  its other devices. Frames finished in between stay pending.
+     *  \param frames_per_second the highest frame rate, 0 for no limit
+     */
+    void SetMaxFrameRate(float frames_per_second)
+    {
+        frame_interval_us_
+            = frames_per_second > 0.f ? uint32_t(1e6f / frames_per_second)
+                                      : 0;
+    }
+
+    /** Marks the draw buffer as a finished frame, to be sent by Process().
+     *  A frame that is still waiting is replaced by it, the changes drawn
+     *  since are all in the same buffer.
+     */
+    void QueueFrame()
+    {
+        if(frame_pending_)
+            num_frames_dropped_++;
+        frame_pending_ = true;
+    }
+
+    /** Starts sending the frame of QueueFrame(), once the last one is out
+     *  and the frame interval is over. Nothing else sends a pending frame,
+     *  so call it regularly, e.g. from the main loop or a timer, until
+     *  IsFramePending() is false.
+     *  \return true if it started sending a frame
+     */
+    bool Process()
+    {
+        if(!frame_pending_ || current_driver_idx_ >= 0)
+            return false;
+        const uint32_t now = System::GetUs();
+        if(num_frames_sent_ > 0 && now - last_frame_us_ < frame_interval_us_)
+            return false;
+        frame_pending_ = false;
+        last_frame_us_ = now;
+        num_frames_sent_++;
+        StartTransmission();
+        return true;
+    }
+
+    /** Returns true while a frame waits to be sent by Process() */
+    bool IsFramePending() const { return frame_pending_; }
+
+    /** Returns the number of frames started since Init() */
+    uint32_t GetNumFramesSent() const { return num_frames_sent_; }
+
+    /** Returns the number of queued frames replaced by a later one */
+    uint32_t GetNumFramesDropped() const { return num_frames_dropped_; }
+
     /** Swaps the current draw buffer and the current transmit buffer and
-     *  starts transmitting the values to all chips.
+     *  starts transmitting the values to all chips. Waits for the last
+     *  frame to be out, the frame rate limit doesn't apply. A frame of
+     *  QueueFrame() is sent along, as it's in the same buffer.
      */
     void SwapBuffersAndTransmit()
     {
         // wait for current transmission to complete
         while(current_driver_idx_ >= 0) {};
 
+        frame_pending_ = false;
+        last_frame_us_ = System::GetUs();
+        num_frames_sent_++;
+        StartTransmission();
+    }
+
+  private:
+    /** Swaps the current draw buffer and the current transmit buffer and
+     *  starts transmitting the values that changed to the chips.
+     */
+    void StartTransmission()
+    {
         // swap buffers
         auto tmp         = transmit_buffer_;
         transmit_buffer_ = draw_buffer_;
         draw_buffer_     = tmp;
 
+        // the draw buffer now holds what the chips were sent last
+        for(int d = 0; d < numDrivers; d++)
+        {
+            uint16_t changed = 0;
+            for(int ch = 0; ch < 16; ch++)
+            {
+                if(resend_all_
+                   || transmit_buffer_[d].leds[ch].on
+                          != draw_buffer_[d].leds[ch].on
+                   || transmit_buffer_[d].leds[ch].off
+                          != draw_buffer_[d].leds[ch].off)
+                    changed |= 1 << ch;
+            }
+            changed_channels_[d] = changed;
+        }
+        resend_all_ = false;
+
         // copy current transmit buffer contents to the new draw buffer
         // to keep the led settings (if required)
         if(persistentBufferContents)
         {
             for(int d = 0; d < numDrivers; d++)
                 for(int ch = 0; ch < 16; ch++)
-                    draw_buffer_[d].leds[ch].off
-                        = transmit_buffer_[d].leds[ch].off;
+                    draw_buffer_[d].leds[ch] = transmit_buffer_[d].leds[ch];
         }
 
         // start transmission
-        current_driver_idx_ = -1;
+        current_driver_idx_ = 0;
+        next_channel_       = 0;
         ContinueTransmission();
     }
 
-  private:
+    /** Sends the next run of changed channels, or ends the transmission */
     void ContinueTransmission()
     {
-        current_driver_idx_ = current_driver_idx_ + 1;
-        if(current_driver_idx_ >= numDrivers)
+        RestorePatchedByte();
+
+        int d = current_driver_idx_;
+        while(d < numDrivers && (changed_channels_[d] >> next_channel_) == 0)
+        {
+            d++;
+            next_channel_ = 0;
+        }
+        if(d >= numDrivers)
         {
             current_driver_idx_ = -1;
             return;
         }
+        current_driver_idx_ = d;
+
+        const uint16_t changed = changed_channels_[d];
+        int            first   = next_channel_;
+        while((changed & (1 << first)) == 0)
+            first++;
+        int last = first;
+        while(last < 15 && (changed & (1 << (last + 1))))
+            last++;
+        next_channel_ = last + 1;
 
-        const auto    d       = current_driver_idx_;
-        const uint8_t address = PCA9685_I2C_BASE_ADDRESS | addresses_[d];
-        const auto    status  = i2c_.TransmitDma(address,
-                                             (uint8_t*)&transmit_buffer_[d],
-                                             PCA9685TransmitBuffer::size,
-                                             &TxCpltCallback,
-                                             this);
+        // The register address is sent right before the first channel of
+        // the run. Past channel 0 it takes the place of the last byte of
+        // the channel before, which is put back when the run is done.
+        uint8_t* data = (uint8_t*)&transmit_buffer_[d].leds[first] - 1;
+        if(first > 0)
+        {
+            patched_byte_  = data;
+            patched_value_ = *data;
+            *data          = PCA9685_LED0 + 4 * first;
+        }
+
+        const uint8_t  address = PCA9685_I2C_BASE_ADDRESS | addresses_[d];
+        const uint16_t size    = 1 + 4 * (last - first + 1);
+        const auto     status  = i2c_.TransmitDma(
+            address, data, size, &TxCpltCallback, this);
         if(status != I2CHandle::Result::OK)
         {
-            // TODO: fix this :-)
-            // Reinit I2C (probably a flag to kill, but hey this works fairly well for now.)
+            // Reinit I2C, and send everything with the next frame, as it's
+            // unknown what the chips received
+            RestorePatchedByte();
             i2c_.Init(i2c_.GetConfig());
+            resend_all_         = true;
+            current_driver_idx_ = -1;
+        }
+    }
+
+    void RestorePatchedByte()
+    {
+        if(patched_byte_ != nullptr)
+        {
+            *patched_byte_ = patched_value_;
+            patched_byte_  = nullptr;
         }
     }
+
     uint16_t GetStartCycleForLed(int ledIndex) const
     {
         return (ledIndex << 2) & 0x0FFF; // shift each led by 4 cycles
@@ -279,29 +421,22 @@ class LedDriverPca9685
     dsy_gpio               oe_pin_gpio_;
     // index of the dirver that is currently updated.
     volatile int8_t current_driver_idx_;
-    const uint16_t  gamma_table_[256] = {
-        0,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        2,    2,    2,    2,    2,    2,    2,    3,    3,    4,    4,    5,
-        5,    6,    7,    8,    8,    9,    10,   11,   12,   13,   15,   16,
-        17,   18,   20,   21,   23,   25,   26,   28,   30,   32,   34,   36,
-        38,   40,   43,   45,   48,   50,   53,   56,   59,   62,   65,   68,
-        71,   75,   78,   82,   85,   89,   93,   97,   101,  105,  110,  114,
-        119,  123,  128,  133,  138,  143,  149,  154,  159,  165,  171,  177,
-        183,  189,  195,  202,  208,  215,  222,  229,  236,  243,  250,  258,
-        266,  273,  281,  290,  298,  306,  315,  324,  332,  341,  351,  360,
-        369,  379,  389,  399,  409,  419,  430,  440,  451,  462,  473,  485,
-        496,  508,  520,  532,  544,  556,  569,  582,  594,  608,  621,  634,
-        648,  662,  676,  690,  704,  719,  734,  749,  764,  779,  795,  811,
-        827,  843,  859,  876,  893,  910,  927,  944,  962,  980,  998,  1016,
-        1034, 1053, 1072, 1091, 1110, 1130, 1150, 1170, 1190, 1210, 1231, 1252,
-        1273, 1294, 1316, 1338, 1360, 1382, 1404, 1427, 1450, 1473, 1497, 1520,
-        1544, 1568, 1593, 1617, 1642, 1667, 1693, 1718, 1744, 1770, 1797, 1823,
-        1850, 1877, 1905, 1932, 1960, 1988, 2017, 2045, 2074, 2103, 2133, 2162,
-        2192, 2223, 2253, 2284, 2315, 2346, 2378, 2410, 2442, 2474, 2507, 2540,
-        2573, 2606, 2640, 2674, 2708, 2743, 2778, 2813, 2849, 2884, 2920, 2957,
-        2993, 3030, 3067, 3105, 3143, 3181, 3219, 3258, 3297, 3336, 3376, 3416,
-        3456, 3496, 3537, 3578, 3619, 3661, 3703, 3745, 3788, 3831, 3874, 3918,
-        3962, 4006, 4050, 4095};
+    // first channel of the next run of the current driver
+    int8_t next_channel_;
+    // channels of each driver that differ from the last transmission
+    uint16_t changed_channels_[numDrivers];
+    // byte of the transmit buffer replaced by the register address
+    uint8_t* patched_byte_;
+    uint8_t  patched_value_;
+    // whether the next frame sends all channels
+    bool resend_all_;
+    // whether the draw buffer holds a frame for Process()
+    volatile bool frame_pending_;
+    // shortest time between the starts of two frames, 0 for no limit
+    uint32_t frame_interval_us_;
+    uint32_t last_frame_us_;
+    uint32_t num_frames_sent_;
+    uint32_t num_frames_dropped_;
 
     static constexpr uint8_t PCA9685_I2C_BASE_ADDRESS = 0b01000000;
     static constexpr uint8_t PCA9685_MODE1
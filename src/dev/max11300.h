@@ -4,7 +4,11 @@
 
 #include "daisy_core.h"
 #include "per/spiMultislave.h"
+#include "per/tim.h"
 #include "sys/system.h"
+#include "util/scopedirqblocker.h"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 
 
@@ -262,6 +266,12 @@ class MAX11300MultiSlaveSpiTransport
  * which are not exposed, as well as a number of configuration decisions 
  * that were made in order to simplify usage and improve ergonomics, 
  * even at the cost of flexibility.
+ *
+ * The ADC and GPI values are double buffered: an update fills the back
+ * buffer, and the buffers are swapped when all devices have been read, so
+ * all values read at once, e.g. in the audio callback, are from the same
+ * update. The DAC and GPO values are taken from all devices at the start
+ * of an update, so values written at once are sent together.
 */
 template <typename Transport, size_t num_devices>
 class MAX11300Driver
@@ -273,6 +283,18 @@ class MAX11300Driver
         void Defaults() { transport_config = decltype(transport_config){}; }
     };
 
+    /**
+     * The values of the ANALOG_IN (ADC) pins of all MAX11300s, all from the
+     * same update, see GetSnapshot()
+     */
+    struct Snapshot
+    {
+        /** raw 12 bit values, 0 for the pins that aren't ANALOG_IN */
+        uint16_t raw[num_devices][20];
+        /** GetUpdateCount() of the update the values are from */
+        uint32_t update;
+    };
+
     MAX11300Driver(){};
     ~MAX11300Driver(){};
 
@@ -294,6 +316,10 @@ class MAX11300Driver
         update_complete_callback_         = nullptr;
         update_complete_callback_context_ = nullptr;
         run_                              = false;
+        timed_                            = false;
+        input_bank_                       = 0;
+        overruns_                         = 0;
+        updates_                          = 0;
 
         if(transport_.Init(config.transport_config) != Transport::Result::OK)
             return MAX11300Types::Result::ERR;
@@ -448,12 +474,23 @@ class MAX11300Driver
     uint16_t ReadAnalogPinRaw(size_t device_index, MAX11300Types::Pin pin) const
     {
         auto& device = devices_[device_index];
+        auto& config = device.pin_configurations_[pin];
 
-        if(device.pin_configurations_[pin].value == nullptr)
+        if(config.value == nullptr)
         {
             return 0;
         }
-        return __builtin_bswap16(*device.pin_configurations_[pin].value);
+        if(config.mode == PinMode::ANALOG_IN)
+        {
+            // value points into the first bank, read the same place in the
+            // bank of the last complete update
+            const size_t offset = reinterpret_cast<const uint8_t*>(config.value)
+                                  - device.adc_buffer_[0];
+            uint16_t raw;
+            memcpy(&raw, &device.adc_buffer_[input_bank_][offset], sizeof(raw));
+            return __builtin_bswap16(raw);
+        }
+        return __builtin_bswap16(*config.value);
     }
 
     /**
@@ -473,6 +510,77 @@ class MAX11300Driver
             device.pin_configurations_[pin].range.adc);
     }
 
+    /**
+     * Copies the values of all ANALOG_IN (ADC) pins of the last complete
+     * update. They are consistent, also when an update completes while
+     * they're copied, the copy is simply repeated then. Takes well under a
+     * microsecond per device, so it can be called from the audio callback.
+     *
+     * \param snapshot - Set to the values of all pins
+     */
+    void GetSnapshot(Snapshot& snapshot) const
+    {
+        uint32_t update;
+        do
+        {
+            update = updates_;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            const uint8_t bank = input_bank_;
+            for(size_t d = 0; d < num_devices; d++)
+            {
+                const Device& device = devices_[d];
+                for(size_t i = 0; i < 20; i++)
+                {
+                    // big endian, after the address byte
+                    const uint8_t  idx = device.adc_index_[i];
+                    const uint8_t* raw = &device.adc_buffer_[bank][idx];
+                    snapshot.raw[d][i]
+                        = idx == 0 ? 0 : uint16_t((raw[0] << 8) | raw[1]);
+                }
+            }
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while(update != updates_);
+        snapshot.update = update;
+    }
+
+    /**
+     * Converts the values of a snapshot to volts, each with the range of
+     * its pin. The scale of each pin is computed when it's configured, so
+     * this is a multiply and an add per pin.
+     *
+     * \param snapshot - The values of GetSnapshot()
+     * \param volts - Set to the voltage of each pin, 0 if it isn't ANALOG_IN
+     */
+    void SnapshotToVolts(const Snapshot& snapshot,
+                         float (&volts)[num_devices][20]) const
+    {
+        for(size_t d = 0; d < num_devices; d++)
+        {
+            const Device& device = devices_[d];
+            for(size_t i = 0; i < 20; i++)
+                volts[d][i] = snapshot.raw[d][i] * device.adc_scale_[i]
+                              + device.adc_offset_[i];
+        }
+    }
+
+    /**
+     * Reads the voltages of all ANALOG_IN (ADC) pins of all MAX11300s, all
+     * from the same update
+     *
+     * \param volts - Set to the voltage of each pin, 0 if it isn't ANALOG_IN
+     * \return - GetUpdateCount() of the update the values are from
+     */
+    uint32_t ReadAnalogPinsVolts(float (&volts)[num_devices][20]) const
+    {
+        Snapshot snapshot;
+        GetSnapshot(snapshot);
+        SnapshotToVolts(snapshot, volts);
+        return snapshot.update;
+    }
+
+    /** Returns the number of updates that completed since Init() */
+    uint32_t GetUpdateCount() const { return updates_; }
+
     /**
      * Write a raw 12 bit (0-4095) value to a given ANALOG_OUT (DAC) pin
      * 
@@ -526,19 +634,20 @@ class MAX11300Driver
      */
     bool ReadDigitalPin(size_t device_index, MAX11300Types::Pin pin) const
     {
-        auto& device = devices_[device_index];
+        auto&          device = devices_[device_index];
+        const uint8_t* gpi    = device.gpi_buffer_[input_bank_];
 
         if(pin > MAX11300Types::Pin::PIN_15)
         {
-            return static_cast<bool>((device.gpi_buffer_[4] >> (pin - 16)) & 1);
+            return static_cast<bool>((gpi[4] >> (pin - 16)) & 1);
         }
         else if(pin > MAX11300Types::Pin::PIN_7)
         {
-            return static_cast<bool>((device.gpi_buffer_[1] >> (pin - 8)) & 1);
+            return static_cast<bool>((gpi[1] >> (pin - 8)) & 1);
         }
         else
         {
-            return static_cast<bool>((device.gpi_buffer_[2] >> pin) & 1);
+            return static_cast<bool>((gpi[2] >> pin) & 1);
         }
     }
 
@@ -631,8 +740,75 @@ class MAX11300Driver
         return MAX11300Types::Result::OK;
     }
 
+    /**
+     * Starts to update and synchronize the MAX11300s at a fixed rate, from
+     * the interrupt of a timer, instead of starting the next update as soon
+     * as one has completed. An update that is still running when the timer
+     * fires is completed, the one that was due is skipped and counted by
+     * GetOverrunCount().
+     *
+     * \param periph The timer to use, not TIM_2, which System uses, nor one
+     *               used by e.g. an InputService
+     * \param update_rate Updates per second, e.g. 1000
+     * \param complete_callback An optional callback function that's called after each successful update
+     *                          Keep this callback function simple and fast, it's called from an interrupt.
+     * \param complete_callback_context An optional context pointer provided to the complete_callback
+     * \return ERR if the timer can't run at the update rate
+     */
+    MAX11300Types::Result StartTimed(
+        TimerHandle::Config::Peripheral                  periph,
+        float                                            update_rate,
+        MAX11300Types::UpdateCompleteCallbackFunctionPtr complete_callback
+        = nullptr,
+        void* complete_callback_context = nullptr)
+    {
+        Stop();
+        update_complete_callback_         = complete_callback;
+        update_complete_callback_context_ = complete_callback_context;
+        if(!StartTimer(periph, update_rate))
+            return MAX11300Types::Result::ERR;
+        timed_ = true;
+        return MAX11300Types::Result::OK;
+    }
+
+    /**
+     * Starts a single update of all MAX11300s, e.g. from a timer interrupt
+     * of the application. The complete_callback of the last Start() or
+     * StartTimed() is called when it has completed.
+     *
+     * \return ERR if the previous update is still running
+     */
+    MAX11300Types::Result Trigger()
+    {
+        {
+            ScopedIrqBlocker block;
+            if(sequencer_.IsBusy())
+            {
+                overruns_++;
+                return MAX11300Types::Result::ERR;
+            }
+            sequencer_.current_device_ = 0;
+            sequencer_.current_step_   = UpdateSequencer::first_step_;
+        }
+        ContinueUpdate();
+        return MAX11300Types::Result::OK;
+    }
+
+    /** Returns the number of timed updates that were skipped because the
+     *  update before was still running
+     */
+    uint32_t GetOverrunCount() const { return overruns_; }
+
     /** Call this to stop the auto updating, but complete the current update. */
-    void Stop() { run_ = false; }
+    void Stop()
+    {
+        run_ = false;
+        if(timed_)
+        {
+            StopTimer();
+            timed_ = false;
+        }
+    }
 
     /**
      * A utility funtion for converting a voltage (float) value, bound to a given
@@ -869,11 +1045,16 @@ class MAX11300Driver
         std::memset(device.adc_buffer_, 0, sizeof(device.adc_buffer_));
         std::memset(device.gpi_buffer_, 0, sizeof(device.gpi_buffer_));
         std::memset(device.gpo_buffer_, 0, sizeof(device.gpo_buffer_));
+        std::memset(device.dac_frame_, 0, sizeof(device.dac_frame_));
+        std::memset(device.gpo_frame_, 0, sizeof(device.gpo_frame_));
 
         device.dac_pin_count_ = 0;
         device.adc_pin_count_ = 0;
         device.gpi_pin_count_ = 0;
         device.gpo_pin_count_ = 0;
+        std::memset(device.adc_index_, 0, sizeof(device.adc_index_));
+        std::fill(device.adc_scale_, device.adc_scale_ + 20, 0.f);
+        std::fill(device.adc_offset_, device.adc_offset_ + 20, 0.f);
 
         for(uint8_t i = 0; i <= MAX11300Types::Pin::PIN_19; i++)
         {
@@ -910,10 +1091,18 @@ class MAX11300Driver
                         = ((MAX11300_ADCDAT_BASE + pin) << 1) | 1;
                 }
                 // set the pin_config.value to a pointer at the appropriate
-                // index of the adc_buffer...
+                // index of the first bank of the adc_buffer...
+                const size_t idx = (2 * device.adc_pin_count_) - 1;
                 device.pin_configurations_[i].value
-                    = reinterpret_cast<uint16_t*>(
-                        &device.adc_buffer_[(2 * device.adc_pin_count_) - 1]);
+                    = reinterpret_cast<uint16_t*>(&device.adc_buffer_[0][idx]);
+
+                // for GetSnapshot() and SnapshotToVolts()
+                const auto  range  = device.pin_configurations_[i].range.adc;
+                const float offset = TwelveBitUintToVolts(0, range);
+                device.adc_index_[i]  = idx;
+                device.adc_offset_[i] = offset;
+                device.adc_scale_[i]
+                    = (TwelveBitUintToVolts(4095, range) - offset) / 4095.f;
             }
             else if(device.pin_configurations_[i].mode == PinMode::GPI)
             {
@@ -938,6 +1127,66 @@ class MAX11300Driver
 #endif
     }
 
+    // Wrappers for the timer of StartTimed(), excluded from the unit tests
+    bool StartTimer(TimerHandle::Config::Peripheral periph, float rate)
+    {
+#ifndef UNIT_TEST
+        if(rate <= 0.f || periph == TimerHandle::Config::Peripheral::TIM_2)
+            return false;
+        // TIM3 and TIM4 only count to 16 bits, the prescaler makes up the rest
+        const bool is_32bit
+            = periph == TimerHandle::Config::Peripheral::TIM_5;
+        const float    ticks     = System::GetPClk1Freq() * 2.f / rate;
+        const float    max_ticks = is_32bit ? 4294967296.f : 65536.f;
+        const uint32_t prescaler = uint32_t(ticks / max_ticks);
+        if(ticks < 2.f || prescaler > 0xffff)
+            return false;
+
+        TimerHandle::Config tim_cfg;
+        tim_cfg.periph     = periph;
+        tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+        tim_cfg.period     = uint32_t(ticks / (prescaler + 1) + 0.5f) - 1;
+        tim_cfg.enable_irq = true;
+        if(timer_.Init(tim_cfg) != TimerHandle::Result::OK)
+            return false;
+        timer_.SetPrescaler(prescaler);
+        timer_.SetCallback(TimerCallback, this);
+        return timer_.Start() == TimerHandle::Result::OK;
+#else
+        (void)periph;
+        (void)rate;
+        return false;
+#endif
+    }
+
+    void StopTimer()
+    {
+#ifndef UNIT_TEST
+        timer_.Stop();
+#endif
+    }
+
+    static void TimerCallback(void* context)
+    {
+        static_cast<MAX11300Driver*>(context)->Trigger();
+    }
+
+    /** Takes the DAC and GPO values of all devices for the update */
+    void BeginFrame()
+    {
+        ScopedIrqBlocker block;
+        for(size_t i = 0; i < num_devices; i++)
+        {
+            auto& device = devices_[i];
+            memcpy(device.dac_frame_,
+                   device.dac_buffer_,
+                   sizeof(device.dac_frame_));
+            memcpy(device.gpo_frame_,
+                   device.gpo_buffer_,
+                   sizeof(device.gpo_frame_));
+        }
+    }
+
     /**
      * Read the value of a single register address from the MAX11300
      * \param address - the register address to read
@@ -1054,6 +1303,7 @@ class MAX11300Driver
             case UpdateSequencer::Step::start:
                 sequencer_.current_device_ = 0;
                 sequencer_.current_step_   = UpdateSequencer::Step::updateDac;
+                BeginFrame();
                 break;
             case UpdateSequencer::Step::updateDac:
                 // nothing to read back; we only sent data
@@ -1065,7 +1315,8 @@ class MAX11300Driver
                 const size_t size
                     = (devices_[sequencer_.current_device_].adc_pin_count_ * 2)
                       + 1;
-                memcpy(devices_[sequencer_.current_device_].adc_buffer_,
+                memcpy(devices_[sequencer_.current_device_]
+                           .adc_buffer_[input_bank_ ^ 1],
                        dma_buffer_->rx_buffer,
                        size);
                 sequencer_.current_step_ = UpdateSequencer::Step::updateGpo;
@@ -1078,9 +1329,10 @@ class MAX11300Driver
             case UpdateSequencer::Step::updateGpi:
             {
                 // read back rx data
-                const size_t size
-                    = sizeof(devices_[sequencer_.current_device_].gpi_buffer_);
-                memcpy(devices_[sequencer_.current_device_].gpi_buffer_,
+                const size_t size = sizeof(
+                    devices_[sequencer_.current_device_].gpi_buffer_[0]);
+                memcpy(devices_[sequencer_.current_device_]
+                           .gpi_buffer_[input_bank_ ^ 1],
                        dma_buffer_->rx_buffer,
                        size);
 
@@ -1095,6 +1347,9 @@ class MAX11300Driver
         {
             if(sequencer_.current_device_ >= num_devices)
             {
+                // all inputs were read, they become the current ones
+                input_bank_ ^= 1;
+                updates_ = updates_ + 1;
                 sequencer_.Invalidate();
                 if(update_complete_callback_)
                     update_complete_callback_(
@@ -1104,6 +1359,7 @@ class MAX11300Driver
                 {
                     sequencer_.current_device_ = 0;
                     sequencer_.current_step_ = UpdateSequencer::Step::updateDac;
+                    BeginFrame();
                 }
                 else
                     return; // all devices complete, no retriggering
@@ -1128,7 +1384,7 @@ class MAX11300Driver
                         // plus one byte for the initial pin address.
                         size_t tx_size = (device.dac_pin_count_ * 2) + 1;
                         memcpy(dma_buffer_->tx_buffer,
-                               device.dac_buffer_,
+                               device.dac_frame_,
                                tx_size);
                         transport_.TransmitDma(sequencer_.current_device_,
                                                dma_buffer_->tx_buffer,
@@ -1177,8 +1433,8 @@ class MAX11300Driver
                         // the GPO data register, and the subsequent 4 bytes containing the state of the
                         // GPO ports to be written.
                         memcpy(dma_buffer_->tx_buffer,
-                               device.gpo_buffer_,
-                               sizeof(device.gpo_buffer_));
+                               device.gpo_frame_,
+                               sizeof(device.gpo_frame_));
                         dma_buffer_->tx_buffer[0] = (MAX11300_GPODAT << 1);
                         transport_.TransmitDma(sequencer_.current_device_,
                                                dma_buffer_->tx_buffer,
@@ -1202,13 +1458,14 @@ class MAX11300Driver
                         // and only TX byte being the GPI register.
                         dma_buffer_->tx_buffer[0] = (MAX11300_GPIDAT << 1) | 1;
                         // clear the rest of the buffer (it may contain stuff from a previous transaction)
-                        for(size_t i = 1; i < sizeof(device.gpi_buffer_); i++)
+                        for(size_t i = 1; i < sizeof(device.gpi_buffer_[0]);
+                            i++)
                             dma_buffer_->tx_buffer[i] = 0x00;
                         transport_.TransmitAndReceiveDma(
                             sequencer_.current_device_,
                             dma_buffer_->tx_buffer,
                             dma_buffer_->rx_buffer,
-                            sizeof(device.gpi_buffer_),
+                            sizeof(device.gpi_buffer_[0]),
                             &DmaCompleteCallback,
                             this);
                         done = true;
@@ -1250,10 +1507,15 @@ class MAX11300Driver
         uint8_t   gpi_pin_count_;
         uint8_t   gpo_pin_count_;
         uint8_t   dac_buffer_[41];
+        uint8_t   dac_frame_[41];
         uint8_t   adc_first_adress;
-        uint8_t   adc_buffer_[41];
-        uint8_t   gpi_buffer_[5];
+        uint8_t   adc_buffer_[2][41];
+        uint8_t   gpi_buffer_[2][5];
         uint8_t   gpo_buffer_[5];
+        uint8_t   gpo_frame_[5];
+        uint8_t   adc_index_[20]; /**< of each pin in adc_buffer_, or 0 */
+        float     adc_scale_[20];
+        float     adc_offset_[20];
     };
     Device devices_[num_devices];
 
@@ -1284,6 +1546,12 @@ class MAX11300Driver
     MAX11300Types::UpdateCompleteCallbackFunctionPtr update_complete_callback_;
     void* update_complete_callback_context_;
     bool  run_;
+
+    TimerHandle       timer_;
+    bool              timed_;
+    volatile uint8_t  input_bank_;
+    volatile uint32_t overruns_;
+    volatile uint32_t updates_;
 };
 template <size_t num_devices = 1>
 using MAX11300
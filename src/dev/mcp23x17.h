@@ -68,7 +68,7 @@ enum class MCPMode : uint8_t
 
 /**
  * Barebones driver for MCP23017 I2C 16-Bit I/O Expander
- * For now it supports only polling approach.
+ * Process() reads the pins after an interrupt-on-change, or polls them.
  * 
  * Usage:
  *  Mcp23017 mcp;
@@ -141,18 +141,83 @@ class Mcp23017Transport
         portB = data[1];
     }
 
+    /** Reads consecutive registers in one transaction */
+    I2CHandle::Result ReadRegs(MCPRegister reg, uint8_t* data, uint16_t size)
+    {
+        return i2c_.ReadDataAtAddress(
+            i2c_address_, static_cast<uint8_t>(reg), 1, data, size, timeout);
+    }
+
+    /**
+     * Reads consecutive registers with the DMA. The buffer must be in DMA
+     * memory, buffer[0] takes the register address and the data arrives at
+     * buffer + 1. The callback is called from an interrupt.
+     */
+    I2CHandle::Result ReadRegsDma(MCPRegister                    reg,
+                                  uint8_t*                       buffer,
+                                  uint16_t                       size,
+                                  I2CHandle::CallbackFunctionPtr callback,
+                                  void*                          context)
+    {
+        buffer[0]     = static_cast<uint8_t>(reg);
+        dma_buffer_   = buffer;
+        dma_size_     = size;
+        dma_callback_ = callback;
+        dma_context_  = context;
+        return i2c_.TransmitDma(
+            i2c_address_ >> 1, buffer, 1, DmaWriteDone, this);
+    }
+
     daisy::I2CHandle i2c_;
     uint8_t          i2c_address_;
     uint8_t          timeout{10};
+
+  private:
+    static void DmaWriteDone(void* context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<Mcp23017Transport*>(context);
+        if(result == I2CHandle::Result::OK)
+            result = transport->i2c_.ReceiveDma(transport->i2c_address_ >> 1,
+                                                transport->dma_buffer_ + 1,
+                                                transport->dma_size_,
+                                                transport->dma_callback_,
+                                                transport->dma_context_);
+        if(result != I2CHandle::Result::OK)
+            transport->dma_callback_(transport->dma_context_, result);
+    }
+
+    uint8_t*                       dma_buffer_;
+    uint16_t                       dma_size_;
+    I2CHandle::CallbackFunctionPtr dma_callback_;
+    void*                          dma_context_;
 };
 
 template <typename Transport>
 class Mcp23X17
 {
   public:
+    /** Bytes of the read of INTF, INTCAP and GPIO of both ports */
+    static constexpr size_t kReadSize = 6;
+
+    /** Size of Config::dma_buffer, the register address and the data */
+    static constexpr size_t kDmaBufferSize = 1 + kReadSize;
+
     struct Config
     {
         typename Transport::Config transport_config;
+
+        /**
+         * INTA and INTB outputs, so that Process() only reads after a
+         * change. Without INTB, INTA signals the changes of both ports.
+         * Both can stay unset to read with every Process().
+         */
+        Pin int_a;
+        Pin int_b;
+
+        /** kDmaBufferSize bytes in DMA memory, nullptr for blocking reads */
+        uint8_t* dma_buffer;
+
+        Config() : dma_buffer(nullptr) {}
     };
 
     void Init()
@@ -164,16 +229,26 @@ class Mcp23X17
 
     void Init(const Config& config)
     {
+        config_    = config;
+        dma_state_ = DmaState::IDLE;
+        refresh_   = true;
+        int_flags_ = 0;
+        captured_  = 0;
         transport.Init(config.transport_config);
+        if(config.int_a.IsValid())
+            int_a_.Init(config.int_a, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
+        if(config.int_b.IsValid())
+            int_b_.Init(config.int_b, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
 
         //BANK =     0 : sequential register addresses
-        //MIRROR =     0 : use configureInterrupt
-        //SEQOP =     1 : sequential operation disabled, address pointer does not increment
+        //MIRROR =     1 : without INTB, INTA signals both ports
+        //SEQOP =     0 : sequential operation, for the reads of Process()
         //DISSLW =     0 : slew rate enabled
         //HAEN =     0 : hardware address pin is always enabled on 23017
         //ODR =     0 : open drain output
         //INTPOL =     0 : interrupt active low
-        transport.WriteReg(MCPRegister::IOCON, 0b00100000);
+        transport.WriteReg(MCPRegister::IOCON,
+                           config.int_b.IsValid() ? 0b00000000 : 0b01000000);
 
         //enable all pull up resistors (will be effective for input pins only)
         transport.WriteReg(MCPRegister::GPPU_A, 0xFF, 0xFF);
@@ -365,7 +440,114 @@ class Mcp23X17
      */
     uint8_t GetPin(uint8_t id) { return ReadBit(pin_data, id); }
 
+    /**
+     * Enables the interrupt-on-change of input pins, against their
+     * previous value, for Config::int_a and Config::int_b.
+     * Pin 0-7 for port A, 8-15 for port B.
+     *
+     * See "3.5.3 Interrupt-on-change control register".
+     */
+    void EnableInterrupts(uint16_t pins = 0xFFFF)
+    {
+        transport.WriteReg(MCPRegister::INTCON_A, 0x00, 0x00);
+        transport.WriteReg(
+            MCPRegister::GPINTEN_A, LowByte(pins), HighByte(pins));
+        refresh_ = true;
+    }
+
+    /**
+     * Reads the interrupt flags, the values captured at the interrupt and
+     * the pins of both ports in one transaction, which also clears the
+     * interrupt. With interrupt pins that only happens after a change,
+     * and with a DMA buffer the values arrive with a later call.
+     * Call it in the main loop.
+     *
+     * @return true if GetPin() and the captured values were updated
+     */
+    bool Process()
+    {
+        bool updated = false;
+        if(dma_state_ == DmaState::DONE)
+        {
+            Decode(config_.dma_buffer + 1);
+            dma_state_ = DmaState::IDLE;
+            updated    = true;
+        }
+        else if(dma_state_ == DmaState::FAILED)
+        {
+            dma_state_ = DmaState::IDLE;
+        }
+        if(dma_state_ != DmaState::IDLE || !InterruptPending())
+            return updated;
+
+        refresh_ = false;
+        if(config_.dma_buffer == nullptr)
+        {
+            uint8_t data[kReadSize];
+            if(transport.ReadRegs(MCPRegister::INTF_A, data, kReadSize)
+               != I2CHandle::Result::OK)
+                return updated;
+            Decode(data);
+            return true;
+        }
+
+        dma_state_ = DmaState::BUSY;
+        if(transport.ReadRegsDma(MCPRegister::INTF_A,
+                                 config_.dma_buffer,
+                                 kReadSize,
+                                 ReadDone,
+                                 this)
+           != I2CHandle::Result::OK)
+            dma_state_ = DmaState::FAILED;
+        return updated;
+    }
+
+    /**
+     * The pins that caused the interrupt of the last Process() read, port
+     * A in the low byte. See "3.5.8 Interrupt flag register".
+     */
+    uint16_t GetInterruptFlags() const { return int_flags_; }
+
+    /**
+     * The pins at the time of that interrupt, which keeps presses that
+     * were released again before the read. See "3.5.9 Interrupt captured
+     * register".
+     */
+    uint16_t GetCapturedPins() const { return captured_; }
+
   private:
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
+    bool InterruptPending()
+    {
+        if(refresh_
+           || (!config_.int_a.IsValid() && !config_.int_b.IsValid()))
+            return true;
+        return (config_.int_a.IsValid() && !int_a_.Read())
+               || (config_.int_b.IsValid() && !int_b_.Read());
+    }
+
+    /** Takes the values of a read from INTF_A */
+    void Decode(const uint8_t* data)
+    {
+        int_flags_ = data[0] | data[1] << 8;
+        captured_  = data[2] | data[3] << 8;
+        pin_data   = data[4] | data[5] << 8;
+    }
+
+    static void ReadDone(void* context, I2CHandle::Result result)
+    {
+        auto mcp        = static_cast<Mcp23X17*>(context);
+        mcp->dma_state_ = result == I2CHandle::Result::OK ? DmaState::DONE
+                                                          : DmaState::FAILED;
+    }
+
     uint8_t GetBit(uint8_t data, uint8_t id)
     {
         uint8_t mask     = 1 << id;
@@ -393,9 +575,22 @@ class Mcp23X17
     uint8_t LowByte(uint16_t val) { return val & 0xFF; }
     uint8_t HighByte(uint16_t val) { return (val >> 8) & 0xff; }
 
-    uint16_t  pin_data;
-    Transport transport;
+    uint16_t          pin_data;
+    Transport         transport;
+    Config            config_;
+    GPIO              int_a_;
+    GPIO              int_b_;
+    volatile DmaState dma_state_;
+    bool              refresh_;
+    uint16_t          int_flags_;
+    uint16_t          captured_;
 };
 
+template <typename Transport>
+constexpr size_t Mcp23X17<Transport>::kReadSize;
+
+template <typename Transport>
+constexpr size_t Mcp23X17<Transport>::kDmaBufferSize;
+
 using Mcp23017 = Mcp23X17<Mcp23017Transport>;
 } // namespace daisy
\ No newline at end of file
@@ -73,6 +73,30 @@ class Mpr121I2CTransport
                != i2c_.ReceiveBlocking(config_.dev_addr, data, size, 10);
     }
 
+    /** Starts a write with the DMA, data must be in DMA memory
+        \return true if error, false if ok */
+    bool WriteDma(uint8_t                       *data,
+                  uint16_t                       size,
+                  I2CHandle::CallbackFunctionPtr callback,
+                  void                          *callback_context)
+    {
+        return I2CHandle::Result::OK
+               != i2c_.TransmitDma(
+                   config_.dev_addr, data, size, callback, callback_context);
+    }
+
+    /** Starts a read with the DMA, data must be in DMA memory
+        \return true if error, false if ok */
+    bool ReadDma(uint8_t                       *data,
+                 uint16_t                       size,
+                 I2CHandle::CallbackFunctionPtr callback,
+                 void                          *callback_context)
+    {
+        return I2CHandle::Result::OK
+               != i2c_.ReceiveDma(
+                   config_.dev_addr, data, size, callback, callback_context);
+    }
+
   private:
     I2CHandle i2c_;
     Config    config_;
@@ -82,6 +106,22 @@ class Mpr121I2CTransport
 /** @brief Device support for MPR121 12x Capacitive Touch Sensor
     @author beserge
     @date December 2021
+
+    With the IRQ pin of the chip in the Config, Process() only reads when
+    the chip signals a changed touch status. The touch status and the
+    filtered data of all 12 electrodes are then read in one transaction,
+    with the DMA if a buffer in DMA memory is given, and kept for
+    GetTouched() and GetFilteredData().
+    @code
+    uint8_t DMA_BUFFER_MEM_SECTION mpr_buffer[Mpr121I2C::kDmaBufferSize];
+    Mpr121I2C::Config cfg;
+    cfg.irq_pin    = seed::D7;
+    cfg.dma_buffer = mpr_buffer;
+    mpr.Init(cfg);
+    while(1)
+        if(mpr.Process())
+            touched = mpr.GetTouched();
+    @endcode
 */
 template <typename Transport>
 class Mpr121
@@ -90,16 +130,32 @@ class Mpr121
     Mpr121() {}
     ~Mpr121() {}
 
+    /** Electrodes of the chip */
+    static constexpr uint8_t kNumChannels = 12;
+
+    /** Bytes read by Process(): touch status, out of range status, and the
+        filtered data of the electrodes */
+    static constexpr uint16_t kReadSize = 4 + 2 * kNumChannels;
+
+    /** Size of Config::dma_buffer, the register address and the data */
+    static constexpr size_t kDmaBufferSize = 1 + kReadSize;
+
     struct Config
     {
         typename Transport::Config transport_config;
         uint8_t                    touch_threshold;
         uint8_t                    release_threshold;
+        /** IRQ output of the chip, or Pin() to read with every Process() */
+        Pin irq_pin;
+        /** kDmaBufferSize bytes in DMA memory, nullptr for blocking reads */
+        uint8_t *dma_buffer;
 
         Config()
         {
             touch_threshold   = MPR121_TOUCH_THRESHOLD_DEFAULT;
             release_threshold = MPR121_RELEASE_THRESHOLD_DEFAULT;
+            irq_pin           = Pin();
+            dma_buffer        = nullptr;
         }
     };
 
@@ -114,7 +170,13 @@ class Mpr121
     */
     Result Init(Config config)
     {
-        config_ = config;
+        config_    = config;
+        dma_state_ = DmaState::IDLE;
+        touched_   = 0;
+        for(uint8_t i = 0; i < kNumChannels; i++)
+            filtered_[i] = 0;
+        if(config_.irq_pin.IsValid())
+            irq_.Init(config_.irq_pin, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
 
         SetTransportErr(transport_.Init(config_.transport_config));
 
@@ -224,6 +286,80 @@ class Mpr121
         return t & 0x0FFF;
     }
 
+    /** Read the filtered data of all 12 channels in one transaction.
+        \param data the 10 bit values, kNumChannels of them
+        \return ERR if the transaction failed
+    */
+    Result ReadFilteredData(uint16_t *data)
+    {
+        uint8_t reg = MPR121_FILTDATA_0L;
+        uint8_t buff[2 * kNumChannels];
+        SetTransportErr(transport_.Write(&reg, 1));
+        SetTransportErr(transport_.Read(buff, sizeof(buff)));
+        for(uint8_t i = 0; i < kNumChannels; i++)
+            data[i] = buff[2 * i] | (buff[2 * i + 1] << 8);
+        return GetTransportErr();
+    }
+
+    /** Reads the touch status and the filtered data when they changed, or
+        with every call without an IRQ pin. Call it in the main loop.
+        With a DMA buffer the read runs in the background, and its values
+        arrive with a later call.
+        \return true if GetTouched() and GetFilteredData() were updated
+    */
+    bool Process()
+    {
+        bool updated = false;
+        if(dma_state_ == DmaState::DONE)
+        {
+            Decode(config_.dma_buffer + 1);
+            dma_state_ = DmaState::IDLE;
+            updated    = true;
+        }
+        else if(dma_state_ == DmaState::FAILED)
+        {
+            SetTransportErr(true);
+            dma_state_ = DmaState::IDLE;
+        }
+
+        // the IRQ output is low until the touch status has been read
+        if(dma_state_ != DmaState::IDLE
+           || (config_.irq_pin.IsValid() && irq_.Read()))
+            return updated;
+
+        if(config_.dma_buffer == nullptr)
+        {
+            uint8_t buff[kReadSize];
+            uint8_t reg = MPR121_TOUCHSTATUS_L;
+            bool    err = transport_.Write(&reg, 1);
+            err         = err || transport_.Read(buff, kReadSize);
+            SetTransportErr(err);
+            if(!err)
+                Decode(buff);
+            return updated || !err;
+        }
+
+        dma_state_            = DmaState::BUSY;
+        config_.dma_buffer[0] = MPR121_TOUCHSTATUS_L;
+        if(transport_.WriteDma(config_.dma_buffer, 1, WriteDone, this))
+            dma_state_ = DmaState::FAILED;
+        return updated;
+    }
+
+    /** The touch status of the last Process() read, as in Touched() */
+    uint16_t GetTouched() const { return touched_; }
+
+    /** The filtered data of channel t of the last Process() read, as in
+        FilteredData() */
+    uint16_t GetFilteredData(uint8_t t) const
+    {
+        return t < kNumChannels ? filtered_[t] : 0;
+    }
+
+    /** Returns ERR if a transaction of Process() failed since the last
+        call */
+    Result GetProcessError() { return GetTransportErr(); }
+
     /** Read the contents of an 8 bit device register.
         \param      reg the register address to read from
         \returns    the 8 bit value that was read.
@@ -335,9 +471,45 @@ class Mpr121
     };
 
   private:
-    Config    config_;
-    Transport transport_;
-    bool      transport_error_;
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
+    /** Takes the values of a read from MPR121_TOUCHSTATUS_L */
+    void Decode(const uint8_t *buff)
+    {
+        touched_ = (buff[0] | (buff[1] << 8)) & 0x0FFF;
+        for(uint8_t i = 0; i < kNumChannels; i++)
+            filtered_[i] = buff[4 + 2 * i] | (buff[5 + 2 * i] << 8);
+    }
+
+    static void WriteDone(void *context, I2CHandle::Result result)
+    {
+        auto mpr = static_cast<Mpr121 *>(context);
+        if(result != I2CHandle::Result::OK
+           || mpr->transport_.ReadDma(
+               mpr->config_.dma_buffer + 1, kReadSize, ReadDone, mpr))
+            mpr->dma_state_ = DmaState::FAILED;
+    }
+
+    static void ReadDone(void *context, I2CHandle::Result result)
+    {
+        auto mpr        = static_cast<Mpr121 *>(context);
+        mpr->dma_state_ = result == I2CHandle::Result::OK ? DmaState::DONE
+                                                          : DmaState::FAILED;
+    }
+
+    Config            config_;
+    Transport         transport_;
+    bool              transport_error_;
+    GPIO              irq_;
+    volatile DmaState dma_state_;
+    uint16_t          touched_;
+    uint16_t          filtered_[kNumChannels];
 
     /** Set the global transport_error_ bool */
     void SetTransportErr(bool err) { transport_error_ |= err; }
@@ -352,6 +524,15 @@ class Mpr121
 
 }; // class
 
+template <typename Transport>
+constexpr uint8_t Mpr121<Transport>::kNumChannels;
+
+template <typename Transport>
+constexpr uint16_t Mpr121<Transport>::kReadSize;
+
+template <typename Transport>
+constexpr size_t Mpr121<Transport>::kDmaBufferSize;
+
 using Mpr121I2C = Mpr121<Mpr121I2CTransport>;
 
 /** @} */
@@ -3,6 +3,7 @@
 #define DSY_NEO_TRELLIS_H
 
 #include "dev/neopixel.h"
+#include "per/gpio.h"
 
 #define NEO_TRELLIS_ADDR 0x2E
 
@@ -97,6 +98,28 @@ class NeoTrellisI2CTransport
         Read(buff, size);
     }
 
+    /** Starts a read with the DMA, data must be in DMA memory
+        \param data receives the data
+        \param size bytes to read
+        \param callback called from an interrupt when the read is done, or
+               failed
+        \param context passed to the callback
+        \return true if error, false if ok
+    */
+    bool ReadDma(uint8_t                       *data,
+                 uint16_t                       size,
+                 I2CHandle::CallbackFunctionPtr callback,
+                 void                          *context)
+    {
+        dma_callback_ = callback;
+        dma_context_  = context;
+        const bool err
+            = I2CHandle::Result::OK
+              != i2c_.ReceiveDma(config_.address, data, size, DmaDone, this);
+        error_ |= err;
+        return err;
+    }
+
     /**  Writes an 8 bit value
         \param reg the register address to write to
         \param value the value to write to the register
@@ -131,8 +154,17 @@ class NeoTrellisI2CTransport
     }
 
   private:
-    I2CHandle i2c_;
-    Config    config_;
+    static void DmaDone(void *context, I2CHandle::Result result)
+    {
+        auto transport = static_cast<NeoTrellisI2CTransport *>(context);
+        transport->error_ |= result != I2CHandle::Result::OK;
+        transport->dma_callback_(transport->dma_context_, result);
+    }
+
+    I2CHandle                      i2c_;
+    Config                         config_;
+    I2CHandle::CallbackFunctionPtr dma_callback_;
+    void                          *dma_context_;
 
     // true if error has occured since last check
     bool error_;
@@ -234,12 +266,25 @@ class NeoTrellis
         RISING,
     };
 
+    /** Most events read from the keypad FIFO by ProcessAsync() at once */
+    static constexpr size_t kMaxEvents = 32;
+
     struct Config
     {
         typename Transport::Config transport_config;
         NeoPixelI2C::Config        pixels_conf;
 
-        Config() {}
+        /** INT output of the seesaw, low while there are events, so that
+            ProcessAsync() only reads then. Unset to poll.
+        */
+        Pin int_pin;
+
+        /** kMaxEvents bytes in DMA memory for the FIFO reads of
+            ProcessAsync(), or nullptr for blocking reads
+        */
+        uint8_t *dma_buffer;
+
+        Config() : dma_buffer(nullptr) {}
     };
 
     enum Result
@@ -255,7 +300,11 @@ class NeoTrellis
     */
     Result Init(Config config)
     {
-        config_ = config;
+        config_     = config;
+        scan_state_ = ScanState::IDLE;
+        if(config_.int_pin.IsValid())
+            int_pin_.Init(
+                config_.int_pin, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
 
         // init neopixels
         if(pixels.Init(config_.pixels_conf) == NeoPixelI2C::Result::ERR)
@@ -343,25 +392,76 @@ class NeoTrellis
                 count = count + 2;
             keyEventRaw e[count];
             ReadKeypad(e, count);
-            for(int i = 0; i < count; i++)
+            HandleEvents(e, count);
+        }
+    }
+
+    /** Reads the events like Process(), without waiting. Each call does
+        the next step of the read once its delay has passed, and the seesaw
+        is only asked when the interrupt pin is low, or always without one.
+        The events of the FIFO are then read with one transfer, with the
+        DMA when Config::dma_buffer is set. Call it in the main loop.
+        \return true if events were handled with this call
+    */
+    bool ProcessAsync()
+    {
+        const uint32_t now = System::GetUs();
+        switch(scan_state_)
+        {
+            case ScanState::IDLE:
+            {
+                if(config_.int_pin.IsValid() && int_pin_.Read())
+                    return false;
+                uint8_t cmd[2] = {SEESAW_KEYPAD_BASE, SEESAW_KEYPAD_COUNT};
+                transport_.Write(cmd, 2);
+                scan_time_  = now;
+                scan_state_ = ScanState::COUNT_WAIT;
+                return false;
+            }
+            case ScanState::COUNT_WAIT:
+            {
+                if(now - scan_time_ < 500)
+                    return false;
+                uint8_t count = 0;
+                transport_.Read(&count, 1);
+                if(count == 0 || count == 0xFF)
+                {
+                    scan_state_ = ScanState::IDLE;
+                    return false;
+                }
+                // like Process(), catch events that arrive meanwhile
+                if(!config_.int_pin.IsValid())
+                    count += 2;
+                scan_count_ = count < kMaxEvents ? count : kMaxEvents;
+                uint8_t cmd[2] = {SEESAW_KEYPAD_BASE, SEESAW_KEYPAD_FIFO};
+                transport_.Write(cmd, 2);
+                scan_time_  = now;
+                scan_state_ = ScanState::FIFO_WAIT;
+                return false;
+            }
+            case ScanState::FIFO_WAIT:
             {
-                e[i].bit.NUM = NEO_TRELLIS_SEESAW_KEY(e[i].bit.NUM);
-                if(e[i].bit.NUM < NEO_TRELLIS_NUM_KEYS)
+                if(now - scan_time_ < 1000)
+                    return false;
+                if(config_.dma_buffer == nullptr)
                 {
-                    keyEvent evt = {e[i].bit.EDGE, e[i].bit.NUM};
-
-                    state_[evt.bit.NUM]
-                        = evt.bit.EDGE == HIGH || evt.bit.EDGE == RISING;
-                    rising_[evt.bit.NUM]  = evt.bit.EDGE == RISING;
-                    falling_[evt.bit.NUM] = evt.bit.EDGE == FALLING;
-
-                    // call any callbacks associated with the key
-                    if(_callbacks[e[i].bit.NUM] != NULL)
-                    {
-                        _callbacks[e[i].bit.NUM](evt);
-                    }
+                    keyEventRaw e[kMaxEvents];
+                    transport_.Read((uint8_t *)e, scan_count_);
+                    HandleEvents(e, scan_count_);
+                    scan_state_ = ScanState::IDLE;
+                    return true;
                 }
+                scan_state_ = ScanState::READING;
+                if(transport_.ReadDma(
+                       config_.dma_buffer, scan_count_, ReadDone, this))
+                    scan_state_ = ScanState::IDLE;
+                return false;
             }
+            case ScanState::DONE:
+                HandleEvents((keyEventRaw *)config_.dma_buffer, scan_count_);
+                scan_state_ = ScanState::IDLE;
+                return true;
+            default: return false;
         }
     }
 
@@ -478,9 +578,57 @@ class NeoTrellis
     NeoPixelI2C pixels;
 
   private:
+    enum class ScanState
+    {
+        IDLE,
+        COUNT_WAIT,
+        FIFO_WAIT,
+        READING,
+        DONE,
+    };
+
+    /** Updates the key states and calls the callbacks for events read
+        from the keypad FIFO
+    */
+    void HandleEvents(keyEventRaw *e, uint8_t count)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            e[i].bit.NUM = NEO_TRELLIS_SEESAW_KEY(e[i].bit.NUM);
+            if(e[i].bit.NUM < NEO_TRELLIS_NUM_KEYS)
+            {
+                keyEvent evt = {e[i].bit.EDGE, e[i].bit.NUM};
+
+                state_[evt.bit.NUM]
+                    = evt.bit.EDGE == HIGH || evt.bit.EDGE == RISING;
+                rising_[evt.bit.NUM]  = evt.bit.EDGE == RISING;
+                falling_[evt.bit.NUM] = evt.bit.EDGE == FALLING;
+
+                // call any callbacks associated with the key
+                if(_callbacks[e[i].bit.NUM] != NULL)
+                {
+                    _callbacks[e[i].bit.NUM](evt);
+                }
+            }
+        }
+    }
+
+    static void ReadDone(void *context, I2CHandle::Result result)
+    {
+        auto trellis         = static_cast<NeoTrellis *>(context);
+        trellis->scan_state_ = result == I2CHandle::Result::OK
+                                   ? ScanState::DONE
+                                   : ScanState::IDLE;
+    }
+
     Config    config_;
     Transport transport_;
 
+    GPIO               int_pin_;
+    volatile ScanState scan_state_;
+    uint32_t           scan_time_;
+    uint8_t            scan_count_;
+
     bool state_[NEO_TRELLIS_NUM_KEYS];
     bool rising_[NEO_TRELLIS_NUM_KEYS];
     bool falling_[NEO_TRELLIS_NUM_KEYS];
@@ -490,6 +638,9 @@ class NeoTrellis
 
 }; // namespace daisy
 
+template <typename Transport>
+constexpr size_t NeoTrellis<Transport>::kMaxEvents;
+
 /** @} */
 
 using NeoTrellisI2C = NeoTrellis<NeoTrellisI2CTransport>;
@@ -5,6 +5,7 @@
 #include "per/i2c.h"
 #include "per/spi.h"
 #include "per/gpio.h"
+#include "sys/dma.h"
 #include "sys/system.h"
 
 namespace daisy
@@ -15,6 +16,16 @@ namespace daisy
 class SSD130xI2CTransport
 {
   public:
+    /** Most display data bytes sent in one transaction, a page of 128
+     *  columns */
+    static constexpr size_t kMaxDataSize = 128;
+
+    /** Most commands of SendCommandsDma() */
+    static constexpr size_t kMaxCommands = 4;
+
+    /** Called from the interrupt when a DMA transfer is done */
+    typedef void (*TransferCallback)(void* context);
+
     struct Config
     {
         Config()
@@ -24,7 +35,12 @@ class SSD130xI2CTransport
         }
         I2CHandle::Config i2c_config;
         uint8_t           i2c_address;
-        void              Defaults()
+
+        /** Sends the display data by DMA, SendData() returns while the
+         *  page is sent. The driver must not be on the stack (DTCM). */
+        bool use_dma;
+
+        void Defaults()
         {
             i2c_config.periph         = I2CHandle::Config::Peripheral::I2C_1;
             i2c_config.speed          = I2CHandle::Config::Speed::I2C_1MHZ;
@@ -32,31 +48,116 @@ class SSD130xI2CTransport
             i2c_config.pin_config.scl = {DSY_GPIOB, 8};
             i2c_config.pin_config.sda = {DSY_GPIOB, 9};
             i2c_address               = 0x3C;
+            use_dma                   = false;
         }
     };
     void Init(const Config& config)
     {
         i2c_address_ = config.i2c_address;
+        use_dma_     = config.use_dma;
+        dma_busy_    = false;
+        callback_    = nullptr;
         i2c_.Init(config.i2c_config);
     };
     void SendCommand(uint8_t cmd)
     {
+        WaitForDma();
         uint8_t buf[2] = {0X00, cmd};
         i2c_.TransmitBlocking(i2c_address_, buf, 2, 1000);
     };
 
+    /** Sends the data as one data stream: a control byte and up to
+     *  kMaxDataSize bytes per transaction. */
     void SendData(uint8_t* buff, size_t size)
     {
-        for(size_t i = 0; i < size; i++)
+        while(size > 0)
         {
-            uint8_t buf[2] = {0X40, buff[i]};
-            i2c_.TransmitBlocking(i2c_address_, buf, 2, 1000);
+            const size_t chunk = size < kMaxDataSize ? size : kMaxDataSize;
+
+            // the previous DMA transfer may still read the buffer
+            WaitForDma();
+            data_[0] = 0X40;
+            for(size_t i = 0; i < chunk; i++)
+                data_[i + 1] = buff[i];
+
+            if(use_dma_)
+                StartDma(data_, chunk + 1, nullptr, nullptr);
+            else
+                i2c_.TransmitBlocking(i2c_address_, data_, chunk + 1, 1000);
+            buff += chunk;
+            size -= chunk;
         }
     };
 
+    /** Sends up to kMaxCommands commands in one DMA transaction and
+     *  returns, for SSD130xDriver::StartUpdate(). Callable from the
+     *  callback of the previous transfer.
+     */
+    void SendCommandsDma(const uint8_t*   cmds,
+                         size_t           size,
+                         TransferCallback callback,
+                         void*            context)
+    {
+        WaitForDma();
+        size     = size < kMaxCommands ? size : kMaxCommands;
+        cmds_[0] = 0X00;
+        for(size_t i = 0; i < size; i++)
+            cmds_[i + 1] = cmds[i];
+        StartDma(cmds_, size + 1, callback, context);
+    };
+
+    /** Sends up to kMaxDataSize bytes of display data in one DMA
+     *  transaction and returns. The data is copied.
+     */
+    void SendDataDma(const uint8_t*   buff,
+                     size_t           size,
+                     TransferCallback callback,
+                     void*            context)
+    {
+        WaitForDma();
+        size     = size < kMaxDataSize ? size : kMaxDataSize;
+        data_[0] = 0X40;
+        for(size_t i = 0; i < size; i++)
+            data_[i + 1] = buff[i];
+        StartDma(data_, size + 1, callback, context);
+    };
+
   private:
+    void WaitForDma()
+    {
+        while(dma_busy_) {}
+    }
+
+    void StartDma(uint8_t*         buff,
+                  size_t           size,
+                  TransferCallback callback,
+                  void*            context)
+    {
+        dsy_dma_clear_cache_for_buffer(buff, size);
+        callback_         = callback;
+        callback_context_ = context;
+        dma_busy_         = true;
+        if(i2c_.TransmitDma(i2c_address_, buff, size, &DmaCallback, this)
+           != I2CHandle::Result::OK)
+            DmaCallback(this, I2CHandle::Result::ERR);
+    }
+
+    static void DmaCallback(void* context, I2CHandle::Result)
+    {
+        auto& transport     = *static_cast<SSD130xI2CTransport*>(context);
+        transport.dma_busy_ = false;
+        if(transport.callback_ != nullptr)
+            transport.callback_(transport.callback_context_);
+    }
+
     daisy::I2CHandle i2c_;
     uint8_t          i2c_address_;
+    bool             use_dma_;
+    volatile bool    dma_busy_;
+    TransferCallback callback_;
+    void*            callback_context_;
+    uint8_t          cmds_[kMaxCommands + 1];
+    uint8_t          data_[kMaxDataSize + 1];
 };
 
 /**
@@ -65,6 +166,12 @@ class SSD130xI2CTransport
 class SSD130x4WireSpiTransport
 {
   public:
+    /** Most commands of SendCommandsDma() */
+    static constexpr size_t kMaxCommands = 4;
+
+    /** Called from the interrupt when a DMA transfer is done */
+    typedef void (*TransferCallback)(void* context);
+
     struct Config
     {
         Config()
@@ -131,10 +238,60 @@ class SSD130x4WireSpiTransport
         spi_.BlockingTransmit(buff, size);
     };
 
+    /** Sends up to kMaxCommands commands by DMA and returns, for
+     *  SSD130xDriver::StartUpdate(). The commands are copied. Call once the
+     *  previous transfer is done, e.g. from its callback.
+     */
+    void SendCommandsDma(const uint8_t*   cmds,
+                         size_t           size,
+                         TransferCallback callback,
+                         void*            context)
+    {
+        size = size < kMaxCommands ? size : kMaxCommands;
+        for(size_t i = 0; i < size; i++)
+            cmds_[i] = cmds[i];
+        dsy_gpio_write(&pin_dc_, 0);
+        StartDma(cmds_, size, callback, context);
+    };
+
+    /** Sends display data by DMA and returns. The data is not copied, it
+     *  must stay unchanged and be reachable by the DMA until the callback.
+     */
+    void SendDataDma(const uint8_t*   buff,
+                     size_t           size,
+                     TransferCallback callback,
+                     void*            context)
+    {
+        dsy_gpio_write(&pin_dc_, 1);
+        StartDma(const_cast<uint8_t*>(buff), size, callback, context);
+    };
+
   private:
-    SpiHandle spi_;
-    dsy_gpio  pin_reset_;
-    dsy_gpio  pin_dc_;
+    void StartDma(uint8_t*         buff,
+                  size_t           size,
+                  TransferCallback callback,
+                  void*            context)
+    {
+        dsy_dma_clear_cache_for_buffer(buff, size);
+        callback_         = callback;
+        callback_context_ = context;
+        // errors are reported through the callback too
+        spi_.DmaTransmit(buff, size, nullptr, &DmaCallback, this);
+    }
+
+    static void DmaCallback(void* context, SpiHandle::Result)
+    {
+        auto& transport = *static_cast<SSD130x4WireSpiTransport*>(context);
+        if(transport.callback_ != nullptr)
+            transport.callback_(transport.callback_context_);
+    }
+
+    SpiHandle        spi_;
+    dsy_gpio         pin_reset_;
+    dsy_gpio         pin_dc_;
+    TransferCallback callback_;
+    void*            callback_context_;
+    uint8_t          cmds_[kMaxCommands];
 };
 
 /**
@@ -189,6 +346,11 @@ class SSD130x4WireSoftSpiTransport
         pin_reset_.pin  = config.pin_config.reset;
         dsy_gpio_init(&pin_reset_);
 
+        // the clocked pins are written directly, see SoftSpiTransmit()
+        fast_sclk_.Init(config.pin_config.sclk);
+        fast_mosi_.Init(config.pin_config.mosi);
+        fast_dc_.Init(config.pin_config.dc);
+
         // Reset and Configure OLED.
         dsy_gpio_write(&pin_reset_, 0);
         System::Delay(10);
@@ -197,13 +359,13 @@ class SSD130x4WireSoftSpiTransport
     };
     void SendCommand(uint8_t cmd)
     {
-        dsy_gpio_write(&pin_dc_, 0);
+        fast_dc_.Clear();
         SoftSpiTransmit(cmd);
     };
 
     void SendData(uint8_t* buff, size_t size)
     {
-        dsy_gpio_write(&pin_dc_, 1);
+        fast_dc_.Set();
         for(size_t i = 0; i < size; i++)
             SoftSpiTransmit(buff[i]);
     };
@@ -218,15 +380,15 @@ class SSD130x4WireSoftSpiTransport
 
         for(uint8_t bit = 0u; bit < 8u; bit++)
         {
-            dsy_gpio_write(&pin_mosi_, ((val & (1 << bit)) ? 1 : 0));
+            fast_mosi_.Write(val & (1 << bit));
 
             System::DelayTicks(clk_delay);
 
-            dsy_gpio_toggle(&pin_sclk_);
+            fast_sclk_.Clear();
 
             System::DelayTicks(clk_delay);
 
-            dsy_gpio_toggle(&pin_sclk_);
+            fast_sclk_.Set();
         }
     }
 
@@ -235,6 +397,9 @@ class SSD130x4WireSoftSpiTransport
     dsy_gpio pin_mosi_;
     dsy_gpio pin_reset_;
     dsy_gpio pin_dc_;
+    FastGpio fast_sclk_;
+    FastGpio fast_mosi_;
+    FastGpio fast_dc_;
 };
 
 
@@ -252,6 +417,9 @@ class SSD130xDriver
 
     void Init(Config config)
     {
+        updating_ = false;
+        // the contents of the display are unknown
+        MarkAllDirty();
         transport_.Init(config.transport_config);
 
         // Init routine...
@@ -353,45 +521,269 @@ class SSD130xDriver
     {
         if(x >= width || y >= height)
             return;
-        if(on)
-            buffer_[x + (y / 8) * width] |= (1 << (y % 8));
-        else
-            buffer_[x + (y / 8) * width] &= ~(1 << (y % 8));
+        const size_t  page = y / 8;
+        uint8_t&      byte = buffer_[x + page * width];
+        const uint8_t bit  = 1 << (y % 8);
+        const uint8_t next = on ? byte | bit : byte & ~bit;
+        if(next != byte)
+        {
+            byte = next;
+            MarkDirty(page, x);
+        }
     }
 
     void Fill(bool on)
     {
-        for(size_t i = 0; i < sizeof(buffer_); i++)
+        const uint8_t value = on ? 0xff : 0x00;
+        for(size_t page = 0; page < kNumPages; page++)
         {
-            buffer_[i] = on ? 0xff : 0x00;
+            for(size_t x = 0; x < width; x++)
+            {
+                if(buffer_[x + page * width] != value)
+                {
+                    buffer_[x + page * width] = value;
+                    MarkDirty(page, x);
+                }
+            }
         }
     };
 
+    /** Draws a horizontal line, one byte per pixel of the page */
+    void DrawHorizontalSpan(uint_fast8_t x,
+                            uint_fast8_t y,
+                            uint_fast8_t length,
+                            bool         on)
+    {
+        if(y >= height)
+            return;
+        const uint8_t bit = 1 << (y % 8);
+        const size_t  end = x + length < width ? x + length : width;
+        for(size_t i = x; i < end; i++)
+            WriteBits(y / 8, i, on ? bit : 0, bit);
+    }
+
+    /** Draws a vertical line, one byte for up to 8 pixels */
+    void DrawVerticalSpan(uint_fast8_t x,
+                          uint_fast8_t y,
+                          uint_fast8_t length,
+                          bool         on)
+    {
+        if(length > 0)
+            FillRect(x, y, x, y + length - 1, on);
+    }
+
+    /** Fills a rectangle, the corners are included, a byte for up to 8
+     *  pixels of a column */
+    void FillRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on)
+    {
+        if(x2 < x1 || y2 < y1 || x1 >= width || y1 >= height)
+            return;
+        const size_t x_end = x2 < width ? x2 + 1 : width;
+        const size_t y_end = y2 < height ? y2 + 1 : height;
+        for(size_t page = y1 / 8; page * 8 < y_end; page++)
+        {
+            // the lines of the rectangle within this page
+            const size_t  top    = page * 8 > y1 ? 0 : y1 % 8;
+            const size_t  bottom = y_end >= page * 8 + 8 ? 8 : y_end % 8;
+            const uint8_t mask   = (0xff >> (8 - (bottom - top))) << top;
+            for(size_t x = x1; x < x_end; x++)
+                WriteBits(page, x, on ? mask : 0, mask);
+        }
+    }
+
+    /** Draws a bitmap in the page format of the buffer, see
+     *  OneBitGraphicsDisplayImpl::DrawBitmap(). Each byte of the bitmap
+     *  goes into at most two bytes of the buffer.
+     */
+    void DrawBitmap(uint_fast8_t   x,
+                    uint_fast8_t   y,
+                    const uint8_t* bitmap,
+                    uint_fast8_t   bitmap_width,
+                    uint_fast8_t   bitmap_height,
+                    bool           on)
+    {
+        const size_t shift = y % 8;
+        const size_t bands = (bitmap_height + 7) / 8;
+        for(size_t band = 0; band < bands; band++)
+        {
+            const size_t   rows = bitmap_height - band * 8;
+            const uint16_t mask = (rows >= 8 ? 0xff : 0xff >> (8 - rows))
+                                  << shift;
+            const size_t   page = y / 8 + band;
+            for(size_t i = 0; i < bitmap_width && x + i < width; i++)
+            {
+                uint16_t bits = bitmap[band * bitmap_width + i] << shift;
+                if(!on)
+                    bits = ~bits;
+                WriteBits(page, x + i, bits & mask, mask & 0xff);
+                WriteBits(page + 1, x + i, (bits & mask) >> 8, mask >> 8);
+            }
+        }
+    }
+
     /**
-     * Update the display 
+     * Update the display. Only the columns of each page that changed since
+     * the last update are sent.
     */
     void Update()
     {
-        uint8_t i;
-        uint8_t high_column_addr;
-        switch(height)
-        {
-            case 32: high_column_addr = 0x12; break;
+        // a StartUpdate() may still be sending
+        while(updating_) {}
 
-            default: high_column_addr = 0x10; break;
+        for(size_t page = 0; page < kNumPages; page++)
+        {
+            const size_t start = dirty_start_[page];
+            const size_t end   = dirty_end_[page];
+            if(start >= end)
+                continue;
+            ClearDirty(page);
+
+            uint8_t cmds[3];
+            GetAddressCommands(page, start, cmds);
+            for(size_t i = 0; i < 3; i++)
+                transport_.SendCommand(cmds[i]);
+            transport_.SendData(&buffer_[width * page + start], end - start);
         }
-        for(i = 0; i < (height / 8); i++)
+    };
+
+    /**
+     * Starts sending the display by DMA, and returns right away.
+     *
+     * The changed parts of the buffer are copied to a front buffer, which
+     * is sent page by page from the completion interrupts, while drawing
+     * continues in the buffer. Needs a transport with DMA:
+     * SSD130x4WireSpiTransport or SSD130xI2CTransport. The driver must not
+     * be on the stack (DTCM).
+     *
+     * \return false if the previous frame is still being sent, then
+     *         nothing is started
+     */
+    bool StartUpdate()
+    {
+        if(updating_)
+            return false;
+        for(size_t page = 0; page < kNumPages; page++)
         {
-            transport_.SendCommand(0xB0 + i);
-            transport_.SendCommand(0x00);
-            transport_.SendCommand(high_column_addr);
-            transport_.SendData(&buffer_[width * i], width);
+            const size_t start = dirty_start_[page];
+            const size_t end   = dirty_end_[page];
+            front_start_[page] = start;
+            front_end_[page]   = end;
+            for(size_t i = width * page + start; i < width * page + end; i++)
+                front_buffer_[i] = buffer_[i];
+            ClearDirty(page);
         }
+        page_ = FindFrontPage(0);
+        if(page_ >= kNumPages)
+            return true;
+        updating_ = true;
+        SendPageCommands();
+        return true;
     };
 
+    /** \return true when the frame of StartUpdate() was sent */
+    bool UpdateFinished() const { return !updating_; }
+
   protected:
-    Transport transport_;
-    uint8_t   buffer_[width * height / 8];
+    static constexpr size_t kNumPages = height / 8;
+
+    /** First column of the display in the controller's memory */
+    static constexpr size_t kColumnOffset = height == 32 ? 32 : 0;
+
+    /** The page and start column commands */
+    static void GetAddressCommands(size_t page, size_t start, uint8_t* cmds)
+    {
+        const size_t column = kColumnOffset + start;
+        cmds[0]             = 0xB0 + page;
+        cmds[1]             = 0x00 | (column & 0x0F);
+        cmds[2]             = 0x10 | (column >> 4);
+    }
+
+    /** Sets the bits of mask in a byte of the buffer */
+    void WriteBits(size_t page, size_t x, uint8_t bits, uint8_t mask)
+    {
+        if(page >= kNumPages || mask == 0)
+            return;
+        uint8_t&      byte = buffer_[x + page * width];
+        const uint8_t next = (byte & ~mask) | (bits & mask);
+        if(next != byte)
+        {
+            byte = next;
+            MarkDirty(page, x);
+        }
+    }
+
+    void MarkDirty(size_t page, size_t x)
+    {
+        if(x < dirty_start_[page])
+            dirty_start_[page] = x;
+        if(x >= dirty_end_[page])
+            dirty_end_[page] = x + 1;
+    }
+
+    void MarkAllDirty()
+    {
+        for(size_t page = 0; page < kNumPages; page++)
+        {
+            dirty_start_[page] = 0;
+            dirty_end_[page]   = width;
+        }
+    }
+
+    void ClearDirty(size_t page)
+    {
+        dirty_start_[page] = width;
+        dirty_end_[page]   = 0;
+    }
+
+    /** \return the next page from the StartUpdate() with changes, or
+     *          kNumPages */
+    uint8_t FindFrontPage(size_t page) const
+    {
+        while(page < kNumPages && front_start_[page] >= front_end_[page])
+            page++;
+        return page;
+    }
+
+    void SendPageCommands()
+    {
+        uint8_t cmds[3];
+        GetAddressCommands(page_, front_start_[page_], cmds);
+        transport_.SendCommandsDma(cmds, 3, &PageCommandsSent, this);
+    }
+
+    static void PageCommandsSent(void* context)
+    {
+        auto&          driver = *static_cast<SSD130xDriver*>(context);
+        const size_t   page   = driver.page_;
+        const size_t   start  = driver.front_start_[page];
+        const size_t   size   = driver.front_end_[page] - start;
+        const uint8_t* data   = &driver.front_buffer_[width * page + start];
+        driver.transport_.SendDataDma(data, size, &PageDataSent, context);
+    }
+
+    static void PageDataSent(void* context)
+    {
+        auto& driver = *static_cast<SSD130xDriver*>(context);
+        driver.page_ = driver.FindFrontPage(driver.page_ + 1);
+        if(driver.page_ < kNumPages)
+            driver.SendPageCommands();
+        else
+            driver.updating_ = false;
+    }
+
+    Transport        transport_;
+    uint8_t          buffer_[width * height / 8];
+    uint8_t          front_buffer_[width * height / 8];
+    uint8_t          dirty_start_[kNumPages];
+    uint8_t          dirty_end_[kNumPages];
+    uint8_t          front_start_[kNumPages];
+    uint8_t          front_end_[kNumPages];
+    volatile uint8_t page_;
+    volatile bool    updating_;
 };
 
 /**
@@ -0,0 +1,166 @@
+#pragma once
+#ifndef DSY_OLED_SSD1327_H
+#define DSY_OLED_SSD1327_H /**< & */
+
+#include <cstring>
+#include "dev/display_spi_transport.h"
+#include "util/pixel_format.h"
+
+namespace daisy
+{
+/**
+ * A driver implementation for the SSD1327 16 level greyscale OLED, for
+ * the FramebufferDisplay. The framebuffer is L4, in the order of the
+ * controller's memory, and sent as it is. The DMA2D can't write L4, the
+ * FramebufferDisplay draws on it with the CPU.
+ *
+ * The driver must not be on the stack (DTCM), the DMA sends from it.
+ * @ingroup device
+ */
+template <size_t width, size_t height, typename Transport>
+class SSD1327Driver
+{
+  public:
+    struct Config
+    {
+        typename Transport::Config transport_config;
+    };
+
+    void Init(Config config)
+    {
+        updating_ = false;
+        memset(buffer_, 0, sizeof(buffer_));
+        transport_.Init(config.transport_config);
+
+        // all parameters are sent as commands
+        const uint8_t init[] = {
+            0xFD, 0x12,             // Unlock
+            0xAE,                   // Display Off
+            0xA8, height - 1,       // Multiplex Ratio
+            0xA1, 0x00,             // Start Line
+            0xA2, 128 - height,     // Display Offset
+            0xA0, 0x51,             // Remap, first pixel in the high nibble
+            0xAB, 0x01,             // Internal VDD
+            0x81, 0x80,             // Contrast Control
+            0xB1, 0x51,             // Phase Length
+            0xB3, 0x01,             // Display Clock
+            0xBC, 0x08,             // Pre Charge Voltage
+            0xBE, 0x07,             // VCOMH
+            0xB6, 0x01,             // Second Pre Charge
+            0xD5, 0x62,             // Function Selection B
+            0xA4,                   // Normal Display
+        };
+        for(size_t i = 0; i < sizeof(init); i++)
+            transport_.SendCommand(init[i]);
+        Update();
+        // Display On
+        transport_.SendCommand(0xAF);
+    }
+
+    size_t Width() const { return width; }
+    size_t Height() const { return height; }
+
+    /** Returns the framebuffer, for the FramebufferDisplay */
+    PixelBuffer GetFramebuffer()
+    {
+        return {buffer_, PixelFormat::L4, width, height};
+    }
+
+    /** Sets the contrast, 0 to 255 */
+    void SetContrast(uint8_t contrast)
+    {
+        transport_.SendCommand(0x81);
+        transport_.SendCommand(contrast);
+    }
+
+    /**
+     * Update the display
+    */
+    void Update()
+    {
+        // a StartUpdate() may still be sending
+        while(updating_) {}
+        uint8_t cmds[kNumAddressCommands];
+        GetAddressCommands(cmds);
+        for(size_t i = 0; i < kNumAddressCommands; i++)
+            transport_.SendCommand(cmds[i]);
+        transport_.SendData(buffer_, sizeof(buffer_));
+    }
+
+    /**
+     * Starts sending the display by DMA, and returns right away. The
+     * framebuffer is copied to a front buffer, which is sent while drawing
+     * continues.
+     *
+     * \return false if the previous frame is still being sent, then
+     *         nothing is started
+     */
+    bool StartUpdate()
+    {
+        if(updating_)
+            return false;
+        memcpy(front_buffer_, buffer_, sizeof(buffer_));
+        updating_ = true;
+        uint8_t cmds[kNumAddressCommands];
+        GetAddressCommands(cmds);
+        transport_.SendCommandsDma(
+            cmds, kNumAddressCommands, &CommandsSent, this);
+        return true;
+    }
+
+    /** \return true when the frame of StartUpdate() was sent */
+    bool UpdateFinished() const { return !updating_; }
+
+  private:
+    static_assert(width % 2 == 0 && width <= 128 && height <= 128,
+                  "the SSD1327 has 128 x 128 pixels");
+
+    static constexpr size_t kNumAddressCommands = 6;
+
+    /** The column and row address commands of the whole display */
+    static void GetAddressCommands(uint8_t* cmds)
+    {
+        // two pixels per column address
+        cmds[0] = 0x15;
+        cmds[1] = 0;
+        cmds[2] = width / 2 - 1;
+        cmds[3] = 0x75;
+        cmds[4] = 0;
+        cmds[5] = height - 1;
+    }
+
+    static void CommandsSent(void* context)
+    {
+        auto& driver = *static_cast<SSD1327Driver*>(context);
+        driver.transport_.SendDataDma(driver.front_buffer_,
+                                      sizeof(driver.front_buffer_),
+                                      &DataSent,
+                                      context);
+    }
+
+    static void DataSent(void* context)
+    {
+        static_cast<SSD1327Driver*>(context)->updating_ = false;
+    }
+
+    Transport     transport_;
+    uint8_t       buffer_[width * height / 2];
+    uint8_t       front_buffer_[width * height / 2];
+    volatile bool updating_;
+};
+
+/**
+ * A driver for the SSD1327 128x128 OLED displays connected via 4 wire SPI
+ */
+using SSD13274WireSpi128x128Driver
+    = daisy::SSD1327Driver<128, 128, DisplaySpiTransport>;
+
+/**
+ * A driver for the SSD1327 128x96 OLED displays connected via 4 wire SPI
+ */
+using SSD13274WireSpi128x96Driver
+    = daisy::SSD1327Driver<128, 96, DisplaySpiTransport>;
+
+} // namespace daisy
+
+#endif
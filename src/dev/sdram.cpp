@@ -43,6 +43,11 @@ typedef struct
 
 static dsy_sdram_t dsy_sdram;
 
+// end of the DSY_SDRAM_BSS variables, from the linker script
+extern "C" uint8_t _esdram_bss;
+
+static daisy::MemoryArena sdram_arena;
+
 SdramHandle::Result SdramHandle::Init()
 {
     if(PeriphInit() != Result::OK)
@@ -69,6 +74,17 @@ SdramHandle::Result SdramHandle::DeInit()
     return Result::OK;
 }
 
+daisy::MemoryArena& SdramHandle::GetArena()
+{
+    if(sdram_arena.GetSize() == 0)
+    {
+        uint8_t* const start = &_esdram_bss;
+        uint8_t* const end   = (uint8_t*)(DSY_SDRAM_BASE + DSY_SDRAM_SIZE);
+        sdram_arena.Init(start, end - start, "sdram");
+    }
+    return sdram_arena;
+}
+
 SdramHandle::Result SdramHandle::PeriphInit()
 {
     FMC_SDRAM_TimingTypeDef SdramTiming = {0};
@@ -57,6 +57,7 @@ SECTIONS
 #define RAM_AS4C16M16SA_H /**< & */
 #include <stdint.h>
 #include "daisy_core.h"
+#include "util/MemoryArena.h"
 
 /** @addtogroup sdram
     @{
@@ -80,6 +81,14 @@ SECTIONS
 */
 #define DSY_SDRAM_BSS __attribute__((section(".sdram_bss")))
 
+/** Start address of the SDRAM */
+#define DSY_SDRAM_BASE 0xc0000000
+
+/** Size of the SDRAM fitted, the end of GetArena() */
+#ifndef DSY_SDRAM_SIZE
+#define DSY_SDRAM_SIZE (64 * 1024 * 1024)
+#endif
+
 class SdramHandle
 {
   public:
@@ -93,6 +102,12 @@ class SdramHandle
     Result Init();
     Result DeInit();
 
+    /** Returns an arena over the SDRAM after the DSY_SDRAM_BSS variables,
+     *  for allocating buffers at runtime, see daisy::MemoryArena.
+     *  The SDRAM must be initialized first, DaisySeed::Init() does that.
+     */
+    static daisy::MemoryArena& GetArena();
+
   private:
     Result PeriphInit();
     Result DeviceInit();
@@ -2,6 +2,7 @@
 #ifndef DEV_SR_4021_H
 #define DEV_SR_4021_H
 #include "per/gpio.h"
+#include "per/spi.h"
 #include "sys/system.h"
 
 namespace daisy
@@ -32,6 +33,14 @@ namespace daisy
  ** When combining multiple daisy chained and parallel devices the number of devices chained should match
  ** for each parallel device chain.
  **
+ ** When all data pins are on the same GPIO port, the parallel chains are
+ ** read with a single port read per clock. GetStateMask() returns the
+ ** states as bits, in the same order.
+ **
+ ** A single chain can also be read by a SPI peripheral, see SpiConfig, in
+ ** one transfer instead of toggling the clock for each bit, optionally by
+ ** DMA in the background.
+ **
  ***/
 template <size_t num_daisychained = 1, size_t num_parallel = 1>
 class ShiftRegister4021
@@ -45,13 +54,34 @@ class ShiftRegister4021
         dsy_gpio_pin data[num_parallel]; /**< Data Pin(s) */
     };
 
-    ShiftRegister4021() {}
+    /** Settings to read the chain with a SPI peripheral. The clk and data
+     ** pins of the Config must be the SCK and MISO pins of the peripheral.
+     */
+    struct SpiConfig
+    {
+        SpiHandle::Config::Peripheral    periph;
+        SpiHandle::Config::BaudPrescaler baud_prescaler;
+
+        /** num_daisychained bytes in DMA memory (DMA_BUFFER_MEM_SECTION)
+         ** for DMA transfers, or nullptr for blocking ones */
+        uint8_t* dma_buffer;
+
+        SpiConfig()
+        : periph(SpiHandle::Config::Peripheral::SPI_1),
+          baud_prescaler(SpiHandle::Config::BaudPrescaler::PS_128),
+          dma_buffer(nullptr)
+        {
+        }
+    };
+
+    ShiftRegister4021() : use_spi_(false), dma_busy_(false) {}
     ~ShiftRegister4021() {}
 
     /** Initializes the Device(s) */
     void Init(const Config& cfg)
     {
-        config_ = cfg;
+        use_spi_ = false;
+        config_  = cfg;
         // Init GPIO
         clk_.mode = DSY_GPIO_MODE_OUTPUT_PP;
         clk_.pull = DSY_GPIO_NOPULL;
@@ -61,39 +91,96 @@ class ShiftRegister4021
         latch_.pull = DSY_GPIO_NOPULL;
         latch_.pin  = cfg.latch;
         dsy_gpio_init(&latch_);
+        fast_clk_.Init(cfg.clk);
+        fast_latch_.Init(cfg.latch);
         for(size_t i = 0; i < num_parallel; i++)
         {
             data_[i].mode = DSY_GPIO_MODE_INPUT;
             data_[i].pull = DSY_GPIO_NOPULL;
             data_[i].pin  = cfg.data[i];
             dsy_gpio_init(&data_[i]);
+            fast_data_[i].Init(cfg.data[i]);
+            data_masks_[i] = 1 << cfg.data[i].pin;
+            if(cfg.data[i].port != cfg.data[0].port)
+                data_masks_[0] = 0;
         }
         // Init States
         for(size_t i = 0; i < kTotalStates; i++)
         {
             states_[i] = false;
         }
+        for(size_t i = 0; i < kNumMaskWords; i++)
+        {
+            state_bits_[i] = 0;
+        }
+    }
+
+    /** Initializes a single chain on a SPI peripheral
+     ** \return false if the SPI peripheral couldn't be initialized
+     */
+    bool Init(const Config& cfg, const SpiConfig& spi_cfg)
+    {
+        static_assert(num_parallel == 1,
+                      "A SPI peripheral reads a single chain");
+        Init(cfg);
+
+        SpiHandle::Config spi_config;
+        spi_config.periph    = spi_cfg.periph;
+        spi_config.mode      = SpiHandle::Config::Mode::MASTER;
+        spi_config.direction = SpiHandle::Config::Direction::TWO_LINES_RX_ONLY;
+        // the 4021 shifts on the rising edge, the data before is sampled
+        spi_config.clock_polarity  = SpiHandle::Config::ClockPolarity::LOW;
+        spi_config.clock_phase     = SpiHandle::Config::ClockPhase::ONE_EDGE;
+        spi_config.datasize        = 8;
+        spi_config.nss             = SpiHandle::Config::NSS::SOFT;
+        spi_config.baud_prescaler  = spi_cfg.baud_prescaler;
+        spi_config.pin_config.sclk = cfg.clk;
+        spi_config.pin_config.miso = cfg.data[0];
+        spi_config.pin_config.mosi = Pin();
+        spi_config.pin_config.nss  = Pin();
+        if(spi_.Init(spi_config) != SpiHandle::Result::OK)
+            return false;
+
+        dma_buffer_ = spi_cfg.dma_buffer;
+        dma_busy_   = false;
+        use_spi_    = true;
+        return true;
     }
 
-    /** Reads the states of all pins on the connected device(s) */
+    /** Reads the states of all pins on the connected device(s). With a
+     ** DMA buffer it starts the transfer and returns, the states are
+     ** updated when it has completed. An Update() during a transfer is
+     ** ignored.
+     */
     void Update()
     {
-        dsy_gpio_write(&clk_, 0);
-        dsy_gpio_write(&latch_, 1);
+        if(use_spi_)
+        {
+            UpdateSpi();
+            return;
+        }
+        fast_clk_.Clear();
+        fast_latch_.Set();
         System::DelayTicks(1);
-        dsy_gpio_write(&latch_, 0);
+        fast_latch_.Clear();
         uint32_t idx;
+        // a mask of 0 means the pins are on more than one port
+        const bool one_port = data_masks_[0] != 0;
         for(size_t i = 0; i < 8 * num_daisychained; i++)
         {
-            dsy_gpio_write(&clk_, 0);
+            fast_clk_.Clear();
             System::DelayTicks(1);
+            const uint16_t port
+                = one_port ? dsy_gpio_read_port(config_.data[0].port) : 0;
             for(size_t j = 0; j < num_parallel; j++)
             {
                 idx = (8 * num_daisychained - 1) - i;
                 idx += (8 * num_daisychained * j);
-                states_[idx] = dsy_gpio_read(&data_[j]);
+                SetState(idx,
+                         one_port ? (port & data_masks_[j]) != 0
+                                  : fast_data_[j].Read());
             }
-            dsy_gpio_write(&clk_, 1);
+            fast_clk_.Set();
             System::DelayTicks(1);
         }
     }
@@ -106,15 +193,81 @@ class ShiftRegister4021
      ***/
     inline bool State(int index) const { return states_[index]; }
 
+    /** returns the last read states as bits, bit n of word w is the state
+     ** of the input at index 32 * w + n
+     ***/
+    inline uint32_t GetStateMask(size_t word = 0) const
+    {
+        return state_bits_[word];
+    }
+
     inline const Config& GetConfig() const { return config_; }
 
   private:
-    static constexpr int kTotalStates = 8 * num_daisychained * num_parallel;
+    void UpdateSpi()
+    {
+        if(dma_busy_)
+            return;
+        // load the inputs, the first bit is then on the output
+        fast_latch_.Set();
+        System::DelayTicks(1);
+        fast_latch_.Clear();
+        if(dma_buffer_ == nullptr)
+        {
+            uint8_t buff[num_daisychained];
+            if(spi_.BlockingReceive(buff, num_daisychained, 100)
+               == SpiHandle::Result::OK)
+                ReadBuffer(buff);
+            return;
+        }
+        dma_busy_ = true;
+        spi_.DmaReceive(dma_buffer_, num_daisychained, nullptr, DmaDone, this);
+    }
+
+    static void DmaDone(void* context, SpiHandle::Result result)
+    {
+        auto sr = static_cast<ShiftRegister4021*>(context);
+        if(result == SpiHandle::Result::OK)
+            sr->ReadBuffer(sr->dma_buffer_);
+        sr->dma_busy_ = false;
+    }
+
+    /** The bits are received in the order Update() reads them */
+    void ReadBuffer(const uint8_t* buff)
+    {
+        for(size_t i = 0; i < 8 * num_daisychained; i++)
+        {
+            const size_t idx = (8 * num_daisychained - 1) - i;
+            SetState(idx, (buff[i / 8] >> (7 - (i % 8))) & 1);
+        }
+    }
+
+    void SetState(size_t idx, bool state)
+    {
+        const uint32_t bit = 1u << (idx % 32);
+        states_[idx]       = state;
+        if(state)
+            state_bits_[idx / 32] |= bit;
+        else
+            state_bits_[idx / 32] &= ~bit;
+    }
+
+    static constexpr int kTotalStates  = 8 * num_daisychained * num_parallel;
+    static constexpr int kNumMaskWords = (kTotalStates + 31) / 32;
     Config               config_;
-    bool                 states_[kTotalStates];
+    volatile bool        states_[kTotalStates];
+    volatile uint32_t    state_bits_[kNumMaskWords];
     dsy_gpio             clk_;
     dsy_gpio             latch_;
     dsy_gpio             data_[num_parallel];
+    FastGpio             fast_clk_;
+    FastGpio             fast_latch_;
+    FastGpio             fast_data_[num_parallel];
+    uint16_t             data_masks_[num_parallel];
+    SpiHandle            spi_;
+    bool                 use_spi_;
+    uint8_t*             dma_buffer_;
+    volatile bool        dma_busy_;
 };
 
 } // namespace daisy
@@ -1,7 +1,16 @@
 #include <algorithm>
 #include "dev/sr_595.h"
+#include "sys/system.h"
+#include "util/scopedirqblocker.h"
+
+using namespace daisy;
+
+/** Clock of the bit-banged Write(), the max of a 74HC595 at 2V */
+static constexpr uint32_t kMaxClockFreq = 4000000;
+
 void ShiftRegister595::Init(dsy_gpio_pin *pin_cfg, size_t num_daisy_chained)
 {
+    use_spi_ = false;
     // Initialize Pins as outputs
     for(size_t i = 0; i < NUM_PINS; i++)
     {
@@ -9,6 +18,7 @@ void ShiftRegister595::Init(dsy_gpio_pin *pin_cfg, size_t num_daisy_chained)
         pin_[i].mode = DSY_GPIO_MODE_OUTPUT_PP;
         pin_[i].pull = DSY_GPIO_NOPULL;
         dsy_gpio_init(&pin_[i]);
+        fast_[i].Init(pin_cfg[i]);
     }
     std::fill(state_, state_ + kMaxSr595DaisyChain, 0x00);
     num_devices_ = num_daisy_chained;
@@ -16,6 +26,35 @@ void ShiftRegister595::Init(dsy_gpio_pin *pin_cfg, size_t num_daisy_chained)
     if(num_devices_ == 0 || num_devices_ > kMaxSr595DaisyChain)
         num_devices_ = 1;
 }
+bool ShiftRegister595::Init(dsy_gpio_pin    *pin_cfg,
+                            const SpiConfig &spi_cfg,
+                            size_t           num_daisy_chained)
+{
+    Init(pin_cfg, num_daisy_chained);
+
+    SpiHandle::Config cfg;
+    cfg.periph          = spi_cfg.periph;
+    cfg.mode            = SpiHandle::Config::Mode::MASTER;
+    cfg.direction       = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+    cfg.clock_polarity  = SpiHandle::Config::ClockPolarity::LOW;
+    cfg.clock_phase     = SpiHandle::Config::ClockPhase::ONE_EDGE;
+    cfg.datasize        = 8;
+    cfg.nss             = SpiHandle::Config::NSS::SOFT;
+    cfg.baud_prescaler  = spi_cfg.baud_prescaler;
+    cfg.pin_config.sclk = pin_cfg[PIN_CLK];
+    cfg.pin_config.mosi = pin_cfg[PIN_DATA];
+    cfg.pin_config.miso = Pin();
+    cfg.pin_config.nss  = Pin();
+    if(spi_.Init(cfg) != SpiHandle::Result::OK)
+        return false;
+
+    dma_buffer_  = spi_cfg.dma_buffer;
+    dma_busy_    = false;
+    dma_pending_ = false;
+    use_spi_     = true;
+    fast_[PIN_LATCH].Set();
+    return true;
+}
 void ShiftRegister595::Set(uint8_t idx, bool state)
 {
     uint8_t dev, bit;
@@ -28,16 +67,82 @@ void ShiftRegister595::Set(uint8_t idx, bool state)
 }
 void ShiftRegister595::Write()
 {
-    // This is about 2MHz clock speeds without delays
+    if(use_spi_)
+    {
+        WriteSpi();
+        return;
+    }
+    // Each edge is a single store to the port, back to back stores at
+    // 480 MHz are shorter than the minimum pulse width. So each level is
+    // held for half a period of the lowest max frequency, with the timer
+    // like the ShiftRegister4021 does, which is about the speed of the
+    // dsy_gpio_write() calls used before.
     // Max Freq is 4-6 MHz at 2V, and 21-31MHz at 4V5.
-    dsy_gpio_write(&pin_[PIN_LATCH], 0);
+    const uint32_t  half = System::GetTickFreq() / (2 * kMaxClockFreq) + 1;
+    const FastGpio &clk  = fast_[PIN_CLK];
+    const FastGpio &data = fast_[PIN_DATA];
+    fast_[PIN_LATCH].Clear();
     for(size_t i = 0; i < num_devices_ * 8; i++)
     {
-        dsy_gpio_write(&pin_[PIN_CLK], 0);
-        dsy_gpio_write(&pin_[PIN_DATA],
-                       state_[((num_devices_ - 1) - (i / 8))]
-                           & (1 << (7 - (i % 8))));
-        dsy_gpio_write(&pin_[PIN_CLK], 1);
+        clk.Clear();
+        data.Write(state_[((num_devices_ - 1) - (i / 8))]
+                   & (1 << (7 - (i % 8))));
+        System::DelayTicks(half);
+        clk.Set();
+        System::DelayTicks(half);
+    }
+    fast_[PIN_LATCH].Set();
+}
+
+void ShiftRegister595::WriteSpi()
+{
+    if(dma_buffer_ == nullptr)
+    {
+        uint8_t buff[kMaxSr595DaisyChain];
+        FillBuffer(buff);
+        fast_[PIN_LATCH].Clear();
+        spi_.BlockingTransmit(buff, num_devices_);
+        fast_[PIN_LATCH].Set();
+        return;
+    }
+    {
+        ScopedIrqBlocker block;
+        if(dma_busy_)
+        {
+            // the buffer is on its way, the callback sends the new states
+            dma_pending_ = true;
+            return;
+        }
+        dma_busy_ = true;
+    }
+    StartDma();
+}
+void ShiftRegister595::StartDma()
+{
+    FillBuffer(dma_buffer_);
+    spi_.DmaTransmit(dma_buffer_, num_devices_, DmaStart, DmaDone, this);
+}
+void ShiftRegister595::FillBuffer(uint8_t *buff) const
+{
+    // the last device is shifted in first, MSB (QH) first
+    for(size_t i = 0; i < num_devices_; i++)
+        buff[i] = state_[(num_devices_ - 1) - i];
+}
+void ShiftRegister595::DmaStart(void *context)
+{
+    auto sr = static_cast<ShiftRegister595 *>(context);
+    sr->fast_[PIN_LATCH].Clear();
+}
+void ShiftRegister595::DmaDone(void *context, SpiHandle::Result result)
+{
+    auto sr = static_cast<ShiftRegister595 *>(context);
+    sr->fast_[PIN_LATCH].Set();
+    if(sr->dma_pending_ && result == SpiHandle::Result::OK)
+    {
+        sr->dma_pending_ = false;
+        sr->StartDma();
+        return;
     }
-    dsy_gpio_write(&pin_[PIN_LATCH], 1);
+    sr->dma_pending_ = false;
+    sr->dma_busy_    = false;
 }
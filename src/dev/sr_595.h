@@ -4,6 +4,7 @@
 
 #include "daisy_core.h"
 #include "per/gpio.h"
+#include "per/spi.h"
 
 const size_t kMaxSr595DaisyChain
     = 16; /**< Maximum Number of chained devices Connect device's QH' pin to the next chips serial input*/
@@ -15,6 +16,9 @@ const size_t kMaxSr595DaisyChain
 /**
    @brief Device Driver for 8-bit shift register. \n 
    CD74HC595 - 8-bit serial to parallel output shift
+
+   The chain can also be driven by a SPI peripheral, see SpiConfig, which
+   sends all devices in one transfer, optionally by DMA in the background.
    @author shensley
    @date May 2020
 */
@@ -31,7 +35,30 @@ class ShiftRegister595
         PIN_DATA,  /** DATA corresponds to Pin 14 "SER" */
         NUM_PINS, /** _SRCLR_ is not added here, but is tied to 3v3 on test hardware. */
     };
-    ShiftRegister595() {}
+    /** Settings to send the data with a SPI peripheral. PIN_CLK and
+        PIN_DATA must be the SCK and MOSI pins of the peripheral, which
+        can't be shared with other devices: the 595 has no chip select.
+    */
+    struct SpiConfig
+    {
+        daisy::SpiHandle::Config::Peripheral    periph;
+        daisy::SpiHandle::Config::BaudPrescaler baud_prescaler;
+
+        /** num_daisy_chained bytes in DMA memory (DMA_BUFFER_MEM_SECTION)
+            for DMA transfers, or nullptr for blocking ones */
+        uint8_t *dma_buffer;
+
+        SpiConfig()
+        : periph(daisy::SpiHandle::Config::Peripheral::SPI_1),
+          baud_prescaler(daisy::SpiHandle::Config::BaudPrescaler::PS_32),
+          dma_buffer(nullptr)
+        {
+        }
+    };
+
+    ShiftRegister595() : use_spi_(false), dma_busy_(false), dma_pending_(false)
+    {
+    }
     ~ShiftRegister595() {}
 
     /** 
@@ -41,6 +68,16 @@ class ShiftRegister595
      */
     void Init(dsy_gpio_pin *pin_cfg, size_t num_daisy_chained = 1);
 
+    /** Initializes the latch GPIO and the SPI peripheral
+     * \param pin_cfg is an array of dsy_gpio_pin corresponding the the Pins enum above.
+     * \param spi_cfg peripheral, clock rate and DMA buffer
+     * \param num_daisy_chained (default = 1) is the number of 595 devices daisy chained together.
+     * \return false if the SPI peripheral couldn't be initialized
+     */
+    bool Init(dsy_gpio_pin    *pin_cfg,
+              const SpiConfig &spi_cfg,
+              size_t           num_daisy_chained = 1);
+
     /** Sets the state of the specified output.
         \param idx The index starts with QA on the first device and ends with QH on the last device.
     \param state A true state will set the output HIGH, while a false state will set the output LOW.
@@ -48,13 +85,28 @@ class ShiftRegister595
     void Set(uint8_t idx, bool state);
 
     /** Writes the states of shift register out to the connected devices.
+        With a DMA buffer it returns right away, and a Write() during a
+        transfer is sent when the transfer has completed.
      */
     void Write();
 
   private:
-    dsy_gpio pin_[NUM_PINS];
-    uint8_t  state_[kMaxSr595DaisyChain];
-    size_t   num_devices_;
+    void        WriteSpi();
+    void        StartDma();
+    void        FillBuffer(uint8_t *buff) const;
+    static void DmaStart(void *context);
+    static void DmaDone(void *context, daisy::SpiHandle::Result result);
+
+    dsy_gpio        pin_[NUM_PINS];
+    daisy::FastGpio fast_[NUM_PINS];
+    uint8_t         state_[kMaxSr595DaisyChain];
+    size_t          num_devices_;
+
+    daisy::SpiHandle spi_;
+    bool             use_spi_;
+    uint8_t         *dma_buffer_;
+    volatile bool    dma_busy_;
+    volatile bool    dma_pending_;
 };
 
 #endif
@@ -0,0 +1,191 @@
+#pragma once
+#ifndef DSY_TFT_ST7789_H
+#define DSY_TFT_ST7789_H /**< & */
+
+#include "dev/display_spi_transport.h"
+#include "sys/dma2d.h"
+#include "util/pixel_format.h"
+
+namespace daisy
+{
+/**
+ * A driver implementation for ST7789 SPI TFTs, for the FramebufferDisplay.
+ * The framebuffer is RGB565, which the DMA2D draws on. The controller
+ * takes the pixels big endian: for an update the DMA2D copies the
+ * framebuffer to a front buffer with the bytes swapped, which is then sent
+ * by SPI DMA, while drawing continues.
+ *
+ * Both buffers are width * height * 2 bytes. The driver must not be on
+ * the stack (DTCM), on larger panels it can go to the SDRAM.
+ * @ingroup device
+ */
+template <size_t width, size_t height, typename Transport>
+class ST7789Driver
+{
+  public:
+    struct Config
+    {
+        typename Transport::Config transport_config;
+
+        /** Position of the panel in the controller's memory, e.g. 80 rows
+         *  down for 240 x 240 panels with the rows reversed */
+        uint16_t column_offset = 0;
+        uint16_t row_offset    = 0; /**< & */
+
+        /** Most panels need the colours inverted */
+        bool invert = true;
+    };
+
+    void Init(Config config)
+    {
+        updating_ = false;
+        dma2d_.Init();
+        transport_.Init(config.transport_config);
+
+        // Software Reset
+        transport_.SendCommand(0x01);
+        System::Delay(150);
+        // Sleep Out
+        transport_.SendCommand(0x11);
+        System::Delay(120);
+        // Pixel Format, 16 bits
+        const uint8_t colmod = 0x55;
+        transport_.SendCommand(0x3A, &colmod, 1);
+        // Memory Data Access Control
+        const uint8_t madctl = 0x00;
+        transport_.SendCommand(0x36, &madctl, 1);
+        // Column and Row Address, the window stays the whole panel
+        const uint16_t x_end = config.column_offset + width - 1;
+        const uint16_t y_end = config.row_offset + height - 1;
+        const uint8_t  caset[] = {uint8_t(config.column_offset >> 8),
+                                 uint8_t(config.column_offset),
+                                 uint8_t(x_end >> 8),
+                                 uint8_t(x_end)};
+        const uint8_t  raset[] = {uint8_t(config.row_offset >> 8),
+                                 uint8_t(config.row_offset),
+                                 uint8_t(y_end >> 8),
+                                 uint8_t(y_end)};
+        transport_.SendCommand(0x2A, caset, sizeof(caset));
+        transport_.SendCommand(0x2B, raset, sizeof(raset));
+        // Inversion On/Off
+        transport_.SendCommand(config.invert ? 0x21 : 0x20);
+        // Normal Display
+        transport_.SendCommand(0x13);
+
+        for(size_t i = 0; i < width * height; i++)
+            buffer_[i] = 0;
+        Update();
+        // Display On
+        transport_.SendCommand(0x29);
+    }
+
+    size_t Width() const { return width; }
+    size_t Height() const { return height; }
+
+    /** Returns the framebuffer, for the FramebufferDisplay */
+    PixelBuffer GetFramebuffer()
+    {
+        return {buffer_, PixelFormat::RGB565, width, height};
+    }
+
+    /**
+     * Update the display
+    */
+    void Update()
+    {
+        // a StartUpdate() may still be sending
+        while(updating_) {}
+        SwapBuffers();
+        dma2d_.Wait();
+        transport_.SendCommand(0x2C);
+        transport_.SendData(reinterpret_cast<uint8_t*>(front_buffer_),
+                            sizeof(front_buffer_));
+    }
+
+    /**
+     * Starts sending the display, and returns right away. The byte swap
+     * and the transfer run on the DMA2D and the SPI DMA.
+     *
+     * \return false if the previous frame is still being sent, then
+     *         nothing is started
+     */
+    bool StartUpdate()
+    {
+        if(updating_)
+            return false;
+        updating_ = true;
+        if(!SwapBuffers(&Swapped, this))
+            SendFrontBuffer();
+        return true;
+    }
+
+    /** \return true when the frame of StartUpdate() was sent */
+    bool UpdateFinished() const { return !updating_; }
+
+  private:
+    /** Copies the framebuffer to the front buffer, swapping the bytes.
+     *  Done by the CPU when the DMA2D request can't be queued.
+     *  \return true if the DMA2D does it, and calls the callback
+     */
+    bool SwapBuffers(Dma2dHandle::EndCallbackFunctionPtr callback = nullptr,
+                     void*                               context  = nullptr)
+    {
+        const PixelBuffer src = GetFramebuffer();
+        const PixelBuffer dst
+            = {front_buffer_, PixelFormat::RGB565_SWAPPED, width, height};
+        if(dma2d_.Copy(dst, 0, 0, src, callback, context)
+           == Dma2dHandle::Result::OK)
+            return true;
+        for(size_t i = 0; i < width * height; i++)
+            front_buffer_[i] = (buffer_[i] << 8) | (buffer_[i] >> 8);
+        return false;
+    }
+
+    void SendFrontBuffer()
+    {
+        const uint8_t ramwr = 0x2C;
+        transport_.SendCommandsDma(&ramwr, 1, &CommandSent, this);
+    }
+
+    static void Swapped(void* context, Dma2dHandle::Result)
+    {
+        static_cast<ST7789Driver*>(context)->SendFrontBuffer();
+    }
+
+    static void CommandSent(void* context)
+    {
+        auto& driver = *static_cast<ST7789Driver*>(context);
+        driver.transport_.SendDataDma(
+            reinterpret_cast<const uint8_t*>(driver.front_buffer_),
+            sizeof(driver.front_buffer_),
+            &DataSent,
+            context);
+    }
+
+    static void DataSent(void* context)
+    {
+        static_cast<ST7789Driver*>(context)->updating_ = false;
+    }
+
+    Transport     transport_;
+    Dma2dHandle   dma2d_;
+    uint16_t      buffer_[width * height];
+    uint16_t      front_buffer_[width * height];
+    volatile bool updating_;
+};
+
+/**
+ * A driver for the ST7789 240x240 TFTs connected via 4 wire SPI
+ */
+using ST7789Spi240x240Driver
+    = daisy::ST7789Driver<240, 240, DisplaySpiTransport>;
+
+/**
+ * A driver for the ST7789 320x240 TFTs connected via 4 wire SPI
+ */
+using ST7789Spi240x320Driver
+    = daisy::ST7789Driver<240, 320, DisplaySpiTransport>;
+
+} // namespace daisy
+
+#endif
@@ -19,6 +19,8 @@
 #define REGMASK_READ 0
 #define REGMASK_WRITE 1
 
+#include "util/FIFO.h"
+
 namespace daisy
 {
 /** @addtogroup external 
@@ -88,6 +90,22 @@ class Tlv493dI2CTransport
                 != i2c_.ReceiveBlocking(config_.address, data, size, 10);
     }
 
+    /** Starts a read with the DMA, data must be in DMA memory
+        \return true if error, false if ok
+    */
+    bool ReadDma(uint8_t                       *data,
+                 uint16_t                       size,
+                 I2CHandle::CallbackFunctionPtr callback,
+                 void                          *callback_context)
+    {
+        const bool err
+            = I2CHandle::Result::OK
+              != i2c_.ReceiveDma(
+                  config_.address, data, size, callback, callback_context);
+        err_ |= err;
+        return err;
+    }
+
     bool GetError()
     {
         bool tmp = err_;
@@ -206,10 +224,30 @@ class Tlv493d
         {REGMASK_WRITE, 3, 0x1F, 0}  // W_RES3
     };
 
+    /** Samples kept by the driver until ReadSample() */
+    static constexpr size_t kQueueSize = 32;
+
+    /** A 3-axis measurement, in mT */
+    struct Sample
+    {
+        float x;
+        float y;
+        float z;
+    };
+
     struct Config
     {
         typename Transport::Config transport_config;
-        Config() {}
+
+        /** Measurement mode, FASTMODE for the highest rate */
+        AccessMode_e mode;
+
+        /** TLV493D_MEASUREMENT_READOUT bytes in DMA memory for the reads of
+            Process(), or nullptr for blocking reads
+        */
+        uint8_t *dma_buffer;
+
+        Config() : mode(MASTERCONTROLLEDMODE), dma_buffer(nullptr) {}
     };
 
     enum Result
@@ -238,11 +276,15 @@ class Tlv493d
         SetRegBits(W_RES3, GetRegBits(R_RES3));
         // enable parity detection
         SetRegBits(W_PARITY_EN, 1);
-        // config sensor to lowpower mode
+        // config sensor to the mode of the config
         // also contains parity calculation and writeout to sensor
-        SetAccessMode(MASTERCONTROLLEDMODE);
+        SetAccessMode(config_.mode);
 
         prev_sample_period_ = System::GetNow();
+        dma_state_          = DmaState::IDLE;
+        last_frame_         = 0xFF;
+        drops_              = 0;
+        samples_.Clear();
 
         return GetTransportErr();
     }
@@ -286,20 +328,70 @@ class Tlv493d
 
             ReadOut();
 
-            // construct results from registers
-            mXdata = ConcatResults(GetRegBits(R_BX1), GetRegBits(R_BX2), true);
-            mYdata = ConcatResults(GetRegBits(R_BY1), GetRegBits(R_BY2), true);
-            mZdata = ConcatResults(GetRegBits(R_BZ1), GetRegBits(R_BZ2), true);
-            mTempdata = ConcatResults(
-                GetRegBits(R_TEMP1), GetRegBits(R_TEMP2), false);
+            ConstructResults();
+        }
+    }
 
-            // SetAccessMode(POWERDOWNMODE);
-            GetRegBits(R_CHANNEL);
+    /** Reads the measurements into a queue without waiting, call it in the
+        main loop. A read starts once the measurement time of the mode has
+        passed, at once in FASTMODE, with the DMA when Config::dma_buffer is
+        set. Its result is then taken with a later call. Reads that don't
+        bring a new frame don't add a sample.
+        \return true if a sample was added for ReadSample()
+    */
+    bool Process()
+    {
+        bool updated = false;
+        if(dma_state_ == DmaState::DONE)
+        {
+            dma_state_ = DmaState::IDLE;
+            updated    = TakeReadout(config_.dma_buffer);
+        }
+        else if(dma_state_ == DmaState::FAILED)
+        {
+            dma_state_ = DmaState::IDLE;
+        }
+        if(dma_state_ != DmaState::IDLE)
+            return updated;
 
-            mExpectedFrameCount = GetRegBits(R_FRAMECOUNTER) + 1;
+        uint32_t now = System::GetNow();
+        if(now - prev_sample_period_ < GetMeasurementDelay())
+            return updated;
+        prev_sample_period_ = now;
+
+        if(config_.dma_buffer == nullptr)
+        {
+            uint8_t buffer[TLV493D_MEASUREMENT_READOUT];
+            transport_.Read(buffer, TLV493D_MEASUREMENT_READOUT);
+            return TakeReadout(buffer) || updated;
         }
+
+        dma_state_ = DmaState::BUSY;
+        if(transport_.ReadDma(config_.dma_buffer,
+                              TLV493D_MEASUREMENT_READOUT,
+                              ReadDone,
+                              this))
+            dma_state_ = DmaState::FAILED;
+        return updated;
+    }
+
+    /** Takes the oldest sample that Process() read
+        \param sample receives the sample
+        \return false if there's none
+    */
+    bool ReadSample(Sample &sample)
+    {
+        if(samples_.IsEmpty())
+            return false;
+        sample = samples_.PopFront();
+        return true;
     }
 
+    /** \return the samples waiting for ReadSample() */
+    size_t GetNumSamples() const { return samples_.GetNumElements(); }
+
+    /** \return samples dropped because ReadSample() was too slow */
+    uint32_t GetDropCount() const { return drops_; }
     void SetInterrupt(bool enable)
     {
         SetRegBits(W_INT, enable);
@@ -408,6 +500,14 @@ class Tlv493d
     }
 
   private:
+    enum class DmaState
+    {
+        IDLE,
+        BUSY,
+        DONE,
+        FAILED,
+    };
+
     Config    config_;
     Transport transport_;
     uint8_t   regReadData[TLV493D_BUSIF_READSIZE];
@@ -415,6 +515,52 @@ class Tlv493d
     int16_t   mXdata, mYdata, mZdata, mTempdata, mExpectedFrameCount, mMode;
     uint32_t  prev_sample_period_;
 
+    volatile DmaState        dma_state_;
+    uint8_t                  last_frame_;
+    uint32_t                 drops_;
+    FIFO<Sample, kQueueSize> samples_;
+
+    // construct results from registers
+    void ConstructResults()
+    {
+        mXdata = ConcatResults(GetRegBits(R_BX1), GetRegBits(R_BX2), true);
+        mYdata = ConcatResults(GetRegBits(R_BY1), GetRegBits(R_BY2), true);
+        mZdata = ConcatResults(GetRegBits(R_BZ1), GetRegBits(R_BZ2), true);
+        mTempdata
+            = ConcatResults(GetRegBits(R_TEMP1), GetRegBits(R_TEMP2), false);
+
+        // SetAccessMode(POWERDOWNMODE);
+        GetRegBits(R_CHANNEL);
+
+        mExpectedFrameCount = GetRegBits(R_FRAMECOUNTER) + 1;
+    }
+
+    /** Takes the measurement bytes of a read, and queues a new frame
+        \return true if a sample was added
+    */
+    bool TakeReadout(const uint8_t *buffer)
+    {
+        for(size_t i = 0; i < TLV493D_MEASUREMENT_READOUT; i++)
+            regReadData[i] = buffer[i];
+        ConstructResults();
+
+        const uint8_t frame = GetRegBits(R_FRAMECOUNTER);
+        if(frame == last_frame_)
+            return false;
+        last_frame_ = frame;
+
+        Sample sample = {GetX(), GetY(), GetZ()};
+        if(!samples_.PushBack(sample))
+            drops_++;
+        return true;
+    }
+
+    static void ReadDone(void *context, I2CHandle::Result result)
+    {
+        auto tlv        = static_cast<Tlv493d *>(context);
+        tlv->dma_state_ = result == I2CHandle::Result::OK ? DmaState::DONE
+                                                          : DmaState::FAILED;
+    }
     /** Get the global transport_error_ bool (as a Result), then reset it */
     Result GetTransportErr()
     {
@@ -459,6 +605,9 @@ class Tlv493d
     }
 };
 
+template <typename Transport>
+constexpr size_t Tlv493d<Transport>::kQueueSize;
+
 /** @} */
 
 using Tlv493dI2C = Tlv493d<Tlv493dI2CTransport>;
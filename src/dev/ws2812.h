@@ -0,0 +1,389 @@
+#pragma once
+#ifndef DSY_WS2812_H
+#define DSY_WS2812_H
+
+#include <cstddef>
+#include <cstdint>
+#include "per/spi.h"
+#include "util/color.h"
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+/**
+ * \brief SPI Transport for WS2812 pixels, only the MOSI pin is used
+ */
+class Ws2812SpiTransport
+{
+  public:
+    /** Called from an interrupt when a transfer has completed */
+    typedef void (*DoneCallback)(void *context);
+
+    struct Config
+    {
+        SpiHandle::Config::Peripheral    periph;
+        SpiHandle::Config::BaudPrescaler baud_prescaler;
+        Pin                              data_pin;
+
+        /** The bit rate must be 2.4 to 3 MHz. The kernel clock of SPI1-3 is
+         *  160 MHz at the default CPU clock, which PS_64 divides to 2.5 MHz.
+         */
+        void Defaults()
+        {
+            periph         = SpiHandle::Config::Peripheral::SPI_1;
+            baud_prescaler = SpiHandle::Config::BaudPrescaler::PS_64;
+            data_pin       = Pin(PORTB, 5);
+        };
+    };
+
+    inline bool Init(Config &config)
+    {
+        SpiHandle::Config spi_cfg;
+        spi_cfg.periph    = config.periph;
+        spi_cfg.mode      = SpiHandle::Config::Mode::MASTER;
+        spi_cfg.direction = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+        spi_cfg.clock_polarity  = SpiHandle::Config::ClockPolarity::LOW;
+        spi_cfg.clock_phase     = SpiHandle::Config::ClockPhase::ONE_EDGE;
+        spi_cfg.datasize        = 8;
+        spi_cfg.nss             = SpiHandle::Config::NSS::SOFT;
+        spi_cfg.baud_prescaler  = config.baud_prescaler;
+        spi_cfg.pin_config.sclk = Pin();
+        spi_cfg.pin_config.mosi = config.data_pin;
+        spi_cfg.pin_config.miso = Pin();
+        spi_cfg.pin_config.nss  = Pin();
+
+        return spi_.Init(spi_cfg) == SpiHandle::Result::OK;
+    };
+
+    /** Starts sending a buffer in DMA memory */
+    bool Transmit(uint8_t *data, size_t size, DoneCallback done, void *context)
+    {
+        done_    = done;
+        context_ = context;
+        return spi_.DmaTransmit(data, size, nullptr, SpiDone, this)
+               == SpiHandle::Result::OK;
+    };
+
+  private:
+    static void SpiDone(void *context, SpiHandle::Result)
+    {
+        auto transport = static_cast<Ws2812SpiTransport *>(context);
+        transport->done_(transport->context_);
+    }
+
+    SpiHandle    spi_;
+    DoneCallback done_;
+    void        *context_;
+};
+
+
+/** \brief Device support for WS2812 and SK6812 pixels, driven directly
+ *         from a SPI MOSI pin
+ *  \details Each bit for the pixels is sent as 3 SPI bits, 100 for a 0 and
+ *           110 for a 1, at 2.4 to 3 MHz. Show() encodes the pixels into
+ *           one of two DMA buffers and sends it in the background: while
+ *           the strip is busy the other buffer is filled, and goes out as
+ *           soon as the transfer before has completed. A newer Show()
+ *           replaces a frame that has to wait. Neither Show() nor the
+ *           drawing functions ever wait for the strip.
+ *
+ *           The DMA buffers are provided by the caller, in D2 memory:
+ *           \code
+ *           constexpr size_t kSize = Ws2812Spi::GetDmaBufferSize(60);
+ *           uint8_t DMA_BUFFER_MEM_SECTION buff_a[kSize], buff_b[kSize];
+ *           \endcode
+ */
+template <typename Transport>
+class Ws2812
+{
+  public:
+    enum class Result
+    {
+        OK,
+        ERR_INVALID_ARGUMENT,
+        ERR_TRANSPORT
+    };
+
+    struct Config
+    {
+        enum ColorOrder : uint8_t
+        {
+            //      R          G          B
+            RGB = ((0 << 4) | (1 << 2) | (2)),
+            RBG = ((0 << 4) | (2 << 2) | (1)),
+            GRB = ((1 << 4) | (0 << 2) | (2)),
+            GBR = ((2 << 4) | (0 << 2) | (1)),
+            BRG = ((1 << 4) | (2 << 2) | (0)),
+            BGR = ((2 << 4) | (1 << 2) | (0)),
+        };
+
+        typename Transport::Config
+                   transport_config; /**< Transport-specific configuration */
+        ColorOrder color_order;      /**< Pixel color channel ordering */
+        bool       rgbw;       /**< SK6812 RGBW, the white byte comes last */
+        uint16_t   num_pixels; /**< Number of pixels (max 256) */
+        uint8_t   *dma_buffer_a; /**< GetDmaBufferSize() bytes, DMA memory */
+        uint8_t   *dma_buffer_b; /**< GetDmaBufferSize() bytes, DMA memory */
+
+        void Defaults()
+        {
+            transport_config.Defaults();
+            color_order  = ColorOrder::GRB;
+            rgbw         = false;
+            num_pixels   = 1;
+            dma_buffer_a = nullptr;
+            dma_buffer_b = nullptr;
+        };
+    };
+
+    /** Low bytes before and after the pixels, the reset of the strip. At
+     *  3 MHz that's 267us, newer WS2812B need more than 280us between
+     *  frames, with the reset before the frame there's plenty.
+     */
+    static constexpr size_t kResetBytes = 100;
+
+    /** Size of each DMA buffer in bytes
+     *  \param num_pixels number of pixels
+     *  \param rgbw true for 4 channel pixels
+     */
+    static constexpr size_t GetDmaBufferSize(size_t num_pixels,
+                                             bool   rgbw = false)
+    {
+        return 2 * kResetBytes + num_pixels * (rgbw ? 4 : 3) * 3;
+    }
+
+    Ws2812(){};
+    ~Ws2812(){};
+
+    Result Init(Config &config)
+    {
+        if(config.num_pixels > kMaxNumPixels || config.dma_buffer_a == nullptr
+           || config.dma_buffer_b == nullptr)
+        {
+            return Result::ERR_INVALID_ARGUMENT;
+        }
+        num_pixels_ = config.num_pixels;
+        channels_   = config.rgbw ? 4 : 3;
+        buffers_[0] = config.dma_buffer_a;
+        buffers_[1] = config.dma_buffer_b;
+        sending_    = -1;
+        pending_    = -1;
+        error_      = false;
+        offsets_[0] = (config.color_order >> 4) & 0b11;
+        offsets_[1] = (config.color_order >> 2) & 0b11;
+        offsets_[2] = config.color_order & 0b11;
+        offsets_[3] = 3;
+        const size_t size = GetDmaBufferSize(num_pixels_, config.rgbw);
+        for(size_t i = 0; i < size; i++)
+        {
+            buffers_[0][i] = 0;
+            buffers_[1][i] = 0;
+        }
+        Clear();
+        if(!transport_.Init(config.transport_config))
+        {
+            return Result::ERR_TRANSPORT;
+        }
+        return Result::OK;
+    };
+
+    /** Returns the number of pixels */
+    uint16_t GetNumPixels() const { return num_pixels_; }
+
+    /** Returns the color of a pixel as 24-bit RGB */
+    uint32_t GetPixelColor(uint16_t idx) const
+    {
+        if(idx >= num_pixels_)
+            return 0;
+        const uint8_t *pixel = pixels_[idx];
+        return (pixel[offsets_[0]] << 16) | (pixel[offsets_[1]] << 8)
+               | pixel[offsets_[2]];
+    }
+
+    /**
+     * \brief Sets color of a single pixel
+     *
+     * \param idx Index of the pixel
+     * \param color Color object to apply to the pixel
+     */
+    void SetPixelColor(uint16_t idx, const Color &color)
+    {
+        SetPixelColor(idx, color.Red8(), color.Green8(), color.Blue8());
+    }
+
+    /**
+     * \brief Sets color of a single pixel, e.g. from HsvToRgb8()
+     *
+     * \param idx Index of the pixel
+     * \param color 8-bit color to apply to the pixel
+     */
+    void SetPixelColor(uint16_t idx, const Rgb8 &color)
+    {
+        SetPixelColor(idx, color.red, color.green, color.blue);
+    }
+
+    /**
+     * \brief Sets color of a single pixel
+     * \param color 32-bit integer representing 24-bit RGB color. MSB ignored.
+     */
+    void SetPixelColor(uint16_t idx, uint32_t color)
+    {
+        uint8_t r = (color >> 16) & 0xFF;
+        uint8_t g = (color >> 8) & 0xFF;
+        uint8_t b = color & 0xFF;
+        SetPixelColor(idx, r, g, b);
+    }
+
+    /**
+     * \brief Sets color of a single pixel
+     *
+     * \param idx Index of the pixel
+     * \param r 8-bit red value to apply to pixel
+     * \param g 8-bit green value to apply to pixel
+     * \param b 8-bit blue value to apply to pixel
+     * \param w 8-bit white value, for RGBW pixels
+     */
+    Result
+    SetPixelColor(uint16_t idx, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0)
+    {
+        if(idx >= num_pixels_)
+        {
+            return Result::ERR_INVALID_ARGUMENT;
+        }
+        uint8_t *pixel     = pixels_[idx];
+        pixel[offsets_[0]] = r;
+        pixel[offsets_[1]] = g;
+        pixel[offsets_[2]] = b;
+        pixel[offsets_[3]] = w;
+        return Result::OK;
+    };
+
+    /**
+     * \brief Fills all pixels with color
+     * \param color 32-bit integer representing 24-bit RGB color. MSB ignored.
+     */
+    void Fill(uint32_t color)
+    {
+        for(uint16_t i = 0; i < num_pixels_; i++)
+        {
+            SetPixelColor(i, color);
+        }
+    }
+
+    /** \brief Clears all current color data.
+     *         Does not write pixel buffer data to LEDs.
+     */
+    void Clear()
+    {
+        for(uint16_t i = 0; i < num_pixels_; i++)
+        {
+            SetPixelColor(i, 0, 0, 0, 0);
+        }
+    };
+
+    /** \brief Sends the pixels in the background, doesn't wait for the
+     *         strip. Call it from one context only, e.g. the main loop.
+     *  \return ERR_TRANSPORT if a transfer couldn't be started, since the
+     *          last call
+     */
+    Result Show()
+    {
+        int buffer;
+        {
+            // the buffer that isn't on its way, it may be pending
+            ScopedIrqBlocker block;
+            buffer   = sending_ == 0 ? 1 : 0;
+            pending_ = -1;
+        }
+
+        Encode(buffers_[buffer]);
+
+        {
+            ScopedIrqBlocker block;
+            if(sending_ < 0)
+                StartTransfer(buffer);
+            else
+                pending_ = buffer;
+        }
+        const bool error = error_;
+        error_           = false;
+        return error ? Result::ERR_TRANSPORT : Result::OK;
+    };
+
+    /** Returns true while a frame is being sent, or waits to be sent */
+    bool IsBusy() const { return sending_ >= 0; }
+
+    /** Encodes the pixels into the SPI bit patterns of a DMA buffer,
+     *  between the reset bytes, which stay 0
+     */
+    void Encode(uint8_t *buffer) const
+    {
+        uint8_t *out = buffer + kResetBytes;
+        for(uint16_t i = 0; i < num_pixels_; i++)
+        {
+            for(uint8_t c = 0; c < channels_; c++)
+            {
+                const uint8_t  value = pixels_[i][c];
+                const uint32_t bits  = (uint32_t(kNibbleBits[value >> 4]) << 12)
+                                      | kNibbleBits[value & 0x0F];
+                *out++ = bits >> 16;
+                *out++ = bits >> 8;
+                *out++ = bits;
+            }
+        }
+    }
+
+  private:
+    void StartTransfer(int buffer)
+    {
+        sending_ = buffer;
+        if(!transport_.Transmit(buffers_[buffer],
+                                GetDmaBufferSize(num_pixels_, channels_ == 4),
+                                TransferDone,
+                                this))
+        {
+            sending_ = -1;
+            error_   = true;
+        }
+    }
+
+    static void TransferDone(void *context)
+    {
+        auto strip      = static_cast<Ws2812 *>(context);
+        strip->sending_ = -1;
+        if(strip->pending_ >= 0)
+        {
+            const int buffer = strip->pending_;
+            strip->pending_  = -1;
+            strip->StartTransfer(buffer);
+        }
+    }
+
+    /** 3 SPI bits for each bit of a nibble, MSB first */
+    static constexpr uint16_t kNibbleBits[16]
+        = {0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+           0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6};
+
+    static const size_t kMaxNumPixels = 256;
+    Transport           transport_;
+    uint16_t            num_pixels_;
+    uint8_t             channels_;
+    uint8_t             offsets_[4];
+    uint8_t             pixels_[kMaxNumPixels][4];
+    uint8_t            *buffers_[2];
+    volatile int8_t     sending_;
+    volatile int8_t     pending_;
+    volatile bool       error_;
+};
+
+template <typename Transport>
+constexpr uint16_t Ws2812<Transport>::kNibbleBits[16];
+
+template <typename Transport>
+constexpr size_t Ws2812<Transport>::kResetBytes;
+
+using Ws2812Spi = Ws2812<Ws2812SpiTransport>;
+
+} // namespace daisy
+
+#endif
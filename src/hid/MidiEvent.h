@@ -330,6 +330,12 @@ struct MidiEvent
     SystemRealTimeType srt_type;
     ChannelModeType    cm_type;
 
+    /** System::GetCycleCount() when the MidiHandler received the event,
+     *  see AudioBlockClock. Events parsed from the same block of received
+     *  bytes share a timestamp.
+     */
+    uint32_t timestamp;
+
     /** Returns the data within the MidiEvent as a NoteOffEvent struct */
     NoteOffEvent AsNoteOff()
     {
@@ -489,6 +495,67 @@ struct MidiEvent
     }
 };
 
+/** A MidiEvent packed into 8 bytes, for event queues. The bytes of a SysEx
+ *  chunk aren't copied, they stay in the SysEx buffer of the MidiParser,
+ *  which is passed in when the MidiEvent is unpacked.
+ */
+struct CompactMidiEvent
+{
+    MidiMessageType type;     /**< & */
+    uint8_t         channel;  /**< & */
+    uint8_t         data[2];  /**< & */
+    uint8_t         sub_type; /**< sc_type, srt_type or cm_type */
+    uint8_t         sysex_type; /**< SysexChunk::Type */
+    uint16_t        sysex_size; /**< & */
+    uint32_t        timestamp;  /**< & */
+
+    /** Packs the parts of a MidiEvent that are used by its type */
+    static CompactMidiEvent Pack(const MidiEvent &event)
+    {
+        CompactMidiEvent e;
+        e.type       = event.type;
+        e.channel    = event.channel;
+        e.data[0]    = event.data[0];
+        e.data[1]    = event.data[1];
+        e.sub_type   = 0;
+        e.sysex_type = event.sysex_chunk.GetType();
+        e.sysex_size = uint16_t(event.sysex_chunk.GetSize());
+        e.timestamp  = event.timestamp;
+        if(event.type == SystemCommon)
+            e.sub_type = event.sc_type;
+        else if(event.type == SystemRealTime)
+            e.sub_type = event.srt_type;
+        else if(event.type == ChannelMode)
+            e.sub_type = event.cm_type;
+        return e;
+    }
+
+    /** Unpacks the MidiEvent
+     *  \param sysex_buf the buffer of the parser that produced the event
+     */
+    MidiEvent Unpack(RingBuffer<uint8_t, SYSEX_BUF_MAX_SIZE> *sysex_buf) const
+    {
+        MidiEvent event;
+        event.type        = type;
+        event.channel     = channel;
+        event.data[0]     = data[0];
+        event.data[1]     = data[1];
+        event.timestamp   = timestamp;
+        event.sysex_chunk = SysexChunk<>(
+            SysexChunk<>::Type(sysex_type), sysex_buf, sysex_size);
+        event.sc_type  = type == SystemCommon ? SystemCommonType(sub_type)
+                                              : SystemCommonLast;
+        event.srt_type = type == SystemRealTime ? SystemRealTimeType(sub_type)
+                                                : SystemRealTimeLast;
+        event.cm_type  = type == ChannelMode ? ChannelModeType(sub_type)
+                                             : ChannelModeLast;
+        return event;
+    }
+};
+
+static_assert(sizeof(CompactMidiEvent) == 12, "12 bytes per queued event");
+static_assert(SYSEX_BUF_CHUNK_LEN <= UINT16_MAX, "chunks fit sysex_size");
+
 /** @} */ // End midi_events
 
 /** @} */ // End midi
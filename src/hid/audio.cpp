@@ -1,4 +1,14 @@
+#include <cmath>
+#include <cstring>
+#include <stm32h7xx_hal.h>
 #include "hid/audio.h"
+#include "hid/audio_asrc.h"
+#include "hid/audio_chain.h"
+#include "hid/audio_convert.h"
+#include "sys/irq_priority.h"
+#include "sys/system.h"
+#include "util/IrqProfiler.h"
+#include "util/scopedirqblocker.h"
 
 namespace daisy
 {
@@ -10,13 +20,28 @@ namespace daisy
 // in the interest in encourage newcomers, and this also being an audio-centric platform
 // these buffers will always be present, and usable.
 //
-static const size_t kAudioMaxBufferSize = 1024;
-static const size_t kAudioMaxChannels   = 2;
+static const size_t kAudioMaxBufferSize  = 1024;
+static const size_t kAudioMaxChannels    = 4;
+static const size_t kAudioMaxBufferDepth = 4;
+
+// Blocks up to this size use the fixed size processing routines
+static const size_t kAudioMaxTinyBlockSize = 4;
+
+// Channels the level metering measures, all TDM slots
+static const size_t kAudioMaxMeterChannels
+    = audio_convert::LevelMeter::kMaxChannels;
+
+// Frames of the FIFOs that resample the second SAI, and the largest block
+// that leaves room for the target fill of two blocks plus one more.
+static const size_t kAudioAsrcCapacity     = 512;
+static const size_t kAudioAsrcMaxBlockSize = 128;
 
 // Static Global Buffers
-// 8kB in SRAM1, non-cached memory
+// 16kB in SRAM1, non-cached memory
 // 1k samples in, 1k samples out, 4 bytes per sample.
 // One buffer per 2 channels (Interleaved on hardware)
+// With buffer_depth > 2 the ring of blocks for deferred processing is
+// placed directly after the DMA double buffer.
 static int32_t DMA_BUFFER_MEM_SECTION
     dsy_audio_rx_buffer[kAudioMaxChannels / 2][kAudioMaxBufferSize];
 static int32_t DMA_BUFFER_MEM_SECTION
@@ -35,25 +60,48 @@ class AudioHandle::Impl
     AudioHandle::Result DeInit();
     AudioHandle::Result Start(AudioHandle::AudioCallback callback);
     AudioHandle::Result Start(AudioHandle::InterleavingAudioCallback callback);
+    AudioHandle::Result Start(AudioHandle::NativeAudioCallback callback);
+    AudioHandle::Result Start(AudioChain& chain);
     AudioHandle::Result Stop();
     AudioHandle::Result ChangeCallback(AudioHandle::AudioCallback callback);
     AudioHandle::Result
     ChangeCallback(AudioHandle::InterleavingAudioCallback callback);
+    AudioHandle::Result
+    ChangeCallback(AudioHandle::NativeAudioCallback callback);
+    AudioHandle::Result ChangeCallback(AudioChain& chain);
 
     inline size_t GetChannels() const
     {
-        // if(sai1_.IsInitialized() && sai2_.IsInitialized())
-        //     return 4;
-        // else
-        if(sai1_.IsInitialized()) // || sai2_.IsInitialized())
-            return 2;
+        if(sai1_.IsInitialized() && sai2_.IsInitialized())
+            return 4;
+        else if(sai1_.IsInitialized())
+            return sai1_.GetSlotCount();
         else
             return 0;
     }
 
+    /** Returns the number of interleaved samples per frame in each buffer */
+    inline size_t GetSlotsPerBuffer() const
+    {
+        return sai1_.IsInitialized() ? sai1_.GetSlotCount() : 2;
+    }
+
+    /** Largest blocksize that fits the DMA buffers at the configured depth */
+    size_t GetMaxBlockSize() const
+    {
+        const size_t stages
+            = config_.buffer_depth > 2 ? 2 + config_.buffer_depth : 2;
+        const size_t size
+            = kAudioMaxBufferSize / (GetSlotsPerBuffer() * stages);
+        if(config_.resample_secondary && sai2_.IsInitialized()
+           && size > kAudioAsrcMaxBlockSize)
+            return kAudioAsrcMaxBlockSize;
+        return size;
+    }
+
     AudioHandle::Result SetBlockSize(size_t size)
     {
-        size_t maxSize    = kAudioMaxBufferSize / 4;
+        size_t maxSize    = GetMaxBlockSize();
         config_.blocksize = size <= maxSize ? size : maxSize;
         return size <= maxSize ? AudioHandle::Result::OK
                                : AudioHandle::Result::ERR;
@@ -82,19 +130,194 @@ class AudioHandle::Impl
     }
 
     AudioHandle::Result SetSampleRate(SaiHandle::Config::SampleRate sampelrate);
+    AudioHandle::Result
+    ChangeSampleRate(SaiHandle::Config::SampleRate samplerate);
+
+    /** Applies a samplerate change requested with ChangeSampleRate().
+     *  Called from the DMA callback, i.e. between two transfers. */
+    void ApplyPendingSampleRate();
+
+    /** Starts the SAI DMA streams. The second SAI (if present) is started
+     *  first without a callback, its data is handled from the first one. */
+    void StartDma();
+
+    /** Picks the processing routine for the current callback type,
+     *  bit depth and channel count. This is done once when the callback
+     *  changes, so there is no per-sample or per-block format switching.
+     */
+    void SelectProcessFunction();
 
     // Internal Callback
     static void InternalCallback(int32_t* in, int32_t* out, size_t size);
 
-    void *callback_, *interleaved_callback_;
+    /** DMA callback for buffer_depth > 2. Exchanges the DMA half-buffers
+     *  with the ring, and defers the processing to ProcessPending() */
+    static void ExchangeCallback(int32_t* in, int32_t* out, size_t size);
+
+    /** Processes all blocks received since the last call,
+     *  runs from the PendSV interrupt. */
+    void ProcessPending();
+
+    /** Runs the selected process function, and updates the timing stats */
+    void RunProcess(int32_t* in, int32_t* out, size_t size);
+
+    /** Selects the resampling routines of the second SAI for the bit
+     *  depth, and resets the resamplers
+     *  \returns the DMA callback of the second SAI */
+    SaiHandle::CallbackFunctionPtr InitResampling();
+
+    /** DMA callback of the second SAI when it's resampled. Passes its
+     *  input to the first SAI's clock, and takes its output from it. */
+    template <int Bits>
+    static void SecondaryCallback(int32_t* in, int32_t* out, size_t size);
+
+    /** Reads a block of the second SAI's input at the first SAI's clock
+     *  into asrc_in_, runs in the first SAI's DMA interrupt */
+    template <int Bits>
+    static void PullSecondary(size_t size);
+
+    /** Passes the block in asrc_out_ on to the second SAI's clock */
+    template <int Bits>
+    static void PushSecondary(size_t size);
+
+    // Processing routines, one instantiation per supported format
+    typedef void (*ProcessFunction)(int32_t* in, int32_t* out, size_t size);
+    static void ProcessNative(int32_t* in, int32_t* out, size_t size);
+    template <int Bits>
+    static void ProcessInterleaved(int32_t* in, int32_t* out, size_t size);
+    template <int Bits, size_t Channels>
+    static void ProcessNonInterleaved(int32_t* in, int32_t* out, size_t size);
+    template <int Bits>
+    static void ProcessTdm(int32_t* in, int32_t* out, size_t size);
+
+    // Fixed size variants for blocks of up to kAudioMaxTinyBlockSize frames.
+    // The frame count is a template argument, so the conversion is fully
+    // unrolled, and the scratch buffers are fixed size arrays.
+    template <size_t Frames>
+    static void ProcessTinyInterleaved(int32_t* in, int32_t* out, size_t size);
+    template <size_t Channels, size_t Frames>
+    static void
+    ProcessTinyNonInterleaved(int32_t* in, int32_t* out, size_t size);
+
+    /** Selects one of the fixed size routines for blocksizes up to
+     *  kAudioMaxTinyBlockSize. Returns false for larger blocks. */
+    bool SelectTinyProcessFunction(size_t chns);
+
+    AudioHandle::CallbackStats GetCallbackStats() const
+    {
+        AudioHandle::CallbackStats stats;
+        stats.callback_count    = callback_count_;
+        stats.missed_deadlines  = underruns_
+                                 + (sai1_.IsInitialized()
+                                        ? sai1_.GetMissedDeadlineCount()
+                                        : 0);
+        stats.last_cycles       = last_cycles_;
+        stats.worst_case_cycles = worst_case_cycles_;
+        for(size_t i = 0; i < DSY_AUDIO_COLD_START_CALLBACKS; i++)
+            stats.first_cycles[i] = first_cycles_[i];
+        return stats;
+    }
+
+    void ResetCallbackStats()
+    {
+        if(sai1_.IsInitialized())
+            sai1_.ResetMissedDeadlineCount();
+        underruns_         = 0;
+        callback_count_    = 0;
+        last_cycles_       = 0;
+        worst_case_cycles_ = 0;
+        for(auto& cycles : first_cycles_)
+            cycles = 0;
+    }
+
+    /** Adds the levels of a block to the ones since the last reset */
+    void AddLevels(const audio_convert::LevelMeter& in,
+                   const audio_convert::LevelMeter& out,
+                   size_t                           frames)
+    {
+        const size_t chns = GetChannels();
+        for(size_t c = 0; c < chns && c < kAudioMaxMeterChannels; c++)
+        {
+            if(in.peak[c] > levels_in_.peak[c])
+                levels_in_.peak[c] = in.peak[c];
+            if(out.peak[c] > levels_out_.peak[c])
+                levels_out_.peak[c] = out.peak[c];
+            levels_in_.sum_sq[c] += in.sum_sq[c];
+            levels_out_.sum_sq[c] += out.sum_sq[c];
+        }
+        level_frames_ += frames;
+    }
+
+    AudioHandle::Level GetLevel(const audio_convert::LevelMeter& meter,
+                                size_t                           channel) const
+    {
+        AudioHandle::Level level = {0.f, 0.f};
+        if(channel >= kAudioMaxMeterChannels)
+            return level;
+        ScopedIrqBlocker block;
+        level.peak = meter.peak[channel];
+        if(level_frames_ > 0)
+            level.rms = sqrtf(meter.sum_sq[channel] / float(level_frames_));
+        return level;
+    }
+
+    void ResetLevels()
+    {
+        ScopedIrqBlocker block;
+        levels_in_.Reset(kAudioMaxMeterChannels);
+        levels_out_.Reset(kAudioMaxMeterChannels);
+        level_frames_ = 0;
+    }
+
+    void *callback_, *interleaved_callback_, *native_callback_;
+    AudioChain* volatile chain_;
 
     // Data
-    AudioHandle::Config config_;
-    SaiHandle           sai1_; //, sai2_;
-    int32_t*            buff_rx_[2];
-    int32_t*            buff_tx_[2];
-    float               postgain_recip_;
-    float               output_adjust_;
+    AudioHandle::Config      config_;
+    SaiHandle                sai1_, sai2_;
+    int32_t*                 buff_rx_[2];
+    int32_t*                 buff_tx_[2];
+    int32_t*                 ring_rx_[2];
+    int32_t*                 ring_tx_[2];
+    int32_t*                 in2_;
+    int32_t*                 out2_;
+    float                    postgain_recip_;
+    float                    output_adjust_;
+    volatile ProcessFunction process_;
+
+    // Callback timing statistics
+    volatile uint32_t callback_count_;
+    volatile uint32_t last_cycles_;
+    volatile uint32_t worst_case_cycles_;
+    volatile uint32_t first_cycles_[DSY_AUDIO_COLD_START_CALLBACKS];
+
+    // Levels since the last ResetLevels(), see Config::metering
+    volatile bool             metering_;
+    audio_convert::LevelMeter levels_in_, levels_out_;
+    uint32_t                  level_frames_;
+
+    // Samplerate change requested while running
+    bool                          running_;
+    volatile bool                 samplerate_pending_;
+    SaiHandle::Config::SampleRate pending_samplerate_;
+
+    // Block counters for buffer_depth > 2
+    volatile uint32_t blocks_exchanged_;
+    volatile uint32_t blocks_processed_;
+    volatile uint32_t underruns_;
+
+    // Resampling of the second SAI, see Config::resample_secondary
+    typedef void (*ResampleFunction)(size_t size);
+    typedef AsyncResampler<2, kAudioAsrcCapacity> Resampler;
+
+    bool             resampling_;
+    ResampleFunction pull_secondary_;
+    ResampleFunction push_secondary_;
+    ClockDriftMeter  drift_;
+    Resampler        asrc_rx_, asrc_tx_;
+    int32_t          asrc_in_[kAudioAsrcMaxBlockSize * 2];
+    int32_t          asrc_out_[kAudioAsrcMaxBlockSize * 2];
+    float            asrc_scratch_[kAudioAsrcMaxBlockSize * 2];
 };
 
 // ================================================================
@@ -103,6 +326,54 @@ class AudioHandle::Impl
 
 static AudioHandle::Impl audio_handle;
 
+/** The levels of one block, measured by the conversion kernels, and added
+ *  to the AudioHandle's at the end of the block. Without metering the
+ *  kernels run with the NoMeter, and measure nothing.
+ */
+class BlockLevels
+{
+  public:
+    explicit BlockLevels(size_t channels) : on_(audio_handle.metering_)
+    {
+        if(on_)
+        {
+            in_.Reset(channels);
+            out_.Reset(channels);
+        }
+    }
+
+    /** Runs the input conversion with the input's meter */
+    template <typename Convert>
+    FORCE_INLINE void Input(Convert&& convert)
+    {
+        if(on_)
+            convert(in_);
+        else
+            convert(audio_convert::NoMeter());
+    }
+
+    /** Runs the output conversion with the output's meter */
+    template <typename Convert>
+    FORCE_INLINE void Output(Convert&& convert)
+    {
+        if(on_)
+            convert(out_);
+        else
+            convert(audio_convert::NoMeter());
+    }
+
+    /** Adds the block to the levels of the AudioHandle */
+    void Commit(size_t frames)
+    {
+        if(on_)
+            audio_handle.AddLevels(in_, out_, frames);
+    }
+
+  private:
+    const bool                on_;
+    audio_convert::LevelMeter in_, out_;
+};
+
 // ================================================================
 // Private Implementation
 // ================================================================
@@ -110,7 +381,8 @@ static AudioHandle::Impl audio_handle;
 AudioHandle::Result AudioHandle::Impl::Init(const AudioHandle::Config config,
                                             SaiHandle                 sai)
 {
-    config_ = config;
+    config_   = config;
+    metering_ = config_.metering;
 
     /** Precompute input level adjustment */
     if(config_.postgain > 0.f)
@@ -130,6 +402,13 @@ AudioHandle::Result AudioHandle::Impl::Init(const AudioHandle::Config config,
     {
         return Result::ERR;
     }
+    sai2_       = SaiHandle();
+    resampling_ = false;
+
+    if(config_.buffer_depth < 2 || config_.buffer_depth > kAudioMaxBufferDepth
+       || config_.blocksize > GetMaxBlockSize())
+        return Result::ERR;
+
     buff_rx_[0] = dsy_audio_rx_buffer[0];
     buff_tx_[0] = dsy_audio_tx_buffer[0];
     return Result::OK;
@@ -139,12 +418,18 @@ AudioHandle::Result AudioHandle::Impl::Init(const AudioHandle::Config config,
                                             SaiHandle                 sai1,
                                             SaiHandle                 sai2)
 {
-    this->Init(config, sai1);
-    // sai2_       = sai2;
-    // buff_rx_[1] = dsy_audio_rx_buffer[1];
-    // buff_tx_[1] = dsy_audio_tx_buffer[1];
-    // How do we want to handle the rx/tx buffs for the second peripheral of audio..?
-    return Result::OK;
+    if(this->Init(config, sai1) != Result::OK)
+        return Result::ERR;
+    // TDM is only supported on a single SAI
+    if(!sai2.IsInitialized()
+       || sai2.GetConfig().bit_depth != sai1.GetConfig().bit_depth
+       || sai1.GetSlotCount() != 2 || sai2.GetSlotCount() != 2)
+        return Result::ERR;
+    sai2_       = sai2;
+    buff_rx_[1] = dsy_audio_rx_buffer[1];
+    buff_tx_[1] = dsy_audio_tx_buffer[1];
+    // resampling limits the blocksize further
+    return config_.blocksize <= GetMaxBlockSize() ? Result::OK : Result::ERR;
 }
 
 AudioHandle::Result AudioHandle::Impl::DeInit()
@@ -157,54 +442,112 @@ AudioHandle::Result AudioHandle::Impl::DeInit()
             return Result::ERR;
         }
     }
-    // if(sai2_.IsInitialized())
-    // {
-    //     if(sai2_.DeInit() != SaiHandle::Result::OK)
-    //     {
-    //         return Result::ERR;
-    //     }
-    // }
+    if(sai2_.IsInitialized())
+    {
+        if(sai2_.DeInit() != SaiHandle::Result::OK)
+        {
+            return Result::ERR;
+        }
+    }
     return Result::OK;
 }
 
-AudioHandle::Result
-AudioHandle::Impl::Start(AudioHandle::AudioCallback callback)
+void AudioHandle::Impl::StartDma()
 {
-    // Get instance of object
-    // if(sai2_.IsInitialized())
-    // {
-    //     // Start stream with no callback. Data will be filled externally.
-    //     sai2_.StartDma(
-    //         buff_rx_[1], buff_tx_[1], config_.blocksize * 2 * 2, nullptr);
-    // }
+    const size_t dma_size = config_.blocksize * GetSlotsPerBuffer() * 2;
+    const bool   deferred = config_.buffer_depth > 2;
+
+    ResetCallbackStats();
+    ResetLevels();
+    running_            = true;
+    samplerate_pending_ = false;
+    blocks_exchanged_   = 0;
+    blocks_processed_   = 0;
+    for(size_t i = 0; i < 2; i++)
+    {
+        ring_rx_[i] = buff_rx_[i] ? buff_rx_[i] + dma_size : nullptr;
+        ring_tx_[i] = buff_tx_[i] ? buff_tx_[i] + dma_size : nullptr;
+    }
+    if(deferred)
+    {
+        // Lowest priority, so that the DMA interrupts can preempt a long
+        // callback and keep exchanging blocks.
+        HAL_NVIC_SetPriority(PendSV_IRQn, DSY_IRQ_PRIORITY_AUDIO_CALLBACK, 0);
+    }
+
+    resampling_ = config_.resample_secondary && sai2_.IsInitialized();
+    if(resampling_)
+    {
+        // The second SAI runs at its own pace, and hands its data over
+        // through the resamplers from its own interrupt.
+        sai2_.StartDma(buff_rx_[1], buff_tx_[1], dma_size, InitResampling());
+    }
+    else if(sai2_.IsInitialized())
+    {
+        // Start stream with no callback. Data will be filled externally.
+        sai2_.StartDma(buff_rx_[1], buff_tx_[1], dma_size, nullptr);
+    }
     sai1_.StartDma(buff_rx_[0],
                    buff_tx_[0],
-                   config_.blocksize * 2 * 2,
-                   audio_handle.InternalCallback);
+                   dma_size,
+                   deferred ? audio_handle.ExchangeCallback
+                            : audio_handle.InternalCallback);
+}
+
+AudioHandle::Result
+AudioHandle::Impl::Start(AudioHandle::AudioCallback callback)
+{
     callback_             = (void*)callback;
     interleaved_callback_ = nullptr;
+    native_callback_      = nullptr;
+    chain_                = nullptr;
+    SelectProcessFunction();
+    StartDma();
     return Result::OK;
 }
 
 AudioHandle::Result
 AudioHandle::Impl::Start(AudioHandle::InterleavingAudioCallback callback)
 {
-    // Get instance of object
-    sai1_.StartDma(buff_rx_[0],
-                   buff_tx_[0],
-                   config_.blocksize * 2 * 2,
-                   audio_handle.InternalCallback);
     interleaved_callback_ = (void*)callback;
     callback_             = nullptr;
+    native_callback_      = nullptr;
+    chain_                = nullptr;
+    SelectProcessFunction();
+    StartDma();
+    return Result::OK;
+}
+
+AudioHandle::Result
+AudioHandle::Impl::Start(AudioHandle::NativeAudioCallback callback)
+{
+    native_callback_      = (void*)callback;
+    callback_             = nullptr;
+    interleaved_callback_ = nullptr;
+    chain_                = nullptr;
+    SelectProcessFunction();
+    StartDma();
+    return Result::OK;
+}
+
+AudioHandle::Result AudioHandle::Impl::Start(AudioChain& chain)
+{
+    chain_                = &chain;
+    callback_             = nullptr;
+    interleaved_callback_ = nullptr;
+    native_callback_      = nullptr;
+    SelectProcessFunction();
+    StartDma();
     return Result::OK;
 }
 
 AudioHandle::Result AudioHandle::Impl::Stop()
 {
+    running_ = false;
     if(sai1_.IsInitialized())
         sai1_.StopDma();
-    // if(sai2_.IsInitialized())
-    //     sai2_.StopDma();
+    if(sai2_.IsInitialized())
+        sai2_.StopDma();
     return Result::OK;
 }
 
@@ -215,6 +558,9 @@ AudioHandle::Impl::ChangeCallback(AudioHandle::AudioCallback callback)
     {
         callback_             = (void*)callback;
         interleaved_callback_ = nullptr;
+        native_callback_      = nullptr;
+        chain_                = nullptr;
+        SelectProcessFunction();
         return Result::OK;
     }
     else
@@ -230,6 +576,9 @@ AudioHandle::Result AudioHandle::Impl::ChangeCallback(
     {
         interleaved_callback_ = (void*)callback;
         callback_             = nullptr;
+        native_callback_      = nullptr;
+        chain_                = nullptr;
+        SelectProcessFunction();
         return Result::OK;
     }
     else
@@ -238,6 +587,34 @@ AudioHandle::Result AudioHandle::Impl::ChangeCallback(
     }
 }
 
+AudioHandle::Result
+AudioHandle::Impl::ChangeCallback(AudioHandle::NativeAudioCallback callback)
+{
+    if(callback != nullptr)
+    {
+        native_callback_      = (void*)callback;
+        callback_             = nullptr;
+        interleaved_callback_ = nullptr;
+        chain_                = nullptr;
+        SelectProcessFunction();
+        return Result::OK;
+    }
+    else
+    {
+        return Result::ERR;
+    }
+}
+
+AudioHandle::Result AudioHandle::Impl::ChangeCallback(AudioChain& chain)
+{
+    chain_                = &chain;
+    callback_             = nullptr;
+    interleaved_callback_ = nullptr;
+    native_callback_      = nullptr;
+    SelectProcessFunction();
+    return Result::OK;
+}
+
 AudioHandle::Result
 AudioHandle::Impl::SetSampleRate(SaiHandle::Config::SampleRate samplerate)
 {
@@ -253,247 +630,545 @@ AudioHandle::Impl::SetSampleRate(SaiHandle::Config::SampleRate samplerate)
             return Result::ERR;
         }
     }
-    // if(sai2_.IsInitialized())
-    // {
-    //     // Set, and reinit
-    //     SaiHandle::Config cfg;
-    //     cfg    = sai2_.GetConfig();
-    //     cfg.sr = config_.samplerate;
-    //     if(sai2_.Init(cfg) != SaiHandle::Result::OK)
-    //     {
-    //         return Result::ERR;
-    //     }
-    // }
+    if(sai2_.IsInitialized())
+    {
+        // Set, and reinit
+        SaiHandle::Config cfg;
+        cfg    = sai2_.GetConfig();
+        cfg.sr = config_.samplerate;
+        if(sai2_.Init(cfg) != SaiHandle::Result::OK)
+        {
+            return Result::ERR;
+        }
+    }
     return Result::OK;
 }
 
-// This turned into a very large function due to the bit-depth conversions..
-// I didn't want to do a conditional conversion in a single loop because it seemed
-// far less efficient, so this is where I landed.
-//
-// Using function pointers for the x2f and f2x functions would have been ideal, but
-// wasn't possible due to the different parameter/return types for each function.
-void AudioHandle::Impl::InternalCallback(int32_t* in, int32_t* out, size_t size)
-{
-    // Convert from sai format to float, and call user callback
-    size_t                      chns;
-    // SaiHandle::Config::BitDepth bd;
-    // bd   = audio_handle.sai1_.GetConfig().bit_depth;
-    chns = audio_handle.GetChannels();
-    if(chns == 0)
+AudioHandle::Result
+AudioHandle::Impl::ChangeSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    if(!running_)
+        return SetSampleRate(samplerate);
+
+    // Only SAI that generate their clocks can change the rate on their own
+    const SaiHandle* sais[2] = {&sai1_, &sai2_};
+    for(const SaiHandle* sai : sais)
+    {
+        if(!sai->IsInitialized())
+            continue;
+        const SaiHandle::Config& cfg = sai->GetConfig();
+        if(cfg.a_sync != SaiHandle::Config::Sync::MASTER
+           && cfg.b_sync != SaiHandle::Config::Sync::MASTER)
+            return Result::ERR;
+    }
+    config_.samplerate  = samplerate;
+    pending_samplerate_ = samplerate;
+    samplerate_pending_ = true;
+    return Result::OK;
+}
+
+void AudioHandle::Impl::ApplyPendingSampleRate()
+{
+    samplerate_pending_ = false;
+    // Both SAI are changed back to back, so they stay in step
+    if(sai2_.IsInitialized())
+        sai2_.SetSampleRate(pending_samplerate_);
+    sai1_.SetSampleRate(pending_samplerate_);
+}
+
+void AudioHandle::Impl::SelectProcessFunction()
+{
+    const size_t chns = GetChannels();
+    if(native_callback_)
+    {
+        process_ = ProcessNative;
         return;
-    // Handle Interleaved / Non Interleaved separate
-    // if(audio_handle.interleaved_callback_)
-    // {
-    //     InterleavingAudioCallback cb
-    //         = (InterleavingAudioCallback)audio_handle.interleaved_callback_;
-    //     float fin[size];
-    //     float fout[size];
-    //     // There _must_ be a more elegant way to do this....
-    //     // Convert from int to float
-    //     switch(bd)
-    //     {
-    //         case SaiHandle::Config::BitDepth::SAI_16BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 fin[i] = s162f(in[i]) * audio_handle.postgain_recip_;
-    //                 fin[i + 1]
-    //                     = s162f(in[i + 1]) * audio_handle.postgain_recip_;
-    //             }
-    //             break;
-    //         case SaiHandle::Config::BitDepth::SAI_24BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 fin[i] = s242f(in[i]) * audio_handle.postgain_recip_;
-    //                 fin[i + 1]
-    //                     = s242f(in[i + 1]) * audio_handle.postgain_recip_;
-    //             }
-    //             break;
-    //         case SaiHandle::Config::BitDepth::SAI_32BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 fin[i] = s322f(in[i]) * audio_handle.postgain_recip_;
-    //                 fin[i + 1]
-    //                     = s322f(in[i + 1]) * audio_handle.postgain_recip_;
-    //             }
-    //             break;
-    //         default: break;
-    //     }
-    //     cb(fin, fout, size);
-    //     switch(bd)
-    //     {
-    //         case SaiHandle::Config::BitDepth::SAI_16BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 out[i] = f2s16(fout[i] * audio_handle.output_adjust_);
-    //                 out[i + 1]
-    //                     = f2s16(fout[i + 1] * audio_handle.output_adjust_);
-    //             }
-    //             break;
-    //         case SaiHandle::Config::BitDepth::SAI_24BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 out[i] = f2s24(fout[i] * audio_handle.output_adjust_);
-    //                 out[i + 1]
-    //                     = f2s24(fout[i + 1] * audio_handle.output_adjust_);
-    //             }
-    //             break;
-    //         case SaiHandle::Config::BitDepth::SAI_32BIT:
-    //             for(size_t i = 0; i < size; i += 2)
-    //             {
-    //                 out[i] = f2s32(fout[i] * audio_handle.output_adjust_);
-    //                 out[i + 1]
-    //                     = f2s32(fout[i + 1] * audio_handle.output_adjust_);
-    //             }
-    //             break;
-    //         default: break;
-    //     }
-    // }
-    // else
-    if(audio_handle.callback_)
-    {
-        AudioCallback cb = (AudioCallback)audio_handle.callback_;
+    }
+    // a chain runs on the same non-interleaved buffers as the callback
+    if(chns == 0 || (!interleaved_callback_ && !callback_ && !chain_))
+    {
+        process_ = nullptr;
+        return;
+    }
+
+    // TDM frames are handed to the non-interleaving callbacks with a single
+    // deinterleave pass. Interleaving callbacks get all slots as they are.
+    const bool tdm = GetSlotsPerBuffer() > 2;
+
+    // Only instantiated for 24 bit (used by all of the on-board codecs),
+    // to keep the code size down.
+    if(!tdm
+       && sai1_.GetConfig().bit_depth == SaiHandle::Config::BitDepth::SAI_24BIT
+       && SelectTinyProcessFunction(chns))
+        return;
+
+    // Interleaving callbacks only support the first two channels for now.
+    switch(sai1_.GetConfig().bit_depth)
+    {
+        case SaiHandle::Config::BitDepth::SAI_16BIT:
+            if(interleaved_callback_)
+                process_ = ProcessInterleaved<16>;
+            else
+                process_ = tdm        ? ProcessTdm<16>
+                           : chns > 2 ? ProcessNonInterleaved<16, 4>
+                                      : ProcessNonInterleaved<16, 2>;
+            break;
+        case SaiHandle::Config::BitDepth::SAI_32BIT:
+            if(interleaved_callback_)
+                process_ = ProcessInterleaved<32>;
+            else
+                process_ = tdm        ? ProcessTdm<32>
+                           : chns > 2 ? ProcessNonInterleaved<32, 4>
+                                      : ProcessNonInterleaved<32, 2>;
+            break;
+        case SaiHandle::Config::BitDepth::SAI_24BIT:
+        default:
+            if(interleaved_callback_)
+                process_ = ProcessInterleaved<24>;
+            else
+                process_ = tdm        ? ProcessTdm<24>
+                           : chns > 2 ? ProcessNonInterleaved<24, 4>
+                                      : ProcessNonInterleaved<24, 2>;
+            break;
+    }
+}
+
+bool AudioHandle::Impl::SelectTinyProcessFunction(size_t chns)
+{
+    if(interleaved_callback_)
+    {
+        switch(config_.blocksize)
+        {
+            case 1: process_ = ProcessTinyInterleaved<1>; return true;
+            case 2: process_ = ProcessTinyInterleaved<2>; return true;
+            case 3: process_ = ProcessTinyInterleaved<3>; return true;
+            case 4: process_ = ProcessTinyInterleaved<4>; return true;
+            default: return false;
+        }
+    }
+    if(chns > 2)
+    {
+        switch(config_.blocksize)
+        {
+            case 1: process_ = ProcessTinyNonInterleaved<4, 1>; return true;
+            case 2: process_ = ProcessTinyNonInterleaved<4, 2>; return true;
+            case 3: process_ = ProcessTinyNonInterleaved<4, 3>; return true;
+            case 4: process_ = ProcessTinyNonInterleaved<4, 4>; return true;
+            default: return false;
+        }
+    }
+    switch(config_.blocksize)
+    {
+        case 1: process_ = ProcessTinyNonInterleaved<2, 1>; return true;
+        case 2: process_ = ProcessTinyNonInterleaved<2, 2>; return true;
+        case 3: process_ = ProcessTinyNonInterleaved<2, 3>; return true;
+        case 4: process_ = ProcessTinyNonInterleaved<2, 4>; return true;
+        default: return false;
+    }
+}
+
+void DSY_AUDIO_FUNC AudioHandle::Impl::RunProcess(int32_t* in,
+                                                  int32_t* out,
+                                                  size_t   size)
+{
+    ProcessFunction process = process_;
+    if(!process)
+        return;
+    const uint32_t start = System::GetCycleCount();
+    process(in, out, size);
+    const uint32_t cycles = System::GetCycleCount() - start;
+
+    last_cycles_ = cycles;
+    if(cycles > worst_case_cycles_)
+        worst_case_cycles_ = cycles;
+    const uint32_t count = callback_count_;
+    if(count < DSY_AUDIO_COLD_START_CALLBACKS)
+        first_cycles_[count] = cycles;
+    callback_count_ = count + 1;
+}
+
+void DSY_AUDIO_FUNC AudioHandle::Impl::InternalCallback(int32_t* in,
+                                                        int32_t* out,
+                                                        size_t   size)
+{
+    if(audio_handle.samplerate_pending_)
+        audio_handle.ApplyPendingSampleRate();
+    if(audio_handle.resampling_)
+    {
+        audio_handle.pull_secondary_(size);
+        audio_handle.in2_  = audio_handle.asrc_in_;
+        audio_handle.out2_ = audio_handle.asrc_out_;
+    }
+    else if(audio_handle.sai2_.IsInitialized())
+    {
         // offset needed for 2nd audio codec.
-        // size_t offset    = audio_handle.sai2_.GetOffset();
-        size_t buff_size = size;
-        float  finbuff[buff_size], foutbuff[buff_size];
-        float* fin[chns];
-        float* fout[chns];
-        fin[0]  = finbuff;
-        fin[1]  = finbuff + (buff_size / chns);
-        fout[0] = foutbuff;
-        fout[1] = foutbuff + (buff_size / chns);
-        // if(chns > 2)
-        // {
-        //     fin[2]  = fin[1] + (buff_size / chns);
-        //     fin[3]  = fin[2] + (buff_size / chns);
-        //     fout[2] = fout[1] + (buff_size / chns);
-        //     fout[3] = fout[2] + (buff_size / chns);
-        // }
-        // Deinterleave and scale
-        // NOTE: this has been modified to reduce code size, only 24bit option is available
-        //       – original code commented out below
-        for(size_t i = 0; i < size; i += 2)
+        const size_t offset = audio_handle.sai2_.GetOffset();
+        audio_handle.in2_   = audio_handle.buff_rx_[1] + offset;
+        audio_handle.out2_  = audio_handle.buff_tx_[1] + offset;
+    }
+    audio_handle.RunProcess(in, out, size);
+    if(audio_handle.resampling_)
+        audio_handle.push_secondary_(size);
+}
+
+SaiHandle::CallbackFunctionPtr AudioHandle::Impl::InitResampling()
+{
+    // long enough windows that the interrupt jitter doesn't matter, even
+    // for small blocks
+    const size_t frames = config_.blocksize;
+    const size_t window = 16384 / frames;
+    drift_.Reset(window > 256 ? window : 256);
+    asrc_rx_.Init(2 * frames + 16, frames);
+    asrc_tx_.Init(2 * frames + 16, frames);
+    switch(sai2_.GetConfig().bit_depth)
+    {
+        case SaiHandle::Config::BitDepth::SAI_16BIT:
+            pull_secondary_ = PullSecondary<16>;
+            push_secondary_ = PushSecondary<16>;
+            return SecondaryCallback<16>;
+        case SaiHandle::Config::BitDepth::SAI_32BIT:
+            pull_secondary_ = PullSecondary<32>;
+            push_secondary_ = PushSecondary<32>;
+            return SecondaryCallback<32>;
+        case SaiHandle::Config::BitDepth::SAI_24BIT:
+        default:
+            pull_secondary_ = PullSecondary<24>;
+            push_secondary_ = PushSecondary<24>;
+            return SecondaryCallback<24>;
+    }
+}
+
+template <int Bits>
+void DSY_AUDIO_FUNC AudioHandle::Impl::SecondaryCallback(int32_t* in,
+                                                         int32_t* out,
+                                                         size_t   size)
+{
+    // Both SAI interrupts have the same priority, so this never runs in
+    // the middle of the first SAI's callback, and the scratch is shared.
+    Impl&          ah      = audio_handle;
+    float*         scratch = ah.asrc_scratch_;
+    const uint32_t now     = System::GetTick();
+    ah.drift_.MarkSecondary(now);
+    audio_convert::ToFloatBlock<Bits>(in, scratch, size, 1.f);
+    ah.asrc_rx_.Write(scratch, size / 2, now);
+    ah.asrc_tx_.Read(scratch, size / 2, 1.f / ah.drift_.GetRatio(), now);
+    audio_convert::FromFloatBlock<Bits>(scratch, out, size, 1.f);
+}
+
+template <int Bits>
+void DSY_AUDIO_FUNC AudioHandle::Impl::PullSecondary(size_t size)
+{
+    Impl&          ah   = audio_handle;
+    const uint32_t now  = System::GetTick();
+    const float    rate = ah.drift_.GetRatio();
+    ah.drift_.MarkPrimary(now);
+    ah.asrc_rx_.Read(ah.asrc_scratch_, size / 2, rate, now);
+    audio_convert::FromFloatBlock<Bits>(
+        ah.asrc_scratch_, ah.asrc_in_, size, 1.f);
+}
+
+template <int Bits>
+void DSY_AUDIO_FUNC AudioHandle::Impl::PushSecondary(size_t size)
+{
+    Impl& ah = audio_handle;
+    audio_convert::ToFloatBlock<Bits>(
+        ah.asrc_out_, ah.asrc_scratch_, size, 1.f);
+    ah.asrc_tx_.Write(ah.asrc_scratch_, size / 2, System::GetTick());
+}
+
+void DSY_AUDIO_FUNC AudioHandle::Impl::ExchangeCallback(int32_t* in,
+                                                        int32_t* out,
+                                                        size_t   size)
+{
+    Impl&          ah      = audio_handle;
+    const size_t   depth   = ah.config_.buffer_depth;
+    const size_t   bytes   = size * sizeof(int32_t);
+    const bool     has_two = ah.sai2_.IsInitialized();
+    const size_t   offset  = has_two ? ah.sai2_.GetOffset() : 0;
+    const uint32_t block   = ah.blocks_exchanged_;
+
+    if(ah.samplerate_pending_)
+        ah.ApplyPendingSampleRate();
+
+    // The second SAI's blocks are the resampled ones when it has its own
+    // clock, or the halves of its DMA buffers the DMA isn't in.
+    int32_t* in2  = has_two ? ah.buff_rx_[1] + offset : nullptr;
+    int32_t* out2 = has_two ? ah.buff_tx_[1] + offset : nullptr;
+    if(ah.resampling_)
+    {
+        ah.pull_secondary_(size);
+        in2  = ah.asrc_in_;
+        out2 = ah.asrc_out_;
+    }
+
+    // The output due now belongs to the block received depth - 1 blocks ago.
+    // Before the ring has filled up the output stays silent.
+    if(block >= depth - 1)
+    {
+        const uint32_t due  = block - (depth - 1);
+        const size_t   slot = (due % depth) * size;
+        if(ah.blocks_processed_ > due)
         {
-            fin[0][i / 2] = s242f(in[i]) * audio_handle.postgain_recip_;
-            fin[1][i / 2] = s242f(in[i + 1]) * audio_handle.postgain_recip_;
+            std::memcpy(out, ah.ring_tx_[0] + slot, bytes);
+            if(has_two)
+                std::memcpy(out2, ah.ring_tx_[1] + slot, bytes);
         }
-        // switch(bd)
-        // {
-        //     // case SaiHandle::Config::BitDepth::SAI_16BIT:
-        //     //     for(size_t i = 0; i < size; i += 2)
-        //     //     {
-        //     //         fin[0][i / 2] = s162f(in[i]) * audio_handle.postgain_recip_;
-        //     //         fin[1][i / 2]
-        //     //             = s162f(in[i + 1]) * audio_handle.postgain_recip_;
-        //     //         // if(chns > 2)
-        //     //         // {
-        //     //         //     fin[2][i / 2]
-        //     //         //         = s162f(audio_handle.buff_rx_[1][offset + i])
-        //     //         //           * audio_handle.postgain_recip_;
-        //     //         //     fin[3][i / 2]
-        //     //         //         = s162f(audio_handle.buff_rx_[1][offset + i + 1])
-        //     //         //           * audio_handle.postgain_recip_;
-        //     //         // }
-        //     //     }
-        //     //     break;
-        //     // case SaiHandle::Config::BitDepth::SAI_24BIT:
-        //     for(size_t i = 0; i < size; i += 2)
-        //     {
-        //         fin[0][i / 2] = s242f(in[i]) * audio_handle.postgain_recip_;
-        //         fin[1][i / 2] = s242f(in[i + 1]) * audio_handle.postgain_recip_;
-        //         // if(chns > 2)
-        //         // {
-        //         //     fin[2][i / 2]
-        //         //         = s242f(audio_handle.buff_rx_[1][offset + i])
-        //         //           * audio_handle.postgain_recip_;
-        //         //     fin[3][i / 2]
-        //         //         = s242f(audio_handle.buff_rx_[1][offset + i + 1])
-        //         //           * audio_handle.postgain_recip_;
-        //         // }
-        //     }
-        //     break;
-        //     // case SaiHandle::Config::BitDepth::SAI_32BIT:
-        //     //     for(size_t i = 0; i < size; i += 2)
-        //     //     {
-        //     //         fin[0][i / 2] = s322f(in[i]) * audio_handle.postgain_recip_;
-        //     //         fin[1][i / 2]
-        //     //             = s322f(in[i + 1]) * audio_handle.postgain_recip_;
-        //     //         // if(chns > 2)
-        //     //         // {
-        //     //         //     fin[2][i / 2]
-        //     //         //         = s322f(audio_handle.buff_rx_[1][offset + i])
-        //     //         //           * audio_handle.postgain_recip_;
-        //     //         //     fin[3][i / 2]
-        //     //         //         = s322f(audio_handle.buff_rx_[1][offset + i + 1])
-        //     //         //           * audio_handle.postgain_recip_;
-        //     //         // }
-        //     //     }
-        //     //     break;
-        //     //     default: break;
-        //     // }
-        cb(fin, fout, size / 2);
-        // Reinterleave and scale
-        // NOTE: this has been modified to reduce code size, only 24bit option is available
-        //       – original code commented out below
-        for(size_t i = 0; i < size; i += 2)
+        else
         {
-            out[i]     = f2s24(fout[0][i / 2] * audio_handle.output_adjust_);
-            out[i + 1] = f2s24(fout[1][i / 2] * audio_handle.output_adjust_);
+            std::memset(out, 0, bytes);
+            if(has_two)
+                std::memset(out2, 0, bytes);
+            ah.underruns_ = ah.underruns_ + 1;
         }
-        // switch(bd)
-        // {
-        //     case SaiHandle::Config::BitDepth::SAI_16BIT:
-        //         for(size_t i = 0; i < size; i += 2)
-        //         {
-        //             out[i]
-        //                 = f2s16(fout[0][i / 2] * audio_handle.output_adjust_);
-        //             out[i + 1]
-        //                 = f2s16(fout[1][i / 2] * audio_handle.output_adjust_);
-        //             // if(chns > 2)
-        //             // {
-        //             //     audio_handle.buff_tx_[1][offset + i] = f2s16(
-        //             //         fout[2][i / 2] * audio_handle.output_adjust_);
-        //             //     audio_handle.buff_tx_[1][offset + i + 1] = f2s16(
-        //             //         fout[3][i / 2] * audio_handle.output_adjust_);
-        //             // }
-        //         }
-        //         break;
-        //     case SaiHandle::Config::BitDepth::SAI_24BIT:
-        //         for(size_t i = 0; i < size; i += 2)
-        //         {
-        //             out[i]
-        //                 = f2s24(fout[0][i / 2] * audio_handle.output_adjust_);
-        //             out[i + 1]
-        //                 = f2s24(fout[1][i / 2] * audio_handle.output_adjust_);
-        //             // if(chns > 2)
-        //             // {
-        //             //     audio_handle.buff_tx_[1][offset + i] = f2s24(
-        //             //         fout[2][i / 2] * audio_handle.output_adjust_);
-        //             //     audio_handle.buff_tx_[1][offset + i + 1] = f2s24(
-        //             //         fout[3][i / 2] * audio_handle.output_adjust_);
-        //             // }
-        //         }
-        //         break;
-        //     case SaiHandle::Config::BitDepth::SAI_32BIT:
-        //         for(size_t i = 0; i < size; i += 2)
-        //         {
-        //             out[i]
-        //                 = f2s32(fout[0][i / 2] * audio_handle.output_adjust_);
-        //             out[i + 1]
-        //                 = f2s32(fout[1][i / 2] * audio_handle.output_adjust_);
-        //             // if(chns > 2)
-        //             // {
-        //             //     audio_handle.buff_tx_[1][offset + i] = f2s32(
-        //             //         fout[2][i / 2] * audio_handle.output_adjust_);
-        //             //     audio_handle.buff_tx_[1][offset + i + 1] = f2s32(
-        //             //         fout[3][i / 2] * audio_handle.output_adjust_);
-        //             // }
-        //         }
-        //         break;
-        //     default: break;
-        // }
     }
+    else
+    {
+        std::memset(out, 0, bytes);
+        if(has_two)
+            std::memset(out2, 0, bytes);
+    }
+
+    // The slot of this block last held the one that was just played.
+    const size_t slot = (block % depth) * size;
+    std::memcpy(ah.ring_rx_[0] + slot, in, bytes);
+    if(has_two)
+        std::memcpy(ah.ring_rx_[1] + slot, in2, bytes);
+    if(ah.resampling_)
+        ah.push_secondary_(size);
+    ah.blocks_exchanged_ = block + 1;
+
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessPending()
+{
+    const size_t depth = config_.buffer_depth;
+    const size_t size  = config_.blocksize * GetSlotsPerBuffer();
+    uint32_t     head;
+    while(blocks_processed_ != (head = blocks_exchanged_))
+    {
+        uint32_t block = blocks_processed_;
+        // Skip blocks whose output slot has already been played out
+        if(head - block > depth - 1)
+            block = head - (depth - 1);
+
+        const size_t slot = (block % depth) * size;
+        if(sai2_.IsInitialized())
+        {
+            in2_  = ring_rx_[1] + slot;
+            out2_ = ring_tx_[1] + slot;
+        }
+        RunProcess(ring_rx_[0] + slot, ring_tx_[0] + slot, size);
+        blocks_processed_ = block + 1;
+    }
+}
+
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessNative(int32_t* in,
+                                                     int32_t* out,
+                                                     size_t   size)
+{
+    // Native callbacks get the DMA buffers as-is, with no scratch buffers
+    NativeAudioCallback cb = (NativeAudioCallback)audio_handle.native_callback_;
+    if(cb)
+        cb(in, out, size);
+}
+
+// The conversion loops live in hid/audio_convert.h
+template <int Bits>
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessInterleaved(int32_t* in,
+                                                          int32_t* out,
+                                                          size_t   size)
+{
+    InterleavingAudioCallback cb
+        = (InterleavingAudioCallback)audio_handle.interleaved_callback_;
+    if(!cb)
+        return;
+    const size_t chns = audio_handle.GetSlotsPerBuffer();
+    float        fin[size];
+    float        fout[size];
+    BlockLevels  levels(chns);
+    levels.Input([&](auto&& meter) {
+        audio_convert::ToFloatBlock<Bits>(
+            in, fin, size, audio_handle.postgain_recip_, meter);
+    });
+    cb(fin, fout, size);
+    levels.Output([&](auto&& meter) {
+        audio_convert::FromFloatBlock<Bits>(
+            fout, out, size, audio_handle.output_adjust_, meter);
+    });
+    levels.Commit(size / chns);
+}
+
+template <int Bits, size_t Channels>
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessNonInterleaved(int32_t* in,
+                                                             int32_t* out,
+                                                             size_t   size)
+{
+    AudioCallback cb    = (AudioCallback)audio_handle.callback_;
+    AudioChain*   chain = audio_handle.chain_;
+    if(!cb && !chain)
+        return;
+    // size is the number of interleaved samples of one SAI
+    const size_t frames = size / 2;
+    float        finbuff[frames * Channels], foutbuff[frames * Channels];
+    float*       fin[Channels];
+    float*       fout[Channels];
+    for(size_t i = 0; i < Channels; i++)
+    {
+        fin[i]  = finbuff + i * frames;
+        fout[i] = foutbuff + i * frames;
+    }
+    // Deinterleave and scale, both SAIs in one pass for 4 channels
+    // a chain processes the output buffers in place
+    float**     dst = chain ? fout : fin;
+    const float pre = audio_handle.postgain_recip_;
+    BlockLevels levels(Channels);
+    levels.Input([&](auto&& meter) {
+        if(Channels > 2)
+            audio_convert::DeinterleaveStereoPair<Bits>(
+                in, audio_handle.in2_, dst, frames, pre, meter);
+        else
+            audio_convert::DeinterleaveStereo<Bits>(
+                in, dst, frames, pre, meter);
+    });
+
+    if(chain)
+        chain->Process(fout, frames);
+    else
+        cb(fin, fout, frames);
+
+    // Reinterleave and scale
+    const float post = audio_handle.output_adjust_;
+    levels.Output([&](auto&& meter) {
+        if(Channels > 2)
+            audio_convert::InterleaveStereoPair<Bits>(
+                fout, out, audio_handle.out2_, frames, post, meter);
+        else
+            audio_convert::InterleaveStereo<Bits>(
+                fout, out, frames, post, meter);
+    });
+    levels.Commit(frames);
+}
+
+template <int Bits>
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessTdm(int32_t* in,
+                                                  int32_t* out,
+                                                  size_t   size)
+{
+    AudioCallback cb    = (AudioCallback)audio_handle.callback_;
+    AudioChain*   chain = audio_handle.chain_;
+    if(!cb && !chain)
+        return;
+    // all channels arrive in one frame of slots on a single SAI
+    const size_t chns   = audio_handle.GetChannels();
+    const size_t frames = size / chns;
+    float        finbuff[frames * chns], foutbuff[frames * chns];
+    float*       fin[chns];
+    float*       fout[chns];
+    for(size_t i = 0; i < chns; i++)
+    {
+        fin[i]  = finbuff + i * frames;
+        fout[i] = foutbuff + i * frames;
+    }
+
+    float**     dst = chain ? fout : fin;
+    BlockLevels levels(chns);
+    levels.Input([&](auto&& meter) {
+        audio_convert::Deinterleave<Bits>(
+            in, dst, chns, frames, audio_handle.postgain_recip_, meter);
+    });
+    if(chain)
+        chain->Process(fout, frames);
+    else
+        cb(fin, fout, frames);
+    levels.Output([&](auto&& meter) {
+        audio_convert::Interleave<Bits>(
+            fout, out, chns, frames, audio_handle.output_adjust_, meter);
+    });
+    levels.Commit(frames);
+}
+
+template <size_t Frames>
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessTinyInterleaved(int32_t* in,
+                                                              int32_t* out,
+                                                              size_t)
+{
+    static_assert(Frames <= kAudioMaxTinyBlockSize, "block too large");
+    InterleavingAudioCallback cb
+        = (InterleavingAudioCallback)audio_handle.interleaved_callback_;
+    if(!cb)
+        return;
+    float       fin[Frames * 2];
+    float       fout[Frames * 2];
+    BlockLevels levels(2);
+    levels.Input([&](auto&& meter) {
+        audio_convert::ToFloatBlock<24>(
+            in, fin, Frames * 2, audio_handle.postgain_recip_, meter);
+    });
+    cb(fin, fout, Frames * 2);
+    levels.Output([&](auto&& meter) {
+        audio_convert::FromFloatBlock<24>(
+            fout, out, Frames * 2, audio_handle.output_adjust_, meter);
+    });
+    levels.Commit(Frames);
+}
+
+template <size_t Channels, size_t Frames>
+void DSY_AUDIO_FUNC AudioHandle::Impl::ProcessTinyNonInterleaved(int32_t* in,
+                                                                 int32_t* out,
+                                                                 size_t)
+{
+    static_assert(Frames <= kAudioMaxTinyBlockSize, "block too large");
+    AudioCallback cb    = (AudioCallback)audio_handle.callback_;
+    AudioChain*   chain = audio_handle.chain_;
+    if(!cb && !chain)
+        return;
+    float  finbuff[Channels][Frames], foutbuff[Channels][Frames];
+    float* fin[Channels];
+    float* fout[Channels];
+    for(size_t i = 0; i < Channels; i++)
+    {
+        fin[i]  = finbuff[i];
+        fout[i] = foutbuff[i];
+    }
+
+    float**     dst = chain ? fout : fin;
+    const float pre = audio_handle.postgain_recip_;
+    BlockLevels levels(Channels);
+    levels.Input([&](auto&& meter) {
+        if(Channels > 2)
+            audio_convert::DeinterleaveStereoPair<24>(
+                in, audio_handle.in2_, dst, Frames, pre, meter);
+        else
+            audio_convert::DeinterleaveStereo<24>(
+                in, dst, Frames, pre, meter);
+    });
+
+    if(chain)
+        chain->Process(fout, Frames);
+    else
+        cb(fin, fout, Frames);
+
+    const float post = audio_handle.output_adjust_;
+    levels.Output([&](auto&& meter) {
+        if(Channels > 2)
+            audio_convert::InterleaveStereoPair<24>(
+                fout, out, audio_handle.out2_, Frames, post, meter);
+        else
+            audio_convert::InterleaveStereo<24>(
+                fout, out, Frames, post, meter);
+    });
+    levels.Commit(Frames);
+}
+
+// ================================================================
+// Deferred Processing Interrupt
+// ================================================================
+
+extern "C" void DSY_AUDIO_FUNC PendSV_Handler(void)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::AUDIO);
+    audio_handle.ProcessPending();
 }
 
 // ================================================================
@@ -546,6 +1221,12 @@ AudioHandle::SetSampleRate(SaiHandle::Config::SampleRate samplerate)
     return pimpl_->SetSampleRate(samplerate);
 }
 
+AudioHandle::Result
+AudioHandle::ChangeSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    return pimpl_->ChangeSampleRate(samplerate);
+}
+
 AudioHandle::Result AudioHandle::Start(AudioCallback callback)
 {
     return pimpl_->Start(callback);
@@ -556,6 +1237,58 @@ AudioHandle::Result AudioHandle::Start(InterleavingAudioCallback callback)
     return pimpl_->Start(callback);
 }
 
+AudioHandle::Result AudioHandle::Start(NativeAudioCallback callback)
+{
+    return pimpl_->Start(callback);
+}
+
+AudioHandle::Result AudioHandle::Start(AudioChain& chain)
+{
+    return pimpl_->Start(chain);
+}
+
+AudioHandle::CallbackStats AudioHandle::GetCallbackStats() const
+{
+    return pimpl_->GetCallbackStats();
+}
+
+void AudioHandle::ResetCallbackStats()
+{
+    pimpl_->ResetCallbackStats();
+}
+
+void AudioHandle::SetMetering(bool enable)
+{
+    pimpl_->metering_ = enable;
+}
+
+AudioHandle::Level AudioHandle::GetInputLevel(size_t channel) const
+{
+    return pimpl_->GetLevel(pimpl_->levels_in_, channel);
+}
+
+AudioHandle::Level AudioHandle::GetOutputLevel(size_t channel) const
+{
+    return pimpl_->GetLevel(pimpl_->levels_out_, channel);
+}
+
+void AudioHandle::ResetLevels()
+{
+    pimpl_->ResetLevels();
+}
+
+float AudioHandle::GetSecondaryDriftPpm() const
+{
+    return pimpl_->resampling_ ? pimpl_->drift_.GetDriftPpm() : 0.f;
+}
+
+uint32_t AudioHandle::GetSecondarySlips() const
+{
+    return pimpl_->resampling_
+               ? pimpl_->asrc_rx_.GetSlips() + pimpl_->asrc_tx_.GetSlips()
+               : 0;
+}
+
 AudioHandle::Result AudioHandle::Stop()
 {
     return pimpl_->Stop();
@@ -572,6 +1305,16 @@ AudioHandle::ChangeCallback(InterleavingAudioCallback callback)
     return pimpl_->ChangeCallback(callback);
 }
 
+AudioHandle::Result AudioHandle::ChangeCallback(NativeAudioCallback callback)
+{
+    return pimpl_->ChangeCallback(callback);
+}
+
+AudioHandle::Result AudioHandle::ChangeCallback(AudioChain& chain)
+{
+    return pimpl_->ChangeCallback(chain);
+}
+
 AudioHandle::Result AudioHandle::SetPostGain(float val)
 {
     return pimpl_->SetPostGain(val);
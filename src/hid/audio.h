@@ -3,8 +3,16 @@
 
 #include "per/sai.h"
 
+/** Number of callbacks after the start whose durations are kept in
+ ** AudioHandle::CallbackStats::first_cycles */
+#ifndef DSY_AUDIO_COLD_START_CALLBACKS
+#define DSY_AUDIO_COLD_START_CALLBACKS 8
+#endif
+
 namespace daisy
 {
+class AudioChain;
+
 /** @brief Audio Engine Handle
  *  @ingroup audio
  *  @details This class allows for higher level access to an audio engine.
@@ -26,7 +34,12 @@ class AudioHandle
     /** TODO: Figure out how to get samplerate in here. */
     struct Config
     {
-        /** number of samples to process per callback */
+        /** number of samples to process per callback
+         *  Blocks of 1 to 4 samples at 24 bit use a low-latency path with
+         *  fixed size, fully unrolled conversion. The round-trip latency of
+         *  the buffering is 2 blocks (i.e. 4 samples or 83us at 48kHz with a
+         *  blocksize of 2) plus the filter delay of the codec.
+         */
         size_t blocksize = 48;
 
         /**< Sample rate of audio */
@@ -40,6 +53,34 @@ class AudioHandle
          *  have unequal input/output ranges
          */
         float output_compensation = 1.f;
+
+        /** number of blocks in flight between the callback and the codec (2-4)
+         *  With 2 (double buffering) the callback runs in the DMA interrupt,
+         *  and has to finish within one block.
+         *  With 3 or 4 the DMA interrupt only exchanges blocks with a ring
+         *  buffer, and the callback runs one or two blocks ahead at the lowest
+         *  interrupt priority (PendSV). Occasional long callbacks are then
+         *  absorbed, at the cost of one block of latency per extra stage.
+         *  The maximum blocksize is reduced to 1024 / (2 * (2 + depth)).
+         */
+        size_t buffer_depth = 2;
+
+        /** resamples the audio of the second SAI to the clock of the first
+         *  one, and back, for two SAIs that don't share a clock, e.g. an
+         *  external codec that's the clock master of SAI2.
+         *  Without it the two clocks drift apart, and the audio of the
+         *  second codec clicks each time they slip by a block.
+         *  The drift is measured from the DMA interrupts of both SAIs, see
+         *  GetSecondaryDriftPpm(). Adds about two blocks of latency to the
+         *  second codec, and limits the blocksize to 128.
+         */
+        bool resample_secondary = false;
+
+        /** measures the peak and RMS level of each input and output
+         *  channel while converting the samples, see GetInputLevel().
+         *  Costs a few cycles per sample, and nothing when it's off.
+         */
+        bool metering = false;
     };
 
     enum class Result
@@ -84,6 +125,46 @@ class AudioHandle
                                               InterleavingOutputBuffer out,
                                               size_t                   size);
 
+    /** Native Audio Callback
+     ** Receives the raw interleaved DMA half-buffers as they are exchanged
+     ** with the SAI, without any conversion or level adjustment.
+     ** Samples are 24 bit, right-aligned in each word: { L0, R0, L1, R1, . . . }
+     ** size is the total number of samples in the buffer (frames * channels).
+     */
+    typedef void (*NativeAudioCallback)(const int32_t* in,
+                                        int32_t*       out,
+                                        size_t         size);
+
+    /** Timing statistics of the audio callback
+     ** Durations include the sample format conversion, and are measured
+     ** with the DWT cycle counter (CPU clock cycles).
+     */
+    struct CallbackStats
+    {
+        /** number of callbacks since the last reset */
+        uint32_t callback_count;
+
+        /** callbacks that were still running when the next DMA
+         ** half-transfer completed (i.e. audio was dropped or repeated)
+         ** With buffer_depth > 2 this counts the blocks that were not
+         ** processed in time, and were replaced by silence.
+         */
+        uint32_t missed_deadlines;
+
+        /** duration of the most recent callback in cycles */
+        uint32_t last_cycles;
+
+        /** longest callback duration in cycles since the last reset */
+        uint32_t worst_case_cycles;
+
+        /** durations in cycles of the first callbacks since the last
+         ** reset, 0 for the ones that didn't run yet. After a boot these
+         ** are slower than the rest while the caches fill, most of all
+         ** when running from the QSPI flash, see DSY_SRAM_FUNC.
+         */
+        uint32_t first_cycles[DSY_AUDIO_COLD_START_CALLBACKS];
+    };
+
     AudioHandle() : pimpl_(nullptr) {}
     ~AudioHandle() {}
 
@@ -105,9 +186,8 @@ class AudioHandle
     /** Returns the number of channels of audio.
      **
      ** When using a single SAI this returns 2, when using two SAI it returns 4
+     ** With a single SAI in TDM mode this returns the number of slots.
      ** If no SAI is initialized this returns 0
-     **
-     ** Eventually when we add non-standard I2S for each SAI this will be work differently
      */
     size_t GetChannels() const;
 
@@ -117,6 +197,16 @@ class AudioHandle
     /** Sets the samplerate, and reinitializes the sai as needed. */
     Result SetSampleRate(SaiHandle::Config::SampleRate samplerate);
 
+    /** Changes the samplerate while the audio is running, without stopping
+     ** the DMA or reinitializing the SAI (and the codec).
+     ** The SAI master clock dividers are reprogrammed at the start of the next
+     ** callback, so the gap is only about one frame. GetSampleRate() returns
+     ** the new rate once it has been applied.
+     ** If the audio isn't running this is the same as SetSampleRate().
+     ** Returns ERR if the SAI clocks are generated externally (slave mode).
+     */
+    Result ChangeSampleRate(SaiHandle::Config::SampleRate samplerate);
+
     /** Sets the block size after initialization, and updates the internal configuration struct.
      ** Get BlockSize and other details via the GetConfig
      */
@@ -140,22 +230,84 @@ class AudioHandle
     Result Start(AudioCallback callback);
 
     /** Starts the Audio using the interleaving callback.
-     ** For now only two channels are supported via this method.
-     ** @warning INTERLEAVING CALLBACKS DISABLED IN THIS BRANCH
+     ** For now only two channels are supported via this method,
+     ** except for a TDM SAI, where all slots are passed interleaved.
      */
     Result Start(InterleavingAudioCallback callback);
 
+    /** Starts the Audio using the native callback.
+     ** The DMA buffers are passed straight to the callback, and no
+     ** postgain or output compensation is applied.
+     */
+    Result Start(NativeAudioCallback callback);
+
+    /** Starts the Audio running a chain of stages in place, instead of a
+     ** callback, see AudioChain. The chain has to outlive the audio.
+     */
+    Result Start(AudioChain& chain);
+
+    /** Returns the callback timing statistics gathered since the audio was
+     ** started, or since the last call to ResetCallbackStats()
+     */
+    CallbackStats GetCallbackStats() const;
+
+    /** Resets all callback timing statistics to zero */
+    void ResetCallbackStats();
+
+    /** Level of one channel, measured in the conversion of the samples */
+    struct Level
+    {
+        float peak; /**< largest magnitude, above 1 when clipping */
+        float rms;  /**< root of the mean of the squares */
+    };
+
+    /** Turns the level metering on or off, see Config::metering */
+    void SetMetering(bool enable);
+
+    /** Returns the level of an input channel since the audio was started,
+     ** or since the last call to ResetLevels(), as the callback got it,
+     ** after the postgain.
+     ** Only measured with metering on, and not for the native callback.
+     */
+    Level GetInputLevel(size_t channel) const;
+
+    /** Returns the level of an output channel as the callback wrote it,
+     ** before the output compensation and the clipping, see
+     ** GetInputLevel()
+     */
+    Level GetOutputLevel(size_t channel) const;
+
+    /** Starts a new level measurement, e.g. once per meter refresh */
+    void ResetLevels();
+
+    /** Returns how much faster the clock of the second SAI runs than the
+     ** one of the first, in parts per million
+     ** Only measured with Config::resample_secondary, 0 until the first
+     ** measurement is done, about a third of a second after the start.
+     */
+    float GetSecondaryDriftPpm() const;
+
+    /** Returns how often the resampling of the second SAI ran out of, or
+     ** overflowed with audio, e.g. when its clock stopped. Each one is a
+     ** short gap in the audio of the second codec.
+     */
+    uint32_t GetSecondarySlips() const;
+
     /** Stop the Audio*/
     Result Stop();
 
     /** Immediatley changes the audio callback to the non-interleaving callback passed in. */
     Result ChangeCallback(AudioCallback callback);
 
-    /** Immediatley changes the audio callback to the interleaving callback passed in.
-     ** @warning INTERLEAVING CALLBACKS DISABLED IN THIS BRANCH
-     */
+    /** Immediatley changes the audio callback to the interleaving callback passed in. */
     Result ChangeCallback(InterleavingAudioCallback callback);
 
+    /** Immediatley changes the audio callback to the native callback passed in. */
+    Result ChangeCallback(NativeAudioCallback callback);
+
+    /** Immediatley changes the audio callback to a chain of stages. */
+    Result ChangeCallback(AudioChain& chain);
+
 
     class Impl;
 
@@ -0,0 +1,322 @@
+#pragma once
+#ifndef DSY_AUDIO_ASRC_H
+#define DSY_AUDIO_ASRC_H /**< & */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Measures the drift between two clocks from the times of their
+ *  block interrupts
+ *  @ingroup audio
+ *  @details Each stream marks the time at its interrupts, e.g. with
+ *           System::GetTick(), which keeps counting while the CPU sleeps.
+ *           The period of the blocks of each stream is averaged over a
+ *           window of blocks, so the latency jitter of the interrupts
+ *           hardly matters, and a new estimate is made at the end of each
+ *           window. The count may wrap, as long as a window is shorter
+ *           than 2^32 counts (about 17s at 240MHz).
+ */
+class ClockDriftMeter
+{
+  public:
+    ClockDriftMeter() { Reset(); }
+
+    /** Forgets all measurements
+     *  \param window blocks per estimate, e.g. 256
+     */
+    void Reset(uint32_t window = 256)
+    {
+        window_ = window > 0 ? window : 1;
+        for(auto& s : streams_)
+            s = Stream{0, 0, 0.f};
+        ratio_ = 1.f;
+        valid_ = false;
+    }
+
+    /** Marks an interrupt of the primary stream, e.g. SAI1 */
+    void MarkPrimary(uint32_t now) { Mark(streams_[0], now); }
+
+    /** Marks an interrupt of the secondary stream, e.g. SAI2 */
+    void MarkSecondary(uint32_t now) { Mark(streams_[1], now); }
+
+    /** Returns true once both streams have been measured over a window */
+    bool IsValid() const { return valid_; }
+
+    /** Returns the rate of the secondary stream over the rate of the
+     *  primary one, in blocks per block, 1 until it's valid
+     */
+    float GetRatio() const { return ratio_; }
+
+    /** Returns how much faster the secondary clock runs, in parts per
+     *  million
+     */
+    float GetDriftPpm() const { return (ratio_ - 1.f) * 1e6f; }
+
+    /** Returns the average block period of a stream in counts, 0 until
+     *  it's been measured
+     *  \param secondary false for the primary stream
+     */
+    float GetPeriod(bool secondary) const
+    {
+        return streams_[secondary ? 1 : 0].period;
+    }
+
+  private:
+    struct Stream
+    {
+        uint32_t start;  // time at the start of the window
+        uint32_t blocks; // interrupts since the start, 0 before the first
+        float    period; // time per block of the last window
+    };
+
+    void Mark(Stream& s, uint32_t now)
+    {
+        if(s.blocks == 0)
+        {
+            s.start  = now;
+            s.blocks = 1;
+            return;
+        }
+        if(s.blocks++ < window_)
+            return;
+        s.period = float(now - s.start) / float(window_);
+        s.start  = now;
+        s.blocks = 1;
+
+        const float p0 = streams_[0].period, p1 = streams_[1].period;
+        if(p0 > 0.f && p1 > 0.f)
+        {
+            ratio_ = p0 / p1;
+            valid_ = true;
+        }
+    }
+
+    Stream   streams_[2];
+    uint32_t window_;
+    float    ratio_;
+    bool     valid_;
+};
+
+/** @brief Moves audio between two clocks that drift apart
+ *  @ingroup audio
+ *  @details Frames are written in blocks at the rate of one clock, and read
+ *           at the rate of another, through a FIFO. The reader steps through
+ *           the FIFO with a ratio of input to output frames that's a bit
+ *           off 1, and interpolates between the frames with a 4 point
+ *           cubic Hermite. A control loop trims the ratio, so that the FIFO
+ *           holds target frames at each read. The clocks then can't slip
+ *           against each other, however long they run.
+ *
+ *           As the frames arrive in blocks, the fill of the FIFO at the
+ *           reads jumps by a block whenever the two clocks drift past each
+ *           other. So the loop counts the part of the next block the
+ *           writer is through as well, from the times of the calls, and
+ *           sees a fill that changes smoothly.
+ *
+ *           The ratio passed to Read() is the expected one, e.g. from a
+ *           ClockDriftMeter, so the loop only has to correct what's left.
+ *           When the FIFO runs empty or full anyway, e.g. at the start or
+ *           when a stream stops, the reader skips back to the target fill,
+ *           and GetSlips() counts it.
+ *
+ *           Write() and Read() mustn't interrupt each other, e.g. both are
+ *           called from DMA interrupts of the same priority.
+ *
+ *  @tparam Channels interleaved channels of each frame
+ *  @tparam Capacity frames the FIFO holds, a power of 2
+ */
+template <size_t Channels, size_t Capacity>
+class AsyncResampler
+{
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "Capacity has to be a power of 2");
+
+  public:
+    /** Largest correction of the ratio the control loop makes */
+    static constexpr float kMaxCorrection = 0.002f;
+
+    AsyncResampler() { Init(Capacity / 4, Capacity / 8); }
+
+    /** Empties the FIFO
+     *  \param target frames to keep in the FIFO at each read, counting the
+     *                block the writer is working on. At least two blocks,
+     *                plus a margin for the interrupt jitter.
+     *  \param block frames per Read(), to scale the control loop by
+     *  \returns false if the target doesn't fit into the FIFO
+     */
+    bool Init(size_t target, size_t block)
+    {
+        block       = block > 0 ? block : 1;
+        target_     = float(target);
+        kp_         = 1.5e-3f / float(block);
+        ki_         = 5e-7f / float(block);
+        write_idx_  = 0;
+        read_idx_   = 0;
+        frac_       = 0.f;
+        last_write_ = 0;
+        interval_   = 0.f;
+        last_count_ = 0;
+        error_      = 0.f;
+        integral_   = 0.f;
+        slips_      = 0;
+        priming_    = true;
+        for(auto& s : fifo_)
+            s = 0.f;
+        return target + block + 4 <= Capacity;
+    }
+
+    /** Adds frames to the FIFO. When it's full, the oldest frames are
+     *  dropped.
+     *  \param frames count frames, interleaved
+     *  \param now a free running count, e.g. System::GetTick()
+     */
+    void Write(const float* frames, size_t count, uint32_t now)
+    {
+        // the writer's block period, smoothed against the jitter
+        const float interval = float(now - last_write_);
+        if(last_count_ > 0 && interval_ > 0.f)
+            interval_ += 0.01f * (interval - interval_);
+        else if(last_count_ > 0)
+            interval_ = interval;
+        last_write_ = now;
+        last_count_ = count;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            float* dst = &fifo_[(write_idx_ & kMask) * Channels];
+            for(size_t c = 0; c < Channels; c++)
+                dst[c] = frames[i * Channels + c];
+            write_idx_++;
+        }
+        // one frame before the read position is kept for the interpolation
+        if(write_idx_ - read_idx_ + 1 > Capacity)
+        {
+            read_idx_ = write_idx_ + 1 - Capacity;
+            if(!priming_)
+                Slip();
+        }
+    }
+
+    /** Reads frames from the FIFO
+     *  \param frames count frames are written to it, interleaved
+     *  \param ratio expected input frames per output frame
+     *  \param now a free running count, the same as for Write()
+     */
+    void Read(float* frames, size_t count, float ratio, uint32_t now)
+    {
+        if(priming_)
+        {
+            // waits for the FIFO to fill up to the target
+            if(GetFill() < target_)
+            {
+                for(size_t i = 0; i < count * Channels; i++)
+                    frames[i] = 0.f;
+                return;
+            }
+            read_idx_ = write_idx_ - uint32_t(target_);
+            frac_     = 0.f;
+            priming_  = false;
+        }
+        Steer(now);
+        const float step = ratio * (1.f + GetCorrection());
+        for(size_t i = 0; i < count; i++)
+        {
+            if(write_idx_ - read_idx_ < 3)
+            {
+                // ran empty, silent until the FIFO has filled up again
+                for(size_t j = i * Channels; j < count * Channels; j++)
+                    frames[j] = 0.f;
+                Slip();
+                return;
+            }
+            Interpolate(&frames[i * Channels]);
+            frac_ += step;
+            const uint32_t whole = uint32_t(frac_);
+            read_idx_ += whole;
+            frac_ -= float(whole);
+        }
+    }
+
+    /** Returns the number of frames in the FIFO */
+    float GetFill() const
+    {
+        return float(write_idx_ - read_idx_) - frac_;
+    }
+
+    /** Returns the correction of the ratio the control loop makes, e.g.
+     *  0.0001 for 100ppm more input frames per output frame
+     */
+    float GetCorrection() const
+    {
+        const float c = kp_ * error_ + integral_;
+        return c > kMaxCorrection    ? kMaxCorrection
+               : c < -kMaxCorrection ? -kMaxCorrection
+                                     : c;
+    }
+
+    /** Returns how often the FIFO ran empty or full */
+    uint32_t GetSlips() const { return slips_; }
+
+  private:
+    static constexpr uint32_t kMask = Capacity - 1;
+
+    void Steer(uint32_t now)
+    {
+        // counts the frames of the next block the writer has made so far
+        float fill = GetFill();
+        if(interval_ > 0.f)
+        {
+            const float part = float(now - last_write_) / interval_;
+            fill += float(last_count_) * (part < 1.f ? part : 1.f);
+        }
+        error_ += 0.1f * ((fill - target_) - error_);
+        integral_ += ki_ * error_;
+        if(integral_ > kMaxCorrection)
+            integral_ = kMaxCorrection;
+        else if(integral_ < -kMaxCorrection)
+            integral_ = -kMaxCorrection;
+    }
+
+    void Slip()
+    {
+        slips_++;
+        priming_ = true;
+        error_   = 0.f;
+    }
+
+    void Interpolate(float* out) const
+    {
+        const float* xm1 = &fifo_[((read_idx_ - 1) & kMask) * Channels];
+        const float* x0  = &fifo_[(read_idx_ & kMask) * Channels];
+        const float* x1  = &fifo_[((read_idx_ + 1) & kMask) * Channels];
+        const float* x2  = &fifo_[((read_idx_ + 2) & kMask) * Channels];
+        const float  t   = frac_;
+        for(size_t c = 0; c < Channels; c++)
+        {
+            const float c1 = 0.5f * (x1[c] - xm1[c]);
+            const float c2 = xm1[c] - 2.5f * x0[c] + 2.f * x1[c] - 0.5f * x2[c];
+            const float c3 = 0.5f * (x2[c] - xm1[c]) + 1.5f * (x0[c] - x1[c]);
+            out[c]         = ((c3 * t + c2) * t + c1) * t + x0[c];
+        }
+    }
+
+    float    fifo_[Capacity * Channels];
+    uint32_t write_idx_;  // frames written in total
+    uint32_t read_idx_;   // frame at or before the read position
+    float    frac_;       // position between read_idx_ and the next frame
+    uint32_t last_write_; // time of the last write
+    float    interval_;   // time between writes, 0 until it's known
+    size_t   last_count_; // frames of the last write
+    float    target_;
+    float    kp_, ki_;
+    float    error_;    // smoothed fill error in frames
+    float    integral_; // integral part of the correction
+    uint32_t slips_;
+    bool     priming_;
+};
+
+} // namespace daisy
+
+#endif
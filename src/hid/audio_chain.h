@@ -0,0 +1,180 @@
+#pragma once
+#ifndef DSY_AUDIO_CHAIN_H
+#define DSY_AUDIO_CHAIN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/** Number of stages an AudioChain can hold */
+#ifndef DSY_AUDIO_CHAIN_MAX_STAGES
+#define DSY_AUDIO_CHAIN_MAX_STAGES 8
+#endif
+
+namespace daisy
+{
+/** @brief A list of audio processing stages that run one after the other,
+ *  in place on the same buffers
+ *  @ingroup audio
+ *  @details Started with AudioHandle::Start(AudioChain&) instead of a
+ *           callback. The AudioHandle converts the input right into the
+ *           output buffers, each stage then processes them in place, and
+ *           what's left in them after the last stage goes to the codec.
+ *           So a chain of e.g. input conditioning, the program's DSP and an
+ *           output limiter and meter costs no copies or buffers of its own.
+ *           Without stages, the input goes to the output as it is.
+ *
+ *           Stages can be added and removed while the audio runs. Each
+ *           change is made to a second copy of the list, which then
+ *           replaces the one the audio callback uses with a single write,
+ *           so a block is always processed by either the old or the new
+ *           list as a whole, with no locks. Changes have to be made from
+ *           one context at a time, e.g. the main loop, and not from the
+ *           stages themselves.
+ *
+ *  @code
+ *  void Limit(float* const* buf, size_t size, void* context)
+ *  {
+ *      auto* limiter = static_cast<Limiter*>(context);
+ *      limiter->ProcessBlock(buf[0], size, 1.f);
+ *      limiter->ProcessBlock(buf[1], size, 1.f);
+ *  }
+ *
+ *  AudioChain chain;
+ *  chain.Add(DcBlock);
+ *  chain.Add(Effect, &effect);
+ *  chain.Add(Limit, &limiter);
+ *  hw.StartAudio(chain);
+ *  // later, in the main loop
+ *  chain.Remove(Effect, &effect);
+ *  @endcode
+ */
+class AudioChain
+{
+  public:
+    /** A stage, processing size samples of each channel in place
+     *  \param buffer one buffer per channel, as the callback's output
+     *  \param size samples per channel
+     *  \param context the pointer passed to Add()
+     */
+    typedef void (*StageFunction)(float* const* buffer,
+                                  size_t        size,
+                                  void*         context);
+
+    AudioChain() : active_(0) { num_stages_[0] = num_stages_[1] = 0; }
+
+    /** Appends a stage to the end of the chain
+     *  \returns false if the chain is full, or stage is nullptr
+     */
+    bool Add(StageFunction stage, void* context = nullptr)
+    {
+        return Insert(GetNumStages(), stage, context);
+    }
+
+    /** Inserts a stage before the one at a position
+     *  \param position from 0 for the first stage, up to GetNumStages()
+     *  \returns false if the chain is full, position is past the end, or
+     *           stage is nullptr
+     */
+    bool Insert(size_t position, StageFunction stage, void* context = nullptr)
+    {
+        const uint8_t cur = active_;
+        const size_t  num = num_stages_[cur];
+        if(stage == nullptr || num >= DSY_AUDIO_CHAIN_MAX_STAGES
+           || position > num)
+            return false;
+        Stage* next = stages_[cur ^ 1];
+        for(size_t i = 0, j = 0; i <= num; i++)
+        {
+            if(i == position)
+                next[j++] = Stage{stage, context};
+            if(i < num)
+                next[j++] = stages_[cur][i];
+        }
+        Publish(num + 1);
+        return true;
+    }
+
+    /** Removes the first stage with a function and context
+     *  \returns false if there's no such stage
+     */
+    bool Remove(StageFunction stage, void* context = nullptr)
+    {
+        const uint8_t cur   = active_;
+        const size_t  num   = num_stages_[cur];
+        Stage*        next  = stages_[cur ^ 1];
+        bool          found = false;
+        size_t        j     = 0;
+        for(size_t i = 0; i < num; i++)
+        {
+            const Stage& s = stages_[cur][i];
+            if(!found && s.process == stage && s.context == context)
+                found = true;
+            else
+                next[j++] = s;
+        }
+        if(found)
+            Publish(j);
+        return found;
+    }
+
+    /** Removes all stages */
+    void Clear() { Publish(0); }
+
+    /** Returns the number of stages */
+    size_t GetNumStages() const { return num_stages_[active_]; }
+
+    /** Returns true if a stage with a function and context is in the
+     *  chain
+     */
+    bool Contains(StageFunction stage, void* context = nullptr) const
+    {
+        const uint8_t cur = active_;
+        for(size_t i = 0; i < num_stages_[cur]; i++)
+            if(stages_[cur][i].process == stage
+               && stages_[cur][i].context == context)
+                return true;
+        return false;
+    }
+
+    /** Runs all stages on a block, called by the AudioHandle
+     *  \param buffer one buffer per channel, holding the input
+     *  \param size samples per channel
+     */
+    void Process(float* const* buffer, size_t size) const
+    {
+        // read once, a change made by an interrupt in between takes effect
+        // with the next block
+        const uint8_t cur = active_;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        const Stage* s   = stages_[cur];
+        const size_t num = num_stages_[cur];
+        for(size_t i = 0; i < num; i++)
+            s[i].process(buffer, size, s[i].context);
+    }
+
+  private:
+    struct Stage
+    {
+        StageFunction process;
+        void*         context;
+    };
+
+    /** Makes the list that was just written the one the audio uses */
+    void Publish(size_t num)
+    {
+        const uint8_t next = active_ ^ 1;
+        num_stages_[next]  = num;
+        // the list is complete before the audio interrupt can see it
+        std::atomic_signal_fence(std::memory_order_release);
+        active_ = next;
+    }
+
+    Stage            stages_[2][DSY_AUDIO_CHAIN_MAX_STAGES];
+    size_t           num_stages_[2];
+    volatile uint8_t active_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,506 @@
+#pragma once
+#ifndef DSY_AUDIO_CONVERT_H
+#define DSY_AUDIO_CONVERT_H /**< & */
+
+#include "daisy_core.h"
+
+namespace daisy
+{
+/** @brief Block sample format conversion kernels used by the AudioHandle
+ *  @ingroup audio
+ *  @details These convert whole blocks between the interleaved integer
+ *           format of the SAI DMA buffers and the float buffers handed to
+ *           the audio callbacks.
+ *
+ *           Each kernel is templated on the bit depth of the SAI data
+ *           (16, 24 or 32), so that the AudioHandle can select the matching
+ *           instantiation once, rather than switching per sample.
+ *
+ *           The level adjustments (postgain, output compensation) are folded
+ *           into the fixed-point scale so that each sample costs a single
+ *           multiply, and the loops are unrolled by 4 frames.
+ *           On the Cortex-M7 the fixed-point forms of VCVT are used, which
+ *           combine the int<->float conversion and the 2^n scaling into one
+ *           instruction. The results are bit-identical to the s162f/f2s16,
+ *           s242f/f2s24 and s322f/f2s32 helpers in daisy_core.h.
+ *
+ *           Each kernel optionally takes a meter, e.g. a LevelMeter, that
+ *           sees every float sample as it's converted, so the levels are
+ *           measured in the same pass.
+ */
+namespace audio_convert
+{
+    /** Meter of the kernels that measures nothing, the default */
+    struct NoMeter
+    {
+        FORCE_INLINE void Add(size_t, float) {}
+        FORCE_INLINE void AddInterleaved(size_t, float) {}
+    };
+
+    /** Measures the peak and the sum of the squares of each channel of the
+     *  float samples the kernels convert.
+     */
+    struct LevelMeter
+    {
+        static constexpr size_t kMaxChannels = 16;
+
+        /** Clears the measurements
+         *  \param channels per frame, a power of two for AddInterleaved()
+         */
+        void Reset(size_t channels)
+        {
+            for(size_t c = 0; c < kMaxChannels; c++)
+                peak[c] = sum_sq[c] = 0.f;
+            mask = channels > 0 ? channels - 1 : 0;
+        }
+
+        /** Adds a sample of a channel */
+        FORCE_INLINE void Add(size_t channel, float x)
+        {
+            const float a = x < 0.f ? -x : x;
+            peak[channel] = a > peak[channel] ? a : peak[channel];
+            sum_sq[channel] += x * x;
+        }
+
+        /** Adds the sample at an index of an interleaved block */
+        FORCE_INLINE void AddInterleaved(size_t index, float x)
+        {
+            Add(index & mask, x);
+        }
+
+        float  peak[kMaxChannels];
+        float  sum_sq[kMaxChannels];
+        size_t mask;
+    };
+
+    /** Converts one sample from the SAI format to float, including
+     *  the sign extension from the top bit of the sample.
+     *  \tparam Bits bit depth of the sample (16, 24, or 32)
+     *  \param x raw sample, right-aligned in the word (upper bits are ignored)
+     *  \param gain factor applied after scaling to -1..1
+     */
+    template <int Bits>
+    FORCE_INLINE float ToFloat(int32_t x, float gain)
+    {
+        static_assert(Bits == 16 || Bits == 24 || Bits == 32,
+                      "unsupported bit depth");
+        // shifting to the top of the word and converting as Q31 performs
+        // the sign extension and the 2^-(Bits-1) scaling at once.
+        const uint32_t q31 = (uint32_t)x << (32 - Bits);
+#if defined(__ARM_FP) && !defined(UNIT_TEST)
+        float f;
+        asm("vmov %0, %1\n\t"
+            "vcvt.f32.s32 %0, %0, #31"
+            : "=t"(f)
+            : "r"(q31));
+        return f * gain;
+#else
+        return (float)(int32_t)q31 * (S322F_SCALE * gain);
+#endif
+    }
+
+    /** Converts one float sample to the SAI format with clipping.
+     *  \tparam Bits bit depth of the sample (16, 24, or 32)
+     *  \param x sample in the range -1..1
+     *  \param gain factor applied before clipping
+     */
+    template <int Bits>
+    FORCE_INLINE int32_t FromFloat(float x, float gain);
+
+    /** 16 bit samples are scaled by (2^15 - 1), so there is no
+     *  fixed-point shortcut here. */
+    template <>
+    FORCE_INLINE int32_t FromFloat<16>(float x, float gain)
+    {
+        x *= gain;
+        x = x <= FBIPMIN ? FBIPMIN : x;
+        x = x >= FBIPMAX ? FBIPMAX : x;
+        return (int32_t)(x * F2S16_SCALE);
+    }
+
+    template <>
+    FORCE_INLINE int32_t FromFloat<24>(float x, float gain)
+    {
+        x *= gain;
+        x = x <= FBIPMIN ? FBIPMIN : x;
+        x = x >= FBIPMAX ? FBIPMAX : x;
+#if defined(__ARM_FP) && !defined(UNIT_TEST)
+        // Q23 conversion performs the 2^23 scaling, and rounds toward zero.
+        int32_t r;
+        asm("vcvt.s32.f32 %1, %1, #23\n\t"
+            "vmov %0, %1"
+            : "=r"(r), "+t"(x));
+        return r;
+#else
+        return (int32_t)(x * F2S24_SCALE);
+#endif
+    }
+
+    template <>
+    FORCE_INLINE int32_t FromFloat<32>(float x, float gain)
+    {
+        x *= gain;
+        x = x <= FBIPMIN ? FBIPMIN : x;
+        x = x >= FBIPMAX ? FBIPMAX : x;
+#if defined(__ARM_FP) && !defined(UNIT_TEST)
+        // Q31 conversion, F2S32_SCALE rounds to exactly 2^31 as a float.
+        int32_t r;
+        asm("vcvt.s32.f32 %1, %1, #31\n\t"
+            "vmov %0, %1"
+            : "=r"(r), "+t"(x));
+        return r;
+#else
+        return (int32_t)(x * F2S32_SCALE);
+#endif
+    }
+
+    /** Deinterleaves a stereo block of samples into two float channels.
+     *  \tparam Bits bit depth of the samples
+     *  \param in interleaved samples { L0, R0, L1, R1, . . . }
+     *  \param out array of two channel buffers, with room for frames samples
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample
+     *  \param meter sees each float sample, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void DeinterleaveStereo(const int32_t* in,
+                                   float* const*  out,
+                                   size_t         frames,
+                                   float          gain,
+                                   Meter&&        meter = Meter())
+    {
+        float* l = out[0];
+        float* r = out[1];
+        size_t i = 0;
+        for(const size_t n = frames & ~size_t(3); i < n; i += 4, in += 8)
+        {
+            const int32_t s0 = in[0], s1 = in[1], s2 = in[2], s3 = in[3];
+            const int32_t s4 = in[4], s5 = in[5], s6 = in[6], s7 = in[7];
+            l[i]     = ToFloat<Bits>(s0, gain);
+            r[i]     = ToFloat<Bits>(s1, gain);
+            l[i + 1] = ToFloat<Bits>(s2, gain);
+            r[i + 1] = ToFloat<Bits>(s3, gain);
+            l[i + 2] = ToFloat<Bits>(s4, gain);
+            r[i + 2] = ToFloat<Bits>(s5, gain);
+            l[i + 3] = ToFloat<Bits>(s6, gain);
+            r[i + 3] = ToFloat<Bits>(s7, gain);
+            for(size_t k = 0; k < 4; k++)
+            {
+                meter.Add(0, l[i + k]);
+                meter.Add(1, r[i + k]);
+            }
+        }
+        for(; i < frames; i++, in += 2)
+        {
+            l[i] = ToFloat<Bits>(in[0], gain);
+            r[i] = ToFloat<Bits>(in[1], gain);
+            meter.Add(0, l[i]);
+            meter.Add(1, r[i]);
+        }
+    }
+
+    /** Interleaves two float channels into a stereo block of samples.
+     *  \tparam Bits bit depth of the samples
+     *  \param in array of two channel buffers
+     *  \param out interleaved destination { L0, R0, L1, R1, . . . }
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample before clipping
+     *  \param meter sees each float sample before the gain, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void InterleaveStereo(const float* const* in,
+                                 int32_t*            out,
+                                 size_t              frames,
+                                 float               gain,
+                                 Meter&&             meter = Meter())
+    {
+        const float* l = in[0];
+        const float* r = in[1];
+        size_t       i = 0;
+        for(const size_t n = frames & ~size_t(3); i < n; i += 4, out += 8)
+        {
+            out[0] = FromFloat<Bits>(l[i], gain);
+            out[1] = FromFloat<Bits>(r[i], gain);
+            out[2] = FromFloat<Bits>(l[i + 1], gain);
+            out[3] = FromFloat<Bits>(r[i + 1], gain);
+            out[4] = FromFloat<Bits>(l[i + 2], gain);
+            out[5] = FromFloat<Bits>(r[i + 2], gain);
+            out[6] = FromFloat<Bits>(l[i + 3], gain);
+            out[7] = FromFloat<Bits>(r[i + 3], gain);
+            for(size_t k = 0; k < 4; k++)
+            {
+                meter.Add(0, l[i + k]);
+                meter.Add(1, r[i + k]);
+            }
+        }
+        for(; i < frames; i++, out += 2)
+        {
+            out[0] = FromFloat<Bits>(l[i], gain);
+            out[1] = FromFloat<Bits>(r[i], gain);
+            meter.Add(0, l[i]);
+            meter.Add(1, r[i]);
+        }
+    }
+
+    /** Deinterleaves the stereo blocks of two SAIs into four float channels
+     *  in one pass, as used for 4 channels (e.g. the Daisy Patch).
+     *  \tparam Bits bit depth of the samples
+     *  \param in1 interleaved samples of the 1st SAI -> channels 0 and 1
+     *  \param in2 interleaved samples of the 2nd SAI -> channels 2 and 3
+     *  \param out array of four channel buffers, with room for frames samples
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample
+     *  \param meter sees each float sample, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void DeinterleaveStereoPair(const int32_t* in1,
+                                       const int32_t* in2,
+                                       float* const*  out,
+                                       size_t         frames,
+                                       float          gain,
+                                       Meter&&        meter = Meter())
+    {
+        float* c0 = out[0];
+        float* c1 = out[1];
+        float* c2 = out[2];
+        float* c3 = out[3];
+        size_t i  = 0;
+        for(const size_t n = frames & ~size_t(1); i < n;
+            i += 2, in1 += 4, in2 += 4)
+        {
+            const int32_t a0 = in1[0], a1 = in1[1], a2 = in1[2], a3 = in1[3];
+            const int32_t b0 = in2[0], b1 = in2[1], b2 = in2[2], b3 = in2[3];
+            c0[i]     = ToFloat<Bits>(a0, gain);
+            c1[i]     = ToFloat<Bits>(a1, gain);
+            c2[i]     = ToFloat<Bits>(b0, gain);
+            c3[i]     = ToFloat<Bits>(b1, gain);
+            c0[i + 1] = ToFloat<Bits>(a2, gain);
+            c1[i + 1] = ToFloat<Bits>(a3, gain);
+            c2[i + 1] = ToFloat<Bits>(b2, gain);
+            c3[i + 1] = ToFloat<Bits>(b3, gain);
+            for(size_t k = 0; k < 2; k++)
+            {
+                meter.Add(0, c0[i + k]);
+                meter.Add(1, c1[i + k]);
+                meter.Add(2, c2[i + k]);
+                meter.Add(3, c3[i + k]);
+            }
+        }
+        if(i < frames)
+        {
+            c0[i] = ToFloat<Bits>(in1[0], gain);
+            c1[i] = ToFloat<Bits>(in1[1], gain);
+            c2[i] = ToFloat<Bits>(in2[0], gain);
+            c3[i] = ToFloat<Bits>(in2[1], gain);
+            meter.Add(0, c0[i]);
+            meter.Add(1, c1[i]);
+            meter.Add(2, c2[i]);
+            meter.Add(3, c3[i]);
+        }
+    }
+
+    /** Interleaves four float channels into the stereo blocks of two SAIs
+     *  in one pass.
+     *  \tparam Bits bit depth of the samples
+     *  \param in array of four channel buffers
+     *  \param out1 interleaved destination of channels 0 and 1
+     *  \param out2 interleaved destination of channels 2 and 3
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample before clipping
+     *  \param meter sees each float sample before the gain, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void InterleaveStereoPair(const float* const* in,
+                                     int32_t*            out1,
+                                     int32_t*            out2,
+                                     size_t              frames,
+                                     float               gain,
+                                     Meter&&             meter = Meter())
+    {
+        const float* c0 = in[0];
+        const float* c1 = in[1];
+        const float* c2 = in[2];
+        const float* c3 = in[3];
+        size_t       i  = 0;
+        for(const size_t n = frames & ~size_t(1); i < n;
+            i += 2, out1 += 4, out2 += 4)
+        {
+            out1[0] = FromFloat<Bits>(c0[i], gain);
+            out1[1] = FromFloat<Bits>(c1[i], gain);
+            out2[0] = FromFloat<Bits>(c2[i], gain);
+            out2[1] = FromFloat<Bits>(c3[i], gain);
+            out1[2] = FromFloat<Bits>(c0[i + 1], gain);
+            out1[3] = FromFloat<Bits>(c1[i + 1], gain);
+            out2[2] = FromFloat<Bits>(c2[i + 1], gain);
+            out2[3] = FromFloat<Bits>(c3[i + 1], gain);
+            for(size_t k = 0; k < 2; k++)
+            {
+                meter.Add(0, c0[i + k]);
+                meter.Add(1, c1[i + k]);
+                meter.Add(2, c2[i + k]);
+                meter.Add(3, c3[i + k]);
+            }
+        }
+        if(i < frames)
+        {
+            out1[0] = FromFloat<Bits>(c0[i], gain);
+            out1[1] = FromFloat<Bits>(c1[i], gain);
+            out2[0] = FromFloat<Bits>(c2[i], gain);
+            out2[1] = FromFloat<Bits>(c3[i], gain);
+            meter.Add(0, c0[i]);
+            meter.Add(1, c1[i]);
+            meter.Add(2, c2[i]);
+            meter.Add(3, c3[i]);
+        }
+    }
+
+    /** Deinterleaves a block with any number of channels (e.g. a TDM frame)
+     *  into separate float channels.
+     *  \tparam Bits bit depth of the samples
+     *  \param in interleaved samples { C0_0, C1_0, . . . CN_0, C0_1, . . . }
+     *  \param out array of channels buffers, each with room for frames samples
+     *  \param channels number of channels (slots) per frame
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample
+     *  \param meter sees each float sample, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void Deinterleave(const int32_t* in,
+                             float* const*  out,
+                             size_t         channels,
+                             size_t         frames,
+                             float          gain,
+                             Meter&&        meter = Meter())
+    {
+        const size_t n = channels & ~size_t(3);
+        for(size_t i = 0; i < frames; i++, in += channels)
+        {
+            // reads stay sequential, the writes go to the cached buffers
+            size_t c = 0;
+            for(; c < n; c += 4)
+            {
+                const int32_t s0 = in[c], s1 = in[c + 1], s2 = in[c + 2],
+                              s3 = in[c + 3];
+                out[c][i]     = ToFloat<Bits>(s0, gain);
+                out[c + 1][i] = ToFloat<Bits>(s1, gain);
+                out[c + 2][i] = ToFloat<Bits>(s2, gain);
+                out[c + 3][i] = ToFloat<Bits>(s3, gain);
+                for(size_t k = 0; k < 4; k++)
+                    meter.Add(c + k, out[c + k][i]);
+            }
+            for(; c < channels; c++)
+            {
+                out[c][i] = ToFloat<Bits>(in[c], gain);
+                meter.Add(c, out[c][i]);
+            }
+        }
+    }
+
+    /** Interleaves any number of float channels into a block of frames.
+     *  \tparam Bits bit depth of the samples
+     *  \param in array of channel buffers
+     *  \param out interleaved destination { C0_0, C1_0, . . . CN_0, C0_1, . . }
+     *  \param channels number of channels (slots) per frame
+     *  \param frames number of samples per channel
+     *  \param gain level adjustment applied to each sample before clipping
+     *  \param meter sees each float sample before the gain, see LevelMeter
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void Interleave(const float* const* in,
+                           int32_t*            out,
+                           size_t              channels,
+                           size_t              frames,
+                           float               gain,
+                           Meter&&             meter = Meter())
+    {
+        const size_t n = channels & ~size_t(3);
+        for(size_t i = 0; i < frames; i++, out += channels)
+        {
+            size_t c = 0;
+            for(; c < n; c += 4)
+            {
+                out[c]     = FromFloat<Bits>(in[c][i], gain);
+                out[c + 1] = FromFloat<Bits>(in[c + 1][i], gain);
+                out[c + 2] = FromFloat<Bits>(in[c + 2][i], gain);
+                out[c + 3] = FromFloat<Bits>(in[c + 3][i], gain);
+                for(size_t k = 0; k < 4; k++)
+                    meter.Add(c + k, in[c + k][i]);
+            }
+            for(; c < channels; c++)
+            {
+                out[c] = FromFloat<Bits>(in[c][i], gain);
+                meter.Add(c, in[c][i]);
+            }
+        }
+    }
+
+    /** Converts an interleaved block of samples to interleaved floats.
+     *  \tparam Bits bit depth of the samples
+     *  \param in source samples
+     *  \param out destination, with room for size samples
+     *  \param size total number of samples (frames * channels)
+     *  \param gain level adjustment applied to each sample
+     *  \param meter sees each float sample, see LevelMeter::AddInterleaved()
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void ToFloatBlock(const int32_t* in,
+                             float*         out,
+                             size_t         size,
+                             float          gain,
+                             Meter&&        meter = Meter())
+    {
+        size_t i = 0;
+        for(const size_t n = size & ~size_t(3); i < n; i += 4)
+        {
+            const int32_t s0 = in[i], s1 = in[i + 1], s2 = in[i + 2],
+                          s3 = in[i + 3];
+            out[i]     = ToFloat<Bits>(s0, gain);
+            out[i + 1] = ToFloat<Bits>(s1, gain);
+            out[i + 2] = ToFloat<Bits>(s2, gain);
+            out[i + 3] = ToFloat<Bits>(s3, gain);
+            for(size_t k = 0; k < 4; k++)
+                meter.AddInterleaved(i + k, out[i + k]);
+        }
+        for(; i < size; i++)
+        {
+            out[i] = ToFloat<Bits>(in[i], gain);
+            meter.AddInterleaved(i, out[i]);
+        }
+    }
+
+    /** Converts an interleaved block of floats to interleaved samples.
+     *  \tparam Bits bit depth of the samples
+     *  \param in source samples
+     *  \param out destination, with room for size samples
+     *  \param size total number of samples (frames * channels)
+     *  \param gain level adjustment applied to each sample before clipping
+     *  \param meter sees each float sample before the gain, see
+     *               LevelMeter::AddInterleaved()
+     */
+    template <int Bits, typename Meter = NoMeter>
+    inline void FromFloatBlock(const float* in,
+                               int32_t*     out,
+                               size_t       size,
+                               float        gain,
+                               Meter&&      meter = Meter())
+    {
+        size_t i = 0;
+        for(const size_t n = size & ~size_t(3); i < n; i += 4)
+        {
+            out[i]     = FromFloat<Bits>(in[i], gain);
+            out[i + 1] = FromFloat<Bits>(in[i + 1], gain);
+            out[i + 2] = FromFloat<Bits>(in[i + 2], gain);
+            out[i + 3] = FromFloat<Bits>(in[i + 3], gain);
+            for(size_t k = 0; k < 4; k++)
+                meter.AddInterleaved(i + k, in[i + k]);
+        }
+        for(; i < size; i++)
+        {
+            out[i] = FromFloat<Bits>(in[i], gain);
+            meter.AddInterleaved(i, in[i]);
+        }
+    }
+} // namespace audio_convert
+} // namespace daisy
+
+#endif
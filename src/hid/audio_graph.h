@@ -0,0 +1,356 @@
+#pragma once
+#ifndef DSY_AUDIO_GRAPH_H
+#define DSY_AUDIO_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "hid/audio.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+/** @brief A processor in an AudioGraph
+ *  @ingroup audio
+ */
+class AudioNode
+{
+  public:
+    virtual ~AudioNode() {}
+
+    /** Processes one block, from the audio callback.
+     *  \param in one buffer per input of the node, unconnected inputs are
+     *         silent. Don't write to them, they may be shared.
+     *  \param out one buffer per output of the node
+     *  \param size samples per buffer
+     */
+    virtual void
+    Process(const float* const* in, float* const* out, size_t size) = 0;
+};
+
+/** @brief A fixed graph of audio processors, run from the audio callback
+ *  @ingroup audio
+ *  @details Nodes are added and connected before the audio starts, and
+ *           Init() works out the order to run them in, so that every node
+ *           runs after the nodes it reads from. Process() then runs the
+ *           nodes in that order, reading from and writing to buffers kept
+ *           in the graph, without allocating anything, and counts the CPU
+ *           cycles each node takes with the DWT cycle counter.
+ *
+ *           Every output of a node has a buffer of its own, which any
+ *           number of inputs can read. An input reads one output, or one
+ *           channel of the callback's input. Feedback loops aren't
+ *           possible, as each block of a loop would need the block it's
+ *           about to make. Blocks larger than maxBlock are processed in
+ *           parts.
+ *
+ *  @tparam maxNodes nodes the graph can hold
+ *  @tparam maxBlock samples of the buffers of the node outputs
+ *  @tparam maxPorts inputs and outputs a node can have
+ *
+ *  @code
+ *  AudioGraph<4> graph;
+ *  int f = graph.AddNode(&filter, 1, 1, "filter");
+ *  int d = graph.AddNode(&delay, 1, 2, "delay");
+ *  graph.Connect(graph.kGraph, 0, f, 0); // input 1 to the filter
+ *  graph.Connect(f, 0, d, 0);
+ *  graph.Connect(d, 0, graph.kGraph, 0); // to outputs 1 and 2
+ *  graph.Connect(d, 1, graph.kGraph, 1);
+ *  graph.Init();
+ *
+ *  void AudioCallback(AudioHandle::InputBuffer  in,
+ *                     AudioHandle::OutputBuffer out,
+ *                     size_t                    size)
+ *  {
+ *      graph.Process(in, out, size);
+ *  }
+ *  // graph.GetStats(d)->GetAverage() are the delay's cycles per block
+ *  @endcode
+ */
+template <size_t maxNodes, size_t maxBlock = 48, size_t maxPorts = 2>
+class AudioGraph
+{
+  public:
+    /** Stands for the graph's own inputs and outputs in Connect() */
+    static constexpr int kGraph = -1;
+
+    /** Callback channels the graph can read and write */
+    static constexpr size_t kMaxChannels = 4;
+
+    /** CPU cycles of a node per audio callback */
+    struct NodeStats
+    {
+        uint32_t last_cycles;  /**< of the last callback */
+        uint32_t max_cycles;   /**< most in one callback */
+        uint64_t total_cycles; /**< since the last ResetStats() */
+        uint32_t blocks;       /**< callbacks since the last ResetStats() */
+
+        /** Returns the cycles per callback, on average */
+        float GetAverage() const
+        {
+            return blocks > 0 ? float(total_cycles) / blocks : 0.f;
+        }
+    };
+
+    AudioGraph() { Clear(); }
+    ~AudioGraph() {}
+
+    /** Removes all nodes and connections */
+    void Clear()
+    {
+        num_nodes_ = 0;
+        channels_  = 2;
+        ready_     = false;
+        for(size_t c = 0; c < kMaxChannels; c++)
+            outputs_[c] = Source{kNone, 0};
+        std::memset(silence_, 0, sizeof(silence_));
+        ResetGraphStats();
+    }
+
+    /** Adds a node, with its inputs unconnected
+     *  \param node the processor, which has to outlive the graph
+     *  \param num_inputs inputs of the node, up to maxPorts
+     *  \param num_outputs outputs of the node, up to maxPorts
+     *  \param name for printing the stats
+     *  \return the node's id for Connect() and GetStats(), or -1 if the
+     *          graph is full or a count is too large
+     */
+    int AddNode(AudioNode*  node,
+                size_t      num_inputs,
+                size_t      num_outputs,
+                const char* name = "")
+    {
+        if(node == nullptr || num_nodes_ >= maxNodes || num_inputs > maxPorts
+           || num_outputs > maxPorts)
+            return -1;
+        Node& n       = nodes_[num_nodes_];
+        n.proc        = node;
+        n.name        = name;
+        n.num_inputs  = num_inputs;
+        n.num_outputs = num_outputs;
+        for(size_t i = 0; i < maxPorts; i++)
+            n.inputs[i] = Source{kNone, 0};
+        ready_ = false;
+        return int(num_nodes_++);
+    }
+
+    /** Connects an output to an input
+     *  \param src node to read from, or kGraph for the callback's input
+     *  \param src_port output of the node, or channel of the input
+     *  \param dst node to write to, or kGraph for the callback's output
+     *  \param dst_port input of the node, or channel of the output
+     *  \return false if a node or port doesn't exist, or the input is
+     *          already connected
+     */
+    bool Connect(int src, size_t src_port, int dst, size_t dst_port)
+    {
+        if(src == kGraph)
+        {
+            if(src_port >= kMaxChannels)
+                return false;
+        }
+        else if(!IsNode(src) || src_port >= nodes_[src].num_outputs)
+            return false;
+        Source* input;
+        if(dst == kGraph)
+        {
+            if(dst_port >= kMaxChannels)
+                return false;
+            input = &outputs_[dst_port];
+        }
+        else
+        {
+            if(!IsNode(dst) || dst_port >= nodes_[dst].num_inputs)
+                return false;
+            input = &nodes_[dst].inputs[dst_port];
+        }
+        if(input->node != kNone)
+            return false;
+        *input = Source{src, uint8_t(src_port)};
+        ready_ = false;
+        return true;
+    }
+
+    /** Works out the order of the nodes, call it after the last Connect()
+     *  and before the audio starts
+     *  \param channels channels of the audio callback, 2 or 4
+     *  \return false if the connections form a loop, then Process() only
+     *          writes silence
+     */
+    bool Init(size_t channels = 2)
+    {
+        channels_ = channels < kMaxChannels ? channels : kMaxChannels;
+        // runs the earliest added node whose sources have all run
+        bool placed[maxNodes] = {};
+        for(size_t k = 0; k < num_nodes_; k++)
+        {
+            size_t next = num_nodes_;
+            for(size_t n = 0; n < num_nodes_ && next == num_nodes_; n++)
+                if(!placed[n] && SourcesPlaced(nodes_[n], placed))
+                    next = n;
+            if(next == num_nodes_)
+            {
+                ready_ = false;
+                return false;
+            }
+            placed[next] = true;
+            order_[k]    = uint8_t(next);
+        }
+        ResetStats();
+        ready_ = true;
+        return true;
+    }
+
+    /** Returns true after a successful Init(), until the graph changes */
+    bool IsReady() const { return ready_; }
+
+    /** Runs the graph for one audio callback, non-interleaved buffers */
+    void Process(AudioHandle::InputBuffer  in,
+                 AudioHandle::OutputBuffer out,
+                 size_t                    size)
+    {
+        if(!ready_)
+        {
+            for(size_t c = 0; c < channels_; c++)
+                std::memset(out[c], 0, size * sizeof(float));
+            return;
+        }
+        const uint32_t graph_start = System::GetCycleCount();
+        for(size_t k = 0; k < num_nodes_; k++)
+            nodes_[order_[k]].stats.last_cycles = 0;
+
+        for(size_t offset = 0; offset < size; offset += maxBlock)
+        {
+            const size_t left = size - offset;
+            const size_t n    = left < maxBlock ? left : maxBlock;
+            for(size_t k = 0; k < num_nodes_; k++)
+            {
+                const size_t idx  = order_[k];
+                Node&        node = nodes_[idx];
+                const float* ins[maxPorts];
+                float*       outs[maxPorts];
+                for(size_t i = 0; i < node.num_inputs; i++)
+                    ins[i] = Resolve(node.inputs[i], in, offset);
+                for(size_t o = 0; o < node.num_outputs; o++)
+                    outs[o] = buffers_[idx][o];
+
+                const uint32_t start = System::GetCycleCount();
+                node.proc->Process(ins, outs, n);
+                node.stats.last_cycles += System::GetCycleCount() - start;
+            }
+            for(size_t c = 0; c < channels_; c++)
+            {
+                if(outputs_[c].node == kNone)
+                    std::memset(out[c] + offset, 0, n * sizeof(float));
+                else
+                    std::memcpy(out[c] + offset,
+                                Resolve(outputs_[c], in, offset),
+                                n * sizeof(float));
+            }
+        }
+
+        for(size_t k = 0; k < num_nodes_; k++)
+            AddBlock(nodes_[order_[k]].stats);
+        graph_stats_.last_cycles = System::GetCycleCount() - graph_start;
+        AddBlock(graph_stats_);
+    }
+
+    /** Returns the CPU cycles of a node, nullptr if there's no such node */
+    const NodeStats* GetStats(int node) const
+    {
+        return IsNode(node) ? &nodes_[node].stats : nullptr;
+    }
+
+    /** Returns the CPU cycles of the whole Process(), including the
+     *  copies to the output and the counting */
+    const NodeStats& GetGraphStats() const { return graph_stats_; }
+
+    /** Returns the name given to AddNode() */
+    const char* GetName(int node) const
+    {
+        return IsNode(node) ? nodes_[node].name : "";
+    }
+
+    /** Returns the number of nodes */
+    size_t GetNumNodes() const { return num_nodes_; }
+
+    /** Returns the node that runs at a position, from 0, after Init() */
+    int GetNodeAt(size_t position) const
+    {
+        return ready_ && position < num_nodes_ ? int(order_[position]) : -1;
+    }
+
+    /** Starts counting the cycles of all nodes from 0 */
+    void ResetStats()
+    {
+        for(size_t n = 0; n < num_nodes_; n++)
+            nodes_[n].stats = NodeStats{0, 0, 0, 0};
+        ResetGraphStats();
+    }
+
+  private:
+    static constexpr int kNone = -2;
+
+    struct Source
+    {
+        int     node; /**< kNone, kGraph or a node */
+        uint8_t port;
+    };
+
+    struct Node
+    {
+        AudioNode*  proc;
+        const char* name;
+        size_t      num_inputs;
+        size_t      num_outputs;
+        Source      inputs[maxPorts];
+        NodeStats   stats;
+    };
+
+    bool IsNode(int node) const
+    {
+        return node >= 0 && size_t(node) < num_nodes_;
+    }
+
+    static bool SourcesPlaced(const Node& node, const bool* placed)
+    {
+        for(size_t i = 0; i < node.num_inputs; i++)
+            if(node.inputs[i].node >= 0 && !placed[node.inputs[i].node])
+                return false;
+        return true;
+    }
+
+    const float*
+    Resolve(const Source& src, AudioHandle::InputBuffer in, size_t offset)
+    {
+        if(src.node == kGraph)
+            return src.port < channels_ ? in[src.port] + offset : silence_;
+        if(src.node >= 0)
+            return buffers_[src.node][src.port];
+        return silence_;
+    }
+
+    static void AddBlock(NodeStats& stats)
+    {
+        if(stats.last_cycles > stats.max_cycles)
+            stats.max_cycles = stats.last_cycles;
+        stats.total_cycles += stats.last_cycles;
+        stats.blocks++;
+    }
+
+    void ResetGraphStats() { graph_stats_ = NodeStats{0, 0, 0, 0}; }
+
+    Node      nodes_[maxNodes];
+    uint8_t   order_[maxNodes];
+    Source    outputs_[kMaxChannels];
+    size_t    num_nodes_;
+    size_t    channels_;
+    bool      ready_;
+    NodeStats graph_stats_;
+    float     buffers_[maxNodes][maxPorts][maxBlock];
+    float     silence_[maxBlock];
+};
+
+} // namespace daisy
+
+#endif
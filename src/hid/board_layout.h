@@ -0,0 +1,133 @@
+#pragma once
+#ifndef DSY_BOARD_LAYOUT_H
+#define DSY_BOARD_LAYOUT_H
+#include <stddef.h>
+#include "daisy_core.h"
+#include "per/adc.h"
+#include "hid/ctrl.h"
+#include "hid/rgb_led.h"
+#include "hid/switch3.h"
+
+#ifdef __cplusplus
+namespace daisy
+{
+/**
+    @brief An analog control of a board, read by a single ADC channel \n
+    With BoardSwitch3 and BoardRgbLed, a board lists its analog inputs,
+    switches and LEDs as constexpr tables, which stay in flash instead of
+    being built on the stack by Init(), and initializes its control arrays
+    from them with the functions below. The size of each table is part of
+    its type, so a table that doesn't match the control array it
+    initializes fails to compile, and the pins can be checked with
+    static_assert.
+    @ingroup controls
+
+    @code
+    constexpr BoardAnalogIn kKnobs[] = {{seed::D21, true}, {seed::D22, true}};
+    constexpr Pin           kPins[]  = {seed::D21, seed::D22, seed::D30};
+    static_assert(BoardPinsUnique(kPins), "a pin is used twice");
+
+    AnalogControl knobs[2];
+    InitBoardAnalogIns(seed.adc, kKnobs, knobs, seed.AudioCallbackRate());
+    @endcode
+*/
+struct BoardAnalogIn
+{
+    /** ADC pin of the control */
+    Pin pin;
+    /** input is flipped (i.e. 1.f - input), see AnalogControl::Init() */
+    bool flip = false;
+    /** input is inverted (i.e. -1.f * input) */
+    bool invert = false;
+    /** a -5V to 5V inverted input, see AnalogControl::InitBipolarCv() */
+    bool bipolar_cv = false;
+};
+
+/** A 3-position switch */
+struct BoardSwitch3
+{
+    Pin pin_a;
+    Pin pin_b;
+};
+
+/** An RGB LED of 3 GPIOs */
+struct BoardRgbLed
+{
+    Pin  red;
+    Pin  green;
+    Pin  blue;
+    bool invert = false;
+};
+
+/** Returns true if all pins of a table are valid */
+template <size_t N>
+constexpr bool BoardPinsValid(const Pin (&pins)[N])
+{
+    for(size_t i = 0; i < N; i++)
+        if(!pins[i].IsValid())
+            return false;
+    return true;
+}
+
+/** Returns true if no pin is in a table twice */
+template <size_t N>
+constexpr bool BoardPinsUnique(const Pin (&pins)[N])
+{
+    for(size_t i = 0; i < N; i++)
+        for(size_t j = i + 1; j < N; j++)
+            if(pins[i] == pins[j])
+                return false;
+    return true;
+}
+
+/** Initializes the ADC with one channel per input, and the controls
+    reading them, in the order of the table.
+    \param adc ADC to initialize, with its default oversampling
+    \param inputs table of the inputs
+    \param controls the controls to initialize, one per input
+    \param update_rate rate in Hz the controls are processed at
+*/
+template <size_t N>
+void InitBoardAnalogIns(AdcHandle&          adc,
+                        const BoardAnalogIn (&inputs)[N],
+                        AnalogControl (&controls)[N],
+                        float update_rate)
+{
+    AdcChannelConfig cfg[N];
+    for(size_t i = 0; i < N; i++)
+        cfg[i].InitSingle(inputs[i].pin);
+    adc.Init(cfg, N);
+
+    for(size_t i = 0; i < N; i++)
+    {
+        if(inputs[i].bipolar_cv)
+            controls[i].InitBipolarCv(adc.GetPtr(i), update_rate);
+        else
+            controls[i].Init(adc.GetPtr(i),
+                             update_rate,
+                             inputs[i].flip,
+                             inputs[i].invert);
+    }
+}
+
+/** Initializes 3-position switches, in the order of the table */
+template <size_t N>
+void InitBoardSwitch3s(const BoardSwitch3 (&switches)[N],
+                       Switch3 (&controls)[N])
+{
+    for(size_t i = 0; i < N; i++)
+        controls[i].Init(switches[i].pin_a, switches[i].pin_b);
+}
+
+/** Initializes RGB LEDs, in the order of the table */
+template <size_t N>
+void InitBoardRgbLeds(const BoardRgbLed (&leds)[N], RgbLed (&controls)[N])
+{
+    for(size_t i = 0; i < N; i++)
+        controls[i].Init(
+            leds[i].red, leds[i].green, leds[i].blue, leds[i].invert);
+}
+
+} // namespace daisy
+#endif
+#endif
@@ -11,6 +11,7 @@ void AnalogControl::Init(uint16_t *adcptr,
                          float     slew_seconds)
 {
     val_        = 0.0f;
+    prev_       = 0.0f;
     raw_        = adcptr;
     samplerate_ = sr;
     SetCoeff(1.0f / (slew_seconds * samplerate_ * 0.5f));
@@ -25,6 +26,7 @@ void AnalogControl::Init(uint16_t *adcptr,
 void AnalogControl::InitBipolarCv(uint16_t *adcptr, float sr)
 {
     val_        = 0.0f;
+    prev_       = 0.0f;
     raw_        = adcptr;
     samplerate_ = sr;
     SetCoeff(1.0f / (0.002f * samplerate_ * 0.5f));
@@ -41,7 +43,8 @@ float AnalogControl::Process()
     t = (float)*raw_ / 65536.0f;
     if(flip_)
         t = 1.f - t;
-    t = (t - offset_) * scale_ * (invert_ ? -1.0f : 1.0f);
+    t     = (t - offset_) * scale_ * (invert_ ? -1.0f : 1.0f);
+    prev_ = val_;
     val_ += coeff_ * (t - val_);
     return val_;
 }
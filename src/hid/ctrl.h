@@ -55,6 +55,16 @@ class AnalogControl
     /** Returns the current stored value, without reprocessing */
     inline float Value() const { return val_; }
 
+    /** Returns a value between the one before the last Process() and the
+        current one, for controls that are processed less often than they
+        are read, e.g. with a ControlRateClock.
+        \param phase 0 for the value before, 1 for the current value
+    */
+    inline float Interpolate(float phase) const
+    {
+        return prev_ + (val_ - prev_) * phase;
+    }
+
     /** Directly set the Coefficient of the one pole smoothing filter. 
       \param val Value to set coefficient to. Max of 1, min of 0.
     */
@@ -80,7 +90,7 @@ class AnalogControl
 
   private:
     uint16_t *raw_;
-    float     coeff_, samplerate_, val_;
+    float     coeff_, samplerate_, val_, prev_;
     float     scale_, offset_;
     bool      flip_;
     bool      invert_;
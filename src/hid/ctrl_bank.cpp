@@ -0,0 +1,76 @@
+#include "hid/ctrl_bank.h"
+using namespace daisy;
+
+constexpr int ControlBank::kInvalidControl;
+
+static float clamp_coeff(float val)
+{
+    val = val > 1.f ? 1.f : val;
+    return val < 0.f ? 0.f : val;
+}
+
+void ControlBank::Init(float sr)
+{
+    num_channels_ = 0;
+    samplerate_   = sr;
+}
+
+int ControlBank::AddControl(uint16_t *adcptr,
+                            bool      flip,
+                            bool      invert,
+                            float     slew_seconds)
+{
+    return Add(adcptr, flip, invert ? -1.f : 1.f, 0.f, slew_seconds);
+}
+
+int ControlBank::AddBipolarCv(uint16_t *adcptr)
+{
+    return Add(adcptr, false, -2.f, 0.5f, 0.002f);
+}
+
+int ControlBank::Add(uint16_t *adcptr,
+                     bool      flip,
+                     float     scale,
+                     float     offset,
+                     float     slew_seconds)
+{
+    if(adcptr == nullptr || num_channels_ >= DSY_CONTROL_BANK_MAX_CHANNELS)
+        return kInvalidControl;
+    const size_t i = num_channels_++;
+
+    // AnalogControl computes ((flip ? 1 - t : t) - offset) * scale, with
+    // t = raw / 65536, which is gain * raw + bias
+    raw_[i]          = adcptr;
+    gain_[i]         = (flip ? -scale : scale) / 65536.f;
+    bias_[i]         = ((flip ? 1.f : 0.f) - offset) * scale;
+    val_[i]          = 0.f;
+    slew_seconds_[i] = slew_seconds;
+
+    coeff_[i] = clamp_coeff(1.f / (slew_seconds * samplerate_ * 0.5f));
+    return int(i);
+}
+
+void ControlBank::Process()
+{
+    const size_t n = num_channels_;
+    float        in[DSY_CONTROL_BANK_MAX_CHANNELS];
+
+    // the ADC buffer is read once, then the filters run over plain arrays
+    for(size_t i = 0; i < n; i++)
+        in[i] = float(*raw_[i]);
+    for(size_t i = 0; i < n; i++)
+        val_[i] += coeff_[i] * (gain_[i] * in[i] + bias_[i] - val_[i]);
+}
+
+void ControlBank::SetCoeff(size_t idx, float val)
+{
+    if(idx < num_channels_)
+        coeff_[idx] = clamp_coeff(val);
+}
+
+void ControlBank::SetSampleRate(float sample_rate)
+{
+    samplerate_ = sample_rate;
+    for(size_t i = 0; i < num_channels_; i++)
+        coeff_[i] = clamp_coeff(1.f / (slew_seconds_[i] * samplerate_ * 0.5f));
+}
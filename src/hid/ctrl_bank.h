@@ -0,0 +1,115 @@
+#pragma once
+#ifndef DSY_CTRL_BANK_H
+#define DSY_CTRL_BANK_H
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of controls a ControlBank can hold */
+#ifndef DSY_CONTROL_BANK_MAX_CHANNELS
+#define DSY_CONTROL_BANK_MAX_CHANNELS 32
+#endif
+
+#ifdef __cplusplus
+namespace daisy
+{
+/**
+    @brief Processes many analog controls in one loop \n
+    Does the same as an array of AnalogControl, with the state kept as
+    arrays per field instead of one object per control. Flip, invert and
+    the bipolar offset are folded into one gain and bias per control, so
+    Process() is a gather of the raw values straight from the ADC buffer,
+    followed by one loop of multiply-adds over all of them, without a call
+    or a branch per control.
+    @ingroup controls
+
+    @code
+    ControlBank bank;
+    bank.Init(hw.AudioCallbackRate());
+    for(int i = 0; i < 8; i++)
+        bank.AddControl(hw.adc.GetMuxPtr(0, i));
+    bank.AddBipolarCv(hw.adc.GetPtr(1));
+    // in the audio callback
+    bank.Process();
+    float cutoff = bank.Value(0);
+    @endcode
+*/
+class ControlBank
+{
+  public:
+    /** Returned by AddControl() when the bank is full */
+    static constexpr int kInvalidControl = -1;
+
+    ControlBank() : num_channels_(0), samplerate_(1000.f) {}
+    ~ControlBank() {}
+
+    /** Removes all controls
+        \param sr is the samplerate in Hz that Process() will be called at.
+    */
+    void Init(float sr);
+
+    /** Adds a control, the arguments are the ones of AnalogControl::Init()
+        \param *adcptr pointer to the raw adc value, e.g. from
+               AdcHandle::GetPtr() or AdcHandle::GetMuxPtr()
+        \param flip input is flipped (i.e. 1.f - input)
+        \param invert input is inverted (i.e. -1.f * input)
+        \param slew_seconds time it takes the control to change to a new
+               value
+        \return index of the control, or kInvalidControl if the bank is
+                full or there's no pointer
+    */
+    int AddControl(uint16_t *adcptr,
+                   bool      flip         = false,
+                   bool      invert       = false,
+                   float     slew_seconds = 0.002f);
+
+    /** Adds a control for a -5V to 5V inverted input, returning -1.0 to
+        1.0, like AnalogControl::InitBipolarCv()
+        \return index of the control, or kInvalidControl
+    */
+    int AddBipolarCv(uint16_t *adcptr);
+
+    /** Filters and scales all controls, at the samplerate given to Init() */
+    void Process();
+
+    /** Returns the current value of a control, without reprocessing */
+    inline float Value(size_t idx) const { return val_[idx]; }
+
+    /** Returns the values of all controls, in the order they were added */
+    inline const float *GetValues() const { return val_; }
+
+    /** Returns the raw unsigned 16-bit value from the ADC */
+    inline uint16_t GetRawValue(size_t idx) const { return *raw_[idx]; }
+
+    /** Returns the number of controls */
+    inline size_t GetNumChannels() const { return num_channels_; }
+
+    /** Directly set the Coefficient of the one pole smoothing filter.
+        \param idx control to set the coefficient of
+        \param val Value to set coefficient to. Max of 1, min of 0.
+    */
+    void SetCoeff(size_t idx, float val);
+
+    /** Set a new sample rate for all controls
+     *  \param sample_rate New update rate in hz
+    */
+    void SetSampleRate(float sample_rate);
+
+  private:
+    int Add(uint16_t *adcptr,
+            bool      flip,
+            float     scale,
+            float     offset,
+            float     slew_seconds);
+
+    const uint16_t *raw_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    float           gain_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    float           bias_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    float           coeff_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    float           val_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    float           slew_seconds_[DSY_CONTROL_BANK_MAX_CHANNELS];
+    size_t          num_channels_;
+    float           samplerate_;
+};
+} // namespace daisy
+#endif
+#endif
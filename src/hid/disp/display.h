@@ -210,6 +210,11 @@ class OneBitGraphicsDisplay
  *          void Update() override { ... }
  *      };
  *  
+ *  Lines, rectangles and text are drawn with a few span primitives:
+ *  DrawHorizontalSpan(), DrawVerticalSpan(), FillRect() and DrawBitmap().
+ *  Here they call DrawPixel() for every pixel. A child class can hide
+ *  them with versions that write whole bytes of its buffer, which are then
+ *  used by all the drawing functions.
  */
 template <class ChildType>
 class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
@@ -224,6 +229,23 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
                   uint_fast8_t y2,
                   bool         on) override
     {
+        if(y1 == y2)
+        {
+            const uint_fast8_t x = x1 < x2 ? x1 : x2;
+            ((ChildType*)(this))
+                ->ChildType::DrawHorizontalSpan(
+                    x, y1, abs((int_fast16_t)x2 - (int_fast16_t)x1) + 1, on);
+            return;
+        }
+        if(x1 == x2)
+        {
+            const uint_fast8_t y = y1 < y2 ? y1 : y2;
+            ((ChildType*)(this))
+                ->ChildType::DrawVerticalSpan(
+                    x1, y, abs((int_fast16_t)y2 - (int_fast16_t)y1) + 1, on);
+            return;
+        }
+
         int_fast16_t deltaX = abs((int_fast16_t)x2 - (int_fast16_t)x1);
         int_fast16_t deltaY = abs((int_fast16_t)y2 - (int_fast16_t)y1);
         int_fast16_t signX  = ((x1 < x2) ? 1 : -1);
@@ -263,13 +285,7 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
     {
         if(fill)
         {
-            for(uint_fast8_t x = x1; x <= x2; x++)
-            {
-                for(uint_fast8_t y = y1; y <= y2; y++)
-                {
-                    ((ChildType*)(this))->ChildType::DrawPixel(x, y, on);
-                }
-            }
+            ((ChildType*)(this))->ChildType::FillRect(x1, y1, x2, y2, on);
         }
         else
         {
@@ -280,6 +296,92 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
         }
     }
 
+    /**
+    Draws a horizontal line of pixels.
+    \param x      x Coordinate of the leftmost pixel
+    \param y      y Coordinate
+    \param length number of pixels
+    \param on     on or off
+    */
+    void DrawHorizontalSpan(uint_fast8_t x,
+                            uint_fast8_t y,
+                            uint_fast8_t length,
+                            bool         on)
+    {
+        for(uint_fast16_t i = 0; i < length; i++)
+            ((ChildType*)(this))->ChildType::DrawPixel(x + i, y, on);
+    }
+
+    /**
+    Draws a vertical line of pixels.
+    \param x      x Coordinate
+    \param y      y Coordinate of the top pixel
+    \param length number of pixels
+    \param on     on or off
+    */
+    void DrawVerticalSpan(uint_fast8_t x,
+                          uint_fast8_t y,
+                          uint_fast8_t length,
+                          bool         on)
+    {
+        for(uint_fast16_t i = 0; i < length; i++)
+            ((ChildType*)(this))->ChildType::DrawPixel(x, y + i, on);
+    }
+
+    /**
+    Fills a rectangle, the corners are included like in DrawRect().
+    \param x1 x Coordinate of the top left corner
+    \param y1 y Coordinate of the top left corner
+    \param x2 x Coordinate of the bottom right corner
+    \param y2 y Coordinate of the bottom right corner
+    \param on on or off
+    */
+    void FillRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on)
+    {
+        if(x2 < x1)
+            return;
+        for(uint_fast16_t y = y1; y <= y2; y++)
+            ((ChildType*)(this))
+                ->ChildType::DrawHorizontalSpan(x1, y, x2 - x1 + 1, on);
+    }
+
+    /**
+    Draws a bitmap, the pixels that are set are drawn on, the others off.
+    The bitmap is organized like the buffer of a page based display: a
+    row of bytes for each band of 8 lines, one byte per column with the
+    top pixel in the lowest bit. Pixel (i, j) is bit j % 8 of
+    bitmap[(j / 8) * width + i].
+    \param x      x Coordinate of the top left corner
+    \param y      y Coordinate of the top left corner
+    \param bitmap the pixels, width * ((height + 7) / 8) bytes
+    \param width  width of the bitmap
+    \param height height of the bitmap
+    \param on     what the set pixels are drawn as
+    */
+    void DrawBitmap(uint_fast8_t   x,
+                    uint_fast8_t   y,
+                    const uint8_t* bitmap,
+                    uint_fast8_t   width,
+                    uint_fast8_t   height,
+                    bool           on)
+    {
+        for(uint_fast16_t j = 0; j < height; j++)
+        {
+            const uint8_t* row = &bitmap[(j / 8) * width];
+            const uint8_t  bit = 1 << (j % 8);
+            for(uint_fast16_t i = 0; i < width; i++)
+            {
+                const bool set = (row[i] & bit) != 0;
+                ((ChildType*)(this))
+                    ->ChildType::DrawPixel(x + i, y + j, set ? on : !on);
+            }
+        }
+    }
+
     void DrawArc(uint_fast8_t x,
                  uint_fast8_t y,
                  uint_fast8_t radius,
@@ -409,6 +511,30 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
             return 0;
         }
 
+        if(font.FontWidth <= 16 && font.FontHeight <= 8 * kMaxFontBands)
+        {
+            // turn the rows of the glyph into a bitmap of columns
+            uint8_t bitmap[16 * kMaxFontBands] = {};
+            for(i = 0; i < font.FontHeight; i++)
+            {
+                b = font.data[(ch - 32) * font.FontHeight + i];
+                for(j = 0; j < font.FontWidth; j++)
+                {
+                    if((b << j) & 0x8000)
+                        bitmap[(i / 8) * font.FontWidth + j] |= 1 << (i % 8);
+                }
+            }
+            ((ChildType*)(this))
+                ->ChildType::DrawBitmap(currentX_,
+                                        currentY_,
+                                        bitmap,
+                                        font.FontWidth,
+                                        font.FontHeight,
+                                        on);
+            SetCursor(currentX_ + font.FontWidth, currentY_);
+            return ch;
+        }
+
         // Use the font to write
         for(i = 0; i < font.FontHeight; i++)
         {
@@ -470,7 +596,79 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
         return alignedRect;
     }
 
+    /**
+    Writes a character of a font in the page format. The glyph is drawn
+    with DrawBitmap(), without converting it first.
+    \param ch character to be written
+    \param font font to be written in
+    \param on on or off
+    \return the character, or 0 if it's not in the font or doesn't fit
+    */
+    char WriteChar(char ch, const PageFontDef& font, bool on)
+    {
+        if(ch < 32 || ch > 126)
+            return 0;
+        if(Width() < (currentX_ + font.FontWidth)
+           || Height() < (currentY_ + font.FontHeight))
+            return 0;
+
+        const size_t glyph_size = font.FontWidth * ((font.FontHeight + 7) / 8);
+        ((ChildType*)(this))
+            ->ChildType::DrawBitmap(currentX_,
+                                    currentY_,
+                                    &font.data[(ch - 32) * glyph_size],
+                                    font.FontWidth,
+                                    font.FontHeight,
+                                    on);
+        SetCursor(currentX_ + font.FontWidth, currentY_);
+        return ch;
+    }
+
+    /**
+    Writes a string in a font in the page format.
+    \param str string to be written
+    \param font font to be written in
+    \param on on or off
+    \return '\0' or the first character that couldn't be written
+    */
+    char WriteString(const char* str, const PageFontDef& font, bool on)
+    {
+        while(*str)
+        {
+            if(WriteChar(*str, font, on) != *str)
+                return *str;
+            str++;
+        }
+        return *str;
+    }
+
+    /**
+    Writes a string in a font in the page format, aligned in a bounding box.
+    \param str string to be written
+    \param font font to be written in
+    \param boundingBox the box to align the text in
+    \param alignment where in the box the text goes
+    \param on on or off
+    \return the rectangle the text was written in
+    */
+    Rectangle WriteStringAligned(const char*        str,
+                                 const PageFontDef& font,
+                                 Rectangle          boundingBox,
+                                 Alignment          alignment,
+                                 bool               on)
+    {
+        const Rectangle textRect
+            = {int16_t(strlen(str) * font.FontWidth), font.FontHeight};
+        const auto alignedRect = textRect.AlignedWithin(boundingBox, alignment);
+        SetCursor(alignedRect.GetX(), alignedRect.GetY());
+        WriteString(str, font, on);
+        return alignedRect;
+    }
+
   private:
+    /** Bands of 8 lines of the largest font WriteChar() draws as a bitmap */
+    static constexpr size_t kMaxFontBands = 4;
+
     uint32_t strlen(const char* string)
     {
         uint32_t result = 0;
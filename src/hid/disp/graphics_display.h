@@ -0,0 +1,266 @@
+#pragma once
+#ifndef DSY_GRAPHICS_DISPLAY_H
+#define DSY_GRAPHICS_DISPLAY_H /**< Macro */
+
+#include "sys/dma2d.h"
+#include "util/pixel_format.h"
+#include "graphics_common.h"
+
+namespace daisy
+{
+/**
+ * This interface is used as a base class for displays with more than one
+ * bit per pixel, colour or greyscale. Colours are 0xAARRGGBB, converted
+ * to the format of the display, greyscale displays show the luminance.
+*/
+class GraphicsDisplay
+{
+  public:
+    GraphicsDisplay() {}
+    virtual ~GraphicsDisplay() {}
+
+    virtual uint16_t Height() const = 0;
+    virtual uint16_t Width() const  = 0;
+
+    Rectangle GetBounds() const
+    {
+        return Rectangle(int16_t(Width()), int16_t(Height()));
+    }
+
+    /**
+    Fills the entire display with a colour.
+    \param color 0xAARRGGBB, the alpha is ignored
+    */
+    virtual void Fill(uint32_t color) = 0;
+
+    /**
+    Sets the pixel at the specified coordinate.
+    \param x x Coordinate
+    \param y y coordinate
+    \param color 0xAARRGGBB, the alpha is ignored
+    */
+    virtual void DrawPixel(uint_fast16_t x, uint_fast16_t y, uint32_t color)
+        = 0;
+
+    /**
+    Fills a rectangle, clipped to the display.
+    \param x left edge
+    \param y top edge
+    \param width width of the rectangle
+    \param height height of the rectangle
+    \param color 0xAARRGGBB, the alpha is ignored
+    */
+    virtual void FillRect(uint_fast16_t x,
+                          uint_fast16_t y,
+                          uint_fast16_t width,
+                          uint_fast16_t height,
+                          uint32_t      color)
+        = 0;
+
+    /**
+    Copies an image to the display, converting its pixel format.
+    \param x where the left edge of the image goes
+    \param y where the top edge of the image goes
+    \param image the image, not A8
+    */
+    virtual void
+    DrawImage(uint_fast16_t x, uint_fast16_t y, const PixelBuffer& image)
+        = 0;
+
+    /**
+    Blends an image over the display.
+    \param x where the left edge of the image goes
+    \param y where the top edge of the image goes
+    \param image the image, its alpha is multiplied by alpha / 255
+    \param alpha constant alpha
+    \param color the colour of an A8 image, e.g. antialiased text
+    */
+    virtual void BlendImage(uint_fast16_t      x,
+                            uint_fast16_t      y,
+                            const PixelBuffer& image,
+                            uint8_t            alpha = 255,
+                            uint32_t           color = 0xffffff)
+        = 0;
+
+    /**
+    Writes the changes to the display.
+    */
+    virtual void Update() = 0;
+};
+
+/**
+ * A GraphicsDisplay drawing into the framebuffer of a display driver, e.g.
+ * the SSD1327Driver or the ST7789Driver. The fills, copies and blending
+ * run on the DMA2D when it can write the format of the framebuffer, and
+ * on the CPU otherwise. DMA2D requests are queued: drawing returns right
+ * away, and the CPU only waits before it touches the framebuffer itself,
+ * e.g. for DrawPixel(), or before an update.
+ *
+ * The driver provides Width(), Height(), GetFramebuffer(), Update() and,
+ * for updates in the background, StartUpdate() and UpdateFinished(). Its
+ * framebuffer must be reachable by the DMA2D, not in the DTCM, so the
+ * display must not be on the stack.
+ * @ingroup device
+*/
+template <typename DisplayDriver>
+class FramebufferDisplay : public GraphicsDisplay
+{
+  public:
+    FramebufferDisplay() {}
+    virtual ~FramebufferDisplay() {}
+
+    struct Config
+    {
+        typename DisplayDriver::Config driver_config;
+    };
+
+    void Init(Config config)
+    {
+        dma2d_.Init();
+        driver_.Init(config.driver_config);
+    }
+
+    uint16_t Height() const override { return driver_.Height(); }
+    uint16_t Width() const override { return driver_.Width(); }
+
+    void Fill(uint32_t color) override
+    {
+        FillRect(0, 0, Width(), Height(), color);
+    }
+
+    void DrawPixel(uint_fast16_t x, uint_fast16_t y, uint32_t color) override
+    {
+        if(x >= Width() || y >= Height())
+            return;
+        dma2d_.Wait();
+        WritePixel(driver_.GetFramebuffer(), x, y, color);
+    }
+
+    void FillRect(uint_fast16_t x,
+                  uint_fast16_t y,
+                  uint_fast16_t width,
+                  uint_fast16_t height,
+                  uint32_t      color) override
+    {
+        const PixelBuffer fb = driver_.GetFramebuffer();
+        if(Dma2dHandle::CanWrite(fb.format)
+           && RunOnDma2d([&] {
+                  return dma2d_.Fill(fb, x, y, width, height, color);
+              }))
+            return;
+
+        dma2d_.Wait();
+        const size_t x_end = x + width < fb.width ? x + width : fb.width;
+        const size_t y_end = y + height < fb.height ? y + height : fb.height;
+        for(size_t j = y; j < y_end; j++)
+            for(size_t i = x; i < x_end; i++)
+                WritePixel(fb, i, j, color);
+    }
+
+    void DrawImage(uint_fast16_t      x,
+                   uint_fast16_t      y,
+                   const PixelBuffer& image) override
+    {
+        const PixelBuffer fb = driver_.GetFramebuffer();
+        if(Dma2dHandle::CanWrite(fb.format)
+           && Dma2dHandle::CanRead(image.format)
+           && RunOnDma2d([&] { return dma2d_.Copy(fb, x, y, image); }))
+            return;
+
+        ForEachPixel(fb, x, y, image, [&](size_t i, size_t j) {
+            WritePixel(fb, x + i, y + j, ReadPixel(image, i, j));
+        });
+    }
+
+    void BlendImage(uint_fast16_t      x,
+                    uint_fast16_t      y,
+                    const PixelBuffer& image,
+                    uint8_t            alpha = 255,
+                    uint32_t           color = 0xffffff) override
+    {
+        const PixelBuffer fb = driver_.GetFramebuffer();
+        if(Dma2dHandle::CanWrite(fb.format) && Dma2dHandle::CanRead(fb.format)
+           && Dma2dHandle::CanRead(image.format)
+           && RunOnDma2d([&] {
+                  return dma2d_.Blend(fb, x, y, image, alpha, color);
+              }))
+            return;
+
+        const bool mask = image.format == PixelFormat::A8;
+        ForEachPixel(fb, x, y, image, [&](size_t i, size_t j) {
+            uint32_t fg = ReadPixel(image, i, j);
+            if(mask)
+                fg = (fg & 0xff000000) | (color & 0xffffff);
+            const uint32_t bg = ReadPixel(fb, x + i, y + j);
+            WritePixel(fb, x + i, y + j, BlendPixel(fg, bg, alpha));
+        });
+    }
+
+    /** Waits for the drawing, and writes the framebuffer to the display */
+    void Update() override
+    {
+        dma2d_.Wait();
+        driver_.Update();
+    }
+
+    /** Waits for the drawing, and starts sending the framebuffer in the
+     *  background, see the driver's StartUpdate().
+     *  \return false if the previous frame is still being sent
+     */
+    bool StartUpdate()
+    {
+        dma2d_.Wait();
+        return driver_.StartUpdate();
+    }
+
+    /** \return true when the frame of StartUpdate() was sent */
+    bool UpdateFinished() const { return driver_.UpdateFinished(); }
+
+    /** Waits until the queued drawing is done */
+    void Wait() const { dma2d_.Wait(); }
+
+    /** Returns the driver, e.g. for SSD1327Driver::SetContrast() */
+    DisplayDriver& GetDriver() { return driver_; }
+
+  private:
+    /** Queues a DMA2D request, and when the queue is full, tries once more
+     *  after it's empty.
+     *  \return false if the request has to be done by the CPU
+     */
+    template <typename Request>
+    bool RunOnDma2d(Request request)
+    {
+        if(request() == Dma2dHandle::Result::OK)
+            return true;
+        dma2d_.Wait();
+        return request() == Dma2dHandle::Result::OK;
+    }
+
+    /** Waits for the DMA2D, and calls draw(i, j) for each pixel of the
+     *  image that's on the display */
+    template <typename Draw>
+    void ForEachPixel(const PixelBuffer& fb,
+                      size_t             x,
+                      size_t             y,
+                      const PixelBuffer& image,
+                      Draw               draw)
+    {
+        dma2d_.Wait();
+        if(x >= fb.width || y >= fb.height)
+            return;
+        const size_t width  = image.width < fb.width - x ? image.width
+                                                          : fb.width - x;
+        const size_t height = image.height < fb.height - y ? image.height
+                                                            : fb.height - y;
+        for(size_t j = 0; j < height; j++)
+            for(size_t i = 0; i < width; i++)
+                draw(i, j);
+    }
+
+    DisplayDriver driver_;
+    Dma2dHandle   dma2d_;
+};
+
+} // namespace daisy
+
+#endif
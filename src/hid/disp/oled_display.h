@@ -44,15 +44,162 @@ class OledDisplay : public OneBitGraphicsDisplayImpl<OledDisplay<DisplayDriver>>
         driver_.DrawPixel(x, y, on);
     }
 
+    /** Draws a horizontal line, with the driver's fast path if it has one */
+    void DrawHorizontalSpan(uint_fast8_t x,
+                            uint_fast8_t y,
+                            uint_fast8_t length,
+                            bool         on)
+    {
+        HorizontalSpan(driver_, x, y, length, on, 0);
+    }
+
+    /** Draws a vertical line, with the driver's fast path if it has one */
+    void DrawVerticalSpan(uint_fast8_t x,
+                          uint_fast8_t y,
+                          uint_fast8_t length,
+                          bool         on)
+    {
+        VerticalSpan(driver_, x, y, length, on, 0);
+    }
+
+    /** Fills a rectangle, with the driver's fast path if it has one */
+    void FillRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on)
+    {
+        Rect(driver_, x1, y1, x2, y2, on, 0);
+    }
+
+    /** Draws a bitmap, with the driver's fast path if it has one */
+    void DrawBitmap(uint_fast8_t   x,
+                    uint_fast8_t   y,
+                    const uint8_t* bitmap,
+                    uint_fast8_t   width,
+                    uint_fast8_t   height,
+                    bool           on)
+    {
+        Bitmap(driver_, x, y, bitmap, width, height, on, 0);
+    }
+
     /** 
     Writes the current display buffer to the OLED device using SPI or I2C depending on 
     how the object was initialized.
     */
     void Update() override { driver_.Update(); }
 
+    /**
+    Starts writing the display buffer by DMA and returns, while drawing
+    continues. Only for drivers and transports with DMA support.
+    \return false if the previous frame is still being sent
+    */
+    bool StartUpdate() { return driver_.StartUpdate(); }
+
+    /** \return true when the frame of StartUpdate() was sent */
+    bool UpdateFinished() const { return driver_.UpdateFinished(); }
+
   private:
+    using Base = OneBitGraphicsDisplayImpl<OledDisplay<DisplayDriver>>;
+
     DisplayDriver driver_;
 
+    // The span primitives of the driver are optional: the int overloads
+    // are only viable if the driver has them, else the pixel by pixel
+    // versions of the base class are used.
+    template <typename D>
+    auto HorizontalSpan(D&           driver,
+                        uint_fast8_t x,
+                        uint_fast8_t y,
+                        uint_fast8_t length,
+                        bool         on,
+                        int)
+        -> decltype(driver.DrawHorizontalSpan(x, y, length, on))
+    {
+        driver.DrawHorizontalSpan(x, y, length, on);
+    }
+    template <typename D>
+    void HorizontalSpan(D&,
+                        uint_fast8_t x,
+                        uint_fast8_t y,
+                        uint_fast8_t length,
+                        bool         on,
+                        long)
+    {
+        Base::DrawHorizontalSpan(x, y, length, on);
+    }
+
+    template <typename D>
+    auto VerticalSpan(D&           driver,
+                      uint_fast8_t x,
+                      uint_fast8_t y,
+                      uint_fast8_t length,
+                      bool         on,
+                      int)
+        -> decltype(driver.DrawVerticalSpan(x, y, length, on))
+    {
+        driver.DrawVerticalSpan(x, y, length, on);
+    }
+    template <typename D>
+    void VerticalSpan(D&,
+                      uint_fast8_t x,
+                      uint_fast8_t y,
+                      uint_fast8_t length,
+                      bool         on,
+                      long)
+    {
+        Base::DrawVerticalSpan(x, y, length, on);
+    }
+
+    template <typename D>
+    auto Rect(D&           driver,
+              uint_fast8_t x1,
+              uint_fast8_t y1,
+              uint_fast8_t x2,
+              uint_fast8_t y2,
+              bool         on,
+              int) -> decltype(driver.FillRect(x1, y1, x2, y2, on))
+    {
+        driver.FillRect(x1, y1, x2, y2, on);
+    }
+    template <typename D>
+    void Rect(D&,
+              uint_fast8_t x1,
+              uint_fast8_t y1,
+              uint_fast8_t x2,
+              uint_fast8_t y2,
+              bool         on,
+              long)
+    {
+        Base::FillRect(x1, y1, x2, y2, on);
+    }
+
+    template <typename D>
+    auto Bitmap(D&             driver,
+                uint_fast8_t   x,
+                uint_fast8_t   y,
+                const uint8_t* bitmap,
+                uint_fast8_t   width,
+                uint_fast8_t   height,
+                bool           on,
+                int)
+        -> decltype(driver.DrawBitmap(x, y, bitmap, width, height, on))
+    {
+        driver.DrawBitmap(x, y, bitmap, width, height, on);
+    }
+    template <typename D>
+    void Bitmap(D&,
+                uint_fast8_t   x,
+                uint_fast8_t   y,
+                const uint8_t* bitmap,
+                uint_fast8_t   width,
+                uint_fast8_t   height,
+                bool           on,
+                long)
+    {
+        Base::DrawBitmap(x, y, bitmap, width, height, on);
+    }
+
     void Reset() { driver_.Reset(); };
     void SendCommand(uint8_t cmd) { driver_.SendCommand(cmd); };
     void SendData(uint8_t* buff, size_t size) { driver_.SendData(buff, size); };
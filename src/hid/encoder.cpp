@@ -1,7 +1,33 @@
 #include "hid/encoder.h"
+#include "stm32h7xx_hal.h"
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
 
 using namespace daisy;
 
+/** Pins of the channels 1 and 2 of the timers with an encoder mode */
+struct EncoderTimerPins
+{
+    Pin          ch1, ch2;
+    TIM_TypeDef *tim;
+    uint8_t      alternate;
+};
+
+static const EncoderTimerPins encoder_timer_pins[] = {
+    {Pin(PORTA, 8), Pin(PORTA, 9), TIM1, GPIO_AF1_TIM1},
+    {Pin(PORTE, 9), Pin(PORTE, 11), TIM1, GPIO_AF1_TIM1},
+    {Pin(PORTA, 6), Pin(PORTA, 7), TIM3, GPIO_AF2_TIM3},
+    {Pin(PORTB, 4), Pin(PORTB, 5), TIM3, GPIO_AF2_TIM3},
+    {Pin(PORTC, 6), Pin(PORTC, 7), TIM3, GPIO_AF2_TIM3},
+    {Pin(PORTB, 6), Pin(PORTB, 7), TIM4, GPIO_AF2_TIM4},
+    {Pin(PORTD, 12), Pin(PORTD, 13), TIM4, GPIO_AF2_TIM4},
+    {Pin(PORTA, 0), Pin(PORTA, 1), TIM5, GPIO_AF2_TIM5},
+    {Pin(PORTH, 10), Pin(PORTH, 11), TIM5, GPIO_AF2_TIM5},
+};
+
 void Encoder::Init(dsy_gpio_pin a,
                    dsy_gpio_pin b,
                    dsy_gpio_pin click,
@@ -24,10 +50,82 @@ void Encoder::Init(dsy_gpio_pin a,
     // Set initial states, etc.
     inc_ = 0;
     a_ = b_ = 0xff;
+
+    // software decoding, until InitHardware()
+    count_reg_ = nullptr;
+}
+
+bool Encoder::InitHardware(Pin a, Pin b, Pin click)
+{
+    Init(a, b, click);
+
+    const EncoderTimerPins *match = nullptr;
+    for(const EncoderTimerPins &p : encoder_timer_pins)
+    {
+        if((p.ch1 == a && p.ch2 == b) || (p.ch1 == b && p.ch2 == a))
+            match = &p;
+    }
+    if(match == nullptr)
+        return false;
+    TIM_TypeDef *tim = match->tim;
+
+    if(tim == TIM1)
+        __HAL_RCC_TIM1_CLK_ENABLE();
+    else if(tim == TIM3)
+        __HAL_RCC_TIM3_CLK_ENABLE();
+    else if(tim == TIM4)
+        __HAL_RCC_TIM4_CLK_ENABLE();
+    else
+        __HAL_RCC_TIM5_CLK_ENABLE();
+    if(tim->CR1 & TIM_CR1_CEN)
+        return false;
+
+    // Init() left them as inputs with pull ups, and started the GPIO clocks
+    GPIO_InitTypeDef ginit;
+    ginit.Mode      = GPIO_MODE_AF_PP;
+    ginit.Pull      = GPIO_PULLUP;
+    ginit.Speed     = GPIO_SPEED_LOW;
+    ginit.Alternate = match->alternate;
+    ginit.Pin       = 1 << a.pin;
+    HAL_GPIO_Init(dsy_hal_map_get_port(&hw_a_.pin), &ginit);
+    ginit.Pin = 1 << b.pin;
+    HAL_GPIO_Init(dsy_hal_map_get_port(&hw_b_.pin), &ginit);
+
+    // x4 encoder mode, the longest input filter (8 samples at 1/32 of the
+    // quarter timer clock, a few us) takes care of the contact bounce
+    tim->CR1   = TIM_CLOCKDIVISION_DIV4;
+    tim->SMCR  = TIM_ENCODERMODE_TI12;
+    tim->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0 | TIM_CCMR1_IC1F
+                 | TIM_CCMR1_IC2F;
+    tim->CCER  = TIM_CCER_CC1E | TIM_CCER_CC2E;
+    tim->ARR   = 0xffff;
+    tim->CNT   = 0;
+    tim->CR1 |= TIM_CR1_CEN;
+
+    // counts up when A falls while B is low, like the software decoding
+    count_reg_    = &tim->CNT;
+    last_count_   = 0;
+    count_rem_    = 0;
+    count_invert_ = match->ch1 != a;
+    return true;
 }
 
 void Encoder::Debounce()
 {
+    if(count_reg_ != nullptr)
+    {
+        // four edges per step, the rest is kept for the next call
+        const uint16_t count = *count_reg_;
+        const int16_t  delta = int16_t(count - last_count_);
+        last_count_          = count;
+        count_rem_ += count_invert_ ? -delta : delta;
+        inc_ = count_rem_ / 4;
+        count_rem_ -= inc_ * 4;
+        updated_ = true;
+        sw_.Debounce();
+        return;
+    }
+
     // update no faster than 1kHz
     uint32_t now = System::GetNow();
     updated_     = false;
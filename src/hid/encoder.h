@@ -17,7 +17,7 @@ namespace daisy
 class Encoder
 {
   public:
-    Encoder() {}
+    Encoder() : count_reg_(nullptr) {}
     ~Encoder() {}
 
     /** Initializes the encoder with the specified hardware pins.
@@ -27,12 +27,30 @@ class Encoder
               dsy_gpio_pin b,
               dsy_gpio_pin click,
               float        update_rate = 0.f);
+
+    /** Initializes the encoder on a timer in encoder mode, if its pins are
+     * the two channels of one. The timer counts every edge of A and B, with
+     * its input filter as debounce, so no step is lost however slowly
+     * Debounce() is called, and Debounce() only reads the counter.
+     *
+     * Pins (A and B, either way around):
+     * TIM1: PA8/PA9, PE9/PE11 - TIM3: PA6/PA7, PB4/PB5, PC6/PC7 -
+     * TIM4: PB6/PB7, PD12/PD13 - TIM5: PA0/PA1, PH10/PH11
+     *
+     * The timer can't be used for anything else, e.g. a TimerHandle, or TIM1
+     * for AdcHandle's multiplexed inputs.
+     * \return false, and the encoder is decoded in software as with Init(),
+     *         if the pins aren't on a timer or it's already running
+     */
+    bool InitHardware(Pin a, Pin b, Pin click);
+
     /** Called at update_rate to debounce and handle timing for the switch.
      * In order for events not to be missed, its important that the Edge/Pressed checks be made at the same rate as the debounce function is being called.
      */
     void Debounce();
 
-    /** Returns +1 if the encoder was turned clockwise, -1 if it was turned counter-clockwise, or 0 if it was not just turned. */
+    /** Returns +1 if the encoder was turned clockwise, -1 if it was turned counter-clockwise, or 0 if it was not just turned.
+     * With InitHardware(), all steps since the last Debounce(), which can be more than one. */
     inline int32_t Increment() const { return updated_ ? inc_ : 0; }
 
     /** Returns true if the encoder was just pressed. */
@@ -59,6 +77,12 @@ class Encoder
     dsy_gpio hw_a_, hw_b_;
     uint8_t  a_, b_;
     int32_t  inc_;
+
+    // InitHardware() state, the counter register of the timer
+    volatile uint32_t *count_reg_;
+    uint16_t           last_count_;
+    int32_t            count_rem_;
+    bool               count_invert_;
 };
 } // namespace daisy
 #endif
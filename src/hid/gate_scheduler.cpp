@@ -0,0 +1,217 @@
+#include "hid/gate_scheduler.h"
+#include "sys/dma_streams.h"
+#include "util/hal_map.h"
+#include <cstring>
+
+using namespace daisy;
+
+// One BSRR word per frame of the audio DMA buffer, both halves, read by
+// the DMA from non-cached memory
+static uint32_t DMA_BUFFER_MEM_SECTION
+    gate_table[2 * DSY_GATE_SCHEDULER_MAX_BLOCK];
+
+static DMA_HandleTypeDef          gate_dma;
+static DmaStreamAllocator::Stream gate_stream;
+
+// The streams of GateScheduler::Config::DmaStream, in its order
+static constexpr DmaStreamAllocator::Stream gate_streams[] = {
+    DmaStreamAllocator::Stream::DMA_1_STREAM_5,
+    DmaStreamAllocator::Stream::DMA_1_STREAM_7,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_4,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_5,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_6,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_7,
+};
+
+static DMA_Stream_TypeDef* const gate_dma_instances[] = {
+    DMA1_Stream0, DMA1_Stream1, DMA1_Stream2, DMA1_Stream3,
+    DMA1_Stream4, DMA1_Stream5, DMA1_Stream6, DMA1_Stream7,
+    DMA2_Stream0, DMA2_Stream1, DMA2_Stream2, DMA2_Stream3,
+    DMA2_Stream4, DMA2_Stream5, DMA2_Stream6, DMA2_Stream7,
+};
+
+/** Claims the stream of the config, or any of them for AUTO */
+static DmaStreamAllocator::Stream
+ClaimDmaStream(GateScheduler::Config::DmaStream stream)
+{
+    const size_t idx = static_cast<size_t>(stream);
+    if(idx < sizeof(gate_streams) / sizeof(gate_streams[0]))
+        return DmaStreamAllocator::Claim(
+                   gate_streams[idx], "gates", DMA_REQUEST_GENERATOR0)
+                   ? gate_streams[idx]
+                   : DmaStreamAllocator::Stream::NONE;
+    uint16_t candidates = 0;
+    for(DmaStreamAllocator::Stream s : gate_streams)
+        candidates |= DmaStreamAllocator::Bit(s);
+    return DmaStreamAllocator::ClaimFree(
+        candidates, "gates", DMA_REQUEST_GENERATOR0);
+}
+
+// The SAI streams are DMA1 streams 0, 1, 3 and 4, which are connected to
+// the DMAMUX1 channels of the same numbers
+static DMAMUX_Channel_TypeDef* const gate_mux_channels[5] = {
+    DMAMUX1_Channel0,
+    DMAMUX1_Channel1,
+    nullptr,
+    DMAMUX1_Channel3,
+    DMAMUX1_Channel4,
+};
+
+static const uint32_t gate_mux_events[5] = {
+    HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH0_EVT,
+    HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH1_EVT,
+    0,
+    HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH3_EVT,
+    HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH4_EVT,
+};
+
+/** Returns the DMA1 stream of the transmitting block of a SAI, or -1 */
+static int GetTxStream(const SaiHandle::Config& cfg)
+{
+    const bool sai1 = cfg.periph == SaiHandle::Config::Peripheral::SAI_1;
+    if(cfg.a_dir == SaiHandle::Config::Direction::TRANSMIT)
+        return sai1 ? 0 : 3;
+    if(cfg.b_dir == SaiHandle::Config::Direction::TRANSMIT)
+        return sai1 ? 1 : 4;
+    return -1;
+}
+
+void GateScheduler::Init(const Config& config)
+{
+    Stop();
+    config_    = config;
+    num_gates_ = 0;
+    port_      = DSY_GPIOX;
+}
+
+int GateScheduler::AddPin(dsy_gpio_pin pin)
+{
+    if(running_ || num_gates_ >= kMaxGates)
+        return -1;
+    if(num_gates_ > 0 && pin.port != port_)
+        return -1;
+    port_ = pin.port;
+
+    dsy_gpio gpio;
+    gpio.pin  = pin;
+    gpio.mode = DSY_GPIO_MODE_OUTPUT_PP;
+    gpio.pull = DSY_GPIO_NOPULL;
+    dsy_gpio_init(&gpio);
+    dsy_gpio_write(&gpio, false);
+
+    gate_bits_[num_gates_] = dsy_hal_map_get_pin(&pin);
+    return int(num_gates_++);
+}
+
+bool GateScheduler::Start(const SaiHandle& sai, size_t block_size)
+{
+    Stop();
+    if(num_gates_ == 0 || !sai.IsInitialized() || block_size == 0
+       || block_size > DSY_GATE_SCHEDULER_MAX_BLOCK)
+        return false;
+    const int tx_stream = GetTxStream(sai.GetConfig());
+    if(tx_stream < 0)
+        return false;
+
+    block_size_ = block_size;
+    write_half_ = 0;
+    std::memset(gate_table, 0, sizeof(gate_table));
+
+    // The transmitting SAI stream makes one request per slot. Its DMAMUX
+    // channel raises an event after the requests of each frame. The SAI
+    // driver sets up the channel in HAL_DMA_Init(), which clears this, so
+    // it's set again with every start.
+    DMAMUX_Channel_TypeDef* mux       = gate_mux_channels[tx_stream];
+    const uint32_t          per_frame = sai.GetSlotCount();
+    mux->CCR = (mux->CCR & ~DMAMUX_CxCR_NBREQ)
+               | ((per_frame - 1) << DMAMUX_CxCR_NBREQ_Pos) | DMAMUX_CxCR_EGE;
+
+    gate_stream = ClaimDmaStream(config_.stream);
+    if(gate_stream == DmaStreamAllocator::Stream::NONE)
+        return false;
+
+    gate_dma.Instance = gate_dma_instances[static_cast<size_t>(gate_stream)];
+
+    gate_dma.Init.Request             = DMA_REQUEST_GENERATOR0;
+    gate_dma.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    gate_dma.Init.PeriphInc           = DMA_PINC_DISABLE;
+    gate_dma.Init.MemInc              = DMA_MINC_ENABLE;
+    gate_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    gate_dma.Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+    gate_dma.Init.Mode                = DMA_CIRCULAR;
+    gate_dma.Init.Priority            = DMA_PRIORITY_MEDIUM;
+    gate_dma.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if(HAL_DMA_Init(&gate_dma) != HAL_OK)
+    {
+        DmaStreamAllocator::Release(gate_stream, "gates");
+        return false;
+    }
+
+    // one request for the gate stream per event, i.e. per frame
+    HAL_DMA_MuxRequestGeneratorConfigTypeDef gen_cfg;
+    gen_cfg.SignalID      = gate_mux_events[tx_stream];
+    gen_cfg.Polarity      = HAL_DMAMUX_REQ_GEN_RISING;
+    gen_cfg.RequestNumber = 1;
+    if(HAL_DMAEx_ConfigMuxRequestGenerator(&gate_dma, &gen_cfg) != HAL_OK)
+    {
+        HAL_DMA_DeInit(&gate_dma);
+        DmaStreamAllocator::Release(gate_stream, "gates");
+        return false;
+    }
+
+    dsy_gpio_pin  pin  = {port_, 0};
+    GPIO_TypeDef* gpio = dsy_hal_map_get_port(&pin);
+    HAL_DMA_Start(&gate_dma,
+                  reinterpret_cast<uint32_t>(gate_table),
+                  reinterpret_cast<uint32_t>(&gpio->BSRR),
+                  2 * block_size_);
+    HAL_DMAEx_EnableMuxRequestGenerator(&gate_dma);
+    running_ = true;
+    return true;
+}
+
+void GateScheduler::Stop()
+{
+    if(!running_)
+        return;
+    HAL_DMAEx_DisableMuxRequestGenerator(&gate_dma);
+    HAL_DMA_Abort(&gate_dma);
+    HAL_DMA_DeInit(&gate_dma);
+    DmaStreamAllocator::Release(gate_stream, "gates");
+    running_ = false;
+}
+
+uint32_t* GateScheduler::GetWriteHalf()
+{
+    // The callback of a block runs right after the DMA finished one half
+    // of the buffer, and writes the output that's sent when the DMA comes
+    // around to that half again. The gate stream is clocked by the same
+    // frames, so that's the half it isn't in.
+    const size_t remaining = __HAL_DMA_GET_COUNTER(&gate_dma);
+    const size_t half      = remaining > block_size_ ? 1 : 0;
+    uint32_t*    words     = gate_table + half * block_size_;
+    if(half != write_half_)
+    {
+        // first call of a new block, the changes in there were sent
+        std::memset(words, 0, block_size_ * sizeof(uint32_t));
+        write_half_ = half;
+    }
+    return words;
+}
+
+void GateScheduler::BeginBlock()
+{
+    if(running_)
+        GetWriteHalf();
+}
+
+void GateScheduler::Schedule(int gate, bool state, size_t offset)
+{
+    if(!running_ || gate < 0 || size_t(gate) >= num_gates_
+       || offset >= block_size_)
+        return;
+    uint32_t*      words = GetWriteHalf();
+    const uint32_t set   = gate_bits_[gate];
+    const uint32_t mask  = set | (set << 16);
+    words[offset]        = (words[offset] & ~mask) | (state ? set : set << 16);
+}
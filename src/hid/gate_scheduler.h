@@ -0,0 +1,147 @@
+#pragma once
+#ifndef DSY_GATE_SCHEDULER_H
+#define DSY_GATE_SCHEDULER_H
+#include "daisy_core.h"
+#include "per/gpio.h"
+#include "per/sai.h"
+
+/** Longest audio block a GateScheduler can follow, in frames */
+#ifndef DSY_GATE_SCHEDULER_MAX_BLOCK
+#define DSY_GATE_SCHEDULER_MAX_BLOCK 256
+#endif
+
+namespace daisy
+{
+/**
+    @brief Gate outputs set and cleared at a sample within the audio block \n
+    Writing a gate pin from the audio callback changes it when the
+    callback runs, so all triggers land on block boundaries. The
+    GateScheduler instead keeps a table of GPIO BSRR words, one per frame
+    of the audio DMA buffer, and a DMA stream writes one word to the port
+    per frame. The stream is clocked by the SAI itself: the DMAMUX channel
+    of its transmitting DMA stream generates an event for every frame, and
+    a DMAMUX request generator turns the events into requests for the gate
+    stream. So the gates follow the audio buffer exactly, without a timer
+    that would drift against the codec clock.
+
+    Like the audio output, a change scheduled in the callback happens one
+    block later, at the same frame as the output sample of that offset.
+    It leads the sound at the jack by the latency of the SAI FIFO and the
+    codec, which is constant.
+
+    All pins have to be on one GPIO port. The DMA stream of the Config
+    must not be used by anything else, Start() fails if another driver
+    claimed it from the DmaStreamAllocator. There can only be one
+    scheduler, as it uses request generator 0. It follows the default
+    double buffered audio, not a deeper AudioHandle::Config::buffer_depth.
+
+    Call BeginBlock() once per audio callback, e.g. from the board's
+    ProcessAllControls(), so that the changes of a block are cleared
+    before the DMA comes around to them again.
+    @ingroup feedback
+
+    @code
+    GateScheduler gates;
+    gates.Init();
+    int trig = gates.AddPin(seed::D15);
+    gates.Start(sai_1, 48); // before audio.Start()
+    // in the audio callback
+    gates.BeginBlock();
+    gates.Schedule(trig, true, 12);
+    gates.Schedule(trig, false, 36);
+    @endcode
+*/
+class GateScheduler
+{
+  public:
+    /** Pins a scheduler can drive */
+    static constexpr size_t kMaxGates = 16;
+
+    /** Settings of the scheduler */
+    struct Config
+    {
+        /** DMA streams the scheduler can use */
+        enum class DmaStream
+        {
+            DMA_1_STREAM_5,
+            DMA_1_STREAM_7,
+            DMA_2_STREAM_4,
+            DMA_2_STREAM_5,
+            DMA_2_STREAM_6,
+            DMA_2_STREAM_7,
+            AUTO, /**< any of these that is free at Start() */
+        };
+
+        /** Stream that writes the port */
+        DmaStream stream;
+
+        Config() : stream(DmaStream::DMA_2_STREAM_7) {}
+    };
+
+    GateScheduler()
+    : running_(false),
+      num_gates_(0),
+      block_size_(0),
+      write_half_(0),
+      port_(DSY_GPIOX)
+    {
+    }
+    ~GateScheduler() {}
+
+    /** Stops the scheduler and removes all pins */
+    void Init(const Config& config = Config());
+
+    /** Configures a pin as output, initially low. Pins are added before
+        Start().
+        \param pin GPIO of the gate
+        \return gate for Schedule(), or -1 if the scheduler is full, or the
+                pin is on another port than the first one
+    */
+    int AddPin(dsy_gpio_pin pin);
+
+    /** Starts following the audio buffer of a SAI. Call it before the
+        audio is started, e.g. before AudioHandle::Start(), so that the
+        first frames of both line up.
+        \param sai SAI of the audio, its transmitting block clocks the gates
+        \param block_size frames per audio callback
+        \return false if there are no pins, the block is too large, or the
+                DMA can't be set up
+    */
+    bool Start(const SaiHandle& sai, size_t block_size);
+
+    /** Stops the DMA, the pins keep their last level */
+    void Stop();
+
+    /** Returns true between Start() and Stop() */
+    bool IsRunning() const { return running_; }
+
+    /** Clears the changes that were scheduled two blocks ago, from the
+        part of the table that the current callback schedules into. Call
+        it once per audio callback. Schedule() does it as well.
+    */
+    void BeginBlock();
+
+    /** Sets or clears a gate at a frame of the block of the current audio
+        callback. A later change of a gate at the same frame replaces an
+        earlier one.
+        \param gate as returned by AddPin()
+        \param state true for high
+        \param offset frame within the block, 0 to block_size - 1
+    */
+    void Schedule(int gate, bool state, size_t offset);
+
+  private:
+    uint32_t* GetWriteHalf();
+
+    Config        config_;
+    bool          running_;
+    uint32_t      gate_bits_[kMaxGates];
+    size_t        num_gates_;
+    size_t        block_size_;
+    size_t        write_half_;
+    dsy_gpio_port port_;
+};
+
+} // namespace daisy
+
+#endif
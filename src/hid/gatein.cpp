@@ -1,4 +1,5 @@
 #include "hid/gatein.h"
+#include "sys/system.h"
 
 using namespace daisy;
 
@@ -10,6 +11,7 @@ void GateIn::Init(dsy_gpio_pin *pin_cfg, bool invert)
     prev_state_ = false;
     state_      = false;
     invert_     = invert;
+    interrupt_  = false;
 }
 
 
@@ -19,12 +21,56 @@ void GateIn::Init(Pin pin_cfg, bool invert)
     prev_state_ = false;
     state_      = false;
     invert_     = invert;
+    interrupt_  = false;
+}
+
+bool GateIn::GetEdge(Edge &edge)
+{
+    if(edges_.isEmpty())
+        return false;
+    edge = edges_.ImmediateRead();
+    return true;
+}
+
+size_t GateIn::GetBlockOffset(uint32_t edge_cycles,
+                              uint32_t block_cycles,
+                              float    samplerate,
+                              size_t   block_size)
+{
+    // an edge just after the start of the callback counts as at the start
+    int32_t age = int32_t(block_cycles - edge_cycles);
+    if(age < 0)
+        age = 0;
+    const float samples = age * samplerate / System::GetCpuFreq();
+    if(samples >= block_size)
+        return 0;
+    const size_t offset = block_size - size_t(samples);
+    return offset < block_size ? offset : block_size - 1;
+}
+
+void GateIn::InternalEdgeCallback()
+{
+    Edge edge;
+    edge.cycles = System::GetCycleCount();
+    edge.rising = !both_edges_ || State();
+    if(edge.rising)
+        rising_count_ = rising_count_ + 1;
+    if(edges_.writable() > 0)
+        edges_.Overwrite(edge);
 }
 
 bool GateIn::Trig()
 {
+    if(interrupt_)
+    {
+        const uint32_t count = rising_count_;
+        const bool     trig  = count != trig_count_;
+        trig_count_          = count;
+        return trig;
+    }
+
     // Inverted because of typical BJT input circuit.
     prev_state_ = state_;
     state_      = invert_ ? !pin_.Read() : pin_.Read();
     return state_ && !prev_state_;
-}
\ No newline at end of file
+}
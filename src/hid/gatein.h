@@ -2,6 +2,12 @@
 #ifndef DSY_GATEIN_H
 #define DSY_GATEIN_H
 #include "per/gpio.h"
+#include "util/ringbuffer.h"
+
+/** Edges an interrupt driven GateIn can queue, one less than this */
+#ifndef DSY_GATEIN_QUEUE_SIZE
+#define DSY_GATEIN_QUEUE_SIZE 16
+#endif
 
 namespace daisy
 {
@@ -14,8 +20,15 @@ namespace daisy
 class GateIn
 {
   public:
+    /** An edge timestamped by the interrupt of InitInterrupt() */
+    struct Edge
+    {
+        uint32_t cycles; /**< System::GetCycleCount() at the edge */
+        bool     rising; /**< true for the start of a gate */
+    };
+
     /** GateIn Constructor */
-    GateIn() {}
+    GateIn() : interrupt_(false) {}
 
     /** GateIn Destructor */
     ~GateIn() {}
@@ -46,6 +59,50 @@ class GateIn
      */
     void Init(dsy_gpio_pin *pin_cfg, bool invert = true);
 
+    /** @brief Initializes the gate input with an EXTI interrupt, which
+     *  timestamps each edge with the cycle counter.
+     *
+     *  Trig() then returns true if a gate started since the last call, also
+     *  a gate shorter than the time between the calls, and GetEdge() gives
+     *  the time of each edge, e.g. to place triggers sample accurately in
+     *  an audio block with GetBlockOffset().
+     *
+     *  There is one EXTI line per pin number, shared by all ports, so e.g.
+     *  PA3 and PB3 can't both be used. The line is registered with
+     *  ExtiLines, where an application registers its own lines as well.
+     *  The interrupt has DSY_IRQ_PRIORITY_GPIO, right below the audio DMA:
+     *  edges during an audio callback in the DMA interrupt are stamped when
+     *  it returns, edges during a deferred callback are exact.
+     *
+     *  @param pin pin to initialize
+     *  @param invert True if the pin state is HIGH when 0V is present
+     *  @param both_edges also queue the ends of the gates
+     *  @return false if the EXTI line of the pin is already in use
+     */
+    bool InitInterrupt(Pin pin, bool invert = true, bool both_edges = false);
+
+    /** Takes the oldest edge of InitInterrupt() from the queue.
+     *  @return false if there are no edges
+     */
+    bool GetEdge(Edge &edge);
+
+    /** Returns the sample of an audio block an edge goes to, delayed by
+     *  exactly one block, so edges keep their spacing.
+     *  @param edge_cycles timestamp of an Edge
+     *  @param block_cycles System::GetCycleCount() at the start of the
+     *         audio callback
+     *  @param samplerate audio samplerate in Hz
+     *  @param block_size samples per block
+     *  @return 0 to block_size - 1, 0 for edges more than a block old
+     */
+    static size_t GetBlockOffset(uint32_t edge_cycles,
+                                 uint32_t block_cycles,
+                                 float    samplerate,
+                                 size_t   block_size);
+
+    /** Called by the EXTI interrupt, not to be called by the user */
+    void InternalEdgeCallback();
+
     /** Checks current state of gate input.
      *  @return True if the GPIO just transitioned.
      */
@@ -60,6 +117,12 @@ class GateIn
     GPIO pin_;
     bool prev_state_, state_;
     bool invert_;
+
+    // InitInterrupt() state
+    bool                                    interrupt_, both_edges_;
+    volatile uint32_t                       rising_count_;
+    uint32_t                                trig_count_;
+    RingBuffer<Edge, DSY_GATEIN_QUEUE_SIZE> edges_;
 };
 } // namespace daisy
 #endif
@@ -0,0 +1,50 @@
+#include "hid/gatein.h"
+#include "stm32h7xx_hal.h"
+#include "sys/exti.h"
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
+
+// Apart from gatein.cpp, so only programs that use the interrupt link the
+// EXTI handlers of ExtiLines.
+
+using namespace daisy;
+
+static void gatein_edge_callback(void *context)
+{
+    static_cast<GateIn *>(context)->InternalEdgeCallback();
+}
+
+bool GateIn::InitInterrupt(Pin pin, bool invert, bool both_edges)
+{
+    const uint8_t line = pin.pin;
+    if(!pin.IsValid()
+       || (ExtiLines::IsRegistered(line)
+           && !ExtiLines::Register(line, &gatein_edge_callback, this)))
+        return false;
+    // starts the GPIO clock
+    Init(pin, invert);
+
+    rising_count_ = 0;
+    trig_count_   = 0;
+    edges_.Init();
+    interrupt_  = true;
+    both_edges_ = both_edges;
+
+    // the start of a gate is the falling edge of an inverted input
+    GPIO_InitTypeDef ginit;
+    if(both_edges)
+        ginit.Mode = GPIO_MODE_IT_RISING_FALLING;
+    else
+        ginit.Mode = invert ? GPIO_MODE_IT_FALLING : GPIO_MODE_IT_RISING;
+    ginit.Pull  = GPIO_NOPULL;
+    ginit.Speed = GPIO_SPEED_FREQ_LOW;
+    ginit.Pin   = 1 << pin.pin;
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    dsy_gpio_pin old_pin = pin;
+    HAL_GPIO_Init(dsy_hal_map_get_port(&old_pin), &ginit);
+
+    return ExtiLines::Register(line, &gatein_edge_callback, this);
+}
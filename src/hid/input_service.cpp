@@ -0,0 +1,141 @@
+#include "hid/input_service.h"
+#include "sys/system.h"
+
+using namespace daisy;
+
+bool InputService::Init(const Config& config)
+{
+    Stop();
+    num_switches_ = 0;
+    num_encoders_ = 0;
+    num_gates_    = 0;
+    dropped_      = 0;
+    events_.Init();
+    if(config.rate <= 0.f)
+        return false;
+
+    // TIM3 and TIM4 only count to 16 bits, the prescaler makes up the rest
+    const bool is_32bit
+        = config.periph == TimerHandle::Config::Peripheral::TIM_2
+          || config.periph == TimerHandle::Config::Peripheral::TIM_5;
+    const float    ticks     = System::GetPClk1Freq() * 2.f / config.rate;
+    const float    max_ticks = is_32bit ? 4294967296.f : 65536.f;
+    const uint32_t prescaler = uint32_t(ticks / max_ticks);
+    if(ticks < 2.f || prescaler > 0xffff)
+        return false;
+
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = config.periph;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.period     = uint32_t(ticks / (prescaler + 1) + 0.5f) - 1;
+    tim_cfg.enable_irq = true;
+    if(tim_.Init(tim_cfg) != TimerHandle::Result::OK)
+        return false;
+    tim_.SetPrescaler(prescaler);
+    tim_.SetCallback(TimerCallback, this);
+    return true;
+}
+
+int InputService::AddSwitch(Switch* sw)
+{
+    if(sw == nullptr || num_switches_ >= DSY_INPUT_SERVICE_MAX_INPUTS)
+        return -1;
+    switches_[num_switches_] = sw;
+    return int(num_switches_++);
+}
+
+int InputService::AddEncoder(Encoder* enc)
+{
+    if(enc == nullptr || num_encoders_ >= DSY_INPUT_SERVICE_MAX_INPUTS)
+        return -1;
+    encoders_[num_encoders_] = enc;
+    return int(num_encoders_++);
+}
+
+int InputService::AddGateIn(GateIn* gate)
+{
+    if(gate == nullptr || num_gates_ >= DSY_INPUT_SERVICE_MAX_INPUTS)
+        return -1;
+    gates_[num_gates_] = gate;
+    return int(num_gates_++);
+}
+
+void InputService::Start()
+{
+    if(!running_)
+    {
+        running_ = true;
+        tim_.Start();
+    }
+}
+
+void InputService::Stop()
+{
+    if(running_)
+    {
+        tim_.Stop();
+        running_ = false;
+    }
+}
+
+bool InputService::GetEvent(Event& event)
+{
+    if(events_.isEmpty())
+        return false;
+    event = events_.ImmediateRead();
+    return true;
+}
+
+void InputService::TimerCallback(void* data)
+{
+    static_cast<InputService*>(data)->Sample();
+}
+
+void InputService::Push(EventType type,
+                        size_t    index,
+                        int32_t   increment,
+                        uint32_t  now)
+{
+    if(events_.writable() == 0)
+    {
+        dropped_ = dropped_ + 1;
+        return;
+    }
+    Event event;
+    event.type      = type;
+    event.index     = uint8_t(index);
+    event.increment = int8_t(increment);
+    event.time_ms   = now;
+    events_.Overwrite(event);
+}
+
+void InputService::Sample()
+{
+    const uint32_t now = System::GetNow();
+    for(size_t i = 0; i < num_switches_; i++)
+    {
+        Switch* sw = switches_[i];
+        sw->Debounce();
+        if(sw->RisingEdge())
+            Push(EventType::SWITCH_PRESSED, i, 0, now);
+        if(sw->FallingEdge())
+            Push(EventType::SWITCH_RELEASED, i, 0, now);
+    }
+    for(size_t i = 0; i < num_encoders_; i++)
+    {
+        Encoder* enc = encoders_[i];
+        enc->Debounce();
+        const int32_t inc = enc->Increment();
+        if(inc != 0)
+            Push(EventType::ENCODER_TURNED, i, inc, now);
+        if(enc->RisingEdge())
+            Push(EventType::ENCODER_PRESSED, i, 0, now);
+        if(enc->FallingEdge())
+            Push(EventType::ENCODER_RELEASED, i, 0, now);
+    }
+    for(size_t i = 0; i < num_gates_; i++)
+    {
+        if(gates_[i]->Trig())
+            Push(EventType::GATE_TRIGGERED, i, 0, now);
+    }
+}
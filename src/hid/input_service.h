@@ -0,0 +1,150 @@
+#pragma once
+#ifndef DSY_INPUT_SERVICE_H
+#define DSY_INPUT_SERVICE_H
+#include "daisy_core.h"
+#include "hid/encoder.h"
+#include "hid/gatein.h"
+#include "hid/switch.h"
+#include "per/tim.h"
+#include "util/ringbuffer.h"
+
+/** Number of inputs of each type an InputService can hold */
+#ifndef DSY_INPUT_SERVICE_MAX_INPUTS
+#define DSY_INPUT_SERVICE_MAX_INPUTS 16
+#endif
+
+/** Size of the event queue of an InputService, one less can be queued */
+#ifndef DSY_INPUT_SERVICE_QUEUE_SIZE
+#define DSY_INPUT_SERVICE_QUEUE_SIZE 64
+#endif
+
+namespace daisy
+{
+/**
+    @brief Samples switches, encoders and gates from a timer interrupt \n
+    Normally the digital controls are debounced from the main loop or the
+    audio callback, so how well they work depends on how often that
+    happens, e.g. on the audio block size. The InputService calls
+    Debounce() of all its Switch and Encoder objects, and Trig() of its
+    GateIn objects, from a TimerHandle interrupt at a fixed rate instead,
+    and queues what happened as events for the main loop.
+
+    Once added, the inputs must not be debounced anywhere else, e.g. by
+    the ProcessDigitalControls() of a board. Their Pressed() and
+    TimeHeldMs() can still be read, the edges and increments are only seen
+    through the events.
+
+    Switch::Debounce() and Encoder::Debounce() update at most once per
+    millisecond, so rates above 1kHz only help the gates. Gates shorter
+    than one period can be missed.
+    @ingroup controls
+
+    @code
+    InputService inputs;
+    inputs.Init();
+    inputs.AddEncoder(&hw.encoder);
+    inputs.AddSwitch(&hw.button1);
+    inputs.Start();
+
+    InputService::Event event;
+    while(inputs.GetEvent(event))
+    {
+        if(event.type == InputService::EventType::ENCODER_TURNED)
+            value += event.increment;
+    }
+    @endcode
+*/
+class InputService
+{
+  public:
+    /** Settings of the service */
+    struct Config
+    {
+        /** Timer that runs the service, not TIM_2, which System uses */
+        TimerHandle::Config::Peripheral periph;
+
+        /** Samples per second */
+        float rate;
+
+        Config() : periph(TimerHandle::Config::Peripheral::TIM_5), rate(1000.f)
+        {
+        }
+    };
+
+    /** What an Event is about */
+    enum class EventType
+    {
+        SWITCH_PRESSED,   /**< a Switch was pressed */
+        SWITCH_RELEASED,  /**< a Switch was released */
+        ENCODER_TURNED,   /**< an Encoder turned, by the increment */
+        ENCODER_PRESSED,  /**< the switch of an Encoder was pressed */
+        ENCODER_RELEASED, /**< the switch of an Encoder was released */
+        GATE_TRIGGERED,   /**< a GateIn went high */
+    };
+
+    /** Something that happened to an input */
+    struct Event
+    {
+        EventType type;
+        uint8_t   index;     /**< as returned by AddSwitch() etc. */
+        int8_t    increment; /**< +1 or -1 for ENCODER_TURNED */
+        uint32_t  time_ms;   /**< System::GetNow() of the event */
+    };
+
+    InputService() : running_(false) {}
+    ~InputService() {}
+
+    /** Initializes the timer and removes all inputs
+        \return false if the timer can't run at the rate
+    */
+    bool Init(const Config& config = Config());
+
+    /** Adds a switch, initialized by the caller
+        \return index for the events, or -1 if the service is full
+    */
+    int AddSwitch(Switch* sw);
+
+    /** Adds an encoder, initialized by the caller
+        \return index for the events, or -1 if the service is full
+    */
+    int AddEncoder(Encoder* enc);
+
+    /** Adds a gate input, initialized by the caller
+        \return index for the events, or -1 if the service is full
+    */
+    int AddGateIn(GateIn* gate);
+
+    /** Starts sampling the inputs */
+    void Start();
+
+    /** Stops sampling the inputs */
+    void Stop();
+
+    /** Takes the oldest event from the queue, from the main loop
+        \return false if there are no events
+    */
+    bool GetEvent(Event& event);
+
+    /** Returns the number of events that were lost to a full queue */
+    uint32_t GetNumDropped() const { return dropped_; }
+
+  private:
+    static void TimerCallback(void* data);
+    void        Sample();
+
+    void Push(EventType type, size_t index, int32_t increment, uint32_t now);
+
+    TimerHandle tim_;
+    bool        running_;
+
+    Switch*  switches_[DSY_INPUT_SERVICE_MAX_INPUTS];
+    Encoder* encoders_[DSY_INPUT_SERVICE_MAX_INPUTS];
+    GateIn*  gates_[DSY_INPUT_SERVICE_MAX_INPUTS];
+    size_t   num_switches_, num_encoders_, num_gates_;
+
+    RingBuffer<Event, DSY_INPUT_SERVICE_QUEUE_SIZE> events_;
+    volatile uint32_t                               dropped_;
+};
+
+} // namespace daisy
+#endif
@@ -1,4 +1,5 @@
 #include "hid/led.h"
+#include "hid/led_pwm_service.h"
 #include "per/tim.h"
 
 using namespace daisy;
@@ -12,6 +13,7 @@ void Led::Init(dsy_gpio_pin pin, bool invert, float samplerate)
     hw_pin_.pin  = pin;
     hw_pin_.mode = DSY_GPIO_MODE_OUTPUT_PP;
     dsy_gpio_init(&hw_pin_);
+    pwm_service_ = nullptr;
     // Set internal stuff.
     bright_  = 0.0f;
     pwm_cnt_ = 0;
@@ -29,14 +31,34 @@ void Led::Init(dsy_gpio_pin pin, bool invert, float samplerate)
         off_ = false;
     }
 }
+bool Led::Init(dsy_gpio_pin pin, bool invert, LedPwmService& pwm)
+{
+    hw_pin_.pin  = pin;
+    invert_      = invert;
+    on_          = !invert;
+    off_         = invert;
+    bright_      = 0.0f;
+    pwm_service_ = nullptr;
+    pwm_channel_ = pwm.AddPin(pin, invert);
+    if(pwm_channel_ < 0)
+        return false;
+    pwm_service_ = &pwm;
+    return true;
+}
+
 void Led::Set(float val)
 {
     bright_     = cube(val);
     pwm_thresh_ = bright_ * static_cast<float>(RESOLUTION_MAX);
+    if(pwm_service_ != nullptr)
+        pwm_service_->SetDuty(pwm_channel_, bright_);
 }
 
 void Led::Update()
 {
+    if(pwm_service_ != nullptr)
+        return;
+
     // Shout out to @grrwaaa for the quick fix for pwm
     pwm_ += 120.f / samplerate_;
     if(pwm_ > 1.f)
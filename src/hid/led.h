@@ -11,6 +11,8 @@
 
 namespace daisy
 {
+class LedPwmService;
+
 /**
     @brief LED Class providing simple Software PWM ability, etc \n 
     Eventually this will work with hardware PWM, and external LED Driver devices as well.
@@ -32,6 +34,16 @@ class Led
     */
     void Init(dsy_gpio_pin pin, bool invert, float samplerate = 1000.0f);
 
+    /**
+    Initializes an LED that's driven by a LedPwmService, Set() then only
+    changes its duty cycle, and Update() doesn't need to be called.
+    \param pin chooses LED pin
+    \param invert will set whether to internally invert the brightness due to hardware config.
+    \param pwm the service, before its Start()
+    \return false if the service can't take the pin
+    */
+    bool Init(dsy_gpio_pin pin, bool invert, LedPwmService& pwm);
+
     /** 
     Sets the brightness of the Led.
     \param val will be cubed for gamma correction, and then quantized to 8-bit values for Software PWM
@@ -42,6 +54,7 @@ class Led
     /** 
     This processes the pwm of the LED
     sets the hardware accordingly.
+    Does nothing for an LED driven by a LedPwmService.
     */
     void Update();
 
@@ -57,6 +70,9 @@ class Led
     float    samplerate_;
     bool     invert_, on_, off_;
     dsy_gpio hw_pin_;
+
+    LedPwmService* pwm_service_;
+    int            pwm_channel_;
 };
 
 } // namespace daisy
@@ -0,0 +1,243 @@
+#include "hid/led_pwm_service.h"
+#include "sys/dma_streams.h"
+#include "sys/system.h"
+#include "util/hal_map.h"
+#include "util/scopedirqblocker.h"
+
+using namespace daisy;
+
+// One BSRR word per step and port, read by the DMA from non-cached memory
+static uint32_t DMA_BUFFER_MEM_SECTION
+    led_pwm_table[LedPwmService::kMaxPorts][DSY_LED_PWM_STEPS];
+
+static DMA_HandleTypeDef led_pwm_dma[LedPwmService::kMaxPorts];
+
+static DmaStreamAllocator::Stream led_pwm_streams[LedPwmService::kMaxPorts];
+
+// The streams of LedPwmService::Config::DmaStream, in its order
+static constexpr DmaStreamAllocator::Stream led_pwm_candidates[] = {
+    DmaStreamAllocator::Stream::DMA_1_STREAM_5,
+    DmaStreamAllocator::Stream::DMA_1_STREAM_7,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_4,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_5,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_6,
+    DmaStreamAllocator::Stream::DMA_2_STREAM_7,
+};
+
+static DMA_Stream_TypeDef* const led_pwm_dma_instances[] = {
+    DMA1_Stream0, DMA1_Stream1, DMA1_Stream2, DMA1_Stream3,
+    DMA1_Stream4, DMA1_Stream5, DMA1_Stream6, DMA1_Stream7,
+    DMA2_Stream0, DMA2_Stream1, DMA2_Stream2, DMA2_Stream3,
+    DMA2_Stream4, DMA2_Stream5, DMA2_Stream6, DMA2_Stream7,
+};
+
+/** Claims the stream of the config, or any of them for AUTO */
+static DmaStreamAllocator::Stream
+ClaimDmaStream(LedPwmService::Config::DmaStream stream, uint32_t request)
+{
+    const size_t idx = static_cast<size_t>(stream);
+    if(idx < sizeof(led_pwm_candidates) / sizeof(led_pwm_candidates[0]))
+        return DmaStreamAllocator::Claim(
+                   led_pwm_candidates[idx], "led_pwm", request)
+                   ? led_pwm_candidates[idx]
+                   : DmaStreamAllocator::Stream::NONE;
+    uint16_t candidates = 0;
+    for(DmaStreamAllocator::Stream s : led_pwm_candidates)
+        candidates |= DmaStreamAllocator::Bit(s);
+    return DmaStreamAllocator::ClaimFree(candidates, "led_pwm", request);
+}
+
+static TIM_TypeDef* GetTimer(TimerHandle::Config::Peripheral periph)
+{
+    constexpr TIM_TypeDef* instances[4] = {TIM2, TIM3, TIM4, TIM5};
+    return instances[static_cast<size_t>(periph)];
+}
+
+// The requests of the update event and of compares 1 to 3, which all
+// happen once per timer period with the compare values at 0
+static const uint32_t led_pwm_requests[4][LedPwmService::kMaxPorts] = {
+    {DMA_REQUEST_TIM2_UP,
+     DMA_REQUEST_TIM2_CH1,
+     DMA_REQUEST_TIM2_CH2,
+     DMA_REQUEST_TIM2_CH3},
+    {DMA_REQUEST_TIM3_UP,
+     DMA_REQUEST_TIM3_CH1,
+     DMA_REQUEST_TIM3_CH2,
+     DMA_REQUEST_TIM3_CH3},
+    {DMA_REQUEST_TIM4_UP,
+     DMA_REQUEST_TIM4_CH1,
+     DMA_REQUEST_TIM4_CH2,
+     DMA_REQUEST_TIM4_CH3},
+    {DMA_REQUEST_TIM5_UP,
+     DMA_REQUEST_TIM5_CH1,
+     DMA_REQUEST_TIM5_CH2,
+     DMA_REQUEST_TIM5_CH3},
+};
+
+static const uint32_t led_pwm_dier_bits[LedPwmService::kMaxPorts]
+    = {TIM_DIER_UDE, TIM_DIER_CC1DE, TIM_DIER_CC2DE, TIM_DIER_CC3DE};
+
+bool LedPwmService::Init(const Config& config)
+{
+    Stop();
+    config_       = config;
+    num_channels_ = 0;
+    num_ports_    = 0;
+    if(config.frequency <= 0.f
+       || config.periph == TimerHandle::Config::Peripheral::TIM_2)
+        return false;
+
+    // TIM3 and TIM4 only count to 16 bits, the prescaler makes up the rest
+    const bool is_32bit
+        = config.periph == TimerHandle::Config::Peripheral::TIM_5;
+    const float ticks = System::GetPClk1Freq() * 2.f
+                        / (config.frequency * DSY_LED_PWM_STEPS);
+    const float    max_ticks = is_32bit ? 4294967296.f : 65536.f;
+    const uint32_t prescaler = uint32_t(ticks / max_ticks);
+    if(ticks < 2.f || prescaler > 0xffff)
+        return false;
+
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = config.periph;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.period     = uint32_t(ticks / (prescaler + 1) + 0.5f) - 1;
+    tim_cfg.enable_irq = false;
+    if(tim_.Init(tim_cfg) != TimerHandle::Result::OK)
+        return false;
+    tim_.SetPrescaler(prescaler);
+    return true;
+}
+
+int LedPwmService::AddPin(dsy_gpio_pin pin, bool invert)
+{
+    if(running_ || num_channels_ >= DSY_LED_PWM_MAX_CHANNELS)
+        return -1;
+
+    size_t port = 0;
+    while(port < num_ports_ && ports_[port] != pin.port)
+        port++;
+    if(port == num_ports_)
+    {
+        if(num_ports_ >= kMaxPorts)
+            return -1;
+        ports_[num_ports_++] = pin.port;
+        for(size_t i = 0; i < DSY_LED_PWM_STEPS; i++)
+            led_pwm_table[port][i] = 0;
+    }
+
+    dsy_gpio gpio;
+    gpio.pin  = pin;
+    gpio.mode = DSY_GPIO_MODE_OUTPUT_PP;
+    gpio.pull = DSY_GPIO_NOPULL;
+    dsy_gpio_init(&gpio);
+
+    const uint32_t set = dsy_hal_map_get_pin(&pin);
+    Channel&       ch  = channels_[num_channels_];
+    ch.port            = uint8_t(port);
+    ch.steps           = 0;
+    ch.on_bits         = invert ? set << 16 : set;
+    ch.off_bits        = invert ? set : set << 16;
+
+    const uint32_t mask  = set | (set << 16);
+    uint32_t*      table = led_pwm_table[port];
+    for(size_t i = 0; i < DSY_LED_PWM_STEPS; i++)
+        table[i] = (table[i] & ~mask) | ch.off_bits;
+    dsy_gpio_write(&gpio, invert);
+    return int(num_channels_++);
+}
+
+void LedPwmService::SetDuty(int channel, float duty)
+{
+    duty = duty < 0.f ? 0.f : (duty > 1.f ? 1.f : duty);
+    SetDutyRaw(channel, uint32_t(duty * DSY_LED_PWM_STEPS + 0.5f));
+}
+
+void LedPwmService::SetDutyRaw(int channel, uint32_t steps)
+{
+    if(channel < 0 || size_t(channel) >= num_channels_)
+        return;
+    if(steps > DSY_LED_PWM_STEPS)
+        steps = DSY_LED_PWM_STEPS;
+
+    // Only the steps between the old and the new duty cycle change. Other
+    // channels on the port share the words, so the read-modify-write is
+    // done with interrupts blocked.
+    ScopedIrqBlocker block;
+    Channel&         ch = channels_[channel];
+    if(steps == ch.steps)
+        return;
+    const uint32_t bits  = steps > ch.steps ? ch.on_bits : ch.off_bits;
+    const uint32_t mask  = ch.on_bits | ch.off_bits;
+    const uint32_t first = steps > ch.steps ? ch.steps : steps;
+    const uint32_t last  = steps > ch.steps ? steps : ch.steps;
+    uint32_t*      table = led_pwm_table[ch.port];
+    for(uint32_t i = first; i < last; i++)
+        table[i] = (table[i] & ~mask) | bits;
+    ch.steps = steps;
+}
+
+void LedPwmService::Start()
+{
+    if(running_ || num_ports_ == 0)
+        return;
+    const size_t tim_idx = static_cast<size_t>(config_.periph);
+    TIM_TypeDef* tim     = GetTimer(config_.periph);
+    for(size_t port = 0; port < num_ports_; port++)
+    {
+        const uint32_t request = led_pwm_requests[tim_idx][port];
+        led_pwm_streams[port]  = ClaimDmaStream(config_.streams[port], request);
+        if(led_pwm_streams[port] == DmaStreamAllocator::Stream::NONE)
+            continue;
+
+        const size_t       stream_idx  = size_t(led_pwm_streams[port]);
+        DMA_HandleTypeDef* hdma        = &led_pwm_dma[port];
+        hdma->Instance                 = led_pwm_dma_instances[stream_idx];
+        hdma->Init.Request             = request;
+        hdma->Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hdma->Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma->Init.MemInc              = DMA_MINC_ENABLE;
+        hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+        hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+        hdma->Init.Mode                = DMA_CIRCULAR;
+        hdma->Init.Priority            = DMA_PRIORITY_LOW;
+        hdma->Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+        if(HAL_DMA_Init(hdma) != HAL_OK)
+        {
+            DmaStreamAllocator::Release(led_pwm_streams[port], "led_pwm");
+            led_pwm_streams[port] = DmaStreamAllocator::Stream::NONE;
+            continue;
+        }
+
+        dsy_gpio_pin  pin  = {ports_[port], 0};
+        GPIO_TypeDef* gpio = dsy_hal_map_get_port(&pin);
+        HAL_DMA_Start(hdma,
+                      reinterpret_cast<uint32_t>(led_pwm_table[port]),
+                      reinterpret_cast<uint32_t>(&gpio->BSRR),
+                      DSY_LED_PWM_STEPS);
+        tim->DIER |= led_pwm_dier_bits[port];
+    }
+    tim->CCR1 = 0;
+    tim->CCR2 = 0;
+    tim->CCR3 = 0;
+    running_  = true;
+    tim_.Start();
+}
+
+void LedPwmService::Stop()
+{
+    if(!running_)
+        return;
+    tim_.Stop();
+    TIM_TypeDef* tim = GetTimer(config_.periph);
+    for(size_t port = 0; port < num_ports_; port++)
+    {
+        tim->DIER &= ~led_pwm_dier_bits[port];
+        if(led_pwm_streams[port] == DmaStreamAllocator::Stream::NONE)
+            continue;
+        HAL_DMA_Abort(&led_pwm_dma[port]);
+        HAL_DMA_DeInit(&led_pwm_dma[port]);
+        DmaStreamAllocator::Release(led_pwm_streams[port], "led_pwm");
+        led_pwm_streams[port] = DmaStreamAllocator::Stream::NONE;
+    }
+    running_ = false;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#ifndef DSY_LED_PWM_SERVICE_H
+#define DSY_LED_PWM_SERVICE_H
+#include "daisy_core.h"
+#include "per/gpio.h"
+#include "per/tim.h"
+
+/** Steps of the duty cycle within one PWM period */
+#ifndef DSY_LED_PWM_STEPS
+#define DSY_LED_PWM_STEPS 256
+#endif
+
+/** Number of pins a LedPwmService can drive */
+#ifndef DSY_LED_PWM_MAX_CHANNELS
+#define DSY_LED_PWM_MAX_CHANNELS 32
+#endif
+
+namespace daisy
+{
+/**
+    @brief Software PWM for GPIO LEDs, generated by DMA \n
+    Led::Update() toggles its pin from the main loop, so the LED flickers
+    whenever the loop is busy, and it costs CPU time. The LedPwmService
+    instead keeps a table with a GPIO BSRR word for each step of the PWM
+    period, one table per GPIO port, and a DMA stream per port writes the
+    table to the port in a loop, clocked by a timer. Setting a duty cycle
+    only rewrites the steps between the old and the new one, the pins then
+    run without the CPU.
+
+    Up to 4 GPIO ports can be used, each needs one of the DMA streams of
+    the Config, which must not be used by anything else, e.g. the DMA of a
+    UartHandler. Start() claims them from the DmaStreamAllocator, and a port
+    whose stream is taken isn't driven. The timer's update and compare 1 to
+    3 requests clock the streams. There can only be one service.
+
+    Led and RgbLed take the service in Init(), and their Set() then only
+    writes the duty cycle.
+    @ingroup feedback
+
+    @code
+    LedPwmService pwm;
+    pwm.Init();
+    led.Init(seed::D7, false, pwm);
+    pwm.Start();
+    led.Set(0.5f);
+    @endcode
+*/
+class LedPwmService
+{
+  public:
+    /** GPIO ports the service can drive at once */
+    static constexpr size_t kMaxPorts = 4;
+
+    /** Settings of the service */
+    struct Config
+    {
+        /** DMA streams the service can use, one per GPIO port */
+        enum class DmaStream
+        {
+            DMA_1_STREAM_5,
+            DMA_1_STREAM_7,
+            DMA_2_STREAM_4,
+            DMA_2_STREAM_5,
+            DMA_2_STREAM_6,
+            DMA_2_STREAM_7,
+            AUTO, /**< any of these that is free at Start() */
+        };
+
+        /** Timer that clocks the DMA, not TIM_2, which System uses */
+        TimerHandle::Config::Peripheral periph;
+
+        /** PWM periods per second */
+        float frequency;
+
+        /** Stream for the first, second, ... port that pins are added on */
+        DmaStream streams[kMaxPorts];
+
+        Config()
+        : periph(TimerHandle::Config::Peripheral::TIM_4), frequency(500.f)
+        {
+            streams[0] = DmaStream::DMA_2_STREAM_5;
+            streams[1] = DmaStream::DMA_2_STREAM_6;
+            streams[2] = DmaStream::DMA_2_STREAM_7;
+            streams[3] = DmaStream::DMA_1_STREAM_7;
+        }
+    };
+
+    LedPwmService() : running_(false), num_channels_(0), num_ports_(0) {}
+    ~LedPwmService() {}
+
+    /** Initializes the timer and removes all pins
+        \return false if the timer can't run at the rate
+    */
+    bool Init(const Config& config = Config());
+
+    /** Configures a pin as output, initially off. Pins are added before
+        Start().
+        \param pin GPIO of the LED
+        \param invert true if the LED is on when the pin is low
+        \return channel for SetDuty(), or -1 if the service is full, or the
+                pin is on a fifth port
+    */
+    int AddPin(dsy_gpio_pin pin, bool invert);
+
+    /** Sets the duty cycle of a channel, from any context
+        \param channel as returned by AddPin()
+        \param duty 0 to 1, linear
+    */
+    void SetDuty(int channel, float duty);
+
+    /** Sets the duty cycle of a channel, in steps of the period
+        \param channel as returned by AddPin()
+        \param steps 0 to DSY_LED_PWM_STEPS
+    */
+    void SetDutyRaw(int channel, uint32_t steps);
+
+    /** Starts the DMA and the timer */
+    void Start();
+
+    /** Stops the timer and the DMA, the pins keep their last level */
+    void Stop();
+
+  private:
+    struct Channel
+    {
+        uint8_t  port;
+        uint16_t steps;
+        uint32_t on_bits;
+        uint32_t off_bits;
+    };
+
+    TimerHandle tim_;
+    Config      config_;
+    bool        running_;
+
+    Channel channels_[DSY_LED_PWM_MAX_CHANNELS];
+    size_t  num_channels_;
+
+    dsy_gpio_port ports_[kMaxPorts];
+    size_t        num_ports_;
+};
+
+} // namespace daisy
+
+#endif
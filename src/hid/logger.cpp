@@ -1,9 +1,10 @@
 #include <cstring>
 #include <cstdarg>
-#include <cstdio>
 #include <cassert>
 #include "logger.h"
 #include "sys/system.h"
+#include "util/StringFormat.h"
+#include "stm32h7xx_hal.h"
 
 namespace daisy
 {
@@ -18,7 +19,13 @@ void Logger<dest>::Print(const char* format, ...)
 template <LoggerDestination dest>
 void Logger<dest>::PrintV(const char* format, va_list va)
 {
-    tx_ptr_ += vsnprintf(
+    if(LoggerIsAsync(dest))
+    {
+        PrintAsync(false, format, va);
+        return;
+    }
+
+    tx_ptr_ += FormatStringV(
         tx_buff_ + tx_ptr_, sizeof(tx_buff_) - tx_ptr_, format, va);
 
     TransmitBuf();
@@ -36,7 +43,13 @@ void Logger<dest>::PrintLine(const char* format, ...)
 template <LoggerDestination dest>
 void Logger<dest>::PrintLineV(const char* format, va_list va)
 {
-    tx_ptr_ += vsnprintf(
+    if(LoggerIsAsync(dest))
+    {
+        PrintAsync(true, format, va);
+        return;
+    }
+
+    tx_ptr_ += FormatStringV(
         tx_buff_ + tx_ptr_, sizeof(tx_buff_) - tx_ptr_, format, va);
 
     AppendNewLine();
@@ -91,37 +104,158 @@ void Logger<dest>::TransmitBuf()
 
 template <LoggerDestination dest>
 void Logger<dest>::AppendNewLine()
+{
+    tx_ptr_ = AppendNewLine(tx_buff_, tx_ptr_, sizeof(tx_buff_));
+}
+
+template <LoggerDestination dest>
+size_t Logger<dest>::AppendNewLine(char* buff, size_t len, size_t size)
 {
     /*  trim existing control characters */
-    while(tx_ptr_ > 0
-          && (tx_buff_[tx_ptr_ - 1] == '\n' || tx_buff_[tx_ptr_ - 1] == '\r'))
+    while(len > 0 && (buff[len - 1] == '\n' || buff[len - 1] == '\r'))
     {
-        tx_ptr_--;
+        len--;
     }
 
     /* check if there's enough room for newline sequence */
     constexpr size_t eol = NewLineSeqLength();
-    if(tx_ptr_ + eol < sizeof(tx_buff_))
+    if(len + eol < size)
     {
         /* this loop will be optimized away by the compiler */
         constexpr const char* nl = LOGGER_NEWLINE;
         for(size_t i = 0; i < eol; i++)
         {
-            tx_buff_[tx_ptr_++] = nl[i];
+            buff[len++] = nl[i];
         }
+        return len;
     }
-    else /**< trigger overflow indication */
+    /**< trigger overflow indication */
+    return size;
+}
+
+template <LoggerDestination dest>
+void Logger<dest>::PrintAsync(bool newline, const char* format, va_list va)
+{
+    char   buff[LOGGER_BUFFER];
+    size_t len = FormatStringV(buff, sizeof(buff), format, va);
+    if(newline)
     {
-        tx_ptr_ = sizeof(tx_buff_);
+        len = AppendNewLine(buff, len, sizeof(buff));
     }
+    if(len >= sizeof(buff))
+    {
+        /** indicate truncation with an unlikely character sequence "$$" */
+        buff[sizeof(buff) - 1] = '$';
+        buff[sizeof(buff) - 2] = '$';
+
+        len = sizeof(buff);
+    }
+    impl_.Transmit(buff, len);
 }
 
 /** explicit forward specializations */
 template class Logger<LOGGER_INTERNAL>;
 template class Logger<LOGGER_EXTERNAL>;
 template class Logger<LOGGER_SEMIHOST>;
+template class Logger<LOGGER_INTERNAL_ASYNC>;
+template class Logger<LOGGER_EXTERNAL_ASYNC>;
+template class Logger<LOGGER_SWO>;
 
 /** LoggerImpl static member variables */
 UsbHandle LoggerImpl<LOGGER_INTERNAL>::usb_handle_;
 UsbHandle LoggerImpl<LOGGER_EXTERNAL>::usb_handle_;
+uint32_t  LoggerImpl<LOGGER_SWO>::dropped_ = 0;
+
+/** SWO and trace funnel of the STM32H7, which the CMSIS headers don't
+ *  define, see the debug support chapter of RM0433
+ */
+static constexpr uintptr_t kSwoCodr   = 0x5C003010; /**< prescaler */
+static constexpr uintptr_t kSwoSppr   = 0x5C0030F0; /**< protocol */
+static constexpr uintptr_t kSwoLar    = 0x5C003FB0; /**< lock access */
+static constexpr uintptr_t kSwtfCtrl  = 0x5C004000; /**< funnel ports */
+static constexpr uintptr_t kSwtfLar   = 0x5C004FB0; /**< lock access */
+static constexpr uint32_t  kUnlockKey = 0xC5ACCE55;
+
+static volatile uint32_t& DebugRegister(uintptr_t address)
+{
+    return *reinterpret_cast<volatile uint32_t*>(address);
+}
+
+/** The SWO is clocked by the CPU clock */
+static void SetSwoPrescaler(void* context)
+{
+    DebugRegister(kSwoCodr) = System::GetCpuFreq() / LOGGER_SWO_BAUD - 1;
+}
+
+void LoggerImpl<LOGGER_SWO>::Init()
+{
+    /** TRACESWO, the alternate function 0 of PB3 */
+    GPIO_InitTypeDef pin = {};
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    pin.Pin       = GPIO_PIN_3;
+    pin.Mode      = GPIO_MODE_AF_PP;
+    pin.Pull      = GPIO_NOPULL;
+    pin.Speed     = GPIO_SPEED_FREQ_VERY_HIGH;
+    pin.Alternate = GPIO_AF0_SWJ;
+    HAL_GPIO_Init(GPIOB, &pin);
+
+    DBGMCU->CR |= DBGMCU_CR_DBG_TRACECKEN | DBGMCU_CR_DBG_CKD1EN
+                  | DBGMCU_CR_DBG_CKD3EN;
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+    /** SWO in NRZ (UART) mode, and the funnel passes the trace of the core */
+    DebugRegister(kSwoLar) = kUnlockKey;
+    SetSwoPrescaler(nullptr);
+    DebugRegister(kSwoSppr) = 2;
+    DebugRegister(kSwtfLar) = kUnlockKey;
+    DebugRegister(kSwtfCtrl) |= 1;
+
+    static bool registered = false;
+    if(!registered)
+        registered = System::AddClockChangeCallback(SetSwoPrescaler, nullptr);
+
+    ITM->LAR = kUnlockKey;
+    ITM->TCR = ITM_TCR_ITMENA_Msk | ITM_TCR_SYNCENA_Msk
+               | (1u << ITM_TCR_TraceBusID_Pos);
+    ITM->TPR = 0;
+    ITM->TER |= 1u << LOGGER_SWO_PORT;
+}
+
+bool LoggerImpl<LOGGER_SWO>::Transmit(const void* buffer, size_t bytes)
+{
+    /** a probe, or Init(), enables the port */
+    if((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0
+       || (ITM->TER & (1u << LOGGER_SWO_PORT)) == 0)
+    {
+        dropped_ += bytes;
+        return true;
+    }
+
+    /** the stimulus port reads as 1 while its FIFO has room */
+    volatile ITM_Type* const itm  = ITM;
+    const uint8_t*           data = static_cast<const uint8_t*>(buffer);
+    ScopedIrqBlocker         block;
+    for(; bytes >= 4; bytes -= 4, data += 4)
+    {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        while(itm->PORT[LOGGER_SWO_PORT].u32 == 0) {}
+        itm->PORT[LOGGER_SWO_PORT].u32 = word;
+    }
+    for(; bytes > 0; bytes--, data++)
+    {
+        while(itm->PORT[LOGGER_SWO_PORT].u32 == 0) {}
+        itm->PORT[LOGGER_SWO_PORT].u8 = *data;
+    }
+    return true;
+}
+
+bool LoggerCanAccessUsb()
+{
+    /** thread mode, or an interrupt at or below the USB priority */
+    const uint32_t active = __get_IPSR();
+    return active == 0
+           || NVIC_GetPriority(static_cast<IRQn_Type>(int32_t(active) - 16))
+                  >= DSY_IRQ_PRIORITY_USB;
+}
 } // namespace daisy
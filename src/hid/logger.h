@@ -5,7 +5,9 @@
 #include <cmath>
 #include <cstdarg>
 #include <cstdio>
+#include <atomic>
 #include "logger_impl.h"
+#include "util/TraceRecord.h"
 
 namespace daisy
 {
@@ -38,6 +40,7 @@ namespace daisy
 
 /** Floating point output formatting string. Include in your printf-style format string
  *  example: printf("float value = " FLT_FMT(3) " continue like that", FLT_VAR(3, x));
+ *  The Logger formats with FormatStringV(), which prints %f directly.
  */
 // clang-format off
 #define FLT_FMT(_n) STRINGIZE(PPCAT(PPCAT(%c%d.%0, _n), d))
@@ -75,7 +78,7 @@ class Logger
      */
     Logger() {}
 
-    /** Print formatted string
+    /** Print formatted string, see FormatStringV() for the conversions
      */
     static void Print(const char* format, ...);
 
@@ -96,6 +99,48 @@ class Logger
      */
     static void PrintLineV(const char* format, va_list va);
 
+    /** Bytes of messages that were dropped because the destination was
+     *  busy, only the asynchronous destinations drop messages
+     */
+    static uint32_t GetDroppedBytes() { return impl_.GetDroppedBytes(); }
+
+    /** Sends binary data as is, e.g. Telemetry frames. Blocks like
+     *  Print() until the terminal is connected, and drops the data
+     *  instead of accumulating it before then.
+     */
+    static void Write(const void* data, size_t size)
+    {
+        if(pc_sync_ >= LOGGER_SYNC_IN && !LoggerIsAsync(dest))
+        {
+            TransmitSync(data, size);
+        }
+        else
+        {
+            impl_.Transmit(data, size);
+        }
+    }
+
+    /** Queues a binary trace record instead of formatting the message,
+     *  see TraceRecord. Takes a few dozen cycles, so that it can be called
+     *  from the audio callback at a high rate, and needs an asynchronous
+     *  destination. Decode the stream on the host with
+     *  resources/decode_trace.py and the program's .elf file.
+     *  \param format printf-style format string literal
+     *  \param args up to 32 bit integers, floats, and string literals
+     */
+    template <typename... Args>
+    static void Trace(const char* format, Args... args)
+    {
+        static_assert(LoggerIsAsync(dest),
+                      "Trace() needs an asynchronous logger destination");
+        TraceRecord<sizeof...(Args)> record;
+        record.Encode(format,
+                      trace_sequence_.fetch_add(1, std::memory_order_relaxed),
+                      System::GetTick(),
+                      args...);
+        impl_.Transmit(record.GetData(), record.GetSize());
+    }
+
   protected:
     /** Internal constants
      */
@@ -121,6 +166,16 @@ class Logger
      */
     static void AppendNewLine();
 
+    /** AppendNewLine() for any buffer
+     *  \return the new length of the data, size on overflow
+     */
+    static size_t AppendNewLine(char* buff, size_t len, size_t size);
+
+    /** Formats a message on the stack and queues it, so that it can be
+     *  called from interrupts. Used by the asynchronous destinations.
+     */
+    static void PrintAsync(bool newline, const char* format, va_list va);
+
     /** Constexpr function equivalent of strlen(LOGGER_NEWLINE)
      */
     static constexpr size_t NewLineSeqLength()
@@ -141,6 +196,8 @@ class Logger
     static size_t           tx_ptr_;  /**< current position in the buffer */
     static size_t           pc_sync_; /**< terminal synchronization state */
     static LoggerImpl<dest> impl_;    /**< underlying trasnfer implementation */
+
+    static std::atomic<uint16_t> trace_sequence_; /**< next Trace() record */
 };
 
 /** @addtogroup logger_statics LoggerStaticMembers
@@ -164,6 +221,9 @@ size_t Logger<dest>::tx_ptr_ = 0;
 template <LoggerDestination dest>
 LoggerImpl<dest> Logger<dest>::impl_;
 
+template <LoggerDestination dest>
+std::atomic<uint16_t> Logger<dest>::trace_sequence_(0);
+
 /** @} */ // end logger_statics
 
 /** Specialization for a muted log
@@ -178,6 +238,10 @@ class Logger<LOGGER_NONE>
     static void StartLog(bool wait_for_pc = false) {}         /**<  */
     static void PrintV(const char* format, va_list va) {}     /**<  */
     static void PrintLineV(const char* format, va_list va) {} /**<  */
+    static uint32_t GetDroppedBytes() { return 0; }           /**<  */
+    static void Write(const void* data, size_t size) {}       /**<  */
+    template <typename... Args>
+    static void Trace(const char* format, Args... args) {} /**<  */
 };
 
 /** @} */
@@ -5,6 +5,8 @@
 #include <cassert>
 #include "hid/usb.h"
 #include "sys/system.h"
+#include "util/LogRing.h"
+#include "util/scopedirqblocker.h"
 
 
 namespace daisy
@@ -13,12 +15,47 @@ namespace daisy
  */
 enum LoggerDestination
 {
-    LOGGER_NONE,     /**< mute logging */
-    LOGGER_INTERNAL, /**< internal USB port */
-    LOGGER_EXTERNAL, /**< external USB port */
-    LOGGER_SEMIHOST, /**< stdout */
+    LOGGER_NONE,           /**< mute logging */
+    LOGGER_INTERNAL,       /**< internal USB port */
+    LOGGER_EXTERNAL,       /**< external USB port */
+    LOGGER_SEMIHOST,       /**< stdout */
+    LOGGER_INTERNAL_ASYNC, /**< internal USB port, through a ring buffer */
+    LOGGER_EXTERNAL_ASYNC, /**< external USB port, through a ring buffer */
+    LOGGER_SWO,            /**< ITM stimulus port, out of the SWO pin */
 };
 
+/** Size in bytes of the ring of an asynchronous destination, a power of two
+ */
+#ifndef LOGGER_ASYNC_BUFFER
+#define LOGGER_ASYNC_BUFFER 4096
+#endif
+
+/** ITM stimulus port of LOGGER_SWO, 0 to 31 */
+#ifndef LOGGER_SWO_PORT
+#define LOGGER_SWO_PORT 0
+#endif
+
+/** Bit rate of the SWO pin of LOGGER_SWO, in Hz, it has to match the
+ *  setting of the debug probe
+ */
+#ifndef LOGGER_SWO_BAUD
+#define LOGGER_SWO_BAUD 2000000
+#endif
+
+/** Returns true for the destinations that never wait for a terminal, and
+ *  can be used from interrupts
+ */
+constexpr bool LoggerIsAsync(LoggerDestination dest)
+{
+    return dest == LOGGER_INTERNAL_ASYNC || dest == LOGGER_EXTERNAL_ASYNC
+           || dest == LOGGER_SWO;
+}
+
+/** Returns true when the current context may start USB transfers: the main
+ *  loop, or an interrupt that the USB interrupt can't preempt
+ */
+bool LoggerCanAccessUsb();
+
 /** @brief Logging I/O underlying implementation
  *  @author Alexander Petrov-Savchenko (axp@soft-amp.com)
  *  @date November 2020
@@ -34,6 +71,11 @@ class LoggerImpl
     /** Transmit a block of data
      */
     static bool Transmit(const void* buffer, size_t bytes) { return true; }
+
+    /** Bytes of messages that were dropped, always 0 for blocking
+     *  destinations
+     */
+    static uint32_t GetDroppedBytes() { return 0; }
 };
 
 
@@ -62,6 +104,9 @@ class LoggerImpl<LOGGER_INTERNAL>
                == usb_handle_.TransmitInternal((uint8_t*)buffer, bytes);
     }
 
+    /** Bytes of messages that were dropped */
+    static uint32_t GetDroppedBytes() { return 0; }
+
   protected:
     /** USB Handle for CDC transfers 
      */
@@ -94,6 +139,9 @@ class LoggerImpl<LOGGER_EXTERNAL>
                == usb_handle_.TransmitExternal((uint8_t*)buffer, bytes);
     }
 
+    /** Bytes of messages that were dropped */
+    static uint32_t GetDroppedBytes() { return 0; }
+
   protected:
     /** USB Handle for CDC transfers 
      */
@@ -118,6 +166,143 @@ class LoggerImpl<LOGGER_SEMIHOST>
         write(STDOUT_FILENO, buffer, bytes);
         return true;
     }
+
+    /** Bytes of messages that were dropped */
+    static uint32_t GetDroppedBytes() { return 0; }
+};
+
+
+/** @brief Non-blocking USB logging through a ring buffer
+ *
+ *  Messages are appended to a lock-free ring, which can be done from any
+ *  context, interrupts included, and never waits: a message that doesn't
+ *  fit is dropped whole, and counted. The ring is drained into the
+ *  transmit ring of the USB port right away when the caller may access
+ *  the port, and otherwise when the port completes its next transfer, or
+ *  with the next message from the main loop.
+ *
+ *  \tparam periph FS_INTERNAL or FS_EXTERNAL
+ */
+template <UsbHandle::UsbPeriph periph>
+class LoggerAsyncUsb
+{
+  public:
+    /** Initialize logging destination
+     */
+    static void Init()
+    {
+        static_assert(1u == sizeof(usb_handle_), "UsbHandle is not static");
+        ring_.Init();
+        usb_handle_.Init(periph);
+        usb_handle_.SetTransmitCallback(Drain, periph);
+    }
+
+    /** Queue a block of data, never blocks
+     *  \return true, dropped messages are counted instead
+     */
+    static bool Transmit(const void* buffer, size_t bytes)
+    {
+        ring_.Write(buffer, bytes);
+        if(LoggerCanAccessUsb())
+        {
+            ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
+            Drain();
+        }
+        return true;
+    }
+
+    /** Bytes of messages that were dropped */
+    static uint32_t GetDroppedBytes() { return ring_.GetDroppedBytes(); }
+
+    /** Number of messages that were dropped */
+    static uint32_t GetDroppedMessages()
+    {
+        return ring_.GetDroppedMessages();
+    }
+
+  protected:
+    /** Moves as much of the ring as fits into the USB transmit ring. Runs
+     *  in the USB interrupt, or with it blocked.
+     */
+    static void Drain()
+    {
+        const uint8_t* data;
+        size_t         size;
+        while((size = ring_.Peek(&data)) > 0)
+        {
+            const size_t sent = usb_handle_.Write(data, size, periph);
+            ring_.Consume(sent);
+            if(sent < size)
+                break;
+        }
+    }
+
+    /** log messages waiting for the port */
+    static LogRing<LOGGER_ASYNC_BUFFER> ring_;
+
+    /** USB Handle for CDC transfers
+     */
+    static UsbHandle usb_handle_;
+};
+
+template <UsbHandle::UsbPeriph periph>
+LogRing<LOGGER_ASYNC_BUFFER> LoggerAsyncUsb<periph>::ring_;
+
+template <UsbHandle::UsbPeriph periph>
+UsbHandle LoggerAsyncUsb<periph>::usb_handle_;
+
+
+/**  @brief Specialization for the internal USB port, non-blocking
+ */
+template <>
+class LoggerImpl<LOGGER_INTERNAL_ASYNC>
+: public LoggerAsyncUsb<UsbHandle::FS_INTERNAL>
+{
+};
+
+
+/**  @brief Specialization for the external USB port, non-blocking
+ */
+template <>
+class LoggerImpl<LOGGER_EXTERNAL_ASYNC>
+: public LoggerAsyncUsb<UsbHandle::FS_EXTERNAL>
+{
+};
+
+
+/** @brief Specialization for the SWO pin of the debug port
+ *
+ *  Messages are written to an ITM stimulus port, LOGGER_SWO_PORT, a word
+ *  at a time, and the trace unit sends them out of the SWO pin (PB3) at
+ *  LOGGER_SWO_BAUD. There's no buffer and no interrupt: each word waits
+ *  only for a slot in the ITM FIFO, so a message costs about the time it
+ *  takes to shift it out, 5us per byte at 2 MHz. Messages are written
+ *  with the interrupts disabled, so that they don't interleave, which makes
+ *  it usable in the audio callback for development, not in a release.
+ *
+ *  While the port is disabled, e.g. by the probe, writing costs nothing
+ *  but a register read, and the bytes are counted as dropped.
+ *
+ *  The probe shows the text of the port, e.g. in the SWV console of
+ *  STM32CubeIDE, or with OpenOCD's "itm port 0 on". A raw capture of the
+ *  pin is decoded with resources/decode_trace.py --itm 0, along with the
+ *  records of Logger::Trace().
+ */
+template <>
+class LoggerImpl<LOGGER_SWO>
+{
+  public:
+    /** Enables the trace clock, the SWO pin and the stimulus port */
+    static void Init();
+
+    /** Transmit a block of data, never fails */
+    static bool Transmit(const void* buffer, size_t bytes);
+
+    /** Bytes that were written while the port was disabled */
+    static uint32_t GetDroppedBytes() { return dropped_; }
+
+  protected:
+    static uint32_t dropped_;
 };
 
 
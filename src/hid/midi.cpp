@@ -1,19 +1,25 @@
 #include "midi.h"
+#include "util/DmaBuffer.h"
 
 namespace daisy
 {
 static constexpr size_t kDefaultMidiRxBufferSize = 256;
+static constexpr size_t kDefaultMidiTxBufferSize = 256;
 
-static uint8_t DMA_BUFFER_MEM_SECTION
-    default_midi_rx_buffer[kDefaultMidiRxBufferSize];
+static DmaBuffer<uint8_t, kDefaultMidiRxBufferSize> DMA_BUFFER_MEM_SECTION
+    default_midi_rx_buffer;
+static DmaBuffer<uint8_t, kDefaultMidiTxBufferSize> DMA_BUFFER_MEM_SECTION
+    default_midi_tx_buffer;
 
 MidiUartTransport::Config::Config()
 {
     periph         = UartHandler::Config::Peripheral::USART_1;
     rx             = {DSY_GPIOB, 7};
     tx             = {DSY_GPIOB, 6};
-    rx_buffer      = default_midi_rx_buffer;
+    rx_buffer      = default_midi_rx_buffer.Data();
     rx_buffer_size = kDefaultMidiRxBufferSize;
+    tx_buffer      = default_midi_tx_buffer.Data();
+    tx_buffer_size = kDefaultMidiTxBufferSize;
     rx_dma_stream  = UartHandler::Config::DmaStream::DMA_1_STREAM_5;
     tx_dma_stream  = UartHandler::Config::DmaStream::DMA_2_STREAM_4;
 }
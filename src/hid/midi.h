@@ -9,7 +9,9 @@
 #include "util/ringbuffer.h"
 #include "util/FIFO.h"
 #include "hid/midi_parser.h"
+#include "hid/midi_router.h"
 #include "hid/usb_midi.h"
+#include "hid/usb_host_midi.h"
 #include "sys/dma.h"
 #include "sys/system.h"
 
@@ -55,6 +57,21 @@ class MidiUartTransport
          */
         size_t rx_buffer_size;
 
+        /** Pointer to buffer for the queue of DMA UART tx bytes.
+         *
+         *  @details Like rx_buffer, by default a shared buffer in
+         *           DMA_BUFFER_MEM_SECTION for a single UART peripheral.
+         */
+        uint8_t* tx_buffer;
+
+        /** Size in bytes of tx_buffer, the most bytes that can wait to be sent.
+         *
+         *  @details By default 256 bytes. Tx() waits for room in the queue
+         *           for messages that don't fit in its free part, and sends
+         *           messages larger than the queue blocking, see Tx().
+         */
+        size_t tx_buffer_size;
+
         UartHandler::Config::DmaStream rx_dma_stream;
         UartHandler::Config::DmaStream tx_dma_stream;
 
@@ -87,6 +104,8 @@ class MidiUartTransport
         std::fill(rx_buffer, rx_buffer + rx_buffer_size, 0);
 
         uart_.Init(uart_config);
+        uart_.SetTxQueue(config.tx_buffer, config.tx_buffer_size);
+        tx_buffer_size_ = config.tx_buffer_size;
     }
 
     /** @brief Start the UART peripheral in listening mode.
@@ -107,13 +126,41 @@ class MidiUartTransport
     /** @brief This is a no-op for UART transport - Rx is via DMA callback with circular buffer */
     inline void FlushRx() {}
 
-    /** @brief sends the buffer of bytes out of the UART peripheral */
-    inline void Tx(uint8_t* buff, size_t size) { uart_.PollTx(buff, size); }
+    /** @brief queues the buffer of bytes to be sent out of the UART peripheral
+     *  by DMA, and returns right away if the queue has room for them.
+     *  Otherwise it waits for the DMA to send enough of the queue, and a
+     *  message larger than the whole queue, e.g. a SysEx dump, is sent
+     *  blocking once the queue is empty.
+     *  Waiting needs the UART DMA interrupts, so don't call it from an
+     *  interrupt of the same or a higher priority.
+     */
+    inline void Tx(uint8_t* buff, size_t size)
+    {
+        if(size > tx_buffer_size_)
+        {
+            while(uart_.GetTxQueued() > 0) {}
+            // 320us per byte at 31250 baud
+            uart_.BlockingTransmit(buff, size, size / 3 + 10);
+            return;
+        }
+        while(tx_buffer_size_ - uart_.GetTxQueued() < size) {}
+        uart_.QueueTx(buff, size);
+    }
+
+    /** @brief returns the number of Tx() calls that couldn't be queued */
+    inline uint32_t GetTxOverflows() const { return uart_.GetTxOverflows(); }
+
+    /** @brief returns the number of bytes waiting to be sent */
+    inline size_t GetTxQueued() const { return uart_.GetTxQueued(); }
+
+    /** @brief returns the size of the Tx() queue, tx_buffer_size */
+    inline size_t GetTxQueueSize() const { return tx_buffer_size_; }
 
   private:
     UartHandler         uart_;
     uint8_t*            rx_buffer;
     size_t              rx_buffer_size;
+    size_t              tx_buffer_size_;
     void*               parse_context_;
     MidiRxParseCallback parse_callback_;
 
@@ -149,11 +196,24 @@ class MidiUartTransport
     @brief Simple MIDI Handler \n
     Parses bytes from an input into valid MidiEvents. \n
     The MidiEvents fill a FIFO queue that the user can pop messages from.
+    The whole block of received bytes is parsed at once, and the events are
+    queued as 12 byte CompactMidiEvents, with SysEx data left in the parser.
+    Each event is timestamped with the cycle count on reception, so that
+    an AudioBlockClock can place it at its sample in the audio block.
+
+    A handler takes 12 bytes per queued event, plus the SYSEX_BUF_MAX_SIZE
+    bytes of SysEx data in its parser, i.e. 4kB with the defaults. Ports
+    that only see a few events between two calls to PopEvent(), e.g. a
+    controller input, can use a shorter queue, and busy ports a deeper one.
+    \tparam Transport         the MidiUartTransport, MidiUsbTransport or
+                              MidiUsbHostTransport
+    \tparam kEventQueueSize   the most events that wait to be popped,
+                              more are dropped
     @author shensley
     @date March 2020
     @ingroup midi
 */
-template <typename Transport>
+template <typename Transport, size_t kEventQueueSize = 256>
 class MidiHandler
 {
   public:
@@ -170,7 +230,9 @@ class MidiHandler
      */
     void Init(Config config)
     {
-        config_ = config;
+        config_         = config;
+        dropped_events_ = 0;
+        router_         = nullptr;
         transport_.Init(config_.transport_config);
         parser_.Init();
     }
@@ -205,7 +267,10 @@ class MidiHandler
     /** Pops the oldest unhandled MidiEvent from the internal queue
     \return The event to be handled
      */
-    MidiEvent PopEvent() { return event_q_.PopFront(); }
+    MidiEvent PopEvent()
+    {
+        return event_q_.PopFront().Unpack(parser_.GetSysexBuffer());
+    }
 
     /** SendMessage
     Send raw bytes as message
@@ -215,6 +280,14 @@ class MidiHandler
         transport_.Tx(bytes, size);
     }
 
+    /** Returns the number of sent bytes that wait in the transport's
+     *  queue, for transports that have one like MidiUartTransport
+     */
+    size_t GetTxQueued() const { return transport_.GetTxQueued(); }
+
+    /** Returns the size of the transport's queue, see GetTxQueued() */
+    size_t GetTxQueueSize() const { return transport_.GetTxQueueSize(); }
+
     /** Feed in bytes to parser state machine from an external source.
         Populates internal FIFO queue with MIDI Messages.
 
@@ -226,23 +299,68 @@ class MidiHandler
         MidiEvent event;
         if(parser_.Parse(byte, &event))
         {
-            event_q_.PushBack(event);
+            event.timestamp = System::GetCycleCount();
+            QueueEvent(CompactMidiEvent::Pack(event));
+            if(router_ != nullptr)
+                router_->Process(router_input_, event);
         }
     }
 
+    /** Streams SysEx messages to a callback instead of queueing them,
+     *  see MidiParser::SetSysexCallback(). The callback runs where the
+     *  bytes are received, i.e. in the UART or USB interrupt, so it must
+     *  be quick, e.g. copy the data to a flash write queue.
+     *  Call this after Init().
+     */
+    void SetSysexCallback(MidiParser::SysexCallback callback, void* context)
+    {
+        parser_.SetSysexCallback(callback, context);
+    }
+
+    /** Passes the received messages to a router as they are parsed, in
+     *  addition to queueing them. Call this after Init().
+     *  \param router the router, nullptr to stop forwarding
+     *  \param input the number of this handler's input in the router
+     */
+    void SetRouter(MidiRouter* router, size_t input)
+    {
+        router_input_ = input;
+        router_       = router;
+    }
+
+    /** Returns the number of events that were dropped because the queue
+     *  was full, since Init()
+     */
+    uint32_t GetNumDroppedEvents() const { return dropped_events_; }
+
   private:
-    Config               config_;
-    Transport            transport_;
-    MidiParser           parser_;
-    FIFO<MidiEvent, 256> event_q_;
+    Config                                  config_;
+    Transport                               transport_;
+    MidiParser                              parser_;
+    FIFO<CompactMidiEvent, kEventQueueSize> event_q_;
+    volatile uint32_t                       dropped_events_;
+    MidiRouter* volatile                    router_;
+    size_t                                  router_input_;
+
+    void QueueEvent(const CompactMidiEvent& event)
+    {
+        if(!event_q_.PushBack(event))
+            dropped_events_ = dropped_events_ + 1;
+    }
 
     static void ParseCallback(uint8_t* data, size_t size, void* context)
     {
-        MidiHandler* handler = reinterpret_cast<MidiHandler*>(context);
-        for(size_t i = 0; i < size; i++)
-        {
-            handler->Parse(data[i]);
-        }
+        MidiHandler*   handler = reinterpret_cast<MidiHandler*>(context);
+        const uint32_t now     = System::GetCycleCount();
+
+        auto handle_event = [handler, now](const MidiEvent& event) {
+            CompactMidiEvent e = CompactMidiEvent::Pack(event);
+            e.timestamp        = now;
+            handler->QueueEvent(e);
+            if(handler->router_ != nullptr)
+                handler->router_->Process(handler->router_input_, event);
+        };
+        handler->parser_.Parse(data, size, handle_event);
     }
 };
 
@@ -251,8 +369,9 @@ class MidiHandler
  *  @ingroup midi
  *  @brief shorthand accessors for MIDI Handlers
  * */
-using MidiUartHandler = MidiHandler<MidiUartTransport>;
-using MidiUsbHandler  = MidiHandler<MidiUsbTransport>;
+using MidiUartHandler    = MidiHandler<MidiUartTransport>;
+using MidiUsbHandler     = MidiHandler<MidiUsbTransport>;
+using MidiUsbHostHandler = MidiHandler<MidiUsbHostTransport>;
 /** @} */
 } // namespace daisy
 #endif
@@ -0,0 +1,150 @@
+#include "midi_clock.h"
+#include "sys/system.h"
+#include <cmath>
+
+using namespace daisy;
+
+void MidiClockTracker::Init(float smoothing)
+{
+    if(smoothing < 0.001f)
+        smoothing = 0.001f;
+    if(smoothing > 1.0f)
+        smoothing = 1.0f;
+    // a critically damped alpha-beta filter
+    alpha_       = smoothing;
+    beta_        = smoothing * smoothing / (2.0f - smoothing);
+    has_tick_    = false;
+    locked_      = false;
+    running_     = false;
+    last_raw_    = 0;
+    last_tick_   = 0;
+    period_      = 0.0f;
+    num_ticks_   = 0;
+    position_    = -1;
+    next_output_ = 0;
+}
+
+void MidiClockTracker::ProcessEvent(const MidiEvent& event)
+{
+    if(event.type == SystemCommon && event.sc_type == SongPositionPointer)
+    {
+        // in sixteenth notes, 6 ticks each
+        const int32_t sixteenths = event.data[0] | (event.data[1] << 7);
+        position_                = sixteenths * 6 - 1;
+        next_output_             = position_ + 1;
+        return;
+    }
+    if(event.type != SystemRealTime)
+        return;
+    switch(event.srt_type)
+    {
+        case TimingClock: OnClock(event.timestamp); break;
+        case Start:
+            running_     = true;
+            position_    = -1;
+            next_output_ = 0;
+            break;
+        case Continue: running_ = true; break;
+        case Stop: running_ = false; break;
+        default: break;
+    }
+}
+
+float MidiClockTracker::GetTempoBpm() const
+{
+    if(!locked_ || period_ <= 0.0f)
+        return 0.0f;
+    return 60.0f * float(System::GetCpuFreq()) / (period_ * kTicksPerBeat);
+}
+
+float MidiClockTracker::GetPosition(uint32_t now) const
+{
+    if(position_ < 0)
+        return 0.0f;
+    float fraction = 0.0f;
+    if(running_ && locked_)
+    {
+        fraction = float(int32_t(now - last_tick_)) / period_;
+        if(fraction < 0.0f)
+            fraction = 0.0f;
+        if(fraction > 1.0f)
+            fraction = 1.0f;
+    }
+    return (float(position_) + fraction) / kTicksPerBeat;
+}
+
+bool MidiClockTracker::GetNextTick(uint32_t until, uint32_t* tick_cycles)
+{
+    if(!running_)
+        return false;
+    // ticks that were never asked for are skipped
+    if(next_output_ < position_)
+        next_output_ = position_;
+    // only the next tick is predicted
+    if(next_output_ > position_ + 1 || (next_output_ > position_ && !locked_))
+        return false;
+
+    const uint32_t cycles = GetTickCycles(next_output_);
+    if(int32_t(cycles - until) >= 0)
+        return false;
+    *tick_cycles = cycles;
+    next_output_++;
+    return true;
+}
+
+void MidiClockTracker::OnClock(uint32_t timestamp)
+{
+    if(!has_tick_)
+    {
+        has_tick_  = true;
+        last_tick_ = timestamp;
+    }
+    else if(!locked_)
+    {
+        // ticks from the same received block have the same timestamp
+        if(timestamp != last_raw_)
+        {
+            period_    = float(timestamp - last_raw_);
+            locked_    = true;
+            num_ticks_ = 2;
+        }
+        last_tick_ = timestamp;
+    }
+    else
+    {
+        const float error = float(int32_t(timestamp - last_tick_)) - period_;
+        if(std::fabs(error) > 0.5f * period_)
+        {
+            locked_    = false;
+            period_    = 0.0f;
+            last_tick_ = timestamp;
+        }
+        else
+        {
+            // right after the lock, the gains of a least squares fit
+            // through all ticks so far, until they get below the
+            // steady state gains
+            num_ticks_++;
+            const float n         = float(num_ticks_);
+            const float fit_alpha = 2.0f * (2.0f * n - 1.0f) / (n * (n + 1.0f));
+            float       alpha     = alpha_;
+            float       beta      = beta_;
+            if(fit_alpha > alpha_)
+            {
+                alpha = fit_alpha;
+                beta  = 6.0f / (n * (n + 1.0f));
+            }
+            last_tick_ += uint32_t(int32_t(period_ + alpha * error));
+            period_    += beta * error;
+        }
+    }
+    last_raw_ = timestamp;
+    if(running_)
+        position_++;
+}
+
+uint32_t MidiClockTracker::GetTickCycles(int32_t tick) const
+{
+    const float ticks = float(tick - position_);
+    return last_tick_ + uint32_t(int32_t(ticks * period_));
+}
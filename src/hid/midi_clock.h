@@ -0,0 +1,110 @@
+#pragma once
+#ifndef DSY_MIDI_CLOCK_H
+#define DSY_MIDI_CLOCK_H
+
+#include <stdint.h>
+#include "hid/MidiEvent.h"
+
+namespace daisy
+{
+/** @brief Follows an external MIDI clock
+ *  @ingroup midi
+ *  @details The clock ticks (24 per quarter note) arrive with the jitter
+ *           of the UART and USB transfers. The tracker smooths them with an
+ *           alpha-beta filter, a second order PLL, on the timestamps of the
+ *           events (see MidiEvent::timestamp), and provides the tempo, the
+ *           song position between the ticks, and predictions of the next
+ *           ticks in cycles. Together with an AudioBlockClock the ticks can
+ *           be placed at their sample in the audio block.
+ *
+ *           Right after the lock, the filter fits a line through all the
+ *           ticks so far, so that it locks quickly, and then settles to
+ *           the given smoothing.
+ *           A tick that is off the prediction by more than half a tick,
+ *           e.g. after a tempo jump or lost bytes, restarts the lock.
+ *
+ *           \code
+ *           while(midi.HasEvents())
+ *               clock.ProcessEvent(midi.PopEvent());
+ *           uint32_t tick;
+ *           while(clock.GetNextTick(block_clock.GetBlockStartCycles(), &tick))
+ *               sequencer.Step(block_clock.GetSampleOffset(tick));
+ *           \endcode
+ */
+class MidiClockTracker
+{
+  public:
+    /** MIDI clock ticks per quarter note */
+    static constexpr uint32_t kTicksPerBeat = 24;
+
+    MidiClockTracker() {}
+    ~MidiClockTracker() {}
+
+    /** Initializes the tracker, without a lock and stopped.
+     *  \param smoothing 0..1, how much of the jitter of each tick goes
+     *         into the estimate. Lower values are smoother, and follow
+     *         tempo changes more slowly.
+     */
+    void Init(float smoothing = 0.05f);
+
+    /** Handles the clock, start, stop, continue and song position pointer
+     *  messages, and ignores the others.
+     */
+    void ProcessEvent(const MidiEvent& event);
+
+    /** True when the tick period is known, after the second tick */
+    bool IsLocked() const { return locked_; }
+
+    /** True between a start or continue and a stop message */
+    bool IsRunning() const { return running_; }
+
+    /** Returns the smoothed tempo in beats per minute, 0 without a lock */
+    float GetTempoBpm() const;
+
+    /** Returns the smoothed time between ticks in cycles, 0 without a lock
+     */
+    float GetTickPeriodCycles() const { return locked_ ? period_ : 0.0f; }
+
+    /** Returns the song position in beats (quarter notes) at a time,
+     *  interpolated between the ticks, and stopping at the next tick when
+     *  it doesn't arrive.
+     *  \param now the cycle count, e.g. System::GetCycleCount()
+     */
+    float GetPosition(uint32_t now) const;
+
+    /** Returns the ticks one by one, while running, whose time is before
+     *  `until`. Ticks that were received are returned at their smoothed
+     *  time, and the next one, when locked, at its predicted time before
+     *  it arrives. Every tick is only returned once.
+     *  \param until the cycle count up to which to return ticks
+     *  \param tick_cycles set to the time of the tick
+     *  \return false if there are no more ticks before `until`
+     */
+    bool GetNextTick(uint32_t until, uint32_t* tick_cycles);
+
+    /** Returns the song position in ticks of the latest tick, -1 before
+     *  the first tick after a start
+     */
+    int32_t GetTickPosition() const { return position_; }
+
+  private:
+    void OnClock(uint32_t timestamp);
+
+    /** time of a tick, predicted from the latest one */
+    uint32_t GetTickCycles(int32_t tick) const;
+
+    float    alpha_, beta_;
+    bool     has_tick_;
+    bool     locked_;
+    bool     running_;
+    uint32_t last_raw_;
+    uint32_t last_tick_;
+    float    period_;
+    uint32_t num_ticks_;
+    int32_t  position_;
+    int32_t  next_output_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,169 @@
+#include "midi_encoder.h"
+
+using namespace daisy;
+
+void MidiOutputEncoder::Init(Config config)
+{
+    config_         = config;
+    running_status_ = 0;
+    num_pending_    = 0;
+    coalesced_      = 0;
+    dropped_        = 0;
+    status_saved_   = 0;
+}
+
+bool MidiOutputEncoder::Send(const uint8_t* bytes, size_t size)
+{
+    if(size == 0 || bytes[0] < 0x80 || config_.write == nullptr)
+        return false;
+    const uint8_t status = bytes[0];
+    if((status & 0xf0) == 0xb0 && size == 3 && IsCoalesced(bytes[1]))
+        return ControlChange(status & 0x0f, bytes[1], bytes[2]);
+
+    // real time messages may go anywhere, everything else keeps its place
+    // after the control changes that were held back
+    if(status < 0xf8)
+        Flush();
+    if(!Write(bytes, size))
+    {
+        dropped_++;
+        return false;
+    }
+    return true;
+}
+
+bool MidiOutputEncoder::ControlChange(uint8_t channel,
+                                      uint8_t control,
+                                      uint8_t value)
+{
+    channel &= 0x0f;
+    control &= 0x7f;
+    value &= 0x7f;
+    if(!IsCoalesced(control))
+    {
+        const uint8_t bytes[3] = {uint8_t(0xb0 | channel), control, value};
+        return Send(bytes, sizeof(bytes));
+    }
+    if(config_.write == nullptr)
+        return false;
+
+    for(size_t i = 0; i < num_pending_; i++)
+    {
+        if(pending_[i].channel == channel && pending_[i].control == control)
+        {
+            pending_[i].value = value;
+            coalesced_++;
+            return true;
+        }
+    }
+    if(num_pending_ >= kMaxPendingControls)
+    {
+        Flush();
+        if(num_pending_ >= kMaxPendingControls)
+        {
+            dropped_++;
+            return false;
+        }
+    }
+    PendingControl& pending = pending_[num_pending_++];
+    pending.channel         = channel;
+    pending.control         = control;
+    pending.value           = value;
+    if(config_.queued != nullptr)
+        SendPending(config_.control_backlog);
+    return true;
+}
+
+bool MidiOutputEncoder::NoteOn(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    const uint8_t bytes[3] = {uint8_t(0x90 | (channel & 0x0f)),
+                              uint8_t(note & 0x7f),
+                              uint8_t(velocity & 0x7f)};
+    return Send(bytes, sizeof(bytes));
+}
+
+bool MidiOutputEncoder::NoteOff(uint8_t channel,
+                                uint8_t note,
+                                uint8_t velocity)
+{
+    const uint8_t bytes[3] = {uint8_t(0x80 | (channel & 0x0f)),
+                              uint8_t(note & 0x7f),
+                              uint8_t(velocity & 0x7f)};
+    return Send(bytes, sizeof(bytes));
+}
+
+void MidiOutputEncoder::Process()
+{
+    SendPending(config_.control_backlog);
+}
+
+void MidiOutputEncoder::Flush()
+{
+    SendPending(SIZE_MAX);
+}
+
+bool MidiOutputEncoder::IsCoalesced(uint8_t control)
+{
+    // data entry MSB/LSB, increment/decrement and the (N)RPN numbers, then
+    // the channel mode messages
+    return control != 6 && control != 38 && (control < 96 || control > 101)
+           && control < 120;
+}
+
+size_t MidiOutputEncoder::Backlog() const
+{
+    return config_.queued != nullptr ? config_.queued(config_.context) : 0;
+}
+
+bool MidiOutputEncoder::Write(const uint8_t* bytes, size_t size)
+{
+    const uint8_t status = bytes[0];
+    const size_t  skip   = config_.running_status && status < 0xf0
+                              && status == running_status_
+                            ? 1
+                            : 0;
+    if(config_.queue_size > 0 && Backlog() + size - skip > config_.queue_size)
+        return false;
+
+    if(status >= 0xf8)
+    {
+        // real time messages don't affect the running status
+    }
+    else if(status >= 0xf0)
+        running_status_ = 0;
+    else
+        running_status_ = status;
+    status_saved_ += skip;
+    // the output doesn't write to the bytes, it only takes them non-const
+    config_.write(const_cast<uint8_t*>(bytes) + skip,
+                  size - skip,
+                  config_.context);
+    return true;
+}
+
+void MidiOutputEncoder::SendPending(size_t limit)
+{
+    while(num_pending_ > 0 && Backlog() < limit)
+    {
+        // a control of the channel of the running status goes first, the
+        // order of each channel's controls is kept
+        size_t next = 0;
+        for(size_t i = 0; i < num_pending_; i++)
+        {
+            if(uint8_t(0xb0 | pending_[i].channel) == running_status_)
+            {
+                next = i;
+                break;
+            }
+        }
+        const PendingControl& pending = pending_[next];
+        const uint8_t         bytes[3]
+            = {uint8_t(0xb0 | pending.channel), pending.control, pending.value};
+        // a control that doesn't fit waits for the queue to drain
+        if(!Write(bytes, sizeof(bytes)))
+            return;
+        for(size_t i = next + 1; i < num_pending_; i++)
+            pending_[i - 1] = pending_[i];
+        num_pending_--;
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+#ifndef DSY_MIDI_ENCODER_H
+#define DSY_MIDI_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisy
+{
+/** @brief Compacts the messages sent to a UART MIDI output
+ *  @ingroup midi
+ *  @details At 31.25 kbaud a three byte message takes almost a millisecond,
+ *           and a dense stream of control changes, e.g. from a few knobs,
+ *           saturates the output. The encoder leaves out repeated status
+ *           bytes (running status), which saves a third of the bytes of
+ *           such a stream, and it holds control changes back until the
+ *           output's DMA queue has drained. A control that changes again
+ *           meanwhile is only sent with its latest value, so the output
+ *           lags the knobs by a few milliseconds at most, rather than by
+ *           the whole backlog.
+ *
+ *           Other messages are sent right away. Control changes that are
+ *           held back are sent before them, to keep the order of e.g. a
+ *           bank select and a program change. Data entry and the (N)RPN
+ *           numbers mean different things in a sequence, so they are never
+ *           held back, and neither are the channel mode messages.
+ *
+ *           Each message is only queued whole. One that doesn't fit in the
+ *           free part of the queue is dropped, and counted, without changing
+ *           the running status. Don't send to the output other than by the
+ *           encoder, or call ResetRunningStatus() afterwards.
+ *
+ *           \code
+ *           encoder.Init(midi_uart);
+ *           while(1)
+ *           {
+ *               encoder.ControlChange(0, 74, cutoff_knob.Value() * 127);
+ *               encoder.Process();
+ *           }
+ *           \endcode
+ */
+class MidiOutputEncoder
+{
+  public:
+    /** The most control changes that are held back */
+    static constexpr size_t kMaxPendingControls = 32;
+
+    /** Writes bytes to the output, e.g. MidiHandler::SendMessage() */
+    typedef void (*OutputFunction)(uint8_t* bytes, size_t size, void* context);
+
+    /** Returns the number of bytes that wait in the output's queue */
+    typedef size_t (*QueuedFunction)(void* context);
+
+    struct Config
+    {
+        OutputFunction write   = nullptr;
+        void*          context = nullptr; /**< passed to write and queued */
+
+        /** The output's queue, nullptr if it has none. Without a queue,
+         *  control changes are held back until the next Process().
+         */
+        QueuedFunction queued = nullptr;
+
+        /** Size in bytes of the output's queue, 0 if unknown */
+        size_t queue_size = 0;
+
+        /** Control changes are only passed on by Process() while fewer
+         *  bytes wait in the queue, 3 is about a millisecond of UART MIDI
+         */
+        size_t control_backlog = 3;
+
+        /** false to send each message with its status, e.g. for USB */
+        bool running_status = true;
+    };
+
+    MidiOutputEncoder() {}
+    ~MidiOutputEncoder() {}
+
+    void Init(Config config);
+
+    /** Sends to a MidiHandler, or anything else with a
+     *  SendMessage(uint8_t*, size_t), GetTxQueued() and GetTxQueueSize(),
+     *  like the MidiUartHandler.
+     */
+    template <typename Handler>
+    void Init(Handler& handler)
+    {
+        Config config;
+        config.write      = &SendToHandler<Handler>;
+        config.queued     = &QueuedOfHandler<Handler>;
+        config.context    = &handler;
+        config.queue_size = handler.GetTxQueueSize();
+        Init(config);
+    }
+
+    /** Sends a complete message, starting with its status byte. Control
+     *  changes are passed to ControlChange().
+     *  \return false if it was dropped
+     */
+    bool Send(const uint8_t* bytes, size_t size);
+
+    /** Sends a control change, or holds it back while the output's queue
+     *  is busy, see Process().
+     *  \param channel 0 to 15
+     *  \return false if it was dropped
+     */
+    bool ControlChange(uint8_t channel, uint8_t control, uint8_t value);
+
+    /** Sends a note on, see Send() */
+    bool NoteOn(uint8_t channel, uint8_t note, uint8_t velocity);
+
+    /** Sends a note off, see Send() */
+    bool NoteOff(uint8_t channel, uint8_t note, uint8_t velocity);
+
+    /** Passes control changes on to the output as its queue drains. Call
+     *  it from the main loop, as often as possible.
+     */
+    void Process();
+
+    /** Passes all control changes that are held back on to the output */
+    void Flush();
+
+    /** Makes the next message start with its status byte, e.g. after
+     *  something else was sent to the output
+     */
+    void ResetRunningStatus() { running_status_ = 0; }
+
+    /** Returns the number of control changes that are held back */
+    size_t GetNumPending() const { return num_pending_; }
+
+    /** Returns the number of control changes that were replaced by a
+     *  newer value before they were sent, since Init()
+     */
+    uint32_t GetNumCoalesced() const { return coalesced_; }
+
+    /** Returns the number of messages that were dropped, since Init() */
+    uint32_t GetNumDropped() const { return dropped_; }
+
+    /** Returns the number of status bytes left out, since Init() */
+    uint32_t GetNumStatusBytesSaved() const { return status_saved_; }
+
+  private:
+    struct PendingControl
+    {
+        uint8_t channel;
+        uint8_t control;
+        uint8_t value;
+    };
+
+    /** True for the controls that may be held back and coalesced */
+    static bool IsCoalesced(uint8_t control);
+
+    size_t Backlog() const;
+
+    /** Queues a message whole, leaving out a repeated status byte */
+    bool Write(const uint8_t* bytes, size_t size);
+
+    /** Sends pending control changes, while the backlog is below limit */
+    void SendPending(size_t limit);
+
+    template <typename Handler>
+    static void SendToHandler(uint8_t* bytes, size_t size, void* context)
+    {
+        static_cast<Handler*>(context)->SendMessage(bytes, size);
+    }
+
+    template <typename Handler>
+    static size_t QueuedOfHandler(void* context)
+    {
+        return static_cast<Handler*>(context)->GetTxQueued();
+    }
+
+    Config         config_;
+    uint8_t        running_status_;
+    PendingControl pending_[kMaxPendingControls];
+    size_t         num_pending_;
+    uint32_t       coalesced_;
+    uint32_t       dropped_;
+    uint32_t       status_saved_;
+};
+
+} // namespace daisy
+
+#endif
@@ -7,6 +7,14 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
     // reset parser when status byte is received
     bool did_parse = false;
 
+    // system real time messages can come between the bytes of other
+    // messages, and don't change the state
+    if((byte & 0xF8) == 0xF8 && pstate_ != ParserSysEx)
+    {
+        produceRealTime(byte, event_out);
+        return true;
+    }
+
     if((byte & kStatusByteMask) && pstate_ != ParserSysEx)
     {
         pstate_ = ParserEmpty;
@@ -21,8 +29,6 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
                 incoming_message_.channel = byte & kChannelMask;
                 incoming_message_.type
                     = static_cast<MidiMessageType>((byte & kMessageMask) >> 4);
-                if((byte & 0xF8) == 0xF8)
-                    incoming_message_.type = SystemRealTime;
 
                 // Validate, and move on.
                 if(incoming_message_.type < MessageLast)
@@ -38,6 +44,11 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
                         if(incoming_message_.sc_type == SystemExclusive)
                         {
                             pstate_ = ParserSysEx;
+                            if(sysex_callback_ != nullptr)
+                                sysex_callback_(SysexStage::Start,
+                                                nullptr,
+                                                0,
+                                                sysex_context_);
                         }
                         //short circuit
                         else if(incoming_message_.sc_type > SongSelect)
@@ -50,20 +61,6 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
                             did_parse = true;
                         }
                     }
-                    else if(incoming_message_.type == SystemRealTime)
-                    {
-                        incoming_message_.srt_type
-                            = static_cast<SystemRealTimeType>(
-                                byte & kSystemRealTimeMask);
-
-                        //short circuit to start
-                        pstate_ = ParserEmpty;
-                        if(event_out != nullptr)
-                        {
-                            *event_out = incoming_message_;
-                        }
-                        did_parse = true;
-                    }
                     else // Channel Voice or Channel Mode
                     {
                         running_status_ = incoming_message_.type;
@@ -77,10 +74,7 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
                 incoming_message_.type    = running_status_;
                 incoming_message_.data[0] = byte & kDataByteMask;
                 //check for single byte running status, really this only applies to channel pressure though
-                if(running_status_ == ChannelPressure
-                   || running_status_ == ProgramChange
-                   || incoming_message_.sc_type == MTCQuarterFrame
-                   || incoming_message_.sc_type == SongSelect)
+                if(TakesOneDataByte(running_status_))
                 {
                     //Send the single byte update
                     pstate_ = ParserEmpty;
@@ -100,10 +94,7 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
             if((byte & kStatusByteMask) == 0)
             {
                 incoming_message_.data[0] = byte & kDataByteMask;
-                if(running_status_ == ChannelPressure
-                   || running_status_ == ProgramChange
-                   || incoming_message_.sc_type == MTCQuarterFrame
-                   || incoming_message_.sc_type == SongSelect)
+                if(TakesOneDataByte(incoming_message_.type))
                 {
                     //these are just one data byte, so we short circuit back to start
                     pstate_ = ParserEmpty;
@@ -162,8 +153,17 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
             pstate_ = ParserEmpty;
             break;
         case ParserSysEx:
+            if(sysex_callback_ != nullptr)
+            {
+                // a status byte other than the end or real time messages
+                // starts the next message
+                if(StreamSysexByte(byte, event_out))
+                    did_parse = true;
+                else if(pstate_ == ParserEmpty && byte != 0xf7)
+                    did_parse = Parse(byte, event_out);
+            }
             // end of sysex
-            if(byte == 0xf7)
+            else if(byte == 0xf7)
             {
                 if(sysex_overflow_)
                 {
@@ -205,14 +205,89 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
     return did_parse;
 }
 
+size_t MidiParser::ParseChannelMessage(const uint8_t* bytes, size_t size)
+{
+    MidiMessageType type   = running_status_;
+    const bool      status = (bytes[0] & kStatusByteMask) != 0;
+    if(status)
+        type = static_cast<MidiMessageType>((bytes[0] & kMessageMask) >> 4);
+
+    // channel voice and channel mode messages only
+    const size_t pos = status ? 1 : 0;
+    if(type == SystemCommon || (type >= SystemRealTime && type != ChannelMode)
+       || TakesOneDataByte(type) || pos + 2 > size
+       || (bytes[pos] & kStatusByteMask) || (bytes[pos + 1] & kStatusByteMask))
+        return 0;
+
+    if(status)
+    {
+        incoming_message_.channel = bytes[0] & kChannelMask;
+        running_status_           = type;
+    }
+    incoming_message_.type    = type;
+    incoming_message_.data[0] = bytes[pos];
+    incoming_message_.data[1] = bytes[pos + 1];
+
+    //ChannelModeMessages (reserved Control Changes)
+    if(status && type == ControlChange && incoming_message_.data[0] > 119)
+    {
+        incoming_message_.type    = ChannelMode;
+        running_status_           = ChannelMode;
+        incoming_message_.cm_type = static_cast<ChannelModeType>(
+            incoming_message_.data[0] - 120);
+    }
+
+    //velocity 0 NoteOns are NoteOffs
+    if(running_status_ == NoteOn && incoming_message_.data[1] == 0)
+        incoming_message_.type = NoteOff;
+
+    return pos + 2;
+}
+
 void MidiParser::Reset()
 {
+    if(sysex_callback_ != nullptr && pstate_ == ParserSysEx)
+        sysex_callback_(SysexStage::Aborted, nullptr, 0, sysex_context_);
     pstate_                       = ParserEmpty;
     sysex_chunk_len_              = 0;
     sysex_chunk_count_            = 0;
     sysex_overflow_               = false;
     incoming_message_.type        = MessageLast;
+    incoming_message_.sc_type     = SystemCommonLast;
     incoming_message_.sysex_chunk = SysexChunk<>();
+    incoming_message_.timestamp   = 0;
+}
+
+bool MidiParser::StreamSysexByte(uint8_t byte, MidiEvent* event_out)
+{
+    if((byte & kStatusByteMask) == 0)
+    {
+        sysex_callback_(SysexStage::Continue, &byte, 1, sysex_context_);
+        return false;
+    }
+    if((byte & 0xF8) == 0xF8)
+    {
+        produceRealTime(byte, event_out);
+        return true;
+    }
+    pstate_ = ParserEmpty;
+    sysex_callback_(byte == 0xf7 ? SysexStage::End : SysexStage::Aborted,
+                    nullptr,
+                    0,
+                    sysex_context_);
+    return false;
+}
+
+void MidiParser::produceRealTime(uint8_t byte, MidiEvent* event_out)
+{
+    if(event_out == nullptr)
+        return;
+    *event_out             = incoming_message_;
+    event_out->type        = SystemRealTime;
+    event_out->channel     = byte & kChannelMask;
+    event_out->sysex_chunk = SysexChunk<>();
+    event_out->srt_type
+        = static_cast<SystemRealTimeType>(byte & kSystemRealTimeMask);
 }
 
 void MidiParser::produceSysexChunk(MidiEvent* event_out, bool msg_ended)
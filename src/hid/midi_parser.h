@@ -19,7 +19,52 @@ class MidiParser
     MidiParser() {};
     ~MidiParser() {}
 
-    inline void Init() { Reset(); }
+    /** Where a SysexCallback is in a SysEx message */
+    enum class SysexStage : uint8_t
+    {
+        /** 0xf0 was received, no data yet */
+        Start,
+        /** more data bytes of the message */
+        Continue,
+        /** 0xf7 was received, the message is complete */
+        End,
+        /** the message was cut short by another status byte or Reset() */
+        Aborted,
+    };
+
+    /** Receives SysEx data as it arrives, see SetSysexCallback().
+     *  Each message starts with a Start call, then its data comes in
+     *  Continue calls, and it ends with an End or Aborted call. Only
+     *  Continue calls have data.
+     */
+    typedef void (*SysexCallback)(SysexStage     stage,
+                                  const uint8_t *data,
+                                  size_t         size,
+                                  void          *context);
+
+    inline void Init()
+    {
+        sysex_callback_ = nullptr;
+        sysex_buf_.Init();
+        Reset();
+    }
+
+    /**
+     * @brief Streams SysEx messages to a callback instead of queueing
+     *        them as events with chunks of SYSEX_BUF_CHUNK_LEN bytes.
+     *        Messages can be of any length, e.g. firmware or sample dumps,
+     *        and aren't buffered: Parse() of a block passes the data
+     *        bytes that were received together in one call. System real
+     *        time messages within the SysEx message are parsed as events.
+     *
+     * @param callback  Called from Parse(), nullptr to queue events again
+     * @param context   Passed to the callback
+     */
+    void SetSysexCallback(SysexCallback callback, void *context)
+    {
+        sysex_callback_ = callback;
+        sysex_context_  = context;
+    }
 
     /**
      * @brief Parse one MIDI byte. If the byte completes a parsed event,
@@ -34,6 +79,65 @@ class MidiParser
      */
     bool Parse(uint8_t byte, MidiEvent *event_out);
 
+    /**
+     * @brief Parses a block of MIDI bytes, e.g. all that were received,
+     *        and calls the handler with each event. Channel messages with
+     *        two data bytes, with or without running status, are decoded
+     *        in a tight loop, the rest goes through Parse(). Messages can
+     *        be split between blocks.
+     *
+     * @param bytes     Raw MIDI bytes to parse
+     * @param size      Number of bytes
+     * @param handler   Called as handler(const MidiEvent&) for each event
+     */
+    template <typename EventHandler>
+    void Parse(const uint8_t *bytes, size_t size, EventHandler &&handler)
+    {
+        MidiEvent event;
+        size_t    i = 0;
+        while(i < size)
+        {
+            if(pstate_ == ParserSysEx && sysex_callback_ != nullptr)
+            {
+                size_t end = i;
+                while(end < size && (bytes[end] & kStatusByteMask) == 0)
+                    end++;
+                if(end > i)
+                {
+                    sysex_callback_(SysexStage::Continue,
+                                    &bytes[i],
+                                    end - i,
+                                    sysex_context_);
+                    i = end;
+                    continue;
+                }
+            }
+            const size_t consumed
+                = pstate_ == ParserEmpty
+                      ? ParseChannelMessage(&bytes[i], size - i)
+                      : 0;
+            if(consumed > 0)
+            {
+                handler(static_cast<const MidiEvent &>(incoming_message_));
+                i += consumed;
+            }
+            else
+            {
+                if(Parse(bytes[i], &event))
+                    handler(static_cast<const MidiEvent &>(event));
+                i++;
+            }
+        }
+    }
+
+    /** Returns the buffer that SysEx chunks are read from, e.g. to unpack
+     *  a CompactMidiEvent
+     */
+    RingBuffer<uint8_t, SYSEX_BUF_MAX_SIZE> *GetSysexBuffer()
+    {
+        return &sysex_buf_;
+    }
+
     /**
      * @brief Reset parser to default state
      */
@@ -55,8 +159,31 @@ class MidiParser
     size_t                                  sysex_chunk_len_;
     size_t                                  sysex_chunk_count_;
     bool                                    sysex_overflow_;
+    SysexCallback                           sysex_callback_;
+    void                                   *sysex_context_;
 
     void produceSysexChunk(MidiEvent *event_out, bool msg_ended);
+    void produceRealTime(uint8_t byte, MidiEvent *event_out);
+
+    /** Handles a byte of a SysEx message for the SysexCallback.
+     *  \return true if the byte was a system real time event
+     */
+    bool StreamSysexByte(uint8_t byte, MidiEvent *event_out);
+
+    /** Decodes a complete channel message with two data bytes, with or
+     *  without running status, into incoming_message_.
+     *  \return the number of bytes used, 0 if it's another kind of message
+     */
+    size_t ParseChannelMessage(const uint8_t *bytes, size_t size);
+
+    /** True if a message of this type only has one data byte */
+    bool TakesOneDataByte(MidiMessageType type) const
+    {
+        return type == ChannelPressure || type == ProgramChange
+               || (type == SystemCommon
+                   && (incoming_message_.sc_type == MTCQuarterFrame
+                       || incoming_message_.sc_type == SongSelect));
+    }
 
     // Masks to check for message type, and byte content
     const uint8_t kStatusByteMask     = 0x80;
@@ -0,0 +1,146 @@
+#include "midi_router.h"
+
+using namespace daisy;
+
+bool MidiRouter::Filter::Passes(const MidiEvent& event) const
+{
+    if(event.type >= MessageLast || (types & TypeBit(event.type)) == 0)
+        return false;
+    const bool channel_message
+        = event.type < SystemCommon || event.type == ChannelMode;
+    return !channel_message || (channels & (1u << event.channel)) != 0;
+}
+
+void MidiRouter::Init()
+{
+    num_outputs_ = 0;
+    num_routes_  = 0;
+}
+
+int MidiRouter::AddOutput(OutputFunction write,
+                          void*          context,
+                          bool           running_status)
+{
+    if(write == nullptr || num_outputs_ >= kMaxOutputs)
+        return -1;
+    Output& output            = outputs_[num_outputs_];
+    output.write              = write;
+    output.context            = context;
+    output.use_running_status = running_status;
+    output.running_status     = 0;
+    return int(num_outputs_++);
+}
+
+bool MidiRouter::AddRoute(size_t input, int output, const Filter& filter)
+{
+    if(output < 0 || size_t(output) >= num_outputs_
+       || num_routes_ >= kMaxRoutes)
+        return false;
+    Route& route = routes_[num_routes_++];
+    route.input  = input;
+    route.output = size_t(output);
+    route.filter = filter;
+    return true;
+}
+
+bool MidiRouter::AddRoute(size_t input, int output)
+{
+    return AddRoute(input, output, Filter());
+}
+
+void MidiRouter::Process(size_t input, const MidiEvent& event)
+{
+    uint8_t bytes[3];
+    size_t  size = 0;
+    for(size_t i = 0; i < num_routes_; i++)
+    {
+        const Route& route = routes_[i];
+        if(route.input != input || !route.filter.Passes(event))
+            continue;
+        // encoded once, for the first route that passes the message
+        if(size == 0)
+        {
+            size = Encode(event, bytes);
+            if(size == 0)
+                return;
+        }
+        Send(outputs_[route.output], bytes, size);
+    }
+}
+
+void MidiRouter::ResetRunningStatus(int output)
+{
+    if(output >= 0 && size_t(output) < num_outputs_)
+        outputs_[output].running_status = 0;
+}
+
+size_t MidiRouter::Encode(const MidiEvent& event, uint8_t* bytes)
+{
+    switch(event.type)
+    {
+        case NoteOff:
+        case NoteOn:
+        case PolyphonicKeyPressure:
+        case ControlChange:
+        case PitchBend:
+        case ChannelMode:
+        {
+            // channel mode messages are control changes
+            const uint8_t type = event.type == ChannelMode ? ControlChange
+                                                           : event.type;
+            bytes[0] = uint8_t(0x80 | (type << 4) | (event.channel & 0x0f));
+            bytes[1] = event.data[0];
+            bytes[2] = event.data[1];
+            return 3;
+        }
+        case ProgramChange:
+        case ChannelPressure:
+            bytes[0]
+                = uint8_t(0x80 | (event.type << 4) | (event.channel & 0x0f));
+            bytes[1] = event.data[0];
+            return 2;
+        case SystemCommon:
+            bytes[0] = uint8_t(0xf0 | event.sc_type);
+            bytes[1] = event.data[0];
+            bytes[2] = event.data[1];
+            switch(event.sc_type)
+            {
+                case MTCQuarterFrame:
+                case SongSelect: return 2;
+                case SongPositionPointer: return 3;
+                case TuneRequest: return 1;
+                default: return 0;
+            }
+        case SystemRealTime:
+            if(event.srt_type >= SystemRealTimeLast)
+                return 0;
+            bytes[0] = uint8_t(0xf8 | event.srt_type);
+            return 1;
+        default: return 0;
+    }
+}
+
+void MidiRouter::Send(Output& output, uint8_t* bytes, size_t size)
+{
+    const uint8_t status = bytes[0];
+    // real time messages can be sent between the bytes of other messages,
+    // and don't cancel the running status
+    if(status >= 0xf8)
+    {
+        output.write(bytes, size, output.context);
+        return;
+    }
+    if(status >= 0xf0)
+    {
+        output.running_status = 0;
+        output.write(bytes, size, output.context);
+        return;
+    }
+    if(output.use_running_status && status == output.running_status)
+    {
+        output.write(bytes + 1, size - 1, output.context);
+        return;
+    }
+    output.running_status = status;
+    output.write(bytes, size, output.context);
+}
@@ -0,0 +1,152 @@
+#pragma once
+#ifndef DSY_MIDI_ROUTER_H
+#define DSY_MIDI_ROUTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hid/MidiEvent.h"
+
+namespace daisy
+{
+/** @brief Merges and forwards MIDI messages between MidiHandlers
+ *  @ingroup midi
+ *  @details The handlers pass each message to the router as it is parsed
+ *           on reception (see MidiHandler::SetRouter()), and the router
+ *           sends it to the outputs of the routes it passes, without a
+ *           detour through the main loop. Messages are only sent whole, so
+ *           the messages of several inputs merge cleanly into one output.
+ *           The router keeps track of the running status of each output,
+ *           and only sends a status byte when it changes.
+ *
+ *           SysEx messages are not forwarded.
+ *
+ *           The router isn't locked: all inputs should be handlers whose
+ *           messages are parsed at the same interrupt priority, like the
+ *           UART and USB handlers are. Don't send to an output from
+ *           elsewhere, e.g. the main loop, with SendMessage() while
+ *           messages are forwarded to it.
+ *
+ *           \code
+ *           router.Init();
+ *           const int usb_out = router.AddOutput(midi_usb, false);
+ *           router.AddRoute(0, usb_out);
+ *           midi_uart.SetRouter(&router, 0);
+ *           \endcode
+ */
+class MidiRouter
+{
+  public:
+    /** The most outputs and routes */
+    static constexpr size_t kMaxOutputs = 4;
+    static constexpr size_t kMaxRoutes  = 8;
+
+    /** Writes bytes to an output, e.g. MidiHandler::SendMessage() */
+    typedef void (*OutputFunction)(uint8_t* bytes, size_t size, void* context);
+
+    /** Which messages a route passes */
+    struct Filter
+    {
+        /** Bit n passes channel messages on channel n */
+        uint16_t channels = 0xffff;
+
+        /** Bit n passes messages of MidiMessageType n, see TypeBit() */
+        uint16_t types = 0xffff;
+
+        /** Returns the bit for a type, e.g. to drop the clock with
+         *  types &= ~TypeBit(SystemRealTime)
+         */
+        static constexpr uint16_t TypeBit(MidiMessageType type)
+        {
+            return uint16_t(1u << type);
+        }
+
+        /** True if the filter passes the event */
+        bool Passes(const MidiEvent& event) const;
+    };
+
+    MidiRouter() {}
+    ~MidiRouter() {}
+
+    /** Removes all outputs and routes */
+    void Init();
+
+    /** Adds an output.
+     *  \param write called with each message for the output
+     *  \param context passed to write
+     *  \param running_status true to leave out repeated status bytes, e.g.
+     *         for UART MIDI, false for USB MIDI, which sends each message
+     *         in a packet with its status
+     *  \return the index of the output, -1 if there are kMaxOutputs
+     */
+    int AddOutput(OutputFunction write, void* context, bool running_status);
+
+    /** Adds a MidiHandler, or anything else with a
+     *  SendMessage(uint8_t*, size_t), as an output. See AddOutput().
+     */
+    template <typename Handler>
+    int AddOutput(Handler& handler, bool running_status)
+    {
+        return AddOutput(&SendToHandler<Handler>, &handler, running_status);
+    }
+
+    /** Routes the messages of an input that pass the filter to an output.
+     *  \param input the input number passed to Process()
+     *  \param output an index returned by AddOutput()
+     *  \param filter which messages are forwarded
+     *  \return false if the output doesn't exist, or there are kMaxRoutes
+     */
+    bool AddRoute(size_t input, int output, const Filter& filter);
+
+    /** Routes all messages of an input to an output, see above */
+    bool AddRoute(size_t input, int output);
+
+    /** Forwards a message from an input to the outputs of its routes.
+     *  This is called by the MidiHandlers on reception.
+     *  \param input the number of the input
+     *  \param event the parsed message
+     */
+    void Process(size_t input, const MidiEvent& event);
+
+    /** Makes the next message to an output start with its status byte,
+     *  e.g. after something else was sent to it
+     */
+    void ResetRunningStatus(int output);
+
+  private:
+    struct Output
+    {
+        OutputFunction write;
+        void*          context;
+        bool           use_running_status;
+        uint8_t        running_status;
+    };
+
+    struct Route
+    {
+        size_t input;
+        size_t output;
+        Filter filter;
+    };
+
+    /** Encodes the message with its status byte.
+     *  \return the number of bytes, 0 if it can't be forwarded
+     */
+    static size_t Encode(const MidiEvent& event, uint8_t* bytes);
+
+    void Send(Output& output, uint8_t* bytes, size_t size);
+
+    template <typename Handler>
+    static void SendToHandler(uint8_t* bytes, size_t size, void* context)
+    {
+        static_cast<Handler*>(context)->SendMessage(bytes, size);
+    }
+
+    Output outputs_[kMaxOutputs];
+    size_t num_outputs_;
+    Route  routes_[kMaxRoutes];
+    size_t num_routes_;
+};
+
+} // namespace daisy
+
+#endif
@@ -1,5 +1,6 @@
 #include "hid/parameter.h"
 #include <math.h>
+#include "util/FastMath.h"
 
 using namespace daisy;
 
@@ -25,6 +26,9 @@ float Parameter::Process()
         case LOGARITHMIC:
             val_ = expf((in_.Process() * (lmax_ - lmin_)) + lmin_);
             break;
+        case LOGARITHMIC_FAST:
+            val_ = fastexpf((in_.Process() * (lmax_ - lmin_)) + lmin_);
+            break;
         case CUBE:
             val_ = in_.Process();
             val_ = ((val_ * (val_ * val_)) * (pmax_ - pmin_)) + pmin_;
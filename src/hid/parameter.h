@@ -15,11 +15,12 @@ class Parameter
     /** Curves are applied to the output signal */
     enum Curve
     {
-        LINEAR,      /**< Linear curve */
-        EXPONENTIAL, /**< Exponential curve */
-        LOGARITHMIC, /**<  Logarithmic curve */
-        CUBE,        /**< Cubic curve */
-        LAST,        /**< Final enum element. */
+        LINEAR,           /**< Linear curve */
+        EXPONENTIAL,      /**< Exponential curve */
+        LOGARITHMIC,      /**<  Logarithmic curve */
+        CUBE,             /**< Cubic curve */
+        LOGARITHMIC_FAST, /**< Logarithmic curve, with fastexpf() */
+        LAST,             /**< Final enum element. */
     };
     /** Constructor */
     Parameter() {}
@@ -31,6 +32,8 @@ class Parameter
     \param min - bottom of range. (when input is 0.0)
         \param max - top of range (when input is 1.0)
     \param curve - the scaling curve for the input->output transformation.
+    LOGARITHMIC_FAST is LOGARITHMIC with a relative error below 4e-6, without
+    the expf() call per Process().
     */
     void Init(AnalogControl input, float min, float max, Curve curve);
 
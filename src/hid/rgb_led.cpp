@@ -10,6 +10,18 @@ void RgbLed::Init(dsy_gpio_pin red,
     b_.Init(blue, invert);
 }
 
+bool RgbLed::Init(dsy_gpio_pin   red,
+                  dsy_gpio_pin   green,
+                  dsy_gpio_pin   blue,
+                  bool           invert,
+                  LedPwmService& pwm)
+{
+    const bool r = r_.Init(red, invert, pwm);
+    const bool g = g_.Init(green, invert, pwm);
+    const bool b = b_.Init(blue, invert, pwm);
+    return r && g && b;
+}
+
 void RgbLed::Set(float r, float g, float b)
 {
     r_.Set(r);
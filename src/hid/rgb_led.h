@@ -26,6 +26,21 @@ class RgbLed
     void
     Init(dsy_gpio_pin red, dsy_gpio_pin green, dsy_gpio_pin blue, bool invert);
 
+    /** Initializes the elements as LEDs driven by a LedPwmService, Set()
+    then only changes the duty cycles, and Update() doesn't need to be called.
+    \param red  Red element
+    \param green Green element
+    \param blue Blue element
+    \param invert Flips led polarity
+    \param pwm the service, before its Start()
+    \return false if the service can't take the pins
+    */
+    bool Init(dsy_gpio_pin   red,
+              dsy_gpio_pin   green,
+              dsy_gpio_pin   blue,
+              bool           invert,
+              LedPwmService& pwm);
+
     /** Sets each element of the LED with a floating point number 0-1 
     \param r Red element
     \param g Green element
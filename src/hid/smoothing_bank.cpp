@@ -0,0 +1,160 @@
+#include <math.h>
+#include "hid/smoothing_bank.h"
+#include "hid/parameter.h"
+using namespace daisy;
+
+constexpr int SmoothingBank::kInvalidChannel;
+
+void SmoothingBank::Init(float samplerate)
+{
+    num_channels_ = 0;
+    samplerate_   = samplerate;
+}
+
+int SmoothingBank::Add(Ramp ramp, float ramp_seconds, float initial)
+{
+    if(num_channels_ >= DSY_SMOOTHING_BANK_MAX_CHANNELS)
+        return kInvalidChannel;
+    const size_t i = num_channels_++;
+
+    param_[i]      = nullptr;
+    value_[i]      = initial;
+    target_[i]     = initial;
+    step_[i]       = 0.f;
+    steps_left_[i] = 0;
+    SetRamp(i, ramp, ramp_seconds);
+    return int(i);
+}
+
+int SmoothingBank::Add(Parameter* param, Ramp ramp, float ramp_seconds)
+{
+    if(param == nullptr)
+        return kInvalidChannel;
+    const int idx = Add(ramp, ramp_seconds, param->Value());
+    if(idx != kInvalidChannel)
+        param_[idx] = param;
+    return idx;
+}
+
+void SmoothingBank::SetRamp(size_t idx, Ramp ramp, float ramp_seconds)
+{
+    ramp_[idx]         = ramp;
+    ramp_seconds_[idx] = ramp_seconds > 0.f ? ramp_seconds : 0.f;
+    // per sample factor of the distance to an exponential target
+    coeff_[idx] = ramp_seconds_[idx] > 0.f
+                      ? expf(-1.f / (ramp_seconds_[idx] * samplerate_))
+                      : 0.f;
+}
+
+void SmoothingBank::SetTarget(size_t idx, float target)
+{
+    Retarget(idx, target);
+}
+
+void SmoothingBank::SetTargets(const float* targets, size_t count)
+{
+    count = count < num_channels_ ? count : num_channels_;
+    for(size_t i = 0; i < count; i++)
+        Retarget(i, targets[i]);
+}
+
+void SmoothingBank::Reset(size_t idx, float value)
+{
+    value_[idx]      = value;
+    target_[idx]     = value;
+    steps_left_[idx] = 0;
+}
+
+void SmoothingBank::Retarget(size_t idx, float target)
+{
+    if(target == target_[idx])
+        return;
+    target_[idx] = target;
+
+    // a timed linear ramp starts over from where it is
+    if(ramp_[idx] == Ramp::LINEAR && ramp_seconds_[idx] > 0.f)
+    {
+        const float    steps = ramp_seconds_[idx] * samplerate_ + 0.5f;
+        const uint32_t n     = steps >= 1.f ? uint32_t(steps) : 1;
+        steps_left_[idx]     = n;
+        step_[idx]           = (target - value_[idx]) / float(n);
+    }
+}
+
+void SmoothingBank::Process(float* const* outs, size_t size)
+{
+    if(size == 0)
+        return;
+    const size_t n = num_channels_;
+
+    // the block rate part: new targets, and the ramps that end with it
+    for(size_t i = 0; i < n; i++)
+    {
+        if(param_[i] != nullptr)
+            Retarget(i, param_[i]->Process());
+        if(ramp_[i] == Ramp::LINEAR && ramp_seconds_[i] <= 0.f)
+        {
+            steps_left_[i] = uint32_t(size);
+            step_[i]       = (target_[i] - value_[i]) / float(size);
+        }
+    }
+
+    // the sample rate part, one tight loop per parameter
+    for(size_t i = 0; i < n; i++)
+    {
+        float* const out    = outs[i];
+        const float  target = target_[i];
+        if(ramp_[i] == Ramp::EXPONENTIAL)
+        {
+            const float k = coeff_[i];
+            float       d = value_[i] - target;
+            if(out != nullptr)
+            {
+                for(size_t s = 0; s < size; s++)
+                {
+                    d *= k;
+                    out[s] = target + d;
+                }
+            }
+            else
+            {
+                for(size_t s = 0; s < size; s++)
+                    d *= k;
+            }
+            // settled, before the distance turns denormal
+            value_[i] = fabsf(d) < 1e-20f ? target : target + d;
+            continue;
+        }
+
+        const size_t ramp = steps_left_[i] < size ? steps_left_[i] : size;
+        const float  step = step_[i];
+        float        v    = value_[i];
+        if(out != nullptr)
+        {
+            for(size_t s = 0; s < ramp; s++)
+            {
+                v += step;
+                out[s] = v;
+            }
+        }
+        else
+        {
+            v += step * float(ramp);
+        }
+        steps_left_[i] -= uint32_t(ramp);
+
+        // the end of a ramp is the target itself, not the sum of the steps
+        if(steps_left_[i] == 0)
+        {
+            v = target;
+            if(out != nullptr)
+            {
+                if(ramp > 0)
+                    out[ramp - 1] = target;
+                for(size_t s = ramp; s < size; s++)
+                    out[s] = target;
+            }
+        }
+        value_[i] = v;
+    }
+}
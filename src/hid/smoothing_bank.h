@@ -0,0 +1,137 @@
+#pragma once
+#ifndef DSY_SMOOTHING_BANK_H
+#define DSY_SMOOTHING_BANK_H
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of parameters a SmoothingBank can hold */
+#ifndef DSY_SMOOTHING_BANK_MAX_CHANNELS
+#define DSY_SMOOTHING_BANK_MAX_CHANNELS 32
+#endif
+
+#ifdef __cplusplus
+namespace daisy
+{
+class Parameter;
+
+/**
+    @brief Turns block rate parameter values into per-sample ramps \n
+    Controls, and the Parameter objects built on them, change once per
+    audio block, so a parameter used as is steps at each block boundary,
+    which can be heard as zipper noise on gains and filter cutoffs. The
+    bank takes a new target per parameter once per block, and writes a
+    ramp to it into a block of samples per parameter, for the DSP to read
+    instead of the stepping value.
+
+    Each parameter ramps either linearly, reaching the target after its
+    ramp time, or by default at the end of each block, or exponentially,
+    like a one pole lowpass with its time constant. The state is kept as
+    arrays per field, like ControlBank, and each ramp is one add or one
+    multiply-add per sample, without a call or a branch per sample.
+    @ingroup controls
+
+    @code
+    SmoothingBank smooth;
+    float         cutoff[48], gain[48];
+    float* const  outs[] = {cutoff, gain};
+
+    smooth.Init(hw.AudioSampleRate());
+    smooth.Add(&cutoff_param, SmoothingBank::Ramp::EXPONENTIAL, 0.02f);
+    smooth.Add(&gain_param);
+    // in the audio callback, Process() of the parameters happens here
+    smooth.Process(outs, size);
+    @endcode
+*/
+class SmoothingBank
+{
+  public:
+    /** Returned by Add() when the bank is full */
+    static constexpr int kInvalidChannel = -1;
+
+    /** Shape of the ramp to a new target */
+    enum class Ramp
+    {
+        LINEAR,      /**< straight line, over the ramp time or the block */
+        EXPONENTIAL, /**< one pole lowpass, the ramp time is the time
+                          constant */
+    };
+
+    SmoothingBank() : num_channels_(0), samplerate_(48000.f) {}
+    ~SmoothingBank() {}
+
+    /** Removes all parameters
+        \param samplerate rate in Hz of the samples written by Process(),
+               e.g. the audio sample rate
+    */
+    void Init(float samplerate);
+
+    /** Adds a parameter that gets its targets from SetTarget()
+        \param ramp shape of the ramps
+        \param ramp_seconds time of a LINEAR ramp, 0 to reach each target
+               at the end of the block, or the time constant of an
+               EXPONENTIAL one
+        \param initial value to start from
+        \return index of the parameter, or kInvalidChannel if the bank is
+                full
+    */
+    int Add(Ramp  ramp         = Ramp::LINEAR,
+            float ramp_seconds = 0.f,
+            float initial      = 0.f);
+
+    /** Adds a Parameter, starting from its Value(). Process() calls its
+        Process() once per block for the target.
+        \return index of the parameter, or kInvalidChannel if the bank is
+                full or there's no Parameter
+    */
+    int Add(Parameter* param,
+            Ramp       ramp         = Ramp::LINEAR,
+            float      ramp_seconds = 0.f);
+
+    /** Sets the value a parameter ramps to, from the next Process() */
+    void SetTarget(size_t idx, float target);
+
+    /** Sets the targets of the first count parameters, e.g. from
+        ControlBank::GetValues()
+    */
+    void SetTargets(const float* targets, size_t count);
+
+    /** Jumps to a value without a ramp, e.g. after loading a preset */
+    void Reset(size_t idx, float value);
+
+    /** Changes the ramp of a parameter, the current ramp continues */
+    void SetRamp(size_t idx, Ramp ramp, float ramp_seconds);
+
+    /** Writes a block of the ramps of all parameters, once per block
+        \param outs one block of size samples per parameter, in the order
+               they were added. A nullptr skips writing the parameter, it
+               still moves on.
+        \param size samples per block
+    */
+    void Process(float* const* outs, size_t size);
+
+    /** Returns the value of a parameter after the last sample written */
+    inline float Value(size_t idx) const { return value_[idx]; }
+
+    /** Returns the target of a parameter */
+    inline float Target(size_t idx) const { return target_[idx]; }
+
+    /** Returns the number of parameters */
+    inline size_t GetNumChannels() const { return num_channels_; }
+
+  private:
+    void Retarget(size_t idx, float target);
+
+    Parameter* param_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    Ramp       ramp_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    float      ramp_seconds_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    float      coeff_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    float      value_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    float      target_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    float      step_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    uint32_t   steps_left_[DSY_SMOOTHING_BANK_MAX_CHANNELS];
+    size_t     num_channels_;
+    float      samplerate_;
+};
+} // namespace daisy
+#endif
+#endif
@@ -0,0 +1,209 @@
+#pragma once
+#ifndef DSY_SPECTRUM_ANALYZER_H
+#define DSY_SPECTRUM_ANALYZER_H /**< & */
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "util/RealFft.h"
+
+namespace daisy
+{
+/** @brief Collects the blocks of the audio callback, and computes their
+ *  spectrum outside of it
+ *  @ingroup audio
+ *  @details The audio callback only copies its block into a ring of 2 * N
+ *           samples with Write(), or the analyzer runs as a stage of an
+ *           AudioChain. Process(), called from the main loop or an
+ *           interrupt of a lower priority than the audio, e.g. a
+ *           TimerHandle callback, takes the next frame of N samples from
+ *           the ring, applies a Hann window and a RealFft, and computes
+ *           the magnitudes. So the FFT costs nothing of the audio
+ *           callback's time.
+ *
+ *           A frame starts every Hop samples, e.g. N / 2 for frames that
+ *           overlap by half. The ring holds a frame more than the one
+ *           being analyzed, so Process() has N samples of time to copy it
+ *           before the audio overwrites it. When it's called too rarely,
+ *           it skips to the newest frame, and counts the frames it skipped
+ *           in GetDroppedFrames().
+ *
+ *           The magnitudes are scaled to the amplitude of a sine at the
+ *           center of a bin, e.g. 1 for a full scale sine.
+ *
+ *  @code
+ *  static SpectrumAnalyzer<1024> DSY_SDRAM_BSS analyzer;
+ *
+ *  analyzer.Init();
+ *  chain.Add(SpectrumAnalyzer<1024>::Stage, &analyzer);
+ *  while(1)
+ *  {
+ *      if(analyzer.Process())
+ *          Draw(analyzer.GetMagnitudes(), analyzer.GetNumBins());
+ *  }
+ *  @endcode
+ *
+ *  \tparam N samples per frame, a power of two of at least 4
+ *  \tparam Hop samples from the start of one frame to the next, 1 to N
+ */
+template <size_t N, size_t Hop = N / 2>
+class SpectrumAnalyzer
+{
+    static_assert(Hop > 0 && Hop <= N, "Hop has to be from 1 to N");
+
+  public:
+    SpectrumAnalyzer() {}
+
+    /** Clears the analyzer, call it before use. The constructor leaves
+     *  the buffers alone, so the object can be placed in the SDRAM.
+     */
+    void Init()
+    {
+        const float pi = 3.14159265358979f;
+        fft_.Init();
+        for(size_t i = 0; i < N; i++)
+            window_[i] = 0.5f - 0.5f * cosf(2.f * pi * float(i) / float(N));
+        for(auto& s : ring_)
+            s = 0.f;
+        for(auto& m : magnitudes_)
+            m = 0.f;
+        written_  = 0;
+        next_end_ = N;
+        frames_   = 0;
+        dropped_  = 0;
+    }
+
+    /** Adds a block of audio, called from the audio callback
+     *  \param in size samples
+     *  \param size samples in the block
+     */
+    void Write(const float* in, size_t size)
+    {
+        const uint32_t w = written_;
+        for(size_t i = 0; i < size; i++)
+            ring_[(w + i) & kMask] = in[i];
+        std::atomic_signal_fence(std::memory_order_release);
+        written_ = w + size;
+    }
+
+    /** An AudioChain stage, writing the first channel to the analyzer
+     *  passed as the context
+     */
+    static void Stage(float* const* buffer, size_t size, void* context)
+    {
+        static_cast<SpectrumAnalyzer*>(context)->Write(buffer[0], size);
+    }
+
+    /** Analyzes the next frame, if the audio has written it
+     *  \returns true if there's a new spectrum
+     */
+    bool Process()
+    {
+        uint32_t       end = next_end_;
+        const uint32_t w   = written_;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        if(int32_t(w - end) < 0)
+            return false;
+        // the ring holds the last 2N samples, when the frame is older than
+        // that the newest one is taken
+        if(w - end > N)
+        {
+            while(w - end >= Hop)
+            {
+                end += Hop;
+                dropped_++;
+            }
+        }
+        for(size_t i = 0; i < N; i++)
+            frame_[i] = ring_[(end - N + i) & kMask] * window_[i];
+        next_end_ = end + Hop;
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        if(written_ - end > N)
+        {
+            // the audio overwrote the start of the frame while copying it
+            dropped_++;
+            return false;
+        }
+
+        fft_.Forward(frame_);
+        // the window halves the amplitude, and bins 0 and N / 2 aren't
+        // mirrored
+        const float scale  = 4.f / float(N);
+        magnitudes_[0]     = fabsf(frame_[0]) * scale * 0.5f;
+        magnitudes_[N / 2] = fabsf(frame_[1]) * scale * 0.5f;
+        for(size_t k = 1; k < N / 2; k++)
+        {
+            const float re = frame_[2 * k], im = frame_[2 * k + 1];
+            magnitudes_[k] = sqrtf(re * re + im * im) * scale;
+        }
+        frames_++;
+        return true;
+    }
+
+    /** Returns the number of bins, N / 2 + 1 from 0Hz to half the
+     *  samplerate
+     */
+    static constexpr size_t GetNumBins() { return N / 2 + 1; }
+
+    /** Returns the magnitudes of the last spectrum, GetNumBins() values */
+    const float* GetMagnitudes() const { return magnitudes_; }
+
+    /** Returns the last spectrum as the RealFft computed it, N values */
+    const float* GetSpectrum() const { return frame_; }
+
+    /** Returns the frequency of a bin
+     *  \param bin from 0 to GetNumBins() - 1, may be fractional
+     *  \param samplerate of the audio in Hz
+     */
+    static float GetBinFrequency(float bin, float samplerate)
+    {
+        return bin * samplerate / float(N);
+    }
+
+    /** Returns the peak of the last spectrum in bins, between the bins by
+     *  a parabola through the largest one and its neighbours, e.g. for a
+     *  tuner
+     *  \param first lowest bin to search, e.g. 1 to skip the DC offset
+     */
+    float GetPeakBin(size_t first = 1) const
+    {
+        size_t peak = first < N / 2 ? first : N / 2;
+        for(size_t k = peak + 1; k <= N / 2; k++)
+            if(magnitudes_[k] > magnitudes_[peak])
+                peak = k;
+        if(peak == 0 || peak == N / 2)
+            return float(peak);
+        const float a   = magnitudes_[peak - 1];
+        const float b   = magnitudes_[peak];
+        const float c   = magnitudes_[peak + 1];
+        const float div = a - 2.f * b + c;
+        return div < 0.f ? float(peak) + 0.5f * (a - c) / div : float(peak);
+    }
+
+    /** Returns the number of spectra computed since Init() */
+    uint32_t GetFrameCount() const { return frames_; }
+
+    /** Returns the number of frames that were skipped, as Process() wasn't
+     *  called often enough
+     */
+    uint32_t GetDroppedFrames() const { return dropped_; }
+
+  private:
+    static constexpr uint32_t kMask = 2 * N - 1;
+
+    RealFft<N>        fft_;
+    float             ring_[2 * N];
+    float             frame_[N];
+    float             window_[N];
+    float             magnitudes_[N / 2 + 1];
+    volatile uint32_t written_;  // samples written in total
+    uint32_t          next_end_; // written_ at the end of the next frame
+    uint32_t          frames_;
+    uint32_t          dropped_;
+};
+
+} // namespace daisy
+
+#endif
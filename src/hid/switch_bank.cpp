@@ -0,0 +1,116 @@
+#include "hid/switch_bank.h"
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
+
+using namespace daisy;
+
+constexpr int    SwitchBank::kInvalidSwitch;
+constexpr size_t SwitchBank::kMaxSwitches;
+
+void SwitchBank::Init()
+{
+    for(size_t i = 0; i < 8; i++)
+        history_[i] = 0;
+    pressed_      = 0;
+    rising_       = 0;
+    falling_      = 0;
+    flip_         = 0;
+    last_update_  = System::GetNow();
+    num_switches_ = 0;
+    num_ports_    = 0;
+}
+
+int SwitchBank::AddSwitch(Pin pin, Switch::Polarity pol, Switch::Pull pu)
+{
+    if(!pin.IsValid() || num_switches_ >= kMaxSwitches)
+        return kInvalidSwitch;
+
+    dsy_gpio gpio;
+    gpio.pin  = pin;
+    gpio.mode = DSY_GPIO_MODE_INPUT;
+    switch(pu)
+    {
+        case Switch::PULL_UP: gpio.pull = DSY_GPIO_PULLUP; break;
+        case Switch::PULL_DOWN: gpio.pull = DSY_GPIO_PULLDOWN; break;
+        case Switch::PULL_NONE: gpio.pull = DSY_GPIO_NOPULL; break;
+        default: gpio.pull = DSY_GPIO_PULLUP; break;
+    }
+    dsy_gpio_init(&gpio);
+
+    // each port is read once, no matter how many switches it has
+    const volatile uint32_t *idr = &dsy_hal_map_get_port(&gpio.pin)->IDR;
+    size_t                   port;
+    for(port = 0; port < num_ports_; port++)
+    {
+        if(port_idr_[port] == idr)
+            break;
+    }
+    if(port == num_ports_)
+        port_idr_[num_ports_++] = idr;
+
+    const size_t i = num_switches_++;
+    port_[i]       = port;
+    pin_[i]        = pin.pin;
+    // 1 is pressed, as in Switch
+    if(pol == Switch::POLARITY_INVERTED)
+        flip_ |= 1u << i;
+    return int(i);
+}
+
+uint32_t SwitchBank::Read() const
+{
+    uint32_t idr[PORTX];
+    for(size_t i = 0; i < num_ports_; i++)
+        idr[i] = *port_idr_[i];
+    uint32_t pressed = 0;
+    for(size_t i = 0; i < num_switches_; i++)
+        pressed |= ((idr[port_[i]] >> pin_[i]) & 1u) << i;
+    return pressed ^ flip_;
+}
+
+void SwitchBank::Debounce()
+{
+    // update no faster than 1kHz
+    const uint32_t now = System::GetNow();
+    if(now - last_update_ >= 1)
+    {
+        last_update_ = now;
+        Process(Read());
+    }
+    else
+    {
+        rising_  = 0;
+        falling_ = 0;
+    }
+}
+
+void SwitchBank::Process(uint32_t pressed)
+{
+    // the shift register of Switch, one bit of each word per switch
+    for(size_t k = 7; k > 0; k--)
+        history_[k] = history_[k - 1];
+    history_[0] = pressed;
+
+    // 7 updates held after 1 released is a rising edge (0x7f), the reverse
+    // a falling one (0x80), and 8 held is pressed (0xff)
+    uint32_t held = history_[0], released = ~history_[0];
+    for(size_t k = 1; k < 7; k++)
+    {
+        held &= history_[k];
+        released &= ~history_[k];
+    }
+    rising_  = held & ~history_[7];
+    falling_ = released & history_[7];
+    pressed_ = held & history_[7];
+
+    uint32_t edges = rising_;
+    while(edges)
+    {
+        const uint32_t i     = __builtin_ctz(edges);
+        rising_edge_time_[i] = System::GetNow();
+        edges &= edges - 1;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef DSY_SWITCH_BANK_H
+#define DSY_SWITCH_BANK_H
+#include "daisy_core.h"
+#include "hid/switch.h"
+
+namespace daisy
+{
+/**
+    @brief Debounces up to 32 switches at once \n
+    Does the same as an array of Switch, for boards with many buttons. Each
+    GPIO port is read once per Debounce(), and the states of all switches
+    are kept as 8 words of history, one bit per switch, so the debouncing
+    of all of them takes a few word operations instead of a read and a
+    shift per switch.
+    @ingroup controls
+
+    @code
+    SwitchBank buttons;
+    buttons.Init();
+    for(size_t i = 0; i < 16; i++)
+        buttons.AddSwitch(pins[i]);
+    // in the control loop
+    buttons.Debounce();
+    if(buttons.RisingEdge(3))
+        // ...
+    @endcode
+*/
+class SwitchBank
+{
+  public:
+    /** Returned by AddSwitch() when the bank is full */
+    static constexpr int kInvalidSwitch = -1;
+
+    /** Maximum number of switches, one bit of a word each */
+    static constexpr size_t kMaxSwitches = 32;
+
+    SwitchBank() : num_switches_(0), num_ports_(0) {}
+    ~SwitchBank() {}
+
+    /** Removes all switches */
+    void Init();
+
+    /** Adds a switch and initializes its pin as an input.
+        \param pin hardware pin of the switch
+        \param pol switch polarity -- Default: POLARITY_INVERTED
+        \param pu switch pull up/down -- Default: PULL_UP
+        \return index of the switch, or kInvalidSwitch if the bank is full
+                or the pin isn't valid
+    */
+    int AddSwitch(Pin              pin,
+                  Switch::Polarity pol = Switch::POLARITY_INVERTED,
+                  Switch::Pull     pu  = Switch::PULL_UP);
+
+    /** Reads all switches and debounces them, like Switch::Debounce(), no
+        more often than once per millisecond. The edges are only set by the
+        call that did the update.
+    */
+    void Debounce();
+
+    /** Debounces switches not read from a GPIO, e.g. from a shift
+        register. Updates every time it's called.
+        \param pressed bit i is 1 if switch i is held down, without
+               debouncing
+    */
+    void Process(uint32_t pressed);
+
+    /** \return true if a switch was just pressed. */
+    inline bool RisingEdge(size_t idx) const { return (rising_ >> idx) & 1; }
+
+    /** \return true if a switch was just released */
+    inline bool FallingEdge(size_t idx) const
+    {
+        return (falling_ >> idx) & 1;
+    }
+
+    /** \return true if a switch is held down */
+    inline bool Pressed(size_t idx) const { return (pressed_ >> idx) & 1; }
+
+    /** \return the switches that are held down, bit i for switch i */
+    inline uint32_t GetPressed() const { return pressed_; }
+
+    /** \return the switches that were just pressed */
+    inline uint32_t GetRisingEdges() const { return rising_; }
+
+    /** \return the switches that were just released */
+    inline uint32_t GetFallingEdges() const { return falling_; }
+
+    /** \return the time in milliseconds that a switch has been held */
+    inline float TimeHeldMs(size_t idx) const
+    {
+        return Pressed(idx) ? System::GetNow() - rising_edge_time_[idx] : 0;
+    }
+
+    /** Returns the number of switches */
+    inline size_t GetNumSwitches() const { return num_switches_; }
+
+  private:
+    uint32_t Read() const;
+
+    /** history_[k] holds the states of k updates ago */
+    uint32_t history_[8];
+    uint32_t pressed_, rising_, falling_;
+    uint32_t flip_;
+    uint32_t last_update_;
+
+    const volatile uint32_t *port_idr_[PORTX];
+    uint8_t                  port_[kMaxSwitches];
+    uint8_t                  pin_[kMaxSwitches];
+    float                    rising_edge_time_[kMaxSwitches];
+    size_t                   num_switches_;
+    size_t                   num_ports_;
+};
+
+} // namespace daisy
+#endif
@@ -3,6 +3,13 @@
 #include "usbd_desc.h"
 #include "usbd_cdc.h"
 #include "usbd_cdc_if.h"
+#include "usbd_uac.h"
+#include "usbd_msc.h"
+#include "util/ringbuffer.h"
+#include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
+#include <algorithm>
+#include <cstring>
 
 using namespace daisy;
 
@@ -29,6 +36,197 @@ extern "C"
 
 UsbHandle::ReceiveCallback rx_callback;
 
+/** The rings of the buffered transfers of a CDC port */
+class CdcPort
+{
+  public:
+    typedef uint8_t (*TransmitFunction)(uint8_t* buff, uint16_t size);
+    typedef uint8_t (*BusyFunction)(void);
+    typedef void (*RxFunction)(void);
+
+    CdcPort(TransmitFunction transmit,
+            BusyFunction     busy,
+            RxFunction       hold_rx,
+            RxFunction       release_rx)
+    : tx_callback_(nullptr),
+      transmit_(transmit),
+      busy_(busy),
+      hold_rx_(hold_rx),
+      release_rx_(release_rx),
+      tx_head_(0),
+      tx_tail_(0),
+      tx_in_flight_(0)
+    {
+        rx_ring_.Init();
+        ResetStats();
+    }
+
+    size_t Write(const uint8_t* buff, size_t size);
+    size_t GetTxSpace() const { return kTxRingSize - (tx_head_ - tx_tail_); }
+
+    /** Called from the USB interrupt when a transfer has completed */
+    void TransmitComplete();
+
+    /** Called from the USB interrupt with a received packet */
+    void Receive(uint8_t* buff, uint32_t size);
+
+    size_t Read(uint8_t* buff, size_t size);
+    size_t GetRxAvailable() const { return rx_ring_.readable(); }
+
+    /** Receives the next packet, if the ring held the reception */
+    void ReleaseRx()
+    {
+        ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
+        release_rx_();
+    }
+
+    UsbHandle::Stats GetStats() const { return stats_; }
+    void             ResetStats()
+    {
+        ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
+        stats_ = {};
+    }
+
+    /** the callback of the user, after each transfer */
+    UsbHandle::TransmitCallback tx_callback_;
+
+  private:
+    /** Starts a transfer of the queued bytes, up to the end of the ring,
+     *  unless one is in flight. Called with the USB interrupts masked.
+     */
+    void StartTransfer();
+
+    static constexpr size_t kTxRingSize = 4096;
+    static constexpr size_t kRxRingSize = 2048;
+
+    TransmitFunction transmit_;
+    BusyFunction     busy_;
+    RxFunction       hold_rx_;
+    RxFunction       release_rx_;
+
+    uint8_t         tx_ring_[kTxRingSize];
+    volatile size_t tx_head_;
+    volatile size_t tx_tail_;
+    volatile size_t tx_in_flight_;
+
+    RingBuffer<uint8_t, kRxRingSize> rx_ring_;
+
+    UsbHandle::Stats stats_;
+};
+
+size_t CdcPort::Write(const uint8_t* buff, size_t size)
+{
+    const size_t space = GetTxSpace();
+    if(size > space)
+    {
+        stats_.tx_dropped += size - space;
+        size = space;
+    }
+    // Only the bytes past the head are written, the transfer in flight
+    // sends those before the tail
+    const size_t start = tx_head_ % kTxRingSize;
+    const size_t first = std::min(size, kTxRingSize - start);
+    memcpy(&tx_ring_[start], buff, first);
+    memcpy(tx_ring_, buff + first, size - first);
+
+    ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
+    tx_head_ = tx_head_ + size;
+    StartTransfer();
+    return size;
+}
+
+void CdcPort::StartTransfer()
+{
+    if(tx_in_flight_ > 0)
+    {
+        if(busy_())
+            return;
+        // The device was reset or reconfigured, and the transfer was lost
+        tx_in_flight_ = 0;
+    }
+    const size_t queued = tx_head_ - tx_tail_;
+    if(queued == 0)
+        return;
+    const size_t start = tx_tail_ % kTxRingSize;
+    const size_t size  = std::min(queued, kTxRingSize - start);
+    if(transmit_(&tx_ring_[start], size) == USBD_OK)
+        tx_in_flight_ = size;
+}
+
+void CdcPort::TransmitComplete()
+{
+    if(tx_in_flight_ > 0)
+    {
+        tx_tail_ = tx_tail_ + tx_in_flight_;
+        stats_.tx_bytes += tx_in_flight_;
+        stats_.tx_transfers++;
+        tx_in_flight_ = 0;
+        StartTransfer();
+    }
+    if(tx_callback_)
+        tx_callback_();
+}
+
+void CdcPort::Receive(uint8_t* buff, uint32_t size)
+{
+    // The reception is held before the ring can't take a full packet
+    rx_ring_.Overwrite(buff, std::min<size_t>(size, rx_ring_.writable()));
+    stats_.rx_bytes += size;
+    if(rx_ring_.writable() < CDC_DATA_FS_MAX_PACKET_SIZE)
+    {
+        hold_rx_();
+        stats_.rx_holds++;
+    }
+}
+
+size_t CdcPort::Read(uint8_t* buff, size_t size)
+{
+    size = std::min(size, rx_ring_.readable());
+    rx_ring_.ImmediateRead(buff, size);
+    if(size > 0 && rx_ring_.writable() >= CDC_DATA_FS_MAX_PACKET_SIZE)
+        ReleaseRx();
+    return size;
+}
+
+static CdcPort cdc_port_fs(CDC_Transmit_FS,
+                           CDC_Tx_Busy_FS,
+                           CDC_Hold_Rx_FS,
+                           CDC_Release_Rx_FS);
+static CdcPort cdc_port_hs(CDC_Transmit_HS,
+                           CDC_Tx_Busy_HS,
+                           CDC_Hold_Rx_HS,
+                           CDC_Release_Rx_HS);
+
+static CdcPort* GetCdcPort(UsbHandle::UsbPeriph dev)
+{
+    switch(dev)
+    {
+        case UsbHandle::FS_INTERNAL: return &cdc_port_fs;
+        case UsbHandle::FS_EXTERNAL: return &cdc_port_hs;
+        default: return nullptr;
+    }
+}
+
+static void TransmitCompleteFS()
+{
+    cdc_port_fs.TransmitComplete();
+}
+
+static void TransmitCompleteHS()
+{
+    cdc_port_hs.TransmitComplete();
+}
+
+static void BufferedReceiveFS(uint8_t* buff, uint32_t* size)
+{
+    cdc_port_fs.Receive(buff, *size);
+}
+
+static void BufferedReceiveHS(uint8_t* buff, uint32_t* size)
+{
+    cdc_port_hs.Receive(buff, *size);
+}
+
 static void InitFS()
 {
     rx_callback = DummyRxCallback;
@@ -36,15 +234,33 @@ static void InitFS()
     {
         UsbErrorHandler();
     }
-    if(USBD_RegisterClass(&hUsbDeviceFS, &USBD_CDC) != USBD_OK)
+    if(usbd_mode == USBD_MODE_AUDIO)
     {
-        UsbErrorHandler();
+        if(USBD_RegisterClass(&hUsbDeviceFS, &USBD_UAC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
     }
-    if(USBD_CDC_RegisterInterface(&hUsbDeviceFS, &USBD_Interface_fops_FS)
-       != USBD_OK)
+    else if(usbd_mode == USBD_MODE_MSC)
     {
-        UsbErrorHandler();
+        if(USBD_RegisterClass(&hUsbDeviceFS, &USBD_MSC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
+    }
+    else
+    {
+        if(USBD_RegisterClass(&hUsbDeviceFS, &USBD_CDC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
+        if(USBD_CDC_RegisterInterface(&hUsbDeviceFS, &USBD_Interface_fops_FS)
+           != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
     }
+    CDC_Set_Tx_Callback_FS(TransmitCompleteFS);
     if(USBD_Start(&hUsbDeviceFS) != USBD_OK)
     {
         UsbErrorHandler();
@@ -66,15 +282,33 @@ static void InitHS()
     {
         UsbErrorHandler();
     }
-    if(USBD_RegisterClass(&hUsbDeviceHS, &USBD_CDC) != USBD_OK)
+    if(usbd_mode == USBD_MODE_AUDIO)
     {
-        UsbErrorHandler();
+        if(USBD_RegisterClass(&hUsbDeviceHS, &USBD_UAC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
     }
-    if(USBD_CDC_RegisterInterface(&hUsbDeviceHS, &USBD_Interface_fops_HS)
-       != USBD_OK)
+    else if(usbd_mode == USBD_MODE_MSC)
     {
-        UsbErrorHandler();
+        if(USBD_RegisterClass(&hUsbDeviceHS, &USBD_MSC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
+    }
+    else
+    {
+        if(USBD_RegisterClass(&hUsbDeviceHS, &USBD_CDC) != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
+        if(USBD_CDC_RegisterInterface(&hUsbDeviceHS, &USBD_Interface_fops_HS)
+           != USBD_OK)
+        {
+            UsbErrorHandler();
+        }
     }
+    CDC_Set_Tx_Callback_HS(TransmitCompleteHS);
     if(USBD_Start(&hUsbDeviceHS) != USBD_OK)
     {
         UsbErrorHandler();
@@ -147,6 +381,73 @@ void UsbHandle::SetReceiveCallback(ReceiveCallback cb, UsbPeriph dev)
             break;
         default: break;
     }
+    // in case a full receive ring held the reception
+    if(dev != FS_EXTERNAL)
+        cdc_port_fs.ReleaseRx();
+    if(dev != FS_INTERNAL)
+        cdc_port_hs.ReleaseRx();
+}
+
+void UsbHandle::SetTransmitCallback(TransmitCallback cb, UsbPeriph dev)
+{
+    // Called by the ports after their own transfers are handled
+    switch(dev)
+    {
+        case FS_INTERNAL: cdc_port_fs.tx_callback_ = cb; break;
+        case FS_EXTERNAL: cdc_port_hs.tx_callback_ = cb; break;
+        case FS_BOTH:
+            cdc_port_fs.tx_callback_ = cb;
+            cdc_port_hs.tx_callback_ = cb;
+            break;
+        default: break;
+    }
+}
+
+size_t UsbHandle::Write(const uint8_t* buff, size_t size, UsbPeriph dev)
+{
+    CdcPort* port = GetCdcPort(dev);
+    return port ? port->Write(buff, size) : 0;
+}
+
+size_t UsbHandle::GetTxSpace(UsbPeriph dev) const
+{
+    CdcPort* port = GetCdcPort(dev);
+    return port ? port->GetTxSpace() : 0;
+}
+
+void UsbHandle::StartBufferedRx(UsbPeriph dev)
+{
+    switch(dev)
+    {
+        case FS_INTERNAL: CDC_Set_Rx_Callback_FS(BufferedReceiveFS); break;
+        case FS_EXTERNAL: CDC_Set_Rx_Callback_HS(BufferedReceiveHS); break;
+        default: break;
+    }
+}
+
+size_t UsbHandle::Read(uint8_t* buff, size_t size, UsbPeriph dev)
+{
+    CdcPort* port = GetCdcPort(dev);
+    return port ? port->Read(buff, size) : 0;
+}
+
+size_t UsbHandle::GetRxAvailable(UsbPeriph dev) const
+{
+    CdcPort* port = GetCdcPort(dev);
+    return port ? port->GetRxAvailable() : 0;
+}
+
+UsbHandle::Stats UsbHandle::GetStats(UsbPeriph dev) const
+{
+    CdcPort* port = GetCdcPort(dev);
+    return port ? port->GetStats() : Stats{};
+}
+
+void UsbHandle::ResetStats(UsbPeriph dev)
+{
+    CdcPort* port = GetCdcPort(dev);
+    if(port)
+        port->ResetStats();
 }
 
 // Static Function Implementation
@@ -162,13 +463,19 @@ extern "C"
 
     void OTG_FS_EP1_OUT_IRQHandler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_FS);
         HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
     }
 
     void OTG_FS_EP1_IN_IRQHandler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_FS);
         HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
     }
 
-    void OTG_FS_IRQHandler(void) { HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS); }
+    void OTG_FS_IRQHandler(void)
+    {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_FS);
+        HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
+    }
 }
@@ -37,6 +37,25 @@ class UsbHandle
     /** Function called upon reception of a buffer */
     typedef void (*ReceiveCallback)(uint8_t* buff, uint32_t* len);
 
+    /** Function called from the USB interrupt when a transmission has
+     *  completed, and the next one can be started
+     */
+    typedef void (*TransmitCallback)();
+
+    /** Counters of the buffered transfers of a port, see Write() and
+     *  Read(). Divided by the time between two readings they give the
+     *  throughput.
+     */
+    struct Stats
+    {
+        uint32_t tx_bytes;     /**< bytes sent to the host */
+        uint32_t tx_transfers; /**< transfers that completed */
+        uint32_t tx_dropped;   /**< bytes that didn't fit in the ring */
+        uint32_t rx_bytes;     /**< bytes received into the ring */
+        uint32_t rx_holds;     /**< times the ring was full, and the host
+                                    had to wait */
+    };
+
     UsbHandle() {}
 
     ~UsbHandle() {}
@@ -69,6 +88,52 @@ class UsbHandle
      */
     void SetReceiveCallback(ReceiveCallback cb, UsbPeriph dev);
 
+    /** sets the callback to be called when a transmission has completed
+    \param cb Function to serve as callback, or nullptr for none
+    \param dev Device to set callback for
+     */
+    void SetTransmitCallback(TransmitCallback cb, UsbPeriph dev);
+
+    /** Queues bytes for the host in the transmit ring of a port. The ring
+     *  is sent in transfers of the queued bytes: while one is in flight,
+     *  the next one fills up, and starts as soon as it has completed, so
+     *  bulk data runs at the bandwidth of the bus. Doesn't mix with
+     *  TransmitInternal() and TransmitExternal() on the same port.
+     *  \param buff bytes to send
+     *  \param size number of bytes
+     *  \param dev FS_INTERNAL or FS_EXTERNAL
+     *  \return the number of bytes queued, fewer when the ring is full
+     */
+    size_t Write(const uint8_t* buff, size_t size, UsbPeriph dev = FS_INTERNAL);
+
+    /** \return the bytes that fit in the transmit ring of a port */
+    size_t GetTxSpace(UsbPeriph dev = FS_INTERNAL) const;
+
+    /** Queues the received bytes of a port in its receive ring for Read(),
+     *  instead of passing them to the receive callback. When the ring is
+     *  full the host waits, so nothing is lost. SetReceiveCallback() goes
+     *  back to the callback.
+     *  \param dev FS_INTERNAL or FS_EXTERNAL
+     */
+    void StartBufferedRx(UsbPeriph dev = FS_INTERNAL);
+
+    /** Reads received bytes from the receive ring of a port
+     *  \param buff destination
+     *  \param size maximum number of bytes
+     *  \param dev FS_INTERNAL or FS_EXTERNAL
+     *  \return number of bytes read
+     */
+    size_t Read(uint8_t* buff, size_t size, UsbPeriph dev = FS_INTERNAL);
+
+    /** \return the bytes in the receive ring of a port */
+    size_t GetRxAvailable(UsbPeriph dev = FS_INTERNAL) const;
+
+    /** \return the transfer counters of a port */
+    Stats GetStats(UsbPeriph dev = FS_INTERNAL) const;
+
+    /** Sets the transfer counters of a port to 0 */
+    void ResetStats(UsbPeriph dev = FS_INTERNAL);
+
   private:
 };
 
@@ -0,0 +1,109 @@
+#include "hid/usb_audio.h"
+#include "hid/usb.h"
+#include "daisy_core.h"
+#include "usbd_cdc.h"
+#include "usbd_uac.h"
+
+using namespace daisy;
+
+class UsbAudio::Impl
+{
+  public:
+    void Init(Config config);
+    void Write(const float* const* in, size_t size);
+    void Read(float** out, size_t size);
+
+  private:
+    UsbHandle usb_handle_;
+};
+
+// Global Impl
+static UsbAudio::Impl usb_audio_handle;
+
+void UsbAudio::Impl::Init(Config config)
+{
+    // This tells the USB middleware to register the audio class instead of
+    // CDC
+    usbd_mode = USBD_MODE_AUDIO;
+    usb_handle_.Init(config.periph == Config::EXTERNAL
+                         ? UsbHandle::FS_EXTERNAL
+                         : UsbHandle::FS_INTERNAL);
+}
+
+void UsbAudio::Impl::Write(const float* const* in, size_t size)
+{
+    // Written in place, the ring may return its space in two parts
+    size_t done = 0;
+    while(done < size)
+    {
+        uint32_t frames;
+        int16_t* dst = USBD_UAC_BeginInWrite(&frames);
+        if(frames == 0)
+            return;
+        if(frames > size - done)
+            frames = size - done;
+        for(uint32_t i = 0; i < frames; i++)
+        {
+            dst[2 * i]     = f2s16(in[0][done + i]);
+            dst[2 * i + 1] = f2s16(in[1][done + i]);
+        }
+        USBD_UAC_EndInWrite(frames);
+        done += frames;
+    }
+}
+
+void UsbAudio::Impl::Read(float** out, size_t size)
+{
+    size_t done = 0;
+    while(done < size)
+    {
+        uint32_t       frames;
+        const int16_t* src = USBD_UAC_BeginOutRead(&frames);
+        if(frames == 0)
+            break;
+        if(frames > size - done)
+            frames = size - done;
+        for(uint32_t i = 0; i < frames; i++)
+        {
+            out[0][done + i] = s162f(src[2 * i]);
+            out[1][done + i] = s162f(src[2 * i + 1]);
+        }
+        USBD_UAC_EndOutRead(frames);
+        done += frames;
+    }
+    for(; done < size; done++)
+    {
+        out[0][done] = 0.f;
+        out[1][done] = 0.f;
+    }
+}
+
+////////////////////////////////////////////////
+// UsbAudio -> UsbAudio::Impl
+////////////////////////////////////////////////
+
+void UsbAudio::Init(UsbAudio::Config config)
+{
+    pimpl_ = &usb_audio_handle;
+    pimpl_->Init(config);
+}
+
+void UsbAudio::Write(const float* const* in, size_t size)
+{
+    pimpl_->Write(in, size);
+}
+
+void UsbAudio::Read(float** out, size_t size)
+{
+    pimpl_->Read(out, size);
+}
+
+bool UsbAudio::IsPlaying() const
+{
+    return USBD_UAC_IsOutActive();
+}
+
+bool UsbAudio::IsRecording() const
+{
+    return USBD_UAC_IsInActive();
+}
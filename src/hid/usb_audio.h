@@ -0,0 +1,89 @@
+#pragma once
+#ifndef __DSY_USBAUDIO_H__
+#define __DSY_USBAUDIO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisy
+{
+/** @brief USB Audio Class device, streaming stereo audio to and from a host
+ *  @ingroup audio
+ *  @details The device shows up as a 48 kHz, 16 bit stereo sound card with
+ *           a speaker (the host plays to the Daisy) and a microphone (the
+ *           host records from the Daisy). The AudioHandle must run at
+ *           48 kHz: the codec clock is the master, the host follows it
+ *           with the asynchronous feedback of the USB audio class, so no
+ *           samples are dropped or repeated over time.
+ *
+ *           Both directions go through a ring of 512 frames kept half
+ *           full, which the USB endpoints transfer to and from in place.
+ *           Read() and Write() convert between the rings and the float
+ *           buffers of the audio callback, and are called from it.
+ *
+ *           The device replaces the CDC (serial) device on its USB
+ *           peripheral, so the logger and MidiUsbTransport can't share it.
+ *
+ *           \code
+ *           void AudioCallback(AudioHandle::InputBuffer  in,
+ *                              AudioHandle::OutputBuffer out,
+ *                              size_t                    size)
+ *           {
+ *               usb_audio.Write(in, size);  // codec input to the host
+ *               usb_audio.Read(out, size);  // host playback to the codec
+ *           }
+ *           \endcode
+ */
+class UsbAudio
+{
+  public:
+    struct Config
+    {
+        enum Periph
+        {
+            INTERNAL = 0,
+            EXTERNAL
+        };
+
+        Periph periph;
+
+        Config() : periph(INTERNAL) {}
+    };
+
+    /** Starts the USB device */
+    void Init(Config config);
+
+    /** Converts the first two channels of a block for the host. Frames
+     *  are dropped when the host doesn't record, and the ring is full.
+     *  \param in non-interleaved buffers, e.g. AudioHandle::InputBuffer
+     *  \param size frames per channel
+     */
+    void Write(const float* const* in, size_t size);
+
+    /** Converts a block from the host to the first two channels, with
+     *  silence while the host doesn't play, or the stream underruns.
+     *  \param out non-interleaved buffers, e.g. AudioHandle::OutputBuffer
+     *  \param size frames per channel
+     */
+    void Read(float** out, size_t size);
+
+    /** True while the host plays to the device */
+    bool IsPlaying() const;
+
+    /** True while the host records from the device */
+    bool IsRecording() const;
+
+    class Impl;
+
+    UsbAudio() : pimpl_(nullptr) {}
+    ~UsbAudio() {}
+    UsbAudio(const UsbAudio& other) = default;
+    UsbAudio& operator=(const UsbAudio& other) = default;
+
+  private:
+    Impl* pimpl_;
+};
+
+} // namespace daisy
+
+#endif // __DSY_USBAUDIO_H__
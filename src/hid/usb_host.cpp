@@ -3,6 +3,7 @@
 #include "daisy_core.h"
 #include "usbh_core.h"
 #include "usbh_msc.h"
+#include "usbh_midi.h"
 
 using namespace daisy;
 
@@ -26,6 +27,7 @@ class USBHostHandle::Impl
     Result ReEnumerate();
 
     bool GetReady();
+    bool GetMidiReady();
 
     inline Config &GetConfig() { return config_; }
 
@@ -72,6 +74,11 @@ USBHostHandle::Result USBHostHandle::Impl::Init(USBHostHandle::Config config)
     {
         return ConvertStatus(sta);
     }
+    sta = USBH_RegisterClass(&hUsbHostHS, USBH_MIDI_CLASS);
+    if(sta != USBH_OK)
+    {
+        return ConvertStatus(sta);
+    }
     sta = USBH_Start(&hUsbHostHS);
     if(sta != USBH_OK)
     {
@@ -99,9 +106,17 @@ USBHostHandle::Result USBHostHandle::Impl::ReEnumerate()
 
 bool USBHostHandle::Impl::GetReady()
 {
+    // the MSC functions take the class data of the active class as theirs
+    if(hUsbHostHS.pActiveClass != USBH_MSC_CLASS)
+        return false;
     return (bool)USBH_MSC_IsReady(&hUsbHostHS);
 }
 
+bool USBHostHandle::Impl::GetMidiReady()
+{
+    return (bool)USBH_MIDI_IsReady(&hUsbHostHS);
+}
+
 // MSDHandle -> Impl
 
 USBHostHandle::Result USBHostHandle::Init(Config config)
@@ -120,6 +135,11 @@ bool USBHostHandle::GetReady()
     return pimpl_->GetReady();
 }
 
+bool USBHostHandle::GetMidiReady()
+{
+    return pimpl_->GetMidiReady();
+}
+
 USBHostHandle::Result USBHostHandle::Process()
 {
     return pimpl_->Process();
@@ -20,7 +20,11 @@ typedef enum
    @author Gabriel Ball
    @date September 16, 2021
 
-   @brief Presents a USB Mass Storage Device host interface
+   @brief Presents a USB host interface for Mass Storage and MIDI devices
+
+   The class of the connected device is selected on enumeration. Process()
+   runs the transfers of both classes, so it should be called often in the
+   main loop, especially for MIDI, whose packets are handled in it.
 */
 class USBHostHandle
 {
@@ -109,6 +113,11 @@ class USBHostHandle
      */
     bool GetReady();
 
+    /** Returns true if a USB MIDI device is connected and ready, see
+     *  MidiUsbHostTransport
+     */
+    bool GetMidiReady();
+
     /** Run after the first `Process` call to detect if
      *  a device is present
      * 
@@ -0,0 +1,214 @@
+#include "hid/usb_host_midi.h"
+#include "usbh_midi.h"
+
+using namespace daisy;
+
+extern "C"
+{
+    extern USBH_HandleTypeDef hUsbHostHS;
+}
+
+class MidiUsbHostTransport::Impl
+{
+  public:
+    void Init(Config config);
+
+    void StartRx(MidiRxParseCallback callback, void* context)
+    {
+        parse_callback_ = callback;
+        parse_context_  = context;
+        rx_active_      = true;
+    }
+
+    bool RxActive() { return rx_active_; }
+    void FlushRx() {}
+    void Tx(uint8_t* buffer, size_t size);
+
+    /** Parses the event packets of a received transfer */
+    void Receive(uint8_t* packets, size_t length);
+
+  private:
+    /** Adds a packet to the ones for the device, and sends them when full */
+    void WritePacket(uint8_t code_index,
+                     uint8_t byte0,
+                     uint8_t byte1,
+                     uint8_t byte2);
+    void Flush();
+
+    static constexpr size_t kPacketSize = 4;
+
+    Config              config_;
+    bool                rx_active_;
+    MidiRxParseCallback parse_callback_;
+    void*               parse_context_;
+
+    uint8_t tx_packets_[USBH_MIDI_TX_BUF_SIZE];
+    size_t  tx_size_;
+
+    // MIDI message size determined by the
+    // code index number. You can find this
+    // table in the MIDI USB spec 1.0
+    const uint8_t code_index_size_[16]
+        = {0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1};
+};
+
+// Global Impl
+static MidiUsbHostTransport::Impl midi_usb_host_handle;
+
+static void HostReceiveCallback(uint8_t* buff, size_t len, void* pUser)
+{
+    static_cast<MidiUsbHostTransport::Impl*>(pUser)->Receive(buff, len);
+}
+
+void MidiUsbHostTransport::Impl::Init(Config config)
+{
+    config_         = config;
+    rx_active_      = false;
+    parse_callback_ = nullptr;
+    parse_context_  = nullptr;
+    tx_size_        = 0;
+    USBH_MIDI_SetReceiveCallback(&hUsbHostHS, HostReceiveCallback, this);
+}
+
+void MidiUsbHostTransport::Impl::Receive(uint8_t* packets, size_t length)
+{
+    if(!rx_active_ || parse_callback_ == nullptr)
+        return;
+
+    // At most 3 bytes for each packet
+    uint8_t bytes[USBH_MIDI_RX_BUF_SIZE];
+    size_t  size = 0;
+    for(size_t i = 0; i + kPacketSize <= length; i += kPacketSize)
+    {
+        const uint8_t* packet = packets + i;
+        if((packet[0] >> 4) != config_.cable)
+            continue;
+        // 0x0 and 0x1 are reserved, and skipped with a size of 0
+        const uint8_t code_index = packet[0] & 0xF;
+        for(uint8_t j = 0; j < code_index_size_[code_index]; j++)
+            bytes[size++] = packet[1 + j];
+    }
+    if(size > 0)
+        parse_callback_(bytes, size, parse_context_);
+}
+
+void MidiUsbHostTransport::Impl::Tx(uint8_t* buffer, size_t size)
+{
+    size_t i = 0;
+    while(i < size)
+    {
+        const uint8_t status = buffer[i];
+        if(status < 0x80)
+        {
+            // We'll assume your messages start with a status byte!
+            i++;
+            continue;
+        }
+
+        if(status == 0xF0)
+        {
+            // Sysex messages are split up into several 4 bytes packets,
+            // the one with the stop byte, or the last one, uses CIN 0x5 to
+            // 0x7 for 1 to 3 bytes
+            size_t end = i + 1;
+            while(end < size && buffer[end] != 0xF7)
+                end++;
+            if(end < size)
+                end++;
+            for(; i + 3 < end; i += 3)
+                WritePacket(0x4, buffer[i], buffer[i + 1], buffer[i + 2]);
+            const size_t remaining = end - i;
+            WritePacket(0x4 + remaining,
+                        buffer[i],
+                        remaining > 1 ? buffer[i + 1] : 0,
+                        remaining > 2 ? buffer[i + 2] : 0);
+            i = end;
+            continue;
+        }
+
+        size_t  message_size;
+        uint8_t code_index;
+        if(status < 0xF0)
+        {
+            // CIN is the same as status byte for channel voice messages
+            code_index   = status >> 4;
+            message_size = (code_index == 0xC || code_index == 0xD) ? 2 : 3;
+        }
+        else if(status == 0xF2)
+        {
+            code_index   = 0x3;
+            message_size = 3;
+        }
+        else if(status == 0xF1 || status == 0xF3)
+        {
+            code_index   = 0x2;
+            message_size = 2;
+        }
+        else
+        {
+            // single byte system common, and real time messages
+            code_index   = status < 0xF8 ? 0x5 : 0xF;
+            message_size = 1;
+        }
+        if(i + message_size > size)
+            break; // incomplete
+        WritePacket(code_index,
+                    status,
+                    message_size > 1 ? buffer[i + 1] : 0,
+                    message_size > 2 ? buffer[i + 2] : 0);
+        i += message_size;
+    }
+    Flush();
+}
+
+void MidiUsbHostTransport::Impl::WritePacket(uint8_t code_index,
+                                             uint8_t byte0,
+                                             uint8_t byte1,
+                                             uint8_t byte2)
+{
+    if(tx_size_ + kPacketSize > sizeof(tx_packets_))
+        Flush();
+    uint8_t* packet = tx_packets_ + tx_size_;
+    packet[0]       = uint8_t(config_.cable << 4) | code_index;
+    packet[1]       = byte0;
+    packet[2]       = byte1;
+    packet[3]       = byte2;
+    tx_size_ += kPacketSize;
+}
+
+void MidiUsbHostTransport::Impl::Flush()
+{
+    if(tx_size_ > 0)
+        USBH_MIDI_Transmit(&hUsbHostHS, tx_packets_, tx_size_);
+    tx_size_ = 0;
+}
+
+////////////////////////////////////////////////
+// MidiUsbHostTransport -> MidiUsbHostTransport::Impl
+////////////////////////////////////////////////
+
+void MidiUsbHostTransport::Init(MidiUsbHostTransport::Config config)
+{
+    pimpl_ = &midi_usb_host_handle;
+    pimpl_->Init(config);
+}
+
+void MidiUsbHostTransport::StartRx(MidiRxParseCallback callback, void* context)
+{
+    pimpl_->StartRx(callback, context);
+}
+
+bool MidiUsbHostTransport::RxActive()
+{
+    return pimpl_->RxActive();
+}
+
+void MidiUsbHostTransport::FlushRx()
+{
+    pimpl_->FlushRx();
+}
+
+void MidiUsbHostTransport::Tx(uint8_t* buffer, size_t size)
+{
+    pimpl_->Tx(buffer, size);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef __DSY_MIDIUSBHOSTTRANSPORT_H__
+#define __DSY_MIDIUSBHOSTTRANSPORT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisy
+{
+/** @brief USB Host Transport for MIDI, for USB MIDI devices such as
+ *         controllers plugged into the USB host port
+ *  @ingroup midi
+ *  @details The USBHostHandle runs the USB host, and must be initialized
+ *           and its Process() called often in the main loop: the device's
+ *           bulk IN packets are received there, in turns into two buffers,
+ *           and each transfer is passed to the parser while the next one
+ *           is already under way. Tx() queues the messages, they are sent
+ *           by Process() too. Both should be used from the main loop.
+ *
+ *           \code
+ *           USBHostHandle::Config usb_config;
+ *           usb_host.Init(usb_config);
+ *           MidiUsbHostHandler::Config midi_config;
+ *           midi.Init(midi_config);
+ *           midi.StartReceive();
+ *           while(1)
+ *           {
+ *               usb_host.Process();
+ *               while(midi.HasEvents())
+ *                   HandleEvent(midi.PopEvent());
+ *           }
+ *           \endcode
+ */
+class MidiUsbHostTransport
+{
+  public:
+    typedef void (*MidiRxParseCallback)(uint8_t* data,
+                                        size_t   size,
+                                        void*    context);
+
+    struct Config
+    {
+        /** The virtual cable of the messages, the device's packets on other
+         *  cables are ignored
+         */
+        uint8_t cable;
+
+        Config() : cable(0) {}
+    };
+
+    void Init(Config config);
+
+    void StartRx(MidiRxParseCallback callback, void* context);
+    bool RxActive();
+    void FlushRx();
+
+    /** Queues the messages for the device. They are dropped when no
+     *  device is ready, or the queue is full.
+     */
+    void Tx(uint8_t* buffer, size_t size);
+
+    class Impl;
+
+    MidiUsbHostTransport() : pimpl_(nullptr) {}
+    ~MidiUsbHostTransport() {}
+    MidiUsbHostTransport(const MidiUsbHostTransport& other) = default;
+    MidiUsbHostTransport& operator=(const MidiUsbHostTransport& other)
+        = default;
+
+  private:
+    Impl* pimpl_;
+};
+
+} // namespace daisy
+
+#endif // __DSY_MIDIUSBHOSTTRANSPORT_H__
@@ -1,6 +1,7 @@
 #include "system.h"
 #include "usbd_cdc.h"
 #include "hid/usb_midi.h"
+#include "util/scopedirqblocker.h"
 #include <cassert>
 
 using namespace daisy;
@@ -10,39 +11,69 @@ class MidiUsbTransport::Impl
   public:
     void Init(Config config);
 
-    void StartRx(MidiRxParseCallback callback, void* context)
+    void StartRx(uint8_t cable, MidiRxParseCallback callback, void* context)
     {
-        rx_active_      = true;
-        parse_callback_ = callback;
-        parse_context_  = context;
+        rx_active_             = true;
+        parse_callback_[cable] = callback;
+        parse_context_[cable]  = context;
     }
 
     bool RxActive() { return rx_active_; }
     void FlushRx() { rx_buffer_.Flush(); }
-    void Tx(uint8_t* buffer, size_t size);
+    void Tx(uint8_t cable, uint8_t* buffer, size_t size);
 
-    void UsbToMidi(uint8_t* buffer, uint8_t length);
-    void MidiToUsb(uint8_t* buffer, size_t length);
-    void Parse();
+    /** Parses the packets of a received transfer */
+    void Receive(uint8_t* buffer, size_t length);
+
+    /** Starts a transfer of the queued packets, unless one is in flight */
+    void StartTransfer();
+
+    /** the cables in the USB descriptors */
+    static constexpr uint8_t kNumCables = USBD_MIDI_NUM_CABLES;
 
   private:
-    void MidiToUsbSingle(uint8_t* buffer, size_t length);
+    void UsbToMidi(uint8_t* buffer, uint8_t length);
+    void MidiToUsb(uint8_t cable, uint8_t* buffer, size_t length);
+    void MidiToUsbSingle(uint8_t cable, uint8_t* buffer, size_t length);
+    void Parse(uint8_t cable);
+
+    /** Queues a USB MIDI event packet, waiting for space if it's full.
+     *  \return false if the packet was dropped
+     */
+    bool QueuePacket(uint8_t cable,
+                     uint8_t code_index,
+                     uint8_t byte0,
+                     uint8_t byte1,
+                     uint8_t byte2);
 
     /** USB Handle for CDC transfers
          */
     UsbHandle usb_handle_;
     Config    config_;
+    bool      usb_initialized_ = false;
 
     static constexpr size_t kBufferSize = 1024;
-    bool                    rx_active_;
+    static constexpr size_t kPacketSize = 4;
+    // 15 packets, so that a transfer is always a single short USB packet,
+    // a full 64 byte one would be followed by a zero length packet
+    static constexpr size_t kTransferSize = 60;
+
+    volatile bool rx_active_;
     // This corresponds to 256 midi messages
     RingBuffer<uint8_t, kBufferSize> rx_buffer_;
-    MidiRxParseCallback              parse_callback_;
-    void*                            parse_context_;
+    MidiRxParseCallback              parse_callback_[kNumCables];
+    void*                            parse_context_[kNumCables];
 
-    // simple, self-managed buffer
-    uint8_t tx_buffer_[kBufferSize];
-    size_t  tx_ptr_;
+    // queue of event packets, the free running counts of the bytes
+    // queued and sent. Accessed with the USB interrupt masked.
+    uint8_t         tx_queue_[kBufferSize];
+    volatile size_t tx_queued_;
+    volatile size_t tx_sent_;
+
+    // the USB driver sends from the buffer without copying it, so the next
+    // transfer is prepared in the other one
+    uint8_t tx_transfers_[2][kTransferSize];
+    uint8_t tx_next_transfer_;
 
     // MIDI message size determined by the
     // code index number. You can find this
@@ -69,15 +100,12 @@ static MidiUsbTransport::Impl midi_usb_handle;
 void ReceiveCallback(uint8_t* buffer, uint32_t* length)
 {
     if(midi_usb_handle.RxActive())
-    {
-        for(uint16_t i = 0; i < *length; i += 4)
-        {
-            size_t  remaining_bytes = *length - i;
-            uint8_t packet_length   = remaining_bytes > 4 ? 4 : remaining_bytes;
-            midi_usb_handle.UsbToMidi(buffer + i, packet_length);
-            midi_usb_handle.Parse();
-        }
-    }
+        midi_usb_handle.Receive(buffer, *length);
+}
+
+void TransmitCallback()
+{
+    midi_usb_handle.StartTransfer();
 }
 
 void MidiUsbTransport::Impl::Init(Config config)
@@ -90,40 +118,114 @@ void MidiUsbTransport::Impl::Init(Config config)
 
     // This tells the USB middleware to send out MIDI descriptors instead of CDC
     usbd_mode = USBD_MODE_MIDI;
-    config_   = config;
+
+    // The transports of the other cables share the peripheral
+    if(usb_initialized_)
+    {
+        config_.tx_retry_count = config.tx_retry_count;
+        return;
+    }
+    config_ = config;
 
     UsbHandle::UsbPeriph periph = UsbHandle::FS_INTERNAL;
     if(config_.periph == Config::EXTERNAL)
         periph = UsbHandle::FS_EXTERNAL;
 
+    for(uint8_t i = 0; i < kNumCables; i++)
+    {
+        parse_callback_[i] = nullptr;
+        parse_context_[i]  = nullptr;
+    }
+    rx_active_        = false;
+    tx_queued_        = 0;
+    tx_sent_          = 0;
+    tx_next_transfer_ = 0;
     usb_handle_.Init(periph);
+    usb_initialized_ = true;
 
-    rx_active_ = false;
     System::Delay(10);
+    usb_handle_.SetTransmitCallback(TransmitCallback, periph);
     usb_handle_.SetReceiveCallback(ReceiveCallback, periph);
 }
 
-void MidiUsbTransport::Impl::Tx(uint8_t* buffer, size_t size)
+void MidiUsbTransport::Impl::Tx(uint8_t cable, uint8_t* buffer, size_t size)
 {
-    UsbHandle::Result result;
-    int               attempt_count = config_.tx_retry_count;
-    bool              should_retry;
+    MidiToUsb(cable, buffer, size);
+    StartTransfer();
+}
 
-    MidiToUsb(buffer, size);
-    do
+bool MidiUsbTransport::Impl::QueuePacket(uint8_t cable,
+                                         uint8_t code_index,
+                                         uint8_t byte0,
+                                         uint8_t byte1,
+                                         uint8_t byte2)
+{
+    int attempt_count = config_.tx_retry_count;
+    while(true)
     {
-        if(config_.periph == Config::EXTERNAL)
-            result = usb_handle_.TransmitExternal(tx_buffer_, tx_ptr_);
-        else
-            result = usb_handle_.TransmitInternal(tx_buffer_, tx_ptr_);
+        {
+            ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
+            if(tx_queued_ - tx_sent_ < kBufferSize)
+            {
+                uint8_t* packet = tx_queue_ + tx_queued_ % kBufferSize;
+                packet[0]       = (cable << 4) | code_index;
+                packet[1]       = byte0;
+                packet[2]       = byte1;
+                packet[3]       = byte2;
+                tx_queued_      = tx_queued_ + kPacketSize;
+                return true;
+            }
+        }
+        if(attempt_count-- <= 0)
+            return false;
+        // the queue is full, e.g. the messages are queued from an
+        // interrupt that masks the transfer complete callback
+        StartTransfer();
+        System::DelayUs(100);
+    }
+}
 
-        should_retry = (result == UsbHandle::Result::ERR) && attempt_count--;
+void MidiUsbTransport::Impl::StartTransfer()
+{
+    ScopedIrqPriorityBlocker block(DSY_IRQ_PRIORITY_USB);
 
-        if(should_retry)
-            System::DelayUs(100);
-    } while(should_retry);
+    const size_t queued = tx_queued_ - tx_sent_;
+    if(queued == 0)
+        return;
+    const size_t size     = queued < kTransferSize ? queued : kTransferSize;
+    uint8_t*     transfer = tx_transfers_[tx_next_transfer_];
+    for(size_t i = 0; i < size; i++)
+        transfer[i] = tx_queue_[(tx_sent_ + i) % kBufferSize];
 
-    tx_ptr_ = 0;
+    // fails while the previous transfer is in flight, its transfer
+    // complete callback starts this one then
+    UsbHandle::Result result;
+    if(config_.periph == Config::EXTERNAL)
+        result = usb_handle_.TransmitExternal(transfer, size);
+    else
+        result = usb_handle_.TransmitInternal(transfer, size);
+    if(result == UsbHandle::Result::OK)
+    {
+        tx_sent_          = tx_sent_ + size;
+        tx_next_transfer_ = 1 - tx_next_transfer_;
+    }
+}
+
+void MidiUsbTransport::Impl::Receive(uint8_t* buffer, size_t length)
+{
+    // The consecutive packets of a cable are parsed in one go
+    uint8_t cable = 0;
+    for(size_t i = 0; i + kPacketSize <= length; i += kPacketSize)
+    {
+        const uint8_t packet_cable = buffer[i] >> 4;
+        if(packet_cable != cable)
+        {
+            Parse(cable);
+            cable = packet_cable;
+        }
+        UsbToMidi(buffer + i, kPacketSize);
+    }
+    Parse(cable);
 }
 
 void MidiUsbTransport::Impl::UsbToMidi(uint8_t* buffer, uint8_t length)
@@ -134,8 +236,7 @@ void MidiUsbTransport::Impl::UsbToMidi(uint8_t* buffer, uint8_t length)
     if(length < 4)
         return;
 
-    // Right now, Daisy only supports a single cable, so we don't
-    // need to extract that value from the upper nibble
+    // The cable in the upper nibble is handled in Receive()
     uint8_t code_index = buffer[0] & 0xF;
     if(code_index == 0x0 || code_index == 0x1)
     {
@@ -160,7 +261,9 @@ void MidiUsbTransport::Impl::UsbToMidi(uint8_t* buffer, uint8_t length)
     }
 }
 
-void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t* buffer, size_t size)
+void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t  cable,
+                                             uint8_t* buffer,
+                                             size_t   size)
 {
     if(size == 0)
         return;
@@ -181,12 +284,11 @@ void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t* buffer, size_t size)
         }
 
         // CIN is the same as status byte for channel voice messages
-        tx_buffer_[tx_ptr_ + 0] = (buffer[0] & 0xF0) >> 4;
-        tx_buffer_[tx_ptr_ + 1] = buffer[0];
-        tx_buffer_[tx_ptr_ + 2] = buffer[1];
-        tx_buffer_[tx_ptr_ + 3] = size == 3 ? buffer[2] : 0;
-
-        tx_ptr_ += 4;
+        QueuePacket(cable,
+                    (buffer[0] & 0xF0) >> 4,
+                    buffer[0],
+                    buffer[1],
+                    size == 3 ? buffer[2] : 0);
     }
     else // buffer[0] & 0xF0 == 0xF0 aka System common or realtime
     {
@@ -196,25 +298,15 @@ void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t* buffer, size_t size)
             if(size != 3)
                 return; // error
 
-            tx_buffer_[tx_ptr_ + 0] = 0x03;
-            tx_buffer_[tx_ptr_ + 1] = buffer[0];
-            tx_buffer_[tx_ptr_ + 2] = buffer[1];
-            tx_buffer_[tx_ptr_ + 3] = buffer[2];
-
-            tx_ptr_ += 4;
+            QueuePacket(cable, 0x03, buffer[0], buffer[1], buffer[2]);
         }
-        if(0xF1 == buffer[0] || 0xF3 == buffer[0])
+        else if(0xF1 == buffer[0] || 0xF3 == buffer[0])
         // two byte messages
         {
             if(size != 2)
                 return; // error
 
-            tx_buffer_[tx_ptr_ + 0] = 0x02;
-            tx_buffer_[tx_ptr_ + 1] = buffer[0];
-            tx_buffer_[tx_ptr_ + 2] = buffer[1];
-            tx_buffer_[tx_ptr_ + 3] = 0;
-
-            tx_ptr_ += 4;
+            QueuePacket(cable, 0x02, buffer[0], buffer[1], 0);
         }
         else if(0xF4 <= buffer[0])
         // one byte message
@@ -222,12 +314,7 @@ void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t* buffer, size_t size)
             if(size != 1)
                 return; // error
 
-            tx_buffer_[tx_ptr_ + 0] = 0x05;
-            tx_buffer_[tx_ptr_ + 1] = buffer[0];
-            tx_buffer_[tx_ptr_ + 2] = 0;
-            tx_buffer_[tx_ptr_ + 3] = 0;
-
-            tx_ptr_ += 4;
+            QueuePacket(cable, 0x05, buffer[0], 0, 0);
         }
         else // sysex
         {
@@ -235,29 +322,29 @@ void MidiUsbTransport::Impl::MidiToUsbSingle(uint8_t* buffer, size_t size)
             // Sysex messages are split up into several 4 bytes packets
             // first ones use CIN 0x04
             // but packet containing the SysEx stop byte use a different CIN
-            for(i = 0; i + 3 < size; i += 3, tx_ptr_ += 4)
+            for(i = 0; i + 3 < size; i += 3)
             {
-                tx_buffer_[tx_ptr_]     = 0x04;
-                tx_buffer_[tx_ptr_ + 1] = buffer[i];
-                tx_buffer_[tx_ptr_ + 2] = buffer[i + 1];
-                tx_buffer_[tx_ptr_ + 3] = buffer[i + 2];
+                QueuePacket(
+                    cable, 0x04, buffer[i], buffer[i + 1], buffer[i + 2]);
             }
 
             // Fill CIN for terminating bytes
             // 0x05 for 1 remaining byte
             // 0x06 for 2
             // 0x07 for 3
-            tx_buffer_[tx_ptr_] = 0x05 + (size - i - 1);
-            tx_ptr_++;
-            for(; i < size; ++i, ++tx_ptr_)
-                tx_buffer_[tx_ptr_] = buffer[i];
-            for(; (tx_ptr_ % 4) != 0; ++tx_ptr_)
-                tx_buffer_[tx_ptr_] = 0;
+            const size_t remaining = size - i;
+            QueuePacket(cable,
+                        0x05 + (remaining - 1),
+                        buffer[i],
+                        remaining > 1 ? buffer[i + 1] : 0,
+                        remaining > 2 ? buffer[i + 2] : 0);
         }
     }
 }
 
-void MidiUsbTransport::Impl::MidiToUsb(uint8_t* buffer, size_t size)
+void MidiUsbTransport::Impl::MidiToUsb(uint8_t  cable,
+                                       uint8_t* buffer,
+                                       size_t   size)
 {
     // We'll assume your message starts with a status byte!
     size_t status_index = 0;
@@ -278,14 +365,15 @@ void MidiUsbTransport::Impl::MidiToUsb(uint8_t* buffer, size_t size)
             // Either we're at the end or it's malformed
             next_status = size;
         }
-        MidiToUsbSingle(buffer + status_index, next_status - status_index);
+        MidiToUsbSingle(
+            cable, buffer + status_index, next_status - status_index);
         status_index = next_status;
     }
 }
 
-void MidiUsbTransport::Impl::Parse()
+void MidiUsbTransport::Impl::Parse(uint8_t cable)
 {
-    if(parse_callback_)
+    if(cable < kNumCables && parse_callback_[cable])
     {
         uint8_t bytes[kBufferSize];
         size_t  i = 0;
@@ -293,7 +381,13 @@ void MidiUsbTransport::Impl::Parse()
         {
             bytes[i++] = rx_buffer_.Read();
         }
-        parse_callback_(bytes, i, parse_context_);
+        if(i > 0)
+            parse_callback_[cable](bytes, i, parse_context_[cable]);
+    }
+    else
+    {
+        // nobody listens to the cable
+        rx_buffer_.Flush();
     }
 }
 
@@ -304,12 +398,13 @@ void MidiUsbTransport::Impl::Parse()
 void MidiUsbTransport::Init(MidiUsbTransport::Config config)
 {
     pimpl_ = &midi_usb_handle;
+    cable_ = config.cable < Impl::kNumCables ? config.cable : 0;
     pimpl_->Init(config);
 }
 
 void MidiUsbTransport::StartRx(MidiRxParseCallback callback, void* context)
 {
-    pimpl_->StartRx(callback, context);
+    pimpl_->StartRx(cable_, callback, context);
 }
 
 bool MidiUsbTransport::RxActive()
@@ -324,5 +419,5 @@ void MidiUsbTransport::FlushRx()
 
 void MidiUsbTransport::Tx(uint8_t* buffer, size_t size)
 {
-    pimpl_->Tx(buffer, size);
+    pimpl_->Tx(cable_, buffer, size);
 }
@@ -10,6 +10,16 @@ namespace daisy
 {
 /** @brief USB Transport for MIDI
  *  @ingroup midi
+ *  @details Outgoing messages are queued as USB MIDI event packets, and
+ *           sent in transfers of up to 15 packets: while a transfer is in
+ *           flight, the messages queue up for the next one, which is
+ *           started as soon as the transfer has completed.
+ *
+ *           The device has USBD_MIDI_NUM_CABLES virtual cables (ports), see
+ *           usbd_cdc.h, 1 by default. Each transport sends and receives
+ *           the messages of its cable, so there can be one MidiHandler per
+ *           cable. The transports share the USB peripheral of the first
+ *           that is initialized.
  */
 class MidiUsbTransport
 {
@@ -29,18 +39,23 @@ class MidiUsbTransport
         Periph periph;
 
         /**
-         * When sending MIDI messages immediately back-to-back in user code,
-         * sometimes the USB CDC driver is still "busy".
+         * When sending many MIDI messages back-to-back in user code, or when
+         * the host doesn't read them, the transmit queue can be full.
          *
-         * This option configures the number of times to retry a Tx after
-         * delaying for 100 microseconds (default = 3 retries).
+         * This option configures the number of times to retry queueing a
+         * packet after delaying for 100 microseconds (default = 3 retries).
          *
-         * If you set this to zero, Tx will not retry so the attempt will block
-         * for slightly less time, but transmit can fail if the Tx state is busy.
+         * If you set this to zero, Tx will not wait for the queue, so it
+         * blocks for less time, but packets are dropped when it's full.
          */
         uint8_t tx_retry_count;
 
-        Config() : periph(INTERNAL), tx_retry_count(3) {}
+        /** The virtual cable of the messages, 0 to USBD_MIDI_NUM_CABLES - 1,
+         *  cables past those are set to 0
+         */
+        uint8_t cable;
+
+        Config() : periph(INTERNAL), tx_retry_count(3), cable(0) {}
     };
 
     void Init(Config config);
@@ -52,13 +67,14 @@ class MidiUsbTransport
 
     class Impl;
 
-    MidiUsbTransport() : pimpl_(nullptr) {}
+    MidiUsbTransport() : pimpl_(nullptr), cable_(0) {}
     ~MidiUsbTransport() {}
     MidiUsbTransport(const MidiUsbTransport& other) = default;
     MidiUsbTransport& operator=(const MidiUsbTransport& other) = default;
 
   private:
-    Impl* pimpl_;
+    Impl*   pimpl_;
+    uint8_t cable_;
 };
 
 } // namespace daisy
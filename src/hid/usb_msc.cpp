@@ -0,0 +1,125 @@
+#include "hid/usb_msc.h"
+#include "hid/usb.h"
+#include "ff_gen_drv.h"
+#include "util/sd_diskio.h"
+#include "usbd_cdc.h"
+#include "usbd_msc.h"
+
+using namespace daisy;
+
+class UsbMsc::Impl
+{
+  public:
+    void   Init(Config config);
+    Result Attach();
+    void   Detach();
+    void   Process();
+    bool   IsHostOwned() const { return owned_; }
+
+  private:
+    UsbHandle usb_handle_;
+    Config    config_;
+    bool      owned_;
+    bool      detaching_;
+};
+
+// Global Impl
+static UsbMsc::Impl usb_msc_handle;
+
+void UsbMsc::Impl::Init(Config config)
+{
+    config_    = config;
+    owned_     = false;
+    detaching_ = false;
+    USBD_MSC_SetMedium(0, 0);
+    // This tells the USB middleware to register the mass storage class
+    // instead of CDC
+    usbd_mode = USBD_MODE_MSC;
+    usb_handle_.Init(config.periph == Config::EXTERNAL
+                         ? UsbHandle::FS_EXTERNAL
+                         : UsbHandle::FS_INTERNAL);
+}
+
+UsbMsc::Result UsbMsc::Impl::Attach()
+{
+    if(owned_)
+    {
+        detaching_ = false;
+        return Result::OK;
+    }
+    // FatFs may have left the card in any state, start from scratch
+    SD_SetSuspended(1);
+    BSP_SD_CardInfo info;
+    if(BSP_SD_Init() != MSD_OK)
+    {
+        SD_SetSuspended(0);
+        return Result::ERR_NO_CARD;
+    }
+    BSP_SD_GetCardInfo(&info);
+    if(info.LogBlockSize != MSC_SECTOR_SIZE)
+    {
+        SD_SetSuspended(0);
+        return Result::ERR_NO_CARD;
+    }
+    owned_ = true;
+    USBD_MSC_SetMedium(info.LogBlockNbr, config_.read_only);
+    return Result::OK;
+}
+
+void UsbMsc::Impl::Detach()
+{
+    if(!owned_)
+        return;
+    USBD_MSC_SetMedium(0, 0);
+    detaching_ = true;
+    Process();
+}
+
+void UsbMsc::Impl::Process()
+{
+    USBD_MSC_MediaRequest req;
+    while(USBD_MSC_GetMediaRequest(&req))
+    {
+        const DRESULT res
+            = req.write ? SD_WriteDirect(req.buff, req.lba, req.count)
+                        : SD_ReadDirect(req.buff, req.lba, req.count);
+        USBD_MSC_CompleteMediaRequest(res == RES_OK);
+    }
+
+    if(owned_ && (detaching_ || USBD_MSC_IsEjected()) && USBD_MSC_IsIdle())
+    {
+        owned_     = false;
+        detaching_ = false;
+        SD_SetSuspended(0);
+    }
+}
+
+////////////////////////////////////////////////
+// UsbMsc -> UsbMsc::Impl
+////////////////////////////////////////////////
+
+void UsbMsc::Init(UsbMsc::Config config)
+{
+    pimpl_ = &usb_msc_handle;
+    pimpl_->Init(config);
+}
+
+UsbMsc::Result UsbMsc::Attach()
+{
+    return pimpl_->Attach();
+}
+
+void UsbMsc::Detach()
+{
+    pimpl_->Detach();
+}
+
+void UsbMsc::Process()
+{
+    pimpl_->Process();
+}
+
+bool UsbMsc::IsHostOwned() const
+{
+    return pimpl_->IsHostOwned();
+}
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef __DSY_USBMSC_H__
+#define __DSY_USBMSC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisy
+{
+/** @brief USB Mass Storage device, sharing the SD card with a host
+ *  @ingroup human_interface
+ *  @details The device shows up as a removable disk, the SD card that the
+ *           SdmmcHandler set up. The host's reads and writes are run by
+ *           Process() from the main loop, as multi-block DMA transfers of
+ *           up to 16 sectors. Two buffers overlap them with the USB: reads
+ *           are fetched ahead of the host, and the host's data is received
+ *           while the previous block is written, so transfers run close to
+ *           the 1 MB/s that full speed USB can carry.
+ *
+ *           The card has one owner at a time. While the host has it, from
+ *           Attach() until Detach() or the host ejects the disk, FatFs sees
+ *           no SD card. Once it's back, FatFs mounts it again on the next
+ *           access, as the host may have changed anything on it. Files
+ *           that are open when the card is attached have to be closed
+ *           first, and opened again afterwards.
+ *
+ *           The device replaces the CDC (serial) device on its USB
+ *           peripheral, so the logger and MidiUsbTransport can't share it.
+ *
+ *           \code
+ *           sdmmc.Init(sd_cfg);
+ *           fsi.Init(FatFSInterface::Config::MEDIA_SD);
+ *           usb_msc.Init(UsbMsc::Config());
+ *           usb_msc.Attach();
+ *           while(1)
+ *           {
+ *               usb_msc.Process();
+ *               if(!usb_msc.IsHostOwned())
+ *                   ; // e.g. f_mount() and load the files the host wrote
+ *           }
+ *           \endcode
+ */
+class UsbMsc
+{
+  public:
+    enum class Result
+    {
+        OK,
+        ERR_NO_CARD, /**< the card couldn't be initialized */
+    };
+
+    struct Config
+    {
+        enum Periph
+        {
+            INTERNAL = 0,
+            EXTERNAL
+        };
+
+        Periph periph;
+        bool   read_only; /**< refuse the host's writes */
+
+        Config() : periph(INTERNAL), read_only(false) {}
+    };
+
+    /** Starts the USB device, without a disk until Attach() */
+    void Init(Config config);
+
+    /** Hands the SD card to the host, suspending FatFs' access to it */
+    Result Attach();
+
+    /** Takes the card back, the host sees the disk removed. A transfer in
+     *  progress is completed first, by Process(). The host should have
+     *  ejected the disk, or it may lose the writes it cached.
+     */
+    void Detach();
+
+    /** Runs the host's reads and writes of the card, and hands it back to
+     *  FatFs once it's detached or ejected. Call it from the main loop, as
+     *  often as possible.
+     */
+    void Process();
+
+    /** True while the host owns the card, and FatFs can't access it */
+    bool IsHostOwned() const;
+
+    class Impl;
+
+    UsbMsc() : pimpl_(nullptr) {}
+    ~UsbMsc() {}
+    UsbMsc(const UsbMsc& other) = default;
+    UsbMsc& operator=(const UsbMsc& other) = default;
+
+  private:
+    Impl* pimpl_;
+};
+
+} // namespace daisy
+
+#endif // __DSY_USBMSC_H__
@@ -3,6 +3,167 @@
 
 using namespace daisy;
 
+namespace
+{
+// Format specific conversions of one channel, selected in Open().
+// The loads go through memcpy, which compiles to a single load on the M7.
+
+void ConvertS16(const uint8_t *src, size_t stride, float *dst, size_t frames)
+{
+    for(size_t i = 0; i < frames; i++)
+    {
+        int16_t x;
+        memcpy(&x, src, sizeof(x));
+        dst[i] = s162f(x);
+        src += stride;
+    }
+}
+
+void ConvertS24(const uint8_t *src, size_t stride, float *dst, size_t frames)
+{
+    for(size_t i = 0; i < frames; i++)
+    {
+        // packed little endian, shifted into the top of a 32-bit word
+        const uint32_t x = (uint32_t(src[0]) << 8) | (uint32_t(src[1]) << 16)
+                           | (uint32_t(src[2]) << 24);
+        dst[i] = s322f(int32_t(x));
+        src += stride;
+    }
+}
+
+void ConvertS32(const uint8_t *src, size_t stride, float *dst, size_t frames)
+{
+    for(size_t i = 0; i < frames; i++)
+    {
+        int32_t x;
+        memcpy(&x, src, sizeof(x));
+        dst[i] = s322f(x);
+        src += stride;
+    }
+}
+
+void ConvertF32(const uint8_t *src, size_t stride, float *dst, size_t frames)
+{
+    for(size_t i = 0; i < frames; i++)
+    {
+        memcpy(&dst[i], src, sizeof(float));
+        src += stride;
+    }
+}
+
+// Index of the headers of a directory, see WavPlayer::Init()
+constexpr uint32_t kIndexMagic   = 0x58444957; // "WIDX"
+constexpr uint32_t kIndexVersion = 1;
+const char         kIndexName[]  = "wavplayer.idx";
+
+struct IndexHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t signature;
+};
+
+struct IndexEntry
+{
+    WAV_FormatTypeDef raw_data;
+    uint32_t          format;
+    uint32_t          data_offset;
+    uint32_t          data_size;
+    uint32_t          file_size;
+    uint32_t          first_cluster;
+};
+
+/** FNV-1a, to detect changes of the directory listing */
+uint32_t Hash(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+} // namespace
+
+bool daisy::WavReadFileInfo(FIL *fil, WavFileInfo &info)
+{
+    WAV_FormatTypeDef &raw = info.raw_data;
+    size_t             bytesread;
+    uint32_t           chunk[2];
+    memset(&raw, 0, sizeof(raw));
+    info.format      = 0;
+    info.data_offset = 0;
+    info.data_size   = 0;
+
+    // RIFF header
+    if(f_read(fil, &raw, 12, &bytesread) != FR_OK || bytesread < 12)
+        return false;
+    if(raw.ChunkId != kWavFileChunkId || raw.FileFormat != kWavFileWaveId)
+        return true; // not a wav file, Open() will refuse it
+
+    // Walk the chunks until the sample data, other chunks (e.g. LIST)
+    // may appear before it, and "fmt " is not always 16 bytes long.
+    while(f_read(fil, chunk, sizeof(chunk), &bytesread) == FR_OK
+          && bytesread == sizeof(chunk))
+    {
+        const uint32_t id = chunk[0], size = chunk[1];
+        const FSIZE_t  body = f_tell(fil);
+        if(id == kWavFileSubChunk2Id)
+        {
+            raw.SubChunk2ID   = id;
+            raw.SubCHunk2Size = size;
+            info.data_offset  = f_tell(fil);
+            info.data_size    = size;
+            return true;
+        }
+        if(id == kWavFileSubChunk1Id)
+        {
+            // WAVEFORMATEXTENSIBLE is 40 bytes, the sub format starts at 24
+            uint8_t      fmt[40];
+            const size_t rxsize = size < sizeof(fmt) ? size : sizeof(fmt);
+            if(f_read(fil, fmt, rxsize, &bytesread) != FR_OK
+               || bytesread < 16)
+                return false;
+            raw.SubChunk1ID   = id;
+            raw.SubChunk1Size = size;
+            memcpy(&raw.AudioFormat, fmt, 16);
+            info.format = raw.AudioFormat;
+            if(info.format == WAVE_FORMAT_EXTENSIBLE && bytesread >= 26)
+                info.format = uint16_t(fmt[24] | (fmt[25] << 8));
+        }
+        // chunks are padded to an even size
+        if(f_lseek(fil, body + size + (size & 1)) != FR_OK)
+            return false;
+    }
+    return true;
+}
+
+WavConvertFunction daisy::WavGetConvertFunction(const WavFileInfo &info)
+{
+    const size_t bits = info.raw_data.BitPerSample;
+    if(info.format == WAVE_FORMAT_PCM)
+    {
+        return bits == 16   ? ConvertS16
+               : bits == 24 ? ConvertS24
+               : bits == 32 ? ConvertS32
+                            : nullptr;
+    }
+    if(info.format == WAVE_FORMAT_IEEE_FLOAT && bits == 32)
+        return ConvertF32;
+    return nullptr;
+}
+
+bool daisy::WavEnableFastSeek(FIL *fil, DWORD *table, size_t table_size)
+{
+#if _USE_FASTSEEK
+    table[0]   = table_size;
+    fil->cltbl = table;
+    if(f_lseek(fil, CREATE_LINKMAP) == FR_OK)
+        return true;
+    fil->cltbl = nullptr;
+#endif
+    return false;
+}
+
 void WavPlayer::Init(const char *search_path)
 {
     // First check for all .wav files, and add them to the list until its full or there are no more.
@@ -11,6 +172,18 @@ void WavPlayer::Init(const char *search_path)
     FILINFO fno;
     DIR     dir;
     char *  fn;
+    // the directory's own timestamp, where it has one (not for the root)
+    uint32_t signature = 2166136261u;
+    char     dir_path[WAV_FILENAME_MAX];
+    strcpy(dir_path, search_path);
+    const size_t len = strlen(dir_path);
+    if(len > 1 && dir_path[len - 1] == '/')
+        dir_path[len - 1] = 0;
+    if(f_stat(dir_path, &fno) == FR_OK)
+    {
+        signature = Hash(signature, &fno.fdate, sizeof(fno.fdate));
+        signature = Hash(signature, &fno.ftime, sizeof(fno.ftime));
+    }
     file_sel_ = 0;
     file_cnt_ = 0;
     playing_  = true;
@@ -37,6 +210,11 @@ void WavPlayer::Init(const char *search_path)
             {
                 strcpy(file_info_[file_cnt_].name, search_path);
                 strcat(file_info_[file_cnt_].name, fn);
+                file_info_[file_cnt_].file_size = fno.fsize;
+                signature = Hash(signature, fn, strlen(fn) + 1);
+                signature = Hash(signature, &fno.fsize, sizeof(fno.fsize));
+                signature = Hash(signature, &fno.fdate, sizeof(fno.fdate));
+                signature = Hash(signature, &fno.ftime, sizeof(fno.ftime));
                 file_cnt_++;
                 // For now lets break anyway to test.
                 //                break;
@@ -48,33 +226,132 @@ void WavPlayer::Init(const char *search_path)
         }
     } while(result == FR_OK);
     f_closedir(&dir);
-    // Now we'll go through each file and load the WavInfo.
-    for(size_t i = 0; i < file_cnt_; i++)
+    // Now we'll go through each file and load the WavInfo,
+    // unless the index from the last time is still valid.
+    if(!LoadIndex(search_path, signature))
     {
-        size_t bytesread;
-        if(f_open(&fil_, file_info_[i].name, (FA_OPEN_EXISTING | FA_READ))
-           == FR_OK)
+        for(size_t i = 0; i < file_cnt_; i++)
         {
-            // Populate the WAV Info
-            if(f_read(&fil_,
-                      (void *)&file_info_[i].raw_data,
-                      sizeof(WAV_FormatTypeDef),
-                      &bytesread)
-               != FR_OK)
+            if(f_open(&fil_, file_info_[i].name, (FA_OPEN_EXISTING | FA_READ))
+               == FR_OK)
             {
-                // Maybe add return type
-                return;
+                // Populate the WAV Info
+                file_info_[i].first_cluster = fil_.obj.sclust;
+                if(!WavReadFileInfo(&fil_, file_info_[i]))
+                {
+                    // Maybe add return type
+                    f_close(&fil_);
+                    return;
+                }
+                f_close(&fil_);
             }
-            f_close(&fil_);
         }
+        SaveIndex(search_path, signature);
     }
+    // 16-bit mono until a file was opened successfully
+    channels_       = 1;
+    sample_bytes_   = 2;
+    frame_bytes_    = 2;
+    buff_size_      = kBufferSize;
+    read_ptr_       = 0;
+    data_pos_       = 0;
+    loop_start_     = 0;
+    loop_end_       = 0;
+    preload_len_    = 0;
+    preload_pos_    = 0;
+    refill_         = false;
+    end_ptr_        = kNoEnd;
+    speed_          = 1.0f;
+    phase_          = 0.0f;
+    rs_count_       = 0;
+    convert_        = ConvertS16;
     // fill buffer with first file preemptively.
-    buff_state_ = BUFFER_STATE_PREPARE_0;
     Open(0);
-    Prepare();
-    read_ptr_ = 0;
 }
 
+bool WavPlayer::LoadIndex(const char *search_path, uint32_t signature)
+{
+    char        path[WAV_FILENAME_MAX];
+    IndexHeader header;
+    IndexEntry  entry;
+    size_t      bytesread;
+    bool        ok = false;
+    strcpy(path, search_path);
+    strcat(path, kIndexName);
+    if(f_open(&fil_, path, (FA_OPEN_EXISTING | FA_READ)) != FR_OK)
+        return false;
+    if(f_read(&fil_, &header, sizeof(header), &bytesread) == FR_OK
+       && bytesread == sizeof(header) && header.magic == kIndexMagic
+       && header.version == kIndexVersion && header.count == file_cnt_
+       && header.signature == signature)
+    {
+        ok = true;
+        for(size_t i = 0; i < file_cnt_ && ok; i++)
+        {
+            ok = f_read(&fil_, &entry, sizeof(entry), &bytesread) == FR_OK
+                 && bytesread == sizeof(entry)
+                 && entry.file_size == file_info_[i].file_size;
+            file_info_[i].raw_data      = entry.raw_data;
+            file_info_[i].format        = entry.format;
+            file_info_[i].data_offset   = entry.data_offset;
+            file_info_[i].data_size     = entry.data_size;
+            file_info_[i].first_cluster = entry.first_cluster;
+        }
+    }
+    f_close(&fil_);
+    return ok;
+}
+
+void WavPlayer::SaveIndex(const char *search_path, uint32_t signature)
+{
+    char        path[WAV_FILENAME_MAX];
+    IndexHeader header
+        = {kIndexMagic, kIndexVersion, uint32_t(file_cnt_), signature};
+    IndexEntry  entry;
+    size_t      bw;
+    strcpy(path, search_path);
+    strcat(path, kIndexName);
+    // a write protected card just doesn't get an index
+    if(f_open(&fil_, path, (FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK)
+        return;
+    bool ok = f_write(&fil_, &header, sizeof(header), &bw) == FR_OK;
+    for(size_t i = 0; i < file_cnt_ && ok; i++)
+    {
+        entry.raw_data      = file_info_[i].raw_data;
+        entry.format        = file_info_[i].format;
+        entry.data_offset   = file_info_[i].data_offset;
+        entry.data_size     = file_info_[i].data_size;
+        entry.file_size     = file_info_[i].file_size;
+        entry.first_cluster = file_info_[i].first_cluster;
+        ok = f_write(&fil_, &entry, sizeof(entry), &bw) == FR_OK;
+    }
+    f_close(&fil_);
+    if(ok)
+        f_chmod(path, AM_HID, AM_HID);
+    else
+        f_unlink(path);
+}
+
+bool WavPlayer::SelectFormat(const WavFileInfo &info)
+{
+    const size_t chns = info.raw_data.NbrChannels;
+    const size_t bits = info.raw_data.BitPerSample;
+    if(info.data_offset == 0 || chns == 0)
+        return false;
+
+    const WavConvertFunction convert = WavGetConvertFunction(info);
+    // each half of the buffer has to fit at least one frame
+    if(convert == nullptr || chns * (bits / 8) > kBufferSize / 2)
+        return false;
+
+    convert_      = convert;
+    channels_     = chns;
+    sample_bytes_ = bits / 8;
+    frame_bytes_  = chns * sample_bytes_;
+    // both halves hold whole frames, so that no frame wraps around
+    buff_size_ = (kBufferSize / (2 * frame_bytes_)) * 2 * frame_bytes_;
+    return true;
+}
 
 int WavPlayer::Open(size_t sel)
 {
@@ -84,8 +361,101 @@ int WavPlayer::Open(size_t sel)
         file_sel_ = sel < file_cnt_ ? sel : file_cnt_ - 1;
     }
     // Set Buffer Position
-    return f_open(
+    FRESULT res = f_open(
         &fil_, file_info_[file_sel_].name, (FA_OPEN_EXISTING | FA_READ));
+    if(res != FR_OK)
+        return res;
+    // the file was replaced since the index was written
+    if(fil_.obj.sclust != file_info_[file_sel_].first_cluster)
+    {
+        file_info_[file_sel_].first_cluster = fil_.obj.sclust;
+        WavReadFileInfo(&fil_, file_info_[file_sel_]);
+    }
+    if(!SelectFormat(file_info_[file_sel_]))
+    {
+        f_close(&fil_);
+        return FR_INVALID_OBJECT;
+    }
+    // seeks and loops don't need to walk the FAT from here on
+    WavEnableFastSeek(&fil_, link_map_, WAV_LINK_MAP_SIZE);
+    const WavFileInfo &info = file_info_[file_sel_];
+    loop_start_             = 0;
+    loop_end_               = info.data_size;
+    preload_len_            = 0;
+    preload_pos_            = 0;
+    refill_                 = false;
+    playing_                = true;
+    if(preload_ == nullptr)
+        return FillBuffer(0);
+
+    // load as much as fits and is wanted, in whole frames
+    uint32_t size = preload_size_ < info.data_size ? preload_size_
+                                                   : info.data_size;
+    if(preload_seconds_ > 0.0f)
+    {
+        const float max_size = preload_seconds_ * info.raw_data.SampleRate
+                               * frame_bytes_;
+        size = max_size < size ? uint32_t(max_size) : size;
+    }
+    size -= size % frame_bytes_;
+    res          = SeekData(0);
+    preload_len_ = ReadData(preload_, size);
+    preload_len_ -= preload_len_ % frame_bytes_;
+    if(preload_len_ >= info.data_size)
+    {
+        buff_state_ = BUFFER_STATE_IDLE;
+        return res;
+    }
+    // stream the rest
+    return FillBuffer(preload_len_);
+}
+
+int WavPlayer::Seek(size_t frame)
+{
+    uint32_t pos = frame * frame_bytes_;
+    pos          = pos < loop_end_ ? pos : loop_end_;
+    playing_     = true;
+    rs_count_    = 0;
+    phase_       = 0.0f;
+    if(pos < preload_len_)
+    {
+        preload_pos_ = pos;
+        return preload_len_ < file_info_[file_sel_].data_size
+                   ? FillBuffer(preload_len_)
+                   : FR_OK;
+    }
+    // past the preloaded part
+    preload_pos_ = preload_len_;
+    return FillBuffer(pos);
+}
+
+FRESULT WavPlayer::FillBuffer(uint32_t pos)
+{
+    const FRESULT res = SeekData(pos);
+    read_ptr_         = 0;
+    end_ptr_          = kNoEnd;
+    ReadHalf(false);
+    ReadHalf(true);
+    buff_state_ = BUFFER_STATE_IDLE;
+    return res;
+}
+
+bool WavPlayer::SetLoopPoints(size_t start, size_t end)
+{
+    const size_t length = GetLengthFrames();
+    end                 = end < length ? end : length;
+    if(start >= end)
+        return false;
+    loop_start_ = start * frame_bytes_;
+    loop_end_   = end * frame_bytes_;
+    return true;
+}
+
+void WavPlayer::SetPreloadBuffer(void *buffer, size_t size, float seconds)
+{
+    preload_         = static_cast<uint8_t *>(buffer);
+    preload_size_    = buffer != nullptr ? size : 0;
+    preload_seconds_ = seconds;
 }
 
 int WavPlayer::Close()
@@ -93,69 +463,309 @@ int WavPlayer::Close()
     return f_close(&fil_);
 }
 
+bool WavPlayer::IsPreloaded() const
+{
+    return preload_len_ > 0
+           && preload_len_ >= file_info_[file_sel_].data_size;
+}
+
+const uint8_t *WavPlayer::NextFrames(size_t &frames, size_t step)
+{
+    // from the preloaded data, looping there if the whole file is loaded
+    const bool     loop_in_memory = looping_ && IsPreloaded();
+    const uint32_t mem_end        = loop_in_memory ? loop_end_ : preload_len_;
+    if(loop_in_memory && preload_pos_ >= loop_end_)
+        preload_pos_ = loop_start_;
+    if(preload_pos_ < mem_end)
+    {
+        const size_t avail = (mem_end - preload_pos_) / step;
+        frames             = frames < avail ? frames : avail;
+        const uint8_t *src = &preload_[preload_pos_];
+        preload_pos_ += frames * step;
+        return src;
+    }
+    if(IsPreloaded() || refill_)
+        return nullptr;
+
+    // from the buffer, up to its end or the end of the data
+    size_t limit = buff_size_;
+    if(end_ptr_ != kNoEnd && end_ptr_ >= read_ptr_)
+        limit = end_ptr_;
+    const size_t avail = (limit - read_ptr_) / step;
+    frames             = frames < avail ? frames : avail;
+    if(frames == 0)
+        return nullptr;
+
+    // Flag the half that was finished for refilling
+    const uint8_t *src   = &buff_[read_ptr_];
+    const size_t   start = read_ptr_;
+    read_ptr_ += frames * step;
+    if(read_ptr_ >= buff_size_)
+    {
+        read_ptr_   = 0;
+        buff_state_ = BUFFER_STATE_PREPARE_1;
+    }
+    else if(start < buff_size_ / 2 && read_ptr_ >= buff_size_ / 2)
+        buff_state_ = BUFFER_STATE_PREPARE_0;
+    return src;
+}
+
 int16_t WavPlayer::Stream()
 {
-    int16_t samp;
+    int16_t samp = 0;
     if(playing_)
     {
-        samp = buff_[read_ptr_];
-        // Increment rpo
-        read_ptr_ = (read_ptr_ + 1) % kBufferSize;
-        if(read_ptr_ == 0)
-            buff_state_ = BUFFER_STATE_PREPARE_1;
-        else if(read_ptr_ == kBufferSize / 2)
-            buff_state_ = BUFFER_STATE_PREPARE_0;
+        size_t         n   = 1;
+        const uint8_t *src = NextFrames(n, sample_bytes_);
+        if(src == nullptr)
+        {
+            // a late refill after a restart is only a dropout
+            if(!refill_)
+                playing_ = false;
+        }
+        else if(sample_bytes_ == 2)
+        {
+            memcpy(&samp, src, sizeof(samp));
+        }
+        else
+        {
+            float f;
+            convert_(src, 0, &f, 1);
+            samp = f2s16(f);
+        }
     }
     else
     {
-        samp = 0;
         if(looping_)
             playing_ = true;
     }
     return samp;
 }
 
-void WavPlayer::Prepare()
+void WavPlayer::Stream(float *const *out, size_t frames, size_t channels)
 {
-    if(buff_state_ != BUFFER_STATE_IDLE)
+    if(speed_ != 1.0f)
     {
-        size_t offset, bytesread, rxsize;
-        bytesread = 0;
-        rxsize    = (kBufferSize / 2) * sizeof(buff_[0]);
-        offset    = buff_state_ == BUFFER_STATE_PREPARE_1 ? kBufferSize / 2 : 0;
-        f_read(&fil_, &buff_[offset], rxsize, &bytesread);
-        if(bytesread < rxsize || f_eof(&fil_))
+        StreamResampled(out, frames, channels);
+        return;
+    }
+    // frames buffered for resampling are dropped on the way back to 1x
+    rs_count_   = 0;
+    phase_      = 0.0f;
+    size_t done = 0;
+    if(playing_)
+    {
+        while(done < frames)
         {
-            if(looping_)
+            // in contiguous runs, up to the end of the memory or buffer
+            size_t         n   = frames - done;
+            const uint8_t *src = NextFrames(n, frame_bytes_);
+            if(src == nullptr)
             {
-                Restart();
-                f_read(&fil_,
-                       &buff_[offset + (bytesread / 2)],
-                       rxsize - bytesread,
-                       &bytesread);
+                if(!refill_)
+                    playing_ = false;
+                break;
             }
-            else
+            for(size_t c = 0; c < channels; c++)
             {
-                playing_ = false;
+                float *dst = &out[c][done];
+                if(c >= channels_ && channels_ > 1)
+                    memset(dst, 0, n * sizeof(float));
+                else
+                    convert_(&src[(c < channels_ ? c : 0) * sample_bytes_],
+                             frame_bytes_,
+                             dst,
+                             n);
             }
+            done += n;
         }
+    }
+    else if(looping_)
+    {
+        playing_ = true;
+    }
+
+    for(size_t c = 0; c < channels; c++)
+        memset(&out[c][done], 0, (frames - done) * sizeof(float));
+}
+
+void WavPlayer::SetPlaybackSpeed(float speed)
+{
+    speed  = speed > 0.001f ? speed : 0.001f;
+    speed_ = speed < 2.0f ? speed : 2.0f;
+}
+
+bool WavPlayer::FillResampleBuffer(size_t count)
+{
+    const size_t chns
+        = channels_ < kResampleChannels ? channels_ : kResampleChannels;
+    while(rs_count_ < count)
+    {
+        size_t         n   = count - rs_count_;
+        const uint8_t *src = NextFrames(n, frame_bytes_);
+        if(src == nullptr)
+        {
+            // the end of the file, or a late refill
+            for(size_t c = 0; c < chns; c++)
+                memset(&rs_buff_[c][rs_count_],
+                       0,
+                       (count - rs_count_) * sizeof(float));
+            rs_count_ = count;
+            return false;
+        }
+        for(size_t c = 0; c < chns; c++)
+            convert_(&src[c * sample_bytes_],
+                     frame_bytes_,
+                     &rs_buff_[c][rs_count_],
+                     n);
+        rs_count_ += n;
+    }
+    return true;
+}
+
+void WavPlayer::StreamResampled(float *const *out,
+                                size_t       frames,
+                                size_t       channels)
+{
+    const float  speed = speed_;
+    const size_t chns
+        = channels_ < kResampleChannels ? channels_ : kResampleChannels;
+    size_t done = 0;
+    if(!playing_ && looping_)
+        playing_ = true;
+    while(done < frames && playing_)
+    {
+        // as many outputs as the frames that fit into rs_buff_ allow
+        size_t n = size_t((kResampleFrames - 1 - phase_) / speed);
+        n        = n < frames - done ? n : frames - done;
+        const float  next     = phase_ + n * speed;
+        const size_t consumed = size_t(next);
+        // the last output interpolates towards the frame after it,
+        // and the frame at the next position stays for the next block
+        size_t count = size_t(phase_ + (n - 1) * speed) + 2;
+        count        = count > consumed + 1 ? count : consumed + 1;
+        if(!FillResampleBuffer(count) && !refill_)
+            playing_ = false;
+
+        for(size_t c = 0; c < channels; c++)
+        {
+            float *      dst = &out[c][done];
+            const size_t src = c < channels_ ? c : 0;
+            if((c >= channels_ && channels_ > 1) || src >= kResampleChannels)
+            {
+                memset(dst, 0, n * sizeof(float));
+                continue;
+            }
+            const float *buf = rs_buff_[src];
+            for(size_t i = 0; i < n; i++)
+            {
+                const float  pos  = phase_ + i * speed;
+                const size_t idx  = size_t(pos);
+                const float  frac = pos - idx;
+                dst[i] = buf[idx] + (buf[idx + 1] - buf[idx]) * frac;
+            }
+        }
+
+        // keep the frames from the next position
+        rs_count_ -= consumed;
+        for(size_t c = 0; c < chns; c++)
+            memmove(rs_buff_[c],
+                    &rs_buff_[c][consumed],
+                    rs_count_ * sizeof(float));
+        phase_ = next - consumed;
+        done += n;
+    }
+
+    for(size_t c = 0; c < channels; c++)
+        memset(&out[c][done], 0, (frames - done) * sizeof(float));
+}
+
+size_t WavPlayer::ReadData(uint8_t *dst, size_t size)
+{
+    // without looping, play on past the loop end up to the end of the data
+    const uint32_t end = looping_ ? loop_end_ : file_info_[file_sel_].data_size;
+    size_t         bytesread = 0;
+    if(data_pos_ >= end)
+        return 0;
+    if(size > end - data_pos_)
+        size = end - data_pos_;
+    FatFSInterface::ReadContiguous(&fil_, dst, size, &bytesread);
+    data_pos_ += bytesread;
+    return bytesread;
+}
+
+FRESULT WavPlayer::SeekData(uint32_t pos)
+{
+    data_pos_ = pos;
+    return f_lseek(&fil_, file_info_[file_sel_].data_offset + pos);
+}
+
+void WavPlayer::ReadHalf(bool second)
+{
+    const size_t rxsize = buff_size_ / 2;
+    const size_t offset = second ? buff_size_ / 2 : 0;
+    size_t       filled = ReadData(&buff_[offset], rxsize);
+    // loops shorter than half the buffer wrap more than once
+    while(filled < rxsize && looping_)
+    {
+        SeekData(loop_start_);
+        const size_t n = ReadData(&buff_[offset + filled], rxsize - filled);
+        if(n == 0)
+            break;
+        filled += n;
+    }
+    if(filled < rxsize)
+    {
+        // playback stops once the reader gets here
+        filled -= filled % frame_bytes_;
+        end_ptr_ = offset + filled;
+        // silence instead of stale samples after the end of the data
+        memset(&buff_[offset + filled], 0, rxsize - filled);
+    }
+}
+
+void WavPlayer::Prepare()
+{
+    if(refill_)
+    {
+        // restarted from the preloaded data, the buffer continues after it
+        refill_ = false;
+        FillBuffer(preload_len_);
+    }
+    else if(!playing_ && looping_ && end_ptr_ != kNoEnd)
+    {
+        // looping was enabled after the end was already buffered
+        playing_ = true;
+        FillBuffer(loop_start_);
+    }
+    else if(buff_state_ != BUFFER_STATE_IDLE)
+    {
+        ReadHalf(buff_state_ == BUFFER_STATE_PREPARE_1);
         buff_state_ = BUFFER_STATE_IDLE;
     }
 }
 
 void WavPlayer::Restart()
 {
-    playing_ = true;
-    f_lseek(&fil_,
-            sizeof(WAV_FormatTypeDef)
-                + file_info_[file_sel_].raw_data.SubChunk1Size);
+    playing_  = true;
+    rs_count_ = 0;
+    phase_    = 0.0f;
+    if(preload_len_ > 0)
+    {
+        preload_pos_ = 0;
+        if(!IsPreloaded())
+            refill_ = true;
+        return;
+    }
+    end_ptr_ = kNoEnd;
+    SeekData(0);
 }
 
 WavPlayer::BufferState WavPlayer::GetNextBuffState()
 {
     size_t next_samp;
-    next_samp = (read_ptr_ + 1) % kBufferSize;
-    if(next_samp < kBufferSize / 2)
+    next_samp = (read_ptr_ + sample_bytes_) % buff_size_;
+    if(next_samp < buff_size_ / 2)
     {
         return BUFFER_STATE_PREPARE_1;
     }
@@ -1,6 +1,6 @@
 /* Current Limitations:
-- 1x Playback speed only
-- 16-bit, mono files only (otherwise fun weirdness can happen).
+- Varispeed only in the block based Stream(), up to 2x.
+- 16/24/32-bit PCM and 32-bit float files only.
 - Only 1 file playing back at a time.
 - Not sure how this would interfere with trying to use the SDCard/FatFs outside of
 this module. However, by using the extern'd SDFile, etc. I think that would break things.
@@ -11,6 +11,7 @@ this module. However, by using the extern'd SDFile, etc. I think that would brea
 #include "daisy_core.h"
 #include "util/wav_format.h"
 #include "ff.h"
+#include "sys/fatfs.h"
 
 #define WAV_FILENAME_MAX \
     256 /**< Maximum LFN (set to same in FatFs (ffconf.h) */
@@ -23,8 +24,52 @@ struct WavFileInfo
 {
     WAV_FormatTypeDef raw_data;               /**< Raw wav data */
     char              name[WAV_FILENAME_MAX]; /**< Wav filename */
+    uint16_t          format;                 /**< resolved format code */
+    uint32_t          data_offset;            /**< start of sample data */
+    uint32_t          data_size;              /**< sample data in bytes */
+    uint32_t          file_size;              /**< file size in bytes */
+    uint32_t          first_cluster;          /**< first cluster on card */
 };
 
+/** Converts frames samples of one channel of a wav file to float.
+ ** \param src first sample
+ ** \param stride distance between two samples of the channel in bytes
+ ** \param dst output buffer with room for frames samples
+ ** \param frames number of samples to convert
+ */
+typedef void (*WavConvertFunction)(const uint8_t* src,
+                                   size_t         stride,
+                                   float*         dst,
+                                   size_t         frames);
+
+/** Reads the header of an open wav file by walking its RIFF chunks,
+ ** and fills everything but the name of info.
+ ** The file position is left somewhere inside the header.
+ ** \return false if reading failed, files that aren't wav files
+ **         return true but have a data_offset of 0
+ */
+bool WavReadFileInfo(FIL* fil, WavFileInfo& info);
+
+/** \return the float conversion for the sample format of a file,
+ **         or nullptr if the format is not supported
+ */
+WavConvertFunction WavGetConvertFunction(const WavFileInfo& info);
+
+/** Number of DWORDs in a cluster link map for WavEnableFastSeek().
+ ** Enough for files split into up to 15 fragments.
+ */
+#define WAV_LINK_MAP_SIZE 32
+
+/** Builds the FatFs cluster link map of an open file, so that seeking
+ ** doesn't have to follow the cluster chain through the FAT.
+ ** \param fil an open file, the file position is not changed
+ ** \param table the link map, has to stay valid while the file is open
+ ** \param table_size number of entries in table
+ ** \return false if the file has more fragments than fit into the table,
+ **         the file then keeps seeking the slow way
+ */
+bool WavEnableFastSeek(FIL* fil, DWORD* table, size_t table_size);
+
 /* 
 TODO:
 - Make template-y to reduce memory usage.
@@ -40,11 +85,19 @@ class WavPlayer
     WavPlayer() {}
     ~WavPlayer() {}
 
-    /** Initializes the WavPlayer, loading up to max_files of wav files from an SD Card. */
+    /** Initializes the WavPlayer, loading up to max_files of wav files from an SD Card.
+     ** The headers are cached in a hidden index file (wavplayer.idx) in the
+     ** search path. As long as the directory listing (names, sizes and
+     ** timestamps) doesn't change, the files aren't opened here.
+     */
     void Init(const char* search_path);
 
-    /** Opens the file at index sel for reading.
+    /** Opens the file at index sel for reading, and fills the buffer
+     ** from the start of its sample data. The conversion to float is
+     ** selected here from the format of the file.
     \param sel File to open
+    \return FR_OK, an FatFs error, or FR_INVALID_OBJECT if the sample
+     ** format is not supported
      */
     int Open(size_t sel);
 
@@ -53,15 +106,68 @@ class WavPlayer
      */
     int Close();
 
-    /** \return The next sample if playing, otherwise returns 0 */
+    /** \return The next sample if playing, otherwise returns 0.
+     ** Multichannel files return their samples interleaved, formats
+     ** other than 16-bit are converted.
+     */
     int16_t Stream();
 
+    /** Fills a whole block of non-interleaved float output.
+     ** Mono files are copied to all outputs, outputs beyond the channels of
+     ** a multichannel file are filled with silence.
+     ** Outputs silence if not playing.
+    \param out array of channel buffers, each with room for frames samples
+    \param frames number of samples per channel
+    \param channels number of channel buffers in out
+    */
+    void Stream(float* const* out, size_t frames, size_t channels = 2);
+
     /** Collects buffer for playback when needed. */
     void Prepare();
 
-    /** Resets the playback position to the beginning of the file immediately */
+    /** Resets the playback position to the beginning of the file immediately.
+     ** With a preloaded file this doesn't touch the SD Card, and can be
+     ** called from the audio callback to trigger the file without latency.
+     */
     void Restart();
 
+    /** Moves the playback to a frame of the current file, and refills
+     ** the buffer from there. Call from the main loop, not the audio callback.
+    \param frame position in samples per channel from the start of the data
+    \return FR_OK, or an FatFs error
+    */
+    int Seek(size_t frame);
+
+    /** Sets the region that is repeated while looping. Looping jumps
+     ** from the end to the start without a gap, so loops are exact to
+     ** the sample. The loop points are reset to the whole file by Open().
+    \param start first frame of the loop
+    \param end frame after the last frame of the loop, clipped to the length
+    \return false if the region is empty, the loop points are unchanged then
+    */
+    bool SetLoopPoints(size_t start, size_t end);
+
+    /** Sets a buffer that Open() loads the start of each file into, e.g. in
+     ** SDRAM. Playback starts from there, so Restart() doesn't have to wait
+     ** for the card. Files that fit are loaded completely and never touch
+     ** the card again, for longer files the rest is streamed as usual.
+     ** The pre-roll has to cover the time it takes Prepare() to refill the
+     ** stream buffer after a Restart(), otherwise there's a short dropout.
+    \param buffer the memory to load into, or nullptr to disable preloading
+    \param size size of the buffer in bytes
+    \param seconds load at most this much of each file, 0 for no limit
+    */
+    void SetPreloadBuffer(void* buffer, size_t size, float seconds = 0.0f);
+
+    /** \return Whether the whole current file is in the preload buffer */
+    bool IsPreloaded() const;
+
+    /** \return The length of the current file in samples per channel */
+    inline size_t GetLengthFrames() const
+    {
+        return file_info_[file_sel_].data_size / frame_bytes_;
+    }
+
     /** Sets whether or not the current file will repeat after completing playback. 
     \param loop To loop or not to loop.
     */
@@ -76,6 +182,20 @@ class WavPlayer
     /** \return currently selected file.*/
     inline size_t GetCurrentFile() const { return file_sel_; }
 
+    /** \return The number of channels of the currently open file */
+    inline size_t GetChannels() const { return channels_; }
+
+    /** Sets the playback speed of the block based Stream(), 1 plays at the
+     ** original speed, 2 an octave higher. Other speeds than 1 are linearly
+     ** interpolated, for the first 8 channels of a file.
+     ** Can be changed from the audio callback, to play with modulation.
+    \param speed playback speed, clamped to 0.001 to 2
+    */
+    void SetPlaybackSpeed(float speed);
+
+    /** \return The playback speed of the block based Stream() */
+    inline float GetPlaybackSpeed() const { return speed_; }
+
   private:
     enum BufferState
     {
@@ -85,14 +205,52 @@ class WavPlayer
     };
 
     BufferState GetNextBuffState();
+    bool        SelectFormat(const WavFileInfo& info);
+    bool        LoadIndex(const char* search_path, uint32_t signature);
+    void        SaveIndex(const char* search_path, uint32_t signature);
+    size_t      ReadData(uint8_t* dst, size_t size);
+    FRESULT     SeekData(uint32_t pos);
+    FRESULT     FillBuffer(uint32_t pos);
+    void        ReadHalf(bool second);
+
+    /** Returns up to frames contiguous frames (or samples, depending on
+     ** step) from the preloaded data or the buffer, and advances past them.
+     ** frames is reduced to the number returned.
+     ** \return nullptr if there's nothing to play
+     */
+    const uint8_t* NextFrames(size_t& frames, size_t step);
+
+    void StreamResampled(float* const* out, size_t frames, size_t channels);
+    bool FillResampleBuffer(size_t count);
+
+    static constexpr size_t kNoEnd = SIZE_MAX;
 
-    static constexpr size_t kMaxFiles   = 8;
-    static constexpr size_t kBufferSize = 4096;
+    static constexpr size_t kMaxFiles = 8;
+    // in bytes, at 2x speed a half lasts as long as 4096 bytes at 1x
+    static constexpr size_t kBufferSize       = 16384;
+    static constexpr size_t kResampleFrames   = 64;
+    static constexpr size_t kResampleChannels = 8;
     WavFileInfo             file_info_[kMaxFiles];
     size_t                  file_cnt_, file_sel_;
     BufferState             buff_state_;
-    int16_t                 buff_[kBufferSize];
-    size_t                  read_ptr_;
+    alignas(4) uint8_t      buff_[kBufferSize];
+    size_t                  buff_size_; // used bytes, two halves of frames
+    size_t                  read_ptr_;  // in bytes
+    size_t                  channels_, sample_bytes_, frame_bytes_;
+    uint32_t                data_pos_; // next byte to read from the data
+    uint32_t                loop_start_, loop_end_; // in bytes
+    DWORD                   link_map_[WAV_LINK_MAP_SIZE];
+    size_t                  end_ptr_; // end of the data in the buffer, if any
+    uint8_t*                preload_         = nullptr;
+    size_t                  preload_size_    = 0;
+    float                   preload_seconds_ = 0.0f;
+    uint32_t                preload_len_, preload_pos_; // in bytes
+    volatile bool           refill_; // buffer has to restart after preload
+    float                   speed_;
+    float                   phase_;    // position in rs_buff_
+    size_t                  rs_count_; // frames in rs_buff_
+    float                   rs_buff_[kResampleChannels][kResampleFrames];
+    WavConvertFunction      convert_;
     bool                    looping_, playing_;
     FIL                     fil_;
 };
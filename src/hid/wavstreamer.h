@@ -0,0 +1,393 @@
+#pragma once
+#ifndef DSY_WAVSTREAMER_H
+#define DSY_WAVSTREAMER_H /**< Macro */
+#include <atomic>
+#include <cstring>
+#include "hid/wavplayer.h"
+
+namespace daisy
+{
+/** @brief Streams several wav files from an SD Card at the same time
+ *  @addtogroup utility
+ *
+ *  Every voice has its own file and ring buffer, but all reads are done
+ *  from a single Prepare() in the main loop. Each call services the voice
+ *  that would run out of samples first, so a busy card or a slow read
+ *  delays the voices that can afford it. A voice is only read once at
+ *  least a quarter of its buffer is free, and then as much as fits, cut
+ *  to end on a sector boundary of the file. This keeps the reads large, so
+ *  that FatFs can transfer whole sectors directly into the buffer.
+ *
+ *  Open() and Stop() are called from the main loop, Stream() from the
+ *  audio callback.
+ *
+ *  The buffers need to be reachable by the SDMMC DMA, e.g. in SDRAM:
+ *  @code
+ *  WavStreamer<16> DSY_SDRAM_BSS streamer;
+ *
+ *  void AudioCallback(InputBuffer in, OutputBuffer out, size_t size)
+ *  {
+ *      streamer.Stream(0, out, size, 2);
+ *  }
+ *
+ *  int main(void)
+ *  {
+ *      // ... mount the sd card, start the audio
+ *      streamer.Init();
+ *      streamer.Open(0, "loop.wav", true);
+ *      while(1)
+ *          streamer.Prepare();
+ *  }
+ *  @endcode
+ *
+ *  @tparam num_voices  the number of voices that can play at once
+ *  @tparam buffer_size the size of each voice's buffer in bytes.
+ *                      Must be a power of 2 and a multiple of 2048.
+ */
+template <size_t num_voices = 8, size_t buffer_size = 16384>
+class WavStreamer
+{
+  public:
+    WavStreamer() {}
+    ~WavStreamer() {}
+
+    /** Return values for Open() */
+    enum class Result
+    {
+        OK,
+        ERR_INVALID_VOICE,
+        ERR_FILE,
+        ERR_FORMAT,
+    };
+
+    /** Buffer health of one voice, see GetVoiceHealth() */
+    struct VoiceHealth
+    {
+        float    fill;      /**< buffered fraction of the buffer right now */
+        float    min_fill;  /**< lowest buffered fraction since the reset */
+        uint32_t underruns; /**< number of Stream() calls that were short */
+        uint32_t reads;     /**< number of reads from the card */
+    };
+
+    /** Closes all voices */
+    void Init()
+    {
+        for(auto& v : voices_)
+        {
+            v.active = false;
+            v.open   = false;
+        }
+    }
+
+    /** Opens a file on a voice, and fills its buffer before it starts
+     *  to play. A file that was playing on the voice is closed.
+     *  \param voice   index of the voice
+     *  \param path    the path of the wav file
+     *  \param looping whether to restart the file when it ends
+     */
+    Result Open(size_t voice, const char* path, bool looping = false)
+    {
+        if(voice >= num_voices)
+            return Result::ERR_INVALID_VOICE;
+        Voice& v = voices_[voice];
+        Close(voice);
+
+        if(f_open(&v.fil, path, (FA_OPEN_EXISTING | FA_READ)) != FR_OK)
+            return Result::ERR_FILE;
+        v.open = true;
+        if(!WavReadFileInfo(&v.fil, v.info))
+        {
+            Close(voice);
+            return Result::ERR_FILE;
+        }
+
+        const size_t chns = v.info.raw_data.NbrChannels;
+        v.convert         = WavGetConvertFunction(v.info);
+        v.sample_bytes    = v.info.raw_data.BitPerSample / 8;
+        v.frame_bytes     = chns * v.sample_bytes;
+        if(v.info.data_offset == 0 || v.convert == nullptr || chns == 0
+           || v.frame_bytes > kGuardSize
+           || v.info.raw_data.SampleRate == 0)
+        {
+            Close(voice);
+            return Result::ERR_FORMAT;
+        }
+        v.channels  = chns;
+        v.byte_rate = v.info.raw_data.SampleRate * v.frame_bytes;
+        v.looping   = looping;
+
+        // loops jump back without walking the FAT
+        WavEnableFastSeek(&v.fil, v.link_map, WAV_LINK_MAP_SIZE);
+        if(f_lseek(&v.fil, v.info.data_offset) != FR_OK)
+        {
+            Close(voice);
+            return Result::ERR_FILE;
+        }
+        v.data_remaining = v.info.data_size;
+        v.eof            = false;
+        v.write_pos      = 0;
+        v.read_pos       = 0;
+        v.min_buffered   = buffer_size;
+        v.underruns      = 0;
+        v.reads          = 0;
+        Fill(v);
+        v.active = true;
+        return Result::OK;
+    }
+
+    /** Stops a voice and closes its file */
+    void Close(size_t voice)
+    {
+        if(voice >= num_voices)
+            return;
+        Voice& v = voices_[voice];
+        v.active = false;
+        if(v.open)
+            f_close(&v.fil);
+        v.open = false;
+    }
+
+    /** Stops a voice, it outputs silence until it's opened again.
+     *  Can be called from the audio callback.
+     */
+    void Stop(size_t voice)
+    {
+        if(voice < num_voices)
+            voices_[voice].active = false;
+    }
+
+    /** \return whether a voice is playing */
+    bool IsPlaying(size_t voice) const
+    {
+        return voice < num_voices && voices_[voice].active;
+    }
+
+    /** \return the number of channels of the file on a voice */
+    size_t GetChannels(size_t voice) const
+    {
+        return voice < num_voices ? voices_[voice].channels : 0;
+    }
+
+    /** Fills a block of non-interleaved float output from a voice.
+     *  Mono files are copied to all outputs, outputs beyond the channels
+     *  of a multichannel file are filled with silence. When there are not
+     *  enough samples buffered, the rest of the block is silence and
+     *  the voice's underrun count is increased.
+     *  \param voice    index of the voice
+     *  \param out      array of channel buffers, with room for frames samples
+     *  \param frames   number of samples per channel
+     *  \param channels number of channel buffers in out
+     */
+    void Stream(size_t voice, float* const* out, size_t frames, size_t channels)
+    {
+        if(voice >= num_voices || !voices_[voice].active)
+        {
+            for(size_t c = 0; c < channels; c++)
+                memset(out[c], 0, frames * sizeof(float));
+            return;
+        }
+        Voice& v = voices_[voice];
+
+        const uint32_t start    = v.read_pos;
+        const uint32_t buffered = v.write_pos - start;
+        const size_t   avail    = buffered / v.frame_bytes;
+        const size_t   n_frames = avail < frames ? avail : frames;
+        if(n_frames < frames)
+        {
+            if(v.eof)
+                v.active = false; // played to the end
+            else
+                v.underruns++;
+        }
+
+        for(size_t c = 0; c < channels; c++)
+        {
+            float* dst = out[c];
+            if(c < v.channels || v.channels == 1)
+            {
+                const size_t chn_offset
+                    = (c < v.channels ? c : 0) * v.sample_bytes;
+                size_t rp        = start & kMask;
+                size_t remaining = n_frames;
+                while(remaining > 0)
+                {
+                    // a frame at the end may continue in the guard area
+                    size_t n = (buffer_size - rp + v.frame_bytes - 1)
+                               / v.frame_bytes;
+                    n = n < remaining ? n : remaining;
+                    v.convert(&v.buff[rp + chn_offset], v.frame_bytes, dst, n);
+                    dst += n;
+                    remaining -= n;
+                    rp += n * v.frame_bytes;
+                    if(rp >= buffer_size)
+                        rp -= buffer_size;
+                }
+            }
+            else
+            {
+                FillSilence(dst, 0, n_frames);
+            }
+            FillSilence(out[c], n_frames, frames);
+        }
+
+        const uint32_t left = buffered - n_frames * v.frame_bytes;
+        if(left < v.min_buffered)
+            v.min_buffered = left;
+        std::atomic_signal_fence(std::memory_order_release);
+        v.read_pos = start + n_frames * v.frame_bytes;
+    }
+
+    /** Reads from the card for the voice that runs out of samples first.
+     *  Call this as often as possible from the main loop.
+     *  \return true if a read was done, false if all buffers are full
+     *          enough
+     */
+    bool Prepare()
+    {
+        Voice*   next      = nullptr;
+        uint64_t next_time = 0;
+        for(auto& v : voices_)
+        {
+            if(!v.active || v.eof)
+                continue;
+            const uint32_t buffered = v.write_pos - v.read_pos;
+            if(buffer_size - buffered < kMinReadSize)
+                continue;
+            // compare buffered / byte_rate without dividing
+            const uint64_t time = uint64_t(buffered) * kTimeScale / v.byte_rate;
+            if(next == nullptr || time < next_time)
+            {
+                next      = &v;
+                next_time = time;
+            }
+        }
+        if(next == nullptr)
+            return false;
+        Fill(*next);
+        return true;
+    }
+
+    /** \return the buffer health of a voice */
+    VoiceHealth GetVoiceHealth(size_t voice) const
+    {
+        VoiceHealth h = {0.0f, 0.0f, 0, 0};
+        if(voice >= num_voices)
+            return h;
+        const Voice& v = voices_[voice];
+        h.fill         = float(v.write_pos - v.read_pos) / float(buffer_size);
+        h.min_fill     = float(v.min_buffered) / float(buffer_size);
+        h.underruns    = v.underruns;
+        h.reads        = v.reads;
+        return h;
+    }
+
+    /** Resets the lowest fill and the underrun and read counts of a voice */
+    void ResetVoiceHealth(size_t voice)
+    {
+        if(voice >= num_voices)
+            return;
+        Voice& v       = voices_[voice];
+        v.min_buffered = v.write_pos - v.read_pos;
+        v.underruns    = 0;
+        v.reads        = 0;
+    }
+
+  private:
+    static_assert((buffer_size & (buffer_size - 1)) == 0,
+                  "buffer_size must be a power of 2");
+    static_assert(buffer_size >= 2048, "buffer_size must be at least 2048");
+
+    static constexpr size_t   kMask        = buffer_size - 1;
+    static constexpr size_t   kSectorSize  = 512;
+    static constexpr size_t   kMinReadSize = buffer_size / 4;
+    static constexpr size_t   kGuardSize   = 32; // largest frame in bytes
+    static constexpr uint64_t kTimeScale   = 1000000;
+
+    struct Voice
+    {
+        FIL                fil;
+        DWORD              link_map[WAV_LINK_MAP_SIZE];
+        WavFileInfo        info;
+        WavConvertFunction convert;
+        size_t             channels, sample_bytes, frame_bytes;
+        uint32_t           byte_rate;
+        uint32_t           data_remaining;
+        // free running byte counts, only the main loop writes write_pos
+        // and only the audio callback writes read_pos
+        volatile uint32_t write_pos, read_pos;
+        volatile uint32_t min_buffered, underruns;
+        uint32_t          reads;
+        volatile bool     active, eof;
+        bool              open, looping;
+        // the first kGuardSize bytes are mirrored behind the end, so that
+        // Stream() can convert frames that wrap around in one go.
+        alignas(4) uint8_t buff[buffer_size + kGuardSize];
+    };
+
+    static void FillSilence(float* dst, size_t from, size_t to)
+    {
+        if(to > from)
+            memset(&dst[from], 0, (to - from) * sizeof(float));
+    }
+
+    /** Reads as much as fits into a voice's buffer in one go */
+    void Fill(Voice& v)
+    {
+        const uint32_t wp   = v.write_pos & kMask;
+        const uint32_t free = buffer_size - (v.write_pos - v.read_pos);
+        size_t         n    = free < buffer_size - wp ? free : buffer_size - wp;
+        if(n >= v.data_remaining)
+        {
+            n = v.data_remaining;
+        }
+        else
+        {
+            // end on a sector boundary, so that the next read is aligned
+            const size_t misalign = (f_tell(&v.fil) + n) % kSectorSize;
+            if(misalign < n)
+                n -= misalign;
+        }
+
+        size_t bytesread = 0;
+        if(n > 0
+           && FatFSInterface::ReadContiguous(
+                  &v.fil, &v.buff[wp], n, &bytesread)
+                  != FR_OK)
+            bytesread = 0;
+        v.reads++;
+        v.data_remaining -= bytesread;
+        if(bytesread < n)
+            v.data_remaining = 0; // file shorter than its header says
+        if(wp < kGuardSize && bytesread > 0)
+        {
+            const size_t end = wp + bytesread;
+            memcpy(&v.buff[buffer_size + wp],
+                   &v.buff[wp],
+                   (end < kGuardSize ? end : kGuardSize) - wp);
+        }
+
+        bool end_of_data = false;
+        if(v.data_remaining == 0)
+        {
+            if(v.looping && v.info.data_size > 0
+               && f_lseek(&v.fil, v.info.data_offset) == FR_OK)
+                v.data_remaining = v.info.data_size;
+            else
+                end_of_data = true;
+        }
+        std::atomic_signal_fence(std::memory_order_release);
+        v.write_pos = v.write_pos + bytesread;
+        // only after the last samples are visible to Stream()
+        if(end_of_data)
+            v.eof = true;
+    }
+
+    Voice voices_[num_voices];
+
+    WavStreamer(const WavStreamer&) = delete;
+    WavStreamer& operator=(const WavStreamer&) = delete;
+};
+
+} // namespace daisy
+
+#endif
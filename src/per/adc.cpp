@@ -1,6 +1,12 @@
 #include <stm32h7xx_hal.h>
 #include "per/adc.h"
+#include "per/adc_filter.h"
+#include "sys/dma_streams.h"
+#include "sys/irq_priority.h"
+#include "sys/system.h"
+#include "util/DmaBuffer.h"
 #include "util/hal_map.h"
+#include "util/IrqProfiler.h"
 
 using namespace daisy;
 
@@ -129,8 +135,27 @@ static uint16_t DMA_BUFFER_MEM_SECTION
  **
  ** Also used to provide buffer for trash data during mux pin changes.
  ***/
-static uint16_t DMA_BUFFER_MEM_SECTION
-    adc1_dma_buffer[DSY_ADC_MAX_CHANNELS * 2];
+static DmaBuffer<uint16_t, DSY_ADC_MAX_CHANNELS * 2> DMA_BUFFER_MEM_SECTION
+    adc1_dma_buffer;
+
+/** Two blocks of conversions for StartSynced(), one is written while the
+ ** other is read.
+ ***/
+static DmaBuffer<uint16_t, DSY_ADC_SYNC_BUFFER_SIZE> DMA_BUFFER_MEM_SECTION
+    adc1_sync_buffer;
+
+/** Filtered values after SetFilter(), the channels first, then the mux
+ ** inputs of each channel
+ ***/
+static AdcFilter adc1_filter;
+static_assert(DSY_ADC_MAX_CHANNELS * (1 + DSY_ADC_MAX_MUX_CHANNELS)
+                  <= DSY_ADC_FILTER_MAX_SLOTS,
+              "the filter needs a slot per channel and mux input");
+
+static constexpr size_t adc_mux_slot(size_t chn, size_t idx)
+{
+    return DSY_ADC_MAX_CHANNELS + chn * DSY_ADC_MAX_MUX_CHANNELS + idx;
+}
 
 // Global ADC Struct
 struct dsy_adc
@@ -145,8 +170,19 @@ struct dsy_adc
     uint16_t* dma_buffer;
     uint16_t (*mux_cache)[DSY_ADC_MAX_MUX_CHANNELS];
     ADC_HandleTypeDef hadc1;
+    ADC_HandleTypeDef hadc2; // MODE_DUAL slave
     DMA_HandleTypeDef hdma_adc1;
     bool              mux_used; // flag set when mux is configured
+    bool              dual;     // ADC1 and ADC2 in regular simultaneous mode
+    bool              filtered; // the getters return adc1_filter
+    uint8_t           sequence; // conversions per ADC
+    TIM_HandleTypeDef htim1;         // starts the sequences with muxes
+    float             mux_settle_us; // time from the mux switch to the start
+    // StartSynced() state
+    TIM_HandleTypeDef        htim15;
+    bool                     synced;
+    size_t                   sync_conversions;
+    const uint16_t* volatile sync_ready; // last complete block
 };
 
 // Static Functions
@@ -164,6 +200,80 @@ static int get_num_mux_pins_required(int num_mux_ch)
 static void
                       write_mux_value(uint8_t chn, uint8_t idx, uint8_t num_mux_pins_to_write);
 static const uint32_t adc_channel_from_pin(dsy_gpio_pin* pin);
+static void           adc_set_trigger(bool synced);
+static bool           adc_init_converters();
+static void           adc_start_dma(uint32_t* buffer, uint32_t length);
+static void           adc_init_mux_timer();
+
+// Ratio and right shift of an oversampling amount, for both groups
+static void adc_get_oversampling(AdcHandle::OverSampling ovs,
+                                 uint32_t&               ratio,
+                                 uint32_t&               shift)
+{
+    switch(ovs)
+    {
+        case AdcHandle::OVS_4:
+            shift = ADC_RIGHTBITSHIFT_2;
+            ratio = 3;
+            break;
+        case AdcHandle::OVS_8:
+            shift = ADC_RIGHTBITSHIFT_3;
+            ratio = 7;
+            break;
+        case AdcHandle::OVS_16:
+            shift = ADC_RIGHTBITSHIFT_4;
+            ratio = 15;
+            break;
+        case AdcHandle::OVS_32:
+            shift = ADC_RIGHTBITSHIFT_5;
+            ratio = 31;
+            break;
+        case AdcHandle::OVS_64:
+            shift = ADC_RIGHTBITSHIFT_6;
+            ratio = 63;
+            break;
+        case AdcHandle::OVS_128:
+            shift = ADC_RIGHTBITSHIFT_7;
+            ratio = 127;
+            break;
+        case AdcHandle::OVS_256:
+            shift = ADC_RIGHTBITSHIFT_8;
+            ratio = 255;
+            break;
+        case AdcHandle::OVS_512:
+            shift = ADC_RIGHTBITSHIFT_9;
+            ratio = 511;
+            break;
+        case AdcHandle::OVS_1024:
+            shift = ADC_RIGHTBITSHIFT_10;
+            ratio = 1023;
+            break;
+        default: break;
+    }
+}
+
+static uint32_t adc_sampling_time(AdcChannelConfig::ConversionSpeed speed)
+{
+    switch(speed)
+    {
+        case AdcChannelConfig::SPEED_1CYCLES_5: return ADC_SAMPLETIME_1CYCLE_5;
+        case AdcChannelConfig::SPEED_2CYCLES_5:
+            return ADC_SAMPLETIME_2CYCLES_5;
+        case AdcChannelConfig::SPEED_8CYCLES_5:
+            return ADC_SAMPLETIME_8CYCLES_5;
+        case AdcChannelConfig::SPEED_16CYCLES_5:
+            return ADC_SAMPLETIME_16CYCLES_5;
+        case AdcChannelConfig::SPEED_32CYCLES_5:
+            return ADC_SAMPLETIME_32CYCLES_5;
+        case AdcChannelConfig::SPEED_64CYCLES_5:
+            return ADC_SAMPLETIME_64CYCLES_5;
+        case AdcChannelConfig::SPEED_387CYCLES_5:
+            return ADC_SAMPLETIME_387CYCLES_5;
+        case AdcChannelConfig::SPEED_810CYCLES_5:
+            return ADC_SAMPLETIME_810CYCLES_5;
+    }
+    return ADC_SAMPLETIME_8CYCLES_5;
+}
 
 static const uint32_t adc_channel_from_pin(dsy_gpio_pin* pin)
 {
@@ -197,6 +307,33 @@ static const uint32_t adc_channel_from_pin(dsy_gpio_pin* pin)
 // Declare Global ADC Handle
 static dsy_adc adc;
 
+// Stream of StartStream(), the injected group of ADC2
+typedef float dsy_adc_stream_block[DSY_ADC_STREAM_MAX_BLOCK];
+struct dsy_adc_stream
+{
+    ADC_HandleTypeDef         hadc2;
+    TIM_HandleTypeDef         htim8;
+    AdcHandle::StreamCallback callback;
+    void*                     context;
+    size_t                    channels, block_size;
+    size_t                    pos;   // next sample of the block being written
+    uint8_t                   write; // block being written
+    dsy_adc_stream_block      buffer[2][DSY_ADC_STREAM_MAX_CHANNELS];
+    // last complete block
+    const float* ready[DSY_ADC_STREAM_MAX_CHANNELS];
+    float        samplerate;
+    bool         running;
+};
+
+static dsy_adc_stream adc_stream;
+
+static const uint32_t dsy_adc_injected_rank_map[] = {
+    ADC_INJECTED_RANK_1,
+    ADC_INJECTED_RANK_2,
+    ADC_INJECTED_RANK_3,
+    ADC_INJECTED_RANK_4,
+};
+
 // Begin AdcChannelConfig Implementations
 
 void AdcChannelConfig::InitSingle(dsy_gpio_pin                      pin,
@@ -238,7 +375,8 @@ void AdcChannelConfig::InitMux(dsy_gpio_pin                      adc_pin,
 
 void AdcHandle::Init(AdcChannelConfig* cfg,
                      size_t            num_channels,
-                     OverSampling      ovs)
+                     OverSampling      ovs,
+                     ConverterMode     mode)
 {
     ADC_MultiModeTypeDef   multimode = {0};
     ADC_ChannelConfTypeDef sConfig   = {0};
@@ -246,7 +384,7 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
     oversampling_ = ovs;
     // Set DMA buffers
     num_channels_  = num_channels;
-    adc.dma_buffer = adc1_dma_buffer;
+    adc.dma_buffer = adc1_dma_buffer.Data();
     adc.mux_cache  = &adc1_mux_cache[0];
     // Clear Buffers
     for(size_t i = 0; i < DSY_ADC_MAX_CHANNELS; i++)
@@ -259,6 +397,7 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
     adc.channels = num_channels;
     adc.mux_used
         = false; // set false, and let any pin using it override this setting.
+    adc.filtered = false;
     for(size_t i = 0; i < num_channels_; i++)
     {
         adc.pin_cfg[i]      = cfg[i];
@@ -267,32 +406,31 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
         if(cfg[i].mux_channels_ > 0)
             adc.mux_used = true;
     }
+    // In MODE_DUAL ADC1 converts the even channels and ADC2 the odd ones at
+    // the same time. ADC2 can't read channels 16 and 17. The DMA moves both
+    // results as one word, ADC1 in the lower half, so the buffer keeps the
+    // order of the channels.
+    adc.dual = mode == MODE_DUAL && num_channels > 1;
+    for(size_t i = 1; i < num_channels && adc.dual; i += 2)
+    {
+        const uint32_t chn = adc_channel_from_pin(&adc.pin_cfg[i].pin_.pin);
+        if(chn == ADC_CHANNEL_16 || chn == ADC_CHANNEL_17)
+            adc.dual = false;
+    }
+    adc.sequence      = adc.dual ? (num_channels + 1) / 2 : num_channels;
+    adc.mux_settle_us = DSY_ADC_MUX_SETTLE_US;
+
     adc.hadc1.Instance                  = ADC1;
     adc.hadc1.Init.ClockPrescaler       = ADC_CLOCK_ASYNC_DIV2;
     adc.hadc1.Init.Resolution           = ADC_RESOLUTION_16B;
     adc.hadc1.Init.ScanConvMode         = ADC_SCAN_ENABLE;
     adc.hadc1.Init.EOCSelection         = ADC_EOC_SEQ_CONV;
     adc.hadc1.Init.LowPowerAutoWait     = DISABLE;
-    adc.hadc1.Init.NbrOfConversion      = adc.channels;
-    adc.hadc1.Init.ExternalTrigConv     = ADC_SOFTWARE_START;
-    adc.hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
-
-    // Set ConversionDataManagement, and (Dis)Continuous based on whether
-    // the callback needs to be used, or if the ADC can run in circular
-    if(!adc.mux_used)
-    {
-        adc.hadc1.Init.ContinuousConvMode    = ENABLE;
-        adc.hadc1.Init.DiscontinuousConvMode = DISABLE;
-        adc.hadc1.Init.ConversionDataManagement
-            = ADC_CONVERSIONDATA_DMA_CIRCULAR;
-    }
-    else
-    {
-        adc.hadc1.Init.ContinuousConvMode    = DISABLE;
-        adc.hadc1.Init.DiscontinuousConvMode = DISABLE;
-        adc.hadc1.Init.ConversionDataManagement
-            = ADC_CONVERSIONDATA_DMA_ONESHOT;
-    }
+    adc.hadc1.Init.NbrOfConversion      = adc.sequence;
+    adc.synced                          = false;
+    adc.sync_conversions                = 0;
+    adc.sync_ready                      = nullptr;
+    adc_set_trigger(false);
 
     adc.hadc1.Init.Overrun      = ADC_OVR_DATA_PRESERVED;
     adc.hadc1.Init.LeftBitShift = ADC_LEFTBITSHIFT_NONE;
@@ -304,59 +442,30 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
             = ADC_REGOVERSAMPLING_CONTINUED_MODE;
         adc.hadc1.Init.Oversampling.TriggeredMode
             = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
-        switch(oversampling_)
-        {
-            case OVS_4:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_2;
-                adc.hadc1.Init.Oversampling.Ratio         = 3;
-                break;
-            case OVS_8:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_3;
-                adc.hadc1.Init.Oversampling.Ratio         = 7;
-                break;
-            case OVS_16:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_4;
-                adc.hadc1.Init.Oversampling.Ratio         = 15;
-                break;
-            case OVS_32:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_5;
-                adc.hadc1.Init.Oversampling.Ratio         = 31;
-                break;
-            case OVS_64:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_6;
-                adc.hadc1.Init.Oversampling.Ratio         = 63;
-                break;
-            case OVS_128:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_7;
-                adc.hadc1.Init.Oversampling.Ratio         = 127;
-                break;
-            case OVS_256:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_8;
-                adc.hadc1.Init.Oversampling.Ratio         = 255;
-                break;
-            case OVS_512:
-                adc.hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_9;
-                adc.hadc1.Init.Oversampling.Ratio         = 511;
-                break;
-            case OVS_1024:
-                adc.hadc1.Init.Oversampling.RightBitShift
-                    = ADC_RIGHTBITSHIFT_10;
-                adc.hadc1.Init.Oversampling.Ratio = 1023;
-                break;
-            default: break;
-        }
+        adc_get_oversampling(oversampling_,
+                             adc.hadc1.Init.Oversampling.Ratio,
+                             adc.hadc1.Init.Oversampling.RightBitShift);
     }
     else
     {
         adc.hadc1.Init.OversamplingMode = DISABLE;
     }
     // Init ADC
-    if(HAL_ADC_Init(&adc.hadc1) != HAL_OK)
+    if(!adc_init_converters())
     {
         Error_Handler();
     }
     // Configure the ADC multi-mode
-    multimode.Mode = ADC_MODE_INDEPENDENT;
+    if(adc.dual)
+    {
+        multimode.Mode             = ADC_DUALMODE_REGSIMULT;
+        multimode.DualModeData     = ADC_DUALMODEDATAFORMAT_32_10_BITS;
+        multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_1CYCLE;
+    }
+    else
+    {
+        multimode.Mode = ADC_MODE_INDEPENDENT;
+    }
     if(HAL_ADCEx_MultiModeConfigChannel(&adc.hadc1, &multimode) != HAL_OK)
     {
         Error_Handler();
@@ -370,34 +479,14 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
     {
         const auto& cfg = adc.pin_cfg[i];
 
-        /** Handle per-channel conversions */
-        switch(cfg.speed_)
-        {
-            case AdcChannelConfig::SPEED_1CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_1CYCLE_5;
-                break;
-            case AdcChannelConfig::SPEED_2CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_2CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_8CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_8CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_16CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_16CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_32CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_32CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_64CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_64CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_387CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_387CYCLES_5;
-                break;
-            case AdcChannelConfig::SPEED_810CYCLES_5:
-                sConfig.SamplingTime = ADC_SAMPLETIME_810CYCLES_5;
-                break;
-        }
+        /** Handle per-channel conversions, the channels converted at the
+         *  same time take the same time */
+        AdcChannelConfig::ConversionSpeed speed = cfg.speed_;
+        const size_t                      other = i ^ 1;
+        if(adc.dual && other < adc.channels
+           && adc.pin_cfg[other].speed_ > speed)
+            speed = adc.pin_cfg[other].speed_;
+        sConfig.SamplingTime = adc_sampling_time(speed);
 
         // init ADC pin
         dsy_gpio_init(&cfg.pin_);
@@ -412,58 +501,338 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
         }
 
         // init adc channel sequence
+        ADC_HandleTypeDef* hadc = adc.dual && (i & 1) ? &adc.hadc2 : &adc.hadc1;
         sConfig.Channel = adc_channel_from_pin(&adc.pin_cfg[i].pin_.pin);
-        sConfig.Rank    = dsy_adc_rank_map[i];
-        if(HAL_ADC_ConfigChannel(&adc.hadc1, &sConfig) != HAL_OK)
+        sConfig.Rank    = dsy_adc_rank_map[adc.dual ? i / 2 : i];
+        if(HAL_ADC_ConfigChannel(hadc, &sConfig) != HAL_OK)
         {
             Error_Handler();
         }
+
+        // with an odd number of channels ADC2 converts its last one twice,
+        // the result lands after the last channel
+        if(adc.dual && i == adc.channels - 1 && (i & 1) == 0)
+        {
+            sConfig.Channel
+                = adc_channel_from_pin(&adc.pin_cfg[i - 1].pin_.pin);
+            if(HAL_ADC_ConfigChannel(&adc.hadc2, &sConfig) != HAL_OK)
+            {
+                Error_Handler();
+            }
+        }
     }
 }
 
+bool AdcHandle::IsDualMode() const
+{
+    return adc.dual;
+}
+
 void AdcHandle::Start()
 {
-    HAL_ADCEx_Calibration_Start(
-        &adc.hadc1, ADC_CALIB_OFFSET_LINEARITY, ADC_SINGLE_ENDED);
-    HAL_ADC_Start_DMA(&adc.hadc1, (uint32_t*)adc.dma_buffer, adc.channels);
+    // back from StartSynced()
+    if(adc.hadc1.Init.ExternalTrigConv == ADC_EXTERNALTRIG_T15_TRGO)
+    {
+        adc_set_trigger(false);
+        if(!adc_init_converters())
+            Error_Handler();
+    }
+    if(adc.mux_used)
+        adc_init_mux_timer();
+    adc_start_dma((uint32_t*)adc.dma_buffer, adc.sequence);
+    // the first sequence, the callback starts the next ones
+    if(adc.mux_used)
+        SET_BIT(TIM1->CR1, TIM_CR1_CEN);
+}
+
+void AdcHandle::SetMuxSettleTime(float settle_us)
+{
+    adc.mux_settle_us = settle_us > 0.f ? settle_us : 0.f;
 }
 
 void AdcHandle::Stop()
 {
-    HAL_ADC_Stop_DMA(&adc.hadc1);
+    if(adc.synced)
+    {
+        CLEAR_BIT(TIM15->CR1, TIM_CR1_CEN);
+        adc.synced           = false;
+        adc.sync_conversions = 0;
+    }
+    if(adc.mux_used)
+        CLEAR_BIT(TIM1->CR1, TIM_CR1_CEN);
+    if(adc.dual)
+        HAL_ADCEx_MultiModeStop_DMA(&adc.hadc1);
+    else
+        HAL_ADC_Stop_DMA(&adc.hadc1);
+}
+
+bool AdcHandle::StartSynced(float  samplerate,
+                            size_t block_size,
+                            size_t conversions)
+{
+    const size_t values = conversions * adc.channels * 2;
+    if(adc.mux_used || adc.channels == 0 || (adc.dual && (adc.channels & 1))
+       || samplerate <= 0.f
+       || conversions == 0 || conversions > 256
+       || block_size % conversions != 0 || values > DSY_ADC_SYNC_BUFFER_SIZE)
+        return false;
+
+    // TIM15 runs at 2x PClk2, a 16 bit counter
+    const float    rate  = samplerate * conversions / block_size;
+    const uint32_t ticks = uint32_t(System::GetPClk2Freq() * 2 / rate);
+    if(ticks < 2)
+        return false;
+    Stop();
+
+    // One pulse mode with a repetition counter: after OnAudioBlock()
+    // starts it, OC1REF rises once per period, and the counter stops after
+    // the last conversion of the block. PWM mode 2 keeps OC1REF low while
+    // it's stopped, so there's no extra edge.
+    const uint32_t prescaler = ticks >> 16;
+    __HAL_RCC_TIM15_CLK_ENABLE();
+    adc.htim15.Instance               = TIM15;
+    adc.htim15.Init.Prescaler         = prescaler;
+    adc.htim15.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    adc.htim15.Init.Period            = ticks / (prescaler + 1) - 1;
+    adc.htim15.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    adc.htim15.Init.RepetitionCounter = conversions - 1;
+    adc.htim15.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if(HAL_TIM_PWM_Init(&adc.htim15) != HAL_OK)
+        return false;
+
+    TIM_OC_InitTypeDef oc = {0};
+    oc.OCMode             = TIM_OCMODE_PWM2;
+    oc.Pulse              = 1;
+    oc.OCPolarity         = TIM_OCPOLARITY_HIGH;
+    oc.OCFastMode         = TIM_OCFAST_DISABLE;
+    if(HAL_TIM_PWM_ConfigChannel(&adc.htim15, &oc, TIM_CHANNEL_1) != HAL_OK)
+        return false;
+
+    TIM_MasterConfigTypeDef master = {0};
+    master.MasterOutputTrigger     = TIM_TRGO_OC1REF;
+    master.MasterOutputTrigger2    = TIM_TRGO2_RESET;
+    master.MasterSlaveMode         = TIM_MASTERSLAVEMODE_DISABLE;
+    if(HAL_TIMEx_MasterConfigSynchronization(&adc.htim15, &master)
+       != HAL_OK)
+        return false;
+    SET_BIT(TIM15->CR1, TIM_CR1_OPM);
+
+    adc_set_trigger(true);
+    if(!adc_init_converters())
+        return false;
+    adc.sync_conversions = conversions;
+    adc.sync_ready       = nullptr;
+    adc.synced           = true;
+    // two values per transfer in MODE_DUAL
+    adc_start_dma((uint32_t*)adc1_sync_buffer.Data(),
+                  adc.dual ? values / 2 : values);
+    return true;
+}
+
+void AdcHandle::OnAudioBlock()
+{
+    if(adc.synced && !READ_BIT(TIM15->CR1, TIM_CR1_CEN))
+        SET_BIT(TIM15->CR1, TIM_CR1_CEN);
+}
+
+const uint16_t* AdcHandle::GetSyncBlock() const
+{
+    return adc.sync_ready;
+}
+
+size_t AdcHandle::GetSyncConversions() const
+{
+    return adc.sync_conversions;
+}
+
+bool AdcHandle::StartStream(AdcChannelConfig* cfg,
+                            size_t            num_channels,
+                            float             samplerate,
+                            size_t            block_size,
+                            StreamCallback    callback,
+                            void*             context,
+                            OverSampling      ovs)
+{
+    if(cfg == nullptr || adc.dual || num_channels == 0
+       || num_channels > DSY_ADC_STREAM_MAX_CHANNELS || block_size == 0
+       || block_size > DSY_ADC_STREAM_MAX_BLOCK || samplerate <= 0.f)
+        return false;
+    // TIM8 runs at 2x PClk2, a 16 bit counter
+    const uint32_t ticks = uint32_t(System::GetPClk2Freq() * 2 / samplerate);
+    if(ticks < 2)
+        return false;
+    uint32_t channels[DSY_ADC_STREAM_MAX_CHANNELS];
+    for(size_t i = 0; i < num_channels; i++)
+    {
+        // channels 16 and 17 of ADC2 are the DAC outputs
+        channels[i] = adc_channel_from_pin(&cfg[i].pin_.pin);
+        if(cfg[i].mux_channels_ > 0 || channels[i] == 0
+           || channels[i] == ADC_CHANNEL_16 || channels[i] == ADC_CHANNEL_17)
+            return false;
+    }
+    StopStream();
+
+    // ADC2 only converts the injected group, on the rising edge of TRGO
+    __HAL_RCC_ADC12_CLK_ENABLE();
+    ADC_HandleTypeDef& hadc            = adc_stream.hadc2;
+    hadc.Instance                      = ADC2;
+    hadc.Init.ClockPrescaler           = ADC_CLOCK_ASYNC_DIV2;
+    hadc.Init.Resolution               = ADC_RESOLUTION_16B;
+    hadc.Init.ScanConvMode             = ADC_SCAN_ENABLE;
+    hadc.Init.EOCSelection             = ADC_EOC_SEQ_CONV;
+    hadc.Init.LowPowerAutoWait         = DISABLE;
+    hadc.Init.ContinuousConvMode       = DISABLE;
+    hadc.Init.NbrOfConversion          = 1;
+    hadc.Init.DiscontinuousConvMode    = DISABLE;
+    hadc.Init.ExternalTrigConv         = ADC_SOFTWARE_START;
+    hadc.Init.ExternalTrigConvEdge     = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadc.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DR;
+    hadc.Init.Overrun                  = ADC_OVR_DATA_OVERWRITTEN;
+    hadc.Init.LeftBitShift             = ADC_LEFTBITSHIFT_NONE;
+    hadc.Init.OversamplingMode         = DISABLE;
+    if(HAL_ADC_Init(&hadc) != HAL_OK)
+        return false;
+
+    ADC_InjectionConfTypeDef inj      = {0};
+    inj.InjectedSingleDiff            = ADC_SINGLE_ENDED;
+    inj.InjectedOffsetNumber          = ADC_OFFSET_NONE;
+    inj.InjectedNbrOfConversion       = num_channels;
+    inj.InjectedDiscontinuousConvMode = DISABLE;
+    inj.AutoInjectedConv              = DISABLE;
+    inj.QueueInjectedContext          = DISABLE;
+    inj.ExternalTrigInjecConv         = ADC_EXTERNALTRIGINJEC_T8_TRGO;
+    inj.ExternalTrigInjecConvEdge     = ADC_EXTERNALTRIGINJECCONV_EDGE_RISING;
+    inj.InjecOversamplingMode         = DISABLE;
+    if(ovs != OVS_NONE && ovs < OVS_LAST)
+    {
+        inj.InjecOversamplingMode = ENABLE;
+        adc_get_oversampling(ovs,
+                             inj.InjecOversampling.Ratio,
+                             inj.InjecOversampling.RightBitShift);
+    }
+    for(size_t i = 0; i < num_channels; i++)
+    {
+        dsy_gpio_init(&cfg[i].pin_);
+        inj.InjectedChannel      = channels[i];
+        inj.InjectedRank         = dsy_adc_injected_rank_map[i];
+        inj.InjectedSamplingTime = adc_sampling_time(cfg[i].speed_);
+        if(HAL_ADCEx_InjectedConfigChannel(&hadc, &inj) != HAL_OK)
+            return false;
+    }
+
+    // TIM8 sets the samplerate
+    const uint32_t     prescaler = ticks >> 16;
+    const uint32_t     period    = ticks / (prescaler + 1);
+    TIM_HandleTypeDef& htim      = adc_stream.htim8;
+    __HAL_RCC_TIM8_CLK_ENABLE();
+    htim.Instance               = TIM8;
+    htim.Init.Prescaler         = prescaler;
+    htim.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    htim.Init.Period            = period - 1;
+    htim.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    htim.Init.RepetitionCounter = 0;
+    htim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if(HAL_TIM_Base_Init(&htim) != HAL_OK)
+        return false;
+    TIM_MasterConfigTypeDef master = {0};
+    master.MasterOutputTrigger     = TIM_TRGO_UPDATE;
+    master.MasterOutputTrigger2    = TIM_TRGO2_RESET;
+    master.MasterSlaveMode         = TIM_MASTERSLAVEMODE_DISABLE;
+    if(HAL_TIMEx_MasterConfigSynchronization(&htim, &master) != HAL_OK)
+        return false;
+
+    adc_stream.callback   = callback;
+    adc_stream.context    = context;
+    adc_stream.channels   = num_channels;
+    adc_stream.block_size = block_size;
+    adc_stream.pos        = 0;
+    adc_stream.write      = 0;
+    adc_stream.samplerate = float(System::GetPClk2Freq() * 2)
+                            / ((prescaler + 1) * period);
+    for(size_t i = 0; i < num_channels; i++)
+    {
+        for(size_t j = 0; j < block_size; j++)
+            adc_stream.buffer[1][i][j] = 0.f;
+        adc_stream.ready[i] = adc_stream.buffer[1][i];
+    }
+
+    HAL_ADCEx_Calibration_Start(
+        &hadc, ADC_CALIB_OFFSET_LINEARITY, ADC_SINGLE_ENDED);
+    HAL_NVIC_SetPriority(ADC_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+    if(HAL_ADCEx_InjectedStart_IT(&hadc) != HAL_OK)
+        return false;
+    adc_stream.running = true;
+    HAL_TIM_Base_Start(&htim);
+    return true;
+}
+
+void AdcHandle::StopStream()
+{
+    if(!adc_stream.running)
+        return;
+    HAL_TIM_Base_Stop(&adc_stream.htim8);
+    HAL_ADCEx_InjectedStop_IT(&adc_stream.hadc2);
+    adc_stream.running    = false;
+    adc_stream.samplerate = 0.f;
+}
+
+const float* AdcHandle::GetStreamBlock(uint8_t chn) const
+{
+    return adc_stream.running && chn < adc_stream.channels
+               ? adc_stream.ready[chn]
+               : nullptr;
+}
+
+float AdcHandle::GetStreamSampleRate() const
+{
+    return adc_stream.running ? adc_stream.samplerate : 0.f;
 }
 
 // Accessors
 
 uint16_t AdcHandle::Get(uint8_t chn) const
 {
-    return adc.dma_buffer[chn < DSY_ADC_MAX_CHANNELS ? chn : 0];
+    return *GetPtr(chn);
 }
 uint16_t* AdcHandle::GetPtr(uint8_t chn) const
 {
-    return &adc.dma_buffer[chn < DSY_ADC_MAX_CHANNELS ? chn : 0];
+    chn = chn < DSY_ADC_MAX_CHANNELS ? chn : 0;
+    return adc.filtered ? adc1_filter.GetPtr(chn) : &adc.dma_buffer[chn];
 }
 
 float AdcHandle::GetFloat(uint8_t chn) const
 {
-    return (float)adc.dma_buffer[chn < DSY_ADC_MAX_CHANNELS ? chn : 0]
-           / DSY_ADC_MAX_RESOLUTION;
+    return (float)*GetPtr(chn) / DSY_ADC_MAX_RESOLUTION;
 }
 
 uint16_t AdcHandle::GetMux(uint8_t chn, uint8_t idx) const
 {
-    return adc.mux_cache[chn < DSY_ADC_MAX_CHANNELS ? chn : 0][idx];
+    return *GetMuxPtr(chn, idx);
 }
 
 uint16_t* AdcHandle::GetMuxPtr(uint8_t chn, uint8_t idx) const
 {
-    return &adc.mux_cache[chn < DSY_ADC_MAX_CHANNELS ? chn : 0][idx];
+    chn = chn < DSY_ADC_MAX_CHANNELS ? chn : 0;
+    return adc.filtered ? adc1_filter.GetPtr(adc_mux_slot(chn, idx))
+                        : &adc.mux_cache[chn][idx];
 }
 
 float AdcHandle::GetMuxFloat(uint8_t chn, uint8_t idx) const
 {
-    return (float)adc.mux_cache[chn < DSY_ADC_MAX_CHANNELS ? chn : 0][idx]
-           / DSY_ADC_MAX_RESOLUTION;
+    return (float)*GetMuxPtr(chn, idx) / DSY_ADC_MAX_RESOLUTION;
+}
+
+void AdcHandle::SetFilter(const AdcFilter::Config& config)
+{
+    adc.filtered = false;
+    adc1_filter.Init(config, DSY_ADC_FILTER_MAX_SLOTS);
+    adc.filtered = true;
+}
+
+bool AdcHandle::IsFiltered() const
+{
+    return adc.filtered;
 }
 
 
@@ -487,19 +856,125 @@ write_mux_value(uint8_t chn, uint8_t idx, uint8_t num_mux_pins_to_write)
     }
 }
 
+// Trigger: TIM15 for StartSynced(), TIM1 after the muxes settled,
+// otherwise continuous
+static void adc_set_trigger(bool synced)
+{
+    adc.hadc1.Init.DiscontinuousConvMode    = DISABLE;
+    adc.hadc1.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DMA_CIRCULAR;
+    if(synced || adc.mux_used)
+    {
+        adc.hadc1.Init.ExternalTrigConv
+            = synced ? ADC_EXTERNALTRIG_T15_TRGO : ADC_EXTERNALTRIG_T1_TRGO;
+        adc.hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+        adc.hadc1.Init.ContinuousConvMode   = DISABLE;
+    }
+    else
+    {
+        adc.hadc1.Init.ExternalTrigConv     = ADC_SOFTWARE_START;
+        adc.hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+        adc.hadc1.Init.ContinuousConvMode   = ENABLE;
+    }
+}
+
+// Inits ADC1, and ADC2 with the same settings in MODE_DUAL
+static bool adc_init_converters()
+{
+    if(HAL_ADC_Init(&adc.hadc1) != HAL_OK)
+        return false;
+    if(!adc.dual)
+        return true;
+    adc.hadc2.Instance = ADC2;
+    adc.hadc2.Init     = adc.hadc1.Init;
+    return HAL_ADC_Init(&adc.hadc2) == HAL_OK;
+}
+
+// Calibrates the converters, and starts the conversions into a buffer
+static void adc_start_dma(uint32_t* buffer, uint32_t length)
+{
+    HAL_ADCEx_Calibration_Start(
+        &adc.hadc1, ADC_CALIB_OFFSET_LINEARITY, ADC_SINGLE_ENDED);
+    if(!adc.dual)
+    {
+        HAL_ADC_Start_DMA(&adc.hadc1, buffer, length);
+        return;
+    }
+    HAL_ADCEx_Calibration_Start(
+        &adc.hadc2, ADC_CALIB_OFFSET_LINEARITY, ADC_SINGLE_ENDED);
+    HAL_ADCEx_MultiModeStart_DMA(&adc.hadc1, buffer, length);
+}
+
+// A block of StartSynced() is complete, half 0 or 1 of the buffer
+static void adc_sync_callback(size_t half)
+{
+    const size_t    size  = adc.sync_conversions * adc.channels;
+    const uint16_t* block = adc1_sync_buffer.Data() + half * size;
+    // the most recent conversion for Get()
+    for(size_t i = 0; i < adc.channels; i++)
+        adc.dma_buffer[i] = block[size - adc.channels + i];
+    adc.sync_ready = block;
+    if(adc.filtered)
+    {
+        for(size_t i = 0; i < adc.channels; i++)
+            adc1_filter.Process(i, adc.dma_buffer[i]);
+    }
+}
+
+// Passes a sequence of conversions to the filter, before the muxes move on
+static void adc_filter_callback()
+{
+    for(size_t i = 0; i < adc.channels; i++)
+    {
+        const size_t slot = adc.mux_channels[i] > 0
+                                ? adc_mux_slot(i, adc.mux_index[i])
+                                : i;
+        adc1_filter.Process(slot, adc.dma_buffer[i]);
+    }
+}
+
+// One conversion of all streamed channels is done
+static void adc_stream_callback()
+{
+    // JDR1 to JDR4 are in a row
+    const volatile uint32_t* jdr   = &ADC2->JDR1;
+    dsy_adc_stream_block*    block = adc_stream.buffer[adc_stream.write];
+    for(size_t i = 0; i < adc_stream.channels; i++)
+        block[i][adc_stream.pos] = jdr[i] / DSY_ADC_MAX_RESOLUTION;
+    if(++adc_stream.pos < adc_stream.block_size)
+        return;
+
+    adc_stream.pos   = 0;
+    adc_stream.write = 1 - adc_stream.write;
+    for(size_t i = 0; i < adc_stream.channels; i++)
+        adc_stream.ready[i] = block[i];
+    if(adc_stream.callback)
+        adc_stream.callback(adc_stream.ready,
+                            adc_stream.channels,
+                            adc_stream.block_size,
+                            adc_stream.context);
+}
+
 static void adc_init_dma1()
 {
+    // The stream is fixed, a conflict is only recorded for the application
+    DmaStreamAllocator::Claim(
+        DmaStreamAllocator::Stream::DMA_1_STREAM_2, "adc", DMA_REQUEST_ADC1);
     adc.hdma_adc1.Instance                 = DMA1_Stream2;
     adc.hdma_adc1.Init.Request             = DMA_REQUEST_ADC1;
     adc.hdma_adc1.Init.Direction           = DMA_PERIPH_TO_MEMORY;
     adc.hdma_adc1.Init.PeriphInc           = DMA_PINC_DISABLE;
     adc.hdma_adc1.Init.MemInc              = DMA_MINC_ENABLE;
-    adc.hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
-    adc.hdma_adc1.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
-    if(adc.mux_used)
-        adc.hdma_adc1.Init.Mode = DMA_NORMAL;
+    if(adc.dual)
+    {
+        adc.hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+        adc.hdma_adc1.Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+    }
     else
-        adc.hdma_adc1.Init.Mode = DMA_CIRCULAR;
+    {
+        adc.hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        adc.hdma_adc1.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+    }
+    adc.hdma_adc1.Init.Mode     = DMA_CIRCULAR;
     adc.hdma_adc1.Init.Priority = DMA_PRIORITY_LOW;
     adc.hdma_adc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
     if(HAL_DMA_Init(&adc.hdma_adc1) != HAL_OK)
@@ -512,14 +987,12 @@ static void adc_init_dma1()
 
 // Handle Externally Multiplexed Pins
 // This is called from the CpltCallback, only when at least one multiplexor is used.
-// When this is the case the DMA is also configured in normal mode instead of circular.
-//
-// This allows the DMA to stop while the GPIO switch, and then once that is done
-// the DMA Transfer is started again. This prevents issues with data being read to the wrong channels
+// When this is the case each sequence is started by TIM1, in one pulse mode.
 //
-// We could set up everything to run from a timer and provide a few microseconds
-// to adjust pins before resuming reading, but that won't work with how everything
-// is set up right now.
+// The ADC waits for the trigger while the GPIO switch, and TIM1 triggers it
+// once the settle time passed. This prevents issues with data being read to
+// the wrong channels, and the rate is only limited by the conversions and
+// the settle time, the DMA keeps running in circular mode.
 static void adc_internal_callback()
 {
     for(uint16_t i = 0; i < adc.channels; i++)
@@ -539,9 +1012,36 @@ static void adc_internal_callback()
                 chn, adc.mux_index[chn], adc.num_mux_pins_required[chn]);
         }
     }
-    // Restart DMA
-    adc_init_dma1();
-    HAL_ADC_Start_DMA(&adc.hadc1, (uint32_t*)adc.dma_buffer, adc.channels);
+    // Start the next sequence after the settle time
+    SET_BIT(TIM1->CR1, TIM_CR1_CEN);
+}
+
+// TIM1 counts the settle time of the muxes once per start, the update at the
+// end triggers the ADC
+static void adc_init_mux_timer()
+{
+    const uint32_t clk_hz    = System::GetPClk2Freq() * 2;
+    uint32_t       ticks     = uint32_t(adc.mux_settle_us * (clk_hz / 1e6f));
+    ticks                    = ticks > 1 ? ticks : 1;
+    const uint32_t prescaler = ticks >> 16;
+
+    __HAL_RCC_TIM1_CLK_ENABLE();
+    adc.htim1.Instance               = TIM1;
+    adc.htim1.Init.Prescaler         = prescaler;
+    adc.htim1.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    adc.htim1.Init.Period            = ticks / (prescaler + 1);
+    adc.htim1.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    adc.htim1.Init.RepetitionCounter = 0;
+    adc.htim1.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if(HAL_TIM_Base_Init(&adc.htim1) != HAL_OK)
+        Error_Handler();
+    TIM_MasterConfigTypeDef master = {0};
+    master.MasterOutputTrigger     = TIM_TRGO_UPDATE;
+    master.MasterOutputTrigger2    = TIM_TRGO2_RESET;
+    master.MasterSlaveMode         = TIM_MASTERSLAVEMODE_DISABLE;
+    if(HAL_TIMEx_MasterConfigSynchronization(&adc.htim1, &master) != HAL_OK)
+        Error_Handler();
+    SET_BIT(TIM1->CR1, TIM_CR1_OPM);
 }
 
 
@@ -576,13 +1076,45 @@ void HAL_ADC_MspDeInit(ADC_HandleTypeDef* adcHandle)
 
 extern "C"
 {
-    void DMA1_Stream2_IRQHandler(void) { HAL_DMA_IRQHandler(&adc.hdma_adc1); }
+    void DMA1_Stream2_IRQHandler(void)
+    {
+        DSY_IRQ_PROFILE_SCOPE(Source::ANALOG_IN);
+        HAL_DMA_IRQHandler(&adc.hdma_adc1);
+    }
+
+    // Shared by ADC1 and ADC2, only enabled by StartStream()
+    void ADC_IRQHandler(void)
+    {
+        DSY_IRQ_PROFILE_SCOPE(Source::ANALOG_IN);
+        if(READ_BIT(ADC2->ISR, ADC_ISR_JEOS))
+        {
+            WRITE_REG(ADC2->ISR, ADC_ISR_JEOS);
+            adc_stream_callback();
+        }
+        // ADC1 is read by the DMA, its overrun interrupt was never handled
+        const uint32_t adc1_flags = ADC1->ISR & ADC1->IER;
+        if(adc1_flags)
+            WRITE_REG(ADC1->ISR, adc1_flags);
+    }
+
+    void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc)
+    {
+        if(hadc->Instance == ADC1 && adc.synced)
+            adc_sync_callback(0);
+    }
 
     void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
     {
-        if(hadc->Instance == ADC1 && adc.mux_used)
+        if(hadc->Instance == ADC1 && adc.synced)
+        {
+            adc_sync_callback(1);
+        }
+        else if(hadc->Instance == ADC1)
         {
-            adc_internal_callback();
+            if(adc.filtered)
+                adc_filter_callback();
+            if(adc.mux_used)
+                adc_internal_callback();
         }
     }
 
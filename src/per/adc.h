@@ -5,9 +5,28 @@
 #include <stdlib.h>
 #include "daisy_core.h"
 #include "per/gpio.h"
+#include "per/adc_filter.h"
 
 #define DSY_ADC_MAX_CHANNELS 16 /**< Maximum number of ADC channels */
 
+/** Default time the muxes get to settle, see AdcHandle::SetMuxSettleTime() */
+#ifndef DSY_ADC_MUX_SETTLE_US
+#define DSY_ADC_MUX_SETTLE_US 2.0f
+#endif
+
+/** Maximum channels of StartStream(), the injected group of ADC2 */
+#define DSY_ADC_STREAM_MAX_CHANNELS 4
+
+/** Maximum samples per block of StartStream() */
+#ifndef DSY_ADC_STREAM_MAX_BLOCK
+#define DSY_ADC_STREAM_MAX_BLOCK 64
+#endif
+
+/** Values in the buffer of StartSynced(), two blocks of all conversions */
+#ifndef DSY_ADC_SYNC_BUFFER_SIZE
+#define DSY_ADC_SYNC_BUFFER_SIZE 512
+#endif
+
 namespace daisy
 {
 /** @addtogroup per_analog
@@ -106,23 +125,185 @@ class AdcHandle
         OVS_LAST, /**< & */
     };
 
+    /** Converters used by Init() */
+    enum ConverterMode
+    {
+        /** ADC1 converts all channels, one after another */
+        MODE_SINGLE,
+        /** ADC1 and ADC2 convert two channels at the same time, the even
+         *  ones on ADC1 and the odd ones on ADC2, which about doubles the
+         *  rate per channel. Falls back to MODE_SINGLE when there's only
+         *  one channel, or an odd one is only connected to ADC1 (PA0, PA1).
+         *  StartStream() can't be used with it.
+         */
+        MODE_DUAL,
+    };
+
+    /** Called by StartStream() for every block, from the ADC interrupt
+     *  \param data num_channels arrays of size values, from 0 to 1
+     *  \param num_channels number of streamed channels
+     *  \param size samples per channel
+     *  \param context as passed to StartStream()
+     */
+    typedef void (*StreamCallback)(const float *const *data,
+                                   size_t              num_channels,
+                                   size_t              size,
+                                   void               *context);
+
     AdcHandle() {}
     ~AdcHandle() {}
     /** 
     Initializes the ADC with the pins passed in.
+    The oversampling is shared by all channels, the converters have one
+    setting each. Inputs that need a low latency can take a short sample
+    time per channel (AdcChannelConfig::ConversionSpeed), or be streamed
+    by StartStream() with their own oversampling.
     \param *cfg an array of AdcChannelConfig of the desired channel
     \param num_channels number of ADC channels to initialize
     \param ovs Oversampling amount - Defaults to OVS_32
+    \param mode converters to split the channels over - Defaults to
+           MODE_SINGLE
+    */
+    void Init(AdcChannelConfig *cfg,
+              size_t            num_channels,
+              OverSampling      ovs  = OVS_32,
+              ConverterMode     mode = MODE_SINGLE);
+
+    /** Returns true if Init() set up the ADCs in MODE_DUAL */
+    bool IsDualMode() const;
+
+    /** Filters the conversions of Init() in the ADC's DMA interrupt, see
+    AdcFilter. Get(), GetPtr(), GetMux() and the others then return the
+    filtered values, which are stable while a knob rests and follow a fast
+    turn with little lag, so AnalogControl and ControlBank can run without
+    smoothing, e.g. with a slew time of 0.
+
+    Call it after Init(), before the pointers of GetPtr() and GetMuxPtr()
+    are taken, e.g. by AnalogControl::Init(). The ones taken before still
+    point to the raw conversions. After StartSynced() the filter runs once
+    per block, on the last conversion. Init() turns it off again.
     */
-    void
-    Init(AdcChannelConfig *cfg, size_t num_channels, OverSampling ovs = OVS_32);
+    void SetFilter(const AdcFilter::Config &config = AdcFilter::Config());
+
+    /** Returns true after SetFilter() */
+    bool IsFiltered() const;
 
     /** Starts reading from the ADC */
     void Start();
 
-    /** Stops reading from the ADC */
+    /** Sets the time between switching the muxes and converting the next
+    sequence, for the slew of the mux and the input filter.
+
+    Muxed inputs are scanned by TIM1: after each sequence the muxes move
+    to their next input, and TIM1 starts the next sequence once this time
+    has passed. That makes the rate of each mux input
+    1 / ((conversion time of the sequence + settle time) * mux channels).
+    Call it after Init(), it takes effect with the next Start().
+    \param settle_us settle time in microseconds,
+           defaults to DSY_ADC_MUX_SETTLE_US
+    */
+    void SetMuxSettleTime(float settle_us);
+
+    /** Stops reading from the ADC, also after StartSynced() */
     void Stop();
 
+    /** Starts reading from the ADC in step with the audio blocks.
+
+    Instead of converting continuously, the ADC converts all channels a
+    fixed number of times per audio block, started by OnAudioBlock() from
+    the audio callback. TIM15 spaces the conversions evenly over the block,
+    from the audio samplerate, and stops after the last one, so they don't
+    drift against the audio and each block holds the same number of them.
+
+    GetSyncBlock() returns the conversions of the previous block, the
+    value of conversion i is the CV at sample i * block_size / conversions
+    of that block. Get() and GetFloat() return the most recent conversion.
+
+    \code
+    hw.adc.StartSynced(hw.AudioSampleRate(), hw.AudioBlockSize(), 4);
+
+    void AudioCallback(AudioHandle::InputBuffer  in,
+                       AudioHandle::OutputBuffer out,
+                       size_t                    size)
+    {
+        hw.adc.OnAudioBlock();
+        const uint16_t* cv = hw.adc.GetSyncBlock();
+        // cv[i * num_channels + chn], for i < 4
+    }
+    \endcode
+
+    Multiplexed inputs aren't supported, and all channels with the
+    oversampling have to convert within 1 / (samplerate / block_size *
+    conversions) seconds.
+
+    \param samplerate audio samplerate in Hz
+    \param block_size samples per audio block
+    \param conversions conversions of all channels per block, from 1 (once
+           per block) to block_size (once per sample), dividing block_size
+    \return false if there are muxed inputs, an odd number of channels in
+            MODE_DUAL, or the settings or the buffer
+            (DSY_ADC_SYNC_BUFFER_SIZE) don't fit
+    */
+    bool StartSynced(float samplerate, size_t block_size, size_t conversions);
+
+    /** Starts the conversions of one block, after StartSynced(). Call it
+     *  at the start of every audio callback. Ignored while the conversions
+     *  of the block before are still running.
+     */
+    void OnAudioBlock();
+
+    /** Returns the conversions of the last complete block after
+     *  StartSynced(), num_channels values per conversion, or nullptr
+     *  before the first block.
+     */
+    const uint16_t *GetSyncBlock() const;
+
+    /** Returns the conversions per block of StartSynced(), 0 when it isn't
+     *  running */
+    size_t GetSyncConversions() const;
+
+    /** Streams up to four channels at audio rate, e.g. for FM or AM inputs.
+
+    The stream uses ADC2, triggered by TIM8, next to the channels of
+    Init() on ADC1, so muxed and other channels keep their own rate. Each
+    conversion of all streamed channels is stored as floats into one of two
+    blocks, when a block is full the callback gets it and the next one is
+    written. All DMA streams are in use, so this takes one interrupt per
+    sample, which is fine up to 48 kHz.
+
+    The pins must not be in the Init() channels, muxed inputs and pins
+    only connected to ADC1 (PA0, PA1) aren't supported.
+
+    \param cfg channels to stream, set up with InitSingle()
+    \param num_channels 1 to DSY_ADC_STREAM_MAX_CHANNELS
+    \param samplerate conversions per second, e.g. 8000 to 48000
+    \param block_size samples per callback, up to DSY_ADC_STREAM_MAX_BLOCK
+    \param callback called with every block, can be nullptr
+    \param context passed to the callback
+    \param ovs oversampling of the streamed channels, independent of the
+           one of Init(). Each sample takes ovs conversions of every channel.
+    \return false if a channel or setting isn't supported, or Init() is in
+            MODE_DUAL
+    */
+    bool StartStream(AdcChannelConfig *cfg,
+                     size_t            num_channels,
+                     float             samplerate,
+                     size_t            block_size,
+                     StreamCallback    callback = nullptr,
+                     void             *context  = nullptr,
+                     OverSampling      ovs      = OVS_NONE);
+
+    /** Stops the stream of StartStream() */
+    void StopStream();
+
+    /** Returns the last complete block of a streamed channel, block_size
+     *  values from 0 to 1, or nullptr if the channel isn't streamed */
+    const float *GetStreamBlock(uint8_t chn) const;
+
+    /** Returns the samplerate of the stream, which the timer can only
+     *  approximate, or 0 when it isn't running */
+    float GetStreamSampleRate() const;
+
     /** 
     Single channel getter
     \param chn channel to get
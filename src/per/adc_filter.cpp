@@ -0,0 +1,68 @@
+#include "per/adc_filter.h"
+
+using namespace daisy;
+
+void AdcFilter::Init(const Config& config, size_t num_slots)
+{
+    config_ = config;
+    if(config_.decimation == 0)
+        config_.decimation = 1;
+    if(config_.min_coeff < 0.f)
+        config_.min_coeff = 0.f;
+    if(config_.min_coeff > 1.f)
+        config_.min_coeff = 1.f;
+    num_slots_ = num_slots < DSY_ADC_FILTER_MAX_SLOTS
+                     ? num_slots
+                     : DSY_ADC_FILTER_MAX_SLOTS;
+    inv_decimation_ = 1.f / config_.decimation;
+    coeff_slope_    = config_.fast_slew > 0.f
+                          ? (1.f - config_.min_coeff) / config_.fast_slew
+                          : 0.f;
+    for(size_t i = 0; i < DSY_ADC_FILTER_MAX_SLOTS; i++)
+    {
+        sum_[i]    = 0;
+        state_[i]  = 0.f;
+        out_[i]    = 0;
+        count_[i]  = 0;
+        primed_[i] = false;
+    }
+}
+
+uint16_t AdcFilter::Process(size_t slot, uint16_t value)
+{
+    if(slot >= num_slots_)
+        return 0;
+    if(!primed_[slot])
+    {
+        // start at the first value, rather than ramping up from 0
+        state_[slot]  = value;
+        out_[slot]    = value;
+        primed_[slot] = true;
+        return value;
+    }
+    sum_[slot] += value;
+    if(++count_[slot] < config_.decimation)
+        return out_[slot];
+
+    const float avg = sum_[slot] * inv_decimation_;
+    sum_[slot]      = 0;
+    count_[slot]    = 0;
+
+    const float delta = avg - state_[slot];
+    const float slew  = delta < 0.f ? -delta : delta;
+    float       coeff = config_.fast_slew > 0.f
+                            ? config_.min_coeff + slew * coeff_slope_
+                            : 1.f;
+    coeff = coeff < 1.f ? coeff : 1.f;
+    state_[slot] += coeff * delta;
+
+    // a fast move passes the hysteresis, a resting input stays put
+    const float diff = state_[slot] - out_[slot];
+    const float dist = diff < 0.f ? -diff : diff;
+    if(dist > config_.hysteresis || slew * 2.f >= config_.fast_slew)
+    {
+        const float rounded = state_[slot] + 0.5f;
+        out_[slot] = rounded >= 65535.f ? 65535 : uint16_t(rounded);
+    }
+    return out_[slot];
+}
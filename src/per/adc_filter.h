@@ -0,0 +1,104 @@
+#pragma once
+#ifndef DSY_ADC_FILTER_H
+#define DSY_ADC_FILTER_H
+#include <stddef.h>
+#include <stdint.h>
+
+/** Inputs an AdcFilter can hold, enough for every channel and mux input of
+ *  the AdcHandle */
+#ifndef DSY_ADC_FILTER_MAX_SLOTS
+#define DSY_ADC_FILTER_MAX_SLOTS (16 * (1 + 8))
+#endif
+
+namespace daisy
+{
+/** @brief Decimating, slew adaptive filter for pots and CVs
+ *  @ingroup peripheral
+ *  @details A fixed one pole lowpass needs a long time constant to hide the
+ *           noise of a resting knob, and then lags behind a fast turn. This
+ *           filter averages a number of conversions per step (decimation),
+ *           then lowpasses the averages with a coefficient that follows the
+ *           input's slew: small changes, i.e. noise, are smoothed heavily,
+ *           and large ones pass almost at once. A hysteresis keeps the
+ *           output of a resting input from moving at all.
+ *
+ *           The AdcHandle runs it on every conversion of its DMA, see
+ *           AdcHandle::SetFilter(), and the filtered values are read with
+ *           the usual getters, so the controls need no smoothing (and no
+ *           work) of their own.
+ *
+ *           Each input (slot) keeps its own state. The filter uses 16 bit
+ *           values, like the converters with oversampling.
+ */
+class AdcFilter
+{
+  public:
+    struct Config
+    {
+        /** Conversions averaged per filter step, 1 to 255 */
+        uint8_t decimation = 4;
+
+        /** Lowpass coefficient per step while the input changes little,
+         *  from 0 (frozen) to 1 (no smoothing)
+         */
+        float min_coeff = 0.05f;
+
+        /** Change per step, in 16 bit steps, from which the input passes
+         *  without smoothing. Between 0 and this the coefficient rises
+         *  from min_coeff to 1.
+         */
+        float fast_slew = 1024.f;
+
+        /** Steps of the smoothed value the output ignores, as long as the
+         *  input changes slower than fast_slew / 2
+         */
+        uint16_t hysteresis = 24;
+    };
+
+    AdcFilter() : num_slots_(0) {}
+    ~AdcFilter() {}
+
+    /** Clears the state of all slots, the next value of each sets its
+     *  output directly
+     *  \param num_slots inputs used, up to DSY_ADC_FILTER_MAX_SLOTS
+     */
+    void Init(const Config& config, size_t num_slots);
+
+    /** Adds a conversion of an input, a filter step runs every
+     *  Config::decimation of them
+     *  \return the output of the slot
+     */
+    uint16_t Process(size_t slot, uint16_t value);
+
+    /** Returns the output of a slot */
+    uint16_t Get(size_t slot) const
+    {
+        return out_[slot < num_slots_ ? slot : 0];
+    }
+
+    /** Returns a pointer to the output of a slot, e.g. for AnalogControl */
+    uint16_t* GetPtr(size_t slot)
+    {
+        return &out_[slot < num_slots_ ? slot : 0];
+    }
+
+    /** Returns the number of slots of Init() */
+    size_t GetNumSlots() const { return num_slots_; }
+
+    const Config& GetConfig() const { return config_; }
+
+  private:
+    Config   config_;
+    size_t   num_slots_;
+    float    inv_decimation_;
+    float    coeff_slope_;
+    uint32_t sum_[DSY_ADC_FILTER_MAX_SLOTS];
+    float    state_[DSY_ADC_FILTER_MAX_SLOTS];
+    uint16_t out_[DSY_ADC_FILTER_MAX_SLOTS];
+    uint8_t  count_[DSY_ADC_FILTER_MAX_SLOTS];
+    bool     primed_[DSY_ADC_FILTER_MAX_SLOTS];
+};
+
+} // namespace daisy
+
+#endif
@@ -1,7 +1,11 @@
+#include "sys/dma_streams.h"
+#include "sys/irq_priority.h"
 #include "sys/system.h"
 #include "per/gpio.h"
 #include "per/tim.h"
 #include "per/dac.h"
+#include "util/DmaBuffer.h"
+#include "util/IrqProfiler.h"
 
 extern "C"
 {
@@ -24,6 +28,14 @@ class DacHandle::Impl
                             DacHandle::DacCallback cb);
     DacHandle::Result Stop();
     DacHandle::Result WriteValue(DacHandle::Channel chn, uint16_t val);
+    DacHandle::Result StartSynced(float samplerate, size_t block_size);
+    DacHandle::Result WriteSynced(const float *const *in, size_t size);
+    void SetCalibration(DacHandle::Channel chn, float scale, float offset);
+    DacHandle::Result StartWaveform(const uint16_t *table_1,
+                                    const uint16_t *table_2,
+                                    size_t          size,
+                                    float           frequency);
+    DacHandle::Result SetWaveformFrequency(float frequency);
 
 
     // Init Hardware (called from MspInit, etc.)
@@ -33,6 +45,8 @@ class DacHandle::Impl
 
     void InternalCalllback(Channel chn, size_t offset_state);
 
+    void UpdateConversion();
+
     inline bool ChannelOneActive() const
     {
         return config_.chn == Channel::BOTH || config_.chn == Channel::ONE;
@@ -53,8 +67,24 @@ class DacHandle::Impl
     size_t                 buff_size_;
     uint16_t *             buff_[2];
     DacHandle::DacCallback callback_;
+
+    // StartSynced() state, the write position in the ring of two blocks
+    bool     synced_;
+    size_t   sync_block_;
+    size_t   sync_write_;
+    uint32_t sync_period_;
+    float    scale_[2], offset_[2];
+    float    gain_[2], bias_[2], max_code_;
+
+    // StartWaveform() state
+    bool   waveform_;
+    size_t waveform_size_;
 };
 
+/** Two blocks per channel, the ring of StartSynced() */
+static DmaBuffer<uint16_t, DSY_DAC_SYNC_MAX_BLOCK * 2> DMA_BUFFER_MEM_SECTION
+    dac_sync_buffer[2];
+
 // ================================================================
 // Generic Error Handler
 // ================================================================
@@ -82,7 +112,15 @@ static DacHandle::Impl dac_handle;
 DacHandle::Result DacHandle::Impl::Init(const DacHandle::Config &config)
 {
     DAC_ChannelConfTypeDef dac_config;
-    config_ = config;
+    config_   = config;
+    synced_   = false;
+    waveform_ = false;
+    for(size_t i = 0; i < 2; i++)
+    {
+        scale_[i]  = 1.f;
+        offset_[i] = 0.f;
+    }
+    UpdateConversion();
     // Init the actual peripheral
     hal_dac_.Instance = DAC1;
     HAL_DAC_Init(&hal_dac_);
@@ -206,6 +244,218 @@ DacHandle::Result DacHandle::Impl::Stop()
         HAL_DAC_Stop_DMA(&hal_dac_, DAC_CHANNEL_1);
     if(ChannelTwoActive())
         HAL_DAC_Stop_DMA(&hal_dac_, DAC_CHANNEL_2);
+    if(synced_ || waveform_)
+    {
+        // back to the period of Init()
+        HAL_TIM_Base_Stop(&hal_tim_);
+        CLEAR_BIT(hal_tim_.Instance->CR1, TIM_CR1_ARPE);
+        hal_tim_.Instance->PSC = hal_tim_.Init.Prescaler;
+        hal_tim_.Instance->ARR = hal_tim_.Init.Period;
+        // the prescaler is buffered, load it before the next start
+        __HAL_TIM_SET_COUNTER(&hal_tim_, 0);
+        hal_tim_.Instance->EGR = TIM_EGR_UG;
+        synced_                = false;
+        waveform_              = false;
+    }
+    return Result::OK;
+}
+
+void DacHandle::Impl::UpdateConversion()
+{
+    // the +0.5 rounds the cast to the nearest code
+    max_code_ = config_.bitdepth == BitDepth::BITS_8 ? 255.f : 4095.f;
+    for(size_t i = 0; i < 2; i++)
+    {
+        gain_[i] = scale_[i] * max_code_;
+        bias_[i] = offset_[i] * max_code_ + 0.5f;
+    }
+}
+
+void DacHandle::Impl::SetCalibration(DacHandle::Channel chn,
+                                     float              scale,
+                                     float              offset)
+{
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(chn == Channel::BOTH || (chn == Channel::TWO) == (i == 1))
+        {
+            scale_[i]  = scale;
+            offset_[i] = offset;
+        }
+    }
+    UpdateConversion();
+}
+
+DacHandle::Result DacHandle::Impl::StartSynced(float samplerate,
+                                               size_t block_size)
+{
+    if(config_.mode != Mode::DMA || samplerate <= 0.f || block_size == 0
+       || block_size > DSY_DAC_SYNC_MAX_BLOCK)
+        return Result::ERR;
+    Stop();
+
+    // the same tick as Init(), without its rounding down
+    const float ticks = float(System::GetPClk2Freq()) / samplerate;
+    if(ticks < 2.f || ticks > 65536.f)
+        return Result::ERR;
+    sync_period_ = uint32_t(ticks + 0.5f) - 1;
+    HAL_TIM_Base_Stop(&hal_tim_);
+    __HAL_TIM_SET_COUNTER(&hal_tim_, 0);
+    hal_tim_.Instance->ARR = sync_period_;
+    // the period is changed while the timer runs
+    SET_BIT(hal_tim_.Instance->CR1, TIM_CR1_ARPE);
+
+    // idle at the output of 0.0 until the first block
+    const size_t ring = block_size * 2;
+    for(size_t i = 0; i < 2; i++)
+    {
+        const float v = bias_[i] < 0.f ? 0.f : bias_[i];
+        for(size_t j = 0; j < ring; j++)
+            dac_sync_buffer[i][j] = uint16_t(v > max_code_ ? max_code_ : v);
+    }
+    sync_block_ = block_size;
+    sync_write_ = ring;
+    callback_   = nullptr;
+
+    const uint32_t bd = config_.bitdepth == BitDepth::BITS_8 ? DAC_ALIGN_8B_R
+                                                             : DAC_ALIGN_12B_R;
+    if(ChannelOneActive())
+        HAL_DAC_Start_DMA(&hal_dac_,
+                          DAC_CHANNEL_1,
+                          (uint32_t *)dac_sync_buffer[0].Data(),
+                          ring,
+                          bd);
+    if(ChannelTwoActive())
+        HAL_DAC_Start_DMA(&hal_dac_,
+                          DAC_CHANNEL_2,
+                          (uint32_t *)dac_sync_buffer[1].Data(),
+                          ring,
+                          bd);
+    HAL_TIM_Base_Start(&hal_tim_);
+    synced_ = true;
+    return Result::OK;
+}
+
+DacHandle::Result DacHandle::Impl::StartWaveform(const uint16_t *table_1,
+                                                 const uint16_t *table_2,
+                                                 size_t          size,
+                                                 float           frequency)
+{
+    if(config_.mode != Mode::DMA || table_1 == nullptr || size < 2)
+        return Result::ERR;
+    Stop();
+    HAL_TIM_Base_Stop(&hal_tim_);
+    waveform_size_ = size;
+    waveform_      = true;
+    if(SetWaveformFrequency(frequency) != Result::OK)
+    {
+        waveform_ = false;
+        return Result::ERR;
+    }
+    // load the new prescaler and period before the start
+    __HAL_TIM_SET_COUNTER(&hal_tim_, 0);
+    hal_tim_.Instance->EGR = TIM_EGR_UG;
+    callback_              = nullptr;
+
+    const uint32_t bd = config_.bitdepth == BitDepth::BITS_8 ? DAC_ALIGN_8B_R
+                                                             : DAC_ALIGN_12B_R;
+    const bool      two       = config_.chn == Channel::BOTH && table_2;
+    const uint16_t *tables[2] = {table_1, two ? table_2 : table_1};
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(i == 0 ? !ChannelOneActive() : !ChannelTwoActive())
+            continue;
+        HAL_DAC_Start_DMA(&hal_dac_,
+                          i == 0 ? DAC_CHANNEL_1 : DAC_CHANNEL_2,
+                          (uint32_t *)tables[i],
+                          size,
+                          bd);
+        // the DMA loops over the table by itself, no interrupts needed
+        __HAL_DMA_DISABLE_IT(&hal_dac_dma_[i], DMA_IT_HT | DMA_IT_TC);
+    }
+    HAL_TIM_Base_Start(&hal_tim_);
+    return Result::OK;
+}
+
+DacHandle::Result DacHandle::Impl::SetWaveformFrequency(float frequency)
+{
+    if(!waveform_ || frequency <= 0.f)
+        return Result::ERR;
+
+    // timer clock is PClk2 * 2, split into a prescaler and a 16-bit period
+    const float clocks = 2.f * System::GetPClk2Freq()
+                         / (frequency * float(waveform_size_));
+    if(clocks < 2.f || clocks > 65536.f * 65536.f)
+        return Result::ERR;
+    const uint32_t prescaler = uint32_t(clocks / 65536.f);
+    const uint32_t period    = uint32_t(clocks / (prescaler + 1) + 0.5f);
+
+    // both are buffered, and take effect at the end of the current period
+    SET_BIT(hal_tim_.Instance->CR1, TIM_CR1_ARPE);
+    hal_tim_.Instance->PSC = prescaler;
+    hal_tim_.Instance->ARR = period > 1 ? period - 1 : 1;
+    return Result::OK;
+}
+
+/** Converts to DAC codes, gain and bias include the calibration */
+static void dac_convert(uint16_t *   dst,
+                        const float *src,
+                        size_t       size,
+                        float        gain,
+                        float        bias,
+                        float        max_code)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        float v = src[i] * gain + bias;
+        v       = v < 0.f ? 0.f : (v > max_code ? max_code : v);
+        dst[i]  = uint16_t(v);
+    }
+}
+
+DacHandle::Result DacHandle::Impl::WriteSynced(const float *const *in,
+                                               size_t              size)
+{
+    if(!synced_ || in == nullptr || size != sync_block_)
+        return Result::ERR;
+
+    // samples the DMA has to output before it gets to the write position
+    const size_t ring = sync_block_ * 2;
+    const size_t half = sync_block_ / 2;
+    DMA_HandleTypeDef *hdma
+        = ChannelOneActive() ? &hal_dac_dma_[0] : &hal_dac_dma_[1];
+    const size_t read = (ring - __HAL_DMA_GET_COUNTER(hdma)) % ring;
+    size_t       lead = (sync_write_ + ring - read) % ring;
+    if(sync_write_ >= ring || lead == 0 || lead > sync_block_)
+    {
+        // first block, or a block was missed: half a block ahead again
+        sync_write_ = (read + half) % ring;
+        lead        = half;
+    }
+
+    // the DMA should be half a block before the write position, a shorter
+    // timer period catches up, a longer one falls back
+    uint32_t period = sync_period_;
+    if(lead > half + 1)
+        period--;
+    else if(lead + 1 < half)
+        period++;
+    hal_tim_.Instance->ARR = period;
+
+    const size_t first = ring - sync_write_ < size ? ring - sync_write_ : size;
+    size_t       chn   = 0;
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(i == 0 ? !ChannelOneActive() : !ChannelTwoActive())
+            continue;
+        const float *src = in[chn++];
+        uint16_t *   dst = dac_sync_buffer[i].Data();
+        dac_convert(
+            dst + sync_write_, src, first, gain_[i], bias_[i], max_code_);
+        dac_convert(
+            dst, src + first, size - first, gain_[i], bias_[i], max_code_);
+    }
+    sync_write_ = (sync_write_ + size) % ring;
     return Result::OK;
 }
 
@@ -265,6 +515,10 @@ void DacHandle::Impl::InitDma()
         if(ChannelOneActive())
         {
             // Configure and Initialize channel 1 DMA
+            DmaStreamAllocator::Claim(
+                DmaStreamAllocator::Stream::DMA_2_STREAM_0,
+                "dac",
+                DMA_REQUEST_DAC1);
             hdma                           = &hal_dac_dma_[0];
             hdma->Instance                 = DMA2_Stream0;
             hdma->Init.Request             = DMA_REQUEST_DAC1;
@@ -285,6 +539,10 @@ void DacHandle::Impl::InitDma()
         if(ChannelTwoActive())
         {
             // Configure and Initialize channel 2 DMA
+            DmaStreamAllocator::Claim(
+                DmaStreamAllocator::Stream::DMA_2_STREAM_1,
+                "dac",
+                DMA_REQUEST_DAC2);
             hdma                           = &hal_dac_dma_[1];
             hdma->Instance                 = DMA2_Stream1;
             hdma->Init.Request             = DMA_REQUEST_DAC2;
@@ -366,7 +624,7 @@ extern "C" void HAL_DAC_MspInit(DAC_HandleTypeDef *hdac)
         dac_handle.InitDma();
 
         // This stuff is more relevant to TIM6, but makes more sense to be enabled here.
-        HAL_NVIC_SetPriority(TIM6_DAC_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(TIM6_DAC_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
     }
 }
@@ -386,18 +644,21 @@ extern "C" void HAL_DAC_MspDeInit(DAC_HandleTypeDef *hdac)
 
 extern "C" void DMA2_Stream0_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::ANALOG_OUT);
     // DAC1 Ch1 IRQ Handler
     HAL_DMA_IRQHandler(&dac_handle.hal_dac_dma_[0]);
 }
 
 extern "C" void DMA2_Stream1_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::ANALOG_OUT);
     // DAC1 Ch2 IRQ Handler
     HAL_DMA_IRQHandler(&dac_handle.hal_dac_dma_[1]);
 }
 
 extern "C" void TIM6_DAC_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::ANALOG_OUT);
     HAL_DAC_IRQHandler(&dac_handle.hal_dac_);
     HAL_TIM_IRQHandler(&dac_handle.hal_tim_);
 }
@@ -471,5 +732,33 @@ DacHandle::Result DacHandle::WriteValue(DacHandle::Channel chn, uint16_t val)
     return pimpl_->WriteValue(chn, val);
 }
 
+DacHandle::Result DacHandle::StartSynced(float samplerate, size_t block_size)
+{
+    return pimpl_->StartSynced(samplerate, block_size);
+}
+
+DacHandle::Result DacHandle::WriteSynced(const float *const *in, size_t size)
+{
+    return pimpl_->WriteSynced(in, size);
+}
+
+void DacHandle::SetCalibration(Channel chn, float scale, float offset)
+{
+    pimpl_->SetCalibration(chn, scale, offset);
+}
+
+DacHandle::Result DacHandle::StartWaveform(const uint16_t *table,
+                                           size_t          size,
+                                           float           frequency,
+                                           const uint16_t *table_2)
+{
+    return pimpl_->StartWaveform(table, table_2, size, frequency);
+}
+
+DacHandle::Result DacHandle::SetWaveformFrequency(float frequency)
+{
+    return pimpl_->SetWaveformFrequency(frequency);
+}
+
 
 } // namespace daisy
@@ -4,6 +4,11 @@
 
 #include "daisy_core.h"
 
+/** Maximum samples per block of DacHandle::StartSynced() */
+#ifndef DSY_DAC_SYNC_MAX_BLOCK
+#define DSY_DAC_SYNC_MAX_BLOCK 256
+#endif
+
 namespace daisy
 {
 /** @brief DAC handle for Built-in DAC Peripheral 
@@ -111,9 +116,81 @@ class DacHandle
     Result
     Start(uint16_t *buffer_1, uint16_t *buffer_2, size_t size, DacCallback cb);
 
-    /** Stops the DAC channel(s). */
+    /** Stops the DAC channel(s), also after StartSynced() and
+     ** StartWaveform(). */
     Result Stop();
 
+    /** Starts streaming float blocks from the audio callback, in DMA mode.
+     **
+     ** TIM6 runs at the audio samplerate, and WriteSynced() adjusts its
+     ** period by one tick when the DMA runs ahead of or behind the audio
+     ** blocks, so the outputs stay locked to the audio instead of drifting
+     ** against it. The samples of a block are output half a block after it
+     ** was written.
+     **
+     ** \code
+     ** hw.dac.StartSynced(hw.AudioSampleRate(), hw.AudioBlockSize());
+     **
+     ** void AudioCallback(AudioHandle::InputBuffer  in,
+     **                    AudioHandle::OutputBuffer out,
+     **                    size_t                    size)
+     ** {
+     **     float cv[2][48];
+     **     // ... fill cv[0] and cv[1], 0.0 to 1.0
+     **     const float *cvs[2] = {cv[0], cv[1]};
+     **     hw.dac.WriteSynced(cvs, size);
+     ** }
+     ** \endcode
+     **
+     ** \param samplerate audio samplerate in Hz
+     ** \param block_size samples per audio block, up to DSY_DAC_SYNC_MAX_BLOCK
+     ** \return Result::ERR if not in DMA mode or the block doesn't fit
+     ***/
+    Result StartSynced(float samplerate, size_t block_size);
+
+    /** Converts and queues one block after StartSynced(), from the audio
+     ** callback. Only the highest priority interrupts should be between
+     ** the start of the callback and this call.
+     ** \param in an array per active channel, like the DacCallback, of
+     **        values from 0.0 (0V) to 1.0 (VDDA) before the calibration
+     ** \param size samples per channel, the block size of StartSynced()
+     ***/
+    Result WriteSynced(const float *const *in, size_t size);
+
+    /** Sets the calibration of WriteSynced(). The output is
+     ** (in * scale + offset) of full scale, clamped to 0V - VDDA.
+     ** Defaults to a scale of 1 and an offset of 0.
+     ***/
+    void SetCalibration(Channel chn, float scale, float offset);
+
+    /** Plays a wavetable over and over, in DMA mode, without the CPU.
+     **
+     ** The DMA loops over the table by itself, with its interrupts off, so
+     ** an LFO or a repeating envelope costs nothing after the start. TIM6
+     ** sets the rate, SetWaveformFrequency() changes it at the end of the
+     ** current sample, without a glitch.
+     **
+     ** The table is read by the DMA, so it has to be in the D1 or D2 SRAM
+     ** (e.g. DMA_BUFFER_MEM_SECTION), not the DTCM, and written back from
+     ** the cache if it's in cached memory. Changes to it are heard in the
+     ** next cycle, it can be rewritten while it plays.
+     **
+     ** \param table DAC codes, right aligned to the bit depth
+     ** \param size number of codes in the table, at least 2
+     ** \param frequency cycles of the table per second
+     ** \param table_2 table of channel 2 when both channels are active,
+     **        nullptr plays the first table on both
+     ** \return Result::ERR if not in DMA mode or the frequency can't be
+     **         reached, from about 0.0002Hz for a table of 256 codes
+     ***/
+    Result StartWaveform(const uint16_t *table,
+                         size_t          size,
+                         float           frequency,
+                         const uint16_t *table_2 = nullptr);
+
+    /** Sets the frequency of StartWaveform(), in cycles per second. */
+    Result SetWaveformFrequency(float frequency);
+
     /** Sets and Writes value in Polling Mode 
      ** Has no effect in DMA mode.*/
     Result WriteValue(Channel chn, uint16_t val);
@@ -187,6 +187,12 @@ extern "C"
         //                            gpio_hal_pin_map[p->pin.pin]);
     }
 
+    uint16_t dsy_gpio_read_port(dsy_gpio_port port)
+    {
+        const dsy_gpio_pin pin = {port, 0};
+        return dsy_hal_map_get_port(&pin)->IDR;
+    }
+
     void dsy_gpio_write(const dsy_gpio *p, uint8_t state)
     {
         return HAL_GPIO_WritePin(dsy_hal_map_get_port(&p->pin),
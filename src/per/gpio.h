@@ -135,6 +135,138 @@ class GPIO
     uint32_t *port_base_addr_;
 };
 
+/** @brief Address of the registers of a GPIO port
+ *  @ingroup peripheral
+ *  @details The ports of the STM32H7 are 0x400 apart on the AHB4 bus,
+ *           starting with GPIOA at 0x58020000.
+ */
+constexpr uintptr_t GetGpioPortAddress(GPIOPort port)
+{
+    return 0x58020000u + 0x400u * static_cast<uintptr_t>(port);
+}
+
+/** @brief GPIO output and input that cost one register access
+ *  @ingroup peripheral
+ *  @details For bit-banging, e.g. shift registers and soft SPI, where the
+ *           lookup of the port and the HAL calls of GPIO::Write() and
+ *           dsy_gpio_write() take longer than the rest of each bit. Init()
+ *           resolves the pin's port once, then Write() is a single store to
+ *           its BSRR, and Read() a single load of its IDR.
+ *
+ *           The pin is configured separately, e.g. by GPIO::Init(). For a
+ *           pin that is known at compile time, FastPin does without the
+ *           pointer.
+ */
+class FastGpio
+{
+  public:
+    FastGpio() : regs_(Sink()), bit_(0) {}
+
+    /** Resolves the registers of a pin. An invalid pin, e.g. an unused
+     *  Pin(), writes and reads nothing.
+     */
+    void Init(Pin p)
+    {
+        if(!p.IsValid())
+        {
+            regs_ = Sink();
+            bit_  = 0;
+            return;
+        }
+        regs_ = reinterpret_cast<volatile uint32_t *>(
+            GetGpioPortAddress(p.port));
+        bit_ = 1u << p.pin;
+    }
+
+    /** Resolves the registers of an old-style pin */
+    void Init(dsy_gpio_pin p)
+    {
+        Init(Pin(static_cast<GPIOPort>(p.port), p.pin));
+    }
+
+    /** Uses the registers of a port at another address, e.g. for tests */
+    void Init(volatile uint32_t *port_regs, uint8_t pin)
+    {
+        regs_ = port_regs;
+        bit_  = 1u << pin;
+    }
+
+    void Set() const { regs_[kBsrr] = bit_; }
+    void Clear() const { regs_[kBsrr] = bit_ << 16; }
+    void Write(bool state) const
+    {
+        regs_[kBsrr] = state ? bit_ : bit_ << 16;
+    }
+    bool Read() const { return (regs_[kIdr] & bit_) != 0; }
+
+    /** Flips the output, from the state it was last set to */
+    void Toggle() const { Write((regs_[kOdr] & bit_) == 0); }
+
+    /** Word offsets of the input, output and set/reset registers */
+    static constexpr size_t kIdr  = 4;
+    static constexpr size_t kOdr  = 5;
+    static constexpr size_t kBsrr = 6;
+
+  private:
+    /** Registers for pins that aren't connected */
+    static volatile uint32_t *Sink()
+    {
+        static volatile uint32_t sink[kBsrr + 1];
+        return sink;
+    }
+
+    volatile uint32_t *regs_;
+    uint32_t           bit_;
+};
+
+/** @brief A GPIO pin fixed at compile time, that compiles to one register
+ *         access
+ *  @ingroup peripheral
+ *  @details Like FastGpio, without the pointer, as the address is a
+ *           constant, for the pins of a board.
+ *
+ *           \code
+ *           using Gate = FastPin<PORTC, 10>;
+ *           Gate::Init(GPIO::Mode::OUTPUT);
+ *           Gate::Set();
+ *           \endcode
+ */
+template <GPIOPort port, uint8_t pin>
+class FastPin
+{
+    static_assert(port < PORTX && pin < 16, "FastPin needs a valid pin");
+
+  public:
+    static constexpr Pin GetPin() { return Pin(port, pin); }
+
+    /** Configures the pin, see GPIO::Init() */
+    static void Init(GPIO::Mode  mode  = GPIO::Mode::OUTPUT,
+                     GPIO::Pull  pull  = GPIO::Pull::NOPULL,
+                     GPIO::Speed speed = GPIO::Speed::LOW)
+    {
+        GPIO gpio;
+        gpio.Init(GetPin(), mode, pull, speed);
+    }
+
+    static void Set() { Reg(FastGpio::kBsrr) = kBit; }
+    static void Clear() { Reg(FastGpio::kBsrr) = kBit << 16; }
+    static void Write(bool state)
+    {
+        Reg(FastGpio::kBsrr) = state ? kBit : kBit << 16;
+    }
+    static bool Read() { return (Reg(FastGpio::kIdr) & kBit) != 0; }
+    static void Toggle() { Write((Reg(FastGpio::kOdr) & kBit) == 0); }
+
+  private:
+    static constexpr uint32_t kBit = 1u << pin;
+
+    static volatile uint32_t &Reg(size_t idx)
+    {
+        return reinterpret_cast<volatile uint32_t *>(
+            GetGpioPortAddress(port))[idx];
+    }
+};
+
 } // namespace daisy
 
 
@@ -194,6 +326,12 @@ extern "C"
     \return 1 if the pin is HIGH, and 0 if the pin is LOW */
     uint8_t dsy_gpio_read(const dsy_gpio *p);
 
+    /** 
+    Reads the input states of all pins on a port at once
+    \param port GPIO port
+    \return a bit per pin, bit n is set if pin n is HIGH */
+    uint16_t dsy_gpio_read_port(dsy_gpio_port port);
+
     /** 
     Writes the state to the gpio pin
     Pin will be set to 3v3 when state is 1, and 0V when state is 0
@@ -1,6 +1,10 @@
+#include <cstring>
 #include "per/i2c.h"
+#include "sys/dma_streams.h"
+#include "sys/irq_priority.h"
 #include "sys/system.h"
 #include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
 extern "C"
 {
 #include "util/hal_map.h"
@@ -51,6 +55,41 @@ class I2CHandle::Impl
                                          uint16_t data_size,
                                          uint32_t timeout);
 
+    I2CHandle::Result
+    StartRegisterMap(uint8_t*                            regs,
+                     uint8_t*                            snapshot,
+                     uint16_t                            size,
+                     uint16_t                            num_writable,
+                     I2CHandle::RegisterWriteCallbackPtr callback,
+                     void*                               callback_context);
+    I2CHandle::Result StopRegisterMap();
+    I2CHandle::Result
+    SetRegisters(uint16_t first, const uint8_t* data, uint16_t size);
+    I2CHandle::Result
+    GetRegisters(uint16_t first, uint8_t* data, uint16_t size);
+
+    // =========================================================
+    // register map, served from the I2C interrupt
+    static I2CHandle::Impl* GetRegisterMapHandle(I2C_HandleTypeDef* hal_handle);
+    void                    RegisterMapAddressed(uint8_t direction);
+    void                    RegisterMapByteReceived();
+    void                    RegisterMapListenDone();
+    void                    RegisterMapError();
+    void                    FinishRegisterMapWrite();
+
+    uint8_t*                            map_regs_;
+    uint8_t*                            map_snapshot_;
+    uint16_t                            map_size_;
+    uint16_t                            map_writable_;
+    I2CHandle::RegisterWriteCallbackPtr map_callback_;
+    void*                               map_context_;
+    volatile bool                       map_running_;
+    uint16_t                            map_pointer_;
+    bool                                map_rx_first_;
+    uint8_t                             map_rx_byte_;
+    uint16_t                            map_write_first_;
+    uint16_t                            map_write_count_;
+
     // =========================================================
     // scheduling and global functions
     struct DmaJob
@@ -121,6 +160,15 @@ static I2CHandle::Impl i2c_handles[4];
 // Scheduling and global functions
 // ================================================================
 
+I2CHandle::Impl*
+I2CHandle::Impl::GetRegisterMapHandle(I2C_HandleTypeDef* hal_handle)
+{
+    for(auto& handle : i2c_handles)
+        if(&handle.i2c_hal_handle_ == hal_handle)
+            return handle.map_running_ ? &handle : nullptr;
+    return nullptr;
+}
+
 void I2CHandle::Impl::GlobalInit()
 {
     // init the scheduler queue
@@ -477,7 +525,10 @@ I2CHandle::Impl::StartDmaTransmission(uint16_t                       address,
     // wait for previous transfer to be finished
     while(HAL_I2C_GetState(&i2c_hal_handle_) != HAL_I2C_STATE_READY) {};
 
-    // reinit the DMA
+    // reinit the DMA, the I2C peripherals take turns with the stream
+    if(!DmaStreamAllocator::Claim(DmaStreamAllocator::Stream::DMA_1_STREAM_6,
+                                  "i2c"))
+        return I2CHandle::Result::ERR;
     i2c_dma_tc_handle_.Instance = DMA1_Stream6;
     switch(config_.periph)
     {
@@ -549,7 +600,10 @@ I2CHandle::Impl::StartDmaReception(uint16_t                       address,
     // wait for previous transfer to be finished
     while(HAL_I2C_GetState(&i2c_hal_handle_) != HAL_I2C_STATE_READY) {};
 
-    // reinit the DMA
+    // reinit the DMA, the I2C peripherals take turns with the stream
+    if(!DmaStreamAllocator::Claim(DmaStreamAllocator::Stream::DMA_1_STREAM_6,
+                                  "i2c"))
+        return I2CHandle::Result::ERR;
     i2c_dma_tc_handle_.Instance = DMA1_Stream6;
     switch(config_.periph)
     {
@@ -611,6 +665,135 @@ I2CHandle::Impl::StartDmaReception(uint16_t                       address,
     return I2CHandle::Result::OK;
 }
 
+I2CHandle::Result I2CHandle::Impl::StartRegisterMap(
+    uint8_t*                            regs,
+    uint8_t*                            snapshot,
+    uint16_t                            size,
+    uint16_t                            num_writable,
+    I2CHandle::RegisterWriteCallbackPtr callback,
+    void*                               callback_context)
+{
+    if(config_.mode != I2CHandle::Config::Mode::I2C_SLAVE || regs == nullptr
+       || snapshot == nullptr || size == 0 || size > 256 || num_writable > size)
+        return I2CHandle::Result::ERR;
+
+    // wait for previous transfer to be finished
+    while(HAL_I2C_GetState(&i2c_hal_handle_) != HAL_I2C_STATE_READY) {};
+
+    map_regs_        = regs;
+    map_snapshot_    = snapshot;
+    map_size_        = size;
+    map_writable_    = num_writable;
+    map_callback_    = callback;
+    map_context_     = callback_context;
+    map_pointer_     = 0;
+    map_write_count_ = 0;
+    map_running_     = true;
+    if(HAL_I2C_EnableListen_IT(&i2c_hal_handle_) != HAL_OK)
+    {
+        map_running_ = false;
+        return I2CHandle::Result::ERR;
+    }
+    return I2CHandle::Result::OK;
+}
+
+I2CHandle::Result I2CHandle::Impl::StopRegisterMap()
+{
+    if(!map_running_)
+        return I2CHandle::Result::OK;
+    map_running_ = false;
+    // a transaction in progress ends without listening again
+    if(HAL_I2C_GetState(&i2c_hal_handle_) == HAL_I2C_STATE_LISTEN)
+        HAL_I2C_DisableListen_IT(&i2c_hal_handle_);
+    return I2CHandle::Result::OK;
+}
+
+I2CHandle::Result I2CHandle::Impl::SetRegisters(uint16_t       first,
+                                                const uint8_t* data,
+                                                uint16_t       size)
+{
+    if(map_regs_ == nullptr || first + size > map_size_)
+        return I2CHandle::Result::ERR;
+    // the interrupt takes its snapshot in one go
+    ScopedIrqBlocker block;
+    memcpy(map_regs_ + first, data, size);
+    return I2CHandle::Result::OK;
+}
+
+I2CHandle::Result
+I2CHandle::Impl::GetRegisters(uint16_t first, uint8_t* data, uint16_t size)
+{
+    if(map_regs_ == nullptr || first + size > map_size_)
+        return I2CHandle::Result::ERR;
+    ScopedIrqBlocker block;
+    memcpy(data, map_regs_ + first, size);
+    return I2CHandle::Result::OK;
+}
+
+void I2CHandle::Impl::RegisterMapAddressed(uint8_t direction)
+{
+    // a repeated start ends a write without a stop
+    FinishRegisterMapWrite();
+    if(direction == I2C_DIRECTION_TRANSMIT)
+    {
+        // the host writes, starting with the register number
+        map_rx_first_ = true;
+        HAL_I2C_Slave_Seq_Receive_IT(
+            &i2c_hal_handle_, &map_rx_byte_, 1, I2C_FIRST_FRAME);
+    }
+    else
+    {
+        const uint16_t size = map_size_ - map_pointer_;
+        memcpy(map_snapshot_, map_regs_ + map_pointer_, size);
+        HAL_I2C_Slave_Seq_Transmit_IT(
+            &i2c_hal_handle_, map_snapshot_, size, I2C_LAST_FRAME);
+    }
+}
+
+void I2CHandle::Impl::RegisterMapByteReceived()
+{
+    if(map_rx_first_)
+    {
+        map_rx_first_    = false;
+        map_pointer_     = map_rx_byte_ < map_size_ ? map_rx_byte_ : 0;
+        map_write_first_ = map_pointer_;
+        map_write_count_ = 0;
+    }
+    else if(map_write_first_ + map_write_count_ < map_writable_)
+    {
+        map_regs_[map_write_first_ + map_write_count_] = map_rx_byte_;
+        map_write_count_++;
+    }
+    HAL_I2C_Slave_Seq_Receive_IT(
+        &i2c_hal_handle_, &map_rx_byte_, 1, I2C_NEXT_FRAME);
+}
+
+void I2CHandle::Impl::RegisterMapListenDone()
+{
+    FinishRegisterMapWrite();
+    if(map_running_)
+        HAL_I2C_EnableListen_IT(&i2c_hal_handle_);
+}
+
+void I2CHandle::Impl::RegisterMapError()
+{
+    // the host ends every read with a NACK, anything else resets the
+    // peripheral
+    if((HAL_I2C_GetError(&i2c_hal_handle_) & ~HAL_I2C_ERROR_AF) != 0)
+        HAL_I2C_Init(&i2c_hal_handle_);
+    RegisterMapListenDone();
+}
+
+void I2CHandle::Impl::FinishRegisterMapWrite()
+{
+    if(map_write_count_ == 0)
+        return;
+    const uint16_t count = map_write_count_;
+    map_write_count_     = 0;
+    if(map_callback_ != nullptr)
+        map_callback_(map_context_, map_write_first_, count);
+}
+
 void I2CHandle::Impl::InitPins()
 {
     GPIO_InitTypeDef GPIO_InitStruct;
@@ -674,7 +857,7 @@ extern "C" void HAL_I2C_MspInit(I2C_HandleTypeDef* i2c_handle)
         __HAL_RCC_I2C1_CLK_ENABLE();
         __HAL_RCC_DMA1_CLK_ENABLE();
 
-        HAL_NVIC_SetPriority(I2C1_EV_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(I2C1_EV_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
     }
     else if(i2c_handle->Instance == I2C2)
@@ -685,7 +868,7 @@ extern "C" void HAL_I2C_MspInit(I2C_HandleTypeDef* i2c_handle)
         __HAL_RCC_I2C2_CLK_ENABLE();
         __HAL_RCC_DMA1_CLK_ENABLE();
 
-        HAL_NVIC_SetPriority(I2C2_EV_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(I2C2_EV_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(I2C2_EV_IRQn);
     }
     else if(i2c_handle->Instance == I2C3)
@@ -695,7 +878,7 @@ extern "C" void HAL_I2C_MspInit(I2C_HandleTypeDef* i2c_handle)
         __HAL_RCC_I2C3_CLK_ENABLE();
         __HAL_RCC_DMA1_CLK_ENABLE();
 
-        HAL_NVIC_SetPriority(I2C3_EV_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(I2C3_EV_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(I2C3_EV_IRQn);
     }
     else if(i2c_handle->Instance == I2C4)
@@ -754,21 +937,25 @@ void halI2CDmaStreamCallback(void)
 }
 extern "C" void DMA1_Stream6_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::I2CS);
     halI2CDmaStreamCallback();
 }
 
 extern "C" void I2C1_EV_IRQHandler()
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::I2CS);
     HAL_I2C_EV_IRQHandler(&i2c_handles[0].i2c_hal_handle_);
 }
 
 extern "C" void I2C2_EV_IRQHandler()
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::I2CS);
     HAL_I2C_EV_IRQHandler(&i2c_handles[1].i2c_hal_handle_);
 }
 
 extern "C" void I2C3_EV_IRQHandler()
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::I2CS);
     HAL_I2C_EV_IRQHandler(&i2c_handles[2].i2c_hal_handle_);
 }
 
@@ -784,17 +971,47 @@ extern "C" void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef* i2c_handle)
 
 extern "C" void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef* i2c_handle)
 {
+    // a register map read ends with the NACK and stop of the host
+    if(I2CHandle::Impl::GetRegisterMapHandle(i2c_handle) != nullptr)
+        return;
     I2CHandle::Impl::DmaTransferFinished(i2c_handle, I2CHandle::Result::OK);
 }
 
 extern "C" void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef* i2c_handle)
 {
-    I2CHandle::Impl::DmaTransferFinished(i2c_handle, I2CHandle::Result::OK);
+    I2CHandle::Impl* map = I2CHandle::Impl::GetRegisterMapHandle(i2c_handle);
+    if(map != nullptr)
+        map->RegisterMapByteReceived();
+    else
+        I2CHandle::Impl::DmaTransferFinished(i2c_handle,
+                                             I2CHandle::Result::OK);
+}
+
+extern "C" void HAL_I2C_AddrCallback(I2C_HandleTypeDef* i2c_handle,
+                                     uint8_t            direction,
+                                     uint16_t           address_match_code)
+{
+    (void)address_match_code;
+    I2CHandle::Impl* map = I2CHandle::Impl::GetRegisterMapHandle(i2c_handle);
+    if(map != nullptr)
+        map->RegisterMapAddressed(direction);
+}
+
+extern "C" void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef* i2c_handle)
+{
+    I2CHandle::Impl* map = I2CHandle::Impl::GetRegisterMapHandle(i2c_handle);
+    if(map != nullptr)
+        map->RegisterMapListenDone();
 }
 
 extern "C" void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* i2c_handle)
 {
-    I2CHandle::Impl::DmaTransferFinished(i2c_handle, I2CHandle::Result::ERR);
+    I2CHandle::Impl* map = I2CHandle::Impl::GetRegisterMapHandle(i2c_handle);
+    if(map != nullptr)
+        map->RegisterMapError();
+    else
+        I2CHandle::Impl::DmaTransferFinished(i2c_handle,
+                                             I2CHandle::Result::ERR);
 }
 
 // ======================================================================
@@ -871,4 +1088,33 @@ I2CHandle::Result I2CHandle::WriteDataAtAddress(uint16_t address,
         address, mem_address, mem_address_size, data, data_size, timeout);
 }
 
+I2CHandle::Result
+I2CHandle::StartRegisterMap(uint8_t*                 regs,
+                            uint8_t*                 snapshot,
+                            uint16_t                 size,
+                            uint16_t                 num_writable,
+                            RegisterWriteCallbackPtr callback,
+                            void*                    callback_context)
+{
+    return pimpl_->StartRegisterMap(
+        regs, snapshot, size, num_writable, callback, callback_context);
+}
+
+I2CHandle::Result I2CHandle::StopRegisterMap()
+{
+    return pimpl_->StopRegisterMap();
+}
+
+I2CHandle::Result
+I2CHandle::SetRegisters(uint16_t first, const uint8_t* data, uint16_t size)
+{
+    return pimpl_->SetRegisters(first, data, size);
+}
+
+I2CHandle::Result
+I2CHandle::GetRegisters(uint16_t first, uint8_t* data, uint16_t size)
+{
+    return pimpl_->GetRegisters(first, data, size);
+}
+
 } // namespace daisy
@@ -203,6 +203,60 @@ class I2CHandle
                               uint32_t timeout);
 
 
+    /** A callback for the register map, called from the I2C interrupt after
+     *  the host wrote registers.
+     *  \param context the pointer given to StartRegisterMap()
+     *  \param first the first register written
+     *  \param count the number of registers written
+     */
+    typedef void (*RegisterWriteCallbackPtr)(void*    context,
+                                             uint16_t first,
+                                             uint16_t count);
+
+    /** Serves a register map to an I2C host, in slave mode. The host writes
+     *  a register number and optionally data, which goes to the registers
+     *  from there on, and reads from the register it wrote last. Each read
+     *  transaction gets a snapshot of the registers from its start to the
+     *  end of the map, copied when the host addresses the device, so wider
+     *  values are never torn. Everything runs in the I2C event interrupt,
+     *  the main loop only updates the registers with SetRegisters().
+     *
+     *  Only registers below num_writable can be written by the host, the
+     *  ones after it are e.g. status and measurements for the host to read.
+     *  The handle can't be used for other transfers while the map runs.
+     *
+     *  \param regs             the registers, up to 256
+     *  \param snapshot         a buffer of the same size for the reads
+     *  \param size             number of registers
+     *  \param num_writable     registers the host can write, from 0
+     *  \param callback         called after host writes, or nullptr
+     *  \param callback_context passed back in the callback
+     *  \return ERR in master mode, or if the map doesn't fit an 8 bit address
+     */
+    Result StartRegisterMap(uint8_t*                 regs,
+                            uint8_t*                 snapshot,
+                            uint16_t                 size,
+                            uint16_t                 num_writable,
+                            RegisterWriteCallbackPtr callback,
+                            void*                    callback_context);
+
+    /** Stops serving the register map */
+    Result StopRegisterMap();
+
+    /** Copies data to the registers, without a host read seeing half of it
+     *  \param first the first register
+     *  \param data the values
+     *  \param size number of registers
+     */
+    Result SetRegisters(uint16_t first, const uint8_t* data, uint16_t size);
+
+    /** Copies registers out, e.g. the ones written by the host
+     *  \param first the first register
+     *  \param data the destination
+     *  \param size number of registers
+     */
+    Result GetRegisters(uint16_t first, uint8_t* data, uint16_t size);
+
     class Impl; /**< & */
 
   private:
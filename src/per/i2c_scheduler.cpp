@@ -0,0 +1,167 @@
+#include "per/i2c_scheduler.h"
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+namespace
+{
+/** State of a Transfer() call, on its stack */
+struct Waiter
+{
+    volatile bool              done;
+    volatile I2CHandle::Result result;
+};
+} // namespace
+
+void I2CScheduler::Init(I2CHandle i2c)
+{
+    ScopedIrqBlocker block;
+    i2c_ = i2c;
+    for(size_t i = 0; i < kNumPriorities; i++)
+    {
+        queues_[i].read  = 0;
+        queues_[i].count = 0;
+    }
+    active_ = false;
+    errors_ = 0;
+}
+
+I2CHandle::Result I2CScheduler::Queue(const Transaction& transaction,
+                                      Priority           priority)
+{
+    const bool write = transaction.tx_data != nullptr && transaction.tx_size;
+    const bool read  = transaction.rx_data != nullptr && transaction.rx_size;
+    if((!write && !read) || size_t(priority) >= kNumPriorities)
+        return I2CHandle::Result::ERR;
+
+    bool start;
+    {
+        ScopedIrqBlocker  block;
+        TransactionQueue& queue = queues_[size_t(priority)];
+        if(queue.count >= DSY_I2C_SCHEDULER_QUEUE_SIZE)
+            return I2CHandle::Result::ERR;
+        const size_t pos
+            = (queue.read + queue.count) % DSY_I2C_SCHEDULER_QUEUE_SIZE;
+        queue.items[pos] = transaction;
+        if(!write)
+            queue.items[pos].tx_data = nullptr;
+        if(!read)
+            queue.items[pos].rx_data = nullptr;
+        queue.count = queue.count + 1;
+        start       = Claim();
+    }
+    // the bus was idle, later ones are started from TransferCallback()
+    if(start)
+        Start();
+    return I2CHandle::Result::OK;
+}
+
+I2CHandle::Result I2CScheduler::Transfer(const Transaction& transaction,
+                                         Priority           priority)
+{
+    Waiter waiter = {false, I2CHandle::Result::OK};
+
+    Transaction t      = transaction;
+    t.callback         = &WaitCallback;
+    t.callback_context = &waiter;
+    if(Queue(t, priority) != I2CHandle::Result::OK)
+        return I2CHandle::Result::ERR;
+    while(!waiter.done) {}
+    return waiter.result;
+}
+
+bool I2CScheduler::IsBusy() const
+{
+    return active_ || GetNumQueued() > 0;
+}
+
+size_t I2CScheduler::GetNumQueued() const
+{
+    size_t num = 0;
+    for(size_t i = 0; i < kNumPriorities; i++)
+        num += queues_[i].count;
+    return num;
+}
+
+bool I2CScheduler::Claim()
+{
+    if(active_)
+        return false;
+    for(size_t i = kNumPriorities; i-- > 0;)
+    {
+        TransactionQueue& queue = queues_[i];
+        if(queue.count == 0)
+            continue;
+        current_    = queue.items[queue.read];
+        queue.read  = (queue.read + 1) % DSY_I2C_SCHEDULER_QUEUE_SIZE;
+        queue.count = queue.count - 1;
+        phase_      = current_.tx_data != nullptr ? Phase::WRITE : Phase::READ;
+        active_     = true;
+        return true;
+    }
+    return false;
+}
+
+void I2CScheduler::Start()
+{
+    // loops instead of recursing when transfers fail to start
+    while(true)
+    {
+        I2CHandle::Result result;
+        if(phase_ == Phase::WRITE)
+            result = i2c_.TransmitDma(current_.address,
+                                      current_.tx_data,
+                                      current_.tx_size,
+                                      &TransferCallback,
+                                      this);
+        else
+            result = i2c_.ReceiveDma(current_.address,
+                                     current_.rx_data,
+                                     current_.rx_size,
+                                     &TransferCallback,
+                                     this);
+        if(result == I2CHandle::Result::OK || !Finish(result))
+            return;
+    }
+}
+
+bool I2CScheduler::Finish(I2CHandle::Result result)
+{
+    if(result != I2CHandle::Result::OK)
+        errors_ = errors_ + 1;
+    const I2CHandle::CallbackFunctionPtr callback = current_.callback;
+    void* const                          context  = current_.callback_context;
+
+    active_ = false;
+
+    // the callback may queue, and start, the next transaction itself
+    if(callback != nullptr)
+        callback(context, result);
+
+    ScopedIrqBlocker block;
+    return Claim();
+}
+
+void I2CScheduler::TransferCallback(void* context, I2CHandle::Result result)
+{
+    I2CScheduler& scheduler = *static_cast<I2CScheduler*>(context);
+    if(result == I2CHandle::Result::OK && scheduler.phase_ == Phase::WRITE
+       && scheduler.current_.rx_data != nullptr)
+    {
+        // the read of the same transaction, before anything else
+        scheduler.phase_ = Phase::READ;
+        scheduler.Start();
+        return;
+    }
+    if(scheduler.Finish(result))
+        scheduler.Start();
+}
+
+void I2CScheduler::WaitCallback(void* context, I2CHandle::Result result)
+{
+    Waiter& waiter = *static_cast<Waiter*>(context);
+    waiter.result  = result;
+    waiter.done    = true;
+}
+
+} // namespace daisy
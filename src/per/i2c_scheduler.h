@@ -0,0 +1,152 @@
+#pragma once
+#ifndef DSY_I2C_SCHEDULER_H
+#define DSY_I2C_SCHEDULER_H
+
+#include "daisy_core.h"
+#include "per/i2c.h"
+
+/** Number of transactions that can wait, per priority */
+#ifndef DSY_I2C_SCHEDULER_QUEUE_SIZE
+#define DSY_I2C_SCHEDULER_QUEUE_SIZE 8
+#endif
+
+namespace daisy
+{
+/** @addtogroup serial
+@{
+*/
+
+/** @brief Runs the DMA transactions of all drivers on one I2C bus
+ *
+ *  Codec, LED drivers, displays and sensors often share one I2CHandle.
+ *  When each driver starts its own transfers they collide, or wait for
+ *  each other with blocking calls. Instead, the drivers queue their
+ *  transactions here. The scheduler runs one at a time by DMA, and starts
+ *  the next one from the completion interrupt of the one before, so the
+ *  bus is busy back-to-back without the main loop.
+ *
+ *  There's a queue per priority. The next transaction is the oldest of
+ *  the highest priority that has one, a running transaction is never
+ *  interrupted.
+ *
+ *  A transaction can write, read, or write and then read, e.g. a register
+ *  address followed by its contents. The read follows the write directly,
+ *  no other transaction of the scheduler can come in between. It is not a
+ *  combined transfer though: the write ends with a STOP and the read starts
+ *  with a new START, not a repeated START. Devices that lose the register
+ *  pointer on a STOP, or need a repeated START, are not supported, use the
+ *  blocking I2CHandle::ReadDataAtAddress() for them.
+ *
+ *  The buffers are used by the DMA, see I2CHandle::TransmitDma(). Only
+ *  I2C1 to I2C3 have a DMA.
+ *
+ *  @code
+ *  I2CScheduler bus;
+ *  bus.Init(i2c);
+ *
+ *  I2CScheduler::Transaction t = {};
+ *  t.address = 0x40;
+ *  t.tx_data = led_frame;
+ *  t.tx_size = sizeof(led_frame);
+ *  bus.Queue(t, I2CScheduler::Priority::LOW);
+ *  @endcode
+ */
+class I2CScheduler
+{
+  public:
+    /** Order of the queues, higher first */
+    enum class Priority
+    {
+        LOW,    /**< & */
+        NORMAL, /**< & */
+        HIGH,   /**< & */
+    };
+
+    /** Number of Priority values */
+    static constexpr size_t kNumPriorities = 3;
+
+    /** A transfer with one device */
+    struct Transaction
+    {
+        uint16_t address; /**< the 7 bit device address */
+        uint8_t* tx_data; /**< written first, or nullptr to only read */
+        uint16_t tx_size; /**< & */
+        uint8_t* rx_data; /**< read after the write and a STOP, or nullptr */
+        uint16_t rx_size; /**< & */
+
+        /** called from the interrupt when the transaction is done, or NULL.
+         *  It may queue the next transaction. */
+        I2CHandle::CallbackFunctionPtr callback;
+        void*                          callback_context;
+    };
+
+    I2CScheduler() : active_(false) {}
+    I2CScheduler(const I2CScheduler& other) = delete;
+    I2CScheduler& operator=(const I2CScheduler& other) = delete;
+
+    /** Sets the bus and empties the queues
+     *  \param i2c an initialized master handle
+     */
+    void Init(I2CHandle i2c);
+
+    /** Queues a transaction, and starts it if the bus is idle. From any
+     *  context, also interrupts.
+     *  \param transaction the transfer, its buffers must stay valid until
+     *                     the callback
+     *  \param priority the queue to wait in
+     *  \return ERR if the transaction has no data, or the queue is full
+     */
+    I2CHandle::Result Queue(const Transaction& transaction,
+                            Priority           priority = Priority::NORMAL);
+
+    /** Queues a transaction and waits until it's done. For drivers that
+     *  used the blocking calls of I2CHandle, from the main loop only.
+     *  The callback of the transaction is not used.
+     *  \return the result of the transfer
+     */
+    I2CHandle::Result Transfer(const Transaction& transaction,
+                               Priority           priority = Priority::NORMAL);
+
+    /** \return true while a transaction runs or waits */
+    bool IsBusy() const;
+
+    /** \return the number of transactions that haven't started yet */
+    size_t GetNumQueued() const;
+
+    /** \return the number of transactions that failed since Init() */
+    uint32_t GetNumErrors() const { return errors_; }
+
+  private:
+    enum class Phase
+    {
+        WRITE,
+        READ,
+    };
+
+    /** Takes the next transaction if none runs, with interrupts disabled */
+    bool Claim();
+    void Start();
+    bool Finish(I2CHandle::Result result);
+
+    static void TransferCallback(void* context, I2CHandle::Result result);
+    static void WaitCallback(void* context, I2CHandle::Result result);
+
+    struct TransactionQueue
+    {
+        Transaction     items[DSY_I2C_SCHEDULER_QUEUE_SIZE];
+        size_t          read;
+        volatile size_t count;
+    };
+
+    I2CHandle         i2c_;
+    TransactionQueue  queues_[kNumPriorities];
+    Transaction       current_;
+    Phase             phase_;
+    volatile bool     active_;
+    volatile uint32_t errors_;
+};
+
+/** @} */
+} // namespace daisy
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef UNIT_TEST
 #include "per/qspi.h"
+#include "sys/irq_priority.h"
 #include "sys/system.h"
 #include "stm32h7xx_hal.h"
 #include "dev/flash_IS25LP080D.h"
 #include "dev/flash_IS25LP064A.h"
+#include "util/IrqProfiler.h"
 extern "C"
 {
 #include "util/hal_map.h"
@@ -47,16 +49,44 @@ class QSPIHandle::Impl
 
     QSPIHandle::Result Write(uint32_t address, uint32_t size, uint8_t* buffer);
 
+    QSPIHandle::Result Read(uint32_t address, uint32_t size, uint8_t* buffer);
+
     QSPIHandle::Result Erase(uint32_t start_addr, uint32_t end_addr);
 
     QSPIHandle::Result EraseSector(uint32_t address);
 
+    QSPIHandle::Result StartErase(uint32_t               start_addr,
+                                  uint32_t               end_addr,
+                                  EndCallbackFunctionPtr callback,
+                                  void*                  context);
+
+    QSPIHandle::Result StartWrite(uint32_t               address,
+                                  uint32_t               size,
+                                  uint8_t*               buffer,
+                                  EndCallbackFunctionPtr callback,
+                                  void*                  context);
+
+    QSPIHandle::Result StartRead(uint32_t               address,
+                                 uint32_t               size,
+                                 uint8_t*               buffer,
+                                 EndCallbackFunctionPtr callback,
+                                 void*                  context);
+
+    /** Called from the interrupt when the DMA of StartRead() is done */
+    void ReadDone(bool ok);
+
+    bool Process(uint32_t max_us);
+
+    bool IsBusy() { return async_.op != AsyncOp::NONE; }
+
     uint32_t GetPin(size_t pin);
 
     GPIO_TypeDef* GetPort(size_t pin);
 
     QSPI_HandleTypeDef* GetHalHandle();
 
+    MDMA_HandleTypeDef* GetMdmaHandle() { return &hmdma_; }
+
     size_t GetNumPins() { return pin_count_; }
 
     Status GetStatus() { return status_; }
@@ -77,12 +107,25 @@ class QSPIHandle::Impl
 
     QSPIHandle::Result EnableMemoryMappedMode();
 
+    /** Sets up the quad read command of the read mode. With continuous,
+     *  the flash expects the next read without the instruction.
+     */
+    void SetReadCommand(QSPI_CommandTypeDef* s_command, bool continuous);
+
     QSPIHandle::Result AutopollingMemReady(uint32_t timeout);
 
     QSPIHandle::Result SetMode(Config::Mode mode);
 
     QSPIHandle::Result CheckProgramMemory();
 
+    /** Starts the next page program or erase of the asynchronous operation */
+    QSPIHandle::Result StartAsyncStep();
+
+    /** Ends the asynchronous operation, and calls its callback */
+    bool FinishAsync(QSPIHandle::Result result);
+
+    QSPIHandle::Result ReadStatusRegister(uint8_t* reg);
+
     // These functions are defined, but we haven't added the ability to switch to quad mode. So they're currently unused.
     QSPIHandle::Result EnterQuadMode() __attribute__((unused));
     QSPIHandle::Result ExitQuadMode() __attribute__((unused));
@@ -90,8 +133,31 @@ class QSPIHandle::Impl
 
     QSPIHandle::Config config_;
     QSPI_HandleTypeDef halqspi_;
+    MDMA_HandleTypeDef hmdma_;
     Status             status_;
 
+    enum class AsyncOp
+    {
+        NONE,
+        ERASE,
+        WRITE,
+        READ,
+    };
+
+    /** State of an asynchronous erase or write */
+    struct
+    {
+        AsyncOp                op = AsyncOp::NONE;
+        uint32_t               address, end; // next step, and end of the area
+        uint8_t*               buffer;
+        volatile bool          in_flight; // a step is running on the chip
+        uint32_t               step_start, step_timeout; // in ms
+        EndCallbackFunctionPtr callback;
+        void*                  context;
+        bool                   mapped;  // READ: mode to go back to
+        volatile bool          read_ok; // READ: set by the interrupt
+    } async_;
+
     static constexpr size_t pin_count_
         = sizeof(QSPIHandle::Config::pin_config) / sizeof(dsy_gpio_pin);
     // Data structure for easy hal initialization
@@ -141,7 +207,9 @@ QSPIHandle::Result QSPIHandle::Impl::Init(const QSPIHandle::Config& config)
     //dsy_qspi_handle.Init.ClockPrescaler = 7;
     //dsy_qspi_handle.Init.ClockPrescaler = 7;
     //dsy_qspi_handle.Init.ClockPrescaler = 2; // Conservative setting for now. Signal gets very weak faster than this.
-    halqspi_.Init.ClockPrescaler     = 1;
+    // DTR reads are limited to 80MHz by the flash
+    halqspi_.Init.ClockPrescaler
+        = config_.read_mode == Config::ReadMode::QUAD_DTR ? 2 : 1;
     halqspi_.Init.FifoThreshold      = 1;
     halqspi_.Init.SampleShifting     = QSPI_SAMPLE_SHIFTING_NONE;
     halqspi_.Init.FlashSize          = POSITION_VAL(flash_size) - 1;
@@ -327,6 +395,39 @@ QSPIHandle::Impl::Write(uint32_t address, uint32_t size, uint8_t* buffer)
 }
 
 
+QSPIHandle::Result
+QSPIHandle::Impl::Read(uint32_t address, uint32_t size, uint8_t* buffer)
+{
+    RETURN_IF_ERR(CheckProgramMemory());
+    if(IsBusy())
+        return Result::ERR;
+    if(size == 0)
+        return Result::OK;
+
+    const bool mapped = config_.mode == Config::Mode::MEMORY_MAPPED;
+    RETURN_IF_ERR(SetMode(Config::Mode::INDIRECT_POLLING));
+
+    QSPI_CommandTypeDef s_command;
+    SetReadCommand(&s_command, false);
+    s_command.Address = address & 0x0FFFFFFF;
+    s_command.NbData  = size;
+    if(HAL_QSPI_Command(&halqspi_, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != HAL_OK)
+    {
+        ERR_RECOVERY(Status::E_HAL_ERROR);
+    }
+    if(HAL_QSPI_Receive(&halqspi_, buffer, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != HAL_OK)
+    {
+        ERR_RECOVERY(Status::E_HAL_ERROR);
+    }
+
+    if(mapped)
+        RETURN_IF_ERR(SetMode(Config::Mode::MEMORY_MAPPED));
+    return QSPIHandle::Result::OK;
+}
+
+
 QSPIHandle::Result QSPIHandle::Impl::Erase(uint32_t start_addr,
                                            uint32_t end_addr)
 {
@@ -398,6 +499,280 @@ QSPIHandle::Result QSPIHandle::Impl::EraseSector(uint32_t address)
 }
 
 
+QSPIHandle::Result
+QSPIHandle::Impl::StartErase(uint32_t               start_addr,
+                             uint32_t               end_addr,
+                             EndCallbackFunctionPtr callback,
+                             void*                  context)
+{
+    RETURN_IF_ERR(CheckProgramMemory());
+    if(IsBusy())
+        return Result::ERR;
+    start_addr &= 0x0FFFFFFF;
+    end_addr &= 0x0FFFFFFF;
+    async_.op        = AsyncOp::ERASE;
+    async_.address   = start_addr - (start_addr % IS25LP080D_SECTOR_SIZE);
+    async_.end       = end_addr;
+    async_.buffer    = nullptr;
+    async_.in_flight = false;
+    async_.callback  = callback;
+    async_.context   = context;
+    return Result::OK;
+}
+
+
+QSPIHandle::Result
+QSPIHandle::Impl::StartWrite(uint32_t               address,
+                             uint32_t               size,
+                             uint8_t*               buffer,
+                             EndCallbackFunctionPtr callback,
+                             void*                  context)
+{
+    RETURN_IF_ERR(CheckProgramMemory());
+    if(IsBusy())
+        return Result::ERR;
+    address &= 0x0FFFFFFF;
+    async_.op        = AsyncOp::WRITE;
+    async_.address   = address;
+    async_.end       = address + size;
+    async_.buffer    = buffer;
+    async_.in_flight = false;
+    async_.callback  = callback;
+    async_.context   = context;
+    return Result::OK;
+}
+
+
+QSPIHandle::Result
+QSPIHandle::Impl::StartRead(uint32_t               address,
+                            uint32_t               size,
+                            uint8_t*               buffer,
+                            EndCallbackFunctionPtr callback,
+                            void*                  context)
+{
+    RETURN_IF_ERR(CheckProgramMemory());
+    if(IsBusy() || buffer == nullptr)
+        return Result::ERR;
+    async_.op           = AsyncOp::READ;
+    async_.address      = address & 0x0FFFFFFF;
+    async_.end          = async_.address + size;
+    async_.buffer       = buffer;
+    async_.in_flight    = false;
+    async_.callback     = callback;
+    async_.context      = context;
+    async_.mapped       = config_.mode == Config::Mode::MEMORY_MAPPED;
+    async_.read_ok      = false;
+    async_.step_start   = System::GetNow();
+    async_.step_timeout = HAL_QPSI_TIMEOUT_DEFAULT_VALUE + size / 1024;
+    if(size == 0)
+        return Result::OK; // done with the next Process()
+
+    if(SetMode(Config::Mode::INDIRECT_POLLING) != Result::OK)
+    {
+        async_.op = AsyncOp::NONE;
+        return Result::ERR;
+    }
+    QSPI_CommandTypeDef s_command;
+    SetReadCommand(&s_command, false);
+    s_command.Address = async_.address;
+    s_command.NbData  = size;
+    // no dirty lines may be evicted over the buffer during the transfer
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)buffer, size);
+    async_.in_flight = true;
+    if(HAL_QSPI_Command(&halqspi_, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+           != HAL_OK
+       || HAL_QSPI_Receive_DMA(&halqspi_, buffer) != HAL_OK)
+    {
+        async_.in_flight = false;
+        async_.op        = AsyncOp::NONE;
+        ERR_RECOVERY(Status::E_HAL_ERROR);
+    }
+    return Result::OK;
+}
+
+
+void QSPIHandle::Impl::ReadDone(bool ok)
+{
+    if(async_.op != AsyncOp::READ)
+        return;
+    async_.read_ok   = ok;
+    async_.in_flight = false;
+}
+
+
+bool QSPIHandle::Impl::Process(uint32_t max_us)
+{
+    if(!IsBusy())
+        return false;
+    if(async_.op == AsyncOp::READ)
+    {
+        if(!async_.in_flight)
+        {
+            // the MDMA wrote behind the cache
+            SCB_InvalidateDCache_by_Addr((uint32_t*)async_.buffer,
+                                         async_.end - async_.address);
+            return FinishAsync(async_.address == async_.end || async_.read_ok
+                                   ? Result::OK
+                                   : Result::ERR);
+        }
+        if(System::GetNow() - async_.step_start > async_.step_timeout)
+        {
+            HAL_QSPI_Abort(&halqspi_);
+            async_.in_flight = false;
+            return FinishAsync(Result::ERR);
+        }
+        return true;
+    }
+    const uint32_t start = System::GetUs();
+    while(true)
+    {
+        if(async_.in_flight)
+        {
+            uint8_t reg;
+            if(ReadStatusRegister(&reg) != Result::OK)
+                return FinishAsync(Result::ERR);
+            if(reg & IS25LP080D_SR_WIP)
+            {
+                if(System::GetNow() - async_.step_start > async_.step_timeout)
+                    return FinishAsync(Result::ERR);
+                if(System::GetUs() - start < max_us)
+                    continue;
+                return true;
+            }
+            async_.in_flight = false;
+            if(async_.address >= async_.end)
+                return FinishAsync(Result::OK);
+            // let the memory be read until the next call
+            if(System::GetUs() - start >= max_us)
+            {
+                if(SetMode(Config::Mode::MEMORY_MAPPED) != Result::OK)
+                    return FinishAsync(Result::ERR);
+                return true;
+            }
+        }
+        if(async_.address >= async_.end)
+            return FinishAsync(Result::OK);
+        if(StartAsyncStep() != Result::OK)
+            return FinishAsync(Result::ERR);
+    }
+}
+
+
+QSPIHandle::Result QSPIHandle::Impl::StartAsyncStep()
+{
+    QSPI_CommandTypeDef s_command;
+    uint32_t            size;
+    s_command.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
+    s_command.AddressMode       = QSPI_ADDRESS_1_LINE;
+    s_command.AddressSize       = QSPI_ADDRESS_24_BITS;
+    s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+    s_command.DummyCycles       = 0;
+    s_command.DdrMode           = QSPI_DDR_MODE_DISABLE;
+    s_command.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
+    s_command.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+    s_command.Address           = async_.address;
+
+    if(async_.op == AsyncOp::ERASE)
+    {
+        // whole 64kB blocks take a lot less time than 16 sectors
+        s_command.DataMode = QSPI_DATA_NONE;
+        s_command.NbData   = 1;
+        if(async_.address % IS25LP080D_BLOCK_SIZE == 0
+           && async_.end - async_.address >= IS25LP080D_BLOCK_SIZE)
+        {
+            s_command.Instruction = BLOCK_ERASE_CMD;
+            size                  = IS25LP080D_BLOCK_SIZE;
+            async_.step_timeout   = IS25LP080D_BLOCK_ERASE_MAX_TIME;
+        }
+        else
+        {
+            s_command.Instruction = SECTOR_ERASE_CMD;
+            size                  = IS25LP080D_SECTOR_SIZE;
+            async_.step_timeout   = IS25LP080D_SECTOR_ERASE_MAX_TIME;
+        }
+    }
+    else
+    {
+        // up to the end of the page
+        size = IS25LP080D_PAGE_SIZE - (async_.address % IS25LP080D_PAGE_SIZE);
+        if(size > async_.end - async_.address)
+            size = async_.end - async_.address;
+        s_command.Instruction = PAGE_PROG_CMD;
+        s_command.DataMode    = QSPI_DATA_1_LINE;
+        s_command.NbData      = size;
+        async_.step_timeout   = HAL_QPSI_TIMEOUT_DEFAULT_VALUE;
+    }
+
+    RETURN_IF_ERR(SetMode(Config::Mode::INDIRECT_POLLING));
+    RETURN_IF_ERR(WriteEnable());
+    if(HAL_QSPI_Command(&halqspi_, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != HAL_OK)
+    {
+        ERR_SIMPLE(Status::E_HAL_ERROR);
+    }
+    if(async_.op == AsyncOp::WRITE)
+    {
+        if(HAL_QSPI_Transmit(
+               &halqspi_, async_.buffer, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+           != HAL_OK)
+        {
+            ERR_SIMPLE(Status::E_HAL_ERROR);
+        }
+        async_.buffer += size;
+    }
+    async_.address += size;
+    async_.in_flight  = true;
+    async_.step_start = System::GetNow();
+    return Result::OK;
+}
+
+
+bool QSPIHandle::Impl::FinishAsync(QSPIHandle::Result result)
+{
+    const EndCallbackFunctionPtr callback = async_.callback;
+    void* const                  context  = async_.context;
+    // a read goes back to the mode it was started in
+    const bool restore = async_.op != AsyncOp::READ || async_.mapped;
+    async_.op          = AsyncOp::NONE;
+    async_.in_flight   = false;
+    if(restore && SetMode(Config::Mode::MEMORY_MAPPED) != Result::OK)
+        result = Result::ERR;
+    if(result != Result::OK && status_ == Status::GOOD)
+        status_ = Status::E_HAL_ERROR;
+    if(callback)
+        callback(context, result);
+    return IsBusy(); // the callback may have started the next operation
+}
+
+
+QSPIHandle::Result QSPIHandle::Impl::ReadStatusRegister(uint8_t* reg)
+{
+    QSPI_CommandTypeDef s_command;
+    s_command.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
+    s_command.Instruction       = READ_STATUS_REG_CMD;
+    s_command.AddressMode       = QSPI_ADDRESS_NONE;
+    s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+    s_command.DataMode          = QSPI_DATA_1_LINE;
+    s_command.DummyCycles       = 0;
+    s_command.NbData            = 1;
+    s_command.DdrMode           = QSPI_DDR_MODE_DISABLE;
+    s_command.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
+    s_command.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+
+    if(HAL_QSPI_Command(&halqspi_, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != HAL_OK)
+    {
+        ERR_SIMPLE(Status::E_HAL_ERROR);
+    }
+    if(HAL_QSPI_Receive(&halqspi_, reg, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != HAL_OK)
+    {
+        ERR_SIMPLE(Status::E_HAL_ERROR);
+    }
+    return QSPIHandle::Result::OK;
+}
+
+
 QSPIHandle::Result QSPIHandle::Impl::ResetMemory()
 {
     QSPI_CommandTypeDef s_command;
@@ -646,27 +1021,40 @@ QSPIHandle::Result QSPIHandle::Impl::QuadEnable()
 }
 
 
+void QSPIHandle::Impl::SetReadCommand(QSPI_CommandTypeDef* s_command,
+                                      bool                 continuous)
+{
+    const bool dtr = config_.read_mode == Config::ReadMode::QUAD_DTR;
+    // The mode bits 0xAx keep the flash in continuous read mode. They
+    // count towards the 8 dummy cycles set by DummyCyclesConfig(), and
+    // take 2 cycles in SDR and 1 in DTR.
+    const uint32_t mode_bits = continuous ? 0xA0 : 0x00;
+    const uint32_t sioo      = continuous ? QSPI_SIOO_INST_ONLY_FIRST_CMD
+                                          : QSPI_SIOO_INST_EVERY_CMD;
+
+    s_command->InstructionMode    = QSPI_INSTRUCTION_1_LINE;
+    s_command->Instruction        = dtr ? QUAD_INOUT_FAST_READ_DTR_CMD
+                                        : QUAD_INOUT_FAST_READ_CMD;
+    s_command->AddressMode        = QSPI_ADDRESS_4_LINES;
+    s_command->AddressSize        = QSPI_ADDRESS_24_BITS;
+    s_command->AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
+    s_command->AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
+    s_command->AlternateBytes     = mode_bits;
+    s_command->DummyCycles        = dtr ? 7 : 6;
+    s_command->DdrMode  = dtr ? QSPI_DDR_MODE_ENABLE : QSPI_DDR_MODE_DISABLE;
+    s_command->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+    s_command->SIOOMode         = sioo;
+    s_command->DataMode         = QSPI_DATA_4_LINES;
+}
+
+
 QSPIHandle::Result QSPIHandle::Impl::EnableMemoryMappedMode()
 {
     QSPI_CommandTypeDef      s_command;
     QSPI_MemoryMappedTypeDef s_mem_mapped_cfg;
 
     /* Configure the command for the read instruction */
-    s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-    s_command.Instruction     = QUAD_INOUT_FAST_READ_CMD;
-    s_command.AddressMode     = QSPI_ADDRESS_4_LINES;
-    s_command.AddressSize     = QSPI_ADDRESS_24_BITS;
-    //    s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-    //s_command.DummyCycles       = IS25LP080D_DUMMY_CYCLES_READ_QUAD;
-    s_command.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-    s_command.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    s_command.AlternateBytes     = 0x000000A0;
-    s_command.DummyCycles        = 6;
-    s_command.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    s_command.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    //s_command.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-    s_command.SIOOMode = QSPI_SIOO_INST_ONLY_FIRST_CMD;
-    s_command.DataMode = QSPI_DATA_4_LINES;
+    SetReadCommand(&s_command, true);
 
     /* Configure the memory mapped mode */
     s_mem_mapped_cfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
@@ -891,6 +1279,12 @@ QSPIHandle::Write(uint32_t address, uint32_t size, uint8_t* buffer)
     return pimpl_->Write(address, size, buffer);
 }
 
+QSPIHandle::Result
+QSPIHandle::Read(uint32_t address, uint32_t size, uint8_t* buffer)
+{
+    return pimpl_->Read(address, size, buffer);
+}
+
 QSPIHandle::Result QSPIHandle::Erase(uint32_t start_addr, uint32_t end_addr)
 {
     return pimpl_->Erase(start_addr, end_addr);
@@ -901,6 +1295,42 @@ QSPIHandle::Result QSPIHandle::EraseSector(uint32_t address)
     return pimpl_->EraseSector(address);
 }
 
+QSPIHandle::Result QSPIHandle::StartErase(uint32_t               start_addr,
+                                          uint32_t               end_addr,
+                                          EndCallbackFunctionPtr callback,
+                                          void*                  context)
+{
+    return pimpl_->StartErase(start_addr, end_addr, callback, context);
+}
+
+QSPIHandle::Result QSPIHandle::StartWrite(uint32_t               address,
+                                          uint32_t               size,
+                                          uint8_t*               buffer,
+                                          EndCallbackFunctionPtr callback,
+                                          void*                  context)
+{
+    return pimpl_->StartWrite(address, size, buffer, callback, context);
+}
+
+QSPIHandle::Result QSPIHandle::StartRead(uint32_t               address,
+                                         uint32_t               size,
+                                         uint8_t*               buffer,
+                                         EndCallbackFunctionPtr callback,
+                                         void*                  context)
+{
+    return pimpl_->StartRead(address, size, buffer, callback, context);
+}
+
+bool QSPIHandle::Process(uint32_t max_us)
+{
+    return pimpl_->Process(max_us);
+}
+
+bool QSPIHandle::IsBusy()
+{
+    return pimpl_->IsBusy();
+}
+
 void* QSPIHandle::GetData(uint32_t offset)
 {
     return pimpl_->GetData(offset);
@@ -942,8 +1372,32 @@ extern "C" void HAL_QSPI_MspInit(QSPI_HandleTypeDef* qspiHandle)
             GPIO_InitStruct.Alternate = af_config[i];
             HAL_GPIO_Init(port, &GPIO_InitStruct);
         }
+        /* The MDMA channel of StartRead(), after the one of MdmaHandle.
+         * The QSPI sets the source and destination up for each read. */
+        __HAL_RCC_MDMA_CLK_ENABLE();
+        MDMA_HandleTypeDef* hmdma            = qspi_impl.GetMdmaHandle();
+        hmdma->Instance                      = MDMA_Channel1;
+        hmdma->Init.Request                  = MDMA_REQUEST_QUADSPI_FIFO_TH;
+        hmdma->Init.TransferTriggerMode      = MDMA_BUFFER_TRANSFER;
+        hmdma->Init.Priority                 = MDMA_PRIORITY_HIGH;
+        hmdma->Init.Endianness               = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+        hmdma->Init.SourceInc                = MDMA_SRC_INC_DISABLE;
+        hmdma->Init.DestinationInc           = MDMA_DEST_INC_BYTE;
+        hmdma->Init.SourceDataSize           = MDMA_SRC_DATASIZE_BYTE;
+        hmdma->Init.DestDataSize             = MDMA_DEST_DATASIZE_BYTE;
+        hmdma->Init.DataAlignment            = MDMA_DATAALIGN_PACKENABLE;
+        hmdma->Init.BufferTransferLength     = 1; // the FIFO threshold
+        hmdma->Init.SourceBurst              = MDMA_SOURCE_BURST_SINGLE;
+        hmdma->Init.DestBurst                = MDMA_DEST_BURST_SINGLE;
+        hmdma->Init.SourceBlockAddressOffset = 0;
+        hmdma->Init.DestBlockAddressOffset   = 0;
+        HAL_MDMA_Init(hmdma);
+        __HAL_LINKDMA(qspiHandle, hmdma, *hmdma);
+        HAL_NVIC_SetPriority(MDMA_IRQn, DSY_IRQ_PRIORITY_MDMA, 0);
+        HAL_NVIC_EnableIRQ(MDMA_IRQn);
+
         /* QUADSPI interrupt Init */
-        HAL_NVIC_SetPriority(QUADSPI_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(QUADSPI_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
     }
 }
@@ -965,6 +1419,8 @@ extern "C" void HAL_QSPI_MspDeInit(QSPI_HandleTypeDef* qspiHandle)
             pin  = qspi_impl.GetPin(i);
             HAL_GPIO_DeInit(port, pin);
         }
+        if(qspi_impl.GetMdmaHandle()->Instance != nullptr)
+            HAL_MDMA_DeInit(qspi_impl.GetMdmaHandle());
         /* QUADSPI interrupt Deinit */
         HAL_NVIC_DisableIRQ(QUADSPI_IRQn);
         /* USER CODE BEGIN QUADSPI_MspDeInit 1 */
@@ -975,9 +1431,29 @@ extern "C" void HAL_QSPI_MspDeInit(QSPI_HandleTypeDef* qspiHandle)
 
 extern "C" void QUADSPI_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::QSPI_FLASH);
     HAL_QSPI_IRQHandler(qspi_impl.GetHalHandle());
 }
 
+/** Called by the MDMA interrupt of mdma.cpp, in place of its weak default */
+extern "C" void dsy_qspi_mdma_irq_handler(void)
+{
+    if(qspi_impl.GetMdmaHandle()->Instance != nullptr)
+        HAL_MDMA_IRQHandler(qspi_impl.GetMdmaHandle());
+}
+
+extern "C" void HAL_QSPI_RxCpltCallback(QSPI_HandleTypeDef* hqspi)
+{
+    (void)hqspi;
+    qspi_impl.ReadDone(true);
+}
+
+extern "C" void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef* hqspi)
+{
+    (void)hqspi;
+    qspi_impl.ReadDone(false);
+}
+
 } // namespace daisy
 
 /* HAL Overwrite Implementation */
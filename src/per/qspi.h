@@ -78,6 +78,19 @@ class QSPIHandle
             MODE_LAST,
         };
 
+        /**
+        Read command of the memory mapped mode and Read().
+        Quad SDR clocks the flash at 120MHz with one transfer per clock.
+        Quad DTR transfers on both edges, at 80MHz, as the flash
+        doesn't allow faster DTR reads, so it reads a third faster.
+        */
+        enum ReadMode
+        {
+            QUAD_SDR,       /**< & */
+            QUAD_DTR,       /**< & */
+            READ_MODE_LAST, /**< & */
+        };
+
         //SCK,  CE# (active low)
         struct
         {
@@ -89,8 +102,9 @@ class QSPIHandle
             dsy_gpio_pin ncs; /**< & */
         } pin_config;
 
-        Device device;
-        Mode   mode;
+        Device   device;
+        Mode     mode;
+        ReadMode read_mode = QUAD_SDR;
     };
 
     /** 
@@ -131,6 +145,18 @@ class QSPIHandle
         */
     Result Write(uint32_t address, uint32_t size, uint8_t* buffer);
 
+    /** 
+        Reads from the QSPI in indirect mode, into a buffer in RAM.
+        In memory mapped mode this switches to indirect mode and back,
+        which reinitializes the chip, so reading through GetData() is
+        faster for small reads. Can't be used while running from QSPI.
+        \param address Address to read from
+        \param size Number of bytes to read
+        \param buffer Buffer to read into
+        \return Result::OK or Result::ERR
+        */
+    Result Read(uint32_t address, uint32_t size, uint8_t* buffer);
+
     /** 
         Erases the area specified on the chip.
         Erasures will happen by 4K, 32K or 64K increments.
@@ -149,6 +175,83 @@ class QSPIHandle
         */
     Result EraseSector(uint32_t address);
 
+    /** A callback to be executed after an asynchronous erase or write */
+    typedef void (*EndCallbackFunctionPtr)(void* context, Result result);
+
+    /** 
+        Starts erasing the area specified on the chip, without blocking.
+        The erase is done by Process(), in 4kB sectors, or 64kB blocks
+        where the area allows it.
+        \param start_addr Address to begin erasing from
+        \param end_addr  Address to stop erasing at
+        \param callback called from Process() once done, can be nullptr
+        \param context passed to the callback
+        \return Result::ERR if an asynchronous operation is in progress
+        */
+    Result StartErase(uint32_t               start_addr,
+                      uint32_t               end_addr,
+                      EndCallbackFunctionPtr callback = nullptr,
+                      void*                  context  = nullptr);
+
+    /** 
+        Starts writing data to the QSPI, without blocking.
+        The pages are programmed by Process().
+        \param address Address to write to
+        \param size Buffer size
+        \param buffer Buffer to write, has to stay valid until completion
+        \param callback called from Process() once done, can be nullptr
+        \param context passed to the callback
+        \return Result::ERR if an asynchronous operation is in progress
+        */
+    Result StartWrite(uint32_t               address,
+                      uint32_t               size,
+                      uint8_t*               buffer,
+                      EndCallbackFunctionPtr callback = nullptr,
+                      void*                  context  = nullptr);
+
+    /** 
+        Starts reading from the QSPI into a buffer in RAM with the MDMA, in
+        indirect mode, without blocking, e.g. to prefetch the next part of
+        a sample that's played from the flash.
+        The CPU isn't involved until the read is done. The read ends with
+        Process(), which calls the callback, and goes back to the memory
+        mapped mode if it was in it. Initialize in INDIRECT_POLLING mode to
+        stream without switching modes, which reinitializes the chip.
+        The data cache is taken care of, the buffer shouldn't be touched
+        until the callback. If it doesn't start and end on a 32 byte cache
+        line, the data next to it mustn't be written during the read.
+        \param address Address to read from
+        \param size Number of bytes to read
+        \param buffer Buffer to read into
+        \param callback called from Process() once done, can be nullptr
+        \param context passed to the callback
+        \return Result::ERR if an asynchronous operation is in progress
+        */
+    Result StartRead(uint32_t               address,
+                     uint32_t               size,
+                     uint8_t*               buffer,
+                     EndCallbackFunctionPtr callback = nullptr,
+                     void*                  context  = nullptr);
+
+    /** 
+        Advances an asynchronous erase, write or read, to be called regularly,
+        e.g. from the main loop.
+        Each step (a page program, or a sector erase) is started, and
+        polled, in indirect mode. While a step is running the memory
+        can't be read, as the flash itself can't be read while it's busy.
+        Steps are started for up to max_us microseconds, after that the
+        memory mapped mode is restored until the next call. Switching modes
+        reinitializes the chip, so larger values finish faster.
+        \param max_us time to spend starting and polling steps
+        \return true while the operation is in progress
+        */
+    bool Process(uint32_t max_us = 0);
+
+    /** Returns true while an asynchronous erase, write or read is in progress.
+     *  No other functions that access the chip should be used then.
+     */
+    bool IsBusy();
+
     /** Returns the current class status. Useful for debugging.
      *  \returns Status
      */
@@ -179,6 +282,7 @@ class QSPIHandle
 
 #else
 
+#include <algorithm>
 #include <cstdint>
 #include "../tests/TestIsolator.h"
 
@@ -199,36 +303,49 @@ class QSPIHandle
         ERR
     };
 
+    /** A callback to be executed after an asynchronous erase or write */
+    typedef void (*EndCallbackFunctionPtr)(void* context, Result result);
+
     /** A mock-only function for resetting the memory to clean state 
      *  This should be called at the beginning of any test to ensure that
      *  data from a previous test does not interfere.
      */
     static Result ResetAndClear()
     {
-        testIsolator_.GetStateForCurrentTest()->memory_.clear();
+        auto state = testIsolator_.GetStateForCurrentTest();
+        state->memory_.clear();
+        state->busy_ = false;
         return Result::OK;
     }
 
 
     static Result Write(uint32_t address, uint32_t size, uint8_t* buffer)
     {
-        // 256-byte aligned, normalized address value
-        uint32_t adjusted_addr = (address) & (uint32_t)(~0xff);
+        assert(address + size <= kMaxAdjustedAddr);
         // Make sure memory is of approriate size
-        uint32_t total_bytes = adjusted_addr + size;
-        AdaptToSize(total_bytes);
-        // Copy data into vector
+        AdaptToSize(address + size);
+        // Like on the hardware, programming can only clear bits
         uint8_t* dest = testIsolator_.GetStateForCurrentTest()->memory_.data();
-        std::copy(&buffer[adjusted_addr],
-                  &buffer[adjusted_addr + size],
-                  &dest[adjusted_addr]);
+        for(uint32_t i = 0; i < size; i++)
+            dest[address + i] &= buffer[i];
+        return Result::OK;
+    }
+
+    static Result Read(uint32_t address, uint32_t size, uint8_t* buffer)
+    {
+        assert(address + size <= kMaxAdjustedAddr);
+        AdaptToSize(address + size);
+        std::copy_n(testIsolator_.GetStateForCurrentTest()->memory_.data()
+                        + address,
+                    size,
+                    buffer);
         return Result::OK;
     }
 
     static Result Erase(uint32_t start_addr, uint32_t end_addr)
     {
         uint32_t adjusted_start_addr = (start_addr) & (uint32_t)(~0xff);
-        uint32_t adjusted_end_addr   = (end_addr) & (uint32_t)(~0xff);
+        uint32_t adjusted_end_addr   = (end_addr + 0xff) & (uint32_t)(~0xff);
 
         // guard addresses
         assert(adjusted_start_addr < kMaxAdjustedAddr);
@@ -243,6 +360,65 @@ class QSPIHandle
         return Result::OK;
     }
 
+    /** Erases right away, the callback is called by the next Process() */
+    static Result StartErase(uint32_t               start_addr,
+                             uint32_t               end_addr,
+                             EndCallbackFunctionPtr callback = nullptr,
+                             void*                  context  = nullptr)
+    {
+        if(IsBusy())
+            return Result::ERR;
+        Erase(start_addr, end_addr);
+        SetPending(callback, context);
+        return Result::OK;
+    }
+
+    /** Writes right away, the callback is called by the next Process() */
+    static Result StartWrite(uint32_t               address,
+                             uint32_t               size,
+                             uint8_t*               buffer,
+                             EndCallbackFunctionPtr callback = nullptr,
+                             void*                  context  = nullptr)
+    {
+        if(IsBusy())
+            return Result::ERR;
+        Write(address, size, buffer);
+        SetPending(callback, context);
+        return Result::OK;
+    }
+
+    /** Reads right away, the callback is called by the next Process() */
+    static Result StartRead(uint32_t               address,
+                            uint32_t               size,
+                            uint8_t*               buffer,
+                            EndCallbackFunctionPtr callback = nullptr,
+                            void*                  context  = nullptr)
+    {
+        if(IsBusy())
+            return Result::ERR;
+        Read(address, size, buffer);
+        SetPending(callback, context);
+        return Result::OK;
+    }
+
+    /** Completes the asynchronous operation */
+    static bool Process(uint32_t max_us = 0)
+    {
+        (void)max_us;
+        auto state = testIsolator_.GetStateForCurrentTest();
+        if(!state->busy_)
+            return false;
+        state->busy_ = false;
+        if(state->callback_)
+            state->callback_(state->context_, Result::OK);
+        return IsBusy();
+    }
+
+    static bool IsBusy()
+    {
+        return testIsolator_.GetStateForCurrentTest()->busy_;
+    }
+
     /** Returns a pointer to the actual memory used 
     */
     static void* GetData(uint32_t offset = 0)
@@ -266,17 +442,32 @@ class QSPIHandle
     /** Adjusts the test state vector to an appropriate size */
     static void AdaptToSize(uint32_t required_bytes)
     {
-        if(testIsolator_.GetStateForCurrentTest()->memory_.size()
-           < required_bytes)
-            testIsolator_.GetStateForCurrentTest()->memory_.resize(
-                required_bytes, 0x00);
+        std::vector<uint8_t>& memory
+            = testIsolator_.GetStateForCurrentTest()->memory_;
+        // Pointers from GetData() stay valid, like the mapped memory
+        if(memory.capacity() < kMaxAdjustedAddr)
+            memory.reserve(kMaxAdjustedAddr);
+        if(memory.size() < required_bytes)
+            memory.resize(required_bytes, 0x00);
     }
     static constexpr uint32_t kMaxAdjustedAddr = 0x800000;
     struct QSPIState
     {
         // Emulate the byte-memory of the QSPI flash
         std::vector<uint8_t> memory_;
+        // Asynchronous operation waiting for Process()
+        bool                   busy_     = false;
+        EndCallbackFunctionPtr callback_ = nullptr;
+        void*                  context_  = nullptr;
     };
+
+    static void SetPending(EndCallbackFunctionPtr callback, void* context)
+    {
+        auto state       = testIsolator_.GetStateForCurrentTest();
+        state->busy_     = true;
+        state->callback_ = callback;
+        state->context_  = context;
+    }
     static TestIsolator<QSPIState> testIsolator_;
 };
 
@@ -1,11 +1,18 @@
 #include "rng.h"
 #include "util/hal_map.h"
+#include "util/scopedirqblocker.h"
+#include "util/SpscFifo.h"
+#include "sys/irq_priority.h"
 #include "sys/system.h"
 
 #define RNG_TIMEOUT 100
 
 namespace daisy
 {
+/** Values for TryGetValue(), filled by the interrupt */
+static SpscFifo<uint32_t, DSY_RNG_POOL_SIZE> rng_pool;
+static volatile bool                         rng_pool_running = false;
+
 void Random::Init()
 {
     /** NON-HAL except defines/macros */
@@ -19,8 +26,62 @@ void Random::DeInit()
     __HAL_RCC_RNG_CLK_DISABLE();
 }
 
+void Random::StartPool()
+{
+    rng_pool_running = true;
+    HAL_NVIC_SetPriority(HASH_RNG_IRQn, DSY_IRQ_PRIORITY_RNG, 0);
+    HAL_NVIC_EnableIRQ(HASH_RNG_IRQn);
+    ScopedIrqBlocker irq_blocker;
+    RNG->CR |= RNG_CR_IE;
+}
+
+void Random::StopPool()
+{
+    rng_pool_running = false;
+    {
+        ScopedIrqBlocker irq_blocker;
+        RNG->CR &= ~RNG_CR_IE;
+    }
+    HAL_NVIC_DisableIRQ(HASH_RNG_IRQn);
+}
+
+bool Random::TryGetValue(uint32_t& value)
+{
+    if(rng_pool.PopFront(value))
+    {
+        // there's room again, the interrupt stops when the pool is full
+        if(rng_pool_running)
+        {
+            ScopedIrqBlocker irq_blocker;
+            RNG->CR |= RNG_CR_IE;
+        }
+        return true;
+    }
+    if(rng_pool_running || !IsReady())
+        return false;
+    value = RNG->DR;
+    return true;
+}
+
+size_t Random::GetNumAvailable()
+{
+    return rng_pool.GetNumElements();
+}
+
 uint32_t Random::GetValue()
 {
+    if(rng_pool_running)
+    {
+        const uint32_t start = System::GetNow();
+        uint32_t       value;
+        while(!TryGetValue(value))
+        {
+            if(System::GetNow() - start > RNG_TIMEOUT)
+                return 0;
+        }
+        return value;
+    }
+
     /** HAL code */
     // HAL_RNG_GenerateRandomNumber()
     uint32_t start;
@@ -50,3 +111,26 @@ bool Random::IsReady()
 }
 
 } // namespace daisy
+
+using namespace daisy;
+
+extern "C" void HASH_RNG_IRQHandler(void)
+{
+    const uint32_t sr = RNG->SR;
+    if(sr & (RNG_SR_SEIS | RNG_SR_CEIS))
+    {
+        // a seed error restarts the generator, the value is discarded
+        RNG->SR = ~(sr & (RNG_SR_SEIS | RNG_SR_CEIS));
+        if(sr & RNG_SR_SEIS)
+        {
+            RNG->CR &= ~RNG_CR_RNGEN;
+            RNG->CR |= RNG_CR_RNGEN;
+        }
+        return;
+    }
+    if((sr & RNG_SR_DRDY) == 0)
+        return;
+    rng_pool.PushBack(RNG->DR);
+    if(rng_pool.IsFull())
+        RNG->CR &= ~RNG_CR_IE;
+}
@@ -1,6 +1,11 @@
 #pragma once
 #include "daisy_core.h"
 
+/** Number of values the pool of Random holds, a power of two */
+#ifndef DSY_RNG_POOL_SIZE
+#define DSY_RNG_POOL_SIZE 16
+#endif
+
 namespace daisy
 {
 /** @brief True Random Number Generator access
@@ -8,6 +13,13 @@ namespace daisy
  *  @ingroup utility
  * 
  *  Provides static access to the built-in True Random Number Generator
+ *
+ *  A new value takes the peripheral tens of clock cycles of its own
+ *  clock, and polling for it can block. After StartPool(), the RNG
+ *  interrupt keeps a small pool of values filled in the background, so
+ *  TryGetValue() never waits, and GetValue() only waits when the pool
+ *  was emptied faster than it fills. For noise at audio rate, seed a
+ *  FastRandom with one of the values instead.
  */
 class Random
 {
@@ -27,9 +39,31 @@ class Random
     /** Deinitializes the Peripheral */
     static void DeInit();
 
+    /** Starts filling the pool of values from the RNG interrupt
+     *
+     *  Call it after Init(). The interrupt only runs while the pool
+     *  isn't full.
+     */
+    static void StartPool();
+
+    /** Stops filling the pool, the values in it can still be taken */
+    static void StopPool();
+
+    /** Takes a value without waiting, from the pool or, without the
+     *  pool, from the peripheral if one is ready. Values can be taken
+     *  from one interrupt or the main loop, not from both.
+     *
+     *  \param value set to a 32-bit random number
+     *  \return false if there is no value
+     */
+    static bool TryGetValue(uint32_t& value);
+
+    /** Returns the number of values in the pool */
+    static size_t GetNumAvailable();
+
     /** Returns a randomly generated 32-bit number
-     *  This is done by polling the peripheral, 
-     *  and can block for up to 100ms.
+     *  This is done by polling the peripheral, or the pool after
+     *  StartPool(), and can block for up to 100ms.
      * 
      *  To avoid blocking issues, the IsReady function can be 
      *  used to check if a value is ready before calling this function.
@@ -1,5 +1,7 @@
 #include "per/sai.h"
 #include "daisy_core.h"
+#include "sys/dma_streams.h"
+#include "util/IrqProfiler.h"
 extern "C"
 {
 #include "util/hal_map.h"
@@ -25,11 +27,19 @@ class SaiHandle::Impl
                                        size_t                         size,
                                        SaiHandle::CallbackFunctionPtr callback);
     SaiHandle::Result StopDmaTransfer();
+    size_t            GetOffset() const;
+
+    SaiHandle::Result SetSampleRate(SaiHandle::Config::SampleRate samplerate);
 
     // Utility functions
     float  GetSampleRate();
     size_t GetBlockSize();
     float  GetBlockRate();
+    size_t GetSlotCount() const
+    {
+        return config_.protocol == Config::Protocol::TDM ? config_.tdm_slots
+                                                         : 2;
+    }
 
     SaiHandle::Config config_;
     SAI_HandleTypeDef sai_a_handle_, sai_b_handle_;
@@ -43,9 +53,31 @@ class SaiHandle::Impl
     /** Offset stored for weird inter-SAI stuff.*/
     size_t dma_offset;
 
+    /** Set when the DMA runs without a callback, e.g. the 2nd SAI of a 4
+     *  channel setup. Its half/complete interrupts are then turned off,
+     *  and the offset is read from the DMA counter instead. */
+    bool polled_;
+
+    /** IRQ of the DMA stream that triggers the callbacks (receiving block),
+     *  kNoDmaIrq when both blocks transmit */
+    IRQn_Type rx_dma_irqn_;
+
+    /** Not a device IRQ, used while no block receives */
+    static constexpr IRQn_Type kNoDmaIrq = static_cast<IRQn_Type>(-128);
+
+    /** Number of callbacks that were still running when the next
+     *  half-transfer of the DMA completed. */
+    volatile uint32_t missed_deadlines_;
+
     /** Callback that dispatches user callback from Cplt and HalfCplt DMA Callbacks */
     void InternalCallback(size_t offset);
 
+    /** Adds the time since the DMA reached the half or the end of the
+     *  buffer to the IrqProfiler, from the number of slots it has moved on
+     *  since. Called at the start of the DMA interrupts. */
+    void MeasureIrqLatency(const DMA_HandleTypeDef* hdma,
+                           IrqProfiler::Source      source);
+
     /** Pin Initiazlization */
     void InitPins();
     void DeInitPins();
@@ -53,6 +85,12 @@ class SaiHandle::Impl
     /** DMA Initialization */
     void InitDma(PeripheralBlock block);
     void DeInitDma(PeripheralBlock block);
+
+    /** Name of the SAI in the DmaStreamAllocator */
+    const char* GetDmaOwner() const
+    {
+        return config_.periph == Config::Peripheral::SAI_1 ? "sai1" : "sai2";
+    }
 };
 
 // ================================================================
@@ -65,11 +103,29 @@ static void Error_Handler()
     while(1) {}
 }
 
+/** Returns the HAL audio frequency for a samplerate setting */
+static uint32_t GetAudioFrequency(SaiHandle::Config::SampleRate samplerate)
+{
+    switch(samplerate)
+    {
+        case SaiHandle::Config::SampleRate::SAI_8KHZ:
+            return SAI_AUDIO_FREQUENCY_8K;
+        case SaiHandle::Config::SampleRate::SAI_16KHZ:
+            return SAI_AUDIO_FREQUENCY_16K;
+        case SaiHandle::Config::SampleRate::SAI_32KHZ:
+            return SAI_AUDIO_FREQUENCY_32K;
+        case SaiHandle::Config::SampleRate::SAI_96KHZ:
+            return SAI_AUDIO_FREQUENCY_96K;
+        case SaiHandle::Config::SampleRate::SAI_48KHZ:
+        default: return SAI_AUDIO_FREQUENCY_48K;
+    }
+}
+
 // ================================================================
 // Static References for available SaiHandle::Impls
 // ================================================================
 
-static SaiHandle::Impl sai_handles[1];
+static SaiHandle::Impl sai_handles[2];
 
 // ================================================================
 // SAI Functions
@@ -83,10 +139,11 @@ SaiHandle::Result SaiHandle::Impl::Init(const SaiHandle::Config& config)
         return Result::ERR;
 
     // Default Buffer states
-    buff_rx_   = nullptr;
-    buff_tx_   = nullptr;
-    buff_size_ = 0;
-    config_    = config;
+    buff_rx_     = nullptr;
+    buff_tx_     = nullptr;
+    buff_size_   = 0;
+    config_      = config;
+    rx_dma_irqn_ = kNoDmaIrq;
 
     constexpr SAI_Block_TypeDef* a_instances[2] = {SAI1_Block_A, SAI2_Block_A};
     constexpr SAI_Block_TypeDef* b_instances[2] = {SAI1_Block_B, SAI2_Block_B};
@@ -95,30 +152,8 @@ SaiHandle::Result SaiHandle::Impl::Init(const SaiHandle::Config& config)
     sai_b_handle_.Instance = b_instances[sai_idx];
 
     // Samplerate
-    switch(config.sr)
-    {
-        case Config::SampleRate::SAI_8KHZ:
-            sai_a_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_8K;
-            sai_b_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_8K;
-            break;
-        case Config::SampleRate::SAI_16KHZ:
-            sai_a_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_16K;
-            sai_b_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_16K;
-            break;
-        case Config::SampleRate::SAI_32KHZ:
-            sai_a_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_32K;
-            sai_b_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_32K;
-            break;
-        case Config::SampleRate::SAI_48KHZ:
-            sai_a_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_48K;
-            sai_b_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_48K;
-            break;
-        case Config::SampleRate::SAI_96KHZ:
-            sai_a_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_96K;
-            sai_b_handle_.Init.AudioFrequency = SAI_AUDIO_FREQUENCY_96K;
-            break;
-        default: break;
-    }
+    sai_a_handle_.Init.AudioFrequency = GetAudioFrequency(config.sr);
+    sai_b_handle_.Init.AudioFrequency = GetAudioFrequency(config.sr);
     // Audio Mode A
     if(config.a_sync == Config::Sync::MASTER)
     {
@@ -156,20 +191,36 @@ SaiHandle::Result SaiHandle::Impl::Init(const SaiHandle::Config& config)
     uint32_t protocol;
     switch(config.bit_depth)
     {
-        // case Config::BitDepth::SAI_16BIT:
-        //     bd       = SAI_PROTOCOL_DATASIZE_16BIT;
-        //     protocol = SAI_I2S_STANDARD;
-        //     break;
+        case Config::BitDepth::SAI_16BIT:
+            bd       = SAI_PROTOCOL_DATASIZE_16BIT;
+            protocol = SAI_I2S_STANDARD;
+            break;
         case Config::BitDepth::SAI_24BIT:
             bd       = SAI_PROTOCOL_DATASIZE_24BIT;
             protocol = SAI_I2S_MSBJUSTIFIED;
             break;
-        // case Config::BitDepth::SAI_32BIT:
-        //     // Untested Configuration
-        //     bd       = SAI_PROTOCOL_DATASIZE_32BIT;
-        //     protocol = SAI_I2S_STANDARD;
-        //     break;
-        default: break;
+        case Config::BitDepth::SAI_32BIT:
+            // Untested Configuration
+            bd       = SAI_PROTOCOL_DATASIZE_32BIT;
+            protocol = SAI_I2S_STANDARD;
+            break;
+        default: return Result::ERR;
+    }
+    uint32_t nbslot = 2;
+    if(config.protocol == Config::Protocol::TDM)
+    {
+        const uint32_t width      = config.tdm_slot_width;
+        const uint32_t frame_bits = config.tdm_slots * width;
+        if(config.tdm_slots < 2 || config.tdm_slots > 16
+           || (width != 16 && width != 32)
+           || (width == 16 && config.bit_depth != Config::BitDepth::SAI_16BIT)
+           || frame_bits > 256 || (frame_bits & (frame_bits - 1)) != 0)
+            return Result::ERR;
+
+        protocol = SAI_PCM_SHORT;
+        nbslot   = config.tdm_slots;
+        if(config.bit_depth == Config::BitDepth::SAI_16BIT && width == 32)
+            bd = SAI_PROTOCOL_DATASIZE_16BITEXTENDED;
     }
 
     // Generic Inits that we don't have API control over.
@@ -189,13 +240,13 @@ SaiHandle::Result SaiHandle::Impl::Init(const SaiHandle::Config& config)
     sai_b_handle_.Init.MonoStereoMode = SAI_STEREOMODE;
     sai_b_handle_.Init.CompandingMode = SAI_NOCOMPANDING;
     sai_b_handle_.Init.TriState       = SAI_OUTPUT_NOTRELEASED;
-    if(HAL_SAI_InitProtocol(&sai_a_handle_, protocol, bd, 2) != HAL_OK)
+    if(HAL_SAI_InitProtocol(&sai_a_handle_, protocol, bd, nbslot) != HAL_OK)
     {
         Error_Handler();
         return Result::ERR;
     }
 
-    if(HAL_SAI_InitProtocol(&sai_b_handle_, protocol, bd, 2) != HAL_OK)
+    if(HAL_SAI_InitProtocol(&sai_b_handle_, protocol, bd, nbslot) != HAL_OK)
     {
         Error_Handler();
         return Result::ERR;
@@ -219,9 +270,10 @@ SaiHandle::Result SaiHandle::Impl::DeInit()
 
 void SaiHandle::Impl::InitDma(PeripheralBlock block)
 {
-    SAI_HandleTypeDef* hsai;
-    DMA_HandleTypeDef* hdma;
-    uint32_t           req, dir;
+    SAI_HandleTypeDef*         hsai;
+    DMA_HandleTypeDef*         hdma;
+    DmaStreamAllocator::Stream stream;
+    uint32_t                   req, dir;
 
     const int sai_idx = int(config_.periph);
 
@@ -236,9 +288,20 @@ void SaiHandle::Impl::InitDma(PeripheralBlock block)
                                                         : DMA_REQUEST_SAI2_A;
 
         if(sai_idx == int(Config::Peripheral::SAI_1))
+        {
             hdma->Instance = DMA1_Stream0;
+            stream         = DmaStreamAllocator::Stream::DMA_1_STREAM_0;
+        }
         else
+        {
             hdma->Instance = DMA1_Stream3;
+            stream         = DmaStreamAllocator::Stream::DMA_1_STREAM_3;
+        }
+
+        if(config_.a_dir == Config::Direction::RECEIVE)
+            rx_dma_irqn_ = sai_idx == int(Config::Peripheral::SAI_1)
+                               ? DMA1_Stream0_IRQn
+                               : DMA1_Stream3_IRQn;
     }
     else
     {
@@ -251,11 +314,25 @@ void SaiHandle::Impl::InitDma(PeripheralBlock block)
                                                         : DMA_REQUEST_SAI2_B;
 
         if(sai_idx == int(Config::Peripheral::SAI_1))
+        {
             hdma->Instance = DMA1_Stream1;
+            stream         = DmaStreamAllocator::Stream::DMA_1_STREAM_1;
+        }
         else
+        {
             hdma->Instance = DMA1_Stream4;
+            stream         = DmaStreamAllocator::Stream::DMA_1_STREAM_4;
+        }
+
+        if(config_.b_dir == Config::Direction::RECEIVE)
+            rx_dma_irqn_ = sai_idx == int(Config::Peripheral::SAI_1)
+                               ? DMA1_Stream1_IRQn
+                               : DMA1_Stream4_IRQn;
     }
 
+    // The stream is fixed, a conflict is only recorded for the application
+    DmaStreamAllocator::Claim(stream, GetDmaOwner(), req);
+
     // Generic
     hdma->Init.Request             = req;
     hdma->Init.Direction           = dir;
@@ -276,25 +353,57 @@ void SaiHandle::Impl::InitDma(PeripheralBlock block)
 
 void SaiHandle::Impl::DeInitDma(PeripheralBlock block)
 {
+    const bool sai1 = config_.periph == Config::Peripheral::SAI_1;
     if(block == PeripheralBlock::BLOCK_A)
     {
+        DmaStreamAllocator::Release(
+            sai1 ? DmaStreamAllocator::Stream::DMA_1_STREAM_0
+                 : DmaStreamAllocator::Stream::DMA_1_STREAM_3,
+            GetDmaOwner());
         HAL_DMA_DeInit(sai_a_handle_.hdmarx);
         HAL_DMA_DeInit(sai_a_handle_.hdmatx);
     }
     else if(block == PeripheralBlock::BLOCK_B)
     {
+        DmaStreamAllocator::Release(
+            sai1 ? DmaStreamAllocator::Stream::DMA_1_STREAM_1
+                 : DmaStreamAllocator::Stream::DMA_1_STREAM_4,
+            GetDmaOwner());
         HAL_DMA_DeInit(sai_b_handle_.hdmarx);
         HAL_DMA_DeInit(sai_b_handle_.hdmatx);
     }
 }
 
-void SaiHandle::Impl::InternalCallback(size_t offset)
+void DSY_AUDIO_FUNC SaiHandle::Impl::InternalCallback(size_t offset)
 {
     int32_t *in, *out;
     in  = buff_rx_ + offset;
     out = buff_tx_ + offset;
     if(callback_)
+    {
         callback_(in, out, buff_size_ / 2);
+        // The interrupt for the other half of the buffer becoming ready
+        // is pending, so the DMA has already moved on to the buffer that
+        // was just written: the callback missed its deadline.
+        if(rx_dma_irqn_ != kNoDmaIrq && HAL_NVIC_GetPendingIRQ(rx_dma_irqn_))
+            missed_deadlines_ = missed_deadlines_ + 1;
+    }
+}
+
+void DSY_AUDIO_FUNC
+SaiHandle::Impl::MeasureIrqLatency(const DMA_HandleTypeDef* hdma,
+                                   IrqProfiler::Source      source)
+{
+    const size_t half = buff_size_ / 2;
+    if(half == 0)
+        return;
+    // the counter restarts at buff_size_ at the end of the buffer
+    const size_t remaining = __HAL_DMA_GET_COUNTER(hdma);
+    const size_t moved
+        = remaining > half ? buff_size_ - remaining : half - remaining;
+    const float slot_rate       = GetSampleRate() * GetSlotCount();
+    const float cycles_per_slot = float(System::GetCpuFreq()) / slot_rate;
+    IrqProfiler::AddLatency(source, uint32_t(moved * cycles_per_slot));
 }
 
 SaiHandle::Result
@@ -303,10 +412,11 @@ SaiHandle::Impl::StartDmaTransfer(int32_t*                       buffer_rx,
                                   size_t                         size,
                                   SaiHandle::CallbackFunctionPtr callback)
 {
-    buff_rx_   = buffer_rx;
-    buff_tx_   = buffer_tx;
-    buff_size_ = size;
-    callback_  = callback;
+    buff_rx_          = buffer_rx;
+    buff_tx_          = buffer_tx;
+    buff_size_        = size;
+    callback_         = callback;
+    missed_deadlines_ = 0;
 
     // This assumes there will be one master and one slave
     if(config_.a_sync == Config::Sync::SLAVE)
@@ -328,8 +438,34 @@ SaiHandle::Impl::StartDmaTransfer(int32_t*                       buffer_rx,
             : HAL_SAI_Transmit_DMA(&sai_a_handle_, (uint8_t*)buffer_tx, size);
     }
 
+    // Only the receiving stream of the SAI with the callback needs its
+    // half/complete interrupts. Turning the others off leaves a single
+    // interrupt per half block, even with two SAIs. The error interrupts
+    // stay on.
+    const bool a_rx = config_.a_dir == Config::Direction::RECEIVE;
+    const bool b_rx = config_.b_dir == Config::Direction::RECEIVE;
+    polled_         = callback == nullptr && (a_rx || b_rx);
+    if(polled_ || (b_rx && !a_rx))
+        __HAL_DMA_DISABLE_IT(&sai_a_dma_handle_, DMA_IT_HT | DMA_IT_TC);
+    if(polled_ || (a_rx && !b_rx))
+        __HAL_DMA_DISABLE_IT(&sai_b_dma_handle_, DMA_IT_HT | DMA_IT_TC);
+
     return Result::OK;
 }
+
+size_t SaiHandle::Impl::GetOffset() const
+{
+    if(!polled_)
+        return dma_offset;
+    // The half that was completed last is the one the DMA isn't in.
+    // This also holds if this SAI runs slightly ahead of or behind the
+    // one with the callback.
+    const DMA_HandleTypeDef* hdma = config_.a_dir == Config::Direction::RECEIVE
+                                        ? &sai_a_dma_handle_
+                                        : &sai_b_dma_handle_;
+    const size_t remaining = __HAL_DMA_GET_COUNTER(hdma);
+    return remaining > buff_size_ / 2 ? buff_size_ / 2 : 0;
+}
 SaiHandle::Result SaiHandle::Impl::StopDmaTransfer()
 {
     HAL_SAI_DMAStop(&sai_a_handle_);
@@ -337,6 +473,42 @@ SaiHandle::Result SaiHandle::Impl::StopDmaTransfer()
     return Result::OK;
 }
 
+SaiHandle::Result
+SaiHandle::Impl::SetSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    SAI_HandleTypeDef* master;
+    if(config_.a_sync == Config::Sync::MASTER)
+        master = &sai_a_handle_;
+    else if(config_.b_sync == Config::Sync::MASTER)
+        master = &sai_b_handle_;
+    else
+        return Result::ERR;
+
+    // Same divider computation as HAL_SAI_Init() with NODIV = 0
+    const uint32_t fs  = GetAudioFrequency(samplerate);
+    const uint32_t clk = HAL_RCCEx_GetPeriphCLKFreq(
+        config_.periph == Config::Peripheral::SAI_1 ? RCC_PERIPHCLK_SAI1
+                                                    : RCC_PERIPHCLK_SAI23);
+    const uint32_t tmpval = (clk * 10U) / (fs * 256U);
+    uint32_t       mckdiv = tmpval / 10U;
+    if((tmpval % 10U) > 8U)
+        mckdiv++;
+
+    // MCKDIV can only be written while the block is disabled.
+    // Disabling takes effect at the end of the current frame. The
+    // synchronous block and both DMA streams simply pause meanwhile.
+    SAI_Block_TypeDef* block = master->Instance;
+    CLEAR_BIT(block->CR1, SAI_xCR1_SAIEN);
+    while(READ_BIT(block->CR1, SAI_xCR1_SAIEN)) {}
+    MODIFY_REG(block->CR1, SAI_xCR1_MCKDIV, mckdiv << SAI_xCR1_MCKDIV_Pos);
+    SET_BIT(block->CR1, SAI_xCR1_SAIEN);
+
+    master->Init.AudioFrequency = fs;
+    master->Init.Mckdiv         = mckdiv;
+    config_.sr                  = samplerate;
+    return Result::OK;
+}
+
 float SaiHandle::Impl::GetSampleRate()
 {
     switch(config_.sr)
@@ -351,8 +523,8 @@ float SaiHandle::Impl::GetSampleRate()
 }
 size_t SaiHandle::Impl::GetBlockSize()
 {
-    // Buffer handled in halves, 2 samples per frame (1 per channel)
-    return buff_size_ / 2 / 2;
+    // Buffer handled in halves, 1 sample per slot in each frame
+    return buff_size_ / 2 / GetSlotCount();
 }
 float SaiHandle::Impl::GetBlockRate()
 {
@@ -453,18 +625,18 @@ extern "C" void HAL_SAI_MspInit(SAI_HandleTypeDef* hsai)
                                    ? SaiHandle::Impl::PeripheralBlock::BLOCK_A
                                    : SaiHandle::Impl::PeripheralBlock::BLOCK_B);
     }
-    // else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
-    // {
-    //     __HAL_RCC_GPIOA_CLK_ENABLE();
-    //     __HAL_RCC_GPIOD_CLK_ENABLE();
-    //     __HAL_RCC_GPIOG_CLK_ENABLE();
-    //     __HAL_RCC_SAI2_CLK_ENABLE();
-    //     sai_handles[1].InitPins();
-    //     __HAL_RCC_DMA1_CLK_ENABLE();
-    //     sai_handles[1].InitDma(hsai->Instance == SAI2_Block_A
-    //                                ? SaiHandle::Impl::PeripheralBlock::BLOCK_A
-    //                                : SaiHandle::Impl::PeripheralBlock::BLOCK_B);
-    // }
+    else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
+    {
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+        __HAL_RCC_GPIOD_CLK_ENABLE();
+        __HAL_RCC_GPIOG_CLK_ENABLE();
+        __HAL_RCC_SAI2_CLK_ENABLE();
+        sai_handles[1].InitPins();
+        __HAL_RCC_DMA1_CLK_ENABLE();
+        sai_handles[1].InitDma(hsai->Instance == SAI2_Block_A
+                                   ? SaiHandle::Impl::PeripheralBlock::BLOCK_A
+                                   : SaiHandle::Impl::PeripheralBlock::BLOCK_B);
+    }
 }
 extern "C" void HAL_SAI_MspDeInit(SAI_HandleTypeDef* hsai)
 {
@@ -473,63 +645,84 @@ extern "C" void HAL_SAI_MspDeInit(SAI_HandleTypeDef* hsai)
         __HAL_RCC_SAI1_CLK_DISABLE();
         sai_handles[0].DeInitPins();
     }
-    // else if(hsai->Instance == SAI2_Block_A)
-    // {
-    //     __HAL_RCC_SAI2_CLK_DISABLE();
-    //     sai_handles[1].DeInitPins();
-    // }
+    else if(hsai->Instance == SAI2_Block_A)
+    {
+        __HAL_RCC_SAI2_CLK_DISABLE();
+        sai_handles[1].DeInitPins();
+    }
 }
 
 // ================================================================
 // ISRs and event handlers
 // ================================================================
 
-extern "C" void DMA1_Stream0_IRQHandler(void)
+extern "C" void DSY_AUDIO_FUNC DMA1_Stream0_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SAI_1);
+#ifdef DSY_IRQ_PROFILING
+    sai_handles[0].MeasureIrqLatency(&sai_handles[0].sai_a_dma_handle_,
+                                      IrqProfiler::Source::SAI_1);
+#endif
     HAL_DMA_IRQHandler(&sai_handles[0].sai_a_dma_handle_);
 }
 
-extern "C" void DMA1_Stream1_IRQHandler(void)
+extern "C" void DSY_AUDIO_FUNC DMA1_Stream1_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SAI_1);
+#ifdef DSY_IRQ_PROFILING
+    sai_handles[0].MeasureIrqLatency(&sai_handles[0].sai_b_dma_handle_,
+                                      IrqProfiler::Source::SAI_1);
+#endif
     HAL_DMA_IRQHandler(&sai_handles[0].sai_b_dma_handle_);
 }
 
-// extern "C" void DMA1_Stream3_IRQHandler(void)
-// {
-//     HAL_DMA_IRQHandler(&sai_handles[1].sai_a_dma_handle_);
-// }
+extern "C" void DSY_AUDIO_FUNC DMA1_Stream3_IRQHandler(void)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::SAI_2);
+#ifdef DSY_IRQ_PROFILING
+    sai_handles[1].MeasureIrqLatency(&sai_handles[1].sai_a_dma_handle_,
+                                      IrqProfiler::Source::SAI_2);
+#endif
+    HAL_DMA_IRQHandler(&sai_handles[1].sai_a_dma_handle_);
+}
 
-// extern "C" void DMA1_Stream4_IRQHandler(void)
-// {
-//     HAL_DMA_IRQHandler(&sai_handles[1].sai_b_dma_handle_);
-// }
+extern "C" void DSY_AUDIO_FUNC DMA1_Stream4_IRQHandler(void)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::SAI_2);
+#ifdef DSY_IRQ_PROFILING
+    sai_handles[1].MeasureIrqLatency(&sai_handles[1].sai_b_dma_handle_,
+                                      IrqProfiler::Source::SAI_2);
+#endif
+    HAL_DMA_IRQHandler(&sai_handles[1].sai_b_dma_handle_);
+}
 
-extern "C" void HAL_SAI_RxHalfCpltCallback(SAI_HandleTypeDef* hsai)
+extern "C" void DSY_AUDIO_FUNC
+HAL_SAI_RxHalfCpltCallback(SAI_HandleTypeDef* hsai)
 {
     if(hsai->Instance == SAI1_Block_A || hsai->Instance == SAI1_Block_B)
     {
         sai_handles[0].dma_offset = 0;
         sai_handles[0].InternalCallback(0);
     }
-    // else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
-    // {
-    //     sai_handles[1].dma_offset = 0;
-    //     sai_handles[1].InternalCallback(0);
-    // }
+    else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
+    {
+        sai_handles[1].dma_offset = 0;
+        sai_handles[1].InternalCallback(0);
+    }
 }
 
-extern "C" void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef* hsai)
+extern "C" void DSY_AUDIO_FUNC HAL_SAI_RxCpltCallback(SAI_HandleTypeDef* hsai)
 {
     if(hsai->Instance == SAI1_Block_A || hsai->Instance == SAI1_Block_B)
     {
         sai_handles[0].dma_offset = sai_handles[0].buff_size_ / 2;
         sai_handles[0].InternalCallback(sai_handles[0].dma_offset);
     }
-    // else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
-    // {
-    //     sai_handles[1].dma_offset = sai_handles[1].buff_size_ / 2;
-    //     sai_handles[1].InternalCallback(sai_handles[1].dma_offset);
-    // }
+    else if(hsai->Instance == SAI2_Block_A || hsai->Instance == SAI2_Block_B)
+    {
+        sai_handles[1].dma_offset = sai_handles[1].buff_size_ / 2;
+        sai_handles[1].InternalCallback(sai_handles[1].dma_offset);
+    }
 }
 
 // ================================================================
@@ -538,8 +731,7 @@ extern "C" void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef* hsai)
 
 SaiHandle::Result SaiHandle::Init(const Config& config)
 {
-    // SAI2 disabled on this branch
-    if (int(config.periph) > 0)
+    if(int(config.periph) > int(Config::Peripheral::SAI_2))
         return SaiHandle::Result::ERR;
 
     pimpl_ = &sai_handles[int(config.periph)];
@@ -574,6 +766,16 @@ float SaiHandle::GetSampleRate()
     return pimpl_->GetSampleRate();
 }
 
+SaiHandle::Result SaiHandle::SetSampleRate(Config::SampleRate samplerate)
+{
+    return pimpl_->SetSampleRate(samplerate);
+}
+
+size_t SaiHandle::GetSlotCount() const
+{
+    return pimpl_->GetSlotCount();
+}
+
 size_t SaiHandle::GetBlockSize()
 {
     return pimpl_->GetBlockSize();
@@ -586,7 +788,17 @@ float SaiHandle::GetBlockRate()
 
 size_t SaiHandle::GetOffset() const
 {
-    return pimpl_->dma_offset;
+    return pimpl_->GetOffset();
+}
+
+uint32_t SaiHandle::GetMissedDeadlineCount() const
+{
+    return pimpl_->missed_deadlines_;
+}
+
+void SaiHandle::ResetMissedDeadlineCount()
+{
+    pimpl_->missed_deadlines_ = 0;
 }
 
 
@@ -7,7 +7,7 @@
 namespace daisy
 {
 /**
- * Support for I2S Audio Protocol with different bit-depth, samplerate options
+ * Support for I2S and TDM Audio Protocols with different bit-depth, samplerate options
  * Allows for master or slave, as well as freedom of selecting direction,
  * and other behavior for each peripheral, and block.
  *
@@ -49,7 +49,6 @@ class SaiHandle
         enum class Peripheral
         {
             SAI_1,
-            /** NOTE: THIS IS DISABLED ON THIS BRANCH! */
             SAI_2,
         };
 
@@ -66,9 +65,9 @@ class SaiHandle
         /** Bit Depth that the hardware expects to be transferred to/from the device. */
         enum class BitDepth
         {
-            // SAI_16BIT,
+            SAI_16BIT,
             SAI_24BIT,
-            // SAI_32BIT,
+            SAI_32BIT,
         };
 
         /** Specifies whether a particular block is the master or the slave
@@ -88,6 +87,17 @@ class SaiHandle
             RECEIVE,
         };
 
+        /** Frame format of the serial audio data. */
+        enum class Protocol
+        {
+            /** two slots per frame, I2S or MSB justified by bit depth */
+            I2S,
+            /** tdm_slots slots per frame, with a one bit frame sync pulse
+             ** before the first slot (a.k.a. DSP mode)
+             */
+            TDM,
+        };
+
         Peripheral periph;
         struct
         {
@@ -97,6 +107,20 @@ class SaiHandle
         BitDepth   bit_depth;
         Sync       a_sync, b_sync;
         Direction  a_dir, b_dir;
+        Protocol   protocol = Protocol::I2S;
+
+        /** number of slots per frame with Protocol::TDM (2-16)
+         ** The frame (tdm_slots * tdm_slot_width) must be a power of two
+         ** of at most 256 bits, as the bit clock is derived from a 256 * fs
+         ** master clock. The audio callbacks read at least two slots per
+         ** frame, so a single slot isn't supported.
+         */
+        uint8_t tdm_slots = 8;
+
+        /** width of each slot in bits with Protocol::TDM (16 or 32)
+         ** 16 bit slots are only possible with 16 bit data.
+         */
+        uint8_t tdm_slot_width = 32;
     };
 
     /** Return values for SAI functions */
@@ -142,8 +166,22 @@ class SaiHandle
     /** Returns the samplerate based on the current configuration */
     float GetSampleRate();
 
+    /** Returns the number of slots (channels) per frame
+     ** 2 for I2S, or the configured number of slots for TDM */
+    size_t GetSlotCount() const;
+
+    /** Changes the samplerate by only reprogramming the master clock
+     ** divider, while the DMA keeps running.
+     ** The master block is disabled for about one frame to apply the change,
+     ** so this should be called between DMA transfers (e.g. at the start of
+     ** the callback). Codecs that derive their timing from the SAI clocks
+     ** keep running without re-initialization.
+     ** Returns ERR if neither block is the clock master.
+     */
+    Result SetSampleRate(Config::SampleRate samplerate);
+
     /** Returns the number of samples per audio block
-     ** Calculated as Buffer Size / 2 / number of channels */
+     ** Calculated as Buffer Size / 2 / number of slots */
     size_t GetBlockSize();
 
     /** Returns the Block Rate of the current stream based on the size
@@ -154,6 +192,15 @@ class SaiHandle
     /** Returns the current offset within the SAI buffer, will be either 0 or size/2 */
     size_t GetOffset() const;
 
+    /** Returns the number of callbacks that were still running when the DMA
+     ** completed the next half of the buffer (i.e. audio was dropped or repeated).
+     ** The count is reset when the DMA is started.
+     */
+    uint32_t GetMissedDeadlineCount() const;
+
+    /** Resets the missed deadline count back to zero */
+    void ResetMissedDeadlineCount();
+
     inline bool IsInitialized() const
     {
         return pimpl_ == nullptr ? false : true;
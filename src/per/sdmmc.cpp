@@ -1,5 +1,12 @@
+#include <cstring>
 #include "per/sdmmc.h"
+#include "sys/irq_priority.h"
 #include "util/hal_map.h"
+#include "util/IrqProfiler.h"
+extern "C"
+{
+#include "util/bsp_sd_diskio.h"
+}
 //#include "fatfs.h"
 
 
@@ -8,6 +15,76 @@ using namespace daisy;
 /** Local HAL handle */
 SD_HandleTypeDef hsd1;
 
+namespace
+{
+/** Speed::AUTO was requested */
+bool auto_speed = false;
+/** Speed the bus runs at */
+SdmmcHandler::Speed current_speed = SdmmcHandler::Speed::STANDARD;
+
+/** Speeds tried by Speed::AUTO, fastest first */
+const SdmmcHandler::Speed kAutoSpeeds[] = {SdmmcHandler::Speed::VERY_FAST,
+                                           SdmmcHandler::Speed::FAST,
+                                           SdmmcHandler::Speed::STANDARD,
+                                           SdmmcHandler::Speed::MEDIUM_SLOW};
+
+/** Blocks read by each test, and number of times they're read */
+constexpr uint32_t kTestBlocks  = 4;
+constexpr uint32_t kTestRepeats = 4;
+constexpr uint32_t kTestTimeout = 100;
+
+/** Polling reads, so any memory works */
+uint32_t reference_blocks[kTestBlocks * BLOCKSIZE / 4];
+uint32_t test_blocks[kTestBlocks * BLOCKSIZE / 4];
+
+uint32_t GetClockDiv(SdmmcHandler::Speed speed)
+{
+    switch(speed)
+    {
+        case SdmmcHandler::Speed::SLOW: return 250;
+        case SdmmcHandler::Speed::MEDIUM_SLOW: return 8;
+        case SdmmcHandler::Speed::FAST: return 2;
+        case SdmmcHandler::Speed::VERY_FAST: return 1;
+        default: return 4; // STANDARD, and AUTO until the card is tested
+    }
+}
+
+/** Reprograms the clock of an initialized card */
+bool SetSpeed(SdmmcHandler::Speed speed)
+{
+    hsd1.Init.ClockDiv = GetClockDiv(speed);
+    return HAL_SD_ConfigWideBusOperation(&hsd1, hsd1.Init.BusWide) == HAL_OK;
+}
+
+/** Reads the test blocks, fails on any error, e.g. a CRC error */
+bool ReadTestBlocks(uint32_t* dest)
+{
+    if(HAL_SD_ReadBlocks(&hsd1, (uint8_t*)dest, 0, kTestBlocks, kTestTimeout)
+       != HAL_OK)
+        return false;
+    const uint32_t start = HAL_GetTick();
+    while(HAL_SD_GetCardState(&hsd1) != HAL_SD_CARD_TRANSFER)
+    {
+        if(HAL_GetTick() - start > kTestTimeout)
+            return false;
+    }
+    return HAL_SD_GetError(&hsd1) == HAL_SD_ERROR_NONE;
+}
+
+/** Tries the current speed, the data has to match the reference */
+bool TestSpeed()
+{
+    for(uint32_t i = 0; i < kTestRepeats; i++)
+    {
+        if(!ReadTestBlocks(test_blocks)
+           || std::memcmp(test_blocks, reference_blocks, sizeof(test_blocks))
+                  != 0)
+            return false;
+    }
+    return true;
+}
+} // namespace
+
 SdmmcHandler::Result SdmmcHandler::Init(const Config& cfg)
 {
     hsd1.Instance            = SDMMC1;
@@ -19,15 +96,58 @@ SdmmcHandler::Result SdmmcHandler::Init(const Config& cfg)
         = cfg.width == BusWidth::BITS_1 ? SDMMC_BUS_WIDE_1B : SDMMC_BUS_WIDE_4B;
     hsd1.Init.HardwareFlowControl = SDMMC_HARDWARE_FLOW_CONTROL_DISABLE;
 
-    switch(cfg.speed)
+    hsd1.Init.ClockDiv = GetClockDiv(cfg.speed);
+    auto_speed         = cfg.speed == Speed::AUTO;
+    current_speed      = auto_speed ? Speed::STANDARD : cfg.speed;
+    return Result::OK;
+}
+
+SdmmcHandler::Result SdmmcHandler::DeInit()
+{
+    return HAL_SD_DeInit(&hsd1) == HAL_OK ? Result::OK : Result::ERROR;
+}
+
+SdmmcHandler::Speed SdmmcHandler::GetSpeed() const
+{
+    return current_speed;
+}
+
+extern "C"
+{
+    /** Called by BSP_SD_Init() once the card is initialized */
+    uint8_t BSP_SD_SelectSpeed(void)
     {
-        case Speed::SLOW: hsd1.Init.ClockDiv = 250; break;
-        case Speed::MEDIUM_SLOW: hsd1.Init.ClockDiv = 8; break;
-        case Speed::STANDARD: hsd1.Init.ClockDiv = 4; break;
-        case Speed::FAST: hsd1.Init.ClockDiv = 2; break;
-        case Speed::VERY_FAST: hsd1.Init.ClockDiv = 1; break;
+        if(!auto_speed)
+            return MSD_OK;
+
+        // the reference is read at STANDARD speed, or slower if that fails
+        current_speed = SdmmcHandler::Speed::STANDARD;
+        if(!ReadTestBlocks(reference_blocks))
+        {
+            current_speed = SdmmcHandler::Speed::MEDIUM_SLOW;
+            if(!SetSpeed(current_speed) || !ReadTestBlocks(reference_blocks))
+                return MSD_ERROR;
+        }
+
+        // cards without high speed support are limited to 25MHz
+        HAL_SD_CardInfoTypeDef info;
+        HAL_SD_GetCardInfo(&hsd1, &info);
+        for(SdmmcHandler::Speed speed : kAutoSpeeds)
+        {
+            if(speed == current_speed)
+                break; // all faster speeds failed, keep the reference speed
+            if((speed == SdmmcHandler::Speed::FAST
+                || speed == SdmmcHandler::Speed::VERY_FAST)
+               && info.CardSpeed == CARD_NORMAL_SPEED)
+                continue;
+            if(SetSpeed(speed) && TestSpeed())
+            {
+                current_speed = speed;
+                return MSD_OK;
+            }
+        }
+        return SetSpeed(current_speed) ? MSD_OK : MSD_ERROR;
     }
-    return Result::OK;
 }
 
 
@@ -66,6 +186,9 @@ void HAL_SD_MspInit(SD_HandleTypeDef* sdHandle)
             case 2: gpioSpeed = GPIO_SPEED_FREQ_VERY_HIGH; break; // FAST
             case 1: gpioSpeed = GPIO_SPEED_FREQ_VERY_HIGH; break; // VERY_FAST
         }
+        // AUTO starts at the STANDARD divider, and may go up to VERY_FAST
+        if(auto_speed)
+            gpioSpeed = GPIO_SPEED_FREQ_VERY_HIGH;
 
         GPIO_InitStruct.Pin = GPIO_PIN_12 | GPIO_PIN_8;
         if(sdHandle->Init.BusWide == SDMMC_BUS_WIDE_4B)
@@ -84,7 +207,7 @@ void HAL_SD_MspInit(SD_HandleTypeDef* sdHandle)
         HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
 
         /* SDMMC1 interrupt Init */
-        HAL_NVIC_SetPriority(SDMMC1_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(SDMMC1_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
         HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
         /* USER CODE BEGIN SDMMC1_MspInit 1 */
 
@@ -126,5 +249,9 @@ void HAL_SD_MspDeInit(SD_HandleTypeDef* sdHandle)
 
 extern "C"
 {
-    void SDMMC1_IRQHandler() { HAL_SD_IRQHandler(&hsd1); }
+    void SDMMC1_IRQHandler()
+    {
+        DSY_IRQ_PROFILE_SCOPE(Source::SD_CARD);
+        HAL_SD_IRQHandler(&hsd1);
+    }
 }
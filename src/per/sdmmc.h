@@ -56,6 +56,7 @@ class SdmmcHandler
         STANDARD,    /**< 25MHz - DS (Default Speed for SDMMC) */
         FAST,        /**< 50MHz - HS (High Speed signaling) */
         VERY_FAST, /**< 100MHz - SDR50 Overclocked rate for maximum transfer rates */
+        AUTO, /**< Fastest rate that passes a read test, see GetSpeed() */
     };
 
     struct Config
@@ -83,6 +84,21 @@ class SdmmcHandler
      */
     Result Init(const Config& cfg);
 
+    /** Stops the SDMMC peripheral, so that it can be initialized again with
+     *  a different Config. The filesystem needs to be unmounted first, and
+     *  the disk driver linked again after Init(), so that it initializes
+     *  the card again (see FatFSInterface::DeInit()).
+     */
+    Result DeInit();
+
+    /** Returns the speed the bus runs at. With Speed::AUTO this is the one
+     *  chosen when the card was initialized (e.g. by f_mount): the card is
+     *  switched to high speed if it supports it, and the fastest speed,
+     *  at which a few blocks read back without CRC errors and identical to
+     *  a read at STANDARD speed, is kept.
+     */
+    Speed GetSpeed() const;
+
   private:
 };
 /** @} */
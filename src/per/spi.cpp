@@ -1,5 +1,9 @@
 #include "per/spi.h"
+#include "sys/dma_streams.h"
+#include "sys/irq_priority.h"
+#include "sys/system.h"
 #include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
 
 extern "C"
 {
@@ -66,6 +70,12 @@ class SpiHandle::Impl
                           SpiHandle::StartCallbackFunctionPtr start_callback,
                           SpiHandle::EndCallbackFunctionPtr   end_callback,
                           void*                               callback_context);
+    Result StartDmaCircular(uint8_t*                               rx_buff,
+                            uint8_t*                               tx_buff,
+                            size_t                                 size,
+                            SpiHandle::CircularCallbackFunctionPtr callback,
+                            void* callback_context);
+    Result StopDmaCircular();
 
 
     Result InitPins();
@@ -97,8 +107,15 @@ class SpiHandle::Impl
     static void QueueDmaTransfer(size_t spi_idx, const SpiDmaJob& job);
     static bool IsDmaTransferQueuedFor(size_t spi_idx);
 
+    /** Calls the circular callback for a finished half of the buffers.
+     *  \return false if the SPI doesn't run a circular transfer
+     */
+    static bool CircularHalfDone(SPI_HandleTypeDef* hspi, bool second_half);
+    static void CircularError(SPI_HandleTypeDef* hspi);
+
     Result SetDmaPeripheral();
-    Result InitDma();
+    Result InitDma(bool circular = false);
+    void   WaitForNssHigh();
 
     static constexpr uint8_t kNumSpiWithDma = 4;
     static volatile int8_t   dma_active_peripheral_;
@@ -110,6 +127,13 @@ class SpiHandle::Impl
     SPI_HandleTypeDef hspi_;
     DMA_HandleTypeDef hdma_spi_rx_;
     DMA_HandleTypeDef hdma_spi_tx_;
+
+    volatile bool                          circular_;
+    uint8_t*                               circular_rx_;
+    uint8_t*                               circular_tx_;
+    size_t                                 circular_size_;
+    SpiHandle::CircularCallbackFunctionPtr circular_callback_;
+    void*                                  circular_context_;
 };
 
 // ================================================================
@@ -316,8 +340,15 @@ SpiHandle::Result SpiHandle::Impl::SetDmaPeripheral()
     return SpiHandle::Result::OK;
 }
 
-SpiHandle::Result SpiHandle::Impl::InitDma()
+SpiHandle::Result SpiHandle::Impl::InitDma(bool circular)
 {
+    // the SPI peripherals take turns with the two streams
+    if(!DmaStreamAllocator::Claim(DmaStreamAllocator::Stream::DMA_2_STREAM_2,
+                                  "spi")
+       || !DmaStreamAllocator::Claim(
+           DmaStreamAllocator::Stream::DMA_2_STREAM_3, "spi"))
+        return SpiHandle::Result::ERR;
+
     hdma_spi_rx_.Instance                 = DMA2_Stream2;
     hdma_spi_rx_.Init.PeriphInc           = DMA_PINC_DISABLE;
     hdma_spi_rx_.Init.MemInc              = DMA_MINC_ENABLE;
@@ -345,6 +376,11 @@ SpiHandle::Result SpiHandle::Impl::InitDma()
 
     hdma_spi_rx_.Init.Direction = DMA_PERIPH_TO_MEMORY;
     hdma_spi_tx_.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    if(circular)
+    {
+        hdma_spi_rx_.Init.Mode = DMA_CIRCULAR;
+        hdma_spi_tx_.Init.Mode = DMA_CIRCULAR;
+    }
 
     if(HAL_DMA_Init(&hdma_spi_rx_) != HAL_OK)
     {
@@ -676,6 +712,114 @@ SpiHandle::Result SpiHandle::Impl::StartDmaRxTx(
 }
 
 
+void SpiHandle::Impl::WaitForNssHigh()
+{
+    if(config_.mode != Config::Mode::SLAVE
+       || config_.nss != Config::NSS::HARD_INPUT
+       || config_.pin_config.nss.port == DSY_GPIOX)
+        return;
+    // The pin is in alternate function mode, its input register still
+    // follows the level
+    GPIO_TypeDef*  port  = dsy_hal_map_get_port(&config_.pin_config.nss);
+    const uint16_t pin   = dsy_hal_map_get_pin(&config_.pin_config.nss);
+    const uint32_t start = System::GetUs();
+    while((port->IDR & pin) == 0 && System::GetUs() - start < 1000) {}
+}
+
+SpiHandle::Result SpiHandle::Impl::StartDmaCircular(
+    uint8_t*                               rx_buff,
+    uint8_t*                               tx_buff,
+    size_t                                 size,
+    SpiHandle::CircularCallbackFunctionPtr callback,
+    void*                                  callback_context)
+{
+    if((rx_buff == nullptr && tx_buff == nullptr) || size < 2 || size % 2 != 0
+       || size > 0xfffe)
+        return SpiHandle::Result::ERR;
+
+    // claim the DMA streams, the transfer never finishes by itself
+    {
+        ScopedIrqBlocker block;
+        if(IsDmaBusy())
+            return SpiHandle::Result::ERR;
+        dma_active_peripheral_ = int(config_.periph);
+    }
+
+    while(HAL_SPI_GetState(&hspi_) != HAL_SPI_STATE_READY) {};
+    WaitForNssHigh();
+
+    if(InitDma(true) != SpiHandle::Result::OK)
+    {
+        dma_active_peripheral_ = -1;
+        return SpiHandle::Result::ERR;
+    }
+
+    ScopedIrqBlocker block;
+
+    circular_rx_       = rx_buff;
+    circular_tx_       = tx_buff;
+    circular_size_     = size;
+    circular_callback_ = callback;
+    circular_context_  = callback_context;
+    circular_          = true;
+
+    HAL_StatusTypeDef status;
+    if(rx_buff == nullptr)
+        status = HAL_SPI_Transmit_DMA(&hspi_, tx_buff, size);
+    else if(tx_buff == nullptr)
+        status = HAL_SPI_Receive_DMA(&hspi_, rx_buff, size);
+    else
+        status = HAL_SPI_TransmitReceive_DMA(&hspi_, tx_buff, rx_buff, size);
+    if(status != HAL_OK)
+    {
+        circular_              = false;
+        dma_active_peripheral_ = -1;
+        return SpiHandle::Result::ERR;
+    }
+    return SpiHandle::Result::OK;
+}
+
+SpiHandle::Result SpiHandle::Impl::StopDmaCircular()
+{
+    if(!circular_)
+        return SpiHandle::Result::OK;
+    const bool aborted = HAL_SPI_Abort(&hspi_) == HAL_OK;
+    circular_          = false;
+    // releases the streams, and starts what was queued meanwhile
+    DmaTransferFinished(&hspi_, SpiHandle::Result::OK);
+    return aborted ? SpiHandle::Result::OK : SpiHandle::Result::ERR;
+}
+
+bool SpiHandle::Impl::CircularHalfDone(SPI_HandleTypeDef* hspi,
+                                       bool               second_half)
+{
+    SpiHandle::Impl* handle = MapInstanceToHandle(hspi->Instance);
+    if(handle == nullptr || !handle->circular_)
+        return false;
+    if(handle->circular_callback_ != nullptr)
+    {
+        const size_t half   = handle->circular_size_ / 2;
+        const size_t offset = second_half ? half : 0;
+        uint8_t*     rx     = handle->circular_rx_;
+        uint8_t*     tx     = handle->circular_tx_;
+        handle->circular_callback_(rx != nullptr ? rx + offset : nullptr,
+                                   tx != nullptr ? tx + offset : nullptr,
+                                   half,
+                                   handle->circular_context_);
+    }
+    return true;
+}
+
+void SpiHandle::Impl::CircularError(SPI_HandleTypeDef* hspi)
+{
+    // the HAL has stopped the DMA, report it with an empty half
+    SpiHandle::Impl* handle = MapInstanceToHandle(hspi->Instance);
+    handle->circular_       = false;
+    if(handle->circular_callback_ != nullptr)
+        handle->circular_callback_(
+            nullptr, nullptr, 0, handle->circular_context_);
+}
+
 SpiHandle::Result
 SpiHandle::Impl::BlockingTransmit(uint8_t* buff, size_t size, uint32_t timeout)
 {
@@ -996,35 +1140,35 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* spiHandle)
         case SpiHandle::Config::Peripheral::SPI_1:
         {
             __HAL_RCC_SPI1_CLK_ENABLE();
-            HAL_NVIC_SetPriority(SPI1_IRQn, 0, 0);
+            HAL_NVIC_SetPriority(SPI1_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
             HAL_NVIC_EnableIRQ(SPI1_IRQn);
         }
         break;
         case SpiHandle::Config::Peripheral::SPI_2:
         {
             __HAL_RCC_SPI2_CLK_ENABLE();
-            HAL_NVIC_SetPriority(SPI2_IRQn, 0, 0);
+            HAL_NVIC_SetPriority(SPI2_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
             HAL_NVIC_EnableIRQ(SPI2_IRQn);
         }
         break;
         case SpiHandle::Config::Peripheral::SPI_3:
         {
             __HAL_RCC_SPI3_CLK_ENABLE();
-            HAL_NVIC_SetPriority(SPI3_IRQn, 0, 0);
+            HAL_NVIC_SetPriority(SPI3_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
             HAL_NVIC_EnableIRQ(SPI3_IRQn);
         }
         break;
         case SpiHandle::Config::Peripheral::SPI_4:
         {
             __HAL_RCC_SPI4_CLK_ENABLE();
-            HAL_NVIC_SetPriority(SPI4_IRQn, 0, 0);
+            HAL_NVIC_SetPriority(SPI4_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
             HAL_NVIC_EnableIRQ(SPI4_IRQn);
         }
         break;
         case SpiHandle::Config::Peripheral::SPI_5:
         {
             __HAL_RCC_SPI5_CLK_ENABLE();
-            HAL_NVIC_SetPriority(SPI5_IRQn, 0, 0);
+            HAL_NVIC_SetPriority(SPI5_IRQn, DSY_IRQ_PRIORITY_PERIPHERAL, 0);
             HAL_NVIC_EnableIRQ(SPI5_IRQn);
         }
         break;
@@ -1080,31 +1224,37 @@ extern "C" void dsy_spi_global_init()
 
 extern "C" void SPI1_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     HAL_SPI_IRQHandler(&spi_handles[0].hspi_);
 }
 
 extern "C" void SPI2_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     HAL_SPI_IRQHandler(&spi_handles[1].hspi_);
 }
 
 extern "C" void SPI3_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     HAL_SPI_IRQHandler(&spi_handles[2].hspi_);
 }
 
 extern "C" void SPI4_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     HAL_SPI_IRQHandler(&spi_handles[3].hspi_);
 }
 
 extern "C" void SPI5_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     HAL_SPI_IRQHandler(&spi_handles[4].hspi_);
 }
 
 void HalSpiDmaRxStreamCallback(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     ScopedIrqBlocker block;
     if(SpiHandle::Impl::dma_active_peripheral_ >= 0)
         HAL_DMA_IRQHandler(
@@ -1116,6 +1266,7 @@ extern "C" void DMA2_Stream2_IRQHandler(void)
 }
 void HalSpiDmaTxStreamCallback(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::SPIS);
     ScopedIrqBlocker block;
     if(SpiHandle::Impl::dma_active_peripheral_ >= 0)
         HAL_DMA_IRQHandler(
@@ -1128,21 +1279,41 @@ extern "C" void DMA2_Stream3_IRQHandler(void)
 
 extern "C" void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi)
 {
-    SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
+    if(!SpiHandle::Impl::CircularHalfDone(hspi, true))
+        SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
 }
 
 extern "C" void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef* hspi)
 {
-    SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
+    if(!SpiHandle::Impl::CircularHalfDone(hspi, true))
+        SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
 }
 
 extern "C" void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi)
 {
-    SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
+    if(!SpiHandle::Impl::CircularHalfDone(hspi, true))
+        SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::OK);
+}
+
+extern "C" void HAL_SPI_TxHalfCpltCallback(SPI_HandleTypeDef* hspi)
+{
+    SpiHandle::Impl::CircularHalfDone(hspi, false);
+}
+
+extern "C" void HAL_SPI_RxHalfCpltCallback(SPI_HandleTypeDef* hspi)
+{
+    SpiHandle::Impl::CircularHalfDone(hspi, false);
+}
+
+extern "C" void HAL_SPI_TxRxHalfCpltCallback(SPI_HandleTypeDef* hspi)
+{
+    SpiHandle::Impl::CircularHalfDone(hspi, false);
 }
 
 extern "C" void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi)
 {
+    if(MapInstanceToHandle(hspi->Instance)->circular_)
+        SpiHandle::Impl::CircularError(hspi);
     SpiHandle::Impl::DmaTransferFinished(hspi, SpiHandle::Result::ERR);
 }
 
@@ -1213,6 +1384,22 @@ SpiHandle::Result SpiHandle::DmaTransmitAndReceive(
         rx_buff, tx_buff, size, start_callback, end_callback, callback_context);
 }
 
+SpiHandle::Result
+SpiHandle::StartDmaCircular(uint8_t*                    rx_buff,
+                            uint8_t*                    tx_buff,
+                            size_t                      size,
+                            CircularCallbackFunctionPtr callback,
+                            void*                       callback_context)
+{
+    return pimpl_->StartDmaCircular(
+        rx_buff, tx_buff, size, callback, callback_context);
+}
+
+SpiHandle::Result SpiHandle::StopDmaCircular()
+{
+    return pimpl_->StopDmaCircular();
+}
+
 SpiHandle::Result SpiHandle::BlockingTransmitAndReceive(uint8_t* tx_buff,
                                                         uint8_t* rx_buff,
                                                         size_t   size,
@@ -212,6 +212,49 @@ class SpiHandle
                           SpiHandle::EndCallbackFunctionPtr   end_callback,
                           void*                               callback_context);
 
+    /** A callback for the circular DMA, called once per half of the buffers.
+     *  \param rx the half of the receive buffer that was just filled
+     *  \param tx the half of the transmit buffer that was just sent, fill it
+     *            with the data for the next round
+     *  \param size bytes in each half
+     *  \param context the pointer given to StartDmaCircular()
+     */
+    typedef void (*CircularCallbackFunctionPtr)(uint8_t* rx,
+                                                uint8_t* tx,
+                                                size_t   size,
+                                                void*    context);
+
+    /** Starts a continuous DMA transfer that wraps around the buffers until
+     *  StopDmaCircular(). This is mainly meant for slave mode, e.g. to
+     *  stream audio between two modules: the master clocks out one frame
+     *  per transfer, and the slave keeps both buffers running.
+     *
+     *  In slave mode with NSS::HARD_INPUT the start waits (up to 1ms) for
+     *  NSS to be high, so that the first byte received is the first byte of
+     *  a frame. When the master leaves NSS high between frames, a link that
+     *  lost sync is realigned with StopDmaCircular() and StartDmaCircular().
+     *
+     *  The two SPI DMA streams are shared by all SpiHandles, other DMA
+     *  transfers are queued until the circular transfer is stopped.
+     *  The buffers must be in DMA accessible, non cached memory, e.g.
+     *  DMA_BUFFER_MEM_SECTION. On an error, e.g. an overrun, the transfer
+     *  stops, and the callback is called once with nullptr and size 0.
+     *  \param rx_buff  the receive buffer, or nullptr to only transmit
+     *  \param tx_buff  the transmit buffer, or nullptr to only receive
+     *  \param size     size of each buffer, an even number of bytes
+     *  \param callback called from the DMA interrupt at each half
+     *  \param callback_context passed back in the callback
+     *  \return ERR if another DMA transfer is running
+     */
+    Result StartDmaCircular(uint8_t*                    rx_buff,
+                            uint8_t*                    tx_buff,
+                            size_t                      size,
+                            CircularCallbackFunctionPtr callback,
+                            void*                       callback_context);
+
+    /** Stops the circular DMA transfer, and starts any queued transfer */
+    Result StopDmaCircular();
+
     /** \return the result of HAL_SPI_GetError() to the user. */
     int CheckError();
 
@@ -1,4 +1,5 @@
 #include "spiMultislave.h"
+#include "util/scopedirqblocker.h"
 
 namespace daisy
 {
@@ -19,6 +20,8 @@ SpiHandle::Result MultiSlaveSpiHandle::Init(const Config& config)
     }
 
     current_dma_transfer_.Invalidate();
+    queue_read_  = 0;
+    queue_count_ = 0;
 
     SpiHandle::Config spi_config;
     spi_config.baud_prescaler  = config.baud_prescaler;
@@ -157,6 +160,69 @@ SpiHandle::Result MultiSlaveSpiHandle::DmaTransmitAndReceive(
         tx_buff, rx_buff, size, &DmaStartCallback, &DmaEndCallback, this);
 }
 
+SpiHandle::Result
+MultiSlaveSpiHandle::QueueTransaction(const Transaction& transaction)
+{
+    if(transaction.device_index >= config_.num_devices
+       || (transaction.tx_buff == nullptr && transaction.rx_buff == nullptr))
+        return SpiHandle::Result::ERR;
+
+    Transaction next;
+    {
+        ScopedIrqBlocker block;
+        if(queue_count_ >= DSY_SPI_MULTISLAVE_QUEUE_SIZE)
+            return SpiHandle::Result::ERR;
+        const size_t write
+            = (queue_read_ + queue_count_) % DSY_SPI_MULTISLAVE_QUEUE_SIZE;
+        queue_[write] = transaction;
+        queue_count_  = queue_count_ + 1;
+        if(!ClaimQueuedTransaction(next))
+            return SpiHandle::Result::OK;
+    }
+    // the bus was idle, later ones are started from DmaEndCallback()
+    StartTransaction(next);
+    return SpiHandle::Result::OK;
+}
+
+bool MultiSlaveSpiHandle::ClaimQueuedTransaction(Transaction& transaction)
+{
+    if(current_dma_transfer_.IsValid() || queue_count_ == 0)
+        return false;
+    transaction  = queue_[queue_read_];
+    queue_read_  = (queue_read_ + 1) % DSY_SPI_MULTISLAVE_QUEUE_SIZE;
+    queue_count_ = queue_count_ - 1;
+
+    current_dma_transfer_.device_index     = transaction.device_index;
+    current_dma_transfer_.start_callback   = nullptr;
+    current_dma_transfer_.end_callback     = transaction.end_callback;
+    current_dma_transfer_.callback_context = transaction.callback_context;
+    return true;
+}
+
+void MultiSlaveSpiHandle::StartTransaction(const Transaction& transaction)
+{
+    // errors end up in DmaEndCallback() too, which moves on to the next one
+    if(transaction.tx_buff != nullptr && transaction.rx_buff != nullptr)
+        spiHandle_.DmaTransmitAndReceive(transaction.tx_buff,
+                                         transaction.rx_buff,
+                                         transaction.size,
+                                         &DmaStartCallback,
+                                         &DmaEndCallback,
+                                         this);
+    else if(transaction.tx_buff != nullptr)
+        spiHandle_.DmaTransmit(transaction.tx_buff,
+                               transaction.size,
+                               &DmaStartCallback,
+                               &DmaEndCallback,
+                               this);
+    else
+        spiHandle_.DmaReceive(transaction.rx_buff,
+                              transaction.size,
+                              &DmaStartCallback,
+                              &DmaEndCallback,
+                              this);
+}
+
 int MultiSlaveSpiHandle::CheckError()
 {
     return spiHandle_.CheckError();
@@ -197,6 +263,16 @@ void MultiSlaveSpiHandle::DmaEndCallback(void*             context,
             handle.current_dma_transfer_.end_callback(
                 handle.current_dma_transfer_.callback_context, result);
     }
+
+    // the callback may have started a transfer, then the queue waits
+    Transaction next;
+    bool        claimed;
+    {
+        ScopedIrqBlocker block;
+        claimed = handle.ClaimQueuedTransaction(next);
+    }
+    if(claimed)
+        handle.StartTransaction(next);
 }
 
 } // namespace daisy
\ No newline at end of file
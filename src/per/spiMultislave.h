@@ -6,6 +6,11 @@
 #include "spi.h"
 #include "gpio.h"
 
+/** Number of transactions the queue of a MultiSlaveSpiHandle holds */
+#ifndef DSY_SPI_MULTISLAVE_QUEUE_SIZE
+#define DSY_SPI_MULTISLAVE_QUEUE_SIZE 16
+#endif
+
 namespace daisy
 {
 /** @addtogroup serial
@@ -40,6 +45,20 @@ class MultiSlaveSpiHandle
         size_t                           num_devices;
     };
 
+    /** A DMA transfer with one device, for QueueTransaction() */
+    struct Transaction
+    {
+        size_t   device_index; /**< the index of the device */
+        uint8_t* tx_buff;      /**< the transmit buffer, or NULL to receive */
+        uint8_t* rx_buff;      /**< the receive buffer, or NULL to transmit */
+        size_t   size;         /**< the length of the transaction */
+
+        /** A callback to execute when the transaction finishes, or NULL.
+         *  The callback is called from an interrupt, so keep it fast. */
+        SpiHandle::EndCallbackFunctionPtr end_callback;
+        void*                             callback_context;
+    };
+
     MultiSlaveSpiHandle() {}
     MultiSlaveSpiHandle(const MultiSlaveSpiHandle& other) = delete;
 
@@ -138,6 +157,33 @@ class MultiSlaveSpiHandle
                           SpiHandle::EndCallbackFunctionPtr   end_callback,
                           void*                               callback_context);
 
+    /** Queues a DMA transaction and returns right away.
+     *
+     *  The transactions run in the order they were queued, each one is
+     *  started from the completion interrupt of the one before, which
+     *  raises the CS pin of its device and lowers the next one. A scan of
+     *  all devices of the bus can be queued at once, and runs back-to-back
+     *  without the main loop.
+     *
+     *  Don't mix with the other transfers of this class from a different
+     *  context, they wait for the running DMA transfer but not for the
+     *  queue.
+     * \param transaction the transfer, the buffers must stay valid until
+     *                    it's finished
+     * \return ERR if the device index or the buffers are invalid, or the
+     *         queue is full
+     */
+    SpiHandle::Result QueueTransaction(const Transaction& transaction);
+
+    /** \return the number of transactions that haven't started yet */
+    size_t GetNumQueued() const { return queue_count_; }
+
+    /** \return true while a DMA transfer runs or transactions are queued */
+    bool IsBusy() const
+    {
+        return current_dma_transfer_.IsValid() || queue_count_ > 0;
+    }
+
     /** \return the result of HAL_SPI_GetError() to the user. */
     int CheckError();
 
@@ -152,6 +198,11 @@ class MultiSlaveSpiHandle
     static void DmaStartCallback(void* context);
     static void DmaEndCallback(void* context, SpiHandle::Result result);
 
+    /** Takes the next transaction from the queue if no transfer runs,
+     *  with interrupts disabled. */
+    bool ClaimQueuedTransaction(Transaction& transaction);
+    void StartTransaction(const Transaction& transaction);
+
     Config    config_;
     SpiHandle spiHandle_;
     dsy_gpio  nss_pins[max_num_devices_];
@@ -166,6 +217,10 @@ class MultiSlaveSpiHandle
         void Invalidate() { device_index = -1; }
         bool IsValid() const { return device_index >= 0; }
     } current_dma_transfer_;
+
+    Transaction     queue_[DSY_SPI_MULTISLAVE_QUEUE_SIZE];
+    size_t          queue_read_;
+    volatile size_t queue_count_;
 };
 
 /** @} */
@@ -1,6 +1,8 @@
 #include "per/tim.h"
 #include "util/hal_map.h"
+#include "sys/irq_priority.h"
 #include "sys/system.h"
+#include "util/IrqProfiler.h"
 
 
 // To save from digging in reference manual here are some notes:
@@ -263,7 +265,7 @@ extern "C"
             __HAL_RCC_TIM2_CLK_ENABLE();
             if(cfg.enable_irq)
             {
-                HAL_NVIC_SetPriority(TIM2_IRQn, 0x0f, 0);
+                HAL_NVIC_SetPriority(TIM2_IRQn, DSY_IRQ_PRIORITY_TIMER, 0);
                 HAL_NVIC_EnableIRQ(TIM2_IRQn);
             }
         }
@@ -272,7 +274,7 @@ extern "C"
             __HAL_RCC_TIM3_CLK_ENABLE();
             if(cfg.enable_irq)
             {
-                HAL_NVIC_SetPriority(TIM3_IRQn, 0x0f, 0);
+                HAL_NVIC_SetPriority(TIM3_IRQn, DSY_IRQ_PRIORITY_TIMER, 0);
                 HAL_NVIC_EnableIRQ(TIM3_IRQn);
             }
         }
@@ -281,7 +283,7 @@ extern "C"
             __HAL_RCC_TIM4_CLK_ENABLE();
             if(cfg.enable_irq)
             {
-                HAL_NVIC_SetPriority(TIM4_IRQn, 0x0f, 0);
+                HAL_NVIC_SetPriority(TIM4_IRQn, DSY_IRQ_PRIORITY_TIMER, 0);
                 HAL_NVIC_EnableIRQ(TIM4_IRQn);
             }
         }
@@ -291,7 +293,7 @@ extern "C"
             /** @todo make this conditional based on user config */
             if(cfg.enable_irq)
             {
-                HAL_NVIC_SetPriority(TIM5_IRQn, 0x0f, 0);
+                HAL_NVIC_SetPriority(TIM5_IRQn, DSY_IRQ_PRIORITY_TIMER, 0);
                 HAL_NVIC_EnableIRQ(TIM5_IRQn);
             }
         }
@@ -349,21 +351,25 @@ extern "C" void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef* htim)
 
 extern "C" void TIM2_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
     HAL_TIM_IRQHandler(&tim_handles[(int)TimerHandle::Config::Peripheral::TIM_2]
                             .tim_hal_handle_);
 }
 extern "C" void TIM3_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
     HAL_TIM_IRQHandler(&tim_handles[(int)TimerHandle::Config::Peripheral::TIM_3]
                             .tim_hal_handle_);
 }
 extern "C" void TIM4_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
     HAL_TIM_IRQHandler(&tim_handles[(int)TimerHandle::Config::Peripheral::TIM_4]
                             .tim_hal_handle_);
 }
 extern "C" void TIM5_IRQHandler(void)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
     HAL_TIM_IRQHandler(&tim_handles[(int)TimerHandle::Config::Peripheral::TIM_5]
                             .tim_hal_handle_);
 }
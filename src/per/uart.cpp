@@ -1,9 +1,13 @@
+#include <cstring>
 #include <stm32h7xx_hal.h>
 #include "stm32h7xx_ll_dma.h"
 #include "per/uart.h"
 #include "sys/dma.h"
+#include "sys/dma_streams.h"
+#include "sys/irq_priority.h"
 #include "util/ringbuffer.h"
 #include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
 
 extern "C"
 {
@@ -46,6 +50,35 @@ GetDmaStream(const UartHandler::Config::DmaStream& stream)
     return nullptr;
 }
 
+/** Claims a stream, which all UARTs share, one transfer runs on each at a
+ *  time */
+static bool ClaimDmaStream(const UartHandler::Config::DmaStream& stream)
+{
+    DmaStreamAllocator::Stream s = DmaStreamAllocator::Stream::NONE;
+    switch(stream)
+    {
+        case UartHandler::Config::DmaStream::DMA_1_STREAM_5:
+            s = DmaStreamAllocator::Stream::DMA_1_STREAM_5;
+            break;
+        case UartHandler::Config::DmaStream::DMA_1_STREAM_7:
+            s = DmaStreamAllocator::Stream::DMA_1_STREAM_7;
+            break;
+        case UartHandler::Config::DmaStream::DMA_2_STREAM_4:
+            s = DmaStreamAllocator::Stream::DMA_2_STREAM_4;
+            break;
+        case UartHandler::Config::DmaStream::DMA_2_STREAM_5:
+            s = DmaStreamAllocator::Stream::DMA_2_STREAM_5;
+            break;
+        case UartHandler::Config::DmaStream::DMA_2_STREAM_6:
+            s = DmaStreamAllocator::Stream::DMA_2_STREAM_6;
+            break;
+        case UartHandler::Config::DmaStream::DMA_2_STREAM_7:
+            s = DmaStreamAllocator::Stream::DMA_2_STREAM_7;
+            break;
+    }
+    return DmaStreamAllocator::Claim(s, "uart");
+}
+
 static DMA_TypeDef*
 GetDmaFromDmaStream(const UartHandler::Config::DmaStream& stream)
 {
@@ -108,6 +141,16 @@ class UartHandler::Impl
                       EndCallbackFunctionPtr   end_callback,
                       void*                    callback_context);
 
+    Result SetTxQueue(uint8_t* buff, size_t size);
+    Result QueueTx(const uint8_t* buff, size_t size);
+
+    /** Claims the next contiguous bytes of the tx queue for the DMA, with
+     *  interrupts disabled. Returns 0 if there's nothing to send, or a
+     *  transfer is running. */
+    size_t ClaimQueuedTx();
+    void   SendQueuedTx(size_t size);
+    static void QueuedTxEndCallback(void* context, Result result);
+
     /** Starts the DMA Reception in "Listen" mode.
      *  In this mode the DMA is configured for circular
      *  behavior, and the IDLE interrupt is enabled.
@@ -129,6 +172,10 @@ class UartHandler::Impl
      */
     Result DmaListenStop();
 
+    /** Starts the circular reception again after an error aborted it,
+     *  in the listen or ring mode it ran in */
+    void RestartListen();
+
     /** Returns the state of the listen_mode var.
      *  set when DmaListen starts, and cleared
      *  when DmaListen stops. Used to detect if the
@@ -136,6 +183,16 @@ class UartHandler::Impl
      */
     bool IsListening() const;
 
+    Result DmaRingStart(uint8_t*                  buff,
+                        size_t                    size,
+                        RxRingCallbackFunctionPtr notify,
+                        void*                     callback_context);
+    size_t GetRxSpan(RxSpan& span);
+    void   ReleaseRx(size_t size);
+
+    /** Moves the write position of the ring to the DMA position */
+    size_t UpdateRxRing();
+
 
     Result StartDmaTx(uint8_t*                 buff,
                       size_t                   size,
@@ -150,11 +207,20 @@ class UartHandler::Impl
                       void*                    callback_context);
 
     static void GlobalInit();
-    static bool IsDmaBusy();
-    static void DmaTransferFinished(UART_HandleTypeDef* huart, Result result);
 
-    static void QueueDmaTransfer(size_t uart_idx, const UartDmaJob& job);
-    static bool IsDmaTransferQueuedFor(size_t uart_idx);
+    /** Returns true if a transfer of any UART runs on the stream this UART
+     *  uses for the direction */
+    bool        IsDmaBusy(DmaDirection direction) const;
+    static bool IsDmaStreamBusy(Config::DmaStream stream);
+    static void DmaTransferFinished(UART_HandleTypeDef* huart,
+                                    DmaDirection        direction,
+                                    Result              result);
+
+    /** Starts the job if its stream is free, or queues it until a transfer
+     *  on the stream finishes. */
+    Result      ScheduleDmaTransfer(const UartDmaJob& job);
+    Result      StartDmaJob(const UartDmaJob& job);
+    static void StartQueuedDmaTransfers();
 
     // static void DmaReceiveFifoEndCallback(void* context, Result res);
 
@@ -168,11 +234,16 @@ class UartHandler::Impl
 
     int CheckError();
 
-    static constexpr uint8_t      kNumUartWithDma = 9;
-    static volatile int8_t        dma_active_peripheral_;
-    static UartDmaJob             queued_dma_transfers_[kNumUartWithDma];
-    static EndCallbackFunctionPtr next_end_callback_;
-    static void*                  next_callback_context_;
+    static constexpr uint8_t kNumUartWithDma   = 9;
+    static constexpr uint8_t kNumDmaDirections = 2;
+    static UartDmaJob
+        queued_dma_transfers_[kNumUartWithDma][kNumDmaDirections];
+
+    /** The transfer of each DmaDirection, so that TX can run while RX is
+     *  listening. Indexed by int(DmaDirection). */
+    volatile bool          dma_busy_[kNumDmaDirections];
+    EndCallbackFunctionPtr dma_end_callback_[kNumDmaDirections];
+    void*                  dma_callback_context_[kNumDmaDirections];
 
     /** Not static -- any UART can use this
      *  until we had dynamic DMA stream handling
@@ -185,6 +256,23 @@ class UartHandler::Impl
     size_t                        circular_rx_last_pos_;
     bool                          listener_mode_;
 
+    /** DmaRingStart() state, the bytes not released from read_pos */
+    bool                      ring_mode_;
+    RxRingCallbackFunctionPtr ring_notify_;
+    size_t                    ring_read_pos_;
+    size_t                    ring_count_;
+    uint32_t                  ring_overruns_;
+
+    /** QueueTx() state, count includes the bytes the DMA is sending, ends
+     *  counts the QueuedTxEndCallback() calls */
+    uint8_t*          tx_queue_buff_;
+    size_t            tx_queue_size_;
+    size_t            tx_queue_read_;
+    volatile size_t   tx_queue_count_;
+    size_t            tx_queue_sending_;
+    uint32_t          tx_queue_overflows_;
+    volatile uint32_t tx_queue_ends_;
+
     Config             config_;
     UART_HandleTypeDef huart_;
     DMA_HandleTypeDef  hdma_rx_;
@@ -224,9 +312,9 @@ UartHandler::Impl* MapInstanceToHandle(USART_TypeDef* instance)
 void UartHandler::Impl::GlobalInit()
 {
     // init the scheduler queue
-    dma_active_peripheral_ = -1;
     for(int per = 0; per < kNumUartWithDma; per++)
-        queued_dma_transfers_[per] = UartHandler::Impl::UartDmaJob();
+        for(int dir = 0; dir < kNumDmaDirections; dir++)
+            queued_dma_transfers_[per][dir] = UartHandler::Impl::UartDmaJob();
 }
 
 UartHandler::Result UartHandler::Impl::Init(const UartHandler::Config& config)
@@ -318,6 +406,22 @@ UartHandler::Result UartHandler::Impl::Init(const UartHandler::Config& config)
 
     /** New listener mode to replace old "Fifo" stuff */
     listener_mode_ = false;
+    ring_mode_     = false;
+
+    for(int dir = 0; dir < kNumDmaDirections; dir++)
+    {
+        dma_busy_[dir]             = false;
+        dma_end_callback_[dir]     = nullptr;
+        dma_callback_context_[dir] = nullptr;
+    }
+
+    tx_queue_buff_      = nullptr;
+    tx_queue_size_      = 0;
+    tx_queue_read_      = 0;
+    tx_queue_count_     = 0;
+    tx_queue_sending_   = 0;
+    tx_queue_overflows_ = 0;
+    tx_queue_ends_      = 0;
 
     return Result::OK;
 }
@@ -368,29 +472,24 @@ UartHandler::Result UartHandler::Impl::SetDmaPeripheral()
 
 UartHandler::Result UartHandler::Impl::InitDma(bool rx, bool tx)
 {
-    hdma_rx_.Instance                 = GetDmaStream(config_.rx_dma_stream);
-    hdma_rx_.Init.PeriphInc           = DMA_PINC_DISABLE;
-    hdma_rx_.Init.MemInc              = DMA_MINC_ENABLE;
-    hdma_rx_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-    hdma_rx_.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
-    hdma_rx_.Init.Mode                = DMA_NORMAL;
-    hdma_rx_.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
-    hdma_rx_.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
-    hdma_rx_.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    if((rx && !ClaimDmaStream(config_.rx_dma_stream))
+       || (tx && !ClaimDmaStream(config_.tx_dma_stream)))
+        return UartHandler::Result::ERR;
 
-    hdma_tx_.Instance                 = GetDmaStream(config_.tx_dma_stream);
-    hdma_tx_.Init.PeriphInc           = DMA_PINC_DISABLE;
-    hdma_tx_.Init.MemInc              = DMA_MINC_ENABLE;
-    hdma_tx_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-    hdma_tx_.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
-    hdma_tx_.Init.Mode                = DMA_NORMAL;
-    hdma_tx_.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
-    hdma_tx_.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
-    hdma_tx_.Init.Direction           = DMA_MEMORY_TO_PERIPH;
     SetDmaPeripheral();
 
+    // the other direction may be running, e.g. a circular reception
     if(rx)
     {
+        hdma_rx_.Instance                 = GetDmaStream(config_.rx_dma_stream);
+        hdma_rx_.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_rx_.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_rx_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_rx_.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_rx_.Init.Mode                = DMA_NORMAL;
+        hdma_rx_.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
+        hdma_rx_.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+        hdma_rx_.Init.Direction           = DMA_PERIPH_TO_MEMORY;
         if(HAL_DMA_Init(&hdma_rx_) != HAL_OK)
         {
             Error_Handler();
@@ -401,6 +500,15 @@ UartHandler::Result UartHandler::Impl::InitDma(bool rx, bool tx)
 
     if(tx)
     {
+        hdma_tx_.Instance                 = GetDmaStream(config_.tx_dma_stream);
+        hdma_tx_.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_tx_.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_tx_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_tx_.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_tx_.Init.Mode                = DMA_NORMAL;
+        hdma_tx_.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
+        hdma_tx_.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+        hdma_tx_.Init.Direction           = DMA_MEMORY_TO_PERIPH;
         if(HAL_DMA_Init(&hdma_tx_) != HAL_OK)
         {
             Error_Handler();
@@ -413,85 +521,136 @@ UartHandler::Result UartHandler::Impl::InitDma(bool rx, bool tx)
 }
 
 void UartHandler::Impl::DmaTransferFinished(UART_HandleTypeDef* huart,
+                                            DmaDirection        direction,
                                             UartHandler::Result result)
 {
     ScopedIrqBlocker block;
 
-    // on an error, reinit the peripheral to clear any flags
+    UartHandler::Impl* handle = MapInstanceToHandle(huart->Instance);
+    const int          dir    = int(direction);
+    const int          other  = dir == int(DmaDirection::TX)
+                                    ? int(DmaDirection::RX)
+                                    : int(DmaDirection::TX);
+
+    // on an error, reinit the peripheral to clear any flags, unless that
+    // would stop the transfer of the other direction
     if(result != UartHandler::Result::OK)
-        HAL_UART_Init(huart);
+    {
+        if(!handle->dma_busy_[other])
+            HAL_UART_Init(huart);
+        else
+            __HAL_UART_CLEAR_FLAG(huart,
+                                  UART_CLEAR_PEF | UART_CLEAR_FEF
+                                      | UART_CLEAR_NEF | UART_CLEAR_OREF);
+    }
 
-    dma_active_peripheral_ = -1;
+    handle->dma_busy_[dir] = false;
 
-    if(next_end_callback_ != nullptr)
+    if(handle->dma_end_callback_[dir] != nullptr)
     {
         // the callback may setup another transmission, hence we shouldn't reset this to
         // nullptr after the callback - it might overwrite the new transmission.
-        auto callback      = next_end_callback_;
-        next_end_callback_ = nullptr;
+        auto callback                  = handle->dma_end_callback_[dir];
+        handle->dma_end_callback_[dir] = nullptr;
         // make the callback
-        callback(next_callback_context_, result);
+        callback(handle->dma_callback_context_[dir], result);
     }
 
-    // the callback could have started a new transmission right away...
-    if(IsDmaBusy())
-        return;
+    // the callback could have started a new transmission right away,
+    // otherwise another UART peripheral may wait for the stream.
+    StartQueuedDmaTransfers();
+}
 
-    // dma is still idle. Check if another UART peripheral waits for a job.
+void UartHandler::Impl::StartQueuedDmaTransfers()
+{
+    ScopedIrqBlocker block;
     for(int per = 0; per < kNumUartWithDma; per++)
-        if(IsDmaTransferQueuedFor(per))
+        for(int dir = 0; dir < kNumDmaDirections; dir++)
         {
-            UartHandler::Result result;
-            if(queued_dma_transfers_[per].direction
-               == UartHandler::DmaDirection::TX)
-            {
-                result = uart_handles[per].StartDmaTx(
-                    queued_dma_transfers_[per].data_tx,
-                    queued_dma_transfers_[per].size,
-                    queued_dma_transfers_[per].start_callback,
-                    queued_dma_transfers_[per].end_callback,
-                    queued_dma_transfers_[per].callback_context);
-            }
-            else
-            {
-                result = uart_handles[per].StartDmaRx(
-                    queued_dma_transfers_[per].data_rx,
-                    queued_dma_transfers_[per].size,
-                    queued_dma_transfers_[per].start_callback,
-                    queued_dma_transfers_[per].end_callback,
-                    queued_dma_transfers_[per].callback_context);
-            }
-            if(result == UartHandler::Result::OK)
-            {
-                // remove the job from the queue
-                queued_dma_transfers_[per].Invalidate();
-                return;
-            }
+            UartDmaJob& queued = queued_dma_transfers_[per][dir];
+            if(!queued.IsValidJob()
+               || uart_handles[per].IsDmaBusy(queued.direction))
+                continue;
+
+            // remove the job from the queue before it can finish
+            const UartDmaJob job = queued;
+            queued.Invalidate();
+            uart_handles[per].dma_busy_[dir] = true;
+            uart_handles[per].StartDmaJob(job);
         }
 }
 
-bool UartHandler::Impl::IsDmaBusy()
+bool UartHandler::Impl::IsDmaBusy(DmaDirection direction) const
 {
-    return dma_active_peripheral_ >= 0;
+    return IsDmaStreamBusy(direction == DmaDirection::TX
+                               ? config_.tx_dma_stream
+                               : config_.rx_dma_stream);
 }
 
-bool UartHandler::Impl::IsDmaTransferQueuedFor(size_t uart_idx)
+bool UartHandler::Impl::IsDmaStreamBusy(Config::DmaStream stream)
 {
-    return queued_dma_transfers_[uart_idx].IsValidJob();
+    for(int per = 0; per < kNumUartWithDma; per++)
+    {
+        const UartHandler::Impl& handle = uart_handles[per];
+        if((handle.dma_busy_[int(DmaDirection::TX)]
+            && handle.config_.tx_dma_stream == stream)
+           || (handle.dma_busy_[int(DmaDirection::RX)]
+               && handle.config_.rx_dma_stream == stream))
+            return true;
+    }
+    return false;
 }
 
-void UartHandler::Impl::QueueDmaTransfer(size_t uart_idx, const UartDmaJob& job)
+UartHandler::Result
+UartHandler::Impl::ScheduleDmaTransfer(const UartDmaJob& job)
 {
-    // wait for any previous job on this peripheral to finish
-    // and the queue position to become free
-    while(IsDmaTransferQueuedFor(uart_idx))
+    const int dir = int(job.direction);
+    while(true)
     {
-        continue;
-    };
+        {
+            ScopedIrqBlocker block;
+            if(!IsDmaBusy(job.direction))
+            {
+                // claim the stream, then start with the interrupts enabled
+                dma_busy_[dir] = true;
+                break;
+            }
 
-    // queue the job
-    ScopedIrqBlocker block;
-    queued_dma_transfers_[uart_idx] = job;
+            const int   per    = int(config_.periph);
+            UartDmaJob& queued = queued_dma_transfers_[per][dir];
+            if(!queued.IsValidJob())
+            {
+                queued = job;
+                // TODO: the user can't tell if he got returned "OK"
+                // because the transfer was executed or because it was queued...
+                // should we change that?
+                return UartHandler::Result::OK;
+            }
+
+            // an interrupt would wait for itself, e.g. when an end callback
+            // restarts a reception which waits for bytes
+            if(__get_IPSR() != 0)
+                return UartHandler::Result::ERR;
+        }
+        // wait for any previous job on this peripheral to start
+        // and the queue position to become free
+    }
+    return StartDmaJob(job);
+}
+
+UartHandler::Result UartHandler::Impl::StartDmaJob(const UartDmaJob& job)
+{
+    if(job.direction == DmaDirection::TX)
+        return StartDmaTx(job.data_tx,
+                          job.size,
+                          job.start_callback,
+                          job.end_callback,
+                          job.callback_context);
+    return StartDmaRx(job.data_rx,
+                      job.size,
+                      job.start_callback,
+                      job.end_callback,
+                      job.callback_context);
 }
 
 
@@ -502,31 +661,118 @@ UartHandler::Result UartHandler::Impl::DmaTransmit(
     UartHandler::EndCallbackFunctionPtr   end_callback,
     void*                                 callback_context)
 {
-    // if dma is currently running - queue a job
-    if(IsDmaBusy())
+    UartDmaJob job;
+    job.data_tx          = buff;
+    job.size             = size;
+    job.direction        = UartHandler::DmaDirection::TX;
+    job.start_callback   = start_callback;
+    job.end_callback     = end_callback;
+    job.callback_context = callback_context;
+
+    // if the stream is currently running - queue a job
+    return ScheduleDmaTransfer(job);
+}
+
+UartHandler::Result UartHandler::Impl::SetTxQueue(uint8_t* buff, size_t size)
+{
+    if(buff == nullptr || size == 0)
+        return UartHandler::Result::ERR;
+
+    ScopedIrqBlocker block;
+    if(tx_queue_sending_ > 0)
+        return UartHandler::Result::ERR;
+    tx_queue_buff_      = buff;
+    tx_queue_size_      = size;
+    tx_queue_read_      = 0;
+    tx_queue_count_     = 0;
+    tx_queue_overflows_ = 0;
+    return UartHandler::Result::OK;
+}
+
+UartHandler::Result UartHandler::Impl::QueueTx(const uint8_t* buff,
+                                               size_t         size)
+{
+    if(tx_queue_buff_ == nullptr)
+        return UartHandler::Result::ERR;
+
+    size_t write;
     {
-        UartDmaJob job;
-        job.data_tx          = buff;
-        job.size             = size;
-        job.direction        = UartHandler::DmaDirection::TX;
-        job.start_callback   = start_callback;
-        job.end_callback     = end_callback;
-        job.callback_context = callback_context;
-
-        const int uart_idx = int(config_.periph);
-
-        // queue a job (blocks until the queue position is free)
-        QueueDmaTransfer(uart_idx, job);
-        // TODO: the user can't tell if he got returned "OK"
-        // because the transfer was executed or because it was queued...
-        // should we change that?
-        return UartHandler::Result::OK;
+        ScopedIrqBlocker block;
+        if(size > tx_queue_size_ - tx_queue_count_)
+        {
+            tx_queue_overflows_++;
+            return UartHandler::Result::ERR;
+        }
+        write = (tx_queue_read_ + tx_queue_count_) % tx_queue_size_;
     }
 
-    return StartDmaTx(
-        buff, size, start_callback, end_callback, callback_context);
+    // the DMA only reads queued bytes, the free space is written unlocked
+    const size_t space = tx_queue_size_ - write;
+    const size_t first = size < space ? size : space;
+    memcpy(tx_queue_buff_ + write, buff, first);
+    memcpy(tx_queue_buff_, buff + first, size - first);
+    dsy_dma_clear_cache_for_buffer(tx_queue_buff_ + write, first);
+    if(size > first)
+        dsy_dma_clear_cache_for_buffer(tx_queue_buff_, size - first);
+
+    size_t send;
+    {
+        ScopedIrqBlocker block;
+        tx_queue_count_ = tx_queue_count_ + size;
+        send            = ClaimQueuedTx();
+    }
+    if(send > 0)
+        SendQueuedTx(send);
+    return UartHandler::Result::OK;
 }
 
+size_t UartHandler::Impl::ClaimQueuedTx()
+{
+    if(tx_queue_sending_ > 0 || tx_queue_count_ == 0)
+        return 0;
+    // up to the end of the buffer, the rest is the next transfer
+    const size_t space = tx_queue_size_ - tx_queue_read_;
+    tx_queue_sending_  = tx_queue_count_ < space ? tx_queue_count_ : space;
+    return tx_queue_sending_;
+}
+
+void UartHandler::Impl::SendQueuedTx(size_t size)
+{
+    // reports errors through the callback too, which drops the bytes
+    const uint32_t ends = tx_queue_ends_;
+    if(DmaTransmit(tx_queue_buff_ + tx_queue_read_,
+                   size,
+                   nullptr,
+                   UartHandler::Impl::QueuedTxEndCallback,
+                   this)
+           != UartHandler::Result::OK
+       && tx_queue_ends_ == ends)
+    {
+        // not scheduled from an interrupt, without a callback: end it here,
+        // or tx_queue_sending_ would stop the queue for good
+        QueuedTxEndCallback(this, UartHandler::Result::ERR);
+    }
+}
+
+void UartHandler::Impl::QueuedTxEndCallback(void*               context,
+                                            UartHandler::Result result)
+{
+    UartHandler::Impl& impl = *static_cast<UartHandler::Impl*>(context);
+    size_t             send;
+    {
+        ScopedIrqBlocker block;
+        const size_t     sent = impl.tx_queue_sending_;
+        const size_t     size = impl.tx_queue_size_;
+
+        impl.tx_queue_read_    = (impl.tx_queue_read_ + sent) % size;
+        impl.tx_queue_count_   = impl.tx_queue_count_ - sent;
+        impl.tx_queue_sending_ = 0;
+        impl.tx_queue_ends_    = impl.tx_queue_ends_ + 1;
+        send                   = impl.ClaimQueuedTx();
+    }
+    if(send > 0)
+        impl.SendQueuedTx(send);
+}
 
 UartHandler::Result
 UartHandler::Impl::DmaListenStart(uint8_t* buff,
@@ -534,6 +780,20 @@ UartHandler::Impl::DmaListenStart(uint8_t* buff,
                                   UartHandler::CircularRxCallbackFunctionPtr cb,
                                   void* callback_context)
 {
+    const int rx = int(DmaDirection::RX);
+    {
+        // the stream stays claimed until DmaListenStop()
+        ScopedIrqBlocker block;
+        if(IsDmaBusy(DmaDirection::RX))
+            return UartHandler::Result::ERR;
+        dma_busy_[rx] = true;
+    }
+    if(!ClaimDmaStream(config_.rx_dma_stream))
+    {
+        dma_busy_[rx] = false;
+        return UartHandler::Result::ERR;
+    }
+
     /** Set internal data*/
     circular_rx_buff_       = buff;
     circular_rx_total_size_ = size;
@@ -542,9 +802,7 @@ UartHandler::Impl::DmaListenStart(uint8_t* buff,
     circular_rx_last_pos_   = 0;
     listener_mode_          = true;
 
-    /** Initialize DMA Rx i
-     *  TODO: Update when dynamic DMA Stream acquisition is added
-     */
+    /** Initialize DMA Rx */
     hdma_rx_.Instance                 = GetDmaStream(config_.rx_dma_stream);
     hdma_rx_.Init.PeriphInc           = DMA_PINC_DISABLE;
     hdma_rx_.Init.MemInc              = DMA_MINC_ENABLE;
@@ -557,7 +815,11 @@ UartHandler::Impl::DmaListenStart(uint8_t* buff,
     SetDmaPeripheral();
 
     if(HAL_DMA_Init(&hdma_rx_) != HAL_OK)
+    {
+        listener_mode_ = false;
+        dma_busy_[rx]  = false;
         return UartHandler::Result::ERR;
+    }
     __HAL_LINKDMA(&huart_, hdmarx, hdma_rx_);
 
     // enable idle interrupts so that TC, HT, and IDLE are triggers
@@ -566,8 +828,12 @@ UartHandler::Impl::DmaListenStart(uint8_t* buff,
     /** cache maintanence to allow memory from cache-able regions  */
     dsy_dma_invalidate_cache_for_buffer(buff, size);
     if(HAL_UART_Receive_DMA(&huart_, buff, size) != HAL_OK)
+    {
+        __HAL_UART_DISABLE_IT(&huart_, UART_IT_IDLE);
+        listener_mode_ = false;
+        dma_busy_[rx]  = false;
         return UartHandler::Result::ERR;
-    dma_active_peripheral_ = int(config_.periph);
+    }
     return UartHandler::Result::OK;
 }
 
@@ -575,19 +841,129 @@ UartHandler::Result UartHandler::Impl::DmaListenStop()
 {
     /** Set Listener Mode */
     listener_mode_ = false;
+    ring_mode_     = false;
     /** Disable IDLE IRQ*/
     __HAL_UART_DISABLE_IT(&huart_, UART_IT_IDLE);
-    /** Stop DMA */
-    if(HAL_UART_DMAStop(&huart_) != HAL_OK)
+    /** Stop the DMA reception, a transmission keeps running */
+    const HAL_StatusTypeDef status = HAL_UART_AbortReceive(&huart_);
+    dma_busy_[int(DmaDirection::RX)] = false;
+    StartQueuedDmaTransfers();
+    if(status != HAL_OK)
         return UartHandler::Result::ERR;
     return UartHandler::Result::OK;
 }
 
+void UartHandler::Impl::RestartListen()
+{
+    __HAL_UART_DISABLE_IT(&huart_, UART_IT_IDLE);
+    listener_mode_                   = false;
+    dma_busy_[int(DmaDirection::RX)] = false;
+
+    UartHandler::Result result;
+    if(ring_mode_)
+        result = DmaRingStart(circular_rx_buff_,
+                              circular_rx_total_size_,
+                              ring_notify_,
+                              circular_rx_context_);
+    else
+        result = DmaListenStart(circular_rx_buff_,
+                                circular_rx_total_size_,
+                                circular_rx_callback_,
+                                circular_rx_context_);
+    if(result != UartHandler::Result::OK)
+        StartQueuedDmaTransfers();
+}
+
 bool UartHandler::Impl::IsListening() const
 {
     return listener_mode_;
 }
 
+UartHandler::Result
+UartHandler::Impl::DmaRingStart(uint8_t*                               buff,
+                                size_t                                 size,
+                                UartHandler::RxRingCallbackFunctionPtr notify,
+                                void* callback_context)
+{
+    if(buff == nullptr || size == 0)
+        return UartHandler::Result::ERR;
+    ring_notify_   = notify;
+    ring_read_pos_ = 0;
+    ring_count_    = 0;
+    ring_overruns_ = 0;
+    // before the DMA starts, the interrupts only move the ring from now on
+    ring_mode_ = true;
+    const UartHandler::Result result
+        = DmaListenStart(buff, size, nullptr, callback_context);
+    if(result != UartHandler::Result::OK)
+        ring_mode_ = false;
+    return result;
+}
+
+size_t UartHandler::Impl::UpdateRxRing()
+{
+    const size_t size = circular_rx_total_size_;
+    size_t       pos  = size
+                 - LL_DMA_GetDataLength(
+                     GetDmaFromDmaStream(config_.rx_dma_stream),
+                     __LL_DMA_GET_STREAM(hdma_rx_.Instance));
+    if(pos >= size)
+        pos = 0;
+
+    // the HT and TC interrupts come at least twice per lap, so the
+    // distance is never more than one buffer
+    const size_t received = (pos + size - circular_rx_last_pos_) % size;
+    circular_rx_last_pos_ = pos;
+    ring_count_ += received;
+    if(ring_count_ > size)
+    {
+        // the DMA overwrote unread bytes, the oldest left start at pos
+        ring_overruns_ = ring_overruns_ + 1;
+        ring_count_    = size;
+        ring_read_pos_ = pos;
+    }
+    return received;
+}
+
+size_t UartHandler::Impl::GetRxSpan(RxSpan& span)
+{
+    span.size[0] = 0;
+    span.size[1] = 0;
+    span.data[0] = circular_rx_buff_;
+    span.data[1] = circular_rx_buff_;
+    if(!ring_mode_)
+        return 0;
+
+    size_t start, count;
+    {
+        ScopedIrqBlocker block;
+        UpdateRxRing();
+        start = ring_read_pos_;
+        count = ring_count_;
+    }
+    const size_t first = circular_rx_total_size_ - start;
+    span.data[0]       = circular_rx_buff_ + start;
+    span.size[0]       = count < first ? count : first;
+    span.size[1]       = count - span.size[0];
+
+    /** cache maintanence, the DMA wrote past the cache */
+    if(span.size[0] > 0)
+        dsy_dma_invalidate_cache_for_buffer(
+            const_cast<uint8_t*>(span.data[0]), span.size[0]);
+    if(span.size[1] > 0)
+        dsy_dma_invalidate_cache_for_buffer(circular_rx_buff_, span.size[1]);
+    return count;
+}
+
+void UartHandler::Impl::ReleaseRx(size_t size)
+{
+    ScopedIrqBlocker block;
+    if(size > ring_count_)
+        size = ring_count_;
+    ring_read_pos_ = (ring_read_pos_ + size) % circular_rx_total_size_;
+    ring_count_ -= size;
+}
+
 UartHandler::Result UartHandler::Impl::StartDmaTx(
     uint8_t*                              buff,
     size_t                                size,
@@ -595,10 +971,13 @@ UartHandler::Result UartHandler::Impl::StartDmaTx(
     UartHandler::EndCallbackFunctionPtr   end_callback,
     void*                                 callback_context)
 {
-    while(HAL_UART_GetState(&huart_) != HAL_UART_STATE_READY) {};
+    // only the transmitter, the receiver may be listening
+    const int tx = int(DmaDirection::TX);
+    while(huart_.gState != HAL_UART_STATE_READY) {};
 
     if(InitDma(false, true) != UartHandler::Result::OK)
     {
+        dma_busy_[tx] = false;
         if(end_callback)
             end_callback(callback_context, UartHandler::Result::ERR);
         return UartHandler::Result::ERR;
@@ -606,18 +985,17 @@ UartHandler::Result UartHandler::Impl::StartDmaTx(
 
     ScopedIrqBlocker block;
 
-    dma_active_peripheral_ = int(config_.periph);
-    next_end_callback_     = end_callback;
-    next_callback_context_ = callback_context;
+    dma_end_callback_[tx]     = end_callback;
+    dma_callback_context_[tx] = callback_context;
 
     if(start_callback)
         start_callback(callback_context);
 
     if(HAL_UART_Transmit_DMA(&huart_, buff, size) != HAL_OK)
     {
-        dma_active_peripheral_ = -1;
-        next_end_callback_     = NULL;
-        next_callback_context_ = NULL;
+        dma_busy_[tx]             = false;
+        dma_end_callback_[tx]     = nullptr;
+        dma_callback_context_[tx] = nullptr;
         if(end_callback)
             end_callback(callback_context, UartHandler::Result::ERR);
         return UartHandler::Result::ERR;
@@ -632,31 +1010,20 @@ UartHandler::Result UartHandler::Impl::DmaReceive(
     UartHandler::EndCallbackFunctionPtr   end_callback,
     void*                                 callback_context)
 {
-    /** Normal transfer is not listener mode */
-    listener_mode_ = false;
-    // if dma is currently running - queue a job
-    if(IsDmaBusy())
-    {
-        UartDmaJob job;
-        job.data_rx          = buff;
-        job.size             = size;
-        job.direction        = UartHandler::DmaDirection::RX;
-        job.start_callback   = start_callback;
-        job.end_callback     = end_callback;
-        job.callback_context = callback_context;
-
-        const int uart_idx = int(config_.periph);
-
-        // queue a job (blocks until the queue position is free)
-        QueueDmaTransfer(uart_idx, job);
-        // TODO: the user can't tell if he got returned "OK"
-        // because the transfer was executed or because it was queued...
-        // should we change that?
-        return UartHandler::Result::OK;
-    }
+    /** Normal transfer is not listener mode, which keeps the stream */
+    if(listener_mode_)
+        return UartHandler::Result::ERR;
 
-    return StartDmaRx(
-        buff, size, start_callback, end_callback, callback_context);
+    UartDmaJob job;
+    job.data_rx          = buff;
+    job.size             = size;
+    job.direction        = UartHandler::DmaDirection::RX;
+    job.start_callback   = start_callback;
+    job.end_callback     = end_callback;
+    job.callback_context = callback_context;
+
+    // if the stream is currently running - queue a job
+    return ScheduleDmaTransfer(job);
 }
 
 UartHandler::Result UartHandler::Impl::StartDmaRx(
@@ -666,10 +1033,13 @@ UartHandler::Result UartHandler::Impl::StartDmaRx(
     UartHandler::EndCallbackFunctionPtr   end_callback,
     void*                                 callback_context)
 {
-    while(HAL_UART_GetState(&huart_) != HAL_UART_STATE_READY) {};
+    // only the receiver, the transmitter may be sending
+    const int rx = int(DmaDirection::RX);
+    while(huart_.RxState != HAL_UART_STATE_READY) {};
 
     if(InitDma(true, false) != UartHandler::Result::OK)
     {
+        dma_busy_[rx] = false;
         if(end_callback)
             end_callback(callback_context, UartHandler::Result::ERR);
         return UartHandler::Result::ERR;
@@ -677,18 +1047,17 @@ UartHandler::Result UartHandler::Impl::StartDmaRx(
 
     ScopedIrqBlocker block;
 
-    dma_active_peripheral_ = int(config_.periph);
-    next_end_callback_     = end_callback;
-    next_callback_context_ = callback_context;
+    dma_end_callback_[rx]     = end_callback;
+    dma_callback_context_[rx] = callback_context;
 
     if(start_callback)
         start_callback(callback_context);
 
     if(HAL_UART_Receive_DMA(&huart_, buff, size) != HAL_OK)
     {
-        dma_active_peripheral_ = -1;
-        next_end_callback_     = NULL;
-        next_callback_context_ = NULL;
+        dma_busy_[rx]             = false;
+        dma_end_callback_[rx]     = nullptr;
+        dma_callback_context_[rx] = nullptr;
         if(end_callback)
             end_callback(callback_context, UartHandler::Result::ERR);
         return UartHandler::Result::ERR;
@@ -875,12 +1244,8 @@ UartHandler::Result UartHandler::Impl::DeInitPins()
     return Result::OK;
 }
 
-volatile int8_t UartHandler::Impl::dma_active_peripheral_;
-UartHandler::Impl::UartDmaJob
-    UartHandler::Impl::queued_dma_transfers_[kNumUartWithDma];
-
-UartHandler::EndCallbackFunctionPtr UartHandler::Impl::next_end_callback_;
-void*                               UartHandler::Impl::next_callback_context_;
+UartHandler::Impl::UartDmaJob UartHandler::Impl::queued_dma_transfers_
+    [kNumUartWithDma][kNumDmaDirections];
 
 // HAL Interface functions
 void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
@@ -936,7 +1301,8 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
                          UART8_IRQn,
                          LPUART1_IRQn};
 
-    HAL_NVIC_SetPriority(types[(int)handle->config_.periph], 0, 0);
+    HAL_NVIC_SetPriority(
+        types[(int)handle->config_.periph], DSY_IRQ_PRIORITY_PERIPHERAL, 0);
     HAL_NVIC_EnableIRQ(types[(int)handle->config_.periph]);
 }
 
@@ -1009,6 +1375,14 @@ extern "C" void dsy_uart_global_init()
  */
 static void UART_CheckRxListener(UartHandler::Impl* handle)
 {
+    if(handle->ring_mode_)
+    {
+        /** no copy, only the write position of the ring moves */
+        if(handle->UpdateRxRing() > 0 && handle->ring_notify_)
+            handle->ring_notify_(handle->circular_rx_context_);
+        return;
+    }
+
     size_t pos;
     size_t old_pos = handle->circular_rx_last_pos_;
 
@@ -1068,6 +1442,7 @@ static void UART_CheckRxListener(UartHandler::Impl* handle)
 // HAL Interrupts.
 void UART_IRQHandler(UartHandler::Impl* handle)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::UARTS);
     HAL_UART_IRQHandler(&handle->huart_);
 
     if(handle->listener_mode_
@@ -1095,24 +1470,24 @@ extern "C"
 
 void HalUartDmaStreamCallback(DMA_Stream_TypeDef* stream)
 {
+    DSY_IRQ_PROFILE_SCOPE(Source::UARTS);
     ScopedIrqBlocker block;
-    if(UartHandler::Impl::dma_active_peripheral_ >= 0)
+    // Get uart_handle from uart_handles by comparing `stream` with the
+    // hdma_rx_ and hdma_tx_ of the transfers running on each direction
+    for(int i = 0; i < 9; i++)
     {
-        // Get uart_handle from uart_handles by comparing `stream`
-        // with hdma_rx_ and hdma_tx_
-        for(int i = 0; i < 9; i++)
+        UartHandler::Impl& uart_handle = uart_handles[i];
+        if(uart_handle.dma_busy_[int(UartHandler::DmaDirection::RX)]
+           && stream == uart_handle.hdma_rx_.Instance)
         {
-            UartHandler::Impl& uart_handle = uart_handles[i];
-            if(stream == uart_handle.hdma_rx_.Instance)
-            {
-                HAL_DMA_IRQHandler(&uart_handle.hdma_rx_);
-                return;
-            }
-            else if(stream == uart_handle.hdma_tx_.Instance)
-            {
-                HAL_DMA_IRQHandler(&uart_handle.hdma_tx_);
-                return;
-            }
+            HAL_DMA_IRQHandler(&uart_handle.hdma_rx_);
+            return;
+        }
+        else if(uart_handle.dma_busy_[int(UartHandler::DmaDirection::TX)]
+                && stream == uart_handle.hdma_tx_.Instance)
+        {
+            HAL_DMA_IRQHandler(&uart_handle.hdma_tx_);
+            return;
         }
     }
 }
@@ -1132,7 +1507,8 @@ DEFINE_DMA_STREAM_IRQ_HANDLER(DMA2_Stream7);
 
 extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart)
 {
-    UartHandler::Impl::DmaTransferFinished(huart, UartHandler::Result::OK);
+    UartHandler::Impl::DmaTransferFinished(
+        huart, UartHandler::DmaDirection::TX, UartHandler::Result::OK);
 }
 
 extern "C" void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
@@ -1145,7 +1521,8 @@ extern "C" void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
     }
     else
     {
-        UartHandler::Impl::DmaTransferFinished(huart, UartHandler::Result::OK);
+        UartHandler::Impl::DmaTransferFinished(
+            huart, UartHandler::DmaDirection::RX, UartHandler::Result::OK);
     }
 }
 
@@ -1161,11 +1538,29 @@ extern "C" void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef* huart)
 
 extern "C" void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart)
 {
-    /** TODO: This hooks into the "Normal" DMA completion, 
-     *  might want to change this to have a different fallthrough
-     *  for "listener_mode_"
+    /** The HAL ends the transfers an error aborted, and leaves their
+     *  state READY. A transfer of the other direction keeps running.
      */
-    UartHandler::Impl::DmaTransferFinished(huart, UartHandler::Result::ERR);
+    auto*     handle = MapInstanceToHandle(huart->Instance);
+    const int tx     = int(UartHandler::DmaDirection::TX);
+    const int rx     = int(UartHandler::DmaDirection::RX);
+
+    if(handle->dma_busy_[rx] && huart->RxState == HAL_UART_STATE_READY)
+    {
+        if(handle->listener_mode_)
+        {
+            // the bytes still in the buffer are lost
+            handle->RestartListen();
+        }
+        else
+        {
+            UartHandler::Impl::DmaTransferFinished(
+                huart, UartHandler::DmaDirection::RX, UartHandler::Result::ERR);
+        }
+    }
+    if(handle->dma_busy_[tx] && huart->gState == HAL_UART_STATE_READY)
+        UartHandler::Impl::DmaTransferFinished(
+            huart, UartHandler::DmaDirection::TX, UartHandler::Result::ERR);
 }
 
 extern "C" void HAL_UART_AbortCpltCallback(UART_HandleTypeDef* huart)
@@ -1222,6 +1617,26 @@ UartHandler::DmaTransmit(uint8_t*                              buff,
         buff, size, start_callback, end_callback, callback_context);
 }
 
+UartHandler::Result UartHandler::SetTxQueue(uint8_t* buff, size_t size)
+{
+    return pimpl_->SetTxQueue(buff, size);
+}
+
+UartHandler::Result UartHandler::QueueTx(const uint8_t* buff, size_t size)
+{
+    return pimpl_->QueueTx(buff, size);
+}
+
+size_t UartHandler::GetTxQueued() const
+{
+    return pimpl_->tx_queue_count_;
+}
+
+uint32_t UartHandler::GetTxOverflows() const
+{
+    return pimpl_->tx_queue_overflows_;
+}
+
 UartHandler::Result
 UartHandler::DmaReceive(uint8_t*                              buff,
                         size_t                                size,
@@ -1239,6 +1654,7 @@ UartHandler::DmaListenStart(uint8_t*                                   buff,
                             UartHandler::CircularRxCallbackFunctionPtr cb,
                             void* callback_context)
 {
+    pimpl_->ring_mode_ = false;
     return pimpl_->DmaListenStart(buff, size, cb, callback_context);
 }
 
@@ -1252,6 +1668,30 @@ bool UartHandler::IsListening() const
     return pimpl_->IsListening();
 }
 
+UartHandler::Result
+UartHandler::DmaRingStart(uint8_t*                               buff,
+                          size_t                                 size,
+                          UartHandler::RxRingCallbackFunctionPtr notify,
+                          void* callback_context)
+{
+    return pimpl_->DmaRingStart(buff, size, notify, callback_context);
+}
+
+size_t UartHandler::GetRxSpan(RxSpan& span)
+{
+    return pimpl_->GetRxSpan(span);
+}
+
+void UartHandler::ReleaseRx(size_t size)
+{
+    pimpl_->ReleaseRx(size);
+}
+
+uint32_t UartHandler::GetRxOverruns() const
+{
+    return pimpl_->ring_overruns_;
+}
+
 int UartHandler::CheckError()
 {
     return pimpl_->CheckError();
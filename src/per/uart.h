@@ -148,6 +148,24 @@ class UartHandler
                                                   void*    context,
                                                   Result   result);
 
+    /** A callback of the receive ring, when new bytes arrived, with no data
+     *  @param context user-defined context variable
+     */
+    typedef void (*RxRingCallbackFunctionPtr)(void* context);
+
+    /** Unread bytes of the receive ring, in place in the DMA buffer. The
+     *  bytes that wrapped around to the start of the buffer are in the
+     *  second part.
+     */
+    struct RxSpan
+    {
+        const uint8_t* data[2]; /**< start of each part */
+        size_t         size[2]; /**< bytes in each part, 0 if it's empty */
+
+        /** \return the bytes of both parts */
+        size_t Total() const { return size[0] + size[1]; }
+    };
+
     /** Blocking transmit 
     \param buff input buffer
     \param size  buffer size
@@ -181,6 +199,34 @@ class UartHandler
                        UartHandler::EndCallbackFunctionPtr   end_callback,
                        void*                                 callback_context);
 
+    /** Sets the buffer of the transmit queue, for QueueTx().
+     *  \param buff buffer accessible by DMA, e.g. in DMA_BUFFER_MEM_SECTION
+     *  \param size size of the buffer, the most bytes that can wait
+     *  \return ERR if there's no buffer, or the queue is sending
+     */
+    Result SetTxQueue(uint8_t* buff, size_t size);
+
+    /** Non-blocking transmit through the queue of SetTxQueue().
+     *
+     *  The bytes are copied into the queue and the call returns right away.
+     *  The queue is sent by DmaTransmit()s that are chained from the end of
+     *  the previous one, so bytes queued while a transfer runs follow it
+     *  without a gap. Call from one context only, e.g. the main loop.
+     *
+     *  Either all bytes are queued, or none: if they don't fit, ERR is
+     *  returned and GetTxOverflows() counts it.
+     *  \param buff bytes to send
+     *  \param size number of bytes
+     *  \return ERR if there's no queue or the bytes don't fit
+     */
+    Result QueueTx(const uint8_t* buff, size_t size);
+
+    /** Returns the bytes of the tx queue that weren't completely sent */
+    size_t GetTxQueued() const;
+
+    /** Returns the number of QueueTx() calls that didn't fit */
+    uint32_t GetTxOverflows() const;
+
     /** DMA-based receive 
     \param *buff input buffer
     \param size  buffer size
@@ -206,6 +252,10 @@ class UartHandler
      *  Size must be set so that at maximum bandwidth, the software
      *  has time to process N bytes before the next circular IRQ is fired
      * 
+     *  The rx DMA stream stays busy until DmaListenStop(), transmissions
+     *  keep running on the tx stream. Returns ERR if another UART is
+     *  receiving on the same rx stream.
+     * 
      *  @param buff buffer of data accessible by DMA.
      *  @param size size of buffer
      *  @param cb callback that happens containing new bytes to process in software
@@ -222,6 +272,42 @@ class UartHandler
     /** Returns whether listen the DmaListen mode is active or not */
     bool IsListening() const;
 
+    /** Starts receiving into a circular DMA ring, without copying.
+     *
+     *  Like DmaListenStart(), but instead of a callback with each chunk, the
+     *  bytes stay in the buffer until they are read with GetRxSpan() and
+     *  released with ReleaseRx(), e.g. by a parser in the main loop. The HT,
+     *  TC and IDLE interrupts only move the write position, and call the
+     *  optional notify callback. Stopped with DmaListenStop().
+     *
+     *  If the reader falls more than one buffer behind, the oldest bytes are
+     *  lost and GetRxOverruns() counts it.
+     *
+     *  @param buff buffer of data accessible by DMA.
+     *  @param size size of buffer
+     *  @param notify called from the interrupt when bytes arrived, or nullptr
+     *  @param callback_context pointer passed to notify
+     */
+    Result DmaRingStart(uint8_t*                  buff,
+                        size_t                    size,
+                        RxRingCallbackFunctionPtr notify           = nullptr,
+                        void*                     callback_context = nullptr);
+
+    /** Returns the unread bytes of the DmaRingStart() ring, up to the
+     *  current DMA position, also between interrupts.
+     *  @param span set to the unread bytes
+     *  @return number of unread bytes
+     */
+    size_t GetRxSpan(RxSpan& span);
+
+    /** Marks bytes of GetRxSpan() as read, so the DMA can reuse them.
+     *  @param size bytes to release, at most the unread bytes
+     */
+    void ReleaseRx(size_t size);
+
+    /** Returns the number of times the ring overran since DmaRingStart() */
+    uint32_t GetRxOverruns() const;
+
     /** \return the result of HAL_UART_GetError() to the user. */
     int CheckError();
 
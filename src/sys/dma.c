@@ -1,5 +1,6 @@
 #include "stm32h7xx_hal.h"
 #include "sys/dma.h"
+#include "sys/irq_priority.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -13,50 +14,50 @@ extern "C"
         __HAL_RCC_DMA2_CLK_ENABLE();
 
         // DMA interrupt init
-        // DMA1_Stream0_IRQn interrupt configuration
-        HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+        // DMA1_Stream0_IRQn interrupt configuration for SAI1 A
+        HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, DSY_IRQ_PRIORITY_AUDIO_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
-        // DMA1_Stream1_IRQn interrupt configuration
-        HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, 0, 0);
+        // DMA1_Stream1_IRQn interrupt configuration for SAI1 B
+        HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, DSY_IRQ_PRIORITY_AUDIO_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream1_IRQn);
         // DMA1_Stream2_IRQn interrupt configuration
-        HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
-        // DMA1_Stream3_IRQn interrupt configuration
-        HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 0, 0);
+        // DMA1_Stream3_IRQn interrupt configuration for SAI2 A
+        HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, DSY_IRQ_PRIORITY_AUDIO_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
-        // DMA1_Stream4_IRQn interrupt configuration
-        HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 0, 0);
+        // DMA1_Stream4_IRQn interrupt configuration for SAI2 B
+        HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, DSY_IRQ_PRIORITY_AUDIO_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
         // DMA1_Stream5_IRQn and DMA2_Stream4_IRQn interrupt configuration for uart rx and tx
-        HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
-        HAL_NVIC_SetPriority(DMA2_Stream4_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream4_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream4_IRQn);
         // DMA1_Stream6_IRQn interrupt configuration for I2C
-        HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
         // DMA2_Stream0_IRQn, interrupt configuration for DAC Ch1
-        HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
         // DMA2_Stream1_IRQn, interrupt configuration for DAC Ch2
-        HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream1_IRQn);
 
         // DMA2_Stream2_IRQn and DMA2_Stream3_IRQn interrupt configuration for SPI
-        HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
-        HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
 
         // Remaining DMA Streams reserved for UART (see per/uart.cpp)
-        HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream7_IRQn);
-        HAL_NVIC_SetPriority(DMA2_Stream5_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream5_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream5_IRQn);
-        HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
-        HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, DSY_IRQ_PRIORITY_DMA, 0);
         HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
     }
 
@@ -97,8 +98,10 @@ extern "C"
         // clear all cache lines (32bytes each) that span the memory section
         // of our transmit buffer. This makes sure that the SRAM contains the
         // most recent version of the buffer.
-        SCB_CleanDCache_by_Addr(
-            (uint32_t*)((uint32_t)(buffer) & ~(uint32_t)0x1F), size + 32);
+        const uint32_t start = (uint32_t)(buffer) & ~(uint32_t)0x1F;
+        const uint32_t end   = ((uint32_t)(buffer) + size + 0x1F)
+                             & ~(uint32_t)0x1F;
+        SCB_CleanDCache_by_Addr((uint32_t*)start, end - start);
     }
 
     void dsy_dma_invalidate_cache_for_buffer(uint8_t* buffer, size_t size)
@@ -106,8 +109,12 @@ extern "C"
         // invalidate all cache lines (32bytes each) that span the memory section
         // of our transmit buffer. This makes sure that the cache contains the
         // most recent version of the buffer.
-        SCB_InvalidateDCache_by_Addr(
-            (uint32_t*)((uint32_t)(buffer) & ~(uint32_t)0x1F), size + 32);
+        // Only the lines the buffer touches, the one after it may hold
+        // unrelated data the CPU hasn't written back yet.
+        const uint32_t start = (uint32_t)(buffer) & ~(uint32_t)0x1F;
+        const uint32_t end   = ((uint32_t)(buffer) + size + 0x1F)
+                             & ~(uint32_t)0x1F;
+        SCB_InvalidateDCache_by_Addr((uint32_t*)start, end - start);
     }
 
 #ifdef __cplusplus
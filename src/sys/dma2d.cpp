@@ -0,0 +1,421 @@
+#include "stm32h7xx_hal.h"
+#include "sys/dma2d.h"
+#include "sys/dma.h"
+#include "sys/irq_priority.h"
+#include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
+
+namespace daisy
+{
+namespace
+{
+/** Above the size of the data cache, the whole cache is maintained */
+constexpr size_t kCacheSize = 16 * 1024;
+
+void CleanCache(const void* buffer, size_t size)
+{
+    if(size > kCacheSize)
+        SCB_CleanDCache();
+    else
+        dsy_dma_clear_cache_for_buffer((uint8_t*)buffer, size);
+}
+
+void InvalidateCache(void* buffer, size_t size)
+{
+    // this is after the transfer, dirty lines elsewhere have to be kept
+    if(size > kCacheSize)
+        SCB_CleanInvalidateDCache();
+    else
+        dsy_dma_invalidate_cache_for_buffer((uint8_t*)buffer, size);
+}
+
+uint32_t GetOutputColorMode(PixelFormat format)
+{
+    switch(format)
+    {
+        case PixelFormat::ARGB8888: return DMA2D_OUTPUT_ARGB8888;
+        case PixelFormat::RGB888: return DMA2D_OUTPUT_RGB888;
+        case PixelFormat::ARGB1555: return DMA2D_OUTPUT_ARGB1555;
+        case PixelFormat::ARGB4444: return DMA2D_OUTPUT_ARGB4444;
+        default: return DMA2D_OUTPUT_RGB565;
+    }
+}
+
+uint32_t GetInputColorMode(PixelFormat format)
+{
+    switch(format)
+    {
+        case PixelFormat::ARGB8888: return DMA2D_INPUT_ARGB8888;
+        case PixelFormat::RGB888: return DMA2D_INPUT_RGB888;
+        case PixelFormat::ARGB1555: return DMA2D_INPUT_ARGB1555;
+        case PixelFormat::ARGB4444: return DMA2D_INPUT_ARGB4444;
+        case PixelFormat::A8: return DMA2D_INPUT_A8;
+        default: return DMA2D_INPUT_RGB565;
+    }
+}
+
+/** A rectangle of a PixelBuffer, as the DMA2D addresses it */
+struct Area
+{
+    uint8_t* address;
+    uint32_t offset; // pixels from the end of a line to the next
+    size_t   size;   // bytes from the first to the last pixel
+};
+
+Area GetArea(const PixelBuffer& buffer,
+             uint16_t           x,
+             uint16_t           y,
+             uint16_t           width,
+             uint16_t           height)
+{
+    const size_t bytes = GetBitsPerPixel(buffer.format) / 8;
+    Area         area;
+    area.address = static_cast<uint8_t*>(buffer.data)
+                   + (size_t(y) * buffer.width + x) * bytes;
+    area.offset = buffer.width - width;
+    area.size   = ((size_t(height) - 1) * buffer.width + width) * bytes;
+    return area;
+}
+
+/** Returns the part of size that fits in the buffer from pos */
+uint16_t ClipSize(uint16_t pos, uint16_t buffer_size, uint16_t size)
+{
+    if(pos >= buffer_size)
+        return 0;
+    return size < buffer_size - pos ? size : buffer_size - pos;
+}
+} // namespace
+
+class Dma2dHandle::Impl
+{
+  public:
+    struct Request
+    {
+        uint32_t               mode;
+        Area                   out;
+        uint32_t               out_format;
+        bool                   out_swap;
+        Area                   fg;
+        uint32_t               fg_format;
+        uint32_t               fg_alpha; // with the colour for A8
+        Area                   bg;
+        uint32_t               bg_format;
+        uint32_t               color; // of a fill
+        uint16_t               width;
+        uint16_t               height;
+        EndCallbackFunctionPtr callback;
+        void*                  context;
+    };
+
+    Result Init();
+    Result Queue(const Request& request);
+    Result QueueImage(const PixelBuffer&     dst,
+                      uint16_t               x,
+                      uint16_t               y,
+                      const PixelBuffer&     src,
+                      bool                   blend,
+                      uint8_t                alpha,
+                      uint32_t               color,
+                      EndCallbackFunctionPtr callback,
+                      void*                  context);
+    void   StartTransfer();
+    void   TransferDone(bool ok);
+
+    size_t GetNumQueued() const { return num_queued_; }
+
+    DMA2D_HandleTypeDef hdma2d_;
+
+  private:
+    Request         queue_[DSY_DMA2D_QUEUE_SIZE];
+    size_t          head_;
+    volatile size_t num_queued_;
+    bool            initialized_;
+};
+
+// ================================================================
+// Global reference for the Dma2dHandle::Impl, the DMA2D is shared
+// ================================================================
+
+static Dma2dHandle::Impl dma2d_impl;
+
+static void OnTransferComplete(DMA2D_HandleTypeDef* hdma2d)
+{
+    (void)hdma2d;
+    dma2d_impl.TransferDone(true);
+}
+
+static void OnTransferError(DMA2D_HandleTypeDef* hdma2d)
+{
+    (void)hdma2d;
+    dma2d_impl.TransferDone(false);
+}
+
+Dma2dHandle::Result Dma2dHandle::Impl::Init()
+{
+    if(initialized_)
+        return Result::OK;
+    head_       = 0;
+    num_queued_ = 0;
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA2D_IRQn, DSY_IRQ_PRIORITY_DMA2D, 0);
+    HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+    hdma2d_.Instance = DMA2D;
+    initialized_     = true;
+    return Result::OK;
+}
+
+Dma2dHandle::Result Dma2dHandle::Impl::Queue(const Request& request)
+{
+    if(!initialized_)
+        return Result::ERR;
+    if(request.width == 0 || request.height == 0)
+    {
+        if(request.callback)
+            request.callback(request.context, Result::OK);
+        return Result::OK;
+    }
+
+    // what the CPU drew has to be in memory, and no dirty lines may be
+    // evicted over the destination during the transfer
+    if(request.mode != DMA2D_R2M)
+        CleanCache(request.fg.address, request.fg.size);
+    CleanCache(request.out.address, request.out.size);
+
+    ScopedIrqBlocker irq_blocker;
+    if(num_queued_ >= DSY_DMA2D_QUEUE_SIZE)
+        return Result::ERR;
+    queue_[(head_ + num_queued_) % DSY_DMA2D_QUEUE_SIZE] = request;
+    num_queued_ = num_queued_ + 1;
+    if(num_queued_ == 1)
+        StartTransfer();
+    return Result::OK;
+}
+
+Dma2dHandle::Result
+Dma2dHandle::Impl::QueueImage(const PixelBuffer&     dst,
+                              uint16_t               x,
+                              uint16_t               y,
+                              const PixelBuffer&     src,
+                              bool                   blend,
+                              uint8_t                alpha,
+                              uint32_t               color,
+                              EndCallbackFunctionPtr callback,
+                              void*                  context)
+{
+    if(!CanWrite(dst.format) || !CanRead(src.format))
+        return Result::ERR;
+
+    Request req    = {};
+    req.width      = ClipSize(x, dst.width, src.width);
+    req.height     = ClipSize(y, dst.height, src.height);
+    req.out        = GetArea(dst, x, y, req.width, req.height);
+    req.out_format = GetOutputColorMode(dst.format);
+    req.out_swap   = dst.format == PixelFormat::RGB565_SWAPPED;
+    req.fg         = GetArea(src, 0, 0, req.width, req.height);
+    req.fg_format  = GetInputColorMode(src.format);
+    req.fg_alpha   = alpha;
+    req.callback   = callback;
+    req.context    = context;
+    if(src.format == PixelFormat::A8)
+        req.fg_alpha = (uint32_t(alpha) << 24) | (color & 0xffffff);
+
+    if(blend)
+    {
+        req.mode      = DMA2D_M2M_BLEND;
+        req.bg        = req.out;
+        req.bg_format = GetInputColorMode(dst.format);
+    }
+    else
+    {
+        req.mode = src.format == dst.format ? DMA2D_M2M : DMA2D_M2M_PFC;
+    }
+    return Queue(req);
+}
+
+void Dma2dHandle::Impl::StartTransfer()
+{
+    const Request& req = queue_[head_];
+
+    DMA2D_InitTypeDef& init = hdma2d_.Init;
+    init.Mode               = req.mode;
+    init.ColorMode          = req.out_format;
+    init.OutputOffset       = req.out.offset;
+    init.AlphaInverted      = DMA2D_REGULAR_ALPHA;
+    init.RedBlueSwap        = DMA2D_RB_REGULAR;
+    init.BytesSwap      = req.out_swap ? DMA2D_BYTES_SWAP : DMA2D_BYTES_REGULAR;
+    init.LineOffsetMode = DMA2D_LOM_PIXELS;
+    if(HAL_DMA2D_Init(&hdma2d_) != HAL_OK)
+    {
+        TransferDone(false);
+        return;
+    }
+    hdma2d_.XferCpltCallback  = OnTransferComplete;
+    hdma2d_.XferErrorCallback = OnTransferError;
+
+    HAL_StatusTypeDef status = HAL_OK;
+    if(req.mode != DMA2D_R2M)
+    {
+        DMA2D_LayerCfgTypeDef& fg = hdma2d_.LayerCfg[DMA2D_FOREGROUND_LAYER];
+        fg.InputOffset            = req.fg.offset;
+        fg.InputColorMode         = req.fg_format;
+        fg.AlphaMode              = DMA2D_COMBINE_ALPHA;
+        fg.InputAlpha             = req.fg_alpha;
+        fg.AlphaInverted          = DMA2D_REGULAR_ALPHA;
+        fg.RedBlueSwap            = DMA2D_RB_REGULAR;
+        fg.ChromaSubSampling      = DMA2D_NO_CSS;
+        status = HAL_DMA2D_ConfigLayer(&hdma2d_, DMA2D_FOREGROUND_LAYER);
+    }
+    if(status == HAL_OK && req.mode == DMA2D_M2M_BLEND)
+    {
+        DMA2D_LayerCfgTypeDef& bg = hdma2d_.LayerCfg[DMA2D_BACKGROUND_LAYER];
+        bg.InputOffset            = req.bg.offset;
+        bg.InputColorMode         = req.bg_format;
+        bg.AlphaMode              = DMA2D_NO_MODIF_ALPHA;
+        bg.InputAlpha             = 0xff;
+        bg.AlphaInverted          = DMA2D_REGULAR_ALPHA;
+        bg.RedBlueSwap            = DMA2D_RB_REGULAR;
+        bg.ChromaSubSampling      = DMA2D_NO_CSS;
+        status = HAL_DMA2D_ConfigLayer(&hdma2d_, DMA2D_BACKGROUND_LAYER);
+    }
+    if(status != HAL_OK)
+    {
+        TransferDone(false);
+        return;
+    }
+
+    const uint32_t out = (uint32_t)req.out.address;
+    if(req.mode == DMA2D_R2M)
+        status = HAL_DMA2D_Start_IT(
+            &hdma2d_, req.color, out, req.width, req.height);
+    else if(req.mode == DMA2D_M2M_BLEND)
+        status = HAL_DMA2D_BlendingStart_IT(&hdma2d_,
+                                            (uint32_t)req.fg.address,
+                                            (uint32_t)req.bg.address,
+                                            out,
+                                            req.width,
+                                            req.height);
+    else
+        status = HAL_DMA2D_Start_IT(&hdma2d_,
+                                    (uint32_t)req.fg.address,
+                                    out,
+                                    req.width,
+                                    req.height);
+    if(status != HAL_OK)
+        TransferDone(false);
+}
+
+void Dma2dHandle::Impl::TransferDone(bool ok)
+{
+    const Request req = queue_[head_];
+    InvalidateCache(req.out.address, req.out.size);
+    head_       = (head_ + 1) % DSY_DMA2D_QUEUE_SIZE;
+    num_queued_ = num_queued_ - 1;
+    if(num_queued_ > 0)
+        StartTransfer();
+    if(req.callback)
+        req.callback(req.context, ok ? Result::OK : Result::ERR);
+}
+
+// ======================================================================
+// Dma2dHandle > Dma2dHandle::Impl
+// ======================================================================
+
+Dma2dHandle::Result Dma2dHandle::Init()
+{
+    pimpl_ = &dma2d_impl;
+    return pimpl_->Init();
+}
+
+Dma2dHandle::Result Dma2dHandle::Fill(const PixelBuffer&     dst,
+                                      uint16_t               x,
+                                      uint16_t               y,
+                                      uint16_t               width,
+                                      uint16_t               height,
+                                      uint32_t               color,
+                                      EndCallbackFunctionPtr callback,
+                                      void*                  context)
+{
+    if(pimpl_ == nullptr || !CanWrite(dst.format))
+        return Result::ERR;
+    Impl::Request req = {};
+    req.mode          = DMA2D_R2M;
+    req.width         = ClipSize(x, dst.width, width);
+    req.height        = ClipSize(y, dst.height, height);
+    req.out           = GetArea(dst, x, y, req.width, req.height);
+    req.out_format    = GetOutputColorMode(dst.format);
+    req.color         = color;
+    req.callback      = callback;
+    req.context       = context;
+    if(dst.format == PixelFormat::RGB565_SWAPPED)
+    {
+        // the fill colour doesn't go through the byte swap, it's set
+        // swapped
+        uint16_t v = ((color >> 8) & 0xf800) | ((color >> 5) & 0x07e0)
+                     | ((color >> 3) & 0x001f);
+        v         = (v << 8) | (v >> 8);
+        req.color = ((v & 0xf800) << 8) | ((v & 0x07e0) << 5)
+                    | ((v & 0x001f) << 3);
+    }
+    return pimpl_->Queue(req);
+}
+
+Dma2dHandle::Result Dma2dHandle::Copy(const PixelBuffer&     dst,
+                                      uint16_t               x,
+                                      uint16_t               y,
+                                      const PixelBuffer&     src,
+                                      EndCallbackFunctionPtr callback,
+                                      void*                  context)
+{
+    if(pimpl_ == nullptr || src.format == PixelFormat::A8)
+        return Result::ERR;
+    return pimpl_->QueueImage(dst, x, y, src, false, 255, 0, callback, context);
+}
+
+Dma2dHandle::Result Dma2dHandle::Blend(const PixelBuffer&     dst,
+                                       uint16_t               x,
+                                       uint16_t               y,
+                                       const PixelBuffer&     src,
+                                       uint8_t                alpha,
+                                       uint32_t               color,
+                                       EndCallbackFunctionPtr callback,
+                                       void*                  context)
+{
+    // the background is read from dst
+    if(pimpl_ == nullptr || !CanRead(dst.format))
+        return Result::ERR;
+    return pimpl_->QueueImage(
+        dst, x, y, src, true, alpha, color, callback, context);
+}
+
+bool Dma2dHandle::IsBusy() const
+{
+    return GetNumQueued() > 0;
+}
+
+size_t Dma2dHandle::GetNumQueued() const
+{
+    return pimpl_ != nullptr ? pimpl_->GetNumQueued() : 0;
+}
+
+void Dma2dHandle::Wait() const
+{
+    while(IsBusy()) {}
+}
+
+bool Dma2dHandle::CanRead(PixelFormat format)
+{
+    return format != PixelFormat::RGB565_SWAPPED && format != PixelFormat::L4;
+}
+
+bool Dma2dHandle::CanWrite(PixelFormat format)
+{
+    return format != PixelFormat::A8 && format != PixelFormat::L4;
+}
+
+} // namespace daisy
+
+extern "C" void DMA2D_IRQHandler(void)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::DMA_2D);
+    HAL_DMA2D_IRQHandler(&daisy::dma2d_impl.hdma2d_);
+}
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef DSY_DMA2D_H
+#define DSY_DMA2D_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/pixel_format.h"
+
+/** Number of operations that can wait for the DMA2D */
+#ifndef DSY_DMA2D_QUEUE_SIZE
+#define DSY_DMA2D_QUEUE_SIZE 8
+#endif
+
+namespace daisy
+{
+/** @brief Rectangle fills, copies and blending with the DMA2D (Chrom-ART)
+ *  @ingroup system
+ *
+ *  The DMA2D fills rectangles of a framebuffer with a colour, copies
+ *  images into it, converting the pixel format on the way, and blends
+ *  images over it, with per pixel alpha and a constant alpha. A8 alpha
+ *  masks, e.g. antialiased text, are blended in one colour. It works in
+ *  the background, requests are queued and run one after the other.
+ *
+ *  Which formats it reads and writes is returned by CanRead() and
+ *  CanWrite(). Operations are clipped to the destination.
+ *
+ *  The data cache is taken care of, like with the MdmaHandle: images are
+ *  cleaned when a request is queued, the destination is invalidated
+ *  before the callback. Neither may be written until the request is done.
+ *  The DMA2D can't reach the DTCM, buffers on the stack don't work.
+ *
+ *  Callbacks are called from the DMA2D interrupt, and may queue further
+ *  requests.
+ *
+ *  @code
+ *  Dma2dHandle dma2d;
+ *  dma2d.Init();
+ *  PixelBuffer fb = {framebuffer, PixelFormat::RGB565, 240, 240};
+ *  dma2d.Fill(fb, 0, 0, 240, 240, 0xff000000);
+ *  dma2d.Blend(fb, 10, 10, icon, 128);
+ *  dma2d.Wait();
+ *  @endcode
+ */
+class Dma2dHandle
+{
+  public:
+    /** Return values */
+    enum class Result
+    {
+        OK,  /**< & */
+        ERR, /**< & */
+    };
+
+    /** A callback to be executed when a request is done */
+    typedef void (*EndCallbackFunctionPtr)(void* context, Result result);
+
+    Dma2dHandle() : pimpl_(nullptr) {}
+    Dma2dHandle(const Dma2dHandle& other) = default;
+    Dma2dHandle& operator=(const Dma2dHandle& other) = default;
+
+    /** Enables the DMA2D and its interrupt. All handles share one queue. */
+    Result Init();
+
+    /** Queues the fill of a rectangle with a colour
+     *  \param dst the buffer to fill
+     *  \param x left edge
+     *  \param y top edge
+     *  \param width width of the rectangle
+     *  \param height height of the rectangle
+     *  \param color 0xAARRGGBB, converted to the format of dst
+     *  \param callback called when done, can be nullptr
+     *  \param context passed to the callback
+     *  \return Result::ERR if the queue is full or dst can't be written
+     */
+    Result Fill(const PixelBuffer&     dst,
+                uint16_t               x,
+                uint16_t               y,
+                uint16_t               width,
+                uint16_t               height,
+                uint32_t               color,
+                EndCallbackFunctionPtr callback = nullptr,
+                void*                  context  = nullptr);
+
+    /** Queues the copy of an image, converted to the format of dst
+     *  \param dst the buffer to copy to
+     *  \param x where the left edge of the image goes
+     *  \param y where the top edge of the image goes
+     *  \param src the image, not A8
+     *  \param callback called when done, can be nullptr
+     *  \param context passed to the callback
+     *  \return Result::ERR if the queue is full or a format isn't supported
+     */
+    Result Copy(const PixelBuffer&     dst,
+                uint16_t               x,
+                uint16_t               y,
+                const PixelBuffer&     src,
+                EndCallbackFunctionPtr callback = nullptr,
+                void*                  context  = nullptr);
+
+    /** Queues the blending of an image over dst
+     *  \param dst the buffer to blend into
+     *  \param x where the left edge of the image goes
+     *  \param y where the top edge of the image goes
+     *  \param src the image, its alpha is multiplied by alpha / 255
+     *  \param alpha constant alpha
+     *  \param color the colour of an A8 image, the others ignore it
+     *  \param callback called when done, can be nullptr
+     *  \param context passed to the callback
+     *  \return Result::ERR if the queue is full or a format isn't supported
+     */
+    Result Blend(const PixelBuffer&     dst,
+                 uint16_t               x,
+                 uint16_t               y,
+                 const PixelBuffer&     src,
+                 uint8_t                alpha    = 255,
+                 uint32_t               color    = 0xffffff,
+                 EndCallbackFunctionPtr callback = nullptr,
+                 void*                  context  = nullptr);
+
+    /** Returns true while requests are queued or running */
+    bool IsBusy() const;
+
+    /** Returns the number of requests queued, including the running one */
+    size_t GetNumQueued() const;
+
+    /** Waits until all requests are done */
+    void Wait() const;
+
+    /** Returns true if the DMA2D can read images of the format */
+    static bool CanRead(PixelFormat format);
+
+    /** Returns true if the DMA2D can write buffers of the format */
+    static bool CanWrite(PixelFormat format);
+
+    class Impl; /**< & */
+
+  private:
+    Impl* pimpl_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,101 @@
+#include "sys/dma_streams.h"
+#include <cstring>
+
+using namespace daisy;
+
+DmaStreamAllocator::Slot DmaStreamAllocator::slots_[kNumStreams] = {};
+DmaStreamAllocator::Conflict
+       DmaStreamAllocator::conflicts_[kMaxConflicts] = {};
+size_t DmaStreamAllocator::num_conflicts_             = 0;
+
+bool DmaStreamAllocator::SameOwner(const char* a, const char* b)
+{
+    return a == b || (a && b && std::strcmp(a, b) == 0);
+}
+
+void DmaStreamAllocator::AddConflict(Stream      stream,
+                                     uint32_t    request,
+                                     const char* owner,
+                                     const char* holder)
+{
+    if(num_conflicts_ < kMaxConflicts)
+        conflicts_[num_conflicts_] = {stream, request, owner, holder};
+    num_conflicts_++;
+}
+
+bool DmaStreamAllocator::Claim(Stream      stream,
+                               const char* owner,
+                               uint32_t    request)
+{
+    const size_t idx = static_cast<size_t>(stream);
+    if(idx >= kNumStreams || owner == nullptr)
+        return false;
+    Slot& slot = slots_[idx];
+    if(slot.owner && !SameOwner(slot.owner, owner))
+    {
+        AddConflict(stream, request, owner, slot.owner);
+        return false;
+    }
+    if(request != 0)
+    {
+        for(size_t i = 0; i < kNumStreams; i++)
+        {
+            if(i != idx && slots_[i].owner && slots_[i].request == request
+               && !SameOwner(slots_[i].owner, owner))
+            {
+                AddConflict(stream, request, owner, slots_[i].owner);
+                return false;
+            }
+        }
+    }
+    slot.owner   = owner;
+    slot.request = request;
+    return true;
+}
+
+DmaStreamAllocator::Stream DmaStreamAllocator::ClaimFree(uint16_t    candidates,
+                                                         const char* owner,
+                                                         uint32_t    request)
+{
+    if(owner == nullptr)
+        return Stream::NONE;
+    for(size_t i = kNumStreams; i-- > 0;)
+    {
+        if((candidates & (1u << i)) && slots_[i].owner == nullptr)
+        {
+            const Stream stream = static_cast<Stream>(i);
+            return Claim(stream, owner, request) ? stream : Stream::NONE;
+        }
+    }
+    AddConflict(Stream::NONE, request, owner, nullptr);
+    return Stream::NONE;
+}
+
+void DmaStreamAllocator::Release(Stream stream, const char* owner)
+{
+    const size_t idx = static_cast<size_t>(stream);
+    if(idx >= kNumStreams || !SameOwner(slots_[idx].owner, owner))
+        return;
+    slots_[idx].owner   = nullptr;
+    slots_[idx].request = 0;
+}
+
+const char* DmaStreamAllocator::GetOwner(Stream stream)
+{
+    const size_t idx = static_cast<size_t>(stream);
+    return idx < kNumStreams ? slots_[idx].owner : nullptr;
+}
+
+DmaStreamAllocator::Conflict DmaStreamAllocator::GetConflict(size_t idx)
+{
+    if(idx >= num_conflicts_ || idx >= kMaxConflicts)
+        return {Stream::NONE, 0, nullptr, nullptr};
+    return conflicts_[idx];
+}
+
+void DmaStreamAllocator::Reset()
+{
+    for(size_t i = 0; i < kNumStreams; i++)
+        slots_[i] = {nullptr, 0};
+    num_conflicts_ = 0;
+}
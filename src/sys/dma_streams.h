@@ -0,0 +1,139 @@
+#pragma once
+#ifndef DSY_DMA_STREAMS_H
+#define DSY_DMA_STREAMS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Keeps track of which driver uses each DMA stream
+ *  @ingroup system
+ *
+ *  The drivers claim the DMA1 and DMA2 streams they use when they set up
+ *  their transfers, together with the DMAMUX request line. A stream that is
+ *  already claimed by another driver, or a request line that another stream
+ *  serves, is a conflict: the claim fails and the conflict is recorded, so
+ *  that it shows up at startup, e.g. in a print of GetConflict(), rather
+ *  than as transfers that stop or corrupt each other later.
+ *
+ *  Drivers with a choice of streams, e.g. the LedPwmService and the
+ *  GateScheduler with DmaStream::AUTO, ask for any free one with
+ *  ClaimFree(), which leaves the streams of the fixed drivers to them.
+ *
+ *  The first claim of a stream is made from the main loop. Drivers that
+ *  claim it again with each transfer may do that from an interrupt.
+ *
+ *  @code
+ *  if(DmaStreamAllocator::GetNumConflicts() > 0)
+ *  {
+ *      DmaStreamAllocator::Conflict c = DmaStreamAllocator::GetConflict(0);
+ *      hw.PrintLine("%s wants stream %d of %s", c.owner, c.stream, c.holder);
+ *  }
+ *  @endcode
+ */
+class DmaStreamAllocator
+{
+  public:
+    /** The streams of DMA1 and DMA2 */
+    enum class Stream
+    {
+        DMA_1_STREAM_0,
+        DMA_1_STREAM_1,
+        DMA_1_STREAM_2,
+        DMA_1_STREAM_3,
+        DMA_1_STREAM_4,
+        DMA_1_STREAM_5,
+        DMA_1_STREAM_6,
+        DMA_1_STREAM_7,
+        DMA_2_STREAM_0,
+        DMA_2_STREAM_1,
+        DMA_2_STREAM_2,
+        DMA_2_STREAM_3,
+        DMA_2_STREAM_4,
+        DMA_2_STREAM_5,
+        DMA_2_STREAM_6,
+        DMA_2_STREAM_7,
+        NONE,
+    };
+
+    static constexpr size_t kNumStreams = 16;
+
+    /** The most conflicts that are kept, later ones are only counted */
+    static constexpr size_t kMaxConflicts = 4;
+
+    /** A claim that failed */
+    struct Conflict
+    {
+        Stream      stream;  /**< the stream that was asked for */
+        uint32_t    request; /**< the request line that was asked for */
+        const char* owner;   /**< the driver that asked */
+        const char* holder;  /**< the driver that has it */
+    };
+
+    /** Returns the bit of a stream in the candidates of ClaimFree() */
+    static constexpr uint16_t Bit(Stream stream)
+    {
+        return uint16_t(1u << static_cast<size_t>(stream));
+    }
+
+    /** Claims a stream for a driver.
+     *  \param owner name of the driver, the string is not copied. The same
+     *               owner can claim its stream again, e.g. with each
+     *               transfer, or with another request line.
+     *  \param request DMAMUX request line the stream serves, 0 for none, or
+     *                 for one that a driver shares between its streams
+     *  \return false, and the conflict is recorded, if another owner has the
+     *          stream or the request line
+     */
+    static bool Claim(Stream stream, const char* owner, uint32_t request = 0);
+
+    /** Claims the first free stream of the candidates, trying DMA2 stream 7
+     *  first and DMA1 stream 0 last, as the fixed drivers use the lower
+     *  streams.
+     *  \param candidates Bit() of each stream that would be fine
+     *  \return the stream, or NONE, and the conflict is recorded, if all of
+     *          them are claimed, also by the owner itself, which can have
+     *          several streams. Release() it when it's no longer used.
+     */
+    static Stream
+    ClaimFree(uint16_t candidates, const char* owner, uint32_t request = 0);
+
+    /** Gives a stream back, only if owner has it */
+    static void Release(Stream stream, const char* owner);
+
+    /** Returns the owner of a stream, or nullptr if it's free */
+    static const char* GetOwner(Stream stream);
+
+    static bool IsFree(Stream stream) { return GetOwner(stream) == nullptr; }
+
+    /** Returns the number of claims that failed */
+    static size_t GetNumConflicts() { return num_conflicts_; }
+
+    /** Returns one of the first kMaxConflicts conflicts */
+    static Conflict GetConflict(size_t idx);
+
+    /** Frees all streams and clears the conflicts, e.g. for tests */
+    static void Reset();
+
+  private:
+    struct Slot
+    {
+        const char* owner;
+        uint32_t    request;
+    };
+
+    static bool SameOwner(const char* a, const char* b);
+    static void AddConflict(Stream      stream,
+                            uint32_t    request,
+                            const char* owner,
+                            const char* holder);
+
+    static Slot     slots_[kNumStreams];
+    static Conflict conflicts_[kMaxConflicts];
+    static size_t   num_conflicts_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,107 @@
+#include "sys/exti.h"
+#include "stm32h7xx_hal.h"
+#include "sys/irq_priority.h"
+#include "util/IrqProfiler.h"
+#include "util/scopedirqblocker.h"
+
+using namespace daisy;
+
+ExtiLines::Slot ExtiLines::slots_[kNumLines] = {};
+
+static IRQn_Type GetExtiIrq(uint8_t line)
+{
+    if(line <= 4)
+        return IRQn_Type(EXTI0_IRQn + line);
+    else if(line <= 9)
+        return EXTI9_5_IRQn;
+    return EXTI15_10_IRQn;
+}
+
+bool ExtiLines::Register(uint8_t line, Callback callback, void* context)
+{
+    if(line >= kNumLines || callback == nullptr)
+        return false;
+    {
+        ScopedIrqBlocker block;
+        Slot& slot = slots_[line];
+        if(slot.callback != nullptr
+           && (slot.callback != callback || slot.context != context))
+            return false;
+        slot.callback = callback;
+        slot.context  = context;
+    }
+
+    const IRQn_Type irq = GetExtiIrq(line);
+    HAL_NVIC_SetPriority(irq, DSY_IRQ_PRIORITY_GPIO, 0);
+    HAL_NVIC_EnableIRQ(irq);
+    return true;
+}
+
+void ExtiLines::Unregister(uint8_t line)
+{
+    if(line >= kNumLines)
+        return;
+    ScopedIrqBlocker block;
+    slots_[line].callback = nullptr;
+    slots_[line].context  = nullptr;
+}
+
+bool ExtiLines::IsRegistered(uint8_t line)
+{
+    return line < kNumLines && slots_[line].callback != nullptr;
+}
+
+void ExtiLines::Handle(uint8_t first, uint8_t last)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::EXT_LINES);
+    for(uint32_t line = first; line <= last; line++)
+    {
+        const uint32_t mask = 1u << line;
+        if(__HAL_GPIO_EXTI_GET_IT(mask))
+        {
+            __HAL_GPIO_EXTI_CLEAR_IT(mask);
+            const Slot& slot = slots_[line];
+            if(slot.callback != nullptr)
+                slot.callback(slot.context);
+        }
+    }
+}
+
+// ======================================================================
+// EXTI IRQ handlers
+// ======================================================================
+
+extern "C" void EXTI0_IRQHandler(void)
+{
+    ExtiLines::Handle(0, 0);
+}
+
+extern "C" void EXTI1_IRQHandler(void)
+{
+    ExtiLines::Handle(1, 1);
+}
+
+extern "C" void EXTI2_IRQHandler(void)
+{
+    ExtiLines::Handle(2, 2);
+}
+
+extern "C" void EXTI3_IRQHandler(void)
+{
+    ExtiLines::Handle(3, 3);
+}
+
+extern "C" void EXTI4_IRQHandler(void)
+{
+    ExtiLines::Handle(4, 4);
+}
+
+extern "C" void EXTI9_5_IRQHandler(void)
+{
+    ExtiLines::Handle(5, 9);
+}
+
+extern "C" void EXTI15_10_IRQHandler(void)
+{
+    ExtiLines::Handle(10, 15);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef DSY_EXTI_H
+#define DSY_EXTI_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Shares the EXTI interrupts between the drivers and the application
+ *  @ingroup system
+ *
+ *  There is one EXTI line per pin number, and lines 5 to 9 and 10 to 15
+ *  share an IRQ handler each. The handlers are defined here, and call the
+ *  callback registered for each pending line, so GateIn::InitInterrupt()
+ *  and e.g. a button of the application can use lines of the same handler.
+ *
+ *  They are only linked into programs that call Register(), directly or
+ *  through GateIn::InitInterrupt(), a plain GateIn doesn't pull them in.
+ *  Such a program registers its own lines too, instead of defining
+ *  EXTI0_IRQHandler() to EXTI15_10_IRQHandler(), which would be a duplicate
+ *  definition.
+ *
+ *  @code
+ *  // the GPIO is set up as GPIO_MODE_IT_FALLING
+ *  ExtiLines::Register(12, &OnButton, nullptr);
+ *  @endcode
+ */
+class ExtiLines
+{
+  public:
+    static constexpr size_t kNumLines = 16;
+
+    /** Called from the interrupt for an edge of a line */
+    typedef void (*Callback)(void* context);
+
+    /** Sets the callback of a line, and enables its IRQ with
+     *  DSY_IRQ_PRIORITY_GPIO. The GPIO is configured by the caller.
+     *  \param line pin number of the GPIO, 0 to 15
+     *  \return false if another callback and context have the line
+     */
+    static bool Register(uint8_t line, Callback callback, void* context);
+
+    /** Removes the callback of a line, the IRQ stays enabled if it's shared
+     */
+    static void Unregister(uint8_t line);
+
+    /** Returns true if a callback has the line */
+    static bool IsRegistered(uint8_t line);
+
+    /** Calls the callbacks of the pending lines from first to last, and
+     *  clears them. Called by the IRQ handlers.
+     */
+    static void Handle(uint8_t first, uint8_t last);
+
+  private:
+    struct Slot
+    {
+        Callback callback;
+        void*    context;
+    };
+
+    static Slot slots_[kNumLines];
+};
+
+} // namespace daisy
+
+#endif
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "sys/fatfs.h"
 #include "ff_gen_drv.h"
 #include "util/sd_diskio.h"
@@ -6,14 +7,106 @@
 
 using namespace daisy;
 
+namespace
+{
+/** Reads of more sectors than this bypass the cache.
+ *  They're usually streaming audio, that would only evict the metadata. */
+constexpr UINT kMaxCachedRead = 4;
+
+SectorCache* sd_cache = nullptr;
+
+DSTATUS CachedSdInitialize(BYTE lun)
+{
+    // the card might have been changed
+    sd_cache->Clear();
+    return SD_Driver.disk_initialize(lun);
+}
+
+DSTATUS CachedSdStatus(BYTE lun)
+{
+    return SD_Driver.disk_status(lun);
+}
+
+DRESULT CachedSdRead(BYTE lun, BYTE* buff, DWORD sector, UINT count)
+{
+    // the cache is stale as well while the card is owned by someone else
+    if(SD_IsSuspended())
+        return RES_NOTRDY;
+    if(count > kMaxCachedRead)
+        return SD_Driver.disk_read(lun, buff, sector, count);
+
+    UINT i = 0;
+    while(i < count
+          && sd_cache->Read(sector + i, &buff[i * SectorCache::kSectorSize]))
+        i++;
+    if(i == count)
+        return RES_OK;
+
+    // read all of the sectors from the first missing one in one go
+    const DRESULT res = SD_Driver.disk_read(
+        lun, &buff[i * SectorCache::kSectorSize], sector + i, count - i);
+    if(res == RES_OK)
+    {
+        for(; i < count; i++)
+            sd_cache->Insert(sector + i, &buff[i * SectorCache::kSectorSize]);
+    }
+    return res;
+}
+
+#if _USE_WRITE == 1
+DRESULT CachedSdWrite(BYTE lun, const BYTE* buff, DWORD sector, UINT count)
+{
+    const DRESULT res = SD_Driver.disk_write(lun, buff, sector, count);
+    for(UINT i = 0; i < count; i++)
+    {
+        // after a failed write it's unknown what's on the card
+        if(res == RES_OK)
+            sd_cache->Update(sector + i, &buff[i * SectorCache::kSectorSize]);
+        else
+            sd_cache->Invalidate(sector + i);
+    }
+    return res;
+}
+#endif /* _USE_WRITE == 1 */
+
+#if _USE_IOCTL == 1
+DRESULT CachedSdIoctl(BYTE lun, BYTE cmd, void* buff)
+{
+    return SD_Driver.disk_ioctl(lun, cmd, buff);
+}
+#endif /* _USE_IOCTL == 1 */
+
+/** The SD driver with a write-through SectorCache in front */
+const Diskio_drvTypeDef CachedSdDriver = {
+    CachedSdInitialize,
+    CachedSdStatus,
+    CachedSdRead,
+#if _USE_WRITE == 1
+    CachedSdWrite,
+#endif /* _USE_WRITE == 1 */
+#if _USE_IOCTL == 1
+    CachedSdIoctl,
+#endif /* _USE_IOCTL == 1 */
+};
+} // namespace
+
 FatFSInterface::Result FatFSInterface::Init(const FatFSInterface::Config& cfg)
 {
     Result ret = Result::ERR_NO_MEDIA_SELECTED;
     cfg_       = cfg;
+    sd_cache_.Init(cfg_.sd_cache, cfg_.sd_cache_size);
     if(cfg_.media & Config::MEDIA_SD)
-        ret = FATFS_LinkDriver(&SD_Driver, path_[0]) == FR_OK
+    {
+        const Diskio_drvTypeDef* driver = &SD_Driver;
+        if(sd_cache_.IsEnabled())
+        {
+            sd_cache = &sd_cache_;
+            driver   = &CachedSdDriver;
+        }
+        ret = FATFS_LinkDriver(driver, path_[0]) == FR_OK
                   ? Result::OK
                   : Result::ERR_TOO_MANY_VOLUMES;
+    }
     if(cfg_.media & Config::MEDIA_USB)
         ret = FATFS_LinkDriver(&USBH_Driver, path_[1]) == FR_OK
                   ? Result::OK
@@ -46,6 +139,91 @@ FatFSInterface::Result FatFSInterface::DeInit()
     return ret;
 }
 
+FRESULT
+FatFSInterface::ReadContiguous(FIL* fil, void* buff, UINT btr, UINT* br)
+{
+    constexpr UINT kSectorSize = _MAX_SS;
+
+    *br        = 0;
+    FATFS* fs  = fil->obj.fs;
+    BYTE*  out = static_cast<BYTE*>(buff);
+    // f_read() reports the errors, e.g. of a file from before a remount
+    if(fs == nullptr || fil->obj.id != fs->id || fil->err != FR_OK
+       || !(fil->flag & FA_READ))
+        return f_read(fil, buff, btr, br);
+    if(btr > fil->obj.objsize - fil->fptr)
+        btr = UINT(fil->obj.objsize - fil->fptr);
+
+    // exFAT marks files without a FAT chain, their clusters are in one run.
+    // obj.stat is only written on exFAT volumes.
+#if _FS_EXFAT
+    const bool no_chain = fs->fs_type == FS_EXFAT && (fil->obj.stat & 3) == 2;
+#else
+    const bool no_chain = false;
+#endif
+    const FSIZE_t cluster_bytes = FSIZE_t(fs->csize) * kSectorSize;
+    while(btr >= kSectorSize && fil->fptr % kSectorSize == 0
+          && (no_chain || fil->cltbl != nullptr))
+    {
+        // the run of contiguous clusters that fptr is in
+        DWORD index = DWORD(fil->fptr / cluster_bytes);
+        DWORD clst, run;
+        if(no_chain)
+        {
+            clst = fil->obj.sclust + index;
+            run  = DWORD((fil->obj.objsize + cluster_bytes - 1) / cluster_bytes)
+                  - index;
+        }
+        else
+        {
+            // the link map: its size, then (length, first cluster) pairs
+            const DWORD* tbl = fil->cltbl + 1;
+            while(tbl[0] != 0 && index >= tbl[0])
+            {
+                index -= tbl[0];
+                tbl += 2;
+            }
+            if(tbl[0] == 0)
+                break;
+            clst = tbl[1] + index;
+            run  = tbl[0] - index;
+        }
+        if(clst < 2 || clst >= fs->n_fatent)
+            return FR_INT_ERR;
+
+        const UINT  csect = UINT(fil->fptr / kSectorSize) & (fs->csize - 1);
+        const DWORD sect  = fs->database + (clst - 2) * fs->csize + csect;
+        UINT        cc    = btr / kSectorSize;
+        if(cc > run * fs->csize - csect)
+            cc = run * fs->csize - csect;
+        if(disk_read(fs->drv, out, sect, cc) != RES_OK)
+        {
+            fil->err = FR_DISK_ERR;
+            return FR_DISK_ERR;
+        }
+#if !_FS_READONLY && !_FS_TINY
+        // fil->buf holds fil->sect, and is newer if it was written since.
+        // It is copied clean or dirty, as whether it's dirty is private to
+        // ff.c (FA_DIRTY), a clean copy is the same as what was read.
+        if(fil->sect - sect < cc)
+            memcpy(out + (fil->sect - sect) * kSectorSize,
+                   fil->buf,
+                   kSectorSize);
+#endif
+        // f_read() goes on from the cluster of the last byte read
+        fil->clust = clst + (csect + cc - 1) / fs->csize;
+        out += cc * kSectorSize;
+        fil->fptr += cc * kSectorSize;
+        *br += cc * kSectorSize;
+        btr -= cc * kSectorSize;
+    }
+
+    UINT          rest = 0;
+    const FRESULT res  = btr > 0 ? f_read(fil, out, btr, &rest) : FR_OK;
+    *br += rest;
+    return res;
+}
+
 extern "C"
 {
     DWORD get_fattime(void) { return 0; }
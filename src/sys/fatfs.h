@@ -2,6 +2,7 @@
 #define __fatfs_H /**< & */
 
 #include "ff.h"
+#include "util/SectorCache.h"
 
 namespace daisy
 {
@@ -59,6 +60,14 @@ class FatFSInterface
         };
 
         uint8_t media;
+
+        /** Optional memory for a write-through cache of SD card sectors,
+         *  e.g. in SDRAM. Reads of up to 4 sectors, i.e. FAT, directory
+         *  and small file reads, are served from the cache when possible.
+         *  nullptr for no cache.
+         */
+        void*  sd_cache      = nullptr;
+        size_t sd_cache_size = 0; /**< size of sd_cache in bytes */
     };
 
     FatFSInterface() {}
@@ -95,8 +104,24 @@ class FatFSInterface
     /** Returns reference to filesystem object for the USB volume. */
     FATFS& GetUSBFileSystem() { return fs_[1]; }
 
+    /** Returns the SD card sector cache, e.g. for its hit and miss counts */
+    SectorCache& GetSDCache() { return sd_cache_; }
+
+    /** Reads like f_read(), for streaming long files. f_read() reads whole
+     *  sectors straight into buff, but only up to the end of a cluster,
+     *  and looks up the next one in the FAT. This reads all of the whole
+     *  sectors that follow each other on the card in one disk_read(): up
+     *  to the end of a fragment of the file's cluster link map, see
+     *  f_lseek() with CREATE_LINKMAP, or of the file, for an exFAT file
+     *  that is stored in one piece. With the small clusters of FAT32 cards
+     *  that saves many short transfers. Without a link map, or from an
+     *  offset within a sector, it falls back to f_read().
+     */
+    static FRESULT ReadContiguous(FIL* fil, void* buff, UINT btr, UINT* br);
+
   private:
-    Config cfg_;
+    Config      cfg_;
+    SectorCache sd_cache_;
     FATFS  fs_[_VOLUMES];
     char   path_[_VOLUMES][4];
     bool   initialized_;
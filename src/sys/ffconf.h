@@ -68,10 +68,10 @@
     1 /**< This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 #define _USE_EXPAND \
-    0 /**< This option switches f_expand function. (0:Disable or 1:Enable) */
+    1 /**< This option switches f_expand function. (0:Disable or 1:Enable) */
 
 #define _USE_CHMOD \
-    0 /**< This option switches attribute manipulation functions, f_chmod() and f_utime().
+    1 /**< This option switches attribute manipulation functions, f_chmod() and f_utime().
 /  (0:Disable or 1:Enable) Also _FS_READONLY needs to be 0 to enable this option. */
 
 #define _USE_LABEL \
@@ -222,8 +222,17 @@ This option switches support of multi-partition on a physical drive.
 /  Instead of private sector buffer eliminated from the file object, common sector
 /  buffer in the file system object (FATFS) is used for the file data transfer. */
 
+/** exFAT, for cards over 32GB as they're formatted, is enabled by building
+ *  both libDaisy and the program with USE_EXFAT = 1 (DSY_FATFS_EXFAT). It
+ *  changes the FIL and FATFS objects, so the two have to agree. File sizes
+ *  and offsets (FSIZE_t) are 64 bit then.
+ */
+#ifndef DSY_FATFS_EXFAT
+#define DSY_FATFS_EXFAT 0
+#endif
+
 #define _FS_EXFAT \
-    0 /**< This option switches support of exFAT file system. (0:Disable or 1:Enable)
+    DSY_FATFS_EXFAT /**< This option switches support of exFAT file system. (0:Disable or 1:Enable)
 /  When enable exFAT, also LFN needs to be enabled. (_USE_LFN >= 1)
 /  Note that enabling exFAT discards C89 compatibility. */
 
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef DSY_IRQ_PRIORITY_H
+#define DSY_IRQ_PRIORITY_H
+
+/** @brief Interrupt priorities used by the library
+ *  @ingroup system
+ *
+ *  All calls to HAL_NVIC_SetPriority() take their preemption priority from
+ *  here, so the order of the interrupts is decided in one place. Lower
+ *  values are more urgent, 0 is the highest of the 16 levels.
+ *
+ *  The DMA streams of the SAI have the highest priority of all. Nothing
+ *  else can delay the exchange of the audio buffers, and the other
+ *  interrupts can be masked with a ScopedIrqPriorityBlocker without
+ *  adding jitter to the audio.
+ *
+ *  Each value can be overridden with a define, e.g. in the Makefile.
+ *  The SysTick uses TICK_INT_PRIORITY from stm32h7xx_hal_conf.h.
+ */
+
+/** Number of priority bits of the STM32H7 NVIC */
+#define DSY_IRQ_PRIORITY_BITS 4
+
+/** Lowest priority, the largest value */
+#define DSY_IRQ_PRIORITY_LOWEST ((1 << DSY_IRQ_PRIORITY_BITS) - 1)
+
+/** DMA streams of SAI1 and SAI2, the audio callback in the non-deferred
+ *  mode runs here */
+#ifndef DSY_IRQ_PRIORITY_AUDIO_DMA
+#define DSY_IRQ_PRIORITY_AUDIO_DMA 0
+#endif
+
+/** PVD interrupt of the PowerMonitor, that warns of a power loss. The
+ *  callback has a few milliseconds at best, it shouldn't wait. */
+#ifndef DSY_IRQ_PRIORITY_POWER_FAIL
+#define DSY_IRQ_PRIORITY_POWER_FAIL 0
+#endif
+
+/** GPIO edge interrupts of GateIn::InitInterrupt(). Right below the audio,
+ *  the handler only stores a timestamp, which should be exact. */
+#ifndef DSY_IRQ_PRIORITY_GPIO
+#define DSY_IRQ_PRIORITY_GPIO 1
+#endif
+
+/** The other DMA streams: UART, SPI, I2C, DAC */
+#ifndef DSY_IRQ_PRIORITY_DMA
+#define DSY_IRQ_PRIORITY_DMA 1
+#endif
+
+/** UART, SPI, I2C, QSPI, DAC and SDMMC */
+#ifndef DSY_IRQ_PRIORITY_PERIPHERAL
+#define DSY_IRQ_PRIORITY_PERIPHERAL 1
+#endif
+
+/** USB device and host */
+#ifndef DSY_IRQ_PRIORITY_USB
+#define DSY_IRQ_PRIORITY_USB 1
+#endif
+
+/** MDMA, below the peripherals, its callbacks are the application's */
+#ifndef DSY_IRQ_PRIORITY_MDMA
+#define DSY_IRQ_PRIORITY_MDMA 2
+#endif
+
+/** DMA2D, like the MDMA its callbacks are the application's */
+#ifndef DSY_IRQ_PRIORITY_DMA2D
+#define DSY_IRQ_PRIORITY_DMA2D 2
+#endif
+
+/** TIM2 to TIM5 update interrupts */
+#ifndef DSY_IRQ_PRIORITY_TIMER
+#define DSY_IRQ_PRIORITY_TIMER DSY_IRQ_PRIORITY_LOWEST
+#endif
+
+/** RNG interrupt that fills the pool of Random::StartPool() */
+#ifndef DSY_IRQ_PRIORITY_RNG
+#define DSY_IRQ_PRIORITY_RNG DSY_IRQ_PRIORITY_LOWEST
+#endif
+
+/** PendSV, the audio callback in the deferred mode. Lowest, so a long
+ *  callback can be preempted by the interrupts that feed it. */
+#ifndef DSY_IRQ_PRIORITY_AUDIO_CALLBACK
+#define DSY_IRQ_PRIORITY_AUDIO_CALLBACK DSY_IRQ_PRIORITY_LOWEST
+#endif
+
+#endif
@@ -0,0 +1,306 @@
+#include "stm32h7xx_hal.h"
+#include "sys/mdma.h"
+#include "sys/dma.h"
+#include "sys/irq_priority.h"
+#include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
+
+namespace daisy
+{
+namespace
+{
+/** Largest block of one transfer, and most blocks per transfer */
+constexpr size_t kMaxBlockSize  = 65536;
+constexpr size_t kMaxBlockCount = 4096;
+
+/** Above the size of the data cache, the whole cache is maintained */
+constexpr size_t kCacheSize = 16 * 1024;
+
+void CleanCache(const void* buffer, size_t size)
+{
+    if(size > kCacheSize)
+        SCB_CleanDCache();
+    else
+        dsy_dma_clear_cache_for_buffer((uint8_t*)buffer, size);
+}
+
+void InvalidateCache(void* buffer, size_t size)
+{
+    // this is after the transfer, dirty lines elsewhere have to be kept
+    if(size > kCacheSize)
+        SCB_CleanInvalidateDCache();
+    else
+        dsy_dma_invalidate_cache_for_buffer((uint8_t*)buffer, size);
+}
+} // namespace
+
+class MdmaHandle::Impl
+{
+  public:
+    struct Request
+    {
+        uint8_t*               dst;
+        const uint8_t*         src; // nullptr for a fill
+        size_t                 size;
+        uint8_t                value;
+        EndCallbackFunctionPtr callback;
+        void*                  context;
+    };
+
+    Result Init();
+    Result Queue(const Request& request);
+    void   StartTransfer();
+    void   TransferDone(bool ok);
+
+    size_t GetNumQueued() const { return num_queued_; }
+
+    MDMA_HandleTypeDef hmdma_;
+
+  private:
+    Request         queue_[DSY_MDMA_QUEUE_SIZE];
+    size_t          head_;
+    volatile size_t num_queued_;
+    size_t          done_;     // bytes of the running request
+    size_t          transfer_; // bytes of the running transfer
+    bool            initialized_;
+    uint64_t        pattern_; // source of a fill
+};
+
+// ================================================================
+// Global reference for the MdmaHandle::Impl, the MDMA is shared
+// ================================================================
+
+static MdmaHandle::Impl mdma_impl;
+
+static void OnTransferComplete(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+    mdma_impl.TransferDone(true);
+}
+
+static void OnTransferError(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+    mdma_impl.TransferDone(false);
+}
+
+MdmaHandle::Result MdmaHandle::Impl::Init()
+{
+    if(initialized_)
+        return Result::OK;
+    head_       = 0;
+    num_queued_ = 0;
+    __HAL_RCC_MDMA_CLK_ENABLE();
+    // below the audio, the callbacks are the application's
+    HAL_NVIC_SetPriority(MDMA_IRQn, DSY_IRQ_PRIORITY_MDMA, 0);
+    HAL_NVIC_EnableIRQ(MDMA_IRQn);
+    hmdma_.Instance = MDMA_Channel0;
+    initialized_    = true;
+    return Result::OK;
+}
+
+MdmaHandle::Result MdmaHandle::Impl::Queue(const Request& request)
+{
+    if(!initialized_ || request.dst == nullptr)
+        return Result::ERR;
+    if(request.size == 0)
+    {
+        if(request.callback)
+            request.callback(request.context, Result::OK);
+        return Result::OK;
+    }
+
+    // what the CPU wrote has to be in memory for the MDMA, and no dirty
+    // lines may be evicted over the destination during the transfer
+    if(request.src != nullptr)
+        CleanCache(request.src, request.size);
+    CleanCache(request.dst, request.size);
+
+    ScopedIrqBlocker irq_blocker;
+    if(num_queued_ >= DSY_MDMA_QUEUE_SIZE)
+        return Result::ERR;
+    queue_[(head_ + num_queued_) % DSY_MDMA_QUEUE_SIZE] = request;
+    num_queued_ = num_queued_ + 1;
+    if(num_queued_ == 1)
+    {
+        done_ = 0;
+        StartTransfer();
+    }
+    return Result::OK;
+}
+
+void MdmaHandle::Impl::StartTransfer()
+{
+    const Request& req  = queue_[head_];
+    uint8_t* const dst  = req.dst + done_;
+    const uint8_t* src  = req.src != nullptr ? req.src + done_ : nullptr;
+    const size_t   left = req.size - done_;
+
+    // the widest access all addresses and the size are aligned to
+    const uintptr_t bits  = (uintptr_t)dst | (uintptr_t)src | left;
+    const size_t    width = (bits & 7) == 0   ? 8
+                            : (bits & 3) == 0 ? 4
+                            : (bits & 1) == 0 ? 2
+                                              : 1;
+
+    if(src == nullptr)
+    {
+        pattern_ = req.value * 0x0101010101010101ull;
+        CleanCache(&pattern_, sizeof(pattern_));
+        src = reinterpret_cast<const uint8_t*>(&pattern_);
+    }
+
+    // Repeated blocks for the large transfers, the rest is transferred
+    // after them
+    uint32_t block, count;
+    if(left <= kMaxBlockSize)
+    {
+        block = left;
+        count = 1;
+    }
+    else
+    {
+        block = kMaxBlockSize;
+        count = left / kMaxBlockSize;
+        if(count > kMaxBlockCount)
+            count = kMaxBlockCount;
+    }
+    transfer_ = size_t(block) * count;
+
+    MDMA_InitTypeDef& init        = hmdma_.Init;
+    init.Request                  = MDMA_REQUEST_SW;
+    init.TransferTriggerMode      = MDMA_FULL_TRANSFER;
+    init.Priority                 = MDMA_PRIORITY_MEDIUM;
+    init.Endianness               = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+    init.DataAlignment            = MDMA_DATAALIGN_PACKENABLE;
+    init.BufferTransferLength     = 128;
+    init.SourceBurst              = MDMA_SOURCE_BURST_SINGLE;
+    init.DestBurst                = MDMA_DEST_BURST_SINGLE;
+    init.SourceBlockAddressOffset = 0;
+    init.DestBlockAddressOffset   = 0;
+    switch(width)
+    {
+        case 8:
+            init.SourceInc      = MDMA_SRC_INC_DOUBLEWORD;
+            init.DestinationInc = MDMA_DEST_INC_DOUBLEWORD;
+            init.SourceDataSize = MDMA_SRC_DATASIZE_DOUBLEWORD;
+            init.DestDataSize   = MDMA_DEST_DATASIZE_DOUBLEWORD;
+            break;
+        case 4:
+            init.SourceInc      = MDMA_SRC_INC_WORD;
+            init.DestinationInc = MDMA_DEST_INC_WORD;
+            init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+            init.DestDataSize   = MDMA_DEST_DATASIZE_WORD;
+            break;
+        case 2:
+            init.SourceInc      = MDMA_SRC_INC_HALFWORD;
+            init.DestinationInc = MDMA_DEST_INC_HALFWORD;
+            init.SourceDataSize = MDMA_SRC_DATASIZE_HALFWORD;
+            init.DestDataSize   = MDMA_DEST_DATASIZE_HALFWORD;
+            break;
+        default:
+            init.SourceInc      = MDMA_SRC_INC_BYTE;
+            init.DestinationInc = MDMA_DEST_INC_BYTE;
+            init.SourceDataSize = MDMA_SRC_DATASIZE_BYTE;
+            init.DestDataSize   = MDMA_DEST_DATASIZE_BYTE;
+            break;
+    }
+    if(req.src == nullptr)
+        init.SourceInc = MDMA_SRC_INC_DISABLE;
+
+    if(HAL_MDMA_Init(&hmdma_) != HAL_OK)
+    {
+        TransferDone(false);
+        return;
+    }
+    hmdma_.XferCpltCallback  = OnTransferComplete;
+    hmdma_.XferErrorCallback = OnTransferError;
+    if(HAL_MDMA_Start_IT(&hmdma_, (uint32_t)src, (uint32_t)dst, block, count)
+       != HAL_OK)
+        TransferDone(false);
+}
+
+void MdmaHandle::Impl::TransferDone(bool ok)
+{
+    const Request req = queue_[head_];
+    done_ += transfer_;
+    if(ok && done_ < req.size)
+    {
+        StartTransfer();
+        return;
+    }
+
+    InvalidateCache(req.dst, req.size);
+    head_       = (head_ + 1) % DSY_MDMA_QUEUE_SIZE;
+    num_queued_ = num_queued_ - 1;
+    done_       = 0;
+    if(num_queued_ > 0)
+        StartTransfer();
+    if(req.callback)
+        req.callback(req.context, ok ? Result::OK : Result::ERR);
+}
+
+// ======================================================================
+// MdmaHandle > MdmaHandle::Impl
+// ======================================================================
+
+MdmaHandle::Result MdmaHandle::Init()
+{
+    pimpl_ = &mdma_impl;
+    return pimpl_->Init();
+}
+
+MdmaHandle::Result MdmaHandle::Copy(void*                  dst,
+                                    const void*            src,
+                                    size_t                 size,
+                                    EndCallbackFunctionPtr callback,
+                                    void*                  context)
+{
+    if(pimpl_ == nullptr || src == nullptr)
+        return Result::ERR;
+    return pimpl_->Queue({static_cast<uint8_t*>(dst),
+                          static_cast<const uint8_t*>(src),
+                          size,
+                          0,
+                          callback,
+                          context});
+}
+
+MdmaHandle::Result MdmaHandle::Fill(void*                  dst,
+                                    uint8_t                value,
+                                    size_t                 size,
+                                    EndCallbackFunctionPtr callback,
+                                    void*                  context)
+{
+    if(pimpl_ == nullptr)
+        return Result::ERR;
+    return pimpl_->Queue(
+        {static_cast<uint8_t*>(dst), nullptr, size, value, callback, context});
+}
+
+bool MdmaHandle::IsBusy() const
+{
+    return GetNumQueued() > 0;
+}
+
+size_t MdmaHandle::GetNumQueued() const
+{
+    return pimpl_ != nullptr ? pimpl_->GetNumQueued() : 0;
+}
+
+void MdmaHandle::Wait() const
+{
+    while(IsBusy()) {}
+}
+
+} // namespace daisy
+
+/** The MDMA channel of QSPIHandle::StartRead(), defined in qspi.cpp */
+extern "C" __attribute__((weak)) void dsy_qspi_mdma_irq_handler(void) {}
+
+extern "C" void MDMA_IRQHandler(void)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::MASTER_DMA);
+    HAL_MDMA_IRQHandler(&daisy::mdma_impl.hmdma_);
+    dsy_qspi_mdma_irq_handler();
+}
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef DSY_MDMA_H
+#define DSY_MDMA_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** Number of copies and fills that can wait for the MDMA */
+#ifndef DSY_MDMA_QUEUE_SIZE
+#define DSY_MDMA_QUEUE_SIZE 8
+#endif
+
+namespace daisy
+{
+/** @brief Asynchronous memory copy and fill with the MDMA controller
+ *  @ingroup system
+ *
+ *  Moves buffers between SDRAM, AXI SRAM, the D2/D3 SRAMs and the DTCM in
+ *  the background, e.g. wavetable swaps, sample loads or display buffers,
+ *  while the CPU does something else. Requests are queued, and run one
+ *  after the other.
+ *
+ *  The data cache is taken care of: the source is cleaned when a request
+ *  is queued, and the destination is invalidated before the callback.
+ *  The source shouldn't be changed, and the destination not be touched,
+ *  until the request is done. Cache lines are 32 bytes, a destination that
+ *  doesn't start and end on a line shares its first and last line with
+ *  other data, which mustn't be written during the transfer either.
+ *
+ *  The widest bus access the alignment of the addresses and the size
+ *  allows is used, 8 byte aligned buffers are the fastest.
+ *
+ *  Callbacks are called from the MDMA interrupt, and may queue further
+ *  requests.
+ *
+ *  @code
+ *  MdmaHandle mdma;
+ *  mdma.Init();
+ *  mdma.Copy(table_in_sram, table_in_sdram, sizeof(table_in_sram));
+ *  // ...
+ *  mdma.Wait();
+ *  @endcode
+ */
+class MdmaHandle
+{
+  public:
+    /** Return values */
+    enum class Result
+    {
+        OK,  /**< & */
+        ERR, /**< & */
+    };
+
+    /** A callback to be executed when a request is done */
+    typedef void (*EndCallbackFunctionPtr)(void* context, Result result);
+
+    MdmaHandle() : pimpl_(nullptr) {}
+    MdmaHandle(const MdmaHandle& other) = default;
+    MdmaHandle& operator=(const MdmaHandle& other) = default;
+
+    /** Enables the MDMA and its interrupt. All handles share one queue. */
+    Result Init();
+
+    /** Queues a copy, like memcpy
+     *  \param dst destination
+     *  \param src source, the areas must not overlap
+     *  \param size size in bytes
+     *  \param callback called when done, can be nullptr
+     *  \param context passed to the callback
+     *  \return Result::ERR if the queue is full
+     */
+    Result Copy(void*                  dst,
+                const void*            src,
+                size_t                 size,
+                EndCallbackFunctionPtr callback = nullptr,
+                void*                  context  = nullptr);
+
+    /** Queues a fill, like memset
+     *  \param dst destination
+     *  \param value value of every byte
+     *  \param size size in bytes
+     *  \param callback called when done, can be nullptr
+     *  \param context passed to the callback
+     *  \return Result::ERR if the queue is full
+     */
+    Result Fill(void*                  dst,
+                uint8_t                value,
+                size_t                 size,
+                EndCallbackFunctionPtr callback = nullptr,
+                void*                  context  = nullptr);
+
+    /** Returns true while requests are queued or running */
+    bool IsBusy() const;
+
+    /** Returns the number of requests queued, including the running one */
+    size_t GetNumQueued() const;
+
+    /** Waits until all requests are done */
+    void Wait() const;
+
+    class Impl; /**< & */
+
+  private:
+    Impl* pimpl_;
+};
+
+} // namespace daisy
+
+#endif
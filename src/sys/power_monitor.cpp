@@ -0,0 +1,57 @@
+#include "sys/power_monitor.h"
+#include "sys/irq_priority.h"
+#include "util/hal_map.h"
+
+using namespace daisy;
+
+static PowerMonitor::PowerFailCallback power_fail_callback = nullptr;
+static void*                           power_fail_context  = nullptr;
+
+void PowerMonitor::Init(PowerFailCallback callback,
+                        void*             context,
+                        Threshold         threshold)
+{
+    static constexpr uint32_t levels[] = {PWR_PVDLEVEL_0,
+                                          PWR_PVDLEVEL_1,
+                                          PWR_PVDLEVEL_2,
+                                          PWR_PVDLEVEL_3,
+                                          PWR_PVDLEVEL_4,
+                                          PWR_PVDLEVEL_5,
+                                          PWR_PVDLEVEL_6};
+
+    power_fail_callback = callback;
+    power_fail_context  = context;
+
+    // the PVD output rises when the supply falls below the level
+    PWR_PVDTypeDef config;
+    config.PVDLevel = levels[int(threshold)];
+    config.Mode     = PWR_PVD_MODE_IT_RISING;
+    HAL_PWR_ConfigPVD(&config);
+    HAL_PWR_EnablePVD();
+
+    HAL_NVIC_SetPriority(PVD_AVD_IRQn, DSY_IRQ_PRIORITY_POWER_FAIL, 0);
+    HAL_NVIC_EnableIRQ(PVD_AVD_IRQn);
+}
+
+void PowerMonitor::DeInit()
+{
+    HAL_NVIC_DisableIRQ(PVD_AVD_IRQn);
+    HAL_PWR_DisablePVD();
+    power_fail_callback = nullptr;
+}
+
+bool PowerMonitor::IsPowerLow()
+{
+    return (PWR->CSR1 & PWR_CSR1_PVDO) != 0;
+}
+
+extern "C" void HAL_PWR_PVDCallback(void)
+{
+    if(power_fail_callback != nullptr)
+        power_fail_callback(power_fail_context);
+}
+
+extern "C" void PVD_AVD_IRQHandler(void)
+{
+    HAL_PWR_PVD_IRQHandler();
+}
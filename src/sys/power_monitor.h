@@ -0,0 +1,56 @@
+#pragma once
+#ifndef DSY_POWER_MONITOR_H
+#define DSY_POWER_MONITOR_H
+
+namespace daisy
+{
+/** @brief Early warning of a power loss, from the programmable voltage
+ *  detector (PVD)
+ *  @ingroup system
+ *
+ *  Calls a function from an interrupt when the supply falls below a
+ *  threshold, while there's still time to save a BackupSnapshot of the
+ *  state or stop writing to a flash. How long that is depends on the
+ *  capacitance of the supply, usually a few milliseconds. The threshold
+ *  is on VDD, which is 3.3V on the Daisy boards.
+ *
+ *  The interrupt has the highest priority, DSY_IRQ_PRIORITY_POWER_FAIL,
+ *  so the callback runs even when the audio takes all of the time.
+ */
+class PowerMonitor
+{
+  public:
+    /** Called when the supply falls below the threshold */
+    typedef void (*PowerFailCallback)(void* context);
+
+    /** Supply voltage that triggers the callback */
+    enum class Threshold
+    {
+        V1_95, /**< 1.95V */
+        V2_10, /**< 2.1V */
+        V2_25, /**< 2.25V */
+        V2_40, /**< 2.4V */
+        V2_55, /**< 2.55V */
+        V2_70, /**< 2.7V */
+        V2_85, /**< 2.85V, the earliest warning */
+    };
+
+    /** Starts watching the supply
+     *  \param callback function to call, from the interrupt
+     *  \param context passed to the callback
+     *  \param threshold supply voltage to call it at
+     */
+    static void Init(PowerFailCallback callback,
+                     void*             context,
+                     Threshold         threshold = Threshold::V2_85);
+
+    /** Stops watching the supply */
+    static void DeInit();
+
+    /** Returns true while the supply is below the threshold */
+    static bool IsPowerLow();
+};
+
+} // namespace daisy
+
+#endif
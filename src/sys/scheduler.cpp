@@ -0,0 +1,150 @@
+#include "sys/scheduler.h"
+#include "sys/system.h"
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+constexpr Scheduler::TaskId Scheduler::kInvalidTask;
+
+void Scheduler::Init()
+{
+    num_tasks_ = 0;
+    current_   = kInvalidTask;
+}
+
+Scheduler::TaskId Scheduler::AddTask(const TaskConfig& config)
+{
+    if(num_tasks_ >= DSY_SCHEDULER_MAX_TASKS || config.function == nullptr)
+        return kInvalidTask;
+    Task& task      = tasks_[num_tasks_];
+    task.config     = config;
+    task.stats      = {};
+    task.release_us = System::GetUs64();
+    task.trigger_us = 0;
+    task.enabled    = true;
+    task.triggered  = false;
+    return TaskId(num_tasks_++);
+}
+
+void Scheduler::SetEnabled(TaskId id, bool enabled)
+{
+    if(id < 0 || size_t(id) >= num_tasks_)
+        return;
+    Task& task = tasks_[id];
+    if(enabled && !task.enabled)
+        task.release_us = System::GetUs64();
+    task.enabled = enabled;
+}
+
+void Scheduler::Trigger(TaskId id)
+{
+    if(id < 0 || size_t(id) >= num_tasks_)
+        return;
+    ScopedIrqBlocker block;
+    if(tasks_[id].triggered)
+        return;
+    tasks_[id].trigger_us = System::GetUs64();
+    tasks_[id].triggered  = true;
+}
+
+bool Scheduler::IsDue(const Task& task, uint64_t now) const
+{
+    if(!task.enabled)
+        return false;
+    return task.triggered
+           || (task.config.period_us > 0 && now >= task.release_us);
+}
+
+uint64_t Scheduler::GetDeadline(const Task& task) const
+{
+    // periodic tasks are due by the end of their period, triggered ones
+    // within their budget
+    if(task.triggered)
+        return task.trigger_us + task.config.budget_us;
+    return task.release_us + task.config.period_us;
+}
+
+bool Scheduler::Process()
+{
+    const uint64_t now  = System::GetUs64();
+    TaskId         next = kInvalidTask;
+    for(size_t i = 0; i < num_tasks_; i++)
+    {
+        const Task& task = tasks_[i];
+        if(!IsDue(task, now))
+            continue;
+        if(next == kInvalidTask
+           || task.config.priority > tasks_[next].config.priority
+           || (task.config.priority == tasks_[next].config.priority
+               && GetDeadline(task) < GetDeadline(tasks_[next])))
+            next = TaskId(i);
+    }
+    if(next == kInvalidTask)
+        return false;
+
+    Task&    task = tasks_[next];
+    uint64_t late;
+    if(task.triggered)
+    {
+        // cleared before the run, so a Trigger() during it isn't lost, and
+        // after the time is read, so it's the time of this trigger
+        uint64_t trigger_us;
+        {
+            ScopedIrqBlocker block;
+            trigger_us     = task.trigger_us;
+            task.triggered = false;
+        }
+        late = now > trigger_us ? now - trigger_us : 0;
+    }
+    else
+    {
+        // fixed rate, unless whole periods were missed
+        const uint32_t period = task.config.period_us;
+        const uint64_t missed = (now - task.release_us) / period;
+        late                  = now - task.release_us;
+        task.release_us       = task.release_us + (missed + 1) * period;
+        task.stats.misses += uint32_t(missed);
+    }
+    if(late > task.stats.max_late_us)
+        task.stats.max_late_us = uint32_t(late);
+
+    current_          = next;
+    current_start_us_ = now;
+    task.config.function(task.config.context);
+    current_ = kInvalidTask;
+
+    const uint32_t took = uint32_t(System::GetUs64() - now);
+    task.stats.runs++;
+    task.stats.total_us += took;
+    if(took > task.stats.max_us)
+        task.stats.max_us = took;
+    if(task.config.budget_us > 0 && took > task.config.budget_us)
+        task.stats.overruns++;
+    return true;
+}
+
+bool Scheduler::ShouldYield() const
+{
+    if(current_ == kInvalidTask)
+        return false;
+    const Task&    task = tasks_[current_];
+    const uint64_t now  = System::GetUs64();
+    if(task.config.budget_us > 0
+       && now - current_start_us_ >= task.config.budget_us)
+        return true;
+    for(size_t i = 0; i < num_tasks_; i++)
+    {
+        if(tasks_[i].config.priority > task.config.priority
+           && IsDue(tasks_[i], now))
+            return true;
+    }
+    return false;
+}
+
+void Scheduler::ResetStats()
+{
+    for(size_t i = 0; i < num_tasks_; i++)
+        tasks_[i].stats = {};
+}
+
+} // namespace daisy
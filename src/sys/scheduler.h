@@ -0,0 +1,183 @@
+#pragma once
+#ifndef DSY_SCHEDULER_H
+#define DSY_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** Number of tasks a Scheduler can hold */
+#ifndef DSY_SCHEDULER_MAX_TASKS
+#define DSY_SCHEDULER_MAX_TASKS 16
+#endif
+
+namespace daisy
+{
+/** @brief Cooperative scheduler for the tasks of the main loop
+ *  @ingroup system
+ *
+ *  Replaces a `while(1)` that calls everything in a fixed order. Each task
+ *  has a period, a priority and a time budget. Process() runs one task
+ *  per call: of the tasks that are due, the one with the highest priority,
+ *  and of those the one with the earliest deadline (the end of its
+ *  period). Since the choice is made again after every task, an urgent
+ *  task waits for one slow task at most, and never for all of them.
+ *
+ *  Tasks run to completion. A task with a lot of work, e.g. an SD card
+ *  transfer, can do it in pieces and return when ShouldYield() says its
+ *  budget is used up, or a more important task is waiting.
+ *
+ *  Tasks with a period of 0 only run after Trigger(), which can be called
+ *  from interrupts, e.g. when a streaming buffer needs to be refilled.
+ *
+ *  For every task the runs, the longest run, the runs that took longer
+ *  than the budget and the periods that were missed are counted.
+ *
+ *  @code
+ *  Scheduler sched;
+ *  sched.Init();
+ *  sched.AddTask({"refill", Refill, nullptr, 0, 3, 500});
+ *  sched.AddTask({"controls", Controls, nullptr, 1000, 2, 100});
+ *  sched.AddTask({"display", Display, nullptr, 33000, 1, 5000});
+ *  while(1)
+ *      sched.Process();
+ *  @endcode
+ */
+class Scheduler
+{
+  public:
+    /** A task, called from Process() */
+    typedef void (*TaskFunction)(void* context);
+
+    /** Index of a task, as returned by AddTask() */
+    typedef int TaskId;
+
+    /** Returned by AddTask() when the table is full */
+    static constexpr TaskId kInvalidTask = -1;
+
+    /** Settings of a task */
+    struct TaskConfig
+    {
+        /** name for Print(), the string is not copied */
+        const char* name;
+
+        TaskFunction function;
+        void*        context;
+
+        /** time between the starts of two runs, 0 to only run on Trigger() */
+        uint32_t period_us;
+
+        /** higher values run first */
+        uint8_t priority;
+
+        /** time a run is expected to take at most, 0 for no limit */
+        uint32_t budget_us;
+    };
+
+    /** Measurements of a task */
+    struct TaskStats
+    {
+        uint32_t runs;        /**< number of runs */
+        uint32_t overruns;    /**< runs that took longer than the budget */
+        uint32_t misses;      /**< periods that passed without a run */
+        uint32_t max_us;      /**< longest run */
+        uint32_t max_late_us; /**< longest wait of a due task */
+        uint64_t total_us;    /**< sum of all runs */
+    };
+
+    Scheduler() : num_tasks_(0), current_(kInvalidTask) {}
+
+    /** Removes all tasks */
+    void Init();
+
+    /** Adds a task. Periodic tasks are due right away.
+     *  \return the id of the task, or kInvalidTask if the table is full
+     *          or there's no function
+     */
+    TaskId AddTask(const TaskConfig& config);
+
+    /** Enables or disables a task. An enabled periodic task is due right
+     *  away, tasks are enabled when they're added.
+     */
+    void SetEnabled(TaskId id, bool enabled);
+
+    /** Makes a task due, it is run by the next Process() call that has
+     *  nothing more urgent. Can be called from interrupts.
+     */
+    void Trigger(TaskId id);
+
+    /** Runs the most urgent task that's due.
+     *  \return true if a task was run
+     */
+    bool Process();
+
+    /** Returns true when the running task should return from its
+     *  function: it's over its budget, or a task with a higher priority is
+     *  due. Always false outside of a task.
+     */
+    bool ShouldYield() const;
+
+    /** Returns the number of tasks */
+    size_t GetNumTasks() const { return num_tasks_; }
+
+    /** Returns the settings of a task */
+    const TaskConfig& GetConfig(TaskId id) const { return tasks_[id].config; }
+
+    /** Returns the measurements of a task */
+    const TaskStats& GetStats(TaskId id) const { return tasks_[id].stats; }
+
+    /** Clears the measurements of all tasks */
+    void ResetStats();
+
+    /** Prints the measurements of all tasks
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    void Print() const
+    {
+        LoggerType::PrintLine("%-16s %8s %8s %8s %8s %8s %8s",
+                              "task",
+                              "period",
+                              "runs",
+                              "avg us",
+                              "max us",
+                              "overrun",
+                              "missed");
+        for(size_t i = 0; i < num_tasks_; i++)
+        {
+            const TaskStats& s = tasks_[i].stats;
+            const uint32_t   avg
+                = s.runs > 0 ? uint32_t(s.total_us / s.runs) : 0;
+            LoggerType::PrintLine("%-16s %8lu %8lu %8lu %8lu %8lu %8lu",
+                                  tasks_[i].config.name,
+                                  (unsigned long)tasks_[i].config.period_us,
+                                  (unsigned long)s.runs,
+                                  (unsigned long)avg,
+                                  (unsigned long)s.max_us,
+                                  (unsigned long)s.overruns,
+                                  (unsigned long)s.misses);
+        }
+    }
+
+  private:
+    struct Task
+    {
+        TaskConfig    config;
+        TaskStats     stats;
+        uint64_t      release_us; // when a periodic task is due next
+        uint64_t      trigger_us; // when Trigger() was called
+        bool          enabled;
+        volatile bool triggered;
+    };
+
+    bool     IsDue(const Task& task, uint64_t now) const;
+    uint64_t GetDeadline(const Task& task) const;
+
+    Task     tasks_[DSY_SCHEDULER_MAX_TASKS];
+    size_t   num_tasks_;
+    TaskId   current_;
+    uint64_t current_start_us_;
+};
+
+} // namespace daisy
+
+#endif
@@ -5,6 +5,8 @@
 #include "sys/dma.h"
 #include "per/gpio.h"
 #include "per/rng.h"
+#include "util/scopedirqblocker.h"
+#include "util/IrqProfiler.h"
 
 // global init functions for peripheral drivers.
 // These don't really need to be extern "C" anymore..
@@ -13,6 +15,11 @@ extern "C"
     extern void dsy_i2c_global_init();
     extern void dsy_spi_global_init();
     extern void dsy_uart_global_init();
+
+    // the stack, from the linker script and the startup code
+    extern void*        _sstack;
+    extern void*        _estack;
+    extern unsigned int dsy_stack_painted;
 }
 
 // boot info struct declared in persistent backup SRAM
@@ -89,6 +96,7 @@ extern "C"
 {
     void SysTick_Handler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::SYSTICK);
         HAL_IncTick();
         HAL_SYSTICK_IRQHandler();
     }
@@ -99,6 +107,7 @@ extern "C"
 
     void OTG_HS_EP1_OUT_IRQHandler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_HS);
         if(hhcd_USB_OTG_HS.Instance)
             HAL_HCD_IRQHandler(&hhcd_USB_OTG_HS);
         if(hpcd_USB_OTG_HS.Instance)
@@ -107,6 +116,7 @@ extern "C"
 
     void OTG_HS_EP1_IN_IRQHandler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_HS);
         if(hhcd_USB_OTG_HS.Instance)
             HAL_HCD_IRQHandler(&hhcd_USB_OTG_HS);
         if(hpcd_USB_OTG_HS.Instance)
@@ -115,6 +125,7 @@ extern "C"
 
     void OTG_HS_IRQHandler(void)
     {
+        DSY_IRQ_PROFILE_SCOPE(Source::USB_HS);
         if(hhcd_USB_OTG_HS.Instance)
             HAL_HCD_IRQHandler(&hhcd_USB_OTG_HS);
         if(hpcd_USB_OTG_HS.Instance)
@@ -202,8 +213,96 @@ extern "C"
 
 namespace daisy
 {
+namespace
+{
+/** How a System::Config::SysClkFreq is made */
+struct ClockSettings
+{
+    uint32_t vos;           // voltage scaling
+    uint32_t plln;          // PLL1 multiplier, 16MHz HSE / 4 * N / 2
+    uint32_t flash_latency; // for the HCLK
+    uint32_t sysclk_div;    // D1CPRE, the CPU clock
+    uint32_t hclk_div;      // HPRE, the AXI/AHB clock
+};
+
+ClockSettings GetClockSettings(System::Config::SysClkFreq freq)
+{
+    // See page 159 of Reference manual for VOS/Freq relationship
+    // and table for flash latency.
+    switch(freq)
+    {
+        case System::Config::SysClkFreq::FREQ_480MHZ:
+            return {PWR_REGULATOR_VOLTAGE_SCALE0,
+                    240,
+                    FLASH_LATENCY_4,
+                    RCC_SYSCLK_DIV1,
+                    RCC_HCLK_DIV2};
+        case System::Config::SysClkFreq::FREQ_240MHZ:
+            return {PWR_REGULATOR_VOLTAGE_SCALE0,
+                    240,
+                    FLASH_LATENCY_4,
+                    RCC_SYSCLK_DIV2,
+                    RCC_HCLK_DIV1};
+        case System::Config::SysClkFreq::FREQ_200MHZ:
+            return {PWR_REGULATOR_VOLTAGE_SCALE1,
+                    200,
+                    FLASH_LATENCY_2,
+                    RCC_SYSCLK_DIV2,
+                    RCC_HCLK_DIV1};
+        case System::Config::SysClkFreq::FREQ_400MHZ:
+        default:
+            return {PWR_REGULATOR_VOLTAGE_SCALE1,
+                    200,
+                    FLASH_LATENCY_2,
+                    RCC_SYSCLK_DIV1,
+                    RCC_HCLK_DIV2};
+    }
+}
+
+void GetPll1Config(RCC_PLLInitTypeDef& pll, uint32_t plln)
+{
+    pll.PLLState  = RCC_PLL_ON;
+    pll.PLLSource = RCC_PLLSOURCE_HSE;
+    pll.PLLM      = 4;
+    pll.PLLN      = plln;
+    pll.PLLP      = 2;
+    pll.PLLQ      = 5; // was 4 in cube
+    pll.PLLR      = 2;
+    pll.PLLRGE    = RCC_PLL1VCIRANGE_2;
+    pll.PLLVCOSEL = RCC_PLL1VCOWIDE;
+    pll.PLLFRACN  = 0;
+}
+
+void WaitForVoltageScaling()
+{
+    while(!__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY)) {}
+}
+
+/** At least one call per wrap of the timer */
+void OnTimerOverflow(void* data)
+{
+    (void)data;
+    System::GetTick64();
+}
+} // namespace
+
 // Define static tim_
 TimerHandle System::tim_;
+bool        System::sleep_in_delays_ = false;
+
+System::ClockChangeListener
+                  System::clock_listeners_[DSY_SYSTEM_MAX_CLOCK_CALLBACKS];
+size_t            System::num_clock_listeners_ = 0;
+volatile uint32_t System::clock_changes_       = 0;
+
+uint32_t System::tick_wraps_   = 0;
+uint32_t System::last_tick_    = 0;
+uint64_t System::us_base_      = 0;
+uint64_t System::us_base_tick_ = 0;
+uint32_t System::ticks_per_us_ = 1;
+
+uint16_t System::mpu_regions_used_
+    = (1u << System::kNumReservedMpuRegions) - 1;
 
 void System::Init()
 {
@@ -215,7 +314,8 @@ void System::Init()
 // TODO: DONT FORGET TO IMPLEMENT CLOCK CONFIG
 void System::Init(const System::Config& config)
 {
-    cfg_ = config;
+    cfg_             = config;
+    sleep_in_delays_ = config.sleep_in_delays;
     HAL_Init();
     if(!config.skip_clocks)
     {
@@ -235,12 +335,23 @@ void System::Init(const System::Config& config)
 
     // Configure and start highspeed timer.
     // TIM 2 counter UP (defaults to fastest tick/longest period).
+    // The overflow interrupt extends it to 64 bits.
     TimerHandle::Config timcfg;
-    timcfg.periph = TimerHandle::Config::Peripheral::TIM_2;
-    timcfg.dir    = TimerHandle::Config::CounterDir::UP;
+    timcfg.periph     = TimerHandle::Config::Peripheral::TIM_2;
+    timcfg.dir        = TimerHandle::Config::CounterDir::UP;
+    timcfg.enable_irq = true;
     tim_.Init(timcfg);
+    tim_.SetCallback(OnTimerOverflow);
+    tick_wraps_   = 0;
+    last_tick_    = 0;
+    us_base_      = 0;
+    us_base_tick_ = 0;
+    ticks_per_us_ = GetTickFreq() / 1000000;
     tim_.Start();
 
+    // Start the DWT cycle counter for cycle accurate measurements
+    ConfigureCycleCounter();
+
     // Initialize the true random number generator
     Random::Init();
 }
@@ -262,6 +373,50 @@ void System::DeInit()
     // HAL_DeInit();
 }
 
+bool System::SetSysClkFreq(Config::SysClkFreq freq)
+{
+    if(cfg_.skip_clocks)
+        return false;
+    if(freq == cfg_.cpu_freq)
+        return true;
+
+    // Only the CPU divider changes while running. Another PLL1 frequency
+    // would change the bus clocks under the UARTs, I2C and timers.
+    const ClockSettings from = GetClockSettings(cfg_.cpu_freq);
+    const ClockSettings to   = GetClockSettings(freq);
+    if(to.plln != from.plln)
+        return false;
+    {
+        ScopedIrqBlocker irq_blocker;
+
+        // Both dividers in one write, the HCLK doesn't change. The SysTick
+        // runs from the CPU clock, and is set up again for the new rate.
+        MODIFY_REG(RCC->D1CFGR,
+                   RCC_D1CFGR_D1CPRE | RCC_D1CFGR_HPRE,
+                   to.sysclk_div | to.hclk_div);
+        HAL_RCCEx_GetD1SysClockFreq(); // updates SystemCoreClock
+        HAL_InitTick(uwTickPrio);
+
+        cfg_.cpu_freq  = freq;
+        clock_changes_ = clock_changes_ + 1;
+    }
+
+    for(size_t i = 0; i < num_clock_listeners_; i++)
+        clock_listeners_[i].callback(clock_listeners_[i].context);
+    return true;
+}
+
+bool System::AddClockChangeCallback(ClockChangeCallback callback,
+                                    void*               context)
+{
+    if(callback == nullptr
+       || num_clock_listeners_ >= DSY_SYSTEM_MAX_CLOCK_CALLBACKS)
+        return false;
+    clock_listeners_[num_clock_listeners_] = {callback, context};
+    num_clock_listeners_++;
+    return true;
+}
+
 void System::JumpToQspi()
 {
     __JUMPTOQSPI();
@@ -283,13 +438,49 @@ uint32_t System::GetTick()
     return tim_.GetTick();
 }
 
+uint64_t System::GetTick64()
+{
+    ScopedIrqBlocker irq_blocker;
+    const uint32_t   tick = tim_.GetTick();
+    if(tick < last_tick_)
+        tick_wraps_++;
+    last_tick_ = tick;
+    return (uint64_t(tick_wraps_) << 32) | tick;
+}
+
+uint64_t System::GetUs64()
+{
+    ScopedIrqBlocker irq_blocker;
+    return us_base_ + (GetTick64() - us_base_tick_) / ticks_per_us_;
+}
+
 void System::Delay(uint32_t delay_ms)
 {
-    HAL_Delay(delay_ms);
+    if(!sleep_in_delays_)
+    {
+        HAL_Delay(delay_ms);
+        return;
+    }
+    // the same wait as HAL_Delay(), at least delay_ms whole ticks
+    const uint32_t start = HAL_GetTick();
+    uint32_t       wait  = delay_ms;
+    if(wait < HAL_MAX_DELAY)
+        wait += uint32_t(uwTickFreq);
+    while(HAL_GetTick() - start < wait)
+        Sleep();
 }
 
 void System::DelayUs(uint32_t delay_us)
 {
+    if(sleep_in_delays_ && delay_us > 2000)
+    {
+        // the SysTick wakes the CPU at least 1ms before the end
+        const uint64_t end = GetUs64() + delay_us;
+        while(GetUs64() + 1000 < end)
+            Sleep();
+        const uint64_t now = GetUs64();
+        delay_us           = now < end ? uint32_t(end - now) : 0;
+    }
     tim_.DelayUs(delay_us);
 }
 
@@ -298,6 +489,36 @@ void System::DelayTicks(uint32_t delay_ticks)
     tim_.DelayTick(delay_ticks);
 }
 
+void System::Sleep()
+{
+    // sleep, not stop, so that all clocks but the CPU's keep running
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+}
+
+void System::SleepUntil(uint32_t wake_ms)
+{
+    while(int32_t(wake_ms - HAL_GetTick()) > 0)
+        Sleep();
+}
+
+size_t System::GetStackSize()
+{
+    return reinterpret_cast<uintptr_t>(&_estack)
+           - reinterpret_cast<uintptr_t>(&_sstack);
+}
+
+size_t System::GetStackHighWaterMark()
+{
+    if(!dsy_stack_painted)
+        return 0;
+    const uint32_t* word = reinterpret_cast<const uint32_t*>(&_sstack);
+    const uint32_t* top  = reinterpret_cast<const uint32_t*>(&_estack);
+    while(word < top && *word == kStackPaintPattern)
+        word++;
+    return reinterpret_cast<uintptr_t>(top)
+           - reinterpret_cast<uintptr_t>(word);
+}
+
 void System::ResetToBootloader(BootloaderMode mode)
 {
     if(mode == BootloaderMode::STM)
@@ -353,12 +574,18 @@ void System::ResetToBootloader(BootloaderMode mode)
     HAL_NVIC_SystemReset();
 }
 
-void System::InitBackupSram()
+void System::InitBackupSram(bool keep_on_vbat)
 {
     PWR->CR1 |= PWR_CR1_DBP;
     while((PWR->CR1 & PWR_CR1_DBP) == RESET)
         ;
     __HAL_RCC_BKPRAM_CLK_ENABLE();
+    if(keep_on_vbat)
+    {
+        PWR->CR2 |= PWR_CR2_BREN;
+        while((PWR->CR2 & PWR_CR2_BRRDY) == RESET)
+            ;
+    }
 }
 
 System::BootInfo::Version System::GetBootloaderVersion()
@@ -392,28 +619,10 @@ void System::ConfigureClocks()
 
     /** Configure the main internal regulator output voltage
      ** and set PLLN value, and flash-latency.
-     **
-     ** See page 159 of Reference manual for VOS/Freq relationship
-     ** and table for flash latency.
      */
-
-    uint32_t plln_val, flash_latency;
-    switch(cfg_.cpu_freq)
-    {
-        case Config::SysClkFreq::FREQ_480MHZ:
-            __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE0);
-            plln_val      = 240;
-            flash_latency = FLASH_LATENCY_4;
-            break;
-        case Config::SysClkFreq::FREQ_400MHZ:
-        default:
-            __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
-            plln_val      = 200;
-            flash_latency = FLASH_LATENCY_2;
-            break;
-    }
-
-    while(!__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY)) {}
+    const ClockSettings settings = GetClockSettings(cfg_.cpu_freq);
+    __HAL_PWR_VOLTAGESCALING_CONFIG(settings.vos);
+    WaitForVoltageScaling();
     /** Macro to configure the PLL clock source
   */
     __HAL_RCC_PLL_PLLSOURCE_CONFIG(RCC_PLLSOURCE_HSE);
@@ -421,19 +630,9 @@ void System::ConfigureClocks()
   */
     RCC_OscInitStruct.OscillatorType
         = RCC_OSCILLATORTYPE_HSI48 | RCC_OSCILLATORTYPE_HSE;
-    RCC_OscInitStruct.HSEState      = RCC_HSE_ON;
-    RCC_OscInitStruct.HSI48State    = RCC_HSI48_ON;
-    RCC_OscInitStruct.PLL.PLLState  = RCC_PLL_ON;
-    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-    RCC_OscInitStruct.PLL.PLLM      = 4;
-    //
-    RCC_OscInitStruct.PLL.PLLN      = plln_val;
-    RCC_OscInitStruct.PLL.PLLP      = 2;
-    RCC_OscInitStruct.PLL.PLLQ      = 5; // was 4 in cube
-    RCC_OscInitStruct.PLL.PLLR      = 2;
-    RCC_OscInitStruct.PLL.PLLRGE    = RCC_PLL1VCIRANGE_2;
-    RCC_OscInitStruct.PLL.PLLVCOSEL = RCC_PLL1VCOWIDE;
-    RCC_OscInitStruct.PLL.PLLFRACN  = 0;
+    RCC_OscInitStruct.HSEState   = RCC_HSE_ON;
+    RCC_OscInitStruct.HSI48State = RCC_HSI48_ON;
+    GetPll1Config(RCC_OscInitStruct.PLL, settings.plln);
     if(HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
     {
         Error_Handler();
@@ -444,14 +643,15 @@ void System::ConfigureClocks()
         = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1
           | RCC_CLOCKTYPE_PCLK2 | RCC_CLOCKTYPE_D3PCLK1 | RCC_CLOCKTYPE_D1PCLK1;
     RCC_ClkInitStruct.SYSCLKSource   = RCC_SYSCLKSOURCE_PLLCLK;
-    RCC_ClkInitStruct.SYSCLKDivider  = RCC_SYSCLK_DIV1;
-    RCC_ClkInitStruct.AHBCLKDivider  = RCC_HCLK_DIV2;
+    RCC_ClkInitStruct.SYSCLKDivider  = settings.sysclk_div;
+    RCC_ClkInitStruct.AHBCLKDivider  = settings.hclk_div;
     RCC_ClkInitStruct.APB3CLKDivider = RCC_APB3_DIV2;
     RCC_ClkInitStruct.APB1CLKDivider = RCC_APB1_DIV2;
     RCC_ClkInitStruct.APB2CLKDivider = RCC_APB2_DIV2;
     RCC_ClkInitStruct.APB4CLKDivider = RCC_APB4_DIV2;
 
-    if(HAL_RCC_ClockConfig(&RCC_ClkInitStruct, flash_latency) != HAL_OK)
+    if(HAL_RCC_ClockConfig(&RCC_ClkInitStruct, settings.flash_latency)
+       != HAL_OK)
     {
         Error_Handler();
     }
@@ -558,11 +758,120 @@ void System::ConfigureMpu()
     HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
 }
 
+int System::AddMpuRegion(const MpuRegion& region)
+{
+    // the MPU needs a power of two size, and the base aligned to it
+    if(region.size < 32 || (region.size & (region.size - 1)) != 0
+       || (region.base & (region.size - 1)) != 0)
+        return -1;
+
+    int number = kNumReservedMpuRegions;
+    while(number < kNumMpuRegions && (mpu_regions_used_ & (1u << number)))
+        number++;
+    if(number >= kNumMpuRegions)
+        return -1;
+
+    MPU_Region_InitTypeDef MPU_InitStruct;
+    MPU_InitStruct.Enable      = MPU_REGION_ENABLE;
+    MPU_InitStruct.Number      = uint8_t(number);
+    MPU_InitStruct.BaseAddress = region.base;
+    // MPU_REGION_SIZE_32B is 4, i.e. log2(size) - 1
+    MPU_InitStruct.Size             = uint8_t(__builtin_ctz(region.size) - 1);
+    MPU_InitStruct.SubRegionDisable = region.subregion_disable;
+    MPU_InitStruct.DisableExec      = region.no_execute
+                                     ? MPU_INSTRUCTION_ACCESS_DISABLE
+                                     : MPU_INSTRUCTION_ACCESS_ENABLE;
+    switch(region.access)
+    {
+        case MpuAccess::READ_ONLY:
+            MPU_InitStruct.AccessPermission = MPU_REGION_PRIV_RO_URO;
+            break;
+        case MpuAccess::NONE:
+            MPU_InitStruct.AccessPermission = MPU_REGION_NO_ACCESS;
+            break;
+        default: MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+    }
+    // Shareable normal memory isn't cached by the M7, so only the
+    // non-cacheable regions are shareable
+    MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    switch(region.cache)
+    {
+        case MpuCache::WRITE_BACK_ALLOCATE:
+            MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+            MPU_InitStruct.IsCacheable  = MPU_ACCESS_CACHEABLE;
+            MPU_InitStruct.IsBufferable = MPU_ACCESS_BUFFERABLE;
+            break;
+        case MpuCache::WRITE_THROUGH:
+            MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL0;
+            MPU_InitStruct.IsCacheable  = MPU_ACCESS_CACHEABLE;
+            MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+            break;
+        case MpuCache::NON_CACHEABLE:
+            MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+            MPU_InitStruct.IsCacheable  = MPU_ACCESS_NOT_CACHEABLE;
+            MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+            MPU_InitStruct.IsShareable  = MPU_ACCESS_SHAREABLE;
+            break;
+        default:
+            MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL0;
+            MPU_InitStruct.IsCacheable  = MPU_ACCESS_CACHEABLE;
+            MPU_InitStruct.IsBufferable = MPU_ACCESS_BUFFERABLE;
+    }
+
+    {
+        ScopedIrqBlocker block;
+        // Dirty lines of the region would be written back over DMA data
+        // once it isn't cached anymore. The whole cache is only 16kB, it's
+        // quicker to clean than a large region line by line.
+        if(SCB->CCR & SCB_CCR_DC_Msk)
+            SCB_CleanInvalidateDCache();
+        HAL_MPU_Disable();
+        HAL_MPU_ConfigRegion(&MPU_InitStruct);
+        HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+        mpu_regions_used_ |= 1u << number;
+    }
+    return number;
+}
+
+bool System::RemoveMpuRegion(int number)
+{
+    if(number < kNumReservedMpuRegions || number >= kNumMpuRegions
+       || (mpu_regions_used_ & (1u << number)) == 0)
+        return false;
+
+    MPU_Region_InitTypeDef MPU_InitStruct = {};
+    MPU_InitStruct.Enable                 = MPU_REGION_DISABLE;
+    MPU_InitStruct.Number                 = uint8_t(number);
+
+    ScopedIrqBlocker block;
+    if(SCB->CCR & SCB_CCR_DC_Msk)
+        SCB_CleanInvalidateDCache();
+    HAL_MPU_Disable();
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+    mpu_regions_used_ &= ~(1u << number);
+    return true;
+}
+
+void System::ConfigureCycleCounter()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    // The M7 DWT requires unlocking before it can be written to
+    DWT->LAR    = 0xC5ACCE55;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 uint32_t System::GetSysClkFreq()
 {
     return HAL_RCC_GetSysClockFreq();
 }
 
+uint32_t System::GetCpuFreq()
+{
+    return HAL_RCCEx_GetD1SysClockFreq();
+}
+
 uint32_t System::GetHClkFreq()
 {
     return HAL_RCC_GetHCLKFreq();
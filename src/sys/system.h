@@ -3,9 +3,15 @@
 
 #ifndef UNIT_TEST // for unit tests, a dummy implementation is provided below
 
+#include <cstddef>
 #include <cstdint>
 #include "per/tim.h"
 
+/** Number of functions that can be notified of clock changes */
+#ifndef DSY_SYSTEM_MAX_CLOCK_CALLBACKS
+#define DSY_SYSTEM_MAX_CLOCK_CALLBACKS 4
+#endif
+
 namespace daisy
 {
 /** A handle for interacting with the Core System.
@@ -21,11 +27,17 @@ class System
     /** Contains settings for initializing the System */
     struct Config
     {
-        /** Specifies the system clock frequency that feeds APB/AHB clocks, etc. */
+        /** Specifies the CPU clock frequency.
+         ** The AHB/APB busses run at 200MHz/100MHz with FREQ_400MHZ and
+         ** FREQ_200MHZ, and at 240MHz/120MHz with FREQ_480MHZ and
+         ** FREQ_240MHZ. The lower frequencies only divide the CPU clock.
+         */
         enum class SysClkFreq
         {
             FREQ_400MHZ,
             FREQ_480MHZ,
+            FREQ_200MHZ,
+            FREQ_240MHZ,
         };
 
         /** Method to call on the struct to set to defaults
@@ -34,10 +46,11 @@ class System
          ** */
         void Defaults()
         {
-            cpu_freq    = SysClkFreq::FREQ_400MHZ;
-            use_dcache  = true;
-            use_icache  = true;
-            skip_clocks = false;
+            cpu_freq        = SysClkFreq::FREQ_400MHZ;
+            use_dcache      = true;
+            use_icache      = true;
+            skip_clocks     = false;
+            sleep_in_delays = false;
         }
 
         /** Method to call on the struct to set to boost mode:
@@ -46,16 +59,22 @@ class System
          ** */
         void Boost()
         {
-            cpu_freq    = SysClkFreq::FREQ_480MHZ;
-            use_dcache  = true;
-            use_icache  = true;
-            skip_clocks = false;
+            cpu_freq        = SysClkFreq::FREQ_480MHZ;
+            use_dcache      = true;
+            use_icache      = true;
+            skip_clocks     = false;
+            sleep_in_delays = false;
         }
 
         SysClkFreq cpu_freq;
         bool       use_dcache;
         bool       use_icache;
         bool       skip_clocks;
+
+        /** Delay() and DelayUs() sleep in Sleep() instead of spinning,
+         ** see there for what stops while the CPU sleeps.
+         */
+        bool sleep_in_delays;
     };
 
     /** Describes the different regions of memory available to the Daisy */
@@ -113,6 +132,38 @@ class System
      */
     void DeInit();
 
+    /** Changes the CPU clock while running, without stopping the audio
+     ** (the SAI has its own PLL).
+     **
+     ** Only between frequencies with the same bus clocks, 200 and 400MHz,
+     ** or 240 and 480MHz, where just the CPU clock divider changes. The
+     ** peripherals, GetUs() and GetTick() don't notice. The other changes
+     ** would move the bus clocks under the UART baud rates, I2C timings
+     ** and timer periods, they're set with Config::cpu_freq at Init().
+     **
+     ** CpuLoadMeter and CycleCpuLoadMeter pick up the new rate on their
+     ** own through GetClockChangeCount().
+     ** \param freq the new frequency
+     ** \return false if freq has other bus clocks, or the clocks were
+     **         skipped by Init() (Config::skip_clocks)
+     */
+    bool SetSysClkFreq(Config::SysClkFreq freq);
+
+    /** A function to be called after the clocks changed */
+    typedef void (*ClockChangeCallback)(void* context);
+
+    /** Adds a function that SetSysClkFreq() calls after each change, from
+     ** the context SetSysClkFreq() was called from.
+     ** \return false if DSY_SYSTEM_MAX_CLOCK_CALLBACKS are added already
+     */
+    static bool AddClockChangeCallback(ClockChangeCallback callback,
+                                       void*               context);
+
+    /** Returns the number of clock changes since startup. Code that caches a
+     ** clock rate compares it to find out whether to read the rate again.
+     */
+    static uint32_t GetClockChangeCount() { return clock_changes_; }
+
     /** Jumps to the first address of the external flash chip (0x90000000)
      ** If there is no code there, the chip will likely fall through to the while() loop
      ** TODO: Documentation/Loader for using external flash coming soon.
@@ -132,12 +183,41 @@ class System
      ** */
     static uint32_t GetTick();
 
+    /** \return the ticks of GetTick() since Init() as a 64 bit value, that
+     ** doesn't wrap around. The timer overflow interrupt keeps it going
+     ** when it isn't called for longer than a wrap of GetTick() (~18s).
+     ** Takes a few cycles with interrupts disabled, it can be called from
+     ** any interrupt, e.g. the audio callback.
+     ** The rate is GetTickFreq(), SetSysClkFreq() doesn't change it.
+     */
+    static uint64_t GetTick64();
+
+    /** \return the microseconds since Init() as a 64 bit value, that
+     ** doesn't wrap around, and stays continuous through SetSysClkFreq().
+     ** Like GetTick64(), it can be called from any interrupt.
+     */
+    static uint64_t GetUs64();
+
+    /** \return the current value of the DWT cycle counter.
+     ** This counts at the CPU clock rate (see GetCpuFreq()), and
+     ** wraps around every ~9 seconds at 480MHz. It is started in Init().
+     ** Reading it is a single load, so it is suitable for measuring
+     ** short sections of code, even from within interrupts.
+     */
+    static inline uint32_t GetCycleCount()
+    {
+        return *reinterpret_cast<volatile uint32_t*>(kDwtCycCntAddress);
+    }
+
     /** Blocking Delay that uses the SysTick (1ms callback) to wait.
+     ** With Config::sleep_in_delays, the CPU sleeps between the ticks.
      ** \param delay_ms Time to delay in ms
      */
     static void Delay(uint32_t delay_ms);
 
     /** Blocking Delay using internal timer to wait
+     ** With Config::sleep_in_delays, the CPU sleeps for all but the last
+     ** millisecond of delays longer than 2ms, and spins for the rest.
      ** \param delay_us Time to ddelay in microseconds */
     static void DelayUs(uint32_t delay_us);
 
@@ -146,6 +226,34 @@ class System
      ** \param delay_ticks Time to ddelay in microseconds */
     static void DelayTicks(uint32_t delay_ticks);
 
+    /** Lets the CPU sleep (WFI) until the next interrupt, e.g. at the end
+     ** of the main loop, when all its work is done until an interrupt
+     ** brings more. The SysTick wakes it up every millisecond at the
+     ** latest. This saves power and keeps the chip cooler than spinning
+     ** in the loop.
+     **
+     ** The peripherals, DMAs and timers keep running, so GetNow(),
+     ** GetUs() and GetTick() stay right. The DWT cycle counter stops
+     ** with the CPU clock, so GetCycleCount() differences that span a
+     ** sleep, e.g. between two interrupts, come out short.
+     **
+     ** \code
+     ** while(1)
+     ** {
+     **     ProcessControls();
+     **     System::Sleep();
+     ** }
+     ** \endcode
+     */
+    static void Sleep();
+
+    /** Sleeps through the interrupts until GetNow() reaches a time, e.g.
+     ** for a main loop that runs at a fixed rate.
+     ** \param wake_ms the GetNow() to wake up at, returns right away if
+     **        it's passed already (up to 2^31ms ago)
+     */
+    static void SleepUntil(uint32_t wake_ms);
+
     /** Specify how the Daisy should return to the bootloader
      * \param STM return to the STM32-provided
      * bootloader to program internal flash
@@ -167,8 +275,11 @@ class System
      ** mode to allow firmware update. */
     static void ResetToBootloader(BootloaderMode mode = BootloaderMode::STM);
 
-    /** Initializes the backup SRAM */
-    static void InitBackupSram();
+    /** Initializes the backup SRAM
+     ** \param keep_on_vbat also turns on the backup regulator, so the
+     ** backup SRAM keeps its contents from the VBAT pin while VDD is off.
+     ** */
+    static void InitBackupSram(bool keep_on_vbat = false);
 
     /** Checks Daisy Bootloader version, if present. */
     static BootInfo::Version GetBootloaderVersion();
@@ -181,6 +292,12 @@ class System
      ** AXI Peripheral, APB, and AHB clocks. */
     static uint32_t GetSysClkFreq();
 
+    /** Returns the frequency of the CPU clock in Hz, the rate of
+     ** GetCycleCount(). It's the system clock, or half of it with
+     ** FREQ_200MHZ and FREQ_240MHZ.
+     ** */
+    static uint32_t GetCpuFreq();
+
     /** Returns the frequency of the HCLK (AHB) clock. This is derived
      ** from the System clock, and used to clock the CPU, memory, and
      ** peripherals mapped on the AHB, and APB Bus.
@@ -219,6 +336,114 @@ class System
      */
     static MemoryRegion GetMemoryRegion(uint32_t address);
 
+    /** Caching policy of an MPU region */
+    enum class MpuCache
+    {
+        /** Write-back, read allocate: the policy of the SDRAM */
+        WRITE_BACK,
+        /** Write-back, read and write allocate, e.g. for buffers that are
+         ** written before they're read */
+        WRITE_BACK_ALLOCATE,
+        /** Writes go to memory right away, reads are cached: the CPU's
+         ** writes are visible to DMA without cleaning the cache, e.g. for
+         ** delay lines that a DMA copies out */
+        WRITE_THROUGH,
+        /** Not cached, e.g. for DMA buffers, which then need no cache
+         ** maintenance at all */
+        NON_CACHEABLE,
+    };
+
+    /** Access of an MPU region */
+    enum class MpuAccess
+    {
+        READ_WRITE,
+        READ_ONLY,
+        /** Any access faults, e.g. as a guard below a stack */
+        NONE,
+    };
+
+    /** An area of memory with its own caching policy and access, see
+     ** AddMpuRegion()
+     */
+    struct MpuRegion
+    {
+        /** First address, a multiple of size */
+        uint32_t base = 0;
+
+        /** Size in bytes, a power of two from 32 bytes */
+        uint32_t size = 0;
+
+        MpuCache  cache      = MpuCache::NON_CACHEABLE;
+        MpuAccess access     = MpuAccess::READ_WRITE;
+        bool      no_execute = true;
+
+        /** Bit n leaves the nth eighth of the region to the regions below
+         ** it, for regions of 256 bytes or more
+         */
+        uint8_t subregion_disable = 0x00;
+    };
+
+    /** MPU regions that Init() sets up, AddMpuRegion() uses the others */
+    static constexpr int kNumMpuRegions         = 16;
+    static constexpr int kNumReservedMpuRegions = 3;
+
+    /** Adds an MPU region, e.g. to make a buffer in SDRAM non-cacheable
+     ** for DMA, or write-through. Where regions overlap, the one added
+     ** last wins, so a region within the SDRAM or the SRAM overrides the
+     ** policy Init() set up.
+     **
+     ** The cache is cleaned and invalidated first, so no dirty line of
+     ** the region is written back later over data the DMA wrote. This
+     ** takes some microseconds with interrupts disabled; add the regions
+     ** at startup, after Init().
+     **
+     ** \code
+     ** // in SDRAM, aligned to its size
+     ** uint8_t DSY_SDRAM_BSS __attribute__((aligned(65536))) dma_buf[65536];
+     ** System::MpuRegion region;
+     ** region.base = reinterpret_cast<uint32_t>(dma_buf);
+     ** region.size = sizeof(dma_buf);
+     ** System::AddMpuRegion(region);
+     ** \endcode
+     ** 
+eturn the number of the region, -1 if its base or size isn't
+     **         valid, or all regions are used
+     */
+    static int AddMpuRegion(const MpuRegion& region);
+
+    /** Removes a region added by AddMpuRegion(), the memory falls back to
+     ** the policy of the regions below it.
+     ** 
+eturn false if number isn't a region added by AddMpuRegion()
+     */
+    static bool RemoveMpuRegion(int number);
+
+    /** Value the startup code fills the stack with, see
+     ** GetStackHighWaterMark() */
+    static constexpr uint32_t kStackPaintPattern = 0xA5A5A5A5U;
+
+    /** Returns the size of the stack in bytes: the DTCM from the end of
+     ** the variables placed there up to the top at _estack. The main loop
+     ** and all interrupts use this one stack.
+     */
+    static size_t GetStackSize();
+
+    /** Returns the most stack used since startup in bytes, or 0 if the
+     ** startup code didn't paint the stack. To paint it, build the program
+     ** with PAINT_STACK = 1 in its Makefile (DSY_STACK_PAINT), which takes
+     ** about 1ms at startup with a 128kB stack.
+     **
+     ** The stack is scanned from its bottom for the first word that was
+     ** overwritten, so it takes a while with a large stack, call it from
+     ** the main loop. A result close to GetStackSize() means the stack may
+     ** well have overflowed into the variables below it.
+     **
+     ** Interrupts nest on the same stack, so let the program run through
+     ** all of its modes, with the audio, USB, SD card and so on, before
+     ** relying on the result to size the stack.
+     */
+    static size_t GetStackHighWaterMark();
+
     /** This constant indicates the Daisy bootloader's offset from
      *  the beginning of QSPI's address space.
      *  Data written within the first 256K will remain
@@ -227,13 +452,42 @@ class System
     static constexpr uint32_t kQspiBootloaderOffset = 0x40000U;
 
   private:
+    /** Address of the DWT->CYCCNT register */
+    static constexpr uint32_t kDwtCycCntAddress = 0xE0001004U;
+
+    void   ConfigureCycleCounter();
     void   ConfigureClocks();
     void   ConfigureMpu();
     Config cfg_;
 
+    struct ClockChangeListener
+    {
+        ClockChangeCallback callback;
+        void*               context;
+    };
+    static ClockChangeListener
+                             clock_listeners_[DSY_SYSTEM_MAX_CLOCK_CALLBACKS];
+    static size_t            num_clock_listeners_;
+    static volatile uint32_t clock_changes_;
+
     /** One TimerHandle to rule them all
      ** Maybe this whole class should be static.. */
     static TimerHandle tim_;
+
+    /** Config::sleep_in_delays of the last Init() */
+    static bool sleep_in_delays_;
+
+    /** The upper half of GetTick64(), counted when GetTick() is below the
+     ** value it had before. The microseconds restart from us_base_ at
+     ** us_base_tick_ after each clock change. */
+    static uint32_t tick_wraps_;
+    static uint32_t last_tick_;
+    static uint64_t us_base_;
+    static uint64_t us_base_tick_;
+    static uint32_t ticks_per_us_;
+
+    /** Bit n is set while MPU region n is used */
+    static uint16_t mpu_regions_used_;
 };
 
 extern volatile daisy::System::BootInfo boot_info;
@@ -275,6 +529,37 @@ class System
     {
         return testIsolator_.GetStateForCurrentTest()->tickFreqHz_;
     }
+    static uint64_t GetTick64()
+    {
+        return testIsolator_.GetStateForCurrentTest()->currentTick_;
+    }
+    static uint64_t GetUs64()
+    {
+        return testIsolator_.GetStateForCurrentTest()->currentUs_;
+    }
+    static uint32_t GetCycleCount()
+    {
+        return testIsolator_.GetStateForCurrentTest()->currentCycles_;
+    }
+    static uint32_t GetSysClkFreq()
+    {
+        return testIsolator_.GetStateForCurrentTest()->sysClkFreqHz_;
+    }
+    static uint32_t GetCpuFreq()
+    {
+        return testIsolator_.GetStateForCurrentTest()->sysClkFreqHz_;
+    }
+    static uint32_t GetClockChangeCount()
+    {
+        return testIsolator_.GetStateForCurrentTest()->clockChanges_;
+    }
+
+    /** The delays return right away, time only moves when a test sets it */
+    static void Delay(uint32_t) {}
+    static void DelayUs(uint32_t) {}
+    static void DelayTicks(uint32_t) {}
+    static void Sleep() {}
+    static void SleepUntil(uint32_t) {}
 
     /** Sets the current "tick" value for the test that's currently running. */
     static void SetTickForUnitTest(uint32_t tick)
@@ -291,13 +576,32 @@ class System
     {
         testIsolator_.GetStateForCurrentTest()->tickFreqHz_ = freqInHz;
     }
+    /** Sets the current cycle counter value for the test that's currently running. */
+    static void SetCycleCountForUnitTest(uint32_t cycles)
+    {
+        testIsolator_.GetStateForCurrentTest()->currentCycles_ = cycles;
+    }
+    /** Sets the CPU clock frequency for the test that's currently running. */
+    static void SetSysClkFreqForUnitTest(uint32_t freqInHz)
+    {
+        testIsolator_.GetStateForCurrentTest()->sysClkFreqHz_ = freqInHz;
+    }
+    /** Counts a clock change, as SetSysClkFreq() would. Set the new rates with
+     *  SetTickFreqForUnitTest() and SetSysClkFreqForUnitTest() first. */
+    static void ClockChangeForUnitTest()
+    {
+        testIsolator_.GetStateForCurrentTest()->clockChanges_++;
+    }
 
   private:
     struct SystemState
     {
-        uint32_t currentTick_ = 0;
-        uint32_t currentUs_   = 0;
-        uint32_t tickFreqHz_  = 0;
+        uint32_t currentTick_   = 0;
+        uint32_t currentUs_     = 0;
+        uint32_t tickFreqHz_    = 0;
+        uint32_t currentCycles_ = 0;
+        uint32_t sysClkFreqHz_  = 0;
+        uint32_t clockChanges_  = 0;
     };
     static TestIsolator<SystemState> testIsolator_;
 };
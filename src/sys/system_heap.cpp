@@ -0,0 +1,219 @@
+#include "sys/system_heap.h"
+#include "util/scopedirqblocker.h"
+#include <cstring>
+#include <new>
+
+using namespace daisy;
+
+static void DefaultTrap(size_t size)
+{
+    (void)size;
+    asm("bkpt 255");
+}
+
+// The heap is constructed by the first allocation, which can come from a
+// constructor of another file, before the constructors of this one ran.
+// So nothing here has a constructor, the rest is constant initialized.
+alignas(PoolHeap) static uint8_t heap_storage[sizeof(PoolHeap)];
+static bool                      heap_started = false;
+static SystemHeap::TrapFunction  heap_trap    = &DefaultTrap;
+
+#if DSY_SYSTEM_HEAP_SIZE > 0
+alignas(PoolHeap::kAlignment) static uint8_t
+    heap_default_buffer[DSY_SYSTEM_HEAP_SIZE];
+#endif
+
+static PoolHeap& Heap()
+{
+    return *reinterpret_cast<PoolHeap*>(heap_storage);
+}
+
+bool SystemHeap::Start()
+{
+    if(heap_started)
+        return true;
+    new(heap_storage) PoolHeap;
+    heap_started = true;
+#if DSY_SYSTEM_HEAP_SIZE > 0
+    return Heap().Init(
+        heap_default_buffer, sizeof(heap_default_buffer), PoolHeap::Config());
+#else
+    return false;
+#endif
+}
+
+bool SystemHeap::Init(void* buffer, size_t size, const PoolHeap::Config& config)
+{
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    if(Heap().GetStats().bytes_used > 0)
+        return false;
+    return Heap().Init(buffer, size, config);
+}
+
+void SystemHeap::Lock()
+{
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    Heap().Lock();
+}
+
+void SystemHeap::Unlock()
+{
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    Heap().Unlock();
+}
+
+void SystemHeap::SetTrap(TrapFunction trap)
+{
+    heap_trap = trap;
+}
+
+PoolHeap::Stats SystemHeap::GetStats()
+{
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    return Heap().GetStats();
+}
+
+PoolHeap::ClassStats SystemHeap::GetClassStats(size_t idx)
+{
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    return Heap().GetClassStats(idx);
+}
+
+size_t SystemHeap::GetNumClasses()
+{
+    Start();
+    return Heap().GetNumClasses();
+}
+
+void* SystemHeap::Allocate(size_t size)
+{
+    bool  trap;
+    void* ptr;
+    {
+        ScopedIrqBlocker irq_blocker;
+        Start();
+        trap = Heap().IsLocked();
+        ptr  = Heap().Allocate(size);
+    }
+    if(trap && heap_trap != nullptr)
+        heap_trap(size);
+    return ptr;
+}
+
+void SystemHeap::Free(void* ptr)
+{
+    if(ptr == nullptr)
+        return;
+    ScopedIrqBlocker irq_blocker;
+    Start();
+    Heap().Free(ptr);
+}
+
+void* SystemHeap::Reallocate(void* ptr, size_t size)
+{
+    if(ptr == nullptr)
+        return Allocate(size);
+    {
+        // resizing within the block is no allocation, and never traps
+        ScopedIrqBlocker irq_blocker;
+        Start();
+        if(size <= Heap().GetBlockSize(ptr))
+            return ptr;
+    }
+    void* const block = Allocate(size);
+    if(block == nullptr)
+        return nullptr;
+    ScopedIrqBlocker irq_blocker;
+    std::memcpy(block, ptr, Heap().GetBlockSize(ptr));
+    Heap().Free(ptr);
+    return block;
+}
+
+extern "C"
+{
+    struct _reent;
+
+    void* malloc(size_t size) { return SystemHeap::Allocate(size); }
+
+    void free(void* ptr) { SystemHeap::Free(ptr); }
+
+    void* calloc(size_t num, size_t size)
+    {
+        if(size != 0 && num > size_t(-1) / size)
+            return nullptr;
+        void* const ptr = SystemHeap::Allocate(num * size);
+        if(ptr != nullptr)
+            std::memset(ptr, 0, num * size);
+        return ptr;
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        if(size == 0)
+        {
+            SystemHeap::Free(ptr);
+            return nullptr;
+        }
+        return SystemHeap::Reallocate(ptr, size);
+    }
+
+    // newlib's own functions, e.g. printf() and strdup(), call these
+    void* _malloc_r(struct _reent*, size_t size) { return malloc(size); }
+
+    void _free_r(struct _reent*, void* ptr) { free(ptr); }
+
+    void* _calloc_r(struct _reent*, size_t num, size_t size)
+    {
+        return calloc(num, size);
+    }
+
+    void* _realloc_r(struct _reent*, void* ptr, size_t size)
+    {
+        return realloc(ptr, size);
+    }
+}
+
+void* operator new(size_t size)
+{
+    return SystemHeap::Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return SystemHeap::Allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return SystemHeap::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return SystemHeap::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    SystemHeap::Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    SystemHeap::Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    SystemHeap::Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    SystemHeap::Free(ptr);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef DSY_SYSTEM_HEAP_H
+#define DSY_SYSTEM_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/PoolHeap.h"
+
+/** Bytes of the default buffer of the SystemHeap, in the .bss (AXI SRAM).
+ *  0 leaves it out, then nothing can be allocated before SystemHeap::Init().
+ */
+#ifndef DSY_SYSTEM_HEAP_SIZE
+#define DSY_SYSTEM_HEAP_SIZE (64 * 1024)
+#endif
+
+namespace daisy
+{
+/** @brief Replaces newlib's malloc() and the global new with a PoolHeap
+ *  @ingroup system
+ *
+ *  newlib's allocator searches lists of free chunks of any size, so the
+ *  time of a malloc() depends on the history of the heap, and a program
+ *  that allocates and frees for a long time fragments it. Code that isn't
+ *  ours, e.g. a library that allocates in its constructors, often can't be
+ *  changed to use a MemoryArena instead.
+ *
+ *  This module defines malloc(), free(), calloc(), realloc(), the newlib
+ *  reentrant versions of them and the global new and delete, all backed by
+ *  a PoolHeap, with interrupts disabled while it's changed. It isn't part
+ *  of libdaisy.a, since then every program that uses operator delete would
+ *  link it: build the program with USE_POOL_MALLOC = 1 in its Makefile, or
+ *  with the CMake option DSY_USE_POOL_MALLOC, which compile
+ *  sys/system_heap.cpp into the program. Otherwise the functions of
+ *  SystemHeap don't link, and newlib's allocator is used.
+ *
+ *  The heap starts on a buffer of DSY_SYSTEM_HEAP_SIZE bytes in the AXI
+ *  SRAM, with the first allocation, which may well be in a constructor that
+ *  runs before main(). Init() moves it to another buffer, e.g. in the SDRAM
+ *  once it's initialized, as long as nothing is allocated on it.
+ *
+ *  Lock() at the end of the setup makes each later allocation call the
+ *  trap, which stops at a breakpoint by default, so an allocation in the
+ *  audio callback is found at once rather than by a dropout.
+ *
+ *  @code
+ *  hw.Init();
+ *  SystemHeap::Init(sdram_buffer, sizeof(sdram_buffer));
+ *  synth.Init(); // allocates
+ *  SystemHeap::Lock();
+ *  hw.PrintLine("heap: %u bytes", SystemHeap::GetStats().high_water_mark);
+ *  @endcode
+ */
+class SystemHeap
+{
+  public:
+    /** Called for each allocation after Lock(), with its size. The
+     *  allocation goes on when it returns.
+     */
+    typedef void (*TrapFunction)(size_t size);
+
+    /** Moves the heap to a buffer, e.g. in the SDRAM
+     *  \return false if something is allocated on the heap, or if the
+     *          config is invalid, see PoolHeap::Init()
+     */
+    static bool Init(void*                   buffer,
+                     size_t                  size,
+                     const PoolHeap::Config& config = PoolHeap::Config());
+
+    /** Calls the trap for each allocation from now on */
+    static void Lock();
+
+    /** Allows allocations again without the trap, e.g. for a patch change */
+    static void Unlock();
+
+    /** Replaces the trap, which stops at a breakpoint by default. nullptr
+     *  only counts the allocations after Lock().
+     */
+    static void SetTrap(TrapFunction trap);
+
+    /** Returns the usage of the heap, see PoolHeap::Stats */
+    static PoolHeap::Stats GetStats();
+
+    /** Returns the usage of a size class, for tuning PoolHeap::Config */
+    static PoolHeap::ClassStats GetClassStats(size_t idx);
+
+    static size_t GetNumClasses();
+
+    /** Allocates from the heap, for malloc() and new */
+    static void* Allocate(size_t size);
+
+    /** Frees to the heap, for free() and delete */
+    static void Free(void* ptr);
+
+    /** Resizes an allocation, for realloc() */
+    static void* Reallocate(void* ptr, size_t size);
+
+  private:
+    /** Starts the heap on the default buffer, if it isn't yet */
+    static bool Start();
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,84 @@
+#include "sys/timer_service.h"
+#include "sys/system.h"
+#include "util/scopedirqblocker.h"
+
+using namespace daisy;
+
+bool TimerService::Init(const Config& config)
+{
+    Stop();
+    wheel_.Init(GetNow());
+    if(config.tick_us == 0)
+        return false;
+
+    // TIM3 and TIM4 only count to 16 bits, the prescaler makes up the rest
+    const bool is_32bit
+        = config.periph == TimerHandle::Config::Peripheral::TIM_2
+          || config.periph == TimerHandle::Config::Peripheral::TIM_5;
+    const float ticks
+        = System::GetPClk1Freq() * 2.f * (config.tick_us / 1000000.f);
+    const float    max_ticks = is_32bit ? 4294967296.f : 65536.f;
+    const uint32_t prescaler = uint32_t(ticks / max_ticks);
+    if(ticks < 2.f || prescaler > 0xffff)
+        return false;
+
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = config.periph;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.period     = uint32_t(ticks / (prescaler + 1) + 0.5f) - 1;
+    tim_cfg.enable_irq = true;
+    if(tim_.Init(tim_cfg) != TimerHandle::Result::OK)
+        return false;
+    tim_.SetPrescaler(prescaler);
+    tim_.SetCallback(TimerCallback, this);
+    return true;
+}
+
+void TimerService::Start()
+{
+    if(!running_)
+    {
+        running_ = true;
+        tim_.Start();
+    }
+}
+
+void TimerService::Stop()
+{
+    if(running_)
+    {
+        tim_.Stop();
+        running_ = false;
+    }
+}
+
+void TimerService::Schedule(Timer& timer, uint32_t delay_us, uint32_t period_us)
+{
+    ScopedIrqBlocker irq_blocker;
+    wheel_.Schedule(timer, GetNow() + delay_us, period_us);
+}
+
+void TimerService::ScheduleAt(Timer&   timer,
+                              uint32_t time_us,
+                              uint32_t period_us)
+{
+    ScopedIrqBlocker irq_blocker;
+    wheel_.Schedule(timer, time_us, period_us);
+}
+
+bool TimerService::Cancel(Timer& timer)
+{
+    ScopedIrqBlocker irq_blocker;
+    return wheel_.Cancel(timer);
+}
+
+uint32_t TimerService::GetNow()
+{
+    return uint32_t(System::GetUs64());
+}
+
+void TimerService::TimerCallback(void* data)
+{
+    TimerService* service = static_cast<TimerService*>(data);
+    service->wheel_.Process(GetNow());
+}
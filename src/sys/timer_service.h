@@ -0,0 +1,100 @@
+#pragma once
+#ifndef DSY_TIMER_SERVICE_H
+#define DSY_TIMER_SERVICE_H
+
+#include <cstdint>
+#include "per/tim.h"
+#include "util/TimerWheel.h"
+
+namespace daisy
+{
+/** @brief Software timers on one hardware timer
+ *  @ingroup system
+ *
+ *  TimerHandle has one callback per hardware timer, so every periodic job
+ *  would need a timer of its own. The TimerService runs a TimerWheel from
+ *  the interrupt of one TimerHandle instead, with any number of one-shot
+ *  and periodic timers on it. The times are in us, from
+ *  System::GetUs64(), and a timer expires at the first tick of the
+ *  service at or after its deadline, so the tick sets the precision, and
+ *  how often the interrupt runs.
+ *
+ *  The callbacks run in the timer interrupt, and the timers can be
+ *  scheduled and cancelled from anywhere.
+ *
+ *  @code
+ *  TimerService        timers;
+ *  TimerService::Timer blink(ToggleLed, nullptr);
+ *  TimerService::Timer note_off(NoteOff, &voice);
+ *
+ *  timers.Init();
+ *  timers.Start();
+ *  timers.Schedule(blink, 500000, 500000);
+ *  timers.Schedule(note_off, 2500);
+ *  @endcode
+ */
+class TimerService
+{
+  public:
+    /** A timer, owned by the caller */
+    typedef TimerWheel::Timer Timer;
+
+    /** Settings of the service */
+    struct Config
+    {
+        /** Timer that runs the service, not TIM_2, which System uses */
+        TimerHandle::Config::Peripheral periph;
+
+        /** Time between two ticks in us */
+        uint32_t tick_us;
+
+        Config() : periph(TimerHandle::Config::Peripheral::TIM_3), tick_us(100)
+        {
+        }
+    };
+
+    TimerService() : running_(false) {}
+    ~TimerService() {}
+
+    /** Initializes the timer and cancels all timers
+     *  \return false if the timer can't run at the tick
+     */
+    bool Init(const Config& config = Config());
+
+    /** Starts the ticks */
+    void Start();
+
+    /** Stops the ticks, the timers stay scheduled */
+    void Stop();
+
+    /** Schedules a timer, or reschedules it if it's already scheduled
+     *  \param timer timer to schedule, it must stay in place while it's
+     *         scheduled
+     *  \param delay_us time from now to expire
+     *  \param period_us time between the later expiries, or 0 for a
+     *         one-shot timer
+     */
+    void Schedule(Timer& timer, uint32_t delay_us, uint32_t period_us = 0);
+
+    /** Schedules a timer to expire at a GetNow() time, see Schedule() */
+    void ScheduleAt(Timer& timer, uint32_t time_us, uint32_t period_us = 0);
+
+    /** Cancels a timer
+     *  \returns false if it wasn't scheduled
+     */
+    bool Cancel(Timer& timer);
+
+    /** Returns the time of the timers in us, wrapping at 32 bits */
+    static uint32_t GetNow();
+
+  private:
+    static void TimerCallback(void* data);
+
+    TimerHandle tim_;
+    TimerWheel  wheel_;
+    bool        running_;
+};
+
+} // namespace daisy
+
+#endif
@@ -154,15 +154,59 @@ void AbstractMenu::Init(const ItemConfig* items,
                         uint16_t          numItems,
                         Orientation       orientation,
                         bool              allowEntering)
+{
+    arraySource_.items    = items;
+    arraySource_.numItems = numItems;
+    Init(arraySource_, orientation, allowEntering);
+    items_ = items;
+}
+
+void AbstractMenu::Init(ItemSource& source,
+                        Orientation orientation,
+                        bool        allowEntering)
 {
     orientation_   = orientation;
-    items_         = items;
-    numItems_      = numItems;
+    source_        = &source;
+    items_         = nullptr;
+    numItems_      = source.GetNumItems();
     allowEntering_ = allowEntering;
 
-    selectedItemIdx_  = 0;
-    isEditing_        = false;
-    isFuncButtonDown_ = false;
+    selectedItemIdx_     = 0;
+    isEditing_           = false;
+    isFuncButtonDown_    = false;
+    firstVisibleItemIdx_ = 0;
+}
+
+void AbstractMenu::ItemsChanged()
+{
+    numItems_ = source_->GetNumItems();
+    if(selectedItemIdx_ >= numItems_)
+    {
+        selectedItemIdx_ = numItems_ > 0 ? numItems_ - 1 : 0;
+        isEditing_       = false;
+    }
+    Invalidate();
+}
+
+uint16_t AbstractMenu::GetFirstVisibleItemIdx(uint16_t numVisibleRows)
+{
+    if(numVisibleRows == 0 || numItems_ <= numVisibleRows)
+    {
+        firstVisibleItemIdx_ = 0;
+        return 0;
+    }
+
+    // scroll only as far as needed to show the selected item
+    const uint16_t selected = selectedItemIdx_ > 0 ? selectedItemIdx_ : 0;
+    if(selected < firstVisibleItemIdx_)
+        firstVisibleItemIdx_ = selected;
+    else if(selected >= firstVisibleItemIdx_ + numVisibleRows)
+        firstVisibleItemIdx_ = selected - numVisibleRows + 1;
+
+    // no empty rows at the end
+    if(firstVisibleItemIdx_ > numItems_ - numVisibleRows)
+        firstVisibleItemIdx_ = numItems_ - numVisibleRows;
+    return firstVisibleItemIdx_;
 }
 
 bool AbstractMenu::CanItemBeEnteredForEditing(uint16_t itemIdx)
@@ -170,7 +214,7 @@ bool AbstractMenu::CanItemBeEnteredForEditing(uint16_t itemIdx)
     if(itemIdx >= numItems_)
         return false;
 
-    const auto& item = items_[itemIdx];
+    const auto& item = GetItem(itemIdx);
     const auto  type = item.type;
     switch(type)
     {
@@ -192,7 +236,7 @@ void AbstractMenu::ModifyItemValue(uint16_t itemIdx,
     if(itemIdx >= numItems_)
         return;
 
-    const auto& item = items_[itemIdx];
+    const auto& item = GetItem(itemIdx);
     const auto  type = item.type;
     switch(type)
     {
@@ -219,7 +263,7 @@ void AbstractMenu::ModifyItemValue(uint16_t itemIdx,
     if(itemIdx >= numItems_)
         return;
 
-    const auto& item = items_[itemIdx];
+    const auto& item = GetItem(itemIdx);
     const auto  type = item.type;
     switch(type)
     {
@@ -246,7 +290,7 @@ void AbstractMenu::TriggerItemAction(uint16_t itemIdx)
     if(itemIdx >= numItems_)
         return;
 
-    const auto& item = items_[itemIdx];
+    const auto& item = GetItem(itemIdx);
     const auto  type = item.type;
     switch(type)
     {
@@ -23,6 +23,10 @@ namespace daisy
  * - Custom items that do whatever you want them to do, by providing a CustomItem object that 
  *   handles the item-specific functionality.
  * 
+ * The items are either an array of ItemConfig, or are provided by an ItemSource one at a 
+ * time, e.g. for long lists of files or presets that aren't held in memory. The menu only 
+ * asks for the items it's working on and the ones that are visible.
+ * 
  * The Abstract Menu can work with a wide variety of physical controls, here are a couple 
  * of combinations that are possible:
  * - 3 buttons: Left/Right to select and edit items, Ok to activate or enter/leave editing mode
@@ -185,15 +189,39 @@ class AbstractMenu : public UiPage
         };
     };
 
+    /** Provides the items of a menu by their index, so that they don't have to
+     *  exist all at once. */
+    class ItemSource
+    {
+      public:
+        virtual ~ItemSource() {}
+
+        /** Returns the number of items in the menu. */
+        virtual uint16_t GetNumItems() const = 0;
+
+        /** Returns an item. The ItemConfig and its text must stay valid until
+         *  this is called again, e.g. when they're in a buffer that's reused
+         *  for every item. */
+        virtual const ItemConfig& GetItem(uint16_t itemIdx) = 0;
+    };
+
     AbstractMenu() = default;
     virtual ~AbstractMenu() override {}
 
-    uint16_t          GetNumItems() const { return numItems_; }
+    uint16_t GetNumItems() const { return numItems_; }
+    /** Returns an item, which stays valid until the next call, 
+     *  see ItemSource::GetItem() */
     const ItemConfig& GetItem(uint16_t itemIdx) const
     {
-        return items_[itemIdx];
+        return source_->GetItem(itemIdx);
     }
     void    SelectItem(uint16_t itemIdx);
+
+    /** Call this when the items of the ItemSource have changed, e.g. when
+     *  there are more or fewer of them. The selected item is kept, if it 
+     *  still exists, and the menu is redrawn.
+     */
+    void ItemsChanged();
     int16_t GetSelectedItemIdx() const { return selectedItemIdx_; }
 
     // inherited from UiPage
@@ -232,13 +260,31 @@ class AbstractMenu : public UiPage
               Orientation       orientation,
               bool              allowEntering);
 
+    /** Call this from your child class to initialize the menu with items 
+     *  from an ItemSource. The ItemSource must stay alive longer than the menu.
+     * @param source            Provides the items of the menu.
+     * @param orientation       Controls which pair of arrow buttons are used for 
+     *                          selection / editing
+     * @param allowEntering     Globally controls if the Ok button can enter items 
+     *                          for editing, see above.
+     */
+    void Init(ItemSource& source, Orientation orientation, bool allowEntering);
+
+    /** For child classes that draw a list of items: Returns the index of the
+     *  first of `numVisibleRows` rows, scrolled so that the selected item is
+     *  visible. Only these items have to be drawn, and only they are fetched
+     *  with GetItem().
+     */
+    uint16_t GetFirstVisibleItemIdx(uint16_t numVisibleRows);
+
     /** Returns the state of the function button. */
     bool IsFunctionButtonDown() const { return isFuncButtonDown_; }
 
     /** The orientation of the menu. This is used to determine 
      *  which function the arrow keys will be assigned to. */
     Orientation orientation_ = Orientation::upDownSelectLeftRightModify;
-    /** A list of items to include in the menu. */
+    /** A list of items to include in the menu, or nullptr when they're 
+     *  provided by an ItemSource. Use GetItem() to access them. */
     const ItemConfig* items_ = nullptr;
     /** The number of items in `items_` */
     uint16_t numItems_ = 0;
@@ -256,6 +302,20 @@ class AbstractMenu : public UiPage
     AbstractMenu(const AbstractMenu& other) = delete;
     AbstractMenu& operator=(const AbstractMenu& other) = delete;
 
+    /** The ItemSource for menus initialized with an array */
+    class ArrayItemSource : public ItemSource
+    {
+      public:
+        uint16_t GetNumItems() const override { return numItems; }
+        const ItemConfig& GetItem(uint16_t itemIdx) override
+        {
+            return items[itemIdx];
+        }
+
+        const ItemConfig* items    = nullptr;
+        uint16_t          numItems = 0;
+    };
+
     bool CanItemBeEnteredForEditing(uint16_t itemIdx);
     void ModifyItemValue(uint16_t itemIdx,
                          int16_t  increments,
@@ -266,7 +326,10 @@ class AbstractMenu : public UiPage
                          bool     isFunctionButtonPressed);
     void TriggerItemAction(uint16_t itemIdx);
 
-    bool isFuncButtonDown_ = false;
+    bool            isFuncButtonDown_    = false;
+    ArrayItemSource arraySource_;
+    ItemSource*     source_              = &arraySource_;
+    uint16_t        firstVisibleItemIdx_ = 0;
 };
 
 
@@ -29,6 +29,13 @@ namespace daisy
  *
  *      bool IsButtonPressed(uint16_t buttonId);
  *
+ *  Alternatively, the backend can return the states of all buttons at once,
+ *  which the ButtonMonitor then reads in one loop instead of calling the
+ *  backend for each button. This is used instead, when the backend
+ *  implements it:
+ *
+ *      const bool* GetButtonStates(); // numButtons states, true if pressed
+ *
  *   @tparam BackendType     The class type of the backend that will supply button states.
  *   @tparam numButtons     The number of buttons to monitor.
  */
@@ -90,8 +97,7 @@ class ButtonMonitor
         const auto timeDiff = now - lastCallSysTime_;
         lastCallSysTime_    = now;
 
-        for(uint32_t i = 0; i < numButtons; i++)
-            ProcessButton(i, backend_->IsButtonPressed(i), timeDiff, now);
+        ReadAndProcessButtons(*backend_, timeDiff, now, 0);
     }
 
     /** Returns true, if the given button is currently pressed.
@@ -106,12 +112,40 @@ class ButtonMonitor
     }
 
     /** Returns the BackendType that is used by the monitor. */
-    BackendType& GetBackend() { return backend_; }
+    BackendType& GetBackend() { return *backend_; }
 
     /** Returns the number of buttons that are monitored by this class. */
     uint16_t GetNumButtonsMonitored() const { return numButtons; }
 
   private:
+    /** Used when the backend returns all states at once */
+    template <typename Backend>
+    auto ReadAndProcessButtons(Backend& backend,
+                               uint32_t timeInMsSinceLastCall,
+                               uint32_t currentSystemTime,
+                               int)
+        -> decltype(backend.GetButtonStates(), void())
+    {
+        const bool* states = backend.GetButtonStates();
+        for(uint32_t i = 0; i < numButtons; i++)
+            ProcessButton(
+                i, states[i], timeInMsSinceLastCall, currentSystemTime);
+    }
+
+    /** Used when the backend returns one state at a time */
+    template <typename Backend>
+    void ReadAndProcessButtons(Backend& backend,
+                               uint32_t timeInMsSinceLastCall,
+                               uint32_t currentSystemTime,
+                               long)
+    {
+        for(uint32_t i = 0; i < numButtons; i++)
+            ProcessButton(i,
+                          backend.IsButtonPressed(i),
+                          timeInMsSinceLastCall,
+                          currentSystemTime);
+    }
+
     void ProcessButton(uint16_t id,
                        bool     isPressed,
                        uint32_t timeInMsSinceLastCall,
@@ -10,6 +10,13 @@ void FullScreenItemMenu::Init(const AbstractMenu::ItemConfig* items,
     AbstractMenu::Init(items, numItems, orientation, allowEntering);
 }
 
+void FullScreenItemMenu::Init(AbstractMenu::ItemSource& source,
+                              AbstractMenu::Orientation orientation,
+                              bool                      allowEntering)
+{
+    AbstractMenu::Init(source, orientation, allowEntering);
+}
+
 void FullScreenItemMenu::SetOneBitGraphicsDisplayToDrawTo(uint16_t canvasId)
 {
     canvasIdToDrawTo_ = canvasId;
@@ -41,8 +48,8 @@ void FullScreenItemMenu::Draw(const UiCanvasDescriptor& canvas)
     // If we end uo here, this canvas is the one we should draw to.
     OneBitGraphicsDisplay& display = *(OneBitGraphicsDisplay*)(canvas.handle_);
 
-    // make the current LookAndFeel draw the item
-    const auto& item = items_[selectedItemIdx_];
+    // make the current LookAndFeel draw the item, the only one that's visible
+    const auto& item = GetItem(selectedItemIdx_);
     const auto  type = item.type;
     bool isVertical  = orientation_ == Orientation::upDownSelectLeftRightModify;
     switch(type)
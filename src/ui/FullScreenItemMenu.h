@@ -45,6 +45,21 @@ class FullScreenItemMenu : public AbstractMenu
               = AbstractMenu::Orientation::leftRightSelectUpDownModify,
               bool allowEntering = true);
 
+    /** Call this to initialize the menu with items that are provided
+     *  by an ItemSource, one at a time. Only the selected item is fetched
+     *  for drawing.
+     * @param source            Provides the items of the menu. It must stay
+     *                          alive longer than the menu.
+     * @param orientation       Controls which pair of arrow buttons are used for 
+     *                          selection / editing
+     * @param allowEntering     Globally controls if the Ok button can enter items 
+     *                          for editing, see above.
+     */
+    void Init(AbstractMenu::ItemSource& source,
+              AbstractMenu::Orientation orientation
+              = AbstractMenu::Orientation::leftRightSelectUpDownModify,
+              bool allowEntering = true);
+
     /** Call this to change which canvas this menu will draw to. The canvas
      *  must be a `OneBitGraphicsDisplay`, e.g. the `OledDisplay` class.
      *  If `canvasId == UI::invalidCanvasId` then this menu will draw to the
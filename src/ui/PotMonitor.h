@@ -30,6 +30,15 @@ namespace daisy
  *
  *      float GetPotValue(uint16_t potId);
  *
+ *  Alternatively, the backend can return the values of all pots at once,
+ *  e.g. as a pointer into the DMA buffer of the AdcHandle. The PotMonitor
+ *  then reads them in one loop instead of calling the backend for each pot.
+ *  Either of these is used when the backend implements it, instead of
+ *  `GetPotValue()`:
+ *
+ *      const float* GetPotValues();    // numPots values, 0 .. 1
+ *      const uint16_t* GetPotValues(); // numPots raw ADC values, 0 .. 65535
+ *
  *   @tparam BackendType     The class type of the backend that will supply pot values.
  *   @tparam numPots         The number of pots to monitor.
  */
@@ -86,8 +95,7 @@ class PotMonitor
         const auto timeDiff = now - lastCallSysTime_;
         lastCallSysTime_    = now;
 
-        for(uint32_t i = 0; i < numPots; i++)
-            ProcessPot(i, backend_->GetPotValue(i), timeDiff);
+        ReadAndProcessPots(*backend_, timeDiff, 0);
     }
 
     /** Returns true, if the requested pot is currently being moved.
@@ -114,12 +122,33 @@ class PotMonitor
     }
 
     /** Returns the BackendType that is used by the monitor. */
-    BackendType& GetBackend() { return backend_; }
+    BackendType& GetBackend() { return *backend_; }
 
     /** Returns the number of pots that are monitored by this class. */
     uint16_t GetNumPotsMonitored() const { return numPots; }
 
   private:
+    /** Used when the backend returns all values at once */
+    template <typename Backend>
+    auto ReadAndProcessPots(Backend& backend, uint32_t timeDiffMs, int)
+        -> decltype(backend.GetPotValues(), void())
+    {
+        const auto* values = backend.GetPotValues();
+        for(uint32_t i = 0; i < numPots; i++)
+            ProcessPot(i, ToPotValue(values[i]), timeDiffMs);
+    }
+
+    /** Used when the backend returns one value at a time */
+    template <typename Backend>
+    void ReadAndProcessPots(Backend& backend, uint32_t timeDiffMs, long)
+    {
+        for(uint32_t i = 0; i < numPots; i++)
+            ProcessPot(i, backend.GetPotValue(i), timeDiffMs);
+    }
+
+    static float ToPotValue(float value) { return value; }
+    static float ToPotValue(uint16_t value) { return value / 65536.0f; }
+
     /** Process a potentiometer and detect movements - or
      *  flags the pot as "idle" when no movement is detected for
      *  a longer period of time.
@@ -129,41 +158,29 @@ class PotMonitor
      */
     void ProcessPot(uint16_t id, float value, uint32_t timeDiffMs)
     {
-        // currently moving?
-        if(timeoutCounterMs_[id] < timeout_)
+        // the dead band depends on whether the pot is currently moving
+        const bool  isMoving = timeoutCounterMs_[id] < timeout_;
+        const float deadBand = isMoving ? deadBand_ : deadBandIdle_;
+        const float delta    = lastValue_[id] - value;
+
+        // check if pot has left the deadband. If so, add a new message
+        // to the queue and restart the timeout
+        if((delta > deadBand) || (delta < -deadBand))
         {
-            // check if pot has left the deadband. If so, add a new message
-            // to the queue.
-            float delta = lastValue_[id] - value;
-            if((delta > deadBand_) || (delta < -deadBand_))
-            {
-                lastValue_[id] = value;
-                queue_->AddPotMoved(id, value);
-                timeoutCounterMs_[id] = 0;
-            }
-            // no movement, increment timeout counter
-            else
-            {
-                timeoutCounterMs_[id] += timeDiffMs;
-                // post activity changed event after timeout expired.
-                if(timeoutCounterMs_[id] == timeout_)
-                {
-                    queue_->AddPotActivityChanged(id, false);
-                }
-            }
+            lastValue_[id] = value;
+            if(!isMoving)
+                queue_->AddPotActivityChanged(id, true);
+            queue_->AddPotMoved(id, value);
+            timeoutCounterMs_[id] = 0;
         }
-        // not moving right now
-        else
+        // no movement, increment timeout counter
+        else if(isMoving)
         {
-            // check if pot has left the idle deadband. If so, add a new message
-            // to the queue and restart the timeout
-            float delta = lastValue_[id] - value;
-            if((delta > deadBandIdle_) || (delta < -deadBandIdle_))
+            timeoutCounterMs_[id] += timeDiffMs;
+            // post activity changed event after timeout expired.
+            if(timeoutCounterMs_[id] == timeout_)
             {
-                lastValue_[id] = value;
-                queue_->AddPotActivityChanged(id, true);
-                queue_->AddPotMoved(id, value);
-                timeoutCounterMs_[id] = 0;
+                queue_->AddPotActivityChanged(id, false);
             }
         }
     }
@@ -9,6 +9,12 @@ void UiPage::Close()
         parent_->ClosePage(*this);
 }
 
+void UiPage::Invalidate()
+{
+    if(parent_ != nullptr)
+        parent_->Invalidate();
+}
+
 // =========================================================================
 
 // =========================================================================
@@ -28,7 +34,11 @@ void UI::Init(UiEventQueue&                             inputQueue,
     primaryOneBitGraphicsDisplayId_ = primaryOneBitGraphicsDisplayId;
 
     for(int i = 0; i < kMaxNumCanvases; i++)
+    {
         lastUpdateTimes_[i] = 0;
+        canvasInvalid_[i]   = true;
+        frameStats_[i]      = FrameStats();
+    }
 }
 
 UI::~UI()
@@ -61,6 +71,7 @@ void UI::Process()
             UiEventQueue::Event e = eventQueue_->GetAndRemoveNextEvent();
             if(e.type != UiEventQueue::Event::EventType::invalid)
             {
+                Invalidate();
                 ProcessEvent(e);
                 for(int32_t i = pages_.GetNumElements() - 1; i >= 0; i--)
                     pages_[i]->OnUserInteraction();
@@ -82,14 +93,23 @@ void UI::Process()
                   < canvases_[i].screenSaverTimeOut)
         {
             const uint32_t timeDiff = currentTimeInMs - lastUpdateTimes_[i];
-            if(timeDiff > canvases_[i].updateRateMs_)
-                RedrawCanvas(i, currentTimeInMs);
+            if(timeDiff > canvases_[i].updateRateMs_
+               && (canvasInvalid_[i] || IsCanvasAnimating(canvases_[i])))
+            {
+                // the buffer is still being sent, try again next time
+                if(IsFlushing(canvases_[i]))
+                    frameStats_[i].numDeferred++;
+                else
+                    RedrawCanvas(i, currentTimeInMs);
+            }
         }
-        else
+        else if(!canvases_[i].screenSaverOn && !IsFlushing(canvases_[i]))
         { // turn off oled
             canvases_[i].clearFunction_(canvases_[i]);
             canvases_[i].flushFunction_(canvases_[i]);
             canvases_[i].screenSaverOn = true;
+            // redraw when it's turned on again
+            canvasInvalid_[i] = true;
         }
     }
 }
@@ -125,6 +145,7 @@ void UI::OpenPage(UiPage& page)
         // Remove focus
         pages_[pages_.GetNumElements() - 2]->OnFocusLost();
     page.OnFocusGained();
+    Invalidate();
 }
 
 /** Called to close a page: */
@@ -160,6 +181,32 @@ void UI::ClosePage(UiPage& page)
     // close the page
     page.OnHide();
     page.parent_ = nullptr;
+    Invalidate();
+}
+
+void UI::Invalidate(uint16_t canvasId)
+{
+    for(uint32_t i = 0; i < canvases_.GetNumElements(); i++)
+    {
+        if(canvasId == invalidCanvasId || canvases_[i].id_ == canvasId)
+            canvasInvalid_[i] = true;
+    }
+}
+
+UI::FrameStats UI::GetFrameStats(uint16_t canvasId) const
+{
+    for(uint32_t i = 0; i < canvases_.GetNumElements(); i++)
+    {
+        if(canvases_[i].id_ == canvasId)
+            return frameStats_[i];
+    }
+    return FrameStats();
+}
+
+void UI::ResetFrameStats()
+{
+    for(int i = 0; i < kMaxNumCanvases; i++)
+        frameStats_[i] = FrameStats();
 }
 
 void UI::ProcessEvent(const UiEventQueue::Event& e)
@@ -254,9 +301,45 @@ void UI::ProcessEvent(const UiEventQueue::Event& e)
 
 void UI::RedrawCanvas(uint8_t index, uint32_t currentTimeInSysticks)
 {
-    UiCanvasDescriptor& canvas = canvases_[index];
+    UiCanvasDescriptor& canvas     = canvases_[index];
+    const uint32_t      startTimeUs = System::GetUs();
+
+    // cleared before drawing, so that Draw() can invalidate the next frame
+    canvasInvalid_[index] = false;
 
     // find the bottom most page to draw, then draw the pages upwards from there
+    const int firstToDraw = GetFirstPageToDraw(canvas);
+
+    // clear canvas
+    canvas.clearFunction_(canvas);
+
+    // draw pages
+    for(uint32_t i = firstToDraw; i < pages_.GetNumElements(); i++)
+    {
+        pages_[i]->Draw(canvas);
+    }
+
+    // flush canvas to the hardware
+    canvas.flushFunction_(canvas);
+    lastUpdateTimes_[index] = currentTimeInSysticks;
+
+    FrameStats&    stats   = frameStats_[index];
+    const uint32_t frameUs = System::GetUs() - startTimeUs;
+    stats.numFrames++;
+    stats.lastFrameUs = frameUs;
+    stats.totalFrameUs += frameUs;
+    if(frameUs > stats.maxFrameUs)
+        stats.maxFrameUs = frameUs;
+}
+
+bool UI::IsFlushing(const UiCanvasDescriptor& canvas) const
+{
+    return canvas.flushFinishedFunction_ != nullptr
+           && !canvas.flushFinishedFunction_(canvas);
+}
+
+int UI::GetFirstPageToDraw(const UiCanvasDescriptor& canvas)
+{
     int firstToDraw;
     for(firstToDraw = int(pages_.GetNumElements()) - 1; firstToDraw >= 0;
         firstToDraw--)
@@ -268,19 +351,19 @@ void UI::RedrawCanvas(uint8_t index, uint32_t currentTimeInSysticks)
     // all pages are transparent - start with the page on the bottom
     if(firstToDraw < 0)
         firstToDraw = 0;
+    return firstToDraw;
+}
 
-    // clear canvas
-    canvas.clearFunction_(canvas);
-
-    // draw pages
-    for(uint32_t i = firstToDraw; i < pages_.GetNumElements(); i++)
+bool UI::IsCanvasAnimating(const UiCanvasDescriptor& canvas)
+{
+    // pages hidden below an opaque page aren't drawn
+    for(uint32_t i = GetFirstPageToDraw(canvas); i < pages_.GetNumElements();
+        i++)
     {
-        pages_[i]->Draw(canvas);
+        if(pages_[i]->IsAnimating(canvas))
+            return true;
     }
-
-    // flush canvas to the hardware
-    canvas.flushFunction_(canvas);
-    lastUpdateTimes_[index] = currentTimeInSysticks;
+    return false;
 }
 
 void UI::ForwardToButtonHandler(const uint16_t buttonID,
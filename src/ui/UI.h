@@ -63,6 +63,16 @@ struct UiCanvasDescriptor
      */
     using FlushFuncPtr = void (*)(const UiCanvasDescriptor& canvasToFlush);
     FlushFuncPtr flushFunction_;
+
+    /** For a flush function that only starts a transfer, e.g. with
+     *  OledDisplay::StartUpdate(): returns true once the transfer is done,
+     *  e.g. OledDisplay::UpdateFinished(). The UI doesn't clear or draw the
+     *  canvas until then, so the buffer isn't changed while it's sent, and
+     *  keeps handling user input meanwhile. nullptr if the flush function
+     *  returns when it's done.
+     */
+    using FlushFinishedFuncPtr = bool (*)(const UiCanvasDescriptor& canvas);
+    FlushFinishedFuncPtr flushFinishedFunction_ = nullptr;
 };
 
 class OneBitGraphicsLookAndFeel;
@@ -329,6 +339,23 @@ class UiPage
      */
     virtual void Draw(const UiCanvasDescriptor& canvas) = 0;
 
+    /** Asks the parent UI to redraw its canvases. The UI only redraws a
+     *  canvas when something changed: call this when the content of the page
+     *  changes without user input, e.g. when a value is updated from the
+     *  audio callback. Pages are redrawn after user input, and when they are
+     *  opened or closed, without invalidating.
+     */
+    void Invalidate();
+
+    /** Returns true, if the page is animated on the canvas and should be
+     *  redrawn at the canvas' update rate, invalidated or not.
+     */
+    virtual bool IsAnimating(const UiCanvasDescriptor& canvas)
+    {
+        (void)(canvas); // silence unused variable warnings
+        return false;
+    }
+
     /** Returns a reference to the parent UI object, or nullptr if not added to any UI at the moment. */
     UI* GetParentUI() { return parent_; }
     /** Returns a reference to the parent UI object, or nullptr if not added to any UI at the moment. */
@@ -354,9 +381,12 @@ class UiPage
  * 
  *  Pages are drawn from the bottom up. Multiple abstract canvases can be 
  *  used for the drawing, where each canvas could be a graphics display, 
- *  LEDs, alphanumeric displays, etc. The UI system makes sure that drawing 
- *  is executed with a constant refresh rate that can be individually 
- *  specified for each canvas.
+ *  LEDs, alphanumeric displays, etc. A canvas is only redrawn when it was
+ *  invalidated - by user input, by opening or closing a page, or by
+ *  UiPage::Invalidate() - or when one of its visible pages is animating.
+ *  Redraws are limited to an update rate that can be individually
+ *  specified for each canvas. The time each redraw takes is measured, see
+ *  GetFrameStats().
  */
 class UI
 {
@@ -445,6 +475,49 @@ class UI
         return specialControlIds_;
     }
 
+    /** Marks a canvas to be redrawn by the next Process() call, or all
+     *  canvases if canvasId is UI::invalidCanvasId.
+     */
+    void Invalidate(uint16_t canvasId = invalidCanvasId);
+
+    /** The time taken to redraw a canvas, from clearing it to flushing it.
+     *  Flush functions that only start a transfer don't include the transfer.
+     *  Redraws that waited for the transfer of the previous one are counted
+     *  in numDeferred.
+     */
+    struct FrameStats
+    {
+        /** number of redraws */
+        uint32_t numFrames = 0;
+
+        /** duration of the last redraw in us */
+        uint32_t lastFrameUs = 0;
+
+        /** longest redraw in us */
+        uint32_t maxFrameUs = 0;
+
+        /** sum of all redraws in us */
+        uint64_t totalFrameUs = 0;
+
+        /** number of calls of UI::Process() that put a redraw off, as the
+         *  previous flush was still in progress */
+        uint32_t numDeferred = 0;
+
+        /** Returns the average duration of a redraw in us */
+        uint32_t GetAverageFrameUs() const
+        {
+            return numFrames > 0 ? uint32_t(totalFrameUs / numFrames) : 0;
+        }
+    };
+
+    /** Returns the frame time measurements of a canvas, or empty
+     *  measurements if there's no canvas with this ID.
+     */
+    FrameStats GetFrameStats(uint16_t canvasId) const;
+
+    /** Starts the frame time measurements of all canvases from scratch */
+    void ResetFrameStats();
+
   private:
     bool                                       isMuted_;
     bool                                       queueEvents_;
@@ -453,6 +526,8 @@ class UI
     Stack<UiPage*, kMaxNumPages>               pages_;
     Stack<UiCanvasDescriptor, kMaxNumCanvases> canvases_;
     uint32_t          lastUpdateTimes_[kMaxNumCanvases];
+    bool              canvasInvalid_[kMaxNumCanvases];
+    FrameStats        frameStats_[kMaxNumCanvases];
     uint32_t          lastEventTime_;
     UiEventQueue*     eventQueue_;
     SpecialControlIds specialControlIds_;
@@ -463,6 +538,9 @@ class UI
     void AddPage(UiPage* p);
     void ProcessEvent(const UiEventQueue::Event& m);
     void RedrawCanvas(uint8_t index, uint32_t currentTimeInMs);
+    int  GetFirstPageToDraw(const UiCanvasDescriptor& canvas);
+    bool IsCanvasAnimating(const UiCanvasDescriptor& canvas);
+    bool IsFlushing(const UiCanvasDescriptor& canvas) const;
     void ForwardToButtonHandler(uint16_t buttonID,
                                 uint8_t  numberOfPresses,
                                 bool     isRetriggering);
@@ -1,7 +1,7 @@
 #pragma once
 #include <stdint.h>
-#include "../util/FIFO.h"
-#include "../util/scopedirqblocker.h"
+#include <stddef.h>
+#include <atomic>
 
 namespace daisy
 {
@@ -11,8 +11,16 @@ namespace daisy
  * 
  * A queue that holds user interface events such as button presses or encoder turns.
  * The queue can be filled from hardware drivers and read from a UI object.
- * Access to the queue is protected by a ScopedIrqBlocker - that means it's safe to add
- * events from interrupt handlers.
+ *
+ * The queue is lock-free and doesn't disable interrupts. It has a single
+ * producer and a single consumer: events can be added from one interrupt
+ * handler, or from the main loop, while the UI reads them in the main loop.
+ * Events must not be added from two contexts that can interrupt each other.
+ *
+ * Consecutive pot movements of the same pot are coalesced into one event
+ * with the latest position, and consecutive turns of the same encoder into
+ * one event with the sum of the increments, as long as the UI hasn't read
+ * the event yet. Fast movements don't flood the queue that way.
  */
 class UiEventQueue
 {
@@ -110,7 +118,10 @@ class UiEventQueue
         };
     };
 
-    UiEventQueue() {}
+    UiEventQueue()
+    : head_(0), tail_(0), amendable_(kNotAmendable), dropped_(0)
+    {
+    }
     ~UiEventQueue() {}
 
     /** Adds a Event::EventType::buttonPressed event to the queue. */
@@ -123,8 +134,7 @@ class UiEventQueue
         e.asButtonPressed.id = buttonID;
         e.asButtonPressed.numSuccessivePresses = numSuccessivePresses;
         e.asButtonPressed.isRetriggering       = isRetriggering;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e, false);
     }
 
     /** Adds a Event::EventType::buttonReleased event to the queue. */
@@ -133,22 +143,34 @@ class UiEventQueue
         Event m;
         m.type                = Event::EventType::buttonReleased;
         m.asButtonReleased.id = buttonID;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(m);
+        Push(m, false);
     }
 
-    /** Adds a Event::EventType::encoderTurned event to the queue. */
+    /** Adds a Event::EventType::encoderTurned event to the queue, or adds
+     *  the increments to the last event if it's a turn of the same encoder.
+     */
     void AddEncoderTurned(uint16_t encoderID,
                           int16_t  increments,
                           uint16_t stepsPerRev)
     {
+        if(BeginAmending(Event::EventType::encoderTurned, encoderID))
+        {
+            auto&         last = GetNewest().asEncoderTurned;
+            const int32_t sum  = last.increments + increments;
+            const bool    fits = sum >= INT16_MIN && sum <= INT16_MAX
+                              && last.stepsPerRev == stepsPerRev;
+            if(fits)
+                last.increments = int16_t(sum);
+            EndAmending();
+            if(fits)
+                return;
+        }
         Event e;
         e.type                        = Event::EventType::encoderTurned;
         e.asEncoderTurned.id          = encoderID;
         e.asEncoderTurned.increments  = increments;
         e.asEncoderTurned.stepsPerRev = stepsPerRev;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e, true);
     }
 
     /** Adds a Event::EventType::encoderActivityChanged event to the queue. */
@@ -160,19 +182,25 @@ class UiEventQueue
         e.asEncoderActivityChanged.newActivityType
             = isActive ? Event::ActivityType::active
                        : Event::ActivityType::inactive;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e, false);
     }
 
-    /** Adds a Event::EventType::potMoved event to the queue. */
+    /** Adds a Event::EventType::potMoved event to the queue, or updates
+     *  the position of the last event if it's a move of the same pot.
+     */
     void AddPotMoved(uint16_t potId, float newPosition)
     {
+        if(BeginAmending(Event::EventType::potMoved, potId))
+        {
+            GetNewest().asPotMoved.newPosition = newPosition;
+            EndAmending();
+            return;
+        }
         Event e;
         e.type                   = Event::EventType::potMoved;
         e.asPotMoved.id          = potId;
         e.asPotMoved.newPosition = newPosition;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e, true);
     }
 
     /** Adds a Event::EventType::potActivityChanged event to the queue. */
@@ -184,35 +212,124 @@ class UiEventQueue
         e.asPotActivityChanged.newActivityType
             = isActive ? Event::ActivityType::active
                        : Event::ActivityType::inactive;
-        ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e, false);
     }
 
     /** Removes and returns an event from the queue. */
     Event GetAndRemoveNextEvent()
     {
-        ScopedIrqBlocker sIrqBl;
-        if(events_.IsEmpty())
-        {
-            Event m;
-            m.type = Event::EventType::invalid;
-            return m;
-        }
-        else
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        Event          e;
+        e.type = Event::EventType::invalid;
+        if(head == tail)
+            return e;
+        if(tail + 1 == head)
         {
-            return events_.PopFront();
+            // the newest event can't be amended any longer once it's read
+            uint32_t amendable = head;
+            if(!amendable_.compare_exchange_strong(amendable, kNotAmendable)
+               && amendable == kAmending)
+                return e;
         }
+        e = events_[tail & kMask];
+        tail_.store(tail + 1, std::memory_order_release);
+        return e;
     }
 
     /** Returns true, if the queue is empty. */
     bool IsQueueEmpty()
     {
-        ScopedIrqBlocker sIrqBl;
-        return events_.IsEmpty();
+        return !IsReadable(tail_.load(std::memory_order_relaxed));
+    }
+
+    /** Returns the number of events that were dropped because the queue
+     *  was full */
+    uint32_t GetNumDroppedEvents() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
     }
 
   private:
-    FIFO<Event, 256> events_;
+    static constexpr uint32_t kCapacity = 256;
+    static constexpr uint32_t kMask     = kCapacity - 1;
+
+    /** Values of amendable_ that aren't the position after an event */
+    static constexpr uint32_t kNotAmendable = 0;
+    static constexpr uint32_t kAmending     = UINT32_MAX;
+
+    /** Called by the consumer.
+     *  \return true, if the event at tail can be read
+     */
+    bool IsReadable(uint32_t tail) const
+    {
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        if(head == tail)
+            return false;
+        // the newest event is being amended by the producer
+        return !(tail + 1 == head
+                 && amendable_.load(std::memory_order_acquire) == kAmending);
+    }
+
+    /** Called by the producer while amending */
+    Event& GetNewest()
+    {
+        return events_[(head_.load(std::memory_order_relaxed) - 1) & kMask];
+    }
+
+    /** Called by the producer. Adds an event, which can be amended by the
+     *  next one if canBeAmended is true.
+     */
+    void Push(const Event& e, bool canBeAmended)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) >= kCapacity)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events_[head & kMask] = e;
+        // positions that collide with the special values aren't amended
+        uint32_t amendable = head + 1;
+        if(!canBeAmended || amendable == kAmending)
+            amendable = kNotAmendable;
+        // set before the event is visible, so the consumer sees it
+        amendable_.store(amendable, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    /** Called by the producer. Gets exclusive access to the newest event,
+     *  if the consumer hasn't read it yet and it's of the type and ID.
+     *  Call EndAmending() when it returns true.
+     */
+    bool BeginAmending(Event::EventType type, uint16_t id)
+    {
+        const uint32_t head     = head_.load(std::memory_order_relaxed);
+        uint32_t       expected = head;
+        if(expected == kNotAmendable
+           || !amendable_.compare_exchange_strong(expected, kAmending))
+            return false;
+        const Event&   last   = GetNewest();
+        const uint16_t lastId = last.type == Event::EventType::potMoved
+                                    ? last.asPotMoved.id
+                                    : last.asEncoderTurned.id;
+        if(last.type == type && lastId == id)
+            return true;
+        EndAmending();
+        return false;
+    }
+
+    void EndAmending()
+    {
+        amendable_.store(head_.load(std::memory_order_relaxed),
+                         std::memory_order_release);
+    }
+
+    Event                 events_[kCapacity];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<uint32_t> amendable_;
+    std::atomic<uint32_t> dropped_;
 };
 
-} // namespace daisy
\ No newline at end of file
+} // namespace daisy
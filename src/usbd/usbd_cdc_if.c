@@ -107,9 +107,13 @@ uint8_t UserRxBufferHS[APP_RX_DATA_SIZE];
 uint8_t UserTxBufferHS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
-CDC_ReceiveCallback rx_callback_fs = NULL;
-CDC_ReceiveCallback rx_callback_hs = NULL;
-void                dummy_rx_callback(uint8_t* buf, uint32_t* len)
+CDC_ReceiveCallback  rx_callback_fs = NULL;
+CDC_ReceiveCallback  rx_callback_hs = NULL;
+CDC_TransmitCallback tx_callback_fs = NULL;
+CDC_TransmitCallback tx_callback_hs = NULL;
+volatile uint8_t     rx_held_fs     = 0;
+volatile uint8_t     rx_held_hs     = 0;
+void                 dummy_rx_callback(uint8_t* buf, uint32_t* len)
 {
     // do nothing
 }
@@ -153,6 +157,8 @@ static int8_t CDC_Control_HS(uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Receive_HS(uint8_t* pbuf, uint32_t* Len);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
+static int8_t CDC_TransmitCplt_FS(uint8_t* pbuf, uint32_t* Len, uint8_t epnum);
+static int8_t CDC_TransmitCplt_HS(uint8_t* pbuf, uint32_t* Len, uint8_t epnum);
 
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
@@ -161,10 +167,18 @@ static int8_t CDC_Receive_HS(uint8_t* pbuf, uint32_t* Len);
   */
 
 USBD_CDC_ItfTypeDef USBD_Interface_fops_FS
-    = {CDC_Init_FS, CDC_DeInit_FS, CDC_Control_FS, CDC_Receive_FS};
+    = {CDC_Init_FS,
+       CDC_DeInit_FS,
+       CDC_Control_FS,
+       CDC_Receive_FS,
+       CDC_TransmitCplt_FS};
 
 USBD_CDC_ItfTypeDef USBD_Interface_fops_HS
-    = {CDC_Init_HS, CDC_DeInit_HS, CDC_Control_HS, CDC_Receive_HS};
+    = {CDC_Init_HS,
+       CDC_DeInit_HS,
+       CDC_Control_HS,
+       CDC_Receive_HS,
+       CDC_TransmitCplt_HS};
 
 /* Private functions ---------------------------------------------------------*/
 /**
@@ -179,6 +193,7 @@ static int8_t CDC_Init_FS(void)
     USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
     if(!rx_callback_fs)
         rx_callback_fs = dummy_rx_callback;
+    rx_held_fs = 0;
     return (USBD_OK);
     /* USER CODE END 3 */
 }
@@ -275,9 +290,12 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t* Len)
 {
     /* USER CODE BEGIN 6 */
     //  CDC_Transmit_FS(Buf, *Len);
-    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
-    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
     rx_callback_fs(Buf, Len);
+    if(!rx_held_fs)
+    {
+        USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
+        USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+    }
 
     return (USBD_OK);
     /* USER CODE END 6 */
@@ -300,6 +318,10 @@ uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
     /* USER CODE BEGIN 7 */
     USBD_CDC_HandleTypeDef* hcdc
         = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+    if(hcdc == NULL)
+    {
+        return USBD_FAIL;
+    }
     if(hcdc->TxState != 0)
     {
         return USBD_BUSY;
@@ -322,6 +344,7 @@ static int8_t CDC_Init_HS(void)
     USBD_CDC_SetRxBuffer(&hUsbDeviceHS, UserRxBufferHS);
     if(!rx_callback_hs)
         rx_callback_hs = dummy_rx_callback;
+    rx_held_hs = 0;
     return (USBD_OK);
     /* USER CODE END 8 */
 }
@@ -416,9 +439,12 @@ static int8_t CDC_Receive_HS(uint8_t* Buf, uint32_t* Len)
 {
     /* USER CODE BEGIN 11 */
     //CDC_Transmit_HS(Buf, *Len);
-    USBD_CDC_SetRxBuffer(&hUsbDeviceHS, &Buf[0]);
-    USBD_CDC_ReceivePacket(&hUsbDeviceHS);
     rx_callback_hs(Buf, Len);
+    if(!rx_held_hs)
+    {
+        USBD_CDC_SetRxBuffer(&hUsbDeviceHS, &Buf[0]);
+        USBD_CDC_ReceivePacket(&hUsbDeviceHS);
+    }
     return (USBD_OK);
     /* USER CODE END 11 */
 }
@@ -436,6 +462,10 @@ uint8_t CDC_Transmit_HS(uint8_t* Buf, uint16_t Len)
     /* USER CODE BEGIN 12 */
     USBD_CDC_HandleTypeDef* hcdc
         = (USBD_CDC_HandleTypeDef*)hUsbDeviceHS.pClassData;
+    if(hcdc == NULL)
+    {
+        return USBD_FAIL;
+    }
     if(hcdc->TxState != 0)
     {
         return USBD_BUSY;
@@ -458,6 +488,76 @@ void CDC_Set_Rx_Callback_HS(CDC_ReceiveCallback cb)
     rx_callback_hs = cb;
 }
 
+void CDC_Set_Tx_Callback_FS(CDC_TransmitCallback cb)
+{
+    tx_callback_fs = cb;
+}
+
+void CDC_Set_Tx_Callback_HS(CDC_TransmitCallback cb)
+{
+    tx_callback_hs = cb;
+}
+
+uint8_t CDC_Tx_Busy_FS(void)
+{
+    USBD_CDC_HandleTypeDef* hcdc
+        = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+    return hcdc != NULL && hcdc->TxState != 0;
+}
+
+uint8_t CDC_Tx_Busy_HS(void)
+{
+    USBD_CDC_HandleTypeDef* hcdc
+        = (USBD_CDC_HandleTypeDef*)hUsbDeviceHS.pClassData;
+    return hcdc != NULL && hcdc->TxState != 0;
+}
+
+void CDC_Hold_Rx_FS(void)
+{
+    rx_held_fs = 1;
+}
+
+void CDC_Hold_Rx_HS(void)
+{
+    rx_held_hs = 1;
+}
+
+void CDC_Release_Rx_FS(void)
+{
+    if(!rx_held_fs)
+        return;
+    rx_held_fs = 0;
+    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+}
+
+void CDC_Release_Rx_HS(void)
+{
+    if(!rx_held_hs)
+        return;
+    rx_held_hs = 0;
+    USBD_CDC_SetRxBuffer(&hUsbDeviceHS, UserRxBufferHS);
+    USBD_CDC_ReceivePacket(&hUsbDeviceHS);
+}
+
+/**
+  * @brief  Called when a transmission on the IN endpoint has completed,
+  *         from the USB interrupt.
+  */
+static int8_t CDC_TransmitCplt_FS(uint8_t* Buf, uint32_t* Len, uint8_t epnum)
+{
+    if(tx_callback_fs)
+        tx_callback_fs();
+    return (USBD_OK);
+}
+
+static int8_t CDC_TransmitCplt_HS(uint8_t* Buf, uint32_t* Len, uint8_t epnum)
+{
+    if(tx_callback_hs)
+        tx_callback_hs();
+    return (USBD_OK);
+}
+
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
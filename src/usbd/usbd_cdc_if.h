@@ -69,6 +69,9 @@ extern "C"
     */
     typedef void (*CDC_ReceiveCallback)(uint8_t* buf, uint32_t* size);
 
+    /** Called from the USB interrupt when a transmission has completed */
+    typedef void (*CDC_TransmitCallback)(void);
+
     /* USER CODE END EXPORTED_TYPES */
 
     /**
@@ -110,10 +113,26 @@ extern "C"
   * @brief Public functions declaration.
   * @{
   */
-    void    CDC_Set_Rx_Callback_FS(CDC_ReceiveCallback cb); /**< & */
-    void    CDC_Set_Rx_Callback_HS(CDC_ReceiveCallback cb); /**< & */
-    uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);    /**< & */
-    uint8_t CDC_Transmit_HS(uint8_t* Buf, uint16_t Len);    /**< & */
+    void    CDC_Set_Rx_Callback_FS(CDC_ReceiveCallback cb);  /**< & */
+    void    CDC_Set_Rx_Callback_HS(CDC_ReceiveCallback cb);  /**< & */
+    void    CDC_Set_Tx_Callback_FS(CDC_TransmitCallback cb); /**< & */
+    void    CDC_Set_Tx_Callback_HS(CDC_TransmitCallback cb); /**< & */
+    uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);     /**< & */
+    uint8_t CDC_Transmit_HS(uint8_t* Buf, uint16_t Len);     /**< & */
+
+    /** Returns 1 while a transmission is in flight */
+    uint8_t CDC_Tx_Busy_FS(void);
+    uint8_t CDC_Tx_Busy_HS(void); /**< & */
+
+    /** Called from the receive callback, to not receive the next packet
+     *  until CDC_Release_Rx is called. The host waits meanwhile. */
+    void CDC_Hold_Rx_FS(void);
+    void CDC_Hold_Rx_HS(void); /**< & */
+
+    /** Receives the next packet after CDC_Hold_Rx, does nothing when the
+     *  reception isn't held. Called with the USB interrupts masked. */
+    void CDC_Release_Rx_FS(void);
+    void CDC_Release_Rx_HS(void); /**< & */
 
     /* USER CODE BEGIN EXPORTED_FUNCTIONS */
 
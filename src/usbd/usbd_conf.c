@@ -24,6 +24,8 @@
 #include "stm32h7xx_hal.h"
 #include "usbd_def.h"
 #include "usbd_core.h"
+#include "usbd_cdc.h"
+#include "sys/irq_priority.h"
 
 /* USER CODE BEGIN Includes */
 
@@ -99,11 +101,11 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef *pcdHandle)
         __HAL_RCC_USB_OTG_FS_CLK_ENABLE();
 
         /* Peripheral interrupt init */
-        HAL_NVIC_SetPriority(OTG_FS_EP1_OUT_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_FS_EP1_OUT_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_FS_EP1_OUT_IRQn);
-        HAL_NVIC_SetPriority(OTG_FS_EP1_IN_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_FS_EP1_IN_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_FS_EP1_IN_IRQn);
-        HAL_NVIC_SetPriority(OTG_FS_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_FS_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
         /* USER CODE BEGIN USB_OTG_FS_MspInit 1 */
 
@@ -131,11 +133,11 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef *pcdHandle)
         __HAL_RCC_USB_OTG_HS_CLK_ENABLE();
 
         /* Peripheral interrupt init */
-        HAL_NVIC_SetPriority(OTG_HS_EP1_OUT_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_EP1_OUT_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_EP1_OUT_IRQn);
-        HAL_NVIC_SetPriority(OTG_HS_EP1_IN_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_EP1_IN_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_EP1_IN_IRQn);
-        HAL_NVIC_SetPriority(OTG_HS_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
         /* USER CODE BEGIN USB_OTG_HS_MspInit 1 */
 
@@ -457,6 +459,11 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
         HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, 0x80);
         HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x40);
         HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x80);
+        if(usbd_mode == USBD_MODE_AUDIO)
+        {
+            /* The feedback endpoint of the audio class */
+            HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, 0x10);
+        }
     }
     if(pdev->id == DEVICE_HS)
     {
@@ -509,7 +516,17 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
         HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_HS, 0x200);
         HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 0, 0x80);
-        HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 1, 0x174);
+        if(usbd_mode == USBD_MODE_AUDIO)
+        {
+            /* Room in the 4 KB for the feedback endpoint of the audio class
+             */
+            HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 1, 0x100);
+            HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 2, 0x10);
+        }
+        else
+        {
+            HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 1, 0x174);
+        }
     }
     return USBD_OK;
 }
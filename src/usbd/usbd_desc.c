@@ -23,6 +23,7 @@
 #include "usbd_core.h"
 #include "usbd_desc.h"
 #include "usbd_conf.h"
+#include "usbd_cdc.h"
 
 /* USER CODE BEGIN INCLUDE */
 
@@ -123,6 +124,7 @@
 
 static void Get_SerialNum(void);
 static void IntToUnicode(uint32_t value, uint8_t *pbuf, uint8_t len);
+static void SetDeviceClass(uint8_t *desc);
 
 /**
   * @}
@@ -314,6 +316,7 @@ __ALIGN_BEGIN uint8_t USBD_StringSerial[USB_SIZ_STRING_SERIAL] __ALIGN_END = {
 uint8_t *USBD_HS_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
     UNUSED(speed);
+    SetDeviceClass(USBD_HS_DeviceDesc);
     *length = sizeof(USBD_HS_DeviceDesc);
     return USBD_HS_DeviceDesc;
 }
@@ -449,6 +452,7 @@ uint8_t *USBD_HS_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 uint8_t *USBD_FS_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
     UNUSED(speed);
+    SetDeviceClass(USBD_FS_DeviceDesc);
     *length = sizeof(USBD_FS_DeviceDesc);
     return USBD_FS_DeviceDesc;
 }
@@ -609,6 +613,22 @@ static void IntToUnicode(uint32_t value, uint8_t *pbuf, uint8_t len)
         pbuf[2 * idx + 1] = 0;
     }
 }
+
+/**
+  * @brief  Set the device class for the mode, the audio and mass storage
+  *         classes are defined by their interfaces, and hosts must not bind
+  *         a CDC driver to them
+  * @param  desc: device descriptor
+  * @retval None
+  */
+static void SetDeviceClass(uint8_t *desc)
+{
+    uint8_t device_class = 0x02;
+    if(usbd_mode == USBD_MODE_AUDIO || usbd_mode == USBD_MODE_MSC)
+        device_class = 0x00;
+    desc[4] = device_class; /*bDeviceClass*/
+    desc[5] = device_class; /*bDeviceSubClass*/
+}
 /**
   * @}
   */
@@ -0,0 +1,871 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_msc.c
+  * @brief          : USB Mass Storage Class device, Bulk-Only Transport
+  ******************************************************************************
+  */
+
+#include "usbd_msc.h"
+#include "usbd_ctlreq.h"
+
+#define MSC_CBW_SIGNATURE 0x43425355U
+#define MSC_CSW_SIGNATURE 0x53425355U
+#define MSC_CSW_PASSED 0x00U
+#define MSC_CSW_FAILED 0x01U
+
+/** Bulk-Only Transport class requests */
+#define MSC_BOT_GET_MAX_LUN 0xFEU
+#define MSC_BOT_RESET 0xFFU
+
+/** Transport states */
+#define MSC_STATE_IDLE 0U     /* waiting for a CBW */
+#define MSC_STATE_DATA_IN 1U  /* sending the response of a command */
+#define MSC_STATE_MEDIA 2U    /* transferring the data of READ or WRITE */
+#define MSC_STATE_STATUS 3U   /* sending the CSW */
+#define MSC_STATE_STALLED 4U  /* the CSW follows when the host clears IN */
+#define MSC_STATE_RECOVERY 5U /* invalid CBW, stalled until a reset */
+
+/** Buffer states */
+#define MSC_SLOT_FREE 0U
+#define MSC_SLOT_READ 1U   /* to be read from the medium */
+#define MSC_SLOT_WRITE 2U  /* to be written to the medium */
+#define MSC_SLOT_LOADED 3U /* read, to be sent */
+#define MSC_SLOT_USB 4U    /* being sent or received */
+
+/** SCSI commands */
+#define SCSI_TEST_UNIT_READY 0x00U
+#define SCSI_REQUEST_SENSE 0x03U
+#define SCSI_INQUIRY 0x12U
+#define SCSI_MODE_SENSE6 0x1AU
+#define SCSI_START_STOP_UNIT 0x1BU
+#define SCSI_PREVENT_ALLOW_MEDIUM_REMOVAL 0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES 0x23U
+#define SCSI_READ_CAPACITY10 0x25U
+#define SCSI_READ10 0x28U
+#define SCSI_WRITE10 0x2AU
+#define SCSI_VERIFY10 0x2FU
+#define SCSI_SYNCHRONIZE_CACHE10 0x35U
+#define SCSI_MODE_SENSE10 0x5AU
+
+/** Sense keys and additional sense codes */
+#define SCSI_KEY_NONE 0x00U
+#define SCSI_KEY_NOT_READY 0x02U
+#define SCSI_KEY_MEDIUM_ERROR 0x03U
+#define SCSI_KEY_ILLEGAL_REQUEST 0x05U
+#define SCSI_KEY_UNIT_ATTENTION 0x06U
+#define SCSI_KEY_DATA_PROTECT 0x07U
+#define SCSI_ASC_WRITE_ERROR 0x0CU
+#define SCSI_ASC_READ_ERROR 0x11U
+#define SCSI_ASC_INVALID_COMMAND 0x20U
+#define SCSI_ASC_LBA_OUT_OF_RANGE 0x21U
+#define SCSI_ASC_INVALID_FIELD 0x24U
+#define SCSI_ASC_WRITE_PROTECTED 0x27U
+#define SCSI_ASC_MEDIUM_CHANGED 0x28U
+#define SCSI_ASC_MEDIUM_NOT_PRESENT 0x3AU
+
+#define MSC_BUFFER_SIZE (MSC_MEDIA_SECTORS * MSC_SECTOR_SIZE)
+
+static USBD_MSC_HandleTypeDef static_msc;
+static USBD_HandleTypeDef*    msc_pdev = NULL;
+
+/** In .bss, i.e. the AXI SRAM, which the IDMA of the SDMMC can reach.
+ *  Cache line aligned for the maintenance of the transfers. */
+static uint8_t msc_buffers[2][MSC_BUFFER_SIZE] __attribute__((aligned(32)));
+
+static uint8_t USBD_MSC_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
+static uint8_t USBD_MSC_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
+static uint8_t USBD_MSC_Setup(USBD_HandleTypeDef*   pdev,
+                              USBD_SetupReqTypedef* req);
+static uint8_t USBD_MSC_DataIn(USBD_HandleTypeDef* pdev, uint8_t epnum);
+static uint8_t USBD_MSC_DataOut(USBD_HandleTypeDef* pdev, uint8_t epnum);
+static uint8_t* USBD_MSC_GetCfgDesc(uint16_t* length);
+static uint8_t* USBD_MSC_GetDeviceQualifierDesc(uint16_t* length);
+
+USBD_ClassTypeDef USBD_MSC = {
+    USBD_MSC_Init,
+    USBD_MSC_DeInit,
+    USBD_MSC_Setup,
+    NULL, /* EP0_TxSent */
+    NULL, /* EP0_RxReady */
+    USBD_MSC_DataIn,
+    USBD_MSC_DataOut,
+    NULL, /* SOF */
+    NULL, /* IsoINIncomplete */
+    NULL, /* IsoOUTIncomplete */
+    USBD_MSC_GetCfgDesc,
+    USBD_MSC_GetCfgDesc,
+    USBD_MSC_GetCfgDesc,
+    USBD_MSC_GetDeviceQualifierDesc,
+};
+
+__ALIGN_BEGIN static uint8_t USBD_MSC_CfgDesc[USB_MSC_CONFIG_DESC_SIZ]
+    __ALIGN_END
+    = {
+        /* Configuration Descriptor */
+        0x09,
+        USB_DESC_TYPE_CONFIGURATION,
+        LOBYTE(USB_MSC_CONFIG_DESC_SIZ),
+        HIBYTE(USB_MSC_CONFIG_DESC_SIZ),
+        0x01, /* bNumInterfaces */
+        0x01, /* bConfigurationValue */
+        0x00, /* iConfiguration */
+        0xC0, /* bmAttributes: self powered */
+        0x32, /* MaxPower 100 mA */
+
+        /* Mass storage interface: SCSI transparent commands, Bulk-Only */
+        0x09, 0x04, 0x00, 0x00, 0x02, 0x08, 0x06, 0x50, 0x00,
+        /* Bulk IN endpoint */
+        0x07, 0x05, MSC_IN_EP, 0x02, LOBYTE(MSC_MAX_PACKET_SIZE),
+        HIBYTE(MSC_MAX_PACKET_SIZE), 0x00,
+        /* Bulk OUT endpoint */
+        0x07, 0x05, MSC_OUT_EP, 0x02, LOBYTE(MSC_MAX_PACKET_SIZE),
+        HIBYTE(MSC_MAX_PACKET_SIZE), 0x00,
+};
+
+__ALIGN_BEGIN static uint8_t
+    USBD_MSC_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END
+    = {
+        USB_LEN_DEV_QUALIFIER_DESC,
+        USB_DESC_TYPE_DEVICE_QUALIFIER,
+        0x00,
+        0x02,
+        0x00,
+        0x00,
+        0x00,
+        0x40,
+        0x01,
+        0x00,
+};
+
+/** Standard INQUIRY data of a removable direct access device, with the
+ *  vendor, product and revision strings */
+static const uint8_t MSC_InquiryData[36] = {
+    0x00, 0x80, 0x02, 0x02, 0x1F, 0x00, 0x00, 0x00, 'D', 'a', 'i', 's',
+    'y',  ' ',  ' ',  ' ',  'S',  'D',  ' ',  'C',  'a', 'r', 'd', ' ',
+    ' ',  ' ',  ' ',  ' ',  ' ',  ' ',  ' ',  ' ',  '1', '.', '0', '0',
+};
+
+static uint32_t MSC_GetLE32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t MSC_GetBE32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+           | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void MSC_PutLE32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void MSC_PutBE32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static void MSC_SetSense(USBD_MSC_HandleTypeDef* hmsc, uint8_t key, uint8_t asc)
+{
+    hmsc->senseKey = key;
+    hmsc->asc      = asc;
+}
+
+/** Drops the transfer in progress. A buffer the application is reading or
+ *  writing stays taken until it completes, and is used last. */
+static void MSC_ResetTransfer(USBD_MSC_HandleTypeDef* hmsc)
+{
+    for(uint8_t i = 0U; i < 2U; i++)
+    {
+        if(hmsc->ioTaken && hmsc->ioSlot == i)
+            hmsc->slot[i].stale = 1U;
+        else
+            hmsc->slot[i].state = MSC_SLOT_FREE;
+    }
+    hmsc->queueSlot = hmsc->ioTaken ? hmsc->ioSlot ^ 1U : 0U;
+    hmsc->usbSlot   = hmsc->queueSlot;
+    hmsc->mediaLeft = 0U;
+    hmsc->usbLeft   = 0U;
+    hmsc->usbBusy   = 0U;
+    hmsc->failed    = 0U;
+}
+
+static void MSC_ReceiveCBW(USBD_HandleTypeDef*     pdev,
+                           USBD_MSC_HandleTypeDef* hmsc)
+{
+    hmsc->state = MSC_STATE_IDLE;
+    (void)USBD_LL_PrepareReceive(
+        pdev, MSC_OUT_EP, (uint8_t*)hmsc->cbw, MSC_CBW_LENGTH);
+}
+
+/** Sends the status of the command. The next CBW is only received once
+ *  it's sent, so that its completion can't be taken for the response of
+ *  the next command. */
+static void MSC_SendCSW(USBD_HandleTypeDef* pdev, USBD_MSC_HandleTypeDef* hmsc)
+{
+    MSC_PutLE32(&hmsc->csw[0], MSC_CSW_SIGNATURE);
+    MSC_PutLE32(&hmsc->csw[4], hmsc->tag);
+    MSC_PutLE32(&hmsc->csw[8], hmsc->residue);
+    hmsc->csw[12] = hmsc->cswStatus;
+    hmsc->state   = MSC_STATE_STATUS;
+    (void)USBD_LL_Transmit(pdev, MSC_IN_EP, hmsc->csw, MSC_CSW_LENGTH);
+}
+
+/** Fails the command before its data phase. The data the host expects
+ *  from the device is cut off by a stall, the data it would send is
+ *  refused by one. */
+static void MSC_Fail(USBD_HandleTypeDef*     pdev,
+                     USBD_MSC_HandleTypeDef* hmsc,
+                     uint8_t                 key,
+                     uint8_t                 asc)
+{
+    MSC_SetSense(hmsc, key, asc);
+    hmsc->cswStatus = MSC_CSW_FAILED;
+    hmsc->residue   = hmsc->dataLength;
+    if(hmsc->dataLength == 0U)
+    {
+        MSC_SendCSW(pdev, hmsc);
+    }
+    else if(hmsc->cbwFlags & 0x80U)
+    {
+        (void)USBD_LL_StallEP(pdev, MSC_IN_EP);
+        hmsc->state = MSC_STATE_STALLED;
+    }
+    else
+    {
+        (void)USBD_LL_StallEP(pdev, MSC_OUT_EP);
+        MSC_SendCSW(pdev, hmsc);
+    }
+}
+
+/** Sends the first len bytes of the response, as many as the host asked
+ *  for. All responses are shorter than a packet, so a shorter one ends the
+ *  data phase. */
+static void MSC_SendResponse(USBD_HandleTypeDef*     pdev,
+                             USBD_MSC_HandleTypeDef* hmsc,
+                             uint32_t                len)
+{
+    len           = MIN(len, hmsc->dataLength);
+    hmsc->residue = hmsc->dataLength - len;
+    if(len == 0U)
+    {
+        MSC_SendCSW(pdev, hmsc);
+        return;
+    }
+    hmsc->state = MSC_STATE_DATA_IN;
+    (void)USBD_LL_Transmit(pdev, MSC_IN_EP, hmsc->response, len);
+}
+
+/** Fails the command unless the medium is ready
+ *  @retval 1 if it is */
+static uint8_t MSC_CheckMedium(USBD_HandleTypeDef*     pdev,
+                               USBD_MSC_HandleTypeDef* hmsc)
+{
+    if(hmsc->sectors == 0U)
+    {
+        MSC_Fail(pdev, hmsc, SCSI_KEY_NOT_READY, SCSI_ASC_MEDIUM_NOT_PRESENT);
+        return 0U;
+    }
+    if(hmsc->attention)
+    {
+        // once, so that the host reads the capacity again
+        hmsc->attention = 0U;
+        MSC_Fail(pdev, hmsc, SCSI_KEY_UNIT_ATTENTION, SCSI_ASC_MEDIUM_CHANGED);
+        return 0U;
+    }
+    return 1U;
+}
+
+/** Records the first error of the medium in a transfer, which the CSW of
+ *  the command reports */
+static void MSC_FailMedia(USBD_MSC_HandleTypeDef* hmsc, uint8_t asc)
+{
+    if(!hmsc->failed)
+    {
+        hmsc->failed = 1U;
+        MSC_SetSense(hmsc, SCSI_KEY_MEDIUM_ERROR, asc);
+    }
+}
+
+static void MSC_FinishMedia(USBD_HandleTypeDef*     pdev,
+                            USBD_MSC_HandleTypeDef* hmsc)
+{
+    hmsc->cswStatus = hmsc->failed ? MSC_CSW_FAILED : MSC_CSW_PASSED;
+    MSC_SendCSW(pdev, hmsc);
+}
+
+/** Moves the transfer along: queues the free buffers for the medium, and
+ *  starts the USB on the next one that's ready */
+static void MSC_Pump(USBD_HandleTypeDef* pdev, USBD_MSC_HandleTypeDef* hmsc)
+{
+    USBD_MSC_SlotTypeDef* s;
+    if(hmsc->state != MSC_STATE_MEDIA)
+        return;
+
+    if(!hmsc->write)
+    {
+        while(hmsc->mediaLeft > 0U
+              && hmsc->slot[hmsc->queueSlot].state == MSC_SLOT_FREE)
+        {
+            s        = &hmsc->slot[hmsc->queueSlot];
+            s->lba   = hmsc->mediaLba;
+            s->count = MIN(hmsc->mediaLeft, MSC_MEDIA_SECTORS);
+            s->state = MSC_SLOT_READ;
+            // after an error the rest is sent as zeros, without reading it
+            if(hmsc->failed)
+            {
+                USBD_memset(s->buff, 0, s->count * MSC_SECTOR_SIZE);
+                s->state = MSC_SLOT_LOADED;
+            }
+            hmsc->mediaLba += s->count;
+            hmsc->mediaLeft -= s->count;
+            hmsc->queueSlot ^= 1U;
+        }
+        s = &hmsc->slot[hmsc->usbSlot];
+        if(!hmsc->usbBusy && s->state == MSC_SLOT_LOADED)
+        {
+            s->state      = MSC_SLOT_USB;
+            hmsc->usbBusy = 1U;
+            (void)USBD_LL_Transmit(
+                pdev, MSC_IN_EP, s->buff, s->count * MSC_SECTOR_SIZE);
+        }
+    }
+    else
+    {
+        s = &hmsc->slot[hmsc->queueSlot];
+        if(!hmsc->usbBusy && hmsc->mediaLeft > 0U
+           && s->state == MSC_SLOT_FREE)
+        {
+            s->lba        = hmsc->mediaLba;
+            s->count      = MIN(hmsc->mediaLeft, MSC_MEDIA_SECTORS);
+            s->state      = MSC_SLOT_USB;
+            hmsc->usbBusy = 1U;
+            (void)USBD_LL_PrepareReceive(
+                pdev, MSC_OUT_EP, s->buff, s->count * MSC_SECTOR_SIZE);
+        }
+    }
+}
+
+/** Starts READ(10) or WRITE(10) */
+static void MSC_StartMedia(USBD_HandleTypeDef*     pdev,
+                           USBD_MSC_HandleTypeDef* hmsc,
+                           const uint8_t*          cb,
+                           uint8_t                 write)
+{
+    const uint32_t lba   = MSC_GetBE32(&cb[2]);
+    const uint32_t count = ((uint32_t)cb[7] << 8) | cb[8];
+    const uint8_t  in    = (hmsc->cbwFlags & 0x80U) != 0U;
+
+    if(!MSC_CheckMedium(pdev, hmsc))
+        return;
+    if(write && hmsc->readOnly)
+    {
+        MSC_Fail(pdev, hmsc, SCSI_KEY_DATA_PROTECT, SCSI_ASC_WRITE_PROTECTED);
+        return;
+    }
+    if(lba >= hmsc->sectors || count > hmsc->sectors - lba)
+    {
+        MSC_Fail(
+            pdev, hmsc, SCSI_KEY_ILLEGAL_REQUEST, SCSI_ASC_LBA_OUT_OF_RANGE);
+        return;
+    }
+    // the host has to expect the data of all sectors, in their direction
+    if(hmsc->dataLength != count * MSC_SECTOR_SIZE
+       || (count > 0U && in == write))
+    {
+        MSC_Fail(pdev, hmsc, SCSI_KEY_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+        return;
+    }
+    if(count == 0U)
+    {
+        MSC_SendCSW(pdev, hmsc);
+        return;
+    }
+
+    hmsc->write     = write;
+    hmsc->failed    = 0U;
+    hmsc->mediaLba  = lba;
+    hmsc->mediaLeft = count;
+    hmsc->usbLeft   = count;
+    hmsc->usbSlot   = hmsc->queueSlot;
+    hmsc->state     = MSC_STATE_MEDIA;
+    MSC_Pump(pdev, hmsc);
+}
+
+/** Runs the command of a received CBW */
+static void MSC_ProcessCBW(USBD_HandleTypeDef*     pdev,
+                           USBD_MSC_HandleTypeDef* hmsc)
+{
+    const uint8_t* cbw = (const uint8_t*)hmsc->cbw;
+    const uint8_t* cb  = &cbw[15];
+    uint8_t*       r   = hmsc->response;
+
+    if(USBD_LL_GetRxDataSize(pdev, MSC_OUT_EP) != MSC_CBW_LENGTH
+       || MSC_GetLE32(cbw) != MSC_CBW_SIGNATURE || cbw[13] > hmsc->maxLun
+       || cbw[14] < 1U || cbw[14] > 16U)
+    {
+        (void)USBD_LL_StallEP(pdev, MSC_IN_EP);
+        (void)USBD_LL_StallEP(pdev, MSC_OUT_EP);
+        hmsc->state = MSC_STATE_RECOVERY;
+        return;
+    }
+    hmsc->tag        = MSC_GetLE32(&cbw[4]);
+    hmsc->dataLength = MSC_GetLE32(&cbw[8]);
+    hmsc->cbwFlags   = cbw[12];
+    hmsc->residue    = hmsc->dataLength;
+    hmsc->cswStatus  = MSC_CSW_PASSED;
+
+    switch(cb[0])
+    {
+        case SCSI_TEST_UNIT_READY:
+        case SCSI_VERIFY10:
+        case SCSI_SYNCHRONIZE_CACHE10:
+            // the CSW of a write is only sent once it's on the medium
+            if(MSC_CheckMedium(pdev, hmsc))
+                MSC_SendCSW(pdev, hmsc);
+            break;
+
+        case SCSI_REQUEST_SENSE:
+            USBD_memset(r, 0, 18U);
+            r[0]  = 0x70U;
+            r[2]  = hmsc->senseKey;
+            r[7]  = 10U;
+            r[12] = hmsc->asc;
+            MSC_SetSense(hmsc, SCSI_KEY_NONE, 0U);
+            MSC_SendResponse(pdev, hmsc, 18U);
+            break;
+
+        case SCSI_INQUIRY:
+            if((cb[1] & 0x01U) == 0U)
+            {
+                USBD_memcpy(r, MSC_InquiryData, sizeof(MSC_InquiryData));
+                MSC_SendResponse(pdev, hmsc, sizeof(MSC_InquiryData));
+            }
+            else if(cb[2] == 0x00U)
+            {
+                // the vital product data pages: only this list
+                USBD_memset(r, 0, 5U);
+                r[3] = 1U;
+                MSC_SendResponse(pdev, hmsc, 5U);
+            }
+            else
+            {
+                MSC_Fail(pdev,
+                         hmsc,
+                         SCSI_KEY_ILLEGAL_REQUEST,
+                         SCSI_ASC_INVALID_FIELD);
+            }
+            break;
+
+        case SCSI_READ_CAPACITY10:
+            if(MSC_CheckMedium(pdev, hmsc))
+            {
+                MSC_PutBE32(&r[0], hmsc->sectors - 1U);
+                MSC_PutBE32(&r[4], MSC_SECTOR_SIZE);
+                MSC_SendResponse(pdev, hmsc, 8U);
+            }
+            break;
+
+        case SCSI_READ_FORMAT_CAPACITIES:
+            USBD_memset(r, 0, 12U);
+            r[3] = 8U;
+            MSC_PutBE32(&r[4], hmsc->sectors ? hmsc->sectors : 0xFFFFFFFFU);
+            r[8]  = hmsc->sectors ? 0x02U : 0x03U; /* formatted, or none */
+            r[10] = (uint8_t)(MSC_SECTOR_SIZE >> 8);
+            MSC_SendResponse(pdev, hmsc, 12U);
+            break;
+
+        case SCSI_MODE_SENSE6:
+            USBD_memset(r, 0, 4U);
+            r[0] = 3U;
+            r[2] = hmsc->readOnly ? 0x80U : 0x00U;
+            MSC_SendResponse(pdev, hmsc, 4U);
+            break;
+
+        case SCSI_MODE_SENSE10:
+            USBD_memset(r, 0, 8U);
+            r[1] = 6U;
+            r[3] = hmsc->readOnly ? 0x80U : 0x00U;
+            MSC_SendResponse(pdev, hmsc, 8U);
+            break;
+
+        case SCSI_START_STOP_UNIT:
+            // LoEj without Start: the host ejected the medium
+            if((cb[4] & 0x03U) == 0x02U)
+            {
+                hmsc->ejected = 1U;
+                hmsc->sectors = 0U;
+            }
+            MSC_SendCSW(pdev, hmsc);
+            break;
+
+        case SCSI_PREVENT_ALLOW_MEDIUM_REMOVAL: MSC_SendCSW(pdev, hmsc); break;
+
+        case SCSI_READ10: MSC_StartMedia(pdev, hmsc, cb, 0U); break;
+
+        case SCSI_WRITE10: MSC_StartMedia(pdev, hmsc, cb, 1U); break;
+
+        default:
+            MSC_Fail(
+                pdev, hmsc, SCSI_KEY_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND);
+            break;
+    }
+}
+
+/** Continues after the host cleared a stall, with the CSW of a failed
+ *  command, or the next CBW */
+static void MSC_ClearFeature(USBD_HandleTypeDef*     pdev,
+                             USBD_MSC_HandleTypeDef* hmsc,
+                             uint8_t                 ep)
+{
+    if(hmsc->state == MSC_STATE_RECOVERY)
+        (void)USBD_LL_StallEP(pdev, ep);
+    else if(ep == MSC_IN_EP && hmsc->state == MSC_STATE_STALLED)
+        MSC_SendCSW(pdev, hmsc);
+    else if(ep == MSC_OUT_EP && hmsc->state == MSC_STATE_IDLE)
+        MSC_ReceiveCBW(pdev, hmsc);
+}
+
+/**
+  * @brief  USBD_MSC_Init
+  *         Opens the endpoints, and waits for the first command.
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_MSC_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx)
+{
+    UNUSED(cfgidx);
+    USBD_MSC_HandleTypeDef* hmsc = &static_msc;
+
+    hmsc->alt          = 0U;
+    hmsc->maxLun       = 0U;
+    hmsc->slot[0].buff = msc_buffers[0];
+    hmsc->slot[1].buff = msc_buffers[1];
+    MSC_ResetTransfer(hmsc);
+    MSC_SetSense(hmsc, SCSI_KEY_NONE, 0U);
+
+    (void)USBD_LL_OpenEP(
+        pdev, MSC_IN_EP, USBD_EP_TYPE_BULK, MSC_MAX_PACKET_SIZE);
+    pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(
+        pdev, MSC_OUT_EP, USBD_EP_TYPE_BULK, MSC_MAX_PACKET_SIZE);
+    pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 1U;
+
+    pdev->pClassDataCmsit[pdev->classId] = (void*)hmsc;
+    pdev->pClassData = pdev->pClassDataCmsit[pdev->classId];
+    msc_pdev         = pdev;
+    MSC_ReceiveCBW(pdev, hmsc);
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DeInit
+  *         Closes the endpoints, and drops the transfer in progress.
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_MSC_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx)
+{
+    UNUSED(cfgidx);
+    USBD_MSC_HandleTypeDef* hmsc
+        = (USBD_MSC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(hmsc == NULL)
+        return (uint8_t)USBD_OK;
+
+    (void)USBD_LL_CloseEP(pdev, MSC_IN_EP);
+    pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 0U;
+    (void)USBD_LL_CloseEP(pdev, MSC_OUT_EP);
+    pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 0U;
+    MSC_ResetTransfer(hmsc);
+    hmsc->state                          = MSC_STATE_IDLE;
+    pdev->pClassDataCmsit[pdev->classId] = NULL;
+    pdev->pClassData                     = NULL;
+    msc_pdev                             = NULL;
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_Setup
+  *         Handles the Bulk-Only reset and Get Max LUN requests, and
+  *         continues the transport after the host clears a stall.
+  * @param  pdev: device instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t USBD_MSC_Setup(USBD_HandleTypeDef*   pdev,
+                              USBD_SetupReqTypedef* req)
+{
+    USBD_MSC_HandleTypeDef* hmsc
+        = (USBD_MSC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    uint16_t status_info = 0U;
+
+    if(hmsc == NULL)
+        return (uint8_t)USBD_FAIL;
+
+    switch(req->bmRequest & USB_REQ_TYPE_MASK)
+    {
+        case USB_REQ_TYPE_CLASS:
+            if(req->bRequest == MSC_BOT_GET_MAX_LUN && req->wValue == 0U
+               && req->wLength == 1U && (req->bmRequest & 0x80U) != 0U)
+            {
+                (void)USBD_CtlSendData(pdev, &hmsc->maxLun, 1U);
+            }
+            else if(req->bRequest == MSC_BOT_RESET && req->wValue == 0U
+                    && req->wLength == 0U && (req->bmRequest & 0x80U) == 0U)
+            {
+                // the host clears the stalls of both endpoints next
+                MSC_ResetTransfer(hmsc);
+                (void)USBD_LL_FlushEP(pdev, MSC_IN_EP);
+                MSC_ReceiveCBW(pdev, hmsc);
+            }
+            else
+            {
+                USBD_CtlError(pdev, req);
+                return (uint8_t)USBD_FAIL;
+            }
+            break;
+
+        case USB_REQ_TYPE_STANDARD:
+            if(pdev->dev_state != USBD_STATE_CONFIGURED)
+            {
+                USBD_CtlError(pdev, req);
+                return (uint8_t)USBD_FAIL;
+            }
+            switch(req->bRequest)
+            {
+                case USB_REQ_GET_STATUS:
+                    (void)USBD_CtlSendData(pdev, (uint8_t*)&status_info, 2U);
+                    break;
+
+                case USB_REQ_GET_INTERFACE:
+                    (void)USBD_CtlSendData(pdev, &hmsc->alt, 1U);
+                    break;
+
+                case USB_REQ_SET_INTERFACE:
+                    if(req->wValue != 0U)
+                    {
+                        USBD_CtlError(pdev, req);
+                        return (uint8_t)USBD_FAIL;
+                    }
+                    break;
+
+                case USB_REQ_CLEAR_FEATURE:
+                    // the core already cleared the stall and replied
+                    if((req->bmRequest & USB_REQ_RECIPIENT_MASK)
+                           == USB_REQ_RECIPIENT_ENDPOINT
+                       && req->wValue == USB_FEATURE_EP_HALT)
+                    {
+                        MSC_ClearFeature(pdev, hmsc, LOBYTE(req->wIndex));
+                    }
+                    break;
+
+                default:
+                    USBD_CtlError(pdev, req);
+                    return (uint8_t)USBD_FAIL;
+            }
+            break;
+
+        default:
+            USBD_CtlError(pdev, req);
+            return (uint8_t)USBD_FAIL;
+    }
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DataIn
+  *         Sends the CSW after a response, or the next buffer of a read,
+  *         and receives the next CBW after the CSW.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_MSC_DataIn(USBD_HandleTypeDef* pdev, uint8_t epnum)
+{
+    USBD_MSC_HandleTypeDef* hmsc
+        = (USBD_MSC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(hmsc == NULL)
+        return (uint8_t)USBD_FAIL;
+    if(epnum != (MSC_IN_EP & 0x7FU))
+        return (uint8_t)USBD_OK;
+
+    if(hmsc->state == MSC_STATE_DATA_IN)
+    {
+        MSC_SendCSW(pdev, hmsc);
+    }
+    else if(hmsc->state == MSC_STATE_STATUS)
+    {
+        MSC_ReceiveCBW(pdev, hmsc);
+    }
+    else if(hmsc->state == MSC_STATE_MEDIA && !hmsc->write && hmsc->usbBusy)
+    {
+        USBD_MSC_SlotTypeDef* s = &hmsc->slot[hmsc->usbSlot];
+        hmsc->residue -= s->count * MSC_SECTOR_SIZE;
+        hmsc->usbLeft -= s->count;
+        s->state      = MSC_SLOT_FREE;
+        hmsc->usbSlot = hmsc->usbSlot ^ 1U;
+        hmsc->usbBusy = 0U;
+        if(hmsc->usbLeft == 0U)
+            MSC_FinishMedia(pdev, hmsc);
+        else
+            MSC_Pump(pdev, hmsc);
+    }
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DataOut
+  *         Runs a received CBW, or queues a received buffer of a write for
+  *         the medium.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_MSC_DataOut(USBD_HandleTypeDef* pdev, uint8_t epnum)
+{
+    USBD_MSC_HandleTypeDef* hmsc
+        = (USBD_MSC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(hmsc == NULL)
+        return (uint8_t)USBD_FAIL;
+    if(epnum != MSC_OUT_EP)
+        return (uint8_t)USBD_OK;
+
+    if(hmsc->state == MSC_STATE_IDLE)
+    {
+        MSC_ProcessCBW(pdev, hmsc);
+    }
+    else if(hmsc->state == MSC_STATE_MEDIA && hmsc->write && hmsc->usbBusy)
+    {
+        USBD_MSC_SlotTypeDef* s = &hmsc->slot[hmsc->queueSlot];
+        hmsc->residue -= s->count * MSC_SECTOR_SIZE;
+        hmsc->mediaLba += s->count;
+        hmsc->mediaLeft -= s->count;
+        hmsc->queueSlot = hmsc->queueSlot ^ 1U;
+        hmsc->usbBusy   = 0U;
+        // after an error the rest is received, and dropped
+        if(hmsc->failed)
+        {
+            s->state = MSC_SLOT_FREE;
+            hmsc->usbLeft -= s->count;
+        }
+        else
+        {
+            s->state = MSC_SLOT_WRITE;
+        }
+        if(hmsc->usbLeft == 0U)
+            MSC_FinishMedia(pdev, hmsc);
+        else
+            MSC_Pump(pdev, hmsc);
+    }
+    return (uint8_t)USBD_OK;
+}
+
+static uint8_t* USBD_MSC_GetCfgDesc(uint16_t* length)
+{
+    *length = (uint16_t)sizeof(USBD_MSC_CfgDesc);
+    return USBD_MSC_CfgDesc;
+}
+
+static uint8_t* USBD_MSC_GetDeviceQualifierDesc(uint16_t* length)
+{
+    *length = (uint16_t)sizeof(USBD_MSC_DeviceQualifierDesc);
+    return USBD_MSC_DeviceQualifierDesc;
+}
+
+void USBD_MSC_SetMedium(uint32_t sectors, uint8_t readOnly)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    static_msc.sectors   = sectors;
+    static_msc.readOnly  = readOnly;
+    static_msc.attention = 1U;
+    static_msc.ejected   = 0U;
+    __set_PRIMASK(primask);
+}
+
+uint8_t USBD_MSC_IsEjected(void)
+{
+    return static_msc.ejected;
+}
+
+uint8_t USBD_MSC_IsIdle(void)
+{
+    return static_msc.state != MSC_STATE_MEDIA;
+}
+
+uint8_t USBD_MSC_GetMediaRequest(USBD_MSC_MediaRequest* req)
+{
+    USBD_MSC_HandleTypeDef* hmsc    = &static_msc;
+    uint8_t                 found   = 0U;
+    const uint32_t          primask = __get_PRIMASK();
+    __disable_irq();
+    for(uint8_t i = 0U; i < 2U && !found && !hmsc->ioTaken; i++)
+    {
+        const uint8_t         idx = hmsc->ioPrefer ^ i;
+        USBD_MSC_SlotTypeDef* s   = &hmsc->slot[idx];
+        if(s->state == MSC_SLOT_READ || s->state == MSC_SLOT_WRITE)
+        {
+            req->buff     = s->buff;
+            req->lba      = s->lba;
+            req->count    = s->count;
+            req->write    = s->state == MSC_SLOT_WRITE;
+            hmsc->ioTaken = 1U;
+            hmsc->ioSlot  = idx;
+            found         = 1U;
+        }
+    }
+    __set_PRIMASK(primask);
+    return found;
+}
+
+void USBD_MSC_CompleteMediaRequest(uint8_t ok)
+{
+    USBD_MSC_HandleTypeDef* hmsc    = &static_msc;
+    const uint32_t          primask = __get_PRIMASK();
+    __disable_irq();
+    if(hmsc->ioTaken)
+    {
+        USBD_MSC_SlotTypeDef* s = &hmsc->slot[hmsc->ioSlot];
+        hmsc->ioTaken           = 0U;
+        hmsc->ioPrefer          = hmsc->ioSlot ^ 1U;
+        if(s->stale)
+        {
+            s->stale = 0U;
+            s->state = MSC_SLOT_FREE;
+        }
+        else if(s->state == MSC_SLOT_READ)
+        {
+            if(!ok)
+            {
+                USBD_memset(s->buff, 0, s->count * MSC_SECTOR_SIZE);
+                MSC_FailMedia(hmsc, SCSI_ASC_READ_ERROR);
+            }
+            s->state = MSC_SLOT_LOADED;
+        }
+        else
+        {
+            if(!ok)
+                MSC_FailMedia(hmsc, SCSI_ASC_WRITE_ERROR);
+            s->state = MSC_SLOT_FREE;
+            hmsc->usbLeft -= s->count;
+            if(hmsc->usbLeft == 0U && msc_pdev != NULL
+               && hmsc->state == MSC_STATE_MEDIA)
+            {
+                MSC_FinishMedia(msc_pdev, hmsc);
+            }
+        }
+        if(msc_pdev != NULL)
+            MSC_Pump(msc_pdev, hmsc);
+    }
+    __set_PRIMASK(primask);
+}
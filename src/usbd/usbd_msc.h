@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_msc.h
+  * @brief          : USB Mass Storage Class device, Bulk-Only Transport
+  ******************************************************************************
+  * The class implements the Bulk-Only Transport and the SCSI commands that
+  * hosts send to a removable disk of 512 byte sectors. It doesn't access a
+  * medium itself: READ(10) and WRITE(10) are split into media requests of up
+  * to MSC_MEDIA_SECTORS sectors, that the application takes with
+  * USBD_MSC_GetMediaRequest() and runs outside of the USB interrupt, e.g.
+  * with multi-block DMA transfers of the SD card.
+  *
+  * Each request has one of two buffers. While the USB transfers one of
+  * them, the medium fills or drains the other one: reads are fetched ahead
+  * of the host, and the data of the host is received while the previous
+  * block is written. There is a single instance of the class.
+  ******************************************************************************
+  */
+
+#ifndef __USBD_MSC_H
+#define __USBD_MSC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "usbd_ioreq.h"
+
+/** Bytes per sector of the medium */
+#define MSC_SECTOR_SIZE 512U
+
+/** Sectors in each of the two buffers, i.e. the largest media request */
+#ifndef MSC_MEDIA_SECTORS
+#define MSC_MEDIA_SECTORS 16U
+#endif
+
+#define MSC_IN_EP 0x81U
+#define MSC_OUT_EP 0x01U
+#define MSC_MAX_PACKET_SIZE 64U
+
+#define USB_MSC_CONFIG_DESC_SIZ 32U
+
+#define MSC_CBW_LENGTH 31U
+#define MSC_CSW_LENGTH 13U
+
+    /** A transfer between a buffer of the class and the medium */
+    typedef struct
+    {
+        uint8_t* buff;
+        uint32_t lba;   /**< first sector */
+        uint32_t count; /**< sectors, up to MSC_MEDIA_SECTORS */
+        uint8_t  write; /**< 1 to write the buffer to the medium */
+    } USBD_MSC_MediaRequest;
+
+    typedef struct
+    {
+        uint8_t* buff;
+        uint32_t lba;
+        uint32_t count;
+        uint8_t  state;
+        uint8_t  stale; /**< from before a reset, only to be released */
+    } USBD_MSC_SlotTypeDef;
+
+    typedef struct
+    {
+        uint32_t cbw[(MSC_CBW_LENGTH + 4U) / 4U];
+        uint8_t  csw[MSC_CSW_LENGTH];
+        uint8_t  response[36];
+        uint8_t  maxLun;
+        uint8_t  alt;
+
+        uint8_t  state;
+        uint8_t  cbwFlags;
+        uint32_t tag;
+        uint32_t dataLength;
+        uint32_t residue;
+        uint8_t  cswStatus;
+        uint8_t  senseKey;
+        uint8_t  asc;
+
+        /** The medium, 0 sectors while there is none */
+        uint32_t sectors;
+        uint8_t  readOnly;
+        uint8_t  attention; /**< the medium changed since the last command */
+        uint8_t  ejected;
+
+        /** The READ(10) or WRITE(10) in progress */
+        uint8_t  write;
+        uint8_t  failed;
+        uint32_t mediaLba;  /**< next sector to fetch, or to receive */
+        uint32_t mediaLeft; /**< sectors left to fetch, or to receive */
+        uint32_t usbLeft;   /**< sectors left to send, or to write */
+        uint8_t  queueSlot;
+        uint8_t  usbSlot;
+        uint8_t  usbBusy;
+        uint8_t  ioTaken; /**< the application runs the request of ioSlot */
+        uint8_t  ioSlot;
+        uint8_t  ioPrefer;
+
+        /** The two buffers, in the order they're used */
+        USBD_MSC_SlotTypeDef slot[2];
+    } USBD_MSC_HandleTypeDef;
+
+    extern USBD_ClassTypeDef USBD_MSC;
+#define USBD_MSC_CLASS &USBD_MSC
+
+    /** Presents a medium to the host, which sees it as newly inserted.
+     *  \param sectors of MSC_SECTOR_SIZE bytes, 0 to remove the medium
+     *  \param readOnly 1 to refuse writes
+     */
+    void USBD_MSC_SetMedium(uint32_t sectors, uint8_t readOnly);
+
+    /** Returns 1 once the host ejected the medium, until the next
+     *  USBD_MSC_SetMedium()
+     */
+    uint8_t USBD_MSC_IsEjected(void);
+
+    /** Returns 1 while no command accesses the medium, i.e. it can be
+     *  removed without cutting off a transfer
+     */
+    uint8_t USBD_MSC_IsIdle(void);
+
+    /** Takes the next transfer for the medium, called outside of the USB
+     *  interrupt. Once it's done, USBD_MSC_CompleteMediaRequest() has to be
+     *  called before the next one can be taken.
+     *  \returns 1 if there is a transfer
+     */
+    uint8_t USBD_MSC_GetMediaRequest(USBD_MSC_MediaRequest* req);
+
+    /** Releases the buffer of the request taken last
+     *  \param ok 0 if the medium failed, which the host is told
+     */
+    void USBD_MSC_CompleteMediaRequest(uint8_t ok);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_MSC_H */
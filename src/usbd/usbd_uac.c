@@ -0,0 +1,641 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_uac.c
+  * @brief          : USB Audio Class 1.0 device class, asynchronous streaming
+  ******************************************************************************
+  */
+
+#include "usbd_uac.h"
+#include "usbd_ctlreq.h"
+
+#define UAC_RING_MASK (UAC_RING_FRAMES - 1U)
+#define UAC_RING_TARGET (UAC_RING_FRAMES / 2U)
+
+/** Audio class requests */
+#define UAC_SET_CUR 0x01U
+#define UAC_GET_CUR 0x81U
+
+/** The fill levels are averaged over 16 packets (in 1/16 frames), to
+ *  smooth out the audio blocks they are written and read in */
+#define UAC_FILL_AVG_SHIFT 4
+
+/** Change of the feedback, in 10.14 samples per frame, for each frame the
+ *  OUT ring is off half full. A drift of 100 ppm settles at ~20 frames. */
+#define UAC_FEEDBACK_GAIN 4
+
+#if(UAC_RING_FRAMES & UAC_RING_MASK) != 0
+#error "UAC_RING_FRAMES must be a power of two"
+#endif
+
+static USBD_UAC_HandleTypeDef static_uac;
+static USBD_HandleTypeDef*    uac_pdev = NULL;
+
+static uint8_t USBD_UAC_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
+static uint8_t USBD_UAC_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
+static uint8_t USBD_UAC_Setup(USBD_HandleTypeDef*   pdev,
+                              USBD_SetupReqTypedef* req);
+static uint8_t USBD_UAC_DataIn(USBD_HandleTypeDef* pdev, uint8_t epnum);
+static uint8_t USBD_UAC_DataOut(USBD_HandleTypeDef* pdev, uint8_t epnum);
+static uint8_t USBD_UAC_IsoINIncomplete(USBD_HandleTypeDef* pdev,
+                                        uint8_t             epnum);
+static uint8_t USBD_UAC_IsoOUTIncomplete(USBD_HandleTypeDef* pdev,
+                                         uint8_t             epnum);
+static uint8_t* USBD_UAC_GetCfgDesc(uint16_t* length);
+static uint8_t* USBD_UAC_GetDeviceQualifierDesc(uint16_t* length);
+
+USBD_ClassTypeDef USBD_UAC = {
+    USBD_UAC_Init,
+    USBD_UAC_DeInit,
+    USBD_UAC_Setup,
+    NULL, /* EP0_TxSent */
+    NULL, /* EP0_RxReady, the written controls are ignored */
+    USBD_UAC_DataIn,
+    USBD_UAC_DataOut,
+    NULL, /* SOF */
+    USBD_UAC_IsoINIncomplete,
+    USBD_UAC_IsoOUTIncomplete,
+    USBD_UAC_GetCfgDesc,
+    USBD_UAC_GetCfgDesc,
+    USBD_UAC_GetCfgDesc,
+    USBD_UAC_GetDeviceQualifierDesc,
+};
+
+// Type I PCM format, 2 channels of 16 bits at 48 kHz
+#define UAC_FORMAT_TYPE_I                                                  \
+    0x0B, 0x24, 0x02, 0x01, UAC_CHANNELS, UAC_SUBFRAME_SIZE, 0x10, 0x01,   \
+        LOBYTE(UAC_SAMPLE_RATE), HIBYTE(UAC_SAMPLE_RATE),                  \
+        (uint8_t)(UAC_SAMPLE_RATE >> 16)
+
+__ALIGN_BEGIN static uint8_t USBD_UAC_CfgDesc[USB_UAC_CONFIG_DESC_SIZ]
+    __ALIGN_END
+    = {
+        /* Configuration Descriptor */
+        0x09,
+        USB_DESC_TYPE_CONFIGURATION,
+        LOBYTE(USB_UAC_CONFIG_DESC_SIZ),
+        HIBYTE(USB_UAC_CONFIG_DESC_SIZ),
+        UAC_NUM_ITF, /* bNumInterfaces */
+        0x01,        /* bConfigurationValue */
+        0x00,        /* iConfiguration */
+        0xC0,        /* bmAttributes: self powered */
+        0x32,        /* MaxPower 100 mA */
+
+        /* Audio Control interface, without controls */
+        0x09, 0x04, UAC_AC_ITF, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+        /* Class-specific AC header: ADC 1.00, 52 bytes, streaming 1 and 2 */
+        0x0A, 0x24, 0x01, 0x00, 0x01, 0x34, 0x00, 0x02, UAC_OUT_ITF,
+        UAC_IN_ITF,
+        /* Input terminal 1: USB streaming, stereo */
+        0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00,
+        0x00,
+        /* Output terminal 2: speaker, from terminal 1 */
+        0x09, 0x24, 0x03, 0x02, 0x01, 0x03, 0x00, 0x01, 0x00,
+        /* Input terminal 3: microphone, stereo */
+        0x0C, 0x24, 0x02, 0x03, 0x01, 0x02, 0x00, 0x02, 0x03, 0x00, 0x00,
+        0x00,
+        /* Output terminal 4: USB streaming, from terminal 3 */
+        0x09, 0x24, 0x03, 0x04, 0x01, 0x01, 0x00, 0x03, 0x00,
+
+        /* OUT streaming interface, alternate 0 without bandwidth */
+        0x09, 0x04, UAC_OUT_ITF, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+        /* Alternate 1, the data and the feedback endpoints */
+        0x09, 0x04, UAC_OUT_ITF, 0x01, 0x02, 0x01, 0x02, 0x00, 0x00,
+        /* General: to terminal 1, 1 frame delay, PCM */
+        0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,
+        UAC_FORMAT_TYPE_I,
+        /* Isochronous asynchronous data endpoint, synced by 0x82 */
+        0x09, 0x05, UAC_OUT_EP, 0x05, LOBYTE(UAC_MAX_PACKET_SIZE),
+        HIBYTE(UAC_MAX_PACKET_SIZE), 0x01, 0x00, UAC_FEEDBACK_EP,
+        /* Class-specific endpoint, no controls */
+        0x07, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00,
+        /* Feedback endpoint, 10.14 format, every 8 ms */
+        0x09, 0x05, UAC_FEEDBACK_EP, 0x11, 0x03, 0x00, 0x01, 0x03, 0x00,
+
+        /* IN streaming interface, alternate 0 without bandwidth */
+        0x09, 0x04, UAC_IN_ITF, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+        /* Alternate 1, the data endpoint */
+        0x09, 0x04, UAC_IN_ITF, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+        /* General: from terminal 4, 1 frame delay, PCM */
+        0x07, 0x24, 0x01, 0x04, 0x01, 0x01, 0x00,
+        UAC_FORMAT_TYPE_I,
+        /* Isochronous asynchronous data endpoint */
+        0x09, 0x05, UAC_IN_EP, 0x05, LOBYTE(UAC_MAX_PACKET_SIZE),
+        HIBYTE(UAC_MAX_PACKET_SIZE), 0x01, 0x00, 0x00,
+        /* Class-specific endpoint, no controls */
+        0x07, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00,
+};
+
+__ALIGN_BEGIN static uint8_t
+    USBD_UAC_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END
+    = {
+        USB_LEN_DEV_QUALIFIER_DESC,
+        USB_DESC_TYPE_DEVICE_QUALIFIER,
+        0x00,
+        0x02,
+        0x00,
+        0x00,
+        0x00,
+        0x40,
+        0x01,
+        0x00,
+};
+
+static uint32_t UAC_Fill(uint32_t written, uint32_t read)
+{
+    return written - read;
+}
+
+/** Averages the fill level, in 1/16 frames */
+static int32_t UAC_AverageFill(int32_t* avg, uint32_t fill)
+{
+    *avg += (int32_t)(fill << UAC_FILL_AVG_SHIFT)
+            - (*avg >> UAC_FILL_AVG_SHIFT);
+    return *avg >> UAC_FILL_AVG_SHIFT;
+}
+
+/** Sends the samples per frame for the host to send, more when the OUT ring
+ *  is below half, and fewer above, within a frame either way */
+static void UAC_TransmitFeedback(USBD_HandleTypeDef*     pdev,
+                                 USBD_UAC_HandleTypeDef* huac)
+{
+    const int32_t fill = UAC_AverageFill(
+        &huac->outFillAvg, UAC_Fill(huac->outWritten, huac->outRead));
+    const int32_t nominal = (int32_t)UAC_NOMINAL_FRAMES << 14;
+    int32_t       value   = nominal
+                    + ((int32_t)(UAC_RING_TARGET << UAC_FILL_AVG_SHIFT) - fill)
+                          * UAC_FEEDBACK_GAIN / (1 << UAC_FILL_AVG_SHIFT);
+    if(value > nominal + (1 << 14))
+        value = nominal + (1 << 14);
+    else if(value < nominal - (1 << 14))
+        value = nominal - (1 << 14);
+
+    huac->feedback[0]  = (uint8_t)value;
+    huac->feedback[1]  = (uint8_t)(value >> 8);
+    huac->feedback[2]  = (uint8_t)(value >> 16);
+    huac->feedbackBusy = 1U;
+    (void)USBD_LL_Transmit(pdev, UAC_FEEDBACK_EP, huac->feedback, 3U);
+}
+
+/** Sends the next packet straight from the IN ring, a frame longer or
+ *  shorter when the ring is off half full */
+static void UAC_TransmitIn(USBD_HandleTypeDef*     pdev,
+                           USBD_UAC_HandleTypeDef* huac)
+{
+    const uint32_t fill = UAC_Fill(huac->inWritten, huac->inRead);
+    const int32_t  avg  = UAC_AverageFill(&huac->inFillAvg, fill);
+    const int32_t  target
+        = (int32_t)UAC_RING_TARGET << UAC_FILL_AVG_SHIFT;
+    const int32_t margin
+        = (int32_t)(UAC_NOMINAL_FRAMES / 4U) << UAC_FILL_AVG_SHIFT;
+
+    uint32_t frames = UAC_NOMINAL_FRAMES;
+    if(avg > target + margin)
+        frames++;
+    else if(avg < target - margin)
+        frames--;
+    if(frames > fill)
+        frames = fill;
+
+    const uint32_t start = huac->inRead & UAC_RING_MASK;
+    huac->inPending      = frames;
+    huac->inBusy         = 1U;
+    (void)USBD_LL_Transmit(pdev,
+                           UAC_IN_EP,
+                           (uint8_t*)&huac->inRing[start * UAC_CHANNELS],
+                           frames * UAC_FRAME_SIZE);
+}
+
+/** Receives the next packet straight into the OUT ring when a full packet
+ *  fits, or drops it */
+static void UAC_PrepareOut(USBD_HandleTypeDef*     pdev,
+                           USBD_UAC_HandleTypeDef* huac)
+{
+    const uint32_t fill = UAC_Fill(huac->outWritten, huac->outRead);
+    uint8_t*       buff = huac->outDiscardBuf;
+    huac->outDiscard    = 1U;
+    if(fill <= UAC_RING_FRAMES - UAC_MAX_FRAMES)
+    {
+        const uint32_t start = huac->outWritten & UAC_RING_MASK;
+        buff             = (uint8_t*)&huac->outRing[start * UAC_CHANNELS];
+        huac->outDiscard = 0U;
+    }
+    (void)USBD_LL_PrepareReceive(pdev, UAC_OUT_EP, buff, UAC_MAX_PACKET_SIZE);
+}
+
+static void UAC_OpenOut(USBD_HandleTypeDef* pdev, USBD_UAC_HandleTypeDef* huac)
+{
+    (void)USBD_LL_OpenEP(
+        pdev, UAC_OUT_EP, USBD_EP_TYPE_ISOC, UAC_MAX_PACKET_SIZE);
+    pdev->ep_out[UAC_OUT_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(pdev, UAC_FEEDBACK_EP, USBD_EP_TYPE_ISOC, 3U);
+    pdev->ep_in[UAC_FEEDBACK_EP & 0xFU].is_used = 1U;
+
+    huac->outFillAvg = 0;
+    huac->outActive  = 1U;
+    UAC_PrepareOut(pdev, huac);
+    UAC_TransmitFeedback(pdev, huac);
+}
+
+static void UAC_CloseOut(USBD_HandleTypeDef*     pdev,
+                         USBD_UAC_HandleTypeDef* huac)
+{
+    huac->outActive    = 0U;
+    huac->feedbackBusy = 0U;
+    (void)USBD_LL_CloseEP(pdev, UAC_OUT_EP);
+    pdev->ep_out[UAC_OUT_EP & 0xFU].is_used = 0U;
+    (void)USBD_LL_CloseEP(pdev, UAC_FEEDBACK_EP);
+    pdev->ep_in[UAC_FEEDBACK_EP & 0xFU].is_used = 0U;
+}
+
+static void UAC_OpenIn(USBD_HandleTypeDef* pdev, USBD_UAC_HandleTypeDef* huac)
+{
+    (void)USBD_LL_OpenEP(
+        pdev, UAC_IN_EP, USBD_EP_TYPE_ISOC, UAC_MAX_PACKET_SIZE);
+    pdev->ep_in[UAC_IN_EP & 0xFU].is_used = 1U;
+
+    // The ring filled up while the host wasn't recording, drop the oldest
+    // frames down to half
+    if(UAC_Fill(huac->inWritten, huac->inRead) > UAC_RING_TARGET)
+        huac->inRead = huac->inWritten - UAC_RING_TARGET;
+    huac->inFillAvg = (int32_t)UAC_RING_TARGET << (2 * UAC_FILL_AVG_SHIFT);
+    UAC_TransmitIn(pdev, huac);
+}
+
+static void UAC_CloseIn(USBD_HandleTypeDef* pdev, USBD_UAC_HandleTypeDef* huac)
+{
+    huac->inBusy    = 0U;
+    huac->inPending = 0U;
+    (void)USBD_LL_CloseEP(pdev, UAC_IN_EP);
+    pdev->ep_in[UAC_IN_EP & 0xFU].is_used = 0U;
+}
+
+static uint8_t UAC_SetInterface(USBD_HandleTypeDef*     pdev,
+                                USBD_UAC_HandleTypeDef* huac,
+                                uint8_t                 itf,
+                                uint8_t                 alt)
+{
+    if(itf >= UAC_NUM_ITF || alt > (itf == UAC_AC_ITF ? 0U : 1U))
+        return 0U;
+    if(alt == huac->alt[itf])
+        return 1U;
+
+    huac->alt[itf] = alt;
+    if(itf == UAC_OUT_ITF)
+    {
+        if(alt == 1U)
+            UAC_OpenOut(pdev, huac);
+        else
+            UAC_CloseOut(pdev, huac);
+    }
+    else if(itf == UAC_IN_ITF)
+    {
+        if(alt == 1U)
+            UAC_OpenIn(pdev, huac);
+        else
+            UAC_CloseIn(pdev, huac);
+    }
+    return 1U;
+}
+
+/**
+  * @brief  USBD_UAC_Init
+  *         Initializes the class, with both streams closed.
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_UAC_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx)
+{
+    UNUSED(cfgidx);
+    USBD_UAC_HandleTypeDef* huac = &static_uac;
+
+    huac->alt[UAC_AC_ITF]  = 0U;
+    huac->alt[UAC_OUT_ITF] = 0U;
+    huac->alt[UAC_IN_ITF]  = 0U;
+    huac->outActive        = 0U;
+    huac->feedbackBusy     = 0U;
+    huac->inBusy           = 0U;
+    huac->inPending        = 0U;
+
+    pdev->pClassDataCmsit[pdev->classId] = (void*)huac;
+    pdev->pClassData = pdev->pClassDataCmsit[pdev->classId];
+    uac_pdev         = pdev;
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_DeInit
+  *         Closes the open streams.
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_UAC_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx)
+{
+    UNUSED(cfgidx);
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(huac == NULL)
+        return (uint8_t)USBD_OK;
+
+    (void)UAC_SetInterface(pdev, huac, UAC_OUT_ITF, 0U);
+    (void)UAC_SetInterface(pdev, huac, UAC_IN_ITF, 0U);
+    pdev->pClassDataCmsit[pdev->classId] = NULL;
+    pdev->pClassData                     = NULL;
+    uac_pdev                             = NULL;
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_Setup
+  *         Handles the alternate settings of the streaming interfaces, and
+  *         the sampling frequency requests. The rate is fixed: reads
+  *         return it, and writes are accepted and ignored.
+  * @param  pdev: device instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t USBD_UAC_Setup(USBD_HandleTypeDef*   pdev,
+                              USBD_SetupReqTypedef* req)
+{
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    uint16_t status_info = 0U;
+    uint16_t len;
+
+    if(huac == NULL)
+        return (uint8_t)USBD_FAIL;
+
+    switch(req->bmRequest & USB_REQ_TYPE_MASK)
+    {
+        case USB_REQ_TYPE_CLASS:
+            if(req->bRequest == UAC_GET_CUR && req->wLength != 0U)
+            {
+                huac->control[0] = LOBYTE(UAC_SAMPLE_RATE);
+                huac->control[1] = HIBYTE(UAC_SAMPLE_RATE);
+                huac->control[2] = (uint8_t)(UAC_SAMPLE_RATE >> 16);
+                len              = MIN(req->wLength, 3U);
+                (void)USBD_CtlSendData(pdev, huac->control, len);
+            }
+            else if(req->bRequest == UAC_SET_CUR && req->wLength != 0U)
+            {
+                len = MIN(req->wLength, sizeof(huac->control));
+                (void)USBD_CtlPrepareRx(pdev, huac->control, len);
+            }
+            else
+            {
+                USBD_CtlError(pdev, req);
+                return (uint8_t)USBD_FAIL;
+            }
+            break;
+
+        case USB_REQ_TYPE_STANDARD:
+            if(pdev->dev_state != USBD_STATE_CONFIGURED)
+            {
+                USBD_CtlError(pdev, req);
+                return (uint8_t)USBD_FAIL;
+            }
+            switch(req->bRequest)
+            {
+                case USB_REQ_GET_STATUS:
+                    (void)USBD_CtlSendData(pdev, (uint8_t*)&status_info, 2U);
+                    break;
+
+                case USB_REQ_GET_INTERFACE:
+                    if(LOBYTE(req->wIndex) >= UAC_NUM_ITF)
+                    {
+                        USBD_CtlError(pdev, req);
+                        return (uint8_t)USBD_FAIL;
+                    }
+                    (void)USBD_CtlSendData(
+                        pdev, &huac->alt[LOBYTE(req->wIndex)], 1U);
+                    break;
+
+                case USB_REQ_SET_INTERFACE:
+                    if(!UAC_SetInterface(pdev,
+                                         huac,
+                                         LOBYTE(req->wIndex),
+                                         LOBYTE(req->wValue)))
+                    {
+                        USBD_CtlError(pdev, req);
+                        return (uint8_t)USBD_FAIL;
+                    }
+                    break;
+
+                case USB_REQ_CLEAR_FEATURE: break;
+
+                default:
+                    USBD_CtlError(pdev, req);
+                    return (uint8_t)USBD_FAIL;
+            }
+            break;
+
+        default:
+            USBD_CtlError(pdev, req);
+            return (uint8_t)USBD_FAIL;
+    }
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_DataIn
+  *         Releases the frames of the sent IN packet and sends the next,
+  *         or sends the next feedback.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_UAC_DataIn(USBD_HandleTypeDef* pdev, uint8_t epnum)
+{
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(huac == NULL)
+        return (uint8_t)USBD_FAIL;
+
+    if(epnum == (UAC_IN_EP & 0x7FU) && huac->alt[UAC_IN_ITF] == 1U)
+    {
+        huac->inRead += huac->inPending;
+        UAC_TransmitIn(pdev, huac);
+    }
+    else if(epnum == (UAC_FEEDBACK_EP & 0x7FU)
+            && huac->alt[UAC_OUT_ITF] == 1U)
+    {
+        UAC_TransmitFeedback(pdev, huac);
+    }
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_DataOut
+  *         Adds the received packet to the OUT ring, and receives the next.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_UAC_DataOut(USBD_HandleTypeDef* pdev, uint8_t epnum)
+{
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(huac == NULL)
+        return (uint8_t)USBD_FAIL;
+    if(epnum != UAC_OUT_EP || huac->alt[UAC_OUT_ITF] != 1U)
+        return (uint8_t)USBD_OK;
+
+    uint32_t frames = USBD_LL_GetRxDataSize(pdev, epnum) / UAC_FRAME_SIZE;
+    if(!huac->outDiscard && frames > 0U)
+    {
+        if(frames > UAC_MAX_FRAMES)
+            frames = UAC_MAX_FRAMES;
+        // Move the part that was received past the end to the start
+        const uint32_t start = huac->outWritten & UAC_RING_MASK;
+        if(start + frames > UAC_RING_FRAMES)
+        {
+            USBD_memcpy(huac->outRing,
+                        &huac->outRing[UAC_RING_FRAMES * UAC_CHANNELS],
+                        (start + frames - UAC_RING_FRAMES) * UAC_FRAME_SIZE);
+        }
+        __DMB();
+        huac->outWritten += frames;
+    }
+    UAC_PrepareOut(pdev, huac);
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_IsoINIncomplete
+  *         Sends the IN packet or the feedback again when the host didn't
+  *         read it in its frame, e.g. between the feedback polls.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_UAC_IsoINIncomplete(USBD_HandleTypeDef* pdev,
+                                        uint8_t             epnum)
+{
+    UNUSED(epnum);
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(huac == NULL)
+        return (uint8_t)USBD_FAIL;
+
+    if(huac->alt[UAC_IN_ITF] == 1U && huac->inBusy)
+    {
+        const uint32_t start = huac->inRead & UAC_RING_MASK;
+        (void)USBD_LL_FlushEP(pdev, UAC_IN_EP);
+        (void)USBD_LL_Transmit(pdev,
+                               UAC_IN_EP,
+                               (uint8_t*)&huac->inRing[start * UAC_CHANNELS],
+                               huac->inPending * UAC_FRAME_SIZE);
+    }
+    if(huac->alt[UAC_OUT_ITF] == 1U && huac->feedbackBusy)
+    {
+        (void)USBD_LL_FlushEP(pdev, UAC_FEEDBACK_EP);
+        UAC_TransmitFeedback(pdev, huac);
+    }
+    return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_UAC_IsoOUTIncomplete
+  *         Receives the next OUT packet after one was missed.
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_UAC_IsoOUTIncomplete(USBD_HandleTypeDef* pdev,
+                                         uint8_t             epnum)
+{
+    UNUSED(epnum);
+    USBD_UAC_HandleTypeDef* huac
+        = (USBD_UAC_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
+    if(huac == NULL)
+        return (uint8_t)USBD_FAIL;
+
+    if(huac->alt[UAC_OUT_ITF] == 1U)
+        UAC_PrepareOut(pdev, huac);
+    return (uint8_t)USBD_OK;
+}
+
+static uint8_t* USBD_UAC_GetCfgDesc(uint16_t* length)
+{
+    *length = (uint16_t)sizeof(USBD_UAC_CfgDesc);
+    return USBD_UAC_CfgDesc;
+}
+
+static uint8_t* USBD_UAC_GetDeviceQualifierDesc(uint16_t* length)
+{
+    *length = (uint16_t)sizeof(USBD_UAC_DeviceQualifierDesc);
+    return USBD_UAC_DeviceQualifierDesc;
+}
+
+uint8_t USBD_UAC_IsOutActive(void)
+{
+    return uac_pdev != NULL && static_uac.outActive;
+}
+
+uint8_t USBD_UAC_IsInActive(void)
+{
+    return uac_pdev != NULL && static_uac.alt[UAC_IN_ITF] == 1U;
+}
+
+const int16_t* USBD_UAC_BeginOutRead(uint32_t* frames)
+{
+    USBD_UAC_HandleTypeDef* huac = &static_uac;
+    const uint32_t          fill = UAC_Fill(huac->outWritten, huac->outRead);
+
+    // Wait for the ring to be half full again after a start or an underrun.
+    // The frames left over when the host stops are dropped here, as only
+    // the audio callback writes outRead.
+    if(!USBD_UAC_IsOutActive())
+    {
+        huac->outRead   = huac->outWritten;
+        huac->outPrimed = 0U;
+    }
+    else if(fill == 0U)
+        huac->outPrimed = 0U;
+    else if(fill >= UAC_RING_TARGET)
+        huac->outPrimed = 1U;
+    if(!huac->outPrimed)
+    {
+        *frames = 0U;
+        return NULL;
+    }
+
+    const uint32_t start = huac->outRead & UAC_RING_MASK;
+    *frames              = MIN(fill, UAC_RING_FRAMES - start);
+    __DMB();
+    return &huac->outRing[start * UAC_CHANNELS];
+}
+
+void USBD_UAC_EndOutRead(uint32_t frames)
+{
+    __DMB();
+    static_uac.outRead += frames;
+}
+
+int16_t* USBD_UAC_BeginInWrite(uint32_t* frames)
+{
+    USBD_UAC_HandleTypeDef* huac  = &static_uac;
+    const uint32_t          space = UAC_RING_FRAMES
+                           - UAC_Fill(huac->inWritten, huac->inRead);
+    const uint32_t start = huac->inWritten & UAC_RING_MASK;
+    *frames              = MIN(space, UAC_RING_FRAMES - start);
+    __DMB();
+    return &huac->inRing[start * UAC_CHANNELS];
+}
+
+void USBD_UAC_EndInWrite(uint32_t frames)
+{
+    USBD_UAC_HandleTypeDef* huac  = &static_uac;
+    const uint32_t          start = huac->inWritten & UAC_RING_MASK;
+    // Mirror the start of the ring past its end
+    if(start < UAC_MAX_FRAMES)
+    {
+        const uint32_t count = MIN(frames, UAC_MAX_FRAMES - start);
+        USBD_memcpy(&huac->inRing[(UAC_RING_FRAMES + start) * UAC_CHANNELS],
+                    &huac->inRing[start * UAC_CHANNELS],
+                    count * UAC_FRAME_SIZE);
+    }
+    __DMB();
+    huac->inWritten += frames;
+}
@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_uac.h
+  * @brief          : USB Audio Class 1.0 device class, asynchronous streaming
+  ******************************************************************************
+  * The class streams 48 kHz, 16 bit stereo audio in both directions. The
+  * device is the clock master: the host's OUT stream is paced by an explicit
+  * feedback endpoint, computed from the fill level of the OUT ring, and the
+  * size of the IN packets follows the fill level of the IN ring.
+  *
+  * The endpoints transfer straight from and into the two rings, which are
+  * written and read in place by the audio callback through the Begin/End
+  * functions below. There is a single instance of the class.
+  ******************************************************************************
+  */
+
+#ifndef __USBD_UAC_H
+#define __USBD_UAC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "usbd_ioreq.h"
+
+/** Stream format */
+#define UAC_SAMPLE_RATE 48000U
+#define UAC_CHANNELS 2U
+#define UAC_SUBFRAME_SIZE 2U
+#define UAC_FRAME_SIZE (UAC_CHANNELS * UAC_SUBFRAME_SIZE)
+
+/** Frames per 1 ms packet, the size is adjusted by one frame either way */
+#define UAC_NOMINAL_FRAMES (UAC_SAMPLE_RATE / 1000U)
+#define UAC_MAX_FRAMES (UAC_NOMINAL_FRAMES + 1U)
+#define UAC_MAX_PACKET_SIZE (UAC_MAX_FRAMES * UAC_FRAME_SIZE)
+
+/** Frames in each ring, a power of two. The rings are kept half full. */
+#ifndef UAC_RING_FRAMES
+#define UAC_RING_FRAMES 512U
+#endif
+#define UAC_RING_SAMPLES ((UAC_RING_FRAMES + UAC_MAX_FRAMES) * UAC_CHANNELS)
+
+#define UAC_IN_EP 0x81U
+#define UAC_OUT_EP 0x01U
+#define UAC_FEEDBACK_EP 0x82U
+
+/** Interfaces: audio control, the OUT stream (speaker), the IN stream */
+#define UAC_AC_ITF 0x00U
+#define UAC_OUT_ITF 0x01U
+#define UAC_IN_ITF 0x02U
+#define UAC_NUM_ITF 0x03U
+
+#define USB_UAC_CONFIG_DESC_SIZ 183U
+
+    typedef struct
+    {
+        uint8_t alt[UAC_NUM_ITF];
+        uint8_t control[4];
+
+        /** Interleaved frames from the host. Packets are received at the
+         *  write position, the part past the end is moved to the start. */
+        int16_t           outRing[UAC_RING_SAMPLES];
+        volatile uint32_t outWritten;
+        volatile uint32_t outRead;
+        volatile uint8_t  outActive;
+        uint8_t           outPrimed;
+        uint8_t           outDiscard;
+        uint8_t           outDiscardBuf[UAC_MAX_PACKET_SIZE];
+        int32_t           outFillAvg;
+        uint8_t           feedback[4];
+        uint8_t           feedbackBusy;
+
+        /** Interleaved frames for the host. The first UAC_MAX_FRAMES are
+         *  mirrored past the end, so that every packet is contiguous. */
+        int16_t           inRing[UAC_RING_SAMPLES];
+        volatile uint32_t inWritten;
+        volatile uint32_t inRead;
+        uint32_t          inPending;
+        uint8_t           inBusy;
+        int32_t           inFillAvg;
+    } USBD_UAC_HandleTypeDef;
+
+    extern USBD_ClassTypeDef USBD_UAC;
+#define USBD_UAC_CLASS &USBD_UAC
+
+    /** Returns 1 while the host plays to the device */
+    uint8_t USBD_UAC_IsOutActive(void);
+
+    /** Returns 1 while the host records from the device */
+    uint8_t USBD_UAC_IsInActive(void);
+
+    /** Returns the contiguous frames from the host that can be read, 0
+     *  while the ring fills up to half, after the stream starts or runs
+     *  dry. Called from the audio callback.
+     */
+    const int16_t* USBD_UAC_BeginOutRead(uint32_t* frames);
+
+    /** Releases frames returned by USBD_UAC_BeginOutRead() */
+    void USBD_UAC_EndOutRead(uint32_t frames);
+
+    /** Returns the contiguous space for frames to the host, 0 when the
+     *  ring is full. Called from the audio callback.
+     */
+    int16_t* USBD_UAC_BeginInWrite(uint32_t* frames);
+
+    /** Queues frames written to the space of USBD_UAC_BeginInWrite() */
+    void USBD_UAC_EndInWrite(uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_UAC_H */
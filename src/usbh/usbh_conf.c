@@ -21,6 +21,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "usbh_core.h"
+#include "sys/irq_priority.h"
 
 /* USER CODE BEGIN Includes */
 
@@ -96,11 +97,11 @@ void HAL_HCD_MspInit(HCD_HandleTypeDef *hcdHandle)
         __HAL_RCC_USB_OTG_HS_CLK_ENABLE();
 
         /* Peripheral interrupt init */
-        HAL_NVIC_SetPriority(OTG_HS_EP1_OUT_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_EP1_OUT_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_EP1_OUT_IRQn);
-        HAL_NVIC_SetPriority(OTG_HS_EP1_IN_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_EP1_IN_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_EP1_IN_IRQn);
-        HAL_NVIC_SetPriority(OTG_HS_IRQn, 0, 0);
+        HAL_NVIC_SetPriority(OTG_HS_IRQn, DSY_IRQ_PRIORITY_USB, 0);
         HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
         /* USER CODE BEGIN USB_OTG_HS_MspInit 1 */
 
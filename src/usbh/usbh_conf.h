@@ -76,7 +76,7 @@ extern "C"
 #define USBH_KEEP_CFG_DESCRIPTOR 1U
 
 /*----------   -----------*/
-#define USBH_MAX_NUM_SUPPORTED_CLASS 1U
+#define USBH_MAX_NUM_SUPPORTED_CLASS 2U
 
 /*----------   -----------*/
 #define USBH_MAX_SIZE_CONFIGURATION 256U
@@ -0,0 +1,306 @@
+/**
+  ******************************************************************************
+  * @file           : usbh_midi.c
+  * @brief          : USB MIDI (Audio class, MIDIStreaming subclass) host class
+  ******************************************************************************
+  */
+
+#include "usbh_midi.h"
+#include "daisy_core.h"
+
+static MIDI_HandleTypeDef DMA_BUFFER_MEM_SECTION static_midi;
+
+static USBH_MIDI_RxCallback rx_callback      = NULL;
+static void*                rx_callback_user = NULL;
+
+static USBH_StatusTypeDef USBH_MIDI_InterfaceInit(USBH_HandleTypeDef* phost);
+static USBH_StatusTypeDef USBH_MIDI_InterfaceDeInit(USBH_HandleTypeDef* phost);
+static USBH_StatusTypeDef USBH_MIDI_ClassRequest(USBH_HandleTypeDef* phost);
+static USBH_StatusTypeDef USBH_MIDI_Process(USBH_HandleTypeDef* phost);
+static USBH_StatusTypeDef USBH_MIDI_SOFProcess(USBH_HandleTypeDef* phost);
+
+static void MIDI_StartReception(USBH_HandleTypeDef* phost,
+                                MIDI_HandleTypeDef* MIDI_Handle);
+static void MIDI_ProcessReception(USBH_HandleTypeDef* phost,
+                                  MIDI_HandleTypeDef* MIDI_Handle);
+static void MIDI_ProcessTransmission(USBH_HandleTypeDef* phost,
+                                     MIDI_HandleTypeDef* MIDI_Handle);
+
+USBH_ClassTypeDef USBH_midi = {
+    "MIDI",
+    USB_AUDIO_CLASS,
+    USBH_MIDI_InterfaceInit,
+    USBH_MIDI_InterfaceDeInit,
+    USBH_MIDI_ClassRequest,
+    USBH_MIDI_Process,
+    USBH_MIDI_SOFProcess,
+    NULL,
+};
+
+static MIDI_HandleTypeDef* MIDI_GetHandle(USBH_HandleTypeDef* phost)
+{
+    if(phost->pActiveClass != &USBH_midi)
+        return NULL;
+    return (MIDI_HandleTypeDef*)phost->pActiveClass->pData;
+}
+
+/**
+  * @brief  USBH_MIDI_InterfaceInit
+  *         Finds the MIDIStreaming interface, and opens its bulk pipes.
+  * @param  phost: Host handle
+  * @retval USBH Status
+  */
+static USBH_StatusTypeDef USBH_MIDI_InterfaceInit(USBH_HandleTypeDef* phost)
+{
+    uint8_t interface = USBH_FindInterface(
+        phost, USB_AUDIO_CLASS, USB_MIDI_STREAMING_SUBCLASS, 0xFFU);
+    if((interface == 0xFFU) || (interface >= USBH_MAX_NUM_INTERFACES))
+    {
+        USBH_DbgLog("Cannot Find the interface for %s class.",
+                    phost->pActiveClass->Name);
+        return USBH_FAIL;
+    }
+    if(USBH_SelectInterface(phost, interface) != USBH_OK)
+        return USBH_FAIL;
+
+    MIDI_HandleTypeDef* MIDI_Handle = &static_midi;
+    phost->pActiveClass->pData      = MIDI_Handle;
+    USBH_memset(MIDI_Handle, 0, sizeof(MIDI_HandleTypeDef));
+
+    USBH_InterfaceDescTypeDef* itf = &phost->device.CfgDesc.Itf_Desc[interface];
+    for(uint8_t i = 0; i < itf->bNumEndpoints && i < USBH_MAX_NUM_ENDPOINTS;
+        i++)
+    {
+        // MIDIStreaming interfaces may also have isochronous endpoints
+        USBH_EpDescTypeDef* ep = &itf->Ep_Desc[i];
+        if((ep->bmAttributes & 0x03U) != USB_EP_TYPE_BULK)
+            continue;
+        if(ep->bEndpointAddress & 0x80U)
+        {
+            MIDI_Handle->InEp     = ep->bEndpointAddress;
+            MIDI_Handle->InEpSize = ep->wMaxPacketSize;
+        }
+        else
+        {
+            MIDI_Handle->OutEp     = ep->bEndpointAddress;
+            MIDI_Handle->OutEpSize = ep->wMaxPacketSize;
+        }
+    }
+    if(MIDI_Handle->InEp == 0U)
+    {
+        USBH_DbgLog("No bulk IN endpoint for %s class.",
+                    phost->pActiveClass->Name);
+        return USBH_FAIL;
+    }
+    if(MIDI_Handle->InEpSize > USBH_MIDI_RX_BUF_SIZE)
+        MIDI_Handle->InEpSize = USBH_MIDI_RX_BUF_SIZE;
+    if(MIDI_Handle->OutEpSize > USBH_MIDI_TX_BUF_SIZE)
+        MIDI_Handle->OutEpSize = USBH_MIDI_TX_BUF_SIZE;
+
+    MIDI_Handle->InPipe = USBH_AllocPipe(phost, MIDI_Handle->InEp);
+    USBH_OpenPipe(phost,
+                  MIDI_Handle->InPipe,
+                  MIDI_Handle->InEp,
+                  phost->device.address,
+                  phost->device.speed,
+                  USB_EP_TYPE_BULK,
+                  MIDI_Handle->InEpSize);
+    USBH_LL_SetToggle(phost, MIDI_Handle->InPipe, 0U);
+
+    // Devices that only send, e.g. some controllers, have no OUT endpoint
+    if(MIDI_Handle->OutEp != 0U)
+    {
+        MIDI_Handle->OutPipe = USBH_AllocPipe(phost, MIDI_Handle->OutEp);
+        USBH_OpenPipe(phost,
+                      MIDI_Handle->OutPipe,
+                      MIDI_Handle->OutEp,
+                      phost->device.address,
+                      phost->device.speed,
+                      USB_EP_TYPE_BULK,
+                      MIDI_Handle->OutEpSize);
+        USBH_LL_SetToggle(phost, MIDI_Handle->OutPipe, 0U);
+    }
+
+    MIDI_Handle->rxState = MIDI_RX_IDLE;
+    MIDI_Handle->txState = MIDI_TX_IDLE;
+    return USBH_OK;
+}
+
+/**
+  * @brief  USBH_MIDI_InterfaceDeInit
+  *         Closes and frees the pipes.
+  * @param  phost: Host handle
+  * @retval USBH Status
+  */
+static USBH_StatusTypeDef USBH_MIDI_InterfaceDeInit(USBH_HandleTypeDef* phost)
+{
+    MIDI_HandleTypeDef* MIDI_Handle
+        = (MIDI_HandleTypeDef*)phost->pActiveClass->pData;
+    if(MIDI_Handle == NULL)
+        return USBH_OK;
+
+    if(MIDI_Handle->InPipe)
+    {
+        USBH_ClosePipe(phost, MIDI_Handle->InPipe);
+        USBH_FreePipe(phost, MIDI_Handle->InPipe);
+        MIDI_Handle->InPipe = 0U;
+    }
+    if(MIDI_Handle->OutPipe)
+    {
+        USBH_ClosePipe(phost, MIDI_Handle->OutPipe);
+        USBH_FreePipe(phost, MIDI_Handle->OutPipe);
+        MIDI_Handle->OutPipe = 0U;
+    }
+    phost->pActiveClass->pData = 0U;
+    return USBH_OK;
+}
+
+/**
+  * @brief  USBH_MIDI_ClassRequest
+  *         USB MIDI has no class requests to make.
+  * @param  phost: Host handle
+  * @retval USBH Status
+  */
+static USBH_StatusTypeDef USBH_MIDI_ClassRequest(USBH_HandleTypeDef* phost)
+{
+    (void)phost;
+    return USBH_OK;
+}
+
+/**
+  * @brief  USBH_MIDI_Process
+  *         Handles the finished transfers and starts the next ones.
+  * @param  phost: Host handle
+  * @retval USBH Status
+  */
+static USBH_StatusTypeDef USBH_MIDI_Process(USBH_HandleTypeDef* phost)
+{
+    MIDI_HandleTypeDef* MIDI_Handle
+        = (MIDI_HandleTypeDef*)phost->pActiveClass->pData;
+    if(MIDI_Handle == NULL)
+        return USBH_FAIL;
+    MIDI_ProcessTransmission(phost, MIDI_Handle);
+    MIDI_ProcessReception(phost, MIDI_Handle);
+    return USBH_OK;
+}
+
+static USBH_StatusTypeDef USBH_MIDI_SOFProcess(USBH_HandleTypeDef* phost)
+{
+    (void)phost;
+    return USBH_OK;
+}
+
+static void MIDI_StartReception(USBH_HandleTypeDef* phost,
+                                MIDI_HandleTypeDef* MIDI_Handle)
+{
+    USBH_BulkReceiveData(phost,
+                         MIDI_Handle->rxBuffer[MIDI_Handle->rxIndex],
+                         MIDI_Handle->InEpSize,
+                         MIDI_Handle->InPipe);
+    MIDI_Handle->rxState = MIDI_RX_WAIT;
+}
+
+static void MIDI_ProcessReception(USBH_HandleTypeDef* phost,
+                                  MIDI_HandleTypeDef* MIDI_Handle)
+{
+    if(MIDI_Handle->rxState == MIDI_RX_IDLE)
+    {
+        MIDI_StartReception(phost, MIDI_Handle);
+        return;
+    }
+
+    USBH_URBStateTypeDef urb = USBH_LL_GetURBState(phost, MIDI_Handle->InPipe);
+    if(urb == USBH_URB_DONE)
+    {
+        uint8_t* packets = MIDI_Handle->rxBuffer[MIDI_Handle->rxIndex];
+        uint32_t length  = USBH_LL_GetLastXferSize(phost, MIDI_Handle->InPipe);
+
+        // The next transfer goes to the other buffer, and is already on its
+        // way while the packets of this one are parsed
+        MIDI_Handle->rxIndex ^= 1U;
+        MIDI_StartReception(phost, MIDI_Handle);
+
+        if(rx_callback != NULL && length > 0U)
+            rx_callback(packets, length, rx_callback_user);
+    }
+    else if(urb == USBH_URB_ERROR || urb == USBH_URB_STALL)
+    {
+        MIDI_Handle->rxState = MIDI_RX_IDLE;
+    }
+}
+
+static void MIDI_ProcessTransmission(USBH_HandleTypeDef* phost,
+                                     MIDI_HandleTypeDef* MIDI_Handle)
+{
+    if(MIDI_Handle->txState == MIDI_TX_WAIT)
+    {
+        USBH_URBStateTypeDef urb
+            = USBH_LL_GetURBState(phost, MIDI_Handle->OutPipe);
+        if(urb == USBH_URB_NOTREADY)
+        {
+            // NAK, send again
+            USBH_BulkSendData(phost,
+                              MIDI_Handle->txBuffer,
+                              MIDI_Handle->txLength,
+                              MIDI_Handle->OutPipe,
+                              0U);
+            return;
+        }
+        if(urb != USBH_URB_DONE && urb != USBH_URB_ERROR
+           && urb != USBH_URB_STALL)
+            return;
+        MIDI_Handle->txState = MIDI_TX_IDLE;
+    }
+
+    if(MIDI_Handle->txQueued == 0U)
+        return;
+    uint16_t length = MIDI_Handle->txQueued;
+    if(length > MIDI_Handle->OutEpSize)
+        length = MIDI_Handle->OutEpSize;
+    USBH_memcpy(MIDI_Handle->txBuffer, MIDI_Handle->txQueue, length);
+    MIDI_Handle->txQueued -= length;
+    memmove(MIDI_Handle->txQueue,
+            MIDI_Handle->txQueue + length,
+            MIDI_Handle->txQueued);
+    MIDI_Handle->txLength = length;
+    USBH_BulkSendData(phost,
+                      MIDI_Handle->txBuffer,
+                      MIDI_Handle->txLength,
+                      MIDI_Handle->OutPipe,
+                      0U);
+    MIDI_Handle->txState = MIDI_TX_WAIT;
+}
+
+uint8_t USBH_MIDI_IsReady(USBH_HandleTypeDef* phost)
+{
+    return (phost->gState == HOST_CLASS && MIDI_GetHandle(phost) != NULL)
+               ? 1U
+               : 0U;
+}
+
+USBH_StatusTypeDef
+USBH_MIDI_Transmit(USBH_HandleTypeDef* phost, uint8_t* buff, size_t len)
+{
+    MIDI_HandleTypeDef* MIDI_Handle = MIDI_GetHandle(phost);
+    if(MIDI_Handle == NULL || phost->gState != HOST_CLASS
+       || MIDI_Handle->OutPipe == 0U)
+        return USBH_FAIL;
+
+    if(len > USBH_MIDI_TX_QUEUE_SIZE - MIDI_Handle->txQueued)
+        return USBH_BUSY;
+    USBH_memcpy(MIDI_Handle->txQueue + MIDI_Handle->txQueued, buff, len);
+    MIDI_Handle->txQueued += len;
+
+    // Sent right away when the pipe is free, otherwise in USBH_Process()
+    MIDI_ProcessTransmission(phost, MIDI_Handle);
+    return USBH_OK;
+}
+
+void USBH_MIDI_SetReceiveCallback(USBH_HandleTypeDef*  phost,
+                                  USBH_MIDI_RxCallback cb,
+                                  void*                pUser)
+{
+    (void)phost;
+    rx_callback      = cb;
+    rx_callback_user = pUser;
+}
@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file           : usbh_midi.h
+  * @brief          : USB MIDI (Audio class, MIDIStreaming subclass) host class
+  ******************************************************************************
+  * The class streams the bulk IN event packets of a USB MIDI device to a
+  * callback, and sends event packets to the device. It runs in
+  * USBH_Process(), like the ST classes.
+  ******************************************************************************
+  */
+
+#ifndef __USBH_MIDI_H
+#define __USBH_MIDI_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "usbh_core.h"
+
+/** Interface class and subclass of the MIDIStreaming interface */
+#define USB_AUDIO_CLASS 0x01U
+#define USB_MIDI_STREAMING_SUBCLASS 0x03U
+
+/** Size of each of the two receive buffers, and of the transmit buffer */
+#define USBH_MIDI_RX_BUF_SIZE 64U
+#define USBH_MIDI_TX_BUF_SIZE 64U
+
+/** Size of the transmit queue, 64 event packets */
+#ifndef USBH_MIDI_TX_QUEUE_SIZE
+#define USBH_MIDI_TX_QUEUE_SIZE 256U
+#endif
+
+    /** Called from USBH_Process() with the event packets of a transfer
+     *  \param buff the packets, 4 bytes each
+     *  \param len the number of bytes
+     *  \param pUser the user data passed to USBH_MIDI_SetReceiveCallback()
+     */
+    typedef void (*USBH_MIDI_RxCallback)(uint8_t* buff,
+                                         size_t   len,
+                                         void*    pUser);
+
+    typedef enum
+    {
+        MIDI_RX_IDLE = 0,
+        MIDI_RX_WAIT,
+    } MIDI_RxStateTypeDef;
+
+    typedef enum
+    {
+        MIDI_TX_IDLE = 0,
+        MIDI_TX_WAIT,
+    } MIDI_TxStateTypeDef;
+
+    /** Class state, placed in the DMA memory section for the HCD DMA */
+    typedef struct
+    {
+        uint8_t  InPipe;
+        uint8_t  OutPipe;
+        uint8_t  InEp;
+        uint8_t  OutEp;
+        uint16_t InEpSize;
+        uint16_t OutEpSize;
+
+        /** Transfers are received in turns into the two buffers, the next
+         *  one is started before the packets of the last are handled */
+        MIDI_RxStateTypeDef rxState;
+        uint8_t             rxBuffer[2][USBH_MIDI_RX_BUF_SIZE];
+        uint8_t             rxIndex;
+
+        /** Packets are queued while a transfer is in flight, and sent up
+         *  to a packet size at a time */
+        MIDI_TxStateTypeDef txState;
+        uint8_t             txBuffer[USBH_MIDI_TX_BUF_SIZE];
+        uint8_t             txQueue[USBH_MIDI_TX_QUEUE_SIZE];
+        uint16_t            txLength;
+        uint16_t            txQueued;
+    } MIDI_HandleTypeDef;
+
+    extern USBH_ClassTypeDef USBH_midi;
+#define USBH_MIDI_CLASS &USBH_midi
+
+    /** Returns 1 when a MIDI device is connected, and its class is active */
+    uint8_t USBH_MIDI_IsReady(USBH_HandleTypeDef* phost);
+
+    /** Queues event packets for the device, they are sent in
+     *  USBH_Process().
+     *  \return USBH_BUSY if they don't fit in the queue, USBH_FAIL if no
+     *          MIDI device is ready
+     */
+    USBH_StatusTypeDef
+    USBH_MIDI_Transmit(USBH_HandleTypeDef* phost, uint8_t* buff, size_t len);
+
+    /** Sets the callback for the received event packets, it stays set
+     *  when devices are connected and disconnected
+     */
+    void USBH_MIDI_SetReceiveCallback(USBH_HandleTypeDef*  phost,
+                                      USBH_MIDI_RxCallback cb,
+                                      void*                pUser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBH_MIDI_H */
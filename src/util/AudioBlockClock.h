@@ -0,0 +1,105 @@
+#pragma once
+
+#include "sys/system.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Places timestamped events at their sample in the audio block
+ *  @addtogroup utility
+ *
+ *  Events from interrupts, e.g. MidiEvents, are usually only applied at
+ *  the start of the next audio block, so their timing jitters by up to one
+ *  block. With their DWT cycle count timestamps (see
+ *  System::GetCycleCount()) they can be delayed by exactly one block
+ *  instead: an event that arrived 30% into the previous block is played
+ *  30% into the current one.
+ *
+ *  Call OnBlockStart() at the beginning of the audio callback, then
+ *  GetSampleOffset() for each event that is handled in the callback.
+ *
+ *      clock.OnBlockStart();
+ *      while(midi.HasEvents())
+ *      {
+ *          MidiEvent e = midi.PopEvent();
+ *          synth.Schedule(e, clock.GetSampleOffset(e.timestamp));
+ *      }
+ *
+ *  Like the CycleCpuLoadMeter, the block length in cycles follows
+ *  System::SetSysClkFreq().
+ */
+class AudioBlockClock
+{
+  public:
+    AudioBlockClock() {}
+
+    /** Initializes the clock for a particular sample rate and block size.
+     *  @param sampleRateInHz           The sample rate in Hz
+     *  @param blockSizeInSamples       The block size in samples
+     */
+    void Init(float sampleRateInHz, size_t blockSizeInSamples)
+    {
+        blockSize_   = blockSizeInSamples;
+        secPerBlock_ = float(blockSizeInSamples) / sampleRateInHz;
+        UpdateCycleRate();
+        blockStartCycles_ = prevBlockStartCycles_ = System::GetCycleCount();
+    }
+
+    /** Call this at the beginning of your audio callback */
+    void OnBlockStart()
+    {
+        if(System::GetClockChangeCount() != clockChangeCount_)
+            UpdateCycleRate();
+        prevBlockStartCycles_ = blockStartCycles_;
+        blockStartCycles_     = System::GetCycleCount();
+    }
+
+    /** Returns the sample in the current block at which an event is due.
+     *  Events from before the previous block are due right away, at 0.
+     *  Events that arrived after the current block started are due at the
+     *  last sample, blockSize - 1.
+     *  @param timestamp    The DWT cycle count when the event arrived
+     */
+    size_t GetSampleOffset(uint32_t timestamp) const
+    {
+        const uint32_t elapsed = timestamp - prevBlockStartCycles_;
+        if(int32_t(elapsed) < 0)
+            return 0;
+        const size_t offset
+            = size_t((uint64_t(elapsed) * samplesPerCycle_) >> 32);
+        return offset < blockSize_ ? offset : blockSize_ - 1;
+    }
+
+    /** Returns the cycle count at the start of the current block */
+    uint32_t GetBlockStartCycles() const { return blockStartCycles_; }
+
+  private:
+    void UpdateCycleRate()
+    {
+        clockChangeCount_         = System::GetClockChangeCount();
+        const auto cyclesPerS     = float(System::GetCpuFreq());
+        auto       cyclesPerBlock = uint32_t(cyclesPerS * secPerBlock_);
+        if(cyclesPerBlock <= blockSize_)
+            cyclesPerBlock = uint32_t(blockSize_) + 1;
+
+        // samples per cycle as a 0.32 fixed point factor, so that
+        // GetSampleOffset() only needs a multiply instead of a division.
+        // Rounded up, so that events on a sample boundary aren't truncated
+        // to the sample before.
+        const uint64_t scaled = uint64_t(blockSize_) << 32;
+        samplesPerCycle_
+            = uint32_t((scaled + cyclesPerBlock - 1) / cyclesPerBlock);
+    }
+
+    size_t   blockSize_;
+    float    secPerBlock_;
+    uint32_t clockChangeCount_;
+    uint32_t samplesPerCycle_;
+    uint32_t blockStartCycles_;
+    uint32_t prevBlockStartCycles_;
+
+    AudioBlockClock(const AudioBlockClock&) = delete;
+    AudioBlockClock& operator=(const AudioBlockClock&) = delete;
+};
+} // namespace daisy
@@ -0,0 +1,183 @@
+#pragma once
+#ifndef DSY_AUDIO_LINK_FRAME_H
+#define DSY_AUDIO_LINK_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief Frames blocks of audio and a control word for a link between
+ *  two modules, e.g. over SpiHandle::StartDmaCircular()
+ *  @addtogroup utility
+ *
+ *  One frame carries one audio block of all channels, and is sent as one
+ *  half of the circular DMA buffers, so a frame is packed and unpacked in
+ *  each DMA callback. A frame is:
+ *  - uint16_t kSync, uint16_t sequence number, uint32_t control word
+ *  - block_size floats per channel, channel after channel
+ *  - uint32_t Crc32() of everything after the sync word
+ *
+ *  All fields are in the byte order of the MCU, both ends are Daisies.
+ *  A frame that fails the checks is replaced with silence. After
+ *  kResyncFrames bad frames in a row the link has lost its alignment,
+ *  IsSynced() turns false, and the slave restarts its DMA between two
+ *  frames and calls Resync().
+ *
+ *  @code
+ *  using Link = AudioLinkFrame<2, 48>;
+ *  static uint8_t DMA_BUFFER_MEM_SECTION rx[Link::kBufferSize];
+ *  static uint8_t DMA_BUFFER_MEM_SECTION tx[Link::kBufferSize];
+ *  static Link link;
+ *
+ *  void OnHalf(uint8_t* rx, uint8_t* tx, size_t size, void* context)
+ *  {
+ *      link.Unpack(rx, remote_in);
+ *      link.Pack(tx, local_out);
+ *  }
+ *  spi.StartDmaCircular(rx, tx, Link::kBufferSize, OnHalf, nullptr);
+ *  @endcode
+ *
+ *  \tparam num_channels audio channels in a frame
+ *  \tparam block_size samples per channel in a frame
+ */
+template <size_t num_channels, size_t block_size>
+class AudioLinkFrame
+{
+  public:
+    /** First field of each frame */
+    static constexpr uint16_t kSync = 0xa55a;
+
+    /** Bytes of the sync word, sequence number and control word */
+    static constexpr size_t kHeaderSize = 8;
+
+    /** Bytes of a frame */
+    static constexpr size_t kSize
+        = kHeaderSize + num_channels * block_size * sizeof(float) + 4;
+
+    /** Bytes of each circular DMA buffer, two frames */
+    static constexpr size_t kBufferSize = 2 * kSize;
+
+    /** Bad frames in a row after which the link counts as out of sync */
+    static constexpr uint32_t kResyncFrames = 4;
+
+    AudioLinkFrame() { Init(); }
+
+    /** Resets the sequence numbers and the counters */
+    void Init()
+    {
+        tx_sequence_ = 0;
+        bad_frames_  = 0;
+        lost_frames_ = 0;
+        Resync();
+    }
+
+    /** Builds a frame
+     *  \param frame kSize bytes
+     *  \param in num_channels blocks of block_size samples
+     *  \param control a word for the other side, e.g. a parameter
+     */
+    void Pack(uint8_t* frame, const float* const* in, uint32_t control = 0)
+    {
+        const uint16_t sequence = tx_sequence_++;
+        memcpy(frame, &kSync, 2);
+        memcpy(frame + 2, &sequence, 2);
+        memcpy(frame + 4, &control, 4);
+        uint8_t* p = frame + kHeaderSize;
+        for(size_t ch = 0; ch < num_channels; ch++)
+        {
+            memcpy(p, in[ch], block_size * sizeof(float));
+            p += block_size * sizeof(float);
+        }
+        const uint32_t crc = Crc32(frame + 2, kSize - 6);
+        memcpy(p, &crc, 4);
+    }
+
+    /** Reads a frame, or writes silence if it is bad
+     *  \param frame kSize bytes
+     *  \param out num_channels blocks of block_size samples
+     *  \param control the control word of the frame, left unchanged if the
+     *         frame is bad, or nullptr
+     *  \return false if the frame is bad
+     */
+    bool Unpack(const uint8_t* frame, float** out, uint32_t* control = nullptr)
+    {
+        uint16_t sync, sequence;
+        uint32_t crc;
+        memcpy(&sync, frame, 2);
+        memcpy(&sequence, frame + 2, 2);
+        memcpy(&crc, frame + kSize - 4, 4);
+        if(sync != kSync || crc != Crc32(frame + 2, kSize - 6))
+        {
+            bad_frames_++;
+            if(bad_in_row_ < kResyncFrames)
+                bad_in_row_++;
+            for(size_t ch = 0; ch < num_channels; ch++)
+                memset(out[ch], 0, block_size * sizeof(float));
+            return false;
+        }
+
+        if(received_)
+            lost_frames_ += uint16_t(sequence - rx_sequence_);
+        rx_sequence_ = sequence + 1;
+        received_    = true;
+        bad_in_row_  = 0;
+
+        if(control != nullptr)
+            memcpy(control, frame + 4, 4);
+        const uint8_t* p = frame + kHeaderSize;
+        for(size_t ch = 0; ch < num_channels; ch++)
+        {
+            memcpy(out[ch], p, block_size * sizeof(float));
+            p += block_size * sizeof(float);
+        }
+        return true;
+    }
+
+    /** \return false after kResyncFrames bad frames in a row */
+    bool IsSynced() const { return bad_in_row_ < kResyncFrames; }
+
+    /** Starts over after the DMA was restarted, the next frame doesn't
+     *  count lost frames
+     */
+    void Resync()
+    {
+        bad_in_row_ = 0;
+        received_   = false;
+    }
+
+    /** \return the frames that failed the sync word or CRC check */
+    uint32_t GetBadFrameCount() const { return bad_frames_; }
+
+    /** \return the frames missing between the sequence numbers received */
+    uint32_t GetLostFrameCount() const { return lost_frames_; }
+
+  private:
+    uint16_t tx_sequence_;
+    uint16_t rx_sequence_;
+    bool     received_;
+    uint32_t bad_in_row_;
+    uint32_t bad_frames_;
+    uint32_t lost_frames_;
+};
+
+template <size_t num_channels, size_t block_size>
+constexpr uint16_t AudioLinkFrame<num_channels, block_size>::kSync;
+
+template <size_t num_channels, size_t block_size>
+constexpr size_t AudioLinkFrame<num_channels, block_size>::kHeaderSize;
+
+template <size_t num_channels, size_t block_size>
+constexpr size_t AudioLinkFrame<num_channels, block_size>::kSize;
+
+template <size_t num_channels, size_t block_size>
+constexpr size_t AudioLinkFrame<num_channels, block_size>::kBufferSize;
+
+template <size_t num_channels, size_t block_size>
+constexpr uint32_t AudioLinkFrame<num_channels, block_size>::kResyncFrames;
+
+} // namespace daisy
+
+#endif
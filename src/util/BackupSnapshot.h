@@ -0,0 +1,126 @@
+#pragma once
+#ifndef DSY_BACKUPSNAPSHOT_H
+#define DSY_BACKUPSNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief Copy of the state of the program in the backup SRAM, to resume
+ *  right where it was after a reset or a power blip
+ *  @addtogroup utility
+ *
+ *  Loading the state from the QSPI flash or an SD card takes a while at
+ *  every start. The backup SRAM keeps its contents across resets, and
+ *  with a battery on VBAT also while the power is off, so a copy of the
+ *  state can be saved there when the power is about to go, e.g. from the
+ *  PowerMonitor callback, and restored at the start, before anything
+ *  slower is up.
+ *
+ *  A snapshot is a few words of header, the state and a CRC of it.
+ *  Restore() only takes a snapshot with a matching size and CRC, so the
+ *  random contents after the first power up, a save that was cut off, or
+ *  a state struct that changed with an update are all rejected. Save()
+ *  is a copy and a CRC, fast enough for the few milliseconds before a
+ *  brown-out reset if the state is small: the CRC takes about 15 cycles
+ *  per byte.
+ *
+ *  @code
+ *  DSY_BACKUP_SRAM_BSS BackupSnapshot<State>::Storage backup;
+ *  BackupSnapshot<State> snapshot(backup);
+ *
+ *  System::InitBackupSram(true);
+ *  if(!snapshot.Restore(state))
+ *      LoadFromFlash(state);
+ *  PowerMonitor::Init(OnPowerFail, nullptr); // calls snapshot.Save(state)
+ *  @endcode
+ *
+ *  \tparam StateStruct state to save, copied with memcpy
+ */
+template <typename StateStruct>
+class BackupSnapshot
+{
+    static_assert(std::is_trivially_copyable<StateStruct>::value,
+                  "the state must be trivially copyable");
+
+  public:
+    /** The memory of a snapshot, to place in the backup SRAM with
+     *  DSY_BACKUP_SRAM_BSS
+     */
+    struct Storage
+    {
+        uint32_t    magic;
+        uint32_t    size;
+        uint32_t    count;
+        uint32_t    crc;
+        StateStruct state;
+    };
+
+    static_assert(sizeof(Storage) <= 4096 - 64,
+                  "the backup SRAM has 4kB, shared with the bootloader");
+
+    explicit BackupSnapshot(Storage& storage) : storage_(storage) {}
+
+    /** Copies the state into the snapshot. The snapshot is invalid while
+     *  it's written, so a save that's cut off is never restored.
+     */
+    void Save(const StateStruct& state)
+    {
+        // the CRC of the source, which is in cached memory
+        const uint32_t crc = Crc32(&state, sizeof(state));
+        const uint32_t count
+            = storage_.magic == kMagic ? storage_.count + 1 : 1;
+        storage_.magic = 0;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        std::memcpy(&storage_.state, &state, sizeof(state));
+        storage_.size  = sizeof(state);
+        storage_.count = count;
+        storage_.crc   = crc;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        storage_.magic = kMagic;
+    }
+
+    /** Copies the snapshot into the state
+     *  \return false, and the state unchanged, if there's no valid
+     *          snapshot
+     */
+    bool Restore(StateStruct& state) const
+    {
+        if(!IsValid())
+            return false;
+        std::memcpy(&state, &storage_.state, sizeof(state));
+        return true;
+    }
+
+    /** Returns true if there's a snapshot that can be restored */
+    bool IsValid() const
+    {
+        return storage_.magic == kMagic
+               && storage_.size == sizeof(StateStruct)
+               && storage_.crc == Crc32(&storage_.state, sizeof(StateStruct));
+    }
+
+    /** Makes the snapshot invalid, e.g. once the state was changed in a
+     *  way that shouldn't be resumed.
+     */
+    void Invalidate() { storage_.magic = 0; }
+
+    /** Returns the number of saves since the snapshot was last invalid */
+    uint32_t GetSaveCount() const { return IsValid() ? storage_.count : 0; }
+
+  private:
+    static constexpr uint32_t kMagic = 0x534e4150; // "SNAP"
+
+    Storage& storage_;
+};
+
+template <typename StateStruct>
+constexpr uint32_t BackupSnapshot<StateStruct>::kMagic;
+
+} // namespace daisy
+
+#endif
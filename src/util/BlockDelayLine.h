@@ -0,0 +1,164 @@
+#pragma once
+#ifndef DSY_BLOCKDELAYLINE_H
+#define DSY_BLOCKDELAYLINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Delay line that is written and read a block at a time
+ *  @addtogroup utility
+ *
+ *  Long delay lines go in the SDRAM, where a single load takes a lot
+ *  longer than from the internal SRAM, unless its cache line is already
+ *  cached. Writing and reading a sample at a time through each tap jumps
+ *  between distant parts of the buffer for every sample, and wraps each
+ *  index on its own. Here a block is written in one run, and each tap
+ *  reads one run of the block size plus one for the interpolation, so the
+ *  loads of a tap walk through consecutive cache lines. The index is only
+ *  wrapped at the start of the run, and the run is only split when it
+ *  crosses the end of the buffer, which the length being a power of two
+ *  keeps cheap.
+ *
+ *  A delay of 0 is the input itself: after Write() of a block, out[i] of
+ *  ReadBlock() with delay d is the sample written d samples before in[i].
+ *  Delays reach up to GetMaxDelay() minus the block size. ReadTaps() reads
+ *  several taps of the same block. The DelayLine_Benchmark example
+ *  compares this to a sample at a time in the SDRAM.
+ *
+ *  @code
+ *  static BlockDelayLine<float, 65536> DSY_SDRAM_BSS delay;
+ *
+ *  delay.Init();
+ *  // in the audio callback
+ *  delay.Write(in[0], size);
+ *  delay.ReadBlock(out[0], size, 12000.5f);
+ *  @endcode
+ *
+ *  \tparam T sample type, float or another type that can be scaled by a
+ *          float
+ *  \tparam length number of samples kept, a power of two
+ */
+template <typename T, size_t length>
+class BlockDelayLine
+{
+    static_assert(length >= 2 && (length & (length - 1)) == 0,
+                  "length must be a power of two");
+
+  public:
+    BlockDelayLine() {}
+
+    /** Clears the delay line, call it before use. The constructor leaves
+     *  the buffer alone, so the object can be placed in the SDRAM.
+     */
+    void Init()
+    {
+        for(size_t i = 0; i < length; i++)
+            buffer_[i] = T(0);
+        write_ = 0;
+    }
+
+    /** Adds a block of samples
+     *  \param in the samples, oldest first
+     *  \param size number of samples, at most the length
+     */
+    void Write(const T* in, size_t size)
+    {
+        const size_t start = write_ & kMask;
+        const size_t first = size < length - start ? size : length - start;
+        for(size_t i = 0; i < first; i++)
+            buffer_[start + i] = in[i];
+        for(size_t i = first; i < size; i++)
+            buffer_[i - first] = in[i];
+        write_ += size;
+    }
+
+    /** Adds one sample */
+    void Write(const T& in)
+    {
+        buffer_[write_ & kMask] = in;
+        write_++;
+    }
+
+    /** \return the sample written delay samples before the newest one
+     *  \param delay 0 to GetMaxDelay()
+     */
+    T Read(size_t delay) const
+    {
+        return buffer_[(write_ - 1 - delay) & kMask];
+    }
+
+    /** \return the newest sample delayed by a fraction of samples, with
+     *          linear interpolation
+     *  \param delay 0 to GetMaxDelay()
+     */
+    T ReadLinear(float delay) const
+    {
+        const size_t whole = size_t(delay);
+        const float  frac  = delay - float(whole);
+        const T      a     = buffer_[(write_ - 1 - whole) & kMask];
+        const T      b     = buffer_[(write_ - 2 - whole) & kMask];
+        return a + (b - a) * frac;
+    }
+
+    /** Reads one tap for the block that was written last, with linear
+     *  interpolation
+     *  \param out size samples, out[i] is in[i] of the last Write()
+     *         delayed by delay samples
+     *  \param size the size of the last block written
+     *  \param delay 0 to GetMaxDelay() - size
+     */
+    void ReadBlock(T* out, size_t size, float delay) const
+    {
+        const size_t whole = size_t(delay);
+        const float  frac  = delay - float(whole);
+
+        // one run from the oldest sample needed, b is one older than a
+        const size_t start = (write_ - size - whole - 1) & kMask;
+        if(start + size < length)
+        {
+            const T* p = &buffer_[start];
+            for(size_t i = 0; i < size; i++)
+                out[i] = p[i + 1] + (p[i] - p[i + 1]) * frac;
+        }
+        else
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                const T b = buffer_[(start + i) & kMask];
+                const T a = buffer_[(start + i + 1) & kMask];
+                out[i]    = a + (b - a) * frac;
+            }
+        }
+    }
+
+    /** Reads several taps for the block that was written last, one tap
+     *  after the other
+     *  \param outs num_taps blocks of size samples
+     *  \param delays num_taps delays, see ReadBlock()
+     *  \param num_taps number of taps
+     *  \param size the size of the last block written
+     */
+    void ReadTaps(T* const*    outs,
+                  const float* delays,
+                  size_t       num_taps,
+                  size_t       size) const
+    {
+        for(size_t tap = 0; tap < num_taps; tap++)
+            ReadBlock(outs[tap], size, delays[tap]);
+    }
+
+    /** \return the longest delay that ReadLinear() can interpolate */
+    static constexpr size_t GetMaxDelay() { return length - 2; }
+
+  private:
+    static constexpr size_t kMask = length - 1;
+
+    T      buffer_[length];
+    size_t write_;
+};
+
+} // namespace daisy
+
+#endif
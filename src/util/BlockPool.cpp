@@ -0,0 +1,84 @@
+#include "util/BlockPool.h"
+
+namespace daisy
+{
+bool BlockPool::Init(void*  buffer,
+                     size_t buffer_size,
+                     size_t block_size,
+                     size_t alignment)
+{
+    num_blocks_ = 0;
+    num_free_   = 0;
+    free_list_  = nullptr;
+    if(buffer == nullptr || alignment < alignof(FreeBlock)
+       || (alignment & (alignment - 1)) != 0)
+        return false;
+
+    // each block holds the link to the next free one while it's free
+    if(block_size < sizeof(FreeBlock))
+        block_size = sizeof(FreeBlock);
+    block_size_ = (block_size + alignment - 1) & ~(alignment - 1);
+
+    const uintptr_t addr    = reinterpret_cast<uintptr_t>(buffer);
+    const size_t    padding = (alignment - (addr & (alignment - 1)))
+                           & (alignment - 1);
+    if(buffer_size < padding)
+        return false;
+    base_       = static_cast<uint8_t*>(buffer) + padding;
+    num_blocks_ = (buffer_size - padding) / block_size_;
+    num_free_   = num_blocks_;
+
+    // linked from the start, so they're handed out in order
+    for(size_t i = num_blocks_; i-- > 0;)
+    {
+        auto block  = reinterpret_cast<FreeBlock*>(base_ + i * block_size_);
+        block->next = free_list_;
+        free_list_  = block;
+    }
+    high_water_mark_ = 0;
+    return num_blocks_ > 0;
+}
+
+bool BlockPool::Init(MemoryArena& arena,
+                     size_t       block_size,
+                     size_t       num_blocks,
+                     size_t       alignment)
+{
+    if(block_size < sizeof(FreeBlock))
+        block_size = sizeof(FreeBlock);
+    const size_t size = (block_size + alignment - 1) & ~(alignment - 1);
+    void* const  mem  = arena.Allocate(size * num_blocks, alignment);
+    return mem != nullptr && Init(mem, size * num_blocks, size, alignment);
+}
+
+void* BlockPool::Allocate()
+{
+    FreeBlock* block = free_list_;
+    if(block == nullptr)
+        return nullptr;
+    free_list_ = block->next;
+    num_free_--;
+    if(GetNumUsed() > high_water_mark_)
+        high_water_mark_ = GetNumUsed();
+    return block;
+}
+
+void BlockPool::Free(void* block)
+{
+    if(block == nullptr || !Owns(block))
+        return;
+    auto free_block  = static_cast<FreeBlock*>(block);
+    free_block->next = free_list_;
+    free_list_       = free_block;
+    num_free_++;
+}
+
+bool BlockPool::Owns(const void* ptr) const
+{
+    auto p = static_cast<const uint8_t*>(ptr);
+    return num_blocks_ > 0 && p >= base_
+           && p < base_ + num_blocks_ * block_size_
+           && (size_t(p - base_) % block_size_) == 0;
+}
+
+} // namespace daisy
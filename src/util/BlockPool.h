@@ -0,0 +1,107 @@
+#pragma once
+#ifndef DSY_BLOCKPOOL_H
+#define DSY_BLOCKPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/MemoryArena.h"
+
+namespace daisy
+{
+/** @brief Fixed size blocks that can be allocated and freed in any order
+ *  @addtogroup utility
+ *
+ *  All blocks have the same size, so freeing one never leaves a hole that
+ *  is too small to be used again. Allocating and freeing take constant
+ *  time, the free blocks are kept in a list that's stored in the blocks.
+ *  Useful for e.g. sample slots that are loaded and dropped at runtime.
+ *  Not interrupt safe.
+ *
+ *  @code
+ *  BlockPool slots;
+ *  slots.Init(SdramHandle::GetArena(), 256 * 1024, 16); // 16 x 256kB
+ *  void* slot = slots.Allocate();
+ *  // ...
+ *  slots.Free(slot);
+ *  @endcode
+ */
+class BlockPool
+{
+  public:
+    constexpr BlockPool()
+    : base_(nullptr),
+      block_size_(0),
+      num_blocks_(0),
+      num_free_(0),
+      high_water_mark_(0),
+      free_list_(nullptr)
+    {
+    }
+
+    /** Divides a buffer into blocks
+     *  \param buffer memory for the blocks
+     *  \param buffer_size size of buffer in bytes
+     *  \param block_size size of each block, rounded up to the alignment
+     *  \param alignment power of two, at least the alignment of a pointer
+     *  \returns false if not even one block fits
+     */
+    bool Init(void*  buffer,
+              size_t buffer_size,
+              size_t block_size,
+              size_t alignment = MemoryArena::kDefaultAlignment);
+
+    /** Allocates the blocks from an arena
+     *  \param arena arena to allocate from
+     *  \param block_size size of each block, rounded up to the alignment
+     *  \param num_blocks number of blocks
+     *  \param alignment power of two, at least the alignment of a pointer
+     *  \returns false if there isn't enough space in the arena
+     */
+    bool Init(MemoryArena& arena,
+              size_t       block_size,
+              size_t       num_blocks,
+              size_t       alignment = MemoryArena::kDefaultAlignment);
+
+    /** Allocates a block, it's not cleared
+     *  \returns nullptr if all blocks are in use
+     */
+    void* Allocate();
+
+    /** Returns a block to the pool. nullptr is ignored. */
+    void Free(void* block);
+
+    /** Returns true if the pointer is a block of this pool */
+    bool Owns(const void* ptr) const;
+
+    /** Returns the size of a block, after rounding up */
+    size_t GetBlockSize() const { return block_size_; }
+
+    /** Returns the total number of blocks */
+    size_t GetNumBlocks() const { return num_blocks_; }
+
+    /** Returns the number of blocks that can be allocated */
+    size_t GetNumFree() const { return num_free_; }
+
+    /** Returns the number of allocated blocks */
+    size_t GetNumUsed() const { return num_blocks_ - num_free_; }
+
+    /** Returns the most blocks that were ever allocated at once */
+    size_t GetHighWaterMark() const { return high_water_mark_; }
+
+  private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    uint8_t*   base_;
+    size_t     block_size_;
+    size_t     num_blocks_;
+    size_t     num_free_;
+    size_t     high_water_mark_;
+    FreeBlock* free_list_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,23 @@
+#include "util/BootTimer.h"
+#include <cstring>
+
+namespace daisy
+{
+BootTimer::Phase BootTimer::phases_[DSY_BOOT_TIMER_MAX_PHASES];
+size_t           BootTimer::num_phases_ = 0;
+
+void BootTimer::Mark(const char* name)
+{
+    if(num_phases_ >= DSY_BOOT_TIMER_MAX_PHASES)
+        return;
+    for(size_t i = 0; i < num_phases_; i++)
+    {
+        if(std::strcmp(phases_[i].name, name) == 0)
+            return;
+    }
+    phases_[num_phases_].name   = name;
+    phases_[num_phases_].end_us = System::GetUs();
+    num_phases_++;
+}
+
+} // namespace daisy
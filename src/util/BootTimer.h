@@ -0,0 +1,98 @@
+#pragma once
+#ifndef DSY_BOOTTIMER_H
+#define DSY_BOOTTIMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sys/system.h"
+
+/** Number of phases the BootTimer can record */
+#ifndef DSY_BOOT_TIMER_MAX_PHASES
+#define DSY_BOOT_TIMER_MAX_PHASES 16
+#endif
+
+namespace daisy
+{
+/** @brief Records how long each phase of the startup takes
+ *  @addtogroup utility
+ *
+ *  Mark() stores the microseconds since System::Init() with a name, at the
+ *  end of each phase. The board classes mark their own phases (memories,
+ *  codec, ADC, ...) and the start of the audio, so the time from power-on
+ *  to the first audio can be read out in the main loop. The time before
+ *  System::Init(), the bootloader and the startup code, isn't included.
+ *
+ *  @code
+ *  hw.Init();
+ *  BootTimer::Mark("my init");
+ *  hw.StartAudio(AudioCallback);
+ *  hw.StartLog(true);
+ *  BootTimer::Print<DaisySeed::Log>();
+ *  @endcode
+ */
+class BootTimer
+{
+  public:
+    /** One recorded phase */
+    struct Phase
+    {
+        /** name, as passed to Mark(). The string is not copied. */
+        const char* name;
+
+        /** microseconds since System::Init() at the end of the phase */
+        uint32_t end_us;
+    };
+
+    /** Ends a phase. A name that was recorded already is ignored, so a
+     *  phase that repeats, e.g. restarting the audio, is only timed the
+     *  first time. Phases beyond DSY_BOOT_TIMER_MAX_PHASES are dropped.
+     *  \param name the name of the phase that just ended
+     */
+    static void Mark(const char* name);
+
+    /** Returns the number of recorded phases */
+    static size_t GetNumPhases() { return num_phases_; }
+
+    /** Returns a recorded phase */
+    static const Phase& GetPhase(size_t idx) { return phases_[idx]; }
+
+    /** Returns the duration of a recorded phase in microseconds */
+    static uint32_t GetPhaseUs(size_t idx)
+    {
+        return idx == 0 ? phases_[0].end_us
+                        : phases_[idx].end_us - phases_[idx - 1].end_us;
+    }
+
+    /** Returns the end of the last phase in microseconds */
+    static uint32_t GetTotalUs()
+    {
+        return num_phases_ > 0 ? phases_[num_phases_ - 1].end_us : 0;
+    }
+
+    /** Removes all phases */
+    static void Reset() { num_phases_ = 0; }
+
+    /** Prints the duration and the end of each phase
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void Print()
+    {
+        LoggerType::PrintLine("%-24s %10s %10s", "phase", "us", "at us");
+        for(size_t i = 0; i < num_phases_; i++)
+        {
+            LoggerType::PrintLine("%-24s %10lu %10lu",
+                                  phases_[i].name,
+                                  (unsigned long)GetPhaseUs(i),
+                                  (unsigned long)phases_[i].end_us);
+        }
+    }
+
+  private:
+    static Phase  phases_[DSY_BOOT_TIMER_MAX_PHASES];
+    static size_t num_phases_;
+};
+
+} // namespace daisy
+
+#endif
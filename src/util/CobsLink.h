@@ -0,0 +1,444 @@
+#pragma once
+#ifndef DSY_COBSLINK_H
+#define DSY_COBSLINK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief Binary frames over a serial stream, for control from a host
+ *  @addtogroup utility
+ *
+ *  Each frame is its payload and the Crc32() of the payload, as a little
+ *  endian word, COBS encoded (Consistent Overhead Byte Stuffing) and ended
+ *  by a 0 byte. COBS replaces each 0 of the data, so the 0 only ever marks
+ *  the end of a frame, and a receiver that starts in the middle of the
+ *  stream, or loses bytes, is in sync again with the next frame. It adds a
+ *  byte per 254, at most. Frames that are too long, truncated, or fail the
+ *  CRC are dropped and counted.
+ *
+ *  Received frames are decoded straight into a ring of num_frames slots,
+ *  and read from there, without another copy: GetFrame() returns a view of
+ *  the oldest one, which stays valid until ReleaseFrame(). Process() only
+ *  takes bytes from the transport while a slot is free, so a host that
+ *  sends faster than the program reads is held back by the transport,
+ *  e.g. the USB receive ring, or the DMA ring of a UART, which overruns
+ *  and counts it rather than overwriting frames. Send() queues a frame
+ *  whole or not at all, and fails while the transport's queue is full.
+ *
+ *  InitUart() runs on the receive ring and the DMA transmit queue of a
+ *  UartHandler, and InitUsb() on the buffered transfers of a UsbHandle.
+ *  The transport can also be any pair of functions in a Config, see
+ *  resources/cobs_link.py for the host side.
+ *
+ *  Process(), GetFrame() and Send() are called from the main loop.
+ *  Receive() pushes bytes from another context instead, e.g. a receive
+ *  interrupt; frames that arrive while all slots are in use are dropped.
+ *
+ *  @code
+ *  static CobsLink<64, 4> link;
+ *  link.InitUart(uart, rx_ring, sizeof(rx_ring), tx_queue, sizeof(tx_queue));
+ *  while(1)
+ *  {
+ *      link.Process();
+ *      CobsLink<64, 4>::Frame frame;
+ *      while(link.GetFrame(frame))
+ *      {
+ *          HandleCommand(frame.data, frame.size);
+ *          link.ReleaseFrame();
+ *      }
+ *  }
+ *  @endcode
+ *
+ *  \tparam max_payload largest payload of a frame in bytes
+ *  \tparam num_frames received frames that can wait, a power of two
+ */
+template <size_t max_payload = 64, size_t num_frames = 4>
+class CobsLink
+{
+    static_assert(num_frames > 0 && (num_frames & (num_frames - 1)) == 0,
+                  "num_frames must be a power of two");
+
+  public:
+    /** Bytes of the CRC after the payload */
+    static constexpr size_t kCrcSize = 4;
+
+    /** Largest frame in bytes on the stream, with the COBS overhead and the
+     *  0 at the end
+     */
+    static constexpr size_t kMaxEncodedSize
+        = max_payload + kCrcSize + (max_payload + kCrcSize) / 254 + 2;
+
+    /** Reads up to size received bytes into buff
+     *  \return the number of bytes read
+     */
+    typedef size_t (*ReadFunction)(uint8_t* buff, size_t size, void* context);
+
+    /** Queues bytes to send, all of them or none
+     *  \return false if they didn't fit
+     */
+    typedef bool (*WriteFunction)(const uint8_t* buff,
+                                  size_t         size,
+                                  void*          context);
+
+    struct Config
+    {
+        ReadFunction  read    = nullptr; /**< nullptr for Receive() only */
+        WriteFunction write   = nullptr; /**< nullptr to only receive */
+        void*         context = nullptr; /**< passed to read and write */
+    };
+
+    /** A received payload, in place in its slot */
+    struct Frame
+    {
+        const uint8_t* data;
+        size_t         size;
+    };
+
+    /** Counters since Init() */
+    struct Stats
+    {
+        uint32_t rx_frames;     /**< frames received */
+        uint32_t rx_crc_errors; /**< frames with a wrong CRC */
+        uint32_t rx_errors;     /**< too long, or truncated */
+        uint32_t rx_dropped;    /**< Receive() while all slots were used */
+        uint32_t tx_frames;     /**< frames sent */
+        uint32_t tx_busy;       /**< Send() while the queue was full */
+    };
+
+    CobsLink() {}
+    ~CobsLink() {}
+
+    void Init(const Config& config)
+    {
+        config_ = config;
+        std::memset(&stats_, 0, sizeof(stats_));
+        read_.store(0, std::memory_order_relaxed);
+        write_.store(0, std::memory_order_relaxed);
+        in_pos_  = 0;
+        in_size_ = 0;
+        ResetDecoder();
+    }
+
+    /** Runs on a UartHandler, from its DMA receive ring and its transmit
+     *  queue, which are started here
+     *  \param rx_buff buffer of the receive ring, accessible by DMA
+     *  \param tx_buff buffer of the transmit queue, accessible by DMA, at
+     *                 least kMaxEncodedSize bytes
+     *  \return false if the UartHandler failed to start them
+     */
+    template <typename Uart>
+    bool InitUart(Uart&    uart,
+                  uint8_t* rx_buff,
+                  size_t   rx_size,
+                  uint8_t* tx_buff,
+                  size_t   tx_size)
+    {
+        Config config;
+        config.read    = &ReadUart<Uart>;
+        config.write   = &WriteUart<Uart>;
+        config.context = &uart;
+        Init(config);
+        return uart.SetTxQueue(tx_buff, tx_size) == Uart::Result::OK
+               && uart.DmaRingStart(rx_buff, rx_size) == Uart::Result::OK;
+    }
+
+    /** Runs on the buffered transfers of a UsbHandle port, which is
+     *  initialized already, see UsbHandle::Write() and Read()
+     */
+    template <typename Usb>
+    void InitUsb(Usb& usb, typename Usb::UsbPeriph dev)
+    {
+        Config config;
+        config.read    = &ReadUsb<Usb>;
+        config.write   = &WriteUsb<Usb>;
+        config.context = this;
+        Init(config);
+        handle_ = &usb;
+        periph_ = static_cast<int>(dev);
+        usb.StartBufferedRx(dev);
+    }
+
+    /** Decodes the bytes the transport received, while a slot is free */
+    void Process()
+    {
+        if(config_.read == nullptr)
+            return;
+        while(HasFreeSlot())
+        {
+            if(in_pos_ == in_size_)
+            {
+                in_size_ = config_.read(in_, sizeof(in_), config_.context);
+                in_pos_  = 0;
+                if(in_size_ == 0)
+                    return;
+            }
+            // stops after a frame that takes the last slot
+            while(in_pos_ < in_size_ && HasFreeSlot())
+                Decode(in_[in_pos_++]);
+        }
+    }
+
+    /** Decodes received bytes, from one context, e.g. an interrupt, instead
+     *  of Process()
+     */
+    void Receive(const uint8_t* data, size_t size)
+    {
+        for(size_t i = 0; i < size; i++)
+            Decode(data[i]);
+    }
+
+    /** Returns the oldest received frame
+     *  \return false if there's none
+     */
+    bool GetFrame(Frame& frame) const
+    {
+        const uint32_t read = read_.load(std::memory_order_relaxed);
+        if(write_.load(std::memory_order_acquire) == read)
+            return false;
+        const Slot& slot = slots_[read & kMask];
+        frame.data       = slot.data;
+        frame.size       = slot.size;
+        return true;
+    }
+
+    /** Frees the slot of the frame of GetFrame() */
+    void ReleaseFrame()
+    {
+        const uint32_t read = read_.load(std::memory_order_relaxed);
+        if(write_.load(std::memory_order_acquire) != read)
+            read_.store(read + 1, std::memory_order_release);
+    }
+
+    /** Returns the number of received frames that wait */
+    size_t GetNumFrames() const
+    {
+        return write_.load(std::memory_order_acquire)
+               - read_.load(std::memory_order_acquire);
+    }
+
+    /** Encodes a frame and queues it whole
+     *  \return false if it's too long, there's no transport, or its queue
+     *          is full, which Stats::tx_busy counts
+     */
+    bool Send(const void* payload, size_t size)
+    {
+        if(size > max_payload || config_.write == nullptr)
+            return false;
+        const size_t encoded = Encode(payload, size, tx_);
+        if(!config_.write(tx_, encoded, config_.context))
+        {
+            stats_.tx_busy++;
+            return false;
+        }
+        stats_.tx_frames++;
+        return true;
+    }
+
+    /** Encodes a frame with its CRC and the 0 at the end
+     *  \param out at least kMaxEncodedSize bytes, for size up to max_payload
+     *  \return the size of the encoded frame
+     */
+    static size_t Encode(const void* payload, size_t size, uint8_t* out)
+    {
+        const uint32_t crc = Crc32(payload, size);
+        const uint8_t  trailer[kCrcSize]
+            = {uint8_t(crc), uint8_t(crc >> 8), uint8_t(crc >> 16),
+               uint8_t(crc >> 24)};
+        auto   in       = static_cast<const uint8_t*>(payload);
+        size_t code_pos = 0;
+        size_t pos      = 1;
+        for(size_t i = 0; i < size + kCrcSize; i++)
+        {
+            const uint8_t byte = i < size ? in[i] : trailer[i - size];
+            if(byte != 0)
+                out[pos++] = byte;
+            // a block ends at each 0, and after 254 bytes without one
+            if(byte == 0 || pos - code_pos == 0xFF)
+            {
+                out[code_pos] = uint8_t(pos - code_pos);
+                code_pos      = pos++;
+            }
+        }
+        out[code_pos] = uint8_t(pos - code_pos);
+        out[pos++]    = 0;
+        return pos;
+    }
+
+    const Stats& GetStats() const { return stats_; }
+
+  private:
+    static constexpr uint32_t kMask = num_frames - 1;
+
+    struct Slot
+    {
+        uint8_t data[max_payload + kCrcSize];
+        size_t  size;
+    };
+
+    bool HasFreeSlot() const
+    {
+        return write_.load(std::memory_order_relaxed)
+                   - read_.load(std::memory_order_acquire)
+               < num_frames;
+    }
+
+    void ResetDecoder()
+    {
+        size_        = 0;
+        block_left_  = 0;
+        zero_next_   = false;
+        error_       = false;
+        dropped_     = false;
+        has_started_ = false;
+    }
+
+    /** One byte of the stream, into the slot after the last frame */
+    void Decode(uint8_t byte)
+    {
+        if(byte == 0)
+        {
+            EndFrame();
+            return;
+        }
+        has_started_ = true;
+        if(block_left_ == 0)
+        {
+            // a code byte: the block's length, and whether a 0 follows it
+            if(zero_next_)
+                Append(0);
+            block_left_ = byte - 1;
+            zero_next_  = byte != 0xFF;
+        }
+        else
+        {
+            Append(byte);
+            block_left_--;
+        }
+    }
+
+    void Append(uint8_t byte)
+    {
+        if(size_ >= sizeof(Slot::data))
+        {
+            error_ = true;
+            return;
+        }
+        // with all slots in use, the next one is the oldest frame's
+        if(dropped_ || !HasFreeSlot())
+        {
+            dropped_ = true;
+            return;
+        }
+        const uint32_t write = write_.load(std::memory_order_relaxed);
+        slots_[write & kMask].data[size_++] = byte;
+    }
+
+    void EndFrame()
+    {
+        if(!has_started_)
+            return; // 0s between frames
+        const uint32_t write = write_.load(std::memory_order_relaxed);
+        Slot&          slot  = slots_[write & kMask];
+        if(dropped_)
+        {
+            stats_.rx_dropped++;
+        }
+        else if(error_ || block_left_ != 0 || size_ < kCrcSize)
+        {
+            stats_.rx_errors++;
+        }
+        else
+        {
+            const size_t   size = size_ - kCrcSize;
+            const uint8_t* crc  = slot.data + size;
+            const uint32_t sent = uint32_t(crc[0]) | uint32_t(crc[1]) << 8
+                                  | uint32_t(crc[2]) << 16
+                                  | uint32_t(crc[3]) << 24;
+            if(Crc32(slot.data, size) != sent)
+            {
+                stats_.rx_crc_errors++;
+            }
+            else
+            {
+                slot.size = size;
+                stats_.rx_frames++;
+                write_.store(write + 1, std::memory_order_release);
+            }
+        }
+        ResetDecoder();
+    }
+
+    template <typename Uart>
+    static size_t ReadUart(uint8_t* buff, size_t size, void* context)
+    {
+        auto&                 uart = *static_cast<Uart*>(context);
+        typename Uart::RxSpan span;
+        uart.GetRxSpan(span);
+        size_t read = 0;
+        for(size_t i = 0; i < 2 && read < size; i++)
+        {
+            const size_t n = span.size[i] < size - read ? span.size[i]
+                                                        : size - read;
+            std::memcpy(buff + read, span.data[i], n);
+            read += n;
+        }
+        uart.ReleaseRx(read);
+        return read;
+    }
+
+    template <typename Uart>
+    static bool WriteUart(const uint8_t* buff, size_t size, void* context)
+    {
+        return static_cast<Uart*>(context)->QueueTx(buff, size)
+               == Uart::Result::OK;
+    }
+
+    template <typename Usb>
+    static size_t ReadUsb(uint8_t* buff, size_t size, void* context)
+    {
+        auto       link = static_cast<CobsLink*>(context);
+        const auto dev  = static_cast<typename Usb::UsbPeriph>(link->periph_);
+        return static_cast<Usb*>(link->handle_)->Read(buff, size, dev);
+    }
+
+    template <typename Usb>
+    static bool WriteUsb(const uint8_t* buff, size_t size, void* context)
+    {
+        auto       link = static_cast<CobsLink*>(context);
+        Usb&       usb  = *static_cast<Usb*>(link->handle_);
+        const auto dev  = static_cast<typename Usb::UsbPeriph>(link->periph_);
+        return usb.GetTxSpace(dev) >= size
+               && usb.Write(buff, size, dev) == size;
+    }
+
+    Config                config_;
+    Stats                 stats_;
+    Slot                  slots_[num_frames];
+    std::atomic<uint32_t> read_{0};
+    std::atomic<uint32_t> write_{0};
+
+    /** decoder of the frame after the last one */
+    size_t  size_;
+    size_t  block_left_;
+    bool    zero_next_;
+    bool    error_;
+    bool    dropped_;
+    bool    has_started_;
+    uint8_t in_[64];
+    size_t  in_pos_;
+    size_t  in_size_;
+    uint8_t tx_[kMaxEncodedSize];
+
+    /** the UsbHandle and its port, for InitUsb() */
+    void* handle_ = nullptr;
+    int   periph_ = 0;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,248 @@
+#pragma once
+#ifndef DSY_CONTAINERBENCHMARK_H
+#define DSY_CONTAINERBENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/FIFO.h"
+#include "util/FixedCapStr.h"
+#include "util/MappedValue.h"
+#include "util/Stack.h"
+#include "util/ringbuffer.h"
+
+namespace daisy
+{
+/** @brief Times the core operations of the util containers
+ *  @addtogroup utility
+ *
+ *  Runs the operations of FIFO, RingBuffer, Stack, FixedCapStr and
+ *  MappedFloatValue that are used in audio callbacks and UI updates in
+ *  tight loops, and counts the time of each with a counter passed in:
+ *  System::GetCycleCount() on the Daisy, see the Container_Benchmark
+ *  example, or a nanosecond clock on the host, see tests/benchmark.
+ *  The same code runs on both, so a change to one of the headers can be
+ *  measured on the host before it's tried on the hardware.
+ */
+class ContainerBenchmark
+{
+  public:
+    /** Returns a free running 32 bit count, e.g. of CPU cycles */
+    typedef uint32_t (*Counter)();
+
+    /** Timing of one operation */
+    struct Result
+    {
+        const char* name;  /**< container and operation */
+        uint32_t    ops;   /**< operations timed */
+        uint32_t    count; /**< counter difference over all of them */
+
+        /** Counts per operation, e.g. cycles */
+        float PerOp() const { return ops > 0 ? float(count) / ops : 0.f; }
+    };
+
+    /** Number of operations Run() times */
+    static constexpr size_t kNumResults = 9;
+
+    /** Times all operations, each repeated enough to take about a
+     *  millisecond on the Daisy.
+     *  \param counter free running count
+     *  \param results kNumResults entries are filled in
+     *  \param scale repeats the operations this many times as often
+     */
+    static void Run(Counter counter, Result* results, uint32_t scale = 1)
+    {
+        const uint32_t n = 4096 * scale;
+        size_t         i = 0;
+        results[i++]     = FifoPushPop(counter, n);
+        results[i++]     = RingBufferWriteRead(counter, n);
+        results[i++]     = RingBufferBlock(counter, n / 32);
+        results[i++]     = StackPushPop(counter, n);
+        results[i++]     = StrAppendInt(counter, n / 8);
+        results[i++]     = StrAppendFloat(counter, n / 8);
+        results[i++]     = MappedLinSet(counter, n);
+        results[i++]     = MappedLogSet(counter, n / 4);
+        results[i++]     = MappedToString(counter, n / 8);
+    }
+
+    /** Prints the column titles of the table PrintRow() fills
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void PrintHeader(const char* unit)
+    {
+        LoggerType::PrintLine("%-28s %8s %10s", "operation", "ops", unit);
+    }
+
+    /** Prints a result as one line of the table, with the count per
+     *  operation to a tenth
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void PrintRow(const Result& r)
+    {
+        const unsigned long tenths = (unsigned long)(r.PerOp() * 10.f + 0.5f);
+        LoggerType::PrintLine("%-28s %8lu %8lu.%lu",
+                              r.name,
+                              (unsigned long)r.ops,
+                              tenths / 10,
+                              tenths % 10);
+    }
+
+  private:
+    // Keeps the compiler from dropping the results
+    static volatile int32_t& Sink()
+    {
+        static volatile int32_t sink;
+        return sink;
+    }
+
+    static Result FifoPushPop(Counter counter, uint32_t n)
+    {
+        static FIFO<int32_t, 64> fifo;
+        fifo.Clear();
+        for(int32_t i = 0; i < 32; i++)
+            fifo.PushBack(i);
+        int32_t        acc   = 0;
+        const uint32_t start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            fifo.PushBack(int32_t(i));
+            acc += fifo.PopFront();
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = acc;
+        return {"FIFO PushBack+PopFront", n, count};
+    }
+
+    static Result RingBufferWriteRead(Counter counter, uint32_t n)
+    {
+        static RingBuffer<float, 64> rb;
+        rb.Init();
+        for(size_t i = 0; i < 32; i++)
+            rb.Write(0.f);
+        float          acc   = 0.f;
+        const uint32_t start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            rb.Write(float(i));
+            acc += rb.Read();
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(acc);
+        return {"RingBuffer Write+Read", n, count};
+    }
+
+    static Result RingBufferBlock(Counter counter, uint32_t n)
+    {
+        static RingBuffer<float, 256> rb;
+        static float                  block[32];
+        rb.Init();
+        for(size_t i = 0; i < 32; i++)
+            block[i] = float(i);
+        const uint32_t start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            rb.Overwrite(block, 32);
+            rb.ImmediateRead(block, 32);
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(block[31]);
+        return {"RingBuffer 32 sample block", n, count};
+    }
+
+    static Result StackPushPop(Counter counter, uint32_t n)
+    {
+        static Stack<int32_t, 64> stack;
+        int32_t                   acc   = 0;
+        const uint32_t            start = counter();
+        for(uint32_t i = 0; i < n; i += 64)
+        {
+            for(int32_t j = 0; j < 64; j++)
+                stack.PushBack(j);
+            for(int32_t j = 0; j < 64; j++)
+                acc += stack.PopBack();
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = acc;
+        return {"Stack PushBack+PopBack", n, count};
+    }
+
+    static Result StrAppendInt(Counter counter, uint32_t n)
+    {
+        FixedCapStr<32> str;
+        const uint32_t  start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            str.Clear();
+            str.AppendInt(int32_t(i * 2654435761u));
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(str.Size());
+        return {"FixedCapStr AppendInt", n, count};
+    }
+
+    static Result StrAppendFloat(Counter counter, uint32_t n)
+    {
+        FixedCapStr<32> str;
+        const uint32_t  start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            str.Clear();
+            str.AppendFloat(float(i) * 0.37f - 500.f, 2);
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(str.Size());
+        return {"FixedCapStr AppendFloat", n, count};
+    }
+
+    static Result MappedSet(Counter           counter,
+                            uint32_t          n,
+                            MappedFloatValue& value,
+                            const char*       name)
+    {
+        float          acc   = 0.f;
+        const uint32_t start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            value.SetFrom0to1(float(i & 1023) * (1.f / 1023.f));
+            acc += value.Get();
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(acc);
+        return {name, n, count};
+    }
+
+    static Result MappedLinSet(Counter counter, uint32_t n)
+    {
+        MappedFloatValue value(-1.f, 1.f, 0.f);
+        return MappedSet(counter, n, value, "MappedFloatValue lin set");
+    }
+
+    static Result MappedLogSet(Counter counter, uint32_t n)
+    {
+        MappedFloatValue value(
+            20.f, 20000.f, 1000.f, MappedFloatValue::Mapping::log);
+        return MappedSet(counter, n, value, "MappedFloatValue log set");
+    }
+
+    static Result MappedToString(Counter counter, uint32_t n)
+    {
+        MappedFloatValue value(
+            20.f, 20000.f, 1000.f, MappedFloatValue::Mapping::log, "Hz", 1);
+        FixedCapStr<32> str;
+        const uint32_t  start = counter();
+        for(uint32_t i = 0; i < n; i++)
+        {
+            value.SetFrom0to1(float(i & 255) * (1.f / 255.f));
+            str.Clear();
+            value.AppentToString(str);
+        }
+        const uint32_t count = counter() - start;
+        Sink()               = int32_t(str.Size());
+        return {"MappedFloatValue to string", n, count};
+    }
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef DSY_CONTROLRATECLOCK_H
+#define DSY_CONTROLRATECLOCK_H
+
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Runs control updates at a fixed rate from the audio callback,
+ *  whatever the block size
+ *  @addtogroup utility
+ *
+ *  Processing the controls in every audio callback costs more the smaller
+ *  the blocks get, while the controls themselves don't change any faster.
+ *  Tick() is called once per block, and tells when an update of the
+ *  controls is due, at a rate of its own, e.g. 500Hz. The update rate is
+ *  kept exactly over time, by picking the blocks from a 32 bit phase, and
+ *  a rate of the block rate divided by N updates every N blocks.
+ *
+ *  GetPhase() is how far the current block is from the last update to
+ *  the next one, to interpolate from the value before the last update to
+ *  the value of that update (see AnalogControl::Interpolate()). This
+ *  delays the values by one update, but they change smoothly.
+ *
+ *  @code
+ *  ControlRateClock clock;
+ *  clock.Init(hw.AudioCallbackRate(), 500.f);
+ *  // in the audio callback
+ *  if(clock.Tick())
+ *      knob.Process();
+ *  float cutoff = knob.Interpolate(clock.GetPhase());
+ *  @endcode
+ *
+ *  The board classes, e.g. DaisyPod, run one with SetControlRate().
+ */
+class ControlRateClock
+{
+  public:
+    ControlRateClock()
+    : block_rate_(1000.f), requested_(0.f), rate_(1000.f), inc_(0), phase_(0)
+    {
+    }
+
+    /** Starts the clock, the next Tick() is due
+     *  \param block_rate audio callbacks per second
+     *  \param control_rate updates per second, 0 to update with every
+     *         block. Rates from the block rate up also update every block.
+     */
+    void Init(float block_rate, float control_rate = 0.f)
+    {
+        block_rate_ = block_rate;
+        requested_  = control_rate;
+        Update();
+        phase_ = 0u - inc_;
+    }
+
+    /** Changes the update rate, keeping the phase */
+    void SetRate(float control_rate)
+    {
+        requested_ = control_rate;
+        Update();
+    }
+
+    /** Changes the block rate, e.g. after a new block size, keeping the
+     *  update rate
+     */
+    void SetBlockRate(float block_rate)
+    {
+        block_rate_ = block_rate;
+        Update();
+    }
+
+    /** Advances by a block, to be called once per audio callback
+     *  \returns true if an update is due in this block
+     */
+    bool Tick()
+    {
+        if(inc_ == 0)
+            return true;
+        const uint32_t prev = phase_;
+        phase_ += inc_;
+        return phase_ < prev;
+    }
+
+    /** Returns how far the current block is from the last update to the
+     *  next one, 0 to 1. Always 1 when updating every block.
+     */
+    float GetPhase() const
+    {
+        return inc_ == 0 ? 1.f : float(phase_) * kPhaseToFloat;
+    }
+
+    /** Returns how much GetPhase() grows per block, 0 when updating every
+     *  block, e.g. to ramp the interpolation through the samples of a
+     *  block
+     */
+    float GetPhaseIncrement() const { return float(inc_) * kPhaseToFloat; }
+
+    /** Returns the actual update rate in Hz, e.g. for the slew rates of
+     *  the controls
+     */
+    float GetRate() const { return rate_; }
+
+    /** Returns true if there's an update with every block */
+    bool IsEveryBlock() const { return inc_ == 0; }
+
+  private:
+    static constexpr float kPhaseToFloat = 1.f / 4294967296.f;
+
+    void Update()
+    {
+        if(requested_ <= 0.f || requested_ >= block_rate_)
+        {
+            inc_  = 0;
+            rate_ = block_rate_;
+            return;
+        }
+        // rounded up, so N blocks of 1/N always wrap around
+        const double ratio = double(requested_) / double(block_rate_);
+        const double inc   = ratio * 4294967296.0;
+        inc_  = uint32_t(inc) + (double(uint32_t(inc)) < inc ? 1 : 0);
+        rate_ = requested_;
+    }
+
+    float    block_rate_;
+    float    requested_;
+    float    rate_;
+    uint32_t inc_;
+    uint32_t phase_;
+};
+
+} // namespace daisy
+
+#endif
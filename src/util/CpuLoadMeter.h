@@ -14,6 +14,9 @@ namespace daisy
  *  Then at the beginning of the audio callback, call `OnBlockStart()`, 
  *  and at the end of the audio callback, call `OnBlockEnd()`.
  *  You can then read out the minimum, maximum and average CPU load.
+ *
+ *  After System::SetSysClkFreq() the meter uses the new tick rate, the
+ *  block during which the clock changed isn't counted.
  */
 class CpuLoadMeter
 {
@@ -30,9 +33,8 @@ class CpuLoadMeter
               int   blockSizeInSamples,
               float smoothingFilterCutoffHz = 1.0f)
     {
-        const auto secPerBlock = float(blockSizeInSamples) / sampleRateInHz;
-        const auto ticksPerS   = float(System::GetTickFreq());
-        ticksPerBlockInv_      = 1.0f / (ticksPerS * secPerBlock);
+        secPerBlock_ = float(blockSizeInSamples) / sampleRateInHz;
+        UpdateTickRate();
 
         // update filter coefficient for smoothing filter (1pole lowpass)
         const auto blockRateInHz = sampleRateInHz / float(blockSizeInSamples);
@@ -51,7 +53,12 @@ class CpuLoadMeter
     /** Call this at the end of your audio callback */
     void OnBlockEnd()
     {
-        const auto end         = System::GetTick();
+        const auto end = System::GetTick();
+        if(System::GetClockChangeCount() != clockChangeCount_)
+        {
+            UpdateTickRate();
+            return;
+        }
         const auto ticksPassed = end - currentBlockStartTicks_;
         const auto currentBlockLoad
             = float(ticksPassed) * ticksPerBlockInv_; // usPassed / usPerBlock
@@ -88,7 +95,16 @@ class CpuLoadMeter
     }
 
   private:
+    void UpdateTickRate()
+    {
+        clockChangeCount_    = System::GetClockChangeCount();
+        const auto ticksPerS = float(System::GetTickFreq());
+        ticksPerBlockInv_    = 1.0f / (ticksPerS * secPerBlock_);
+    }
+
     bool     firstCycle_;
+    float    secPerBlock_;
+    uint32_t clockChangeCount_;
     float    ticksPerBlockInv_;
     uint32_t currentBlockStartTicks_;
     float    min_;
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef DSY_CRC32_H
+#define DSY_CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief CRC-32 (IEEE 802.3, as used by zip and png)
+ *  @addtogroup utility
+ *
+ *  Uses a 16 entry table, which is a good compromise between speed and
+ *  size for checking stored data.
+ *
+ *  \param data buffer to check
+ *  \param size size of data in bytes
+ *  \param crc result for the data before, to compute the CRC of several
+ *             buffers in a row, 0 to start.
+ */
+inline uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0)
+{
+    static const uint32_t table[16] = {0x00000000,
+                                       0x1db71064,
+                                       0x3b6e20c8,
+                                       0x26d930ac,
+                                       0x76dc4190,
+                                       0x6b6b51f4,
+                                       0x4db26158,
+                                       0x5005713c,
+                                       0xedb88320,
+                                       0xf00f9344,
+                                       0xd6d6a3e8,
+                                       0xcb61b38c,
+                                       0x9b64c2b0,
+                                       0x86d3d2d4,
+                                       0xa00ae278,
+                                       0xbdbdf21c};
+    auto bytes = static_cast<const uint8_t*>(data);
+    crc        = ~crc;
+    for(size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ bytes[i]) & 0x0f] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0f] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "sys/system.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Cycle-precise CPU load metering with a load histogram
+ *  @addtogroup utility
+ *
+ *  Works like the CpuLoadMeter, but measures with the DWT cycle counter
+ *  instead of the system tick, and keeps a histogram of the per-block load.
+ *  This allows to read out percentiles (e.g. p50, p95, p99), which show the
+ *  occasional long blocks that cause dropouts, even when the average
+ *  load is low.
+ *
+ *  `OnBlockStart()` and `OnBlockEnd()` only use integer arithmetic, the
+ *  floating point work is done when reading out the results.
+ *
+ *  After System::SetSysClkFreq() the meter uses the new cycle rate, and
+ *  scales the cycles counted so far to it, the block during which the
+ *  clock changed isn't counted.
+ *
+ *  @tparam numBins The number of histogram bins spread over 0..100% load.
+ *                  Blocks with more than 100% load are collected in an
+ *                  additional overflow bin.
+ */
+template <size_t numBins = 100>
+class CycleCpuLoadMeter
+{
+  public:
+    CycleCpuLoadMeter(){};
+
+    /** Initializes the meter for a particular sample rate and block size.
+     *  @param sampleRateInHz           The sample rate in Hz
+     *  @param blockSizeInSamples       The block size in samples
+     */
+    void Init(float sampleRateInHz, int blockSizeInSamples)
+    {
+        secPerBlock_ = float(blockSizeInSamples) / sampleRateInHz;
+        UpdateCycleRate();
+        Reset();
+    }
+
+    /** Call this at the beginning of your audio callback */
+    void OnBlockStart() { currentBlockStartCycles_ = System::GetCycleCount(); }
+
+    /** Call this at the end of your audio callback */
+    void OnBlockEnd()
+    {
+        const uint32_t end = System::GetCycleCount();
+        if(System::GetClockChangeCount() != clockChangeCount_)
+        {
+            const auto oldCyclesPerBlock = double(cyclesPerBlock_);
+            UpdateCycleRate();
+            const auto scale = double(cyclesPerBlock_) / oldCyclesPerBlock;
+            maxCycles_       = uint32_t(double(maxCycles_) * scale);
+            totalCycles_     = uint64_t(double(totalCycles_) * scale);
+            return;
+        }
+        const uint32_t cyclesPassed = end - currentBlockStartCycles_;
+
+        size_t bin = size_t((uint64_t(cyclesPassed) * binsPerCycle_) >> 32);
+        if(bin > numBins)
+            bin = numBins;
+        histogram_[bin]++;
+
+        if(cyclesPassed > maxCycles_)
+            maxCycles_ = cyclesPassed;
+        totalCycles_ += cyclesPassed;
+        numBlocks_++;
+    }
+
+    /** Returns the number of blocks measured since the last call to Reset() */
+    uint32_t GetNumBlocks() const { return numBlocks_; }
+
+    /** Returns the average CPU load since the last call to Reset(),
+     *  or NAN if no block was measured yet.
+     */
+    float GetAvgCpuLoad() const
+    {
+        if(numBlocks_ == 0)
+            return NAN;
+        return float(totalCycles_) / float(numBlocks_) * cyclesPerBlockInv_;
+    }
+
+    /** Returns the maximum CPU load observed since the last call to Reset(),
+     *  or NAN if no block was measured yet.
+     */
+    float GetMaxCpuLoad() const
+    {
+        if(numBlocks_ == 0)
+            return NAN;
+        return float(maxCycles_) * cyclesPerBlockInv_;
+    }
+
+    /** Returns the load that the given fraction of all blocks did not exceed
+     *  since the last call to Reset(), or NAN if no block was measured yet.
+     *  The result is rounded up to the next histogram bin edge, but never
+     *  exceeds the maximum load.
+     *  @param percentile   The percentile in the range 0..1, e.g. 0.99 for p99
+     */
+    float GetPercentileCpuLoad(float percentile) const
+    {
+        if(numBlocks_ == 0)
+            return NAN;
+        const auto maxLoad = GetMaxCpuLoad();
+        const auto target  = uint32_t(std::ceil(percentile * numBlocks_));
+
+        uint32_t count = 0;
+        for(size_t bin = 0; bin < numBins; bin++)
+        {
+            count += histogram_[bin];
+            if(count >= target && count > 0)
+            {
+                const auto upperEdge = float(bin + 1) / float(numBins);
+                return upperEdge < maxLoad ? upperEdge : maxLoad;
+            }
+        }
+        // in the overflow bin
+        return maxLoad;
+    }
+
+    /** Returns the median CPU load */
+    float GetP50CpuLoad() const { return GetPercentileCpuLoad(0.5f); }
+    /** Returns the 95th percentile of the CPU load */
+    float GetP95CpuLoad() const { return GetPercentileCpuLoad(0.95f); }
+    /** Returns the 99th percentile of the CPU load */
+    float GetP99CpuLoad() const { return GetPercentileCpuLoad(0.99f); }
+
+    /** Returns the number of blocks that took longer than the block
+     *  duration (more than 100% load) since the last call to Reset().
+     */
+    uint32_t GetNumOverloadedBlocks() const { return histogram_[numBins]; }
+
+    /** Resets the histogram and all load readings. */
+    void Reset()
+    {
+        for(auto& count : histogram_)
+            count = 0;
+        maxCycles_   = 0;
+        totalCycles_ = 0;
+        numBlocks_   = 0;
+    }
+
+  private:
+    void UpdateCycleRate()
+    {
+        clockChangeCount_     = System::GetClockChangeCount();
+        const auto cyclesPerS = float(System::GetCpuFreq());
+        cyclesPerBlock_       = uint32_t(cyclesPerS * secPerBlock_);
+        if(cyclesPerBlock_ <= numBins)
+            cyclesPerBlock_ = numBins + 1;
+        cyclesPerBlockInv_ = 1.0f / float(cyclesPerBlock_);
+
+        // bins per cycle as a 0.32 fixed point factor, so that OnBlockEnd()
+        // can find the bin with a single multiply instead of a division.
+        binsPerCycle_ = uint32_t((uint64_t(numBins) << 32) / cyclesPerBlock_);
+    }
+
+    float    secPerBlock_;
+    uint32_t clockChangeCount_;
+    uint32_t cyclesPerBlock_;
+    uint32_t binsPerCycle_;
+    float    cyclesPerBlockInv_;
+    uint32_t currentBlockStartCycles_;
+    uint32_t histogram_[numBins + 1];
+    uint32_t maxCycles_;
+    uint64_t totalCycles_;
+    uint32_t numBlocks_;
+
+    CycleCpuLoadMeter(const CycleCpuLoadMeter&) = delete;
+    CycleCpuLoadMeter& operator=(const CycleCpuLoadMeter&) = delete;
+};
+} // namespace daisy
@@ -0,0 +1,182 @@
+#pragma once
+#ifndef DSY_DMABUFFER_H
+#define DSY_DMABUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sys/dma.h"
+
+namespace daisy
+{
+/** @brief A buffer for DMA transfers that owns whole cache lines
+ *  @addtogroup utility
+ *
+ *  The data starts on a 32 byte cache line and is padded to the end of its
+ *  last line, so cleaning or invalidating it can never write back or throw
+ *  away data of a neighbouring variable, which is what happens when a raw
+ *  pointer and size are rounded to lines by hand.
+ *
+ *  Where it lives is still up to the declaration. DMA1/2 and the SAI can't
+ *  reach the DTCM, so a DmaBuffer goes into D2 SRAM (non-cached), the AXI
+ *  SRAM or the SDRAM (cached, so Clean() and Invalidate() are needed):
+ *  @code
+ *  static DmaBuffer<uint8_t, 256> DMA_BUFFER_MEM_SECTION rx_buffer;
+ *  static DmaBuffer<int32_t, 1024> DSY_SDRAM_BSS         tx_buffer;
+ *
+ *  tx_buffer[i] = sample;     // CPU writes
+ *  tx_buffer.MarkDirty(i, 1); // remember them
+ *  tx_buffer.Clean();         // only the lines that were written go out
+ *  StartTx(tx_buffer.Data(), tx_buffer.SizeBytes());
+ *
+ *  // after a receive, before the CPU reads the first n bytes
+ *  rx_buffer.Invalidate(0, n);
+ *  @endcode
+ *
+ *  Neither the data nor the dirty range are cleared in sections that
+ *  aren't (DMA_BUFFER_MEM_SECTION, DSY_SDRAM_BSS), the first Clean() may
+ *  clean more than was written, never more than the buffer.
+ *  Without a data cache, e.g. in the unit tests, the maintenance is a no-op.
+ *
+ *  \tparam T element type, trivially copyable
+ *  \tparam N number of elements
+ */
+template <typename T, size_t N>
+class DmaBuffer
+{
+  public:
+    /** Size of a data cache line of the Cortex-M7 */
+    static constexpr size_t kCacheLineSize = 32;
+
+    /** Returns the number of elements */
+    static constexpr size_t Size() { return N; }
+
+    /** Returns the size of the data in bytes, without the padding */
+    static constexpr size_t SizeBytes() { return N * sizeof(T); }
+
+    T*       Data() { return storage_.data; }
+    const T* Data() const { return storage_.data; }
+
+    T&       operator[](size_t idx) { return storage_.data[idx]; }
+    const T& operator[](size_t idx) const { return storage_.data[idx]; }
+
+    T*       begin() { return storage_.data; }
+    T*       end() { return storage_.data + N; }
+    const T* begin() const { return storage_.data; }
+    const T* end() const { return storage_.data + N; }
+
+    /** Records that the CPU wrote elements, to be cleaned by Clean()
+     *  \param first index of the first element
+     *  \param count number of elements
+     */
+    void MarkDirty(size_t first, size_t count)
+    {
+        if(count == 0 || first >= N)
+            return;
+        const size_t last = count < N - first ? first + count : N;
+        if(!IsDirty())
+        {
+            dirty_begin_ = first;
+            dirty_end_   = last;
+            return;
+        }
+        if(first < dirty_begin_)
+            dirty_begin_ = first;
+        if(last > dirty_end_)
+            dirty_end_ = last;
+    }
+
+    /** Records that the CPU wrote the whole buffer */
+    void MarkDirty() { MarkDirty(0, N); }
+
+    /** Returns true if MarkDirty() was called since the last Clean() */
+    bool IsDirty() const
+    {
+        return dirty_begin_ < dirty_end_ && dirty_end_ <= N;
+    }
+
+    /** Returns the first element of the dirty range */
+    size_t GetDirtyBegin() const { return IsDirty() ? dirty_begin_ : 0; }
+
+    /** Returns the element after the dirty range */
+    size_t GetDirtyEnd() const { return IsDirty() ? dirty_end_ : 0; }
+
+    /** Writes the lines marked dirty to memory, before the DMA reads them */
+    void Clean()
+    {
+        if(IsDirty())
+            Clean(dirty_begin_, dirty_end_ - dirty_begin_);
+        dirty_begin_ = 0;
+        dirty_end_   = 0;
+    }
+
+    /** Writes the lines holding a range of elements to memory
+     *  \param first index of the first element
+     *  \param count number of elements
+     */
+    void Clean(size_t first, size_t count)
+    {
+        uint8_t* start;
+        size_t   size;
+        if(GetLines(first, count, start, size))
+        {
+#if !UNIT_TEST
+            dsy_dma_clear_cache_for_buffer(start, size);
+#endif
+        }
+    }
+
+    /** Drops the cached copy of the whole buffer, after the DMA wrote it.
+     *  Elements the CPU wrote and didn't clean are lost.
+     */
+    void Invalidate() { Invalidate(0, N); }
+
+    /** Drops the cached lines holding a range of elements, so the CPU reads
+     *  what the DMA wrote
+     *  \param first index of the first element
+     *  \param count number of elements
+     */
+    void Invalidate(size_t first, size_t count)
+    {
+        uint8_t* start;
+        size_t   size;
+        if(GetLines(first, count, start, size))
+        {
+#if !UNIT_TEST
+            dsy_dma_invalidate_cache_for_buffer(start, size);
+#endif
+        }
+    }
+
+  private:
+    /** The lines covering a range of elements, never beyond the padding */
+    bool GetLines(size_t first, size_t count, uint8_t*& start, size_t& size)
+    {
+        if(count == 0 || first >= N)
+            return false;
+        if(count > N - first)
+            count = N - first;
+        const size_t begin = first * sizeof(T) & ~(kCacheLineSize - 1);
+        const size_t end   = ((first + count) * sizeof(T) + kCacheLineSize - 1)
+                           & ~(kCacheLineSize - 1);
+        start = reinterpret_cast<uint8_t*>(storage_.data) + begin;
+        size  = end - begin;
+        return true;
+    }
+
+    /** Aligning the struct pads it to a whole number of lines */
+    struct alignas(kCacheLineSize) Storage
+    {
+        T data[N];
+    };
+
+    Storage storage_;
+    size_t  dirty_begin_;
+    size_t  dirty_end_;
+};
+
+template <typename T, size_t N>
+constexpr size_t DmaBuffer<T, N>::kCacheLineSize;
+
+} // namespace daisy
+
+#endif
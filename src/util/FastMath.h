@@ -0,0 +1,127 @@
+#pragma once
+#ifndef DSY_FASTMATH_H
+#define DSY_FASTMATH_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace daisy
+{
+/** @addtogroup utility
+    @{
+*/
+
+/** @brief Approximation of 2^x, for curves that are evaluated per sample
+ *
+ *  The integer part goes straight into the exponent of the result, the
+ *  fraction, rounded to -0.5..0.5, into a 5th order polynomial. The
+ *  relative error is below 4e-6 (about 0.00003 dB), and it's a few times
+ *  cheaper than powf() or expf() on the Cortex-M7.
+ *
+ *  \param x exponent, clamped to -125..127
+ */
+inline float fastpow2f(float x)
+{
+    x               = x < -125.f ? -125.f : (x > 127.f ? 127.f : x);
+    const int32_t n = int32_t(x < 0.f ? x - 0.5f : x + 0.5f);
+    const float   f = x - float(n);
+    // Taylor series of e^(f * ln2)
+    float p = 0.00133336f;
+    p       = p * f + 0.00961813f;
+    p       = p * f + 0.05550411f;
+    p       = p * f + 0.24022651f;
+    p       = p * f + 0.69314718f;
+    p       = p * f + 1.f;
+    uint32_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += uint32_t(n) << 23;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/** @brief Approximation of 2^x with a choice of accuracy, e.g. for pitch
+ *
+ *  Like fastpow2f(), with a minimax polynomial of the given order for the
+ *  fraction, fitted to the relative error. The largest errors, as an
+ *  interval in cents, are 3 for order 2, 0.13 for order 3, and 0.005 for
+ *  order 4, which is closer than fastpow2f() and a multiply-add cheaper.
+ *
+ *  \tparam order 2, 3 or 4
+ *  \param x exponent, clamped to -125..127
+ */
+template <int order>
+inline float fastpow2f_order(float x)
+{
+    static_assert(order >= 2 && order <= 4, "order must be 2, 3 or 4");
+    x               = x < -125.f ? -125.f : (x > 127.f ? 127.f : x);
+    const int32_t n = int32_t(x < 0.f ? x - 0.5f : x + 0.5f);
+    const float   f = x - float(n);
+    float         p;
+    if(order == 2)
+    {
+        p = 0.238428936f;
+        p = p * f + 0.703448006f;
+        p = p * f + 1.00044314f;
+    }
+    else if(order == 3)
+    {
+        p = 0.0551716691f;
+        p = p * f + 0.242611122f;
+        p = p * f + 0.693260985f;
+        p = p * f + 0.999928074f;
+    }
+    else
+    {
+        p = 0.00957010191f;
+        p = p * f + 0.0559178603f;
+        p = p * f + 0.240247448f;
+        p = p * f + 0.693121815f;
+        p = p * f + 0.999999261f;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += uint32_t(n) << 23;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/** @brief Approximation of log2(x)
+ *
+ *  The exponent of x is the integer part, the mantissa, scaled to
+ *  0.707..1.414, goes into the atanh series of the logarithm. The absolute
+ *  error is below 1e-5, most of it the rounding of large results.
+ *
+ *  \param x a positive, normal number. Zero, negative and denormal numbers
+ *           give meaningless results.
+ */
+inline float fastlog2f(float x)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int32_t e = int32_t((bits >> 23) & 0xff) - 127;
+    bits      = (bits & 0x7fffff) | 0x3f800000;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if(m > 1.41421356f)
+    {
+        m *= 0.5f;
+        e++;
+    }
+    // log2(m) = 2 / ln2 * atanh(s), |s| < 0.172
+    const float s  = (m - 1.f) / (m + 1.f);
+    const float s2 = s * s;
+    return float(e) + s * (2.88539008f + s2 * (0.96179669f + s2 * 0.57707801f));
+}
+
+/** Approximation of e^x, see fastpow2f() */
+inline float fastexpf(float x)
+{
+    return fastpow2f(x * 1.44269504f);
+}
+
+/** @} */
+} // namespace daisy
+
+#endif
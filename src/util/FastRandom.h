@@ -0,0 +1,103 @@
+#pragma once
+#ifndef DSY_FASTRANDOM_H
+#define DSY_FASTRANDOM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace daisy
+{
+/** @brief Seeded pseudo random numbers, fast enough for per sample noise
+ *  @addtogroup utility
+ *
+ *  A xorshift32 generator: three shifts and three xors per number, with a
+ *  period of 2^32 - 1, and nothing to wait for, so it can run in the audio
+ *  callback. The same seed always gives the same numbers. Seed it from
+ *  the hardware Random to get different numbers on every start. Not for
+ *  anything that needs to be unpredictable.
+ *
+ *  @code
+ *  FastRandom noise;
+ *  noise.Init(Random::GetValue());
+ *  // in the audio callback
+ *  noise.ProcessBlock(out, size);
+ *  @endcode
+ */
+class FastRandom
+{
+  public:
+    FastRandom() : state_(kDefaultSeed) {}
+    explicit FastRandom(uint32_t seed) { Init(seed); }
+
+    /** Starts the numbers from a seed. Any value works, 0 is replaced
+     *  since it would only give 0s.
+     */
+    void Init(uint32_t seed) { state_ = seed != 0 ? seed : kDefaultSeed; }
+
+    /** Returns a 32 bit number, never 0 */
+    inline uint32_t Next()
+    {
+        uint32_t x = state_;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state_ = x;
+        return x;
+    }
+
+    /** Returns a number from 0 up to, but not including, range */
+    inline uint32_t NextBelow(uint32_t range)
+    {
+        return uint32_t((uint64_t(Next()) * range) >> 32);
+    }
+
+    /** Returns a float from 0 up to, but not including, 1 */
+    inline float NextFloat() { return ToUnitFloat(Next()) - 1.f; }
+
+    /** Returns a float from -1 up to, but not including, 1 */
+    inline float NextBipolar() { return ToUnitFloat(Next()) * 2.f - 3.f; }
+
+    /** Returns a float from min up to, but not including, max */
+    inline float NextFloat(float min, float max)
+    {
+        return min + NextFloat() * (max - min);
+    }
+
+    /** Writes a block of white noise from -1 to 1 */
+    void ProcessBlock(float* out, size_t size)
+    {
+        uint32_t x = state_;
+        for(size_t i = 0; i < size; i++)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            out[i] = ToUnitFloat(x) * 2.f - 3.f;
+        }
+        state_ = x;
+    }
+
+    /** Returns the state, to continue from later with Init() */
+    uint32_t GetState() const { return state_; }
+
+  private:
+    static constexpr uint32_t kDefaultSeed = 0x9e3779b9;
+
+    /** The top 23 bits as the mantissa of a float from 1 to 2, which is
+     *  cheaper than converting the integer and scaling it
+     */
+    static inline float ToUnitFloat(uint32_t x)
+    {
+        const uint32_t bits = (x >> 9) | 0x3f800000u;
+        float          f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    uint32_t state_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,214 @@
+#include "util/FileIoQueue.h"
+#include "util/scopedirqblocker.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+void FileIoQueue::Init(size_t chunk_size)
+{
+    ScopedIrqBlocker irq_blocker;
+    for(auto& r : requests_)
+        r.pending = false;
+    chunk_size_  = chunk_size > 0 ? chunk_size : 4096;
+    num_pending_ = 0;
+    sequence_    = 0;
+}
+
+bool FileIoQueue::Open(FIL*                          fil,
+                       const char*                   path,
+                       BYTE                          mode,
+                       Priority                      priority,
+                       CompletionCallbackFunctionPtr callback,
+                       void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::OPEN;
+    r.priority = priority;
+    r.fil      = fil;
+    r.path     = path;
+    r.mode     = mode;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+bool FileIoQueue::Close(FIL*                          fil,
+                        Priority                      priority,
+                        CompletionCallbackFunctionPtr callback,
+                        void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::CLOSE;
+    r.priority = priority;
+    r.fil      = fil;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+bool FileIoQueue::Read(FIL*                          fil,
+                       void*                         data,
+                       size_t                        size,
+                       Priority                      priority,
+                       CompletionCallbackFunctionPtr callback,
+                       void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::READ;
+    r.priority = priority;
+    r.fil      = fil;
+    r.data     = static_cast<uint8_t*>(data);
+    r.size     = size;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+bool FileIoQueue::Write(FIL*                          fil,
+                        const void*                   data,
+                        size_t                        size,
+                        Priority                      priority,
+                        CompletionCallbackFunctionPtr callback,
+                        void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::WRITE;
+    r.priority = priority;
+    r.fil      = fil;
+    // only read from, the pointer is shared with reads
+    r.data     = static_cast<uint8_t*>(const_cast<void*>(data));
+    r.size     = size;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+bool FileIoQueue::Seek(FIL*                          fil,
+                       FSIZE_t                       offset,
+                       Priority                      priority,
+                       CompletionCallbackFunctionPtr callback,
+                       void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::SEEK;
+    r.priority = priority;
+    r.fil      = fil;
+    r.offset   = offset;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+bool FileIoQueue::Sync(FIL*                          fil,
+                       Priority                      priority,
+                       CompletionCallbackFunctionPtr callback,
+                       void*                         context)
+{
+    Request r  = {};
+    r.op       = Operation::SYNC;
+    r.priority = priority;
+    r.fil      = fil;
+    r.callback = callback;
+    r.context  = context;
+    return Push(r);
+}
+
+size_t FileIoQueue::Process(uint32_t max_us)
+{
+    const uint32_t start = System::GetUs();
+    do
+    {
+        Request* r = Next();
+        if(r == nullptr)
+            break;
+        FRESULT result = FR_OK;
+        if(Step(*r, result))
+        {
+            // free the slot first, so the callback can queue the next request
+            const CompletionCallbackFunctionPtr callback = r->callback;
+            void* const                         context  = r->context;
+            const size_t                        bytes    = r->done;
+            {
+                ScopedIrqBlocker irq_blocker;
+                r->pending = false;
+                num_pending_--;
+            }
+            if(callback)
+                callback(context, result, bytes);
+        }
+    } while(System::GetUs() - start < max_us);
+    return num_pending_;
+}
+
+bool FileIoQueue::Push(const Request& request)
+{
+    ScopedIrqBlocker irq_blocker;
+    for(auto& r : requests_)
+    {
+        if(!r.pending)
+        {
+            r          = request;
+            r.sequence = sequence_++;
+            r.pending  = true;
+            num_pending_++;
+            return true;
+        }
+    }
+    return false;
+}
+
+FileIoQueue::Request* FileIoQueue::Next()
+{
+    ScopedIrqBlocker irq_blocker;
+    Request*         next = nullptr;
+    for(auto& r : requests_)
+    {
+        if(!r.pending)
+            continue;
+        // the oldest request of each file goes first
+        bool blocked = false;
+        for(auto& other : requests_)
+        {
+            if(other.pending && other.fil == r.fil
+               && int32_t(other.sequence - r.sequence) < 0)
+            {
+                blocked = true;
+                break;
+            }
+        }
+        if(blocked)
+            continue;
+        if(next == nullptr || r.priority > next->priority
+           || (r.priority == next->priority
+               && int32_t(r.sequence - next->sequence) < 0))
+            next = &r;
+    }
+    return next;
+}
+
+bool FileIoQueue::Step(Request& r, FRESULT& result)
+{
+    switch(r.op)
+    {
+        case Operation::OPEN: result = f_open(r.fil, r.path, r.mode); break;
+        case Operation::CLOSE: result = f_close(r.fil); break;
+        case Operation::SEEK: result = f_lseek(r.fil, r.offset); break;
+        case Operation::SYNC: result = f_sync(r.fil); break;
+        case Operation::READ:
+        case Operation::WRITE:
+        {
+            const size_t left  = r.size - r.done;
+            const UINT   n     = UINT(left < chunk_size_ ? left : chunk_size_);
+            UINT         bytes = 0;
+            result = r.op == Operation::READ
+                         ? f_read(r.fil, &r.data[r.done], n, &bytes)
+                         : f_write(r.fil, &r.data[r.done], n, &bytes);
+            r.done += bytes;
+            // a short transfer means end of file, or a full volume
+            return result != FR_OK || bytes < n || r.done >= r.size;
+        }
+    }
+    return true;
+}
+
+} // namespace daisy
@@ -0,0 +1,185 @@
+#pragma once
+#ifndef DSY_FILEIOQUEUE_H
+#define DSY_FILEIOQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "ff.h"
+
+/** Number of requests that can be queued at once */
+#ifndef DSY_FILEIO_QUEUE_SIZE
+#define DSY_FILEIO_QUEUE_SIZE 16
+#endif
+
+namespace daisy
+{
+/** @brief Queue of asynchronous FatFs requests
+ *  @addtogroup utility
+ *
+ *  Requests are queued with a completion callback, and serviced in short
+ *  time slices by Process(), so a slow card doesn't block the rest of the
+ *  main loop for long. Reads and writes are split into chunks, and before
+ *  each chunk the most urgent request is picked again. This way a
+ *  streaming read doesn't have to wait for a long background write.
+ *
+ *  Requests on the same file are always executed in the order they were
+ *  queued, requests on different files by priority first.
+ *  As FatFs isn't reentrant, Process() has to be the only place FatFs is
+ *  used while requests are pending. It can be called from the main loop,
+ *  or from a low priority interrupt, e.g. a timer. Requests can be queued
+ *  from the main loop and from interrupts.
+ *
+ *  @code
+ *  void OnRead(void* context, FRESULT result, size_t bytes) { ... }
+ *
+ *  queue.Read(&fil, buff, sizeof(buff), FileIoQueue::Priority::STREAMING,
+ *             OnRead, nullptr);
+ *  while(1)
+ *  {
+ *      queue.Process(500); // up to about 500us per loop
+ *      ui.Process();
+ *  }
+ *  @endcode
+ */
+class FileIoQueue
+{
+  public:
+    /** Order in which requests on different files are serviced */
+    enum class Priority : uint8_t
+    {
+        BACKGROUND, /**< e.g. saving presets, recording to a large buffer */
+        NORMAL,
+        STREAMING, /**< e.g. refilling playback buffers */
+    };
+
+    /** Called from Process() when a request is done
+     *  \param context the pointer passed with the request
+     *  \param result FR_OK, or the error of the failed FatFs call
+     *  \param bytes number of bytes read or written, 0 for other requests
+     */
+    typedef void (*CompletionCallbackFunctionPtr)(void*   context,
+                                                  FRESULT result,
+                                                  size_t  bytes);
+
+    FileIoQueue() : num_pending_(0), sequence_(0) {}
+
+    /** Empties the queue
+     *  \param chunk_size largest part of a read or write done at once.
+     *                    Multiples of 512 keep the card accesses aligned.
+     */
+    void Init(size_t chunk_size = 4096);
+
+    /** Queues an f_open(), the path has to stay valid until completion.
+     *  \returns false if the queue is full
+     */
+    bool Open(FIL*                          fil,
+              const char*                   path,
+              BYTE                          mode,
+              Priority                      priority,
+              CompletionCallbackFunctionPtr callback,
+              void*                         context);
+
+    /** Queues an f_close()
+     *  \returns false if the queue is full
+     */
+    bool Close(FIL*                          fil,
+               Priority                      priority,
+               CompletionCallbackFunctionPtr callback,
+               void*                         context);
+
+    /** Queues reading size bytes to data, which has to stay valid until
+     *  completion. Stops early at the end of the file.
+     *  \returns false if the queue is full
+     */
+    bool Read(FIL*                          fil,
+              void*                         data,
+              size_t                        size,
+              Priority                      priority,
+              CompletionCallbackFunctionPtr callback,
+              void*                         context);
+
+    /** Queues writing size bytes from data, which has to stay valid until
+     *  completion. Stops early when the volume is full.
+     *  \returns false if the queue is full
+     */
+    bool Write(FIL*                          fil,
+               const void*                   data,
+               size_t                        size,
+               Priority                      priority,
+               CompletionCallbackFunctionPtr callback,
+               void*                         context);
+
+    /** Queues an f_lseek()
+     *  \returns false if the queue is full
+     */
+    bool Seek(FIL*                          fil,
+              FSIZE_t                       offset,
+              Priority                      priority,
+              CompletionCallbackFunctionPtr callback,
+              void*                         context);
+
+    /** Queues an f_sync()
+     *  \returns false if the queue is full
+     */
+    bool Sync(FIL*                          fil,
+              Priority                      priority,
+              CompletionCallbackFunctionPtr callback,
+              void*                         context);
+
+    /** Services the queued requests for about max_us microseconds.
+     *  At least one step (one chunk, or one other FatFs call) is done,
+     *  and a step that's started always finishes.
+     *  \returns the number of requests still pending
+     */
+    size_t Process(uint32_t max_us);
+
+    /** Returns the number of queued and unfinished requests */
+    size_t GetNumPending() const { return num_pending_; }
+
+  private:
+    enum class Operation : uint8_t
+    {
+        OPEN,
+        CLOSE,
+        READ,
+        WRITE,
+        SEEK,
+        SYNC,
+    };
+
+    struct Request
+    {
+        Operation                     op;
+        Priority                      priority;
+        bool                          pending;
+        BYTE                          mode;
+        uint32_t                      sequence; // order of queueing
+        FIL*                          fil;
+        const char*                   path;
+        uint8_t*                      data;
+        size_t                        size, done;
+        FSIZE_t                       offset;
+        CompletionCallbackFunctionPtr callback;
+        void*                         context;
+    };
+
+    /** Adds a request to a free slot */
+    bool Push(const Request& request);
+
+    /** Returns the request to service next, or nullptr */
+    Request* Next();
+
+    /** Does the next step of a request
+     *  \returns true if the request is done
+     */
+    bool Step(Request& request, FRESULT& result);
+
+    Request         requests_[DSY_FILEIO_QUEUE_SIZE];
+    size_t          chunk_size_;
+    volatile size_t num_pending_;
+    uint32_t        sequence_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,251 @@
+#pragma once
+#ifndef DSY_INTRUSIVELIST_H
+#define DSY_INTRUSIVELIST_H
+
+#include <cstddef>
+
+namespace daisy
+{
+template <typename T>
+class IntrusiveList;
+
+/** @brief Base class for the elements of an IntrusiveList
+ *  @addtogroup utility
+ *
+ *  Holds the links, so that adding and removing an element doesn't need
+ *  any memory. An element can be in one list at a time.
+ *
+ *  \tparam T the class that derives from it
+ */
+template <typename T>
+class IntrusiveListNode
+{
+  public:
+    IntrusiveListNode() : prev_(nullptr), next_(nullptr), list_(nullptr) {}
+
+    /** A copy isn't linked to anything */
+    IntrusiveListNode(const IntrusiveListNode&)
+    : prev_(nullptr), next_(nullptr), list_(nullptr)
+    {
+    }
+
+    /** Keeps the links of this element */
+    IntrusiveListNode& operator=(const IntrusiveListNode&) { return *this; }
+
+    /** Returns true if the element is in a list */
+    bool IsLinked() const { return list_ != nullptr; }
+
+  private:
+    friend class IntrusiveList<T>;
+
+    T*                prev_;
+    T*                next_;
+    IntrusiveList<T>* list_;
+};
+
+/** @brief Doubly linked list of elements that hold their own links
+ *  @addtogroup utility
+ *
+ *  The elements derive from IntrusiveListNode, and the list only points
+ *  to them, so adding, removing and moving an element to another list
+ *  take constant time and no memory. E.g. the active voices of a synth,
+ *  oldest first, for voice stealing, with the voices from an ObjectPool.
+ *  Not interrupt safe.
+ *
+ *  @code
+ *  struct Voice : IntrusiveListNode<Voice>
+ *  {
+ *      uint8_t note;
+ *  };
+ *  IntrusiveList<Voice> playing;
+ *
+ *  playing.PushBack(voice);
+ *  for(Voice& v : playing)
+ *      v.Process();
+ *  Voice* oldest = playing.PopFront();
+ *  @endcode
+ *
+ *  To remove elements while walking the list, get the Next() one before
+ *  removing the current one.
+ *
+ *  \tparam T element type, derived from IntrusiveListNode<T>
+ */
+template <typename T>
+class IntrusiveList
+{
+  public:
+    /** Forward iterator over the elements */
+    class Iterator
+    {
+      public:
+        explicit Iterator(T* node) : node_(node) {}
+        T&        operator*() const { return *node_; }
+        T*        operator->() const { return node_; }
+        Iterator& operator++()
+        {
+            node_ = Node(node_)->next_;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const
+        {
+            return node_ != other.node_;
+        }
+        bool operator==(const Iterator& other) const
+        {
+            return node_ == other.node_;
+        }
+
+      private:
+        T* node_;
+    };
+
+    IntrusiveList() : head_(nullptr), tail_(nullptr), size_(0) {}
+
+    /** Unlinks all elements */
+    ~IntrusiveList() { Clear(); }
+
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+    /** Adds an element at the front
+     *  \returns false if the element is already in a list
+     */
+    bool PushFront(T& element) { return Insert(element, nullptr, head_); }
+
+    /** Adds an element at the back
+     *  \returns false if the element is already in a list
+     */
+    bool PushBack(T& element) { return Insert(element, tail_, nullptr); }
+
+    /** Adds an element before another one of this list
+     *  \returns false if the element is already in a list, or position
+     *           isn't in this one
+     */
+    bool InsertBefore(T& position, T& element)
+    {
+        if(Node(&position)->list_ != this)
+            return false;
+        return Insert(element, Node(&position)->prev_, &position);
+    }
+
+    /** Adds an element after another one of this list
+     *  \returns false if the element is already in a list, or position
+     *           isn't in this one
+     */
+    bool InsertAfter(T& position, T& element)
+    {
+        if(Node(&position)->list_ != this)
+            return false;
+        return Insert(element, &position, Node(&position)->next_);
+    }
+
+    /** Removes an element
+     *  \returns false if the element isn't in this list
+     */
+    bool Remove(T& element)
+    {
+        IntrusiveListNode<T>* node = Node(&element);
+        if(node->list_ != this)
+            return false;
+        if(node->prev_ != nullptr)
+            Node(node->prev_)->next_ = node->next_;
+        else
+            head_ = node->next_;
+        if(node->next_ != nullptr)
+            Node(node->next_)->prev_ = node->prev_;
+        else
+            tail_ = node->prev_;
+        node->prev_ = nullptr;
+        node->next_ = nullptr;
+        node->list_ = nullptr;
+        size_--;
+        return true;
+    }
+
+    /** Removes and returns the first element, nullptr if it's empty */
+    T* PopFront()
+    {
+        T* element = head_;
+        if(element != nullptr)
+            Remove(*element);
+        return element;
+    }
+
+    /** Removes and returns the last element, nullptr if it's empty */
+    T* PopBack()
+    {
+        T* element = tail_;
+        if(element != nullptr)
+            Remove(*element);
+        return element;
+    }
+
+    /** Unlinks all elements */
+    void Clear()
+    {
+        while(PopFront() != nullptr) {}
+    }
+
+    /** Returns true if the element is in this list */
+    bool Contains(const T& element) const
+    {
+        return Node(&element)->list_ == this;
+    }
+
+    /** Returns the first element, nullptr if it's empty */
+    T* Front() const { return head_; }
+
+    /** Returns the last element, nullptr if it's empty */
+    T* Back() const { return tail_; }
+
+    /** Returns the element after one of this list, nullptr at the end */
+    static T* Next(const T& element) { return Node(&element)->next_; }
+
+    /** Returns the element before one of this list, nullptr at the start */
+    static T* Prev(const T& element) { return Node(&element)->prev_; }
+
+    /** Returns true if there are no elements */
+    bool IsEmpty() const { return size_ == 0; }
+
+    /** Returns the number of elements */
+    size_t GetNumElements() const { return size_; }
+
+    /** Iterators, for range based for loops */
+    Iterator begin() const { return Iterator(head_); }
+    Iterator end() const { return Iterator(nullptr); }
+
+  private:
+    static IntrusiveListNode<T>* Node(T* element) { return element; }
+    static const IntrusiveListNode<T>* Node(const T* element)
+    {
+        return element;
+    }
+
+    bool Insert(T& element, T* prev, T* next)
+    {
+        IntrusiveListNode<T>* node = Node(&element);
+        if(node->list_ != nullptr)
+            return false;
+        node->prev_ = prev;
+        node->next_ = next;
+        node->list_ = this;
+        if(prev != nullptr)
+            Node(prev)->next_ = &element;
+        else
+            head_ = &element;
+        if(next != nullptr)
+            Node(next)->prev_ = &element;
+        else
+            tail_ = &element;
+        size_++;
+        return true;
+    }
+
+    T*     head_;
+    T*     tail_;
+    size_t size_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,81 @@
+#include "util/IrqProfiler.h"
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+IrqProfiler::Stats IrqProfiler::stats_[size_t(Source::LAST)];
+volatile uint32_t  IrqProfiler::all_cycles_ = 0;
+
+const char* IrqProfiler::GetName(Source source)
+{
+    switch(source)
+    {
+        case Source::SAI_1: return "SAI1";
+        case Source::SAI_2: return "SAI2";
+        case Source::AUDIO: return "AUDIO";
+        case Source::SD_CARD: return "SDMMC";
+        case Source::USB_HS: return "USB_HS";
+        case Source::USB_FS: return "USB_FS";
+        case Source::UARTS: return "UART";
+        case Source::SPIS: return "SPI";
+        case Source::I2CS: return "I2C";
+        case Source::TIMERS: return "TIM";
+        case Source::ANALOG_IN: return "ADC";
+        case Source::ANALOG_OUT: return "DAC";
+        case Source::QSPI_FLASH: return "QSPI";
+        case Source::EXT_LINES: return "EXTI";
+        case Source::MASTER_DMA: return "MDMA";
+        case Source::DMA_2D: return "DMA2D";
+        case Source::SYSTICK: return "SYSTICK";
+        case Source::LAST: break;
+    }
+    return "";
+}
+
+uint64_t IrqProfiler::GetTotalCycles()
+{
+    ScopedIrqBlocker irq_blocker;
+    uint64_t         total = 0;
+    for(const auto& s : stats_)
+        total += s.total_cycles;
+    return total;
+}
+
+void IrqProfiler::Reset()
+{
+    ScopedIrqBlocker irq_blocker;
+    for(auto& s : stats_)
+        s = Stats{0, 0, 0, 0, 0, 0};
+}
+
+void IrqProfiler::Exit(Source source, uint32_t cycles, uint32_t nested)
+{
+    // handlers of a higher priority can end in between
+    ScopedIrqBlocker irq_blocker;
+
+    // the handlers that interrupted this one have counted their cycles
+    const uint32_t inner = all_cycles_ - nested;
+    const uint32_t own   = inner < cycles ? cycles - inner : 0;
+    all_cycles_          = all_cycles_ + own;
+    if(source >= Source::LAST)
+        return;
+    Stats& s = stats_[size_t(source)];
+    s.calls++;
+    s.total_cycles += own;
+    if(own > s.max_cycles)
+        s.max_cycles = own;
+}
+
+void IrqProfiler::AddLatency(Source source, uint32_t cycles)
+{
+    if(source >= Source::LAST)
+        return;
+    ScopedIrqBlocker irq_blocker;
+    Stats&           s = stats_[size_t(source)];
+    s.latency_samples++;
+    s.total_latency += cycles;
+    if(cycles > s.max_latency)
+        s.max_latency = cycles;
+}
+
+} // namespace daisy
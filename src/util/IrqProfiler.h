@@ -0,0 +1,193 @@
+#pragma once
+#ifndef DSY_IRQPROFILER_H
+#define DSY_IRQPROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sys/system.h"
+
+namespace daisy
+{
+/** @brief Counts the CPU cycles spent in libDaisy's interrupt handlers
+ *  @addtogroup utility
+ *
+ *  The audio callback's own cycles are measured by the AudioHandle, but the
+ *  SD card, USB, UART, SPI and timer interrupts take time from it as well,
+ *  and from the main loop. With DSY_IRQ_PROFILING defined for the whole
+ *  build of libDaisy and the program, the handlers are wrapped in
+ *  DSY_IRQ_PROFILE_SCOPE(), which counts the calls of each interrupt
+ *  source, and the total and largest number of cycles they took.
+ *
+ *  The cycles are exclusive: when a handler is interrupted by one of a
+ *  higher priority, the time of the nested handler is counted for it, and
+ *  not for the one it interrupted. The audio callback runs from the SAI
+ *  interrupts, so they include it.
+ *
+ *  The SAI DMA interrupts also measure their entry latency, the time from
+ *  the DMA reaching the half or the end of the buffer to the handler
+ *  starting. It's read from the DMA counter, so it's a multiple of one
+ *  sample slot (about 10us at 48kHz stereo), and mostly 0. Larger values
+ *  show that a handler of the same or a higher priority held it up.
+ *
+ *  Without DSY_IRQ_PROFILING, nothing is measured, and all counts stay 0.
+ *
+ *  @code
+ *  while(1)
+ *  {
+ *      System::Delay(1000);
+ *      IrqProfiler::Print<DaisySeed::Log>();
+ *      IrqProfiler::Reset();
+ *  }
+ *  @endcode
+ */
+class IrqProfiler
+{
+  public:
+    /** The interrupts libDaisy handles, grouped by peripheral */
+    enum class Source : uint8_t
+    {
+        SAI_1,      /**< DMA of the first SAI, with the audio callback */
+        SAI_2,      /**< DMA of the second SAI */
+        AUDIO,      /**< PendSV running the audio callback, buffer_depth > 2 */
+        SD_CARD,    /**< the SDMMC */
+        USB_HS,     /**< USB on the external pins */
+        USB_FS,     /**< USB on the micro USB connector */
+        UARTS,      /**< all UARTs and their DMAs */
+        SPIS,       /**< all SPIs and their DMAs */
+        I2CS,       /**< all I2Cs and their DMAs */
+        TIMERS,     /**< TIM2 to TIM5 */
+        ANALOG_IN,  /**< the ADC and its DMA */
+        ANALOG_OUT, /**< the DAC, its DMAs and TIM6 */
+        QSPI_FLASH, /**< the QSPI flash */
+        EXT_LINES,  /**< the EXTI lines, e.g. GateIn */
+        MASTER_DMA, /**< the MDMA */
+        DMA_2D,     /**< the DMA2D */
+        SYSTICK,    /**< the 1ms SysTick */
+        LAST,
+    };
+
+    /** Measurements of one source */
+    struct Stats
+    {
+        uint32_t calls;           /**< handler calls */
+        uint32_t max_cycles;      /**< longest call */
+        uint64_t total_cycles;    /**< all calls */
+        uint32_t latency_samples; /**< latency measurements */
+        uint32_t max_latency;     /**< longest entry latency in cycles */
+        uint64_t total_latency;   /**< all entry latencies in cycles */
+    };
+
+    /** Returns the measurements of a source */
+    static const Stats& GetStats(Source source)
+    {
+        return stats_[size_t(source)];
+    }
+
+    /** Returns the name of a source for printing */
+    static const char* GetName(Source source);
+
+    /** Returns the cycles of all handlers, to compare with the cycles of
+     *  the same time span, e.g. to find the share they take
+     */
+    static uint64_t GetTotalCycles();
+
+    /** Clears all measurements */
+    static void Reset();
+
+    /** Starts measuring a handler
+     *  \returns the state to pass to Exit()
+     */
+    static inline uint32_t Enter() { return all_cycles_; }
+
+    /** Ends measuring a handler
+     *  \param source the handler's source
+     *  \param cycles from its start to its end
+     *  \param nested value of Enter() at its start
+     */
+    static void Exit(Source source, uint32_t cycles, uint32_t nested);
+
+    /** Adds an entry latency, e.g. from a DMA counter
+     *  \param source the handler's source
+     *  \param cycles from the event to the start of the handler
+     */
+    static void AddLatency(Source source, uint32_t cycles);
+
+    /** Prints the table of the sources that were called.
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void Print()
+    {
+        const uint32_t cycles_per_us = System::GetCpuFreq() / 1000000;
+        LoggerType::PrintLine("%-8s %10s %10s %10s %8s %8s",
+                              "irq",
+                              "calls",
+                              "avg cyc",
+                              "max cyc",
+                              "max us",
+                              "max lat");
+        for(size_t i = 0; i < size_t(Source::LAST); i++)
+        {
+            const Stats& s = stats_[i];
+            if(s.calls == 0)
+                continue;
+            const uint32_t avg = uint32_t(s.total_cycles / s.calls);
+            const uint32_t div = cycles_per_us ? cycles_per_us : 1;
+            LoggerType::PrintLine("%-8s %10lu %10lu %10lu %8lu %8lu",
+                                  GetName(Source(i)),
+                                  (unsigned long)s.calls,
+                                  (unsigned long)avg,
+                                  (unsigned long)s.max_cycles,
+                                  (unsigned long)(s.max_cycles / div),
+                                  (unsigned long)(s.max_latency / div));
+        }
+    }
+
+  private:
+    static Stats stats_[size_t(Source::LAST)];
+
+    /** Cycles of all handlers that ended, wrapping around. A single word,
+     *  so handlers can read it without blocking the interrupts. */
+    static volatile uint32_t all_cycles_;
+};
+
+/** @brief Measures an interrupt handler from its construction to its
+ *  destruction
+ *  @addtogroup utility
+ *  Usually created with the DSY_IRQ_PROFILE_SCOPE() macro, see IrqProfiler.
+ */
+class IrqProfileScope
+{
+  public:
+    explicit IrqProfileScope(IrqProfiler::Source source)
+    : source_(source), nested_(IrqProfiler::Enter())
+    {
+        start_ = System::GetCycleCount();
+    }
+
+    ~IrqProfileScope()
+    {
+        IrqProfiler::Exit(
+            source_, System::GetCycleCount() - start_, nested_);
+    }
+
+  private:
+    IrqProfiler::Source source_;
+    uint32_t            nested_;
+    uint32_t            start_;
+
+    IrqProfileScope(const IrqProfileScope&) = delete;
+    IrqProfileScope& operator=(const IrqProfileScope&) = delete;
+};
+
+} // namespace daisy
+
+#ifdef DSY_IRQ_PROFILING
+/** Measures the rest of the enclosing interrupt handler for a Source */
+#define DSY_IRQ_PROFILE_SCOPE(source) \
+    daisy::IrqProfileScope dsy_irq_profile_scope(daisy::IrqProfiler::source)
+#else
+#define DSY_IRQ_PROFILE_SCOPE(source) /**< without DSY_IRQ_PROFILING */
+#endif
+
+#endif
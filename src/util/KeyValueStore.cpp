@@ -0,0 +1,396 @@
+#include <cstring>
+#include "util/KeyValueStore.h"
+#include "util/Crc32.h"
+#include "sys/dma.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+namespace
+{
+/** Written at the start of each sector of the log, "DKV1" */
+constexpr uint32_t kMagic = 0x31564b44;
+
+/** Key and size of erased flash, which ends the log */
+constexpr uint16_t kErased = 0xffff;
+
+struct SectorHeader
+{
+    uint32_t magic;
+    uint32_t sequence;     // increases with each sector opened
+    uint32_t inv_sequence; // ~sequence, a torn header doesn't pass
+    uint32_t reserved;
+};
+
+struct RecordHeader
+{
+    uint16_t key;
+    uint16_t size; // 0 removes the key
+    uint32_t crc;  // of key, size and data
+};
+
+constexpr uint32_t kHeaderSize = sizeof(SectorHeader);
+constexpr uint32_t kRecordHeaderSize = sizeof(RecordHeader);
+
+/** Records start 4 byte aligned */
+constexpr uint32_t RecordSize(uint32_t size)
+{
+    return kRecordHeaderSize + ((size + 3) & ~3u);
+}
+
+uint32_t RecordCrc(uint16_t key, uint16_t size, const uint8_t* data)
+{
+    const uint8_t head[4] = {uint8_t(key),
+                             uint8_t(key >> 8),
+                             uint8_t(size),
+                             uint8_t(size >> 8)};
+    return Crc32(data, size, Crc32(head, sizeof(head)));
+}
+
+bool IsErased(const uint8_t* data, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+        if(data[i] != 0xff)
+            return false;
+    return true;
+}
+
+bool IsValid(const SectorHeader* h)
+{
+    return h->magic == kMagic && (h->sequence ^ h->inv_sequence) == 0xffffffff;
+}
+
+bool IsEndOfLog(const RecordHeader* h)
+{
+    return h->key == kErased && h->size == kErased && h->crc == 0xffffffff;
+}
+
+bool IsPlausible(const RecordHeader* h, uint32_t pos)
+{
+    return h->size <= DSY_KVSTORE_MAX_VALUE_SIZE
+           && pos + RecordSize(h->size) <= KeyValueStore::kSectorSize;
+}
+} // namespace
+
+constexpr uint32_t KeyValueStore::kSectorSize;
+
+KeyValueStore::Result KeyValueStore::Init(uint32_t address_offset,
+                                          uint32_t num_sectors)
+{
+    base_        = address_offset & ~(kSectorSize - 1);
+    num_sectors_ = num_sectors;
+    num_keys_    = 0;
+    num_used_    = 0;
+    if(num_sectors < 3)
+        return Result::ERR_SIZE;
+
+    // Erase whatever isn't part of a log, e.g. an interrupted erase
+    for(uint32_t s = 0; s < num_sectors_; s++)
+    {
+        auto h = reinterpret_cast<const SectorHeader*>(
+            Data(SectorAddress(s), kHeaderSize));
+        if(IsValid(h))
+            num_used_++;
+        else if(!IsErased(Data(SectorAddress(s), kSectorSize), kSectorSize)
+                && EraseSector(s) != Result::OK)
+            return Result::ERR_QSPI;
+    }
+
+    if(num_used_ == 0)
+    {
+        active_   = num_sectors_ - 1;
+        sequence_ = 0;
+        return OpenNextSector();
+    }
+
+    // Replay the sectors from oldest to newest, so later records win
+    uint32_t last = 0;
+    for(uint32_t n = 0; n < num_used_; n++)
+    {
+        uint32_t next     = num_sectors_;
+        uint32_t next_seq = 0xffffffff;
+        for(uint32_t s = 0; s < num_sectors_; s++)
+        {
+            auto h = reinterpret_cast<const SectorHeader*>(
+                Data(SectorAddress(s), kHeaderSize));
+            if(IsValid(h) && (n == 0 || h->sequence > last)
+               && h->sequence <= next_seq)
+            {
+                next     = s;
+                next_seq = h->sequence;
+            }
+        }
+        last       = next_seq;
+        active_    = next;
+        sequence_  = next_seq;
+        write_pos_ = ScanSector(next);
+    }
+
+    // Anything after the last record is from a write that didn't finish,
+    // don't program over it.
+    if(write_pos_ < kSectorSize
+       && !IsErased(Data(SectorAddress(active_) + write_pos_,
+                         kSectorSize - write_pos_),
+                    kSectorSize - write_pos_))
+        write_pos_ = kSectorSize;
+    return Result::OK;
+}
+
+KeyValueStore::Result
+KeyValueStore::Set(uint16_t key, const void* data, size_t size)
+{
+    if(key == kErased)
+        return Result::ERR_INVALID_KEY;
+    if(size == 0 || size > DSY_KVSTORE_MAX_VALUE_SIZE || data == nullptr)
+        return Result::ERR_SIZE;
+
+    const Entry* e = Find(key);
+    if(e != nullptr && e->size == size
+       && memcmp(Data(e->address + kRecordHeaderSize, size), data, size) == 0)
+        return Result::OK;
+
+    if(e == nullptr && num_keys_ >= DSY_KVSTORE_MAX_KEYS)
+        return Result::ERR_FULL;
+
+    // Keep enough room to move the values out of the oldest sector
+    const uint32_t capacity = (num_sectors_ - 2) * (kSectorSize - kHeaderSize);
+    const uint32_t old_size = e != nullptr ? RecordSize(e->size) : 0;
+    if(GetLiveBytes() - old_size + RecordSize(size) > capacity)
+        return Result::ERR_FULL;
+
+    return Append(key, data, uint16_t(size));
+}
+
+KeyValueStore::Result
+KeyValueStore::Get(uint16_t key, void* data, size_t size) const
+{
+    const Entry* e = Find(key);
+    if(e == nullptr)
+        return Result::ERR_NOT_FOUND;
+    const size_t n = e->size < size ? e->size : size;
+    memcpy(data, Data(e->address + kRecordHeaderSize, n), n);
+    return Result::OK;
+}
+
+size_t KeyValueStore::GetSize(uint16_t key) const
+{
+    const Entry* e = Find(key);
+    return e != nullptr ? e->size : 0;
+}
+
+KeyValueStore::Result KeyValueStore::Remove(uint16_t key)
+{
+    if(Find(key) == nullptr)
+        return Result::ERR_NOT_FOUND;
+    return Append(key, nullptr, 0);
+}
+
+KeyValueStore::Result KeyValueStore::Compact()
+{
+    return num_used_ > 1 ? ReclaimOldest() : Result::OK;
+}
+
+uint32_t KeyValueStore::GetUsedBytes() const
+{
+    return (num_used_ - 1) * kSectorSize + write_pos_;
+}
+
+uint32_t KeyValueStore::GetLiveBytes() const
+{
+    uint32_t bytes = 0;
+    for(size_t i = 0; i < num_keys_; i++)
+        bytes += RecordSize(entries_[i].size);
+    return bytes;
+}
+
+const KeyValueStore::Entry* KeyValueStore::Find(uint16_t key) const
+{
+    for(size_t i = 0; i < num_keys_; i++)
+        if(entries_[i].key == key)
+            return &entries_[i];
+    return nullptr;
+}
+
+KeyValueStore::Result
+KeyValueStore::Append(uint16_t key, const void* data, uint16_t size)
+{
+    // Keep one sector erased, compacting the oldest one needs it. Moving its
+    // values can fill up the new sector when the store is almost full, so
+    // this can take more than one round.
+    for(uint32_t i = 0; write_pos_ + RecordSize(size) > kSectorSize; i++)
+    {
+        if(i == num_sectors_)
+            return Result::ERR_FULL;
+        Result res = OpenNextSector();
+        if(res == Result::OK && num_used_ >= num_sectors_)
+            res = ReclaimOldest();
+        if(res != Result::OK)
+            return res;
+    }
+    return WriteRecord(key, data, size);
+}
+
+KeyValueStore::Result
+KeyValueStore::WriteRecord(uint16_t key, const void* data, uint16_t size)
+{
+    // one write, so the flash sees a single program sequence per page
+    uint8_t      record[RecordSize(DSY_KVSTORE_MAX_VALUE_SIZE)];
+    RecordHeader h;
+    h.key  = key;
+    h.size = size;
+    h.crc  = RecordCrc(key, size, static_cast<const uint8_t*>(data));
+    const uint32_t record_size = RecordSize(size);
+    memset(record, 0xff, record_size);
+    memcpy(record, &h, kRecordHeaderSize);
+    if(size > 0)
+        memcpy(record + kRecordHeaderSize, data, size);
+
+    const uint32_t address = SectorAddress(active_) + write_pos_;
+    if(qspi_.Write(address, record_size, record) != QSPIHandle::Result::OK)
+        return Result::ERR_QSPI;
+    write_pos_ += record_size;
+    return Index(key, size, address);
+}
+
+KeyValueStore::Result KeyValueStore::OpenNextSector()
+{
+    if(num_used_ >= num_sectors_)
+        return Result::ERR_FULL;
+    // the erased sectors follow the active one around the ring
+    uint32_t next = (active_ + 1) % num_sectors_;
+    while(!IsErased(Data(SectorAddress(next), kHeaderSize), kHeaderSize))
+        next = (next + 1) % num_sectors_;
+
+    SectorHeader h;
+    h.magic        = kMagic;
+    h.sequence     = sequence_ + 1;
+    h.inv_sequence = ~h.sequence;
+    h.reserved     = 0xffffffff;
+    if(qspi_.Write(SectorAddress(next), kHeaderSize, (uint8_t*)&h)
+       != QSPIHandle::Result::OK)
+        return Result::ERR_QSPI;
+    active_    = next;
+    sequence_  = h.sequence;
+    write_pos_ = kHeaderSize;
+    num_used_++;
+    return Result::OK;
+}
+
+KeyValueStore::Result KeyValueStore::ReclaimOldest()
+{
+    uint32_t oldest     = num_sectors_;
+    uint32_t oldest_seq = 0xffffffff;
+    for(uint32_t s = 0; s < num_sectors_; s++)
+    {
+        auto h = reinterpret_cast<const SectorHeader*>(
+            Data(SectorAddress(s), kHeaderSize));
+        if(s != active_ && IsValid(h) && h->sequence < oldest_seq)
+        {
+            oldest     = s;
+            oldest_seq = h->sequence;
+        }
+    }
+    if(oldest == num_sectors_)
+        return Result::OK;
+
+    // Move the records the index still points to. Removed keys don't need
+    // their record any more, older values are in this or even older sectors.
+    const uint32_t address = SectorAddress(oldest);
+    for(uint32_t pos = kHeaderSize; pos + kRecordHeaderSize <= kSectorSize;)
+    {
+        auto h = reinterpret_cast<const RecordHeader*>(
+            Data(address + pos, kRecordHeaderSize));
+        if(IsEndOfLog(h) || !IsPlausible(h, pos))
+            break;
+        const uint16_t key  = h->key;
+        const uint16_t size = h->size;
+        const Entry*   e    = Find(key);
+        if(e != nullptr && e->address == address + pos)
+        {
+            uint8_t value[DSY_KVSTORE_MAX_VALUE_SIZE];
+            memcpy(value, Data(address + pos + kRecordHeaderSize, size), size);
+            if(write_pos_ + RecordSize(size) > kSectorSize
+               && OpenNextSector() != Result::OK)
+                return Result::ERR_FULL;
+            const Result res = WriteRecord(key, value, size);
+            if(res != Result::OK)
+                return res;
+        }
+        pos += RecordSize(size);
+    }
+
+    if(EraseSector(oldest) != Result::OK)
+        return Result::ERR_QSPI;
+    num_used_--;
+    return Result::OK;
+}
+
+KeyValueStore::Result
+KeyValueStore::Index(uint16_t key, uint16_t size, uint32_t address)
+{
+    Entry* e = const_cast<Entry*>(Find(key));
+    if(size == 0)
+    {
+        if(e != nullptr)
+            *e = entries_[--num_keys_];
+        return Result::OK;
+    }
+    if(e == nullptr)
+    {
+        if(num_keys_ >= DSY_KVSTORE_MAX_KEYS)
+            return Result::ERR_FULL;
+        e = &entries_[num_keys_++];
+    }
+    e->key     = key;
+    e->size    = size;
+    e->address = address;
+    return Result::OK;
+}
+
+uint32_t KeyValueStore::ScanSector(uint32_t sector)
+{
+    const uint32_t address = SectorAddress(sector);
+    uint32_t       pos     = kHeaderSize;
+    while(pos + kRecordHeaderSize <= kSectorSize)
+    {
+        auto h = reinterpret_cast<const RecordHeader*>(
+            Data(address + pos, kRecordHeaderSize));
+        if(IsEndOfLog(h))
+            break;
+        // a torn header, nothing after it can be trusted
+        if(!IsPlausible(h, pos))
+            return kSectorSize;
+        const uint8_t* data = Data(address + pos + kRecordHeaderSize, h->size);
+        if(h->key != kErased && h->crc == RecordCrc(h->key, h->size, data))
+            Index(h->key, h->size, address + pos);
+        pos += RecordSize(h->size);
+    }
+    return pos;
+}
+
+KeyValueStore::Result KeyValueStore::EraseSector(uint32_t sector)
+{
+    const uint32_t address = SectorAddress(sector);
+    return qspi_.Erase(address, address + kSectorSize) == QSPIHandle::Result::OK
+               ? Result::OK
+               : Result::ERR_QSPI;
+}
+
+const uint8_t* KeyValueStore::Data(uint32_t address, size_t size) const
+{
+    uint8_t* data = static_cast<uint8_t*>(qspi_.GetData(address));
+#if !UNIT_TEST
+    // Caching behavior is different when running programs outside internal
+    // flash, the mapped memory may be stale after a write or erase.
+    if(System::GetProgramMemoryRegion()
+       != System::MemoryRegion::INTERNAL_FLASH)
+    {
+        dsy_dma_invalidate_cache_for_buffer(data, size);
+    }
+#else
+    (void)size;
+#endif
+    return data;
+}
+
+} // namespace daisy
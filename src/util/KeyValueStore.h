@@ -0,0 +1,187 @@
+#pragma once
+#ifndef DSY_KEYVALUESTORE_H
+#define DSY_KEYVALUESTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "per/qspi.h"
+
+/** Number of different keys that can be stored */
+#ifndef DSY_KVSTORE_MAX_KEYS
+#define DSY_KVSTORE_MAX_KEYS 64
+#endif
+
+/** Largest value in bytes, records are assembled on the stack */
+#ifndef DSY_KVSTORE_MAX_VALUE_SIZE
+#define DSY_KVSTORE_MAX_VALUE_SIZE 256
+#endif
+
+namespace daisy
+{
+/** @brief Log-structured key/value store on the QSPI flash
+ *  @addtogroup utility
+ *
+ *  Values are appended to a log of records in a range of 4kB sectors,
+ *  instead of erasing a sector for each save like PersistentStorage.
+ *  Saving a small value only programs a few bytes, and the sectors are
+ *  used in turn, which spreads the wear over all of them.
+ *
+ *  When a sector is full, the next one is used. When only one erased
+ *  sector is left, the oldest sector is compacted: the values that are
+ *  still current are copied to the end of the log, and the sector is
+ *  erased. Compact() does this on request, e.g. while the UI is idle,
+ *  so that the next Set() doesn't have to.
+ *
+ *  Each record has a CRC. A record that was only partially written when
+ *  the power went off is ignored by Init(), the previous value of its key
+ *  is used instead. Values are copied before the sector holding them is
+ *  erased, so an interrupted compaction doesn't lose anything either.
+ *
+ *  @code
+ *  KeyValueStore store(hw.qspi);
+ *  store.Init(0x10000, 4); // 4 sectors at 64kB into the flash
+ *  float gain = 1.f;
+ *  store.Get(kGainKey, gain); // unchanged if not stored yet
+ *  store.Set(kGainKey, gain);
+ *  @endcode
+ */
+class KeyValueStore
+{
+  public:
+    /** Return values */
+    enum class Result
+    {
+        OK,
+        ERR_NOT_FOUND,   /**< the key isn't stored */
+        ERR_INVALID_KEY, /**< 0xffff is reserved */
+        ERR_SIZE,        /**< value larger than DSY_KVSTORE_MAX_VALUE_SIZE */
+        ERR_FULL, /**< too many keys, or not enough space for compaction */
+        ERR_QSPI, /**< erasing or writing the flash failed */
+    };
+
+    /** Size of the erasable sectors of the flash */
+    static constexpr uint32_t kSectorSize = 4096;
+
+    /** Constructor
+     *  \param qspi reference to the hardware qspi peripheral.
+     */
+    KeyValueStore(QSPIHandle& qspi) : qspi_(qspi), num_sectors_(0) {}
+
+    /** Reads the log, and prepares the sectors for writing.
+     *  Sectors that don't hold a valid log are erased.
+     *  \param address_offset start of the area on the QSPI chip, rounded
+     *                        down to a multiple of kSectorSize
+     *  \param num_sectors size of the area in sectors, at least 3.
+     *                     The stored values can take up num_sectors - 2
+     *                     sectors, Set() returns ERR_FULL beyond that.
+     */
+    Result Init(uint32_t address_offset, uint32_t num_sectors);
+
+    /** Stores a value. Nothing is written if the stored value is the same.
+     *  \param key any value but 0xffff
+     *  \param data the value, 1 to DSY_KVSTORE_MAX_VALUE_SIZE bytes
+     *  \param size size of data in bytes
+     */
+    Result Set(uint16_t key, const void* data, size_t size);
+
+    /** Copies a value. If it's shorter than size, the rest of data is
+     *  left untouched, if it's longer, it's truncated.
+     *  \param key the key
+     *  \param data destination
+     *  \param size size of data in bytes
+     *  \returns ERR_NOT_FOUND if the key isn't stored
+     */
+    Result Get(uint16_t key, void* data, size_t size) const;
+
+    /** Stores a value of trivially copyable type */
+    template <typename T>
+    Result Set(uint16_t key, const T& value)
+    {
+        return Set(key, &value, sizeof(T));
+    }
+
+    /** Copies a value of trivially copyable type */
+    template <typename T>
+    Result Get(uint16_t key, T& value) const
+    {
+        return Get(key, &value, sizeof(T));
+    }
+
+    /** Returns the size of a stored value, or 0 if the key isn't stored */
+    size_t GetSize(uint16_t key) const;
+
+    /** Removes a key
+     *  \returns ERR_NOT_FOUND if the key isn't stored
+     */
+    Result Remove(uint16_t key);
+
+    /** Reclaims the oldest sector, if it isn't the one being written.
+     *  Optional, the store compacts itself when it has to.
+     */
+    Result Compact();
+
+    /** Returns the number of stored keys */
+    size_t GetNumKeys() const { return num_keys_; }
+
+    /** Returns the number of bytes in the sectors that aren't erased */
+    uint32_t GetUsedBytes() const;
+
+    /** Returns the number of bytes the current values take up */
+    uint32_t GetLiveBytes() const;
+
+  private:
+    struct Entry
+    {
+        uint16_t key;
+        uint16_t size;
+        uint32_t address; // of the record
+    };
+
+    /** Finds the entry of a key, or returns nullptr */
+    const Entry* Find(uint16_t key) const;
+
+    /** Appends a record, opening a new sector if needed */
+    Result Append(uint16_t key, const void* data, uint16_t size);
+
+    /** Writes a record at the current position */
+    Result WriteRecord(uint16_t key, const void* data, uint16_t size);
+
+    /** Moves on to the next (erased) sector */
+    Result OpenNextSector();
+
+    /** Copies the current values out of the oldest sector, and erases it */
+    Result ReclaimOldest();
+
+    /** Updates the index for a record */
+    Result Index(uint16_t key, uint16_t size, uint32_t address);
+
+    /** Reads the records of a sector into the index
+     *  \returns the end of the valid records
+     */
+    uint32_t ScanSector(uint32_t sector);
+
+    /** Erases a sector */
+    Result EraseSector(uint32_t sector);
+
+    /** Returns a pointer to the memory mapped flash */
+    const uint8_t* Data(uint32_t address, size_t size) const;
+
+    uint32_t SectorAddress(uint32_t sector) const
+    {
+        return base_ + sector * kSectorSize;
+    }
+
+    QSPIHandle& qspi_;
+    uint32_t    base_;
+    uint32_t    num_sectors_;
+    uint32_t    active_;    // sector being appended to
+    uint32_t    num_used_;  // non-erased sectors, up to and including active_
+    uint32_t    write_pos_; // offset in active_
+    uint32_t    sequence_;  // of active_
+    Entry       entries_[DSY_KVSTORE_MAX_KEYS];
+    size_t      num_keys_;
+};
+
+} // namespace daisy
+
+#endif
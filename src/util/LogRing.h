@@ -0,0 +1,161 @@
+#pragma once
+#ifndef DSY_LOGRING_H
+#define DSY_LOGRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace daisy
+{
+/** @brief Lock-free byte ring for messages from any context
+ *  @addtogroup utility
+ *
+ *  Write() appends a whole message or drops it, and can be called from the
+ *  main loop and from interrupt handlers at once, without disabling
+ *  interrupts. Writers reserve their space with a compare-and-swap, and
+ *  the last writer to finish, which on a single core is the one that was
+ *  preempted by the others, makes all the reserved bytes readable. A
+ *  writer that is preempted while it copies holds up the messages after
+ *  it until it continues, they are never lost or torn.
+ *
+ *  There's one reader, which takes the bytes with Peek() and Consume().
+ *
+ *  @code
+ *  static LogRing<4096> ring;
+ *
+ *  ring.Write(message, length); // from anywhere
+ *
+ *  const uint8_t* data;
+ *  size_t         size = ring.Peek(&data);
+ *  ring.Consume(Send(data, size));
+ *  @endcode
+ *
+ *  \tparam capacity size in bytes, a power of two
+ */
+template <size_t capacity>
+class LogRing
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+  public:
+    LogRing() { Init(); }
+
+    /** Empties the ring and clears the counters. Not to be called while
+     *  interrupts may write.
+     */
+    void Init()
+    {
+        reserved_.store(0, std::memory_order_relaxed);
+        committed_.store(0, std::memory_order_relaxed);
+        writers_.store(0, std::memory_order_relaxed);
+        tail_ = 0;
+        ResetStats();
+    }
+
+    /** Appends a message, from any context.
+     *  \return false if it didn't fit, and was dropped
+     */
+    bool Write(const void* data, size_t size)
+    {
+        if(size == 0)
+            return true;
+        writers_.fetch_add(1, std::memory_order_acq_rel);
+        uint32_t pos = reserved_.load(std::memory_order_relaxed);
+        do
+        {
+            if(size > capacity - (pos - tail_))
+            {
+                dropped_bytes_.fetch_add(size, std::memory_order_relaxed);
+                dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+                Publish();
+                return false;
+            }
+        } while(!reserved_.compare_exchange_weak(
+            pos, pos + size, std::memory_order_relaxed));
+
+        const uint32_t start = pos & (capacity - 1);
+        const size_t   room  = capacity - start;
+        const size_t   first = size < room ? size : room;
+        const uint8_t* src   = static_cast<const uint8_t*>(data);
+        memcpy(&buffer_[start], src, first);
+        memcpy(buffer_, src + first, size - first);
+        Publish();
+        return true;
+    }
+
+    /** Returns the readable bytes that are contiguous in the ring, a
+     *  second Peek() after Consume() returns the ones after the wrap.
+     *  \param data set to the first byte
+     *  \return number of bytes
+     */
+    size_t Peek(const uint8_t** data) const
+    {
+        const uint32_t committed = committed_.load(std::memory_order_acquire);
+        const uint32_t start     = tail_ & (capacity - 1);
+        const uint32_t readable  = committed - tail_;
+        *data                    = &buffer_[start];
+        return readable < capacity - start ? readable : capacity - start;
+    }
+
+    /** Frees bytes returned by Peek() */
+    void Consume(size_t size) { tail_ = tail_ + size; }
+
+    /** Returns the number of bytes that can be read */
+    size_t GetReadable() const
+    {
+        return committed_.load(std::memory_order_acquire) - tail_;
+    }
+
+    /** Returns the bytes of the messages that were dropped */
+    uint32_t GetDroppedBytes() const
+    {
+        return dropped_bytes_.load(std::memory_order_relaxed);
+    }
+
+    /** Returns the number of messages that were dropped */
+    uint32_t GetDroppedMessages() const
+    {
+        return dropped_messages_.load(std::memory_order_relaxed);
+    }
+
+    /** Clears the dropped counters */
+    void ResetStats()
+    {
+        dropped_bytes_.store(0, std::memory_order_relaxed);
+        dropped_messages_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    /** Makes the reserved bytes readable, if this is the last writer */
+    void Publish()
+    {
+        if(writers_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        const uint32_t reserved  = reserved_.load(std::memory_order_acquire);
+        uint32_t       committed = committed_.load(std::memory_order_relaxed);
+        // a writer that preempted this one may have published more already
+        while(int32_t(reserved - committed) > 0
+              && !committed_.compare_exchange_weak(
+                  committed, reserved, std::memory_order_release))
+        {
+        }
+    }
+
+    uint8_t               buffer_[capacity];
+    std::atomic<uint32_t> reserved_;
+    std::atomic<uint32_t> committed_;
+    std::atomic<uint32_t> writers_;
+    volatile uint32_t     tail_;
+    std::atomic<uint32_t> dropped_bytes_;
+    std::atomic<uint32_t> dropped_messages_;
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+};
+
+} // namespace daisy
+
+#endif
@@ -1,4 +1,6 @@
 #include "MappedValue.h"
+#include "FastMath.h"
+#include "StringFormat.h"
 #include <cmath>
 #include <cstring>
 
@@ -33,7 +35,7 @@ void MappedFloatValue::Set(float newValue)
 
 void MappedFloatValue::AppentToString(FixedCapStrBase<char>& string) const
 {
-    string.AppendFloat(value_, numDecimals_, false, forceSign_);
+    AppendFormat(string, forceSign_ ? "%+.*f" : "%.*f", numDecimals_, value_);
     string.Append(unitStr_);
 }
 
@@ -57,6 +59,11 @@ float MappedFloatValue::GetAs0to1() const
             const float valueSq = (value_ - min_) / (max_ - min_);
             return std::max(0.0f, std::min(1.0f, sqrtf(valueSq)));
         }
+        case Mapping::fastLog:
+        {
+            const float a = 1.0f / fastlog2f(max_ / min_);
+            return std::max(0.0f, std::min(1.0f, a * fastlog2f(value_ / min_)));
+        }
         default: return 0.0f;
     }
 }
@@ -81,6 +88,9 @@ void MappedFloatValue::SetFrom0to1(float normalizedValue0to1)
             v                   = min_ + valueSq * (max_ - min_);
         }
         break;
+        case Mapping::fastLog:
+            v = min_ * fastpow2f(normalizedValue0to1 * fastlog2f(max_ / min_));
+            break;
         default: value_ = 0.0f; return;
     }
     value_ = std::max(min_, std::min(max_, v));
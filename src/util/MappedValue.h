@@ -51,7 +51,12 @@ class MappedFloatValue : public MappedValue
          */
         log,
         /** The value is mapped with a square law */
-        pow2
+        pow2,
+        /** Like `log`, with `fastlog2f()` and `fastpow2f()` instead of
+         *  `log10f()` and `powf()`. The results differ by less than 1e-5
+         *  (relative), which is far below a step of a knob or encoder.
+         */
+        fastLog
     };
 
     /** Creates a MappedFloatValue.
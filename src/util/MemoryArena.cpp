@@ -0,0 +1,60 @@
+#include "util/MemoryArena.h"
+
+namespace daisy
+{
+constexpr size_t MemoryArena::kDefaultAlignment;
+
+void MemoryArena::Init(void* buffer, size_t size, const char* name)
+{
+    name_            = name;
+    base_            = static_cast<uint8_t*>(buffer);
+    size_            = buffer != nullptr ? size : 0;
+    used_            = 0;
+    high_water_mark_ = 0;
+    num_regions_     = 0;
+}
+
+void* MemoryArena::Allocate(size_t size, size_t alignment)
+{
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return nullptr;
+    // align the address, the buffer itself may not be aligned
+    const uintptr_t addr    = reinterpret_cast<uintptr_t>(base_) + used_;
+    const size_t    padding = (alignment - (addr & (alignment - 1)))
+                           & (alignment - 1);
+    if(base_ == nullptr || padding > size_ - used_
+       || size > size_ - used_ - padding)
+        return nullptr;
+
+    void* ptr = base_ + used_ + padding;
+    used_ += padding + size;
+    if(used_ > high_water_mark_)
+        high_water_mark_ = used_;
+    return ptr;
+}
+
+bool MemoryArena::CreateRegion(MemoryArena& region,
+                               const char*  name,
+                               size_t       size,
+                               size_t       alignment)
+{
+    if(num_regions_ >= DSY_ARENA_MAX_REGIONS)
+        return false;
+    void* mem = Allocate(size, alignment);
+    if(mem == nullptr)
+        return false;
+    region.Init(mem, size, name);
+    regions_[num_regions_++] = &region;
+    return true;
+}
+
+void MemoryArena::Reset(const Checkpoint& checkpoint)
+{
+    if(checkpoint.used > used_)
+        return;
+    used_ = checkpoint.used;
+    if(checkpoint.num_regions < num_regions_)
+        num_regions_ = checkpoint.num_regions;
+}
+
+} // namespace daisy
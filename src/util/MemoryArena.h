@@ -0,0 +1,193 @@
+#pragma once
+#ifndef DSY_MEMORYARENA_H
+#define DSY_MEMORYARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+/** Number of named regions an arena can keep track of */
+#ifndef DSY_ARENA_MAX_REGIONS
+#define DSY_ARENA_MAX_REGIONS 8
+#endif
+
+namespace daisy
+{
+/** @brief Allocates memory from a fixed buffer, without the heap
+ *  @addtogroup utility
+ *
+ *  Allocations are taken from the start of the buffer in order, and can't
+ *  be freed on their own. Instead, a checkpoint is taken before a group of
+ *  allocations, e.g. the buffers of a patch, and resetting to it frees all
+ *  of them at once. So there's no fragmentation, and allocating is only a
+ *  bit of pointer arithmetic.
+ *
+ *  Parts of an arena can be handed out as named regions, arenas of their
+ *  own, e.g. one for delay lines and one for samples. PrintUsage() shows
+ *  how much of each is used, and the high water marks.
+ *
+ *  SdramHandle::GetArena() returns an arena over the SDRAM that isn't used
+ *  by DSY_SDRAM_BSS variables. Not interrupt safe, allocate from the main
+ *  loop, or during setup.
+ *
+ *  @code
+ *  MemoryArena& sdram = SdramHandle::GetArena();
+ *  MemoryArena  delays;
+ *  sdram.CreateRegion(delays, "delays", 4 * 1024 * 1024);
+ *  float* line = delays.Allocate<float>(48000);
+ *  auto   cp   = delays.GetCheckpoint();
+ *  // ... allocations of the current patch
+ *  delays.Reset(cp); // frees them again, line stays
+ *  @endcode
+ */
+class MemoryArena
+{
+  public:
+    /** Position of an arena, see GetCheckpoint() */
+    struct Checkpoint
+    {
+        size_t used;
+        size_t num_regions;
+    };
+
+    /** Alignment of allocations, unless another one is given */
+    static constexpr size_t kDefaultAlignment = 8;
+
+    constexpr MemoryArena()
+    : name_(nullptr),
+      base_(nullptr),
+      size_(0),
+      used_(0),
+      high_water_mark_(0),
+      regions_{},
+      num_regions_(0)
+    {
+    }
+
+    /** Initializes the arena over a buffer
+     *  \param buffer memory to allocate from, it's not cleared
+     *  \param size size of buffer in bytes
+     *  \param name shown by PrintUsage(), the string has to stay valid
+     */
+    void Init(void* buffer, size_t size, const char* name = nullptr);
+
+    /** Allocates memory. It's not cleared.
+     *  \param size size in bytes
+     *  \param alignment power of two, e.g. 32 for buffers used by the DMA,
+     *                   so they can be cache maintained by line
+     *  \returns nullptr if there's not enough space left
+     */
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+    /** Allocates an array of trivial types, it's not cleared
+     *  \returns nullptr if there's not enough space left
+     */
+    template <typename T>
+    T* Allocate(size_t count = 1)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /** Allocates and constructs an object. Its destructor isn't called by
+     *  Reset(), so it should only own memory from the arena.
+     *  \returns nullptr if there's not enough space left
+     */
+    template <typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        void* mem = Allocate(sizeof(T), alignof(T));
+        return mem != nullptr ? new(mem) T(std::forward<Args>(args)...)
+                              : nullptr;
+    }
+
+    /** Creates a named region, an arena over memory allocated from this one.
+     *  The region is freed by resetting this arena to a checkpoint from
+     *  before it, it mustn't be used after that.
+     *  \param region arena to initialize, it has to stay valid as long as
+     *                this arena reports it
+     *  \param name shown by PrintUsage(), the string has to stay valid
+     *  \param size size of the region in bytes
+     *  \param alignment alignment of the start of the region
+     *  \returns false if there's not enough space or regions left
+     */
+    bool CreateRegion(MemoryArena& region,
+                      const char*  name,
+                      size_t       size,
+                      size_t       alignment = 32);
+
+    /** Returns the current position, to free later allocations with Reset() */
+    Checkpoint GetCheckpoint() const { return {used_, num_regions_}; }
+
+    /** Frees everything allocated after a checkpoint was taken */
+    void Reset(const Checkpoint& checkpoint);
+
+    /** Frees everything */
+    void Reset() { Reset({0, 0}); }
+
+    /** Returns the size of the arena in bytes */
+    size_t GetSize() const { return size_; }
+
+    /** Returns the number of bytes allocated, including alignment padding */
+    size_t GetUsed() const { return used_; }
+
+    /** Returns the number of bytes left */
+    size_t GetFree() const { return size_ - used_; }
+
+    /** Returns the most bytes that were ever allocated at once */
+    size_t GetHighWaterMark() const { return high_water_mark_; }
+
+    /** Returns the name given to Init() or CreateRegion() */
+    const char* GetName() const { return name_ != nullptr ? name_ : ""; }
+
+    /** Returns the number of named regions */
+    size_t GetNumRegions() const { return num_regions_; }
+
+    /** Returns a named region */
+    const MemoryArena* GetRegion(size_t idx) const
+    {
+        return idx < num_regions_ ? regions_[idx] : nullptr;
+    }
+
+    /** Returns true if the pointer is inside this arena */
+    bool Contains(const void* ptr) const
+    {
+        auto p = static_cast<const uint8_t*>(ptr);
+        return p >= base_ && p < base_ + size_;
+    }
+
+    /** Prints the usage of the arena and its regions
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    void PrintUsage() const
+    {
+        PrintLine<LoggerType>(*this, "");
+        for(size_t i = 0; i < num_regions_; i++)
+            PrintLine<LoggerType>(*regions_[i], "  ");
+    }
+
+  private:
+    template <typename LoggerType>
+    static void PrintLine(const MemoryArena& arena, const char* indent)
+    {
+        LoggerType::PrintLine("%s%s: %lu of %lu bytes used, peak %lu",
+                              indent,
+                              arena.GetName(),
+                              (unsigned long)arena.GetUsed(),
+                              (unsigned long)arena.GetSize(),
+                              (unsigned long)arena.GetHighWaterMark());
+    }
+
+    const char*  name_;
+    uint8_t*     base_;
+    size_t       size_;
+    size_t       used_;
+    size_t       high_water_mark_;
+    MemoryArena* regions_[DSY_ARENA_MAX_REGIONS];
+    size_t       num_regions_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,182 @@
+#include "stm32h7xx_hal.h"
+#include "util/MemoryBenchmark.h"
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+namespace
+{
+/** Words of a cache line, the step of the latency chain */
+constexpr size_t kLineWords = 8;
+
+/** Keeps the compiler from dropping the reads */
+volatile uint32_t sink;
+
+uint32_t NextRandom(uint32_t& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+/** Calls a test with interrupts disabled, and returns the cycles it took */
+template <typename Test>
+uint32_t Measure(Test test)
+{
+    ScopedIrqBlocker irq_blocker;
+    const uint32_t   start = System::GetCycleCount();
+    test();
+    return System::GetCycleCount() - start;
+}
+
+float ToMbps(size_t bytes, uint32_t cycles)
+{
+    const float seconds = float(cycles) / System::GetCpuFreq();
+    return cycles > 0 ? bytes / seconds / 1e6f : 0.f;
+}
+
+void SequentialRead(const uint32_t* buf, size_t words, size_t passes)
+{
+    uint32_t sum = 0;
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        for(size_t i = 0; i < words; i += 8)
+        {
+            sum += buf[i] + buf[i + 1] + buf[i + 2] + buf[i + 3] + buf[i + 4]
+                   + buf[i + 5] + buf[i + 6] + buf[i + 7];
+        }
+    }
+    sink = sum;
+}
+
+void SequentialWrite(uint32_t* buf, size_t words, size_t passes)
+{
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        const uint32_t v = pass;
+        for(size_t i = 0; i < words; i += 8)
+        {
+            buf[i]     = v;
+            buf[i + 1] = v;
+            buf[i + 2] = v;
+            buf[i + 3] = v;
+            buf[i + 4] = v;
+            buf[i + 5] = v;
+            buf[i + 6] = v;
+            buf[i + 7] = v;
+        }
+    }
+}
+
+/** The addresses don't depend on the data, so the loads can overlap */
+void RandomRead(const uint32_t* buf, size_t words, size_t count)
+{
+    const size_t mask = words - 1;
+    uint32_t     seed = 0x12345678;
+    uint32_t     sum  = 0;
+    for(size_t i = 0; i < count; i++)
+        sum += buf[NextRandom(seed) & mask];
+    sink = sum;
+}
+
+void RandomWrite(uint32_t* buf, size_t words, size_t count)
+{
+    const size_t mask = words - 1;
+    uint32_t     seed = 0x9e3779b9;
+    for(size_t i = 0; i < count; i++)
+        buf[NextRandom(seed) & mask] = i;
+}
+
+/** Links the cache lines into one random cycle (Sattolo's algorithm),
+ *  the first word of each line holds the index of the next one.
+ */
+void BuildChain(uint32_t* buf, size_t lines)
+{
+    for(size_t i = 0; i < lines; i++)
+        buf[i * kLineWords] = i;
+    uint32_t seed = 0x2545f491;
+    for(size_t i = lines - 1; i > 0; i--)
+    {
+        const size_t   j    = NextRandom(seed) % i;
+        const uint32_t tmp  = buf[i * kLineWords];
+        buf[i * kLineWords] = buf[j * kLineWords];
+        buf[j * kLineWords] = tmp;
+    }
+}
+
+/** Every load needs the result of the one before */
+void FollowChain(const uint32_t* buf, size_t steps)
+{
+    uint32_t idx = 0;
+    for(size_t i = 0; i < steps; i++)
+        idx = buf[idx * kLineWords];
+    sink = idx;
+}
+} // namespace
+
+MemoryBenchmark::Results MemoryBenchmark::Run(const Config& cfg)
+{
+    Results r = {};
+    r.region  = System::GetMemoryRegion(uint32_t(uintptr_t(cfg.buffer)));
+    if(cfg.buffer == nullptr || cfg.size < 1024 || cfg.passes == 0
+       || (uintptr_t(cfg.buffer) & 31) != 0)
+        return r;
+
+    // a power of two, so random indices are a mask
+    size_t size = 1024;
+    while(size * 2 <= cfg.size)
+        size *= 2;
+    uint32_t* const buf    = static_cast<uint32_t*>(cfg.buffer);
+    const size_t    words  = size / sizeof(uint32_t);
+    const size_t    bytes  = size * cfg.passes;
+    const size_t    count  = words * cfg.passes;
+    const size_t    lines  = words / kLineWords;
+    const bool      cached = (SCB->CCR & SCB_CCR_DC_Msk) != 0;
+
+    // cleans the cache, nothing dirty is lost
+    if(cached && !cfg.dcache)
+        SCB_DisableDCache();
+
+    uint32_t cycles = Measure([&] { SequentialWrite(buf, words, cfg.passes); });
+    r.write_mbps    = ToMbps(bytes, cycles);
+
+    cycles      = Measure([&] { SequentialRead(buf, words, cfg.passes); });
+    r.read_mbps = ToMbps(bytes, cycles);
+
+    cycles            = Measure([&] { RandomWrite(buf, words, count); });
+    r.rand_write_mbps = ToMbps(count * sizeof(uint32_t), cycles);
+
+    cycles           = Measure([&] { RandomRead(buf, words, count); });
+    r.rand_read_mbps = ToMbps(count * sizeof(uint32_t), cycles);
+
+    BuildChain(buf, lines);
+    const size_t steps = lines * cfg.passes;
+    cycles             = Measure([&] { FollowChain(buf, steps); });
+
+    r.latency_ns = float(cycles) / steps * 1e9f / System::GetCpuFreq();
+
+    r.dcache = (SCB->CCR & SCB_CCR_DC_Msk) != 0;
+    r.size   = size;
+
+    // everything went to memory while it was off, so it can be invalidated
+    if(cached && !cfg.dcache)
+        SCB_EnableDCache();
+    return r;
+}
+
+const char* MemoryBenchmark::GetRegionName(System::MemoryRegion region)
+{
+    switch(region)
+    {
+        case System::INTERNAL_FLASH: return "FLASH";
+        case System::ITCMRAM: return "ITCM";
+        case System::DTCMRAM: return "DTCM";
+        case System::SRAM_D1: return "AXI SRAM";
+        case System::SRAM_D2: return "D2 SRAM";
+        case System::SRAM_D3: return "D3 SRAM";
+        case System::SDRAM: return "SDRAM";
+        case System::QSPI: return "QSPI";
+        default: return "invalid";
+    }
+}
+
+} // namespace daisy
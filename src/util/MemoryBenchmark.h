@@ -0,0 +1,121 @@
+#pragma once
+#ifndef DSY_MEMORYBENCHMARK_H
+#define DSY_MEMORYBENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sys/system.h"
+
+namespace daisy
+{
+/** @brief Measures the throughput and latency of a memory region
+ *  @addtogroup utility
+ *
+ *  Reads and writes a buffer sequentially and at random word addresses,
+ *  and follows a random chain of pointers through it, one per cache line,
+ *  for the latency of a load that depends on the previous one, e.g. an
+ *  interpolated delay line or table lookup. Timed with the DWT cycle
+ *  counter, with interrupts disabled.
+ *
+ *  Run it on a buffer in each System::MemoryRegion, with the data cache
+ *  on and off, to decide where delay lines and tables go, see the
+ *  Memory_Benchmark example. Buffers larger than the 16kB data cache show
+ *  the memory, smaller ones mostly the cache.
+ */
+class MemoryBenchmark
+{
+  public:
+    /** Settings of a run */
+    struct Config
+    {
+        /** memory to test, overwritten, 32 byte aligned. The size is
+         *  rounded down to a power of two, at least 1kB. */
+        void*  buffer = nullptr;
+        size_t size   = 0;
+
+        /** false turns off the data cache during the run */
+        bool dcache = true;
+
+        /** number of times the buffer is read and written */
+        size_t passes = 8;
+    };
+
+    /** Measured numbers. The throughputs are in 10^6 bytes per second. */
+    struct Results
+    {
+        System::MemoryRegion region;          /**< where the buffer is */
+        bool                 dcache;          /**< data cache was on */
+        size_t               size;            /**< bytes tested, 0 if bad */
+        float                read_mbps;       /**< sequential 32 bit reads */
+        float                write_mbps;      /**< sequential 32 bit writes */
+        float                rand_read_mbps;  /**< random 32 bit reads */
+        float                rand_write_mbps; /**< random 32 bit writes */
+        float                latency_ns;      /**< dependent reads, average */
+    };
+
+    /** Runs the benchmark, takes a few ms to a few 100ms, depending on
+     *  the memory. The contents of the buffer are lost.
+     */
+    static Results Run(const Config& cfg);
+
+    /** Returns a short name for a memory region */
+    static const char* GetRegionName(System::MemoryRegion region);
+
+    /** Prints the column titles of the table PrintRow() fills
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void PrintHeader()
+    {
+        LoggerType::PrintLine("%-8s %5s %6s %7s %7s %7s %7s %8s",
+                              "region",
+                              "cache",
+                              "kB",
+                              "read",
+                              "write",
+                              "rd rnd",
+                              "wr rnd",
+                              "latency");
+        LoggerType::PrintLine("%-8s %5s %6s %7s %7s %7s %7s %8s",
+                              "",
+                              "",
+                              "",
+                              "MB/s",
+                              "MB/s",
+                              "MB/s",
+                              "MB/s",
+                              "ns");
+    }
+
+    /** Prints the results as one line of the table
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void PrintRow(const Results& r)
+    {
+        if(r.size == 0)
+        {
+            LoggerType::PrintLine("%-8s failed, bad buffer",
+                                  GetRegionName(r.region));
+            return;
+        }
+        const unsigned long tenths = Round(r.latency_ns * 10);
+        LoggerType::PrintLine("%-8s %5s %6lu %7lu %7lu %7lu %7lu %6lu.%lu",
+                              GetRegionName(r.region),
+                              r.dcache ? "on" : "off",
+                              (unsigned long)(r.size / 1024),
+                              Round(r.read_mbps),
+                              Round(r.write_mbps),
+                              Round(r.rand_read_mbps),
+                              Round(r.rand_write_mbps),
+                              tenths / 10,
+                              tenths % 10);
+    }
+
+  private:
+    static unsigned long Round(float x) { return (unsigned long)(x + 0.5f); }
+};
+
+} // namespace daisy
+
+#endif
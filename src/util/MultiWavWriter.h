@@ -0,0 +1,500 @@
+#pragma once
+#ifndef DSY_MULTI_WAV_WRITER_H
+#define DSY_MULTI_WAV_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "ff.h"
+#include "daisy_core.h"
+#include "sys/system.h"
+#include "util/wav_format.h"
+
+namespace daisy
+{
+/** @brief Records several WAV files at once, e.g. the stems of a mix
+ *  @ingroup utility
+ *
+ *  Each stream is written to its own file, through its own ring of
+ *  blocks of block_size bytes in a buffer given to Init(), e.g. in SDRAM.
+ *  Sample() converts the frames to the format of the files right away,
+ *  so the blocks hold the bytes of the files as they are, the WAV header
+ *  included. Every write to the card is then one or more whole blocks, at
+ *  an offset in the file that is a multiple of block_size, which FatFs
+ *  sends to the card as multi-sector writes, without copying them through
+ *  its sector buffer. Write() takes the streams in rotation, so a stream
+ *  with a lot of queued blocks doesn't hold up the others for long.
+ *
+ *  A frame is only recorded if all streams have room for it, so the
+ *  files stay sample aligned when the card stalls. The frames dropped,
+ *  and the time each write took, are counted in GetStats().
+ *
+ *  For 8 streams of 24-bit at 48kHz, 1.1 MB/s, a buffer of 4 blocks of
+ *  32 kB per stream holds about 0.9 seconds of audio, for the card to
+ *  catch up after a stall.
+ *
+ *  @code
+ *  MultiWavWriter<8> DSY_SDRAM_BSS recorder;
+ *  uint8_t DSY_SDRAM_BSS record_buffer[8 * 4 * 32768];
+ *
+ *  MultiWavWriter<8>::Config config;
+ *  for(size_t i = 0; i < 8; i++)
+ *      config.channels[i] = 1;
+ *  config.buffer      = record_buffer;
+ *  config.buffer_size = sizeof(record_buffer);
+ *  recorder.Init(config);
+ *  recorder.Open({"0.wav", "1.wav", "2.wav", "3.wav",
+ *                 "4.wav", "5.wav", "6.wav", "7.wav"});
+ *  // in the audio callback, a frame of all channels of all streams
+ *  recorder.Sample(frame);
+ *  // in the main loop
+ *  recorder.Write();
+ *  @endcode
+ *
+ *  \tparam num_streams number of files recorded at once
+ *  \tparam block_size bytes per block, a multiple of the 512 byte sectors
+ */
+template <size_t num_streams, size_t block_size = 32768>
+class MultiWavWriter
+{
+  public:
+    static_assert(num_streams > 0, "needs at least one stream");
+    static_assert(block_size > 0 && block_size % 512 == 0,
+                  "block_size has to be a multiple of the sector size");
+
+    /** Most channels of all streams together, the size of a frame */
+    static constexpr size_t kMaxChannels = 64;
+
+    /** Return values for the functions that can fail */
+    enum class Result
+    {
+        OK,
+        ERROR,
+    };
+
+    /** Configuration of the recording */
+    struct Config
+    {
+        float samplerate = 48000.0f;
+        /** 16, 24 (packed) or 32 bit signed int, the same for all files */
+        int32_t bitspersample = 24;
+        /** channels of each stream, at least 1 */
+        size_t channels[num_streams] = {};
+        /** memory for the rings of all streams, e.g. in SDRAM, and word
+         *  aligned for the SD DMA. It's split evenly into the streams,
+         *  each of which needs at least 2 blocks.
+         */
+        void* buffer = nullptr;
+        /** size of buffer in bytes */
+        size_t buffer_size = 0;
+        /** length to allocate contiguously when opening, 0 to not
+         *  preallocate. Needs _USE_EXPAND in ffconf.h.
+         */
+        float prealloc_seconds = 0.0f;
+        /** most blocks of a stream in one write, before the next stream */
+        size_t max_write_blocks = 4;
+        /** writes taking longer than this are counted as stalls */
+        uint32_t stall_us = 20000;
+    };
+
+    /** Counters of the recording, since Open() */
+    struct Stats
+    {
+        uint32_t bytes_written;
+        uint32_t num_writes;
+        /** writes that failed, or wrote less than asked for */
+        uint32_t write_errors;
+        /** writes that took longer than Config::stall_us */
+        uint32_t num_stalls;
+        /** longest write in microseconds */
+        uint32_t max_write_us;
+        /** frames dropped, as a ring was full */
+        uint32_t dropped_frames;
+        /** runs of consecutive dropped frames */
+        uint32_t overflows;
+        /** most completed blocks of a stream that were waiting at once */
+        uint32_t max_queued_blocks;
+    };
+
+    MultiWavWriter() : recording_(false), initialized_(false) {}
+    ~MultiWavWriter() {}
+
+    /** Sets up the rings of the streams
+     *  \return ERROR if a stream has no channels, there are more than
+     *          kMaxChannels, the format isn't supported, or the buffer has
+     *          less than 2 blocks per stream
+     */
+    Result Init(const Config& cfg)
+    {
+        cfg_         = cfg;
+        recording_   = false;
+        initialized_ = false;
+
+        frame_channels_ = 0;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            if(cfg_.channels[s] == 0)
+                return Result::ERROR;
+            frame_channels_ += cfg_.channels[s];
+        }
+        if(frame_channels_ > kMaxChannels)
+            return Result::ERROR;
+        if(cfg_.bitspersample != 16 && cfg_.bitspersample != 24
+           && cfg_.bitspersample != 32)
+            return Result::ERROR;
+        bytes_per_samp_ = cfg_.bitspersample / 8;
+
+        num_blocks_ = cfg_.buffer == nullptr
+                          ? 0
+                          : cfg_.buffer_size / block_size / num_streams;
+        if(num_blocks_ < 2)
+            return Result::ERROR;
+        if(cfg_.max_write_blocks == 0)
+            cfg_.max_write_blocks = 1;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            streams_[s].ring = static_cast<uint8_t*>(cfg_.buffer)
+                               + s * num_blocks_ * block_size;
+            streams_[s].frame_bytes = cfg_.channels[s] * bytes_per_samp_;
+            ResetStream(streams_[s]);
+        }
+        initialized_ = true;
+        return Result::OK;
+    }
+
+    /** Creates the files, one per stream, and starts recording
+     *  \param names paths of the files, in the order of the streams
+     *  \return ERROR if a file can't be created, none are open then
+     */
+    Result Open(const char* const (&names)[num_streams])
+    {
+        if(!initialized_ || recording_)
+            return Result::ERROR;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            Stream& stream = streams_[s];
+            if(f_open(&stream.fp, names[s], FA_WRITE | FA_CREATE_ALWAYS)
+               != FR_OK)
+            {
+                while(s-- > 0)
+                    f_close(&streams_[s].fp);
+                return Result::ERROR;
+            }
+#if _USE_EXPAND
+            if(cfg_.prealloc_seconds > 0.0f)
+            {
+                // whole blocks, falls back to growing the file if there is
+                // no contiguous space of that size
+                const FSIZE_t bytes
+                    = sizeof(WAV_FormatTypeDef)
+                      + FSIZE_t(cfg_.prealloc_seconds * cfg_.samplerate)
+                            * stream.frame_bytes;
+                f_expand(&stream.fp,
+                         (bytes + block_size - 1) / block_size * block_size,
+                         1);
+            }
+#endif
+            // the header starts the first block, it's rewritten by Close()
+            ResetStream(stream);
+            WAV_FormatTypeDef header;
+            FillHeader(header, s, 0);
+            std::memcpy(stream.ring, &header, sizeof(header));
+            stream.fill_pos = sizeof(header);
+        }
+        num_frames_     = 0;
+        dropped_frames_ = 0;
+        overflows_      = 0;
+        overflowing_    = false;
+        next_stream_    = 0;
+        std::memset(&stats_, 0, sizeof(stats_));
+        std::atomic_signal_fence(std::memory_order_release);
+        recording_ = true;
+        return Result::OK;
+    }
+
+    /** Records a frame of all streams, from the audio callback. Frames
+     *  are ignored while not recording, and dropped while the ring of a
+     *  stream is full.
+     *  \param in the channels of stream 0, then those of stream 1, and so
+     *         on, Config::channels of each
+     */
+    void Sample(const float* in)
+    {
+        if(!recording_)
+            return;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            if(!HasRoom(streams_[s]))
+            {
+                if(!overflowing_)
+                    overflows_++;
+                overflowing_ = true;
+                dropped_frames_++;
+                return;
+            }
+        }
+        overflowing_ = false;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            Stream& stream = streams_[s];
+            for(size_t ch = 0; ch < cfg_.channels[s]; ch++)
+                PutSample(stream, *in++);
+        }
+        num_frames_++;
+    }
+
+    /** Writes the completed blocks of all streams to their files.
+     *  Meant to be called from the main loop.
+     */
+    void Write()
+    {
+        if(!recording_)
+            return;
+        bool wrote = true;
+        while(wrote)
+        {
+            wrote = false;
+            for(size_t i = 0; i < num_streams; i++)
+            {
+                const size_t s = (next_stream_ + i) % num_streams;
+                if(FlushBlocks(streams_[s]))
+                    wrote = true;
+            }
+            next_stream_ = (next_stream_ + 1) % num_streams;
+        }
+    }
+
+    /** Stops recording, writes what's left of each stream and its final
+     *  header, and closes the files
+     *  \return ERROR if a write failed during the recording, or here
+     */
+    Result Close()
+    {
+        if(!recording_)
+            return Result::ERROR;
+        recording_ = false;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+
+        bool ok = true;
+        for(size_t s = 0; s < num_streams; s++)
+        {
+            Stream& stream = streams_[s];
+            while(FlushBlocks(stream)) {}
+            WriteBytes(stream, stream.fill_block, stream.fill_pos);
+
+            // cut off the unused part of a preallocated file
+            WAV_FormatTypeDef header;
+            UINT              bw = 0;
+            FillHeader(header, s, num_frames_);
+            ok = f_truncate(&stream.fp) == FR_OK && ok;
+            ok = f_lseek(&stream.fp, 0) == FR_OK && ok;
+            ok = f_write(&stream.fp, &header, sizeof(header), &bw) == FR_OK
+                 && bw == sizeof(header) && ok;
+            ok = f_close(&stream.fp) == FR_OK && ok;
+        }
+        return ok && stats_.write_errors == 0 ? Result::OK : Result::ERROR;
+    }
+
+    /** Returns whether a recording is running */
+    inline bool IsRecording() const { return recording_; }
+
+    /** Returns the length of the recording in frames */
+    inline uint32_t GetLengthSamps() const { return num_frames_; }
+
+    /** Returns the length of the recording in seconds */
+    inline float GetLengthSeconds() const
+    {
+        return float(num_frames_) / cfg_.samplerate;
+    }
+
+    /** Returns the number of blocks the ring of each stream holds */
+    inline size_t GetBufferDepth() const { return num_blocks_; }
+
+    /** Returns the counters of the recording */
+    Stats GetStats() const
+    {
+        Stats stats             = stats_;
+        stats.dropped_frames    = dropped_frames_;
+        stats.overflows         = overflows_;
+        stats.max_queued_blocks = 0;
+        for(size_t s = 0; s < num_streams; s++)
+            if(streams_[s].max_queued > stats.max_queued_blocks)
+                stats.max_queued_blocks = streams_[s].max_queued;
+        return stats;
+    }
+
+  private:
+    struct Stream
+    {
+        FIL      fp;
+        uint8_t* ring;
+        uint8_t* fill_block; // block being filled by Sample()
+        size_t   fill_pos;   // bytes of fill_block filled
+        size_t   frame_bytes;
+
+        // free running block counts, filled is only written by Sample(),
+        // flushed only by Write()
+        volatile uint32_t filled, flushed;
+        volatile uint32_t max_queued;
+    };
+
+    void ResetStream(Stream& stream)
+    {
+        stream.fill_block = stream.ring;
+        stream.fill_pos   = 0;
+        stream.filled     = 0;
+        stream.flushed    = 0;
+        stream.max_queued = 0;
+    }
+
+    /** Returns true if the ring of a stream has room for a frame */
+    bool HasRoom(const Stream& stream) const
+    {
+        const uint32_t queued = stream.filled - stream.flushed;
+        if(queued >= num_blocks_)
+            return false;
+        // a frame that doesn't fit ends in the next block
+        return stream.fill_pos + stream.frame_bytes <= block_size
+               || queued + 1 < num_blocks_;
+    }
+
+    /** Converts a sample to the format of the file, and adds it to the
+     *  block being filled. A packed 24 bit sample can straddle two blocks.
+     */
+    void PutSample(Stream& stream, float x)
+    {
+        uint8_t bytes[4];
+        switch(cfg_.bitspersample)
+        {
+            case 16:
+            {
+                const int16_t s = f2s16(x);
+                std::memcpy(bytes, &s, sizeof(s));
+            }
+            break;
+            case 24:
+            {
+                const int32_t s = f2s24(x);
+                bytes[0]        = s;
+                bytes[1]        = s >> 8;
+                bytes[2]        = s >> 16;
+            }
+            break;
+            default:
+            {
+                const int32_t s = f2s32(x);
+                std::memcpy(bytes, &s, sizeof(s));
+            }
+            break;
+        }
+        if(stream.fill_pos + bytes_per_samp_ < block_size)
+        {
+            std::memcpy(
+                stream.fill_block + stream.fill_pos, bytes, bytes_per_samp_);
+            stream.fill_pos += bytes_per_samp_;
+            return;
+        }
+        for(size_t i = 0; i < bytes_per_samp_; i++)
+        {
+            stream.fill_block[stream.fill_pos++] = bytes[i];
+            if(stream.fill_pos == block_size)
+                PublishBlock(stream);
+        }
+    }
+
+    /** Hands the filled block to Write(), and starts the next one */
+    void PublishBlock(Stream& stream)
+    {
+        // publish the block after its samples
+        std::atomic_signal_fence(std::memory_order_release);
+        stream.filled     = stream.filled + 1;
+        stream.fill_pos   = 0;
+        stream.fill_block = stream.ring
+                            + (stream.filled % num_blocks_) * block_size;
+        const uint32_t queued = stream.filled - stream.flushed;
+        if(queued > stream.max_queued)
+            stream.max_queued = queued;
+    }
+
+    /** Writes the oldest completed blocks of a stream that are next to
+     *  each other in the ring, up to Config::max_write_blocks, and hands
+     *  them back to Sample()
+     *  \return false if there were none
+     */
+    bool FlushBlocks(Stream& stream)
+    {
+        const uint32_t flushed = stream.flushed;
+        const uint32_t queued  = stream.filled - flushed;
+        if(queued == 0)
+            return false;
+        // read the samples only after seeing the blocks
+        std::atomic_signal_fence(std::memory_order_acquire);
+        const size_t idx   = flushed % num_blocks_;
+        size_t       count = queued;
+        if(count > num_blocks_ - idx)
+            count = num_blocks_ - idx;
+        if(count > cfg_.max_write_blocks)
+            count = cfg_.max_write_blocks;
+        WriteBytes(stream, stream.ring + idx * block_size, count * block_size);
+        std::atomic_signal_fence(std::memory_order_release);
+        stream.flushed = flushed + count;
+        return true;
+    }
+
+    /** Writes to the file of a stream, and times the write */
+    void WriteBytes(Stream& stream, const uint8_t* data, size_t size)
+    {
+        if(size == 0)
+            return;
+        UINT           bw      = 0;
+        const uint32_t start   = System::GetUs();
+        const FRESULT  res     = f_write(&stream.fp, data, size, &bw);
+        const uint32_t elapsed = System::GetUs() - start;
+        stats_.num_writes++;
+        stats_.bytes_written += bw;
+        if(res != FR_OK || bw != size)
+            stats_.write_errors++;
+        if(elapsed > cfg_.stall_us)
+            stats_.num_stalls++;
+        if(elapsed > stats_.max_write_us)
+            stats_.max_write_us = elapsed;
+    }
+
+    /** Fills the header of a stream, for a number of recorded frames */
+    void FillHeader(WAV_FormatTypeDef& header, size_t s, uint32_t frames)
+    {
+        const uint32_t frame_bytes = streams_[s].frame_bytes;
+        header.ChunkId             = kWavFileChunkId;     /** "RIFF" */
+        header.FileFormat          = kWavFileWaveId;      /** "WAVE" */
+        header.SubChunk1ID         = kWavFileSubChunk1Id; /** "fmt " */
+        header.SubChunk1Size       = 16;                  // for PCM
+        header.AudioFormat         = WAVE_FORMAT_PCM;
+        header.NbrChannels         = cfg_.channels[s];
+        header.SampleRate          = uint32_t(cfg_.samplerate);
+        header.ByteRate            = header.SampleRate * frame_bytes;
+        header.BlockAlign          = frame_bytes;
+        header.BitPerSample        = cfg_.bitspersample;
+        header.SubChunk2ID         = kWavFileSubChunk2Id; /** "data" */
+        header.SubCHunk2Size       = frames * frame_bytes;
+        header.FileSize            = 36 + header.SubCHunk2Size;
+    }
+
+    Config   cfg_;
+    Stream   streams_[num_streams];
+    size_t   num_blocks_;     // blocks in the ring of each stream
+    size_t   frame_channels_; // channels of all streams
+    size_t   bytes_per_samp_;
+    size_t   next_stream_; // first stream of the next pass of Write()
+    uint32_t num_frames_;
+    Stats    stats_; // of Write(), the drops are counted by Sample()
+
+    volatile uint32_t dropped_frames_, overflows_;
+    bool              overflowing_;
+    volatile bool     recording_;
+    bool              initialized_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+#ifndef DSY_OBJECTPOOL_H
+#define DSY_OBJECTPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace daisy
+{
+/** @brief Fixed number of objects that are created and destroyed in any
+ *  order, without the heap
+ *  @addtogroup utility
+ *
+ *  Like BlockPool, for objects of one type with the storage sized at
+ *  compile time, e.g. for the voices of a synth or pending events.
+ *  Allocate() constructs an object in a free slot and Free() destroys it,
+ *  both in constant time: the free slots are a list of indices, kept
+ *  apart from the objects. GetIndex() numbers the objects, e.g. as voice
+ *  ids. To keep track of the objects in use, put them in an
+ *  IntrusiveList. Not interrupt safe.
+ *
+ *  @code
+ *  ObjectPool<Voice, 16> voices;
+ *  IntrusiveList<Voice>  playing;
+ *
+ *  Voice* v = voices.Allocate(note, velocity);
+ *  if(v != nullptr)
+ *      playing.PushBack(*v);
+ *  // ...
+ *  playing.Remove(*v);
+ *  voices.Free(v);
+ *  @endcode
+ *
+ *  \tparam T object type
+ *  \tparam capacity number of objects
+ */
+template <typename T, size_t capacity>
+class ObjectPool
+{
+    static_assert(capacity > 0 && capacity < UINT16_MAX,
+                  "capacity must be 1 to 65534");
+
+  public:
+    ObjectPool() : high_water_mark_(0) { Reset(); }
+
+    /** Destroys the objects that are still allocated */
+    ~ObjectPool() { Clear(); }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /** Constructs an object in a free slot
+     *  \param args arguments of the constructor of T
+     *  \returns nullptr if all objects are in use
+     */
+    template <typename... Args>
+    T* Allocate(Args&&... args)
+    {
+        if(free_head_ == kNone)
+            return nullptr;
+        const uint16_t index = free_head_;
+        free_head_           = next_free_[index];
+        next_free_[index]    = kUsed;
+        num_used_++;
+        if(num_used_ > high_water_mark_)
+            high_water_mark_ = num_used_;
+        return new(&slots_[index]) T(std::forward<Args>(args)...);
+    }
+
+    /** Destroys an object and returns its slot to the pool. nullptr, and
+     *  objects that aren't allocated from this pool, are ignored.
+     *  \returns false if the object was ignored
+     */
+    bool Free(T* object)
+    {
+        if(!Owns(object))
+            return false;
+        const uint16_t index = uint16_t(GetIndex(object));
+        if(next_free_[index] != kUsed)
+            return false;
+        object->~T();
+        next_free_[index] = free_head_;
+        free_head_        = index;
+        num_used_--;
+        return true;
+    }
+
+    /** Destroys all objects that are allocated, keeps the high water mark */
+    void Clear()
+    {
+        for(size_t i = 0; i < capacity; i++)
+        {
+            if(next_free_[i] == kUsed)
+                Get(i)->~T();
+        }
+        Reset();
+    }
+
+    /** Returns true if the pointer is an object slot of this pool */
+    bool Owns(const T* ptr) const
+    {
+        const Slot* slot = reinterpret_cast<const Slot*>(ptr);
+        return slot >= &slots_[0] && slot < &slots_[capacity];
+    }
+
+    /** Returns the index of an object of this pool, 0 to capacity - 1 */
+    size_t GetIndex(const T* object) const
+    {
+        return size_t(reinterpret_cast<const Slot*>(object) - &slots_[0]);
+    }
+
+    /** Returns the object at an index, or nullptr if it isn't allocated */
+    T* Get(size_t index)
+    {
+        if(index >= capacity || next_free_[index] != kUsed)
+            return nullptr;
+        return reinterpret_cast<T*>(&slots_[index]);
+    }
+
+    /** Returns the total number of objects */
+    static constexpr size_t GetCapacity() { return capacity; }
+
+    /** Returns the number of objects that can be allocated */
+    size_t GetNumFree() const { return capacity - num_used_; }
+
+    /** Returns the number of allocated objects */
+    size_t GetNumUsed() const { return num_used_; }
+
+    /** Returns the most objects that were ever allocated at once */
+    size_t GetHighWaterMark() const { return high_water_mark_; }
+
+  private:
+    /** Marks the end of the free list */
+    static constexpr uint16_t kNone = UINT16_MAX;
+    /** Marks a slot in use */
+    static constexpr uint16_t kUsed = UINT16_MAX - 1;
+
+    struct Slot
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    void Reset()
+    {
+        for(size_t i = 0; i < capacity; i++)
+            next_free_[i] = i + 1 < capacity ? uint16_t(i + 1) : kNone;
+        free_head_ = 0;
+        num_used_  = 0;
+    }
+
+    Slot     slots_[capacity];
+    uint16_t next_free_[capacity];
+    uint16_t free_head_;
+    size_t   num_used_;
+    size_t   high_water_mark_;
+};
+
+template <typename T, size_t capacity>
+constexpr uint16_t ObjectPool<T, capacity>::kNone;
+
+template <typename T, size_t capacity>
+constexpr uint16_t ObjectPool<T, capacity>::kUsed;
+
+} // namespace daisy
+
+#endif
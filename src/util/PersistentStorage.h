@@ -1,20 +1,36 @@
 #pragma once
 
+#include <cstring>
 #include "daisy_core.h"
 #include "per/qspi.h"
 #include "sys/dma.h"
+#include "sys/system.h"
+#include "util/Crc32.h"
 
 namespace daisy
 {
 /** @brief Non Volatile storage class for persistent settings on an external flash device.
  *  @author shensley
  * 
- *  Storage occupied by the struct will be one word larger than 
- *  the SettingStruct used. The extra word is used to store the
- *  state of the data, and whether it's been overwritten or not.
+ *  Storage occupied by the struct will be two words larger than
+ *  the SettingStruct used. The extra words are used to store the
+ *  state of the data, and whether it's been overwritten or not, and
+ *  a CRC of the data.
  * 
- *  \todo - Make Save() non-blocking
- *  \todo - Add wear leveling
+ *  The rest of the 4kB sector is divided into slots of that size. Each
+ *  save goes into the next erased slot, and the sector is only erased
+ *  when all of them are used. Init() loads the newest slot. The state
+ *  word of a slot is written after the settings, so a save that was
+ *  interrupted by a power loss leaves the previous slot as the newest.
+ * 
+ *  Each slot has a CRC of the settings, slots that don't match it aren't
+ *  loaded. Saves only write settings that changed, tested with the
+ *  operator!= of the SettingStruct against a copy of the newest slot, so
+ *  checking for changes doesn't read the flash. MarkDirty() and IsDirty()
+ *  track changes without computing anything.
+ * 
+ *  StartSave() saves without blocking, Process() has to be called from
+ *  the main loop until it's done.
  * 
  **/
 template <typename SettingStruct>
@@ -49,7 +65,13 @@ class PersistentStorage
       address_offset_(0),
       default_settings_(),
       settings_(),
-      state_(State::UNKNOWN)
+      state_(State::UNKNOWN),
+      num_slots_(1),
+      current_slot_(0),
+      next_slot_(0),
+      dirty_(false),
+      step_(Step::IDLE),
+      save_again_(false)
     {
     }
 
@@ -68,21 +90,47 @@ class PersistentStorage
         default_settings_ = defaults;
         settings_         = defaults;
         address_offset_   = address_offset & (uint32_t)(~0xff);
-        auto storage_data
-            = reinterpret_cast<SaveStruct *>(qspi_.GetData(address_offset_));
 
-        // check to see if the state is already in use.
-        State cur_state = storage_data->storage_state;
-        if(cur_state != State::FACTORY && cur_state != State::USER)
+        // the slots take up the rest of the sector
+        const uint32_t sector_end = (address_offset_ | (kSectorSize - 1)) + 1;
+        num_slots_ = (sector_end - address_offset_) / sizeof(SaveStruct);
+        if(num_slots_ == 0)
+            num_slots_ = 1;
+
+        // The newest slot is the last valid one. Writing continues after
+        // the last slot that isn't erased, which may be a save that was
+        // interrupted.
+        bool found    = false;
+        next_slot_    = 0;
+        current_slot_ = 0;
+        dirty_        = false;
+        for(uint32_t i = num_slots_; i-- > 0;)
+        {
+            const SaveStruct *slot = GetSlot(i);
+            if(next_slot_ == 0 && !IsErased(slot))
+                next_slot_ = i + 1;
+            if(IsValid(i, slot))
+            {
+                found         = true;
+                current_slot_ = i;
+                break;
+            }
+        }
+
+        if(!found)
         {
             // Initialize the Data store State::FACTORY, and the DefaultSettings
             state_ = State::FACTORY;
-            StoreSettingsIfChanged();
+            PrepareSave(true);
+            StoreBlocking();
         }
         else
         {
-            state_    = cur_state;
-            settings_ = storage_data->user_data;
+            // a copy of the bytes, so the CRC of settings_ matches
+            const SaveStruct *slot = GetSlot(current_slot_);
+            state_                 = slot->storage_state;
+            memcpy(&settings_, &slot->user_data, sizeof(SettingStruct));
+            memcpy(&pending_, slot, sizeof(SaveStruct));
         }
     }
 
@@ -92,19 +140,77 @@ class PersistentStorage
     /** Returns a reference to the setting struct */
     SettingStruct &GetSettings() { return settings_; }
 
-    /** Performs the save operation, storing the storage */
+    /** Marks the settings as changed, until the next save.
+     *  The next save writes them even if they compare equal to the saved
+     *  ones.
+     */
+    void MarkDirty() { dirty_ = true; }
+
+    /** Returns true if MarkDirty() was called since the last save.
+     *  A quick check, e.g. for showing that there are unsaved changes.
+     *  Changes made without MarkDirty() are still found by operator!= when
+     *  saving.
+     */
+    bool IsDirty() const { return dirty_; }
+
+    /** Performs the save operation, storing the storage.
+     *  Blocks until the settings are written, and waits for a StartSave()
+     *  in progress to finish.
+     */
     void Save()
     {
+        Finish();
+        state_ = State::USER;
+        if(PrepareSave(false))
+            StoreBlocking();
+    }
+
+    /** Starts saving the settings, without blocking.
+     *  The settings are copied, they can be changed while the save is in
+     *  progress. If a save is in progress already, another one follows it.
+     *  \return true if anything needs to be written
+     */
+    bool StartSave()
+    {
+        if(step_ != Step::IDLE)
+        {
+            save_again_ = true;
+            return true;
+        }
         state_ = State::USER;
-        StoreSettingsIfChanged();
+        if(!PrepareSave(false))
+            return false;
+        step_ = pending_erase_ ? Step::ERASE : Step::WRITE_DATA;
+        StartStep();
+        return true;
+    }
+
+    /** Continues a save started by StartSave().
+     *  Call this from the main loop. While it returns true, the QSPI memory
+     *  can't be read, and no other QSPI functions should be used.
+     *  \param max_us time to spend on the save in this call, see
+     *                QSPIHandle::Process()
+     *  \return true while the save is in progress
+     */
+    bool Process(uint32_t max_us = 0)
+    {
+        if(step_ == Step::IDLE)
+            return false;
+        qspi_.Process(max_us);
+        return step_ != Step::IDLE;
     }
 
+    /** Returns true while a save started by StartSave() is in progress */
+    bool IsSaving() const { return step_ != Step::IDLE; }
+
     /** Restores the settings stored in the QSPI */
     void RestoreDefaults()
     {
+        Finish();
         settings_ = default_settings_;
         state_    = State::FACTORY;
-        StoreSettingsIfChanged();
+        if(PrepareSave(false))
+            StoreBlocking();
     }
 
   private:
@@ -112,15 +218,32 @@ class PersistentStorage
     {
         State         storage_state;
         SettingStruct user_data;
+        uint32_t      crc; // of user_data
     };
 
-    void StoreSettingsIfChanged()
+    enum class Step
     {
-        SaveStruct s;
-        s.storage_state = state_;
-        s.user_data     = settings_;
+        IDLE,
+        ERASE,
+        WRITE_DATA,
+        WRITE_STATE,
+    };
+
+    static constexpr uint32_t kSectorSize = 4096;
 
-        void *data_ptr = qspi_.GetData(address_offset_);
+    /** Offset of the settings in a slot, the state comes before them */
+    static constexpr uint32_t kDataOffset
+        = (sizeof(State) + alignof(SettingStruct) - 1) / alignof(SettingStruct)
+          * alignof(SettingStruct);
+
+    uint32_t SlotAddress(uint32_t slot) const
+    {
+        return address_offset_ + slot * sizeof(SaveStruct);
+    }
+
+    const SaveStruct *GetSlot(uint32_t slot)
+    {
+        void *data_ptr = qspi_.GetData(SlotAddress(slot));
 
 #if !UNIT_TEST
         // Caching behavior is different when running programs outside internal flash
@@ -129,18 +252,130 @@ class PersistentStorage
         if(System::GetProgramMemoryRegion()
            != System::MemoryRegion::INTERNAL_FLASH)
         {
-            dsy_dma_invalidate_cache_for_buffer((uint8_t *)data_ptr, sizeof(s));
+            dsy_dma_invalidate_cache_for_buffer((uint8_t *)data_ptr,
+                                                sizeof(SaveStruct));
         }
 #endif
+        return reinterpret_cast<const SaveStruct *>(data_ptr);
+    }
+
+    /** Slots without a CRC are from before it was added. They were only
+     *  ever written to the first slot, and the erased flash behind them
+     *  reads as a CRC of 0xffffffff.
+     */
+    static bool IsValid(uint32_t index, const SaveStruct *slot)
+    {
+        if(slot->storage_state != State::FACTORY
+           && slot->storage_state != State::USER)
+            return false;
+        if(index == 0 && slot->crc == 0xffffffff)
+            return true;
+        return slot->crc == Crc32(&slot->user_data, sizeof(SettingStruct));
+    }
+
+    static bool IsErased(const SaveStruct *slot)
+    {
+        auto bytes = reinterpret_cast<const uint8_t *>(slot);
+        for(size_t i = 0; i < sizeof(SaveStruct); i++)
+            if(bytes[i] != 0xff)
+                return false;
+        return true;
+    }
 
-        // Only actually save if the new data is different
-        // Use the `==operator` in custom SettingStruct to fine tune
-        // what may or may not trigger the erase/save.
-        auto storage_data = reinterpret_cast<SaveStruct *>(data_ptr);
-        if(settings_ != storage_data->user_data)
+    /** Copies the settings, and picks the slot to write them to.
+     *  \param force write even if the newest slot has the same settings
+     *  \return false if there's nothing to write
+     */
+    bool PrepareSave(bool force)
+    {
+        // Only actually save if the new data is different. Use the
+        // `!=operator` in custom SettingStruct to fine tune what counts as a
+        // change, it's compared to the copy of the newest slot instead of
+        // reading it.
+        if(!force && !dirty_ && !(settings_ != pending_.user_data))
+            return false;
+
+        pending_.storage_state = state_;
+        memcpy(&pending_.user_data, &settings_, sizeof(SettingStruct));
+        pending_.crc   = Crc32(&pending_.user_data, sizeof(SettingStruct));
+        dirty_         = false;
+        pending_erase_ = next_slot_ >= num_slots_;
+        current_slot_  = pending_erase_ ? 0 : next_slot_;
+        next_slot_     = current_slot_ + 1;
+        return true;
+    }
+
+    /** Writes the prepared slot */
+    void StoreBlocking()
+    {
+        const uint32_t address = SlotAddress(current_slot_);
+        uint8_t       *bytes   = reinterpret_cast<uint8_t *>(&pending_);
+        if(pending_erase_)
+            qspi_.Erase(address, SlotAddress(num_slots_));
+        // the state last, it marks the slot as complete
+        qspi_.Write(address + kDataOffset,
+                    sizeof(SaveStruct) - kDataOffset,
+                    bytes + kDataOffset);
+        qspi_.Write(address, kDataOffset, bytes);
+    }
+
+    /** Waits for a save in progress */
+    void Finish()
+    {
+        save_again_ = false;
+        while(Process(1000)) {}
+    }
+
+    void StartStep()
+    {
+        const uint32_t address = SlotAddress(current_slot_);
+        uint8_t       *bytes   = reinterpret_cast<uint8_t *>(&pending_);
+        QSPIHandle::Result res = QSPIHandle::Result::ERR;
+        switch(step_)
+        {
+            case Step::ERASE:
+                res = qspi_.StartErase(
+                    address, SlotAddress(num_slots_), OnStepDone, this);
+                break;
+            case Step::WRITE_DATA:
+                res = qspi_.StartWrite(address + kDataOffset,
+                                       sizeof(SaveStruct) - kDataOffset,
+                                       bytes + kDataOffset,
+                                       OnStepDone,
+                                       this);
+                break;
+            case Step::WRITE_STATE:
+                res = qspi_.StartWrite(
+                    address, kDataOffset, bytes, OnStepDone, this);
+                break;
+            default: break;
+        }
+        if(res != QSPIHandle::Result::OK)
+            step_ = Step::IDLE;
+    }
+
+    static void OnStepDone(void *context, QSPIHandle::Result result)
+    {
+        auto self = static_cast<PersistentStorage *>(context);
+        if(result != QSPIHandle::Result::OK)
+        {
+            // start over in a fresh sector with the next save
+            self->next_slot_ = self->num_slots_;
+            self->step_      = Step::IDLE;
+            return;
+        }
+        switch(self->step_)
+        {
+            case Step::ERASE: self->step_ = Step::WRITE_DATA; break;
+            case Step::WRITE_DATA: self->step_ = Step::WRITE_STATE; break;
+            default: self->step_ = Step::IDLE; break;
+        }
+        if(self->step_ != Step::IDLE)
+            self->StartStep();
+        else if(self->save_again_)
         {
-            qspi_.Erase(address_offset_, address_offset_ + sizeof(s));
-            qspi_.Write(address_offset_, sizeof(s), (uint8_t *)&s);
+            self->save_again_ = false;
+            self->StartSave();
         }
     }
 
@@ -149,6 +384,14 @@ class PersistentStorage
     SettingStruct default_settings_;
     SettingStruct settings_;
     State         state_;
+    uint32_t      num_slots_;
+    uint32_t      current_slot_; // newest slot
+    uint32_t      next_slot_;    // first slot that's erased
+    SaveStruct    pending_;      // newest slot, or being written
+    bool          dirty_;
+    bool          pending_erase_;
+    Step          step_;
+    bool          save_again_;
 };
 
 } // namespace daisy
\ No newline at end of file
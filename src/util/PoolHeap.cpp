@@ -0,0 +1,152 @@
+#include "util/PoolHeap.h"
+#include <cstring>
+
+namespace daisy
+{
+bool PoolHeap::Init(void* buffer, size_t size, const Config& config)
+{
+    num_classes_ = 0;
+    locked_      = false;
+    ResetStats();
+    const size_t min = config.min_block_size;
+    if(buffer == nullptr || config.num_classes < 1
+       || config.num_classes > kMaxClasses || min < kAlignment
+       || (min & (min - 1)) != 0)
+        return false;
+
+    log2_min_ = 0;
+    while((size_t(1) << log2_min_) < min)
+        log2_min_++;
+
+    const uintptr_t addr    = reinterpret_cast<uintptr_t>(buffer);
+    const size_t    padding = (kAlignment - (addr & (kAlignment - 1)))
+                           & (kAlignment - 1);
+    if(size < padding)
+        return false;
+    uint8_t* mem  = static_cast<uint8_t*>(buffer) + padding;
+    size_t   left = size - padding;
+
+    // the classes with a number of blocks first, the rest is shared
+    size_t num_shared = 0;
+    for(size_t i = 0; i < config.num_classes; i++)
+    {
+        const size_t bytes = config.num_blocks[i] * (min << i);
+        if(config.num_blocks[i] == 0)
+            num_shared++;
+        else if(bytes > left)
+            return false;
+        else
+            left -= bytes;
+    }
+    const size_t share = num_shared > 0 ? left / num_shared : 0;
+
+    for(size_t i = 0; i < config.num_classes; i++)
+    {
+        const size_t block_size = min << i;
+        const size_t bytes
+            = config.num_blocks[i] > 0 ? config.num_blocks[i] * block_size
+                                       : share / block_size * block_size;
+        if(!pools_[i].Init(mem, bytes, block_size, kAlignment))
+            return false;
+        mem += bytes;
+    }
+    num_classes_ = config.num_classes;
+    return true;
+}
+
+void* PoolHeap::Allocate(size_t size)
+{
+    if(locked_)
+        stats_.num_after_lock++;
+    for(size_t i = ClassForSize(size); i < num_classes_; i++)
+    {
+        void* const block = pools_[i].Allocate();
+        if(block != nullptr)
+        {
+            stats_.num_allocations++;
+            stats_.bytes_used += pools_[i].GetBlockSize();
+            if(stats_.bytes_used > stats_.high_water_mark)
+                stats_.high_water_mark = stats_.bytes_used;
+            return block;
+        }
+    }
+    stats_.num_failed++;
+    return nullptr;
+}
+
+void PoolHeap::Free(void* ptr)
+{
+    const size_t idx = FindClass(ptr);
+    if(idx >= num_classes_)
+        return;
+    pools_[idx].Free(ptr);
+    stats_.bytes_used -= pools_[idx].GetBlockSize();
+}
+
+void* PoolHeap::Reallocate(void* ptr, size_t size)
+{
+    if(ptr == nullptr)
+        return Allocate(size);
+    const size_t old_size = GetBlockSize(ptr);
+    if(old_size == 0)
+        return nullptr;
+    if(size <= old_size)
+        return ptr;
+    void* const block = Allocate(size);
+    if(block == nullptr)
+        return nullptr;
+    std::memcpy(block, ptr, old_size);
+    Free(ptr);
+    return block;
+}
+
+size_t PoolHeap::GetBlockSize(const void* ptr) const
+{
+    const size_t idx = FindClass(ptr);
+    return idx < num_classes_ ? pools_[idx].GetBlockSize() : 0;
+}
+
+size_t PoolHeap::GetMaxSize() const
+{
+    return num_classes_ > 0 ? pools_[num_classes_ - 1].GetBlockSize() : 0;
+}
+
+PoolHeap::ClassStats PoolHeap::GetClassStats(size_t idx) const
+{
+    if(idx >= num_classes_)
+        return {0, 0, 0, 0};
+    const BlockPool& pool = pools_[idx];
+    return {pool.GetBlockSize(),
+            pool.GetNumBlocks(),
+            pool.GetNumUsed(),
+            pool.GetHighWaterMark()};
+}
+
+size_t PoolHeap::ClassForSize(size_t size) const
+{
+    if(num_classes_ == 0 || size > GetMaxSize())
+        return num_classes_;
+    if(size <= (size_t(1) << log2_min_))
+        return 0;
+    // the bits of size - 1 are the log2 of the power of two it fits in
+    const unsigned long rest = static_cast<unsigned long>(size - 1);
+    const size_t        bits = sizeof(unsigned long) * 8 - __builtin_clzl(rest);
+    return bits - log2_min_;
+}
+
+size_t PoolHeap::FindClass(const void* ptr) const
+{
+    if(ptr == nullptr)
+        return num_classes_;
+    size_t idx = 0;
+    while(idx < num_classes_ && !pools_[idx].Owns(ptr))
+        idx++;
+    return idx;
+}
+
+void PoolHeap::ResetStats()
+{
+    stats_ = {0, 0, 0, 0, 0};
+}
+
+} // namespace daisy
@@ -0,0 +1,152 @@
+#pragma once
+#ifndef DSY_POOLHEAP_H
+#define DSY_POOLHEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/BlockPool.h"
+
+namespace daisy
+{
+/** @brief A heap of fixed size blocks in power of two size classes
+ *  @addtogroup utility
+ *
+ *  Each size class is a BlockPool with its own part of the buffer. An
+ *  allocation takes a block of the smallest class it fits in, or of the
+ *  next larger one if that class is used up, so allocating and freeing
+ *  take a time that only depends on the number of classes, and freeing
+ *  never leaves a hole that can't be used again. The price is the unused
+ *  end of each block, and that the share of each class is fixed at Init().
+ *
+ *  After Lock(), e.g. at the end of the setup, allocations still succeed
+ *  but are counted, so code that allocates in the main loop or the audio
+ *  callback shows up in GetStats(). The SystemHeap uses this for malloc()
+ *  and new, and traps them.
+ *
+ *  Not interrupt safe.
+ *
+ *  @code
+ *  PoolHeap::Config config;  // 16 bytes to 2kB
+ *  config.num_blocks[0] = 64; // 64 x 16 bytes, the others share the rest
+ *  heap.Init(buffer, sizeof(buffer), config);
+ *  void* p = heap.Allocate(100); // a 128 byte block
+ *  heap.Free(p);
+ *  @endcode
+ */
+class PoolHeap
+{
+  public:
+    /** The most size classes of a heap */
+    static constexpr size_t kMaxClasses = 12;
+
+    /** Alignment of all blocks */
+    static constexpr size_t kAlignment = MemoryArena::kDefaultAlignment;
+
+    struct Config
+    {
+        /** Size of the blocks of the smallest class, a power of two of at
+         *  least kAlignment. Each class has blocks twice the size of the
+         *  one before.
+         */
+        size_t min_block_size = 16;
+
+        /** Number of classes, up to kMaxClasses */
+        size_t num_classes = 8;
+
+        /** Blocks of each class, 0 for an equal share, in bytes, of the
+         *  buffer that's left after the classes with a number
+         */
+        size_t num_blocks[kMaxClasses] = {};
+    };
+
+    /** Usage of one size class */
+    struct ClassStats
+    {
+        size_t block_size;
+        size_t num_blocks;
+        size_t num_used;
+        size_t high_water_mark;
+    };
+
+    /** Usage of the whole heap */
+    struct Stats
+    {
+        size_t   bytes_used;      /**< of the blocks, not as requested */
+        size_t   high_water_mark; /**< most bytes_used so far */
+        uint32_t num_allocations; /**< all that succeeded */
+        uint32_t num_failed;      /**< too large, or no block left */
+        uint32_t num_after_lock;  /**< allocations after Lock() */
+    };
+
+    PoolHeap() : log2_min_(0), num_classes_(0), locked_(false)
+    {
+        ResetStats();
+    }
+    ~PoolHeap() {}
+
+    /** Divides a buffer into the size classes
+     *  \return false if the config is invalid, or a class gets no block
+     */
+    bool Init(void* buffer, size_t size, const Config& config);
+
+    /** Allocates a block of at least size bytes, it's not cleared. A size
+     *  of 0 gets a block of the smallest class, like with malloc().
+     *  \return nullptr if size is larger than the largest class, or if no
+     *          block of its class or a larger one is left
+     */
+    void* Allocate(size_t size);
+
+    /** Returns a block to its class, nullptr and pointers that aren't from
+     *  this heap are ignored
+     */
+    void Free(void* ptr);
+
+    /** Resizes an allocation. It stays in place if the new size fits in its
+     *  block, otherwise it's moved to a new one.
+     *  \return nullptr, and ptr stays allocated, if there's no block left
+     */
+    void* Reallocate(void* ptr, size_t size);
+
+    /** Returns true if the pointer is a block of this heap */
+    bool Owns(const void* ptr) const { return FindClass(ptr) < num_classes_; }
+
+    /** Returns the usable size of an allocation, 0 if it's not from here */
+    size_t GetBlockSize(const void* ptr) const;
+
+    /** Returns the size of the blocks of the largest class */
+    size_t GetMaxSize() const;
+
+    /** Counts all allocations from now on in Stats::num_after_lock */
+    void Lock() { locked_ = true; }
+
+    /** Stops counting allocations after Lock(), the count stays */
+    void Unlock() { locked_ = false; }
+
+    /** Returns true after Lock() */
+    bool IsLocked() const { return locked_; }
+
+    size_t GetNumClasses() const { return num_classes_; }
+
+    ClassStats GetClassStats(size_t idx) const;
+
+    const Stats& GetStats() const { return stats_; }
+
+  private:
+    /** Returns the smallest class the size fits in, or num_classes_ */
+    size_t ClassForSize(size_t size) const;
+
+    /** Returns the class a block is from, or num_classes_ */
+    size_t FindClass(const void* ptr) const;
+
+    void ResetStats();
+
+    BlockPool pools_[kMaxClasses];
+    size_t    log2_min_;
+    size_t    num_classes_;
+    bool      locked_;
+    Stats     stats_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,377 @@
+#pragma once
+#ifndef DSY_PRESETBANK_H
+#define DSY_PRESETBANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief A bank of presets in one binary image, recalled in constant time
+ *  @addtogroup utility
+ *
+ *  The image is used where it is, without parsing: in the memory mapped
+ *  QSPI flash, from QSPIHandle::GetData(), or in SDRAM, read there from a
+ *  file on the SD card in one f_read(). It's laid out as:
+ *  - a 32 byte Header
+ *  - an index of one 32 byte Entry per preset, with its name, the number
+ *    of bytes used of its record and their CRC
+ *  - the records, all of the same size, a multiple of 32 bytes, so that
+ *    each starts on a cache line
+ *
+ *  A preset is recalled by its number, from the address of its record.
+ *  The records hold the application's settings struct as it is in memory,
+ *  and Header::data_version tells which layout of the struct the bank was
+ *  saved with. All values are little endian. Init() checks the header and
+ *  a CRC of the index, VerifyRecord() the CRC of a record.
+ *
+ *  Create() lays out an empty bank in RAM, and Store() saves presets in
+ *  it, or in a bank opened with InitWritable(). The image is then written
+ *  as it is, e.g. to a file, or to the flash with QSPIHandle::Write().
+ *
+ *  @code
+ *  struct Settings { float cutoff, resonance; uint8_t wave; };
+ *  PresetBank bank;
+ *  if(bank.Init(hw.qspi.GetData(bank_offset), bank_max_size)
+ *     == PresetBank::Result::OK)
+ *  {
+ *      Settings settings;
+ *      if(bank.Load(preset_number, settings))
+ *          ApplySettings(settings);
+ *  }
+ *  @endcode
+ */
+class PresetBank
+{
+  public:
+    enum class Result
+    {
+        OK,            /**< & */
+        ERR_MAGIC,     /**< not a preset bank, e.g. an erased flash */
+        ERR_VERSION,   /**< made for another version of the format */
+        ERR_SIZE,      /**< larger than the memory, or a bad record size */
+        ERR_CRC,       /**< the index is damaged */
+        ERR_ENTRY,     /**< an entry uses more than its record */
+        ERR_INDEX,     /**< there is no preset with that number */
+        ERR_READ_ONLY, /**< the bank was opened with Init() */
+    };
+
+    /** "DSYP" */
+    static constexpr uint32_t kMagic = 0x50595344;
+    /** Version of the format that's read */
+    static constexpr uint16_t kVersion = 1;
+    /** Alignment of the records, and the multiple of their size */
+    static constexpr uint32_t kAlignment = 32;
+    /** Longest name, without the terminating 0 */
+    static constexpr size_t kMaxNameLength = 23;
+    /** The most presets in a bank */
+    static constexpr size_t kMaxPresets = 0xffff;
+    /** Returned by Find() for a name that isn't in the bank */
+    static constexpr int kNotFound = -1;
+
+    /** Start of the image */
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t num_presets;
+        uint32_t record_size; /**< in bytes, a multiple of kAlignment */
+        uint32_t image_size;  /**< all of the image, in bytes */
+        uint32_t index_crc;   /**< Crc32() of the entries */
+        /** The application's version of the layout of the records */
+        uint16_t data_version;
+        uint16_t reserved0;
+        uint32_t reserved[2];
+    };
+
+    /** Index entry of a preset */
+    struct Entry
+    {
+        /** 0 terminated, padded with 0s */
+        char     name[kMaxNameLength + 1];
+        uint32_t size; /**< bytes used of the record, 0 for an empty slot */
+        uint32_t crc;  /**< Crc32() of those bytes */
+    };
+
+    static_assert(sizeof(Header) == 32, "the header is 32 bytes");
+    static_assert(sizeof(Entry) == 32, "an entry is 32 bytes");
+
+    PresetBank()
+    : image_(nullptr), writable_(nullptr), header_(nullptr), entries_(nullptr)
+    {
+    }
+
+    /** Returns the size of the image of a bank
+     *  \param record_size rounded up to a multiple of kAlignment
+     */
+    static constexpr size_t ImageSize(size_t num_presets, size_t record_size)
+    {
+        return sizeof(Header) + num_presets * sizeof(Entry)
+               + num_presets * RoundUp(record_size);
+    }
+
+    /** Checks the image, and reads it from then on
+     *  \param image start of the image, e.g. from QSPIHandle::GetData()
+     *  \param max_size size of the memory the image is in
+     *  \returns Result::OK, or why the image can't be used, then the bank
+     *           has no presets
+     */
+    Result Init(const void* image, size_t max_size)
+    {
+        image_    = nullptr;
+        writable_ = nullptr;
+        header_   = nullptr;
+        entries_  = nullptr;
+        if(image == nullptr || max_size < sizeof(Header))
+            return Result::ERR_SIZE;
+
+        const uint8_t* bytes  = static_cast<const uint8_t*>(image);
+        const Header*  header = reinterpret_cast<const Header*>(image);
+        if(header->magic != kMagic)
+            return Result::ERR_MAGIC;
+        if(header->version != kVersion)
+            return Result::ERR_VERSION;
+        if(header->record_size == 0 || header->record_size % kAlignment != 0
+           || header->image_size > max_size
+           || (header->num_presets != 0
+               && header->record_size > max_size / header->num_presets)
+           || header->image_size
+                  != ImageSize(header->num_presets, header->record_size))
+            return Result::ERR_SIZE;
+
+        const Entry* entries
+            = reinterpret_cast<const Entry*>(bytes + sizeof(Header));
+        if(Crc32(entries, header->num_presets * sizeof(Entry))
+           != header->index_crc)
+            return Result::ERR_CRC;
+        for(size_t i = 0; i < header->num_presets; i++)
+        {
+            if(entries[i].name[kMaxNameLength] != '\0'
+               || entries[i].size > header->record_size)
+                return Result::ERR_ENTRY;
+        }
+
+        image_   = bytes;
+        header_  = header;
+        entries_ = entries;
+        return Result::OK;
+    }
+
+    /** Like Init(), for an image in RAM that Store() may change */
+    Result InitWritable(void* image, size_t max_size)
+    {
+        const Result result = Init(image, max_size);
+        if(result == Result::OK)
+            writable_ = static_cast<uint8_t*>(image);
+        return result;
+    }
+
+    /** Lays out a bank of empty presets, and opens it with InitWritable()
+     *  \param image memory for the image, aligned to 4 bytes at least, or
+     *         to kAlignment for records on cache lines
+     *  \param max_size size of that memory, at least ImageSize()
+     *  \param num_presets 1 to kMaxPresets
+     *  \param record_size largest preset in bytes, rounded up to a
+     *         multiple of kAlignment
+     *  \param data_version the application's version of the records
+     */
+    Result Create(void*    image,
+                  size_t   max_size,
+                  size_t   num_presets,
+                  size_t   record_size,
+                  uint16_t data_version = 0)
+    {
+        image_    = nullptr;
+        writable_ = nullptr;
+        header_   = nullptr;
+        entries_  = nullptr;
+        if(image == nullptr || num_presets == 0 || num_presets > kMaxPresets
+           || record_size == 0
+           || ImageSize(num_presets, record_size) > max_size)
+            return Result::ERR_SIZE;
+
+        const size_t size  = ImageSize(num_presets, record_size);
+        uint8_t*     bytes = static_cast<uint8_t*>(image);
+        std::memset(image, 0, size);
+        Header header       = {};
+        header.magic        = kMagic;
+        header.version      = kVersion;
+        header.num_presets  = uint16_t(num_presets);
+        header.record_size  = uint32_t(RoundUp(record_size));
+        header.image_size   = uint32_t(size);
+        header.index_crc    = Crc32(bytes + sizeof(Header),
+                                 num_presets * sizeof(Entry));
+        header.data_version = data_version;
+        std::memcpy(image, &header, sizeof(header));
+        return InitWritable(image, max_size);
+    }
+
+    /** Saves a preset, and updates the CRCs
+     *  \param idx number of the preset
+     *  \param name up to kMaxNameLength characters, longer ones are cut
+     *  \param data the preset, e.g. the settings struct
+     *  \param size size of data in bytes, up to GetRecordSize()
+     */
+    Result Store(size_t idx, const char* name, const void* data, size_t size)
+    {
+        if(idx >= GetNumPresets())
+            return Result::ERR_INDEX;
+        if(writable_ == nullptr)
+            return Result::ERR_READ_ONLY;
+        if(size > header_->record_size)
+            return Result::ERR_SIZE;
+
+        uint8_t* record = writable_ + RecordOffset(idx);
+        std::memcpy(record, data, size);
+        std::memset(record + size, 0, header_->record_size - size);
+        Entry entry = {};
+        std::strncpy(entry.name, name != nullptr ? name : "", kMaxNameLength);
+        entry.size = uint32_t(size);
+        entry.crc  = Crc32(record, size);
+        SetEntry(idx, entry);
+        return Result::OK;
+    }
+
+    /** Saves a preset of trivially copyable type, see above */
+    template <typename T>
+    Result Store(size_t idx, const char* name, const T& preset)
+    {
+        return Store(idx, name, &preset, sizeof(T));
+    }
+
+    /** Empties the slot of a preset */
+    Result Clear(size_t idx)
+    {
+        if(idx >= GetNumPresets())
+            return Result::ERR_INDEX;
+        if(writable_ == nullptr)
+            return Result::ERR_READ_ONLY;
+        std::memset(writable_ + RecordOffset(idx), 0, header_->record_size);
+        SetEntry(idx, Entry{});
+        return Result::OK;
+    }
+
+    /** Returns the record of a preset, pointing into the image, nullptr if
+     *  there is no preset at idx. Takes the same time for any preset.
+     */
+    const void* GetRecord(size_t idx) const
+    {
+        return idx < GetNumPresets() ? image_ + RecordOffset(idx) : nullptr;
+    }
+
+    /** Copies a preset. If it's shorter than T, e.g. saved by an older
+     *  version with a smaller struct, the rest of preset is left untouched,
+     *  if it's longer, it's truncated.
+     *  \returns false if there is no preset at idx, or its slot is empty
+     */
+    template <typename T>
+    bool Load(size_t idx, T& preset) const
+    {
+        if(idx >= GetNumPresets() || entries_[idx].size == 0)
+            return false;
+        const size_t size = entries_[idx].size;
+        std::memcpy(
+            &preset, GetRecord(idx), size < sizeof(T) ? size : sizeof(T));
+        return true;
+    }
+
+    /** Checks the CRC of a preset's record
+     *  \returns false if it's damaged, or there is no preset at idx
+     */
+    bool VerifyRecord(size_t idx) const
+    {
+        if(idx >= GetNumPresets())
+            return false;
+        return Crc32(GetRecord(idx), entries_[idx].size) == entries_[idx].crc;
+    }
+
+    /** Returns the name of a preset, nullptr if there is none at idx */
+    const char* GetName(size_t idx) const
+    {
+        return idx < GetNumPresets() ? entries_[idx].name : nullptr;
+    }
+
+    /** Returns the bytes used of a preset's record, 0 for an empty slot */
+    size_t GetSize(size_t idx) const
+    {
+        return idx < GetNumPresets() ? entries_[idx].size : 0;
+    }
+
+    /** Returns the index of the first preset with a name, or kNotFound.
+     *  Compares all names, recall the presets by their numbers.
+     */
+    int Find(const char* name) const
+    {
+        for(size_t i = 0; i < GetNumPresets(); i++)
+        {
+            if(entries_[i].size > 0
+               && std::strncmp(entries_[i].name, name, sizeof(Entry::name))
+                      == 0)
+                return int(i);
+        }
+        return kNotFound;
+    }
+
+    /** Returns the number of preset slots, 0 without a bank */
+    size_t GetNumPresets() const
+    {
+        return header_ != nullptr ? header_->num_presets : 0;
+    }
+
+    /** Returns the size of each record in bytes */
+    size_t GetRecordSize() const
+    {
+        return header_ != nullptr ? header_->record_size : 0;
+    }
+
+    /** Returns Header::data_version, the layout the records were saved
+     *  with
+     */
+    uint16_t GetDataVersion() const
+    {
+        return header_ != nullptr ? header_->data_version : 0;
+    }
+
+    /** Returns the start of the whole image, to write it somewhere */
+    const void* GetImage() const { return image_; }
+
+    /** Returns the size of the whole image in bytes, 0 without a bank */
+    size_t GetImageSize() const
+    {
+        return header_ != nullptr ? header_->image_size : 0;
+    }
+
+  private:
+    static constexpr size_t RoundUp(size_t size)
+    {
+        return (size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    size_t RecordOffset(size_t idx) const
+    {
+        return sizeof(Header) + size_t(header_->num_presets) * sizeof(Entry)
+               + idx * header_->record_size;
+    }
+
+    /** Writes an entry, and the CRC of the index */
+    void SetEntry(size_t idx, const Entry& entry)
+    {
+        uint8_t* index = writable_ + sizeof(Header);
+        std::memcpy(index + idx * sizeof(Entry), &entry, sizeof(Entry));
+        const uint32_t crc
+            = Crc32(index, size_t(header_->num_presets) * sizeof(Entry));
+        std::memcpy(
+            writable_ + offsetof(Header, index_crc), &crc, sizeof(crc));
+    }
+
+    const uint8_t* image_;
+    uint8_t*       writable_;
+    const Header*  header_;
+    const Entry*   entries_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,76 @@
+#include "util/Profiler.h"
+#include "util/scopedirqblocker.h"
+#include <cstring>
+
+namespace daisy
+{
+constexpr int8_t Profiler::kInvalidSection;
+constexpr int8_t Profiler::kUnregisteredSection;
+
+Profiler::Section Profiler::sections_[DSY_PROFILER_MAX_SECTIONS];
+volatile size_t   Profiler::num_sections_ = 0;
+int8_t            Profiler::current_[2]
+    = {Profiler::kInvalidSection, Profiler::kInvalidSection};
+
+int8_t Profiler::Register(const char* name)
+{
+    // scopes in the audio callback can preempt registering in the main loop
+    ScopedIrqBlocker irq_blocker;
+
+    const int8_t parent = current_[GetContext()];
+    for(size_t i = 0; i < num_sections_; i++)
+    {
+        if(sections_[i].parent == parent
+           && std::strcmp(sections_[i].name, name) == 0)
+            return int8_t(i);
+    }
+    if(num_sections_ >= DSY_PROFILER_MAX_SECTIONS)
+        return kInvalidSection;
+
+    const uint8_t depth
+        = parent == kInvalidSection ? 0 : sections_[parent].depth + 1;
+    Section& s     = sections_[num_sections_];
+    s.name         = name;
+    s.parent       = parent;
+    s.depth        = depth;
+    s.calls        = 0;
+    s.max_cycles   = 0;
+    s.total_cycles = 0;
+
+    return int8_t(num_sections_++);
+}
+
+int8_t Profiler::Enter(int8_t section)
+{
+    const size_t ctx      = GetContext();
+    const int8_t previous = current_[ctx];
+    if(section >= 0)
+        current_[ctx] = section;
+    return previous;
+}
+
+void Profiler::Exit(int8_t section, int8_t previous, uint32_t cycles)
+{
+    if(section >= 0)
+    {
+        Section& s = sections_[section];
+        s.calls++;
+        s.total_cycles += cycles;
+        if(cycles > s.max_cycles)
+            s.max_cycles = cycles;
+    }
+    current_[GetContext()] = previous;
+}
+
+void Profiler::Reset()
+{
+    ScopedIrqBlocker irq_blocker;
+    for(size_t i = 0; i < num_sections_; i++)
+    {
+        sections_[i].calls        = 0;
+        sections_[i].max_cycles   = 0;
+        sections_[i].total_cycles = 0;
+    }
+}
+
+} // namespace daisy
@@ -0,0 +1,229 @@
+#pragma once
+#ifndef DSY_PROFILER_H
+#define DSY_PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sys/system.h"
+
+/** Number of entries in the static section table */
+#ifndef DSY_PROFILER_MAX_SECTIONS
+#define DSY_PROFILER_MAX_SECTIONS 16
+#endif
+
+namespace daisy
+{
+/** @brief Cycle counting profiler for named code sections
+ *  @addtogroup utility
+ *
+ *  Accumulates the DWT cycle counts of named sections into a static table,
+ *  so that it's possible to tell which stage of the processing takes up
+ *  the most time, or occasionally blows the budget of the audio callback.
+ *
+ *  Sections are created with the DSY_PROFILE_SCOPE() macro, which measures
+ *  from its location to the end of the enclosing scope. Scopes can be nested,
+ *  a section's parent is the section that was active when the scope was
+ *  entered for the first time. Audio callbacks and the main loop are
+ *  tracked separately, so interrupts don't end up as children of main loop
+ *  sections. The measured times are inclusive: they contain the nested
+ *  sections, and any interrupts that ran in between.
+ *
+ *  The scopes are only compiled in when DSY_PROFILING is defined, otherwise
+ *  DSY_PROFILE_SCOPE() expands to nothing.
+ *
+ *  @code
+ *  void AudioCallback(InputBuffer in, OutputBuffer out, size_t size)
+ *  {
+ *      DSY_PROFILE_SCOPE("audio");
+ *      {
+ *          DSY_PROFILE_SCOPE("reverb");
+ *          reverb.Process(in, out, size);
+ *      }
+ *  }
+ *
+ *  int main(void)
+ *  {
+ *      // ...
+ *      while(1)
+ *      {
+ *          System::Delay(1000);
+ *          Profiler::Print<DaisySeed::Log>();
+ *      }
+ *  }
+ *  @endcode
+ */
+class Profiler
+{
+  public:
+    /** Accumulated measurements of one section */
+    struct Section
+    {
+        /** name, as passed to DSY_PROFILE_SCOPE() */
+        const char* name;
+
+        /** index of the enclosing section, or -1 for top level sections */
+        int8_t parent;
+
+        /** nesting level, 0 for top level sections */
+        uint8_t depth;
+
+        /** number of times the section was executed */
+        uint32_t calls;
+
+        /** longest execution of the section in cycles */
+        uint32_t max_cycles;
+
+        /** sum of all executions in cycles */
+        uint64_t total_cycles;
+    };
+
+    /** Section index for a full table. Scopes with this index are ignored. */
+    static constexpr int8_t kInvalidSection = -1;
+
+    /** Initial value of the section index cached by a scope */
+    static constexpr int8_t kUnregisteredSection = -2;
+
+    /** Returns the index of the section with the given name
+     *  inside of the currently active section. The section is added
+     *  to the table, if it doesn't exist yet.
+     *  \param name the name of the section. The string is not copied.
+     *  \returns the index, or kInvalidSection if the table is full.
+     */
+    static int8_t Register(const char* name);
+
+    /** Makes a section the active one in the current context.
+     *  \returns the previously active section, to be passed to Exit()
+     */
+    static int8_t Enter(int8_t section);
+
+    /** Adds a measurement to a section, and restores the previously
+     *  active section.
+     */
+    static void Exit(int8_t section, int8_t previous, uint32_t cycles);
+
+    /** Returns the number of sections in the table */
+    static size_t GetNumSections() { return num_sections_; }
+
+    /** Returns a section from the table */
+    static const Section& GetSection(size_t idx) { return sections_[idx]; }
+
+    /** Clears the measurements of all sections.
+     *  The sections stay registered.
+     */
+    static void Reset();
+
+    /** Prints the table of all sections, grouped by their parents.
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void Print()
+    {
+        const uint32_t cycles_per_us = System::GetCpuFreq() / 1000000;
+        LoggerType::PrintLine("%-24s %10s %10s %10s %8s",
+                              "section",
+                              "calls",
+                              "avg cyc",
+                              "max cyc",
+                              "max us");
+        for(size_t i = 0; i < num_sections_; i++)
+        {
+            if(sections_[i].parent == kInvalidSection)
+                PrintSection<LoggerType>(i, cycles_per_us);
+        }
+    }
+
+  private:
+    template <typename LoggerType>
+    static void PrintSection(size_t idx, uint32_t cycles_per_us)
+    {
+        const Section& s      = sections_[idx];
+        const int      indent = s.depth * 2;
+        const uint32_t avg
+            = s.calls ? uint32_t(s.total_cycles / s.calls) : 0;
+        const uint32_t max_us
+            = cycles_per_us ? s.max_cycles / cycles_per_us : 0;
+        LoggerType::PrintLine("%*s%-*s %10lu %10lu %10lu %8lu",
+                              indent,
+                              "",
+                              24 - indent,
+                              s.name,
+                              (unsigned long)s.calls,
+                              (unsigned long)avg,
+                              (unsigned long)s.max_cycles,
+                              (unsigned long)max_us);
+        for(size_t i = idx + 1; i < num_sections_; i++)
+        {
+            if(sections_[i].parent == int8_t(idx))
+                PrintSection<LoggerType>(i, cycles_per_us);
+        }
+    }
+
+    /** Returns 0 for the main loop, and 1 inside of interrupt handlers */
+    static inline size_t GetContext()
+    {
+#if defined(__arm__) && !defined(UNIT_TEST)
+        uint32_t ipsr;
+        asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+        return ipsr ? 1 : 0;
+#else
+        return 0;
+#endif
+    }
+
+    static Section         sections_[DSY_PROFILER_MAX_SECTIONS];
+    static volatile size_t num_sections_;
+    static int8_t          current_[2];
+};
+
+/** @brief Measures the cycles from its construction to its destruction
+ *  @addtogroup utility
+ *  Usually created with the DSY_PROFILE_SCOPE() macro, see Profiler.
+ */
+class ProfileScope
+{
+  public:
+    /** \param name the name of the section
+     *  \param section_cache a static index cache per call site, initialized
+     *                       to Profiler::kUnregisteredSection. This way the
+     *                       table lookup only happens once.
+     */
+    ProfileScope(const char* name, int8_t& section_cache)
+    {
+        if(section_cache == Profiler::kUnregisteredSection)
+            section_cache = Profiler::Register(name);
+        section_  = section_cache;
+        previous_ = Profiler::Enter(section_);
+        start_    = System::GetCycleCount();
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::Exit(section_, previous_, System::GetCycleCount() - start_);
+    }
+
+  private:
+    uint32_t start_;
+    int8_t   section_;
+    int8_t   previous_;
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+} // namespace daisy
+
+#define DSY_PROFILE_CAT_NX(A, B) A##B /**< non-expanding concatenation */
+#define DSY_PROFILE_CAT(A, B) DSY_PROFILE_CAT_NX(A, B) /**< concatenation */
+
+#ifdef DSY_PROFILING
+/** Profiles the remainder of the enclosing scope as a section named name */
+#define DSY_PROFILE_SCOPE(name)                                             \
+    static int8_t DSY_PROFILE_CAT(dsy_profile_section_, __LINE__)           \
+        = daisy::Profiler::kUnregisteredSection;                            \
+    daisy::ProfileScope DSY_PROFILE_CAT(dsy_profile_scope_, __LINE__)(      \
+        name, DSY_PROFILE_CAT(dsy_profile_section_, __LINE__))
+#else
+#define DSY_PROFILE_SCOPE(name) /**< compiled out without DSY_PROFILING */
+#endif
+
+#endif
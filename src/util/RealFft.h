@@ -0,0 +1,125 @@
+#pragma once
+#ifndef DSY_REALFFT_H
+#define DSY_REALFFT_H
+
+#include <cmath>
+#include <cstddef>
+
+namespace daisy
+{
+/** @brief In place FFT of a block of real samples
+ *  @addtogroup utility
+ *
+ *  The N real samples are treated as N / 2 complex ones, which a radix-2
+ *  FFT transforms, and a last pass splits the result into the spectrum of
+ *  the real signal. That's about half the work of a complex FFT of N
+ *  points. The output has the layout of CMSIS-DSP's arm_rfft_fast_f32():
+ *  the real parts of bins 0 and N / 2 first, as both have no imaginary
+ *  part, then the real and imaginary part of bins 1 to N / 2 - 1.
+ *
+ *  The twiddle factors are computed once by Init(), so the object can
+ *  be placed in the SDRAM.
+ *
+ *  \tparam N number of samples, a power of two of at least 4
+ */
+template <size_t N>
+class RealFft
+{
+    static_assert(N >= 4 && (N & (N - 1)) == 0,
+                  "N must be a power of two of at least 4");
+
+  public:
+    RealFft() {}
+
+    /** Computes the twiddle factors, call it before use */
+    void Init()
+    {
+        // W^k = exp(-2 pi i k / N)
+        const float pi = 3.14159265358979f;
+        for(size_t k = 0; k < N / 2; k++)
+        {
+            wre_[k] = cosf(2.f * pi * float(k) / float(N));
+            wim_[k] = -sinf(2.f * pi * float(k) / float(N));
+        }
+    }
+
+    /** Transforms N samples in place, see the class for the layout */
+    void Forward(float* buf) const
+    {
+        Complex(buf);
+
+        // X[k] = (Z[k] + Z*[M - k]) / 2 - i W^k (Z[k] - Z*[M - k]) / 2
+        const float re0 = buf[0], im0 = buf[1];
+        buf[0]          = re0 + im0;
+        buf[1]          = re0 - im0;
+        for(size_t k = 1; k <= kHalf / 2; k++)
+        {
+            float*      a  = &buf[2 * k];
+            float*      b  = &buf[2 * (kHalf - k)];
+            const float sr = 0.5f * (a[0] + b[0]);
+            const float si = 0.5f * (a[1] - b[1]);
+            const float dr = 0.5f * (a[1] + b[1]);
+            const float di = -0.5f * (a[0] - b[0]);
+            const float wr = wre_[k];
+            const float wi = wim_[k];
+            const float tr = wr * dr - wi * di;
+            const float ti = wr * di + wi * dr;
+            a[0]           = sr + tr;
+            a[1]           = si + ti;
+            b[0]           = sr - tr;
+            b[1]           = -(si - ti);
+        }
+    }
+
+  private:
+    static constexpr size_t kHalf = N / 2;
+
+    /** Radix-2 FFT of N / 2 interleaved complex samples */
+    void Complex(float* buf) const
+    {
+        for(size_t i = 1, j = 0; i < kHalf; i++)
+        {
+            size_t bit = kHalf >> 1;
+            for(; j & bit; bit >>= 1)
+                j ^= bit;
+            j |= bit;
+            if(i < j)
+            {
+                float t        = buf[2 * i];
+                buf[2 * i]     = buf[2 * j];
+                buf[2 * j]     = t;
+                t              = buf[2 * i + 1];
+                buf[2 * i + 1] = buf[2 * j + 1];
+                buf[2 * j + 1] = t;
+            }
+        }
+        for(size_t len = 2; len <= kHalf; len <<= 1)
+        {
+            // W of the stage is exp(-2 pi i k / len), the k * N / len'th
+            const size_t step = N / len;
+            for(size_t start = 0; start < kHalf; start += len)
+            {
+                for(size_t k = 0; k < len / 2; k++)
+                {
+                    float*      a  = &buf[2 * (start + k)];
+                    float*      b  = &buf[2 * (start + k + len / 2)];
+                    const float wr = wre_[k * step];
+                    const float wi = wim_[k * step];
+                    const float tr = wr * b[0] - wi * b[1];
+                    const float ti = wr * b[1] + wi * b[0];
+                    b[0]           = a[0] - tr;
+                    b[1]           = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+
+    float wre_[N / 2]; // real parts of W^k
+    float wim_[N / 2]; // imaginary parts of W^k
+};
+
+} // namespace daisy
+
+#endif
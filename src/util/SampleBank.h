@@ -0,0 +1,273 @@
+#pragma once
+#ifndef DSY_SAMPLEBANK_H
+#define DSY_SAMPLEBANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief Reads a bank of samples from an image in memory, e.g. in the
+ *  memory mapped QSPI flash, without copying them
+ *  @addtogroup utility
+ *
+ *  The image is made on the computer with resources/make_sample_bank.py
+ *  from a set of WAV files, and written to the flash once, e.g. with
+ *  QSPIHandle::Write() or the bootloader. It's laid out as:
+ *  - a 32 byte Header
+ *  - an index of one 48 byte Entry per sample, with its name, format and
+ *    the offset and size of its data
+ *  - the data of the samples, each starting on a 32 byte boundary, so a
+ *    sample starts on a cache line, and can be read with the MDMA
+ *
+ *  All values are little endian. Init() checks the header and a CRC of
+ *  the index, so an erased or partly written flash isn't used. GetSample()
+ *  then points right at the data in the image. VerifyData() checks the
+ *  CRC of all the data, which takes a while for a large bank.
+ *
+ *  @code
+ *  SampleBank bank;
+ *  if(bank.Init(hw.qspi.GetData(bank_offset), bank_max_size)
+ *     == SampleBank::Result::OK)
+ *  {
+ *      SampleBank::Sample kick;
+ *      if(bank.GetSample(bank.Find("kick"), kick))
+ *          player.Play(kick.Pcm16(), kick.num_frames);
+ *  }
+ *  @endcode
+ */
+class SampleBank
+{
+  public:
+    enum class Result
+    {
+        OK,          /**< & */
+        ERR_MAGIC,   /**< not a sample bank, e.g. an erased flash */
+        ERR_VERSION, /**< made for another version of the format */
+        ERR_SIZE,    /**< larger than the memory, or a bad offset */
+        ERR_CRC,     /**< the index is damaged */
+        ERR_ENTRY,   /**< an entry has an unknown format, or bad sizes */
+    };
+
+    /** Format of the data of a sample, interleaved if it has several
+     *  channels
+     */
+    enum class Format : uint8_t
+    {
+        PCM_16,   /**< int16_t */
+        FLOAT_32, /**< float, -1 to 1 */
+        FORMAT_LAST,
+    };
+
+    /** "DSYB" */
+    static constexpr uint32_t kMagic = 0x42595344;
+    /** Version of the format that's read */
+    static constexpr uint16_t kVersion = 1;
+    /** Alignment of the data of each sample */
+    static constexpr uint32_t kAlignment = 32;
+    /** Longest name, without the terminating 0 */
+    static constexpr size_t kMaxNameLength = 23;
+    /** Returned by Find() for a name that isn't in the bank */
+    static constexpr int kNotFound = -1;
+
+    /** Start of the image */
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t num_samples;
+        uint32_t image_size; /**< all of the image, in bytes */
+        uint32_t index_crc;  /**< Crc32() of the entries */
+        uint32_t data_crc;   /**< Crc32() from the end of the index */
+        uint32_t reserved[3];
+    };
+
+    /** Index entry of a sample */
+    struct Entry
+    {
+        /** 0 terminated, padded with 0s */
+        char name[kMaxNameLength + 1];
+        uint32_t offset;     /**< from the start of the image */
+        uint32_t size;       /**< of the data, in bytes */
+        uint32_t samplerate; /**< in Hz */
+        uint32_t loop_start; /**< first frame of the loop */
+        uint32_t loop_end;   /**< frame after the loop, 0 for none */
+        uint8_t  channels;
+        Format   format;
+        uint16_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32, "the header is 32 bytes");
+    static_assert(sizeof(Entry) == 48, "an entry is 48 bytes");
+
+    /** A sample of the bank, pointing into the image */
+    struct Sample
+    {
+        const char* name;
+        const void* data;
+        uint32_t    size;       /**< in bytes */
+        uint32_t    num_frames; /**< samples per channel */
+        uint32_t    samplerate;
+        uint32_t    loop_start;
+        uint32_t    loop_end;
+        uint8_t     channels;
+        Format      format;
+
+        /** Returns the data of a PCM_16 sample, nullptr for other formats */
+        const int16_t* Pcm16() const
+        {
+            return format == Format::PCM_16
+                       ? static_cast<const int16_t*>(data)
+                       : nullptr;
+        }
+
+        /** Returns the data of a FLOAT_32 sample, nullptr for other
+         *  formats
+         */
+        const float* Float32() const
+        {
+            return format == Format::FLOAT_32
+                       ? static_cast<const float*>(data)
+                       : nullptr;
+        }
+    };
+
+    SampleBank() : image_(nullptr), header_(nullptr), entries_(nullptr) {}
+
+    /** Checks the image, and reads it from then on
+     *  \param image start of the image, e.g. from QSPIHandle::GetData()
+     *  \param max_size size of the memory the image is in
+     *  \returns Result::OK, or why the image can't be used, then the bank
+     *           has no samples
+     */
+    Result Init(const void* image, size_t max_size)
+    {
+        image_   = nullptr;
+        header_  = nullptr;
+        entries_ = nullptr;
+        if(image == nullptr || max_size < sizeof(Header))
+            return Result::ERR_SIZE;
+
+        const uint8_t* bytes  = static_cast<const uint8_t*>(image);
+        const Header*  header = reinterpret_cast<const Header*>(image);
+        if(header->magic != kMagic)
+            return Result::ERR_MAGIC;
+        if(header->version != kVersion)
+            return Result::ERR_VERSION;
+        const size_t index_end
+            = sizeof(Header) + size_t(header->num_samples) * sizeof(Entry);
+        if(header->image_size > max_size || header->image_size < index_end)
+            return Result::ERR_SIZE;
+
+        const Entry* entries
+            = reinterpret_cast<const Entry*>(bytes + sizeof(Header));
+        const size_t index_size = index_end - sizeof(Header);
+        if(Crc32(entries, index_size) != header->index_crc)
+            return Result::ERR_CRC;
+        for(size_t i = 0; i < header->num_samples; i++)
+        {
+            if(!IsValid(entries[i], index_end, header->image_size))
+                return Result::ERR_ENTRY;
+        }
+
+        image_   = bytes;
+        header_  = header;
+        entries_ = entries;
+        return Result::OK;
+    }
+
+    /** Checks the CRC of the data of all samples, about 15 cycles a byte
+     *  \returns false if the data is damaged, or there's no bank
+     */
+    bool VerifyData() const
+    {
+        if(header_ == nullptr)
+            return false;
+        const size_t index_end = DataStart();
+        return Crc32(image_ + index_end, header_->image_size - index_end)
+               == header_->data_crc;
+    }
+
+    /** Returns the number of samples */
+    size_t GetNumSamples() const
+    {
+        return header_ != nullptr ? header_->num_samples : 0;
+    }
+
+    /** Returns the size of the whole image in bytes, 0 without a bank */
+    size_t GetImageSize() const
+    {
+        return header_ != nullptr ? header_->image_size : 0;
+    }
+
+    /** Gets a sample
+     *  \param idx index of the sample, e.g. from Find()
+     *  \param sample set to the sample, pointing into the image
+     *  \returns false if there's no sample at idx
+     */
+    bool GetSample(int idx, Sample& sample) const
+    {
+        if(idx < 0 || size_t(idx) >= GetNumSamples())
+            return false;
+        const Entry& entry = entries_[idx];
+        sample.name        = entry.name;
+        sample.data        = image_ + entry.offset;
+        sample.size        = entry.size;
+        sample.num_frames  = entry.size / FrameSize(entry);
+        sample.samplerate  = entry.samplerate;
+        sample.loop_start  = entry.loop_start;
+        sample.loop_end    = entry.loop_end;
+        sample.channels    = entry.channels;
+        sample.format      = entry.format;
+        return true;
+    }
+
+    /** Returns the index of the first sample with a name, or kNotFound.
+     *  Compares all names, so look them up once, not per block.
+     */
+    int Find(const char* name) const
+    {
+        for(size_t i = 0; i < GetNumSamples(); i++)
+        {
+            if(std::strncmp(entries_[i].name, name, sizeof(Entry::name)) == 0)
+                return int(i);
+        }
+        return kNotFound;
+    }
+
+  private:
+    size_t DataStart() const
+    {
+        return sizeof(Header) + size_t(header_->num_samples) * sizeof(Entry);
+    }
+
+    static size_t FrameSize(const Entry& entry)
+    {
+        const size_t bytes = entry.format == Format::PCM_16 ? 2 : 4;
+        return bytes * entry.channels;
+    }
+
+    static bool IsValid(const Entry& entry, size_t data_start, size_t end)
+    {
+        if(entry.name[kMaxNameLength] != '\0' || entry.channels == 0
+           || entry.format >= Format::FORMAT_LAST)
+            return false;
+        if(entry.offset % kAlignment != 0 || entry.offset < data_start
+           || entry.offset > end || entry.size > end - entry.offset)
+            return false;
+        const size_t frames = entry.size / FrameSize(entry);
+        return entry.size % FrameSize(entry) == 0
+               && entry.loop_start <= entry.loop_end
+               && entry.loop_end <= frames;
+    }
+
+    const uint8_t* image_;
+    const Header*  header_;
+    const Entry*   entries_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,311 @@
+#include "util/SampleSlots.h"
+#include <cstring>
+#include "util/scopedirqblocker.h"
+
+namespace daisy
+{
+namespace
+{
+uint32_t ReadU32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint16_t ReadU16(const uint8_t* p)
+{
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+} // namespace
+
+bool SampleSlots::Init(FileIoQueue&          queue,
+                       MemoryArena&          arena,
+                       size_t                slot_size,
+                       size_t                num_slots,
+                       FileIoQueue::Priority priority)
+{
+    queue_         = &queue;
+    priority_      = priority;
+    num_samples_   = 0;
+    use_count_     = 0;
+    num_loads_     = 0;
+    num_evictions_ = 0;
+    loading_       = -1;
+    stage_         = Stage::IDLE;
+    stage_queued_  = false;
+    load_ok_       = false;
+    // slots on cache lines, so the DMA can read right into them
+    return pool_.Init(arena, slot_size, num_slots, 32);
+}
+
+int SampleSlots::AddSample(const char* path)
+{
+    if(path == nullptr || num_samples_ >= DSY_SAMPLE_SLOTS_MAX_SAMPLES)
+        return -1;
+    Entry& e    = samples_[num_samples_];
+    e.path      = path;
+    e.state     = State::UNLOADED;
+    e.acquired  = 0;
+    e.slot      = nullptr;
+    e.last_used = 0;
+    e.queued    = 0;
+    e.sample    = {};
+    return int(num_samples_++);
+}
+
+bool SampleSlots::Request(int sample)
+{
+    if(!IsSample(sample))
+        return false;
+    ScopedIrqBlocker irq_blocker;
+    Entry&           e = samples_[sample];
+    if(e.state == State::UNLOADED || e.state == State::FAILED)
+    {
+        e.state  = State::QUEUED;
+        e.queued = use_count_;
+    }
+    e.last_used = use_count_++;
+    return true;
+}
+
+const SampleSlots::Sample* SampleSlots::Acquire(int sample)
+{
+    if(!IsSample(sample))
+        return nullptr;
+    ScopedIrqBlocker irq_blocker;
+    Entry&           e = samples_[sample];
+    if(e.state != State::READY || e.acquired == 0xFF)
+        return nullptr;
+    e.acquired++;
+    e.last_used = use_count_++;
+    return &e.sample;
+}
+
+void SampleSlots::Release(int sample)
+{
+    if(!IsSample(sample))
+        return;
+    ScopedIrqBlocker irq_blocker;
+    Entry&           e = samples_[sample];
+    if(e.acquired > 0)
+        e.acquired--;
+}
+
+bool SampleSlots::Unload(int sample)
+{
+    if(!IsSample(sample))
+        return false;
+    uint8_t* slot = nullptr;
+    {
+        ScopedIrqBlocker irq_blocker;
+        Entry&           e = samples_[sample];
+        if(e.state == State::LOADING || e.acquired > 0)
+            return false;
+        slot    = e.slot;
+        e.slot  = nullptr;
+        e.state = State::UNLOADED;
+    }
+    pool_.Free(slot);
+    return true;
+}
+
+void SampleSlots::Process()
+{
+    if(queue_ == nullptr)
+        return;
+    if(loading_ < 0)
+    {
+        // the oldest request goes first
+        int next = -1;
+        for(size_t i = 0; i < num_samples_; i++)
+        {
+            const Entry& e = samples_[i];
+            if(e.state == State::QUEUED
+               && (next < 0
+                   || int32_t(e.queued - samples_[next].queued) < 0))
+                next = int(i);
+        }
+        if(next < 0)
+            return;
+        uint8_t* slot = static_cast<uint8_t*>(pool_.Allocate());
+        if(slot == nullptr)
+            slot = Evict();
+        if(slot == nullptr)
+            return; // all slots are acquired, try again later
+        {
+            ScopedIrqBlocker irq_blocker;
+            samples_[next].slot  = slot;
+            samples_[next].state = State::LOADING;
+        }
+        loading_      = next;
+        stage_        = Stage::OPEN;
+        stage_queued_ = false;
+        load_ok_      = false;
+    }
+    // retried on every call while the queue is full
+    if(!stage_queued_)
+        QueueStage();
+}
+
+SampleSlots::State SampleSlots::GetState(int sample) const
+{
+    return IsSample(sample) ? samples_[sample].state : State::UNLOADED;
+}
+
+const char* SampleSlots::GetPath(int sample) const
+{
+    return IsSample(sample) ? samples_[sample].path : nullptr;
+}
+
+uint8_t* SampleSlots::Evict()
+{
+    ScopedIrqBlocker irq_blocker;
+    Entry*           oldest = nullptr;
+    for(size_t i = 0; i < num_samples_; i++)
+    {
+        Entry& e = samples_[i];
+        if(e.state == State::READY && e.acquired == 0
+           && (oldest == nullptr
+               || int32_t(e.last_used - oldest->last_used) < 0))
+            oldest = &e;
+    }
+    if(oldest == nullptr)
+        return nullptr;
+    uint8_t* const slot = oldest->slot;
+    oldest->slot        = nullptr;
+    oldest->state       = State::UNLOADED;
+    num_evictions_++;
+    return slot;
+}
+
+void SampleSlots::QueueStage()
+{
+    Entry& e = samples_[loading_];
+    switch(stage_)
+    {
+        case Stage::OPEN:
+            stage_queued_ = queue_->Open(
+                &file_, e.path, FA_READ, priority_, OnOpen, this);
+            break;
+        case Stage::READ:
+            stage_queued_ = queue_->Read(
+                &file_, e.slot, f_size(&file_), priority_, OnRead, this);
+            break;
+        case Stage::CLOSE:
+            stage_queued_ = queue_->Close(&file_, priority_, OnClose, this);
+            break;
+        case Stage::IDLE: break;
+    }
+}
+
+void SampleSlots::Finish(bool ok)
+{
+    Entry&   e    = samples_[loading_];
+    uint8_t* slot = nullptr;
+    if(ok)
+    {
+        ParseSample(e, e.sample.size);
+        num_loads_++;
+    }
+    else
+    {
+        slot   = e.slot;
+        e.slot = nullptr;
+    }
+    e.state  = ok ? State::READY : State::FAILED;
+    loading_ = -1;
+    stage_   = Stage::IDLE;
+    pool_.Free(slot);
+}
+
+void SampleSlots::ParseSample(Entry& e, size_t size)
+{
+    Sample& s = e.sample;
+    s         = {};
+    s.data    = e.slot;
+    s.size    = size;
+    if(size < 12 || ReadU32(e.slot) != kWavFileChunkId
+       || ReadU32(e.slot + 8) != kWavFileWaveId)
+        return;
+
+    // walk the chunks for the format and the data
+    size_t         pos         = 12;
+    const uint8_t* data        = nullptr;
+    size_t         data_size   = 0;
+    uint16_t       block_align = 0;
+    while(pos + 8 <= size)
+    {
+        const uint32_t id     = ReadU32(e.slot + pos);
+        const size_t   length = ReadU32(e.slot + pos + 4);
+        const size_t   body   = pos + 8;
+        if(id == kWavFileSubChunk1Id && length >= 16 && body + 16 <= size)
+        {
+            s.format       = ReadU16(e.slot + body);
+            s.num_channels = ReadU16(e.slot + body + 2);
+            s.samplerate   = ReadU32(e.slot + body + 4);
+            block_align    = ReadU16(e.slot + body + 12);
+            s.bit_depth    = ReadU16(e.slot + body + 14);
+            // the actual format of an extensible file is in its sub format
+            if(s.format == WAVE_FORMAT_EXTENSIBLE && length >= 40
+               && body + 26 <= size)
+                s.format = ReadU16(e.slot + body + 24);
+        }
+        else if(id == kWavFileSubChunk2Id)
+        {
+            data      = e.slot + body;
+            data_size = length < size - body ? length : size - body;
+            break;
+        }
+        // chunks are padded to an even size
+        pos = body + length + (length & 1);
+    }
+    if(data == nullptr || block_align == 0)
+    {
+        // not a wav file after all, it's played as raw data
+        s      = {};
+        s.data = e.slot;
+        s.size = size;
+        return;
+    }
+    s.data       = data;
+    s.size       = data_size;
+    s.num_frames = data_size / block_align;
+}
+
+void SampleSlots::OnOpen(void* context, FRESULT result, size_t)
+{
+    auto* self          = static_cast<SampleSlots*>(context);
+    self->stage_queued_ = false;
+    if(result != FR_OK)
+        self->Finish(false);
+    else
+        self->stage_ = f_size(&self->file_) <= self->pool_.GetBlockSize()
+                           ? Stage::READ
+                           : Stage::CLOSE;
+    if(self->stage_ != Stage::IDLE)
+        self->QueueStage();
+}
+
+void SampleSlots::OnRead(void* context, FRESULT result, size_t bytes)
+{
+    auto*  self = static_cast<SampleSlots*>(context);
+    Entry& e    = self->samples_[self->loading_];
+
+    e.sample.size       = bytes;
+    self->load_ok_      = result == FR_OK && bytes == f_size(&self->file_);
+    self->stage_queued_ = false;
+    self->stage_        = Stage::CLOSE;
+    self->QueueStage();
+}
+
+void SampleSlots::OnClose(void* context, FRESULT, size_t)
+{
+    auto* self          = static_cast<SampleSlots*>(context);
+    self->stage_queued_ = false;
+    self->Finish(self->load_ok_);
+}
+
+} // namespace daisy
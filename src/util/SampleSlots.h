@@ -0,0 +1,224 @@
+#pragma once
+#ifndef DSY_SAMPLESLOTS_H
+#define DSY_SAMPLESLOTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "ff.h"
+#include "util/BlockPool.h"
+#include "util/FileIoQueue.h"
+#include "util/MemoryArena.h"
+#include "util/wav_format.h"
+
+/** Number of sample files a SampleSlots can know of */
+#ifndef DSY_SAMPLE_SLOTS_MAX_SAMPLES
+#define DSY_SAMPLE_SLOTS_MAX_SAMPLES 128
+#endif
+
+namespace daisy
+{
+/** @brief Loads samples from the SD card into slots in the SDRAM on demand,
+ *  and drops the least recently used ones when the slots run out
+ *  @addtogroup utility
+ *
+ *  For samplers with more samples on the card than fit into the SDRAM.
+ *  All sample files are added once, and then loaded by Request() when
+ *  they're needed, e.g. when a pad is selected or a note is coming up.
+ *  The slots all have the same size, taken from a MemoryArena, so loading
+ *  and dropping samples never fragments the memory. A sample has to fit
+ *  into one slot.
+ *
+ *  Loading goes through a FileIoQueue, one file at a time, so it's done in
+ *  short time slices along with the other card accesses of the program.
+ *  When all slots are taken, the sample that was used the longest time ago
+ *  is dropped, unless it's acquired by the audio callback.
+ *
+ *  The audio callback calls Acquire() for the samples it plays. It returns
+ *  nullptr while a sample isn't loaded, so the callback can play silence,
+ *  a shorter preview sample, or wait for the next block. An acquired sample
+ *  stays in its slot until it's released again.
+ *
+ *  Request(), Acquire(), Release() and GetState() can be called from
+ *  interrupts. Everything else, including the FileIoQueue, has to run in
+ *  the main loop.
+ *
+ *  @code
+ *  FileIoQueue queue;
+ *  SampleSlots slots;
+ *  queue.Init();
+ *  slots.Init(queue, SdramHandle::GetArena(), 1024 * 1024, 48);
+ *  const int kick = slots.AddSample("kit/kick.wav");
+ *  slots.Request(kick);
+ *
+ *  // in the audio callback
+ *  const SampleSlots::Sample* s = slots.Acquire(kick);
+ *  if(s != nullptr)
+ *  {
+ *      // play s->data
+ *      slots.Release(kick);
+ *  }
+ *
+ *  // in the main loop
+ *  slots.Process();
+ *  queue.Process(500);
+ *  @endcode
+ */
+class SampleSlots
+{
+  public:
+    /** Where a sample is */
+    enum class State : uint8_t
+    {
+        UNLOADED, /**< on the card only */
+        QUEUED,   /**< requested, waiting for the card or a free slot */
+        LOADING,  /**< being read into a slot */
+        READY,    /**< in a slot, can be acquired */
+        FAILED,   /**< couldn't be read, or larger than a slot */
+    };
+
+    /** A loaded sample */
+    struct Sample
+    {
+        const uint8_t* data;         /**< the audio data, interleaved */
+        size_t         size;         /**< size of data in bytes */
+        size_t         num_frames;   /**< 0 if it's not a wav file */
+        uint32_t       samplerate;   /**< 0 if it's not a wav file */
+        uint16_t       format;       /**< a WavFileFormatCode, or 0 */
+        uint16_t       num_channels; /**< 0 if it's not a wav file */
+        uint16_t       bit_depth;    /**< 0 if it's not a wav file */
+    };
+
+    SampleSlots() : queue_(nullptr), num_samples_(0) {}
+
+    /** Takes the slots from an arena, e.g. SdramHandle::GetArena()
+     *  \param queue the queue the files are read through
+     *  \param arena memory for the slots
+     *  \param slot_size size of each slot, the largest file that can be
+     *                   loaded, rounded up to a multiple of 32 bytes
+     *  \param num_slots number of slots
+     *  \param priority of the reads in the queue
+     *  \returns false if the arena is too small
+     */
+    bool Init(FileIoQueue&          queue,
+              MemoryArena&          arena,
+              size_t                slot_size,
+              size_t                num_slots,
+              FileIoQueue::Priority priority = FileIoQueue::Priority::NORMAL);
+
+    /** Adds a sample file, the path has to stay valid
+     *  \returns the index of the sample, or -1 if there's no room for more
+     */
+    int AddSample(const char* path);
+
+    /** Queues loading a sample, if it's not loaded yet, and marks it as
+     *  used. Samples are loaded in the order they're requested. A sample
+     *  that failed is tried again.
+     *  \returns false if there's no such sample
+     */
+    bool Request(int sample);
+
+    /** Returns a loaded sample and keeps it in its slot until Release(),
+     *  or nullptr if it's not loaded.
+     *  Calls can be nested, one Release() is needed for each.
+     */
+    const Sample* Acquire(int sample);
+
+    /** Lets an acquired sample be dropped again */
+    void Release(int sample);
+
+    /** Drops a sample from its slot, unless it's acquired, or stops it
+     *  from being loaded if it's only queued
+     *  \returns false if it's acquired or being loaded
+     */
+    bool Unload(int sample);
+
+    /** Starts loading the next requested sample, and moves the current
+     *  load along. Call it from the main loop, along with
+     *  FileIoQueue::Process().
+     */
+    void Process();
+
+    /** Returns where a sample is, UNLOADED if there's no such sample */
+    State GetState(int sample) const;
+
+    /** Returns the path passed to AddSample(), or nullptr */
+    const char* GetPath(int sample) const;
+
+    /** Returns the number of samples added */
+    size_t GetNumSamples() const { return num_samples_; }
+
+    /** Returns the number of slots */
+    size_t GetNumSlots() const { return pool_.GetNumBlocks(); }
+
+    /** Returns the number of slots that hold a sample, or are being loaded */
+    size_t GetNumSlotsUsed() const { return pool_.GetNumUsed(); }
+
+    /** Returns the number of samples loaded since Init() */
+    uint32_t GetNumLoads() const { return num_loads_; }
+
+    /** Returns the number of samples dropped to make room since Init() */
+    uint32_t GetNumEvictions() const { return num_evictions_; }
+
+  private:
+    enum class Stage : uint8_t
+    {
+        IDLE,
+        OPEN,
+        READ,
+        CLOSE,
+    };
+
+    struct Entry
+    {
+        const char*    path;
+        volatile State state;
+        uint8_t        acquired;
+        uint8_t*       slot;
+        uint32_t       last_used; // the use_count_ of the last use
+        uint32_t       queued;    // the use_count_ when it was requested
+        Sample         sample;
+    };
+
+    bool IsSample(int sample) const
+    {
+        return sample >= 0 && size_t(sample) < num_samples_;
+    }
+
+    /** Frees the slot of the least recently used sample that isn't
+     *  acquired, and returns it, or nullptr
+     */
+    uint8_t* Evict();
+
+    /** Queues the FatFs call of the current stage */
+    void QueueStage();
+
+    /** Ends the current load */
+    void Finish(bool ok);
+
+    /** Fills in the sample info, from the wav header if there is one */
+    static void ParseSample(Entry& entry, size_t size);
+
+    static void OnOpen(void* context, FRESULT result, size_t bytes);
+    static void OnRead(void* context, FRESULT result, size_t bytes);
+    static void OnClose(void* context, FRESULT result, size_t bytes);
+
+    FileIoQueue*          queue_;
+    FileIoQueue::Priority priority_;
+    BlockPool             pool_;
+    Entry                 samples_[DSY_SAMPLE_SLOTS_MAX_SAMPLES];
+    size_t                num_samples_;
+    uint32_t              use_count_;
+    uint32_t              num_loads_;
+    uint32_t              num_evictions_;
+
+    // the current load
+    FIL   file_;
+    int   loading_;
+    Stage stage_;
+    bool  stage_queued_;
+    bool  load_ok_;
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,137 @@
+#include "util/SdBenchmark.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+namespace
+{
+/** Total and longest time of a series of transfers */
+struct Timing
+{
+    uint32_t start, total, max;
+
+    void Begin() { start = System::GetUs(); }
+
+    void End()
+    {
+        const uint32_t t = System::GetUs() - start;
+        total += t;
+        if(t > max)
+            max = t;
+    }
+};
+
+/** Writes or reads the whole file, one buffer at a time */
+FRESULT
+Sequential(FIL* fil, const SdBenchmark::Config& cfg, bool write, Timing& t)
+{
+    FRESULT res = f_lseek(fil, 0);
+    for(size_t pos = 0; pos < cfg.file_size && res == FR_OK;)
+    {
+        const size_t left = cfg.file_size - pos;
+        const UINT   n = UINT(left < cfg.buffer_size ? left : cfg.buffer_size);
+        UINT         bytes = 0;
+        t.Begin();
+        res = write ? f_write(fil, cfg.buffer, n, &bytes)
+                    : f_read(fil, cfg.buffer, n, &bytes);
+        t.End();
+        if(res == FR_OK && bytes < n)
+            res = FR_DENIED; // volume full, or file truncated
+        pos += n;
+    }
+    if(write && res == FR_OK)
+        res = f_sync(fil);
+    return res;
+}
+
+/** Reads or writes 4kB blocks at random offsets.
+ *  The sequence is fixed, so runs with different settings are comparable.
+ */
+FRESULT
+Random(FIL* fil, const SdBenchmark::Config& cfg, bool write, Timing& t)
+{
+    const size_t blocks = cfg.file_size / SdBenchmark::kRandomSize;
+    uint32_t     seed   = write ? 0x9e3779b9 : 0x12345678;
+    FRESULT      res    = FR_OK;
+    for(size_t i = 0; i < cfg.random_ops && res == FR_OK; i++)
+    {
+        seed                 = seed * 1664525 + 1013904223;
+        const FSIZE_t offset = FSIZE_t((seed >> 8) % blocks)
+                               * SdBenchmark::kRandomSize;
+        const UINT n     = SdBenchmark::kRandomSize;
+        UINT       bytes = 0;
+        t.Begin();
+        res = f_lseek(fil, offset);
+        if(res == FR_OK)
+            res = write ? f_write(fil, cfg.buffer, n, &bytes)
+                        : f_read(fil, cfg.buffer, n, &bytes);
+        t.End();
+        if(res == FR_OK && bytes < n)
+            res = FR_DENIED;
+    }
+    if(write && res == FR_OK)
+        res = f_sync(fil);
+    return res;
+}
+} // namespace
+
+SdBenchmark::Results SdBenchmark::Run(const Config& cfg)
+{
+    Results r = {};
+    if(cfg.buffer == nullptr || cfg.buffer_size < kRandomSize
+       || cfg.file_size < kRandomSize)
+    {
+        r.result = FR_INVALID_PARAMETER;
+        return r;
+    }
+
+    FIL fil;
+    r.result = f_open(&fil, cfg.path, FA_CREATE_ALWAYS | FA_WRITE | FA_READ);
+    if(r.result != FR_OK)
+        return r;
+    for(size_t i = 0; i < cfg.buffer_size; i++)
+        cfg.buffer[i] = uint8_t(i * 31);
+#if _USE_EXPAND
+    // contiguous, so the cluster allocation isn't part of the timing
+    f_expand(&fil, cfg.file_size, 1);
+#endif
+
+    Timing   t     = {};
+    uint32_t start = System::GetUs();
+    r.result       = Sequential(&fil, cfg, true, t);
+    uint32_t total = System::GetUs() - start;
+    r.write_mbps   = total > 0 ? float(cfg.file_size) / total : 0.f;
+    r.write_max_us = t.max;
+
+    if(r.result == FR_OK)
+    {
+        t             = {};
+        start         = System::GetUs();
+        r.result      = Sequential(&fil, cfg, false, t);
+        total         = System::GetUs() - start;
+        r.read_mbps   = total > 0 ? float(cfg.file_size) / total : 0.f;
+        r.read_max_us = t.max;
+    }
+
+    if(r.result == FR_OK && cfg.random_ops > 0)
+    {
+        t                  = {};
+        r.result           = Random(&fil, cfg, false, t);
+        r.rand_read_avg_us = t.total / cfg.random_ops;
+        r.rand_read_max_us = t.max;
+    }
+
+    if(r.result == FR_OK && cfg.random_ops > 0)
+    {
+        t                   = {};
+        r.result            = Random(&fil, cfg, true, t);
+        r.rand_write_avg_us = t.total / cfg.random_ops;
+        r.rand_write_max_us = t.max;
+    }
+
+    f_close(&fil);
+    f_unlink(cfg.path);
+    return r;
+}
+
+} // namespace daisy
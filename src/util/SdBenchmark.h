@@ -0,0 +1,99 @@
+#pragma once
+#ifndef DSY_SDBENCHMARK_H
+#define DSY_SDBENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "ff.h"
+#include "hid/logger.h"
+
+namespace daisy
+{
+/** @brief Measures the throughput and latency of a mounted FatFs volume
+ *  @addtogroup utility
+ *
+ *  Writes a test file sequentially, reads it back, and then reads and
+ *  overwrites random 4kB blocks of it. The timing includes FatFs, the disk
+ *  driver and the card, so it's what an application sees. Running it for
+ *  each SdmmcHandler::Config shows which bus settings a card copes with,
+ *  see the SDMMC_Benchmark example.
+ *
+ *  The buffer should be in memory the SD DMA can reach directly (AXI SRAM
+ *  or SDRAM, 32 byte aligned), otherwise the scratch buffer copies are
+ *  measured as well.
+ */
+class SdBenchmark
+{
+  public:
+    /** Settings of a run */
+    struct Config
+    {
+        /** test file, overwritten, and deleted after the run */
+        const char* path = "sdbench.bin";
+
+        /** transfer buffer, its size is the size of the sequential
+         *  transfers, at least 4kB */
+        uint8_t* buffer      = nullptr;
+        size_t   buffer_size = 0;
+
+        /** size of the test file in bytes */
+        size_t file_size = 4 * 1024 * 1024;
+
+        /** number of random reads and of random writes */
+        size_t random_ops = 256;
+    };
+
+    /** Measured times, latencies are in microseconds. The throughputs are
+     *  in 10^6 bytes per second.
+     */
+    struct Results
+    {
+        FRESULT  result;            /**< FR_OK, or the first error */
+        float    write_mbps;        /**< sequential write, with f_sync */
+        float    read_mbps;         /**< sequential read */
+        uint32_t write_max_us;      /**< slowest sequential write */
+        uint32_t read_max_us;       /**< slowest sequential read */
+        uint32_t rand_read_avg_us;  /**< random 4kB read, average */
+        uint32_t rand_read_max_us;  /**< random 4kB read, worst case */
+        uint32_t rand_write_avg_us; /**< random 4kB write, average */
+        uint32_t rand_write_max_us; /**< random 4kB write, worst case */
+    };
+
+    /** Size of the random transfers */
+    static constexpr size_t kRandomSize = 4096;
+
+    /** Runs the benchmark on the mounted volume the path is on.
+     *  Takes a few seconds at full speed, the test file is deleted after.
+     */
+    static Results Run(const Config& cfg);
+
+    /** Prints the results, with a title, e.g. the bus settings
+     *  \tparam LoggerType the Logger to print to, e.g. DaisySeed::Log
+     */
+    template <typename LoggerType>
+    static void Print(const char* title, const Results& r)
+    {
+        if(r.result != FR_OK)
+        {
+            LoggerType::PrintLine("%s: failed, FRESULT %d", title, r.result);
+            return;
+        }
+        LoggerType::PrintLine("%s", title);
+        LoggerType::PrintLine("  seq write  " FLT_FMT(2) " MB/s, max %lu us",
+                              FLT_VAR(2, r.write_mbps),
+                              (unsigned long)r.write_max_us);
+        LoggerType::PrintLine("  seq read   " FLT_FMT(2) " MB/s, max %lu us",
+                              FLT_VAR(2, r.read_mbps),
+                              (unsigned long)r.read_max_us);
+        LoggerType::PrintLine("  4k read    avg %lu us, max %lu us",
+                              (unsigned long)r.rand_read_avg_us,
+                              (unsigned long)r.rand_read_max_us);
+        LoggerType::PrintLine("  4k write   avg %lu us, max %lu us",
+                              (unsigned long)r.rand_write_avg_us,
+                              (unsigned long)r.rand_write_max_us);
+    }
+};
+
+} // namespace daisy
+
+#endif
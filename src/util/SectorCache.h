@@ -0,0 +1,183 @@
+#pragma once
+#ifndef DSY_SECTORCACHE_H
+#define DSY_SECTORCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace daisy
+{
+/** @brief Set associative cache of storage sectors
+ *  @addtogroup utility
+ *
+ *  Keeps copies of recently read 512 byte sectors in user provided memory
+ *  (e.g. SDRAM), so that repeated reads of the same sectors, like FAT and
+ *  directory sectors, don't have to go to the media again.
+ *
+ *  A sector can only be stored in one set of 4 lines, chosen by its number.
+ *  When all lines of a set are used, the least recently used one is
+ *  replaced. The cache is meant to be used write-through: after writing to
+ *  the media, Update() refreshes the sectors that are cached.
+ *
+ *  FatFSInterface uses it for the SD card, see FatFSInterface::Config.
+ */
+class SectorCache
+{
+  public:
+    /** Size of a sector in bytes */
+    static constexpr size_t kSectorSize = 512;
+
+    /** Number of lines a sector can be stored in */
+    static constexpr size_t kWays = 4;
+
+    SectorCache()
+    : lines_(nullptr), data_(nullptr), num_sets_(0), clock_(0), hits_(0),
+      misses_(0)
+    {
+    }
+
+    /** Divides the memory into lines, and empties the cache.
+     *  \param mem word aligned memory for the sectors and their tags,
+     *             e.g. in SDRAM
+     *  \param size size of mem in bytes. Less than about 2kB disables
+     *              the cache.
+     */
+    void Init(void* mem, size_t size)
+    {
+        // the tags first, then the sectors, aligned to cache lines
+        const size_t line_size = kSectorSize + sizeof(Line);
+        const size_t sets
+            = size > 32 ? (size - 32) / (line_size * kWays) : 0;
+        uintptr_t data = reinterpret_cast<uintptr_t>(mem)
+                         + sets * kWays * sizeof(Line);
+        data      = (data + 31) & ~uintptr_t(31);
+        lines_    = static_cast<Line*>(mem);
+        data_     = reinterpret_cast<uint8_t*>(data);
+        num_sets_ = mem != nullptr ? sets : 0;
+        Clear();
+        ResetStats();
+    }
+
+    /** Returns whether the cache has memory to store sectors */
+    bool IsEnabled() const { return num_sets_ > 0; }
+
+    /** Returns the number of sectors the cache can hold */
+    size_t GetNumSectors() const { return num_sets_ * kWays; }
+
+    /** Drops all cached sectors, e.g. when the media was changed */
+    void Clear()
+    {
+        for(size_t i = 0; i < num_sets_ * kWays; i++)
+        {
+            lines_[i].sector   = kInvalidSector;
+            lines_[i].last_use = 0;
+        }
+        clock_ = 0;
+    }
+
+    /** Copies a sector from the cache.
+     *  \returns false if the sector isn't cached
+     */
+    bool Read(uint32_t sector, uint8_t* dst)
+    {
+        const int line = Find(sector);
+        if(line < 0)
+        {
+            misses_++;
+            return false;
+        }
+        hits_++;
+        lines_[line].last_use = ++clock_;
+        std::memcpy(dst, &data_[line * kSectorSize], kSectorSize);
+        return true;
+    }
+
+    /** Stores a sector read from the media, replacing the least recently
+     *  used one of its set
+     */
+    void Insert(uint32_t sector, const uint8_t* src)
+    {
+        if(!IsEnabled())
+            return;
+        int line = Find(sector);
+        if(line < 0)
+        {
+            const size_t first = (sector % num_sets_) * kWays;
+            line               = int(first);
+            for(size_t i = first + 1; i < first + kWays; i++)
+            {
+                if(lines_[i].last_use < lines_[line].last_use)
+                    line = int(i);
+            }
+            lines_[line].sector = sector;
+        }
+        lines_[line].last_use = ++clock_;
+        std::memcpy(&data_[line * kSectorSize], src, kSectorSize);
+    }
+
+    /** Refreshes a sector after writing it to the media, if it's cached */
+    void Update(uint32_t sector, const uint8_t* src)
+    {
+        const int line = Find(sector);
+        if(line >= 0)
+            std::memcpy(&data_[line * kSectorSize], src, kSectorSize);
+    }
+
+    /** Drops a sector from the cache, e.g. after a failed write */
+    void Invalidate(uint32_t sector)
+    {
+        const int line = Find(sector);
+        if(line >= 0)
+        {
+            lines_[line].sector   = kInvalidSector;
+            lines_[line].last_use = 0;
+        }
+    }
+
+    /** Returns the number of sectors that were read from the cache */
+    uint32_t GetHits() const { return hits_; }
+
+    /** Returns the number of sectors that weren't in the cache */
+    uint32_t GetMisses() const { return misses_; }
+
+    /** Clears the hit and miss counters */
+    void ResetStats()
+    {
+        hits_   = 0;
+        misses_ = 0;
+    }
+
+  private:
+    static constexpr uint32_t kInvalidSector = 0xffffffff;
+
+    struct Line
+    {
+        uint32_t sector;
+        uint32_t last_use; // 0 for empty lines, so they're replaced first
+    };
+
+    /** Returns the line the sector is stored in, or -1 */
+    int Find(uint32_t sector) const
+    {
+        if(!IsEnabled())
+            return -1;
+        const size_t first = (sector % num_sets_) * kWays;
+        for(size_t i = first; i < first + kWays; i++)
+        {
+            if(lines_[i].sector == sector)
+                return int(i);
+        }
+        return -1;
+    }
+
+    Line*    lines_;
+    uint8_t* data_;
+    size_t   num_sets_;
+    uint32_t clock_;
+    uint32_t hits_, misses_;
+};
+
+} // namespace daisy
+
+#endif
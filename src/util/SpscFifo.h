@@ -0,0 +1,183 @@
+#pragma once
+#ifndef DSY_SPSCFIFO_H
+#define DSY_SPSCFIFO_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Lock-free FIFO for one producer and one consumer
+ *  @addtogroup utility
+ *
+ *  A FIFO that an interrupt handler can fill while the main loop empties
+ *  it, or the other way around, without a ScopedIrqBlocker on either side.
+ *  Each index is only written by its own side, and published with release
+ *  and read with acquire ordering, so the elements are complete before the
+ *  other side sees them. The indices run freely and are masked into the
+ *  buffer, which is why the capacity is a power of two, and all of it can
+ *  be used.
+ *
+ *  Besides single elements, whole blocks can be pushed and popped, or
+ *  written and read in place: Reserve() and Commit() on the producer side,
+ *  Peek() and Consume() on the consumer side, which work on the longest
+ *  contiguous span up to the end of the buffer.
+ *
+ *  @code
+ *  static SpscFifo<MidiEvent, 64> events;
+ *
+ *  events.PushBack(event); // in the UART interrupt
+ *
+ *  MidiEvent event;
+ *  while(events.PopFront(event)) // in the main loop
+ *      Handle(event);
+ *  @endcode
+ *
+ *  \tparam T element type, copied with its assignment operator
+ *  \tparam capacity number of elements, a power of two
+ */
+template <typename T, size_t capacity>
+class SpscFifo
+{
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+  public:
+    SpscFifo() : head_(0), tail_(0) {}
+
+    /** Adds an element, from the producer
+     *  \return false if the FIFO is full
+     */
+    bool PushBack(const T& element)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) >= capacity)
+            return false;
+        buffer_[head & kMask] = element;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Adds up to count elements, from the producer
+     *  \return the number of elements added
+     */
+    size_t PushBack(const T* elements, size_t count)
+    {
+        const uint32_t head  = head_.load(std::memory_order_relaxed);
+        const uint32_t tail  = tail_.load(std::memory_order_acquire);
+        const size_t   space = capacity - (head - tail);
+        if(count > space)
+            count = space;
+        for(size_t i = 0; i < count; i++)
+            buffer_[(head + i) & kMask] = elements[i];
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Removes the oldest element, from the consumer
+     *  \return false if the FIFO is empty
+     */
+    bool PopFront(T& element)
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if(head_.load(std::memory_order_acquire) == tail)
+            return false;
+        element = buffer_[tail & kMask];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Removes up to count elements, from the consumer
+     *  \return the number of elements removed
+     */
+    size_t PopFront(T* elements, size_t count)
+    {
+        const uint32_t tail  = tail_.load(std::memory_order_relaxed);
+        const size_t   avail = head_.load(std::memory_order_acquire) - tail;
+        if(count > avail)
+            count = avail;
+        for(size_t i = 0; i < count; i++)
+            elements[i] = buffer_[(tail + i) & kMask];
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Gets the free space to write in place, from the producer
+     *  \param span set to the first free element
+     *  \return the number of free elements after span, before the end of
+     *          the buffer, 0 if the FIFO is full
+     */
+    size_t Reserve(T*& span)
+    {
+        const uint32_t head  = head_.load(std::memory_order_relaxed);
+        const uint32_t tail  = tail_.load(std::memory_order_acquire);
+        const size_t   space = capacity - (head - tail);
+        const size_t   index = head & kMask;
+        span                 = &buffer_[index];
+        return space < capacity - index ? space : capacity - index;
+    }
+
+    /** Adds count elements written after Reserve(), from the producer */
+    void Commit(size_t count)
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + count,
+                    std::memory_order_release);
+    }
+
+    /** Gets the oldest elements to read in place, from the consumer
+     *  \param span set to the oldest element
+     *  \return the number of elements after span, before the end of the
+     *          buffer, 0 if the FIFO is empty
+     */
+    size_t Peek(const T*& span) const
+    {
+        const uint32_t tail  = tail_.load(std::memory_order_relaxed);
+        const size_t   avail = head_.load(std::memory_order_acquire) - tail;
+        const size_t   index = tail & kMask;
+        span                 = &buffer_[index];
+        return avail < capacity - index ? avail : capacity - index;
+    }
+
+    /** Removes count elements read after Peek(), from the consumer */
+    void Consume(size_t count)
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + count,
+                    std::memory_order_release);
+    }
+
+    /** Removes all elements, from the consumer */
+    void Clear()
+    {
+        tail_.store(head_.load(std::memory_order_acquire),
+                    std::memory_order_release);
+    }
+
+    /** \return the number of elements, which may change meanwhile */
+    size_t GetNumElements() const
+    {
+        // the tail first, the head can only have moved further since
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+    /** \return true if there are no elements */
+    bool IsEmpty() const { return GetNumElements() == 0; }
+
+    /** \return true if no element can be added */
+    bool IsFull() const { return GetNumElements() >= capacity; }
+
+    /** \return the number of elements that fit */
+    static constexpr size_t GetCapacity() { return capacity; }
+
+  private:
+    static constexpr uint32_t kMask = capacity - 1;
+
+    T                     buffer_[capacity];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+};
+
+} // namespace daisy
+
+#endif
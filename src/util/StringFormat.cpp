@@ -0,0 +1,416 @@
+#include <cmath>
+#include <cstdint>
+#include "util/StringFormat.h"
+
+namespace daisy
+{
+namespace
+{
+/** Appends to the string, and counts what doesn't fit */
+class Writer
+{
+  public:
+    explicit Writer(FixedCapStrBase<char>& str) : str_(str), length_(0) {}
+
+    void Put(const char* text, size_t n)
+    {
+        str_.Append(text, n);
+        length_ += n;
+    }
+
+    void Pad(char c, int n)
+    {
+        for(int i = 0; i < n; i++)
+            str_.Append(c);
+        length_ += n > 0 ? n : 0;
+    }
+
+    size_t GetLength() const { return length_; }
+
+  private:
+    FixedCapStrBase<char>& str_;
+    size_t                 length_;
+};
+
+/** One conversion of the format string */
+struct Spec
+{
+    bool left;
+    bool plus;
+    bool space;
+    bool zero;
+    bool alt;
+    int  width;
+    int  precision; /**< -1 if not given */
+    char length;    /**< 'H' for hh, 'L' for ll, 0 for none */
+};
+
+constexpr uint32_t kPow10[10] = {1,
+                                 10,
+                                 100,
+                                 1000,
+                                 10000,
+                                 100000,
+                                 1000000,
+                                 10000000,
+                                 100000000,
+                                 1000000000};
+
+/** Writes the digits backwards, ending before end
+ *  \return the first digit
+ */
+template <typename U>
+char* ToDigits(U value, unsigned base, bool upper, char* end)
+{
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char*       p      = end;
+    do
+    {
+        *--p  = digits[value % base];
+        value = value / base;
+    } while(value != 0);
+    return p;
+}
+
+/** 32 bit divisions are a lot cheaper, when the value fits */
+char* ToDigits64(uint64_t value, unsigned base, bool upper, char* end)
+{
+    if(value <= UINT32_MAX)
+        return ToDigits(uint32_t(value), base, upper, end);
+    return ToDigits(value, base, upper, end);
+}
+
+/** Pads the prefix and body to the width */
+void PutField(Writer&     w,
+              const Spec& spec,
+              const char* prefix,
+              size_t      prefix_len,
+              const char* body,
+              size_t      body_len,
+              bool        zero_pad)
+{
+    const int pad = spec.width - int(prefix_len + body_len);
+    if(!spec.left && !zero_pad)
+        w.Pad(' ', pad);
+    w.Put(prefix, prefix_len);
+    if(!spec.left && zero_pad)
+        w.Pad('0', pad);
+    w.Put(body, body_len);
+    if(spec.left)
+        w.Pad(' ', pad);
+}
+
+void PutInteger(Writer&     w,
+                const Spec& spec,
+                uint64_t    value,
+                bool        negative,
+                unsigned    base,
+                bool        upper)
+{
+    char        buf[24];
+    char* const end   = buf + sizeof(buf);
+    char*       first = end;
+    // an explicit precision of 0 prints nothing for 0
+    if(value != 0 || spec.precision != 0)
+        first = ToDigits64(value, base, upper, end);
+    while(end - first < spec.precision && first > buf)
+        *--first = '0';
+    if(spec.alt && base == 8 && (first == end || *first != '0'))
+        *--first = '0';
+
+    char   prefix[2];
+    size_t prefix_len = 0;
+    if(negative)
+        prefix[prefix_len++] = '-';
+    else if(spec.plus)
+        prefix[prefix_len++] = '+';
+    else if(spec.space)
+        prefix[prefix_len++] = ' ';
+    if(spec.alt && base == 16 && value != 0)
+    {
+        prefix[prefix_len++] = '0';
+        prefix[prefix_len++] = upper ? 'X' : 'x';
+    }
+    PutField(w,
+             spec,
+             prefix,
+             prefix_len,
+             first,
+             end - first,
+             spec.zero && spec.precision < 0);
+}
+
+void PutFloat(Writer& w, const Spec& spec, double value, bool upper)
+{
+    char   prefix[1];
+    size_t prefix_len = 0;
+    if(std::signbit(value))
+    {
+        prefix[prefix_len++] = '-';
+        value                = -value;
+    }
+    else if(spec.plus)
+        prefix[prefix_len++] = '+';
+    else if(spec.space)
+        prefix[prefix_len++] = ' ';
+
+    // 2^64, NaN fails every comparison
+    if(!(value < 18446744073709551616.0))
+    {
+        const char* text = value != value ? (upper ? "NAN" : "nan")
+                                          : (upper ? "INF" : "inf");
+        PutField(w, spec, prefix, prefix_len, text, 3, false);
+        return;
+    }
+
+    int precision = spec.precision < 0 ? 6 : spec.precision;
+    if(precision > 9)
+        precision = 9;
+    const uint32_t scale = kPow10[precision];
+    uint64_t       whole = uint64_t(value);
+    uint32_t       frac  = uint32_t((value - double(whole)) * scale + 0.5);
+    if(frac >= scale)
+    {
+        frac -= scale;
+        whole++;
+    }
+
+    // 20 digits, the point and 9 digits
+    char        buf[32];
+    char* const end   = buf + sizeof(buf);
+    char*       first = end;
+    if(precision > 0)
+    {
+        first = ToDigits(frac, 10, false, end);
+        while(end - first < precision)
+            *--first = '0';
+    }
+    if(precision > 0 || spec.alt)
+        *--first = '.';
+    first = ToDigits64(whole, 10, false, first);
+    PutField(w, spec, prefix, prefix_len, first, end - first, spec.zero);
+}
+
+/** Reads a signed integer argument of the length in the spec */
+int64_t GetSigned(const Spec& spec, va_list* va)
+{
+    switch(spec.length)
+    {
+        case 'L': return va_arg(*va, long long);
+        case 'l': return va_arg(*va, long);
+        case 'j': return va_arg(*va, intmax_t);
+        case 'z': return va_arg(*va, ptrdiff_t);
+        case 't': return va_arg(*va, ptrdiff_t);
+        case 'h': return short(va_arg(*va, int));
+        case 'H': return (signed char)(va_arg(*va, int));
+        default: return va_arg(*va, int);
+    }
+}
+
+/** Reads an unsigned integer argument of the length in the spec */
+uint64_t GetUnsigned(const Spec& spec, va_list* va)
+{
+    switch(spec.length)
+    {
+        case 'L': return va_arg(*va, unsigned long long);
+        case 'l': return va_arg(*va, unsigned long);
+        case 'j': return va_arg(*va, uintmax_t);
+        case 'z': return va_arg(*va, size_t);
+        case 't': return va_arg(*va, size_t);
+        case 'h': return (unsigned short)(va_arg(*va, unsigned));
+        case 'H': return (unsigned char)(va_arg(*va, unsigned));
+        default: return va_arg(*va, unsigned);
+    }
+}
+
+/** Parses the spec after the '%', and returns the conversion character */
+const char* ParseSpec(const char* p, Spec& spec, va_list* va)
+{
+    spec = {false, false, false, false, false, 0, -1, 0};
+    for(;; p++)
+    {
+        if(*p == '-')
+            spec.left = true;
+        else if(*p == '+')
+            spec.plus = true;
+        else if(*p == ' ')
+            spec.space = true;
+        else if(*p == '0')
+            spec.zero = true;
+        else if(*p == '#')
+            spec.alt = true;
+        else
+            break;
+    }
+
+    if(*p == '*')
+    {
+        spec.width = va_arg(*va, int);
+        if(spec.width < 0)
+        {
+            spec.left  = true;
+            spec.width = -spec.width;
+        }
+        p++;
+    }
+    else
+    {
+        while(*p >= '0' && *p <= '9')
+            spec.width = spec.width * 10 + (*p++ - '0');
+    }
+
+    if(*p == '.')
+    {
+        p++;
+        spec.precision = 0;
+        if(*p == '*')
+        {
+            spec.precision = va_arg(*va, int);
+            if(spec.precision < 0)
+                spec.precision = -1;
+            p++;
+        }
+        else
+        {
+            while(*p >= '0' && *p <= '9')
+                spec.precision = spec.precision * 10 + (*p++ - '0');
+        }
+    }
+
+    if(*p == 'h' || *p == 'l')
+    {
+        spec.length = *p++;
+        if(*p == spec.length)
+        {
+            spec.length = spec.length == 'h' ? 'H' : 'L';
+            p++;
+        }
+    }
+    else if(*p == 'z' || *p == 'j' || *p == 't')
+        spec.length = *p++;
+    return p;
+}
+} // namespace
+
+size_t AppendFormat(FixedCapStrBase<char>& str, const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    const size_t length = AppendFormatV(str, format, va);
+    va_end(va);
+    return length;
+}
+
+size_t AppendFormatV(FixedCapStrBase<char>& str, const char* format, va_list va)
+{
+    // a copy, so that its address can be passed on
+    va_list args;
+    va_copy(args, va);
+
+    Writer      w(str);
+    const char* p = format;
+    while(*p != '\0')
+    {
+        // plain text up to the next conversion, in one piece
+        const char* text = p;
+        while(*p != '\0' && *p != '%')
+            p++;
+        w.Put(text, p - text);
+        if(*p == '\0')
+            break;
+
+        Spec spec;
+        p = ParseSpec(p + 1, spec, &args);
+        switch(*p)
+        {
+            case 'd':
+            case 'i':
+            {
+                const int64_t value = GetSigned(spec, &args);
+                const uint64_t magnitude
+                    = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+                PutInteger(w, spec, magnitude, value < 0, 10, false);
+                break;
+            }
+            case 'u':
+                PutInteger(w, spec, GetUnsigned(spec, &args), false, 10, false);
+                break;
+            case 'x':
+            case 'X':
+            {
+                const uint64_t value = GetUnsigned(spec, &args);
+                PutInteger(w, spec, value, false, 16, *p == 'X');
+                break;
+            }
+            case 'o':
+                PutInteger(w, spec, GetUnsigned(spec, &args), false, 8, false);
+                break;
+            case 'p':
+            {
+                const uintptr_t value = uintptr_t(va_arg(args, void*));
+                spec.alt              = true;
+                PutInteger(w, spec, value, false, 16, false);
+                break;
+            }
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            {
+                const bool upper = *p == 'F' || *p == 'E' || *p == 'G';
+                PutFloat(w, spec, va_arg(args, double), upper);
+                break;
+            }
+            case 'c':
+            {
+                const char c = char(va_arg(args, int));
+                PutField(w, spec, nullptr, 0, &c, 1, false);
+                break;
+            }
+            case 's':
+            {
+                const char* s = va_arg(args, const char*);
+                if(s == nullptr)
+                    s = "(null)";
+                size_t len = 0;
+                while(s[len] != '\0'
+                      && (spec.precision < 0 || len < size_t(spec.precision)))
+                    len++;
+                PutField(w, spec, nullptr, 0, s, len, false);
+                break;
+            }
+            case '\0': continue;
+            default: w.Put(p, 1); break;
+        }
+        p++;
+    }
+    va_end(args);
+    return w.GetLength();
+}
+
+size_t FormatString(char* buffer, size_t size, const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    const size_t length = FormatStringV(buffer, size, format, va);
+    va_end(va);
+    return length;
+}
+
+size_t FormatStringV(char* buffer, size_t size, const char* format, va_list va)
+{
+    if(size == 0)
+    {
+        // only counts, into a string without room
+        char                  empty[1];
+        FixedCapStrBase<char> str(empty, 0);
+        return AppendFormatV(str, format, va);
+    }
+    buffer[0] = '\0';
+    FixedCapStrBase<char> str(buffer, size - 1);
+    return AppendFormatV(str, format, va);
+}
+
+} // namespace daisy
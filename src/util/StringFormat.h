@@ -0,0 +1,64 @@
+#pragma once
+#ifndef DSY_STRINGFORMAT_H
+#define DSY_STRINGFORMAT_H
+
+#include <cstdarg>
+#include <cstddef>
+#include "util/FixedCapStr.h"
+
+namespace daisy
+{
+/** @addtogroup utility
+    @{
+*/
+
+/** @brief printf-style formatting without the C library's printf
+ *
+ *  The Logger and other text output format with this instead of
+ *  vsnprintf(). It uses a few dozen bytes of stack instead of several
+ *  hundred, links in a fraction of the code, and prints floats without
+ *  linking with `-u _printf_float`.
+ *
+ *  Supported are the flags `-+ 0#`, the width and precision, also as `*`,
+ *  the lengths `hh h l ll z j t`, and the conversions:
+ *  - `d i u x X o` integers, `c` characters, `s` strings, `p` pointers
+ *  - `f F` fixed point, with up to 9 digits after the point, rounded half
+ *    away from 0, so a value that is exactly halfway can differ from printf
+ *    in the last digit. `e E g G` print the same. Values beyond the 64 bit
+ *    integers print as inf.
+ *  - `%%`, anything else is copied to the output as is
+ *
+ *  The output is cut off at the capacity of the string, with the same
+ *  return value as vsnprintf(), so that a cut off message can be detected.
+ *
+ *  \param str string to append to
+ *  \param format printf-style format string
+ *  \return the number of characters of the whole output, including the
+ *          ones that didn't fit
+ */
+size_t AppendFormat(FixedCapStrBase<char>& str, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/** Variadic argument variant of AppendFormat() */
+size_t
+AppendFormatV(FixedCapStrBase<char>& str, const char* format, va_list va);
+
+/** Drop-in for snprintf(), see AppendFormat()
+ *  \param buffer size bytes, always terminated unless size is 0
+ *  \param size size of the buffer
+ *  \param format printf-style format string
+ *  \return the number of characters of the whole output, not counting
+ *          the terminating 0. The output was cut off if this is size or
+ *          more.
+ */
+size_t FormatString(char* buffer, size_t size, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/** Variadic argument variant of FormatString(), a drop-in for vsnprintf() */
+size_t
+FormatStringV(char* buffer, size_t size, const char* format, va_list va);
+
+/** @} */
+} // namespace daisy
+
+#endif
@@ -0,0 +1,315 @@
+#pragma once
+#ifndef DSY_TELEMETRY_H
+#define DSY_TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "sys/system.h"
+#include "util/CpuLoadMeter.h"
+#include "util/Crc32.h"
+
+namespace daisy
+{
+/** @brief Streams named values to a host in compact binary frames
+ *  @addtogroup utility
+ *
+ *  Channels are registered once, each with a name and a variable, or a
+ *  function that returns the value. Process(), called in the main loop,
+ *  samples all of them every period and sends a value frame through a
+ *  Logger, e.g. DaisySeed::Log, or any class with a static
+ *  Write(const void* data, size_t size), for example one that sends over
+ *  a UartHandler. Every descriptor_interval frames a descriptor frame with
+ *  the names and types is sent, so a dashboard can start at any time.
+ *
+ *  Frames are little endian:
+ *  - kMagic, the kind of frame ('D' or 'V'), uint16_t payload size
+ *  - payload
+ *  - uint32_t Crc32() of the kind, size and payload
+ *
+ *  The payload of 'V' is a uint16_t sequence number, the uint32_t time in
+ *  microseconds, and 4 bytes per channel. The payload of 'D' is the
+ *  number of channels, and for each its Type and zero terminated name.
+ *  resources/telemetry_dump.py decodes the frames into CSV.
+ *
+ *  @code
+ *  static Telemetry<> telemetry;
+ *  telemetry.Init(10); // 100 Hz
+ *  telemetry.AddCpuLoad(load_meter);
+ *  telemetry.Add("gain", &gain);
+ *  telemetry.Add("dropped", &dropped_blocks);
+ *  while(1)
+ *      telemetry.Process<DaisySeed::Log>();
+ *  @endcode
+ *
+ *  \tparam max_channels number of channels that can be registered
+ */
+template <size_t max_channels = 16>
+class Telemetry
+{
+  public:
+    /** Type of a channel's value */
+    enum class Type : uint8_t
+    {
+        FLOAT,
+        UINT32,
+        INT32,
+    };
+
+    /** Returns the value of a channel, for values that aren't a variable */
+    typedef float (*GetFunction)(void* context);
+
+    /** First byte of each frame */
+    static constexpr uint8_t kMagic = 0xD6;
+
+    /** Characters of a channel name that are sent */
+    static constexpr size_t kMaxNameLength = 23;
+
+    /** Bytes of the largest frame, the descriptor frame of the full
+     *  table, with room for the value frame header when there's none
+     */
+    static constexpr size_t kMaxFrameSize
+        = 4 + 6 + max_channels * (kMaxNameLength + 2) + 4;
+
+    Telemetry() : period_us_(10000), descriptor_interval_(100) { Clear(); }
+
+    /** Removes all channels, and sets the sending rate
+     *  \param period_ms time between two value frames
+     *  \param descriptor_interval value frames between descriptor frames,
+     *         0 to only send it at the start, and after SendDescriptor()
+     */
+    void Init(uint32_t period_ms = 10, uint32_t descriptor_interval = 100)
+    {
+        period_us_           = period_ms * 1000;
+        descriptor_interval_ = descriptor_interval;
+        Clear();
+    }
+
+    /** Adds a float channel
+     *  \param name name of the channel, the string isn't copied
+     *  \param value variable read at each period, may be changed from
+     *         interrupts
+     *  \return false if the table is full
+     */
+    bool Add(const char* name, const volatile float* value)
+    {
+        return AddChannel(name, Type::FLOAT, value, nullptr, nullptr);
+    }
+
+    /** Adds an unsigned integer channel, e.g. a counter */
+    bool Add(const char* name, const volatile uint32_t* value)
+    {
+        return AddChannel(name, Type::UINT32, value, nullptr, nullptr);
+    }
+
+    /** Adds a signed integer channel */
+    bool Add(const char* name, const volatile int32_t* value)
+    {
+        return AddChannel(name, Type::INT32, value, nullptr, nullptr);
+    }
+
+    /** Adds a float channel that is read with a function */
+    bool Add(const char* name, GetFunction get, void* context)
+    {
+        return AddChannel(name, Type::FLOAT, nullptr, get, context);
+    }
+
+    /** Adds the average, minimum and maximum load of a meter, as
+     *  "cpu_avg", "cpu_min" and "cpu_max"
+     *  \return false if the table is full
+     */
+    bool AddCpuLoad(CpuLoadMeter& meter)
+    {
+        if(num_channels_ + 3 > max_channels)
+            return false;
+        Add("cpu_avg", GetAvgCpuLoad, &meter);
+        Add("cpu_min", GetMinCpuLoad, &meter);
+        Add("cpu_max", GetMaxCpuLoad, &meter);
+        return true;
+    }
+
+    /** Returns the number of registered channels */
+    size_t GetNumChannels() const { return num_channels_; }
+
+    /** Sends the frames that are due, call it in the main loop
+     *  \tparam LoggerType destination, with a static
+     *          Write(const void* data, size_t size)
+     *  \return true if a value frame was sent
+     */
+    template <typename LoggerType>
+    bool Process()
+    {
+        const uint32_t now = System::GetUs();
+        if(started_ && now - last_us_ < period_us_)
+            return false;
+        // the next period starts on time, unless a whole one was missed
+        last_us_ = started_ && now - last_us_ < 2 * period_us_
+                       ? last_us_ + period_us_
+                       : now;
+        started_ = true;
+
+        if(frames_to_descriptor_ == 0)
+        {
+            LoggerType::Write(frame_, BuildDescriptor());
+            frames_to_descriptor_
+                = descriptor_interval_ > 0 ? descriptor_interval_ : UINT32_MAX;
+        }
+        if(descriptor_interval_ > 0)
+            frames_to_descriptor_--;
+
+        LoggerType::Write(frame_, BuildValues(now));
+        return true;
+    }
+
+    /** Sends the descriptor frame with the next Process() */
+    void SendDescriptor() { frames_to_descriptor_ = 0; }
+
+    /** Builds the descriptor frame in the internal buffer
+     *  \return the size of the frame
+     */
+    size_t BuildDescriptor()
+    {
+        uint8_t* p = &frame_[4];
+        *p++       = uint8_t(num_channels_);
+        for(size_t i = 0; i < num_channels_; i++)
+        {
+            *p++ = uint8_t(channels_[i].type);
+            const size_t len = strnlen(channels_[i].name, kMaxNameLength);
+            memcpy(p, channels_[i].name, len);
+            p += len;
+            *p++ = 0;
+        }
+        return FinishFrame('D', p - &frame_[4]);
+    }
+
+    /** Builds a value frame with the current values in the internal buffer
+     *  \param time_us time of the values
+     *  \return the size of the frame
+     */
+    size_t BuildValues(uint32_t time_us)
+    {
+        uint8_t* p = &frame_[4];
+        PutU16(p, sequence_++);
+        PutU32(p + 2, time_us);
+        p += 6;
+        for(size_t i = 0; i < num_channels_; i++, p += 4)
+            PutU32(p, Sample(channels_[i]));
+        return FinishFrame('V', p - &frame_[4]);
+    }
+
+    /** Returns the frame built last */
+    const uint8_t* GetFrame() const { return frame_; }
+
+  private:
+    struct Channel
+    {
+        const char*          name;
+        Type                 type;
+        const volatile void* value;
+        GetFunction          get;
+        void*                context;
+    };
+
+    void Clear()
+    {
+        num_channels_         = 0;
+        sequence_             = 0;
+        started_              = false;
+        frames_to_descriptor_ = 0;
+    }
+
+    bool AddChannel(const char*          name,
+                    Type                 type,
+                    const volatile void* value,
+                    GetFunction          get,
+                    void*                context)
+    {
+        if(num_channels_ >= max_channels)
+            return false;
+        channels_[num_channels_++] = {name, type, value, get, context};
+        // the dashboard needs the new layout before the next values
+        frames_to_descriptor_ = 0;
+        return true;
+    }
+
+    static uint32_t Sample(const Channel& channel)
+    {
+        if(channel.get != nullptr)
+            return FloatBits(channel.get(channel.context));
+        switch(channel.type)
+        {
+            case Type::FLOAT:
+                return FloatBits(
+                    *static_cast<const volatile float*>(channel.value));
+            case Type::INT32:
+                return uint32_t(
+                    *static_cast<const volatile int32_t*>(channel.value));
+            default:
+                return *static_cast<const volatile uint32_t*>(channel.value);
+        }
+    }
+
+    size_t FinishFrame(uint8_t kind, size_t payload)
+    {
+        frame_[0] = kMagic;
+        frame_[1] = kind;
+        PutU16(&frame_[2], uint16_t(payload));
+        PutU32(&frame_[4 + payload], Crc32(&frame_[1], 3 + payload));
+        return 4 + payload + 4;
+    }
+
+    static uint32_t FloatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static void PutU16(uint8_t* p, uint16_t value)
+    {
+        p[0] = value & 0xff;
+        p[1] = value >> 8;
+    }
+
+    static void PutU32(uint8_t* p, uint32_t value)
+    {
+        PutU16(p, value & 0xffff);
+        PutU16(p + 2, value >> 16);
+    }
+
+    static float GetAvgCpuLoad(void* meter)
+    {
+        return static_cast<CpuLoadMeter*>(meter)->GetAvgCpuLoad();
+    }
+    static float GetMinCpuLoad(void* meter)
+    {
+        return static_cast<CpuLoadMeter*>(meter)->GetMinCpuLoad();
+    }
+    static float GetMaxCpuLoad(void* meter)
+    {
+        return static_cast<CpuLoadMeter*>(meter)->GetMaxCpuLoad();
+    }
+
+    Channel  channels_[max_channels];
+    size_t   num_channels_;
+    uint32_t period_us_;
+    uint32_t descriptor_interval_;
+    uint32_t frames_to_descriptor_;
+    uint32_t last_us_;
+    bool     started_;
+    uint16_t sequence_;
+    uint8_t  frame_[kMaxFrameSize];
+};
+
+template <size_t max_channels>
+constexpr uint8_t Telemetry<max_channels>::kMagic;
+
+template <size_t max_channels>
+constexpr size_t Telemetry<max_channels>::kMaxNameLength;
+
+template <size_t max_channels>
+constexpr size_t Telemetry<max_channels>::kMaxFrameSize;
+
+} // namespace daisy
+
+#endif
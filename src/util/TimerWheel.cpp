@@ -0,0 +1,160 @@
+#include "util/TimerWheel.h"
+
+using namespace daisy;
+
+constexpr size_t   TimerWheel::kNumSlots;
+constexpr uint32_t TimerWheel::kSlotUs;
+constexpr uint8_t  TimerWheel::kOverflow;
+
+namespace
+{
+/** True if time a is before time b, across the wrap of the 32 bits */
+inline bool IsBefore(uint32_t a, uint32_t b)
+{
+    return int32_t(a - b) < 0;
+}
+} // namespace
+
+void TimerWheel::Init(uint32_t now_us)
+{
+    Clear();
+    current_ = now_us;
+    pos_     = 0;
+}
+
+void TimerWheel::Schedule(Timer&   timer,
+                          uint32_t deadline_us,
+                          uint32_t period_us)
+{
+    Cancel(timer);
+    timer.deadline_ = deadline_us;
+    timer.period_   = period_us;
+    Insert(timer);
+}
+
+bool TimerWheel::Cancel(Timer& timer)
+{
+    if(!timer.IsActive())
+        return false;
+    if(timer.slot_ == kOverflow)
+        return overflow_.Remove(timer);
+
+    IntrusiveList<Timer>& slot = slots_[timer.slot_];
+    if(!slot.Remove(timer))
+        return false;
+    if(slot.IsEmpty())
+        used_slots_ &= ~(1u << timer.slot_);
+    return true;
+}
+
+void TimerWheel::Clear()
+{
+    for(auto& slot : slots_)
+        slot.Clear();
+    overflow_.Clear();
+    used_slots_ = 0;
+}
+
+size_t TimerWheel::GetNumActive() const
+{
+    size_t num = overflow_.GetNumElements();
+    for(const auto& slot : slots_)
+        num += slot.GetNumElements();
+    return num;
+}
+
+void TimerWheel::Insert(Timer& timer)
+{
+    // deadlines that are over go to the current slot
+    const uint32_t offset
+        = IsBefore(timer.deadline_, current_)
+              ? 0
+              : (timer.deadline_ - current_) >> DSY_TIMER_WHEEL_SLOT_SHIFT;
+    if(offset >= kNumSlots)
+    {
+        timer.slot_ = kOverflow;
+        overflow_.PushBack(timer);
+        return;
+    }
+
+    const uint32_t        idx  = (pos_ + offset) % kNumSlots;
+    IntrusiveList<Timer>& slot = slots_[idx];
+    timer.slot_                = uint8_t(idx);
+    used_slots_ |= 1u << idx;
+
+    // sorted by deadline, the ones with the same deadline in the order
+    // they were scheduled
+    Timer* prev = slot.Back();
+    while(prev != nullptr && IsBefore(timer.deadline_, prev->deadline_))
+        prev = IntrusiveList<Timer>::Prev(*prev);
+    if(prev != nullptr)
+        slot.InsertAfter(*prev, timer);
+    else
+        slot.PushFront(timer);
+}
+
+void TimerWheel::Advance(uint32_t slots)
+{
+    current_ += slots << DSY_TIMER_WHEEL_SLOT_SHIFT;
+    pos_ = (pos_ + slots) % kNumSlots;
+    if(pos_ != 0)
+        return;
+
+    // once per turn, the waiting timers that are now within the wheel
+    // move to their slots, the others go back to the list
+    for(size_t n = overflow_.GetNumElements(); n > 0; n--)
+        Insert(*overflow_.PopFront());
+}
+
+size_t TimerWheel::Process(uint32_t now_us)
+{
+    size_t fired = 0;
+    while(true)
+    {
+        IntrusiveList<Timer>& slot = slots_[pos_];
+        while(slot.Front() != nullptr
+              && !IsBefore(now_us, slot.Front()->deadline_))
+        {
+            Timer& timer = *slot.PopFront();
+            if(slot.IsEmpty())
+                used_slots_ &= ~(1u << pos_);
+
+            // scheduled again before the callback, so it can cancel it
+            if(timer.period_ > 0)
+            {
+                timer.deadline_ += timer.period_;
+                if(!IsBefore(now_us, timer.deadline_))
+                {
+                    const uint32_t missed
+                        = (now_us - timer.deadline_) / timer.period_ + 1;
+                    timer.deadline_ += missed * timer.period_;
+                }
+                Insert(timer);
+            }
+            if(timer.callback_ != nullptr)
+                timer.callback_(timer.context_);
+            fired++;
+        }
+
+        // on to the next slot with timers, or to the end of the turn
+        // when timers wait to be sorted in, without passing now
+        if(IsBefore(now_us, current_))
+            break;
+        uint32_t skip = (now_us - current_) >> DSY_TIMER_WHEEL_SLOT_SHIFT;
+        if(skip == 0)
+            break;
+        if(!overflow_.IsEmpty() && skip > kNumSlots - pos_)
+            skip = kNumSlots - pos_;
+        if(used_slots_ != 0)
+        {
+            const uint32_t ahead
+                = (used_slots_ >> pos_)
+                  | (used_slots_ << ((kNumSlots - pos_) % kNumSlots));
+            const uint32_t next = ahead & 1u ? 1 : __builtin_ctz(ahead);
+            if(skip > next)
+                skip = next;
+        }
+        Advance(skip);
+    }
+    return fired;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef DSY_TIMERWHEEL_H
+#define DSY_TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "util/IntrusiveList.h"
+
+/** log2 of the time in us that one slot of a TimerWheel covers */
+#ifndef DSY_TIMER_WHEEL_SLOT_SHIFT
+#define DSY_TIMER_WHEEL_SLOT_SHIFT 10
+#endif
+
+namespace daisy
+{
+/** @brief Any number of one-shot and periodic timers, from one time base
+ *  @addtogroup utility
+ *
+ *  The timers are owned by the caller and linked into the wheel, so there
+ *  is no limit to their number and nothing is allocated. The wheel has 32
+ *  slots of 2^DSY_TIMER_WHEEL_SLOT_SHIFT us each (1.024ms by default),
+ *  and a timer goes to the slot of its deadline, in order, so Process()
+ *  only looks at the front of the current slot. Timers beyond the 32
+ *  slots wait in a separate list and are sorted into the slots once per
+ *  turn of the wheel. Scheduling a timer costs a walk through the timers
+ *  of its slot, cancelling it costs nothing.
+ *
+ *  The times are in us and wrap around at 32 bits, so deadlines must be
+ *  within 2^31 us, about 35 minutes, of the time passed to Process().
+ *  TimerService runs a wheel from a hardware timer. Not interrupt safe.
+ *
+ *  @code
+ *  TimerWheel        wheel;
+ *  TimerWheel::Timer blink(ToggleLed, nullptr);
+ *
+ *  wheel.Init(now);
+ *  wheel.Schedule(blink, now + 500000, 500000);
+ *  // every now and then
+ *  wheel.Process(now);
+ *  @endcode
+ */
+class TimerWheel
+{
+  public:
+    /** Called when a timer expires */
+    typedef void (*Callback)(void* context);
+
+    /** A timer, owned by the caller. It must stay in place while it's
+     *  scheduled.
+     */
+    class Timer : public IntrusiveListNode<Timer>
+    {
+      public:
+        Timer()
+        : callback_(nullptr),
+          context_(nullptr),
+          deadline_(0),
+          period_(0),
+          slot_(0)
+        {
+        }
+
+        Timer(Callback callback, void* context) : Timer()
+        {
+            SetCallback(callback, context);
+        }
+
+        /** Sets the function called when the timer expires. Set it before
+         *  the timer is scheduled.
+         */
+        void SetCallback(Callback callback, void* context = nullptr)
+        {
+            callback_ = callback;
+            context_  = context;
+        }
+
+        /** Returns true while the timer is scheduled */
+        bool IsActive() const { return IsLinked(); }
+
+        /** Returns the time in us the timer expires next */
+        uint32_t GetDeadline() const { return deadline_; }
+
+        /** Returns the period in us, 0 for a one-shot timer */
+        uint32_t GetPeriod() const { return period_; }
+
+      private:
+        friend class TimerWheel;
+
+        Callback callback_;
+        void*    context_;
+        uint32_t deadline_;
+        uint32_t period_;
+        uint8_t  slot_;
+    };
+
+    /** Number of slots */
+    static constexpr size_t kNumSlots = 32;
+
+    /** Time in us one slot covers */
+    static constexpr uint32_t kSlotUs = 1u << DSY_TIMER_WHEEL_SLOT_SHIFT;
+
+    TimerWheel() : current_(0), pos_(0), used_slots_(0) {}
+    ~TimerWheel() { Clear(); }
+
+    /** Cancels all timers and starts the time at now_us */
+    void Init(uint32_t now_us);
+
+    /** Schedules a timer, or reschedules it if it's already scheduled
+     *  \param timer timer to schedule
+     *  \param deadline_us time to expire. A time that's already over
+     *         expires with the next Process(), or the running one when
+     *         it's scheduled from a callback.
+     *  \param period_us time between the later expiries, or 0 for a
+     *         one-shot timer
+     */
+    void Schedule(Timer& timer, uint32_t deadline_us, uint32_t period_us = 0);
+
+    /** Cancels a timer
+     *  \returns false if it wasn't scheduled
+     */
+    bool Cancel(Timer& timer);
+
+    /** Cancels all timers */
+    void Clear();
+
+    /** Calls the callbacks of the timers that expired, in the order of
+     *  their deadlines, and schedules the periodic ones again. Periods
+     *  that are already over are skipped. Callbacks can schedule and
+     *  cancel timers, also their own.
+     *  \param now_us the current time
+     *  \returns the number of callbacks called
+     */
+    size_t Process(uint32_t now_us);
+
+    /** Returns the number of scheduled timers */
+    size_t GetNumActive() const;
+
+  private:
+    /** Slot of the timers beyond the slots of the wheel */
+    static constexpr uint8_t kOverflow = 0xff;
+
+    void Insert(Timer& timer);
+    void Advance(uint32_t slots);
+
+    IntrusiveList<Timer> slots_[kNumSlots];
+    IntrusiveList<Timer> overflow_;
+    uint32_t             current_;    // start of the current slot
+    uint32_t             pos_;        // index of the current slot
+    uint32_t             used_slots_; // a bit per slot with timers
+};
+
+} // namespace daisy
+
+#endif
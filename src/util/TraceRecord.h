@@ -0,0 +1,124 @@
+#pragma once
+#ifndef DSY_TRACERECORD_H
+#define DSY_TRACERECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace daisy
+{
+/** @brief Binary log record with a format string that's decoded on the host
+ *  @addtogroup utility
+ *
+ *  Instead of formatting a message, the record stores the address of its
+ *  format string, which stays in flash, and the arguments as raw 32 bit
+ *  words. That takes a few dozen cycles, also in the audio callback, and
+ *  resources/decode_trace.py formats the records on the host, with the
+ *  format strings read from the program's .elf file.
+ *
+ *  The record is a sequence of little endian words:
+ *  - header: kMagic in the low byte, the number of arguments in the next
+ *    one, and a 16 bit sequence number in the high half, to spot dropped
+ *    records
+ *  - timestamp, e.g. System::GetTick()
+ *  - address of the format string
+ *  - one word per argument: integers are truncated to 32 bits, floating
+ *    point values stored as float, and pointers (%s of string literals
+ *    and %p) as their address
+ *
+ *  kMagic isn't an ASCII character, so the records can be mixed with
+ *  text on the same stream.
+ *
+ *  \tparam num_args number of arguments
+ */
+template <size_t num_args>
+class TraceRecord
+{
+    static_assert(num_args < 256, "too many arguments for a trace record");
+
+  public:
+    /** First byte of each record */
+    static constexpr uint8_t kMagic = 0xD5;
+
+    /** Words before the arguments */
+    static constexpr size_t kHeaderWords = 3;
+
+    /** Fills in the record
+     *  \param format format string, must be a literal, or else live at
+     *         least as long as the program
+     *  \param sequence sequence number of the record
+     *  \param timestamp time of the record
+     *  \param args num_args values
+     */
+    template <typename... Args>
+    void Encode(const char* format,
+                uint16_t    sequence,
+                uint32_t    timestamp,
+                Args... args)
+    {
+        static_assert(sizeof...(Args) == num_args,
+                      "wrong number of arguments for the trace record");
+        words_[0] = kMagic | (uint32_t(num_args) << 8)
+                    | (uint32_t(sequence) << 16);
+        words_[1] = timestamp;
+        words_[2] = uint32_t(reinterpret_cast<uintptr_t>(format));
+
+        // the extra 0 keeps the array from being empty
+        const uint32_t values[] = {ToWord(args)..., 0};
+        for(size_t i = 0; i < num_args; i++)
+            words_[kHeaderWords + i] = values[i];
+    }
+
+    /** Returns the record */
+    const void* GetData() const { return words_; }
+
+    /** Returns the size of the record in bytes */
+    static constexpr size_t GetSize()
+    {
+        return sizeof(uint32_t) * (kHeaderWords + num_args);
+    }
+
+    /** Returns a word of the record */
+    uint32_t GetWord(size_t idx) const { return words_[idx]; }
+
+  private:
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value
+                                       || std::is_enum<T>::value,
+                                   uint32_t>::type
+    ToWord(T value)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value,
+                                   uint32_t>::type
+    ToWord(T value)
+    {
+        const float f = static_cast<float>(value);
+        uint32_t    word;
+        memcpy(&word, &f, sizeof(word));
+        return word;
+    }
+
+    template <typename T>
+    static uint32_t ToWord(const T* value)
+    {
+        return uint32_t(reinterpret_cast<uintptr_t>(value));
+    }
+
+    uint32_t words_[kHeaderWords + num_args];
+};
+
+template <size_t num_args>
+constexpr uint8_t TraceRecord<num_args>::kMagic;
+
+template <size_t num_args>
+constexpr size_t TraceRecord<num_args>::kHeaderWords;
+
+} // namespace daisy
+
+#endif
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include "util/FastMath.h"
+
 namespace daisy
 {
 /** @brief Helper class for calibrating an input to 1V/oct response 
@@ -14,11 +17,26 @@ namespace daisy
  * 
  *  This can also be used for 100mV/Semitone calibration as used by Buchla synthesizer 
  *  modules. To calibrate for this standard. You would send 1.2V, and 3.6V
+ *
+ *  ProcessInputToFrequency() goes straight to the frequency in Hz, for
+ *  oscillators that track the input at audio rate. It folds the
+ *  calibration into the exponent of an approximation of 2^x, see
+ *  fastpow2f_order(), instead of calling powf() on the note number. The
+ *  accuracy is set in cents with SetPitchAccuracy().
  */
 class VoctCalibration
 {
   public:
-    VoctCalibration() : scale_(0.f), offset_(0.f), cal_(false) {}
+    VoctCalibration()
+    : scale_(0.f),
+      offset_(0.f),
+      cal_(false),
+      a4_frequency_(440.f),
+      order_(4),
+      exp_scale_(0.f),
+      exp_offset_(-69.f / 12.f)
+    {
+    }
 
     ~VoctCalibration() {}
 
@@ -42,6 +60,7 @@ class VoctCalibration
         scale_      = 24.f / delta;
         offset_     = 12.f - scale_ * val1V;
         cal_        = true;
+        UpdateExponent();
         return cal_;
     }
 
@@ -64,6 +83,7 @@ class VoctCalibration
         scale_  = scale;
         offset_ = offset;
         cal_    = true;
+        UpdateExponent();
     }
 
     /** Process a value through the calibrated data to get a MIDI Note number */
@@ -72,9 +92,76 @@ class VoctCalibration
         return offset_ + (scale_ * inval);
     }
 
+    /** Sets the frequency of MIDI note 69, 440Hz by default */
+    void SetTuning(float a4_frequency) { a4_frequency_ = a4_frequency; }
+
+    /** Sets the largest error of ProcessInputToFrequency() that is fine,
+     *  as an interval in cents. The cheapest approximation within it is
+     *  used, each step down saves a multiply-add: 3 cents and more get the
+     *  2nd order polynomial, 0.13 cents and more the 3rd order, anything
+     *  smaller the 4th order with 0.005 cents, the default.
+     */
+    void SetPitchAccuracy(float max_error_cents)
+    {
+        if(max_error_cents >= 3.f)
+            order_ = 2;
+        else if(max_error_cents >= 0.13f)
+            order_ = 3;
+        else
+            order_ = 4;
+    }
+
+    /** Process a value through the calibrated data to get a frequency in Hz,
+     *  like mtof() of ProcessInput(), without powf()
+     */
+    inline float ProcessInputToFrequency(const float inval) const
+    {
+        const float x = exp_offset_ + exp_scale_ * inval;
+        switch(order_)
+        {
+            case 2: return a4_frequency_ * fastpow2f_order<2>(x);
+            case 3: return a4_frequency_ * fastpow2f_order<3>(x);
+            default: return a4_frequency_ * fastpow2f_order<4>(x);
+        }
+    }
+
+    /** ProcessInputToFrequency() of a block of values, e.g. from an audio
+     *  input, with the choice of approximation outside of the loop
+     */
+    void
+    ProcessInputToFrequency(const float* in, float* out, size_t size) const
+    {
+        switch(order_)
+        {
+            case 2: ProcessBlock<2>(in, out, size); break;
+            case 3: ProcessBlock<3>(in, out, size); break;
+            default: ProcessBlock<4>(in, out, size); break;
+        }
+    }
+
   private:
+    /** Note to exponent of 2 relative to A4, in octaves */
+    void UpdateExponent()
+    {
+        exp_scale_  = scale_ / 12.f;
+        exp_offset_ = (offset_ - 69.f) / 12.f;
+    }
+
+    template <int order>
+    void ProcessBlock(const float* in, float* out, size_t size) const
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            const float x = exp_offset_ + exp_scale_ * in[i];
+            out[i]        = a4_frequency_ * fastpow2f_order<order>(x);
+        }
+    }
+
     float scale_, offset_;
     bool  cal_;
+    float a4_frequency_;
+    int   order_;
+    float exp_scale_, exp_offset_;
 };
 
 } // namespace daisy
\ No newline at end of file
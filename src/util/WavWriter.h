@@ -1,5 +1,7 @@
 #pragma once
 #pragma once
+#include <atomic>
+#include <cstring>
 #include "fatfs.h"
 
 namespace daisy
@@ -11,8 +13,30 @@ namespace daisy
  ** Recordings are made with floating point input, and will be converted to the 
  ** specified bits per sample internally 
  **
- ** For now only 16-bit and 32-bit (signed int) formats are supported
- ** f32 and s24 formats will be added next
+ ** 16-bit, 24-bit (packed) and 32-bit signed int, and 32-bit float formats
+ ** are supported (Config::format). For 24-bit and float recordings, Sample()
+ ** only stores the floats, and the conversion to packed 24-bit happens in
+ ** Write(), outside of the audio callback.
+ **
+ ** Any number of channels can be recorded. Each transfer of the working buffer
+ ** holds whole frames, so for channel counts that don't divide the transfer
+ ** size, the transfers are a little shorter.
+ **
+ ** To avoid the delays of allocating clusters while recording, the file can
+ ** be preallocated as one contiguous block (Config::prealloc_seconds).
+ ** Recordings longer than that continue to grow the file as usual.
+ ** With Config::header_update_seconds, the header is rewritten while
+ ** recording, so a recording that is cut off by a power loss is a valid file
+ ** up to the last header update.
+ **
+ ** Sample() and Write() hand the audio over through a lock-free ring of
+ ** transfers: the audio callback fills one transfer after the other, and
+ ** the main loop writes all of the completed ones to the card. By default
+ ** the ring is made of the 2 internal transfers. To ride out longer stalls
+ ** of the card, a larger ring can be passed in Config::buffer, e.g. in
+ ** SDRAM (1 MB of 16-bit stereo at 48kHz holds about 5 seconds).
+ ** When the ring is full, the incoming frames are dropped, and counted
+ ** in GetDroppedFrames() and GetOverflowCount().
  **
  ** The transfer size determines the amount of internal memory used, and can have an
  ** effect on the performance of the streaming behavior of the WavWriter.
@@ -50,17 +74,24 @@ class WavWriter
         float   samplerate;
         int32_t channels;
         int32_t bitspersample;
-    };
-
-    /** State of the internal Writing mechanism. 
-     ** When the buffer is a certain amount full one section will write its contents
-     ** while the other is still being written to. This is performed circularly
-     ** so that audio will be uninterrupted during writing. */
-    enum class BufferState
-    {
-        IDLE,
-        FLUSH0,
-        FLUSH1,
+        /** WAVE_FORMAT_PCM, or WAVE_FORMAT_IEEE_FLOAT with 32 bits per
+         ** sample */
+        uint16_t format = WAVE_FORMAT_PCM;
+        /** length to allocate contiguously when opening, 0 to not
+         ** preallocate. Needs _USE_EXPAND in ffconf.h.
+         */
+        float prealloc_seconds = 0.0f;
+        /** time between header updates while recording, 0 to only write
+         ** the header in SaveFile()
+         */
+        float header_update_seconds = 0.0f;
+        /** optional memory for the ring of transfers, e.g. in SDRAM.
+         ** It's divided into transfers of transfer_size bytes, and has to
+         ** hold at least 2 of them. nullptr uses the internal buffer.
+         */
+        void *buffer = nullptr;
+        /** size of buffer in bytes */
+        size_t buffer_size = 0;
     };
 
     /**  Initializes the WavFile header, and prepares the object for recording. */
@@ -74,7 +105,7 @@ class WavWriter
         wavheader_.FileFormat    = kWavFileWaveId;      /** "WAVE" */
         wavheader_.SubChunk1ID   = kWavFileSubChunk1Id; /** "fmt " */
         wavheader_.SubChunk1Size = 16;                  // for PCM
-        wavheader_.AudioFormat   = WAVE_FORMAT_PCM;
+        wavheader_.AudioFormat   = cfg.format;
         wavheader_.NbrChannels   = cfg.channels;
         wavheader_.SampleRate    = static_cast<int>(cfg.samplerate);
         wavheader_.ByteRate      = CalcByteRate();
@@ -82,16 +113,55 @@ class WavWriter
         wavheader_.BitPerSample  = cfg_.bitspersample;
         wavheader_.SubChunk2ID   = kWavFileSubChunk2Id; /** "data" */
         /** Also calcs SubChunk2Size */
-        wavheader_.FileSize = CalcFileSize();
+        wavheader_.FileSize = CalcFileSize(0);
         // This is calculated as part of the subchunk size
+
+        // the transfers hold whole frames, of the format stored by Sample()
+        const size_t bytes_per_samp
+            = cfg_.bitspersample == 16 ? sizeof(int16_t) : sizeof(float);
+        half_samps_
+            = (transfer_size / bytes_per_samp / cfg_.channels) * cfg_.channels;
+        const float transfers_per_second
+            = cfg_.samplerate * cfg_.channels / float(half_samps_);
+        header_interval_
+            = uint32_t(cfg_.header_update_seconds * transfers_per_second);
+        if(cfg_.header_update_seconds > 0.0f && header_interval_ == 0)
+            header_interval_ = 1;
+
+        if(cfg_.buffer != nullptr && cfg_.buffer_size >= 2 * transfer_size)
+        {
+            ring_       = static_cast<uint8_t *>(cfg_.buffer);
+            num_blocks_ = cfg_.buffer_size / transfer_size;
+        }
+        else
+        {
+            ring_       = reinterpret_cast<uint8_t *>(transfer_buff);
+            num_blocks_ = 2;
+        }
+        ResetRing();
+        recording_ = false;
     }
 
     /** Records the current sample into the working buffer,
      ** queues writes to media when necessary. 
+     ** Meant to be called from the audio callback, frames are ignored
+     ** while not recording, and dropped while the ring is full.
      ** 
      ** \param in should be a pointer to an array of samples */
     void Sample(const float *in)
     {
+        if(!recording_)
+            return;
+        // the transfer to be filled wasn't written yet
+        if(filled_ - flushed_ >= num_blocks_)
+        {
+            if(!overflowing_)
+                overflows_++;
+            overflowing_ = true;
+            dropped_frames_++;
+            return;
+        }
+        overflowing_ = false;
         for(size_t i = 0; i < cfg_.channels; i++)
         {
             switch(cfg_.bitspersample)
@@ -99,53 +169,83 @@ class WavWriter
                 case 16:
                 {
                     int16_t *tp;
-                    tp            = (int16_t *)transfer_buff;
+                    tp            = (int16_t *)fill_block_;
                     tp[wptr_ + i] = f2s16(in[i]);
                 }
                 break;
-                case 32: transfer_buff[wptr_ + i] = f2s32(in[i]); break;
+                case 24:
+                {
+                    // packed in Write()
+                    float *tp;
+                    tp            = (float *)fill_block_;
+                    tp[wptr_ + i] = in[i];
+                }
+                break;
+                case 32:
+                {
+                    if(cfg_.format == WAVE_FORMAT_IEEE_FLOAT)
+                    {
+                        float *tp;
+                        tp            = (float *)fill_block_;
+                        tp[wptr_ + i] = in[i];
+                    }
+                    else
+                    {
+                        int32_t *tp;
+                        tp            = (int32_t *)fill_block_;
+                        tp[wptr_ + i] = f2s32(in[i]);
+                    }
+                }
+                break;
                 default: break;
             }
         }
         num_samps_++;
         wptr_ += cfg_.channels;
-        size_t cap_point
-            = cfg_.bitspersample == 16 ? kTransferSamps * 2 : kTransferSamps;
-        if(wptr_ == cap_point)
-        {
-            bstate_ = BufferState::FLUSH0;
-        }
-        if(wptr_ >= cap_point * 2)
+        if(wptr_ >= half_samps_)
         {
+            // publish the transfer after its samples
+            std::atomic_signal_fence(std::memory_order_release);
+            filled_ = filled_ + 1;
             wptr_   = 0;
-            bstate_ = BufferState::FLUSH1;
+            fill_block_ = ring_ + (filled_ % num_blocks_) * transfer_size;
+            const uint32_t queued = filled_ - flushed_;
+            if(queued > max_queued_)
+                max_queued_ = queued;
         }
     }
 
-    /** Check buffer state and write */
+    /** Writes all completed transfers to the file.
+     ** Meant to be called from the main loop. */
     void Write()
     {
-        if(bstate_ != BufferState::IDLE && IsRecording())
+        if(!IsRecording())
+            return;
+        while(FlushBlock())
         {
-            uint32_t     offset;
-            unsigned int bw = 0;
-            //offset          = bstate_ == BufferState::FLUSH0 ? 0 : transfer_size;
-            offset  = bstate_ == BufferState::FLUSH0 ? 0 : kTransferSamps;
-            bstate_ = BufferState::IDLE;
-            f_write(&fp_, &transfer_buff[offset], transfer_size, &bw);
+            if(header_interval_ > 0 && ++transfers_ >= header_interval_)
+            {
+                transfers_ = 0;
+                UpdateHeader();
+            }
         }
     }
 
     /** Finalizes the writing of the WAV file.
-     ** This overwrites the WAV Header with the correct
-     ** final size, and closes the fptr. */
+     ** This writes whatever is left in the working buffer, overwrites the
+     ** WAV Header with the correct final size, and closes the fptr. */
     void SaveFile()
     {
         unsigned int bw = 0;
         recording_      = false;
-        // We _should_ flush whatever's left in the transfer buff
-        // TODO: that.
-        wavheader_.FileSize = CalcFileSize();
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        // the transfers that weren't written yet, before the partial one
+        while(FlushBlock()) {}
+        WriteSamples(fill_block_, wptr_);
+
+        wavheader_.FileSize = CalcFileSize(num_samps_);
+        // cut off the unused part of a preallocated file
+        f_truncate(&fp_);
         f_lseek(&fp_, 0);
         f_write(&fp_, &wavheader_, sizeof(wavheader_), &bw);
         f_close(&fp_);
@@ -157,10 +257,26 @@ class WavWriter
         if(f_open(&fp_, name, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK)
         {
             unsigned int bw = 0;
+#if _USE_EXPAND
+            if(cfg_.prealloc_seconds > 0.0f)
+            {
+                // falls back to growing the file, if there is no contiguous
+                // space of that size
+                const FSIZE_t size
+                    = sizeof(wavheader_)
+                      + FSIZE_t(cfg_.prealloc_seconds * CalcByteRate());
+                f_expand(&fp_, size, 1);
+            }
+#endif
+            wavheader_.FileSize = CalcFileSize(0);
             if(f_write(&fp_, &wavheader_, sizeof(wavheader_), &bw) == FR_OK)
             {
-                recording_ = true;
                 num_samps_ = 0;
+                written_   = 0;
+                transfers_ = 0;
+                ResetRing();
+                std::atomic_signal_fence(std::memory_order_release);
+                recording_ = true;
             }
         }
     }
@@ -177,15 +293,128 @@ class WavWriter
         return (float)num_samps_ / (float)cfg_.samplerate;
     }
 
+    /** Returns the number of frames that were dropped, because the ring
+     ** was full, since the file was opened. */
+    inline uint32_t GetDroppedFrames() const { return dropped_frames_; }
+
+    /** Returns how often the ring ran full since the file was opened.
+     ** Each run of consecutive dropped frames counts as one overflow. */
+    inline uint32_t GetOverflowCount() const { return overflows_; }
+
+    /** Returns the number of transfers the ring can hold */
+    inline size_t GetBufferDepth() const { return num_blocks_; }
+
+    /** Returns the number of completed transfers waiting to be written */
+    inline size_t GetBufferedTransfers() const { return filled_ - flushed_; }
+
+    /** Returns the highest number of completed transfers that were waiting
+     ** at once since the file was opened. Reaching GetBufferDepth() means
+     ** the ring ran full. */
+    inline size_t GetMaxBufferedTransfers() const { return max_queued_; }
+
   private:
-    /** Calculate the file size based on current recording */
-    inline uint32_t CalcFileSize()
+    /** Calculate the file size for a number of recorded frames */
+    inline uint32_t CalcFileSize(uint32_t frames)
     {
         wavheader_.SubCHunk2Size
-            = num_samps_ * cfg_.channels * cfg_.bitspersample / 8;
+            = frames * cfg_.channels * cfg_.bitspersample / 8;
         return 36 + wavheader_.SubCHunk2Size;
     }
 
+    /** Writes count samples of a transfer of the ring */
+    void WriteSamples(uint8_t *block, size_t count)
+    {
+        if(count == 0)
+            return;
+        unsigned int bw  = 0;
+        const size_t bps = cfg_.bitspersample / 8;
+        if(cfg_.bitspersample == 24)
+            PackS24(block, count);
+        f_write(&fp_, block, count * bps, &bw);
+        written_ += count / cfg_.channels;
+    }
+
+    /** Converts count floats to packed 24-bit samples in place.
+     ** The output is smaller than the input, so each sample is read
+     ** before it's overwritten.
+     */
+    static void PackS24(uint8_t *data, size_t count)
+    {
+        const uint8_t *src = data;
+        uint8_t       *dst = data;
+        size_t         i   = 0;
+        // 4 samples into 3 words at a time
+        for(; i + 4 <= count; i += 4)
+        {
+            float x[4];
+            memcpy(x, src, sizeof(x));
+            const uint32_t s0 = f2s24(x[0]);
+            const uint32_t s1 = f2s24(x[1]);
+            const uint32_t s2 = f2s24(x[2]);
+            const uint32_t s3 = f2s24(x[3]);
+            const uint32_t w[3]
+                = {(s0 & 0xffffff) | (s1 << 24),
+                   ((s1 >> 8) & 0xffff) | (s2 << 16),
+                   ((s2 >> 16) & 0xff) | (s3 << 8)};
+            memcpy(dst, w, sizeof(w));
+            src += sizeof(x);
+            dst += sizeof(w);
+        }
+        for(; i < count; i++)
+        {
+            float x;
+            memcpy(&x, src, sizeof(x));
+            const int32_t s = f2s24(x);
+            dst[0]          = s;
+            dst[1]          = s >> 8;
+            dst[2]          = s >> 16;
+            src += sizeof(x);
+            dst += 3;
+        }
+    }
+
+    /** Writes the oldest completed transfer, and hands it back to Sample().
+     ** \returns false if there was none */
+    bool FlushBlock()
+    {
+        const uint32_t flushed = flushed_;
+        if(filled_ == flushed)
+            return false;
+        // read the samples only after seeing the transfer
+        std::atomic_signal_fence(std::memory_order_acquire);
+        WriteSamples(ring_ + (flushed % num_blocks_) * transfer_size,
+                     half_samps_);
+        std::atomic_signal_fence(std::memory_order_release);
+        flushed_ = flushed + 1;
+        return true;
+    }
+
+    /** Empties the ring, and clears its statistics */
+    void ResetRing()
+    {
+        wptr_           = 0;
+        filled_         = 0;
+        flushed_        = 0;
+        fill_block_     = ring_;
+        max_queued_     = 0;
+        dropped_frames_ = 0;
+        overflows_      = 0;
+        overflowing_    = false;
+    }
+
+    /** Rewrites the header with the frames written so far, and syncs the
+     ** file, so that the recording is readable after a power loss. */
+    void UpdateHeader()
+    {
+        unsigned int  bw  = 0;
+        const FSIZE_t pos = f_tell(&fp_);
+        wavheader_.FileSize = CalcFileSize(written_);
+        f_lseek(&fp_, 0);
+        f_write(&fp_, &wavheader_, sizeof(wavheader_), &bw);
+        f_lseek(&fp_, pos);
+        f_sync(&fp_);
+    }
+
     /** Compute the byte rate given the user settings. */
     inline uint32_t CalcByteRate()
     {
@@ -196,10 +425,21 @@ class WavWriter
 
     WAV_FormatTypeDef wavheader_;
     uint32_t          num_samps_, wptr_;
+    uint32_t          half_samps_; // samples per transfer
+    uint32_t          written_;    // frames written to the file
+    uint32_t          header_interval_, transfers_;
     Config            cfg_;
     int32_t           transfer_buff[kTransferSamps * 2];
-    BufferState       bstate_;
-    bool              recording_;
+    uint8_t          *ring_;       // transfer_buff, or Config::buffer
+    uint8_t          *fill_block_; // transfer being filled by Sample()
+    size_t            num_blocks_; // transfers in the ring
+
+    // free running transfer counts, filled_ is only written by Sample(),
+    // flushed_ only by Write()
+    volatile uint32_t filled_, flushed_;
+    volatile uint32_t max_queued_, dropped_frames_, overflows_;
+    bool              overflowing_;
+    volatile bool     recording_;
     FIL               fp_;
 };
 
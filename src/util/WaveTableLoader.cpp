@@ -1,13 +1,63 @@
 #include "WaveTableLoader.h"
 #include "daisy_core.h"
+#include <cmath>
+#include <utility>
 namespace daisy
 {
+namespace
+{
+/** In place radix-2 FFT of n complex values, stored as re, im pairs.
+ ** The inverse transform isn't scaled by 1 / n. */
+void Fft(float *data, size_t n, bool inverse)
+{
+    for(size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+        {
+            std::swap(data[2 * i], data[2 * j]);
+            std::swap(data[2 * i + 1], data[2 * j + 1]);
+        }
+    }
+    for(size_t len = 2; len <= n; len <<= 1)
+    {
+        // the twiddle factors are rotated in double, to keep the error of
+        // the recurrence small for long tables
+        const double angle  = (inverse ? 2.0 : -2.0) * 3.14159265358979 / len;
+        const double step_r = cos(angle), step_i = sin(angle);
+        double       w_r = 1.0, w_i = 0.0;
+        for(size_t j = 0; j < len / 2; j++)
+        {
+            const float wr = float(w_r), wi = float(w_i);
+            for(size_t i = j; i < n; i += len)
+            {
+                float *     a  = &data[2 * i];
+                float *     b  = &data[2 * (i + len / 2)];
+                const float tr = wr * b[0] - wi * b[1];
+                const float ti = wr * b[1] + wi * b[0];
+                b[0]           = a[0] - tr;
+                b[1]           = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+            const double t = w_r;
+            w_r            = w_r * step_r - w_i * step_i;
+            w_i            = t * step_i + w_i * step_r;
+        }
+    }
+}
+} // namespace
+
 void WaveTableLoader::Init(float *mem, size_t mem_size)
 {
     buf_             = mem;
     buf_size_        = mem_size;
     samps_per_table_ = 256;
     num_tables_      = 1;
+    num_levels_      = 1;
 }
 
 WaveTableLoader::Result WaveTableLoader::SetWaveTableInfo(size_t samps,
@@ -17,54 +67,111 @@ WaveTableLoader::Result WaveTableLoader::SetWaveTableInfo(size_t samps,
         return Result::ERR_TABLE_INFO_OVERFLOW;
     samps_per_table_ = samps;
     num_tables_      = count;
+    num_levels_      = 1;
     return Result::OK;
 }
 
 WaveTableLoader::Result WaveTableLoader::Import(const char *filename)
 {
-    if(f_open(&fp_, filename, FA_READ | FA_OPEN_EXISTING) == FR_OK)
+    Result res = BeginImport(filename);
+    while(res == Result::IN_PROGRESS)
+        res = ContinueImport();
+    return res;
+}
+
+WaveTableLoader::Result
+WaveTableLoader::BeginImport(const char *                filename,
+                             ProgressCallbackFunctionPtr callback,
+                             void *                      context)
+{
+    if(importing_)
+        EndImport();
+    if(f_open(&fp_, filename, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+        return Result::ERR_FILE_READ;
+
+    WavFileInfo info;
+    if(!WavReadFileInfo(&fp_, info)
+       || f_lseek(&fp_, info.data_offset) != FR_OK)
     {
-        // First Grab the Wave header info
-        unsigned int br;
-        f_read(&fp_, &header_, sizeof(header_), &br);
-        uint32_t wptr = 0;
-        do
-        {
-            f_read(&fp_, workspace, kWorkspaceSize * sizeof(workspace[0]), &br);
-            // Fill mem
-            switch(header_.BitPerSample)
-            {
-                case 16:
-                {
-                    int16_t *wsp;
-                    wsp = (int16_t *)workspace;
-                    for(size_t i = 0; i < kWorkspaceSize * 2; i++)
-                    {
-                        buf_[wptr] = s162f(wsp[i]);
-                        wptr++;
-                    }
-                }
-                break;
-                case 32:
-                {
-                    float *wsp;
-                    wsp = (float *)workspace;
-                    for(size_t i = 0; i < kWorkspaceSize; i++)
-                    {
-                        buf_[wptr] = wsp[i];
-                    }
-                }
-                break;
-                default: break;
-            }
-        } while(!f_eof(&fp_) || wptr <= buf_size_ - 1);
         f_close(&fp_);
+        return Result::ERR_FILE_READ;
+    }
+    header_  = info.raw_data;
+    convert_ = info.data_offset > 0 ? WavGetConvertFunction(info) : nullptr;
+    if(convert_ == nullptr)
+    {
+        f_close(&fp_);
+        return Result::ERR_FORMAT;
+    }
+
+    // all channels are loaded as one interleaved stream
+    sample_bytes_     = header_.BitPerSample / 8;
+    total_            = info.data_size / sample_bytes_;
+    total_            = total_ < buf_size_ ? total_ : buf_size_;
+    loaded_           = 0;
+    carry_            = 0;
+    callback_         = callback;
+    callback_context_ = context;
+    importing_        = true;
+    return Result::IN_PROGRESS;
+}
+
+WaveTableLoader::Result WaveTableLoader::ContinueImport()
+{
+    if(!importing_)
+        return Result::OK;
+    if(loaded_ >= total_)
+    {
+        EndImport();
+        return Result::OK;
     }
-    else
+
+    // Read to the next sector boundary at most a workspace away, so that
+    // all but the first read go straight from the card to the workspace.
+    // The read starts at the same alignment as the file position, so that
+    // the sectors in it are word aligned for the DMA.
+    const FSIZE_t pos   = f_tell(&fp_);
+    const size_t  align = size_t(pos % 4);
+    FSIZE_t end = (pos + sizeof(workspace) - sizeof(workspace[0]) - align)
+                  / 512 * 512;
+    const FSIZE_t data_end = pos + (total_ - loaded_) * sample_bytes_ - carry_;
+    end = end < data_end ? end : data_end;
+
+    uint8_t *    dst = reinterpret_cast<uint8_t *>(workspace) + 4 + align;
+    unsigned int br  = 0;
+    if(f_read(&fp_, dst, size_t(end - pos), &br) != FR_OK || br == 0)
     {
+        EndImport();
         return Result::ERR_FILE_READ;
     }
-    return Result::OK;
+
+    // put the partial sample from the previous chunk in front
+    dst -= carry_;
+    for(size_t i = 0; i < carry_; i++)
+        dst[i] = carry_bytes_[i];
+    const size_t bytes = carry_ + br;
+    const size_t samps = bytes / sample_bytes_;
+    convert_(dst, sample_bytes_, &buf_[loaded_], samps);
+    loaded_ += samps;
+    carry_ = bytes - samps * sample_bytes_;
+    for(size_t i = 0; i < carry_; i++)
+        carry_bytes_[i] = dst[samps * sample_bytes_ + i];
+
+    if(callback_)
+        callback_(callback_context_, loaded_, total_);
+
+    if(loaded_ >= total_ || f_eof(&fp_))
+    {
+        EndImport();
+        return Result::OK;
+    }
+    return Result::IN_PROGRESS;
+}
+
+void WaveTableLoader::EndImport()
+{
+    f_close(&fp_);
+    importing_ = false;
 }
 
 /** Returns pointer to specific table start or nullptr if invalid idx */
@@ -72,4 +179,61 @@ float *WaveTableLoader::GetTable(size_t idx)
 {
     return idx < num_tables_ ? &buf_[idx * samps_per_table_] : nullptr;
 }
+
+float *WaveTableLoader::GetTable(size_t idx, size_t level)
+{
+    if(idx >= num_tables_ || level >= num_levels_)
+        return nullptr;
+    return &buf_[(level * num_tables_ + idx) * samps_per_table_];
+}
+
+WaveTableLoader::Result WaveTableLoader::BuildMipLevels(size_t num_levels)
+{
+    const size_t n = samps_per_table_;
+    if(n < 2 || (n & (n - 1)) != 0 || num_levels < 1
+       || (n >> num_levels) == 0)
+        return Result::ERR_GENERIC;
+    if((num_levels * num_tables_ + 4) * n > buf_size_)
+        return Result::ERR_TABLE_INFO_OVERFLOW;
+    num_levels_ = num_levels;
+
+    // spectrum of the table, and the one being cut down for a level
+    float *spectrum = &buf_[num_levels * num_tables_ * n];
+    float *work     = spectrum + 2 * n;
+    for(size_t t = 0; t < num_tables_; t++)
+    {
+        const float *table = GetTable(t);
+        for(size_t i = 0; i < n; i++)
+        {
+            spectrum[2 * i]     = table[i];
+            spectrum[2 * i + 1] = 0.0f;
+        }
+        Fft(spectrum, n, false);
+
+        for(size_t level = 1; level < num_levels; level++)
+        {
+            // keep DC and the lowest harmonics, and their mirror images
+            const size_t harmonics = (n / 2) >> level;
+            for(size_t i = 0; i < 2 * n; i++)
+                work[i] = 0.0f;
+            for(size_t k = 0; k <= harmonics; k++)
+            {
+                work[2 * k]     = spectrum[2 * k];
+                work[2 * k + 1] = spectrum[2 * k + 1];
+            }
+            for(size_t k = n - harmonics; k < n; k++)
+            {
+                work[2 * k]     = spectrum[2 * k];
+                work[2 * k + 1] = spectrum[2 * k + 1];
+            }
+            Fft(work, n, true);
+
+            float *     dst   = GetTable(t, level);
+            const float scale = 1.0f / n;
+            for(size_t i = 0; i < n; i++)
+                dst[i] = work[2 * i] * scale;
+        }
+    }
+    return Result::OK;
+}
 } // namespace daisy
@@ -1,6 +1,7 @@
 #pragma once
 #include "fatfs.h"
 #include "util/wav_format.h"
+#include "hid/wavplayer.h"
 namespace daisy
 {
 /** Loads a bank of wavetables into memory. 
@@ -9,6 +10,14 @@ namespace daisy
  ** it's imported. 
  **
  ** A internal 4kB workspace is used for reading from the file, and conveting to the correct memory location. 
+ **
+ ** Large banks can be imported incrementally, so the main loop keeps
+ ** running in between:
+ ** \code
+ ** loader.BeginImport("bank.wav", OnProgress, &ui);
+ ** while(loader.ContinueImport() == WaveTableLoader::Result::IN_PROGRESS)
+ **     ui.Process();
+ ** \endcode
  ** */
 class WaveTableLoader
 {
@@ -19,7 +28,19 @@ class WaveTableLoader
         ERR_TABLE_INFO_OVERFLOW,
         ERR_FILE_READ,
         ERR_GENERIC,
+        ERR_FORMAT,
+        IN_PROGRESS,
     };
+
+    /** Called after each imported chunk
+     ** \param context the pointer passed to BeginImport()
+     ** \param loaded number of samples imported so far
+     ** \param total number of samples that will be imported
+     */
+    typedef void (*ProgressCallbackFunctionPtr)(void * context,
+                                               size_t loaded,
+                                               size_t total);
+
     WaveTableLoader() {}
     ~WaveTableLoader() {}
 
@@ -34,24 +55,104 @@ class WaveTableLoader
      ** And the wavheader data will be stored internally to the class, 
      ** but will not be stored in the user-provided buffer.
      **
-     ** Currently only 16-bit and 32-bit data is supported.
+     ** 16, 24 and 32-bit PCM, and 32-bit float data is supported.
      ** The importer also assumes data is mono so stereo data will be loaded as-is 
      ** (i.e. interleaved)
+     ** Loading stops when the memory passed to Init() is full.
      ** */
     Result Import(const char *filename);
 
+    /** Opens a file for an incremental import with ContinueImport().
+     ** \param callback optional, called after each imported chunk
+     ** \param context passed to the callback
+     ** \return OK, ERR_FILE_READ or ERR_FORMAT
+     */
+    Result BeginImport(const char *               filename,
+                       ProgressCallbackFunctionPtr callback = nullptr,
+                       void *                     context  = nullptr);
+
+    /** Imports the next chunk (up to 4kB of the file) of an import started
+     ** with BeginImport(), and closes the file after the last one.
+     ** \return IN_PROGRESS while there is more to import, OK when done,
+     **         or ERR_FILE_READ
+     */
+    Result ContinueImport();
+
+    /** Returns whether an import started with BeginImport() is unfinished */
+    bool IsImporting() const { return importing_; }
+
+    /** Returns the imported fraction of the current import (0 to 1) */
+    float GetImportProgress() const
+    {
+        return total_ > 0 ? float(loaded_) / float(total_) : 1.0f;
+    }
+
     /** Returns pointer to specific table start or nullptr if invalid idx */
     float *GetTable(size_t idx);
 
+    /** Builds band-limited copies of all tables, to play them back at
+     ** higher pitches without aliasing. Level 0 is the table itself, each
+     ** following level keeps half of the harmonics of the previous one,
+     ** down to the lowest (samps / 2) >> level harmonics.
+     ** The levels have the same length as the tables, and are stored after
+     ** them. Building them needs memory for (num_levels * count + 4) * samps
+     ** floats, the last 4 * samps are used as workspace.
+     ** \param num_levels number of levels including level 0, up to
+     **        log2(samps)
+     ** \return OK, ERR_TABLE_INFO_OVERFLOW if the memory is too small, or
+     **         ERR_GENERIC if samps is not a power of 2
+     */
+    Result BuildMipLevels(size_t num_levels);
+
+    /** Returns pointer to a level of a table built by BuildMipLevels(),
+     ** or nullptr if invalid idx or level */
+    float *GetTable(size_t idx, size_t level);
+
+    /** Returns the number of levels, 1 if BuildMipLevels() wasn't called */
+    size_t GetNumMipLevels() const { return num_levels_; }
+
+    /** Returns the level with the most harmonics that are all below
+     ** Nyquist when the table is played at freq.
+     ** \param freq playback frequency in cycles per sample (Hz / samplerate)
+     */
+    size_t GetMipLevel(float freq) const
+    {
+        size_t level = 0;
+        float  top   = (samps_per_table_ / 2) * freq;
+        // the highest harmonic above Nyquist
+        while(top > 0.5f && level + 1 < num_levels_)
+        {
+            top *= 0.5f;
+            level++;
+        }
+        return level;
+    }
+
   private:
+    /** Stops the current import and closes the file */
+    void EndImport();
+
     static constexpr int kWorkspaceSize = 1024;
     float *              buf_;
     size_t               buf_size_;
     WAV_FormatTypeDef    header_;
     size_t               samps_per_table_;
     size_t               num_tables_;
-    int32_t              workspace[kWorkspaceSize];
-    FIL                  fp_;
+    size_t               num_levels_;
+    // the samples are read one word into the workspace, so that the partial
+    // sample from the end of the previous chunk fits in front of them
+    int32_t workspace[kWorkspaceSize + 1];
+
+    // incremental import
+    WavConvertFunction          convert_;
+    ProgressCallbackFunctionPtr callback_;
+    void *                      callback_context_;
+    size_t                      sample_bytes_;
+    size_t                      loaded_, total_; // in samples
+    size_t                      carry_;          // bytes of a partial sample
+    uint8_t                     carry_bytes_[4];
+    bool                        importing_ = false;
+    FIL                         fp_;
 };
 
 } // namespace daisy
@@ -0,0 +1,250 @@
+#pragma once
+#ifndef DSY_WORKQUEUE_H
+#define DSY_WORKQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sys/system.h"
+
+namespace daisy
+{
+/** @brief Defers work from interrupts to the main loop
+ *  @addtogroup utility
+ *
+ *  A fixed capacity queue of function calls (function pointer + context).
+ *  Interrupt handlers Post() to it, and the main loop, or a low priority
+ *  handler, calls Process() to run what was posted, outside of interrupt
+ *  context. That way DMA and driver callbacks, e.g. transfer complete
+ *  handlers of the UART, SPI, LedDriverPca9685 or MAX11300, only post
+ *  and return.
+ *
+ *  Post() is lock-free and doesn't disable interrupts: several handlers,
+ *  also ones that preempt each other, can post at the same time. There's
+ *  one consumer, Process() must not be called from two places at once.
+ *  A posting handler that is preempted while it writes its slot holds up
+ *  the calls after it until it continues, they are never lost.
+ *
+ *  A notify function can be set, which is called after each Post(), e.g.
+ *  to Scheduler::Trigger() the task that calls Process().
+ *
+ *  Statistics: the deepest the queue has been, the number of posts that
+ *  failed because it was full, and the time from Post() to the call, in
+ *  CPU cycles.
+ *
+ *  @code
+ *  static WorkQueue<16> work;
+ *
+ *  void TxDone(void* context, SpiHandle::Result result)
+ *  {
+ *      work.Post(StartNextTransfer, context);
+ *  }
+ *
+ *  while(1)
+ *      work.Process();
+ *  @endcode
+ *
+ *  \tparam capacity number of calls that can be queued, a power of two
+ */
+template <size_t capacity>
+class WorkQueue
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+  public:
+    /** A deferred call */
+    typedef void (*WorkFunction)(void* context);
+
+    /** Called after each Post() */
+    typedef void (*NotifyFunction)(void* context);
+
+    /** Measurements of the queue */
+    struct Stats
+    {
+        uint32_t posted;        /**< calls posted */
+        uint32_t processed;     /**< calls made by Process() */
+        uint32_t dropped;       /**< posts that failed, queue full */
+        uint32_t max_depth;     /**< largest number of queued calls */
+        uint32_t max_latency;   /**< longest time from post to call */
+        uint64_t total_latency; /**< sum of the times from post to call */
+    };
+
+    WorkQueue() { Init(); }
+
+    /** Empties the queue, clears the statistics and the notify function.
+     *  Not to be called while interrupts may post.
+     */
+    void Init()
+    {
+        for(size_t i = 0; i < capacity; i++)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+        tail_           = 0;
+        notify_         = nullptr;
+        notify_context_ = nullptr;
+        ResetStats();
+    }
+
+    /** Sets a function that's called after each successful Post(), from
+     *  the posting context.
+     */
+    void SetNotify(NotifyFunction notify, void* context = nullptr)
+    {
+        notify_context_ = context;
+        notify_         = notify;
+    }
+
+    /** Queues a call, from any context.
+     *  \return false if the queue is full or there's no function
+     */
+    bool Post(WorkFunction function, void* context = nullptr)
+    {
+        if(function == nullptr)
+            return false;
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        Slot*    slot;
+        while(true)
+        {
+            slot               = &slots_[pos & (capacity - 1)];
+            const uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+            const int32_t diff = int32_t(seq - pos);
+            if(diff == 0)
+            {
+                // the slot is free, claim it
+                if(head_.compare_exchange_weak(
+                       pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                // another handler claimed it first
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->function = function;
+        slot->context  = context;
+        slot->posted   = System::GetCycleCount();
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        // depth when this call was added, the consumer may lag behind
+        const uint32_t depth = pos + 1 - tail_;
+        uint32_t       max   = max_depth_.load(std::memory_order_relaxed);
+        while(depth > max
+              && !max_depth_.compare_exchange_weak(
+                  max, depth, std::memory_order_relaxed))
+        {
+        }
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        const NotifyFunction notify = notify_;
+        if(notify != nullptr)
+            notify(notify_context_);
+        return true;
+    }
+
+    /** Makes the queued calls, in the order they were posted, from the
+     *  main loop or one low priority handler.
+     *  \param max_calls the most calls to make, 0 for all that are queued
+     *  \return the number of calls made
+     */
+    size_t Process(size_t max_calls = 0)
+    {
+        size_t calls = 0;
+        while(max_calls == 0 || calls < max_calls)
+        {
+            const uint32_t pos  = tail_;
+            Slot&          slot = slots_[pos & (capacity - 1)];
+            if(slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                break;
+            const WorkFunction function = slot.function;
+            void* const        context  = slot.context;
+            const uint32_t     latency  = System::GetCycleCount() - slot.posted;
+            // free the slot before the call, which may post again. The tail
+            // moves first, so a Post() that sees the free slot never counts
+            // it twice in the depth.
+            tail_ = pos + 1;
+            slot.sequence.store(pos + capacity, std::memory_order_release);
+
+            if(latency > max_latency_)
+                max_latency_ = latency;
+            total_latency_ += latency;
+            processed_++;
+            function(context);
+            calls++;
+        }
+        return calls;
+    }
+
+    /** Returns true if no calls are waiting */
+    bool IsEmpty() const
+    {
+        return slots_[tail_ & (capacity - 1)].sequence.load(
+                   std::memory_order_acquire)
+               != tail_ + 1;
+    }
+
+    /** Returns the number of calls that can be queued */
+    static constexpr size_t GetCapacity() { return capacity; }
+
+    /** Returns the statistics */
+    Stats GetStats() const
+    {
+        Stats s;
+        s.posted        = posted_.load(std::memory_order_relaxed);
+        s.processed     = processed_;
+        s.dropped       = dropped_.load(std::memory_order_relaxed);
+        s.max_depth     = max_depth_.load(std::memory_order_relaxed);
+        s.max_latency   = max_latency_;
+        s.total_latency = total_latency_;
+        return s;
+    }
+
+    /** Clears the statistics, from the consumer */
+    void ResetStats()
+    {
+        posted_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+        max_depth_.store(0, std::memory_order_relaxed);
+        processed_     = 0;
+        max_latency_   = 0;
+        total_latency_ = 0;
+    }
+
+  private:
+    /** The sequence is the position the slot can be written at, and one
+     *  more once it's written. */
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        WorkFunction          function;
+        void*                 context;
+        uint32_t              posted;
+    };
+
+    Slot                  slots_[capacity];
+    std::atomic<uint32_t> head_;
+    volatile uint32_t     tail_;
+
+    NotifyFunction volatile notify_;
+    void* volatile          notify_context_;
+
+    std::atomic<uint32_t> posted_;
+    std::atomic<uint32_t> dropped_;
+    std::atomic<uint32_t> max_depth_;
+    uint32_t              processed_;
+    uint32_t              max_latency_;
+    uint64_t              total_latency_;
+
+    WorkQueue(const WorkQueue&) = delete;
+    WorkQueue& operator=(const WorkQueue&) = delete;
+};
+
+} // namespace daisy
+
+#endif
@@ -39,6 +39,11 @@ uint8_t BSP_SD_Init(void)
             sd_state = MSD_ERROR;
         }
     }
+    /* Pick the bus speed, when SdmmcHandler::Speed::AUTO is used */
+    if(sd_state == MSD_OK)
+    {
+        sd_state = BSP_SD_SelectSpeed();
+    }
 
     return sd_state;
 }
@@ -52,6 +52,11 @@ typedef struct
 // Functions internal for diskIO
 uint8_t BSP_SD_Init(void);     /**< \return card state, ERROR, etc.*/
 uint8_t BSP_SD_ITConfig(void); /**< \return card state, ERROR, etc. */
+/** Tests the card at increasing bus speeds when SdmmcHandler::Speed::AUTO
+    is used, implemented in per/sdmmc.cpp
+    \return OK, or ERROR when the card can't be read at any speed
+*/
+uint8_t BSP_SD_SelectSpeed(void);
 
 /** \param  *pData &
     \param  ReadAddr Address to read from
@@ -19,6 +19,145 @@ namespace daisy
     @{
 */
 
+/** @brief Color in 8 bit integers, the format of the LED strips
+ *
+ *  For animating many LEDs without floats: use HsvToRgb8(), Blend() and
+ *  Gamma8() per pixel, and pass the result to Ws2812 or DotStar, or
+ *  Gamma12() of the channels to LedDriverPca9685::SetLedRaw().
+ */
+struct Rgb8
+{
+    uint8_t red;   /**< & */
+    uint8_t green; /**< & */
+    uint8_t blue;  /**< & */
+
+    /** \return the color as 0x00RRGGBB */
+    constexpr uint32_t Packed() const
+    {
+        return (uint32_t(red) << 16) | (uint32_t(green) << 8) | blue;
+    }
+};
+
+/** \return a * b / 255, rounded, so that 255 is the identity */
+constexpr uint8_t Scale8(uint8_t a, uint8_t b)
+{
+    return uint8_t((uint32_t(a) * b + 128 + ((uint32_t(a) * b + 128) >> 8))
+                   >> 8);
+}
+
+/** Converts a hue, saturation and value to RGB with integer math
+ *  \param hue 0 to 65535 for the whole circle, starting and ending at red
+ *  \param saturation 0 for white to 255 for the pure hue
+ *  \param value brightness, 0 to 255
+ */
+inline Rgb8
+HsvToRgb8(uint16_t hue, uint8_t saturation = 255, uint8_t value = 255)
+{
+    auto channel = [saturation, value](uint8_t c) {
+        return Scale8(255 - Scale8(255 - c, saturation), value);
+    };
+    // 6 sectors of 256 steps between red, yellow, green, cyan, blue, magenta
+    const uint32_t h    = (uint32_t(hue) * 1536) >> 16;
+    const uint8_t  up   = uint8_t(h & 0xff);
+    const uint8_t  down = 255 - up;
+    switch(h >> 8)
+    {
+        case 0: return {channel(255), channel(up), channel(0)};
+        case 1: return {channel(down), channel(255), channel(0)};
+        case 2: return {channel(0), channel(255), channel(up)};
+        case 3: return {channel(0), channel(down), channel(255)};
+        case 4: return {channel(up), channel(0), channel(255)};
+        default: return {channel(255), channel(0), channel(down)};
+    }
+}
+
+/** Fades between two colors
+ *  \param amount 0 for a, 255 for b
+ */
+inline Rgb8 Blend(const Rgb8& a, const Rgb8& b, uint8_t amount)
+{
+    auto mix = [amount](uint8_t x, uint8_t y) {
+        return uint8_t(int32_t(x) + (int32_t(y) - x) * amount / 255);
+    };
+    return {mix(a.red, b.red), mix(a.green, b.green), mix(a.blue, b.blue)};
+}
+
+/** \return the color scaled by brightness / 255 */
+inline Rgb8 Scale(const Rgb8& color, uint8_t brightness)
+{
+    return {Scale8(color.red, brightness),
+            Scale8(color.green, brightness),
+            Scale8(color.blue, brightness)};
+}
+
+/** Gamma correction of an 8 bit value to the 12 bit PWM of the
+ *  LedDriverPca9685, from a constexpr table
+ */
+inline uint16_t Gamma12(uint8_t value)
+{
+    static constexpr uint16_t table[256] = {
+        0,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        2,    2,    2,    2,    2,    2,    2,    3,    3,    4,    4,    5,
+        5,    6,    7,    8,    8,    9,    10,   11,   12,   13,   15,   16,
+        17,   18,   20,   21,   23,   25,   26,   28,   30,   32,   34,   36,
+        38,   40,   43,   45,   48,   50,   53,   56,   59,   62,   65,   68,
+        71,   75,   78,   82,   85,   89,   93,   97,   101,  105,  110,  114,
+        119,  123,  128,  133,  138,  143,  149,  154,  159,  165,  171,  177,
+        183,  189,  195,  202,  208,  215,  222,  229,  236,  243,  250,  258,
+        266,  273,  281,  290,  298,  306,  315,  324,  332,  341,  351,  360,
+        369,  379,  389,  399,  409,  419,  430,  440,  451,  462,  473,  485,
+        496,  508,  520,  532,  544,  556,  569,  582,  594,  608,  621,  634,
+        648,  662,  676,  690,  704,  719,  734,  749,  764,  779,  795,  811,
+        827,  843,  859,  876,  893,  910,  927,  944,  962,  980,  998,  1016,
+        1034, 1053, 1072, 1091, 1110, 1130, 1150, 1170, 1190, 1210, 1231, 1252,
+        1273, 1294, 1316, 1338, 1360, 1382, 1404, 1427, 1450, 1473, 1497, 1520,
+        1544, 1568, 1593, 1617, 1642, 1667, 1693, 1718, 1744, 1770, 1797, 1823,
+        1850, 1877, 1905, 1932, 1960, 1988, 2017, 2045, 2074, 2103, 2133, 2162,
+        2192, 2223, 2253, 2284, 2315, 2346, 2378, 2410, 2442, 2474, 2507, 2540,
+        2573, 2606, 2640, 2674, 2708, 2743, 2778, 2813, 2849, 2884, 2920, 2957,
+        2993, 3030, 3067, 3105, 3143, 3181, 3219, 3258, 3297, 3336, 3376, 3416,
+        3456, 3496, 3537, 3578, 3619, 3661, 3703, 3745, 3788, 3831, 3874, 3918,
+        3962, 4006, 4050, 4095};
+    return table[value];
+}
+
+/** Gamma correction of an 8 bit value to 8 bit, for LED strips. The same
+ *  curve as Gamma12(), rounded to 8 bits.
+ */
+inline uint8_t Gamma8(uint8_t value)
+{
+    static constexpr uint8_t table[256] = {
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   1,   1,
+        1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+        2,   2,   3,   3,   3,   3,   3,   3,   4,   4,   4,   4,
+        4,   5,   5,   5,   5,   6,   6,   6,   6,   7,   7,   7,
+        7,   8,   8,   8,   9,   9,   9,   10,  10,  10,  11,  11,
+        11,  12,  12,  13,  13,  13,  14,  14,  15,  15,  16,  16,
+        17,  17,  17,  18,  19,  19,  20,  20,  21,  21,  22,  22,
+        23,  24,  24,  25,  25,  26,  27,  27,  28,  29,  29,  30,
+        31,  32,  32,  33,  34,  35,  35,  36,  37,  38,  39,  39,
+        40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,
+        51,  52,  53,  55,  56,  57,  58,  59,  60,  61,  62,  63,
+        64,  66,  67,  68,  69,  70,  72,  73,  74,  75,  77,  78,
+        79,  81,  82,  83,  85,  86,  87,  89,  90,  92,  93,  95,
+        96,  98,  99,  101, 102, 104, 105, 107, 109, 110, 112, 114,
+        115, 117, 119, 120, 122, 124, 126, 127, 129, 131, 133, 135,
+        136, 138, 140, 142, 144, 146, 148, 150, 152, 154, 156, 158,
+        160, 162, 164, 167, 169, 171, 173, 175, 177, 180, 182, 184,
+        186, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+        215, 218, 220, 223, 225, 228, 231, 233, 236, 239, 241, 244,
+        247, 249, 252, 255};
+    return table[value];
+}
+
+/** Gamma8() of each channel of a color */
+inline Rgb8 Gamma8(const Rgb8& color)
+{
+    return {Gamma8(color.red), Gamma8(color.green), Gamma8(color.blue)};
+}
+
 /** Class for handling simple colors */
 class Color
 {
@@ -66,6 +205,14 @@ class Color
     inline uint8_t Green8() const { return green_ * 255; }
     inline uint8_t Blue8() const { return blue_ * 255; }
 
+    /** Returns the color in 8 bit integers, rounded */
+    inline Rgb8 ToRgb8() const
+    {
+        return {uint8_t(red_ * 255.f + 0.5f),
+                uint8_t(green_ * 255.f + 0.5f),
+                uint8_t(blue_ * 255.f + 0.5f)};
+    }
+
     /** Returns a scaled color by a float */
     Color operator*(float scale)
     {
@@ -27,5 +27,24 @@ extern FontDef Font_7x10;  /**< & */
 extern FontDef Font_11x18; /**< & */
 extern FontDef Font_16x26; /**< & */
 
+/** Font stored in the page format of the SSD130x memory: each glyph is
+    FontWidth column bytes per band of 8 lines, band after band, the top
+    line of a band in the LSB. Drawn a byte at a time by
+    OneBitGraphicsDisplayImpl::WriteChar(). Generated from the FontDefs by
+    resources/make_page_fonts.py.
+*/
+typedef struct
+{
+    const uint8_t  FontWidth;  /*!< Font width in pixels */
+    uint8_t        FontHeight; /*!< Font height in pixels */
+    const uint8_t *data;       /*!< Glyphs from ' ' to '~' */
+} PageFontDef;
+
+/** The FontDefs above, in the page format */
+extern PageFontDef Font_6x8_Pages;
+extern PageFontDef Font_7x10_Pages;  /**< & */
+extern PageFontDef Font_11x18_Pages; /**< & */
+extern PageFontDef Font_16x26_Pages; /**< & */
+
 #endif
 /** @} */
@@ -0,0 +1,186 @@
+#pragma once
+#ifndef DSY_PIXEL_FORMAT_H
+#define DSY_PIXEL_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/** @brief Pixel formats of framebuffers and images
+ *  @addtogroup utility
+ *
+ *  Colours are passed around as 32 bit 0xAARRGGBB values, and converted
+ *  to the format of a buffer when a pixel is written. The first five
+ *  formats are the ones of the DMA2D, RGB565_SWAPPED is written by it but
+ *  not read, A8 is read but not written, and L4 is left to the CPU.
+ */
+enum class PixelFormat : uint8_t
+{
+    ARGB8888,       /**< 32 bits, 0xAARRGGBB */
+    RGB888,         /**< 24 bits, in memory blue, green, red */
+    RGB565,         /**< 16 bits, little endian */
+    ARGB1555,       /**< 16 bits, 1 bit alpha */
+    ARGB4444,       /**< 16 bits, 4 bit alpha */
+    RGB565_SWAPPED, /**< RGB565 big endian, how most SPI TFTs take it */
+    A8,             /**< 8 bit alpha mask, drawn in one colour */
+    L4,             /**< 4 bit grey, 2 per byte, the first in the high bits */
+};
+
+/** A rectangle of pixels in memory. The lines follow each other. Images
+ *  in flash can be wrapped by casting away the const, they're only read.
+ */
+struct PixelBuffer
+{
+    void*       data;   /**< the first pixel */
+    PixelFormat format; /**< & */
+    uint16_t    width;  /**< pixels per line */
+    uint16_t    height; /**< number of lines */
+};
+
+/** Returns the size of a pixel in bits */
+inline size_t GetBitsPerPixel(PixelFormat format)
+{
+    switch(format)
+    {
+        case PixelFormat::ARGB8888: return 32;
+        case PixelFormat::RGB888: return 24;
+        case PixelFormat::A8: return 8;
+        case PixelFormat::L4: return 4;
+        default: return 16;
+    }
+}
+
+/** Returns the bytes of a buffer. Lines of L4 of an odd width share
+ *  their last byte with the next line.
+ */
+inline size_t
+GetPixelBufferSize(uint16_t width, uint16_t height, PixelFormat format)
+{
+    return (size_t(width) * height * GetBitsPerPixel(format) + 7) / 8;
+}
+
+/** Returns the grey level, 0 to 255, of a colour */
+inline uint8_t GetLuminance(uint32_t color)
+{
+    const uint32_t r = (color >> 16) & 0xff;
+    const uint32_t g = (color >> 8) & 0xff;
+    const uint32_t b = color & 0xff;
+    return uint8_t((77 * r + 150 * g + 29 * b) >> 8);
+}
+
+/** Reads a pixel as 0xAARRGGBB. A8 is white with the alpha of the mask,
+ *  the formats without alpha are opaque.
+ */
+inline uint32_t ReadPixel(const PixelBuffer& buffer, size_t x, size_t y)
+{
+    const size_t   index = y * buffer.width + x;
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer.data);
+    uint32_t       v, r, g, b;
+    switch(buffer.format)
+    {
+        case PixelFormat::ARGB8888:
+            return static_cast<const uint32_t*>(buffer.data)[index];
+        case PixelFormat::RGB888:
+            bytes += index * 3;
+            return 0xff000000 | (bytes[2] << 16) | (bytes[1] << 8) | bytes[0];
+        case PixelFormat::RGB565:
+        case PixelFormat::RGB565_SWAPPED:
+            v = static_cast<const uint16_t*>(buffer.data)[index];
+            if(buffer.format == PixelFormat::RGB565_SWAPPED)
+                v = ((v & 0xff) << 8) | (v >> 8);
+            r = (v >> 11) & 0x1f;
+            g = (v >> 5) & 0x3f;
+            b = v & 0x1f;
+            return 0xff000000 | (((r << 3) | (r >> 2)) << 16)
+                   | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+        case PixelFormat::ARGB1555:
+            v = static_cast<const uint16_t*>(buffer.data)[index];
+            r = (v >> 10) & 0x1f;
+            g = (v >> 5) & 0x1f;
+            b = v & 0x1f;
+            return ((v & 0x8000) ? 0xff000000 : 0)
+                   | (((r << 3) | (r >> 2)) << 16)
+                   | (((g << 3) | (g >> 2)) << 8) | ((b << 3) | (b >> 2));
+        case PixelFormat::ARGB4444:
+            v = static_cast<const uint16_t*>(buffer.data)[index];
+            return (((v >> 12) & 0xf) * 0x11000000u)
+                   | (((v >> 8) & 0xf) * 0x110000u)
+                   | (((v >> 4) & 0xf) * 0x1100u) | ((v & 0xf) * 0x11u);
+        case PixelFormat::A8: return (uint32_t(bytes[index]) << 24) | 0xffffff;
+        case PixelFormat::L4:
+            v = bytes[index / 2];
+            v = (index & 1) ? v & 0xf : v >> 4;
+            return 0xff000000 | (v * 0x111111u);
+    }
+    return 0;
+}
+
+/** Writes a pixel, given as 0xAARRGGBB */
+inline void
+WritePixel(const PixelBuffer& buffer, size_t x, size_t y, uint32_t color)
+{
+    const size_t   index = y * buffer.width + x;
+    uint8_t*       bytes = static_cast<uint8_t*>(buffer.data);
+    uint16_t*      words = static_cast<uint16_t*>(buffer.data);
+    const uint32_t a     = color >> 24;
+    const uint32_t r     = (color >> 16) & 0xff;
+    const uint32_t g     = (color >> 8) & 0xff;
+    const uint32_t b     = color & 0xff;
+    uint16_t       v;
+    switch(buffer.format)
+    {
+        case PixelFormat::ARGB8888:
+            static_cast<uint32_t*>(buffer.data)[index] = color;
+            break;
+        case PixelFormat::RGB888:
+            bytes[index * 3]     = b;
+            bytes[index * 3 + 1] = g;
+            bytes[index * 3 + 2] = r;
+            break;
+        case PixelFormat::RGB565:
+        case PixelFormat::RGB565_SWAPPED:
+            v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+            if(buffer.format == PixelFormat::RGB565_SWAPPED)
+                v = ((v & 0xff) << 8) | (v >> 8);
+            words[index] = v;
+            break;
+        case PixelFormat::ARGB1555:
+            words[index] = ((a >> 7) << 15) | ((r >> 3) << 10) | ((g >> 3) << 5)
+                           | (b >> 3);
+            break;
+        case PixelFormat::ARGB4444:
+            words[index] = ((a >> 4) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4)
+                           | (b >> 4);
+            break;
+        case PixelFormat::A8: bytes[index] = a; break;
+        case PixelFormat::L4:
+            v = GetLuminance(color) >> 4;
+            if(index & 1)
+                bytes[index / 2] = (bytes[index / 2] & 0xf0) | v;
+            else
+                bytes[index / 2] = (bytes[index / 2] & 0x0f) | (v << 4);
+            break;
+    }
+}
+
+/** Returns fg drawn over bg, with the alpha of fg times alpha / 255. The
+ *  same as the DMA2D does for an opaque background.
+ */
+inline uint32_t BlendPixel(uint32_t fg, uint32_t bg, uint8_t alpha = 255)
+{
+    const uint32_t a      = ((fg >> 24) * alpha + 127) / 255;
+    const uint32_t out    = a + (((bg >> 24) * (255 - a) + 127) / 255);
+    uint32_t       result = out << 24;
+    for(size_t shift = 0; shift < 24; shift += 8)
+    {
+        const uint32_t f = (fg >> shift) & 0xff;
+        const uint32_t b = (bg >> shift) & 0xff;
+        result |= ((f * a + b * (255 - a) + 127) / 255) << shift;
+    }
+    return result;
+}
+
+} // namespace daisy
+
+#endif
@@ -10,9 +10,27 @@ namespace daisy
     @{
 */
 
+/** Up to two contiguous pieces of a RingBuffer, the second one is only
+    used when the region wraps around the end of the buffer.
+*/
+template <typename T>
+struct RingBufferSpans
+{
+    T*     first;       /**< start of the first piece */
+    size_t first_size;  /**< elements in the first piece */
+    T*     second;      /**< start of the buffer, if the region wraps */
+    size_t second_size; /**< elements in the second piece, or 0 */
+
+    /** \return the elements in both pieces */
+    size_t size() const { return first_size + second_size; }
+};
+
 /**
 Utility Ring Buffer \n 
 imported from pichenettes/stmlib
+
+When the size is a power of two, the positions wrap with a mask instead
+of a division, which is chosen at compile time.
 */
 template <typename T, size_t size>
 class RingBuffer
@@ -29,11 +47,14 @@ class RingBuffer
     /** \return the number of samples that can be written to ring buffer without overwriting unread data. */
     inline size_t writable() const
     {
-        return (read_ptr_ - write_ptr_ - 1) % size;
+        return Wrap(read_ptr_ + size - write_ptr_ - 1);
     }
 
     /** \return number of unread elements in ring buffer */
-    inline size_t readable() const { return (write_ptr_ - read_ptr_) % size; }
+    inline size_t readable() const
+    {
+        return Wrap(write_ptr_ + size - read_ptr_);
+    }
 
     /** \returns True, if the buffer is empty. */
     inline bool isEmpty() const { return write_ptr_ == read_ptr_; }
@@ -55,7 +76,7 @@ class RingBuffer
     {
         size_t w   = write_ptr_;
         buffer_[w] = v;
-        write_ptr_ = (w + 1) % size;
+        write_ptr_ = Wrap(w + 1);
     }
 
     /** Reads the first available element from the ring buffer
@@ -75,7 +96,7 @@ class RingBuffer
     {
         size_t r      = read_ptr_;
         T      result = buffer_[r];
-        read_ptr_     = (r + 1) % size;
+        read_ptr_     = Wrap(r + 1);
         return result;
     }
 
@@ -91,7 +112,7 @@ class RingBuffer
         {
             return;
         }
-        read_ptr_ = (write_ptr_ + 1 + n) % size;
+        read_ptr_ = Wrap(write_ptr_ + 1 + n);
     }
 
     /** Reads a number of elements into a buffer immediately
@@ -113,7 +134,7 @@ class RingBuffer
             std::copy(
                 &buffer_[0], &buffer_[num_elements - read], destination + read);
         }
-        read_ptr_ = (r + num_elements) % size;
+        read_ptr_ = Wrap(r + num_elements);
     }
 
     /** Overwrites a number of elements using the source buffer as input. 
@@ -135,7 +156,7 @@ class RingBuffer
             std::copy(source + written, source + num_elements, &buffer_[0]);
         }
 
-        write_ptr_ = (w + num_elements) % size;
+        write_ptr_ = Wrap(w + num_elements);
     }
 
     /**Advances the write pointer, for when a peripheral is writing to the buffer. */
@@ -144,9 +165,38 @@ class RingBuffer
         size_t free;
         free         = this->writable();
         num_elements = num_elements < free ? num_elements : free;
-        write_ptr_   = write_ptr_ + num_elements;
-        if(write_ptr_ > size)
-            write_ptr_ = write_ptr_ - size;
+        write_ptr_   = Wrap(write_ptr_ + num_elements);
+    }
+
+    /** Gets the unread elements to process them in place, e.g. a block
+    for a DMA or a whole audio block, then Consume() them.
+    \param max_elements at most this many elements
+    \return the elements in up to two pieces
+     */
+    inline RingBufferSpans<const T> GetReadSpans(size_t max_elements = size)
+    {
+        const size_t n = std::min(readable(), max_elements);
+        return MakeSpans<const T>(read_ptr_, n);
+    }
+
+    /** Removes elements that were read with GetReadSpans()
+    \param num_elements how many, at most readable()
+     */
+    inline void Consume(size_t num_elements)
+    {
+        num_elements = std::min(num_elements, readable());
+        read_ptr_    = Wrap(read_ptr_ + num_elements);
+    }
+
+    /** Gets the free space to write in place, then Advance() the write
+    pointer by the elements written.
+    \param max_elements at most this many elements
+    \return the free space in up to two pieces
+     */
+    inline RingBufferSpans<T> GetWriteSpans(size_t max_elements = size)
+    {
+        const size_t n = std::min(writable(), max_elements);
+        return MakeSpans<T>(write_ptr_, n);
     }
 
     /**Returns a pointer to the actual Ring Buffer
@@ -154,6 +204,21 @@ class RingBuffer
     inline T* GetMutableBuffer() { return buffer_; }
 
   private:
+    static constexpr bool kIsPowerOfTwo = (size & (size - 1)) == 0;
+
+    /** Wraps a position past the end back into the buffer */
+    static inline size_t Wrap(size_t position)
+    {
+        return kIsPowerOfTwo ? position & (size - 1) : position % size;
+    }
+
+    template <typename U>
+    inline RingBufferSpans<U> MakeSpans(size_t start, size_t n)
+    {
+        const size_t first = std::min(n, size - start);
+        return {&buffer_[start], first, &buffer_[0], n - first};
+    }
+
     T               buffer_[size];
     volatile size_t read_ptr_;
     volatile size_t write_ptr_;
@@ -190,6 +255,20 @@ class RingBuffer<T, 0>
         (void)(source);
         (void)(num_elements);
     } /**< \param source 3 \param num_elements & */
+    inline RingBufferSpans<const T> GetReadSpans(size_t max_elements = 0)
+    {
+        (void)(max_elements);
+        return {nullptr, 0, nullptr, 0};
+    } /**< \return empty spans */
+    inline void Consume(size_t num_elements)
+    {
+        (void)(num_elements);
+    } /**< \param num_elements & */
+    inline RingBufferSpans<T> GetWriteSpans(size_t max_elements = 0)
+    {
+        (void)(max_elements);
+        return {nullptr, 0, nullptr, 0};
+    } /**< \return empty spans */
 
   private:
 };
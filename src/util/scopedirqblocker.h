@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include "sys/irq_priority.h"
 
 #ifndef UNIT_TEST // provide dummy implementation for unit tests
 extern "C"
@@ -29,6 +30,42 @@ class ScopedIrqBlocker
   private:
     uint32_t prim_;
 };
+
+/** @brief Temporarily disables the IRQ handlers up to a priority, with
+ *  RAII techniques.
+ *
+ *  Unlike the ScopedIrqBlocker it only masks interrupts with the given
+ *  priority and the less urgent ones (larger values, see
+ *  sys/irq_priority.h), through the BASEPRI register. The default keeps
+ *  the DMA of the SAI running, so a critical section in the main loop
+ *  doesn't delay the audio.
+ *
+ *  The state it protects must not be touched from the interrupts that stay
+ *  enabled, e.g. from an audio callback running in the DMA interrupt
+ *  (AudioHandle with a buffer depth of 2); that takes a ScopedIrqBlocker.
+ *  Nesting only ever raises the mask, and the destructor restores the
+ *  previous one.
+ */
+class ScopedIrqPriorityBlocker
+{
+  public:
+    /** \param priority the most urgent priority to mask, at least 1,
+     *         priority 0 can't be masked through the BASEPRI
+     */
+    explicit ScopedIrqPriorityBlocker(
+        uint32_t priority = DSY_IRQ_PRIORITY_AUDIO_DMA + 1)
+    {
+        if(priority < 1)
+            priority = 1;
+        basepri_ = __get_BASEPRI();
+        __set_BASEPRI_MAX(priority << (8 - DSY_IRQ_PRIORITY_BITS));
+    }
+
+    ~ScopedIrqPriorityBlocker() { __set_BASEPRI(basepri_); }
+
+  private:
+    uint32_t basepri_;
+};
 } // namespace daisy
 
 #else // ifndef UNIT_TEST
@@ -42,6 +79,18 @@ class ScopedIrqBlocker
     ScopedIrqBlocker(){};
     ~ScopedIrqBlocker() = default;
 };
+
+/** A dummy implementation for unit tests */
+class ScopedIrqPriorityBlocker
+{
+  public:
+    explicit ScopedIrqPriorityBlocker(
+        uint32_t priority = DSY_IRQ_PRIORITY_AUDIO_DMA + 1)
+    {
+        (void)priority;
+    }
+    ~ScopedIrqPriorityBlocker() = default;
+};
 } // namespace daisy
 
 #endif
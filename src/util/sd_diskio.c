@@ -21,6 +21,8 @@
 #include "ff_gen_drv.h"
 #include "util/sd_diskio.h"
 #include "stm32h7xx_hal.h"
+#include "daisy_core.h"
+#include <string.h>
 
 
 /* Private typedef -----------------------------------------------------------*/
@@ -52,6 +54,16 @@
 
 #define ENABLE_SD_DMA_CACHE_MAINTENANCE 1
 
+/*
+ * Buffers the IDMA of SDMMC1 can't reach (DTCM, D2/D3 SRAM, flash), or that
+ * aren't aligned well enough, are transferred through a scratch buffer in
+ * chunks of this many sectors. Everything else goes straight to the user's
+ * buffer in one multi-block transfer.
+ */
+#ifndef SD_SCRATCH_SECTORS
+#define SD_SCRATCH_SECTORS 4
+#endif
+
 
 /* Private variables ---------------------------------------------------------*/
 /* Disk status */
@@ -59,6 +71,17 @@ static volatile DSTATUS Stat = STA_NOINIT;
 //static volatile  UINT  WriteStatus = 0, ReadStatus = 0;
 static uint32_t WriteStatus = 0;
 static uint32_t ReadStatus  = 0;
+/* While another owner, e.g. a USB host, has the card, FatFs sees no disk,
+ * and it mounts the card again once it's back, as the host may have
+ * changed anything on it.
+ */
+static volatile uint8_t SD_Suspended = 0;
+static uint8_t          SD_Remount   = 0;
+/* in the AXI SRAM, as the SDMMC1 IDMA can't reach the D2 SRAM or the DTCM,
+ * where .bss is with BOOT_SRAM. Cache line aligned for the maintenance. */
+static uint32_t DSY_AXI_SRAM_BSS
+    SD_Scratch[SD_SCRATCH_SECTORS * SD_DEFAULT_BLOCK_SIZE / 4]
+    __attribute__((aligned(32)));
 /* Private function prototypes -----------------------------------------------*/
 static DSTATUS SD_CheckStatus(BYTE lun);
 DSTATUS        SD_initialize(BYTE);
@@ -89,7 +112,7 @@ static DSTATUS SD_CheckStatus(BYTE lun)
 {
     Stat = STA_NOINIT;
 
-    if(BSP_SD_GetCardState() == MSD_OK)
+    if(!SD_Suspended && !SD_Remount && BSP_SD_GetCardState() == MSD_OK)
     {
         Stat &= ~STA_NOINIT;
     }
@@ -104,6 +127,11 @@ static DSTATUS SD_CheckStatus(BYTE lun)
   */
 DSTATUS SD_initialize(BYTE lun)
 {
+    /* the card is left alone while it's suspended */
+    if(SD_Suspended)
+        return STA_NOINIT;
+    SD_Remount = 0;
+
 #if !defined(DISABLE_SD_INIT)
 
     if(BSP_SD_Init() == MSD_OK)
@@ -128,23 +156,40 @@ DSTATUS SD_status(BYTE lun)
 }
 
 /**
-  * @brief  Reads Sector(s)
-  * @param  lun : not used
-  * @param  *buff: Data buffer to store read data
+  * @brief  Checks whether the IDMA can transfer directly from/to a buffer
+  * @param  buff: the buffer
+  * @param  align: required alignment of the address in bytes
+  * @retval 1 if the buffer is usable for DMA
+  */
+static int SD_IsDmaBuffer(const BYTE *buff, uint32_t align)
+{
+    const uint32_t addr = (uint32_t)buff;
+    if(addr & (align - 1))
+        return 0;
+    /* SDMMC1 can only access the AXI SRAM and the FMC (i.e. SDRAM) */
+    return (addr >= 0x24000000 && addr < 0x24080000)
+           || (addr >= 0xC0000000 && addr < 0xE0000000);
+}
+
+/**
+  * @brief  Reads sectors with one multi-block DMA transfer
+  * @param  buff: a buffer that passes SD_IsDmaBuffer()
   * @param  sector: Sector address (LBA)
-  * @param  count: Number of sectors to read (1..128)
+  * @param  count: Number of sectors to read
   * @retval DRESULT: Operation result
   */
-DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+static DRESULT SD_ReadBlocks(BYTE *buff, DWORD sector, UINT count)
 {
     DRESULT res = RES_ERROR;
     ReadStatus  = 0;
     uint32_t timeout;
 #if(ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)
-    uint32_t alignedAddr;
-    alignedAddr = (uint32_t)buff & ~0x1F;
-    SCB_CleanDCache_by_Addr((uint32_t *)alignedAddr,
-                            count * BLOCKSIZE + ((uint32_t)buff - alignedAddr));
+    /* The buffer is cache line aligned, so no neighbouring data is lost
+     * by invalidating it. Dirty lines that might get evicted during the
+     * transfer are dropped before, lines that were speculatively
+     * refetched during it, after the transfer.
+     */
+    SCB_InvalidateDCache_by_Addr((uint32_t *)buff, count * BLOCKSIZE);
 #endif
     if(BSP_SD_ReadBlocks_DMA((uint32_t *)buff, (uint32_t)(sector), count)
        == MSD_OK)
@@ -168,11 +213,8 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
                 {
                     res = RES_OK;
 #if(ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)
-                    /* the SCB_InvalidateDCache_by_Addr() requires a 32-Byte aligned address,
-                     * adjust the address and the D-Cache size to invalidate accordingly. */
-                    SCB_InvalidateDCache_by_Addr(
-                        (uint32_t *)alignedAddr,
-                        count * BLOCKSIZE + ((uint32_t)buff - alignedAddr));
+                    SCB_InvalidateDCache_by_Addr((uint32_t *)buff,
+                                                 count * BLOCKSIZE);
 #endif
                     break;
                 }
@@ -184,29 +226,57 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 }
 
 /**
-  * @brief  Writes Sector(s)
+  * @brief  Reads Sector(s)
   * @param  lun : not used
-  * @param  *buff: Data to be written
+  * @param  *buff: Data buffer to store read data
   * @param  sector: Sector address (LBA)
-  * @param  count: Number of sectors to write (1..128)
+  * @param  count: Number of sectors to read (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+    if(SD_Suspended)
+        return RES_NOTRDY;
+    return SD_ReadDirect(buff, sector, count);
+}
+
+DRESULT SD_ReadDirect(BYTE *buff, DWORD sector, UINT count)
+{
+    DRESULT res = RES_OK;
+    UINT    n;
+
+    /* zero copy, so that large reads run at the card's sequential speed */
+    if(SD_IsDmaBuffer(buff, 32))
+        return SD_ReadBlocks(buff, sector, count);
+
+    while(count > 0 && res == RES_OK)
+    {
+        n   = count < SD_SCRATCH_SECTORS ? count : SD_SCRATCH_SECTORS;
+        res = SD_ReadBlocks((BYTE *)SD_Scratch, sector, n);
+        if(res == RES_OK)
+            memcpy(buff, SD_Scratch, n * BLOCKSIZE);
+        buff += n * BLOCKSIZE;
+        sector += n;
+        count -= n;
+    }
+    return res;
+}
+
+/**
+  * @brief  Writes sectors with one multi-block DMA transfer
+  * @param  buff: a buffer that passes SD_IsDmaBuffer()
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write
   * @retval DRESULT: Operation result
   */
 #if _USE_WRITE == 1
-DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+static DRESULT SD_WriteBlocks(const BYTE *buff, DWORD sector, UINT count)
 {
     DRESULT res = RES_ERROR;
     WriteStatus = 0;
     uint32_t timeout;
 #if(ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)
     uint32_t alignedAddr;
-#endif
-    /*
-  * since the MPU is configured as write-through, see main.c file, there isn't any need
-  * to maintain the cache as its content is always coherent with the memory.
-  * If needed, check the file "Middlewares/Third_Party/FatFs/src/drivers/sd_diskio_dma_template.c"
-  * to see how the cache is maintained during the write operations.
-  */
-#if(ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)
 
     /*
     the SCB_CleanDCache_by_Addr() requires a 32-Byte aligned address
@@ -245,6 +315,43 @@ DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 
     return res;
 }
+
+/**
+  * @brief  Writes Sector(s)
+  * @param  lun : not used
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+    if(SD_Suspended)
+        return RES_NOTRDY;
+    return SD_WriteDirect(buff, sector, count);
+}
+
+DRESULT SD_WriteDirect(const BYTE *buff, DWORD sector, UINT count)
+{
+    DRESULT res = RES_OK;
+    UINT    n;
+
+    /* cleaning the cache doesn't touch the neighbouring data, so word
+     * alignment is enough for the IDMA */
+    if(SD_IsDmaBuffer(buff, 4))
+        return SD_WriteBlocks(buff, sector, count);
+
+    while(count > 0 && res == RES_OK)
+    {
+        n = count < SD_SCRATCH_SECTORS ? count : SD_SCRATCH_SECTORS;
+        memcpy(SD_Scratch, buff, n * BLOCKSIZE);
+        res = SD_WriteBlocks((const BYTE *)SD_Scratch, sector, n);
+        buff += n * BLOCKSIZE;
+        sector += n;
+        count -= n;
+    }
+    return res;
+}
 #endif /* _USE_WRITE == 1 */
 
 /**
@@ -260,7 +367,7 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
     DRESULT         res = RES_ERROR;
     BSP_SD_CardInfo CardInfo;
 
-    if(Stat & STA_NOINIT)
+    if(SD_Suspended || (Stat & STA_NOINIT))
         return RES_NOTRDY;
 
     switch(cmd)
@@ -297,6 +404,18 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
 #endif /* _USE_IOCTL == 1 */
 
 
+void SD_SetSuspended(uint8_t suspended)
+{
+    if(suspended)
+        SD_Remount = 1;
+    SD_Suspended = suspended;
+}
+
+uint8_t SD_IsSuspended(void)
+{
+    return SD_Suspended;
+}
+
 /**
   * @brief Tx Transfer completed callbacks
   * @param hsd: SD handle
@@ -10,6 +10,26 @@ extern "C"
 
     extern const Diskio_drvTypeDef SD_Driver; /**< & */
 
+    /** Reads sectors with multi-block DMA, bypassing the suspension of
+     *  SD_Driver, e.g. for a USB host that owns the card.
+     *  \param buff any buffer; ones outside of the AXI SRAM and SDRAM go
+     *         through a scratch buffer
+     */
+    DRESULT SD_ReadDirect(BYTE *buff, DWORD sector, UINT count);
+
+    /** Writes sectors with multi-block DMA, bypassing the suspension of
+     *  SD_Driver */
+    DRESULT SD_WriteDirect(const BYTE *buff, DWORD sector, UINT count);
+
+    /** Suspends SD_Driver while another owner has the card: FatFs sees no
+     *  disk, and mounts the card again on its first access after it's
+     *  resumed. Files that were open have to be opened again.
+     */
+    void SD_SetSuspended(uint8_t suspended);
+
+    /** Returns 1 while SD_Driver is suspended */
+    uint8_t SD_IsSuspended(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,7 @@
 #include "ff_gen_drv.h"
 #include "usbh_diskio.h"
 #include "daisy_core.h"
+#include <string.h>
 
 extern USBH_HandleTypeDef hUsbHostHS;
 #define hUSB_Host hUsbHostHS
@@ -35,9 +36,28 @@ extern USBH_HandleTypeDef hUsbHostHS;
 
 #define ENABLE_USB_DMA_CACHE_MAINTENANCE 1
 
+/*
+ * Every MSC command costs a few USB frames of overhead, so small reads are
+ * served from a read-ahead buffer of this many sectors, filled with one
+ * multi-sector command. It's also the bounce buffer for buffers the OTG DMA
+ * can't transfer directly. Reads of at least this many sectors to suitable
+ * buffers go straight to the user's buffer.
+ */
+#ifndef USBH_CACHE_SECTORS
+#define USBH_CACHE_SECTORS 8
+#endif
+
+#define USBH_DMA_ENABLED() \
+    (((HCD_HandleTypeDef *)hUSB_Host.pData)->Init.dma_enable)
+
 /* Private variables ---------------------------------------------------------*/
-static DWORD DMA_BUFFER_MEM_SECTION scratch[_MAX_SS / 4];
-extern USBH_HandleTypeDef           hUSB_Host;
+static DWORD DMA_BUFFER_MEM_SECTION scratch[USBH_CACHE_SECTORS * _MAX_SS / 4]
+    __attribute__((aligned(32)));
+extern USBH_HandleTypeDef hUSB_Host;
+/* sectors held by scratch, cache_count is 0 if it holds nothing */
+static BYTE  cache_lun;
+static DWORD cache_sector;
+static UINT  cache_count;
 
 /* Private function prototypes -----------------------------------------------*/
 DSTATUS USBH_initialize(BYTE);
@@ -78,6 +98,7 @@ const Diskio_drvTypeDef USBH_Driver = {
 DSTATUS USBH_initialize(BYTE lun)
 {
     /* CAUTION : USB Host library has to be initialized in the application */
+    cache_count = 0;
 
     return RES_OK;
 }
@@ -97,12 +118,116 @@ DSTATUS USBH_status(BYTE lun)
     }
     else
     {
-        res = RES_ERROR;
+        /* the drive may have been swapped */
+        cache_count = 0;
+        res         = RES_ERROR;
     }
 
     return res;
 }
 
+/**
+  * @brief  Checks whether the OTG DMA can transfer directly from/to a buffer
+  * @param  buff: the buffer
+  * @param  align: required alignment of the address in bytes
+  * @retval 1 if the buffer is usable
+  */
+static int USBH_IsDmaBuffer(const BYTE *buff, uint32_t align)
+{
+    const uint32_t addr = (uint32_t)buff;
+    if(addr & (align - 1))
+        return 0;
+    if(!USBH_DMA_ENABLED())
+        return 1;
+    /* the OTG DMA can't access the DTCM, or the flash */
+    return (addr >= 0x24000000 && addr < 0x24080000)
+           || (addr >= 0x30000000 && addr < 0x30048000)
+           || (addr >= 0xC0000000 && addr < 0xE0000000);
+}
+
+/**
+  * @brief  Converts the sense data of a failed command
+  * @param  lun : lun id
+  * @retval DRESULT: Operation result
+  */
+static DRESULT USBH_GetError(BYTE lun)
+{
+    MSC_LUNTypeDef info;
+    USBH_MSC_GetLUNInfo(&hUSB_Host, lun, &info);
+
+    switch(info.sense.asc)
+    {
+        case SCSI_ASC_WRITE_PROTECTED:
+            USBH_ErrLog("USB Disk is Write protected!");
+            return RES_WRPRT;
+
+        case SCSI_ASC_LOGICAL_UNIT_NOT_READY:
+        case SCSI_ASC_MEDIUM_NOT_PRESENT:
+        case SCSI_ASC_NOT_READY_TO_READY_CHANGE:
+            USBH_ErrLog("USB Disk is not ready!");
+            return RES_NOTRDY;
+
+        default: return RES_ERROR;
+    }
+}
+
+/**
+  * @brief  Reads sectors with one MSC command
+  * @param  lun : lun id
+  * @param  buff: a buffer that passes USBH_IsDmaBuffer(buff, 32)
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to read
+  * @retval DRESULT: Operation result
+  */
+static DRESULT USBH_ReadBlocks(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+    USBH_StatusTypeDef status;
+#if(ENABLE_USB_DMA_CACHE_MAINTENANCE == 1)
+    /* The buffer is cache line aligned, so no neighbouring data is lost by
+     * invalidating it, before (dirty lines) and after (prefetched lines).
+     * Without DMA the data is copied by the CPU, through the cache.
+     */
+    const int dma = USBH_DMA_ENABLED();
+    if(dma)
+        SCB_InvalidateDCache_by_Addr((uint32_t *)buff, count * BLOCKSIZE);
+#endif
+    status = USBH_MSC_Read(&hUSB_Host, lun, sector, buff, count);
+#if(ENABLE_USB_DMA_CACHE_MAINTENANCE == 1)
+    if(dma)
+        SCB_InvalidateDCache_by_Addr((uint32_t *)buff, count * BLOCKSIZE);
+#endif
+    return status == USBH_OK ? RES_OK : USBH_GetError(lun);
+}
+
+/**
+  * @brief  Fills the read-ahead buffer, starting at a sector
+  * @param  lun : lun id
+  * @param  sector: Sector address (LBA)
+  * @retval DRESULT: Operation result
+  */
+static DRESULT USBH_FillCache(BYTE lun, DWORD sector)
+{
+    MSC_LUNTypeDef info;
+    UINT           n = USBH_CACHE_SECTORS;
+    DRESULT        res;
+
+    /* don't read past the end of the drive */
+    if(USBH_MSC_GetLUNInfo(&hUSB_Host, lun, &info) == USBH_OK
+       && info.capacity.block_nbr > sector
+       && info.capacity.block_nbr - sector < n)
+        n = info.capacity.block_nbr - sector;
+
+    cache_count = 0;
+    res         = USBH_ReadBlocks(lun, (BYTE *)scratch, sector, n);
+    if(res == RES_OK)
+    {
+        cache_lun    = lun;
+        cache_sector = sector;
+        cache_count  = n;
+    }
+    return res;
+}
+
 /* USER CODE BEGIN beforeReadSection */
 /* can be used to modify previous code / undefine following code / add new code */
 /* USER CODE END beforeReadSection */
@@ -117,68 +242,31 @@ DSTATUS USBH_status(BYTE lun)
   */
 DRESULT USBH_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 {
-    DRESULT            res = RES_ERROR;
-    MSC_LUNTypeDef     info;
-    USBH_StatusTypeDef status = USBH_OK;
+    DRESULT res = RES_OK;
+    UINT    offset, n;
 
-#if(ENABLE_USB_DMA_CACHE_MAINTENANCE == 1)
-    uint32_t alignedAddr;
-    alignedAddr = (uint32_t)buff & ~0x1F;
-    SCB_CleanDCache_by_Addr((uint32_t *)alignedAddr,
-                            count * BLOCKSIZE + ((uint32_t)buff - alignedAddr));
-#endif
+    /* large reads go straight to the user's buffer with one command */
+    if(count >= USBH_CACHE_SECTORS && USBH_IsDmaBuffer(buff, 32))
+        return USBH_ReadBlocks(lun, buff, sector, count);
 
-    if(((DWORD)buff & 3)
-       && (((HCD_HandleTypeDef *)hUSB_Host.pData)->Init.dma_enable))
+    while(count > 0 && res == RES_OK)
     {
-        while((count--) && (status == USBH_OK))
+        if(cache_count == 0 || cache_lun != lun || sector < cache_sector
+           || sector >= cache_sector + cache_count)
         {
-            status = USBH_MSC_Read(
-                &hUSB_Host, lun, sector + count, (uint8_t *)scratch, 1);
-
-            if(status == USBH_OK)
-            {
-                memcpy(&buff[count * _MAX_SS], scratch, _MAX_SS);
-            }
-            else
-            {
+            res = USBH_FillCache(lun, sector);
+            if(res != RES_OK)
                 break;
-            }
         }
+        offset = sector - cache_sector;
+        n      = cache_count - offset;
+        if(n > count)
+            n = count;
+        memcpy(buff, &((BYTE *)scratch)[offset * _MAX_SS], n * _MAX_SS);
+        buff += n * _MAX_SS;
+        sector += n;
+        count -= n;
     }
-    else
-    {
-        status = USBH_MSC_Read(&hUSB_Host, lun, sector, buff, count);
-    }
-#if(ENABLE_USB_DMA_CACHE_MAINTENANCE == 1)
-    /* the SCB_InvalidateDCache_by_Addr() requires a 32-Byte aligned address,
-                     * adjust the address and the D-Cache size to invalidate accordingly. */
-    SCB_InvalidateDCache_by_Addr((uint32_t *)alignedAddr,
-                                 count * BLOCKSIZE
-                                     + ((uint32_t)buff - alignedAddr));
-#endif
-
-    if(status == USBH_OK)
-    {
-        res = RES_OK;
-    }
-    else
-    {
-        USBH_MSC_GetLUNInfo(&hUSB_Host, lun, &info);
-
-        switch(info.sense.asc)
-        {
-            case SCSI_ASC_LOGICAL_UNIT_NOT_READY:
-            case SCSI_ASC_MEDIUM_NOT_PRESENT:
-            case SCSI_ASC_NOT_READY_TO_READY_CHANGE:
-                USBH_ErrLog("USB Disk is not ready!");
-                res = RES_NOTRDY;
-                break;
-
-            default: res = RES_ERROR; break;
-        }
-    }
-
     return res;
 }
 
@@ -186,20 +274,19 @@ DRESULT USBH_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 /* can be used to modify previous code / undefine following code / add new code */
 /* USER CODE END beforeWriteSection */
 
+#if _USE_WRITE == 1
 /**
-  * @brief  Writes Sector(s)
+  * @brief  Writes sectors with one MSC command
   * @param  lun : lun id
-  * @param  *buff: Data to be written
+  * @param  buff: a buffer that passes USBH_IsDmaBuffer(buff, 4)
   * @param  sector: Sector address (LBA)
-  * @param  count: Number of sectors to write (1..128)
+  * @param  count: Number of sectors to write
   * @retval DRESULT: Operation result
   */
-#if _USE_WRITE == 1
-DRESULT USBH_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+static DRESULT
+USBH_WriteBlocks(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 {
-    DRESULT            res = RES_ERROR;
-    MSC_LUNTypeDef     info;
-    USBH_StatusTypeDef status = USBH_OK;
+    USBH_StatusTypeDef status;
 #if(ENABLE_USB_DMA_CACHE_MAINTENANCE == 1)
     uint32_t alignedAddr;
     /*
@@ -210,53 +297,43 @@ DRESULT USBH_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
     SCB_CleanDCache_by_Addr((uint32_t *)alignedAddr,
                             count * BLOCKSIZE + ((uint32_t)buff - alignedAddr));
 #endif
+    status = USBH_MSC_Write(&hUSB_Host, lun, sector, (BYTE *)buff, count);
+    return status == USBH_OK ? RES_OK : USBH_GetError(lun);
+}
 
-    if(((DWORD)buff & 3)
-       && (((HCD_HandleTypeDef *)hUSB_Host.pData)->Init.dma_enable))
-    {
-        while(count--)
-        {
-            memcpy(scratch, &buff[count * _MAX_SS], _MAX_SS);
-
-            status = USBH_MSC_Write(
-                &hUSB_Host, lun, sector + count, (BYTE *)scratch, 1);
-            if(status == USBH_FAIL)
-            {
-                break;
-            }
-        }
-    }
-    else
-    {
-        status = USBH_MSC_Write(&hUSB_Host, lun, sector, (BYTE *)buff, count);
-    }
-
-    if(status == USBH_OK)
-    {
-        res = RES_OK;
-    }
-    else
-    {
-        USBH_MSC_GetLUNInfo(&hUSB_Host, lun, &info);
+/**
+  * @brief  Writes Sector(s)
+  * @param  lun : lun id
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT USBH_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+    DRESULT res = RES_OK;
+    UINT    n;
 
-        switch(info.sense.asc)
-        {
-            case SCSI_ASC_WRITE_PROTECTED:
-                USBH_ErrLog("USB Disk is Write protected!");
-                res = RES_WRPRT;
-                break;
+    /* the read-ahead buffer must not return stale data */
+    if(cache_count > 0 && cache_lun == lun
+       && sector < cache_sector + cache_count && sector + count > cache_sector)
+        cache_count = 0;
 
-            case SCSI_ASC_LOGICAL_UNIT_NOT_READY:
-            case SCSI_ASC_MEDIUM_NOT_PRESENT:
-            case SCSI_ASC_NOT_READY_TO_READY_CHANGE:
-                USBH_ErrLog("USB Disk is not ready!");
-                res = RES_NOTRDY;
-                break;
+    /* cleaning the cache doesn't touch the neighbouring data, so word
+     * alignment is enough for the DMA */
+    if(USBH_IsDmaBuffer(buff, 4))
+        return USBH_WriteBlocks(lun, buff, sector, count);
 
-            default: res = RES_ERROR; break;
-        }
+    cache_count = 0;
+    while(count > 0 && res == RES_OK)
+    {
+        n = count < USBH_CACHE_SECTORS ? count : USBH_CACHE_SECTORS;
+        memcpy(scratch, buff, n * _MAX_SS);
+        res = USBH_WriteBlocks(lun, (const BYTE *)scratch, sector, n);
+        buff += n * _MAX_SS;
+        sector += n;
+        count -= n;
     }
-
     return res;
 }
 #endif /* _USE_WRITE == 1 */
@@ -106,6 +106,17 @@ class ExposedAbstractMenu : public AbstractMenu
         AbstractMenu::Init(itemConfigs_.data(), 1, orientation, true);
     }
 
+    void InitWithSource(ItemSource& source)
+    {
+        AbstractMenu::Init(
+            source, Orientation::upDownSelectLeftRightModify, true);
+    }
+
+    uint16_t GetFirstVisibleItemIdx(uint16_t numVisibleRows)
+    {
+        return AbstractMenu::GetFirstVisibleItemIdx(numVisibleRows);
+    }
+
     AbstractMenu::Orientation GetOrientation() { return orientation_; }
     bool                      AllowsEntering() { return allowEntering_; }
     bool                      IsEnteredForEditing() { return isEditing_; }
@@ -979,4 +990,78 @@ TEST(ui_AbstractMenu, m_closeMenu)
     // close menu with the cancel button
     menu.OnCancelButton(1, false);
     EXPECT_FALSE(menu.IsActive());
-}
\ No newline at end of file
+}
+/** Makes checkbox items on request, and counts the requests */
+class CheckboxSource : public AbstractMenu::ItemSource
+{
+  public:
+    uint16_t GetNumItems() const override { return numItems_; }
+    const AbstractMenu::ItemConfig& GetItem(uint16_t itemIdx) override
+    {
+        numRequests_++;
+        lastRequested_ = itemIdx;
+        item_.type     = AbstractMenu::ItemType::checkboxItem;
+        item_.text     = "checkbox";
+        item_.asCheckboxItem.valueToModify = &values_[itemIdx];
+        return item_;
+    }
+
+    uint16_t                 numItems_      = 500;
+    int                      numRequests_   = 0;
+    uint16_t                 lastRequested_ = 0;
+    bool                     values_[500]   = {};
+    AbstractMenu::ItemConfig item_;
+};
+
+TEST(ui_AbstractMenu, n_itemSource)
+{
+    ExposedAbstractMenu menu;
+    CheckboxSource      source;
+    menu.InitWithSource(source);
+    EXPECT_EQ(menu.GetNumItems(), 500);
+    EXPECT_EQ(source.numRequests_, 0);
+
+    // only the selected item is requested
+    menu.SelectItem(321);
+    menu.OnOkayButton(1, false);
+    EXPECT_EQ(source.numRequests_, 2);
+    EXPECT_EQ(source.lastRequested_, 321);
+    EXPECT_TRUE(source.values_[321]);
+    EXPECT_FALSE(source.values_[320]);
+
+    // fewer items, the selection moves to the last one
+    source.numItems_ = 100;
+    menu.ItemsChanged();
+    EXPECT_EQ(menu.GetNumItems(), 100);
+    EXPECT_EQ(menu.GetSelectedItemIdx(), 99);
+    menu.SelectItem(150);
+    EXPECT_EQ(menu.GetSelectedItemIdx(), 99);
+}
+
+TEST(ui_AbstractMenu, o_visibleRows)
+{
+    ExposedAbstractMenu menu;
+    CheckboxSource      source;
+    menu.InitWithSource(source);
+
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 0);
+    menu.SelectItem(3);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 0);
+    // scrolls down as far as needed
+    menu.SelectItem(4);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 1);
+    menu.SelectItem(10);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 7);
+    // and up again
+    menu.SelectItem(8);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 7);
+    menu.SelectItem(2);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 2);
+    // no empty rows at the end
+    menu.SelectItem(499);
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 496);
+    source.numItems_ = 3;
+    menu.ItemsChanged();
+    EXPECT_EQ(menu.GetFirstVisibleItemIdx(4), 0);
+    EXPECT_EQ(source.numRequests_, 0);
+}
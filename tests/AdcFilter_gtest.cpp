@@ -0,0 +1,78 @@
+#include "per/adc_filter.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+AdcFilter::Config MakeConfig()
+{
+    AdcFilter::Config cfg;
+    cfg.decimation = 4;
+    cfg.min_coeff  = 0.05f;
+    cfg.fast_slew  = 1024.f;
+    cfg.hysteresis = 24;
+    return cfg;
+}
+} // namespace
+
+TEST(per_AdcFilter, a_startsAtTheFirstValue)
+{
+    AdcFilter filter;
+    filter.Init(MakeConfig(), 2);
+    EXPECT_EQ(filter.Process(0, 30000), 30000);
+    EXPECT_EQ(filter.Get(0), 30000);
+    EXPECT_EQ(filter.Get(1), 0);
+    EXPECT_EQ(*filter.GetPtr(0), 30000);
+    // slots past Init() are ignored
+    EXPECT_EQ(filter.Process(5, 100), 0);
+}
+
+TEST(per_AdcFilter, b_restingInputHoldsStill)
+{
+    AdcFilter filter;
+    filter.Init(MakeConfig(), 1);
+    filter.Process(0, 30000);
+    // noise of +-40 steps doesn't move the output
+    uint16_t out = 0;
+    for(int i = 0; i < 4000; i++)
+    {
+        out = filter.Process(0, i % 2 ? 30040 : 29960);
+        EXPECT_EQ(out, 30000);
+    }
+}
+
+TEST(per_AdcFilter, c_fastMovePassesQuickly)
+{
+    AdcFilter filter;
+    filter.Init(MakeConfig(), 1);
+    filter.Process(0, 1000);
+    // a jump of half the range is through after one step
+    uint16_t out = 0;
+    for(int i = 0; i < 4; i++)
+        out = filter.Process(0, 33000);
+    EXPECT_EQ(out, 33000);
+}
+
+TEST(per_AdcFilter, d_slowMoveIsFollowed)
+{
+    AdcFilter filter;
+    filter.Init(MakeConfig(), 1);
+    filter.Process(0, 10000);
+    // ramps by 4 per conversion, the output stays within a few steps of
+    // hysteresis behind
+    uint16_t out   = 0;
+    uint16_t value = 10000;
+    for(int i = 0; i < 4000; i++)
+    {
+        value += 4;
+        out = filter.Process(0, value);
+    }
+    EXPECT_GT(out, value - 600);
+    EXPECT_LE(out, value);
+
+    // and settles close to where it stopped
+    for(int i = 0; i < 400; i++)
+        out = filter.Process(0, value);
+    EXPECT_NEAR(out, value, 25);
+}
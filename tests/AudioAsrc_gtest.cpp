@@ -0,0 +1,175 @@
+#include "hid/audio_asrc.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+constexpr size_t kBlock = 48;
+constexpr float  kPi    = 3.14159265f;
+
+/** Runs a stereo sine through a resampler, written at one rate and read
+ *  at another, and keeps the frames read after it settled
+ *  \param ppm how much faster the writer runs
+ *  \param seconds of audio to run
+ */
+struct Bridge
+{
+    AsyncResampler<2, 512> asrc;
+    ClockDriftMeter        meter;
+    std::vector<float>     left; // the frames read after a second
+    double                 read_rate = 48000.0, write_rate;
+    float                  min_fill = 1e9f, max_fill = 0.f;
+
+    Bridge(double ppm, double seconds, bool use_meter)
+    {
+        write_rate = read_rate * (1.0 + ppm * 1e-6);
+        asrc.Init(2 * kBlock + 16, kBlock);
+        meter.Reset(256);
+        double   t_write = 0.0, t_read = 0.3e-3;
+        uint64_t written = 0;
+        float    in[kBlock * 2], out[kBlock * 2];
+        while(t_read < seconds)
+        {
+            if(t_write < t_read)
+            {
+                for(size_t i = 0; i < kBlock; i++, written++)
+                {
+                    // 100Hz, so it's the same sine at both rates
+                    const double phase
+                        = std::fmod(written * 100.0 / write_rate, 1.0);
+                    const float x = float(std::sin(2.0 * kPi * phase));
+                    in[2 * i] = in[2 * i + 1] = x;
+                }
+                meter.MarkSecondary(uint32_t(t_write * 480e6));
+                asrc.Write(in, kBlock, uint32_t(t_write * 480e6));
+                t_write += kBlock / write_rate;
+            }
+            else
+            {
+                meter.MarkPrimary(uint32_t(t_read * 480e6));
+                const float fill = asrc.GetFill();
+                asrc.Read(out,
+                          kBlock,
+                          use_meter ? meter.GetRatio() : 1.f,
+                          uint32_t(t_read * 480e6));
+                if(t_read > 1.0)
+                {
+                    min_fill = fill < min_fill ? fill : min_fill;
+                    max_fill = fill > max_fill ? fill : max_fill;
+                    for(size_t i = 0; i < kBlock; i++)
+                        left.push_back(out[2 * i]);
+                }
+                t_read += kBlock / read_rate;
+            }
+        }
+    }
+};
+} // namespace
+
+TEST(hid_AudioAsrc, a_measuresTheDrift)
+{
+    ClockDriftMeter meter;
+    meter.Reset(100);
+    EXPECT_FALSE(meter.IsValid());
+    EXPECT_FLOAT_EQ(meter.GetRatio(), 1.f);
+    // the secondary clock runs 200ppm fast, the counter wraps on the way
+    uint32_t t1 = 0xF0000000u, t2 = 0xF0001234u;
+    for(int i = 0; i < 1000; i++)
+    {
+        meter.MarkPrimary(t1 + (i % 3) * 50); // some jitter
+        meter.MarkSecondary(t2);
+        t1 += 480000;
+        t2 += uint32_t(480000 / 1.0002 + 0.5);
+    }
+    EXPECT_TRUE(meter.IsValid());
+    EXPECT_NEAR(meter.GetDriftPpm(), 200.f, 2.f);
+    EXPECT_NEAR(meter.GetPeriod(false), 480000.f, 1.f);
+}
+
+TEST(hid_AudioAsrc, b_sameClockPassesThrough)
+{
+    AsyncResampler<1, 256> asrc;
+    ASSERT_TRUE(asrc.Init(20, 8));
+    EXPECT_FALSE(asrc.Init(250, 8));
+    asrc.Init(20, 8);
+    float in[8], out[8];
+    float    next = 0.f, expected = 0.f;
+    bool     started = false;
+    uint32_t now     = 0;
+    for(int block = 0; block < 100; block++)
+    {
+        for(auto& x : in)
+            x = next++;
+        asrc.Write(in, 8, now);
+        asrc.Read(out, 8, 1.f, now + 10);
+        now += 1000;
+        if(!started && out[0] != 0.f)
+        {
+            started  = true;
+            expected = out[0];
+        }
+        // a ramp comes out as it went in, give or take the trim of the loop
+        for(size_t i = 0; started && i < 8; i++)
+            EXPECT_NEAR(out[i], expected++, 0.05f);
+    }
+    EXPECT_TRUE(started);
+    EXPECT_EQ(asrc.GetSlips(), 0u);
+}
+
+TEST(hid_AudioAsrc, c_followsTheDrift)
+{
+    for(double ppm : {-300.0, 50.0, 500.0})
+    {
+        for(bool use_meter : {false, true})
+        {
+            Bridge b(ppm, 30.0, use_meter);
+            EXPECT_EQ(b.asrc.GetSlips(), 0u) << ppm;
+            // the fill stays close to the target of 2 blocks at each read
+            EXPECT_GT(b.min_fill, kBlock + 8.f) << ppm;
+            EXPECT_LT(b.max_fill, 3.f * kBlock + 24.f) << ppm;
+            // the correction ends up where the meter would be
+            const float expected
+                = use_meter ? 0.f : float(ppm * 1e-6 / (1 + ppm * 1e-6));
+            EXPECT_NEAR(b.asrc.GetCorrection(), expected, 5e-6f) << ppm;
+
+            // no jumps in the sine, a step of 100Hz at 48kHz is < 0.014
+            float max_step = 0.f;
+            for(size_t i = 1; i < b.left.size(); i++)
+                max_step = std::fmax(max_step,
+                                     std::fabs(b.left[i] - b.left[i - 1]));
+            EXPECT_LT(max_step, 0.0132f) << ppm;
+            EXPECT_GT(max_step, 0.0130f) << ppm;
+        }
+    }
+}
+
+TEST(hid_AudioAsrc, d_slipsWhenAStreamStops)
+{
+    AsyncResampler<2, 512> asrc;
+    asrc.Init(2 * kBlock + 16, kBlock);
+    float    block[kBlock * 2];
+    uint32_t now = 0;
+    for(auto& x : block)
+        x = 0.5f;
+    for(int i = 0; i < 10; i++, now += 1000)
+    {
+        asrc.Write(block, kBlock, now);
+        asrc.Read(block, kBlock, 1.f, now);
+    }
+    EXPECT_EQ(asrc.GetSlips(), 0u);
+    // the writer stops, the reader runs empty once, and is then silent
+    for(int i = 0; i < 10; i++, now += 1000)
+        asrc.Read(block, kBlock, 1.f, now);
+    EXPECT_EQ(asrc.GetSlips(), 1u);
+    EXPECT_FLOAT_EQ(block[0], 0.f);
+    // the reader stops, the FIFO overflows once
+    for(int i = 0; i < 20; i++, now += 1000)
+        asrc.Write(block, kBlock, now);
+    asrc.Read(block, kBlock, 1.f, now);
+    for(int i = 0; i < 20; i++, now += 1000)
+        asrc.Write(block, kBlock, now);
+    EXPECT_EQ(asrc.GetSlips(), 2u);
+}
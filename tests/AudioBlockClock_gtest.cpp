@@ -0,0 +1,60 @@
+#include "util/AudioBlockClock.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+/** 48 samples at 48kHz, 480000 cycles per block */
+void InitClock(AudioBlockClock& clock, uint32_t startCycles)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    System::SetCycleCountForUnitTest(startCycles);
+    clock.Init(48000.0f, 48);
+}
+
+/** starts the next block, the given number of cycles after the last one */
+void StartBlockAfter(AudioBlockClock& clock, uint32_t cycles)
+{
+    System::SetCycleCountForUnitTest(clock.GetBlockStartCycles() + cycles);
+    clock.OnBlockStart();
+}
+} // namespace
+
+TEST(util_AudioBlockClock, a_eventsAreDelayedByOneBlock)
+{
+    AudioBlockClock clock;
+    InitClock(clock, 1000);
+    StartBlockAfter(clock, 480000);
+    const uint32_t prevStart = 1000;
+
+    EXPECT_EQ(clock.GetSampleOffset(prevStart), 0u);
+    EXPECT_EQ(clock.GetSampleOffset(prevStart + 10000), 1u);
+    EXPECT_EQ(clock.GetSampleOffset(prevStart + 240000), 24u);
+    EXPECT_EQ(clock.GetSampleOffset(prevStart + 479999), 47u);
+
+    // too old or too new
+    EXPECT_EQ(clock.GetSampleOffset(prevStart - 1), 0u);
+    EXPECT_EQ(clock.GetSampleOffset(prevStart + 500000), 47u);
+}
+
+TEST(util_AudioBlockClock, b_cycleCounterWraps)
+{
+    AudioBlockClock clock;
+    InitClock(clock, 0xffffffffu - 100000);
+    StartBlockAfter(clock, 480000);
+
+    // 240000 cycles into the previous block, after the wrap
+    EXPECT_EQ(clock.GetSampleOffset(240000u - 100001u), 24u);
+}
+
+TEST(util_AudioBlockClock, c_followsClockChanges)
+{
+    AudioBlockClock clock;
+    InitClock(clock, 0);
+    System::SetSysClkFreqForUnitTest(240000000u);
+    System::ClockChangeForUnitTest();
+    StartBlockAfter(clock, 240000);
+
+    EXPECT_EQ(clock.GetSampleOffset(120000), 24u);
+}
@@ -0,0 +1,403 @@
+#pragma once
+#include "hid/audio.h"
+#include "sys/system.h"
+#include "util/wav_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace daisy
+{
+/** Runs an audio callback offline, on the host, for profiling and
+ *  regression tests of DSP code without the hardware.
+ *
+ *  The input is a signal in memory, generated with the helpers below or
+ *  loaded from a WAV file. It's cut into blocks and fed through the
+ *  callback like the AudioHandle would, and the output is collected into
+ *  another signal, which can be compared or written to a WAV file.
+ *
+ *  Before each block, the dummy System's time, ticks and cycle counter
+ *  are set to the time of that block, as if the audio was running in
+ *  real time. Code that reads System::GetUs() or a CpuLoadMeter in the
+ *  callback sees the time advance by one block per callback.
+ *
+ *  Each callback is timed with the host's clock. That's no measure of the
+ *  time on the Cortex-M7, but it shows what changed between runs, and
+ *  which blocks are the expensive ones.
+ *
+ *  @code
+ *  AudioCallbackHarness::Config cfg;
+ *  cfg.block_size = 4;
+ *  AudioCallbackHarness harness(cfg);
+ *
+ *  auto in  = AudioCallbackHarness::Sine(440.f, 0.5f, 48000, 2, 48000.f);
+ *  AudioCallbackHarness::Signal out;
+ *  auto report = harness.Run(MyAudioCallback, in, out);
+ *  AudioCallbackHarness::WriteWav("out.wav", out, cfg.samplerate);
+ *  @endcode
+ */
+class AudioCallbackHarness
+{
+  public:
+    /** One vector of samples per channel, all of the same length */
+    using Signal = std::vector<std::vector<float>>;
+
+    struct Config
+    {
+        /** frames per second, only used for the simulated time */
+        float samplerate = 48000.f;
+        /** frames per callback */
+        size_t block_size = 48;
+        /** channels passed to the callback, 2 or 4 like the AudioHandle */
+        size_t channels = 2;
+        /** clocks of the simulated System, as at the default 400MHz */
+        uint32_t tick_freq = 200000000;
+        uint32_t cpu_freq  = 400000000;
+    };
+
+    /** Timing of one Run() */
+    struct Report
+    {
+        size_t blocks = 0;
+        size_t frames = 0;
+        /** real time budget of one block in seconds */
+        double budget_seconds = 0.0;
+        /** host time per callback, in seconds */
+        double min_seconds  = 0.0;
+        double mean_seconds = 0.0;
+        double max_seconds  = 0.0;
+        /** host time of each callback, in seconds */
+        std::vector<double> block_seconds;
+
+        /** mean and worst callback time in parts of the budget */
+        double MeanLoad() const
+        {
+            return budget_seconds > 0.0 ? mean_seconds / budget_seconds : 0.0;
+        }
+        double MaxLoad() const
+        {
+            return budget_seconds > 0.0 ? max_seconds / budget_seconds : 0.0;
+        }
+    };
+
+    AudioCallbackHarness() {}
+    explicit AudioCallbackHarness(const Config& config) : config_(config) {}
+
+    const Config& GetConfig() const { return config_; }
+
+    /** Feeds the input through a non-interleaving callback.
+     *  Channels missing from the input are silent, and the last block is
+     *  padded with silence. The output has the input's length.
+     */
+    Report Run(AudioHandle::AudioCallback cb, const Signal& in, Signal& out)
+    {
+        const size_t        chns = config_.channels;
+        const size_t        bs   = config_.block_size;
+        std::vector<float>  in_block(chns * bs), out_block(chns * bs);
+        std::vector<float*> in_ptrs(chns), out_ptrs(chns);
+        for(size_t c = 0; c < chns; c++)
+        {
+            in_ptrs[c]  = in_block.data() + c * bs;
+            out_ptrs[c] = out_block.data() + c * bs;
+        }
+        return RunBlocks(in, out, [&](size_t start, size_t frames) {
+            for(size_t c = 0; c < chns; c++)
+                for(size_t i = 0; i < bs; i++)
+                    in_block[c * bs + i] = Sample(in, c, start + i, frames);
+            std::fill(out_block.begin(), out_block.end(), 0.f);
+            const auto t0 = Clock::now();
+            cb(in_ptrs.data(), out_ptrs.data(), bs);
+            const auto t1 = Clock::now();
+            for(size_t c = 0; c < chns; c++)
+                for(size_t i = 0; i < bs && start + i < frames; i++)
+                    out[c][start + i] = out_block[c * bs + i];
+            return std::chrono::duration<double>(t1 - t0).count();
+        });
+    }
+
+    /** Feeds the input through an interleaving callback. size is the
+     *  number of samples of all channels, as with the AudioHandle.
+     */
+    Report Run(AudioHandle::InterleavingAudioCallback cb,
+               const Signal&                          in,
+               Signal&                                out)
+    {
+        const size_t       chns = config_.channels;
+        const size_t       bs   = config_.block_size;
+        std::vector<float> in_block(chns * bs), out_block(chns * bs);
+        return RunBlocks(in, out, [&](size_t start, size_t frames) {
+            for(size_t i = 0; i < bs; i++)
+                for(size_t c = 0; c < chns; c++)
+                    in_block[i * chns + c] = Sample(in, c, start + i, frames);
+            std::fill(out_block.begin(), out_block.end(), 0.f);
+            const auto t0 = Clock::now();
+            cb(in_block.data(), out_block.data(), chns * bs);
+            const auto t1 = Clock::now();
+            for(size_t i = 0; i < bs && start + i < frames; i++)
+                for(size_t c = 0; c < chns; c++)
+                    out[c][start + i] = out_block[i * chns + c];
+            return std::chrono::duration<double>(t1 - t0).count();
+        });
+    }
+
+    /** Sets the simulated System to the time of a frame */
+    void SetTimeForFrame(size_t frame) const
+    {
+        // the counters wrap around like the hardware's 32 bit ones
+        const double t = double(frame) / config_.samplerate;
+        System::SetUsForUnitTest(uint32_t(std::llround(t * 1e6)));
+        System::SetTickForUnitTest(
+            uint32_t(std::llround(t * config_.tick_freq)));
+        System::SetCycleCountForUnitTest(
+            uint32_t(std::llround(t * config_.cpu_freq)));
+    }
+
+    /** Prints the timing of a run */
+    static void PrintReport(const Report& report, std::FILE* f = stdout)
+    {
+        std::fprintf(f,
+                     "%zu blocks: min %.2fus, mean %.2fus, max %.2fus, "
+                     "budget %.2fus (mean %.1f%%, max %.1f%% host time)\n",
+                     report.blocks,
+                     report.min_seconds * 1e6,
+                     report.mean_seconds * 1e6,
+                     report.max_seconds * 1e6,
+                     report.budget_seconds * 1e6,
+                     report.MeanLoad() * 100.0,
+                     report.MaxLoad() * 100.0);
+    }
+
+    /** Generated signals, the same on every channel */
+    static Signal Silence(size_t frames, size_t channels)
+    {
+        return Signal(channels, std::vector<float>(frames, 0.f));
+    }
+
+    static Signal Sine(float  freq,
+                       float  amp,
+                       size_t frames,
+                       size_t channels,
+                       float  samplerate)
+    {
+        Signal s = Silence(frames, channels);
+        for(size_t i = 0; i < frames; i++)
+        {
+            const float v
+                = amp * std::sin(6.28318530718f * freq * i / samplerate);
+            for(auto& chn : s)
+                chn[i] = v;
+        }
+        return s;
+    }
+
+    static Signal
+    Impulse(size_t frames, size_t channels, size_t at = 0, float amp = 1.f)
+    {
+        Signal s = Silence(frames, channels);
+        if(at < frames)
+            for(auto& chn : s)
+                chn[at] = amp;
+        return s;
+    }
+
+    /** Uniform noise between -amp and amp, repeatable for a seed */
+    static Signal
+    Noise(size_t frames, size_t channels, float amp = 1.f, uint32_t seed = 1)
+    {
+        Signal s = Silence(frames, channels);
+        for(size_t i = 0; i < frames; i++)
+        {
+            seed          = seed * 1664525u + 1013904223u;
+            const float v = amp * (float(seed >> 8) / 8388608.f - 1.f);
+            for(auto& chn : s)
+                chn[i] = v;
+        }
+        return s;
+    }
+
+    /** Loads a WAV file, 16, 24 or 32 bit PCM, or 32 bit float.
+     *  \param samplerate if not null, set to the file's samplerate
+     *  \return false if the file can't be read or has another format
+     */
+    static bool
+    ReadWav(const std::string& path, Signal& out, float* samplerate = nullptr)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if(f == nullptr)
+            return false;
+        std::vector<uint8_t> file;
+        uint8_t              buf[4096];
+        size_t               n;
+        while((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+            file.insert(file.end(), buf, buf + n);
+        std::fclose(f);
+
+        if(file.size() < 12 || Read32(&file[0]) != kWavFileChunkId
+           || Read32(&file[8]) != kWavFileWaveId)
+            return false;
+        uint16_t format = 0, chns = 0, bits = 0;
+        uint32_t sr = 0;
+        size_t   pos = 12;
+        while(pos + 8 <= file.size())
+        {
+            const uint32_t id   = Read32(&file[pos]);
+            const size_t   size = Read32(&file[pos + 4]);
+            const uint8_t* body = &file[pos + 8];
+            if(pos + 8 + size > file.size())
+                return false;
+            if(id == kWavFileSubChunk1Id && size >= 16)
+            {
+                format = Read16(body);
+                chns   = Read16(body + 2);
+                sr     = Read32(body + 4);
+                bits   = Read16(body + 14);
+                // the format code is the start of the extensible sub format
+                if(format == WAVE_FORMAT_EXTENSIBLE && size >= 26)
+                    format = Read16(body + 24);
+            }
+            else if(id == kWavFileSubChunk2Id)
+            {
+                if(chns == 0 || !DecodeWav(format, bits, chns, body, size, out))
+                    return false;
+                if(samplerate != nullptr)
+                    *samplerate = float(sr);
+                return true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        return false;
+    }
+
+    /** Writes a signal as a 32 bit float WAV file */
+    static bool
+    WriteWav(const std::string& path, const Signal& in, float samplerate)
+    {
+        const uint16_t    chns   = uint16_t(in.size());
+        const size_t      frames = chns > 0 ? in[0].size() : 0;
+        const uint32_t    data   = uint32_t(frames * chns * sizeof(float));
+        WAV_FormatTypeDef header;
+        header.ChunkId       = kWavFileChunkId;
+        header.FileSize      = uint32_t(sizeof(header) - 8 + data);
+        header.FileFormat    = kWavFileWaveId;
+        header.SubChunk1ID   = kWavFileSubChunk1Id;
+        header.SubChunk1Size = 16;
+        header.AudioFormat   = WAVE_FORMAT_IEEE_FLOAT;
+        header.NbrChannels   = chns;
+        header.SampleRate    = uint32_t(samplerate);
+        header.BitPerSample  = 32;
+        header.BlockAlign    = uint16_t(chns * sizeof(float));
+        header.ByteRate      = header.SampleRate * header.BlockAlign;
+        header.SubChunk2ID   = kWavFileSubChunk2Id;
+        header.SubCHunk2Size = data;
+
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if(f == nullptr)
+            return false;
+        bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+        for(size_t i = 0; i < frames && ok; i++)
+            for(size_t c = 0; c < chns && ok; c++)
+                ok = std::fwrite(&in[c][i], sizeof(float), 1, f) == 1;
+        return std::fclose(f) == 0 && ok;
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    template <typename ProcessBlock>
+    Report RunBlocks(const Signal& in, Signal& out, ProcessBlock process)
+    {
+        const size_t frames = in.empty() ? 0 : in[0].size();
+        const size_t bs     = config_.block_size;
+        out = Silence(frames, config_.channels);
+
+        System::SetTickFreqForUnitTest(config_.tick_freq);
+        System::SetSysClkFreqForUnitTest(config_.cpu_freq);
+
+        Report report;
+        report.frames         = frames;
+        report.budget_seconds = double(bs) / config_.samplerate;
+        double total          = 0.0;
+        for(size_t start = 0; start < frames; start += bs)
+        {
+            SetTimeForFrame(start);
+            const double t = process(start, frames);
+            report.block_seconds.push_back(t);
+            total += t;
+        }
+        report.blocks = report.block_seconds.size();
+        if(report.blocks > 0)
+        {
+            report.min_seconds = *std::min_element(report.block_seconds.begin(),
+                                                   report.block_seconds.end());
+            report.max_seconds = *std::max_element(report.block_seconds.begin(),
+                                                   report.block_seconds.end());
+            report.mean_seconds = total / report.blocks;
+        }
+        return report;
+    }
+
+    static float
+    Sample(const Signal& in, size_t chn, size_t frame, size_t frames)
+    {
+        return chn < in.size() && frame < frames ? in[chn][frame] : 0.f;
+    }
+
+    static uint16_t Read16(const uint8_t* p)
+    {
+        return uint16_t(p[0] | (p[1] << 8));
+    }
+
+    static uint32_t Read32(const uint8_t* p)
+    {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16)
+               | (uint32_t(p[3]) << 24);
+    }
+
+    static bool DecodeWav(uint16_t       format,
+                          uint16_t       bits,
+                          uint16_t       chns,
+                          const uint8_t* data,
+                          size_t         size,
+                          Signal&        out)
+    {
+        const size_t bytes = bits / 8;
+        const bool   pcm   = format == WAVE_FORMAT_PCM
+                         && (bits == 16 || bits == 24 || bits == 32);
+        const bool flt = format == WAVE_FORMAT_IEEE_FLOAT && bits == 32;
+        if(!pcm && !flt)
+            return false;
+        const size_t frames = size / (bytes * chns);
+        out                 = Silence(frames, chns);
+        for(size_t i = 0; i < frames; i++)
+        {
+            for(size_t c = 0; c < chns; c++)
+            {
+                const uint8_t* p = data + (i * chns + c) * bytes;
+                float          v;
+                if(flt)
+                {
+                    const uint32_t word = Read32(p);
+                    std::memcpy(&v, &word, sizeof(v));
+                }
+                else
+                {
+                    // sign extend from the top byte of a 32 bit word
+                    uint32_t word = 0;
+                    for(size_t b = 0; b < bytes; b++)
+                        word |= uint32_t(p[b]) << (8 * (4 - bytes + b));
+                    v = float(int32_t(word)) / 2147483648.f;
+                }
+                out[c][i] = v;
+            }
+        }
+        return true;
+    }
+
+    Config config_;
+};
+
+} // namespace daisy
@@ -0,0 +1,150 @@
+#include "AudioCallbackHarness.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+std::vector<uint32_t> callback_us;
+std::vector<size_t>   callback_sizes;
+
+void PassThrough(AudioHandle::InputBuffer  in,
+                 AudioHandle::OutputBuffer out,
+                 size_t                    size)
+{
+    callback_us.push_back(System::GetUs());
+    callback_sizes.push_back(size);
+    for(size_t i = 0; i < size; i++)
+    {
+        out[0][i] = in[0][i];
+        out[1][i] = in[1][i];
+    }
+}
+
+void SwapAndHalve(AudioHandle::InterleavingInputBuffer  in,
+                  AudioHandle::InterleavingOutputBuffer out,
+                  size_t                                size)
+{
+    callback_sizes.push_back(size);
+    for(size_t i = 0; i < size; i += 2)
+    {
+        out[i]     = in[i + 1] * 0.5f;
+        out[i + 1] = in[i] * 0.5f;
+    }
+}
+} // namespace
+
+TEST(util_AudioCallbackHarness, a_passThroughKeepsTheInput)
+{
+    callback_us.clear();
+    callback_sizes.clear();
+    AudioCallbackHarness::Config cfg;
+    cfg.block_size = 16;
+    AudioCallbackHarness harness(cfg);
+
+    // not a whole number of blocks, the last one is padded
+    auto in = AudioCallbackHarness::Noise(100, 2, 0.9f, 7);
+    in[1]   = AudioCallbackHarness::Sine(440.f, 0.5f, 100, 1, 48000.f)[0];
+    AudioCallbackHarness::Signal out;
+    const auto report = harness.Run(PassThrough, in, out);
+
+    EXPECT_EQ(report.blocks, 7u);
+    EXPECT_EQ(report.frames, 100u);
+    EXPECT_EQ(report.block_seconds.size(), 7u);
+    EXPECT_DOUBLE_EQ(report.budget_seconds, 16.0 / 48000.0);
+    EXPECT_LE(report.min_seconds, report.mean_seconds);
+    EXPECT_LE(report.mean_seconds, report.max_seconds);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out, in);
+    for(const auto size : callback_sizes)
+        EXPECT_EQ(size, 16u);
+}
+
+TEST(util_AudioCallbackHarness, b_systemTimeFollowsTheBlocks)
+{
+    callback_us.clear();
+    AudioCallbackHarness::Config cfg;
+    cfg.block_size = 48;
+    AudioCallbackHarness harness(cfg);
+    AudioCallbackHarness::Signal out;
+    harness.Run(PassThrough, AudioCallbackHarness::Silence(480, 2), out);
+
+    ASSERT_EQ(callback_us.size(), 10u);
+    for(size_t i = 0; i < callback_us.size(); i++)
+        EXPECT_EQ(callback_us[i], i * 1000u); // 1ms per block
+    EXPECT_EQ(System::GetTickFreq(), cfg.tick_freq);
+    EXPECT_EQ(System::GetTick(), 9u * 200000u);
+}
+
+TEST(util_AudioCallbackHarness, c_interleavingCallback)
+{
+    callback_sizes.clear();
+    AudioCallbackHarness::Config cfg;
+    cfg.block_size = 4;
+    AudioCallbackHarness harness(cfg);
+
+    auto in = AudioCallbackHarness::Impulse(10, 2, 3);
+    in[1][5] = -1.f;
+    AudioCallbackHarness::Signal out;
+    harness.Run(SwapAndHalve, in, out);
+
+    ASSERT_EQ(callback_sizes.size(), 3u);
+    EXPECT_EQ(callback_sizes[0], 8u); // samples of both channels
+    for(size_t i = 0; i < 10; i++)
+    {
+        EXPECT_FLOAT_EQ(out[0][i], in[1][i] * 0.5f);
+        EXPECT_FLOAT_EQ(out[1][i], in[0][i] * 0.5f);
+    }
+}
+
+TEST(util_AudioCallbackHarness, d_wavRoundTrip)
+{
+    const std::string path = "AudioCallbackHarness_gtest_d.wav";
+    auto sig = AudioCallbackHarness::Sine(1000.f, 0.25f, 256, 2, 44100.f);
+    sig[1]   = AudioCallbackHarness::Noise(256, 1, 0.5f)[0];
+    ASSERT_TRUE(AudioCallbackHarness::WriteWav(path, sig, 44100.f));
+
+    AudioCallbackHarness::Signal read;
+    float                        sr = 0.f;
+    ASSERT_TRUE(AudioCallbackHarness::ReadWav(path, read, &sr));
+    std::remove(path.c_str());
+    EXPECT_FLOAT_EQ(sr, 44100.f);
+    EXPECT_EQ(read, sig);
+}
+
+TEST(util_AudioCallbackHarness, e_readsPcm16)
+{
+    const std::string path = "AudioCallbackHarness_gtest_e.wav";
+    const int16_t     samples[4] = {16384, -16384, 32767, -32768};
+    WAV_FormatTypeDef header;
+    header.ChunkId       = kWavFileChunkId;
+    header.FileSize      = sizeof(header) - 8 + sizeof(samples);
+    header.FileFormat    = kWavFileWaveId;
+    header.SubChunk1ID   = kWavFileSubChunk1Id;
+    header.SubChunk1Size = 16;
+    header.AudioFormat   = WAVE_FORMAT_PCM;
+    header.NbrChannels   = 1;
+    header.SampleRate    = 48000;
+    header.ByteRate      = 96000;
+    header.BlockAlign    = 2;
+    header.BitPerSample  = 16;
+    header.SubChunk2ID   = kWavFileSubChunk2Id;
+    header.SubCHunk2Size = sizeof(samples);
+    std::FILE* f         = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    std::fwrite(&header, sizeof(header), 1, f);
+    std::fwrite(samples, sizeof(samples), 1, f);
+    std::fclose(f);
+
+    AudioCallbackHarness::Signal read;
+    ASSERT_TRUE(AudioCallbackHarness::ReadWav(path, read));
+    std::remove(path.c_str());
+    ASSERT_EQ(read.size(), 1u);
+    ASSERT_EQ(read[0].size(), 4u);
+    EXPECT_FLOAT_EQ(read[0][0], 0.5f);
+    EXPECT_FLOAT_EQ(read[0][1], -0.5f);
+    EXPECT_FLOAT_EQ(read[0][2], 32767.f / 32768.f);
+    EXPECT_FLOAT_EQ(read[0][3], -1.f);
+
+    EXPECT_FALSE(AudioCallbackHarness::ReadWav("no_such_file.wav", read));
+}
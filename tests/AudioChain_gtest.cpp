@@ -0,0 +1,110 @@
+#include "hid/audio_chain.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Appends its id to the log in its context, and adds 1 to each sample */
+struct Tag
+{
+    int               id;
+    std::vector<int>* log;
+};
+
+void Mark(float* const* buf, size_t size, void* context)
+{
+    auto* tag = static_cast<Tag*>(context);
+    tag->log->push_back(tag->id);
+    for(size_t c = 0; c < 2; c++)
+        for(size_t i = 0; i < size; i++)
+            buf[c][i] += 1.f;
+}
+
+void Double(float* const* buf, size_t size, void*)
+{
+    for(size_t c = 0; c < 2; c++)
+        for(size_t i = 0; i < size; i++)
+            buf[c][i] *= 2.f;
+}
+} // namespace
+
+TEST(hid_AudioChain, a_runsStagesInOrderInPlace)
+{
+    std::vector<int> log;
+    Tag              t1{1, &log}, t2{2, &log};
+    AudioChain       chain;
+    EXPECT_TRUE(chain.Add(Mark, &t1));
+    EXPECT_TRUE(chain.Add(Double));
+    EXPECT_TRUE(chain.Add(Mark, &t2));
+    EXPECT_EQ(chain.GetNumStages(), 3u);
+
+    float  left[4] = {0.f, 1.f, 2.f, 3.f}, right[4] = {-1.f, -1.f, -1.f, -1.f};
+    float* buf[2]  = {left, right};
+    chain.Process(buf, 4);
+
+    EXPECT_EQ(log, (std::vector<int>{1, 2}));
+    // (x + 1) * 2 + 1
+    EXPECT_FLOAT_EQ(left[0], 3.f);
+    EXPECT_FLOAT_EQ(left[3], 9.f);
+    EXPECT_FLOAT_EQ(right[2], 1.f);
+}
+
+TEST(hid_AudioChain, b_insertAndRemove)
+{
+    std::vector<int> log;
+    Tag              t1{1, &log}, t2{2, &log}, t3{3, &log};
+    AudioChain       chain;
+    chain.Add(Mark, &t1);
+    chain.Add(Mark, &t3);
+    EXPECT_TRUE(chain.Insert(1, Mark, &t2));
+    EXPECT_TRUE(chain.Insert(0, Double));
+    EXPECT_FALSE(chain.Insert(5, Double));
+    EXPECT_TRUE(chain.Contains(Mark, &t2));
+    EXPECT_TRUE(chain.Contains(Double));
+
+    float  l[1] = {0.f}, r[1] = {0.f};
+    float* buf[2] = {l, r};
+    chain.Process(buf, 1);
+    EXPECT_EQ(log, (std::vector<int>{1, 2, 3}));
+
+    // the same function with another context is another stage
+    EXPECT_TRUE(chain.Remove(Mark, &t2));
+    EXPECT_FALSE(chain.Remove(Mark, &t2));
+    EXPECT_FALSE(chain.Contains(Mark, &t2));
+    EXPECT_TRUE(chain.Contains(Mark, &t1));
+    EXPECT_EQ(chain.GetNumStages(), 3u);
+
+    log.clear();
+    chain.Process(buf, 1);
+    EXPECT_EQ(log, (std::vector<int>{1, 3}));
+}
+
+TEST(hid_AudioChain, c_rejectsNullAndFullChains)
+{
+    AudioChain chain;
+    EXPECT_FALSE(chain.Add(nullptr));
+    for(size_t i = 0; i < DSY_AUDIO_CHAIN_MAX_STAGES; i++)
+        EXPECT_TRUE(chain.Add(Double));
+    EXPECT_FALSE(chain.Add(Double));
+    EXPECT_EQ(chain.GetNumStages(), size_t(DSY_AUDIO_CHAIN_MAX_STAGES));
+
+    // the duplicates are removed one at a time
+    EXPECT_TRUE(chain.Remove(Double));
+    EXPECT_EQ(chain.GetNumStages(), size_t(DSY_AUDIO_CHAIN_MAX_STAGES - 1));
+    chain.Clear();
+    EXPECT_EQ(chain.GetNumStages(), 0u);
+    EXPECT_FALSE(chain.Contains(Double));
+}
+
+TEST(hid_AudioChain, d_emptyChainPassesThrough)
+{
+    AudioChain chain;
+    float      l[2] = {0.25f, -0.5f}, r[2] = {1.f, 0.f};
+    float*     buf[2] = {l, r};
+    chain.Process(buf, 2);
+    EXPECT_FLOAT_EQ(l[0], 0.25f);
+    EXPECT_FLOAT_EQ(l[1], -0.5f);
+    EXPECT_FLOAT_EQ(r[0], 1.f);
+}
@@ -0,0 +1,333 @@
+#include "hid/audio_convert.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace daisy;
+
+namespace
+{
+/** fills a buffer with samples covering the full range,
+ *  laid out like the SAI delivers them (unused upper bits cleared). */
+void FillRaw(int32_t* buf, size_t size, int bits)
+{
+    const uint32_t mask  = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1u;
+    uint32_t       state = 12345;
+    for(size_t i = 0; i < size; i++)
+    {
+        state  = state * 1664525u + 1013904223u;
+        buf[i] = (int32_t)(state & mask);
+    }
+    buf[0] = (int32_t)(mask >> 1);        // most positive
+    buf[1] = (int32_t)((mask >> 1) + 1u); // most negative
+    buf[2] = 0;
+    buf[3] = (int32_t)mask; // -1 LSB
+}
+
+void FillFloat(float* buf, size_t size)
+{
+    uint32_t state = 54321;
+    for(size_t i = 0; i < size; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        // -1.5 .. 1.5 so that the clipping gets tested too
+        buf[i] = (float(state >> 8) / float(1 << 24)) * 3.0f - 1.5f;
+    }
+    buf[0] = 0.0f;
+    buf[1] = 1.0f;
+    buf[2] = -1.0f;
+}
+
+bool BitEqual(float a, float b)
+{
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// The reference implementations from daisy_core.h
+template <int Bits>
+float RefToFloat(int32_t x);
+template <>
+float RefToFloat<16>(int32_t x)
+{
+    return s162f((int16_t)x);
+}
+template <>
+float RefToFloat<24>(int32_t x)
+{
+    return s242f(x);
+}
+template <>
+float RefToFloat<32>(int32_t x)
+{
+    return s322f(x);
+}
+
+template <int Bits>
+int32_t RefFromFloat(float x);
+template <>
+int32_t RefFromFloat<16>(float x)
+{
+    return f2s16(x);
+}
+template <>
+int32_t RefFromFloat<24>(float x)
+{
+    return f2s24(x);
+}
+template <>
+int32_t RefFromFloat<32>(float x)
+{
+    return f2s32(x);
+}
+
+template <int Bits>
+void TestDeinterleave()
+{
+    // 19 frames to exercise both the unrolled and the remainder loop
+    constexpr size_t kFrames = 19;
+    int32_t          in[kFrames * 2];
+    float            l[kFrames], r[kFrames];
+    float*           out[2] = {l, r};
+    FillRaw(in, kFrames * 2, Bits);
+
+    for(const float gain : {1.0f, 0.5f, 1.f / 3.f})
+    {
+        audio_convert::DeinterleaveStereo<Bits>(in, out, kFrames, gain);
+        for(size_t i = 0; i < kFrames; i++)
+        {
+            EXPECT_TRUE(BitEqual(l[i], RefToFloat<Bits>(in[i * 2]) * gain));
+            EXPECT_TRUE(
+                BitEqual(r[i], RefToFloat<Bits>(in[i * 2 + 1]) * gain));
+        }
+    }
+}
+
+template <int Bits>
+void TestInterleave()
+{
+    constexpr size_t kFrames = 19;
+    float            l[kFrames], r[kFrames];
+    const float*     in[2] = {l, r};
+    int32_t          out[kFrames * 2];
+    FillFloat(l, kFrames);
+    FillFloat(r, kFrames);
+    r[5] = 0.75f;
+
+    for(const float gain : {1.0f, 2.0f, 0.7f})
+    {
+        audio_convert::InterleaveStereo<Bits>(in, out, kFrames, gain);
+        for(size_t i = 0; i < kFrames; i++)
+        {
+            EXPECT_EQ(out[i * 2], RefFromFloat<Bits>(l[i] * gain));
+            EXPECT_EQ(out[i * 2 + 1], RefFromFloat<Bits>(r[i] * gain));
+        }
+    }
+}
+
+template <int Bits>
+void TestBlocks()
+{
+    constexpr size_t kSize = 38;
+    int32_t          raw[kSize];
+    float            f[kSize];
+    int32_t          out[kSize];
+    FillRaw(raw, kSize, Bits);
+
+    audio_convert::ToFloatBlock<Bits>(raw, f, kSize, 0.5f);
+    for(size_t i = 0; i < kSize; i++)
+        EXPECT_TRUE(BitEqual(f[i], RefToFloat<Bits>(raw[i]) * 0.5f));
+
+    FillFloat(f, kSize);
+    audio_convert::FromFloatBlock<Bits>(f, out, kSize, 1.25f);
+    for(size_t i = 0; i < kSize; i++)
+        EXPECT_EQ(out[i], RefFromFloat<Bits>(f[i] * 1.25f));
+}
+template <int Bits>
+void TestMultichannel(size_t channels)
+{
+    constexpr size_t kFrames      = 5;
+    constexpr size_t kMaxChannels = 16;
+    int32_t          raw[kFrames * kMaxChannels];
+    int32_t          out[kFrames * kMaxChannels];
+    float            buff[kMaxChannels][kFrames];
+    float*           chans[kMaxChannels];
+    for(size_t c = 0; c < kMaxChannels; c++)
+        chans[c] = buff[c];
+    FillRaw(raw, kFrames * channels, Bits);
+
+    audio_convert::Deinterleave<Bits>(raw, chans, channels, kFrames, 0.5f);
+    for(size_t i = 0; i < kFrames; i++)
+        for(size_t c = 0; c < channels; c++)
+        {
+            const float expected = RefToFloat<Bits>(raw[i * channels + c]);
+            EXPECT_TRUE(BitEqual(buff[c][i], expected * 0.5f));
+        }
+
+    audio_convert::Interleave<Bits>(chans, out, channels, kFrames, 2.0f);
+    for(size_t i = 0; i < kFrames; i++)
+        for(size_t c = 0; c < channels; c++)
+            EXPECT_EQ(out[i * channels + c],
+                      RefFromFloat<Bits>(buff[c][i] * 2.0f));
+}
+
+/** the pair kernels must match two stereo conversions */
+template <int Bits>
+void TestStereoPair()
+{
+    // odd, to exercise the remainder
+    constexpr size_t kFrames = 19;
+    int32_t          in1[kFrames * 2], in2[kFrames * 2];
+    float            buff[4][kFrames], ref[4][kFrames];
+    float*           chans[4] = {buff[0], buff[1], buff[2], buff[3]};
+    float*           refs[4]  = {ref[0], ref[1], ref[2], ref[3]};
+    FillRaw(in1, kFrames * 2, Bits);
+    FillRaw(in2, kFrames * 2, Bits);
+    in2[7] = 42;
+
+    audio_convert::DeinterleaveStereoPair<Bits>(
+        in1, in2, chans, kFrames, 0.5f);
+    audio_convert::DeinterleaveStereo<Bits>(in1, refs, kFrames, 0.5f);
+    audio_convert::DeinterleaveStereo<Bits>(in2, refs + 2, kFrames, 0.5f);
+    for(size_t c = 0; c < 4; c++)
+        for(size_t i = 0; i < kFrames; i++)
+            EXPECT_TRUE(BitEqual(buff[c][i], ref[c][i]));
+
+    int32_t out1[kFrames * 2], out2[kFrames * 2];
+    int32_t ref1[kFrames * 2], ref2[kFrames * 2];
+    for(size_t c = 0; c < 4; c++)
+        FillFloat(buff[c], kFrames);
+    buff[3][4] = 0.75f;
+    audio_convert::InterleaveStereoPair<Bits>(
+        chans, out1, out2, kFrames, 1.25f);
+    audio_convert::InterleaveStereo<Bits>(chans, ref1, kFrames, 1.25f);
+    audio_convert::InterleaveStereo<Bits>(chans + 2, ref2, kFrames, 1.25f);
+    for(size_t i = 0; i < kFrames * 2; i++)
+    {
+        EXPECT_EQ(out1[i], ref1[i]);
+        EXPECT_EQ(out2[i], ref2[i]);
+    }
+}
+} // namespace
+
+TEST(hid_AudioConvert, a_deinterleaveMatchesReference)
+{
+    TestDeinterleave<16>();
+    TestDeinterleave<24>();
+    TestDeinterleave<32>();
+}
+
+TEST(hid_AudioConvert, b_interleaveMatchesReference)
+{
+    TestInterleave<16>();
+    TestInterleave<24>();
+    TestInterleave<32>();
+}
+
+TEST(hid_AudioConvert, c_interleavedBlocksMatchReference)
+{
+    TestBlocks<16>();
+    TestBlocks<24>();
+    TestBlocks<32>();
+}
+
+TEST(hid_AudioConvert, d_roundTrip)
+{
+    constexpr size_t kSize = 16;
+    int32_t          raw[kSize];
+    float            f[kSize];
+    int32_t          out[kSize];
+    for(size_t i = 0; i < kSize; i++)
+        raw[i] = (int32_t(i) - 8) * 100000;
+
+    audio_convert::ToFloatBlock<24>(raw, f, kSize, 1.0f);
+    audio_convert::FromFloatBlock<24>(f, out, kSize, 1.0f);
+    for(size_t i = 0; i < kSize; i++)
+        EXPECT_EQ(out[i], raw[i]);
+}
+
+TEST(hid_AudioConvert, e_multichannelMatchesReference)
+{
+    // TDM slot counts, with and without a remainder after unrolling
+    for(const size_t channels : {1, 2, 6, 8, 16})
+    {
+        TestMultichannel<16>(channels);
+        TestMultichannel<24>(channels);
+        TestMultichannel<32>(channels);
+    }
+}
+
+TEST(hid_AudioConvert, f_stereoPairMatchesTwoStereo)
+{
+    TestStereoPair<16>();
+    TestStereoPair<24>();
+    TestStereoPair<32>();
+}
+
+TEST(hid_AudioConvert, g_metersWhileConverting)
+{
+    // 7 frames, so the remainder after unrolling is metered too
+    constexpr size_t kFrames = 7;
+    int32_t          raw[kFrames * 2];
+    float            left[kFrames], right[kFrames];
+    float*           chans[2] = {left, right};
+    FillRaw(raw, kFrames * 2, 24);
+
+    audio_convert::LevelMeter meter;
+    meter.Reset(2);
+    audio_convert::DeinterleaveStereo<24>(raw, chans, kFrames, 0.5f, meter);
+    float peak[2] = {0.f, 0.f}, sum[2] = {0.f, 0.f};
+    for(size_t i = 0; i < kFrames; i++)
+    {
+        // the samples are the same as without a meter
+        EXPECT_TRUE(BitEqual(left[i], RefToFloat<24>(raw[2 * i]) * 0.5f));
+        peak[0] = std::max(peak[0], std::fabs(left[i]));
+        peak[1] = std::max(peak[1], std::fabs(right[i]));
+        sum[0] += left[i] * left[i];
+        sum[1] += right[i] * right[i];
+    }
+    for(size_t c = 0; c < 2; c++)
+    {
+        EXPECT_FLOAT_EQ(meter.peak[c], peak[c]);
+        EXPECT_FLOAT_EQ(meter.sum_sq[c], sum[c]);
+    }
+    // the most negative sample, halved
+    EXPECT_FLOAT_EQ(meter.peak[1], 0.5f);
+
+    // the output is metered before the gain, and keeps adding up
+    int32_t out[kFrames * 2];
+    audio_convert::LevelMeter out_meter;
+    out_meter.Reset(2);
+    audio_convert::InterleaveStereo<24>(chans, out, kFrames, 4.f, out_meter);
+    audio_convert::InterleaveStereo<24>(chans, out, kFrames, 4.f, out_meter);
+    EXPECT_FLOAT_EQ(out_meter.peak[0], peak[0]);
+    EXPECT_FLOAT_EQ(out_meter.sum_sq[1], 2.f * sum[1]);
+}
+
+TEST(hid_AudioConvert, h_metersInterleavedAndMultichannel)
+{
+    // an interleaved TDM block of 4 slots, slot 2 is silent
+    constexpr size_t kFrames = 5, kSlots = 4;
+    float            in[kFrames * kSlots];
+    int32_t          out[kFrames * kSlots];
+    for(size_t i = 0; i < kFrames * kSlots; i++)
+        in[i] = i % kSlots == 2 ? 0.f : 0.25f * float(i % kSlots);
+
+    audio_convert::LevelMeter meter;
+    meter.Reset(kSlots);
+    audio_convert::FromFloatBlock<24>(in, out, kFrames * kSlots, 1.f, meter);
+    EXPECT_FLOAT_EQ(meter.peak[0], 0.f);
+    EXPECT_FLOAT_EQ(meter.peak[1], 0.25f);
+    EXPECT_FLOAT_EQ(meter.peak[2], 0.f);
+    EXPECT_FLOAT_EQ(meter.peak[3], 0.75f);
+    EXPECT_FLOAT_EQ(meter.sum_sq[3], kFrames * 0.75f * 0.75f);
+
+    // the same block, deinterleaved
+    float  chan_buf[kSlots][kFrames];
+    float* chans[kSlots] = {chan_buf[0], chan_buf[1], chan_buf[2], chan_buf[3]};
+    audio_convert::LevelMeter multi;
+    multi.Reset(kSlots);
+    audio_convert::Deinterleave<24>(out, chans, kSlots, kFrames, 1.f, multi);
+    for(size_t c = 0; c < kSlots; c++)
+        EXPECT_NEAR(multi.peak[c], meter.peak[c], 1e-6f);
+}
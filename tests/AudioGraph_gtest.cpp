@@ -0,0 +1,174 @@
+#include "hid/audio_graph.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Scales its input, and takes a set number of "cycles" */
+class Gain : public AudioNode
+{
+  public:
+    Gain(float gain, uint32_t cost = 0) : gain_(gain), cost_(cost) {}
+
+    void
+    Process(const float* const* in, float* const* out, size_t size) override
+    {
+        for(size_t i = 0; i < size; i++)
+            out[0][i] = in[0][i] * gain_;
+        System::SetCycleCountForUnitTest(System::GetCycleCount() + cost_);
+        calls_++;
+    }
+
+    float    gain_;
+    uint32_t cost_;
+    int      calls_ = 0;
+};
+
+/** Adds its two inputs to the first output, subtracts them on the second */
+class SumDiff : public AudioNode
+{
+  public:
+    void
+    Process(const float* const* in, float* const* out, size_t size) override
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            out[0][i] = in[0][i] + in[1][i];
+            out[1][i] = in[0][i] - in[1][i];
+        }
+    }
+};
+
+struct Buffers
+{
+    explicit Buffers(size_t size) : l(size), r(size), out_l(size), out_r(size)
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            l[i] = float(i);
+            r[i] = 100.f + i;
+        }
+        ins[0]  = l.data();
+        ins[1]  = r.data();
+        outs[0] = out_l.data();
+        outs[1] = out_r.data();
+    }
+    std::vector<float> l, r, out_l, out_r;
+    const float*       ins[2];
+    float*             outs[2];
+};
+} // namespace
+
+TEST(hid_AudioGraph, a_chain)
+{
+    AudioGraph<4, 8> graph;
+    Gain             half(0.5f), twice(2.f), triple(3.f);
+    const int        a = graph.AddNode(&half, 1, 1, "half");
+    const int        b = graph.AddNode(&twice, 1, 1, "twice");
+    const int        c = graph.AddNode(&triple, 1, 1, "triple");
+    EXPECT_TRUE(graph.Connect(graph.kGraph, 1, a, 0));
+    EXPECT_TRUE(graph.Connect(a, 0, b, 0));
+    EXPECT_TRUE(graph.Connect(b, 0, graph.kGraph, 0));
+    // c isn't connected to anything, but runs on silence
+    EXPECT_TRUE(graph.Connect(c, 0, graph.kGraph, 1));
+    EXPECT_FALSE(graph.IsReady());
+    ASSERT_TRUE(graph.Init());
+    EXPECT_STREQ(graph.GetName(b), "twice");
+
+    Buffers buf(8);
+    graph.Process(buf.ins, buf.outs, 8);
+    for(size_t i = 0; i < 8; i++)
+    {
+        EXPECT_FLOAT_EQ(buf.out_l[i], buf.r[i]);
+        EXPECT_FLOAT_EQ(buf.out_r[i], 0.f);
+    }
+}
+
+TEST(hid_AudioGraph, b_orderFollowsTheConnections)
+{
+    AudioGraph<4, 16> graph;
+    SumDiff           mix;
+    Gain              left(1.f), right(-1.f);
+    // added before its sources, still runs after them
+    const int m = graph.AddNode(&mix, 2, 2, "mix");
+    const int l = graph.AddNode(&left, 1, 1);
+    const int r = graph.AddNode(&right, 1, 1);
+    EXPECT_TRUE(graph.Connect(graph.kGraph, 0, l, 0));
+    EXPECT_TRUE(graph.Connect(graph.kGraph, 1, r, 0));
+    EXPECT_TRUE(graph.Connect(l, 0, m, 0));
+    EXPECT_TRUE(graph.Connect(r, 0, m, 1));
+    EXPECT_TRUE(graph.Connect(m, 0, graph.kGraph, 0));
+    EXPECT_TRUE(graph.Connect(m, 1, graph.kGraph, 1));
+    ASSERT_TRUE(graph.Init());
+    EXPECT_EQ(graph.GetNodeAt(0), l);
+    EXPECT_EQ(graph.GetNodeAt(1), r);
+    EXPECT_EQ(graph.GetNodeAt(2), m);
+    EXPECT_EQ(graph.GetNodeAt(3), -1);
+
+    Buffers buf(16);
+    graph.Process(buf.ins, buf.outs, 16);
+    for(size_t i = 0; i < 16; i++)
+    {
+        EXPECT_FLOAT_EQ(buf.out_l[i], buf.l[i] - buf.r[i]);
+        EXPECT_FLOAT_EQ(buf.out_r[i], buf.l[i] + buf.r[i]);
+    }
+}
+
+TEST(hid_AudioGraph, c_rejectsBadConnectionsAndLoops)
+{
+    AudioGraph<2, 8> graph;
+    Gain             a_gain(1.f), b_gain(1.f), c_gain(1.f);
+    const int        a = graph.AddNode(&a_gain, 1, 1);
+    const int        b = graph.AddNode(&b_gain, 1, 1);
+    EXPECT_EQ(graph.AddNode(&c_gain, 1, 1), -1); // full
+    EXPECT_FALSE(graph.Connect(a, 1, b, 0));     // no such output
+    EXPECT_FALSE(graph.Connect(a, 0, b, 1));     // no such input
+    EXPECT_FALSE(graph.Connect(5, 0, b, 0));     // no such node
+    EXPECT_FALSE(graph.Connect(a, 0, graph.kGraph, 4));
+    EXPECT_TRUE(graph.Connect(a, 0, b, 0));
+    EXPECT_FALSE(graph.Connect(graph.kGraph, 0, b, 0)); // taken
+    EXPECT_TRUE(graph.Connect(b, 0, a, 0));
+    EXPECT_TRUE(graph.Connect(b, 0, graph.kGraph, 0));
+    EXPECT_FALSE(graph.Init());
+
+    // a loop only outputs silence
+    Buffers buf(8);
+    buf.out_l[3] = 1.f;
+    graph.Process(buf.ins, buf.outs, 8);
+    EXPECT_FLOAT_EQ(buf.out_l[3], 0.f);
+    EXPECT_EQ(a_gain.calls_, 0);
+}
+
+TEST(hid_AudioGraph, d_countsCyclesPerNode)
+{
+    AudioGraph<2, 8> graph;
+    Gain             cheap(1.f, 100), dear(1.f, 1000);
+    const int        a = graph.AddNode(&cheap, 1, 1);
+    const int        b = graph.AddNode(&dear, 1, 1);
+    graph.Connect(graph.kGraph, 0, a, 0);
+    graph.Connect(a, 0, b, 0);
+    graph.Connect(b, 0, graph.kGraph, 0);
+    ASSERT_TRUE(graph.Init());
+
+    Buffers buf(24);
+    graph.Process(buf.ins, buf.outs, 8);
+    EXPECT_EQ(graph.GetStats(a)->last_cycles, 100u);
+    EXPECT_EQ(graph.GetStats(b)->last_cycles, 1000u);
+
+    // a larger block runs in parts of 8, counted as one callback
+    graph.Process(buf.ins, buf.outs, 24);
+    EXPECT_EQ(dear.calls_, 4);
+    EXPECT_EQ(graph.GetStats(b)->last_cycles, 3000u);
+    EXPECT_EQ(graph.GetStats(b)->max_cycles, 3000u);
+    EXPECT_EQ(graph.GetStats(b)->blocks, 2u);
+    EXPECT_FLOAT_EQ(graph.GetStats(b)->GetAverage(), 2000.f);
+    EXPECT_EQ(graph.GetGraphStats().last_cycles, 3300u);
+    for(size_t i = 0; i < 24; i++)
+        EXPECT_FLOAT_EQ(buf.out_l[i], buf.l[i]);
+
+    graph.ResetStats();
+    EXPECT_EQ(graph.GetStats(b)->blocks, 0u);
+    EXPECT_EQ(graph.GetStats(2), nullptr);
+}
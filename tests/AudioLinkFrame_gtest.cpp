@@ -0,0 +1,122 @@
+#include "util/AudioLinkFrame.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+using Link = AudioLinkFrame<2, 4>;
+
+struct Blocks
+{
+    float  left[4];
+    float  right[4];
+    float* ptrs[2] = {left, right};
+
+    void Fill(float offset)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            left[i]  = offset + i;
+            right[i] = -offset - i;
+        }
+    }
+};
+} // namespace
+
+TEST(util_AudioLinkFrame, a_roundTrip)
+{
+    EXPECT_EQ(Link::kSize, 8u + 2 * 4 * 4 + 4);
+    EXPECT_EQ(Link::kBufferSize, 2 * Link::kSize);
+
+    Link    tx, rx;
+    Blocks  in, out;
+    uint8_t frame[Link::kSize + 2] = {};
+    in.Fill(1.f);
+    tx.Pack(frame, in.ptrs, 0x12345678);
+
+    uint32_t control = 0;
+    EXPECT_TRUE(rx.Unpack(frame, out.ptrs, &control));
+    EXPECT_EQ(control, 0x12345678u);
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(out.left[i], in.left[i]);
+        EXPECT_EQ(out.right[i], in.right[i]);
+    }
+    EXPECT_EQ(rx.GetBadFrameCount(), 0u);
+    EXPECT_EQ(rx.GetLostFrameCount(), 0u);
+}
+
+TEST(util_AudioLinkFrame, b_badFrameIsSilence)
+{
+    Link    tx, rx;
+    Blocks  in, out;
+    uint8_t frame[Link::kSize + 2] = {};
+    in.Fill(1.f);
+    out.Fill(5.f);
+    tx.Pack(frame, in.ptrs);
+    frame[Link::kHeaderSize + 3] ^= 0x01;
+
+    uint32_t control = 7;
+    EXPECT_FALSE(rx.Unpack(frame, out.ptrs, &control));
+    EXPECT_EQ(control, 7u);
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(out.left[i], 0.f);
+        EXPECT_EQ(out.right[i], 0.f);
+    }
+    EXPECT_EQ(rx.GetBadFrameCount(), 1u);
+
+    // a shifted frame fails the sync word
+    tx.Pack(frame, in.ptrs);
+    EXPECT_FALSE(rx.Unpack(frame + 1, out.ptrs));
+    EXPECT_EQ(rx.GetBadFrameCount(), 2u);
+}
+
+TEST(util_AudioLinkFrame, c_lostFrames)
+{
+    Link    tx, rx;
+    Blocks  in, out;
+    uint8_t frame[Link::kSize + 2] = {};
+    in.Fill(0.f);
+
+    tx.Pack(frame, in.ptrs);
+    EXPECT_TRUE(rx.Unpack(frame, out.ptrs));
+    tx.Pack(frame, in.ptrs);
+    tx.Pack(frame, in.ptrs);
+    tx.Pack(frame, in.ptrs);
+    EXPECT_TRUE(rx.Unpack(frame, out.ptrs));
+    EXPECT_EQ(rx.GetLostFrameCount(), 2u);
+
+    // the first frame after a resync starts the count over
+    rx.Resync();
+    tx.Pack(frame, in.ptrs);
+    tx.Pack(frame, in.ptrs);
+    EXPECT_TRUE(rx.Unpack(frame, out.ptrs));
+    EXPECT_EQ(rx.GetLostFrameCount(), 2u);
+}
+
+TEST(util_AudioLinkFrame, d_syncLost)
+{
+    Link    tx, rx;
+    Blocks  in, out;
+    uint8_t frame[Link::kSize + 2] = {};
+    in.Fill(0.f);
+    tx.Pack(frame, in.ptrs);
+
+    for(uint32_t i = 0; i < Link::kResyncFrames; i++)
+    {
+        EXPECT_TRUE(rx.IsSynced());
+        EXPECT_FALSE(rx.Unpack(frame + 2, out.ptrs));
+    }
+    EXPECT_FALSE(rx.IsSynced());
+
+    // a good frame ends the run of bad ones
+    EXPECT_TRUE(rx.Unpack(frame, out.ptrs));
+    EXPECT_TRUE(rx.IsSynced());
+
+    for(uint32_t i = 0; i < Link::kResyncFrames; i++)
+        rx.Unpack(frame + 2, out.ptrs);
+    rx.Resync();
+    EXPECT_TRUE(rx.IsSynced());
+}
@@ -0,0 +1,110 @@
+#include "hid/audio_oversampler.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+const float kPi = 3.14159265358979f;
+
+/** Runs a signal up and down through an oversampler in blocks */
+template <size_t Factor>
+std::vector<float> RoundTrip(const std::vector<float>& in, size_t block)
+{
+    Oversampler<Factor, 32> os;
+    std::vector<float>      out(in.size());
+    for(size_t i = 0; i + block <= in.size(); i += block)
+    {
+        os.Upsample(&in[i], block);
+        os.Downsample(&out[i], block);
+    }
+    return out;
+}
+
+std::vector<float> Sine(float freq, size_t size)
+{
+    std::vector<float> s(size);
+    for(size_t i = 0; i < size; i++)
+        s[i] = sinf(2.f * kPi * freq * float(i));
+    return s;
+}
+
+float Rms(const std::vector<float>& s, size_t from)
+{
+    float sum = 0.f;
+    for(size_t i = from; i < s.size(); i++)
+        sum += s[i] * s[i];
+    return sqrtf(sum / float(s.size() - from));
+}
+} // namespace
+
+TEST(hid_AudioOversampler, a_halfBandHasUnityGainAtDc)
+{
+    HalfBandCoefficients<12> h;
+    float                    sum = 0.5f;
+    for(float c : h.coef)
+        sum += 2.f * c;
+    EXPECT_NEAR(sum, 1.f, 1e-6f);
+
+    HalfBandUpsampler<12, 16> up;
+    float                     ones[16], out[32];
+    for(auto& s : ones)
+        s = 1.f;
+    for(int i = 0; i < 4; i++)
+        up.Process(ones, out, 16);
+    for(float s : out)
+        EXPECT_NEAR(s, 1.f, 1e-5f);
+}
+
+TEST(hid_AudioOversampler, b_roundTripDelaysTheAudioBand)
+{
+    // 1kHz at 48kHz comes back as it went in, only delayed
+    const float              freq = 1000.f / 48000.f;
+    const std::vector<float> in   = Sine(freq, 960);
+    const float              latency2 = Oversampler<2, 32>::GetLatency();
+    EXPECT_FLOAT_EQ(latency2, 23.f);
+    const std::vector<float> out2 = RoundTrip<2>(in, 32);
+    for(size_t i = 100; i < in.size(); i++)
+        EXPECT_NEAR(out2[i], in[i - size_t(latency2)], 1e-3f);
+
+    // 4x adds the half sample delay of the inner stages
+    const float latency4 = Oversampler<4, 32>::GetLatency();
+    EXPECT_FLOAT_EQ(latency4, 28.5f);
+    const std::vector<float> out4 = RoundTrip<4>(in, 32);
+    for(size_t i = 100; i < in.size(); i++)
+        EXPECT_NEAR(out4[i],
+                    sinf(2.f * kPi * freq * (float(i) - latency4)),
+                    1e-3f);
+}
+
+TEST(hid_AudioOversampler, c_blockSizeDoesNotMatter)
+{
+    const std::vector<float> in = Sine(0.03f, 480);
+    const std::vector<float> a  = RoundTrip<4>(in, 32);
+    const std::vector<float> b  = RoundTrip<4>(in, 5);
+    for(size_t i = 0; i < 475; i++)
+        EXPECT_FLOAT_EQ(a[i], b[i]);
+}
+
+TEST(hid_AudioOversampler, d_filtersWhatANonlinearityAdds)
+{
+    // a tone at 3/4 of the doubled rate's Nyquist, as a waveshaper would
+    // make it, doesn't fold back into the audio band
+    Oversampler<2, 32>       os;
+    const std::vector<float> tone = Sine(0.375f, 64 * 32);
+    std::vector<float>       out(64 * 16);
+    for(size_t b = 0; b < 32; b++)
+    {
+        float* up = os.Upsample(&out[b * 16], 16);
+        for(size_t i = 0; i < 32; i++)
+            up[i] = tone[b * 32 + i];
+        os.Downsample(&out[b * 16], 16);
+    }
+    EXPECT_LT(Rms(out, 64), 0.001f);
+
+    // while the audio band passes
+    const std::vector<float> in = Sine(0.1f, 64 * 16);
+    EXPECT_NEAR(Rms(RoundTrip<2>(in, 16), 64), sqrtf(0.5f), 0.01f);
+}
@@ -0,0 +1,61 @@
+#include "util/BackupSnapshot.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+struct State
+{
+    float    volume;
+    uint16_t preset;
+    uint8_t  page;
+};
+} // namespace
+
+TEST(util_BackupSnapshot, a_saveAndRestore)
+{
+    BackupSnapshot<State>::Storage storage;
+    // what the memory holds after the first power up
+    std::memset(&storage, 0xa5, sizeof(storage));
+    BackupSnapshot<State> snapshot(storage);
+
+    State state = {0.5f, 12, 3};
+    EXPECT_FALSE(snapshot.IsValid());
+    EXPECT_FALSE(snapshot.Restore(state));
+    EXPECT_EQ(state.preset, 12);
+    EXPECT_EQ(snapshot.GetSaveCount(), 0u);
+
+    snapshot.Save(state);
+    snapshot.Save(state);
+    EXPECT_TRUE(snapshot.IsValid());
+    EXPECT_EQ(snapshot.GetSaveCount(), 2u);
+
+    // after a reset
+    BackupSnapshot<State> resumed(storage);
+    State                 restored = {};
+    EXPECT_TRUE(resumed.Restore(restored));
+    EXPECT_FLOAT_EQ(restored.volume, 0.5f);
+    EXPECT_EQ(restored.preset, 12);
+    EXPECT_EQ(restored.page, 3);
+
+    resumed.Invalidate();
+    EXPECT_FALSE(resumed.Restore(restored));
+}
+
+TEST(util_BackupSnapshot, b_rejectsDamage)
+{
+    BackupSnapshot<State>::Storage storage;
+    BackupSnapshot<State>          snapshot(storage);
+    State                          state = {1.f, 7, 0};
+    snapshot.Save(state);
+
+    storage.state.preset ^= 1;
+    EXPECT_FALSE(snapshot.IsValid());
+    storage.state.preset ^= 1;
+    EXPECT_TRUE(snapshot.IsValid());
+
+    // a struct of another size, e.g. after an update
+    storage.size++;
+    EXPECT_FALSE(snapshot.IsValid());
+}
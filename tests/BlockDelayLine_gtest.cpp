@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "util/BlockDelayLine.h"
+
+using namespace daisy;
+
+namespace
+{
+using Delay = BlockDelayLine<float, 64>;
+
+/** Writes the blocks count, count + 1, ... */
+void WriteRamp(Delay& delay, float& count, size_t size)
+{
+    float block[16];
+    for(size_t i = 0; i < size; i++)
+        block[i] = count++;
+    delay.Write(block, size);
+}
+} // namespace
+
+TEST(util_BlockDelayLine, a_readSamples)
+{
+    Delay delay;
+    delay.Init();
+    EXPECT_EQ(delay.Read(size_t(10)), 0.f);
+
+    for(int i = 1; i <= 100; i++)
+        delay.Write(float(i));
+    EXPECT_EQ(delay.Read(size_t(0)), 100.f);
+    EXPECT_EQ(delay.Read(size_t(5)), 95.f);
+    EXPECT_EQ(delay.Read(Delay::GetMaxDelay()), 100.f - 62.f);
+    EXPECT_FLOAT_EQ(delay.ReadLinear(5.25f), 94.75f);
+    EXPECT_FLOAT_EQ(delay.ReadLinear(0.f), 100.f);
+}
+
+TEST(util_BlockDelayLine, b_readBlocks)
+{
+    // the blocks and the reads cross the end of the buffer
+    Delay delay;
+    delay.Init();
+    float count = 1.f;
+    for(int n = 0; n < 20; n++)
+    {
+        WriteRamp(delay, count, 12);
+        const float newest = count - 1.f;
+
+        float out[12];
+        for(float d : {0.f, 0.5f, 7.f, 30.25f, 51.75f})
+        {
+            delay.ReadBlock(out, 12, d);
+            for(size_t i = 0; i < 12; i++)
+            {
+                const float expected = newest - 11.f + float(i) - d;
+                EXPECT_FLOAT_EQ(out[i], expected > 0.f ? expected : 0.f)
+                    << "block " << n << " delay " << d << " sample " << i;
+            }
+        }
+    }
+}
+
+TEST(util_BlockDelayLine, c_blockMatchesSamples)
+{
+    Delay block, single;
+    block.Init();
+    single.Init();
+    float count_block = 1.f, count_single = 1.f;
+    for(int n = 0; n < 10; n++)
+    {
+        WriteRamp(block, count_block, 16);
+
+        const float delays[3] = {3.5f, 17.f, 40.125f};
+        float       taps[3][16];
+        float*      outs[3] = {taps[0], taps[1], taps[2]};
+        block.ReadTaps(outs, delays, 3, 16);
+
+        // the same, a sample at a time
+        for(size_t i = 0; i < 16; i++)
+        {
+            single.Write(count_single++);
+            for(size_t tap = 0; tap < 3; tap++)
+                EXPECT_FLOAT_EQ(taps[tap][i], single.ReadLinear(delays[tap]));
+        }
+    }
+}
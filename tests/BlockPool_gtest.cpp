@@ -0,0 +1,67 @@
+#include "util/BlockPool.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_BlockPool, a_allocateAndFree)
+{
+    alignas(8) uint8_t buffer[1000];
+    BlockPool          pool;
+    // rounded up to the alignment
+    EXPECT_TRUE(pool.Init(buffer, sizeof(buffer), 100));
+    EXPECT_EQ(pool.GetBlockSize(), 104u);
+    EXPECT_EQ(pool.GetNumBlocks(), 9u);
+    EXPECT_EQ(pool.GetNumFree(), 9u);
+
+    void* blocks[9];
+    for(auto& b : blocks)
+    {
+        b = pool.Allocate();
+        ASSERT_NE(b, nullptr);
+        EXPECT_TRUE(pool.Owns(b));
+    }
+    EXPECT_EQ(blocks[0], buffer);
+    EXPECT_EQ(blocks[1], buffer + 104);
+    EXPECT_EQ(pool.Allocate(), nullptr);
+    EXPECT_EQ(pool.GetNumUsed(), 9u);
+
+    // freed blocks are reused first
+    pool.Free(blocks[4]);
+    pool.Free(blocks[2]);
+    EXPECT_EQ(pool.GetNumFree(), 2u);
+    EXPECT_EQ(pool.Allocate(), blocks[2]);
+    EXPECT_EQ(pool.Allocate(), blocks[4]);
+    EXPECT_EQ(pool.GetHighWaterMark(), 9u);
+}
+
+TEST(util_BlockPool, b_foreignPointers)
+{
+    alignas(8) uint8_t buffer[256];
+    BlockPool          pool;
+    pool.Init(buffer, sizeof(buffer), 64);
+    void* block = pool.Allocate();
+    EXPECT_FALSE(pool.Owns(static_cast<uint8_t*>(block) + 1));
+    EXPECT_FALSE(pool.Owns(buffer + 256));
+
+    // ignored
+    pool.Free(nullptr);
+    pool.Free(static_cast<uint8_t*>(block) + 1);
+    EXPECT_EQ(pool.GetNumFree(), 3u);
+}
+
+TEST(util_BlockPool, c_fromArena)
+{
+    alignas(32) uint8_t buffer[4096];
+    MemoryArena         arena;
+    arena.Init(buffer, sizeof(buffer));
+
+    BlockPool pool;
+    EXPECT_TRUE(pool.Init(arena, 500, 4, 32));
+    EXPECT_EQ(pool.GetBlockSize(), 512u);
+    EXPECT_EQ(pool.GetNumBlocks(), 4u);
+    EXPECT_EQ(arena.GetUsed(), 2048u);
+    EXPECT_TRUE(arena.Contains(pool.Allocate()));
+
+    BlockPool too_large;
+    EXPECT_FALSE(too_large.Init(arena, 1024, 3));
+}
@@ -0,0 +1,41 @@
+#include "hid/board_layout.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+constexpr Pin kPins[]    = {Pin(PORTA, 0), Pin(PORTA, 1), Pin(PORTB, 0)};
+constexpr Pin kTwice[]   = {Pin(PORTA, 0), Pin(PORTB, 0), Pin(PORTA, 0)};
+constexpr Pin kInvalid[] = {Pin(PORTA, 0), Pin()};
+
+// evaluated by the compiler, as the boards do
+static_assert(BoardPinsUnique(kPins), "");
+static_assert(!BoardPinsUnique(kTwice), "");
+static_assert(!BoardPinsValid(kInvalid), "");
+
+constexpr BoardAnalogIn kInputs[]
+    = {{Pin(PORTA, 0), true}, {Pin(PORTA, 1), false, true}};
+} // namespace
+
+TEST(hid_BoardLayout, a_pinChecks)
+{
+    EXPECT_TRUE(BoardPinsValid(kPins));
+    EXPECT_TRUE(BoardPinsUnique(kPins));
+    EXPECT_FALSE(BoardPinsUnique(kTwice));
+    EXPECT_FALSE(BoardPinsValid(kInvalid));
+    EXPECT_TRUE(BoardPinsUnique(kInvalid));
+}
+
+TEST(hid_BoardLayout, b_defaults)
+{
+    EXPECT_TRUE(kInputs[0].flip);
+    EXPECT_FALSE(kInputs[0].invert);
+    EXPECT_FALSE(kInputs[1].flip);
+    EXPECT_TRUE(kInputs[1].invert);
+    EXPECT_FALSE(kInputs[1].bipolar_cv);
+
+    constexpr BoardRgbLed led = {Pin(PORTA, 0), Pin(PORTA, 1), Pin(PORTA, 2)};
+    EXPECT_FALSE(led.invert);
+    EXPECT_TRUE(led.blue == Pin(PORTA, 2));
+}
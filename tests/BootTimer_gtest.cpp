@@ -0,0 +1,60 @@
+#include "util/BootTimer.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_BootTimer, a_recordsPhases)
+{
+    BootTimer::Reset();
+    System::SetUsForUnitTest(1000);
+    BootTimer::Mark("system");
+    System::SetUsForUnitTest(1500);
+    BootTimer::Mark("audio");
+    System::SetUsForUnitTest(101500);
+    BootTimer::Mark("sdram");
+
+    ASSERT_EQ(BootTimer::GetNumPhases(), 3u);
+    EXPECT_STREQ(BootTimer::GetPhase(0).name, "system");
+    EXPECT_STREQ(BootTimer::GetPhase(2).name, "sdram");
+    EXPECT_EQ(BootTimer::GetPhaseUs(0), 1000u);
+    EXPECT_EQ(BootTimer::GetPhaseUs(1), 500u);
+    EXPECT_EQ(BootTimer::GetPhaseUs(2), 100000u);
+    EXPECT_EQ(BootTimer::GetTotalUs(), 101500u);
+
+    BootTimer::Reset();
+    EXPECT_EQ(BootTimer::GetNumPhases(), 0u);
+    EXPECT_EQ(BootTimer::GetTotalUs(), 0u);
+}
+
+TEST(util_BootTimer, b_ignoresRepeatedPhases)
+{
+    BootTimer::Reset();
+    System::SetUsForUnitTest(100);
+    BootTimer::Mark("audio start");
+    System::SetUsForUnitTest(200);
+    BootTimer::Mark("audio start");
+
+    ASSERT_EQ(BootTimer::GetNumPhases(), 1u);
+    EXPECT_EQ(BootTimer::GetTotalUs(), 100u);
+    BootTimer::Reset();
+}
+
+TEST(util_BootTimer, c_dropsPhasesWhenFull)
+{
+    static const char* names[]
+        = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11",
+           "12", "13", "14", "15", "16", "17", "18", "19", "20", "21"};
+    static_assert(sizeof(names) / sizeof(names[0])
+                      > DSY_BOOT_TIMER_MAX_PHASES,
+                  "more names than phases needed");
+
+    BootTimer::Reset();
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        System::SetUsForUnitTest(i * 10);
+        BootTimer::Mark(names[i]);
+    }
+    EXPECT_EQ(BootTimer::GetNumPhases(), size_t(DSY_BOOT_TIMER_MAX_PHASES));
+    EXPECT_EQ(BootTimer::GetTotalUs(), (DSY_BOOT_TIMER_MAX_PHASES - 1) * 10u);
+    BootTimer::Reset();
+}
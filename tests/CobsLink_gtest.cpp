@@ -0,0 +1,262 @@
+#include "util/CobsLink.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** a transport of two byte vectors, and a limit of the queue */
+struct FakeTransport
+{
+    std::vector<uint8_t> rx;
+    size_t               rx_pos = 0;
+    std::vector<uint8_t> tx;
+    size_t               tx_space = 1024;
+
+    static size_t Read(uint8_t* buff, size_t size, void* context)
+    {
+        auto&  t = *static_cast<FakeTransport*>(context);
+        size_t n = 0;
+        while(n < size && t.rx_pos < t.rx.size())
+            buff[n++] = t.rx[t.rx_pos++];
+        return n;
+    }
+
+    static bool Write(const uint8_t* buff, size_t size, void* context)
+    {
+        auto& t = *static_cast<FakeTransport*>(context);
+        if(size > t.tx_space)
+            return false;
+        t.tx.insert(t.tx.end(), buff, buff + size);
+        t.tx_space -= size;
+        return true;
+    }
+};
+
+/** the parts of a UartHandler InitUart() runs on: the bytes the DMA
+ *  received wrap around the ring, and QueueTx() copies into the queue */
+struct FakeUart
+{
+    enum class Result
+    {
+        OK,
+        ERR,
+    };
+
+    struct RxSpan
+    {
+        const uint8_t* data[2];
+        size_t         size[2];
+    };
+
+    uint8_t*             ring      = nullptr;
+    size_t               ring_size = 0;
+    size_t               ring_read = 0;
+    size_t               ring_used = 0;
+    bool                 listening = false;
+    size_t               tx_size   = 0;
+    std::vector<uint8_t> sent;
+
+    Result SetTxQueue(uint8_t* buff, size_t size)
+    {
+        if(buff == nullptr || listening)
+            return Result::ERR;
+        tx_size = size;
+        return Result::OK;
+    }
+
+    Result DmaRingStart(uint8_t* buff, size_t size)
+    {
+        ring      = buff;
+        ring_size = size;
+        listening = true;
+        return Result::OK;
+    }
+
+    Result QueueTx(const uint8_t* buff, size_t size)
+    {
+        if(tx_size == 0 || size > tx_size)
+            return Result::ERR;
+        sent.insert(sent.end(), buff, buff + size);
+        return Result::OK;
+    }
+
+    /** the DMA writing received bytes */
+    void Receive(const std::vector<uint8_t>& bytes)
+    {
+        for(uint8_t b : bytes)
+            ring[(ring_read + ring_used++) % ring_size] = b;
+    }
+
+    size_t GetRxSpan(RxSpan& span)
+    {
+        const size_t first = ring_size - ring_read;
+        span.data[0]       = ring + ring_read;
+        span.size[0]       = ring_used < first ? ring_used : first;
+        span.data[1]       = ring;
+        span.size[1]       = ring_used - span.size[0];
+        return ring_used;
+    }
+
+    void ReleaseRx(size_t size)
+    {
+        ring_read = (ring_read + size) % ring_size;
+        ring_used -= size;
+    }
+};
+
+using Link = CobsLink<300, 2>;
+
+void InitLink(Link& link, FakeTransport& transport)
+{
+    Link::Config config;
+    config.read    = &FakeTransport::Read;
+    config.write   = &FakeTransport::Write;
+    config.context = &transport;
+    link.Init(config);
+}
+} // namespace
+
+TEST(util_CobsLink, a_encoding)
+{
+    // the payload 11 00 22, and the CRC
+    const uint8_t  payload[] = {0x11, 0x00, 0x22};
+    const uint32_t crc       = Crc32(payload, sizeof(payload));
+    uint8_t        out[Link::kMaxEncodedSize];
+    const size_t   size = Link::Encode(payload, sizeof(payload), out);
+
+    // this CRC has no 0 bytes, so the 22 and the CRC are one block
+    for(int shift = 0; shift < 32; shift += 8)
+        ASSERT_NE((crc >> shift) & 0xFF, 0u);
+    ASSERT_EQ(size, 1u + 3u + 4u + 1u);
+    EXPECT_EQ(out[0], 0x02);
+    EXPECT_EQ(out[1], 0x11);
+    EXPECT_EQ(out[2], 0x06);
+    EXPECT_EQ(out[3], 0x22);
+    EXPECT_EQ(out[4], uint8_t(crc));
+    EXPECT_EQ(out[7], uint8_t(crc >> 24));
+    EXPECT_EQ(out[size - 1], 0x00);
+    for(size_t i = 0; i < size - 1; i++)
+        EXPECT_NE(out[i], 0x00);
+}
+
+TEST(util_CobsLink, b_roundTrip)
+{
+    FakeTransport transport;
+    Link          link;
+    InitLink(link, transport);
+
+    // an empty payload, one of 0s, and one with a block of 254 and more
+    std::vector<uint8_t> zeros(10, 0);
+    std::vector<uint8_t> longer(300);
+    for(size_t i = 0; i < longer.size(); i++)
+        longer[i] = uint8_t(i % 255 + 1);
+    EXPECT_TRUE(link.Send(nullptr, 0));
+    EXPECT_TRUE(link.Send(zeros.data(), zeros.size()));
+    EXPECT_TRUE(link.Send(longer.data(), longer.size()));
+    EXPECT_FALSE(link.Send(longer.data(), 301));
+    EXPECT_EQ(link.GetStats().tx_frames, 3u);
+
+    // looped back, the link holds two frames at a time
+    transport.rx = transport.tx;
+    link.Process();
+    EXPECT_EQ(link.GetNumFrames(), 2u);
+    Link::Frame frame;
+    ASSERT_TRUE(link.GetFrame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    link.ReleaseFrame();
+    ASSERT_TRUE(link.GetFrame(frame));
+    EXPECT_EQ(std::vector<uint8_t>(frame.data, frame.data + frame.size),
+              zeros);
+    link.ReleaseFrame();
+
+    // the rest waited in the transport
+    EXPECT_FALSE(link.GetFrame(frame));
+    link.Process();
+    ASSERT_TRUE(link.GetFrame(frame));
+    EXPECT_EQ(std::vector<uint8_t>(frame.data, frame.data + frame.size),
+              longer);
+    link.ReleaseFrame();
+    EXPECT_EQ(link.GetStats().rx_frames, 3u);
+    EXPECT_EQ(link.GetStats().rx_dropped, 0u);
+}
+
+TEST(util_CobsLink, c_errorsAndBackPressure)
+{
+    FakeTransport transport;
+    Link          link;
+    InitLink(link, transport);
+
+    const uint8_t payload[] = {1, 2, 3, 4, 5};
+    uint8_t       good[Link::kMaxEncodedSize];
+    const size_t  size = Link::Encode(payload, sizeof(payload), good);
+
+    // a corrupted byte, a truncated frame, then a good one
+    std::vector<uint8_t> stream(good, good + size);
+    stream[2] ^= 0x40;
+    stream.insert(stream.end(), good, good + 3);
+    stream.push_back(0);
+    stream.insert(stream.end(), good, good + size);
+    link.Receive(stream.data(), stream.size());
+    EXPECT_EQ(link.GetStats().rx_crc_errors, 1u);
+    EXPECT_EQ(link.GetStats().rx_errors, 1u);
+    EXPECT_EQ(link.GetNumFrames(), 1u);
+
+    // Receive() drops frames while all slots are in use
+    link.Receive(good, size);
+    link.Receive(good, size);
+    EXPECT_EQ(link.GetNumFrames(), 2u);
+    EXPECT_EQ(link.GetStats().rx_dropped, 1u);
+    Link::Frame frame;
+    ASSERT_TRUE(link.GetFrame(frame));
+    EXPECT_EQ(frame.size, sizeof(payload));
+    EXPECT_EQ(frame.data[4], 5);
+
+    // Send() fails whole while the queue is full
+    transport.tx_space = size - 1;
+    EXPECT_FALSE(link.Send(payload, sizeof(payload)));
+    EXPECT_TRUE(transport.tx.empty());
+    EXPECT_EQ(link.GetStats().tx_busy, 1u);
+}
+
+TEST(util_CobsLink, d_uart)
+{
+    FakeUart uart;
+    Link     link;
+    uint8_t  rx_ring[64];
+    uint8_t  tx_queue[Link::kMaxEncodedSize];
+    ASSERT_TRUE(link.InitUart(
+        uart, rx_ring, sizeof(rx_ring), tx_queue, sizeof(tx_queue)));
+    EXPECT_TRUE(uart.listening);
+
+    // frames are sent while the ring receives
+    const uint8_t a[] = {1, 0, 2};
+    const uint8_t b[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    EXPECT_TRUE(link.Send(a, sizeof(a)));
+    EXPECT_TRUE(link.Send(b, sizeof(b)));
+    EXPECT_EQ(link.GetStats().tx_frames, 2u);
+    EXPECT_EQ(link.GetStats().tx_busy, 0u);
+
+    // looped back a few times, so the frames wrap around the ring
+    const std::vector<uint8_t> looped = uart.sent;
+    ASSERT_LT(looped.size(), sizeof(rx_ring));
+    for(int lap = 0; lap < 3; lap++)
+    {
+        uart.Receive(looped);
+        Link::Frame frame;
+        for(size_t i = 0; i < 2; i++)
+        {
+            link.Process();
+            ASSERT_TRUE(link.GetFrame(frame));
+            const uint8_t* expected = i == 0 ? a : b;
+            const size_t   size     = i == 0 ? sizeof(a) : sizeof(b);
+            EXPECT_EQ(std::vector<uint8_t>(frame.data, frame.data + frame.size),
+                      std::vector<uint8_t>(expected, expected + size));
+            link.ReleaseFrame();
+        }
+        EXPECT_EQ(uart.ring_used, 0u);
+    }
+    EXPECT_EQ(link.GetStats().rx_frames, 6u);
+    EXPECT_EQ(link.GetStats().rx_crc_errors, 0u);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "util/color.h"
+
+using namespace daisy;
+
+TEST(util_Color, a_scale8)
+{
+    for(int a = 0; a < 256; a++)
+    {
+        for(int b = 0; b < 256; b++)
+        {
+            const int expected = int(std::lround(a * b / 255.0));
+            ASSERT_EQ(Scale8(a, b), expected) << a << " * " << b;
+        }
+    }
+}
+
+TEST(util_Color, b_hsvToRgb8)
+{
+    struct
+    {
+        uint16_t hue;
+        uint32_t rgb;
+    } corners[] = {{0, 0xff0000},
+                   {10923, 0xffff00},
+                   {21846, 0x00ff00},
+                   {32768, 0x00ffff},
+                   {43691, 0x0000ff},
+                   {54614, 0xff00ff}};
+    for(const auto& c : corners)
+        EXPECT_EQ(HsvToRgb8(c.hue).Packed(), c.rgb) << "hue " << c.hue;
+
+    // orange, halfway between red and yellow
+    const Rgb8 orange = HsvToRgb8(5461);
+    EXPECT_EQ(orange.red, 255);
+    EXPECT_NEAR(orange.green, 128, 1);
+    EXPECT_EQ(orange.blue, 0);
+
+    // no saturation is white, no value is black
+    EXPECT_EQ(HsvToRgb8(20000, 0).Packed(), 0xffffffu);
+    EXPECT_EQ(HsvToRgb8(20000, 255, 0).Packed(), 0u);
+    EXPECT_EQ(HsvToRgb8(0, 255, 128).Packed(), 0x800000u);
+    EXPECT_EQ(HsvToRgb8(65535).red, 255);
+}
+
+TEST(util_Color, c_blendAndScale)
+{
+    const Rgb8 a = {0, 100, 255};
+    const Rgb8 b = {255, 0, 255};
+    EXPECT_EQ(Blend(a, b, 0).Packed(), a.Packed());
+    EXPECT_EQ(Blend(a, b, 255).Packed(), b.Packed());
+    const Rgb8 mid = Blend(a, b, 128);
+    EXPECT_EQ(mid.red, 128);
+    EXPECT_EQ(mid.green, 50);
+    EXPECT_EQ(mid.blue, 255);
+
+    EXPECT_EQ(Scale(b, 255).Packed(), b.Packed());
+    EXPECT_EQ(Scale(b, 51).Packed(), 0x330033u);
+}
+
+TEST(util_Color, d_gamma)
+{
+    EXPECT_EQ(Gamma12(0), 0);
+    EXPECT_EQ(Gamma12(255), 4095);
+    EXPECT_EQ(Gamma8(0), 0);
+    EXPECT_EQ(Gamma8(255), 255);
+    for(int i = 1; i < 256; i++)
+    {
+        // rising, and the same curve at both resolutions
+        ASSERT_GE(Gamma12(i), Gamma12(i - 1));
+        ASSERT_EQ(Gamma8(i), (Gamma12(i) * 255 + 2047) / 4095) << i;
+    }
+    const Rgb8 c = Gamma8(Rgb8{255, 128, 0});
+    EXPECT_EQ(c.red, 255);
+    EXPECT_EQ(c.green, Gamma8(128));
+    EXPECT_EQ(c.blue, 0);
+}
@@ -0,0 +1,48 @@
+#include "util/ContainerBenchmark.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace daisy;
+
+namespace
+{
+uint32_t fake_count = 0;
+
+// every read advances by 10, so each operation sees 10 counts
+uint32_t FakeCounter()
+{
+    fake_count += 10;
+    return fake_count;
+}
+} // namespace
+
+TEST(util_ContainerBenchmark, a_fillsAllResults)
+{
+    ContainerBenchmark::Result results[ContainerBenchmark::kNumResults];
+    std::memset(results, 0, sizeof(results));
+    fake_count = 0xFFFFFFF0; // the counter wraps around during the run
+    ContainerBenchmark::Run(FakeCounter, results);
+
+    for(size_t i = 0; i < ContainerBenchmark::kNumResults; i++)
+    {
+        ASSERT_NE(results[i].name, nullptr);
+        EXPECT_GT(results[i].ops, 0u);
+        EXPECT_EQ(results[i].count, 10u);
+        EXPECT_FLOAT_EQ(results[i].PerOp(), 10.f / results[i].ops);
+        for(size_t j = 0; j < i; j++)
+            EXPECT_STRNE(results[i].name, results[j].name);
+    }
+}
+
+TEST(util_ContainerBenchmark, b_scaleRepeatsTheOperations)
+{
+    ContainerBenchmark::Result one[ContainerBenchmark::kNumResults];
+    ContainerBenchmark::Result four[ContainerBenchmark::kNumResults];
+    ContainerBenchmark::Run(FakeCounter, one);
+    ContainerBenchmark::Run(FakeCounter, four, 4);
+    for(size_t i = 0; i < ContainerBenchmark::kNumResults; i++)
+        EXPECT_EQ(four[i].ops, one[i].ops * 4);
+
+    const ContainerBenchmark::Result none = {"none", 0, 5};
+    EXPECT_FLOAT_EQ(none.PerOp(), 0.f);
+}
@@ -0,0 +1,62 @@
+#include "hid/ctrl.h"
+#include "hid/ctrl_bank.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(hid_ControlBank, a_matchesAnalogControl)
+{
+    uint16_t      raw[4] = {0, 1000, 40000, 65535};
+    AnalogControl ctrl[4];
+    ControlBank   bank;
+    bank.Init(1000.f);
+
+    ctrl[0].Init(&raw[0], 1000.f);
+    ctrl[1].Init(&raw[1], 1000.f, true, false, 0.01f);
+    ctrl[2].Init(&raw[2], 1000.f, true, true);
+    ctrl[3].InitBipolarCv(&raw[3], 1000.f);
+    EXPECT_EQ(bank.AddControl(&raw[0]), 0);
+    EXPECT_EQ(bank.AddControl(&raw[1], true, false, 0.01f), 1);
+    EXPECT_EQ(bank.AddControl(&raw[2], true, true), 2);
+    EXPECT_EQ(bank.AddBipolarCv(&raw[3]), 3);
+    EXPECT_EQ(bank.GetNumChannels(), 4u);
+
+    for(int n = 0; n < 50; n++)
+    {
+        if(n == 25)
+        {
+            raw[0] = 30000;
+            raw[3] = 12345;
+        }
+        bank.Process();
+        for(int i = 0; i < 4; i++)
+            EXPECT_NEAR(bank.Value(i), ctrl[i].Process(), 1e-5f);
+    }
+
+    // new coefficients, as after a change of the block size
+    bank.SetSampleRate(500.f);
+    for(int i = 0; i < 4; i++)
+        ctrl[i].SetSampleRate(500.f);
+    raw[1] = 50000;
+    for(int n = 0; n < 20; n++)
+    {
+        bank.Process();
+        for(int i = 0; i < 4; i++)
+            EXPECT_NEAR(bank.GetValues()[i], ctrl[i].Process(), 1e-5f);
+    }
+}
+
+TEST(hid_ControlBank, b_full)
+{
+    uint16_t    raw = 0;
+    ControlBank bank;
+    bank.Init(1000.f);
+    EXPECT_EQ(bank.AddControl(nullptr), ControlBank::kInvalidControl);
+    for(int i = 0; i < DSY_CONTROL_BANK_MAX_CHANNELS; i++)
+        EXPECT_EQ(bank.AddControl(&raw), i);
+    EXPECT_EQ(bank.AddControl(&raw), ControlBank::kInvalidControl);
+    EXPECT_EQ(bank.GetNumChannels(), size_t(DSY_CONTROL_BANK_MAX_CHANNELS));
+
+    bank.Init(1000.f);
+    EXPECT_EQ(bank.GetNumChannels(), 0u);
+}
@@ -0,0 +1,75 @@
+#include "util/ControlRateClock.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_ControlRateClock, a_everyBlock)
+{
+    ControlRateClock clock;
+    clock.Init(1000.f);
+    EXPECT_TRUE(clock.IsEveryBlock());
+    EXPECT_FLOAT_EQ(clock.GetRate(), 1000.f);
+    for(int i = 0; i < 10; i++)
+        EXPECT_TRUE(clock.Tick());
+    EXPECT_FLOAT_EQ(clock.GetPhase(), 1.f);
+    EXPECT_FLOAT_EQ(clock.GetPhaseIncrement(), 0.f);
+
+    // faster than the blocks is every block too
+    clock.Init(1000.f, 4000.f);
+    EXPECT_TRUE(clock.IsEveryBlock());
+    EXPECT_FLOAT_EQ(clock.GetRate(), 1000.f);
+}
+
+TEST(util_ControlRateClock, b_everyNthBlock)
+{
+    for(int n = 2; n <= 7; n++)
+    {
+        ControlRateClock clock;
+        clock.Init(48000.f / 48.f, 1000.f / n);
+        EXPECT_FALSE(clock.IsEveryBlock());
+        // the first update is right away, then every nth block
+        for(int block = 0; block < 10000; block++)
+            ASSERT_EQ(clock.Tick(), block % n == 0) << n << " " << block;
+    }
+}
+
+TEST(util_ControlRateClock, c_fixedRate)
+{
+    // 32 sample blocks at 48kHz are 1500 blocks a second
+    ControlRateClock clock;
+    clock.Init(1500.f, 400.f);
+    EXPECT_FLOAT_EQ(clock.GetRate(), 400.f);
+    int updates = 0;
+    for(int block = 0; block < 1500 * 10; block++)
+    {
+        const bool due = clock.Tick();
+        updates += due ? 1 : 0;
+        // the phase is small right after an update, and below 1
+        if(due)
+        {
+            EXPECT_LT(clock.GetPhase(), clock.GetPhaseIncrement());
+        }
+        EXPECT_LT(clock.GetPhase(), 1.f);
+    }
+    EXPECT_EQ(updates, 4000);
+
+    // a new block size keeps the rate
+    clock.SetBlockRate(750.f);
+    updates = 0;
+    for(int block = 0; block < 750 * 10; block++)
+        updates += clock.Tick() ? 1 : 0;
+    EXPECT_EQ(updates, 4000);
+    EXPECT_NEAR(clock.GetPhaseIncrement(), 400.f / 750.f, 1e-6f);
+}
+
+TEST(util_ControlRateClock, d_setRate)
+{
+    ControlRateClock clock;
+    clock.Init(1000.f, 250.f);
+    EXPECT_TRUE(clock.Tick());
+    EXPECT_FALSE(clock.Tick());
+    clock.SetRate(0.f);
+    EXPECT_TRUE(clock.IsEveryBlock());
+    EXPECT_TRUE(clock.Tick());
+    EXPECT_TRUE(clock.Tick());
+}
@@ -152,4 +152,30 @@ TEST(util_CpuLoadMeter, e_tolerateTickOverflow)
     // check results - meter should have tolerated the overflow
     EXPECT_FLOAT_EQ(meter.GetMinCpuLoad(), 0.5f);
     EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.5f);
-}
\ No newline at end of file
+}
+TEST(util_CpuLoadMeter, f_followClockChange)
+{
+    System::SetTickFreqForUnitTest(1000000u); // 1us tick duration
+    CpuLoadMeter meter;
+    meter.Init(48000.0f, 48); // 1kHz block rate
+
+    // measure block with 20% load
+    meter.OnBlockStart();
+    System::SetTickForUnitTest(System::GetTick() + 200);
+    meter.OnBlockEnd();
+
+    // the tick rate doubles during the next block, which isn't counted
+    meter.OnBlockStart();
+    System::SetTickFreqForUnitTest(2000000u);
+    System::ClockChangeForUnitTest();
+    System::SetTickForUnitTest(System::GetTick() + 5000);
+    meter.OnBlockEnd();
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.2f);
+
+    // measure block with 10% load at the new rate
+    meter.OnBlockStart();
+    System::SetTickForUnitTest(System::GetTick() + 200);
+    meter.OnBlockEnd();
+    EXPECT_FLOAT_EQ(meter.GetMinCpuLoad(), 0.1f);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.2f);
+}
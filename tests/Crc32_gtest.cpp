@@ -0,0 +1,18 @@
+#include "util/Crc32.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_Crc32, a_checkValue)
+{
+    // the standard check value of CRC-32
+    const char text[] = "123456789";
+    EXPECT_EQ(Crc32(text, 9), 0xcbf43926u);
+    EXPECT_EQ(Crc32(text, 0), 0u);
+}
+
+TEST(util_Crc32, b_chained)
+{
+    const char text[] = "123456789";
+    EXPECT_EQ(Crc32(text + 4, 5, Crc32(text, 4)), 0xcbf43926u);
+}
@@ -0,0 +1,133 @@
+#include "util/CycleCpuLoadMeter.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace daisy;
+
+namespace
+{
+/** measures one block that takes the given number of cycles */
+template <size_t numBins>
+void MeasureBlock(CycleCpuLoadMeter<numBins>& meter, uint32_t cycles)
+{
+    meter.OnBlockStart();
+    System::SetCycleCountForUnitTest(System::GetCycleCount() + cycles);
+    meter.OnBlockEnd();
+}
+} // namespace
+
+TEST(util_CycleCpuLoadMeter, a_stateAfterInit)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48);
+    EXPECT_EQ(meter.GetNumBlocks(), 0u);
+    EXPECT_TRUE(std::isnan(meter.GetAvgCpuLoad()));
+    EXPECT_TRUE(std::isnan(meter.GetMaxCpuLoad()));
+    EXPECT_TRUE(std::isnan(meter.GetP99CpuLoad()));
+}
+
+TEST(util_CycleCpuLoadMeter, b_stateAfterReset)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48);
+
+    MeasureBlock(meter, 1000);
+    EXPECT_EQ(meter.GetNumBlocks(), 1u);
+    EXPECT_FALSE(std::isnan(meter.GetMaxCpuLoad()));
+
+    meter.Reset();
+    EXPECT_EQ(meter.GetNumBlocks(), 0u);
+    EXPECT_TRUE(std::isnan(meter.GetAvgCpuLoad()));
+    EXPECT_TRUE(std::isnan(meter.GetMaxCpuLoad()));
+    EXPECT_TRUE(std::isnan(meter.GetP50CpuLoad()));
+}
+
+TEST(util_CycleCpuLoadMeter, c_measureAvgMax)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48); // 1kHz block rate, 480000 cycles per block
+
+    MeasureBlock(meter, 96000);  // 20%
+    MeasureBlock(meter, 48000);  // 10%
+    MeasureBlock(meter, 144000); // 30%
+
+    EXPECT_FLOAT_EQ(meter.GetAvgCpuLoad(), 0.2f);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.3f);
+}
+
+TEST(util_CycleCpuLoadMeter, d_percentiles)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48);
+
+    // 98 blocks at 10%, one at 50% and one at 90%
+    for(int i = 0; i < 98; i++)
+        MeasureBlock(meter, 48000);
+    MeasureBlock(meter, 240000);
+    MeasureBlock(meter, 432000);
+
+    // results are rounded up to the 1% bins
+    EXPECT_NEAR(meter.GetP50CpuLoad(), 0.1f, 0.01f);
+    EXPECT_NEAR(meter.GetP95CpuLoad(), 0.1f, 0.01f);
+    EXPECT_NEAR(meter.GetP99CpuLoad(), 0.5f, 0.01f);
+    EXPECT_FLOAT_EQ(meter.GetPercentileCpuLoad(1.0f), 0.9f);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.9f);
+    EXPECT_EQ(meter.GetNumOverloadedBlocks(), 0u);
+}
+
+TEST(util_CycleCpuLoadMeter, e_overload)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<10> meter;
+    meter.Init(48000.0f, 48);
+
+    MeasureBlock(meter, 48000);
+    MeasureBlock(meter, 720000); // 150%
+
+    EXPECT_EQ(meter.GetNumOverloadedBlocks(), 1u);
+    EXPECT_NEAR(meter.GetP50CpuLoad(), 0.1f, 0.1f);
+    EXPECT_FLOAT_EQ(meter.GetPercentileCpuLoad(1.0f), 1.5f);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 1.5f);
+}
+
+TEST(util_CycleCpuLoadMeter, f_tolerateCounterOverflow)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48);
+
+    // 50% load across the wrap of the cycle counter
+    System::SetCycleCountForUnitTest(0xFFFFFFFFu - 120000u);
+    MeasureBlock(meter, 240000);
+    EXPECT_LT(System::GetCycleCount(), 240000u);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.5f);
+    EXPECT_NEAR(meter.GetP50CpuLoad(), 0.5f, 0.01f);
+}
+
+TEST(util_CycleCpuLoadMeter, g_followClockChange)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    CycleCpuLoadMeter<> meter;
+    meter.Init(48000.0f, 48); // 480000 cycles per block
+
+    MeasureBlock(meter, 96000); // 20%
+
+    // the CPU clock halves during the next block, which isn't counted
+    meter.OnBlockStart();
+    System::SetSysClkFreqForUnitTest(240000000u);
+    System::ClockChangeForUnitTest();
+    System::SetCycleCountForUnitTest(System::GetCycleCount() + 480000);
+    meter.OnBlockEnd();
+    EXPECT_EQ(meter.GetNumBlocks(), 1u);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.2f);
+
+    MeasureBlock(meter, 96000); // 40% at 240000 cycles per block
+    EXPECT_EQ(meter.GetNumBlocks(), 2u);
+    EXPECT_FLOAT_EQ(meter.GetAvgCpuLoad(), 0.3f);
+    EXPECT_FLOAT_EQ(meter.GetMaxCpuLoad(), 0.4f);
+    EXPECT_EQ(meter.GetNumOverloadedBlocks(), 0u);
+}
@@ -0,0 +1,64 @@
+#include "util/DmaBuffer.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_DmaBuffer, a_ownsWholeCacheLines)
+{
+    // data that ends in the middle of a line is padded to its end
+    EXPECT_EQ(alignof(DmaBuffer<uint8_t, 3>), 32u);
+    EXPECT_EQ(sizeof(DmaBuffer<uint8_t, 3>) % 32, 0u);
+    EXPECT_EQ(sizeof(DmaBuffer<int32_t, 24>) % 32, 0u);
+
+    DmaBuffer<uint8_t, 33> buffers[2];
+    for(auto& b : buffers)
+    {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(b.Data()) % 32, 0u);
+        EXPECT_EQ(b.Size(), 33u);
+        EXPECT_EQ(b.SizeBytes(), 33u);
+    }
+    // the second buffer starts after the padded lines of the first
+    EXPECT_GE(buffers[1].Data(), buffers[0].Data() + 64);
+}
+
+TEST(util_DmaBuffer, b_elementAccess)
+{
+    DmaBuffer<int16_t, 8> buffer = {};
+    for(size_t i = 0; i < buffer.Size(); i++)
+        buffer[i] = int16_t(i * 3);
+    int sum = 0;
+    for(int16_t v : buffer)
+        sum += v;
+    EXPECT_EQ(sum, 3 * 28);
+    EXPECT_EQ(buffer.Data()[5], 15);
+    EXPECT_EQ(buffer.SizeBytes(), 16u);
+}
+
+TEST(util_DmaBuffer, c_dirtyRange)
+{
+    DmaBuffer<float, 64> buffer = {};
+    EXPECT_FALSE(buffer.IsDirty());
+
+    buffer.MarkDirty(10, 4);
+    EXPECT_TRUE(buffer.IsDirty());
+    EXPECT_EQ(buffer.GetDirtyBegin(), 10u);
+    EXPECT_EQ(buffer.GetDirtyEnd(), 14u);
+
+    // ranges are merged
+    buffer.MarkDirty(2, 1);
+    buffer.MarkDirty(20, 100); // clamped to the end
+    EXPECT_EQ(buffer.GetDirtyBegin(), 2u);
+    EXPECT_EQ(buffer.GetDirtyEnd(), 64u);
+
+    // out of range and empty ranges are ignored
+    buffer.Clean();
+    buffer.MarkDirty(64, 1);
+    buffer.MarkDirty(3, 0);
+    EXPECT_FALSE(buffer.IsDirty());
+
+    buffer.MarkDirty();
+    EXPECT_EQ(buffer.GetDirtyBegin(), 0u);
+    EXPECT_EQ(buffer.GetDirtyEnd(), 64u);
+    buffer.Clean();
+    EXPECT_FALSE(buffer.IsDirty());
+}
@@ -0,0 +1,78 @@
+#include "sys/dma_streams.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+using Stream = DmaStreamAllocator::Stream;
+
+TEST(sys_DmaStreamAllocator, a_claimAndRelease)
+{
+    DmaStreamAllocator::Reset();
+    EXPECT_TRUE(DmaStreamAllocator::Claim(Stream::DMA_1_STREAM_0, "sai1", 87));
+    EXPECT_FALSE(DmaStreamAllocator::IsFree(Stream::DMA_1_STREAM_0));
+    EXPECT_STREQ(DmaStreamAllocator::GetOwner(Stream::DMA_1_STREAM_0), "sai1");
+
+    // the owner can claim it again, e.g. with each transfer
+    EXPECT_TRUE(DmaStreamAllocator::Claim(Stream::DMA_1_STREAM_0, "sai1", 87));
+
+    // others can't release it
+    DmaStreamAllocator::Release(Stream::DMA_1_STREAM_0, "spi");
+    EXPECT_FALSE(DmaStreamAllocator::IsFree(Stream::DMA_1_STREAM_0));
+    DmaStreamAllocator::Release(Stream::DMA_1_STREAM_0, "sai1");
+    EXPECT_TRUE(DmaStreamAllocator::IsFree(Stream::DMA_1_STREAM_0));
+    EXPECT_EQ(DmaStreamAllocator::GetNumConflicts(), 0u);
+}
+
+TEST(sys_DmaStreamAllocator, b_conflicts)
+{
+    DmaStreamAllocator::Reset();
+    EXPECT_TRUE(
+        DmaStreamAllocator::Claim(Stream::DMA_1_STREAM_5, "usart1", 41));
+
+    // the same stream
+    EXPECT_FALSE(DmaStreamAllocator::Claim(Stream::DMA_1_STREAM_5, "leds"));
+    // the same request line on another stream
+    EXPECT_FALSE(DmaStreamAllocator::Claim(Stream::DMA_2_STREAM_0, "spi", 41));
+    EXPECT_TRUE(DmaStreamAllocator::IsFree(Stream::DMA_2_STREAM_0));
+
+    EXPECT_EQ(DmaStreamAllocator::GetNumConflicts(), 2u);
+    const DmaStreamAllocator::Conflict c = DmaStreamAllocator::GetConflict(1);
+    EXPECT_TRUE(c.stream == Stream::DMA_2_STREAM_0);
+    EXPECT_EQ(c.request, 41u);
+    EXPECT_STREQ(c.owner, "spi");
+    EXPECT_STREQ(c.holder, "usart1");
+    EXPECT_EQ(DmaStreamAllocator::GetConflict(2).owner, nullptr);
+}
+
+TEST(sys_DmaStreamAllocator, c_claimFree)
+{
+    DmaStreamAllocator::Reset();
+    const uint16_t candidates
+        = DmaStreamAllocator::Bit(Stream::DMA_1_STREAM_5)
+          | DmaStreamAllocator::Bit(Stream::DMA_2_STREAM_7);
+
+    // the highest stream first
+    EXPECT_TRUE(DmaStreamAllocator::ClaimFree(candidates, "gates")
+                == Stream::DMA_2_STREAM_7);
+    // an owner can have several
+    EXPECT_TRUE(DmaStreamAllocator::ClaimFree(candidates, "gates")
+                == Stream::DMA_1_STREAM_5);
+    EXPECT_TRUE(DmaStreamAllocator::ClaimFree(candidates, "uart")
+                == Stream::NONE);
+    EXPECT_EQ(DmaStreamAllocator::GetNumConflicts(), 1u);
+
+    // the conflicts past kMaxConflicts are only counted
+    for(int i = 0; i < 10; i++)
+        DmaStreamAllocator::ClaimFree(candidates, "uart");
+    EXPECT_EQ(DmaStreamAllocator::GetNumConflicts(), 11u);
+    EXPECT_STREQ(DmaStreamAllocator::GetConflict(3).owner, "uart");
+    EXPECT_EQ(DmaStreamAllocator::GetConflict(4).owner, nullptr);
+
+    DmaStreamAllocator::Release(Stream::DMA_1_STREAM_5, "gates");
+    EXPECT_TRUE(DmaStreamAllocator::ClaimFree(candidates, "uart")
+                == Stream::DMA_1_STREAM_5);
+
+    DmaStreamAllocator::Reset();
+    EXPECT_TRUE(DmaStreamAllocator::IsFree(Stream::DMA_2_STREAM_7));
+    EXPECT_EQ(DmaStreamAllocator::GetNumConflicts(), 0u);
+}
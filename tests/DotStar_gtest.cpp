@@ -0,0 +1,105 @@
+#include "util/color.h"
+#include "dev/dotstar.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Records the transfers, and completes them when the test says so */
+struct FakeTransport
+{
+    struct Config
+    {
+        void Defaults() {}
+    };
+
+    void Init(Config&) {}
+
+    bool Write(uint8_t* data, size_t size)
+    {
+        written.insert(written.end(), data, data + size);
+        return true;
+    }
+
+    bool Transmit(uint8_t* data, size_t size, void (*done)(void*), void* ctx)
+    {
+        sent.emplace_back(data, data + size);
+        done_    = done;
+        context_ = ctx;
+        return true;
+    }
+
+    static void Complete() { done_(context_); }
+
+    static std::vector<uint8_t>              written;
+    static std::vector<std::vector<uint8_t>> sent;
+    static void (*done_)(void*);
+    static void* context_;
+};
+std::vector<uint8_t>              FakeTransport::written;
+std::vector<std::vector<uint8_t>> FakeTransport::sent;
+void (*FakeTransport::done_)(void*);
+void* FakeTransport::context_;
+
+using Strip = DotStar<FakeTransport>;
+} // namespace
+
+TEST(dev_DotStar, dmaFrameMatchesBlockingFrame)
+{
+    uint8_t buffer_a[Strip::GetDmaBufferSize(100)];
+    uint8_t buffer_b[Strip::GetDmaBufferSize(100)];
+    FakeTransport::written.clear();
+    FakeTransport::sent.clear();
+
+    Strip         blocking, dma;
+    Strip::Config cfg;
+    cfg.Defaults();
+    cfg.num_pixels = 100;
+    ASSERT_EQ(blocking.Init(cfg), Strip::Result::OK);
+    cfg.dma_buffer_a = buffer_a;
+    cfg.dma_buffer_b = buffer_b;
+    ASSERT_EQ(dma.Init(cfg), Strip::Result::OK);
+
+    blocking.Fill(0x123456);
+    dma.Fill(0x123456);
+    blocking.Show();
+    dma.Show();
+
+    // 100 pixels need 50 more clocks than the usual 32
+    ASSERT_EQ(FakeTransport::written.size(), 4u + 400u + 8u);
+    ASSERT_EQ(FakeTransport::sent.size(), 1u);
+    EXPECT_EQ(FakeTransport::sent[0], FakeTransport::written);
+    EXPECT_EQ(FakeTransport::written[4], 0xE1);
+    EXPECT_EQ(FakeTransport::written[5], 0x12);
+}
+
+TEST(dev_DotStar, showDoesNotWaitForTheStrip)
+{
+    uint8_t buffer_a[Strip::GetDmaBufferSize(1)];
+    uint8_t buffer_b[Strip::GetDmaBufferSize(1)];
+    FakeTransport::sent.clear();
+
+    Strip         strip;
+    Strip::Config cfg;
+    cfg.Defaults();
+    cfg.dma_buffer_a = buffer_a;
+    cfg.dma_buffer_b = buffer_b;
+    ASSERT_EQ(strip.Init(cfg), Strip::Result::OK);
+
+    strip.Show();
+    EXPECT_TRUE(strip.IsBusy());
+    strip.SetPixelColor(0, 1, 2, 3);
+    strip.Show();
+    strip.SetPixelColor(0, 4, 5, 6);
+    strip.Show();
+    EXPECT_EQ(FakeTransport::sent.size(), 1u);
+
+    // only the newest of the waiting frames is sent
+    FakeTransport::Complete();
+    ASSERT_EQ(FakeTransport::sent.size(), 2u);
+    EXPECT_EQ(FakeTransport::sent[1][5], 4);
+    FakeTransport::Complete();
+    EXPECT_FALSE(strip.IsBusy());
+}
@@ -0,0 +1,128 @@
+#include "FakeFatFs.h"
+#include "sys/system.h"
+#include <cstring>
+
+using namespace daisy;
+
+std::vector<std::string>                    FakeFatFs::calls;
+std::vector<uint8_t>                        FakeFatFs::file;
+std::map<std::string, std::vector<uint8_t>> FakeFatFs::files;
+size_t                                      FakeFatFs::volumeSize;
+
+namespace
+{
+/** the contents of the open files that were found in files */
+std::map<const FIL*, std::vector<uint8_t>*> opened;
+
+std::vector<uint8_t>& Contents(FIL* fp)
+{
+    auto it = opened.find(fp);
+    return it != opened.end() ? *it->second : FakeFatFs::file;
+}
+
+std::string Name(FIL* fp)
+{
+    return std::to_string(fp->flag);
+}
+
+/** every call takes 100us */
+void Spend()
+{
+    System::SetUsForUnitTest(System::GetUs() + 100);
+}
+} // namespace
+
+void FakeFatFs::Reset()
+{
+    calls.clear();
+    file.clear();
+    files.clear();
+    opened.clear();
+    volumeSize = 1 << 20;
+}
+
+extern "C"
+{
+    FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("open " + Name(fp) + " " + path);
+        opened.erase(fp);
+        auto it = FakeFatFs::files.find(path);
+        if(it != FakeFatFs::files.end())
+            opened[fp] = &it->second;
+        else if((mode & (FA_WRITE | FA_CREATE_ALWAYS | FA_OPEN_ALWAYS)) == 0)
+            return FR_NO_FILE;
+        fp->fptr        = 0;
+        fp->obj.objsize = Contents(fp).size();
+        return FR_OK;
+    }
+    FRESULT f_close(FIL* fp)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("close " + Name(fp));
+        opened.erase(fp);
+        return FR_OK;
+    }
+    FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("read " + Name(fp) + " "
+                                   + std::to_string(btr));
+        std::vector<uint8_t>& file = Contents(fp);
+        const size_t          left = file.size() - fp->fptr;
+        *br                        = UINT(btr < left ? btr : left);
+        std::memcpy(buff, file.data() + fp->fptr, *br);
+        fp->fptr += *br;
+        return FR_OK;
+    }
+    FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("write " + Name(fp) + " "
+                                   + std::to_string(btw));
+        std::vector<uint8_t>& file = Contents(fp);
+        const size_t          left = FakeFatFs::volumeSize - fp->fptr;
+        *bw                        = UINT(btw < left ? btw : left);
+        if(file.size() < fp->fptr + *bw)
+            file.resize(fp->fptr + *bw);
+        std::memcpy(file.data() + fp->fptr, buff, *bw);
+        fp->fptr += *bw;
+        return FR_OK;
+    }
+    FRESULT f_lseek(FIL* fp, FSIZE_t ofs)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("seek " + Name(fp) + " "
+                                   + std::to_string(ofs));
+        if(ofs > Contents(fp).size())
+            return FR_INVALID_PARAMETER;
+        fp->fptr = ofs;
+        return FR_OK;
+    }
+    FRESULT f_sync(FIL* fp)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("sync " + Name(fp));
+        return FR_OK;
+    }
+    FRESULT f_truncate(FIL* fp)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("truncate " + Name(fp) + " "
+                                   + std::to_string(fp->fptr));
+        Contents(fp).resize(fp->fptr);
+        return FR_OK;
+    }
+    FRESULT f_expand(FIL* fp, FSIZE_t szf, BYTE opt)
+    {
+        Spend();
+        FakeFatFs::calls.push_back("expand " + Name(fp) + " "
+                                   + std::to_string(szf));
+        (void)opt;
+        if(szf > FakeFatFs::volumeSize)
+            return FR_DENIED;
+        Contents(fp).resize(szf);
+        return FR_OK;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef DSY_FAKEFATFS_H
+#define DSY_FAKEFATFS_H
+
+#include "ff.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace daisy
+{
+/** Stands in for FatFs in the tests, all f_ calls take 100us
+ *
+ *  The files a test puts into files are opened by their path. Files that
+ *  are opened for writing, or never opened, all share the contents of file.
+ *  Files opened for reading that aren't in files don't exist.
+ */
+struct FakeFatFs
+{
+    /** log of the FatFs calls */
+    static std::vector<std::string>                    calls;
+    static std::vector<uint8_t>                        file;
+    static std::map<std::string, std::vector<uint8_t>> files;
+    static size_t                                      volumeSize;
+
+    /** Empties the log and the files */
+    static void Reset();
+};
+
+} // namespace daisy
+
+#endif
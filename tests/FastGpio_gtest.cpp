@@ -0,0 +1,46 @@
+#include "per/gpio.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+static_assert(GetGpioPortAddress(PORTA) == 0x58020000u, "GPIOA");
+static_assert(GetGpioPortAddress(PORTK) == 0x58022800u, "GPIOK");
+static_assert(FastPin<PORTC, 10>::GetPin() == Pin(PORTC, 10), "pin");
+
+TEST(per_FastGpio, a_writeAndRead)
+{
+    volatile uint32_t regs[8] = {};
+    FastGpio          gpio;
+    gpio.Init(regs, 3);
+
+    gpio.Write(true);
+    EXPECT_EQ(regs[FastGpio::kBsrr], 1u << 3);
+    gpio.Clear();
+    EXPECT_EQ(regs[FastGpio::kBsrr], 1u << 19);
+    gpio.Set();
+    EXPECT_EQ(regs[FastGpio::kBsrr], 1u << 3);
+
+    regs[FastGpio::kIdr] = 1u << 3;
+    EXPECT_TRUE(gpio.Read());
+    regs[FastGpio::kIdr] = ~(1u << 3);
+    EXPECT_FALSE(gpio.Read());
+
+    // toggles from the output that is set
+    regs[FastGpio::kOdr] = 1u << 3;
+    gpio.Toggle();
+    EXPECT_EQ(regs[FastGpio::kBsrr], 1u << 19);
+    regs[FastGpio::kOdr] = 0;
+    gpio.Toggle();
+    EXPECT_EQ(regs[FastGpio::kBsrr], 1u << 3);
+}
+
+TEST(per_FastGpio, b_invalidPin)
+{
+    // writes to nothing, and reads low
+    FastGpio gpio;
+    gpio.Write(true);
+    EXPECT_FALSE(gpio.Read());
+    gpio.Init(Pin());
+    gpio.Toggle();
+    EXPECT_FALSE(gpio.Read());
+}
@@ -0,0 +1,61 @@
+#include "util/FastMath.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace daisy;
+
+TEST(util_FastMath, a_pow2)
+{
+    for(float x = -125.f; x <= 127.f; x += 0.0137f)
+    {
+        const double expected = std::pow(2.0, double(x));
+        ASSERT_NEAR(fastpow2f(x) / expected, 1.0, 4e-6) << "x = " << x;
+    }
+    // integers are exact
+    EXPECT_EQ(fastpow2f(0.f), 1.f);
+    EXPECT_EQ(fastpow2f(10.f), 1024.f);
+    EXPECT_EQ(fastpow2f(-3.f), 0.125f);
+    // clamped
+    EXPECT_TRUE(std::isfinite(fastpow2f(1000.f)));
+    EXPECT_GT(fastpow2f(-1000.f), 0.f);
+}
+
+TEST(util_FastMath, b_log2)
+{
+    for(float x = 1e-30f; x < 1e30f; x *= 1.0041f)
+    {
+        const double expected = std::log2(double(x));
+        ASSERT_NEAR(fastlog2f(x), expected, 1e-5) << "x = " << x;
+    }
+    EXPECT_EQ(fastlog2f(1.f), 0.f);
+    EXPECT_EQ(fastlog2f(8.f), 3.f);
+}
+
+TEST(util_FastMath, c_exp)
+{
+    for(float x = -80.f; x <= 80.f; x += 0.01f)
+        ASSERT_NEAR(fastexpf(x) / std::exp(double(x)), 1.0, 1e-5) << x;
+}
+
+TEST(util_FastMath, d_pow2Order)
+{
+    // the largest interval to the exact value, in cents
+    const float limits[3] = {3.f, 0.13f, 0.005f};
+    float       worst[3]  = {};
+    for(float x = -10.f; x <= 10.f; x += 0.001f)
+    {
+        const double exact    = std::pow(2.0, double(x));
+        const float  result[] = {fastpow2f_order<2>(x),
+                                 fastpow2f_order<3>(x),
+                                 fastpow2f_order<4>(x)};
+        for(int i = 0; i < 3; i++)
+        {
+            const float cents
+                = std::fabs(1200.0 * std::log2(double(result[i]) / exact));
+            worst[i] = std::max(worst[i], cents);
+        }
+    }
+    for(int i = 0; i < 3; i++)
+        EXPECT_LT(worst[i], limits[i]) << "order " << i + 2;
+}
@@ -0,0 +1,58 @@
+#include "util/FastRandom.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_FastRandom, a_seeded)
+{
+    FastRandom a(1234), b(1234), c(1235);
+    bool       differs = false;
+    for(int i = 0; i < 100; i++)
+    {
+        const uint32_t x = a.Next();
+        EXPECT_EQ(x, b.Next());
+        EXPECT_NE(x, 0u);
+        differs |= x != c.Next();
+    }
+    EXPECT_TRUE(differs);
+
+    // 0 would only give 0s
+    FastRandom zero(0);
+    EXPECT_NE(zero.Next(), 0u);
+
+    // continues from a saved state
+    FastRandom d;
+    d.Init(a.GetState());
+    EXPECT_EQ(d.Next(), a.Next());
+}
+
+TEST(util_FastRandom, b_ranges)
+{
+    FastRandom rng(42);
+    float      sum = 0.f;
+    for(int i = 0; i < 10000; i++)
+    {
+        const float u = rng.NextFloat();
+        EXPECT_GE(u, 0.f);
+        EXPECT_LT(u, 1.f);
+        const float b = rng.NextBipolar();
+        EXPECT_GE(b, -1.f);
+        EXPECT_LT(b, 1.f);
+        sum += b;
+        const float r = rng.NextFloat(-3.f, 5.f);
+        EXPECT_GE(r, -3.f);
+        EXPECT_LT(r, 5.f);
+        EXPECT_LT(rng.NextBelow(7), 7u);
+    }
+    EXPECT_NEAR(sum / 10000.f, 0.f, 0.03f);
+}
+
+TEST(util_FastRandom, c_block)
+{
+    FastRandom block(99), single(99);
+    float      out[64];
+    block.ProcessBlock(out, 64);
+    for(float sample : out)
+        EXPECT_FLOAT_EQ(sample, single.NextBipolar());
+    EXPECT_EQ(block.GetState(), single.GetState());
+}
@@ -0,0 +1,167 @@
+#include "util/FileIoQueue.h"
+#include "FakeFatFs.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace daisy;
+
+class util_FileIoQueue : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        FakeFatFs::Reset();
+        queue_.Init(1024);
+        // the flag is used as the name of the file in the log
+        a_.flag = 1;
+        b_.flag = 2;
+        a_.fptr = 0;
+        b_.fptr = 0;
+        results_.clear();
+    }
+
+    /** records the completions */
+    static void OnDone(void* context, FRESULT result, size_t bytes)
+    {
+        auto* self = static_cast<util_FileIoQueue*>(context);
+        self->results_.push_back(std::to_string(result) + " "
+                                 + std::to_string(bytes));
+    }
+
+    FileIoQueue              queue_;
+    FIL                      a_, b_;
+    std::vector<std::string> results_;
+};
+
+TEST_F(util_FileIoQueue, a_executesInOrder)
+{
+    uint8_t data[3000];
+    for(size_t i = 0; i < sizeof(data); i++)
+        data[i] = uint8_t(i);
+    const auto prio = FileIoQueue::Priority::NORMAL;
+    EXPECT_TRUE(queue_.Open(&a_, "a.bin", FA_WRITE, prio, OnDone, this));
+    EXPECT_TRUE(queue_.Write(&a_, data, sizeof(data), prio, OnDone, this));
+    EXPECT_TRUE(queue_.Sync(&a_, prio, OnDone, this));
+    EXPECT_TRUE(queue_.Close(&a_, prio, OnDone, this));
+    EXPECT_EQ(queue_.GetNumPending(), 4u);
+
+    // nothing happens before processing
+    EXPECT_TRUE(FakeFatFs::calls.empty());
+    while(queue_.Process(1000) > 0) {}
+
+    // the write is split into chunks
+    const std::vector<std::string> expected
+        = {"open 1 a.bin",
+           "write 1 1024",
+           "write 1 1024",
+           "write 1 952",
+           "sync 1",
+           "close 1"};
+    EXPECT_EQ(FakeFatFs::calls, expected);
+    const std::vector<std::string> expectedResults
+        = {"0 0", "0 3000", "0 0", "0 0"};
+    EXPECT_EQ(results_, expectedResults);
+    ASSERT_EQ(FakeFatFs::file.size(), sizeof(data));
+    EXPECT_EQ(std::memcmp(FakeFatFs::file.data(), data, sizeof(data)), 0);
+}
+
+TEST_F(util_FileIoQueue, b_timeSlices)
+{
+    uint8_t data[8192] = {};
+    queue_.Write(
+        &a_, data, sizeof(data), FileIoQueue::Priority::NORMAL, OnDone, this);
+
+    // each call takes 100us, at least one step is done per slice
+    EXPECT_EQ(queue_.Process(0), 1u);
+    EXPECT_EQ(FakeFatFs::calls.size(), 1u);
+    EXPECT_EQ(queue_.Process(250), 1u);
+    EXPECT_EQ(FakeFatFs::calls.size(), 4u);
+    EXPECT_EQ(queue_.Process(1000), 0u);
+    EXPECT_EQ(FakeFatFs::calls.size(), 8u);
+    EXPECT_EQ(results_, std::vector<std::string>{"0 8192"});
+}
+
+TEST_F(util_FileIoQueue, c_streamingPreemptsBackground)
+{
+    FakeFatFs::file.resize(4096);
+    uint8_t record[4096] = {};
+    uint8_t stream[512];
+    queue_.Write(&a_,
+                 record,
+                 sizeof(record),
+                 FileIoQueue::Priority::BACKGROUND,
+                 OnDone,
+                 this);
+    queue_.Process(0);
+
+    // the read on the other file goes in between the chunks of the write
+    queue_.Seek(&b_, 100, FileIoQueue::Priority::STREAMING, OnDone, this);
+    queue_.Read(&b_,
+                stream,
+                sizeof(stream),
+                FileIoQueue::Priority::STREAMING,
+                OnDone,
+                this);
+    while(queue_.Process(1000) > 0) {}
+
+    const std::vector<std::string> expected = {"write 1 1024",
+                                               "seek 2 100",
+                                               "read 2 512",
+                                               "write 1 1024",
+                                               "write 1 1024",
+                                               "write 1 1024"};
+    EXPECT_EQ(FakeFatFs::calls, expected);
+    const std::vector<std::string> expectedResults
+        = {"0 0", "0 512", "0 4096"};
+    EXPECT_EQ(results_, expectedResults);
+}
+
+TEST_F(util_FileIoQueue, d_sameFileKeepsOrder)
+{
+    FakeFatFs::file.resize(2048);
+    uint8_t buff[512];
+    // a streaming read can't overtake a background seek on the same file
+    queue_.Seek(&a_, 1024, FileIoQueue::Priority::BACKGROUND, OnDone, this);
+    queue_.Read(
+        &a_, buff, sizeof(buff), FileIoQueue::Priority::STREAMING, OnDone, this);
+    while(queue_.Process(1000) > 0) {}
+
+    const std::vector<std::string> expected = {"seek 1 1024", "read 1 512"};
+    EXPECT_EQ(FakeFatFs::calls, expected);
+}
+
+TEST_F(util_FileIoQueue, e_shortTransfersAndErrors)
+{
+    // reading stops at the end of the file
+    FakeFatFs::file.resize(1500);
+    uint8_t buff[4096];
+    queue_.Read(
+        &a_, buff, sizeof(buff), FileIoQueue::Priority::NORMAL, OnDone, this);
+    // writing stops when the volume is full
+    FakeFatFs::volumeSize = 1100;
+    queue_.Write(
+        &b_, buff, sizeof(buff), FileIoQueue::Priority::NORMAL, OnDone, this);
+    // errors are passed on
+    queue_.Seek(&a_, 5000, FileIoQueue::Priority::NORMAL, OnDone, this);
+    while(queue_.Process(1000) > 0) {}
+
+    const std::vector<std::string> expectedResults
+        = {"0 1500", "0 1100", std::to_string(FR_INVALID_PARAMETER) + " 0"};
+    EXPECT_EQ(results_, expectedResults);
+}
+
+TEST_F(util_FileIoQueue, f_fullQueue)
+{
+    for(size_t i = 0; i < DSY_FILEIO_QUEUE_SIZE; i++)
+        EXPECT_TRUE(
+            queue_.Sync(&a_, FileIoQueue::Priority::NORMAL, OnDone, this));
+    EXPECT_FALSE(queue_.Sync(&a_, FileIoQueue::Priority::NORMAL, OnDone, this));
+
+    // the callback can queue the next request
+    queue_.Process(0);
+    EXPECT_TRUE(queue_.Sync(&a_, FileIoQueue::Priority::NORMAL, OnDone, this));
+    while(queue_.Process(1000) > 0) {}
+    EXPECT_EQ(results_.size(), size_t(DSY_FILEIO_QUEUE_SIZE + 1));
+}
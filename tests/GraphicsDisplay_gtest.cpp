@@ -0,0 +1,212 @@
+#include "hid/disp/graphics_display.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace daisy;
+
+// There's no DMA2D on the host. Every request fails, so the display
+// draws with the CPU.
+namespace daisy
+{
+Dma2dHandle::Result Dma2dHandle::Init()
+{
+    return Result::OK;
+}
+Dma2dHandle::Result Dma2dHandle::Fill(const PixelBuffer&,
+                                      uint16_t,
+                                      uint16_t,
+                                      uint16_t,
+                                      uint16_t,
+                                      uint32_t,
+                                      EndCallbackFunctionPtr,
+                                      void*)
+{
+    return Result::ERR;
+}
+Dma2dHandle::Result Dma2dHandle::Copy(const PixelBuffer&,
+                                      uint16_t,
+                                      uint16_t,
+                                      const PixelBuffer&,
+                                      EndCallbackFunctionPtr,
+                                      void*)
+{
+    return Result::ERR;
+}
+Dma2dHandle::Result Dma2dHandle::Blend(const PixelBuffer&,
+                                       uint16_t,
+                                       uint16_t,
+                                       const PixelBuffer&,
+                                       uint8_t,
+                                       uint32_t,
+                                       EndCallbackFunctionPtr,
+                                       void*)
+{
+    return Result::ERR;
+}
+bool Dma2dHandle::IsBusy() const
+{
+    return false;
+}
+size_t Dma2dHandle::GetNumQueued() const
+{
+    return 0;
+}
+void Dma2dHandle::Wait() const {}
+bool Dma2dHandle::CanRead(PixelFormat format)
+{
+    return format != PixelFormat::RGB565_SWAPPED && format != PixelFormat::L4;
+}
+bool Dma2dHandle::CanWrite(PixelFormat format)
+{
+    return format != PixelFormat::A8 && format != PixelFormat::L4;
+}
+} // namespace daisy
+
+namespace
+{
+/** A driver that only has a framebuffer */
+template <PixelFormat format>
+class FakeDriver
+{
+  public:
+    struct Config
+    {
+    };
+    void Init(const Config&)
+    {
+        memset(buffer, 0, sizeof(buffer));
+        updates = 0;
+    }
+    uint16_t    Width() const { return 9; }
+    uint16_t    Height() const { return 5; }
+    PixelBuffer GetFramebuffer() { return {buffer, format, 9, 5}; }
+    void        Update() { updates++; }
+
+    uint32_t buffer[9 * 5];
+    int      updates;
+};
+
+template <PixelFormat format>
+uint32_t PixelAt(FakeDriver<format>& driver, size_t x, size_t y)
+{
+    return ReadPixel(driver.GetFramebuffer(), x, y);
+}
+} // namespace
+
+TEST(util_PixelFormat, a_roundTrips)
+{
+    uint32_t          data[4]   = {};
+    const PixelFormat formats[] = {PixelFormat::ARGB8888,
+                                   PixelFormat::RGB888,
+                                   PixelFormat::RGB565,
+                                   PixelFormat::RGB565_SWAPPED};
+    for(PixelFormat format : formats)
+    {
+        PixelBuffer buffer = {data, format, 2, 2};
+        WritePixel(buffer, 1, 1, 0xff0882ff);
+        WritePixel(buffer, 0, 1, 0xff000000);
+        EXPECT_EQ(ReadPixel(buffer, 1, 1), 0xff0882ffu) << int(format);
+        EXPECT_EQ(ReadPixel(buffer, 0, 1), 0xff000000u) << int(format);
+    }
+
+    PixelBuffer argb4444 = {data, PixelFormat::ARGB4444, 2, 2};
+    WritePixel(argb4444, 1, 0, 0x80ff4020);
+    EXPECT_EQ(ReadPixel(argb4444, 1, 0), 0x88ff4422u);
+
+    PixelBuffer argb1555 = {data, PixelFormat::ARGB1555, 2, 2};
+    WritePixel(argb1555, 1, 0, 0x7fffffff);
+    EXPECT_EQ(ReadPixel(argb1555, 1, 0), 0x00ffffffu);
+}
+
+TEST(util_PixelFormat, b_byteOrder)
+{
+    uint8_t     data[4] = {};
+    PixelBuffer swapped = {data, PixelFormat::RGB565_SWAPPED, 2, 1};
+    WritePixel(swapped, 0, 0, 0xffff0000);
+    EXPECT_EQ(data[0], 0xf8);
+    EXPECT_EQ(data[1], 0x00);
+
+    // the first pixel in the high nibble, as the SSD1327 takes it
+    PixelBuffer l4 = {data, PixelFormat::L4, 4, 1};
+    WritePixel(l4, 0, 0, 0xffffffff);
+    WritePixel(l4, 1, 0, 0xff000000);
+    WritePixel(l4, 3, 0, 0xff777777);
+    EXPECT_EQ(data[0], 0xf0);
+    EXPECT_EQ(data[1], 0x07);
+    EXPECT_EQ(ReadPixel(l4, 3, 0), 0xff777777u);
+}
+
+TEST(util_PixelFormat, c_blend)
+{
+    EXPECT_EQ(BlendPixel(0xffffffff, 0xff000000), 0xffffffffu);
+    EXPECT_EQ(BlendPixel(0x00ffffff, 0xff000000), 0xff000000u);
+    EXPECT_EQ(BlendPixel(0xffff0000, 0xff0000ff, 0), 0xff0000ffu);
+    EXPECT_EQ(BlendPixel(0x80ff0000, 0xff0000ff), 0xff80007fu);
+    EXPECT_EQ(BlendPixel(0xffff0000, 0xff0000ff, 0x80), 0xff80007fu);
+    EXPECT_EQ(GetLuminance(0xffffffff), 255);
+    EXPECT_EQ(GetLuminance(0xff000000), 0);
+}
+
+TEST(hid_disp_FramebufferDisplay, a_fillsAreClipped)
+{
+    FramebufferDisplay<FakeDriver<PixelFormat::RGB565>> display;
+    display.Init({});
+    auto& driver = display.GetDriver();
+
+    display.Fill(0xff0000ff);
+    display.FillRect(7, 3, 10, 10, 0xffffffff);
+    display.DrawPixel(0, 0, 0xffff0000);
+    display.DrawPixel(9, 0, 0xffffffff);
+    for(size_t y = 0; y < 5; y++)
+    {
+        for(size_t x = 0; x < 9; x++)
+        {
+            uint32_t expected = x >= 7 && y >= 3 ? 0xffffffff : 0xff0000ff;
+            if(x == 0 && y == 0)
+                expected = 0xffff0000;
+            EXPECT_EQ(PixelAt(driver, x, y), expected) << x << ", " << y;
+        }
+    }
+    display.Update();
+    EXPECT_EQ(driver.updates, 1);
+}
+
+TEST(hid_disp_FramebufferDisplay, b_imagesAreConverted)
+{
+    FramebufferDisplay<FakeDriver<PixelFormat::L4>> display;
+    display.Init({});
+    auto& driver = display.GetDriver();
+
+    // 3 x 2 ARGB8888, drawn at the right edge
+    uint32_t pixels[]
+        = {0xffffffff, 0xff000000, 0xff777777, 0xff333333, 0xffffffff, 0};
+    const PixelBuffer image = {pixels, PixelFormat::ARGB8888, 3, 2};
+    display.Fill(0xff000000);
+    display.DrawImage(7, 1, image);
+    EXPECT_EQ(PixelAt(driver, 7, 1), 0xffffffffu);
+    EXPECT_EQ(PixelAt(driver, 8, 1), 0xff000000u);
+    EXPECT_EQ(PixelAt(driver, 7, 2), 0xff333333u);
+    EXPECT_EQ(PixelAt(driver, 8, 2), 0xffffffffu);
+    EXPECT_EQ(PixelAt(driver, 6, 1), 0xff000000u);
+    EXPECT_EQ(PixelAt(driver, 0, 2), 0xff000000u);
+}
+
+TEST(hid_disp_FramebufferDisplay, c_masksAreBlendedInAColour)
+{
+    FramebufferDisplay<FakeDriver<PixelFormat::ARGB8888>> display;
+    display.Init({});
+    auto& driver = display.GetDriver();
+
+    uint8_t           alpha[] = {0xff, 0x80, 0x00, 0x40};
+    const PixelBuffer mask    = {alpha, PixelFormat::A8, 2, 2};
+    display.Fill(0xff0000ff);
+    display.BlendImage(1, 1, mask, 255, 0xff0000);
+    EXPECT_EQ(PixelAt(driver, 1, 1), 0xffff0000u);
+    EXPECT_EQ(PixelAt(driver, 2, 1), 0xff80007fu);
+    EXPECT_EQ(PixelAt(driver, 1, 2), 0xff0000ffu);
+    EXPECT_EQ(PixelAt(driver, 0, 0), 0xff0000ffu);
+
+    // the constant alpha on top
+    display.BlendImage(1, 1, mask, 0x80, 0x00ff00);
+    EXPECT_EQ(PixelAt(driver, 1, 1), 0xff7f8000u);
+}
@@ -0,0 +1,85 @@
+#include "util/IntrusiveList.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+struct Item : IntrusiveListNode<Item>
+{
+    Item(int v) : value(v) {}
+    int value;
+};
+
+std::vector<int> Values(const IntrusiveList<Item>& list)
+{
+    std::vector<int> values;
+    for(const Item& item : list)
+        values.push_back(item.value);
+    return values;
+}
+} // namespace
+
+TEST(util_IntrusiveList, a_pushAndPop)
+{
+    IntrusiveList<Item> list;
+    Item                a(1), b(2), c(3);
+    EXPECT_TRUE(list.IsEmpty());
+    EXPECT_EQ(list.PopFront(), nullptr);
+
+    EXPECT_TRUE(list.PushBack(b));
+    EXPECT_TRUE(list.PushFront(a));
+    EXPECT_TRUE(list.PushBack(c));
+    EXPECT_EQ(Values(list), (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(list.GetNumElements(), 3u);
+    EXPECT_EQ(list.Front(), &a);
+    EXPECT_EQ(list.Back(), &c);
+    EXPECT_EQ(IntrusiveList<Item>::Next(a), &b);
+    EXPECT_EQ(IntrusiveList<Item>::Prev(a), nullptr);
+
+    EXPECT_EQ(list.PopBack(), &c);
+    EXPECT_EQ(list.PopFront(), &a);
+    EXPECT_FALSE(a.IsLinked());
+    EXPECT_EQ(Values(list), (std::vector<int>{2}));
+}
+
+TEST(util_IntrusiveList, b_insertAndRemove)
+{
+    IntrusiveList<Item> list;
+    Item                a(1), b(2), c(3), d(4);
+    list.PushBack(a);
+    list.PushBack(d);
+    EXPECT_TRUE(list.InsertAfter(a, b));
+    EXPECT_TRUE(list.InsertBefore(d, c));
+    EXPECT_EQ(Values(list), (std::vector<int>{1, 2, 3, 4}));
+
+    EXPECT_TRUE(list.Remove(b));
+    EXPECT_TRUE(list.Remove(d));
+    EXPECT_FALSE(list.Remove(d));
+    EXPECT_EQ(Values(list), (std::vector<int>{1, 3}));
+    EXPECT_EQ(list.Back(), &c);
+
+    list.Clear();
+    EXPECT_TRUE(list.IsEmpty());
+    EXPECT_FALSE(c.IsLinked());
+}
+
+TEST(util_IntrusiveList, c_oneListAtATime)
+{
+    IntrusiveList<Item> first, second;
+    Item                a(1), b(2);
+    first.PushBack(a);
+
+    EXPECT_FALSE(second.PushBack(a));
+    EXPECT_FALSE(second.Remove(a));
+    EXPECT_FALSE(second.InsertAfter(a, b));
+    EXPECT_TRUE(first.Contains(a));
+    EXPECT_FALSE(second.Contains(a));
+
+    // moving to another list
+    first.Remove(a);
+    EXPECT_TRUE(second.PushBack(a));
+    EXPECT_TRUE(first.IsEmpty());
+    EXPECT_EQ(second.Front(), &a);
+}
@@ -0,0 +1,122 @@
+#define DSY_IRQ_PROFILING
+#include "util/IrqProfiler.h"
+#include <gtest/gtest.h>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** records the printed lines */
+struct TestLogger
+{
+    static std::vector<std::string> lines;
+
+    static void PrintLine(const char* format, ...)
+    {
+        char    buff[128];
+        va_list va;
+        va_start(va, format);
+        vsnprintf(buff, sizeof(buff), format, va);
+        va_end(va);
+        lines.push_back(buff);
+    }
+};
+std::vector<std::string> TestLogger::lines;
+
+void Spend(uint32_t cycles)
+{
+    System::SetCycleCountForUnitTest(System::GetCycleCount() + cycles);
+}
+
+void TimerHandler(uint32_t cycles)
+{
+    DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
+    Spend(cycles);
+}
+} // namespace
+
+TEST(util_IrqProfiler, a_countsCallsAndCycles)
+{
+    IrqProfiler::Reset();
+    TimerHandler(100);
+    TimerHandler(300);
+    TimerHandler(200);
+
+    const auto& s = IrqProfiler::GetStats(IrqProfiler::Source::TIMERS);
+    EXPECT_EQ(s.calls, 3u);
+    EXPECT_EQ(s.total_cycles, 600u);
+    EXPECT_EQ(s.max_cycles, 300u);
+    EXPECT_EQ(IrqProfiler::GetTotalCycles(), 600u);
+    EXPECT_EQ(IrqProfiler::GetStats(IrqProfiler::Source::UARTS).calls, 0u);
+
+    IrqProfiler::Reset();
+    EXPECT_EQ(IrqProfiler::GetStats(IrqProfiler::Source::TIMERS).calls, 0u);
+    EXPECT_EQ(IrqProfiler::GetTotalCycles(), 0u);
+}
+
+TEST(util_IrqProfiler, b_nestedHandlersAreExclusive)
+{
+    IrqProfiler::Reset();
+    // the cycle counter wraps around in the middle
+    System::SetCycleCountForUnitTest(0xFFFFFFF0);
+    {
+        DSY_IRQ_PROFILE_SCOPE(Source::SD_CARD);
+        Spend(40);
+        // a timer interrupt of a higher priority, with one more in it
+        {
+            DSY_IRQ_PROFILE_SCOPE(Source::TIMERS);
+            Spend(10);
+            {
+                DSY_IRQ_PROFILE_SCOPE(Source::SYSTICK);
+                Spend(5);
+            }
+            Spend(10);
+        }
+        Spend(40);
+    }
+
+    using Src = IrqProfiler::Source;
+    EXPECT_EQ(IrqProfiler::GetStats(Src::SD_CARD).total_cycles, 80u);
+    EXPECT_EQ(IrqProfiler::GetStats(Src::TIMERS).total_cycles, 20u);
+    EXPECT_EQ(IrqProfiler::GetStats(Src::SYSTICK).total_cycles, 5u);
+    EXPECT_EQ(IrqProfiler::GetTotalCycles(), 105u);
+
+    // a later handler isn't charged for the earlier ones
+    TimerHandler(7);
+    EXPECT_EQ(IrqProfiler::GetStats(Src::TIMERS).max_cycles, 20u);
+    EXPECT_EQ(IrqProfiler::GetStats(Src::TIMERS).total_cycles, 27u);
+}
+
+TEST(util_IrqProfiler, c_latency)
+{
+    IrqProfiler::Reset();
+    using Src = IrqProfiler::Source;
+    IrqProfiler::AddLatency(Src::SAI_1, 0);
+    IrqProfiler::AddLatency(Src::SAI_1, 10000);
+    IrqProfiler::AddLatency(Src::SAI_1, 5000);
+    IrqProfiler::AddLatency(Src::LAST, 5000);
+
+    const auto& s = IrqProfiler::GetStats(Src::SAI_1);
+    EXPECT_EQ(s.latency_samples, 3u);
+    EXPECT_EQ(s.max_latency, 10000u);
+    EXPECT_EQ(s.total_latency, 15000u);
+    EXPECT_EQ(s.calls, 0u);
+}
+
+TEST(util_IrqProfiler, d_printsCalledSources)
+{
+    IrqProfiler::Reset();
+    System::SetSysClkFreqForUnitTest(400000000);
+    TimerHandler(4000);
+    IrqProfiler::AddLatency(IrqProfiler::Source::TIMERS, 800);
+
+    TestLogger::lines.clear();
+    IrqProfiler::Print<TestLogger>();
+    ASSERT_EQ(TestLogger::lines.size(), 2u);
+    EXPECT_EQ(TestLogger::lines[1],
+              "TIM               1       4000       4000       10        2");
+}
@@ -0,0 +1,218 @@
+#include "util/KeyValueStore.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+using KvResult = KeyValueStore::Result;
+
+// an area away from the start, like an application would use
+static constexpr uint32_t kOffset     = 0x10000;
+static constexpr uint32_t kNumSectors = 4;
+
+TEST(util_KeyValueStore, a_setAndGet)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    EXPECT_EQ(store.Init(kOffset, kNumSectors), KvResult::OK);
+    EXPECT_EQ(store.GetNumKeys(), 0u);
+
+    float    gain  = 0.5f;
+    uint32_t count = 1234;
+    EXPECT_EQ(store.Set(1, gain), KvResult::OK);
+    EXPECT_EQ(store.Set(2, count), KvResult::OK);
+    EXPECT_EQ(store.GetNumKeys(), 2u);
+    EXPECT_EQ(store.GetSize(1), sizeof(float));
+
+    float    gain_out  = 0.f;
+    uint32_t count_out = 0;
+    EXPECT_EQ(store.Get(1, gain_out), KvResult::OK);
+    EXPECT_EQ(store.Get(2, count_out), KvResult::OK);
+    EXPECT_EQ(gain_out, gain);
+    EXPECT_EQ(count_out, count);
+
+    // missing keys leave the value untouched
+    EXPECT_EQ(store.Get(3, count_out), KvResult::ERR_NOT_FOUND);
+    EXPECT_EQ(count_out, count);
+}
+
+TEST(util_KeyValueStore, b_invalidArguments)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    EXPECT_EQ(store.Init(kOffset, 2), KvResult::ERR_SIZE);
+    EXPECT_EQ(store.Init(kOffset, kNumSectors), KvResult::OK);
+
+    uint8_t big[DSY_KVSTORE_MAX_VALUE_SIZE + 1] = {};
+    EXPECT_EQ(store.Set(0xffff, big, 1), KvResult::ERR_INVALID_KEY);
+    EXPECT_EQ(store.Set(1, big, 0), KvResult::ERR_SIZE);
+    EXPECT_EQ(store.Set(1, big, sizeof(big)), KvResult::ERR_SIZE);
+    EXPECT_EQ(store.Remove(1), KvResult::ERR_NOT_FOUND);
+}
+
+TEST(util_KeyValueStore, c_overwriteAndRemove)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    store.Init(kOffset, kNumSectors);
+
+    store.Set(1, uint32_t(1));
+    const uint32_t used = store.GetUsedBytes();
+    // the same value again doesn't write anything
+    store.Set(1, uint32_t(1));
+    EXPECT_EQ(store.GetUsedBytes(), used);
+
+    store.Set(1, uint32_t(2));
+    EXPECT_GT(store.GetUsedBytes(), used);
+    uint32_t value = 0;
+    store.Get(1, value);
+    EXPECT_EQ(value, 2u);
+
+    EXPECT_EQ(store.Remove(1), KvResult::OK);
+    EXPECT_EQ(store.Get(1, value), KvResult::ERR_NOT_FOUND);
+    EXPECT_EQ(store.GetNumKeys(), 0u);
+}
+
+TEST(util_KeyValueStore, d_valuesSurviveInit)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle qspi;
+    {
+        KeyValueStore store(qspi);
+        store.Init(kOffset, kNumSectors);
+        store.Set(1, uint32_t(10));
+        store.Set(2, uint32_t(20));
+        store.Set(1, uint32_t(11));
+        store.Set(3, uint32_t(30));
+        store.Remove(3);
+    }
+
+    // e.g. after a reboot
+    KeyValueStore store(qspi);
+    EXPECT_EQ(store.Init(kOffset, kNumSectors), KvResult::OK);
+    EXPECT_EQ(store.GetNumKeys(), 2u);
+    uint32_t value = 0;
+    store.Get(1, value);
+    EXPECT_EQ(value, 11u);
+    store.Get(2, value);
+    EXPECT_EQ(value, 20u);
+    EXPECT_EQ(store.Get(3, value), KvResult::ERR_NOT_FOUND);
+}
+
+TEST(util_KeyValueStore, e_wearLeveling)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    store.Init(kOffset, kNumSectors);
+
+    // enough writes to go around the sectors a few times
+    uint8_t block[64] = {};
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        block[0] = uint8_t(i);
+        ASSERT_EQ(store.Set(1, uint32_t(i)), KvResult::OK);
+        ASSERT_EQ(store.Set(uint16_t(2 + i % 8), block), KvResult::OK);
+    }
+    EXPECT_LE(store.GetUsedBytes(), kNumSectors * KeyValueStore::kSectorSize);
+
+    // nothing outside of the area was touched
+    const uint8_t* mem = static_cast<uint8_t*>(qspi.GetData());
+    EXPECT_EQ(qspi.GetCurrentSize(),
+              kOffset + kNumSectors * KeyValueStore::kSectorSize);
+    EXPECT_EQ(mem[kOffset - 1], 0x00);
+
+    KeyValueStore reloaded(qspi);
+    reloaded.Init(kOffset, kNumSectors);
+    EXPECT_EQ(reloaded.GetNumKeys(), 9u);
+    uint32_t value = 0;
+    reloaded.Get(1, value);
+    EXPECT_EQ(value, 999u);
+    for(uint16_t key = 2; key < 10; key++)
+    {
+        reloaded.Get(key, block);
+        EXPECT_EQ(block[0], uint8_t(992 + key - 2));
+    }
+}
+
+TEST(util_KeyValueStore, f_compact)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    store.Init(kOffset, kNumSectors);
+
+    uint8_t block[200] = {};
+    for(uint32_t i = 0; i < 30; i++)
+    {
+        block[0] = uint8_t(i);
+        store.Set(1, block);
+    }
+    store.Set(2, uint32_t(42));
+    const uint32_t used = store.GetUsedBytes();
+    EXPECT_GT(used, KeyValueStore::kSectorSize);
+
+    EXPECT_EQ(store.Compact(), KvResult::OK);
+    EXPECT_LT(store.GetUsedBytes(), used);
+    uint32_t value = 0;
+    store.Get(2, value);
+    EXPECT_EQ(value, 42u);
+    store.Get(1, block);
+    EXPECT_EQ(block[0], 29);
+}
+
+TEST(util_KeyValueStore, g_full)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle    qspi;
+    KeyValueStore store(qspi);
+    store.Init(kOffset, kNumSectors);
+
+    // the live values can fill num_sectors - 2 sectors
+    uint8_t  block[DSY_KVSTORE_MAX_VALUE_SIZE] = {};
+    uint16_t key                               = 0;
+    while(store.Set(key, block) == KvResult::OK)
+        key++;
+    EXPECT_GT(key, 0);
+    EXPECT_LE(store.GetLiveBytes(), 2 * KeyValueStore::kSectorSize);
+
+    // the existing values can still be updated
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        block[0] = uint8_t(i);
+        ASSERT_EQ(store.Set(uint16_t(i % key), block), KvResult::OK);
+    }
+}
+
+TEST(util_KeyValueStore, h_tornRecordIsIgnored)
+{
+    QSPIHandle::ResetAndClear();
+    QSPIHandle qspi;
+    {
+        KeyValueStore store(qspi);
+        store.Init(kOffset, kNumSectors);
+        store.Set(1, uint32_t(1));
+        store.Set(1, uint32_t(2));
+    }
+
+    // Clear some bits of the last value, as if the power went off while
+    // it was being programmed. The record header is 8 bytes, and records
+    // are 12 bytes here, after the 16 byte sector header.
+    uint8_t* mem = static_cast<uint8_t*>(qspi.GetData());
+    mem[kOffset + 16 + 12 + 8] &= 0xfd;
+
+    KeyValueStore store(qspi);
+    store.Init(kOffset, kNumSectors);
+    uint32_t value = 0;
+    EXPECT_EQ(store.Get(1, value), KvResult::OK);
+    EXPECT_EQ(value, 1u);
+
+    // a new value gets written after the torn record
+    EXPECT_EQ(store.Set(1, uint32_t(3)), KvResult::OK);
+    KeyValueStore reloaded(qspi);
+    reloaded.Init(kOffset, kNumSectors);
+    reloaded.Get(1, value);
+    EXPECT_EQ(value, 3u);
+}
@@ -0,0 +1,83 @@
+#include "util/LogRing.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace daisy;
+
+namespace
+{
+template <size_t capacity>
+std::string ReadAll(LogRing<capacity>& ring)
+{
+    std::string    result;
+    const uint8_t* data;
+    size_t         size;
+    while((size = ring.Peek(&data)) > 0)
+    {
+        result.append(reinterpret_cast<const char*>(data), size);
+        ring.Consume(size);
+    }
+    return result;
+}
+} // namespace
+
+TEST(util_LogRing, a_readsWhatWasWritten)
+{
+    LogRing<16> ring;
+    EXPECT_EQ(ring.GetReadable(), 0u);
+    EXPECT_TRUE(ring.Write("abc", 3));
+    EXPECT_TRUE(ring.Write("", 0));
+    EXPECT_TRUE(ring.Write("defg", 4));
+    EXPECT_EQ(ring.GetReadable(), 7u);
+    EXPECT_EQ(ReadAll(ring), "abcdefg");
+    EXPECT_EQ(ring.GetReadable(), 0u);
+}
+
+TEST(util_LogRing, b_wrapsAround)
+{
+    LogRing<8> ring;
+    EXPECT_TRUE(ring.Write("012345", 6));
+    EXPECT_EQ(ReadAll(ring), "012345");
+
+    // 2 bytes to the end of the ring, 3 after the wrap
+    EXPECT_TRUE(ring.Write("abcde", 5));
+    const uint8_t* data;
+    EXPECT_EQ(ring.Peek(&data), 2u);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), 2), "ab");
+    ring.Consume(2);
+    EXPECT_EQ(ring.Peek(&data), 3u);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), 3), "cde");
+    ring.Consume(3);
+    EXPECT_EQ(ring.GetReadable(), 0u);
+}
+
+TEST(util_LogRing, c_dropsWholeMessagesWhenFull)
+{
+    LogRing<8> ring;
+    EXPECT_TRUE(ring.Write("01234", 5));
+    EXPECT_FALSE(ring.Write("abcd", 4));
+    EXPECT_TRUE(ring.Write("xyz", 3));
+    EXPECT_FALSE(ring.Write("!", 1));
+    EXPECT_EQ(ring.GetDroppedBytes(), 5u);
+    EXPECT_EQ(ring.GetDroppedMessages(), 2u);
+    EXPECT_EQ(ReadAll(ring), "01234xyz");
+
+    // room again after reading
+    EXPECT_TRUE(ring.Write("abcd", 4));
+    EXPECT_EQ(ReadAll(ring), "abcd");
+
+    ring.ResetStats();
+    EXPECT_EQ(ring.GetDroppedBytes(), 0u);
+    EXPECT_EQ(ring.GetDroppedMessages(), 0u);
+}
+
+TEST(util_LogRing, d_partialConsume)
+{
+    LogRing<16> ring;
+    EXPECT_TRUE(ring.Write("hello", 5));
+    const uint8_t* data;
+    EXPECT_EQ(ring.Peek(&data), 5u);
+    ring.Consume(2);
+    EXPECT_EQ(ring.GetReadable(), 3u);
+    EXPECT_EQ(ReadAll(ring), "llo");
+}
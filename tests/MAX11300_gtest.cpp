@@ -1398,6 +1398,88 @@ TEST_F(MAX11300TestFixture, verifyAutoUpdate)
     EXPECT_EQ(update_complete_callback_count_, stop_auto_updates_after_);
 }
 
+TEST_F(MAX11300TestFixture, verifyTriggerUpdatesOnce)
+{
+    // Configure a single ADC pin on the first chip.
+    // Call Trigger() and expect exactly one update, with the value
+    // readable once the update has completed.
+
+    MAX11300Types::Pin pin = MAX11300Types::PIN_3;
+    EXPECT_TRUE(ConfigurePinAsAnalogReadAndVerify(
+        0, pin, MAX11300Types::AdcVoltageRange::ZERO_TO_10));
+
+    uint16_t adc_val = 1234;
+
+    TxRxTransaction txrx_read_adc;
+    txrx_read_adc.description  = "Chip 0: ADC read transaction";
+    txrx_read_adc.device_index = 0;
+    txrx_read_adc.tx_buff
+        = {(uint8_t)(((MAX11300_ADCDAT_BASE + pin) << 1) | 1), 0x00, 0x00};
+    txrx_read_adc.rx_buff = {0x00, (uint8_t)(adc_val >> 8), (uint8_t)adc_val};
+    txrx_read_adc.size    = 3;
+    txrx_transactions_.push_back(txrx_read_adc);
+
+    EXPECT_EQ(0, max11300_.ReadAnalogPinRaw(0, pin));
+    EXPECT_TRUE(max11300_.Trigger() == MAX11300Types::Result::OK);
+    EXPECT_EQ(adc_val, max11300_.ReadAnalogPinRaw(0, pin));
+    EXPECT_EQ(0u, max11300_.GetOverrunCount());
+}
+
+TEST_F(MAX11300TestFixture, verifySnapshot)
+{
+    // Configure two ADC pins with different ranges on the first chip.
+    // Call Trigger() and expect the snapshot to hold both values from
+    // that update, converted with the range of each pin.
+
+    MAX11300Types::Pin pin0 = MAX11300Types::PIN_2;
+    EXPECT_TRUE(ConfigurePinAsAnalogReadAndVerify(
+        0, pin0, MAX11300Types::AdcVoltageRange::ZERO_TO_10));
+
+    MAX11300Types::Pin pin1 = MAX11300Types::PIN_7;
+    EXPECT_TRUE(ConfigurePinAsAnalogReadAndVerify(
+        0, pin1, MAX11300Types::AdcVoltageRange::NEGATIVE_5_TO_5));
+
+    uint16_t adc_val0 = 1000;
+    uint16_t adc_val1 = 3000;
+
+    TxRxTransaction txrx_read_adc;
+    txrx_read_adc.description  = "Chip 0: ADC read multi transaction";
+    txrx_read_adc.device_index = 0;
+    txrx_read_adc.tx_buff
+        = {(uint8_t)(((MAX11300_ADCDAT_BASE + pin0) << 1) | 1),
+           0x00,
+           0x00,
+           0x00,
+           0x00};
+    txrx_read_adc.rx_buff = {0x00,
+                             (uint8_t)(adc_val0 >> 8),
+                             (uint8_t)adc_val0,
+                             (uint8_t)(adc_val1 >> 8),
+                             (uint8_t)adc_val1};
+    txrx_read_adc.size    = 5;
+    txrx_transactions_.push_back(txrx_read_adc);
+
+    MAX11300Test::Snapshot snapshot;
+    max11300_.GetSnapshot(snapshot);
+    EXPECT_EQ(0u, snapshot.update);
+    EXPECT_EQ(0, snapshot.raw[0][pin0]);
+
+    EXPECT_TRUE(max11300_.Trigger() == MAX11300Types::Result::OK);
+    EXPECT_EQ(1u, max11300_.GetUpdateCount());
+    max11300_.GetSnapshot(snapshot);
+    EXPECT_EQ(1u, snapshot.update);
+    EXPECT_EQ(adc_val0, snapshot.raw[0][pin0]);
+    EXPECT_EQ(adc_val1, snapshot.raw[0][pin1]);
+    EXPECT_EQ(0, snapshot.raw[0][MAX11300Types::PIN_3]);
+    EXPECT_EQ(0, snapshot.raw[1][pin0]);
+
+    float volts[num_devices][20];
+    EXPECT_EQ(1u, max11300_.ReadAnalogPinsVolts(volts));
+    EXPECT_FLOAT_EQ(max11300_.ReadAnalogPinVolts(0, pin0), volts[0][pin0]);
+    EXPECT_FLOAT_EQ(max11300_.ReadAnalogPinVolts(0, pin1), volts[0][pin1]);
+    EXPECT_FLOAT_EQ(0.f, volts[0][MAX11300Types::PIN_3]);
+}
+
 TEST(dev_MAX11300, a_VoltsTo12BitUint)
 {
     EXPECT_EQ(MAX11300Test::VoltsTo12BitUint(
@@ -215,6 +215,28 @@ TEST(util_MappedFloatValue, g_stepUpDown)
 
 // ==========================================================================
 
+TEST(util_MappedFloatValue, h_mapFastLog)
+{
+    MappedFloatValue val(
+        1.0f, 100.0f, 10.0f, MappedFloatValue::Mapping::fastLog);
+
+    // to mormalized value
+    val = 1.0f;
+    EXPECT_NEAR(val.GetAs0to1(), 0.0f, 1e-5f);
+    val = 10.0f;
+    EXPECT_NEAR(val.GetAs0to1(), 0.5f, 1e-5f);
+    val = 100.0f;
+    EXPECT_NEAR(val.GetAs0to1(), 1.0f, 1e-5f);
+
+    // from normalized value
+    val.SetFrom0to1(0.0f);
+    EXPECT_NEAR(val.Get(), 1.0f, 1e-5f);
+    val.SetFrom0to1(0.5f);
+    EXPECT_NEAR(val.Get(), 10.0f, 1e-4f);
+    val.SetFrom0to1(1.0f);
+    EXPECT_NEAR(val.Get(), 100.0f, 1e-3f);
+}
+
 TEST(util_MappedIntValue, a_default)
 {
     MappedIntValue val(0, 10, 5, 2, 1);
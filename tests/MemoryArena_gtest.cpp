@@ -0,0 +1,98 @@
+#include "util/MemoryArena.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_MemoryArena, a_allocate)
+{
+    alignas(32) uint8_t buffer[1024];
+    MemoryArena         arena;
+    arena.Init(buffer, sizeof(buffer), "test");
+    EXPECT_EQ(arena.GetSize(), 1024u);
+    EXPECT_STREQ(arena.GetName(), "test");
+
+    uint8_t* a = static_cast<uint8_t*>(arena.Allocate(3));
+    EXPECT_EQ(a, buffer);
+    // aligned for the type
+    float* b = arena.Allocate<float>(4);
+    EXPECT_EQ(reinterpret_cast<uint8_t*>(b), buffer + 4);
+    EXPECT_EQ(arena.GetUsed(), 4u + 16u);
+    // aligned to a cache line
+    void* c = arena.Allocate(10, 32);
+    EXPECT_EQ(c, buffer + 32);
+    EXPECT_TRUE(arena.Contains(c));
+    EXPECT_FALSE(arena.Contains(buffer + 1024));
+
+    // too large, or not a power of two
+    EXPECT_EQ(arena.Allocate(1024), nullptr);
+    EXPECT_EQ(arena.Allocate(4, 3), nullptr);
+    EXPECT_EQ(arena.GetUsed(), 42u);
+    // everything that's left
+    EXPECT_NE(arena.Allocate(arena.GetFree(), 1), nullptr);
+    EXPECT_EQ(arena.GetFree(), 0u);
+}
+
+TEST(util_MemoryArena, b_checkpoints)
+{
+    alignas(8) uint8_t buffer[1024];
+    MemoryArena        arena;
+    arena.Init(buffer, sizeof(buffer));
+
+    arena.Allocate(100);
+    const auto cp = arena.GetCheckpoint();
+    arena.Allocate(500); // after 4 bytes of padding
+    arena.Allocate(192); // after 4 more
+    EXPECT_EQ(arena.GetHighWaterMark(), 800u);
+
+    arena.Reset(cp);
+    EXPECT_EQ(arena.GetUsed(), 100u);
+    // the memory after the checkpoint is handed out again
+    EXPECT_EQ(arena.Allocate(1, 1), buffer + 100);
+    EXPECT_EQ(arena.GetHighWaterMark(), 800u);
+
+    arena.Reset();
+    EXPECT_EQ(arena.GetUsed(), 0u);
+}
+
+TEST(util_MemoryArena, c_regions)
+{
+    alignas(32) uint8_t buffer[4096];
+    MemoryArena         arena, delays, samples;
+    arena.Init(buffer, sizeof(buffer), "sdram");
+
+    EXPECT_TRUE(arena.CreateRegion(delays, "delays", 1000));
+    const auto cp = arena.GetCheckpoint();
+    EXPECT_TRUE(arena.CreateRegion(samples, "samples", 2000));
+    EXPECT_FALSE(arena.CreateRegion(samples, "too large", 2000));
+    EXPECT_EQ(arena.GetNumRegions(), 2u);
+    EXPECT_EQ(arena.GetRegion(1), &samples);
+    EXPECT_EQ(arena.GetRegion(2), nullptr);
+
+    // regions are aligned, and separate
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(samples.Allocate(1)) % 32, 0u);
+    EXPECT_EQ(delays.Allocate(1001), nullptr);
+    EXPECT_TRUE(delays.Contains(delays.Allocate(1000)));
+    EXPECT_EQ(samples.GetUsed(), 1u);
+
+    arena.Reset(cp);
+    EXPECT_EQ(arena.GetNumRegions(), 1u);
+    EXPECT_EQ(arena.GetRegion(0), &delays);
+}
+
+struct ArenaTestObject
+{
+    ArenaTestObject(int v, float* buf) : value(v), buffer(buf) {}
+    int    value;
+    float* buffer;
+};
+
+TEST(util_MemoryArena, d_new)
+{
+    alignas(8) uint8_t buffer[256];
+    MemoryArena        arena;
+    arena.Init(buffer, sizeof(buffer));
+    auto obj = arena.New<ArenaTestObject>(5, arena.Allocate<float>(16));
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->value, 5);
+    EXPECT_TRUE(arena.Contains(obj->buffer));
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "hid/midi_clock.h"
+#include "sys/system.h"
+
+using namespace daisy;
+
+namespace
+{
+/** 120 BPM at 480MHz */
+const uint32_t kPeriod = 10000000;
+
+MidiEvent RealTime(SystemRealTimeType type, uint32_t timestamp)
+{
+    MidiEvent event;
+    event.type      = SystemRealTime;
+    event.srt_type  = type;
+    event.timestamp = timestamp;
+    return event;
+}
+
+/** sends ticks with +-jitter, alternating, and returns the next time */
+uint32_t SendTicks(MidiClockTracker& clock,
+                   uint32_t          time,
+                   size_t            num_ticks,
+                   uint32_t          period,
+                   int32_t           jitter)
+{
+    for(size_t i = 0; i < num_ticks; i++)
+    {
+        const int32_t offset = i % 2 ? jitter : -jitter;
+        clock.ProcessEvent(RealTime(TimingClock, time + offset));
+        time += period;
+    }
+    return time;
+}
+} // namespace
+
+TEST(hid_MidiClockTracker, a_tempoIsSmoothed)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    MidiClockTracker clock;
+    clock.Init();
+    EXPECT_FALSE(clock.IsLocked());
+    EXPECT_EQ(clock.GetTempoBpm(), 0.0f);
+
+    // +-0.4ms of jitter
+    SendTicks(clock, 1000, 400, kPeriod, 200000);
+    EXPECT_TRUE(clock.IsLocked());
+    EXPECT_NEAR(clock.GetTempoBpm(), 120.0f, 0.12f);
+    EXPECT_NEAR(clock.GetTickPeriodCycles(), float(kPeriod), 10000.0f);
+
+    // a tempo jump restarts the lock
+    uint32_t time = 1000 + 400 * kPeriod;
+    time          = SendTicks(clock, time + kPeriod, 1, kPeriod, 0);
+    EXPECT_FALSE(clock.IsLocked());
+    SendTicks(clock, time + kPeriod, 100, kPeriod * 2, 0);
+    EXPECT_TRUE(clock.IsLocked());
+    EXPECT_NEAR(clock.GetTempoBpm(), 60.0f, 0.01f);
+}
+
+TEST(hid_MidiClockTracker, b_ticksArePredicted)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    MidiClockTracker clock;
+    clock.Init();
+    uint32_t time = SendTicks(clock, 0, 10, kPeriod, 0);
+    uint32_t tick;
+    // not running
+    EXPECT_FALSE(clock.GetNextTick(time + kPeriod, &tick));
+
+    clock.ProcessEvent(RealTime(Start, time - kPeriod / 2));
+    EXPECT_TRUE(clock.IsRunning());
+    EXPECT_EQ(clock.GetTickPosition(), -1);
+    EXPECT_EQ(clock.GetPosition(time), 0.0f);
+
+    // the first tick is predicted before it arrives, but only the one
+    EXPECT_FALSE(clock.GetNextTick(time - 1, &tick));
+    EXPECT_TRUE(clock.GetNextTick(time + 1, &tick));
+    EXPECT_EQ(tick, time);
+    EXPECT_FALSE(clock.GetNextTick(time + 5 * kPeriod, &tick));
+
+    // it arrives late, and isn't returned again
+    clock.ProcessEvent(RealTime(TimingClock, time + 1000));
+    EXPECT_EQ(clock.GetTickPosition(), 0);
+    EXPECT_TRUE(clock.GetNextTick(time + 5 * kPeriod, &tick));
+    EXPECT_NEAR(float(tick - time), float(kPeriod), 1000.0f);
+    EXPECT_FALSE(clock.GetNextTick(time + 5 * kPeriod, &tick));
+
+    // between the ticks, and stopping at the next
+    time += kPeriod;
+    clock.ProcessEvent(RealTime(TimingClock, time));
+    EXPECT_NEAR(clock.GetPosition(time + kPeriod / 2), 1.5f / 24, 0.001f);
+    EXPECT_NEAR(clock.GetPosition(time + 3 * kPeriod), 2.0f / 24, 0.001f);
+
+    // stopped, the ticks don't count
+    clock.ProcessEvent(RealTime(Stop, time + 10));
+    SendTicks(clock, time + kPeriod, 5, kPeriod, 0);
+    EXPECT_EQ(clock.GetTickPosition(), 1);
+    EXPECT_FALSE(clock.GetNextTick(time + 10 * kPeriod, &tick));
+
+    // song position pointer to the second beat, 4 sixteenths
+    MidiEvent spp;
+    spp.type    = SystemCommon;
+    spp.sc_type = SongPositionPointer;
+    spp.data[0] = 4;
+    spp.data[1] = 0;
+    clock.ProcessEvent(spp);
+    clock.ProcessEvent(RealTime(Continue, time + 6 * kPeriod));
+    clock.ProcessEvent(RealTime(TimingClock, time + 7 * kPeriod));
+    EXPECT_EQ(clock.GetTickPosition(), 24);
+    EXPECT_FLOAT_EQ(clock.GetPosition(time + 7 * kPeriod), 1.0f);
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "hid/midi_encoder.h"
+
+using namespace daisy;
+
+namespace
+{
+/** An output with a queue of the bytes sent to it, drained by the test */
+struct FakeQueue
+{
+    void SendMessage(uint8_t* bytes, size_t size)
+    {
+        queue.insert(queue.end(), bytes, bytes + size);
+    }
+    size_t GetTxQueued() const { return queue.size(); }
+    size_t GetTxQueueSize() const { return size; }
+
+    /** Moves the queued bytes to the sent ones */
+    void Drain()
+    {
+        sent.insert(sent.end(), queue.begin(), queue.end());
+        queue.clear();
+    }
+
+    size_t               size = 64;
+    std::vector<uint8_t> queue;
+    std::vector<uint8_t> sent;
+};
+} // namespace
+
+TEST(hid_MidiOutputEncoder, a_runningStatus)
+{
+    FakeQueue         out;
+    MidiOutputEncoder encoder;
+    encoder.Init(out);
+
+    EXPECT_TRUE(encoder.NoteOn(0, 60, 100));
+    EXPECT_TRUE(encoder.NoteOn(0, 62, 100));
+    // the clock doesn't change the running status, the song select ends it
+    const uint8_t clock[]       = {0xf8};
+    const uint8_t song_select[] = {0xf3, 2};
+    EXPECT_TRUE(encoder.Send(clock, 1));
+    EXPECT_TRUE(encoder.NoteOn(0, 64, 100));
+    EXPECT_TRUE(encoder.Send(song_select, 2));
+    EXPECT_TRUE(encoder.NoteOn(0, 65, 100));
+    EXPECT_TRUE(encoder.NoteOff(1, 65, 0));
+    encoder.ResetRunningStatus();
+    EXPECT_TRUE(encoder.NoteOff(1, 66, 0));
+    // no status byte
+    const uint8_t data[] = {60, 100};
+    EXPECT_FALSE(encoder.Send(data, 2));
+
+    const std::vector<uint8_t> expected
+        = {0x90, 60,  100, 62,   100, 0xf8, 64, 100, 0xf3, 2,
+           0x90, 65, 100, 0x81, 65,  0,    0x81, 66, 0};
+    EXPECT_EQ(out.queue, expected);
+    EXPECT_EQ(encoder.GetNumStatusBytesSaved(), 2u);
+}
+
+TEST(hid_MidiOutputEncoder, b_controlsCoalesceWhileTheQueueIsBusy)
+{
+    FakeQueue         out;
+    MidiOutputEncoder encoder;
+    encoder.Init(out);
+
+    // the first one goes out right away, the queue was empty
+    for(uint8_t value = 0; value < 10; value++)
+        EXPECT_TRUE(encoder.ControlChange(0, 74, value));
+    EXPECT_TRUE(encoder.ControlChange(1, 7, 100));
+    EXPECT_TRUE(encoder.ControlChange(0, 71, 5));
+    EXPECT_EQ(out.queue, std::vector<uint8_t>({0xb0, 74, 0}));
+    EXPECT_EQ(encoder.GetNumPending(), 3u);
+    EXPECT_EQ(encoder.GetNumCoalesced(), 8u);
+
+    // nothing more while the queue is busy
+    encoder.Process();
+    EXPECT_EQ(out.queue.size(), 3u);
+
+    // once it drains, the latest values follow, the running status's
+    // channel first
+    out.Drain();
+    encoder.Process();
+    out.Drain();
+    encoder.Process();
+    out.Drain();
+    encoder.Process();
+    out.Drain();
+    EXPECT_EQ(encoder.GetNumPending(), 0u);
+    const std::vector<uint8_t> expected
+        = {0xb0, 74, 0, 74, 9, 71, 5, 0xb1, 7, 100};
+    EXPECT_EQ(out.sent, expected);
+}
+
+TEST(hid_MidiOutputEncoder, c_otherMessagesKeepTheirOrder)
+{
+    FakeQueue         out;
+    MidiOutputEncoder encoder;
+    encoder.Init(out);
+
+    // a note on goes after the control changes that were held back, the
+    // bank select before the program change
+    EXPECT_TRUE(encoder.ControlChange(0, 1, 10));
+    EXPECT_TRUE(encoder.ControlChange(0, 1, 20));
+    EXPECT_TRUE(encoder.ControlChange(0, 0, 3));
+    const uint8_t program[] = {0xc0, 5};
+    EXPECT_TRUE(encoder.Send(program, 2));
+    // the (N)RPN controls and data entry are never coalesced
+    EXPECT_TRUE(encoder.ControlChange(0, 101, 0));
+    EXPECT_TRUE(encoder.ControlChange(0, 6, 2));
+    EXPECT_TRUE(encoder.ControlChange(0, 101, 0));
+    EXPECT_TRUE(encoder.ControlChange(0, 6, 4));
+    // a real time message doesn't wait for the controls
+    EXPECT_TRUE(encoder.ControlChange(0, 1, 30));
+    const uint8_t clock[] = {0xf8};
+    EXPECT_TRUE(encoder.Send(clock, 1));
+    encoder.Flush();
+
+    const std::vector<uint8_t> expected
+        = {0xb0, 1,   10,  1, 20, 0, 3,    0xc0, 5,    0xb0, 101, 0,
+           6,    2,   101, 0, 6,  4, 0xf8, 1,    30};
+    EXPECT_EQ(out.queue, expected);
+    EXPECT_EQ(encoder.GetNumCoalesced(), 0u);
+}
+
+TEST(hid_MidiOutputEncoder, d_fullQueueDropsWholeMessages)
+{
+    FakeQueue out;
+    out.size = 4;
+    MidiOutputEncoder encoder;
+    encoder.Init(out);
+
+    EXPECT_TRUE(encoder.NoteOn(0, 60, 100));
+    // dropped, and the running status is unchanged
+    EXPECT_FALSE(encoder.NoteOn(2, 60, 100));
+    EXPECT_EQ(encoder.GetNumDropped(), 1u);
+    out.Drain();
+    EXPECT_TRUE(encoder.NoteOn(2, 61, 100));
+
+    // controls that don't fit wait for the queue
+    EXPECT_TRUE(encoder.ControlChange(3, 1, 1));
+    encoder.Flush();
+    EXPECT_EQ(encoder.GetNumPending(), 1u);
+    out.Drain();
+    encoder.Flush();
+    out.Drain();
+    EXPECT_EQ(encoder.GetNumPending(), 0u);
+
+    const std::vector<uint8_t> expected
+        = {0x90, 60, 100, 0x92, 61, 100, 0xb3, 1, 1};
+    EXPECT_EQ(out.sent, expected);
+}
+
+TEST(hid_MidiOutputEncoder, e_withoutQueue)
+{
+    std::vector<uint8_t> sent;
+    MidiOutputEncoder::Config config;
+    config.write = [](uint8_t* bytes, size_t size, void* context) {
+        auto* sent = static_cast<std::vector<uint8_t>*>(context);
+        sent->insert(sent->end(), bytes, bytes + size);
+    };
+    config.context        = &sent;
+    config.running_status = false;
+    MidiOutputEncoder encoder;
+    encoder.Init(config);
+
+    // held back until Process(), each message with its status
+    EXPECT_TRUE(encoder.ControlChange(0, 74, 1));
+    EXPECT_TRUE(encoder.ControlChange(0, 74, 2));
+    EXPECT_TRUE(encoder.ControlChange(0, 75, 3));
+    EXPECT_TRUE(sent.empty());
+    encoder.Process();
+    EXPECT_EQ(sent, std::vector<uint8_t>({0xb0, 74, 2, 0xb0, 75, 3}));
+
+    // a full table is flushed to make room
+    sent.clear();
+    for(uint8_t i = 0; i <= MidiOutputEncoder::kMaxPendingControls; i++)
+        EXPECT_TRUE(encoder.ControlChange(0, 40 + i, 1));
+    EXPECT_EQ(sent.size(), 3 * MidiOutputEncoder::kMaxPendingControls);
+    EXPECT_EQ(encoder.GetNumPending(), 1u);
+}
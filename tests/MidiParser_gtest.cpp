@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "hid/midi_parser.h"
+
+using namespace daisy;
+
+namespace
+{
+// note on, running status note ons (one with velocity 0), a clock in
+// between, control change and a channel mode message, a SysEx message,
+// program change, pitch bend with running status, a note off with active
+// sensing between its data bytes and an incomplete note on
+const uint8_t kStream[] = {0x91, 60,   100,  62,   0,    64,   90,   0xf8,
+                           0xb2, 7,    127,  0xb2, 123,  0,    0xf0, 0x7e,
+                           0x01, 0x02, 0xf7, 0xc3, 5,    0xe4, 0,    64,
+                           1,    2,    0x85, 60,   0xfe, 10,   0x94, 70};
+
+/** The fields of an event that are set for its type */
+struct Parsed
+{
+    MidiEvent event;
+    size_t    sysex_size;
+};
+
+void ExpectSame(const std::vector<Parsed>& a, const std::vector<Parsed>& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        const MidiEvent& ea = a[i].event;
+        const MidiEvent& eb = b[i].event;
+        EXPECT_EQ(ea.type, eb.type) << i;
+        EXPECT_EQ(a[i].sysex_size, b[i].sysex_size) << i;
+        if(ea.type == SystemRealTime)
+        {
+            EXPECT_EQ(ea.srt_type, eb.srt_type) << i;
+            continue;
+        }
+        EXPECT_EQ(ea.channel, eb.channel) << i;
+        EXPECT_EQ(ea.data[0], eb.data[0]) << i;
+        if(ea.type == ChannelMode)
+        {
+            EXPECT_EQ(ea.cm_type, eb.cm_type) << i;
+        }
+        if(ea.type != ProgramChange && ea.type != SystemCommon)
+        {
+            EXPECT_EQ(ea.data[1], eb.data[1]) << i;
+        }
+    }
+}
+
+std::vector<Parsed> ParseBytewise(const uint8_t* bytes, size_t size)
+{
+    MidiParser parser;
+    parser.Init();
+    std::vector<Parsed> events;
+    MidiEvent           event;
+    for(size_t i = 0; i < size; i++)
+    {
+        if(parser.Parse(bytes[i], &event))
+            events.push_back({event, event.sysex_chunk.GetSize()});
+    }
+    return events;
+}
+
+/** Parses in two blocks, split at split */
+std::vector<Parsed> ParseBlocks(const uint8_t* bytes, size_t size, size_t split)
+{
+    MidiParser parser;
+    parser.Init();
+    std::vector<Parsed> events;
+    auto handler = [&](const MidiEvent& event) {
+        events.push_back({event, event.sysex_chunk.GetSize()});
+    };
+    parser.Parse(bytes, split, handler);
+    parser.Parse(bytes + split, size - split, handler);
+    return events;
+}
+} // namespace
+
+TEST(hid_MidiParser, a_blocksParseLikeBytes)
+{
+    const auto expected = ParseBytewise(kStream, sizeof(kStream));
+    ASSERT_EQ(expected.size(), 12u);
+    EXPECT_EQ(expected[0].event.type, NoteOn);
+    EXPECT_EQ(expected[1].event.type, NoteOff);
+    EXPECT_EQ(expected[5].event.type, ChannelMode);
+    EXPECT_EQ(expected[6].sysex_size, 3u);
+    EXPECT_EQ(expected[9].event.data[1], 2);
+    EXPECT_EQ(expected[10].event.srt_type, ActiveSensing);
+    EXPECT_EQ(expected[11].event.type, NoteOff);
+    EXPECT_EQ(expected[11].event.channel, 5);
+    EXPECT_EQ(expected[11].event.data[1], 10);
+
+    for(size_t split = 0; split <= sizeof(kStream); split++)
+    {
+        SCOPED_TRACE(split);
+        ExpectSame(ParseBlocks(kStream, sizeof(kStream), split), expected);
+    }
+}
+
+TEST(hid_MidiParser, b_compactEventsKeepTheFields)
+{
+    MidiParser parser;
+    parser.Init();
+    std::vector<CompactMidiEvent> queue;
+    parser.Parse(kStream, sizeof(kStream), [&](MidiEvent event) {
+        event.timestamp = uint32_t(queue.size());
+        queue.push_back(CompactMidiEvent::Pack(event));
+    });
+
+    const auto expected = ParseBytewise(kStream, sizeof(kStream));
+    ASSERT_EQ(queue.size(), expected.size());
+    std::vector<Parsed> unpacked;
+    for(const auto& e : queue)
+    {
+        MidiEvent event = e.Unpack(parser.GetSysexBuffer());
+        EXPECT_EQ(event.timestamp, uint32_t(unpacked.size()));
+        unpacked.push_back({event, event.sysex_chunk.GetSize()});
+    }
+    ExpectSame(unpacked, expected);
+
+    // the SysEx bytes are read from the parser
+    MidiEvent sysex = unpacked[6].event;
+    EXPECT_EQ(sysex.sc_type, SystemExclusive);
+    uint8_t bytes[3];
+    EXPECT_EQ(sysex.sysex_chunk.ReadBytes(bytes, 3), 3u);
+    EXPECT_EQ(bytes[0], 0x7e);
+    EXPECT_EQ(bytes[2], 0x02);
+}
+
+namespace
+{
+/** Records what a SysexCallback receives */
+struct SysexRecorder
+{
+    std::vector<MidiParser::SysexStage> stages;
+    std::vector<uint8_t>                data;
+    size_t                              numContinues = 0;
+
+    static void Callback(MidiParser::SysexStage stage,
+                         const uint8_t*         bytes,
+                         size_t                 size,
+                         void*                  context)
+    {
+        auto& self = *static_cast<SysexRecorder*>(context);
+        if(stage == MidiParser::SysexStage::Continue)
+        {
+            self.data.insert(self.data.end(), bytes, bytes + size);
+            self.numContinues++;
+        }
+        else
+        {
+            self.stages.push_back(stage);
+        }
+    }
+};
+} // namespace
+
+TEST(hid_MidiParser, c_sysexIsStreamed)
+{
+    // a dump much longer than the SysEx buffer with a clock in it, then
+    // a message cut short by a note on
+    std::vector<uint8_t> stream = {0xf0};
+    for(size_t i = 0; i < 3000; i++)
+        stream.push_back(uint8_t(i % 128));
+    stream.insert(stream.begin() + 100, 0xf8);
+    stream.push_back(0xf7);
+    stream.insert(stream.end(), {0xf0, 1, 2, 0x90, 60, 100});
+
+    for(const bool blocks : {false, true})
+    {
+        SCOPED_TRACE(blocks);
+        MidiParser parser;
+        parser.Init();
+        SysexRecorder recorder;
+        parser.SetSysexCallback(&SysexRecorder::Callback, &recorder);
+
+        std::vector<MidiEvent> events;
+        if(blocks)
+        {
+            parser.Parse(stream.data(),
+                         stream.size(),
+                         [&](const MidiEvent& e) { events.push_back(e); });
+        }
+        else
+        {
+            MidiEvent event;
+            for(uint8_t byte : stream)
+            {
+                if(parser.Parse(byte, &event))
+                    events.push_back(event);
+            }
+        }
+
+        using Stage = MidiParser::SysexStage;
+        const std::vector<Stage> expected
+            = {Stage::Start, Stage::End, Stage::Start, Stage::Aborted};
+        EXPECT_EQ(recorder.stages, expected);
+        ASSERT_EQ(recorder.data.size(), 3002u);
+        EXPECT_EQ(recorder.data[2999], 3000 % 128 - 1);
+        EXPECT_EQ(recorder.data[3001], 2);
+        if(blocks)
+        {
+            // around the clock and the end
+            EXPECT_EQ(recorder.numContinues, 3u);
+        }
+
+        ASSERT_EQ(events.size(), 2u);
+        EXPECT_EQ(events[0].type, SystemRealTime);
+        EXPECT_EQ(events[0].srt_type, TimingClock);
+        EXPECT_EQ(events[1].type, NoteOn);
+        EXPECT_EQ(events[1].data[1], 100);
+
+        // also when the parser is reset
+        parser.Parse(0xf0, nullptr);
+        parser.Reset();
+        EXPECT_EQ(recorder.stages.back(), Stage::Aborted);
+        EXPECT_EQ(recorder.stages.size(), 6u);
+    }
+}
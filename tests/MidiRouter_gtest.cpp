@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "hid/midi_parser.h"
+#include "hid/midi_router.h"
+
+using namespace daisy;
+
+namespace
+{
+/** An output that collects the bytes sent to it */
+struct FakeOutput
+{
+    void SendMessage(uint8_t* bytes, size_t size)
+    {
+        sent.insert(sent.end(), bytes, bytes + size);
+    }
+    std::vector<uint8_t> sent;
+};
+
+/** Parses bytes and passes the events to the router */
+void Receive(MidiRouter&                 router,
+             MidiParser&                 parser,
+             size_t                      input,
+             const std::vector<uint8_t>& bytes)
+{
+    parser.Parse(bytes.data(), bytes.size(), [&](const MidiEvent& event) {
+        router.Process(input, event);
+    });
+}
+} // namespace
+
+TEST(hid_MidiRouter, a_inputsAreMergedWithRunningStatus)
+{
+    MidiRouter router;
+    router.Init();
+    FakeOutput uart, usb;
+    const int  uart_out = router.AddOutput(uart, true);
+    const int  usb_out  = router.AddOutput(usb, false);
+    EXPECT_TRUE(router.AddRoute(0, uart_out));
+    EXPECT_TRUE(router.AddRoute(1, uart_out));
+    EXPECT_TRUE(router.AddRoute(0, usb_out));
+    EXPECT_FALSE(router.AddRoute(0, 5));
+
+    MidiParser in0, in1;
+    in0.Init();
+    in1.Init();
+    // running status on the input, the clock isn't a status change
+    Receive(router, in0, 0, {0x90, 60, 100, 62, 100, 0xf8});
+    Receive(router, in0, 0, {64, 100});
+    // a message from the other input needs its status, and afterwards
+    // the first input's status is sent again
+    Receive(router, in1, 1, {0xb0, 7, 127});
+    // after a system common message, and a note on with velocity 0,
+    // which is sent as a note off
+    Receive(router, in0, 0, {65, 100, 0xf2, 1, 2, 0x90, 66, 0});
+
+    const std::vector<uint8_t> expected_uart
+        = {0x90, 60,  100,  62, 100, 0xf8, 64, 100, 0xb0, 7,
+           127,  0x90, 65, 100, 0xf2, 1,    2,  0x80, 66,   0};
+    EXPECT_EQ(uart.sent, expected_uart);
+
+    // no running status, and only the first input
+    const std::vector<uint8_t> expected_usb
+        = {0x90, 60, 100, 0x90, 62, 100, 0xf8, 0x90, 64, 100,
+           0x90, 65, 100, 0xf2, 1,  2,   0x80, 66,   0};
+    EXPECT_EQ(usb.sent, expected_usb);
+}
+
+TEST(hid_MidiRouter, b_filters)
+{
+    MidiRouter router;
+    router.Init();
+    FakeOutput out;
+    const int  index = router.AddOutput(out, false);
+
+    MidiRouter::Filter filter;
+    filter.channels = 1u << 2;
+    filter.types &= ~MidiRouter::Filter::TypeBit(SystemRealTime);
+    filter.types &= ~MidiRouter::Filter::TypeBit(PitchBend);
+    EXPECT_TRUE(router.AddRoute(0, index, filter));
+
+    MidiParser parser;
+    parser.Init();
+    Receive(router,
+            parser,
+            0,
+            {0x91, 60, 100, 0x92, 60, 100, 0xf8, 0xe2, 0, 64, 0xc2, 5,
+             0xb2, 123, 0});
+    // SysEx isn't forwarded
+    Receive(router, parser, 0, {0xf0, 1, 2, 0xf7, 0xf6});
+
+    const std::vector<uint8_t> expected
+        = {0x92, 60, 100, 0xc2, 5, 0xb2, 123, 0, 0xf6};
+    EXPECT_EQ(out.sent, expected);
+
+    // other inputs aren't routed
+    Receive(router, parser, 1, {0x92, 60, 100});
+    EXPECT_EQ(out.sent.size(), expected.size());
+}
@@ -0,0 +1,154 @@
+#include "util/MultiWavWriter.h"
+#include "FakeFatFs.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace daisy;
+
+namespace
+{
+using Writer = MultiWavWriter<2, 512>;
+
+/** sizes of the writes FakeFatFs saw */
+std::vector<size_t> WriteSizes()
+{
+    std::vector<size_t> sizes;
+    for(const auto& call : FakeFatFs::calls)
+        if(call.compare(0, 6, "write ") == 0)
+            sizes.push_back(std::stoul(call.substr(call.rfind(' ') + 1)));
+    return sizes;
+}
+
+/** the 24 bit sample at a byte offset of a file */
+int32_t S24At(const std::vector<uint8_t>& file, size_t offset)
+{
+    const uint32_t u = file[offset] | (file[offset + 1] << 8)
+                       | (file[offset + 2] << 16);
+    return int32_t(u << 8) >> 8;
+}
+
+Writer::Config MakeConfig(uint8_t* buffer, size_t size)
+{
+    Writer::Config config;
+    config.channels[0] = 2;
+    config.channels[1] = 1;
+    config.buffer      = buffer;
+    config.buffer_size = size;
+    return config;
+}
+} // namespace
+
+TEST(util_MultiWavWriter, a_blockAlignedFiles)
+{
+    FakeFatFs::Reset();
+    FakeFatFs::files["a.wav"];
+    FakeFatFs::files["b.wav"];
+
+    static uint8_t buffer[2 * 4 * 512];
+    Writer         writer;
+    auto           config   = MakeConfig(buffer, sizeof(buffer));
+    config.prealloc_seconds = 1.f;
+    ASSERT_TRUE(writer.Init(config) == Writer::Result::OK);
+    EXPECT_EQ(writer.GetBufferDepth(), 4u);
+    ASSERT_TRUE(writer.Open({"a.wav", "b.wav"}) == Writer::Result::OK);
+
+    // 24 bit frames of 9 bytes straddle the blocks
+    const size_t frames = 200;
+    for(size_t i = 0; i < frames; i++)
+    {
+        const float frame[3] = {i / 256.f, -0.5f, 0.25f};
+        writer.Sample(frame);
+        if(i % 50 == 49)
+            writer.Write();
+    }
+    EXPECT_EQ(writer.GetLengthSamps(), frames);
+    ASSERT_TRUE(writer.Close() == Writer::Result::OK);
+
+    // whole blocks, then the rest of each file and the headers
+    const auto sizes = WriteSizes();
+    ASSERT_GE(sizes.size(), 4u);
+    for(size_t i = 0; i + 4 < sizes.size(); i++)
+        EXPECT_EQ(sizes[i] % 512, 0u);
+
+    // the preallocated files are cut to the recording
+    const auto& a = FakeFatFs::files["a.wav"];
+    const auto& b = FakeFatFs::files["b.wav"];
+    ASSERT_EQ(a.size(), 44 + frames * 6);
+    ASSERT_EQ(b.size(), 44 + frames * 3);
+    WAV_FormatTypeDef header;
+    std::memcpy(&header, a.data(), sizeof(header));
+    EXPECT_EQ(header.NbrChannels, 2);
+    EXPECT_EQ(header.BitPerSample, 24);
+    EXPECT_EQ(header.BlockAlign, 6);
+    EXPECT_EQ(header.SubCHunk2Size, frames * 6);
+    std::memcpy(&header, b.data(), sizeof(header));
+    EXPECT_EQ(header.NbrChannels, 1);
+    EXPECT_EQ(header.SubCHunk2Size, frames * 3);
+
+    for(size_t i = 0; i < frames; i++)
+    {
+        ASSERT_EQ(S24At(a, 44 + i * 6), f2s24(i / 256.f));
+        ASSERT_EQ(S24At(a, 47 + i * 6), f2s24(-0.5f));
+        ASSERT_EQ(S24At(b, 44 + i * 3), f2s24(0.25f));
+    }
+    const auto stats = writer.GetStats();
+    // the first block of each file has the header
+    EXPECT_EQ(stats.bytes_written, a.size() + b.size());
+    EXPECT_EQ(stats.write_errors, 0u);
+    EXPECT_EQ(stats.dropped_frames, 0u);
+}
+
+TEST(util_MultiWavWriter, b_dropsFramesOfAllStreams)
+{
+    FakeFatFs::Reset();
+    FakeFatFs::files["a.wav"];
+    FakeFatFs::files["b.wav"];
+
+    static uint8_t buffer[2 * 2 * 512];
+    Writer         writer;
+    ASSERT_TRUE(writer.Init(MakeConfig(buffer, sizeof(buffer)))
+                == Writer::Result::OK);
+    ASSERT_TRUE(writer.Open({"a.wav", "b.wav"}) == Writer::Result::OK);
+
+    // the 2 blocks of stream 0 fill up first, stream 1 has to drop too
+    const float frame[3] = {0.1f, 0.2f, 0.3f};
+    for(int i = 0; i < 400; i++)
+        writer.Sample(frame);
+    const uint32_t recorded = writer.GetLengthSamps();
+    EXPECT_EQ(recorded, (2u * 512 - 44) / 6);
+    EXPECT_EQ(writer.GetStats().dropped_frames, 400 - recorded);
+    EXPECT_EQ(writer.GetStats().overflows, 1u);
+    EXPECT_EQ(writer.GetStats().max_queued_blocks, 1u);
+
+    // the card caught up, one more run of drops is one more overflow
+    writer.Write();
+    for(int i = 0; i < 400; i++)
+        writer.Sample(frame);
+    EXPECT_EQ(writer.GetStats().overflows, 2u);
+    ASSERT_TRUE(writer.Close() == Writer::Result::OK);
+    const uint32_t total = writer.GetLengthSamps();
+    EXPECT_EQ(FakeFatFs::files["a.wav"].size(), 44 + total * 6);
+    EXPECT_EQ(FakeFatFs::files["b.wav"].size(), 44 + total * 3);
+    EXPECT_FALSE(writer.IsRecording());
+}
+
+TEST(util_MultiWavWriter, c_invalidConfigs)
+{
+    static uint8_t buffer[2 * 2 * 512];
+    Writer         writer;
+    auto           config = MakeConfig(buffer, sizeof(buffer) - 1);
+    EXPECT_TRUE(writer.Init(config) == Writer::Result::ERROR);
+    EXPECT_TRUE(writer.Open({"a.wav", "b.wav"}) == Writer::Result::ERROR);
+
+    config             = MakeConfig(buffer, sizeof(buffer));
+    config.channels[1] = 0;
+    EXPECT_TRUE(writer.Init(config) == Writer::Result::ERROR);
+
+    config               = MakeConfig(buffer, sizeof(buffer));
+    config.bitspersample = 20;
+    EXPECT_TRUE(writer.Init(config) == Writer::Result::ERROR);
+
+    config = MakeConfig(buffer, sizeof(buffer));
+    EXPECT_TRUE(writer.Init(config) == Writer::Result::OK);
+    EXPECT_TRUE(writer.Close() == Writer::Result::ERROR);
+}
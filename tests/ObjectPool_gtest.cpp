@@ -0,0 +1,81 @@
+#include "util/ObjectPool.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+struct Counted
+{
+    Counted(int v) : value(v) { alive++; }
+    ~Counted() { alive--; }
+
+    int        value;
+    static int alive;
+};
+int Counted::alive = 0;
+} // namespace
+
+TEST(util_ObjectPool, a_allocateAndFree)
+{
+    ObjectPool<Counted, 4> pool;
+    EXPECT_EQ(pool.GetCapacity(), 4u);
+    EXPECT_EQ(pool.GetNumFree(), 4u);
+
+    Counted* objects[4];
+    for(int i = 0; i < 4; i++)
+    {
+        objects[i] = pool.Allocate(i * 10);
+        ASSERT_NE(objects[i], nullptr);
+        EXPECT_EQ(objects[i]->value, i * 10);
+        EXPECT_EQ(pool.GetIndex(objects[i]), size_t(i));
+        EXPECT_EQ(pool.Get(i), objects[i]);
+    }
+    EXPECT_EQ(Counted::alive, 4);
+    EXPECT_EQ(pool.Allocate(99), nullptr);
+    EXPECT_EQ(Counted::alive, 4);
+
+    // freed slots are reused first
+    EXPECT_TRUE(pool.Free(objects[3]));
+    EXPECT_TRUE(pool.Free(objects[1]));
+    EXPECT_EQ(Counted::alive, 2);
+    EXPECT_EQ(pool.GetNumUsed(), 2u);
+    EXPECT_EQ(pool.Get(1), nullptr);
+    EXPECT_EQ(pool.Allocate(5), objects[1]);
+    EXPECT_EQ(pool.Allocate(7), objects[3]);
+    EXPECT_EQ(objects[3]->value, 7);
+    EXPECT_EQ(pool.GetHighWaterMark(), 4u);
+}
+
+TEST(util_ObjectPool, b_foreignAndDoubleFree)
+{
+    ObjectPool<Counted, 2> pool;
+    Counted                outside(1);
+    Counted*               object = pool.Allocate(2);
+
+    EXPECT_FALSE(pool.Owns(&outside));
+    EXPECT_FALSE(pool.Free(&outside));
+    EXPECT_FALSE(pool.Free(nullptr));
+    EXPECT_TRUE(pool.Free(object));
+    EXPECT_FALSE(pool.Free(object));
+    EXPECT_EQ(pool.GetNumFree(), 2u);
+    EXPECT_EQ(Counted::alive, 1);
+}
+
+TEST(util_ObjectPool, c_clearDestroys)
+{
+    {
+        ObjectPool<Counted, 3> pool;
+        pool.Allocate(1);
+        pool.Allocate(2);
+        pool.Clear();
+        EXPECT_EQ(Counted::alive, 0);
+        EXPECT_EQ(pool.GetNumFree(), 3u);
+        EXPECT_EQ(pool.GetHighWaterMark(), 2u);
+
+        // the destructor destroys what is left
+        pool.Allocate(3);
+        EXPECT_EQ(Counted::alive, 1);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+}
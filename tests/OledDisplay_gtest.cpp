@@ -0,0 +1,233 @@
+#include "dev/oled_ssd130x.h"
+#include "hid/disp/oled_display.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace daisy;
+
+namespace
+{
+constexpr size_t kWidth  = 128;
+constexpr size_t kHeight = 64;
+
+class FakeTransport;
+
+/** The transport of the display under test */
+FakeTransport* transport = nullptr;
+
+/** Keeps a copy of the display memory, from the page and column address
+ *  commands and the data that follows them */
+class FakeTransport
+{
+  public:
+    struct Config
+    {
+    };
+    void Init(const Config&)
+    {
+        transport = this;
+        memset(ram, 0, sizeof(ram));
+        page   = 0;
+        column = 0;
+        writes = 0;
+    }
+    void SendCommand(uint8_t cmd)
+    {
+        if((cmd & 0xF0) == 0xB0)
+            page = cmd & 0x0F;
+        else if(cmd < 0x10)
+            column = (column & 0xF0) | cmd;
+        else if(cmd < 0x20)
+            column = (column & 0x0F) | ((cmd & 0x0F) << 4);
+    }
+    void SendData(uint8_t* buff, size_t size)
+    {
+        for(size_t i = 0; i < size; i++)
+            ram[page][column++] = buff[i];
+        writes += size;
+    }
+    bool GetPixel(size_t x, size_t y) const
+    {
+        return (ram[y / 8][x] >> (y % 8)) & 1;
+    }
+
+    uint8_t ram[kHeight / 8][kWidth];
+    size_t  page;
+    size_t  column;
+    size_t  writes;
+};
+
+using TestDriver = SSD130xDriver<kWidth, kHeight, FakeTransport>;
+
+/** Draws everything pixel by pixel, the reference */
+class PixelDisplay : public OneBitGraphicsDisplayImpl<PixelDisplay>
+{
+  public:
+    PixelDisplay() { Fill(false); }
+    uint16_t Height() const override { return kHeight; }
+    uint16_t Width() const override { return kWidth; }
+    void     Fill(bool on) override { memset(pixels, on, sizeof(pixels)); }
+    void     DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override
+    {
+        if(x < kWidth && y < kHeight)
+            pixels[y][x] = on;
+    }
+    void Update() override {}
+
+    bool pixels[kHeight][kWidth];
+};
+
+class hid_disp_OledDisplay : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        OledDisplay<TestDriver>::Config config;
+        display_.Init(config);
+    }
+
+    const FakeTransport& Transport() const { return *transport; }
+
+    void ExpectEqual()
+    {
+        display_.Update();
+        for(size_t y = 0; y < kHeight; y++)
+            for(size_t x = 0; x < kWidth; x++)
+                ASSERT_EQ(Transport().GetPixel(x, y), reference_.pixels[y][x])
+                    << "at " << x << ", " << y;
+    }
+
+    OledDisplay<TestDriver> display_;
+    PixelDisplay            reference_;
+};
+} // namespace
+
+TEST_F(hid_disp_OledDisplay, a_spansMatchPixels)
+{
+    display_.Fill(false);
+    const uint8_t lines[][4] = {{0, 0, 127, 0},
+                                {3, 5, 90, 5},
+                                {90, 20, 3, 20},
+                                {7, 1, 7, 62},
+                                {9, 63, 9, 2},
+                                {120, 13, 120, 14}};
+    for(const auto& l : lines)
+    {
+        display_.DrawLine(l[0], l[1], l[2], l[3], true);
+        reference_.DrawLine(l[0], l[1], l[2], l[3], true);
+    }
+    ExpectEqual();
+
+    display_.DrawLine(0, 5, 127, 5, false);
+    reference_.DrawLine(0, 5, 127, 5, false);
+    ExpectEqual();
+}
+
+TEST_F(hid_disp_OledDisplay, b_rectsMatchPixels)
+{
+    display_.Fill(false);
+    const uint8_t rects[][4] = {{2, 3, 40, 5},
+                                {10, 7, 20, 8},
+                                {50, 1, 70, 60},
+                                {100, 9, 127, 63},
+                                {0, 0, 0, 0},
+                                {30, 30, 31, 39}};
+    bool on = true;
+    for(const auto& r : rects)
+    {
+        display_.DrawRect(r[0], r[1], r[2], r[3], on, true);
+        reference_.DrawRect(r[0], r[1], r[2], r[3], on, true);
+        display_.DrawRect(r[0], r[1], r[2], r[3], !on, false);
+        reference_.DrawRect(r[0], r[1], r[2], r[3], !on, false);
+        on = !on;
+    }
+    ExpectEqual();
+}
+
+TEST_F(hid_disp_OledDisplay, c_textMatchesPixels)
+{
+    display_.Fill(true);
+    reference_.Fill(true);
+    const FontDef* fonts[] = {&Font_6x8, &Font_7x10, &Font_11x18, &Font_16x26};
+    uint16_t       y       = 0;
+    for(const FontDef* font : fonts)
+    {
+        display_.SetCursor(3, y);
+        reference_.SetCursor(3, y);
+        display_.WriteString("Ag{7", *font, false);
+        reference_.WriteString("Ag{7", *font, false);
+        y += font->FontHeight - 3;
+    }
+    ExpectEqual();
+}
+
+TEST_F(hid_disp_OledDisplay, d_bitmapClipsAtTheEdges)
+{
+    display_.Fill(false);
+    uint8_t bitmap[2 * 12];
+    for(size_t i = 0; i < sizeof(bitmap); i++)
+        bitmap[i] = uint8_t(i * 37 + 5);
+    display_.DrawBitmap(120, 57, bitmap, 12, 11, true);
+    reference_.DrawBitmap(120, 57, bitmap, 12, 11, true);
+    display_.DrawBitmap(30, 3, bitmap, 12, 11, false);
+    reference_.DrawBitmap(30, 3, bitmap, 12, 11, false);
+    ExpectEqual();
+}
+
+TEST_F(hid_disp_OledDisplay, e_onlyChangesAreSent)
+{
+    display_.Fill(false);
+    display_.Update();
+    const size_t writes = Transport().writes;
+
+    // nothing changed
+    display_.Update();
+    EXPECT_EQ(Transport().writes, writes);
+
+    // a pixel that is already off
+    display_.DrawPixel(10, 10, false);
+    display_.Update();
+    EXPECT_EQ(Transport().writes, writes);
+
+    // columns 10 to 14 of one page
+    display_.DrawLine(10, 10, 14, 10, true);
+    display_.Update();
+    EXPECT_EQ(Transport().writes, writes + 5);
+    EXPECT_TRUE(Transport().GetPixel(12, 10));
+}
+
+TEST_F(hid_disp_OledDisplay, f_pageFontsMatchFonts)
+{
+    const FontDef* fonts[] = {&Font_6x8, &Font_7x10, &Font_11x18, &Font_16x26};
+
+    const PageFontDef* pages[] = {
+        &Font_6x8_Pages, &Font_7x10_Pages, &Font_11x18_Pages, &Font_16x26_Pages};
+    for(size_t f = 0; f < 4; f++)
+    {
+        const FontDef&     font = *fonts[f];
+        const PageFontDef& page = *pages[f];
+        ASSERT_EQ(page.FontWidth, font.FontWidth);
+        ASSERT_EQ(page.FontHeight, font.FontHeight);
+
+        // every character, as many screens as it takes
+        char ch = ' ';
+        while(ch <= '~')
+        {
+            display_.Fill(true);
+            reference_.Fill(true);
+            for(uint16_t y = 1; y + font.FontHeight <= kHeight && ch <= '~';
+                y += font.FontHeight)
+            {
+                display_.SetCursor(1, y);
+                reference_.SetCursor(1, y);
+                while(ch <= '~' && display_.WriteChar(ch, page, false) == ch)
+                {
+                    EXPECT_EQ(reference_.WriteChar(ch, font, false), ch);
+                    ch++;
+                }
+            }
+            ExpectEqual();
+        }
+    }
+    EXPECT_EQ(display_.WriteChar('\n', Font_6x8_Pages, true), 0);
+}
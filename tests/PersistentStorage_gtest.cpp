@@ -15,6 +15,10 @@ struct StorageTestData
 
 using StorageTestClass = PersistentStorage<StorageTestData>;
 
+// A slot is the state, the data, and the CRC of the data
+static constexpr uint32_t kSlotWords = 3;
+static constexpr uint32_t kNumSlots  = 4096 / (kSlotWords * 4);
+
 TEST(util_PersistentStorage, a_stateAfterInitClean)
 {
     QSPIHandle       qspi;
@@ -85,6 +89,203 @@ TEST(util_PersistentStorage, d_stateBeforeInitialize)
     EXPECT_EQ(state, StorageTestClass::State::UNKNOWN);
 }
 
+TEST(util_PersistentStorage, e_savesRotateThroughSlots)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+
+    // the defaults go into the first slot, each save into the next one
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    for(uint32_t i = 1; i <= 3; i++)
+    {
+        storage.GetSettings().a = i;
+        storage.Save();
+    }
+    EXPECT_EQ(mem[1], 0xdeadbeef);
+    EXPECT_EQ(mem[kSlotWords + 1], 1u);
+    EXPECT_EQ(mem[3 * kSlotWords + 1], 3u);
+    EXPECT_EQ(mem[4 * kSlotWords], 0xffffffff);
+
+    // the newest slot wins
+    StorageTestClass newStorage(qspi);
+    newStorage.Init(defaults);
+    EXPECT_EQ(newStorage.GetState(), StorageTestClass::State::USER);
+    EXPECT_EQ(newStorage.GetSettings().a, 3u);
+}
+
+TEST(util_PersistentStorage, f_eraseWhenSlotsAreUsedUp)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+
+    // The defaults are in the first slot, so the save after the one in the
+    // last slot erases the sector, and goes into the first.
+    for(uint32_t i = 1; i <= 600; i++)
+    {
+        storage.GetSettings().a = i;
+        storage.Save();
+    }
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    const uint32_t slot = 600 - kNumSlots;
+    EXPECT_EQ(mem[kSlotWords * slot + 1], 600u);
+    EXPECT_EQ(mem[kSlotWords * (slot + 1)], 0xffffffff);
+
+    StorageTestClass newStorage(qspi);
+    newStorage.Init(defaults);
+    EXPECT_EQ(newStorage.GetSettings().a, 600u);
+}
+
+TEST(util_PersistentStorage, g_interruptedSaveIsIgnored)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+    storage.GetSettings().a = 1;
+    storage.Save();
+
+    // the settings of a save made it, but the state word didn't
+    auto    mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    uint8_t torn[4] = {2, 0, 0, 0};
+    qspi.Write((2 * kSlotWords + 1) * sizeof(uint32_t), sizeof(torn), torn);
+
+    StorageTestClass newStorage(qspi);
+    newStorage.Init(defaults);
+    EXPECT_EQ(newStorage.GetSettings().a, 1u);
+
+    // and the next save doesn't go on top of it
+    newStorage.GetSettings().a = 3;
+    newStorage.Save();
+    EXPECT_EQ(mem[2 * kSlotWords + 1], 2u);
+    EXPECT_EQ(mem[3 * kSlotWords + 1], 3u);
+}
+
+TEST(util_PersistentStorage, h_startSave)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+
+    // unchanged settings don't need a save
+    EXPECT_FALSE(storage.StartSave());
+    EXPECT_FALSE(storage.IsSaving());
+
+    storage.GetSettings().a = 1;
+    EXPECT_TRUE(storage.StartSave());
+    EXPECT_TRUE(storage.IsSaving());
+    // changing the settings during the save starts another one after it
+    storage.GetSettings().a = 2;
+    EXPECT_TRUE(storage.StartSave());
+    uint32_t calls = 0;
+    while(storage.Process())
+        calls++;
+    EXPECT_GT(calls, 0u);
+    EXPECT_FALSE(storage.IsSaving());
+
+    StorageTestClass newStorage(qspi);
+    newStorage.Init(defaults);
+    EXPECT_EQ(newStorage.GetState(), StorageTestClass::State::USER);
+    EXPECT_EQ(newStorage.GetSettings().a, 2u);
+}
+
+TEST(util_PersistentStorage, i_corruptSlotIsIgnored)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+    storage.GetSettings().a = 1;
+    storage.Save();
+    storage.GetSettings().a = 0xffff;
+    storage.Save();
+
+    // clear a few bits in the newest settings, its state is still valid
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    mem[2 * kSlotWords + 1] &= 0xff;
+
+    StorageTestClass newStorage(qspi);
+    newStorage.Init(defaults);
+    EXPECT_EQ(newStorage.GetState(), StorageTestClass::State::USER);
+    EXPECT_EQ(newStorage.GetSettings().a, 1u);
+}
+
+TEST(util_PersistentStorage, j_slotWithoutCrc)
+{
+    // written by versions without the CRC, followed by erased flash
+    QSPIHandle qspi;
+    qspi.Erase(0, 4096);
+    uint32_t legacy[2] = {uint32_t(StorageTestClass::State::USER), 42};
+    qspi.Write(0, sizeof(legacy), reinterpret_cast<uint8_t *>(legacy));
+
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+    EXPECT_EQ(storage.GetState(), StorageTestClass::State::USER);
+    EXPECT_EQ(storage.GetSettings().a, 42u);
+
+    // the next save goes into the second slot
+    storage.GetSettings().a = 43;
+    storage.Save();
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    EXPECT_EQ(mem[kSlotWords + 1], 43u);
+}
+
+TEST(util_PersistentStorage, k_dirtyFlag)
+{
+    QSPIHandle       qspi;
+    StorageTestClass storage(qspi);
+    StorageTestData  defaults;
+    storage.Init(defaults);
+    EXPECT_FALSE(storage.IsDirty());
+
+    // forces a save, even without changes
+    storage.MarkDirty();
+    EXPECT_TRUE(storage.IsDirty());
+    EXPECT_TRUE(storage.StartSave());
+    while(storage.Process()) {}
+    EXPECT_FALSE(storage.IsDirty());
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    EXPECT_EQ(mem[kSlotWords], uint32_t(StorageTestClass::State::USER));
+
+    // changes without it are found by the CRC
+    storage.GetSettings().a = 7;
+    EXPECT_FALSE(storage.IsDirty());
+    EXPECT_TRUE(storage.StartSave());
+    while(storage.Process()) {}
+    EXPECT_EQ(mem[2 * kSlotWords + 1], 7u);
+}
+
+struct StorageIgnoredData
+{
+    uint32_t a       = 1;
+    uint32_t ignored = 2;
+
+    bool operator!=(const StorageIgnoredData &rhs) const { return a != rhs.a; }
+};
+
+TEST(util_PersistentStorage, l_changesUseOperator)
+{
+    QSPIHandle                            qspi;
+    PersistentStorage<StorageIgnoredData> storage(qspi);
+    storage.Init(StorageIgnoredData());
+
+    // a field the operator ignores isn't a change
+    storage.GetSettings().ignored = 5;
+    EXPECT_FALSE(storage.StartSave());
+
+    storage.GetSettings().a = 3;
+    EXPECT_TRUE(storage.StartSave());
+    while(storage.Process()) {}
+    auto mem = reinterpret_cast<uint32_t *>(qspi.GetData());
+    EXPECT_EQ(mem[4 + 1], 3u);
+    EXPECT_EQ(mem[4 + 2], 5u);
+}
+
 // A few short tests for the QSPIHandle mock wrapper as well.
 // These can move to their own file
 
@@ -0,0 +1,114 @@
+#include "util/PoolHeap.h"
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+TEST(util_PoolHeap, a_sizeClasses)
+{
+    alignas(8) uint8_t buffer[4096];
+    PoolHeap           heap;
+    PoolHeap::Config   config;
+    config.min_block_size = 16;
+    config.num_classes    = 4; // 16, 32, 64, 128
+    config.num_blocks[0]  = 8;
+    ASSERT_TRUE(heap.Init(buffer, sizeof(buffer), config));
+    EXPECT_EQ(heap.GetNumClasses(), 4u);
+    EXPECT_EQ(heap.GetMaxSize(), 128u);
+
+    // the first class has its number, the others share the rest equally
+    EXPECT_EQ(heap.GetClassStats(0).num_blocks, 8u);
+    const size_t share = (sizeof(buffer) - 8 * 16) / 3;
+    EXPECT_EQ(heap.GetClassStats(1).num_blocks, share / 32);
+    EXPECT_EQ(heap.GetClassStats(3).num_blocks, share / 128);
+
+    // the smallest class each size fits in
+    void* p0 = heap.Allocate(0);
+    void* p1 = heap.Allocate(16);
+    void* p2 = heap.Allocate(17);
+    void* p3 = heap.Allocate(100);
+    EXPECT_EQ(heap.GetBlockSize(p0), 16u);
+    EXPECT_EQ(heap.GetBlockSize(p1), 16u);
+    EXPECT_EQ(heap.GetBlockSize(p2), 32u);
+    EXPECT_EQ(heap.GetBlockSize(p3), 128u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p3) % PoolHeap::kAlignment, 0u);
+    EXPECT_EQ(heap.Allocate(129), nullptr);
+
+    EXPECT_EQ(heap.GetStats().bytes_used, 16u + 16u + 32u + 128u);
+    EXPECT_EQ(heap.GetStats().num_allocations, 4u);
+    EXPECT_EQ(heap.GetStats().num_failed, 1u);
+
+    heap.Free(p3);
+    heap.Free(p2);
+    heap.Free(p1);
+    heap.Free(p0);
+    EXPECT_EQ(heap.GetStats().bytes_used, 0u);
+    EXPECT_EQ(heap.GetStats().high_water_mark, 16u + 16u + 32u + 128u);
+
+    // foreign pointers are ignored
+    uint8_t other;
+    heap.Free(&other);
+    heap.Free(nullptr);
+    EXPECT_FALSE(heap.Owns(&other));
+    EXPECT_EQ(heap.GetStats().bytes_used, 0u);
+}
+
+TEST(util_PoolHeap, b_fallsBackToLargerClasses)
+{
+    alignas(8) uint8_t buffer[1024];
+    PoolHeap           heap;
+    PoolHeap::Config   config;
+    config.num_classes   = 2; // 16, 32
+    config.num_blocks[0] = 2;
+    config.num_blocks[1] = 1;
+    ASSERT_TRUE(heap.Init(buffer, sizeof(buffer), config));
+
+    void* a = heap.Allocate(8);
+    void* b = heap.Allocate(8);
+    void* c = heap.Allocate(8);
+    EXPECT_EQ(heap.GetBlockSize(a), 16u);
+    EXPECT_EQ(heap.GetBlockSize(b), 16u);
+    EXPECT_EQ(heap.GetBlockSize(c), 32u);
+    EXPECT_EQ(heap.Allocate(8), nullptr);
+
+    // a freed block is used again
+    heap.Free(b);
+    EXPECT_EQ(heap.Allocate(4), b);
+
+    // a config that doesn't fit
+    config.num_blocks[1] = 100;
+    EXPECT_FALSE(heap.Init(buffer, sizeof(buffer), config));
+    config.min_block_size = 12;
+    EXPECT_FALSE(heap.Init(buffer, sizeof(buffer), config));
+}
+
+TEST(util_PoolHeap, c_reallocateAndLock)
+{
+    alignas(8) uint8_t buffer[2048];
+    PoolHeap           heap;
+    PoolHeap::Config   config;
+    config.num_classes = 4;
+    ASSERT_TRUE(heap.Init(buffer, sizeof(buffer), config));
+
+    // stays in place as long as it fits in its block
+    auto p = static_cast<uint8_t*>(heap.Allocate(20));
+    for(int i = 0; i < 20; i++)
+        p[i] = uint8_t(i);
+    EXPECT_EQ(heap.Reallocate(p, 32), p);
+    auto q = static_cast<uint8_t*>(heap.Reallocate(p, 60));
+    ASSERT_NE(q, nullptr);
+    EXPECT_EQ(heap.GetBlockSize(q), 64u);
+    for(int i = 0; i < 20; i++)
+        EXPECT_EQ(q[i], uint8_t(i));
+    EXPECT_EQ(heap.GetStats().bytes_used, 64u);
+
+    // allocations after the lock are counted
+    EXPECT_EQ(heap.GetStats().num_after_lock, 0u);
+    heap.Lock();
+    EXPECT_TRUE(heap.IsLocked());
+    heap.Free(heap.Allocate(8));
+    heap.Free(q);
+    EXPECT_EQ(heap.GetStats().num_after_lock, 1u);
+    heap.Unlock();
+    heap.Free(heap.Allocate(8));
+    EXPECT_EQ(heap.GetStats().num_after_lock, 1u);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "ui/PotMonitor.h"
+#include "ui/ButtonMonitor.h"
+
+using namespace daisy;
+
+namespace
+{
+/** Returns one value at a time */
+struct SingleBackend
+{
+    float GetPotValue(uint16_t potId) { return values[potId]; }
+    float values[3] = {};
+};
+
+/** Returns all values at once, like the DMA buffer of the ADC */
+struct RawBackend
+{
+    const uint16_t* GetPotValues() { return values; }
+    uint16_t        values[3] = {};
+};
+
+struct ButtonBackend
+{
+    const bool* GetButtonStates() { return states; }
+    bool        states[2] = {};
+};
+
+using EventType = UiEventQueue::Event::EventType;
+
+/** Lets the pots time out and the buttons settle, and empties the queue */
+template <typename Monitor>
+void Settle(Monitor& monitor, UiEventQueue& queue, uint32_t ms)
+{
+    System::SetUsForUnitTest(ms * 1000);
+    monitor.Process();
+    while(!queue.IsQueueEmpty())
+        queue.GetAndRemoveNextEvent();
+}
+} // namespace
+
+TEST(ui_PotMonitor, a_movementsArePosted)
+{
+    System::SetUsForUnitTest(0);
+    UiEventQueue                 queue;
+    SingleBackend                backend;
+    PotMonitor<SingleBackend, 3> monitor;
+    monitor.Init(queue, backend, 500, 0.01f, 0.001f);
+    Settle(monitor, queue, 500);
+
+    // within the idle dead band
+    backend.values[1] = 0.005f;
+    monitor.Process();
+    EXPECT_TRUE(queue.IsQueueEmpty());
+
+    backend.values[1] = 0.02f;
+    monitor.Process();
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              EventType::potActivityChanged);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().asPotMoved.id, 1);
+    EXPECT_TRUE(monitor.IsMoving(1));
+    EXPECT_FALSE(monitor.IsMoving(0));
+
+    // the smaller dead band while moving
+    backend.values[1] = 0.022f;
+    monitor.Process();
+    auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::potMoved);
+    EXPECT_FLOAT_EQ(e.asPotMoved.newPosition, 0.022f);
+    EXPECT_FLOAT_EQ(monitor.GetCurrentPotValue(1), 0.022f);
+
+    // idle after the timeout
+    System::SetUsForUnitTest(1000000);
+    monitor.Process();
+    e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::potActivityChanged);
+    EXPECT_EQ(e.asPotActivityChanged.newActivityType,
+              UiEventQueue::Event::ActivityType::inactive);
+    EXPECT_FALSE(monitor.IsMoving(1));
+}
+
+TEST(ui_PotMonitor, b_valuesAreReadAtOnce)
+{
+    System::SetUsForUnitTest(0);
+    UiEventQueue              queue;
+    RawBackend                backend;
+    PotMonitor<RawBackend, 3> monitor;
+    monitor.Init(queue, backend);
+    EXPECT_EQ(&monitor.GetBackend(), &backend);
+    Settle(monitor, queue, 500);
+
+    backend.values[2] = 32768;
+    monitor.Process();
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              EventType::potActivityChanged);
+    const auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.asPotMoved.id, 2);
+    EXPECT_FLOAT_EQ(e.asPotMoved.newPosition, 0.5f);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
+
+TEST(ui_ButtonMonitor, a_statesAreReadAtOnce)
+{
+    System::SetUsForUnitTest(0);
+    UiEventQueue                    queue;
+    ButtonBackend                   backend;
+    ButtonMonitor<ButtonBackend, 2> monitor;
+    monitor.Init(queue, backend, 10);
+    Settle(monitor, queue, 20);
+
+    // debounced
+    backend.states[1] = true;
+    monitor.Process();
+    EXPECT_TRUE(queue.IsQueueEmpty());
+    System::SetUsForUnitTest(40000);
+    monitor.Process();
+    auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::buttonPressed);
+    EXPECT_EQ(e.asButtonPressed.id, 1);
+    EXPECT_TRUE(monitor.IsButtonPressed(1));
+    EXPECT_FALSE(monitor.IsButtonPressed(0));
+
+    backend.states[1] = false;
+    monitor.Process();
+    System::SetUsForUnitTest(60000);
+    monitor.Process();
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type, EventType::buttonReleased);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
@@ -0,0 +1,139 @@
+#include "util/PresetBank.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+struct Settings
+{
+    float   cutoff;
+    float   resonance;
+    uint8_t wave;
+};
+
+/** An image of 3 presets, with the first and the last one stored */
+std::vector<uint8_t> MakeImage()
+{
+    std::vector<uint8_t> image(PresetBank::ImageSize(3, sizeof(Settings)));
+    PresetBank           bank;
+    EXPECT_EQ(bank.Create(image.data(), image.size(), 3, sizeof(Settings), 2),
+              PresetBank::Result::OK);
+    EXPECT_EQ(bank.Store(0, "bass", Settings{0.25f, 0.5f, 1}),
+              PresetBank::Result::OK);
+    EXPECT_EQ(bank.Store(2, "lead", Settings{0.75f, 0.1f, 2}),
+              PresetBank::Result::OK);
+    return image;
+}
+} // namespace
+
+TEST(util_PresetBank, a_createAndRecall)
+{
+    // 32 byte header, 3 entries, 3 records of 32 bytes
+    EXPECT_EQ(PresetBank::ImageSize(3, sizeof(Settings)), 32u + 96u + 96u);
+
+    const std::vector<uint8_t> image = MakeImage();
+    PresetBank                 bank;
+    ASSERT_EQ(bank.Init(image.data(), image.size()), PresetBank::Result::OK);
+    EXPECT_EQ(bank.GetNumPresets(), 3u);
+    EXPECT_EQ(bank.GetRecordSize(), 32u);
+    EXPECT_EQ(bank.GetDataVersion(), 2);
+    EXPECT_EQ(bank.GetImageSize(), image.size());
+
+    Settings settings = {};
+    EXPECT_TRUE(bank.Load(2, settings));
+    EXPECT_EQ(settings.cutoff, 0.75f);
+    EXPECT_EQ(settings.wave, 2);
+    // the records are at fixed offsets, on 32 byte boundaries
+    EXPECT_EQ(bank.GetRecord(2), image.data() + 32 + 96 + 64);
+    EXPECT_STREQ(bank.GetName(0), "bass");
+    EXPECT_EQ(bank.GetSize(0), sizeof(Settings));
+    EXPECT_TRUE(bank.VerifyRecord(0));
+
+    // the empty slot, and one past the end
+    EXPECT_FALSE(bank.Load(1, settings));
+    EXPECT_EQ(bank.GetSize(1), 0u);
+    EXPECT_FALSE(bank.Load(3, settings));
+    EXPECT_EQ(bank.GetRecord(3), nullptr);
+    EXPECT_EQ(bank.GetName(3), nullptr);
+
+    EXPECT_EQ(bank.Find("lead"), 2);
+    EXPECT_TRUE(bank.Find("pad") == PresetBank::kNotFound);
+    EXPECT_TRUE(bank.Find("") == PresetBank::kNotFound);
+}
+
+TEST(util_PresetBank, b_storeNeedsAWritableBank)
+{
+    std::vector<uint8_t> image = MakeImage();
+    PresetBank           bank;
+    ASSERT_EQ(bank.Init(image.data(), image.size()), PresetBank::Result::OK);
+    EXPECT_EQ(bank.Store(1, "pad", Settings{}),
+              PresetBank::Result::ERR_READ_ONLY);
+    EXPECT_EQ(bank.Clear(0), PresetBank::Result::ERR_READ_ONLY);
+
+    ASSERT_EQ(bank.InitWritable(image.data(), image.size()),
+              PresetBank::Result::OK);
+    EXPECT_EQ(bank.Store(1, "a name longer than 23 characters", Settings{}),
+              PresetBank::Result::OK);
+    EXPECT_EQ(bank.Store(3, "pad", Settings{}), PresetBank::Result::ERR_INDEX);
+    const uint8_t too_large[33] = {};
+    EXPECT_EQ(bank.Store(1, "pad", too_large, sizeof(too_large)),
+              PresetBank::Result::ERR_SIZE);
+    EXPECT_EQ(bank.Clear(0), PresetBank::Result::OK);
+
+    // the CRCs are kept up to date
+    PresetBank reopened;
+    ASSERT_EQ(reopened.Init(image.data(), image.size()),
+              PresetBank::Result::OK);
+    EXPECT_STREQ(reopened.GetName(1), "a name longer than 23 c");
+    EXPECT_TRUE(reopened.VerifyRecord(1));
+    EXPECT_TRUE(reopened.Find("bass") == PresetBank::kNotFound);
+}
+
+TEST(util_PresetBank, c_shorterRecordsLeaveTheRestAlone)
+{
+    struct Settings2
+    {
+        Settings v1;
+        float    drive;
+    };
+    const std::vector<uint8_t> image = MakeImage();
+    PresetBank                 bank;
+    ASSERT_EQ(bank.Init(image.data(), image.size()), PresetBank::Result::OK);
+    Settings2 settings = {{}, 0.5f};
+    EXPECT_TRUE(bank.Load(0, settings));
+    EXPECT_EQ(settings.v1.resonance, 0.5f);
+    EXPECT_EQ(settings.drive, 0.5f);
+}
+
+TEST(util_PresetBank, d_damagedImages)
+{
+    PresetBank bank;
+    EXPECT_EQ(bank.Init(nullptr, 0), PresetBank::Result::ERR_SIZE);
+
+    std::vector<uint8_t> image = MakeImage();
+    EXPECT_EQ(bank.Init(image.data(), image.size() - 1),
+              PresetBank::Result::ERR_SIZE);
+
+    // a damaged record is only found by its CRC
+    image[32 + 96 + 1] ^= 1;
+    EXPECT_EQ(bank.Init(image.data(), image.size()), PresetBank::Result::OK);
+    EXPECT_FALSE(bank.VerifyRecord(0));
+    EXPECT_TRUE(bank.VerifyRecord(2));
+
+    image[32 + 1] ^= 1;
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              PresetBank::Result::ERR_CRC);
+    EXPECT_EQ(bank.GetNumPresets(), 0u);
+
+    image[4] = 2;
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              PresetBank::Result::ERR_VERSION);
+
+    std::vector<uint8_t> erased(image.size(), 0xff);
+    EXPECT_EQ(bank.Init(erased.data(), erased.size()),
+              PresetBank::Result::ERR_MAGIC);
+    EXPECT_EQ(bank.Create(erased.data(), erased.size(), 3, 33),
+              PresetBank::Result::ERR_SIZE);
+}
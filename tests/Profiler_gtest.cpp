@@ -0,0 +1,172 @@
+#define DSY_PROFILING
+#include "util/Profiler.h"
+#include <gtest/gtest.h>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** records the printed lines */
+struct TestLogger
+{
+    static std::vector<std::string> lines;
+
+    static void PrintLine(const char* format, ...)
+    {
+        char    buff[128];
+        va_list va;
+        va_start(va, format);
+        vsnprintf(buff, sizeof(buff), format, va);
+        va_end(va);
+        lines.push_back(buff);
+    }
+};
+std::vector<std::string> TestLogger::lines;
+
+/** returns the index of the section with the given name, or -1 */
+int FindSection(const char* name)
+{
+    for(size_t i = 0; i < Profiler::GetNumSections(); i++)
+    {
+        if(std::string(Profiler::GetSection(i).name) == name)
+            return int(i);
+    }
+    return -1;
+}
+
+void Spend(uint32_t cycles)
+{
+    System::SetCycleCountForUnitTest(System::GetCycleCount() + cycles);
+}
+} // namespace
+
+TEST(util_Profiler, a_accumulatesCycles)
+{
+    for(int i = 0; i < 3; i++)
+    {
+        DSY_PROFILE_SCOPE("a_section");
+        Spend(100 * (i + 1));
+    }
+
+    const int idx = FindSection("a_section");
+    ASSERT_GE(idx, 0);
+    const auto& s = Profiler::GetSection(idx);
+    EXPECT_EQ(s.calls, 3u);
+    EXPECT_EQ(s.total_cycles, 600u);
+    EXPECT_EQ(s.max_cycles, 300u);
+    EXPECT_EQ(s.parent, Profiler::kInvalidSection);
+    EXPECT_EQ(s.depth, 0);
+}
+
+TEST(util_Profiler, b_nestedScopes)
+{
+    {
+        DSY_PROFILE_SCOPE("b_outer");
+        Spend(10);
+        {
+            DSY_PROFILE_SCOPE("b_inner");
+            Spend(50);
+        }
+        Spend(10);
+    }
+
+    const int outer = FindSection("b_outer");
+    const int inner = FindSection("b_inner");
+    ASSERT_GE(outer, 0);
+    ASSERT_GE(inner, 0);
+    EXPECT_EQ(Profiler::GetSection(inner).parent, outer);
+    EXPECT_EQ(Profiler::GetSection(inner).depth, 1);
+    // inclusive times
+    EXPECT_EQ(Profiler::GetSection(outer).total_cycles, 70u);
+    EXPECT_EQ(Profiler::GetSection(inner).total_cycles, 50u);
+
+    // the active section is restored after leaving the scopes
+    {
+        DSY_PROFILE_SCOPE("b_after");
+    }
+    EXPECT_EQ(Profiler::GetSection(FindSection("b_after")).parent,
+              Profiler::kInvalidSection);
+}
+
+TEST(util_Profiler, c_sameNameSharesSection)
+{
+    const size_t numBefore = Profiler::GetNumSections();
+    {
+        DSY_PROFILE_SCOPE("c_shared");
+        Spend(5);
+    }
+    {
+        DSY_PROFILE_SCOPE("c_shared");
+        Spend(7);
+    }
+    EXPECT_EQ(Profiler::GetNumSections(), numBefore + 1);
+    EXPECT_EQ(Profiler::GetSection(FindSection("c_shared")).calls, 2u);
+}
+
+TEST(util_Profiler, d_resetKeepsSections)
+{
+    {
+        DSY_PROFILE_SCOPE("d_section");
+        Spend(5);
+    }
+    const size_t numBefore = Profiler::GetNumSections();
+    Profiler::Reset();
+    EXPECT_EQ(Profiler::GetNumSections(), numBefore);
+    const auto& s = Profiler::GetSection(FindSection("d_section"));
+    EXPECT_EQ(s.calls, 0u);
+    EXPECT_EQ(s.total_cycles, 0u);
+    EXPECT_EQ(s.max_cycles, 0u);
+}
+
+TEST(util_Profiler, e_print)
+{
+    System::SetSysClkFreqForUnitTest(480000000u);
+    Profiler::Reset();
+    {
+        DSY_PROFILE_SCOPE("e_outer");
+        {
+            DSY_PROFILE_SCOPE("e_inner");
+            Spend(960);
+        }
+    }
+    TestLogger::lines.clear();
+    Profiler::Print<TestLogger>();
+
+    ASSERT_EQ(TestLogger::lines.size(), Profiler::GetNumSections() + 1);
+    // children are printed indented, directly after their parent
+    size_t outerLine = 0;
+    for(size_t i = 0; i < TestLogger::lines.size(); i++)
+    {
+        if(TestLogger::lines[i].find("e_outer") == 0)
+            outerLine = i;
+    }
+    ASSERT_GT(outerLine, 0u);
+    const auto& innerLine = TestLogger::lines[outerLine + 1];
+    EXPECT_EQ(innerLine.find("  e_inner"), 0u);
+    // calls, avg cycles, max cycles, max us
+    EXPECT_NE(innerLine.find(" 1        960        960        2"),
+              std::string::npos);
+}
+
+TEST(util_Profiler, f_fullTableIsIgnored)
+{
+    // fill up the table (this should always be the last test in this file)
+    static const char* names[DSY_PROFILER_MAX_SECTIONS]
+        = {"f0", "f1", "f2",  "f3",  "f4",  "f5",  "f6",  "f7",
+           "f8", "f9", "f10", "f11", "f12", "f13", "f14", "f15"};
+    for(size_t i = 0; Profiler::GetNumSections() < DSY_PROFILER_MAX_SECTIONS;
+        i++)
+        Profiler::Register(names[i]);
+
+    EXPECT_EQ(Profiler::Register("f_overflow"), Profiler::kInvalidSection);
+    {
+        DSY_PROFILE_SCOPE("f_overflow");
+        Spend(10);
+    }
+    EXPECT_EQ(FindSection("f_overflow"), -1);
+    EXPECT_EQ(Profiler::GetNumSections(), size_t(DSY_PROFILER_MAX_SECTIONS));
+}
@@ -0,0 +1,56 @@
+#include "util/RealFft.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+const double kPi = 3.14159265358979;
+} // namespace
+
+TEST(util_RealFft, a_matchesTheDft)
+{
+    const size_t        n = 64;
+    RealFft<64>         fft;
+    float               buf[n];
+    std::vector<double> x(n);
+    fft.Init();
+    srand(3);
+    for(size_t i = 0; i < n; i++)
+        buf[i] = float(x[i] = double(rand()) / RAND_MAX - 0.5);
+    fft.Forward(buf);
+
+    for(size_t k = 0; k <= n / 2; k++)
+    {
+        double re = 0.0, im = 0.0;
+        for(size_t i = 0; i < n; i++)
+        {
+            re += x[i] * cos(2.0 * kPi * double(k * i) / double(n));
+            im -= x[i] * sin(2.0 * kPi * double(k * i) / double(n));
+        }
+        if(k == 0)
+            EXPECT_NEAR(buf[0], re, 1e-4);
+        else if(k == n / 2)
+            EXPECT_NEAR(buf[1], re, 1e-4);
+        else
+        {
+            EXPECT_NEAR(buf[2 * k], re, 1e-4) << k;
+            EXPECT_NEAR(buf[2 * k + 1], im, 1e-4) << k;
+        }
+    }
+}
+
+TEST(util_RealFft, b_splitsDcAndNyquist)
+{
+    RealFft<8> fft;
+    float      buf[8] = {1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 1.f, -1.f};
+    fft.Init();
+    fft.Forward(buf);
+    EXPECT_NEAR(buf[0], 0.f, 1e-6f);
+    EXPECT_NEAR(buf[1], 8.f, 1e-6f);
+    for(size_t i = 2; i < 8; i++)
+        EXPECT_NEAR(buf[i], 0.f, 1e-6f);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "util/ringbuffer.h"
+
+using namespace daisy;
+
+TEST(util_RingBuffer, a_powerOfTwo)
+{
+    RingBuffer<int, 8> buffer;
+    buffer.Init();
+    EXPECT_EQ(buffer.writable(), 7u);
+    EXPECT_EQ(buffer.readable(), 0u);
+
+    // the positions run past the end of the buffer many times
+    for(int i = 0; i < 100; i++)
+    {
+        buffer.Overwrite(i);
+        buffer.Overwrite(i + 1000);
+        EXPECT_EQ(buffer.readable(), 2u);
+        EXPECT_EQ(buffer.ImmediateRead(), i);
+        EXPECT_EQ(buffer.ImmediateRead(), i + 1000);
+    }
+    EXPECT_TRUE(buffer.isEmpty());
+}
+
+TEST(util_RingBuffer, b_otherSize)
+{
+    RingBuffer<int, 5> buffer;
+    buffer.Init();
+    EXPECT_EQ(buffer.writable(), 4u);
+    EXPECT_EQ(buffer.readable(), 0u);
+
+    for(int i = 0; i < 100; i++)
+    {
+        buffer.Overwrite(i);
+        buffer.Overwrite(i + 1000);
+        buffer.Overwrite(i + 2000);
+        EXPECT_EQ(buffer.readable(), 3u);
+        EXPECT_EQ(buffer.writable(), 1u);
+        EXPECT_EQ(buffer.ImmediateRead(), i);
+        EXPECT_EQ(buffer.ImmediateRead(), i + 1000);
+        EXPECT_EQ(buffer.ImmediateRead(), i + 2000);
+    }
+    EXPECT_TRUE(buffer.isEmpty());
+}
+
+TEST(util_RingBuffer, c_spans)
+{
+    RingBuffer<int, 8> buffer;
+    buffer.Init();
+
+    // the free space starts as one piece
+    RingBufferSpans<int> write = buffer.GetWriteSpans(6);
+    EXPECT_EQ(write.first_size, 6u);
+    EXPECT_EQ(write.second_size, 0u);
+    for(int i = 0; i < 6; i++)
+        write.first[i] = i;
+    buffer.Advance(6);
+
+    RingBufferSpans<const int> read = buffer.GetReadSpans(4);
+    EXPECT_EQ(read.size(), 4u);
+    EXPECT_EQ(read.first[0], 0);
+    EXPECT_EQ(read.first[3], 3);
+    buffer.Consume(4);
+
+    // then wraps around the end of the buffer
+    write = buffer.GetWriteSpans();
+    EXPECT_EQ(write.first_size, 2u);
+    EXPECT_EQ(write.second_size, 3u);
+    write.first[0]  = 6;
+    write.first[1]  = 7;
+    write.second[0] = 8;
+    buffer.Advance(3);
+
+    read = buffer.GetReadSpans();
+    EXPECT_EQ(read.first_size, 4u);
+    EXPECT_EQ(read.second_size, 1u);
+    EXPECT_EQ(read.first[0], 4);
+    EXPECT_EQ(read.first[3], 7);
+    EXPECT_EQ(read.second[0], 8);
+    buffer.Consume(read.size());
+    EXPECT_TRUE(buffer.isEmpty());
+
+    // can't consume more than is there
+    buffer.Consume(3);
+    EXPECT_EQ(buffer.readable(), 0u);
+}
@@ -0,0 +1,148 @@
+#include "util/SampleBank.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Builds an image like resources/make_sample_bank.py, with a mono PCM_16
+ *  sample of 5 frames and a stereo FLOAT_32 sample of 3 frames
+ */
+std::vector<uint8_t> MakeImage()
+{
+    const int16_t kick[5] = {0, 1000, -1000, 32767, -32768};
+    const float   pad[6]  = {0.f, 0.5f, -0.5f, 1.f, -1.f, 0.25f};
+
+    SampleBank::Header header = {};
+    SampleBank::Entry  entries[2];
+    std::memset(entries, 0, sizeof(entries));
+    std::strcpy(entries[0].name, "kick");
+    entries[0].offset     = 128;
+    entries[0].size       = sizeof(kick);
+    entries[0].samplerate = 48000;
+    entries[0].channels   = 1;
+    entries[0].format     = SampleBank::Format::PCM_16;
+    std::strcpy(entries[1].name, "pad");
+    entries[1].offset     = 160;
+    entries[1].size       = sizeof(pad);
+    entries[1].samplerate = 44100;
+    entries[1].loop_start = 1;
+    entries[1].loop_end   = 3;
+    entries[1].channels   = 2;
+    entries[1].format     = SampleBank::Format::FLOAT_32;
+
+    std::vector<uint8_t> image(192, 0);
+    std::memcpy(&image[32], entries, sizeof(entries));
+    std::memcpy(&image[128], kick, sizeof(kick));
+    std::memcpy(&image[160], pad, sizeof(pad));
+    header.magic       = SampleBank::kMagic;
+    header.version     = SampleBank::kVersion;
+    header.num_samples = 2;
+    header.image_size  = 192;
+    header.index_crc   = Crc32(entries, sizeof(entries));
+    header.data_crc    = Crc32(&image[128], 64);
+    std::memcpy(&image[0], &header, sizeof(header));
+    return image;
+}
+
+/** Changes the index entry of the second sample, and updates the CRC */
+void PatchEntry(std::vector<uint8_t>& image, size_t offset, uint32_t value)
+{
+    std::memcpy(&image[32 + 48 + offset], &value, sizeof(value));
+    const uint32_t crc = Crc32(&image[32], 96);
+    std::memcpy(&image[12], &crc, sizeof(crc));
+}
+} // namespace
+
+TEST(util_SampleBank, a_readSamples)
+{
+    std::vector<uint8_t> image = MakeImage();
+    SampleBank           bank;
+    ASSERT_EQ(bank.Init(image.data(), image.size()), SampleBank::Result::OK);
+    EXPECT_EQ(bank.GetNumSamples(), 2u);
+    EXPECT_EQ(bank.GetImageSize(), 192u);
+    EXPECT_TRUE(bank.VerifyData());
+
+    SampleBank::Sample sample;
+    ASSERT_TRUE(bank.GetSample(bank.Find("kick"), sample));
+    EXPECT_STREQ(sample.name, "kick");
+    EXPECT_EQ(sample.num_frames, 5u);
+    EXPECT_EQ(sample.samplerate, 48000u);
+    EXPECT_EQ(sample.channels, 1);
+    EXPECT_EQ(sample.Float32(), nullptr);
+    // the data isn't copied
+    ASSERT_EQ(sample.data, image.data() + 128);
+    EXPECT_EQ(sample.Pcm16()[1], 1000);
+    EXPECT_EQ(sample.Pcm16()[4], -32768);
+
+    ASSERT_TRUE(bank.GetSample(bank.Find("pad"), sample));
+    EXPECT_EQ(sample.num_frames, 3u);
+    EXPECT_EQ(sample.channels, 2);
+    EXPECT_EQ(sample.loop_start, 1u);
+    EXPECT_EQ(sample.loop_end, 3u);
+    EXPECT_EQ(sample.Pcm16(), nullptr);
+    EXPECT_FLOAT_EQ(sample.Float32()[5], 0.25f);
+
+    EXPECT_TRUE(bank.Find("snare") == SampleBank::kNotFound);
+    EXPECT_FALSE(bank.GetSample(bank.Find("snare"), sample));
+    EXPECT_FALSE(bank.GetSample(2, sample));
+}
+
+TEST(util_SampleBank, b_rejectsBadImages)
+{
+    SampleBank           bank;
+    std::vector<uint8_t> erased(256, 0xff);
+    EXPECT_EQ(bank.Init(erased.data(), erased.size()),
+              SampleBank::Result::ERR_MAGIC);
+    EXPECT_EQ(bank.GetNumSamples(), 0u);
+    EXPECT_FALSE(bank.VerifyData());
+
+    std::vector<uint8_t> image = MakeImage();
+    EXPECT_EQ(bank.Init(image.data(), 100), SampleBank::Result::ERR_SIZE);
+    EXPECT_EQ(bank.Init(nullptr, 0), SampleBank::Result::ERR_SIZE);
+
+    image[4] = 2;
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_VERSION);
+
+    image = MakeImage();
+    image[40] ^= 1; // in the name of the first sample
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_CRC);
+
+    // the CRC of the data is only checked by VerifyData()
+    image = MakeImage();
+    image[130] ^= 1;
+    EXPECT_EQ(bank.Init(image.data(), image.size()), SampleBank::Result::OK);
+    EXPECT_FALSE(bank.VerifyData());
+}
+
+TEST(util_SampleBank, c_rejectsBadEntries)
+{
+    SampleBank           bank;
+    std::vector<uint8_t> image = MakeImage();
+
+    // not aligned
+    PatchEntry(image, 24, 164);
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_ENTRY);
+
+    // past the end of the image
+    image = MakeImage();
+    PatchEntry(image, 28, 64);
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_ENTRY);
+
+    // not a whole number of frames
+    image = MakeImage();
+    PatchEntry(image, 28, 20);
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_ENTRY);
+
+    // loop past the end of the sample
+    image = MakeImage();
+    PatchEntry(image, 40, 4);
+    EXPECT_EQ(bank.Init(image.data(), image.size()),
+              SampleBank::Result::ERR_ENTRY);
+}
@@ -0,0 +1,233 @@
+#include "util/SampleSlots.h"
+#include "FakeFatFs.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+void Put32(std::vector<uint8_t>& v, uint32_t x)
+{
+    for(int i = 0; i < 4; i++)
+        v.push_back(uint8_t(x >> (8 * i)));
+}
+
+void Put16(std::vector<uint8_t>& v, uint16_t x)
+{
+    v.push_back(uint8_t(x));
+    v.push_back(uint8_t(x >> 8));
+}
+
+void PutId(std::vector<uint8_t>& v, const char* id)
+{
+    v.insert(v.end(), id, id + 4);
+}
+
+/** a 16 bit stereo wav file, with an odd sized chunk before the data */
+std::vector<uint8_t> MakeWav(size_t frames)
+{
+    std::vector<uint8_t> v;
+    PutId(v, "RIFF");
+    Put32(v, 0);
+    PutId(v, "WAVE");
+    PutId(v, "fmt ");
+    Put32(v, 16);
+    Put16(v, WAVE_FORMAT_PCM);
+    Put16(v, 2);
+    Put32(v, 44100);
+    Put32(v, 44100 * 4);
+    Put16(v, 4);
+    Put16(v, 16);
+    PutId(v, "LIST");
+    Put32(v, 3);
+    v.insert(v.end(), {'a', 'b', 'c', 0});
+    PutId(v, "data");
+    Put32(v, uint32_t(frames * 4));
+    for(size_t i = 0; i < frames * 2; i++)
+        Put16(v, uint16_t(i));
+    return v;
+}
+} // namespace
+
+class util_SampleSlots : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        FakeFatFs::Reset();
+        queue_.Init(1024);
+        arena_.Init(memory_, sizeof(memory_));
+    }
+
+    void Init(size_t slot_size, size_t num_slots)
+    {
+        ASSERT_TRUE(slots_.Init(queue_, arena_, slot_size, num_slots));
+    }
+
+    /** runs the main loop until nothing is left to do */
+    void Run()
+    {
+        for(int i = 0; i < 100; i++)
+        {
+            slots_.Process();
+            queue_.Process(1000);
+        }
+    }
+
+    FileIoQueue queue_;
+    SampleSlots slots_;
+    MemoryArena arena_;
+    uint8_t     memory_[16384];
+};
+
+TEST_F(util_SampleSlots, a_loadsOnRequest)
+{
+    FakeFatFs::files["kick.wav"] = MakeWav(100);
+    Init(1024, 2);
+    const int kick = slots_.AddSample("kick.wav");
+    EXPECT_EQ(kick, 0);
+    EXPECT_STREQ(slots_.GetPath(kick), "kick.wav");
+    EXPECT_EQ(slots_.GetState(kick), SampleSlots::State::UNLOADED);
+
+    // nothing is loaded until it's requested
+    Run();
+    EXPECT_TRUE(FakeFatFs::calls.empty());
+    EXPECT_EQ(slots_.Acquire(kick), nullptr);
+
+    EXPECT_TRUE(slots_.Request(kick));
+    EXPECT_EQ(slots_.GetState(kick), SampleSlots::State::QUEUED);
+    slots_.Process();
+    EXPECT_EQ(slots_.GetState(kick), SampleSlots::State::LOADING);
+    EXPECT_EQ(slots_.Acquire(kick), nullptr);
+    Run();
+    EXPECT_EQ(slots_.GetState(kick), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.GetNumLoads(), 1u);
+    EXPECT_EQ(slots_.GetNumSlotsUsed(), 1u);
+
+    const SampleSlots::Sample* s = slots_.Acquire(kick);
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->format, WAVE_FORMAT_PCM);
+    EXPECT_EQ(s->num_channels, 2);
+    EXPECT_EQ(s->bit_depth, 16);
+    EXPECT_EQ(s->samplerate, 44100u);
+    EXPECT_EQ(s->num_frames, 100u);
+    EXPECT_EQ(s->size, 400u);
+    int16_t pcm[200];
+    std::memcpy(pcm, s->data, sizeof(pcm));
+    EXPECT_EQ(pcm[0], 0);
+    EXPECT_EQ(pcm[199], 199);
+    slots_.Release(kick);
+
+    // the slots are aligned to cache lines, the data follows the header
+    const size_t addr = reinterpret_cast<size_t>(s->data - 56);
+    EXPECT_EQ(addr % 32, 0u);
+}
+
+TEST_F(util_SampleSlots, b_evictsTheLeastRecentlyUsed)
+{
+    FakeFatFs::files["a"] = MakeWav(10);
+    FakeFatFs::files["b"] = MakeWav(20);
+    FakeFatFs::files["c"] = MakeWav(30);
+    Init(512, 2);
+    const int a = slots_.AddSample("a");
+    const int b = slots_.AddSample("b");
+    const int c = slots_.AddSample("c");
+    slots_.Request(a);
+    slots_.Request(b);
+    Run();
+    EXPECT_EQ(slots_.GetState(a), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.GetState(b), SampleSlots::State::READY);
+
+    // a was used after b, so b goes
+    slots_.Acquire(a);
+    slots_.Release(a);
+    slots_.Request(c);
+    Run();
+    EXPECT_EQ(slots_.GetState(a), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.GetState(b), SampleSlots::State::UNLOADED);
+    EXPECT_EQ(slots_.GetState(c), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.Acquire(c)->num_frames, 30u);
+    EXPECT_EQ(slots_.GetNumEvictions(), 1u);
+
+    // acquired samples stay, until they're released
+    slots_.Acquire(a);
+    slots_.Request(b);
+    Run();
+    EXPECT_EQ(slots_.GetState(b), SampleSlots::State::QUEUED);
+    slots_.Release(c);
+    Run();
+    EXPECT_EQ(slots_.GetState(b), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.GetState(c), SampleSlots::State::UNLOADED);
+    EXPECT_EQ(slots_.GetState(a), SampleSlots::State::READY);
+    EXPECT_EQ(slots_.Acquire(b)->num_frames, 20u);
+    EXPECT_EQ(slots_.GetNumLoads(), 4u);
+}
+
+TEST_F(util_SampleSlots, c_loadsInRequestOrder)
+{
+    FakeFatFs::files["a"] = MakeWav(10);
+    FakeFatFs::files["b"] = MakeWav(10);
+    Init(512, 2);
+    const int a = slots_.AddSample("a");
+    const int b = slots_.AddSample("b");
+    slots_.Request(b);
+    slots_.Request(a);
+    slots_.Request(b); // already queued, keeps its place
+    Run();
+    // open, read and close of each
+    ASSERT_EQ(FakeFatFs::calls.size(), 6u);
+    const std::string& first  = FakeFatFs::calls[0];
+    const std::string& second = FakeFatFs::calls[3];
+    EXPECT_EQ(first.substr(0, 5) + first.back(), "open b");
+    EXPECT_EQ(second.substr(0, 5) + second.back(), "open a");
+
+    // unloading frees the slot
+    EXPECT_TRUE(slots_.Unload(a));
+    EXPECT_EQ(slots_.GetState(a), SampleSlots::State::UNLOADED);
+    EXPECT_EQ(slots_.Acquire(a), nullptr);
+    EXPECT_EQ(slots_.GetNumSlotsUsed(), 1u);
+    slots_.Acquire(b);
+    EXPECT_FALSE(slots_.Unload(b));
+    slots_.Release(b);
+    EXPECT_TRUE(slots_.Unload(b));
+    EXPECT_EQ(slots_.GetNumSlotsUsed(), 0u);
+    EXPECT_EQ(slots_.GetNumEvictions(), 0u);
+}
+
+TEST_F(util_SampleSlots, d_failures)
+{
+    FakeFatFs::files["large"] = std::vector<uint8_t>(600);
+    FakeFatFs::files["raw"]   = std::vector<uint8_t>(300, 7);
+    Init(512, 1);
+    const int missing = slots_.AddSample("missing");
+    const int large   = slots_.AddSample("large");
+    const int raw     = slots_.AddSample("raw");
+    slots_.Request(missing);
+    slots_.Request(large);
+    Run();
+    EXPECT_EQ(slots_.GetState(missing), SampleSlots::State::FAILED);
+    EXPECT_EQ(slots_.GetState(large), SampleSlots::State::FAILED);
+    EXPECT_EQ(slots_.Acquire(large), nullptr);
+    EXPECT_EQ(slots_.GetNumSlotsUsed(), 0u);
+    EXPECT_FALSE(slots_.Request(3));
+    EXPECT_EQ(slots_.GetState(-1), SampleSlots::State::UNLOADED);
+
+    // a request tries again
+    FakeFatFs::files["missing"] = std::vector<uint8_t>(10);
+    slots_.Request(missing);
+    Run();
+    EXPECT_EQ(slots_.GetState(missing), SampleSlots::State::READY);
+
+    // files that aren't wav files are loaded as they are
+    slots_.Request(raw);
+    Run();
+    const SampleSlots::Sample* s = slots_.Acquire(raw);
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->size, 300u);
+    EXPECT_EQ(s->num_frames, 0u);
+    EXPECT_EQ(s->format, 0);
+    EXPECT_EQ(s->data[299], 7);
+}
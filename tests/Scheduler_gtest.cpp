@@ -0,0 +1,164 @@
+#include "sys/scheduler.h"
+#include "sys/system.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace daisy;
+
+namespace
+{
+/** records the order in which the tasks ran */
+std::string log;
+
+/** a task that takes some time */
+struct FakeTask
+{
+    char     name;
+    uint32_t duration_us;
+};
+
+void RunFakeTask(void* context)
+{
+    const auto* task = static_cast<const FakeTask*>(context);
+    log += task->name;
+    System::SetUsForUnitTest(System::GetUs() + task->duration_us);
+}
+} // namespace
+
+TEST(sys_Scheduler, a_periodicTasks)
+{
+    log.clear();
+    System::SetUsForUnitTest(0);
+    FakeTask  a = {'a', 0};
+    Scheduler sched;
+    sched.Init();
+    const auto id = sched.AddTask({"a", RunFakeTask, &a, 1000, 0, 0});
+    ASSERT_NE(id, Scheduler::kInvalidTask);
+
+    // due right away, then once per period
+    EXPECT_TRUE(sched.Process());
+    EXPECT_FALSE(sched.Process());
+    System::SetUsForUnitTest(999);
+    EXPECT_FALSE(sched.Process());
+    System::SetUsForUnitTest(1000);
+    EXPECT_TRUE(sched.Process());
+    EXPECT_EQ(log, "aa");
+    EXPECT_EQ(sched.GetStats(id).runs, 2u);
+    EXPECT_EQ(sched.GetStats(id).misses, 0u);
+
+    // two periods later, one run and a missed period
+    System::SetUsForUnitTest(3500);
+    EXPECT_TRUE(sched.Process());
+    EXPECT_FALSE(sched.Process());
+    EXPECT_EQ(sched.GetStats(id).misses, 1u);
+    EXPECT_EQ(sched.GetStats(id).max_late_us, 1500u);
+    System::SetUsForUnitTest(4000);
+    EXPECT_TRUE(sched.Process());
+}
+
+TEST(sys_Scheduler, b_priorityAndDeadline)
+{
+    log.clear();
+    System::SetUsForUnitTest(0);
+    FakeTask  slow = {'s', 2000}, fast = {'f', 10}, late = {'l', 10};
+    Scheduler sched;
+    sched.Init();
+    sched.AddTask({"slow", RunFakeTask, &slow, 10000, 1, 1000});
+    sched.AddTask({"late", RunFakeTask, &late, 20000, 2, 0});
+    sched.AddTask({"fast", RunFakeTask, &fast, 1000, 2, 0});
+
+    // same priority: the earlier deadline first, the slow task last
+    while(sched.Process()) {}
+    EXPECT_EQ(log.substr(0, 3), "fls");
+
+    // the slow task overran its budget, and delayed the fast one
+    EXPECT_EQ(sched.GetStats(0).overruns, 1u);
+    EXPECT_EQ(sched.GetStats(0).max_us, 2000u);
+}
+
+TEST(sys_Scheduler, c_trigger)
+{
+    log.clear();
+    System::SetUsForUnitTest(0);
+    FakeTask  t = {'t', 0};
+    Scheduler sched;
+    sched.Init();
+    const auto id = sched.AddTask({"t", RunFakeTask, &t, 0, 0, 0});
+
+    EXPECT_FALSE(sched.Process());
+    sched.Trigger(id);
+    sched.Trigger(id);
+    EXPECT_TRUE(sched.Process());
+    EXPECT_FALSE(sched.Process());
+    EXPECT_EQ(log, "t");
+
+    // disabled tasks don't run
+    sched.SetEnabled(id, false);
+    sched.Trigger(id);
+    EXPECT_FALSE(sched.Process());
+    sched.SetEnabled(id, true);
+    EXPECT_TRUE(sched.Process());
+}
+
+namespace
+{
+Scheduler*        yield_sched;
+int               yield_chunks;
+Scheduler::TaskId yield_trigger = Scheduler::kInvalidTask;
+
+/** works in chunks of 100us until told to yield, and triggers
+ *  yield_trigger after 3 chunks */
+void ChunkedTask(void*)
+{
+    do
+    {
+        yield_chunks++;
+        System::SetUsForUnitTest(System::GetUs() + 100);
+        if(yield_chunks == 3 && yield_trigger != Scheduler::kInvalidTask)
+            yield_sched->Trigger(yield_trigger);
+    } while(!yield_sched->ShouldYield());
+}
+
+void NoOp(void*) {}
+} // namespace
+
+TEST(sys_Scheduler, d_shouldYield)
+{
+    System::SetUsForUnitTest(0);
+    Scheduler sched;
+    yield_sched = &sched;
+    sched.Init();
+    EXPECT_FALSE(sched.ShouldYield());
+
+    // over budget after 5 chunks
+    yield_chunks = 0;
+    sched.AddTask({"chunked", ChunkedTask, nullptr, 10000, 0, 500});
+    EXPECT_TRUE(sched.Process());
+    EXPECT_EQ(yield_chunks, 5);
+    EXPECT_EQ(sched.GetStats(0).overruns, 0u);
+
+    // a more important task becomes due after 3 chunks
+    System::SetUsForUnitTest(10000);
+    yield_trigger = sched.AddTask({"urgent", NoOp, nullptr, 0, 1, 0});
+    yield_chunks  = 0;
+    EXPECT_TRUE(sched.Process());
+    EXPECT_EQ(yield_chunks, 3);
+    EXPECT_TRUE(sched.Process());
+    EXPECT_EQ(sched.GetStats(yield_trigger).runs, 1u);
+    EXPECT_EQ(sched.GetStats(yield_trigger).max_late_us, 0u);
+    yield_trigger = Scheduler::kInvalidTask;
+}
+
+TEST(sys_Scheduler, e_fullTable)
+{
+    Scheduler sched;
+    sched.Init();
+    EXPECT_EQ(sched.AddTask({"none", nullptr, nullptr, 0, 0, 0}),
+              Scheduler::kInvalidTask);
+    for(size_t i = 0; i < DSY_SCHEDULER_MAX_TASKS; i++)
+        EXPECT_NE(sched.AddTask({"noop", NoOp, nullptr, 1000, 0, 0}),
+                  Scheduler::kInvalidTask);
+    EXPECT_EQ(sched.AddTask({"noop", NoOp, nullptr, 1000, 0, 0}),
+              Scheduler::kInvalidTask);
+    EXPECT_EQ(sched.GetNumTasks(), size_t(DSY_SCHEDULER_MAX_TASKS));
+}
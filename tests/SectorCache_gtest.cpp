@@ -0,0 +1,114 @@
+#include "util/SectorCache.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** returns a sector filled with a pattern depending on its number */
+std::vector<uint8_t> MakeSector(uint32_t sector)
+{
+    std::vector<uint8_t> data(SectorCache::kSectorSize);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = uint8_t(sector * 7 + i);
+    return data;
+}
+} // namespace
+
+class util_SectorCache : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        // room for 2 sets
+        mem_.resize(2 * SectorCache::kWays * 520 / 4 + 8);
+        cache_.Init(mem_.data(), mem_.size() * 4);
+    }
+
+    std::vector<uint32_t> mem_;
+    SectorCache           cache_;
+    uint8_t               buff_[SectorCache::kSectorSize];
+};
+
+TEST_F(util_SectorCache, a_stateAfterInit)
+{
+    EXPECT_TRUE(cache_.IsEnabled());
+    EXPECT_EQ(cache_.GetNumSectors(), 2 * SectorCache::kWays);
+    EXPECT_FALSE(cache_.Read(0, buff_));
+    EXPECT_EQ(cache_.GetMisses(), 1u);
+    EXPECT_EQ(cache_.GetHits(), 0u);
+
+    // too small to hold anything
+    SectorCache tiny;
+    tiny.Init(mem_.data(), 1024);
+    EXPECT_FALSE(tiny.IsEnabled());
+    tiny.Insert(0, MakeSector(0).data());
+    EXPECT_FALSE(tiny.Read(0, buff_));
+}
+
+TEST_F(util_SectorCache, b_readsInsertedSectors)
+{
+    for(uint32_t s = 10; s < 14; s++)
+        cache_.Insert(s, MakeSector(s).data());
+    for(uint32_t s = 10; s < 14; s++)
+    {
+        ASSERT_TRUE(cache_.Read(s, buff_));
+        EXPECT_EQ(std::vector<uint8_t>(buff_, buff_ + sizeof(buff_)),
+                  MakeSector(s));
+    }
+    EXPECT_EQ(cache_.GetHits(), 4u);
+    EXPECT_FALSE(cache_.Read(14, buff_));
+    EXPECT_EQ(cache_.GetMisses(), 1u);
+
+    cache_.ResetStats();
+    EXPECT_EQ(cache_.GetHits(), 0u);
+    EXPECT_EQ(cache_.GetMisses(), 0u);
+}
+
+TEST_F(util_SectorCache, c_evictsLeastRecentlyUsed)
+{
+    // even sectors share a set
+    for(uint32_t s = 0; s < 8; s += 2)
+        cache_.Insert(s, MakeSector(s).data());
+    // use sector 0 again, so sector 2 is the oldest one
+    EXPECT_TRUE(cache_.Read(0, buff_));
+    cache_.Insert(8, MakeSector(8).data());
+
+    EXPECT_FALSE(cache_.Read(2, buff_));
+    EXPECT_TRUE(cache_.Read(0, buff_));
+    EXPECT_TRUE(cache_.Read(4, buff_));
+    EXPECT_TRUE(cache_.Read(6, buff_));
+    EXPECT_TRUE(cache_.Read(8, buff_));
+    EXPECT_EQ(std::vector<uint8_t>(buff_, buff_ + sizeof(buff_)),
+              MakeSector(8));
+
+    // the other set is unaffected
+    cache_.Insert(1, MakeSector(1).data());
+    EXPECT_TRUE(cache_.Read(1, buff_));
+}
+
+TEST_F(util_SectorCache, d_writeThrough)
+{
+    cache_.Insert(3, MakeSector(3).data());
+
+    // updating only changes cached sectors
+    cache_.Update(3, MakeSector(100).data());
+    cache_.Update(5, MakeSector(5).data());
+    ASSERT_TRUE(cache_.Read(3, buff_));
+    EXPECT_EQ(std::vector<uint8_t>(buff_, buff_ + sizeof(buff_)),
+              MakeSector(100));
+    EXPECT_FALSE(cache_.Read(5, buff_));
+
+    cache_.Invalidate(3);
+    EXPECT_FALSE(cache_.Read(3, buff_));
+}
+
+TEST_F(util_SectorCache, e_clear)
+{
+    cache_.Insert(1, MakeSector(1).data());
+    cache_.Insert(2, MakeSector(2).data());
+    cache_.Clear();
+    EXPECT_FALSE(cache_.Read(1, buff_));
+    EXPECT_FALSE(cache_.Read(2, buff_));
+}
@@ -0,0 +1,113 @@
+#include "hid/parameter.h"
+#include "hid/smoothing_bank.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace daisy;
+
+TEST(hid_SmoothingBank, a_linearPerBlock)
+{
+    SmoothingBank bank;
+    bank.Init(48000.f);
+    EXPECT_EQ(bank.Add(), 0);
+    EXPECT_EQ(bank.Add(SmoothingBank::Ramp::LINEAR, 0.f, 1.f), 1);
+
+    float        a[4], b[4];
+    float* const outs[]     = {a, b};
+    const float  targets[2] = {1.f, 0.f};
+    bank.SetTargets(targets, 2);
+    bank.Process(outs, 4);
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_FLOAT_EQ(a[i], 0.25f * (i + 1));
+        EXPECT_FLOAT_EQ(b[i], 1.f - 0.25f * (i + 1));
+    }
+
+    // holds the target while it stays
+    bank.Process(outs, 4);
+    for(int i = 0; i < 4; i++)
+        EXPECT_EQ(a[i], 1.f);
+    EXPECT_EQ(bank.Value(0), 1.f);
+}
+
+TEST(hid_SmoothingBank, b_linearTimed)
+{
+    // 10 samples of ramp, over blocks of 4
+    SmoothingBank bank;
+    bank.Init(1000.f);
+    bank.Add(SmoothingBank::Ramp::LINEAR, 0.01f);
+    bank.SetTarget(0, 10.f);
+
+    float        out[12];
+    float* const outs[] = {out};
+    for(int block = 0; block < 3; block++)
+    {
+        float* const block_outs[] = {out + 4 * block};
+        bank.Process(block_outs, 4);
+    }
+    for(int i = 0; i < 12; i++)
+        EXPECT_FLOAT_EQ(out[i], i < 10 ? float(i + 1) : 10.f) << i;
+    EXPECT_EQ(out[9], 10.f);
+
+    // a reset jumps, and nullptr still moves on
+    bank.Reset(0, 2.f);
+    bank.Process(outs, 4);
+    EXPECT_EQ(out[0], 2.f);
+    bank.SetTarget(0, 12.f);
+    float* const skip[] = {nullptr};
+    bank.Process(skip, 5);
+    EXPECT_FLOAT_EQ(bank.Value(0), 7.f);
+}
+
+TEST(hid_SmoothingBank, c_exponential)
+{
+    SmoothingBank bank;
+    bank.Init(1000.f);
+    bank.Add(SmoothingBank::Ramp::EXPONENTIAL, 0.01f);
+    bank.SetTarget(0, 1.f);
+
+    float        out[100];
+    float* const outs[] = {out};
+    bank.Process(outs, 100);
+    for(int i = 0; i < 100; i++)
+        EXPECT_NEAR(out[i], 1.f - std::exp(-(i + 1) / 10.f), 1e-5f) << i;
+
+    // settles on the target
+    for(int n = 0; n < 100; n++)
+        bank.Process(outs, 100);
+    EXPECT_EQ(bank.Value(0), 1.f);
+}
+
+TEST(hid_SmoothingBank, d_parameter)
+{
+    uint16_t      raw = 0;
+    AnalogControl ctrl;
+    ctrl.Init(&raw, 1000.f, false, false, 0.f);
+    Parameter param;
+    param.Init(ctrl, 10.f, 20.f, Parameter::LINEAR);
+    param.Process();
+
+    SmoothingBank bank;
+    bank.Init(48000.f);
+    EXPECT_EQ(bank.Add(&param), 0);
+    EXPECT_EQ(bank.Add(nullptr), SmoothingBank::kInvalidChannel);
+    EXPECT_FLOAT_EQ(bank.Value(0), 10.f);
+
+    // the next block ramps to the parameter's new value
+    raw = 32768;
+    float        out[2];
+    float* const outs[] = {out};
+    bank.Process(outs, 2);
+    EXPECT_FLOAT_EQ(bank.Target(0), param.Value());
+    EXPECT_FLOAT_EQ(out[1], param.Value());
+    EXPECT_GT(param.Value(), 10.f);
+}
+
+TEST(hid_SmoothingBank, e_full)
+{
+    SmoothingBank bank;
+    bank.Init(48000.f);
+    for(int i = 0; i < DSY_SMOOTHING_BANK_MAX_CHANNELS; i++)
+        EXPECT_EQ(bank.Add(), i);
+    EXPECT_EQ(bank.Add(), SmoothingBank::kInvalidChannel);
+}
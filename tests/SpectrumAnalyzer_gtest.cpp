@@ -0,0 +1,89 @@
+#include "hid/spectrum_analyzer.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+const double kPi = 3.14159265358979;
+
+std::vector<float> Sine(float bin, float amp, size_t n, size_t size)
+{
+    std::vector<float> s(size);
+    for(size_t i = 0; i < size; i++)
+        s[i] = amp * float(sin(2.0 * kPi * bin * double(i) / double(n)));
+    return s;
+}
+} // namespace
+
+TEST(hid_SpectrumAnalyzer, a_findsTheAmplitudeAndPeak)
+{
+    static SpectrumAnalyzer<256> analyzer;
+    analyzer.Init();
+    EXPECT_EQ(analyzer.GetNumBins(), 129u);
+
+    const std::vector<float> in = Sine(16.f, 0.5f, 256, 256);
+    EXPECT_FALSE(analyzer.Process());
+    analyzer.Write(in.data(), 128);
+    EXPECT_FALSE(analyzer.Process());
+    analyzer.Write(in.data() + 128, 128);
+    ASSERT_TRUE(analyzer.Process());
+    EXPECT_FALSE(analyzer.Process());
+
+    EXPECT_NEAR(analyzer.GetMagnitudes()[16], 0.5f, 1e-3f);
+    EXPECT_NEAR(analyzer.GetMagnitudes()[40], 0.f, 1e-3f);
+    EXPECT_NEAR(analyzer.GetPeakBin(), 16.f, 1e-3f);
+    EXPECT_FLOAT_EQ(analyzer.GetBinFrequency(16.f, 48000.f), 3000.f);
+
+    // between two bins, e.g. for a tuner
+    const std::vector<float> off = Sine(20.3f, 0.5f, 256, 256);
+    analyzer.Write(off.data(), 128);
+    ASSERT_TRUE(analyzer.Process());
+    analyzer.Write(off.data() + 128, 128);
+    ASSERT_TRUE(analyzer.Process());
+    EXPECT_NEAR(analyzer.GetPeakBin(), 20.3f, 0.1f);
+}
+
+TEST(hid_SpectrumAnalyzer, b_framesOverlapByTheHop)
+{
+    static SpectrumAnalyzer<256, 128> analyzer;
+    analyzer.Init();
+    const std::vector<float> in = Sine(8.f, 1.f, 256, 1024);
+    for(size_t i = 0; i < in.size(); i += 32)
+    {
+        analyzer.Write(&in[i], 32);
+        analyzer.Process();
+    }
+    EXPECT_EQ(analyzer.GetFrameCount(), 7u);
+    EXPECT_EQ(analyzer.GetDroppedFrames(), 0u);
+    EXPECT_NEAR(analyzer.GetMagnitudes()[8], 1.f, 1e-3f);
+}
+
+TEST(hid_SpectrumAnalyzer, c_skipsToTheNewestFrame)
+{
+    static SpectrumAnalyzer<256, 128> analyzer;
+    analyzer.Init();
+    const std::vector<float> in = Sine(8.f, 1.f, 256, 1024);
+    analyzer.Write(in.data(), in.size());
+
+    // the frames ending at 256 to 896 are skipped for the one at 1024
+    EXPECT_TRUE(analyzer.Process());
+    EXPECT_EQ(analyzer.GetDroppedFrames(), 6u);
+    EXPECT_FALSE(analyzer.Process());
+    EXPECT_EQ(analyzer.GetFrameCount(), 1u);
+}
+
+TEST(hid_SpectrumAnalyzer, d_runsAsAnAudioChainStage)
+{
+    static SpectrumAnalyzer<64, 64> analyzer;
+    analyzer.Init();
+    std::vector<float> left = Sine(4.f, 0.25f, 64, 64), right(64, 1.f);
+    float*             buf[2] = {left.data(), right.data()};
+    SpectrumAnalyzer<64, 64>::Stage(buf, 64, &analyzer);
+    ASSERT_TRUE(analyzer.Process());
+    EXPECT_NEAR(analyzer.GetMagnitudes()[4], 0.25f, 1e-3f);
+    // the block itself is left as it is
+    EXPECT_FLOAT_EQ(right[0], 1.f);
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "util/SpscFifo.h"
+
+using namespace daisy;
+
+class util_SpscFifo : public ::testing::Test
+{
+  protected:
+    static constexpr size_t fifoSize_ = 4;
+    SpscFifo<int, fifoSize_> fifo_;
+};
+constexpr size_t util_SpscFifo::fifoSize_; // required for C++14...
+
+TEST_F(util_SpscFifo, a_getCapacity)
+{
+    EXPECT_EQ(fifo_.GetCapacity(), fifoSize_);
+}
+
+TEST_F(util_SpscFifo, b_simplePushAndPop)
+{
+    // empty after initialization
+    EXPECT_EQ(fifo_.GetNumElements(), 0u);
+    EXPECT_TRUE(fifo_.IsEmpty());
+    EXPECT_FALSE(fifo_.IsFull());
+
+    // fill, all of the capacity is used
+    for(int i = 1; i <= 4; i++)
+        EXPECT_TRUE(fifo_.PushBack(i));
+    EXPECT_EQ(fifo_.GetNumElements(), 4u);
+    EXPECT_TRUE(fifo_.IsFull());
+
+    // can't push more
+    EXPECT_FALSE(fifo_.PushBack(5));
+
+    // pop in order
+    int value = 0;
+    for(int i = 1; i <= 4; i++)
+    {
+        EXPECT_TRUE(fifo_.PopFront(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_TRUE(fifo_.IsEmpty());
+    EXPECT_FALSE(fifo_.PopFront(value));
+    EXPECT_EQ(value, 4);
+}
+
+TEST_F(util_SpscFifo, c_wrapAround)
+{
+    // the indices run past the end of the buffer many times
+    int value = 0;
+    for(int i = 0; i < 100; i++)
+    {
+        EXPECT_TRUE(fifo_.PushBack(i));
+        EXPECT_TRUE(fifo_.PushBack(i + 1000));
+        EXPECT_TRUE(fifo_.PopFront(value));
+        EXPECT_EQ(value, i);
+        EXPECT_TRUE(fifo_.PopFront(value));
+        EXPECT_EQ(value, i + 1000);
+    }
+    EXPECT_TRUE(fifo_.IsEmpty());
+}
+
+TEST_F(util_SpscFifo, d_bulkPushAndPop)
+{
+    const int values[6] = {1, 2, 3, 4, 5, 6};
+    int       out[6]    = {};
+
+    // only as many as fit are added
+    EXPECT_EQ(fifo_.PushBack(values, 3), 3u);
+    EXPECT_EQ(fifo_.PushBack(values + 3, 3), 1u);
+    EXPECT_TRUE(fifo_.IsFull());
+
+    EXPECT_EQ(fifo_.PopFront(out, 2), 2u);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[1], 2);
+
+    // wraps around the end of the buffer
+    EXPECT_EQ(fifo_.PushBack(values + 4, 2), 2u);
+    EXPECT_EQ(fifo_.PopFront(out, 6), 4u);
+    EXPECT_EQ(out[0], 3);
+    EXPECT_EQ(out[1], 4);
+    EXPECT_EQ(out[2], 5);
+    EXPECT_EQ(out[3], 6);
+    EXPECT_EQ(fifo_.PopFront(out, 6), 0u);
+}
+
+TEST_F(util_SpscFifo, e_spans)
+{
+    int* write;
+    EXPECT_EQ(fifo_.Reserve(write), 4u);
+    write[0] = 10;
+    write[1] = 11;
+    write[2] = 12;
+    fifo_.Commit(3);
+
+    const int* read;
+    EXPECT_EQ(fifo_.Peek(read), 3u);
+    EXPECT_EQ(read[0], 10);
+    EXPECT_EQ(read[2], 12);
+    fifo_.Consume(2);
+
+    // the free space is only contiguous up to the end of the buffer
+    EXPECT_EQ(fifo_.Reserve(write), 1u);
+    write[0] = 13;
+    fifo_.Commit(1);
+    EXPECT_EQ(fifo_.Reserve(write), 2u);
+    write[0] = 14;
+    fifo_.Commit(1);
+
+    // so are the elements
+    EXPECT_EQ(fifo_.Peek(read), 2u);
+    EXPECT_EQ(read[0], 12);
+    EXPECT_EQ(read[1], 13);
+    fifo_.Consume(2);
+    EXPECT_EQ(fifo_.Peek(read), 1u);
+    EXPECT_EQ(read[0], 14);
+    fifo_.Consume(1);
+    EXPECT_EQ(fifo_.Peek(read), 0u);
+
+    EXPECT_EQ(fifo_.Reserve(write), 3u);
+}
+
+TEST_F(util_SpscFifo, f_clear)
+{
+    fifo_.PushBack(1);
+    fifo_.PushBack(2);
+    fifo_.Clear();
+    EXPECT_TRUE(fifo_.IsEmpty());
+    EXPECT_TRUE(fifo_.PushBack(3));
+    int value = 0;
+    EXPECT_TRUE(fifo_.PopFront(value));
+    EXPECT_EQ(value, 3);
+}
+
+TEST(util_SpscFifoThreads, a_producerAndConsumer)
+{
+    // every value arrives once and in order, with both sides running at once
+    static SpscFifo<uint32_t, 64> fifo;
+    constexpr uint32_t            kCount = 200000;
+
+    std::thread producer([] {
+        uint32_t next = 0;
+        while(next < kCount)
+        {
+            uint32_t block[5];
+            size_t   n = 0;
+            while(n < 5 && next + n < kCount)
+            {
+                block[n] = next + n;
+                n++;
+            }
+            next += fifo.PushBack(block, n);
+        }
+    });
+
+    uint32_t expected = 0;
+    bool     in_order = true;
+    while(expected < kCount)
+    {
+        const uint32_t* span;
+        const size_t    n = fifo.Peek(span);
+        for(size_t i = 0; i < n; i++)
+            in_order &= span[i] == expected + i;
+        fifo.Consume(n);
+        expected += n;
+    }
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(fifo.IsEmpty());
+}
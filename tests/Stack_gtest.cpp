@@ -157,4 +157,20 @@ TEST_F(util_Stack, i_countEqualTo)
     EXPECT_EQ(stack_.CountEqualTo(1), 1u);
     EXPECT_EQ(stack_.CountEqualTo(2), 2u);
     EXPECT_EQ(stack_.CountEqualTo(3), 0u);
-}
\ No newline at end of file
+}
+
+TEST(util_StackInit, a_initializerListKeepsMembers)
+{
+    // a type with default member initializers, which the elements of the
+    // buffer get when they are constructed
+    struct Item
+    {
+        int value = 0;
+    };
+    Item item;
+    item.value = 5;
+    const Stack<Item, 2> stack({item});
+
+    ASSERT_EQ(stack.GetNumElements(), 1u);
+    EXPECT_EQ(stack[0].value, 5);
+}
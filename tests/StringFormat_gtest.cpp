@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdint>
+#include "util/StringFormat.h"
+
+using namespace daisy;
+
+namespace
+{
+/** Checks the output and the return value against snprintf() */
+template <typename... Args>
+void ExpectLikePrintf(const char* format, Args... args)
+{
+    char   expected[64], actual[64];
+    size_t expected_len = snprintf(expected, sizeof(expected), format, args...);
+    size_t actual_len   = FormatString(actual, sizeof(actual), format, args...);
+    EXPECT_STREQ(actual, expected) << "format \"" << format << "\"";
+    EXPECT_EQ(actual_len, expected_len) << "format \"" << format << "\"";
+}
+} // namespace
+
+TEST(util_StringFormat, a_integers)
+{
+    ExpectLikePrintf("plain text");
+    ExpectLikePrintf("%d %i %u", 0, -42, 42u);
+    ExpectLikePrintf("%d %d", INT32_MIN, INT32_MAX);
+    ExpectLikePrintf("%5d|%-5d|%05d|%+d|% d", 42, 42, -42, 42, 42);
+    ExpectLikePrintf("%.3d %.0d %8.3d", 7, 0, -7);
+    ExpectLikePrintf(
+        "%lu %ld %llu", 4000000000ul, -5l, 18446744073709551615ull);
+    ExpectLikePrintf("%lld", -9223372036854775807ll);
+    ExpectLikePrintf(
+        "%zu %hd %hhu", size_t(123), short(-2), (unsigned char)(255));
+    ExpectLikePrintf("%*d|%-*d", 6, 1, 6, 2);
+    ExpectLikePrintf("100%%");
+}
+
+TEST(util_StringFormat, b_hexAndOctal)
+{
+    ExpectLikePrintf("%x %X %08x", 0xbeefu, 0xbeefu, 0x1234u);
+    ExpectLikePrintf("%#x %#X %#x", 255u, 255u, 0u);
+    ExpectLikePrintf("%o %#o", 8u, 8u);
+    ExpectLikePrintf("%llx", 0x123456789abcdefull);
+}
+
+TEST(util_StringFormat, c_floats)
+{
+    ExpectLikePrintf("%f", 3.14159);
+    ExpectLikePrintf("%.2f %.0f %.3f", 2.675, 2.6, -0.0005);
+    ExpectLikePrintf("%8.3f|%-8.3f|%08.3f", -1.5, 1.5, -1.5);
+    ExpectLikePrintf("%+.1f % .1f", 0.04, 0.04);
+    ExpectLikePrintf("%.1f %.2f", 0.96, 9.999);
+    ExpectLikePrintf("%.9f", 1.0 / 3.0);
+    ExpectLikePrintf("%.3f", 123456789012.5);
+    ExpectLikePrintf("%f %f", 1.0 / 0.0, -1.0 / 0.0);
+    ExpectLikePrintf("%.*f", 4, 0.1f);
+
+    // different from printf, halfway values round up
+    char buf[32];
+    FormatString(buf, sizeof(buf), "%.0f %.0f", 2.5, -0.5);
+    EXPECT_STREQ(buf, "3 -1");
+    FormatString(buf, sizeof(buf), "%f", 0.0 / 0.0);
+    EXPECT_TRUE(std::string(buf) == "nan" || std::string(buf) == "-nan");
+    FormatString(buf, sizeof(buf), "%g %e", 1.5, 1.5);
+    EXPECT_STREQ(buf, "1.500000 1.500000");
+}
+
+TEST(util_StringFormat, d_stringsAndChars)
+{
+    ExpectLikePrintf("%s|%8s|%-8s|%.2s", "abc", "abc", "abc", "abc");
+    ExpectLikePrintf("%c%c%3c", 'a', 'b', 'c');
+    ExpectLikePrintf("%-8s %5s %6lu", "region", "cache", 32ul);
+}
+
+TEST(util_StringFormat, e_truncation)
+{
+    // cut off at the size, the return value is the whole length
+    char buf[8] = "xxxxxxx";
+    EXPECT_EQ(FormatString(buf, sizeof(buf), "%s %d", "hello", 12345), 11u);
+    EXPECT_STREQ(buf, "hello 1");
+    EXPECT_EQ(FormatString(buf, 0, "abc"), 3u);
+    EXPECT_EQ(buf[0], 'h');
+
+    // appends to a string
+    FixedCapStr<12> str("x=");
+    EXPECT_EQ(AppendFormat(str, "%.2f, %d", 1.255f, 42), 8u);
+    EXPECT_STREQ(str, "x=1.25, 42");
+    AppendFormat(str, "%s", "overflow");
+    EXPECT_STREQ(str, "x=1.25, 42ov");
+}
@@ -0,0 +1,140 @@
+#include "util/Telemetry.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Collects the frames sent by Process() */
+struct FakeLog
+{
+    static void Write(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        frames.emplace_back(bytes, bytes + size);
+    }
+    static std::vector<std::vector<uint8_t>> frames;
+};
+std::vector<std::vector<uint8_t>> FakeLog::frames;
+
+uint32_t GetU32(const std::vector<uint8_t>& frame, size_t offset)
+{
+    return frame[offset] | (frame[offset + 1] << 8) | (frame[offset + 2] << 16)
+           | (uint32_t(frame[offset + 3]) << 24);
+}
+
+/** Checks the header and CRC of a frame, returns the payload size */
+size_t CheckFrame(const std::vector<uint8_t>& frame, uint8_t kind)
+{
+    EXPECT_GE(frame.size(), 8u);
+    EXPECT_EQ(frame[0], Telemetry<>::kMagic);
+    EXPECT_EQ(frame[1], kind);
+    const size_t payload = frame[2] | (frame[3] << 8);
+    EXPECT_EQ(frame.size(), payload + 8);
+    EXPECT_EQ(GetU32(frame, 4 + payload), Crc32(&frame[1], 3 + payload));
+    return payload;
+}
+
+float GetHalf(void*)
+{
+    return 0.5f;
+}
+} // namespace
+
+TEST(util_Telemetry, a_descriptorFrame)
+{
+    Telemetry<4>      telemetry;
+    volatile float    gain    = 0.0f;
+    volatile uint32_t dropped = 0;
+    telemetry.Init();
+    EXPECT_TRUE(telemetry.Add("gain", &gain));
+    EXPECT_TRUE(telemetry.Add("dropped", &dropped));
+    EXPECT_TRUE(telemetry.Add("half", GetHalf, nullptr));
+
+    const size_t         size = telemetry.BuildDescriptor();
+    const uint8_t*       data = telemetry.GetFrame();
+    std::vector<uint8_t> frame(data, data + size);
+    EXPECT_EQ(CheckFrame(frame, 'D'), 1u + 6 + 9 + 6);
+    EXPECT_EQ(frame[4], 3);
+    EXPECT_EQ(frame[5], uint8_t(Telemetry<4>::Type::FLOAT));
+    EXPECT_STREQ(reinterpret_cast<const char*>(&frame[6]), "gain");
+    EXPECT_EQ(frame[11], uint8_t(Telemetry<4>::Type::UINT32));
+    EXPECT_STREQ(reinterpret_cast<const char*>(&frame[12]), "dropped");
+}
+
+TEST(util_Telemetry, b_valueFrame)
+{
+    Telemetry<4>     telemetry;
+    volatile float   gain   = 0.25f;
+    volatile int32_t offset = -3;
+    telemetry.Init();
+    telemetry.Add("gain", &gain);
+    telemetry.Add("offset", &offset);
+    telemetry.Add("half", GetHalf, nullptr);
+
+    const size_t         size = telemetry.BuildValues(123456);
+    const uint8_t*       data = telemetry.GetFrame();
+    std::vector<uint8_t> frame(data, data + size);
+    EXPECT_EQ(CheckFrame(frame, 'V'), 6u + 3 * 4);
+    EXPECT_EQ(frame[4] | (frame[5] << 8), 0);
+    EXPECT_EQ(GetU32(frame, 6), 123456u);
+    float f;
+    uint32_t word = GetU32(frame, 10);
+    memcpy(&f, &word, sizeof(f));
+    EXPECT_EQ(f, 0.25f);
+    EXPECT_EQ(GetU32(frame, 14), uint32_t(-3));
+    word = GetU32(frame, 18);
+    memcpy(&f, &word, sizeof(f));
+    EXPECT_EQ(f, 0.5f);
+}
+
+TEST(util_Telemetry, c_processSendsAtTheRate)
+{
+    FakeLog::frames.clear();
+    Telemetry<4>      telemetry;
+    volatile uint32_t counter = 0;
+    telemetry.Init(10, 2);
+    telemetry.Add("counter", &counter);
+
+    System::SetUsForUnitTest(1000);
+    EXPECT_TRUE(telemetry.Process<FakeLog>());
+    ASSERT_EQ(FakeLog::frames.size(), 2u);
+    CheckFrame(FakeLog::frames[0], 'D');
+    CheckFrame(FakeLog::frames[1], 'V');
+
+    // not due yet
+    System::SetUsForUnitTest(10999);
+    EXPECT_FALSE(telemetry.Process<FakeLog>());
+    EXPECT_EQ(FakeLog::frames.size(), 2u);
+
+    System::SetUsForUnitTest(11000);
+    EXPECT_TRUE(telemetry.Process<FakeLog>());
+    ASSERT_EQ(FakeLog::frames.size(), 3u);
+    CheckFrame(FakeLog::frames[2], 'V');
+    EXPECT_EQ(FakeLog::frames[2][4], 1);
+
+    // the descriptor is repeated every 2 value frames
+    System::SetUsForUnitTest(21000);
+    EXPECT_TRUE(telemetry.Process<FakeLog>());
+    ASSERT_EQ(FakeLog::frames.size(), 5u);
+    CheckFrame(FakeLog::frames[3], 'D');
+    CheckFrame(FakeLog::frames[4], 'V');
+}
+
+TEST(util_Telemetry, d_fullTable)
+{
+    Telemetry<4>   telemetry;
+    CpuLoadMeter   meter;
+    volatile float value = 0.0f;
+    telemetry.Init();
+    EXPECT_TRUE(telemetry.Add("a", &value));
+    EXPECT_TRUE(telemetry.Add("b", &value));
+    EXPECT_FALSE(telemetry.AddCpuLoad(meter));
+    EXPECT_EQ(telemetry.GetNumChannels(), 2u);
+    telemetry.Init();
+    EXPECT_TRUE(telemetry.AddCpuLoad(meter));
+    EXPECT_TRUE(telemetry.Add("a", &value));
+    EXPECT_FALSE(telemetry.Add("b", &value));
+    EXPECT_EQ(telemetry.GetNumChannels(), 4u);
+}
@@ -0,0 +1,139 @@
+#include "util/TimerWheel.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+struct Log
+{
+    std::vector<int> ids;
+};
+
+struct Entry
+{
+    Log* log;
+    int  id;
+};
+
+void Record(void* context)
+{
+    Entry* e = static_cast<Entry*>(context);
+    e->log->ids.push_back(e->id);
+}
+} // namespace
+
+TEST(util_TimerWheel, a_oneShotInOrder)
+{
+    TimerWheel wheel;
+    Log        log;
+    Entry      e1{&log, 1}, e2{&log, 2}, e3{&log, 3};
+
+    TimerWheel::Timer t1(Record, &e1), t2(Record, &e2), t3(Record, &e3);
+    wheel.Init(1000);
+    // in the same slot and beyond the wheel
+    wheel.Schedule(t1, 1300);
+    wheel.Schedule(t2, 1200);
+    wheel.Schedule(t3, 1000 + 100000);
+    EXPECT_EQ(wheel.GetNumActive(), 3u);
+
+    EXPECT_EQ(wheel.Process(1199), 0u);
+    EXPECT_EQ(wheel.Process(1250), 1u);
+    EXPECT_EQ(log.ids, (std::vector<int>{2}));
+    EXPECT_FALSE(t2.IsActive());
+    EXPECT_TRUE(t1.IsActive());
+
+    // a late call fires everything that's over, in order
+    EXPECT_EQ(wheel.Process(1000 + 99999), 1u);
+    EXPECT_EQ(wheel.Process(1000 + 100000), 1u);
+    EXPECT_EQ(log.ids, (std::vector<int>{2, 1, 3}));
+    EXPECT_EQ(wheel.GetNumActive(), 0u);
+}
+
+TEST(util_TimerWheel, b_periodic)
+{
+    TimerWheel        wheel;
+    Log               log;
+    Entry             e{&log, 7};
+    TimerWheel::Timer t(Record, &e);
+
+    wheel.Init(0);
+    wheel.Schedule(t, 500, 500);
+    uint32_t now = 0;
+    for(int i = 0; i < 100; i++)
+    {
+        now += 100;
+        wheel.Process(now);
+    }
+    // at 500, 1000, ... 10000
+    EXPECT_EQ(log.ids.size(), 20u);
+    EXPECT_EQ(t.GetDeadline(), 10500u);
+
+    // periods that are over are skipped
+    log.ids.clear();
+    EXPECT_EQ(wheel.Process(12600), 1u);
+    EXPECT_EQ(t.GetDeadline(), 13000u);
+
+    EXPECT_TRUE(wheel.Cancel(t));
+    EXPECT_FALSE(wheel.Cancel(t));
+    EXPECT_EQ(wheel.Process(20000), 0u);
+}
+
+TEST(util_TimerWheel, c_rescheduleAndWrap)
+{
+    TimerWheel        wheel;
+    Log               log;
+    Entry             e1{&log, 1}, e2{&log, 2};
+    TimerWheel::Timer t1(Record, &e1), t2(Record, &e2);
+
+    // the times wrap around at 32 bits
+    const uint32_t start = 0xfffff000u;
+    wheel.Init(start);
+    wheel.Schedule(t1, start + 3000);
+    wheel.Schedule(t2, start + 2000000);
+    wheel.Schedule(t1, start + 6000);
+    EXPECT_EQ(wheel.GetNumActive(), 2u);
+
+    EXPECT_EQ(wheel.Process(start + 5999), 0u);
+    EXPECT_EQ(wheel.Process(start + 6000), 1u);
+    for(uint32_t t = 0; t <= 2000000; t += 1000)
+        wheel.Process(start + t);
+    EXPECT_EQ(log.ids, (std::vector<int>{1, 2}));
+
+    // a deadline that's over expires with the next call
+    wheel.Schedule(t1, start);
+    EXPECT_EQ(wheel.Process(start + 2000001), 1u);
+}
+
+namespace
+{
+struct Chain
+{
+    TimerWheel*       wheel;
+    TimerWheel::Timer timer;
+    int               count;
+};
+
+void Reschedule(void* context)
+{
+    Chain* c = static_cast<Chain*>(context);
+    c->count++;
+    if(c->count < 3)
+        c->wheel->Schedule(c->timer, c->timer.GetDeadline() + 40000);
+}
+} // namespace
+
+TEST(util_TimerWheel, d_scheduleFromCallback)
+{
+    TimerWheel wheel;
+    Chain      chain{&wheel, TimerWheel::Timer(), 0};
+    chain.timer.SetCallback(Reschedule, &chain);
+
+    wheel.Init(0);
+    wheel.Schedule(chain.timer, 40000);
+    for(uint32_t t = 0; t <= 200000; t += 250)
+        wheel.Process(t);
+    EXPECT_EQ(chain.count, 3);
+    EXPECT_FALSE(chain.timer.IsActive());
+}
@@ -0,0 +1,56 @@
+#include "util/TraceRecord.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace daisy;
+
+TEST(util_TraceRecord, a_headerWithoutArguments)
+{
+    static const char* format = "start";
+    TraceRecord<0>     record;
+    record.Encode(format, 0x1234, 1000);
+    EXPECT_EQ(record.GetSize(), 12u);
+    EXPECT_EQ(record.GetWord(0), 0x123400D5u);
+    EXPECT_EQ(record.GetWord(1), 1000u);
+    EXPECT_EQ(record.GetWord(2), uint32_t(uintptr_t(format)));
+
+    // the magic byte comes first on the stream
+    const uint8_t* bytes = static_cast<const uint8_t*>(record.GetData());
+    EXPECT_EQ(bytes[0], TraceRecord<0>::kMagic);
+}
+
+TEST(util_TraceRecord, b_argumentWords)
+{
+    enum Color
+    {
+        RED,
+        GREEN
+    };
+    const char*    name = "osc";
+    TraceRecord<6> record;
+    record.Encode(
+        "%d %u %f %s %c %d", 7, 99, -5, 42u, 1.5f, name, 'x', GREEN);
+
+    EXPECT_EQ(record.GetSize(), 36u);
+    EXPECT_EQ(record.GetWord(0), 0x000706D5u);
+    EXPECT_EQ(record.GetWord(1), 99u);
+    EXPECT_EQ(record.GetWord(3), uint32_t(-5));
+    EXPECT_EQ(record.GetWord(4), 42u);
+    float    f;
+    uint32_t word = record.GetWord(5);
+    memcpy(&f, &word, sizeof(f));
+    EXPECT_EQ(f, 1.5f);
+    EXPECT_EQ(record.GetWord(6), uint32_t(uintptr_t(name)));
+    EXPECT_EQ(record.GetWord(7), uint32_t('x'));
+    EXPECT_EQ(record.GetWord(8), uint32_t(GREEN));
+}
+
+TEST(util_TraceRecord, c_doublesAreStoredAsFloat)
+{
+    TraceRecord<1> record;
+    record.Encode("%f", 0, 0, 0.25);
+    float    f;
+    uint32_t word = record.GetWord(3);
+    memcpy(&f, &word, sizeof(f));
+    EXPECT_EQ(f, 0.25f);
+}
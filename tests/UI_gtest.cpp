@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "ui/UI.h"
+#include "sys/system.h"
+
+using namespace daisy;
+
+namespace
+{
+/** A page that counts how often it's drawn */
+class CountingPage : public UiPage
+{
+  public:
+    void Draw(const UiCanvasDescriptor&) override
+    {
+        numDraws++;
+        // takes 250us to draw
+        System::SetUsForUnitTest(System::GetUs() + 250);
+    }
+    bool IsAnimating(const UiCanvasDescriptor&) override { return animating; }
+    void OnUserInteraction() override { numInteractions++; }
+
+    int  numDraws        = 0;
+    int  numInteractions = 0;
+    bool animating       = false;
+};
+
+void NoOp(const UiCanvasDescriptor&) {}
+
+/** A display whose transfer takes until flushDone is set */
+bool flushDone  = true;
+int  numFlushes = 0;
+void StartFlush(const UiCanvasDescriptor&)
+{
+    numFlushes++;
+    flushDone = false;
+}
+bool FlushFinished(const UiCanvasDescriptor&)
+{
+    return flushDone;
+}
+
+/** A UI with one canvas, redrawn at most every 10ms */
+class ui_UI : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        System::SetUsForUnitTest(0);
+        UiCanvasDescriptor canvas;
+        canvas.id_            = 3;
+        canvas.handle_        = nullptr;
+        canvas.updateRateMs_  = 10;
+        canvas.clearFunction_ = &NoOp;
+        canvas.flushFunction_ = &NoOp;
+        ui_.Init(queue_, UI::SpecialControlIds{}, {canvas});
+        ui_.OpenPage(page_);
+    }
+
+    /** advances the time and processes the UI */
+    void ProcessAt(uint32_t ms)
+    {
+        System::SetUsForUnitTest(ms * 1000);
+        ui_.Process();
+    }
+
+    UiEventQueue queue_;
+    UI           ui_;
+    CountingPage page_;
+};
+} // namespace
+
+TEST_F(ui_UI, a_redrawsOnlyWhenInvalid)
+{
+    ProcessAt(20);
+    EXPECT_EQ(page_.numDraws, 1);
+
+    // nothing changed
+    ProcessAt(40);
+    ProcessAt(60);
+    EXPECT_EQ(page_.numDraws, 1);
+
+    // the page changed
+    page_.Invalidate();
+    ProcessAt(80);
+    EXPECT_EQ(page_.numDraws, 2);
+
+    // redrawn at the update rate
+    page_.Invalidate();
+    ProcessAt(85);
+    EXPECT_EQ(page_.numDraws, 2);
+    ProcessAt(91);
+    EXPECT_EQ(page_.numDraws, 3);
+
+    // user input
+    queue_.AddButtonPressed(0, 1);
+    ProcessAt(110);
+    EXPECT_EQ(page_.numDraws, 4);
+
+    // invalidating another canvas
+    ui_.Invalidate(4);
+    ProcessAt(130);
+    EXPECT_EQ(page_.numDraws, 4);
+    ui_.Invalidate(3);
+    ProcessAt(150);
+    EXPECT_EQ(page_.numDraws, 5);
+}
+
+TEST_F(ui_UI, b_animatingPagesAreRedrawn)
+{
+    ProcessAt(20);
+    page_.animating = true;
+    ProcessAt(40);
+    ProcessAt(60);
+    EXPECT_EQ(page_.numDraws, 3);
+
+    // not when hidden below an opaque page
+    CountingPage top;
+    ui_.OpenPage(top);
+    ProcessAt(80);
+    ProcessAt(100);
+    EXPECT_EQ(page_.numDraws, 3);
+    EXPECT_EQ(top.numDraws, 1);
+
+    // closing the page redraws
+    page_.animating = false;
+    ui_.ClosePage(top);
+    ProcessAt(120);
+    ProcessAt(140);
+    EXPECT_EQ(page_.numDraws, 4);
+}
+
+TEST_F(ui_UI, c_frameTimesAreMeasured)
+{
+    ProcessAt(20);
+    page_.Invalidate();
+    ProcessAt(40);
+
+    UI::FrameStats stats = ui_.GetFrameStats(3);
+    EXPECT_EQ(stats.numFrames, 2u);
+    EXPECT_EQ(stats.lastFrameUs, 250u);
+    EXPECT_EQ(stats.maxFrameUs, 250u);
+    EXPECT_EQ(stats.GetAverageFrameUs(), 250u);
+
+    // unknown canvas
+    EXPECT_EQ(ui_.GetFrameStats(4).numFrames, 0u);
+
+    ui_.ResetFrameStats();
+    EXPECT_EQ(ui_.GetFrameStats(3).numFrames, 0u);
+}
+
+TEST_F(ui_UI, d_drawsAfterTheFlushFinished)
+{
+    // a UI of its own, with a canvas that flushes asynchronously
+    System::SetUsForUnitTest(0);
+    flushDone  = true;
+    numFlushes = 0;
+
+    UiEventQueue       queue;
+    UI                 ui;
+    CountingPage       page;
+    UiCanvasDescriptor canvas;
+    canvas.id_                    = 1;
+    canvas.handle_                = nullptr;
+    canvas.updateRateMs_          = 10;
+    canvas.clearFunction_         = &NoOp;
+    canvas.flushFunction_         = &StartFlush;
+    canvas.flushFinishedFunction_ = &FlushFinished;
+    ui.Init(queue, UI::SpecialControlIds{}, {canvas});
+    ui.OpenPage(page);
+
+    System::SetUsForUnitTest(20000);
+    ui.Process();
+    EXPECT_EQ(page.numDraws, 1);
+    EXPECT_EQ(numFlushes, 1);
+
+    // input is handled while the display transmits, the redraw waits
+    queue.AddButtonPressed(0, 1);
+    System::SetUsForUnitTest(40000);
+    ui.Process();
+    EXPECT_EQ(page.numInteractions, 1);
+    EXPECT_EQ(page.numDraws, 1);
+    EXPECT_EQ(ui.GetFrameStats(1).numDeferred, 1u);
+
+    flushDone = true;
+    System::SetUsForUnitTest(41000);
+    ui.Process();
+    EXPECT_EQ(page.numDraws, 2);
+    EXPECT_EQ(numFlushes, 2);
+}
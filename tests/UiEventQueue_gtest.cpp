@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "ui/UiEventQueue.h"
+
+using namespace daisy;
+
+using EventType = UiEventQueue::Event::EventType;
+
+TEST(ui_UiEventQueue, a_eventsAreReadInOrder)
+{
+    UiEventQueue queue;
+    EXPECT_TRUE(queue.IsQueueEmpty());
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type, EventType::invalid);
+
+    queue.AddButtonPressed(1, 2, true);
+    queue.AddButtonReleased(1);
+    queue.AddPotActivityChanged(3, true);
+    EXPECT_FALSE(queue.IsQueueEmpty());
+
+    auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::buttonPressed);
+    EXPECT_EQ(e.asButtonPressed.id, 1);
+    EXPECT_EQ(e.asButtonPressed.numSuccessivePresses, 2);
+    EXPECT_TRUE(e.asButtonPressed.isRetriggering);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type, EventType::buttonReleased);
+    e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::potActivityChanged);
+    EXPECT_EQ(e.asPotActivityChanged.newActivityType,
+              UiEventQueue::Event::ActivityType::active);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
+
+TEST(ui_UiEventQueue, b_potMovesAreCoalesced)
+{
+    UiEventQueue queue;
+    queue.AddPotMoved(1, 0.1f);
+    queue.AddPotMoved(1, 0.2f);
+    queue.AddPotMoved(1, 0.3f);
+    // another pot
+    queue.AddPotMoved(2, 0.4f);
+    queue.AddPotMoved(1, 0.5f);
+
+    auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::potMoved);
+    EXPECT_EQ(e.asPotMoved.id, 1);
+    EXPECT_FLOAT_EQ(e.asPotMoved.newPosition, 0.3f);
+    e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.asPotMoved.id, 2);
+    e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.asPotMoved.id, 1);
+    EXPECT_FLOAT_EQ(e.asPotMoved.newPosition, 0.5f);
+
+    // once read, an event isn't changed
+    queue.AddPotMoved(1, 0.6f);
+    EXPECT_FLOAT_EQ(queue.GetAndRemoveNextEvent().asPotMoved.newPosition,
+                    0.6f);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
+
+TEST(ui_UiEventQueue, c_encoderTurnsAreSummed)
+{
+    UiEventQueue queue;
+    queue.AddEncoderTurned(1, 1, 24);
+    queue.AddEncoderTurned(1, 2, 24);
+    queue.AddEncoderTurned(1, -1, 24);
+    // not after other events
+    queue.AddEncoderActivityChanged(1, false);
+    queue.AddEncoderTurned(1, 5, 24);
+    // not when they don't fit
+    queue.AddEncoderTurned(1, INT16_MAX, 24);
+
+    auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, EventType::encoderTurned);
+    EXPECT_EQ(e.asEncoderTurned.increments, 2);
+    EXPECT_EQ(e.asEncoderTurned.stepsPerRev, 24);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              EventType::encoderActivityChanged);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().asEncoderTurned.increments, 5);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().asEncoderTurned.increments,
+              INT16_MAX);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+
+    // a pot with the ID of the encoder
+    queue.AddEncoderTurned(7, 1, 24);
+    queue.AddPotMoved(7, 0.5f);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type, EventType::encoderTurned);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type, EventType::potMoved);
+}
+
+TEST(ui_UiEventQueue, d_fullQueueDropsEvents)
+{
+    UiEventQueue queue;
+    for(int i = 0; i < 300; i++)
+        queue.AddButtonPressed(uint16_t(i), 1);
+    EXPECT_EQ(queue.GetNumDroppedEvents(), 44u);
+    // coalescing still works, the queue isn't longer
+    queue.GetAndRemoveNextEvent();
+    queue.AddPotMoved(1, 0.1f);
+    queue.AddPotMoved(1, 0.2f);
+    EXPECT_EQ(queue.GetNumDroppedEvents(), 44u);
+
+    int numEvents = 0;
+    while(!queue.IsQueueEmpty())
+    {
+        auto e = queue.GetAndRemoveNextEvent();
+        if(numEvents < 255)
+        {
+            EXPECT_EQ(e.asButtonPressed.id, numEvents + 1);
+        }
+        numEvents++;
+    }
+    EXPECT_EQ(numEvents, 256);
+}
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
 #include "util/VoctCalibration.h"
 
 using namespace daisy;
@@ -81,4 +83,34 @@ TEST(util_VoctCalibration, d_manualValueSetting)
     EXPECT_TRUE(isCalibrated);
     EXPECT_FLOAT_EQ(scale, 60.f);
     EXPECT_FLOAT_EQ(offset, -1.f);
-}
\ No newline at end of file
+}
+TEST(util_VoctCalibration, e_frequency)
+{
+    VoctCalibration cal;
+    cal.Record(0.2f, 0.6f);
+
+    // 0.2 is 1V, note 12, 0.4 is 2V, note 24
+    const float inputs[4] = {0.f, 0.2f, 0.4f, 0.5f};
+    float       out[4];
+    for(float cents : {0.f, 0.13f, 3.f})
+    {
+        cal.SetPitchAccuracy(cents);
+        cal.ProcessInputToFrequency(inputs, out, 4);
+        for(int i = 0; i < 4; i++)
+        {
+            const float note = cal.ProcessInput(inputs[i]);
+            const float exact
+                = 440.f * std::pow(2.f, (note - 69.f) / 12.f);
+            const float error = 1200.f * std::log2(out[i] / exact);
+            EXPECT_LT(std::fabs(error), std::max(cents, 0.01f));
+            EXPECT_EQ(cal.ProcessInputToFrequency(inputs[i]), out[i]);
+        }
+    }
+
+    cal.SetTuning(432.f);
+    cal.SetPitchAccuracy(0.f);
+    // 0.4 is note 24, 3.75 octaves below A4
+    EXPECT_NEAR(cal.ProcessInputToFrequency(0.4f),
+                432.f / 8.f * std::pow(2.f, -0.75f),
+                1e-3f);
+}
@@ -0,0 +1,163 @@
+#include "util/WorkQueue.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+std::vector<int> calls;
+
+void Record(void* context)
+{
+    calls.push_back(*static_cast<int*>(context));
+}
+
+int notifications;
+
+void Notify(void*)
+{
+    notifications++;
+}
+} // namespace
+
+TEST(util_WorkQueue, a_callsInOrder)
+{
+    calls.clear();
+    WorkQueue<4> queue;
+    int          values[] = {1, 2, 3};
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_FALSE(queue.Post(nullptr));
+    for(auto& v : values)
+        EXPECT_TRUE(queue.Post(Record, &v));
+    EXPECT_FALSE(queue.IsEmpty());
+
+    EXPECT_EQ(queue.Process(2), 2u);
+    EXPECT_EQ(queue.Process(), 1u);
+    EXPECT_EQ(queue.Process(), 0u);
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_EQ(calls, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(util_WorkQueue, b_fullQueue)
+{
+    calls.clear();
+    WorkQueue<4> queue;
+    int          value = 7;
+    for(int i = 0; i < 4; i++)
+        EXPECT_TRUE(queue.Post(Record, &value));
+    EXPECT_FALSE(queue.Post(Record, &value));
+
+    // wraps around after it was processed
+    EXPECT_EQ(queue.Process(), 4u);
+    for(int i = 0; i < 3; i++)
+        EXPECT_TRUE(queue.Post(Record, &value));
+    EXPECT_EQ(queue.Process(), 3u);
+
+    const auto stats = queue.GetStats();
+    EXPECT_EQ(stats.posted, 7u);
+    EXPECT_EQ(stats.processed, 7u);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(stats.max_depth, 4u);
+}
+
+TEST(util_WorkQueue, c_latencyAndNotify)
+{
+    notifications = 0;
+    WorkQueue<8> queue;
+    int          value = 0;
+    queue.SetNotify(Notify);
+    System::SetCycleCountForUnitTest(1000);
+    queue.Post(Record, &value);
+    System::SetCycleCountForUnitTest(1500);
+    queue.Post(Record, &value);
+    EXPECT_EQ(notifications, 2);
+
+    System::SetCycleCountForUnitTest(3000);
+    queue.Process();
+    auto stats = queue.GetStats();
+    EXPECT_EQ(stats.max_latency, 2000u);
+    EXPECT_EQ(stats.total_latency, 3500u);
+
+    queue.ResetStats();
+    stats = queue.GetStats();
+    EXPECT_EQ(stats.posted, 0u);
+    EXPECT_EQ(stats.max_latency, 0u);
+}
+
+namespace
+{
+WorkQueue<4>* repost_queue;
+int           reposts;
+
+void Repost(void*)
+{
+    if(++reposts < 10)
+        repost_queue->Post(Repost);
+}
+} // namespace
+
+TEST(util_WorkQueue, d_postFromCall)
+{
+    WorkQueue<4> queue;
+    repost_queue = &queue;
+    reposts      = 0;
+    queue.Post(Repost);
+    // each call frees its slot first, the new post is processed as well
+    EXPECT_EQ(queue.Process(), 10u);
+    EXPECT_EQ(reposts, 10);
+}
+
+namespace
+{
+struct Counter
+{
+    std::vector<uint32_t> seen;
+    uint32_t              producer;
+    uint32_t              index;
+};
+
+Counter counters[4];
+
+void Count(void* context)
+{
+    auto* item = static_cast<uint32_t*>(context);
+    counters[*item >> 16].seen.push_back(*item & 0xffff);
+}
+} // namespace
+
+TEST(util_WorkQueue, e_concurrentProducers)
+{
+    constexpr uint32_t kPerProducer = 2000;
+    static uint32_t    items[4][kPerProducer];
+    WorkQueue<64>      queue;
+
+    std::vector<std::thread> producers;
+    for(uint32_t p = 0; p < 4; p++)
+    {
+        counters[p].seen.clear();
+        producers.emplace_back([&queue, p] {
+            for(uint32_t i = 0; i < kPerProducer; i++)
+            {
+                items[p][i] = (p << 16) | i;
+                while(!queue.Post(Count, &items[p][i]))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    size_t processed = 0;
+    while(processed < 4 * kPerProducer)
+        processed += queue.Process();
+    for(auto& t : producers)
+        t.join();
+
+    // nothing lost, and each producer's calls in order
+    for(uint32_t p = 0; p < 4; p++)
+    {
+        ASSERT_EQ(counters[p].seen.size(), kPerProducer);
+        for(uint32_t i = 0; i < kPerProducer; i++)
+            EXPECT_EQ(counters[p].seen[i], i);
+    }
+    EXPECT_LE(queue.GetStats().max_depth, 64u);
+}
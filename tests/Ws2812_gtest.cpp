@@ -0,0 +1,116 @@
+#include "dev/ws2812.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Records the transfers, and completes them when the test says so */
+struct FakeTransport
+{
+    struct Config
+    {
+        void Defaults() {}
+    };
+
+    bool Init(Config&) { return true; }
+
+    bool Transmit(uint8_t* data, size_t size, void (*done)(void*), void* ctx)
+    {
+        sent.emplace_back(data, data + size);
+        done_    = done;
+        context_ = ctx;
+        return true;
+    }
+
+    static void Complete() { done_(context_); }
+
+    static std::vector<std::vector<uint8_t>> sent;
+    static void (*done_)(void*);
+    static void* context_;
+};
+std::vector<std::vector<uint8_t>> FakeTransport::sent;
+void (*FakeTransport::done_)(void*);
+void* FakeTransport::context_;
+
+using Strip = Ws2812<FakeTransport>;
+
+class dev_Ws2812 : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        Strip::Config cfg;
+        cfg.Defaults();
+        cfg.num_pixels   = 2;
+        cfg.dma_buffer_a = buffer_a_;
+        cfg.dma_buffer_b = buffer_b_;
+        FakeTransport::sent.clear();
+        ASSERT_EQ(strip_.Init(cfg), Strip::Result::OK);
+    }
+
+    Strip   strip_;
+    uint8_t buffer_a_[Strip::GetDmaBufferSize(2)];
+    uint8_t buffer_b_[Strip::GetDmaBufferSize(2)];
+};
+} // namespace
+
+TEST_F(dev_Ws2812, encodesThreeSpiBitsPerBit)
+{
+    // GRB order, 0x0F green, 0xA0 red, 0xFF blue
+    strip_.SetPixelColor(0, 0xA0, 0x0F, 0xFF);
+    strip_.Encode(buffer_a_);
+
+    const uint8_t* p = buffer_a_ + Strip::kResetBytes;
+    // 0x0F: 100 100 100 100 110 110 110 110
+    EXPECT_EQ(p[0], 0x92);
+    EXPECT_EQ(p[1], 0x4D);
+    EXPECT_EQ(p[2], 0xB6);
+    // 0xA0: 110 100 110 100 100 100 100 100
+    EXPECT_EQ(p[3], 0xD3);
+    EXPECT_EQ(p[4], 0x49);
+    EXPECT_EQ(p[5], 0x24);
+    // 0xFF
+    EXPECT_EQ(p[6], 0xDB);
+    EXPECT_EQ(p[7], 0x6D);
+    EXPECT_EQ(p[8], 0xB6);
+    // the second pixel is black, the reset stays low
+    EXPECT_EQ(p[9], 0x92);
+    EXPECT_EQ(p[18], 0x00);
+    EXPECT_EQ(buffer_a_[0], 0x00);
+}
+
+TEST_F(dev_Ws2812, showDoesNotWaitForTheStrip)
+{
+    strip_.Fill(0x010203);
+    EXPECT_EQ(strip_.Show(), Strip::Result::OK);
+    ASSERT_EQ(FakeTransport::sent.size(), 1u);
+    EXPECT_TRUE(strip_.IsBusy());
+
+    // both frames wait for the first transfer, only the last one is sent
+    strip_.Fill(0x040506);
+    strip_.Show();
+    strip_.Fill(0x070809);
+    strip_.Show();
+    EXPECT_EQ(FakeTransport::sent.size(), 1u);
+
+    FakeTransport::Complete();
+    ASSERT_EQ(FakeTransport::sent.size(), 2u);
+    std::vector<uint8_t> expected(Strip::GetDmaBufferSize(2));
+    strip_.Encode(expected.data());
+    EXPECT_EQ(FakeTransport::sent[1], expected);
+
+    FakeTransport::Complete();
+    EXPECT_FALSE(strip_.IsBusy());
+    EXPECT_EQ(FakeTransport::sent.size(), 2u);
+}
+
+TEST_F(dev_Ws2812, rejectsPixelsOutOfRange)
+{
+    EXPECT_EQ(strip_.SetPixelColor(2, 1, 2, 3),
+              Strip::Result::ERR_INVALID_ARGUMENT);
+    strip_.SetPixelColor(1, 0x112233);
+    EXPECT_EQ(strip_.GetPixelColor(1), 0x112233u);
+    EXPECT_EQ(strip_.GetPixelColor(2), 0u);
+}
@@ -0,0 +1,141 @@
+// Host build of the ContainerBenchmark, see "make benchmark" in tests/
+//
+// Times the container operations in nanoseconds on the host, and prints a
+// table. The best of a few runs is taken, which is less noisy than the
+// mean. A run can be saved as a baseline and later runs compared against
+// it, to see if a change to one of the headers made them slower:
+//
+//   ./container_benchmark --save baseline.txt
+//   (change the code, rebuild)
+//   ./container_benchmark --compare baseline.txt --tolerance 20
+//
+// --compare exits with 1 if an operation got slower than the baseline by
+// more than the tolerance, in percent. Only compare runs on one machine.
+#include "util/ContainerBenchmark.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace daisy;
+
+namespace
+{
+struct HostLog
+{
+    template <typename... VA>
+    static void PrintLine(const char* format, VA... va)
+    {
+        std::printf(format, va...);
+        std::printf("\n");
+    }
+};
+
+uint32_t GetNs()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    const auto        now   = std::chrono::steady_clock::now();
+    return uint32_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - start)
+            .count());
+}
+
+bool Save(const char* path, const ContainerBenchmark::Result* results)
+{
+    std::FILE* f = std::fopen(path, "w");
+    if(f == nullptr)
+        return false;
+    for(size_t i = 0; i < ContainerBenchmark::kNumResults; i++)
+        std::fprintf(f, "%s\t%f\n", results[i].name, results[i].PerOp());
+    return std::fclose(f) == 0;
+}
+
+/** Returns the number of operations slower than the baseline, -1 if it
+ *  can't be read */
+int Compare(const char*                       path,
+            const ContainerBenchmark::Result* results,
+            float                             tolerance)
+{
+    std::FILE* f = std::fopen(path, "r");
+    if(f == nullptr)
+        return -1;
+    int  slower = 0;
+    char line[128];
+    while(std::fgets(line, sizeof(line), f) != nullptr)
+    {
+        char* tab = std::strchr(line, '\t');
+        if(tab == nullptr)
+            continue;
+        *tab             = 0;
+        const float base = float(std::atof(tab + 1));
+        for(size_t i = 0; i < ContainerBenchmark::kNumResults; i++)
+        {
+            if(std::strcmp(results[i].name, line) != 0 || base <= 0.f)
+                continue;
+            const float change = (results[i].PerOp() / base - 1.f) * 100.f;
+            const bool  bad    = change > tolerance;
+            std::printf("%-28s %8.1f -> %8.1f ns %+6.1f%%%s\n",
+                        line,
+                        base,
+                        results[i].PerOp(),
+                        change,
+                        bad ? "  SLOWER" : "");
+            slower += bad ? 1 : 0;
+        }
+    }
+    std::fclose(f);
+    return slower;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* save      = nullptr;
+    const char* compare   = nullptr;
+    float       tolerance = 20.f;
+    uint32_t    scale     = 16;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        if(std::strcmp(argv[i], "--save") == 0)
+            save = argv[i + 1];
+        else if(std::strcmp(argv[i], "--compare") == 0)
+            compare = argv[i + 1];
+        else if(std::strcmp(argv[i], "--tolerance") == 0)
+            tolerance = float(std::atof(argv[i + 1]));
+        else if(std::strcmp(argv[i], "--scale") == 0)
+            scale = uint32_t(std::atoi(argv[i + 1]));
+    }
+
+    ContainerBenchmark::Result best[ContainerBenchmark::kNumResults];
+    ContainerBenchmark::Result run[ContainerBenchmark::kNumResults];
+    ContainerBenchmark::Run(GetNs, best, scale);
+    for(int pass = 0; pass < 4; pass++)
+    {
+        ContainerBenchmark::Run(GetNs, run, scale);
+        for(size_t i = 0; i < ContainerBenchmark::kNumResults; i++)
+            if(run[i].count < best[i].count)
+                best[i] = run[i];
+    }
+
+    ContainerBenchmark::PrintHeader<HostLog>("ns per op");
+    for(const auto& r : best)
+        ContainerBenchmark::PrintRow<HostLog>(r);
+
+    if(save != nullptr && !Save(save, best))
+    {
+        std::printf("can't write %s\n", save);
+        return 2;
+    }
+    if(compare != nullptr)
+    {
+        const int slower = Compare(compare, best, tolerance);
+        if(slower < 0)
+        {
+            std::printf("can't read %s\n", compare);
+            return 2;
+        }
+        return slower > 0 ? 1 : 0;
+    }
+    return 0;
+}
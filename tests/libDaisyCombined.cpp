@@ -1,7 +1,29 @@
+#include "sys/dma_streams.cpp"
+#include "sys/scheduler.cpp"
 #include "sys/system.cpp"
 #include "ui/AbstractMenu.cpp"
 #include "ui/UI.cpp"
+#include "util/BlockPool.cpp"
+#include "util/BootTimer.cpp"
+#include "util/FileIoQueue.cpp"
+#include "util/KeyValueStore.cpp"
 #include "util/MappedValue.cpp"
+#include "util/MemoryArena.cpp"
+#include "util/PoolHeap.cpp"
+#include "util/Profiler.cpp"
+#include "util/IrqProfiler.cpp"
+#include "util/SampleSlots.cpp"
+#include "util/StringFormat.cpp"
+#include "util/TimerWheel.cpp"
 #include "util/oled_fonts.c"
+#include "util/oled_page_fonts.c"
+#include "per/adc_filter.cpp"
 #include "per/qspi.cpp"
+#include "hid/midi_clock.cpp"
 #include "hid/midi_parser.cpp"
+#include "hid/midi_encoder.cpp"
+#include "hid/midi_router.cpp"
+#include "hid/ctrl.cpp"
+#include "hid/ctrl_bank.cpp"
+#include "hid/parameter.cpp"
+#include "hid/smoothing_bank.cpp"